@@ -34,3 +34,25 @@ function(find_tests dir dependencies)
     endif()
   endforeach()
 endfunction()
+
+# Benchmarks (*_benchmark.cpp files) are compiled with the tests but
+# they aren't run by ctest, they must be executed manually. The ones
+# that use tests/benchmark.h accept --save/--baseline to detect
+# regressions between two runs.
+function(find_benchmarks dir dependencies)
+  file(GLOB benchmarks ${CMAKE_CURRENT_SOURCE_DIR}/${dir}/*_benchmark.cpp)
+  list(REMOVE_AT ARGV 0)
+
+  foreach(benchmarksourcefile ${benchmarks})
+    get_filename_component(benchmarkname ${benchmarksourcefile} NAME_WE)
+
+    add_executable(${benchmarkname} ${benchmarksourcefile})
+
+    if(MSVC)
+      set_target_properties(${benchmarkname}
+        PROPERTIES LINK_FLAGS -ENTRY:"mainCRTStartup")
+    endif()
+
+    target_link_libraries(${benchmarkname} ${ARGV} ${PLATFORM_LIBS})
+  endforeach()
+endfunction()
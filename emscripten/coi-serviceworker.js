@@ -0,0 +1,41 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+// The threads of the WebAssembly build need SharedArrayBuffer, which
+// is available only in cross-origin isolated pages. When the server
+// doesn't send the COOP/COEP headers, index.html registers this
+// service worker to add them to each response.
+
+self.addEventListener("install", () => self.skipWaiting());
+
+self.addEventListener("activate", (event) => {
+  event.waitUntil(self.clients.claim());
+});
+
+self.addEventListener("fetch", (event) => {
+  const request = event.request;
+  if (request.cache === "only-if-cached" && request.mode !== "same-origin")
+    return;
+
+  event.respondWith(
+    fetch(request).then((response) => {
+      // Opaque responses cannot be modified
+      if (response.status === 0)
+        return response;
+
+      const headers = new Headers(response.headers);
+      headers.set("Cross-Origin-Embedder-Policy", "require-corp");
+      headers.set("Cross-Origin-Opener-Policy", "same-origin");
+
+      return new Response(response.body, {
+        status: response.status,
+        statusText: response.statusText,
+        headers: headers,
+      });
+    })
+  );
+});
@@ -12,6 +12,8 @@
 #include "app/app.h"
 
 #include "app/app_options.h"
+#include "app/batch_loader.h"
+#include "app/benchmark.h"
 #include "app/color_utils.h"
 #include "app/commands/cmd_save_file.h"
 #include "app/commands/cmd_sprite_size.h"
@@ -23,9 +25,11 @@
 #include "app/document_undo.h"
 #include "app/file/file.h"
 #include "app/file/file_formats_manager.h"
+#include "app/file/png_options.h"
 #include "app/file_system.h"
 #include "app/filename_formatter.h"
 #include "app/gui_xml.h"
+#include "app/image_swap_manager.h"
 #include "app/ini_file.h"
 #include "app/log.h"
 #include "app/modules.h"
@@ -37,8 +41,11 @@
 #include "app/resource_finder.h"
 #include "app/script/app_scripting.h"
 #include "app/send_crash.h"
+#include "app/server.h"
 #include "app/shell.h"
 #include "app/tools/active_tool.h"
+#include "app/tools/cel_tool_loop.h"
+#include "app/tools/stroke_recording.h"
 #include "app/tools/tool_box.h"
 #include "app/ui/color_bar.h"
 #include "app/ui/document_view.h"
@@ -57,6 +64,8 @@
 #include "base/fs.h"
 #include "base/path.h"
 #include "base/split_string.h"
+#include "base/thread_pool.h"
+#include "base/trace_span.h"
 #include "doc/document_observer.h"
 #include "doc/frame_tag.h"
 #include "doc/image.h"
@@ -74,12 +83,19 @@
 #include "ui/intern.h"
 #include "ui/ui.h"
 
+#include <chrono>
 #include <iostream>
 
 namespace app {
 
 using namespace ui;
 
+// Documents kept open by the --server mode
+static const int kServerMaxDocuments = 16;
+
+// Times that each --benchmark workload is executed
+static const int kBenchmarkIterations = 3;
+
 class App::CoreModules {
 public:
   ConfigModule m_configModule;
@@ -111,7 +127,7 @@ public:
   }
 
   bool hasRecoverySessions() const {
-    return m_recovery && !m_recovery->sessions().empty();
+    return m_recovery && m_recovery->hasRecoverableSessions();
   }
 
   void createDataRecovery() {
@@ -124,6 +140,43 @@ public:
 
 };
 
+// Prints the time spent in each step of App::initialize() (enabled
+// with --startup-profile).
+class StartupProfile {
+  typedef std::chrono::steady_clock Clock;
+public:
+  StartupProfile(bool enabled)
+    : m_enabled(enabled)
+    , m_start(Clock::now())
+    , m_last(m_start) {
+  }
+
+  void step(const char* name) {
+    if (!m_enabled)
+      return;
+
+    Clock::time_point now = Clock::now();
+    std::cout << "Startup: " << name << " "
+              << milliseconds(now - m_last) << " ms" << std::endl;
+    m_last = now;
+  }
+
+  void total() {
+    if (m_enabled)
+      std::cout << "Startup: total "
+                << milliseconds(Clock::now() - m_start) << " ms" << std::endl;
+  }
+
+private:
+  static double milliseconds(Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+  }
+
+  bool m_enabled;
+  Clock::time_point m_start;
+  Clock::time_point m_last;
+};
+
 App* App::m_instance = NULL;
 
 App::App()
@@ -132,6 +185,8 @@ App::App()
   , m_legacy(nullptr)
   , m_isGui(false)
   , m_isShell(false)
+  , m_isServer(false)
+  , m_isBenchmark(false)
   , m_exporter(nullptr)
 {
   ASSERT(m_instance == NULL);
@@ -140,12 +195,27 @@ App::App()
 
 void App::initialize(const AppOptions& options)
 {
+  StartupProfile profile(options.startupProfile());
+
+  m_traceFileName = options.traceFileName();
+  if (!m_traceFileName.empty())
+    base::trace::set_enabled(true);
+
   m_isGui = options.startUI();
   m_isShell = options.startShell();
+  m_isServer = options.startServer();
+  m_isBenchmark = options.startBenchmark();
   if (m_isGui)
     m_uiSystem.reset(new ui::UISystem);
+  profile.step("ui system");
 
   m_coreModules = std::make_unique<CoreModules>();
+  profile.step("config and preferences");
+
+  // Size of the shared thread pool (before anyone uses it)
+  base::thread_pool::set_default_workers(
+    options.threads() >= 0 ? options.threads():
+                             preferences().general.workerThreads());
 
   bool createLogInDesktop = false;
   switch (options.verboseLevel()) {
@@ -162,8 +232,15 @@ void App::initialize(const AppOptions& options)
   }
 
   m_modules = std::make_unique<Modules>(createLogInDesktop);
+  profile.step("modules (tools, commands, context)");
+
   m_legacy = std::make_unique<LegacyModules>(isGui() ? REQUIRE_INTERFACE: 0);
-  m_brushes.reset(new AppBrushes);
+  profile.step("gui and theme");
+
+  // Memory limit for the cel images (it's checked when big files are
+  // loaded, and from time to time by the ImageSwapManager in GUI mode)
+  ImageSwapManager::setMemoryBudget(
+    preferences().experimental.imageMemoryBudget());
 
   if (options.hasExporterParams())
     m_exporter.reset(new DocumentExporter);
@@ -171,6 +248,7 @@ void App::initialize(const AppOptions& options)
   // Data recovery is enabled only in GUI mode
   if (isGui() && preferences().general.dataRecovery())
     m_modules->createDataRecovery();
+  profile.step("data recovery");
 
   if (isPortable())
     LOG("Running in portable mode\n");
@@ -178,6 +256,7 @@ void App::initialize(const AppOptions& options)
   // Load or create the default palette, or migrate the default
   // palette from an old format palette to the new one, etc.
   load_default_palette(options.paletteFileName());
+  profile.step("default palette");
 
   // Initialize GUI interface
   UIContext* ctx = UIContext::instance();
@@ -196,6 +275,8 @@ void App::initialize(const AppOptions& options)
 
     // Create the main window and show it.
     m_mainWindow.reset(new MainWindow);
+    m_imageSwapManager.reset(new ImageSwapManager);
+    profile.step("main window");
 
     // Default status of the main window.
     app_rebuild_documents_tabs();
@@ -209,6 +290,7 @@ void App::initialize(const AppOptions& options)
 
     // Redraw the whole screen.
     ui::Manager::getDefault()->invalidate();
+    profile.step("open main window");
   }
 
   // Procress options
@@ -230,9 +312,25 @@ void App::initialize(const AppOptions& options)
     std::string importLayer;
     std::string importLayerSaveAs;
     std::string filenameFormat;
+    base::SharedPtr<FormatOptions> pngOptions;
     std::string frameTagName;
     std::string frameRange;
 
+    // In batch mode the files are loaded by the BatchLoader (the next
+    // files can be decoded while the current one is processed)
+    std::unique_ptr<BatchLoader> loader;
+    if (!isGui()) {
+      loader.reset(new BatchLoader(ctx, options.jobs()));
+      loader->setMetadataOnly(!m_exporter &&
+                              options.hasOnlyListingParams());
+      if (options.jobs() > 1) {
+        for (const auto& value : options.values()) {
+          if (!value.option())
+            loader->addFile(base::normalize_path(value.value()));
+        }
+      }
+    }
+
     for (const auto& value : options.values()) {
       const AppOptions::Option* opt = value.option();
 
@@ -256,6 +354,16 @@ void App::initialize(const AppOptions& options)
             m_exporter->setDataFormat(format);
           }
         }
+        // --compact-data
+        else if (opt == &options.compactData()) {
+          if (m_exporter)
+            m_exporter->setCompactData(true);
+        }
+        // --data-binary <file.bin>
+        else if (opt == &options.dataBinary()) {
+          if (m_exporter)
+            m_exporter->setDataBinaryFilename(value.value());
+        }
         // --sheet <file.png>
         else if (opt == &options.sheet()) {
           if (m_exporter)
@@ -283,11 +391,18 @@ void App::initialize(const AppOptions& options)
             sheetType = SpriteSheetType::Columns;
           else if (value.value() == "packed")
             sheetType = SpriteSheetType::Packed;
+          else if (value.value() == "maxrects")
+            sheetType = SpriteSheetType::MaxRects;
         }
         // --sheet-pack
         else if (opt == &options.sheetPack()) {
           sheetType = SpriteSheetType::Packed;
         }
+        // --sheet-rotation
+        else if (opt == &options.sheetRotation()) {
+          if (m_exporter)
+            m_exporter->setAllowRotation(true);
+        }
         // --split-layers
         else if (opt == &options.splitLayers()) {
           splitLayers = true;
@@ -351,6 +466,14 @@ void App::initialize(const AppOptions& options)
         else if (opt == &options.filenameFormat()) {
           filenameFormat = value.value();
         }
+        // --png-options <options>
+        else if (opt == &options.pngOptions()) {
+          base::SharedPtr<PngOptions> png(new PngOptions);
+          if (png->parse(value.value()))
+            pngOptions = png;
+          else
+            console.printf("Invalid --png-options argument: %s\n", value.value().c_str());
+        }
         // --save-as <filename>
         else if (opt == &options.saveAs()) {
           Document* doc = nullptr;
@@ -362,6 +485,8 @@ void App::initialize(const AppOptions& options)
           }
           else {
             ctx->setActiveDocument(doc);
+            if (pngOptions)
+              doc->setFormatOptions(pngOptions);
 
             std::string format = filenameFormat;
 
@@ -508,6 +633,23 @@ void App::initialize(const AppOptions& options)
           AppScripting engine;
           engine.evalFile(value.value());
         }
+        // --replay-strokes <filename>
+        else if (opt == &options.replayStrokes()) {
+          Document* doc = nullptr;
+          if (!ctx->documents().empty())
+            doc = dynamic_cast<Document*>(ctx->documents().lastAdded());
+
+          if (!doc) {
+            console.printf("A document is needed before --replay-strokes argument\n");
+          }
+          else {
+            tools::StrokeRecording recording;
+            std::vector<std::vector<tools::ToolLoopManager::StepTimes>> steps;
+            recording.load(value.value());
+            tools::replay_strokes_in_document(doc, recording, steps);
+            tools::write_replay_report(std::cout, recording, steps);
+          }
+        }
         // --list-layers
         else if (opt == &options.listLayers()) {
           listLayers = true;
@@ -525,19 +667,25 @@ void App::initialize(const AppOptions& options)
       else {
         const std::string& filename = base::normalize_path(value.value());
 
-        app::Document* oldDoc = ctx->activeDocument();
+        app::Document* doc = nullptr;
+        if (loader) {
+          doc = loader->open(filename);
+        }
+        else {
+          app::Document* oldDoc = ctx->activeDocument();
 
-        Command* openCommand = CommandsModule::instance()->getCommandByName(CommandId::OpenFile);
-        Params params;
-        params.set("filename", filename.c_str());
-        ctx->executeCommand(openCommand, params);
+          Command* openCommand = CommandsModule::instance()->getCommandByName(CommandId::OpenFile);
+          Params params;
+          params.set("filename", filename.c_str());
+          ctx->executeCommand(openCommand, params);
 
-        app::Document* doc = ctx->activeDocument();
+          doc = ctx->activeDocument();
 
-        // If the active document is equal to the previous one, it
-        // means that we couldn't open this specific document.
-        if (doc == oldDoc)
-          doc = nullptr;
+          // If the active document is equal to the previous one, it
+          // means that we couldn't open this specific document.
+          if (doc == oldDoc)
+            doc = nullptr;
+        }
 
         // List layers and/or tags
         if (doc) {
@@ -614,6 +762,10 @@ void App::initialize(const AppOptions& options)
 
     if (m_exporter && !filenameFormat.empty())
       m_exporter->setFilenameFormat(filenameFormat);
+
+    if (loader && !options.summaryFileName().empty() &&
+        !loader->saveSummary(options.summaryFileName()))
+      console.printf("Cannot save the summary in %s\n", options.summaryFileName().c_str());
   }
 
   // Export
@@ -634,8 +786,10 @@ void App::initialize(const AppOptions& options)
 
     LOG("Export sprite sheet: Done\n");
   }
+  profile.step("command line options");
 
   she::instance()->finishLaunching();
+  profile.total();
 }
 
 void App::run()
@@ -665,6 +819,21 @@ void App::run()
     shell.run(engine);
   }
 
+  // Process render requests from stdin.
+  if (m_isServer) {
+    script::EngineDelegate::setDefault("server");
+    script::Engine::setDefault("js");
+    AppScripting engine;
+    Server server(&m_modules->m_ui_context, kServerMaxDocuments);
+    server.run(engine, std::cin, std::cout);
+  }
+
+  // Run the standard workloads and print the timings.
+  if (m_isBenchmark) {
+    Benchmark benchmark(&m_modules->m_ui_context, kBenchmarkIterations);
+    benchmark.run(std::cout);
+  }
+
   // Destroy all documents in the UIContext.
   const doc::Documents& docs = m_modules->m_ui_context.documents();
   while (!docs.empty()) {
@@ -687,6 +856,7 @@ void App::run()
 
   if (isGui()) {
     // Destroy the window.
+    m_imageSwapManager.reset(nullptr);
     m_mainWindow.reset(nullptr);
   }
 
@@ -701,6 +871,10 @@ App::~App()
   try {
     ASSERT(m_instance == this);
 
+    if (!m_traceFileName.empty() &&
+        !base::trace::save_chrome_json(m_traceFileName))
+      LOG("ASE: Cannot save trace file %s\n", m_traceFileName.c_str());
+
     // Remove LibreSprite handlers
     LOG("ASE: Uninstalling\n");
 
@@ -718,7 +892,7 @@ App::~App()
 
     // Destroy the loaded gui.xml data.
     delete KeyboardShortcuts::instance();
-    delete GuiXml::instance();
+    GuiXml::destroyInstance();
 
     m_instance = nullptr;
   }
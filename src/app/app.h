@@ -31,6 +31,7 @@ namespace app {
   class DocumentExporter;
   class INotificationDelegate;
   class InputChain;
+  class ImageSwapManager;
   class LegacyModules;
   class LoggerModule;
   class MainWindow;
@@ -76,8 +77,10 @@ namespace app {
     Timeline* timeline() const;
     Preferences& preferences() const;
 
+    // Brushes are loaded on first use (batch mode doesn't need them)
     AppBrushes& brushes() {
-      ASSERT(m_brushes.get());
+      if (!m_brushes)
+        m_brushes.reset(new AppBrushes);
       return *m_brushes;
     }
 
@@ -103,10 +106,14 @@ namespace app {
     std::unique_ptr<LegacyModules> m_legacy;
     bool m_isGui;
     bool m_isShell;
+    bool m_isServer;
+    bool m_isBenchmark;
     std::unique_ptr<MainWindow> m_mainWindow;
     FileList m_files;
     std::unique_ptr<DocumentExporter> m_exporter;
     std::unique_ptr<AppBrushes> m_brushes;
+    std::unique_ptr<ImageSwapManager> m_imageSwapManager;
+    std::string m_traceFileName; // Where the --trace spans are saved on exit
   };
 
   void app_refresh_screen();
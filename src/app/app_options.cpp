@@ -24,20 +24,27 @@ AppOptions::AppOptions(int argc, const char* argv[])
   : m_exeName(base::get_file_name(argv[0]))
   , m_startUI(true)
   , m_startShell(false)
+  , m_startServer(false)
+  , m_startBenchmark(false)
   , m_verboseLevel(kNoVerbose)
   , m_palette(m_po.add("palette").requiresValue("<filename>").description("Use a specific palette by default"))
   , m_shell(m_po.add("shell").description("Start an interactive console to execute scripts"))
+  , m_server(m_po.add("server").description("Process JSON requests from stdin (open, render,\nsheet, script) keeping the documents loaded"))
+  , m_benchmark(m_po.add("benchmark").description("Measure the time of standard workloads\n(load, save, render, filters, etc.) and\nprint the results in JSON format"))
   , m_batch(m_po.add("batch").mnemonic('b').description("Do not start the UI"))
   , m_saveAs(m_po.add("save-as").requiresValue("<filename>").description("Save the last given document with other format"))
   , m_scale(m_po.add("scale").requiresValue("<factor>").description("Resize all previous opened documents"))
   , m_shrinkTo(m_po.add("shrink-to").requiresValue("width,height").description("Shrink each sprite if it is\nlarger than width or height"))
   , m_data(m_po.add("data").requiresValue("<filename.json>").description("File to store the sprite sheet metadata"))
   , m_format(m_po.add("format").requiresValue("<format>").description("Format to export the data file\n(json-hash, json-array)"))
+  , m_compactData(m_po.add("compact-data").description("Save the data file without whitespace"))
+  , m_dataBinary(m_po.add("data-binary").requiresValue("<filename.bin>").description("File to store the frames of the sprite sheet\nin a binary format for game engines"))
   , m_sheet(m_po.add("sheet").requiresValue("<filename.png>").description("Image file to save the texture"))
   , m_sheetWidth(m_po.add("sheet-width").requiresValue("<pixels>").description("Sprite sheet width"))
   , m_sheetHeight(m_po.add("sheet-height").requiresValue("<pixels>").description("Sprite sheet height"))
-  , m_sheetType(m_po.add("sheet-type").requiresValue("<type>").description("Algorithm to create the sprite sheet:\n  horizontal\n  vertical\n  rows\n  columns\n  packed"))
+  , m_sheetType(m_po.add("sheet-type").requiresValue("<type>").description("Algorithm to create the sprite sheet:\n  horizontal\n  vertical\n  rows\n  columns\n  packed\n  maxrects"))
   , m_sheetPack(m_po.add("sheet-pack").description("Same as --sheet-type packed"))
+  , m_sheetRotation(m_po.add("sheet-rotation").description("Rotate frames 90 degrees when it saves space\n(only with --sheet-type maxrects)"))
   , m_splitLayers(m_po.add("split-layers").description("Import each layer of the next given sprite as\na separated image in the sheet"))
   , m_layer(m_po.add("layer").alias("import-layer").requiresValue("<name>").description("Include just the given layer in the sheet"))
   , m_allLayers(m_po.add("all-layers").description("Make all layers visible\nBy default hidden layers will be ignored"))
@@ -50,9 +57,16 @@ AppOptions::AppOptions(int argc, const char* argv[])
   , m_trim(m_po.add("trim").description("Trim all images before exporting"))
   , m_crop(m_po.add("crop").requiresValue("x,y,width,height").description("Crop all the images to the given rectangle"))
   , m_filenameFormat(m_po.add("filename-format").requiresValue("<fmt>").description("Special format to generate filenames"))
+  , m_pngOptions(m_po.add("png-options").requiresValue("<options>").description("Comma-separated options for the next saved PNG files:\n  fastest, best, level=0-9,\n  filter=default|none|sub|up|avg|paeth|all,\n  strategy=default|filtered|huffman|rle"))
   , m_script(m_po.add("script").requiresValue("<filename>").description("Execute a specific script"))
+  , m_replayStrokes(m_po.add("replay-strokes").requiresValue("<filename>").description("Replay the recorded strokes in the last given\ndocument and print the time of each step"))
   , m_listLayers(m_po.add("list-layers").description("List layers of the next given sprite\nor include layers in JSON data"))
   , m_listTags(m_po.add("list-tags").description("List tags of the next given sprite sprite\nor include frame tags in JSON data"))
+  , m_jobs(m_po.add("jobs").requiresValue("<count>").description("Number of files loaded in parallel\nin batch mode (default 1)"))
+  , m_summary(m_po.add("summary").requiresValue("<filename.json>").description("Save the result of each given file\nin JSON format (batch mode)"))
+  , m_threads(m_po.add("threads").requiresValue("<count>").description("Number of worker threads to process\nimages in parallel (0 = automatic)"))
+  , m_trace(m_po.add("trace").requiresValue("<filename.json>").description("Record the time spent in the hot paths and\nsave it in Chrome trace format on exit"))
+  , m_startupProfile(m_po.add("startup-profile").description("Print the time spent in each step of the startup"))
   , m_verbose(m_po.add("verbose").mnemonic('v').description("Explain what is being done"))
   , m_debug(m_po.add("debug").description("Extreme verbose mode and\ncopy log to desktop"))
   , m_help(m_po.add("help").mnemonic('?').description("Display this help and exits"))
@@ -68,6 +82,8 @@ AppOptions::AppOptions(int argc, const char* argv[])
 
     m_paletteFileName = m_po.value_of(m_palette);
     m_startShell = m_po.enabled(m_shell);
+    m_startServer = m_po.enabled(m_server);
+    m_startBenchmark = m_po.enabled(m_benchmark);
 
     if (m_po.enabled(m_help)) {
       showHelp();
@@ -78,7 +94,10 @@ AppOptions::AppOptions(int argc, const char* argv[])
       m_startUI = false;
     }
 
-    if (m_po.enabled(m_shell) || m_po.enabled(m_batch)) {
+    if (m_po.enabled(m_shell) ||
+        m_po.enabled(m_server) ||
+        m_po.enabled(m_benchmark) ||
+        m_po.enabled(m_batch)) {
       m_startUI = false;
     }
   }
@@ -93,9 +112,34 @@ bool AppOptions::hasExporterParams() const
 {
   return
     m_po.enabled(m_data) ||
+    m_po.enabled(m_dataBinary) ||
     m_po.enabled(m_sheet);
 }
 
+bool AppOptions::hasOnlyListingParams() const
+{
+  if (!m_po.enabled(m_listLayers) &&
+      !m_po.enabled(m_listTags))
+    return false;
+
+  for (const auto& value : m_po.values()) {
+    const Option* opt = value.option();
+    if (opt &&
+        opt != &m_listLayers &&
+        opt != &m_listTags &&
+        opt != &m_allLayers &&
+        opt != &m_batch &&
+        opt != &m_jobs &&
+        opt != &m_summary &&
+        opt != &m_threads &&
+        opt != &m_trace &&
+        opt != &m_verbose &&
+        opt != &m_debug)
+      return false;
+  }
+  return true;
+}
+
 void AppOptions::showHelp()
 {
   std::cout
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdlib>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -31,7 +32,26 @@ public:
 
   bool startUI() const { return m_startUI; }
   bool startShell() const { return m_startShell; }
+  bool startServer() const { return m_startServer; }
+  bool startBenchmark() const { return m_startBenchmark; }
   VerboseLevel verboseLevel() const { return m_verboseLevel; }
+  bool startupProfile() const { return m_po.enabled(m_startupProfile); }
+
+  std::string traceFileName() const { return m_po.value_of(m_trace); }
+
+  // Number of worker threads given with --threads (-1 if it wasn't
+  // specified).
+  int threads() const {
+    return (m_po.enabled(m_threads) ? std::atoi(m_po.value_of(m_threads).c_str()): -1);
+  }
+
+  // Number of files loaded in parallel in batch mode (--jobs).
+  int jobs() const {
+    return (m_po.enabled(m_jobs) ? std::atoi(m_po.value_of(m_jobs).c_str()): 1);
+  }
+
+  // File to save the result of each file in batch mode (--summary).
+  std::string summaryFileName() const { return m_po.value_of(m_summary); }
 
   const std::string& paletteFileName() const { return m_paletteFileName; }
 
@@ -45,11 +65,14 @@ public:
   const Option& shrinkTo() const { return m_shrinkTo; }
   const Option& data() const { return m_data; }
   const Option& format() const { return m_format; }
+  const Option& compactData() const { return m_compactData; }
+  const Option& dataBinary() const { return m_dataBinary; }
   const Option& sheet() const { return m_sheet; }
   const Option& sheetWidth() const { return m_sheetWidth; }
   const Option& sheetHeight() const { return m_sheetHeight; }
   const Option& sheetType() const { return m_sheetType; }
   const Option& sheetPack() const { return m_sheetPack; }
+  const Option& sheetRotation() const { return m_sheetRotation; }
   const Option& splitLayers() const { return m_splitLayers; }
   const Option& layer() const { return m_layer; }
   const Option& allLayers() const { return m_allLayers; }
@@ -62,12 +85,19 @@ public:
   const Option& trim() const { return m_trim; }
   const Option& crop() const { return m_crop; }
   const Option& filenameFormat() const { return m_filenameFormat; }
+  const Option& pngOptions() const { return m_pngOptions; }
   const Option& script() const { return m_script; }
+  const Option& replayStrokes() const { return m_replayStrokes; }
   const Option& listLayers() const { return m_listLayers; }
   const Option& listTags() const { return m_listTags; }
 
   bool hasExporterParams() const;
 
+  // True if the files are opened just to list their layers/tags (no
+  // other option uses the documents), so they can be loaded without
+  // pixels.
+  bool hasOnlyListingParams() const;
+
 private:
   void showHelp();
   void showVersion();
@@ -76,22 +106,29 @@ private:
   base::ProgramOptions m_po;
   bool m_startUI;
   bool m_startShell;
+  bool m_startServer;
+  bool m_startBenchmark;
   VerboseLevel m_verboseLevel;
   std::string m_paletteFileName;
 
   Option& m_palette;
   Option& m_shell;
+  Option& m_server;
+  Option& m_benchmark;
   Option& m_batch;
   Option& m_saveAs;
   Option& m_scale;
   Option& m_shrinkTo;
   Option& m_data;
   Option& m_format;
+  Option& m_compactData;
+  Option& m_dataBinary;
   Option& m_sheet;
   Option& m_sheetWidth;
   Option& m_sheetHeight;
   Option& m_sheetType;
   Option& m_sheetPack;
+  Option& m_sheetRotation;
   Option& m_splitLayers;
   Option& m_layer;
   Option& m_allLayers;
@@ -104,10 +141,17 @@ private:
   Option& m_trim;
   Option& m_crop;
   Option& m_filenameFormat;
+  Option& m_pngOptions;
   Option& m_script;
+  Option& m_replayStrokes;
   Option& m_listLayers;
   Option& m_listTags;
 
+  Option& m_jobs;
+  Option& m_summary;
+  Option& m_threads;
+  Option& m_trace;
+  Option& m_startupProfile;
   Option& m_verbose;
   Option& m_debug;
   Option& m_help;
@@ -0,0 +1,203 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/batch_loader.h"
+
+#include "app/console.h"
+#include "app/context.h"
+#include "app/document.h"
+#include "app/file/file.h"
+#include "base/replace_string.h"
+
+#include <chrono>
+#include <fstream>
+
+namespace app {
+
+namespace {
+
+std::string escape_for_json(const std::string& str)
+{
+  std::string res = str;
+  base::replace_string(res, "\\", "\\\\");
+  base::replace_string(res, "\"", "\\\"");
+  base::replace_string(res, "\n", "\\n");
+  return res;
+}
+
+} // anonymous namespace
+
+BatchLoader::BatchLoader(Context* context, int jobs)
+  : m_context(context)
+  , m_jobs(std::max(jobs, 1))
+  , m_loadFlags(FILE_LOAD_SEQUENCE_ASK)
+  , m_next(0)
+{
+}
+
+BatchLoader::~BatchLoader()
+{
+  // Loads that didn't start are discarded, and the running ones
+  // must finish before destroying the items.
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cancel.cancel();
+  m_cv.wait(lock, [this]{
+      for (const auto& item : m_items)
+        if (item->state == State::Running)
+          return false;
+      return true;
+    });
+}
+
+void BatchLoader::setMetadataOnly(bool state)
+{
+  if (state)
+    m_loadFlags |= FILE_LOAD_METADATA_ONLY;
+  else
+    m_loadFlags &= ~FILE_LOAD_METADATA_ONLY;
+}
+
+void BatchLoader::addFile(const std::string& filename)
+{
+  ItemPtr item = std::make_shared<Item>();
+  item->filename = filename;
+  m_items.push_back(item);
+}
+
+Document* BatchLoader::open(const std::string& filename)
+{
+  ItemPtr item;
+  if (m_next < m_items.size() && m_items[m_next]->filename == filename)
+    item = m_items[m_next++];
+  else {
+    item = std::make_shared<Item>();
+    item->filename = filename;
+  }
+
+  // The FileOps are created in the main thread (they can ask things
+  // to the user), and the files are decoded in the pool.
+  if (item->state == State::Pending) {
+    item->fop.reset(FileOp::createLoadDocumentOperation(
+                      m_context, filename.c_str(), m_loadFlags));
+    load(item);
+  }
+  startLoads();
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [&item]{ return item->state == State::Done; });
+  }
+
+  // Same post-load processing and error reporting than OpenFile
+  FileOp* fop = item->fop.get();
+  Document* doc = nullptr;
+  std::string error;
+  if (!fop)
+    error = "Cannot open file";
+  else {
+    if (fop->document())
+      fop->postLoad();
+    doc = fop->releaseDocument();
+    if (fop->hasError()) {
+      error = fop->error();
+      Console().printf(error.c_str());
+    }
+  }
+
+  // The context makes it the active document
+  if (doc)
+    doc->setContext(m_context);
+
+  addResult(filename, doc != nullptr, error, item->seconds);
+  item->fop.reset();
+  return doc;
+}
+
+void BatchLoader::addResult(const std::string& filename, bool ok,
+                            const std::string& error, double seconds)
+{
+  m_results.push_back(Result{ filename, ok, error, seconds });
+}
+
+bool BatchLoader::saveSummary(const std::string& filename) const
+{
+  std::ofstream f(filename.c_str());
+  if (!f)
+    return false;
+
+  f << "[";
+  for (std::size_t i=0; i<m_results.size(); ++i) {
+    const Result& r = m_results[i];
+    f << (i > 0 ? ",\n ": "\n ")
+      << "{ \"file\": \"" << escape_for_json(r.filename) << "\""
+      << ", \"ok\": " << (r.ok ? "true": "false")
+      << ", \"seconds\": " << r.seconds;
+    if (!r.error.empty())
+      f << ", \"error\": \"" << escape_for_json(r.error) << "\"";
+    f << " }";
+  }
+  f << "\n]\n";
+  return f.good();
+}
+
+// Posts the loads of the next "jobs" files
+void BatchLoader::startLoads()
+{
+  if (m_jobs <= 1)
+    return;
+
+  for (std::size_t i=m_next; i<m_items.size() && i<m_next+m_jobs; ++i) {
+    const ItemPtr& item = m_items[i];
+    if (item->state != State::Pending)
+      continue;
+
+    item->fop.reset(FileOp::createLoadDocumentOperation(
+                      m_context, item->filename.c_str(), m_loadFlags));
+    item->state = State::Posted;
+
+    ItemPtr copy = item;
+    base::thread_pool::instance().post(
+      [this, copy]{ load(copy); },
+      base::thread_pool::priority::normal, m_cancel);
+  }
+}
+
+void BatchLoader::load(const ItemPtr& item)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_cancel.canceled())
+      return;
+    item->state = State::Running;
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  if (item->fop && !item->fop->hasError()) {
+    try {
+      item->fop->operate();
+    }
+    catch (const std::exception& e) {
+      item->fop->setError("Error loading file:\n%s", e.what());
+    }
+    item->fop->done();
+  }
+  const std::chrono::duration<double> secs =
+    std::chrono::steady_clock::now() - t0;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    item->seconds = secs.count();
+    item->state = State::Done;
+  }
+  m_cv.notify_all();
+}
+
+} // namespace app
@@ -0,0 +1,88 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/thread_pool.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace app {
+  class Context;
+  class Document;
+  class FileOp;
+
+  // Loads the files given in the command line (batch mode). With
+  // more than one job, the next files are decoded in the shared
+  // thread pool while the current one is processed (transformed and
+  // saved) by the main thread. At most "jobs" files are decoded and
+  // waiting at the same time, so the memory is bounded.
+  //
+  // It also keeps the result of each file to save a summary in JSON
+  // format (--summary).
+  class BatchLoader {
+  public:
+    BatchLoader(Context* context, int jobs);
+    ~BatchLoader();
+
+    // Loads the documents without the pixels of the cels (e.g. to
+    // list their layers or tags). Must be called before addFile().
+    void setMetadataOnly(bool state);
+
+    // Files that will be opened with open() in the same order.
+    void addFile(const std::string& filename);
+
+    // Returns the document of the next added file (the given one) in
+    // the context, or nullptr if it cannot be loaded. Files that
+    // weren't added with addFile() are loaded here.
+    Document* open(const std::string& filename);
+
+    // Adds the result of a file that was processed by other means.
+    void addResult(const std::string& filename, bool ok,
+                   const std::string& error, double seconds);
+
+    bool saveSummary(const std::string& filename) const;
+
+  private:
+    enum class State { Pending, Posted, Running, Done };
+    struct Item {
+      std::string filename;
+      std::unique_ptr<FileOp> fop;
+      State state = State::Pending;
+      double seconds = 0.0;
+    };
+    typedef std::shared_ptr<Item> ItemPtr;
+
+    struct Result {
+      std::string filename;
+      bool ok;
+      std::string error;
+      double seconds;
+    };
+
+    void startLoads();
+    void load(const ItemPtr& item);
+
+    Context* m_context;
+    int m_jobs;
+    int m_loadFlags;            // Flags for FileOp::createLoadDocumentOperation()
+    std::vector<ItemPtr> m_items;
+    std::size_t m_next;         // Next item to be opened
+    std::vector<Result> m_results;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    base::cancel_token m_cancel;
+
+    DISABLE_COPYING(BatchLoader);
+  };
+
+} // namespace app
@@ -0,0 +1,342 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/benchmark.h"
+
+#include "app/commands/filters/filter_manager_impl.h"
+#include "app/context.h"
+#include "app/document.h"
+#include "app/document_exporter.h"
+#include "app/file/file.h"
+#include "app/sprite_sheet_type.h"
+#include "app/tools/cel_tool_loop.h"
+#include "app/tools/pointer.h"
+#include "app/tools/stroke_recording.h"
+#include "app/tools/tool_box.h"
+#include "app/tools/tool_loop_manager.h"
+#include "base/fs.h"
+#include "base/path.h"
+#include "base/thread_pool.h"
+#include "doc/cel.h"
+#include "doc/cels_range.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/rgbmap.h"
+#include "doc/sprite.h"
+#include "filters/invert_color_filter.h"
+#include "filters/median_filter.h"
+#include "render/quantization.h"
+#include "render/render.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+namespace app {
+
+using namespace doc;
+
+namespace {
+
+// Size of the synthetic document
+const int kWidth = 256;
+const int kHeight = 256;
+const int kLayers = 6;
+const int kFrames = 16;
+
+void save_as(Context* context, Document* document, const std::string& filename)
+{
+  std::unique_ptr<FileOp> fop(
+    FileOp::createSaveDocumentOperation(context, document, filename.c_str(), ""));
+  if (!fop)
+    throw std::runtime_error("Cannot save " + filename);
+
+  if (!fop->hasError()) {
+    fop->operate();
+    fop->done();
+  }
+  if (fop->hasError())
+    throw std::runtime_error(fop->error());
+}
+
+Document* load(Context* context, const std::string& filename)
+{
+  std::unique_ptr<FileOp> fop(
+    FileOp::createLoadDocumentOperation(
+      context, filename.c_str(), FILE_LOAD_SEQUENCE_NONE));
+  if (!fop)
+    throw std::runtime_error("Cannot load " + filename);
+
+  if (!fop->hasError()) {
+    fop->operate();
+    fop->done();
+    fop->postLoad();
+  }
+  if (fop->hasError())
+    throw std::runtime_error(fop->error());
+  return fop->releaseDocument();
+}
+
+} // anonymous namespace
+
+Benchmark::Benchmark(Context* context, int iterations)
+  : m_context(context)
+  , m_iterations(std::max(iterations, 1))
+  , m_tempDir(base::join_path(base::get_temp_path(), "libresprite-benchmark"))
+{
+}
+
+Benchmark::~Benchmark()
+{
+  deleteTempFiles();
+}
+
+void Benchmark::run(std::ostream& out)
+{
+  if (!base::is_directory(m_tempDir))
+    base::make_all_directories(m_tempDir);
+
+  std::unique_ptr<Document> doc(createDocument());
+  doc->setContext(m_context);
+  Sprite* sprite = doc->sprite();
+
+  measure("ase_save", [&]{
+      save_as(m_context, doc.get(), tempFile("benchmark.ase"));
+    });
+
+  measure("ase_load", [&]{
+      std::unique_ptr<Document> loaded(load(m_context, tempFile("benchmark.ase")));
+    });
+
+  const render::Zoom zooms[] = {
+    render::Zoom(1, 2), render::Zoom(1, 1), render::Zoom(2, 1), render::Zoom(4, 1)
+  };
+  for (const render::Zoom& zoom : zooms) {
+    const std::string name =
+      (zoom.scale() < 1.0 ? "render_zoom_1_" + std::to_string(zoom.remove(1)):
+                            "render_zoom_" + std::to_string(zoom.apply(1)));
+    measure(name, [&]{
+        std::unique_ptr<Image> image(
+          Image::create(IMAGE_RGB, zoom.apply(kWidth), zoom.apply(kHeight)));
+        render::Render render;
+        render.setParallel(true);
+        for (frame_t frame=0; frame<sprite->totalFrames(); ++frame)
+          render.renderSprite(image.get(), sprite, frame,
+                              gfx::Clip(image->bounds()), zoom);
+      });
+  }
+
+  measure("brush_strokes", [&]{ strokes(doc.get()); });
+
+  measure("filter_median", [&]{
+      filters::MedianFilter filter;
+      filter.setTiledMode(filters::TiledMode::NONE);
+      filter.setSize(3, 3);
+      FilterManagerImpl filterMgr(m_context, &filter);
+      filterMgr.setTarget(TARGET_ALL_CHANNELS | TARGET_ALL_LAYERS | TARGET_ALL_FRAMES);
+      filterMgr.applyToTarget();
+    });
+
+  measure("filter_invert", [&]{
+      filters::InvertColorFilter filter;
+      FilterManagerImpl filterMgr(m_context, &filter);
+      filterMgr.setTarget(TARGET_ALL_CHANNELS | TARGET_ALL_LAYERS | TARGET_ALL_FRAMES);
+      filterMgr.applyToTarget();
+    });
+
+  measure("quantize", [&]{
+      std::shared_ptr<Palette> palette(
+        render::create_palette_from_sprite(sprite, 0, sprite->lastFrame(),
+                                           false, nullptr, nullptr));
+      RgbMap rgbmap;
+      rgbmap.regenerate(palette.get(), -1);
+      for (const auto& cel : sprite->uniqueCels()) {
+        std::unique_ptr<Image> indexed(
+          render::convert_pixel_format(cel->image(), nullptr, IMAGE_INDEXED,
+                                       DitheringMethod::NONE, &rgbmap,
+                                       palette.get(), false, 0));
+      }
+    });
+
+  measure("gif_save", [&]{
+      save_as(m_context, doc.get(), tempFile("benchmark.gif"));
+    });
+
+  measure("png_save", [&]{
+      save_as(m_context, doc.get(), tempFile("benchmark.png"));
+    });
+
+  measure("sheet_pack", [&]{
+      DocumentExporter exporter;
+      exporter.setTextureFilename(tempFile("sheet.png"));
+      exporter.setDataFilename(tempFile("sheet.json"));
+      exporter.setSpriteSheetType(SpriteSheetType::Packed);
+      exporter.addDocument(doc.get());
+      std::unique_ptr<Document> sheet(exporter.exportSheet());
+    });
+
+  doc->close();
+  doc.reset();
+  deleteTempFiles();
+
+  out << "{\n"
+      << "  \"version\": \"" VERSION "\",\n"
+      << "  \"threads\": " << base::thread_pool::instance().concurrency() << ",\n"
+      << "  \"document\": { \"width\": " << kWidth
+      << ", \"height\": " << kHeight
+      << ", \"layers\": " << kLayers
+      << ", \"frames\": " << kFrames << " },\n"
+      << "  \"results\": [";
+  for (std::size_t i=0; i<m_results.size(); ++i) {
+    const Result& r = m_results[i];
+    out << (i > 0 ? ",\n    ": "\n    ")
+        << "{ \"name\": \"" << r.name << "\"";
+    if (r.times.empty())
+      out << ", \"error\": true";
+    else {
+      double total = 0.0;
+      for (double t : r.times)
+        total += t;
+      out << ", \"iterations\": " << r.times.size()
+          << ", \"min_ms\": " << *std::min_element(r.times.begin(), r.times.end())
+          << ", \"avg_ms\": " << total / r.times.size()
+          << ", \"max_ms\": " << *std::max_element(r.times.begin(), r.times.end());
+    }
+    out << " }";
+  }
+  out << "\n  ]\n}" << std::endl;
+}
+
+void Benchmark::measure(const std::string& name, const std::function<void()>& func)
+{
+  Result result;
+  result.name = name;
+
+  for (int i=0; i<m_iterations; ++i) {
+    try {
+      const auto t0 = std::chrono::steady_clock::now();
+      func();
+      const std::chrono::duration<double, std::milli> ms =
+        std::chrono::steady_clock::now() - t0;
+      result.times.push_back(ms.count());
+    }
+    catch (const std::exception& e) {
+      std::cerr << "Benchmark " << name << ": " << e.what() << "\n";
+      result.times.clear();
+      break;
+    }
+  }
+
+  m_results.push_back(result);
+}
+
+// Creates a RGB sprite with an opaque background and transparent
+// layers with circles that move in each frame (so the images can be
+// compressed, but not too much).
+Document* Benchmark::createDocument()
+{
+  std::unique_ptr<Sprite> sprite(new Sprite(IMAGE_RGB, kWidth, kHeight, 256));
+  sprite->setTotalFrames(kFrames);
+
+  uint32_t seed = 1;
+  for (int l=0; l<kLayers; ++l) {
+    std::unique_ptr<LayerImage> layer(new LayerImage(sprite.get()));
+    layer->setName("Layer " + std::to_string(l+1));
+
+    for (frame_t frame=0; frame<kFrames; ++frame) {
+      ImageRef image(Image::create(IMAGE_RGB, kWidth, kHeight));
+      const int cx = (l*47 + frame*9) % kWidth;
+      const int cy = (l*71 + frame*5) % kHeight;
+      const int r = 24 + l*8;
+
+      for (int y=0; y<kHeight; ++y) {
+        auto p = (uint32_t*)image->getPixelAddress(0, y);
+        for (int x=0; x<kWidth; ++x, ++p) {
+          seed = seed*1103515245 + 12345;
+          const int dx = x-cx, dy = y-cy;
+          if (l == 0)
+            *p = rgba(x, y, (x+y+frame*8) & 255, 255);
+          else if (dx*dx + dy*dy < r*r)
+            *p = rgba((x*4 + l*32) & 255,
+                      (y*4 + frame*16) & 255,
+                      (seed >> 16) & 255, 255);
+          else
+            *p = 0;
+        }
+      }
+
+      auto cel = std::make_shared<Cel>(frame, image);
+      layer->addCel(cel);
+    }
+
+    if (l == 0)
+      layer->configureAsBackground();
+
+    sprite->folder()->addLayer(layer.release());
+  }
+
+  return new Document(sprite.release());
+}
+
+// Replays freehand strokes with the pencil tool (circle brush of 8
+// pixels) in the first transparent layer.
+void Benchmark::strokes(Document* doc)
+{
+  Sprite* sprite = doc->sprite();
+  Layer* layer = sprite->indexToLayer(LayerIndex(1));
+  Cel* cel = layer->cel(0).get();
+
+  for (int s=0; s<20; ++s) {
+    tools::RecordedStroke stroke;
+    stroke.toolId = tools::WellKnownTools::Pencil;
+    stroke.brushSize = 8;
+    stroke.primaryColor = rgba(255, s*12, 0, 255);
+
+    tools::Pointer pointer(gfx::Point(0, s*12), tools::Pointer::Left, 1.0f);
+    stroke.events.push_back({ tools::StrokeEventType::Press, 0.0, { pointer } });
+    for (int i=1; i<200; ++i) {
+      pointer = tools::Pointer(
+        gfx::Point((i*3) % kWidth, s*12 + ((i/8) % 2 ? i % 8: 8 - i % 8) * 4),
+        tools::Pointer::Left, 1.0f);
+      stroke.events.push_back({ tools::StrokeEventType::Movement, 0.0, { pointer } });
+    }
+    stroke.events.push_back({ tools::StrokeEventType::Release, 0.0, { pointer } });
+
+    tools::CelToolLoop toolLoop(doc, cel, stroke);
+    tools::ToolLoopManager manager(&toolLoop);
+    tools::replay_stroke(stroke, manager);
+    toolLoop.dispose();
+  }
+}
+
+std::string Benchmark::tempFile(const std::string& name) const
+{
+  return base::join_path(m_tempDir, name);
+}
+
+void Benchmark::deleteTempFiles()
+{
+  if (!base::is_directory(m_tempDir))
+    return;
+
+  for (const auto& file : base::list_files(m_tempDir)) {
+    const std::string fn = tempFile(file);
+    if (base::is_file(fn))
+      base::delete_file(fn);
+  }
+  base::remove_directory(m_tempDir);
+}
+
+} // namespace app
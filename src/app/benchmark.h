@@ -0,0 +1,58 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace app {
+  class Context;
+  class Document;
+
+  // Runs a fixed set of workloads on a synthetic document (--benchmark)
+  // and writes the timings in JSON format, so the results of
+  // different machines and releases can be compared:
+  //
+  //   ase_save, ase_load, render_zoom_N, brush_strokes,
+  //   filter_median, filter_invert, quantize, gif_save, png_save,
+  //   sheet_pack
+  //
+  // Each workload is executed several times (the first execution is
+  // included, so the minimum is usually the most stable value).
+  class Benchmark {
+  public:
+    Benchmark(Context* context, int iterations);
+    ~Benchmark();
+
+    void run(std::ostream& out);
+
+  private:
+    struct Result {
+      std::string name;
+      std::vector<double> times; // Milliseconds of each iteration
+    };
+
+    void measure(const std::string& name, const std::function<void()>& func);
+    Document* createDocument();
+    void strokes(Document* doc);
+    std::string tempFile(const std::string& name) const;
+    void deleteTempFiles();
+
+    Context* m_context;
+    int m_iterations;
+    std::string m_tempDir;
+    std::vector<Result> m_results;
+
+    DISABLE_COPYING(Benchmark);
+  };
+
+} // namespace app
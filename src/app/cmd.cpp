@@ -11,10 +11,36 @@
 
 #include "app/cmd.h"
 
+#include <chrono>
 #include <typeinfo>
 
 namespace app {
 
+namespace {
+
+// Measures the time of one Cmd operation to be added in CmdStats
+class CmdTimer {
+public:
+  CmdTimer(const Cmd* cmd, CmdTypeStats::Op op)
+    : m_type(typeid(*cmd))
+    , m_op(op)
+    , m_start(std::chrono::steady_clock::now()) {
+  }
+
+  ~CmdTimer() {
+    std::chrono::duration<double> secs =
+      std::chrono::steady_clock::now() - m_start;
+    CmdStats::instance().addTime(m_type, m_op, secs.count());
+  }
+
+private:
+  std::type_index m_type;
+  CmdTypeStats::Op m_op;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+} // anonymous namespace
+
 Cmd::Cmd()
 #if _DEBUG
   : m_state(State::NotExecuted)
@@ -33,7 +59,10 @@ void Cmd::execute(Context* ctx)
 
   m_ctx = ctx;
 
-  onExecute();
+  {
+    CmdTimer timer(this, CmdTypeStats::Execute);
+    onExecute();
+  }
   onFireNotifications();
 
 #if _DEBUG
@@ -46,7 +75,10 @@ void Cmd::undo()
   TRACE("Cmd: Undo cmd '%s'\n", typeid(*this).name());
   ASSERT(m_state == State::Executed || m_state == State::Redone);
 
-  onUndo();
+  {
+    CmdTimer timer(this, CmdTypeStats::Undo);
+    onUndo();
+  }
   onFireNotifications();
 
 #if _DEBUG
@@ -59,7 +91,10 @@ void Cmd::redo()
   TRACE("Cmd: Redo cmd '%s'\n", typeid(*this).name());
   ASSERT(m_state == State::Undone);
 
-  onRedo();
+  {
+    CmdTimer timer(this, CmdTypeStats::Redo);
+    onRedo();
+  }
   onFireNotifications();
 
 #if _DEBUG
@@ -82,6 +117,16 @@ size_t Cmd::memSize() const
   return onMemSize();
 }
 
+void Cmd::swapOut()
+{
+  onSwapOut();
+}
+
+void Cmd::collectStats(CmdStatsMap& stats) const
+{
+  onCollectStats(stats);
+}
+
 void Cmd::onExecute()
 {
   // Do nothing
@@ -112,4 +157,16 @@ size_t Cmd::onMemSize() const {
   return sizeof(*this);
 }
 
+void Cmd::onSwapOut()
+{
+  // Do nothing
+}
+
+void Cmd::onCollectStats(CmdStatsMap& stats) const
+{
+  CmdTypeStats& s = stats[typeid(*this)];
+  ++s.count;
+  s.memSize += onMemSize();
+}
+
 } // namespace app
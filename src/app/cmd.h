@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "app/cmd_stats.h"
 #include "base/disable_copying.h"
 #include "doc/sprite_position.h"
 #include "undo/undo_command.h"
@@ -32,6 +33,15 @@ namespace app {
     std::string label() const;
     size_t memSize() const;
 
+    // Moves the data needed to undo/redo this command to the undo
+    // swap file (see UndoSwap) to reduce memSize(). The command
+    // reads it again when it's undone/redone.
+    void swapOut();
+
+    // Adds the memory used by this command (and its sub-commands) to
+    // the entry of its type in "stats".
+    void collectStats(CmdStatsMap& stats) const;
+
     Context* context() const { return m_ctx; }
 
   protected:
@@ -41,6 +51,8 @@ namespace app {
     virtual void onFireNotifications();
     virtual std::string onLabel() const;
     virtual size_t onMemSize() const;
+    virtual void onSwapOut();
+    virtual void onCollectStats(CmdStatsMap& stats) const;
 
   private:
     Context* m_ctx;
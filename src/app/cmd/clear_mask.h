@@ -31,6 +31,9 @@ namespace cmd {
       return sizeof(*this) + m_seq.memSize() +
         (m_copy ? m_copy->getMemSize(): 0);
     }
+    void onSwapOut() override {
+      m_seq.swapOut();
+    }
 
   private:
     void clear();
@@ -11,13 +11,24 @@
 
 #include "app/cmd/copy_region.h"
 
+#include "base/exception.h"
 #include "doc/image.h"
 
+#include "zlib.h"
+
 #include <algorithm>
 
 namespace app {
 namespace cmd {
 
+namespace {
+
+// Undo data is compressed for speed rather than size (most bytes
+// are zero anyway, as the XOR of unchanged pixels is zero).
+const int kCompressionLevel = Z_BEST_SPEED;
+
+} // anonymous namespace
+
 CopyRegion::CopyRegion(Image* dst, const Image* src,
                        const gfx::Region& region,
                        const gfx::Point& dstPos,
@@ -25,8 +36,10 @@ CopyRegion::CopyRegion(Image* dst, const Image* src,
   : WithImage(dst)
   , m_size(0)
   , m_alreadyCopied(alreadyCopied)
+  , m_swapped(false)
 {
   // Create region to save/swap later
+  gfx::RegionBuilder rects;
   for (const auto& rc : region) {
     gfx::Clip clip(
       rc.x+dstPos.x, rc.y+dstPos.y,
@@ -36,19 +49,47 @@ CopyRegion::CopyRegion(Image* dst, const Image* src,
           src->width(), src->height()))
       continue;
 
-    m_region.createUnion(m_region, gfx::Region(clip.dstBounds()));
+    rects.add(clip.dstBounds());
   }
+  rects.build(m_region);
+
+  // Save the XOR between the current pixels of "dst" and the
+  // pixels of "src" (which are the new ones or, if they were already
+  // copied, the old ones).
+  m_size = 0;
+  for (const auto& rc : m_region)
+    m_size += size_t(dst->getRowStrideSize(rc.w)) * rc.h;
+  if (m_size == 0)
+    return;
 
-  // Save region pixels
+  std::vector<uint8_t> delta(m_size);
+  uint8_t* p = &delta[0];
   for (const auto& rc : m_region) {
-    for (int y=0; y<rc.h; ++y) {
-      m_stream.write(
-        (const char*)src->getPixelAddress(rc.x-dstPos.x,
-                                          rc.y-dstPos.y+y),
-        src->getRowStrideSize(rc.w));
+    const int rowSize = dst->getRowStrideSize(rc.w);
+    for (int y=0; y<rc.h; ++y, p+=rowSize) {
+      const uint8_t* a = src->getPixelAddress(rc.x-dstPos.x, rc.y-dstPos.y+y);
+      const uint8_t* b = dst->getPixelAddress(rc.x, rc.y+y);
+      for (int i=0; i<rowSize; ++i)
+        p[i] = a[i] ^ b[i];
     }
   }
-  m_size = size_t(m_stream.tellp());
+
+  uLongf compressedSize = compressBound(uLong(m_size));
+  m_data.resize(compressedSize);
+  int err = compress2((Bytef*)&m_data[0], &compressedSize,
+                      (const Bytef*)&delta[0], uLong(m_size),
+                      kCompressionLevel);
+  if (err != Z_OK)
+    throw base::Exception("ZLib error %d in compress2().", err);
+
+  m_data.resize(compressedSize);
+  m_data.shrink_to_fit();
+}
+
+CopyRegion::~CopyRegion()
+{
+  if (m_swapped)
+    UndoSwap::instance().release(m_slot);
 }
 
 void CopyRegion::onExecute()
@@ -67,32 +108,50 @@ void CopyRegion::onRedo()
   swap();
 }
 
+void CopyRegion::onSwapOut()
+{
+  if (m_swapped || m_data.empty())
+    return;
+
+  if (UndoSwap::instance().store(m_data, m_slot)) {
+    m_data.clear();
+    m_data.shrink_to_fit();
+    m_swapped = true;
+  }
+}
+
 void CopyRegion::swap()
 {
   Image* image = this->image();
 
-  // Save current image region in "tmp" stream
-  std::stringstream tmp;
-  for (const auto& rc : m_region)
-    for (int y=0; y<rc.h; ++y)
-      tmp.write(
-        (const char*)image->getPixelAddress(rc.x, rc.y+y),
-        image->getRowStrideSize(rc.w));
+  if (m_swapped) {
+    if (!UndoSwap::instance().load(m_slot, m_data))
+      throw base::Exception("Error reading undo data from the swap file.");
+    UndoSwap::instance().release(m_slot);
+    m_swapped = false;
+  }
 
-  // Restore m_stream into the image
-  m_stream.seekg(0, std::ios_base::beg);
-  for (const auto& rc : m_region) {
-    for (int y=0; y<rc.h; ++y) {
-      m_stream.read(
-        (char*)image->getPixelAddress(rc.x, rc.y+y),
-        image->getRowStrideSize(rc.w));
+  if (m_size > 0) {
+    std::vector<uint8_t> delta(m_size);
+    uLongf size = uLongf(m_size);
+    int err = uncompress((Bytef*)&delta[0], &size,
+                         (const Bytef*)&m_data[0], uLong(m_data.size()));
+    if (err != Z_OK || size != m_size)
+      throw base::Exception("ZLib error %d in uncompress().", err);
+
+    // XOR the delta with the image to go from the old pixels to the
+    // new ones (or vice versa)
+    const uint8_t* p = &delta[0];
+    for (const auto& rc : m_region) {
+      const int rowSize = image->getRowStrideSize(rc.w);
+      for (int y=0; y<rc.h; ++y, p+=rowSize) {
+        uint8_t* a = image->getPixelAddress(rc.x, rc.y+y);
+        for (int i=0; i<rowSize; ++i)
+          a[i] ^= p[i];
+      }
     }
   }
 
-  // TODO use m_stream.swap(tmp) when clang and gcc support it
-  m_stream.str(tmp.str());
-  m_stream.clear();
-
   image->incrementVersion();
 }
 
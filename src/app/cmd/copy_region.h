@@ -9,10 +9,12 @@
 
 #include "app/cmd.h"
 #include "app/cmd/with_image.h"
+#include "app/undo_swap.h"
 #include "gfx/point.h"
 #include "gfx/region.h"
 
-#include <sstream>
+#include <cstdint>
+#include <vector>
 
 namespace app {
 namespace cmd {
@@ -29,22 +31,32 @@ namespace cmd {
                const gfx::Region& region,
                const gfx::Point& dstPos,
                bool alreadyCopied = false);
+    ~CopyRegion();
 
   protected:
     void onExecute() override;
     void onUndo() override;
     void onRedo() override;
     size_t onMemSize() const override {
-      return sizeof(*this) + m_size;
+      return sizeof(*this) + m_data.size();
     }
+    void onSwapOut() override;
 
   private:
     void swap();
 
+    // Size of the uncompressed pixels of the region.
     size_t m_size;
     bool m_alreadyCopied;
     gfx::Region m_region;
-    std::stringstream m_stream;
+
+    // Compressed XOR between the old and new pixels of the region.
+    // Applying it to the image swaps its state (redo/undo).
+    std::vector<uint8_t> m_data;
+
+    // True if m_data is in the undo swap file.
+    bool m_swapped;
+    UndoSwap::Slot m_slot;
   };
 
 } // namespace cmd
@@ -17,15 +17,21 @@
 #include "app/cmd/copy_rect.h"
 #include "app/cmd/remove_layer.h"
 #include "app/cmd/remove_layer.h"
+#include "app/cmd/set_cel_data.h"
 #include "app/cmd/set_layer_flags.h"
 #include "app/cmd/unlink_cel.h"
 #include "app/document.h"
+#include "base/thread_pool.h"
 #include "doc/cel.h"
 #include "doc/layer.h"
+#include "doc/palette.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
 #include "render/render.h"
 
+#include <map>
+#include <vector>
+
 namespace app {
 namespace cmd {
 
@@ -39,11 +45,6 @@ void FlattenLayers::onExecute()
   Sprite* sprite = this->sprite();
   app::Document* doc = static_cast<app::Document*>(sprite->document());
 
-  // Create a temporary image.
-  ImageRef image(Image::create(sprite->pixelFormat(),
-      sprite->width(),
-      sprite->height()));
-
   LayerImage* flatLayer;  // The layer onto which everything will be flattened.
   color_t     bgcolor;    // The background color to use for flatLayer.
 
@@ -61,34 +62,82 @@ void FlattenLayers::onExecute()
     bgcolor = sprite->transparentColor();
   }
 
-  render::Render render;
-  render.setBgType(render::BgType::NONE);
+  // Frames with the same cels (e.g. linked cels in all layers) and
+  // palette generate the same image, so they are rendered only once
+  // and their cels are linked.
+  std::vector<Layer*> allLayers;
+  sprite->getLayersList(allLayers);
 
-  // Copy all frames to the background.
+  std::map<std::vector<ObjectId>, int> signatures;
+  std::vector<int> renderedIndex(sprite->totalFrames());
+  std::vector<frame_t> renderedFrames;
   for (frame_t frame(0); frame<sprite->totalFrames(); ++frame) {
-    // Clear the image and render this frame.
-    clear_image(image.get(), bgcolor);
-    render.renderSprite(image.get(), sprite, frame);
+    std::vector<ObjectId> signature;
+    signature.push_back(sprite->palette(frame)->id());
+    for (Layer* layer : allLayers) {
+      Cel* cel = (layer->isImage() ? layer->cel(frame).get(): nullptr);
+      signature.push_back(cel ? cel->data()->id(): NullId);
+    }
+
+    auto it = signatures.find(signature);
+    if (it == signatures.end()) {
+      it = signatures.insert(std::make_pair(signature, int(renderedFrames.size()))).first;
+      renderedFrames.push_back(frame);
+    }
+    renderedIndex[frame] = it->second;
+  }
 
-    // TODO Keep cel links when possible
+  // Render the different frames in parallel (each one with its own
+  // Render instance).
+  std::vector<ImageRef> images(renderedFrames.size());
+  base::thread_pool::instance().parallel_for(
+    int(renderedFrames.size()),
+    [&](int i) {
+      ImageRef image(Image::create(sprite->pixelFormat(),
+                                   sprite->width(),
+                                   sprite->height()));
+      clear_image(image.get(), bgcolor);
+
+      render::Render render;
+      render.setBgType(render::BgType::NONE);
+      render.renderSprite(image.get(), sprite, renderedFrames[i]);
+      images[i] = image;
+    });
 
-    ImageRef cel_image;
+  // Copy all frames to the background.
+  std::vector<std::shared_ptr<Cel>> renderedCels(renderedFrames.size());
+  for (frame_t frame(0); frame<sprite->totalFrames(); ++frame) {
+    const int i = renderedIndex[frame];
     auto cel = flatLayer->cel(frame);
+
+    // Link the cel with the first frame that has the same image
+    if (renderedCels[i]) {
+      if (!cel) {
+        cel = Cel::createLink(renderedCels[i]);
+        cel->setFrame(frame);
+        flatLayer->addCel(cel);
+      }
+      else if (cel->dataRef() != renderedCels[i]->dataRef())
+        executeAndAdd(new cmd::SetCelData(cel, renderedCels[i]->dataRef()));
+      continue;
+    }
+
     if (cel) {
       if (cel->links())
         executeAndAdd(new cmd::UnlinkCel(cel));
 
-      cel_image = cel->imageRef();
+      ImageRef cel_image = cel->imageRef();
       ASSERT(cel_image);
 
-      executeAndAdd(new cmd::CopyRect(cel_image.get(), image.get(),
-          gfx::Clip(0, 0, image->bounds())));
+      executeAndAdd(new cmd::CopyRect(cel_image.get(), images[i].get(),
+          gfx::Clip(0, 0, images[i]->bounds())));
     }
     else {
-      cel_image.reset(Image::createCopy(image.get()));
-      cel = std::make_shared<Cel>(frame, cel_image);
+      cel = std::make_shared<Cel>(frame, images[i]);
       flatLayer->addCel(cel);
     }
+    renderedCels[i] = cel;
+    images[i].reset();
   }
 
   // Delete old layers.
@@ -0,0 +1,67 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/permute_frames.h"
+
+#include "doc/document.h"
+#include "doc/document_event.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+
+namespace app {
+namespace cmd {
+
+PermuteFrames::PermuteFrames(Sprite* sprite, const std::vector<frame_t>& newFrames)
+  : WithSprite(sprite)
+  , m_newFrames(newFrames)
+{
+  ASSERT(frame_t(m_newFrames.size()) <= sprite->totalFrames());
+}
+
+void PermuteFrames::onExecute()
+{
+  permute(m_newFrames);
+}
+
+void PermuteFrames::onUndo()
+{
+  std::vector<frame_t> oldFrames(m_newFrames.size());
+  for (frame_t frame=0; frame<frame_t(m_newFrames.size()); ++frame)
+    oldFrames[m_newFrames[frame]] = frame;
+
+  permute(oldFrames);
+}
+
+void PermuteFrames::onFireNotifications()
+{
+  Sprite* sprite = this->sprite();
+  doc::Document* doc = sprite->document();
+  DocumentEvent ev(doc);
+  ev.sprite(sprite);
+  doc->notifyObservers<DocumentEvent&>(&DocumentObserver::onGeneralUpdate, ev);
+}
+
+void PermuteFrames::permute(const std::vector<frame_t>& newFrames)
+{
+  Sprite* sprite = this->sprite();
+
+  std::vector<int> durations(newFrames.size());
+  for (frame_t frame=0; frame<frame_t(newFrames.size()); ++frame)
+    durations[newFrames[frame]] = sprite->frameDuration(frame);
+  for (frame_t frame=0; frame<frame_t(newFrames.size()); ++frame)
+    sprite->setFrameDuration(frame, durations[frame]);
+
+  sprite->folder()->permuteFrames(newFrames);
+  sprite->incrementVersion();
+}
+
+} // namespace cmd
+} // namespace app
@@ -0,0 +1,44 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "app/cmd.h"
+#include "app/cmd/with_sprite.h"
+#include "doc/frame.h"
+
+#include <vector>
+
+namespace app {
+namespace cmd {
+  using namespace doc;
+
+  // Reorders the frames of the sprite (cels and frame durations) in
+  // one step. newFrames[F] is the new position of the frame F, it
+  // must be a permutation of [0, newFrames.size()). The undo only
+  // needs the permutation (its inverse is calculated).
+  class PermuteFrames : public Cmd
+                      , public WithSprite {
+  public:
+    PermuteFrames(Sprite* sprite, const std::vector<frame_t>& newFrames);
+
+  protected:
+    void onExecute() override;
+    void onUndo() override;
+    void onFireNotifications() override;
+    size_t onMemSize() const override {
+      return sizeof(*this) + sizeof(frame_t)*m_newFrames.size();
+    }
+
+  private:
+    void permute(const std::vector<frame_t>& newFrames);
+
+    std::vector<frame_t> m_newFrames;
+  };
+
+} // namespace cmd
+} // namespace app
@@ -48,7 +48,7 @@ void RemapColors::onUndo()
 
 void RemapColors::incrementVersions(Sprite* spr)
 {
-  for (auto cel : spr->uniqueCels())
+  for (const auto& cel : spr->uniqueCels())
     cel->image()->incrementVersion();
 }
 
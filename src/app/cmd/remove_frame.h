@@ -27,6 +27,9 @@ namespace cmd {
     size_t onMemSize() const override {
       return sizeof(*this) + m_seq.memSize();
     }
+    void onSwapOut() override {
+      m_seq.swapOut();
+    }
 
   private:
     frame_t m_frame;
@@ -11,6 +11,7 @@
 
 #include "app/cmd/replace_image.h"
 
+#include "base/exception.h"
 #include "doc/cel.h"
 #include "doc/cels_range.h"
 #include "doc/image.h"
@@ -19,6 +20,10 @@
 #include "doc/sprite.h"
 #include "doc/subobjects_io.h"
 
+#include <memory>
+#include <sstream>
+#include <vector>
+
 namespace app {
 namespace cmd {
 
@@ -29,7 +34,14 @@ ReplaceImage::ReplaceImage(Sprite* sprite, const ImageRef& oldImage, const Image
   , m_oldImageId(oldImage->id())
   , m_newImageId(newImage->id())
   , m_newImage(newImage)
+  , m_swapped(false)
+{
+}
+
+ReplaceImage::~ReplaceImage()
 {
+  if (m_swapped)
+    UndoSwap::instance().release(m_slot);
 }
 
 void ReplaceImage::onExecute()
@@ -39,7 +51,7 @@ void ReplaceImage::onExecute()
   // modify/re-add this same image ID
   ImageRef oldImage = sprite()->getImageRef(m_oldImageId);
   ASSERT(oldImage);
-  m_copy.reset(Image::createCopy(oldImage.get()));
+  m_copy = ImageTiles(oldImage.get());
 
   replaceImage(m_oldImageId, m_newImage);
   m_newImage.reset();
@@ -47,31 +59,76 @@ void ReplaceImage::onExecute()
 
 void ReplaceImage::onUndo()
 {
+  swapIn();
+
   ImageRef newImage = sprite()->getImageRef(m_newImageId);
   ASSERT(newImage);
   ASSERT(!sprite()->getImageRef(m_oldImageId));
-  m_copy->setId(m_oldImageId);
+  ImageRef oldImage(m_copy.createImage());
+  oldImage->setId(m_oldImageId);
 
-  replaceImage(m_newImageId, m_copy);
-  m_copy.reset(Image::createCopy(newImage.get()));
+  replaceImage(m_newImageId, oldImage);
+  m_copy = ImageTiles(newImage.get());
 }
 
 void ReplaceImage::onRedo()
 {
+  swapIn();
+
   ImageRef oldImage = sprite()->getImageRef(m_oldImageId);
   ASSERT(oldImage);
   ASSERT(!sprite()->getImageRef(m_newImageId));
-  m_copy->setId(m_newImageId);
+  ImageRef newImage(m_copy.createImage());
+  newImage->setId(m_newImageId);
 
-  replaceImage(m_oldImageId, m_copy);
-  m_copy.reset(Image::createCopy(oldImage.get()));
+  replaceImage(m_oldImageId, newImage);
+  m_copy = ImageTiles(oldImage.get());
+}
+
+void ReplaceImage::onSwapOut()
+{
+  if (m_swapped || m_copy.isEmpty())
+    return;
+
+  // The copy is stored with the same serialization (compressed)
+  // used by the crash recovery data
+  std::unique_ptr<Image> image(m_copy.createImage());
+  std::ostringstream os(std::ios::binary);
+  write_image(os, image.get());
+  const std::string str = os.str();
+  const std::vector<uint8_t> data(str.begin(), str.end());
+
+  if (UndoSwap::instance().store(data, m_slot)) {
+    m_copy = ImageTiles();
+    m_swapped = true;
+  }
+}
+
+void ReplaceImage::swapIn()
+{
+  if (!m_swapped)
+    return;
+
+  std::vector<uint8_t> data;
+  if (!UndoSwap::instance().load(m_slot, data))
+    throw base::Exception("Error reading undo data from the swap file.");
+
+  std::istringstream is(std::string(data.begin(), data.end()),
+                        std::ios::binary);
+  std::unique_ptr<Image> image(read_image(is, false));
+  if (!image)
+    throw base::Exception("Error reading undo data from the swap file.");
+  m_copy = ImageTiles(image.get());
+
+  UndoSwap::instance().release(m_slot);
+  m_swapped = false;
 }
 
 void ReplaceImage::replaceImage(ObjectId oldId, const ImageRef& newImage)
 {
   Sprite* spr = sprite();
 
-  for (auto cel : spr->uniqueCels()) {
+  for (const auto& cel : spr->uniqueCels()) {
     if (cel->image()->id() == oldId)
       cel->data()->incrementVersion();
   }
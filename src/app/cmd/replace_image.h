@@ -9,7 +9,9 @@
 
 #include "app/cmd.h"
 #include "app/cmd/with_sprite.h"
+#include "app/undo_swap.h"
 #include "doc/image_ref.h"
+#include "doc/image_tiles.h"
 
 #include <sstream>
 
@@ -21,18 +23,20 @@ namespace cmd {
                      , public WithSprite {
   public:
     ReplaceImage(Sprite* sprite, const ImageRef& oldImage, const ImageRef& newImage);
+    ~ReplaceImage();
 
   protected:
     void onExecute() override;
     void onUndo() override;
     void onRedo() override;
     size_t onMemSize() const override {
-      return sizeof(*this) +
-        (m_copy ? m_copy->getMemSize(): 0);
+      return sizeof(*this) + m_copy.getMemSize();
     }
+    void onSwapOut() override;
 
   private:
     void replaceImage(ObjectId oldId, const ImageRef& newImage);
+    void swapIn();
 
     ObjectId m_oldImageId;
     ObjectId m_newImageId;
@@ -41,7 +45,13 @@ namespace cmd {
     // ReplaceImage() ctor until the ReplaceImage::onExecute() call.
     // Then the reference is not used anymore.
     ImageRef m_newImage;
-    ImageRef m_copy;
+
+    // Copy of the replaced image, transparent tiles aren't stored.
+    ImageTiles m_copy;
+
+    // True if m_copy is in the undo swap file.
+    bool m_swapped;
+    UndoSwap::Slot m_slot;
   };
 
 } // namespace cmd
@@ -0,0 +1,172 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/replace_images.h"
+
+#include "base/exception.h"
+#include "base/thread_pool.h"
+#include "doc/cel.h"
+#include "doc/cels_range.h"
+#include "doc/image.h"
+#include "doc/image_io.h"
+#include "doc/sprite.h"
+
+#include <map>
+#include <memory>
+#include <sstream>
+
+namespace app {
+namespace cmd {
+
+using namespace doc;
+
+ReplaceImages::ReplaceImages(Sprite* sprite)
+  : WithSprite(sprite)
+  , m_swapped(false)
+{
+}
+
+ReplaceImages::~ReplaceImages()
+{
+  if (m_swapped)
+    UndoSwap::instance().release(m_slot);
+}
+
+void ReplaceImages::add(const ImageRef& oldImage, const ImageRef& newImage)
+{
+  Item item;
+  item.oldImageId = oldImage->id();
+  item.newImageId = newImage->id();
+  item.newImage = newImage;
+  m_images.push_back(item);
+}
+
+void ReplaceImages::onExecute()
+{
+  swapImages(false);
+}
+
+void ReplaceImages::onUndo()
+{
+  swapIn();
+  swapImages(true);
+}
+
+void ReplaceImages::onRedo()
+{
+  swapIn();
+  swapImages(false);
+}
+
+size_t ReplaceImages::onMemSize() const
+{
+  size_t size = sizeof(*this) + m_images.capacity()*sizeof(Item);
+  for (const auto& item : m_images)
+    size += item.copy.getMemSize();
+  return size;
+}
+
+// Replaces the images of the sprite with the new ones (or with the
+// old ones if "undo" is true), and keeps a copy of the replaced ones.
+void ReplaceImages::swapImages(bool undo)
+{
+  Sprite* spr = sprite();
+
+  // Images that will be replaced (only one pass over the cels)
+  std::map<ObjectId, int> indexes;
+  for (int i=0; i<int(m_images.size()); ++i)
+    indexes[undo ? m_images[i].newImageId: m_images[i].oldImageId] = i;
+
+  std::vector<Cel*> cels(m_images.size(), nullptr);
+  for (const auto& cel : spr->uniqueCels()) {
+    auto it = indexes.find(cel->image()->id());
+    if (it != indexes.end())
+      cels[it->second] = cel.get();
+  }
+
+  // Create the new images from the copies, and copy the replaced
+  // images, in parallel
+  std::vector<ImageRef> images(m_images.size());
+  base::thread_pool::instance().parallel_for(
+    int(m_images.size()),
+    [&](int i) {
+      Item& item = m_images[i];
+      ASSERT(cels[i]);
+      if (!cels[i])
+        return;
+
+      if (item.newImage) {
+        images[i] = item.newImage;
+      }
+      else {
+        images[i].reset(item.copy.createImage());
+        images[i]->setId(undo ? item.oldImageId: item.newImageId);
+      }
+      item.copy = ImageTiles(cels[i]->image());
+    });
+
+  for (int i=0; i<int(m_images.size()); ++i) {
+    if (!cels[i])
+      continue;
+
+    // Linked cels share the same CelData
+    cels[i]->data()->setImage(images[i]);
+    cels[i]->data()->incrementVersion();
+    m_images[i].newImage.reset();
+  }
+}
+
+void ReplaceImages::onSwapOut()
+{
+  if (m_swapped || m_images.empty())
+    return;
+
+  // All the copies are stored in one block with the same
+  // serialization used by ReplaceImage
+  std::ostringstream os(std::ios::binary);
+  for (const auto& item : m_images) {
+    std::unique_ptr<Image> image(item.copy.createImage());
+    write_image(os, image.get());
+  }
+  const std::string str = os.str();
+  const std::vector<uint8_t> data(str.begin(), str.end());
+
+  if (UndoSwap::instance().store(data, m_slot)) {
+    for (auto& item : m_images)
+      item.copy = ImageTiles();
+    m_swapped = true;
+  }
+}
+
+void ReplaceImages::swapIn()
+{
+  if (!m_swapped)
+    return;
+
+  std::vector<uint8_t> data;
+  if (!UndoSwap::instance().load(m_slot, data))
+    throw base::Exception("Error reading undo data from the swap file.");
+
+  std::istringstream is(std::string(data.begin(), data.end()),
+                        std::ios::binary);
+  for (auto& item : m_images) {
+    std::unique_ptr<Image> image(read_image(is, false));
+    if (!image)
+      throw base::Exception("Error reading undo data from the swap file.");
+    item.copy = ImageTiles(image.get());
+  }
+
+  UndoSwap::instance().release(m_slot);
+  m_swapped = false;
+}
+
+} // namespace cmd
+} // namespace app
@@ -0,0 +1,64 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "app/cmd.h"
+#include "app/cmd/with_sprite.h"
+#include "app/undo_swap.h"
+#include "doc/image_ref.h"
+#include "doc/image_tiles.h"
+
+#include <vector>
+
+namespace app {
+namespace cmd {
+  using namespace doc;
+
+  // Replaces several images of the sprite at the same time (e.g. all
+  // the images converted by SetPixelFormat). It's like a sequence of
+  // ReplaceImage, but the cels are updated in one pass, the copies of
+  // the replaced images are created/restored in parallel, and they
+  // are swapped out as one block.
+  class ReplaceImages : public Cmd
+                      , public WithSprite {
+  public:
+    ReplaceImages(Sprite* sprite);
+    ~ReplaceImages();
+
+    void add(const ImageRef& oldImage, const ImageRef& newImage);
+    bool empty() const { return m_images.empty(); }
+
+  protected:
+    void onExecute() override;
+    void onUndo() override;
+    void onRedo() override;
+    size_t onMemSize() const override;
+    void onSwapOut() override;
+
+  private:
+    struct Item {
+      ObjectId oldImageId;
+      ObjectId newImageId;
+      // Used only from add() until onExecute() (see ReplaceImage)
+      ImageRef newImage;
+      // Copy of the image that isn't in the sprite
+      ImageTiles copy;
+    };
+
+    void swapImages(bool undo);
+    void swapIn();
+
+    std::vector<Item> m_images;
+
+    // True if the copies are in the undo swap file.
+    bool m_swapped;
+    UndoSwap::Slot m_slot;
+  };
+
+} // namespace cmd
+} // namespace app
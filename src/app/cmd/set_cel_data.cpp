@@ -28,6 +28,7 @@ SetCelData::SetCelData(std::shared_ptr<Cel> cel, const CelDataRef& newData)
   , m_oldDataId(cel->data()->id())
   , m_oldImageId(cel->image()->id())
   , m_newDataId(newData->id())
+  , m_opacityCopy(255)
   , m_newData(newData)
 {
 }
@@ -47,13 +48,18 @@ void SetCelData::onUndo()
 {
   auto cel = this->cel();
 
-  if (m_dataCopy) {
+  if (!m_imageCopy.isEmpty()) {
     ASSERT(!cel->sprite()->getCelDataRef(m_oldDataId));
-    m_dataCopy->setId(m_oldDataId);
-    m_dataCopy->image()->setId(m_oldImageId);
+    ImageRef image(m_imageCopy.createImage());
+    image->setId(m_oldImageId);
 
-    cel->setDataRef(m_dataCopy);
-    m_dataCopy.reset();
+    CelDataRef oldData(new CelData(image));
+    oldData->setId(m_oldDataId);
+    oldData->setPosition(m_positionCopy);
+    oldData->setOpacity(m_opacityCopy);
+
+    cel->setDataRef(oldData);
+    m_imageCopy = ImageTiles();
   }
   else {
     CelDataRef oldData = cel->sprite()->getCelDataRef(m_oldDataId);
@@ -80,9 +86,10 @@ void SetCelData::createCopy()
 {
   auto cel = this->cel();
 
-  ASSERT(!m_dataCopy);
-  m_dataCopy.reset(new CelData(*cel->data()));
-  m_dataCopy->setImage(ImageRef(Image::createCopy(cel->image())));
+  ASSERT(m_imageCopy.isEmpty());
+  m_imageCopy = ImageTiles(cel->image());
+  m_positionCopy = cel->data()->position();
+  m_opacityCopy = cel->data()->opacity();
 }
 
 } // namespace cmd
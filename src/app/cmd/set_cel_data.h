@@ -10,6 +10,8 @@
 #include "app/cmd.h"
 #include "app/cmd/with_cel.h"
 #include "doc/cel_data.h"
+#include "doc/image_tiles.h"
+#include "gfx/point.h"
 
 #include <sstream>
 
@@ -27,8 +29,7 @@ namespace cmd {
     void onUndo() override;
     void onRedo() override;
     size_t onMemSize() const override {
-      return sizeof(*this) +
-        (m_dataCopy ? m_dataCopy->getMemSize(): 0);
+      return sizeof(*this) + m_imageCopy.getMemSize();
     }
 
   private:
@@ -37,7 +38,12 @@ namespace cmd {
     ObjectId m_oldDataId;
     ObjectId m_oldImageId;
     ObjectId m_newDataId;
-    CelDataRef m_dataCopy;
+
+    // Copy of the old cel data (when the cel isn't linked), the
+    // image is stored in tiles shared with other copies.
+    ImageTiles m_imageCopy;
+    gfx::Point m_positionCopy;
+    int m_opacityCopy;
 
     // Reference used only to keep the copy of the new CelData from
     // the SetCelData() ctor until the SetCelData::onExecute() call.
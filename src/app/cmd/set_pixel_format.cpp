@@ -12,20 +12,24 @@
 #include "app/cmd/set_pixel_format.h"
 
 #include "app/cmd/remove_palette.h"
-#include "app/cmd/replace_image.h"
+#include "app/cmd/replace_images.h"
 #include "app/cmd/set_cel_opacity.h"
 #include "app/cmd/set_palette.h"
 #include "app/document.h"
+#include "base/thread_pool.h"
 #include "doc/cel.h"
 #include "doc/cels_range.h"
 #include "doc/document.h"
 #include "doc/document_event.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
+#include "doc/rgbmap.h"
 #include "doc/sprite.h"
 #include "render/quantization.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace app {
 namespace cmd {
@@ -42,23 +46,73 @@ SetPixelFormat::SetPixelFormat(Sprite* sprite,
   if (sprite->pixelFormat() == newFormat)
     return;
 
-  for (auto cel : sprite->uniqueCels()) {
-    ImageRef old_image = cel->imageRef();
-    ImageRef new_image(
-      render::convert_pixel_format
-      (old_image.get(), NULL, newFormat, m_dithering,
-       sprite->rgbMap(cel->frame()),
-       sprite->palette(cel->frame()),
-       cel->layer()->isBackground(),
-       old_image->maskColor()));
-
-    m_seq.add(new cmd::ReplaceImage(sprite, old_image, new_image));
+  // Cels are grouped by palette, so the cels of each group can be
+  // converted at the same time (the sprite has only one RgbMap, which
+  // is regenerated for each palette).
+  std::vector<Cel*> cels;
+  std::vector<std::pair<const Palette*, std::vector<int>>> groups;
+  for (const auto& cel : sprite->uniqueCels()) {
+    const Palette* palette = sprite->palette(cel->frame());
+    auto it = std::find_if(groups.begin(), groups.end(),
+                           [palette](const auto& group) {
+                             return group.first == palette;
+                           });
+    if (it == groups.end()) {
+      groups.emplace_back(palette, std::vector<int>());
+      it = groups.end()-1;
+    }
+    it->second.push_back(int(cels.size()));
+    cels.push_back(cel.get());
+  }
+
+  std::vector<ImageRef> newImages(cels.size());
+  for (const auto& group : groups) {
+    const std::vector<int>& indexes = group.second;
+    const frame_t frame = cels[indexes.front()]->frame();
+    RgbMap* rgbmap = sprite->rgbMap(frame);
+
+    // For big images it's faster to calculate all the color map at
+    // once (with several threads) than each color on demand. It's
+    // needed to convert several images at the same time too.
+    if (newFormat == IMAGE_INDEXED) {
+      std::size_t pixels = 0;
+      for (int i : indexes)
+        pixels += std::size_t(cels[i]->image()->width()) * cels[i]->image()->height();
+      if (pixels > std::size_t(rgbmap->size()))
+        rgbmap->calculateAll();
+    }
+
+    auto convertCel = [&](int j) {
+      Cel* cel = cels[indexes[j]];
+      const Image* old_image = cel->image();
+      newImages[indexes[j]].reset(
+        render::convert_pixel_format
+        (old_image, NULL, newFormat, m_dithering,
+         rgbmap, group.first,
+         cel->layer()->isBackground(),
+         old_image->maskColor()));
+    };
+
+    if (newFormat != IMAGE_INDEXED || rgbmap->isCalculated())
+      base::thread_pool::instance().parallel_for(int(indexes.size()), convertCel);
+    else {
+      for (int j=0; j<int(indexes.size()); ++j)
+        convertCel(j);
+    }
+  }
+
+  // Only one undo record for all the images
+  if (!cels.empty()) {
+    auto replaceImages = new cmd::ReplaceImages(sprite);
+    for (std::size_t i=0; i<cels.size(); ++i)
+      replaceImages->add(cels[i]->imageRef(), newImages[i]);
+    m_seq.add(replaceImages);
   }
 
   // Set all cels opacity to 100% if we are converting to indexed.
   // TODO remove this
   if (newFormat == IMAGE_INDEXED) {
-    for (auto cel : sprite->uniqueCels()) {
+    for (const auto& cel : sprite->uniqueCels()) {
       if (cel->opacity() < 255)
         m_seq.add(new cmd::SetCelOpacity(cel, 255));
     }
@@ -34,6 +34,9 @@ namespace cmd {
     size_t onMemSize() const override {
       return sizeof(*this) + m_seq.memSize();
     }
+    void onSwapOut() override {
+      m_seq.swapOut();
+    }
 
   private:
     void setFormat(PixelFormat format);
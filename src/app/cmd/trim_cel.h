@@ -28,6 +28,9 @@ namespace cmd {
     size_t onMemSize() const override {
       return sizeof(*this) + m_subCmd->memSize();
     }
+    void onSwapOut() override {
+      m_subCmd->swapOut();
+    }
 
   private:
     Cmd* m_subCmd;
@@ -11,6 +11,8 @@
 
 #include "app/cmd_sequence.h"
 
+#include <typeinfo>
+
 namespace app {
 
 CmdSequence::CmdSequence()
@@ -56,10 +58,27 @@ size_t CmdSequence::onMemSize() const
   return size;
 }
 
+void CmdSequence::onSwapOut()
+{
+  for (Cmd* cmd : m_cmds)
+    cmd->swapOut();
+}
+
 void CmdSequence::executeAndAdd(Cmd* cmd)
 {
   cmd->execute(context());
   add(cmd);
 }
 
+void CmdSequence::onCollectStats(CmdStatsMap& stats) const
+{
+  // The sub-cmds are added in their own entries
+  CmdTypeStats& s = stats[typeid(*this)];
+  ++s.count;
+  s.memSize += sizeof(*this);
+
+  for (auto it = m_cmds.begin(), end=m_cmds.end(); it!=end; ++it)
+    (*it)->collectStats(stats);
+}
+
 } // namespace app
@@ -0,0 +1,102 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd_stats.h"
+
+#include "app/document_undo.h"
+#include "base/mem_utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace app {
+
+CmdStats& CmdStats::instance()
+{
+  static CmdStats stats;
+  return stats;
+}
+
+void CmdStats::addTime(const std::type_index& type, CmdTypeStats::Op op, double secs)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  CmdTypeStats& stats = m_timings[type];
+  ++stats.calls[op];
+  stats.time[op] += secs;
+}
+
+void CmdStats::mergeTimings(CmdStatsMap& stats) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& it : m_timings) {
+    CmdTypeStats& dst = stats[it.first];
+    for (int op=0; op<CmdTypeStats::Ops; ++op) {
+      dst.calls[op] += it.second.calls[op];
+      dst.time[op] += it.second.time[op];
+    }
+  }
+}
+
+std::string CmdStats::typeName(const std::type_index& type)
+{
+  std::string name = type.name();
+#ifdef __GNUG__
+  int status;
+  char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+  if (status == 0)
+    name = demangled;
+  std::free(demangled);
+#endif
+  return name;
+}
+
+std::string CmdStats::report(const DocumentUndo* undo)
+{
+  CmdStatsMap stats;
+  if (undo)
+    undo->collectStats(stats);
+  instance().mergeTimings(stats);
+
+  // Biggest memory users first
+  std::vector<std::pair<std::string, CmdTypeStats>> rows;
+  std::size_t total = 0;
+  for (const auto& it : stats) {
+    rows.push_back(std::make_pair(typeName(it.first), it.second));
+    total += it.second.memSize;
+  }
+  std::sort(rows.begin(), rows.end(),
+            [](const auto& a, const auto& b) {
+              return a.second.memSize > b.second.memSize;
+            });
+
+  std::string result = "Undo memory: " + base::get_pretty_memory_size(total) + "\n";
+  result += "Cmd | count | memory | execute | undo | redo (calls/ms)\n";
+  for (const auto& row : rows) {
+    const CmdTypeStats& s = row.second;
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), " | %d | %s | %d/%.1f | %d/%.1f | %d/%.1f\n",
+                  s.count,
+                  base::get_pretty_memory_size(s.memSize).c_str(),
+                  s.calls[CmdTypeStats::Execute], s.time[CmdTypeStats::Execute]*1000.0,
+                  s.calls[CmdTypeStats::Undo], s.time[CmdTypeStats::Undo]*1000.0,
+                  s.calls[CmdTypeStats::Redo], s.time[CmdTypeStats::Redo]*1000.0);
+    result += row.first + buf;
+  }
+  return result;
+}
+
+} // namespace app
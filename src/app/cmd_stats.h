@@ -0,0 +1,52 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <typeindex>
+
+namespace app {
+  class DocumentUndo;
+
+  // Accumulated costs of one type of Cmd (e.g. app::cmd::SetMask).
+  struct CmdTypeStats {
+    enum Op { Execute, Undo, Redo, Ops };
+
+    int count = 0;              // Cmds in the undo history
+    std::size_t memSize = 0;    // Memory used by those Cmds
+    int calls[Ops] = { 0, 0, 0 };
+    double time[Ops] = { 0.0, 0.0, 0.0 }; // Seconds (including sub-cmds)
+  };
+
+  using CmdStatsMap = std::map<std::type_index, CmdTypeStats>;
+
+  // Process-wide timings of Cmd::execute/undo/redo by Cmd type.
+  class CmdStats {
+  public:
+    static CmdStats& instance();
+
+    void addTime(const std::type_index& type, CmdTypeStats::Op op, double secs);
+
+    // Adds the timings of each type to "stats".
+    void mergeTimings(CmdStatsMap& stats) const;
+
+    static std::string typeName(const std::type_index& type);
+
+    // Table with the memory used by each Cmd type in the given undo
+    // history and the time spent in each operation.
+    static std::string report(const DocumentUndo* undo);
+
+  private:
+    mutable std::mutex m_mutex;
+    CmdStatsMap m_timings;
+  };
+
+} // namespace app
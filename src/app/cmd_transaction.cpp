@@ -16,17 +16,43 @@
 
 namespace app {
 
+// Maximum time between two mergeable transactions to be coalesced
+static const base::tick_t kMergeTime = 400;
+
 CmdTransaction::CmdTransaction(const std::string& label,
   bool changeSavedState, int* savedCounter)
   : m_label(label)
   , m_changeSavedState(changeSavedState)
   , m_savedCounter(savedCounter)
+  , m_mergeable(false)
+  , m_startTick(0)
+  , m_commitTick(0)
 {
 }
 
 void CmdTransaction::commit()
 {
   m_spritePositionAfter = calcSpritePosition();
+  m_commitTick = base::current_tick();
+}
+
+bool CmdTransaction::canMergeWith(const CmdTransaction* next) const
+{
+  return (m_mergeable &&
+          next->m_mergeable &&
+          m_changeSavedState == next->m_changeSavedState &&
+          m_label == next->m_label &&
+          m_spritePositionAfter == next->m_spritePositionBefore &&
+          next->m_startTick - m_commitTick <= kMergeTime);
+}
+
+void CmdTransaction::merge(CmdTransaction* next)
+{
+  ASSERT(canMergeWith(next));
+
+  add(next);
+  m_spritePositionAfter = next->m_spritePositionAfter;
+  m_commitTick = next->m_commitTick;
 }
 
 void CmdTransaction::onExecute()
@@ -36,6 +62,7 @@ void CmdTransaction::onExecute()
   // The execution of CmdTransaction is called by Transaction at the
   // very beginning, just to save the current sprite position.
   m_spritePositionBefore = calcSpritePosition();
+  m_startTick = base::current_tick();
 
   if (m_changeSavedState)
     ++(*m_savedCounter);
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "app/cmd_sequence.h"
+#include "base/time.h"
 
 namespace app {
 
@@ -20,6 +21,16 @@ namespace app {
 
     void commit();
 
+    // A mergeable transaction can be coalesced with the previous
+    // mergeable one (e.g. tiny strokes made quickly with the same
+    // tool, like stippling) to create just one undo state.
+    void setMergeable(bool state) { m_mergeable = state; }
+    bool canMergeWith(const CmdTransaction* next) const;
+
+    // Adds the given (already executed and committed) transaction at
+    // the end of this one. We take the ownership of "next".
+    void merge(CmdTransaction* next);
+
     doc::SpritePosition spritePositionBeforeExecute() const { return m_spritePositionBefore; }
     doc::SpritePosition spritePositionAfterExecute() const { return m_spritePositionAfter; }
 
@@ -37,6 +48,9 @@ namespace app {
     std::string m_label;
     bool m_changeSavedState;
     int* m_savedCounter;
+    bool m_mergeable;
+    base::tick_t m_startTick;
+    base::tick_t m_commitTick;
   };
 
 } // namespace app
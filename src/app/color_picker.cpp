@@ -58,7 +58,7 @@ void ColorPicker::pickColor(const doc::Site& site,
       render::get_sprite_pixel(sprite, pos.x, pos.y, site.frame()));
 
     doc::CelList cels;
-    sprite->pickCels(pos.x, pos.y, site.frame(), 128, cels);
+    sprite->pickCels(pos.x, pos.y, site.frame(), 128, cels, 1);
     if (!cels.empty())
       m_layer = cels.front()->layer();
   }
@@ -108,7 +108,7 @@ private:
     else if (m_range.enabled()) {
       Sprite* sprite = m_document->sprite();
       int count = 0;
-      for (auto cel : sprite->uniqueCels(m_range.frameBegin(),
+      for (const auto& cel : sprite->uniqueCels(m_range.frameBegin(),
                                          m_range.frameEnd())) {
         if (m_range.inRange(sprite->layerToIndex(cel->layer()))) {
           if (backgroundCount && cel->layer()->isBackground())
@@ -186,7 +186,7 @@ private:
         }
         else if (m_range.enabled()) {
           Sprite* sprite = m_document->sprite();
-          for (auto cel : sprite->uniqueCels(m_range.frameBegin(),
+          for (const auto& cel : sprite->uniqueCels(m_range.frameBegin(),
                                              m_range.frameEnd())) {
             if (m_range.inRange(sprite->layerToIndex(cel->layer()))) {
               if (!cel->layer()->isBackground() && newOpacity != cel->opacity()) {
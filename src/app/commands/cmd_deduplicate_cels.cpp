@@ -0,0 +1,107 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/set_cel_data.h"
+#include "app/commands/command.h"
+#include "app/context_access.h"
+#include "app/modules/gui.h"
+#include "app/transaction.h"
+#include "app/ui/status_bar.h"
+#include "doc/cel.h"
+#include "doc/identical_cels.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+
+#include <vector>
+
+namespace app {
+
+// Links all the cels of the sprite that have the same image,
+// position, opacity and user data than a previous cel of the same
+// layer.
+class DeduplicateCelsCommand : public Command {
+public:
+  DeduplicateCelsCommand();
+  Command* clone() const override { return new DeduplicateCelsCommand(*this); }
+
+protected:
+  bool onEnabled(Context* context) override;
+  void onExecute(Context* context) override;
+};
+
+DeduplicateCelsCommand::DeduplicateCelsCommand()
+  : Command("DeduplicateCels",
+            "Deduplicate Cels",
+            CmdRecordableFlag)
+{
+}
+
+bool DeduplicateCelsCommand::onEnabled(Context* context)
+{
+  return context->checkFlags(ContextFlags::ActiveDocumentIsWritable);
+}
+
+void DeduplicateCelsCommand::onExecute(Context* context)
+{
+  ContextWriter writer(context);
+  Document* document(writer.document());
+  Sprite* sprite = writer.sprite();
+  bool nonEditableLayers = false;
+  int linked = 0;
+  {
+    Transaction transaction(writer.context(), friendlyName());
+    IdenticalCels identicalCels;
+
+    std::vector<Layer*> layers;
+    sprite->getLayersList(layers);
+    for (Layer* layer : layers) {
+      if (!layer->isImage())
+        continue;
+
+      if (!layer->isEditable()) {
+        nonEditableLayers = true;
+        continue;
+      }
+
+      CelList cels;
+      layer->getCels(cels);
+      for (auto& cel : cels) {
+        if (cel->link())
+          continue;
+
+        if (auto other = identicalCels.find(cel)) {
+          transaction.execute(new cmd::SetCelData(cel, other->dataRef()));
+          ++linked;
+        }
+        else
+          identicalCels.add(cel);
+      }
+    }
+
+    transaction.commit();
+  }
+
+  if (nonEditableLayers)
+    StatusBar::instance()->showTip(1000,
+      "There are locked layers");
+  else
+    StatusBar::instance()->showTip(1000,
+      "%d cel(s) linked", linked);
+
+  update_screen_for_document(document);
+}
+
+Command* CommandFactory::createDeduplicateCelsCommand()
+{
+  return new DeduplicateCelsCommand;
+}
+
+} // namespace app
@@ -86,7 +86,7 @@ void FlipCommand::onExecute(Context* context)
         cels.push_back(writer.cel());
     }
     else {
-      for (auto cel : sprite->uniqueCels())
+      for (const auto& cel : sprite->uniqueCels())
         cels.push_back(cel);
     }
 
@@ -32,6 +32,8 @@
 #include "she/system.h"
 
 #include <cstring>
+#include <map>
+#include <tuple>
 
 #define PREVIEW_TILED           1
 #define PREVIEW_FIT_ON_SCREEN   2
@@ -42,7 +44,12 @@ using namespace ui;
 using namespace doc;
 using namespace filters;
 
+// The sprite is displayed with tiles of the zoomed sprite already
+// converted to screen surfaces, so panning just blits the tiles, and
+// going back to a frame reuses its tiles.
 class PreviewWindow : public Window {
+  enum { kTileSize = 256 };
+
 public:
   PreviewWindow(Context* context, Editor* editor)
     : Window(DesktopWindow)
@@ -54,7 +61,10 @@ public:
     , m_zoom(editor->zoom())
     , m_index_bg_color(-1)
     , m_doublebuf(Image::create(IMAGE_RGB, ui::display_w(), ui::display_h()))
-    , m_doublesur(she::instance()->createRgbaSurface(ui::display_w(), ui::display_h())) {
+    , m_doublesur(she::instance()->createRgbaSurface(ui::display_w(), ui::display_h()))
+    , m_bgValid(false)
+    , m_tick(0)
+    , m_maxTiles(3 * (ui::display_w()/kTileSize + 2) * (ui::display_h()/kTileSize + 2)) {
     // Do not use DocumentWriter (do not lock the document) because we
     // will call other sub-commands (e.g. previous frame, next frame,
     // etc.).
@@ -79,6 +89,11 @@ public:
     captureMouse();
   }
 
+  ~PreviewWindow() {
+    for (auto& it : m_tiles)
+      it.second.surface->dispose();
+  }
+
 protected:
   virtual bool onProcessMessage(Message* msg) override {
     switch (msg->type()) {
@@ -129,7 +144,6 @@ protected:
              command->id() == CommandId::GotoLastFrame)) {
           m_context->executeCommand(command, params);
           invalidate();
-          m_render.reset(NULL); // Re-render
         }
 #if 0
         // Play the animation
@@ -144,6 +158,7 @@ protected:
           if (m_index_bg_color == -1 ||
             m_index_bg_color < m_pal->size()-1) {
             ++m_index_bg_color;
+            m_bgValid = false;
 
             invalidate();
           }
@@ -152,6 +167,7 @@ protected:
                  keyMsg->unicodeChar() == '-') {
           if (m_index_bg_color >= 0) {
             --m_index_bg_color;     // can be -1 which is the checked background
+            m_bgValid = false;
 
             invalidate();
           }
@@ -174,18 +190,28 @@ protected:
   virtual void onPaint(PaintEvent& ev) override {
     Graphics* g = ev.graphics();
     AppRender& render = m_editor->renderEngine();
-    render.disableOnionskin();
-    render.setBgType(render::BgType::TRANSPARENT);
 
-    // Render sprite and leave the result in 'm_render' variable
-    if (m_render == NULL) {
-      ImageBufferPtr buf = Editor::getRenderImageBuffer();
-      m_render.reset(Image::create(IMAGE_RGB,
-          m_sprite->width(), m_sprite->height(), buf));
+    // The background doesn't move with the sprite, it's converted to
+    // the screen surface only when it changes
+    if (!m_bgValid) {
+      if (m_index_bg_color == -1) {
+        render.setupBackground(m_doc, m_doublebuf->pixelFormat());
+        render.renderBackground(m_doublebuf.get(),
+          gfx::Clip(0, 0, -m_pos.x, -m_pos.y,
+            m_doublebuf->width(), m_doublebuf->height()), m_zoom);
+      }
+      else {
+        doc::clear_image(m_doublebuf.get(), m_pal->getEntry(m_index_bg_color));
+      }
 
-      render.renderSprite(
-        m_render.get(), m_sprite, m_editor->frame());
+      doc::convert_image_to_surface(m_doublebuf.get(), m_pal,
+        m_doublesur, 0, 0, 0, 0, m_doublebuf->width(), m_doublebuf->height());
+      m_bgValid = true;
     }
+    g->blit(m_doublesur, 0, 0, 0, 0, m_doublesur->width(), m_doublesur->height());
+
+    render.disableOnionskin();
+    render.setBgType(render::BgType::TRANSPARENT);
 
     int x, y, w, h, u, v;
     x = m_pos.x + m_zoom.apply(m_zoom.remove(m_delta.x));
@@ -196,45 +222,92 @@ protected:
     if (int(m_tiled) & int(TiledMode::X_AXIS)) x = SGN(x) * (ABS(x)%w);
     if (int(m_tiled) & int(TiledMode::Y_AXIS)) y = SGN(y) * (ABS(y)%h);
 
-    if (m_index_bg_color == -1) {
-      render.setupBackground(m_doc, m_doublebuf->pixelFormat());
-      render.renderBackground(m_doublebuf.get(),
-        gfx::Clip(0, 0, -m_pos.x, -m_pos.y,
-          m_doublebuf->width(), m_doublebuf->height()), m_zoom);
-    }
-    else {
-      doc::clear_image(m_doublebuf.get(), m_pal->getEntry(m_index_bg_color));
-    }
-
     switch (m_tiled) {
       case TiledMode::NONE:
-        render.renderImage(m_doublebuf.get(), m_render.get(), m_pal, x, y,
-                           m_zoom, 255, BlendMode::NORMAL);
+        drawSprite(g, render, x, y, w, h);
         break;
       case TiledMode::X_AXIS:
         for (u=x-w; u<ui::display_w()+w; u+=w)
-          render.renderImage(m_doublebuf.get(), m_render.get(), m_pal, u, y,
-                             m_zoom, 255, BlendMode::NORMAL);
+          drawSprite(g, render, u, y, w, h);
         break;
       case TiledMode::Y_AXIS:
         for (v=y-h; v<ui::display_h()+h; v+=h)
-          render.renderImage(m_doublebuf.get(), m_render.get(), m_pal, x, v,
-                             m_zoom, 255, BlendMode::NORMAL);
+          drawSprite(g, render, x, v, w, h);
         break;
       case TiledMode::BOTH:
         for (v=y-h; v<ui::display_h()+h; v+=h)
           for (u=x-w; u<ui::display_w()+w; u+=w)
-            render.renderImage(m_doublebuf.get(), m_render.get(), m_pal, u, v,
-                               m_zoom, 255, BlendMode::NORMAL);
+            drawSprite(g, render, u, v, w, h);
         break;
     }
 
-    doc::convert_image_to_surface(m_doublebuf.get(), m_pal,
-      m_doublesur, 0, 0, 0, 0, m_doublebuf->width(), m_doublebuf->height());
-    g->blit(m_doublesur, 0, 0, 0, 0, m_doublesur->width(), m_doublesur->height());
+    removeOldTiles();
   }
 
 private:
+  typedef std::tuple<frame_t, int, int> TileKey;
+  struct Tile {
+    she::Surface* surface;
+    uint64_t lastUse;
+  };
+
+  // Draws the visible tiles of the zoomed sprite (of size w x h) at
+  // the given screen position.
+  void drawSprite(Graphics* g, AppRender& render, int x, int y, int w, int h) {
+    const gfx::Rect visible =
+      gfx::Rect(x, y, w, h).createIntersection(
+        gfx::Rect(0, 0, ui::display_w(), ui::display_h()));
+    if (visible.isEmpty())
+      return;
+
+    const int tx1 = (visible.x - x) / kTileSize;
+    const int ty1 = (visible.y - y) / kTileSize;
+    const int tx2 = (visible.x2() - 1 - x) / kTileSize;
+    const int ty2 = (visible.y2() - 1 - y) / kTileSize;
+
+    for (int ty=ty1; ty<=ty2; ++ty)
+      for (int tx=tx1; tx<=tx2; ++tx)
+        g->drawRgbaSurface(getTile(render, tx, ty, w, h),
+                           x + tx*kTileSize, y + ty*kTileSize);
+  }
+
+  she::Surface* getTile(AppRender& render, int tx, int ty, int w, int h) {
+    const frame_t frame = m_editor->frame();
+    auto it = m_tiles.find(TileKey(frame, tx, ty));
+    if (it == m_tiles.end()) {
+      const gfx::Rect rc =
+        gfx::Rect(tx*kTileSize, ty*kTileSize, kTileSize, kTileSize)
+        .createIntersection(gfx::Rect(0, 0, w, h));
+
+      ImageBufferPtr buf = Editor::getRenderImageBuffer();
+      std::unique_ptr<Image> image(Image::create(IMAGE_RGB, rc.w, rc.h, buf));
+      render.renderSprite(image.get(), m_sprite, frame,
+                          gfx::Clip(0, 0, rc), m_zoom);
+
+      she::Surface* surface = she::instance()->createRgbaSurface(rc.w, rc.h);
+      doc::convert_image_to_surface(image.get(), m_pal,
+        surface, 0, 0, 0, 0, rc.w, rc.h);
+
+      it = m_tiles.insert(std::make_pair(TileKey(frame, tx, ty),
+                                         Tile{ surface, 0 })).first;
+    }
+    it->second.lastUse = ++m_tick;
+    return it->second.surface;
+  }
+
+  // Keeps the most recently used tiles
+  void removeOldTiles() {
+    while (int(m_tiles.size()) > m_maxTiles) {
+      auto oldest = m_tiles.begin();
+      for (auto it=m_tiles.begin(); it!=m_tiles.end(); ++it)
+        if (it->second.lastUse < oldest->second.lastUse)
+          oldest = it;
+
+      oldest->second.surface->dispose();
+      m_tiles.erase(oldest);
+    }
+  }
+
   Context* m_context;
   Editor* m_editor;
   Document* m_doc;
@@ -245,9 +318,12 @@ private:
   gfx::Point m_delta;
   render::Zoom m_zoom;
   int m_index_bg_color;
-  std::unique_ptr<Image> m_render;
   std::unique_ptr<Image> m_doublebuf;
   she::ScopedHandle<she::Surface> m_doublesur;
+  bool m_bgValid;
+  std::map<TileKey, Tile> m_tiles;
+  uint64_t m_tick;
+  int m_maxTiles;
   filters::TiledMode m_tiled;
 };
 
@@ -29,12 +29,15 @@
 #include "app/ui/editor/standby_state.h"
 #include "app/ui/workspace.h"
 #include "base/bind.h"
+#include "base/thread_pool.h"
+#include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
+#include "render/render.h"
 #include "ui/ui.h"
 
 #include "import_sprite_sheet.xml.h"
@@ -327,7 +330,6 @@ void ImportSpriteSheetCommand::onExecute(Context* context)
   try {
     Sprite* sprite = document->sprite();
     frame_t currentFrame = context->activeSite().frame();
-    render::Render render;
 
     // Each sprite in the sheet
     std::vector<gfx::Rect> tileRects;
@@ -365,19 +367,31 @@ void ImportSpriteSheetCommand::onExecute(Context* context)
         break;
     }
 
-    // As first step, we cut each tile and add them into "animation" list.
-    for (const auto& tileRect : tileRects) {
-      ImageRef resultImage(
-        Image::create(
-          sprite->pixelFormat(), tileRect.w, tileRect.h));
-
-      // Render the portion of sheet.
-      render.renderSprite(
-        resultImage.get(), sprite, currentFrame,
-        gfx::Clip(0, 0, tileRect));
-
-      animation.push_back(resultImage);
-    }
+    // As first step, we cut each tile (in parallel) and add them into
+    // "animation" list. Empty tiles are kept as null images (frames
+    // without cel).
+    animation.resize(tileRects.size());
+    for (auto& image : animation)
+      image.reset(Image::create(sprite->pixelFormat(), frameBounds.w, frameBounds.h));
+
+    base::thread_pool::instance().parallel_for(
+      int(tileRects.size()),
+      [&animation, &tileRects, sprite, currentFrame](int i) {
+        render::Render render;
+        render.renderSprite(
+          animation[i].get(), sprite, currentFrame,
+          gfx::Clip(0, 0, tileRects[i]));
+
+        gfx::Rect bounds;
+        if (!doc::algorithm::shrink_bounds(animation[i].get(), bounds,
+                                           sprite->transparentColor()))
+          animation[i].reset();
+      });
+
+    // Remove the empty tiles at the end of the sheet (e.g. the last
+    // row of a grid that isn't full)
+    while (animation.size() > 1 && !animation.back())
+      animation.pop_back();
 
     if (animation.size() == 0) {
       Alert::show("Import Sprite Sheet"
@@ -393,18 +407,20 @@ void ImportSpriteSheetCommand::onExecute(Context* context)
     Transaction transaction(writer.context(), "Import Sprite Sheet", ModifyDocument);
     DocumentApi api = document->getApi(transaction);
 
-    // Add the layer in the sprite.
-    LayerImage* resultLayer = api.newLayer(sprite, "Sprite Sheet");
-
-    // Add all frames+cels to the new layer
+    // Add all frames+cels to the new layer before adding it in the
+    // sprite (so it's just one undo command instead of one for each
+    // cel).
+    LayerImage* resultLayer = new LayerImage(sprite);
+    resultLayer->setName("Sprite Sheet");
     for (size_t i=0; i<animation.size(); ++i) {
-      // Create the cel.
-      auto resultCel = std::make_shared<Cel>(frame_t(i), animation[i]);
-
-      // Add the cel in the layer.
-      api.addCel(resultLayer, resultCel);
+      if (animation[i])
+        resultLayer->addCel(std::make_shared<Cel>(frame_t(i), animation[i]));
     }
 
+    // Add the layer in the sprite.
+    api.addLayer(sprite->folder(), resultLayer,
+                 sprite->folder()->getLastLayer());
+
     // Copy the list of layers (because we will modify it in the iteration).
     LayerList layers = sprite->folder()->getLayersList();
 
@@ -33,6 +33,7 @@
 #include "ui/button.h"
 #include "ui/label.h"
 #include "ui/slider.h"
+#include "ui/timer.h"
 #include "ui/widget.h"
 #include "ui/window.h"
 
@@ -45,6 +46,10 @@ namespace app {
 
 using namespace ui;
 
+// Milliseconds without changes in the color/tolerance to generate
+// the preview of the mask.
+static const int kPreviewDelay = 50;
+
 class MaskByColorCommand : public Command {
 public:
   MaskByColorCommand();
@@ -56,9 +61,11 @@ protected:
 
 private:
   Mask* generateMask(const Sprite* sprite, const Image* image, int xpos, int ypos);
+  void schedulePreview();
   void maskPreview(const ContextReader& reader);
 
   Window* m_window; // TODO we cannot use a unique_ptr because clone() needs a copy ctor
+  ui::Timer* m_previewTimer;
   ColorButton* m_buttonColor;
   CheckBox* m_checkPreview;
   Slider* m_sliderTolerance;
@@ -68,6 +75,8 @@ MaskByColorCommand::MaskByColorCommand()
   : Command("MaskByColor",
             "Mask By Color",
             CmdUIOnlyFlag)
+  , m_window(nullptr)
+  , m_previewTimer(nullptr)
 {
 }
 
@@ -120,8 +129,19 @@ void MaskByColorCommand::onExecute(Context* context)
   button_cancel->Click.connect(base::Bind<void>(&Window::closeWindow, m_window, button_cancel));
 
 
-  m_buttonColor->Change.connect(base::Bind<void>(&MaskByColorCommand::maskPreview, this, base::Ref(reader)));
-  m_sliderTolerance->Change.connect(base::Bind<void>(&MaskByColorCommand::maskPreview, this, base::Ref(reader)));
+  // The preview is generated when the user stops changing the
+  // color/tolerance for a moment (the pending preview is discarded
+  // with each change).
+  ui::Timer previewTimer(kPreviewDelay, m_window);
+  m_previewTimer = &previewTimer;
+  previewTimer.Tick.connect(
+    [this, &reader]{
+      m_previewTimer->stop();
+      maskPreview(reader);
+    });
+
+  m_buttonColor->Change.connect(base::Bind<void>(&MaskByColorCommand::schedulePreview, this));
+  m_sliderTolerance->Change.connect(base::Bind<void>(&MaskByColorCommand::schedulePreview, this));
   m_checkPreview->Click.connect(base::Bind<void>(&MaskByColorCommand::maskPreview, this, base::Ref(reader)));
 
   button_ok->setFocusMagnet(true);
@@ -155,6 +175,8 @@ void MaskByColorCommand::onExecute(Context* context)
   m_window->openWindowInForeground();
 
   bool apply = (m_window->closer() == button_ok);
+  previewTimer.stop();
+  m_previewTimer = nullptr;
 
   ContextWriter writer(reader);
   Document* document(writer.document());
@@ -193,6 +215,12 @@ Mask* MaskByColorCommand::generateMask(const Sprite* sprite, const Image* image,
   return mask.release();
 }
 
+void MaskByColorCommand::schedulePreview()
+{
+  if (m_previewTimer && m_checkPreview->isSelected())
+    m_previewTimer->start();
+}
+
 void MaskByColorCommand::maskPreview(const ContextReader& reader)
 {
   if (m_checkPreview->isSelected()) {
@@ -11,7 +11,7 @@
 
 #include "app/app.h"
 #include "app/cmd/add_cel.h"
-#include "app/cmd/replace_image.h"
+#include "app/cmd/set_cel_data.h"
 #include "app/cmd/set_cel_position.h"
 #include "app/cmd/unlink_cel.h"
 #include "app/commands/command.h"
@@ -20,6 +20,7 @@
 #include "app/document_api.h"
 #include "app/modules/gui.h"
 #include "app/transaction.h"
+#include "base/thread_pool.h"
 #include "doc/blend_internals.h"
 #include "doc/cel.h"
 #include "doc/image.h"
@@ -29,6 +30,9 @@
 #include "render/render.h"
 #include "ui/ui.h"
 
+#include <map>
+#include <vector>
+
 namespace app {
 
 class MergeDownLayerCommand : public Command {
@@ -75,84 +79,126 @@ void MergeDownLayerCommand::onExecute(Context* context)
   LayerImage* src_layer = static_cast<LayerImage*>(writer.layer());
   Layer* dst_layer = src_layer->getPrevious();
 
+  // Each pair of source/destination cel data is merged only once,
+  // the other frames with the same pair are linked to the first one.
+  struct Merge {
+    std::shared_ptr<Cel> src_cel;
+    std::shared_ptr<Cel> dst_cel;
+    ImageRef src_image;
+    ImageRef dst_image;
+    gfx::Rect bounds;
+    ImageRef new_image;
+    int first;                  // Index of the first merge of the same pair
+  };
+  std::vector<Merge> merges;
+  std::map<std::pair<ObjectId, ObjectId>, int> pairs;
+
   for (frame_t frpos = 0; frpos<sprite->totalFrames(); ++frpos) {
-    // Get frames
-    auto src_cel = src_layer->cel(frpos);
-    auto dst_cel = dst_layer->cel(frpos);
+    Merge merge;
+    merge.src_cel = src_layer->cel(frpos);
+    merge.dst_cel = dst_layer->cel(frpos);
+    if (!merge.src_cel || !merge.src_cel->image())
+      continue;
+
+    merge.src_image = merge.src_cel->imageRef();
+    if (merge.dst_cel) {
+      merge.dst_image = merge.dst_cel->imageRef();
+
+      // Merge down in the background layer
+      if (dst_layer->isBackground())
+        merge.bounds = sprite->bounds();
+      // Merge down in a transparent layer
+      else
+        merge.bounds = merge.src_cel->bounds().createUnion(merge.dst_cel->bounds());
+    }
 
-    // Get images
-    Image* src_image;
-    if (src_cel != NULL)
-      src_image = src_cel->image();
-    else
-      src_image = NULL;
+    auto key = std::make_pair(merge.src_cel->data()->id(),
+                              merge.dst_cel ? merge.dst_cel->data()->id(): NullId);
+    auto it = pairs.find(key);
+    if (it == pairs.end())
+      it = pairs.insert(std::make_pair(key, int(merges.size()))).first;
+    merge.first = it->second;
+    merges.push_back(merge);
+  }
 
-    ImageRef dst_image;
-    if (dst_cel)
-      dst_image = dst_cel->imageRef();
+  // Merge the images in parallel
+  const doc::color_t bgcolor = app_get_color_to_clear_layer(dst_layer);
+  base::thread_pool::instance().parallel_for(
+    int(merges.size()),
+    [&](int i) {
+      Merge& merge = merges[i];
+      if (merge.first != i)
+        return;
+
+      // No destination image, copy the source image (only a
+      // transparent layer can have a null cel)
+      if (!merge.dst_image) {
+        merge.new_image.reset(Image::createCopy(merge.src_image.get()));
+        return;
+      }
 
-    // With source image?
-    if (src_image) {
+      merge.new_image.reset(doc::crop_image(
+          merge.dst_image.get(),
+          merge.bounds.x-merge.dst_cel->x(),
+          merge.bounds.y-merge.dst_cel->y(),
+          merge.bounds.w, merge.bounds.h, bgcolor));
+
+      // Merge src_image in new_image
       int t;
-      int opacity;
-      opacity = MUL_UN8(src_cel->opacity(), src_layer->opacity(), t);
+      render::composite_image(
+        merge.new_image.get(), merge.src_image.get(),
+        sprite->palette(merge.src_cel->frame()),
+        merge.src_cel->x()-merge.bounds.x,
+        merge.src_cel->y()-merge.bounds.y,
+        MUL_UN8(merge.src_cel->opacity(), src_layer->opacity(), t),
+        src_layer->blendMode());
+    });
+
+  std::vector<ImageRef> oldImages, newImages;
+  for (int i=0; i<int(merges.size()); ++i) {
+    Merge& merge = merges[i];
+    const frame_t frpos = merge.src_cel->frame();
+
+    // Same result as a previous frame
+    if (merge.first != i) {
+      const auto& first_cel = merges[merge.first].dst_cel;
+      if (!merge.dst_cel) {
+        auto dst_cel = Cel::createLink(first_cel);
+        dst_cel->setFrame(frpos);
+        transaction.execute(new cmd::AddCel(dst_layer, dst_cel));
+      }
+      else if (merge.dst_cel->dataRef() != first_cel->dataRef())
+        transaction.execute(new cmd::SetCelData(merge.dst_cel, first_cel->dataRef()));
+      continue;
+    }
 
-      // No destination image
-      if (!dst_image) {  // Only a transparent layer can have a null cel
-        // Copy this cel to the destination layer...
+    // No destination image
+    if (!merge.dst_cel) {
+      // Creating a copy of the cell
+      int t;
+      merge.dst_cel = std::make_shared<Cel>(frpos, merge.new_image);
+      merge.dst_cel->setPosition(merge.src_cel->x(), merge.src_cel->y());
+      merge.dst_cel->setOpacity(MUL_UN8(merge.src_cel->opacity(), src_layer->opacity(), t));
 
-        // Creating a copy of the image
-        dst_image.reset(Image::createCopy(src_image));
+      transaction.execute(new cmd::AddCel(dst_layer, merge.dst_cel));
+    }
+    // With destination
+    else {
+      if (merge.dst_cel->links())
+        transaction.execute(new cmd::UnlinkCel(merge.dst_cel));
 
-        // Creating a copy of the cell
-        dst_cel = std::make_shared<Cel>(frpos, dst_image);
-        dst_cel->setPosition(src_cel->x(), src_cel->y());
-        dst_cel->setOpacity(opacity);
+      transaction.execute(new cmd::SetCelPosition(merge.dst_cel,
+          merge.bounds.x, merge.bounds.y));
 
-        transaction.execute(new cmd::AddCel(dst_layer, dst_cel));
-      }
-      // With destination
-      else {
-        gfx::Rect bounds;
-
-        // Merge down in the background layer
-        if (dst_layer->isBackground()) {
-          bounds = sprite->bounds();
-        }
-        // Merge down in a transparent layer
-        else {
-          bounds = src_cel->bounds().createUnion(dst_cel->bounds());
-        }
-
-        doc::color_t bgcolor = app_get_color_to_clear_layer(dst_layer);
-
-        ImageRef new_image(doc::crop_image(
-            dst_image.get(),
-            bounds.x-dst_cel->x(),
-            bounds.y-dst_cel->y(),
-            bounds.w, bounds.h, bgcolor));
-
-        // Merge src_image in new_image
-        render::composite_image(
-          new_image.get(), src_image,
-          sprite->palette(src_cel->frame()),
-          src_cel->x()-bounds.x,
-          src_cel->y()-bounds.y,
-          opacity,
-          src_layer->blendMode());
-
-        transaction.execute(new cmd::SetCelPosition(dst_cel,
-            bounds.x, bounds.y));
-
-        if (dst_cel->links())
-          transaction.execute(new cmd::UnlinkCel(dst_cel));
-
-        transaction.execute(new cmd::ReplaceImage(sprite,
-            dst_cel->imageRef(), new_image));
-      }
+      oldImages.push_back(merge.dst_cel->imageRef());
+      newImages.push_back(merge.new_image);
     }
+    merge.new_image.reset();
   }
 
+  // Only one undo record for all the merged images
+  document->getApi(transaction).replaceImages(sprite, oldImages, newImages);
+
   document->notifyLayerMergedDown(src_layer, dst_layer);
   document->getApi(transaction).removeLayer(src_layer); // src_layer is deleted inside removeLayer()
 
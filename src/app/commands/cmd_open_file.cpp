@@ -19,12 +19,15 @@
 #include "app/job.h"
 #include "app/modules/editors.h"
 #include "app/modules/gui.h"
+#include "app/pref/preferences.h"
 #include "app/recent_files.h"
+#include "app/thumbnail_generator.h"
 #include "app/ui/status_bar.h"
 #include "app/ui_context.h"
 #include "base/bind.h"
 #include "base/path.h"
 #include "base/thread.h"
+#include "doc/documents_observer.h"
 #include "doc/sprite.h"
 #include "ui/ui.h"
 
@@ -62,7 +65,10 @@ public:
     if (isCanceled())
       m_fop->stop();
 
-    waitJob();
+    // The first frame of a progressive load is ready, the job
+    // continues loading the other frames in background.
+    if (!isDetached())
+      waitJob();
   }
 
 private:
@@ -75,12 +81,20 @@ private:
       m_fop->setError("Error loading file:\n%s", e.what());
     }
 
-    if (m_fop->isStop() && m_fop->document())
+    // A detached document is owned by the context
+    if (m_fop->isStop() && m_fop->document() && !isDetached())
       delete m_fop->releaseDocument();
 
     m_fop->done();
   }
 
+  virtual void onMonitoringTick() override {
+    if (m_fop->isFirstFrameLoaded())
+      detachJob();
+
+    Job::onMonitoringTick();
+  }
+
   virtual void ackFileOpProgress(double progress) override {
     jobProgress(progress);
   }
@@ -88,6 +102,79 @@ private:
   FileOp* m_fop;
 };
 
+// Waits the frames of a document that was given to the context with
+// its first frame (FILE_LOAD_PROGRESSIVE), redrawing the document as
+// they are loaded. It's deleted when the document is closed.
+class ProgressiveLoad : public doc::DocumentsObserver {
+public:
+  ProgressiveLoad(Context* context, FileOp* fop, OpenFileJob* job)
+    : m_context(context)
+    , m_document(fop->document())
+    , m_fop(fop)
+    , m_job(job)
+    , m_timer(kRefreshPeriod)
+    , m_progress(0.0)
+  {
+    m_document->setLoading(true);
+    m_context->documents().addObserver(this);
+    m_timer.Tick.connect(&ProgressiveLoad::onTick, this);
+    m_timer.start();
+  }
+
+  ~ProgressiveLoad() {
+    m_context->documents().removeObserver(this);
+  }
+
+private:
+  static const int kRefreshPeriod = 250;
+
+  void onTick() {
+    if (m_fop->progress() != m_progress) {
+      m_progress = m_fop->progress();
+      StatusBar::instance()->setStatusText(
+        0, "Loading %s (%d%%)",
+        base::get_file_name(m_fop->filename()).c_str(),
+        int(100.0 * m_progress));
+
+      m_document->notifyGeneralUpdate();
+    }
+
+    if (m_fop->isDone())
+      finish();
+  }
+
+  void onRemoveDocument(doc::Document* doc) override {
+    if (doc != m_document)
+      return;
+
+    m_fop->stop();
+    finish();
+    delete this;
+  }
+
+  void finish() {
+    if (!m_job)
+      return;
+
+    m_timer.stop();
+    m_job->waitJob();
+    m_job.reset();
+
+    m_document->setLoading(false);
+    m_document->notifyGeneralUpdate();
+
+    if (m_fop->hasError() && !m_fop->isStop())
+      Console().printf(m_fop->error().c_str());
+  }
+
+  Context* m_context;
+  Document* m_document;
+  std::unique_ptr<FileOp> m_fop;
+  std::unique_ptr<OpenFileJob> m_job;
+  ui::Timer m_timer;
+  double m_progress;
+};
+
 OpenFileCommand::OpenFileCommand()
   : Command("OpenFile",
             "Open Sprite",
@@ -119,9 +206,16 @@ void OpenFileCommand::onExecute(Context* context)
   }
 
   if (!m_filename.empty()) {
+    int flags = FILE_LOAD_SEQUENCE_ASK;
+    if (context->isUIAvailable() &&
+        Preferences::instance().general.progressiveLoad())
+      flags |= FILE_LOAD_PROGRESSIVE;
+    if (Preferences::instance().experimental.compressedCels())
+      flags |= FILE_LOAD_COMPRESSED_CELS;
+
     std::unique_ptr<FileOp> fop(
       FileOp::createLoadDocumentOperation(
-        context, m_filename.c_str(), FILE_LOAD_SEQUENCE_ASK));
+        context, m_filename.c_str(), flags));
     bool unrecent = false;
 
     if (fop) {
@@ -130,22 +224,56 @@ void OpenFileCommand::onExecute(Context* context)
         unrecent = true;
       }
       else {
-        OpenFileJob task(fop.get());
-        task.showProgressWindow();
+        std::unique_ptr<OpenFileJob> task(new OpenFileJob(fop.get()));
+        task->showProgressWindow();
 
         // Post-load processing, it is called from the GUI because may require user intervention.
-        fop->postLoad();
+        if (task->isDetached()) {
+          // The document is still being modified by the job thread
+          Document* document = fop->document();
+          while (!document->lock(Document::WriteLock, 100))
+            ;
+          fop->postLoad();
+          document->unlock();
+
+          // The format has rejected the document
+          if (fop->isStop()) {
+            task->waitJob();
+            delete fop->releaseDocument();
+          }
+        }
+        else {
+          fop->postLoad();
 
-        // Show any error
-        if (fop->hasError())
-          console.printf(fop->error().c_str());
+          // Show any error
+          if (fop->hasError())
+            console.printf(fop->error().c_str());
+        }
 
         Document* document = fop->document();
         if (document) {
-          if (context->isUIAvailable())
+          if (context->isUIAvailable()) {
+            // Documents still being loaded don't have all their layers
+            ThumbnailGenerator* thumbnails = ThumbnailGenerator::instance();
+            if (!task->isDetached() &&
+                !thumbnails->hasCachedThumbnail(document->filename()))
+              thumbnails->saveDocumentThumbnail(document);
+
             App::instance()->recentFiles()->addRecentFile(fop->filename().c_str());
+          }
+
+          if (task->isDetached()) {
+            // The new views read the document while it's locked
+            while (!document->lock(Document::ReadLock, 100))
+              ;
+            document->setContext(context);
+            document->unlock();
 
-          document->setContext(context);
+            // Deletes itself when the document is closed
+            new ProgressiveLoad(context, fop.release(), task.release());
+          }
+          else
+            document->setContext(context);
         }
         else if (!fop->isStop())
           unrecent = true;
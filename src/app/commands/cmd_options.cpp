@@ -13,6 +13,7 @@
 #include "app/modules/i18n.h"
 #include "app/commands/command.h"
 #include "app/context.h"
+#include "app/image_swap_manager.h"
 #include "app/ini_file.h"
 #include "app/launcher.h"
 #include "app/pref/preferences.h"
@@ -120,6 +121,13 @@ public:
     if (m_pref.general.showFullPath())
       showFullPath()->setSelected(true);
 
+    fastSave()->setSelected(m_pref.general.fastSave());
+    incrementalSave()->setSelected(m_pref.general.incrementalSave());
+    showPngOptions()->setSelected(m_pref.general.showPngOptions());
+    fastDataRecovery()->setSelected(m_pref.general.fastDataRecovery());
+    fastClipboard()->setSelected(m_pref.general.fastClipboard());
+    progressiveLoad()->setSelected(m_pref.general.progressiveLoad());
+
     dataRecoveryPeriod()->setSelectedItemIndex(
       dataRecoveryPeriod()->findItemIndexByValue(
         base::convert_to<std::string>(m_pref.general.dataRecoveryPeriod())));
@@ -145,6 +153,14 @@ public:
     if (m_pref.experimental.flashLayer())
       flashLayer()->setSelected(true);
 
+    if (m_pref.experimental.parallelRender())
+      parallelRender()->setSelected(true);
+
+    imageMemoryBudget()->setTextf("%d", m_pref.experimental.imageMemoryBudget());
+
+    if (m_pref.experimental.compressedCels())
+      compressedCels()->setSelected(true);
+
     if (m_pref.editor.showScrollbars())
       showScrollbars()->setSelected(true);
 
@@ -222,6 +238,8 @@ public:
     undoSizeLimit()->setTextf("%d", m_pref.undo.sizeLimit());
     undoGotoModified()->setSelected(m_pref.undo.gotoModified());
     undoAllowNonlinearHistory()->setSelected(m_pref.undo.allowNonlinearHistory());
+    undoSwapOldStates()->setSelected(m_pref.undo.swapOldStates());
+    undoCoalesceStrokes()->setSelected(m_pref.undo.coalesceStrokes());
 
     // Theme buttons
     themeList()->Change.connect(base::Bind<void>(&OptionsWindow::onThemeChange, this));
@@ -258,6 +276,12 @@ public:
     m_pref.general.autoshowTimeline(autotimeline()->isSelected());
     m_pref.general.rewindOnStop(rewindOnStop()->isSelected());
     m_pref.general.showFullPath(showFullPath()->isSelected());
+    m_pref.general.fastSave(fastSave()->isSelected());
+    m_pref.general.incrementalSave(incrementalSave()->isSelected());
+    m_pref.general.showPngOptions(showPngOptions()->isSelected());
+    m_pref.general.fastDataRecovery(fastDataRecovery()->isSelected());
+    m_pref.general.fastClipboard(fastClipboard()->isSelected());
+    m_pref.general.progressiveLoad(progressiveLoad()->isSelected());
 
     bool expandOnMouseover = expandMenubarOnMouseover()->isSelected();
     m_pref.general.expandMenubarOnMouseover(expandOnMouseover);
@@ -305,11 +329,18 @@ public:
     m_pref.undo.sizeLimit(undo_size_limit_value);
     m_pref.undo.gotoModified(undoGotoModified()->isSelected());
     m_pref.undo.allowNonlinearHistory(undoAllowNonlinearHistory()->isSelected());
+    m_pref.undo.swapOldStates(undoSwapOldStates()->isSelected());
+    m_pref.undo.coalesceStrokes(undoCoalesceStrokes()->isSelected());
 
     // Experimental features
     m_pref.experimental.useNativeCursor(nativeCursor()->isSelected());
     m_pref.experimental.useNativeFileDialog(nativeFileDialog()->isSelected());
     m_pref.experimental.flashLayer(flashLayer()->isSelected());
+    m_pref.experimental.parallelRender(parallelRender()->isSelected());
+    m_pref.experimental.imageMemoryBudget(
+      MID(0, imageMemoryBudget()->textInt(), 999999));
+    ImageSwapManager::setMemoryBudget(m_pref.experimental.imageMemoryBudget());
+    m_pref.experimental.compressedCels(compressedCels()->isSelected());
     ui::set_use_native_cursors(
       m_pref.experimental.useNativeCursor());
 
@@ -0,0 +1,78 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/commands/command.h"
+#include "app/console.h"
+#include "app/file_selector.h"
+#include "app/tools/stroke_recording.h"
+#include "app/ui/status_bar.h"
+
+#include <memory>
+
+namespace app {
+
+// Starts recording the strokes painted by the user, and when it's
+// executed again, saves them in a file (that can be replayed with
+// the ReplayStrokes command or the --replay-strokes option).
+class RecordStrokesCommand : public Command {
+public:
+  RecordStrokesCommand();
+  Command* clone() const override { return new RecordStrokesCommand(*this); }
+
+protected:
+  bool onChecked(Context* context) override;
+  void onExecute(Context* context) override;
+};
+
+RecordStrokesCommand::RecordStrokesCommand()
+  : Command("RecordStrokes",
+            "Record Strokes",
+            CmdUIOnlyFlag)
+{
+}
+
+bool RecordStrokesCommand::onChecked(Context* context)
+{
+  return (tools::StrokeRecording::active() != nullptr);
+}
+
+void RecordStrokesCommand::onExecute(Context* context)
+{
+  if (!tools::StrokeRecording::active()) {
+    tools::StrokeRecording::setActive(new tools::StrokeRecording);
+    StatusBar::instance()->showTip(1000, "Recording strokes");
+    return;
+  }
+
+  std::unique_ptr<tools::StrokeRecording> recording(tools::StrokeRecording::active());
+  tools::StrokeRecording::setActive(nullptr);
+  if (recording->empty())
+    return;
+
+  std::string filename = app::show_file_selector(
+    "Save Strokes", "strokes.txt", "txt", FileSelectorType::Save);
+  if (filename.empty())
+    return;
+
+  try {
+    recording->save(filename);
+  }
+  catch (const std::exception& e) {
+    Console::showException(e);
+  }
+}
+
+Command* CommandFactory::createRecordStrokesCommand()
+{
+  return new RecordStrokesCommand;
+}
+
+} // namespace app
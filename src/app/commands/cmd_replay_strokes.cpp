@@ -0,0 +1,143 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/app.h"
+#include "app/color.h"
+#include "app/commands/command.h"
+#include "app/console.h"
+#include "app/context.h"
+#include "app/file_selector.h"
+#include "app/modules/editors.h"
+#include "app/pref/preferences.h"
+#include "app/tools/stroke_recording.h"
+#include "app/tools/tool.h"
+#include "app/tools/tool_box.h"
+#include "app/tools/tool_loop.h"
+#include "app/tools/tool_loop_manager.h"
+#include "app/ui/color_bar.h"
+#include "app/ui/context_bar.h"
+#include "app/ui/editor/editor.h"
+#include "app/ui/editor/tool_loop_impl.h"
+#include "app/ui/toolbar.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+
+#include <memory>
+#include <sstream>
+
+namespace app {
+
+// Replays the strokes of a file saved with the RecordStrokes command
+// in the active editor (with the same tool, brush, and colors), and
+// shows the time spent in each step of the tool loop.
+class ReplayStrokesCommand : public Command {
+public:
+  ReplayStrokesCommand();
+  Command* clone() const override { return new ReplayStrokesCommand(*this); }
+
+protected:
+  bool onEnabled(Context* context) override;
+  void onExecute(Context* context) override;
+};
+
+ReplayStrokesCommand::ReplayStrokesCommand()
+  : Command("ReplayStrokes",
+            "Replay Strokes",
+            CmdUIOnlyFlag)
+{
+}
+
+bool ReplayStrokesCommand::onEnabled(Context* context)
+{
+  return (current_editor &&
+          context->checkFlags(ContextFlags::ActiveDocumentIsWritable |
+                              ContextFlags::HasActiveLayer));
+}
+
+void ReplayStrokesCommand::onExecute(Context* context)
+{
+  std::string filename = app::show_file_selector(
+    "Replay Strokes", "", "txt", FileSelectorType::Open);
+  if (filename.empty())
+    return;
+
+  tools::StrokeRecording recording;
+  try {
+    recording.load(filename);
+  }
+  catch (const std::exception& e) {
+    Console::showException(e);
+    return;
+  }
+
+  Editor* editor = current_editor;
+  const PixelFormat pixelFormat = editor->sprite()->pixelFormat();
+  std::vector<std::vector<tools::ToolLoopManager::StepTimes>> steps;
+
+  for (const auto& stroke : recording.strokes()) {
+    steps.push_back(std::vector<tools::ToolLoopManager::StepTimes>());
+
+    tools::Tool* tool = App::instance()->toolBox()->getToolById(stroke.toolId);
+    if (!tool)
+      continue;
+
+    // Use the settings of the recorded stroke
+    ToolBar::instance()->selectTool(tool);
+    auto& toolPref = Preferences::instance().tool(tool);
+    toolPref.ink(stroke.inkType);
+    toolPref.opacity(stroke.opacity);
+    toolPref.tolerance(stroke.tolerance);
+    toolPref.contiguous(stroke.contiguous);
+    toolPref.filled(stroke.filled);
+    toolPref.brush.type(static_cast<app::gen::BrushType>(stroke.brushType));
+    toolPref.brush.size(stroke.brushSize);
+    toolPref.brush.angle(stroke.brushAngle);
+    App::instance()->contextBar()->discardActiveBrush();
+    ColorBar::instance()->setFgColor(app::Color::fromImage(pixelFormat, stroke.primaryColor));
+    ColorBar::instance()->setBgColor(app::Color::fromImage(pixelFormat, stroke.secondaryColor));
+
+    std::unique_ptr<tools::ToolLoop> toolLoop(create_tool_loop(editor, context));
+    if (!toolLoop)
+      break;
+
+    // Show the trace in the editor like the DrawingState does
+    editor->renderEngine().setPreviewImage(
+      toolLoop->getLayer(),
+      toolLoop->getFrame(),
+      toolLoop->getDstImage(),
+      toolLoop->getCelOrigin(),
+      (toolLoop->getLayer() &&
+       toolLoop->getLayer()->isImage() ?
+       static_cast<LayerImage*>(toolLoop->getLayer())->blendMode():
+       BlendMode::NEG_BW));
+    {
+      tools::ToolLoopManager manager(toolLoop.get());
+      manager.setStepTimes(&steps.back());
+      tools::replay_stroke(stroke, manager);
+    }
+    editor->renderEngine().removePreviewImage();
+    toolLoop->dispose();
+  }
+
+  editor->invalidate();
+
+  std::ostringstream report;
+  tools::write_replay_report(report, recording, steps);
+  Console console;
+  console.printf("%s", report.str().c_str());
+}
+
+Command* CommandFactory::createReplayStrokesCommand()
+{
+  return new ReplayStrokesCommand;
+}
+
+} // namespace app
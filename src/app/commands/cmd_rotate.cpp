@@ -24,6 +24,7 @@
 #include "app/ui/editor/editor.h"
 #include "app/ui/timeline.h"
 #include "app/ui/toolbar.h"
+#include "app/util/cel_batch.h"
 #include "app/util/range_utils.h"
 #include "base/convert_to.h"
 #include "doc/cel.h"
@@ -89,27 +90,22 @@ protected:
       }
     }
 
-    // 2) Rotate images
-    int i = 0;
-    for (auto cel : m_cels) {
-      Image* image = cel->image();
-      if (image) {
-        ImageRef new_image(Image::create(image->pixelFormat(),
-            m_angle == 180 ? image->width(): image->height(),
-            m_angle == 180 ? image->height(): image->width()));
-        new_image->setMaskColor(image->maskColor());
-
-        doc::rotate_image(image, new_image.get(), m_angle);
-        api.replaceImage(m_sprite, cel->imageRef(), new_image);
-      }
-
-      jobProgress((float)i / m_cels.size());
-      ++i;
-
-      // cancel all the operation?
-      if (isCanceled())
-        return;        // Transaction destructor will undo all operations
-    }
+    // 2) Rotate images (in parallel, and replaced with one undoable
+    // command)
+    if (!replace_cel_images(
+          api, m_sprite, m_cels,
+          [this](const Cel* cel) {
+            const Image* image = cel->image();
+            ImageRef new_image(Image::create(image->pixelFormat(),
+                m_angle == 180 ? image->width(): image->height(),
+                m_angle == 180 ? image->height(): image->width()));
+            new_image->setMaskColor(image->maskColor());
+
+            doc::rotate_image(image, new_image.get(), m_angle);
+            return new_image;
+          },
+          this))
+      return;        // Transaction destructor will undo all operations
 
     // rotate mask
     if (m_document->isMaskVisible()) {
@@ -213,7 +209,7 @@ void RotateCommand::onExecute(Context* context)
     }
     // Flip the whole sprite
     else if (site.sprite()) {
-      for (auto cel : site.sprite()->uniqueCels())
+      for (const auto& cel : site.sprite()->uniqueCels())
         cels.push_back(cel);
 
       rotateSprite = true;
@@ -17,22 +17,28 @@
 #include "app/commands/params.h"
 #include "app/console.h"
 #include "app/context_access.h"
+#include "app/document_undo.h"
 #include "app/file/file.h"
 #include "app/file_selector.h"
 #include "app/job.h"
 #include "app/modules/gui.h"
 #include "app/pref/preferences.h"
 #include "app/recent_files.h"
+#include "app/thumbnail_generator.h"
 #include "app/ui/status_bar.h"
 #include "base/bind.h"
 #include "base/convert_to.h"
 #include "base/fs.h"
 #include "base/path.h"
 #include "base/thread.h"
+#include "doc/documents_observer.h"
 #include "doc/sprite.h"
 #include "ui/ui.h"
 
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include <vector>
 
 namespace app {
 
@@ -126,6 +132,11 @@ static bool save_document_in_background(const Context* context,
   }
 
   if (context->isUIAvailable()) {
+    // The thumbnail is cached before adding the recent file, so the
+    // recent files list shows it
+    ThumbnailGenerator::instance()->saveDocumentThumbnail(
+      const_cast<Document*>(document));
+
     App::instance()->recentFiles()->addRecentFile(document->filename().c_str());
     if (mark_as_saved)
       const_cast<Document*>(document)->markAsSaved();
@@ -137,10 +148,198 @@ static bool save_document_in_background(const Context* context,
   return true;
 }
 
+// Saves a copy of the document in a background thread, so the user
+// can continue editing the original document in the meantime. The
+// progress is shown in the status bar, and the original document is
+// marked as saved when the file is completely written (only if it
+// wasn't modified after the copy was taken).
+class BackgroundSave : public doc::DocumentsObserver {
+public:
+  BackgroundSave(Context* context, Document* document,
+                 Document* snapshot, FileOp* fop)
+    : m_context(context)
+    , m_document(document)
+    , m_snapshot(snapshot)
+    , m_fop(fop)
+    , m_modifications(document->undoHistory()->modifications())
+    , m_timer(kRefreshPeriod)
+    , m_progress(0.0)
+  {
+    saves().push_back(this);
+    m_context->documents().addObserver(this);
+    m_timer.Tick.connect(&BackgroundSave::onTick, this);
+    m_timer.start();
+
+    m_thread = std::thread(
+      [this]{
+        try {
+          m_fop->operate();
+        }
+        catch (const std::exception& e) {
+          m_fop->setError("Error saving file:\n%s", e.what());
+        }
+        m_fop->done();
+      });
+  }
+
+  ~BackgroundSave() {
+    ASSERT(!m_thread.joinable());
+    auto& list = saves();
+    list.erase(std::find(list.begin(), list.end(), this));
+  }
+
+  // Waits the save of the given document (if there is one in
+  // progress) and updates its saved state. It deletes the finished
+  // saves too (they cannot be deleted from their own timer tick).
+  static void wait(Document* document) {
+    const std::vector<BackgroundSave*> list = saves();
+    for (BackgroundSave* save : list) {
+      if (!save->isFinished() &&
+          save->m_document &&
+          save->m_document == document) {
+        while (!document->lock(Document::WriteLock, 100))
+          ;
+        save->finish();
+        document->unlock();
+      }
+      if (save->isFinished())
+        delete save;
+    }
+  }
+
+private:
+  static const int kRefreshPeriod = 250;
+
+  static std::vector<BackgroundSave*>& saves() {
+    static std::vector<BackgroundSave*> list;
+    return list;
+  }
+
+  bool isFinished() const {
+    return !m_thread.joinable();
+  }
+
+  void onTick() {
+    if (m_fop->progress() != m_progress) {
+      m_progress = m_fop->progress();
+      StatusBar::instance()->setStatusText(
+        0, "Saving %s (%d%%)",
+        base::get_file_name(m_fop->filename()).c_str(),
+        int(100.0 * m_progress));
+    }
+
+    // The document is updated when nobody is using it (e.g. not in
+    // the middle of a stroke), in other case we try in the next tick.
+    if (m_fop->isDone() &&
+        m_document->lock(Document::WriteLock, 0)) {
+      finish();
+      m_document->unlock();
+    }
+  }
+
+  void onRemoveDocument(doc::Document* doc) override {
+    if (doc != m_document)
+      return;
+
+    // The file is completed anyway, a save cannot be stopped in the
+    // middle of the file.
+    m_document = nullptr;
+    finish();
+  }
+
+  // The document must be locked by the caller.
+  void finish() {
+    if (isFinished())
+      return;
+
+    m_timer.stop();
+    m_thread.join();
+    m_context->documents().removeObserver(this);
+
+    if (m_fop->hasError()) {
+      Console console;
+      console.printf(m_fop->error().c_str());
+
+      // We don't know if the file was saved correctly or not. So
+      // mark it as it should be saved again.
+      if (m_document)
+        m_document->impossibleToBackToSavedState();
+    }
+    else if (m_document) {
+      // The file contains the document as it was when the snapshot
+      // was taken.
+      if (m_document->undoHistory()->modifications() == m_modifications)
+        m_document->markAsSaved();
+      else
+        m_document->impossibleToBackToSavedState();
+
+      // The file index of the snapshot refers to the objects of the
+      // snapshot, so the next save of the document cannot use it.
+      m_document->setFileIndex(nullptr);
+      m_document->setFormatOptions(m_snapshot->getFormatOptions());
+
+      // The thumbnail is cached before adding the recent file, so the
+      // recent files list shows it
+      ThumbnailGenerator::instance()->saveDocumentThumbnail(m_snapshot.get());
+
+      App::instance()->recentFiles()->addRecentFile(m_snapshot->filename().c_str());
+      StatusBar::instance()
+        ->setStatusText(2000, "File %s, saved.",
+                        m_snapshot->name().c_str());
+    }
+
+    m_fop.reset();
+    m_snapshot.reset();
+  }
+
+  Context* m_context;
+  Document* m_document;
+  std::unique_ptr<Document> m_snapshot;
+  std::unique_ptr<FileOp> m_fop;
+  int m_modifications;
+  std::thread m_thread;
+  ui::Timer m_timer;
+  double m_progress;
+};
+
+// Saves a copy of the document taken under a brief read lock, so
+// editing can continue while the file is encoded and written.
+static void save_document_snapshot_in_background(Context* context,
+                                                 Document* document,
+                                                 const std::string& fn_format)
+{
+  std::unique_ptr<Document> snapshot;
+  {
+    ContextReader reader(context);
+    snapshot.reset(document->duplicate(DuplicateExactCopy));
+    snapshot->sprite()->setTransparentColor(
+      document->sprite()->transparentColor());
+  }
+  snapshot->setFilename(document->filename());
+  snapshot->setFormatOptions(document->getFormatOptions());
+
+  std::unique_ptr<FileOp> fop(
+    FileOp::createSaveDocumentOperation(
+      context, snapshot.get(),
+      snapshot->filename().c_str(), fn_format.c_str()));
+  if (!fop)
+    return;
+
+  // It's deleted by the next wait_background_save() call after the
+  // save is finished
+  new BackgroundSave(context, document, snapshot.release(), fop.release());
+}
+
+void wait_background_save(Document* document)
+{
+  BackgroundSave::wait(document);
+}
+
 //////////////////////////////////////////////////////////////////////
 
 SaveFileBaseCommand::SaveFileBaseCommand(const char* short_name, const char* friendly_name, CommandFlags flags)
   : Command(short_name, friendly_name, flags)
+  , m_background(true)
 {
 }
 
@@ -148,13 +347,18 @@ void SaveFileBaseCommand::onLoadParams(const Params& params)
 {
   m_filename = params.get("filename");
   m_filenameFormat = params.get("filename-format");
+
+  // Saves the file in background (only used by "SaveFile" when the
+  // document is already associated to a file)
+  m_background = (params.get("background") != "false");
 }
 
 // Returns true if there is a current sprite to save.
 // [main thread]
 bool SaveFileBaseCommand::onEnabled(Context* context)
 {
-  return context->checkFlags(ContextFlags::ActiveDocumentIsWritable);
+  return (context->checkFlags(ContextFlags::ActiveDocumentIsWritable) &&
+          !context->activeDocument()->isLoading());
 }
 
 bool SaveFileBaseCommand::saveAsDialog(Context* context,
@@ -164,6 +368,9 @@ bool SaveFileBaseCommand::saveAsDialog(Context* context,
   const Document* document = context->activeDocument();
   std::string filename;
 
+  // Only one save of the same document at the same time
+  wait_background_save(const_cast<Document*>(document));
+
   // If there is a delegate, we're doing a "Save Copy As", so we don't
   // have to mark the file as saved.
   bool saveCopyAs = (delegate != nullptr);
@@ -277,6 +484,15 @@ void SaveFileCommand::onExecute(Context* context)
   // If the document is associated to a file in the file-system, we can
   // save it directly without user interaction.
   if (document->isAssociatedToFile()) {
+    // Only one save of the same document at the same time
+    wait_background_save(document);
+
+    if (m_background && context->isUIAvailable()) {
+      save_document_snapshot_in_background(
+        context, document, m_filenameFormat);
+      return;
+    }
+
     ContextWriter writer(context);
     Document* documentWriter = writer.document();
 
@@ -12,8 +12,13 @@
 #include <string>
 
 namespace app {
+  class Document;
   class FileSelectorDelegate;
 
+  // Waits the background save of the given document (if there is
+  // one in progress) and updates its saved state. [main thread]
+  void wait_background_save(Document* document);
+
   class SaveFileBaseCommand : public Command {
   public:
     SaveFileBaseCommand(const char* shortName, const char* friendlyName, CommandFlags flags);
@@ -32,6 +37,7 @@ namespace app {
     std::string m_filename;
     std::string m_filenameFormat;
     std::string m_selectedFilename;
+    bool m_background;
   };
 
 } // namespace app
@@ -13,6 +13,7 @@
 #include "app/commands/command.h"
 #include "app/context_access.h"
 #include "app/document_api.h"
+#include "app/document_undo.h"
 #include "app/modules/gui.h"
 #include "app/ui/color_button.h"
 #include "app/transaction.h"
@@ -21,6 +22,7 @@
 #include "doc/image.h"
 #include "doc/palette.h"
 #include "doc/sprite.h"
+#include "doc/sprite_memory.h"
 #include "ui/ui.h"
 
 #include "sprite_properties.xml.h"
@@ -95,10 +97,20 @@ void SpritePropertiesCommand::onExecute(Context* context)
 
     // Sprite size (width and height)
     window.size()->setTextf(
-      "%dx%d (%s)",
+      "%dx%d",
       sprite->width(),
-      sprite->height(),
-      base::get_pretty_memory_size(sprite->getMemSize()).c_str());
+      sprite->height());
+
+    // Memory (linked cels are counted one time)
+    {
+      doc::SpriteMemory mem = doc::calculate_sprite_memory(sprite);
+      std::string text = base::get_pretty_memory_size(mem.total);
+      if (mem.linked > 0)
+        text += " (" + base::get_pretty_memory_size(mem.linked) + " saved by links)";
+      text += ", undo " +
+        base::get_pretty_memory_size(document->undoHistory()->memSize());
+      window.memory()->setText(text);
+    }
 
     // How many frames
     window.frames()->setTextf("%d", (int)sprite->totalFrames());
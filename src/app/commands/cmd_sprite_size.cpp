@@ -21,19 +21,24 @@
 #include "app/modules/palettes.h"
 #include "app/transaction.h"
 #include "base/bind.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/resize_image.h"
 #include "doc/cel.h"
 #include "doc/cels_range.h"
 #include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/mask.h"
+#include "doc/palette.h"
 #include "doc/primitives.h"
+#include "doc/rgbmap.h"
 #include "doc/sprite.h"
 #include "ui/ui.h"
 
 #include "sprite_size.xml.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #define PERC_FORMAT     "%.1f"
 
@@ -76,22 +81,56 @@ protected:
     Transaction transaction(m_writer.context(), "Sprite Size");
     DocumentApi api = m_writer.document()->getApi(transaction);
 
-    int cels_count = 0;
-    for (auto cel : m_sprite->uniqueCels()) { // TODO add size() member function to CelsRange
-      (void)cel;
-      ++cels_count;
+    // Change the location of each cel, and group the images to
+    // resize by palette (the sprite has only one RgbMap, which is
+    // regenerated for each palette).
+    std::vector<Cel*> cels;
+    std::vector<std::pair<const Palette*, std::vector<int>>> groups;
+    for (const auto& cel : m_sprite->uniqueCels()) {
+      api.setCelPosition(m_sprite, cel, scale_x(cel->x()), scale_y(cel->y()));
+
+      if (!cel->image() || cel->link())
+        continue;
+
+      const Palette* palette = m_sprite->palette(cel->frame());
+      auto it = std::find_if(groups.begin(), groups.end(),
+                             [palette](const auto& group) {
+                               return group.first == palette;
+                             });
+      if (it == groups.end()) {
+        groups.emplace_back(palette, std::vector<int>());
+        it = groups.end()-1;
+      }
+      it->second.push_back(int(cels.size()));
+      cels.push_back(cel.get());
     }
 
-    // For each cel...
+    // Resize the images of each group in parallel (in batches to
+    // report the progress and check if the job was canceled)
+    std::vector<ImageRef> newImages(cels.size());
+    const int batchSize = 4*base::thread_pool::instance().concurrency();
     int progress = 0;
-    for (auto cel : m_sprite->uniqueCels()) {
-      // Change its location
-      api.setCelPosition(m_sprite, cel, scale_x(cel->x()), scale_y(cel->y()));
+    for (const auto& group : groups) {
+      const std::vector<int>& indexes = group.second;
+      RgbMap* rgbmap = m_sprite->rgbMap(cels[indexes.front()]->frame());
+
+      // Indexed images are resized through RGB colors which are
+      // mapped again with the RgbMap (it must be calculated to be
+      // used from several threads)
+      bool parallel = true;
+      if (m_sprite->pixelFormat() == IMAGE_INDEXED &&
+          m_resize_method != doc::algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR) {
+        std::size_t pixels = 0;
+        for (int i : indexes)
+          pixels += std::size_t(scale_x(cels[i]->image()->width())) * scale_y(cels[i]->image()->height());
+        if (pixels > std::size_t(rgbmap->size()))
+          rgbmap->calculateAll();
+        parallel = rgbmap->isCalculated();
+      }
 
-      // Get cel's image
-      Image* image = cel->image();
-      if (image && !cel->link()) {
-        // Resize the image
+      auto resizeCel = [&](int j) {
+        Cel* cel = cels[indexes[j]];
+        Image* image = cel->image();
         int w = scale_x(image->width());
         int h = scale_y(image->height());
         ImageRef new_image(Image::create(image->pixelFormat(), MAX(1, w), MAX(1, h)));
@@ -101,21 +140,36 @@ protected:
         doc::algorithm::resize_image(
           image, new_image.get(),
           m_resize_method,
-          m_sprite->palette(cel->frame()),
-          m_sprite->rgbMap(cel->frame()),
+          group.first, rgbmap,
           (cel->layer()->isBackground() ? -1: m_sprite->transparentColor()));
 
-        api.replaceImage(m_sprite, cel->imageRef(), new_image);
+        newImages[indexes[j]] = new_image;
+      };
+
+      for (int begin=0; begin<int(indexes.size()); begin+=batchSize) {
+        const int n = std::min(batchSize, int(indexes.size())-begin);
+        if (parallel)
+          base::thread_pool::instance().parallel_for(
+            n, [&](int j) { resizeCel(begin+j); });
+        else {
+          for (int j=0; j<n; ++j)
+            resizeCel(begin+j);
+        }
+
+        progress += n;
+        jobProgress((float)progress / cels.size());
+
+        // cancel all the operation?
+        if (isCanceled())
+          return;        // Transaction destructor will undo all operations
       }
-
-      jobProgress((float)progress / cels_count);
-      ++progress;
-
-      // cancel all the operation?
-      if (isCanceled())
-        return;        // Transaction destructor will undo all operations
     }
 
+    std::vector<ImageRef> oldImages;
+    for (Cel* cel : cels)
+      oldImages.push_back(cel->imageRef());
+    api.replaceImages(m_sprite, oldImages, newImages);
+
     // Resize mask
     if (m_document->isMaskVisible()) {
       ImageRef old_bitmap
@@ -171,11 +225,15 @@ public:
 
     static_assert(doc::algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR == 0 &&
                   doc::algorithm::RESIZE_METHOD_BILINEAR == 1 &&
-                  doc::algorithm::RESIZE_METHOD_ROTSPRITE == 2,
+                  doc::algorithm::RESIZE_METHOD_ROTSPRITE == 2 &&
+                  doc::algorithm::RESIZE_METHOD_BICUBIC == 3 &&
+                  doc::algorithm::RESIZE_METHOD_LANCZOS == 4,
                   "ResizeMethod enum has changed");
     method()->addItem("Nearest-neighbor");
     method()->addItem("Bilinear");
     method()->addItem("RotSprite");
+    method()->addItem("Bicubic");
+    method()->addItem("Lanczos");
     method()->setSelectedItemIndex(
       get_config_int("SpriteSize", "Method",
                      doc::algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR));
@@ -288,6 +346,10 @@ void SpriteSizeCommand::onLoadParams(const Params& params)
       m_resizeMethod = doc::algorithm::RESIZE_METHOD_BILINEAR;
     else if (resize_method == "rotsprite")
       m_resizeMethod = doc::algorithm::RESIZE_METHOD_ROTSPRITE;
+    else if (resize_method == "bicubic")
+      m_resizeMethod = doc::algorithm::RESIZE_METHOD_BICUBIC;
+    else if (resize_method == "lanczos")
+      m_resizeMethod = doc::algorithm::RESIZE_METHOD_LANCZOS;
     else
       m_resizeMethod = doc::algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR;
   }
@@ -0,0 +1,49 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/commands/command.h"
+#include "app/ui/performance_hud.h"
+
+namespace app {
+
+class TogglePerformanceHudCommand : public Command {
+public:
+  TogglePerformanceHudCommand();
+  Command* clone() const override { return new TogglePerformanceHudCommand(*this); }
+
+protected:
+  bool onChecked(Context* context) override;
+  void onExecute(Context* context) override;
+};
+
+TogglePerformanceHudCommand::TogglePerformanceHudCommand()
+  : Command("TogglePerformanceHud",
+            "Toggle Performance HUD",
+            CmdUIOnlyFlag)
+{
+}
+
+bool TogglePerformanceHudCommand::onChecked(Context* context)
+{
+  return (PerformanceHud::instance() != nullptr);
+}
+
+void TogglePerformanceHudCommand::onExecute(Context* context)
+{
+  PerformanceHud::toggle();
+}
+
+Command* CommandFactory::createTogglePerformanceHudCommand()
+{
+  return new TogglePerformanceHudCommand;
+}
+
+} // namespace app
@@ -10,6 +10,7 @@
 #endif
 
 #include "app/cmd.h"
+#include "app/cmd_stats.h"
 #include "app/commands/command.h"
 #include "app/console.h"
 #include "app/context.h"
@@ -41,9 +42,7 @@ public:
       : ui::ListItem(
           (state ?
            static_cast<Cmd*>(state->cmd())->label()
-#if _DEBUG
            + std::string(" ") + base::get_pretty_memory_size(static_cast<Cmd*>(state->cmd())->memSize())
-#endif
            : std::string("Initial State"))),
         m_state(state) {
     }
@@ -140,6 +139,7 @@ private:
     actions()->layout();
     view()->updateView();
     actions()->selectChild(item);
+    updateStats(history);
   }
 
   void onAfterUndo(DocumentUndo* history) override {
@@ -172,6 +172,7 @@ private:
       return;
 
     clearList();
+    stats()->setText("");
     m_document->undoHistory()->removeObserver(this);
     m_document = nullptr;
   }
@@ -206,6 +207,29 @@ private:
     view()->updateView();
     if (current)
       actions()->selectChild(current);
+    updateStats(history);
+  }
+
+  // Shows the total memory of the history and the Cmd type which
+  // uses most of it (the full table is in the console, /undostats)
+  void updateStats(DocumentUndo* history) {
+    CmdStatsMap map;
+    history->collectStats(map);
+
+    std::size_t total = 0;
+    auto biggest = map.end();
+    for (auto it=map.begin(); it!=map.end(); ++it) {
+      total += it->second.memSize;
+      if (biggest == map.end() || it->second.memSize > biggest->second.memSize)
+        biggest = it;
+    }
+
+    std::string text = "Total: " + base::get_pretty_memory_size(total);
+    if (biggest != map.end())
+      text += " (" + CmdStats::typeName(biggest->first) + ": " +
+        base::get_pretty_memory_size(biggest->second.memSize) + ")";
+    stats()->setText(text);
+    layout();
   }
 
   void selectState(const undo::UndoState* state) {
@@ -32,6 +32,7 @@ FOR_EACH_COMMAND(CopyCel)
 FOR_EACH_COMMAND(CopyMerged)
 FOR_EACH_COMMAND(CropSprite)
 FOR_EACH_COMMAND(Cut)
+FOR_EACH_COMMAND(DeduplicateCels)
 FOR_EACH_COMMAND(DeselectMask)
 FOR_EACH_COMMAND(Despeckle)
 FOR_EACH_COMMAND(DeveloperConsole)
@@ -42,6 +43,7 @@ FOR_EACH_COMMAND(DuplicateView)
 FOR_EACH_COMMAND(Exit)
 FOR_EACH_COMMAND(ExportSpriteSheet)
 FOR_EACH_COMMAND(Eyedropper)
+FOR_EACH_COMMAND(FilterChain)
 FOR_EACH_COMMAND(FlattenLayers)
 FOR_EACH_COMMAND(Flip)
 FOR_EACH_COMMAND(FrameProperties)
@@ -97,6 +99,7 @@ FOR_EACH_COMMAND(Paste)
 FOR_EACH_COMMAND(PasteText)
 FOR_EACH_COMMAND(PixelPerfectMode)
 FOR_EACH_COMMAND(PlayAnimation)
+FOR_EACH_COMMAND(RecordStrokes)
 FOR_EACH_COMMAND(Redo)
 FOR_EACH_COMMAND(Refresh)
 FOR_EACH_COMMAND(RemoveFrame)
@@ -104,6 +107,7 @@ FOR_EACH_COMMAND(RemoveFrameTag)
 FOR_EACH_COMMAND(RemoveLayer)
 FOR_EACH_COMMAND(RepeatLastExport)
 FOR_EACH_COMMAND(ReplaceColor)
+FOR_EACH_COMMAND(ReplayStrokes)
 FOR_EACH_COMMAND(RescanScripts)
 FOR_EACH_COMMAND(ReselectMask)
 FOR_EACH_COMMAND(ReverseFrames)
@@ -140,6 +144,7 @@ FOR_EACH_COMMAND(SymmetryMode)
 FOR_EACH_COMMAND(TiledMode)
 FOR_EACH_COMMAND(Timeline)
 FOR_EACH_COMMAND(ToggleFullscreen)
+FOR_EACH_COMMAND(TogglePerformanceHud)
 FOR_EACH_COMMAND(TogglePreview)
 FOR_EACH_COMMAND(ToggleTouchbar)
 FOR_EACH_COMMAND(Undo)
@@ -0,0 +1,202 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/color.h"
+#include "app/color_utils.h"
+#include "app/commands/command.h"
+#include "app/commands/filters/filter_manager_impl.h"
+#include "app/commands/filters/filter_worker.h"
+#include "app/commands/params.h"
+#include "app/context.h"
+#include "doc/mask.h"
+#include "doc/site.h"
+#include "filters/color_curve.h"
+#include "filters/color_curve_filter.h"
+#include "filters/filter_chain.h"
+#include "filters/invert_color_filter.h"
+#include "filters/replace_color_filter.h"
+
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace app {
+
+using namespace filters;
+
+// Applies several filters in one pass (with one undo step). The
+// filters are given in "filter1", "filter2", etc. parameters (with
+// "invert", "curve" or "replace" values), and the options of each one
+// in "filterN.option" parameters:
+//
+//   filterN.channels=rgbai  Channels to modify (red, green, blue,
+//                           alpha, index)
+//   filterN.points=x,y,...  Points of the "curve" filter
+//   filterN.from=rgb{...}   Colors and tolerance of the "replace"
+//   filterN.to=rgb{...}     filter (see app::Color::fromString())
+//   filterN.tolerance=0
+//
+// The "frames" and "layers" parameters can be "all" to apply the
+// filters to all frames/layers.
+class FilterChainCommand : public Command {
+public:
+  FilterChainCommand();
+  Command* clone() const override { return new FilterChainCommand(*this); }
+
+protected:
+  void onLoadParams(const Params& params) override;
+  bool onEnabled(Context* context) override;
+  void onExecute(Context* context) override;
+
+private:
+  Params m_params;
+};
+
+static Target parse_channels(const std::string& channels)
+{
+  Target target = 0;
+  for (char c : channels) {
+    switch (c) {
+      case 'r': target |= TARGET_RED_CHANNEL; break;
+      case 'g': target |= TARGET_GREEN_CHANNEL; break;
+      case 'b': target |= TARGET_BLUE_CHANNEL; break;
+      case 'a': target |= TARGET_ALPHA_CHANNEL; break;
+      case 'i': target |= TARGET_INDEX_CHANNEL; break;
+    }
+  }
+
+  if ((target & (TARGET_RED_CHANNEL |
+                 TARGET_GREEN_CHANNEL |
+                 TARGET_BLUE_CHANNEL)) != 0) {
+    target |= TARGET_GRAY_CHANNEL;
+  }
+  return target;
+}
+
+FilterChainCommand::FilterChainCommand()
+  : Command("FilterChain",
+            "Filter Chain",
+            CmdRecordableFlag)
+{
+}
+
+void FilterChainCommand::onLoadParams(const Params& params)
+{
+  m_params = params;
+}
+
+bool FilterChainCommand::onEnabled(Context* context)
+{
+  return context->checkFlags(ContextFlags::ActiveDocumentIsWritable |
+                             ContextFlags::HasActiveSprite);
+}
+
+void FilterChainCommand::onExecute(Context* context)
+{
+  Site site = context->activeSite();
+  std::vector<std::unique_ptr<Filter>> filters;
+  std::vector<std::unique_ptr<ColorCurve>> curves;
+  FilterChain chain;
+
+  for (int i=1; ; ++i) {
+    const std::string prefix = "filter" + std::to_string(i);
+    if (!m_params.has_param(prefix.c_str()))
+      break;
+
+    auto option = [this, &prefix](const char* name) -> std::string {
+      return m_params.get((prefix + "." + name).c_str());
+    };
+
+    const std::string& type = m_params.get(prefix.c_str());
+    Target target;
+
+    if (type == "invert") {
+      filters.emplace_back(new InvertColorFilter);
+      target = (TARGET_RED_CHANNEL |
+                TARGET_GREEN_CHANNEL |
+                TARGET_BLUE_CHANNEL |
+                TARGET_GRAY_CHANNEL);
+    }
+    else if (type == "curve") {
+      std::unique_ptr<ColorCurve> curve(new ColorCurve(ColorCurve::Linear));
+      std::istringstream points(option("points"));
+      std::string x, y;
+      while (std::getline(points, x, ',') && std::getline(points, y, ','))
+        curve->addPoint(gfx::Point(std::strtol(x.c_str(), NULL, 10),
+                                   std::strtol(y.c_str(), NULL, 10)));
+      if (curve->begin() == curve->end()) {
+        curve->addPoint(gfx::Point(0, 0));
+        curve->addPoint(gfx::Point(255, 255));
+      }
+
+      ColorCurveFilter* filter = new ColorCurveFilter;
+      filter->setCurve(curve.get());
+      filters.emplace_back(filter);
+      curves.push_back(std::move(curve));
+      target = (TARGET_RED_CHANNEL |
+                TARGET_GREEN_CHANNEL |
+                TARGET_BLUE_CHANNEL |
+                TARGET_GRAY_CHANNEL |
+                TARGET_ALPHA_CHANNEL);
+    }
+    else if (type == "replace") {
+      ReplaceColorFilter* filter = new ReplaceColorFilter;
+      filter->setFrom(color_utils::color_for_layer(
+                        app::Color::fromString(option("from")), site.layer()));
+      filter->setTo(color_utils::color_for_layer(
+                      app::Color::fromString(option("to")), site.layer()));
+      filter->setTolerance(std::strtol(option("tolerance").c_str(), NULL, 10));
+      filters.emplace_back(filter);
+      target = (TARGET_RED_CHANNEL |
+                TARGET_GREEN_CHANNEL |
+                TARGET_BLUE_CHANNEL |
+                TARGET_GRAY_CHANNEL |
+                TARGET_ALPHA_CHANNEL |
+                TARGET_INDEX_CHANNEL);
+    }
+    else {
+      // Unknown filter, nothing is applied
+      return;
+    }
+
+    const std::string channels = option("channels");
+    if (!channels.empty())
+      target = parse_channels(channels);
+
+    chain.addFilter(filters.back().get(), target);
+  }
+
+  if (chain.isEmpty())
+    return;
+
+  Target target = chain.getTarget();
+  if (m_params.get("frames") == "all")
+    target |= TARGET_ALL_FRAMES;
+  if (m_params.get("layers") == "all")
+    target |= TARGET_ALL_LAYERS;
+
+  FilterManagerImpl filterMgr(context, &chain);
+  filterMgr.setTarget(target);
+
+  if (context->isUIAvailable())
+    start_filter_worker(&filterMgr);
+  else
+    filterMgr.applyToTarget();
+}
+
+Command* CommandFactory::createFilterChainCommand()
+{
+  return new FilterChainCommand;
+}
+
+} // namespace app
@@ -176,6 +176,12 @@ void ConvolutionMatrixStock::reloadStock()
       }
     }
   }
+
+  // Gaussian blurs (applied as two 1D convolutions, so even the
+  // biggest ones are fast)
+  for (int radius : { 1, 2, 3, 4, 6, 8, 12, 15 })
+    m_matrices.push_back(
+      base::SharedPtr<ConvolutionMatrix>(ConvolutionMatrix::createGaussianBlur(radius)));
 }
 
 void ConvolutionMatrixStock::cleanStock()
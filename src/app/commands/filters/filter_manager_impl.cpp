@@ -20,12 +20,17 @@
 #include "app/modules/editors.h"
 #include "app/transaction.h"
 #include "app/ui/editor/editor.h"
+#include "base/chrono.h"
+#include "base/thread_pool.h"
+#include "base/trace_span.h"
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/image.h"
 #include "doc/images_collector.h"
 #include "doc/layer.h"
 #include "doc/mask.h"
+#include "doc/primitives.h"
+#include "doc/rgbmap.h"
 #include "doc/site.h"
 #include "doc/sprite.h"
 #include "filters/filter.h"
@@ -33,8 +38,11 @@
 #include "ui/view.h"
 #include "ui/widget.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <set>
 
 namespace app {
@@ -42,6 +50,102 @@ namespace app {
 using namespace std;
 using namespace ui;
 
+namespace {
+
+// Rows of each job when a filter is applied in parallel
+const int kRowsPerBand = 16;
+
+// Interlaced passes of the preview: the first row, the distance
+// between rows, and the number of rows that show each calculated row
+// (it's copied to the rows calculated in the next passes).
+struct PreviewPass {
+  int first, step, fill;
+};
+
+const PreviewPass kPreviewPasses[] = {
+  { 0, 8, 8 },
+  { 4, 8, 4 },
+  { 2, 4, 2 },
+  { 1, 2, 1 },
+};
+
+const int kPreviewPassCount = sizeof(kPreviewPasses) / sizeof(kPreviewPasses[0]);
+
+} // anonymous namespace
+
+// Rows of one cel processed by a thread. It has its own current row
+// and the mask iterator, the rest is taken from the FilterManagerImpl.
+class FilterManagerImpl::Band : public FilterManager {
+public:
+  Band(FilterManagerImpl* mgr, const Image* src, Image* dst, Target target)
+    : m_mgr(mgr)
+    , m_src(src)
+    , m_dst(dst)
+    , m_target(target)
+    , m_row(0) {
+  }
+
+  // Same as FilterManagerImpl::applyStep() for the given row.
+  void applyRow(int row) {
+    const gfx::Rect& bounds = m_mgr->m_bounds;
+    const Mask* mask = m_mgr->m_mask;
+    m_row = row;
+
+    if (mask && mask->bitmap()) {
+      int x = bounds.x - mask->bounds().x;
+      int y = bounds.y - mask->bounds().y + m_row;
+      if ((x >= bounds.w) ||
+          (y >= bounds.h))
+        return;
+
+      m_maskBits = mask->bitmap()
+        ->lockBits<BitmapTraits>(Image::ReadLock,
+          gfx::Rect(x, y, bounds.w - x, bounds.h - y));
+
+      m_maskIterator = m_maskBits.begin();
+    }
+
+    switch (m_mgr->pixelFormat()) {
+      case IMAGE_RGB:       m_mgr->m_filter->applyToRgba(this); break;
+      case IMAGE_GRAYSCALE: m_mgr->m_filter->applyToGrayscale(this); break;
+      case IMAGE_INDEXED:   m_mgr->m_filter->applyToIndexed(this); break;
+    }
+  }
+
+  // FilterManager implementation
+  const void* getSourceAddress() override {
+    return m_src->getPixelAddress(x(), y());
+  }
+  void* getDestinationAddress() override {
+    return m_dst->getPixelAddress(x(), y());
+  }
+  int getWidth() override { return m_mgr->m_bounds.w; }
+  Target getTarget() override { return m_target; }
+  FilterIndexedData* getIndexedData() override { return m_mgr; }
+  bool skipPixel() override {
+    const Mask* mask = m_mgr->m_mask;
+    bool skip = false;
+    if (mask && mask->bitmap()) {
+      if (!*m_maskIterator)
+        skip = true;
+      ++m_maskIterator;
+    }
+    return skip;
+  }
+  const doc::Image* getSourceImage() override { return m_src; }
+  int x() override { return m_mgr->m_bounds.x; }
+  int y() override { return m_mgr->m_bounds.y+m_row; }
+
+private:
+  FilterManagerImpl* m_mgr;
+  const Image* m_src;
+  Image* m_dst;
+  Target m_target;
+  int m_row;
+  doc::ImageBits<doc::BitmapTraits> m_maskBits;
+  doc::ImageBits<doc::BitmapTraits>::iterator m_maskIterator;
+};
+
 FilterManagerImpl::FilterManagerImpl(Context* context, Filter* filter)
   : m_context(context)
   , m_site(context->activeSite())
@@ -51,6 +155,9 @@ FilterManagerImpl::FilterManagerImpl(Context* context, Filter* filter)
   , m_dst(nullptr)
   , m_mask(nullptr)
   , m_previewMask(nullptr)
+  , m_previewPass(kPreviewPassCount)
+  , m_previewRow(0)
+  , m_previewRectangular(false)
   , m_progressDelegate(NULL)
 {
   m_row = 0;
@@ -113,6 +220,9 @@ void FilterManagerImpl::beginForPreview()
 
   m_row = 0;
   m_mask = m_previewMask.get();
+  m_previewPass = 0;
+  m_previewRow = kPreviewPasses[0].first;
+  m_previewDirty = gfx::Rect();
 
   {
     Editor* editor = current_editor;
@@ -135,6 +245,13 @@ void FilterManagerImpl::beginForPreview()
     m_row = -1;
     return;
   }
+
+  m_previewRectangular = m_previewMask->isRectangular();
+
+  // The RgbMap is calculated lazily, so we calculate it before
+  // using it from several threads
+  if (m_filter->isThreadSafe() && pixelFormat() == IMAGE_INDEXED)
+    getRgbMap()->calculateAll();
 }
 
 void FilterManagerImpl::end()
@@ -171,6 +288,78 @@ bool FilterManagerImpl::applyStep()
   return true;
 }
 
+bool FilterManagerImpl::applyPreviewStep(double seconds)
+{
+  if (m_row < 0)
+    return false;
+
+  base::Chrono chrono;
+  base::thread_pool& pool = base::thread_pool::instance();
+  const bool parallel = (m_filter->isThreadSafe() && pool.concurrency() > 1);
+  const int batchSize = (parallel ? 4*pool.concurrency(): 1);
+  std::vector<int> rows;
+
+  while (m_previewPass < kPreviewPassCount) {
+    const PreviewPass& pass = kPreviewPasses[m_previewPass];
+
+    rows.clear();
+    for (; m_previewRow < m_bounds.h && int(rows.size()) < batchSize;
+         m_previewRow += pass.step)
+      rows.push_back(m_previewRow);
+
+    if (rows.empty()) {
+      if (++m_previewPass < kPreviewPassCount)
+        m_previewRow = kPreviewPasses[m_previewPass].first;
+      continue;
+    }
+
+    if (parallel) {
+      pool.parallel_for(
+        int(rows.size()),
+        [&](int i) {
+          Band band(this, m_src.get(), m_dst.get(), m_target);
+          band.applyRow(rows[i]);
+        });
+    }
+    else {
+      m_row = rows.front();
+      applyStep();
+    }
+
+    // Show each row in the next rows until they are calculated
+    for (int row : rows) {
+      const int fill = std::min(pass.fill, m_bounds.h - row);
+      for (int i=1; i<fill; ++i)
+        copyPreviewRow(row, row+i);
+
+      m_previewDirty |= gfx::Rect(m_bounds.x, m_bounds.y+row, m_bounds.w, fill);
+    }
+
+    if (chrono.elapsed() >= seconds)
+      break;
+  }
+
+  return (m_previewPass < kPreviewPassCount);
+}
+
+void FilterManagerImpl::copyPreviewRow(int srcRow, int dstRow)
+{
+  const int srcY = m_bounds.y+srcRow;
+  const int dstY = m_bounds.y+dstRow;
+
+  if (m_previewRectangular) {
+    std::memcpy(m_dst->getPixelAddress(m_bounds.x, dstY),
+                m_dst->getPixelAddress(m_bounds.x, srcY),
+                m_dst->getRowStrideSize(m_bounds.w));
+    return;
+  }
+
+  for (int x=m_bounds.x; x<m_bounds.x2(); ++x) {
+    if (m_mask->containsPoint(x, dstY))
+      put_pixel(m_dst.get(), x, dstY, get_pixel(m_dst.get(), x, srcY));
+  }
+}
+
 void FilterManagerImpl::apply(Transaction& transaction)
 {
   bool cancelled = false;
@@ -202,6 +391,7 @@ void FilterManagerImpl::apply(Transaction& transaction)
 
 void FilterManagerImpl::applyToTarget()
 {
+  TRACE_SPAN("FilterManagerImpl::applyToTarget");
   bool cancelled = false;
 
   ImagesCollector images((m_target & TARGET_ALL_LAYERS ?
@@ -223,6 +413,18 @@ void FilterManagerImpl::applyToTarget()
 
   std::set<ObjectId> visited;
 
+  if (m_filter->isThreadSafe()) {
+    std::vector<std::shared_ptr<Cel>> cels;
+    for (const auto& item : images) {
+      // Avoid applying the filter two times to the same image
+      if (visited.insert(item.image()->id()).second)
+        cels.push_back(item.cel());
+    }
+    applyInParallel(transaction, cels);
+    transaction.commit();
+    return;
+  }
+
   // For each target image
   for (auto it = images.begin();
        it != images.end() && !cancelled;
@@ -246,27 +448,120 @@ void FilterManagerImpl::applyToTarget()
   transaction.commit();
 }
 
+void FilterManagerImpl::applyInParallel(Transaction& transaction,
+                                        const std::vector<std::shared_ptr<Cel>>& cels)
+{
+  if (cels.empty())
+    return;
+
+  // Same bounds/mask for all cels (see init() and begin())
+  init(cels.front());
+  begin();
+  if (m_bounds.isEmpty())
+    return;
+
+  // The RgbMap is calculated lazily, so we calculate it before
+  // using it from several threads
+  if (pixelFormat() == IMAGE_INDEXED)
+    getRgbMap()->calculateAll();
+
+  struct CelJob {
+    std::shared_ptr<Cel> cel;
+    ImageRef src;
+    ImageRef dst;
+    Target target;
+  };
+
+  base::thread_pool& pool = base::thread_pool::instance();
+  const int bands = (m_bounds.h + kRowsPerBand - 1) / kRowsPerBand;
+  const double totalRows = double(cels.size()) * m_bounds.h;
+  std::atomic<int> doneRows(0);
+  std::atomic<bool> cancelled(false);
+  std::mutex progressMutex;
+
+  // Cels are processed in batches to limit the memory used by the
+  // copies of their images
+  const int batchSize = pool.concurrency();
+  std::vector<CelJob> jobs;
+
+  for (std::size_t first=0; first<cels.size() && !cancelled; first+=batchSize) {
+    const int n = int(std::min(cels.size()-first, std::size_t(batchSize)));
+    jobs.resize(n);
+
+    pool.parallel_for(
+      n,
+      [&](int i) {
+        CelJob& job = jobs[i];
+        job.cel = cels[first+i];
+        job.src.reset(
+          crop_image(
+            job.cel->image(),
+            gfx::Rect(m_site.sprite()->bounds()).offset(-job.cel->position()), 0));
+        job.dst.reset(Image::createCopy(job.src.get()));
+
+        // The alpha channel of the background layer can't be modified
+        job.target = m_targetOrig;
+        if (job.cel->layer()->isBackground())
+          job.target &= ~TARGET_ALPHA_CHANNEL;
+      });
+
+    pool.parallel_for(
+      n*bands,
+      [&](int i) {
+        if (cancelled)
+          return;
+
+        CelJob& job = jobs[i / bands];
+        const int row = (i % bands) * kRowsPerBand;
+        const int rows = std::min(kRowsPerBand, m_bounds.h - row);
+
+        Band band(this, job.src.get(), job.dst.get(), job.target);
+        for (int r=row; r<row+rows; ++r)
+          band.applyRow(r);
+
+        const int done = (doneRows += rows);
+        if (m_progressDelegate) {
+          std::lock_guard<std::mutex> lock(progressMutex);
+          m_progressDelegate->reportProgress(float(done / totalRows));
+          if (m_progressDelegate->isCancelled())
+            cancelled = true;
+        }
+      });
+
+    // Cels of a cancelled batch are not patched (some bands could be
+    // incomplete)
+    if (cancelled)
+      break;
+
+    for (CelJob& job : jobs) {
+      gfx::Rect output;
+      if (algorithm::shrink_bounds2(job.src.get(), job.dst.get(),
+                                    m_bounds, output)) {
+        transaction.execute(
+          new cmd::PatchCel(
+            job.cel, job.dst.get(),
+            gfx::Region(output),
+            position()));
+      }
+    }
+    jobs.clear();
+  }
+
+  end();
+}
+
 void FilterManagerImpl::flush()
 {
-  if (m_row >= 0) {
+  if (m_row >= 0 && !m_previewDirty.isEmpty()) {
     Editor* editor = current_editor;
-    gfx::Rect rect(
-      editor->editorToScreen(
-        gfx::Point(
-          m_bounds.x,
-          m_bounds.y+m_row-1)),
-      gfx::Size(
-        editor->zoom().apply(m_bounds.w),
-        (editor->zoom().scale() >= 1 ? editor->zoom().apply(1):
-                                       editor->zoom().remove(1))));
-
-    gfx::Region reg1(rect);
+    gfx::Region reg1(editor->editorToScreen(m_previewDirty));
     gfx::Region reg2;
     editor->getDrawableRegion(reg2, Widget::kCutTopWindows);
     reg1.createIntersection(reg1, reg2);
 
     editor->invalidateRegion(reg1);
   }
+  m_previewDirty = gfx::Rect();
 }
 
 const void* FilterManagerImpl::getSourceAddress()
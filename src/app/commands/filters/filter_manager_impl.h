@@ -18,6 +18,7 @@
 
 #include <cstring>
 #include <memory>
+#include <vector>
 
 namespace doc {
   class Cel;
@@ -81,6 +82,13 @@ namespace app {
     bool applyStep();
     void applyToTarget();
 
+    // Calculates the next rows of the preview (started with
+    // beginForPreview()) for about the given number of seconds. Rows
+    // are calculated in interlaced passes, so the whole visible area
+    // is shown at a reduced resolution first and then refined in the
+    // next calls. Returns false when the preview is complete.
+    bool applyPreviewStep(double seconds);
+
     app::Document* document();
     doc::Sprite* sprite() { return m_site.sprite(); }
     doc::Layer* layer() { return m_site.layer(); }
@@ -88,7 +96,8 @@ namespace app {
     doc::Image* destinationImage() const { return m_dst.get(); }
     gfx::Point position() const { return gfx::Point(0, 0); }
 
-    // Updates the current editor to show the progress of the preview.
+    // Updates the current editor to show the rows of the preview
+    // calculated since the last flush().
     void flush();
 
     // FilterManager implementation
@@ -107,10 +116,18 @@ namespace app {
     doc::RgbMap* getRgbMap() override;
 
   private:
+    class Band;
+
     void init(std::shared_ptr<doc::Cel> cel);
     void apply(Transaction& transaction);
     void applyToCel(Transaction& transaction, std::shared_ptr<doc::Cel> cel);
+    // Applies a thread-safe filter to several cels and bands of rows
+    // at the same time.
+    void applyInParallel(Transaction& transaction,
+                         const std::vector<std::shared_ptr<doc::Cel>>& cels);
     bool updateBounds(doc::Mask* mask);
+    // Copies a row of the preview to a row that isn't calculated yet.
+    void copyPreviewRow(int srcRow, int dstRow);
 
     Context* m_context;
     doc::Site m_site;
@@ -127,6 +144,12 @@ namespace app {
     Target m_targetOrig;          // Original targets
     Target m_target;              // Filtered targets
 
+    // Progressive preview
+    int m_previewPass;            // Current interlaced pass
+    int m_previewRow;             // Next row of the current pass
+    bool m_previewRectangular;    // True if m_previewMask is a rectangle
+    gfx::Rect m_previewDirty;     // Area to update in flush()
+
     // Hooks
     float m_progressBase;
     float m_progressWidth;
@@ -25,6 +25,10 @@ namespace app {
 using namespace ui;
 using namespace filters;
 
+// Time to calculate the preview in each tick of the timer (so the
+// dialog is still responsive when the filter is slow)
+static const double kSecondsPerTick = 0.015;
+
 FilterPreview::FilterPreview(FilterManagerImpl* filterMgr)
   : Widget(kGenericWidget)
   , m_filterMgr(filterMgr)
@@ -83,9 +87,11 @@ bool FilterPreview::onProcessMessage(Message* msg)
 
     case kTimerMessage:
       if (m_filterMgr) {
-        if (m_filterMgr->applyStep())
-          m_filterMgr->flush();
-        else
+        // restartPreview() starts a new preview, so there is nothing
+        // else to cancel when the parameters change
+        bool pending = m_filterMgr->applyPreviewStep(kSecondsPerTick);
+        m_filterMgr->flush();
+        if (!pending)
           m_timer.stop();
       }
       break;
@@ -13,6 +13,7 @@
 
 #include "app/app.h"
 #include "app/crash/session.h"
+#include "app/crash/write_document.h"
 #include "app/document.h"
 #include "app/pref/preferences.h"
 #include "base/bind.h"
@@ -20,6 +21,11 @@
 #include "base/remove_from_container.h"
 #include "base/scoped_lock.h"
 #include "doc/context.h"
+#include "she/system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
 
 namespace app {
 namespace crash {
@@ -43,7 +49,11 @@ BackupObserver::~BackupObserver()
 
 void BackupObserver::stop()
 {
-  m_done = true;
+  {
+    std::lock_guard<std::mutex> lock(m_doneMutex);
+    m_done = true;
+  }
+  m_wakeUp.notify_all();
 }
 
 void BackupObserver::onAddDocument(doc::Document* document)
@@ -73,34 +83,68 @@ void BackupObserver::backgroundThread()
 #endif
 
   int waitUntil = normalPeriod;
-  int seconds = 0;
 
-  while (!m_done) {
-    seconds++;
-    if (seconds >= waitUntil) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_doneMutex);
+      if (m_wakeUp.wait_for(lock, std::chrono::seconds(waitUntil),
+                            [this]{ return m_done; }))
+        break;
+    }
+
+    {
       TRACE("DataRecovery: Start backup process for %d documents\n", m_documents.size());
 
-      base::scoped_lock hold(m_mutex);
       base::Chrono chrono;
       bool somethingLocked = false;
+      bool somethingSaved = false;
 
-      for (app::Document* doc : m_documents) {
-        try {
-          if (doc->needsBackup())
-            m_session->saveDocumentChanges(doc);
+      std::vector<app::Document*> docs;
+      {
+        base::scoped_lock hold(m_mutex);
+        docs = m_documents;
+      }
+
+      for (app::Document* doc : docs) {
+        std::unique_ptr<DocumentSnapshot> snapshot;
+
+        // The document is locked only to copy its changes, the
+        // images are compressed and saved without locking it (and
+        // without locking m_mutex, so documents can be closed)
+        {
+          base::scoped_lock hold(m_mutex);
+          if (std::find(m_documents.begin(), m_documents.end(), doc) == m_documents.end())
+            continue;           // The document was closed
+
+          try {
+            if (doc->needsBackup())
+              snapshot = m_session->takeDocumentSnapshot(doc);
+          }
+          catch (const std::exception&) {
+            TRACE("DataRecovery: Document '%d' is locked\n", doc->id());
+            somethingLocked = true;
+          }
         }
-        catch (const std::exception&) {
-          TRACE("DataRecovery: Document '%d' is locked\n", doc->id());
-          somethingLocked = true;
+
+        if (snapshot) {
+          try {
+            m_session->saveDocumentSnapshot(snapshot.get());
+            somethingSaved = true;
+          }
+          catch (const std::exception& ex) {
+            (void)ex;
+            TRACE("DataRecovery: Error saving document: %s\n", ex.what());
+          }
         }
       }
 
-      seconds = 0;
+      if (somethingSaved)
+        she::instance()->persistUserFiles();
+
       waitUntil = (somethingLocked ? lockedPeriod: normalPeriod);
 
       TRACE("DataRecovery: Backup process done (%.16g)\n", chrono.elapsed());
     }
-    base::this_thread::sleep_for(1.0);
   }
 }
 
@@ -13,6 +13,8 @@
 #include "doc/document_observer.h"
 #include "doc/documents_observer.h"
 
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 
 namespace doc {
@@ -43,7 +45,11 @@ namespace crash {
     base::mutex m_mutex;
     doc::Context* m_ctx;
     std::vector<app::Document*> m_documents;
+    // The thread waits on m_wakeUp until the next backup (or until
+    // stop() is called).
     bool m_done;
+    std::mutex m_doneMutex;
+    std::condition_variable m_wakeUp;
     base::thread m_thread;
   };
 
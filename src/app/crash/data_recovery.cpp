@@ -14,41 +14,56 @@
 #include "app/crash/backup_observer.h"
 #include "app/crash/session.h"
 #include "app/resource_finder.h"
+#include "app/undo_swap.h"
 #include "base/fs.h"
 #include "base/path.h"
 #include "base/time.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
 namespace app {
 namespace crash {
 
+// Sessions found by the background task (shared with the task, so it
+// can finish after the DataRecovery is deleted).
+struct DataRecovery::Discovery {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;
+  Sessions sessions;
+};
+
 DataRecovery::DataRecovery(doc::Context* ctx)
-  : m_inProgress(nullptr)
+  : m_hasRecoverableSessions(false)
+  , m_discovery(std::make_shared<Discovery>())
+  , m_inProgress(nullptr)
   , m_backup(nullptr)
 {
   ResourceFinder rf;
   rf.includeUserDir(base::join_path("sessions", ".").c_str());
   std::string sessionsDir = rf.getFirstOrCreateDefault();
 
-  // Existent sessions
+  // Existent sessions (the newest ones first, the names start with
+  // the date)
   TRACE("DataRecovery: Listing sessions from '%s'\n", sessionsDir.c_str());
-  for (auto& itemname : base::list_files(sessionsDir)) {
+  std::vector<std::string> itemnames = base::list_files(sessionsDir);
+  std::sort(itemnames.begin(), itemnames.end(), std::greater<std::string>());
+
+  // Just look for the first session to recover here, the complete
+  // list is created in background (reading the pid of each
+  // session and deleting the empty ones is too slow when there are
+  // lots of them).
+  for (auto& itemname : itemnames) {
     std::string itempath = base::join_path(sessionsDir, itemname);
     if (base::is_directory(itempath)) {
-      TRACE("- Session '%s' ", itempath.c_str());
-
-      SessionPtr session(new Session(itempath));
-      if (!session->isRunning()) {
-        if (!session->isEmpty()) {
-          TRACE("to be loaded\n");
-          m_sessions.push_back(session);
-        }
-        else {
-          TRACE("to be deleted\n");
-          session->removeFromDisk();
-        }
+      Session session(itempath);
+      if (!session.isEmpty() && !session.isRunning()) {
+        m_hasRecoverableSessions = true;
+        break;
       }
-      else
-        TRACE("is running\n");
     }
   }
 
@@ -76,21 +91,84 @@ DataRecovery::DataRecovery(doc::Context* ctx)
 
   m_inProgress.reset(new Session(newSessionDir));
   m_inProgress->create(pid);
+  UndoSwap::instance().setFilename(m_inProgress->undoSwapFilename());
   TRACE("DataRecovery: Session in progress '%s'\n", newSessionDir.c_str());
 
   m_backup = new BackupObserver(m_inProgress.get(), ctx);
+
+  // The session in progress isn't in "itemnames"
+  std::shared_ptr<Discovery> discovery = m_discovery;
+  base::cancel_token cancel = m_cancel;
+  base::thread_pool::instance().post(
+    [discovery, cancel, sessionsDir, itemnames]{
+      discoverSessions(discovery, cancel, sessionsDir, itemnames);
+    },
+    base::thread_pool::priority::low, m_cancel);
 }
 
 DataRecovery::~DataRecovery()
 {
+  m_cancel.cancel();
+
   m_backup->stop();
   delete m_backup;
 
+  // The swap file is deleted (if it's not used) before removing the
+  // session directory
+  UndoSwap::instance().setFilename(std::string());
+
   if (m_inProgress)
     m_inProgress->removeFromDisk();
 
   m_inProgress.reset();
 }
 
+const DataRecovery::Sessions& DataRecovery::sessions()
+{
+  std::unique_lock<std::mutex> lock(m_discovery->mutex);
+  m_discovery->cv.wait(lock, [this]{ return m_discovery->done; });
+  return m_discovery->sessions;
+}
+
+// static
+void DataRecovery::discoverSessions(const std::shared_ptr<Discovery>& discovery,
+                                    const base::cancel_token& cancel,
+                                    const std::string& sessionsDir,
+                                    const std::vector<std::string>& itemnames)
+{
+  Sessions sessions;
+  for (auto& itemname : itemnames) {
+    // The program is being closed
+    if (cancel.canceled())
+      break;
+
+    std::string itempath = base::join_path(sessionsDir, itemname);
+    if (base::is_directory(itempath)) {
+      TRACE("- Session '%s' ", itempath.c_str());
+
+      SessionPtr session(new Session(itempath));
+      if (!session->isRunning()) {
+        if (!session->isEmpty()) {
+          TRACE("to be loaded\n");
+          sessions.push_back(session);
+        }
+        else {
+          TRACE("to be deleted\n");
+          session->removeFromDisk();
+        }
+      }
+      else
+        TRACE("is running\n");
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(discovery->mutex);
+    discovery->sessions = std::move(sessions);
+    discovery->done = true;
+  }
+  discovery->cv.notify_all();
+}
+
 } // namespace crash
 } // namespace app
@@ -9,7 +9,10 @@
 
 #include "app/crash/session.h"
 #include "base/disable_copying.h"
+#include "base/thread_pool.h"
 
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace doc {
@@ -27,11 +30,25 @@ namespace crash {
     DataRecovery(doc::Context* context);
     ~DataRecovery();
 
-    // Returns the list of sessions that can be recovered.
-    const Sessions& sessions() { return m_sessions; }
+    // Returns true if there is at least one session that can be
+    // recovered (it doesn't wait the discovery of all sessions).
+    bool hasRecoverableSessions() const { return m_hasRecoverableSessions; }
+
+    // Returns the list of sessions that can be recovered. It waits
+    // until the background task finishes the discovery.
+    const Sessions& sessions();
 
   private:
-    Sessions m_sessions;
+    struct Discovery;
+
+    static void discoverSessions(const std::shared_ptr<Discovery>& discovery,
+                                 const base::cancel_token& cancel,
+                                 const std::string& sessionsDir,
+                                 const std::vector<std::string>& itemnames);
+
+    bool m_hasRecoverableSessions;
+    std::shared_ptr<Discovery> m_discovery;
+    base::cancel_token m_cancel;
     SessionPtr m_inProgress;
     BackupObserver* m_backup;
 
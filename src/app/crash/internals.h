@@ -10,8 +10,10 @@
 #include "doc/object.h"
 
 #include <algorithm>
+#include <cstdio>
 #include <functional>
 #include <map>
+#include <string>
 
 namespace app {
 namespace crash {
@@ -55,5 +57,15 @@ namespace crash {
 
   typedef std::map<doc::ObjectId, ObjVersions> ObjVersionsMap;
 
+  // Pixels of images are saved in files named with the hash of their
+  // content, so identical images (e.g. in several frames or in
+  // several versions of the same image) are saved just once. Each
+  // "imgref" file contains the hash of its pixels.
+  inline std::string blob_filename(uint64_t hash) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "blob-%016llx", (unsigned long long)hash);
+    return buf;
+  }
+
 } // namespace crash
 } // namespace app
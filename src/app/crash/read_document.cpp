@@ -39,6 +39,7 @@
 #include <fstream>
 #include <map>
 #include <memory>
+#include <set>
 
 namespace app {
 namespace crash {
@@ -56,7 +57,8 @@ public:
     , m_dir(dir)
     , m_docId(0)
     , m_docVersions(nullptr)
-    , m_loadInfo(nullptr) {
+    , m_loadInfo(nullptr)
+    , m_imageId(0) {
     for (const auto& fn : base::list_files(dir)) {
       auto i = fn.find('-');
       if (i == std::string::npos)
@@ -74,6 +76,9 @@ public:
       ObjVersions& versions = m_objVersions[id];
       versions.add(ver);
 
+      if (fn.compare(0, 7, "imgref-") == 0)
+        m_imageRefs.insert(id);
+
       if (fn.compare(0, 3, "doc") == 0) {
         if (!m_docId)
           m_docId = id;
@@ -120,6 +125,21 @@ private:
     if (m_images.find(imageId) != m_images.end())
       return m_images[imageId];
 
+    // The image is used by other cel data, so now we have to load it
+    auto lazy = m_lazyCelDatas.find(imageId);
+    if (lazy != m_lazyCelDatas.end()) {
+      ImageRef image = lazy->second->imageRef();
+      m_lazyCelDatas.erase(lazy);
+      return m_images[imageId] = image;
+    }
+
+    // Images in "imgref" files are loaded on demand (see readCelData)
+    if (m_imageRefs.find(imageId) != m_imageRefs.end()) {
+      m_imageId = imageId;
+      return ImageRef(loadObject<Image*>("imgref", imageId, &Reader::readImageRef));
+    }
+
+    // Old backups contain the pixels directly in "img" files
     ImageRef image(loadObject<Image*>("img", imageId, &Reader::readImage));
     return m_images[imageId] = image;
   }
@@ -315,13 +335,54 @@ private:
   }
 
   CelData* readCelData(std::ifstream& s) {
-    return read_celdata(s, this, false);
+    CelData* celdata = read_celdata(s, this, false);
+    if (!celdata)
+      return nullptr;
+
+    // Replace the placeholder with the pixels of the blob file, so
+    // they are loaded the first time the image is used
+    auto it = m_placeholders.find(celdata->image());
+    if (it != m_placeholders.end()) {
+      const Blob blob = it->second;
+      m_placeholders.erase(it);
+
+      celdata->setExternalImage(blob.filename, 4, blob.size);
+      m_lazyCelDatas[blob.imageId] = celdata;
+    }
+    return celdata;
   }
 
   Image* readImage(std::ifstream& s) {
     return read_image(s, false);
   }
 
+  // Returns a placeholder for the image of the blob file (it's
+  // replaced in readCelData).
+  Image* readImageRef(std::ifstream& s) {
+    uint64_t hash = read32(s);
+    hash |= uint64_t(read32(s)) << 32;
+    if (!s)
+      return nullptr;
+
+    Blob blob;
+    blob.filename = base::join_path(m_dir, blob_filename(hash));
+    blob.imageId = m_imageId;
+    {
+      std::ifstream bs(FSTREAM_PATH(blob.filename), std::ifstream::binary);
+      if (read32(bs) != MAGIC_NUMBER)
+        return nullptr;
+    }
+
+    const std::size_t size = base::file_size(blob.filename);
+    if (size <= 4 || size > 0xffffffff)
+      return nullptr;
+    blob.size = uint32_t(size - 4);
+
+    Image* placeholder = Image::create(IMAGE_RGB, 1, 1);
+    m_placeholders[placeholder] = blob;
+    return placeholder;
+  }
+
   std::shared_ptr<Palette> readPalette(std::ifstream& s) {
     return read_palette(s);
   }
@@ -361,6 +422,17 @@ private:
   DocumentInfo* m_loadInfo;
   std::map<ObjectId, ImageRef> m_images;
   std::map<ObjectId, CelDataRef> m_celdatas;
+  std::set<ObjectId> m_imageRefs; // Images saved as "imgref" files
+
+  // Pixels of an image that aren't loaded yet
+  struct Blob {
+    std::string filename;
+    uint32_t size;              // Bytes after the magic number
+    ObjectId imageId;           // ID of the image in the backup
+  };
+  ObjectId m_imageId;           // ID of the "imgref" being loaded
+  std::map<const Image*, Blob> m_placeholders;
+  std::map<ObjectId, CelData*> m_lazyCelDatas;
 };
 
 } // anonymous namespace
@@ -400,7 +472,10 @@ app::Document* read_document_with_raw_images(const std::string& dir,
 
   frame_t frame = 0;
   for (const auto& fn : base::list_files(dir)) {
-    if (fn.compare(0, 3, "img") != 0)
+    // Pixels of old backups ("img" files) or unique pixels of new
+    // ones ("blob" files)
+    if (fn.compare(0, 4, "img-") != 0 &&
+        fn.compare(0, 5, "blob-") != 0)
       continue;
 
     std::ifstream s(FSTREAM_PATH(base::join_path(dir, fn)), std::ifstream::binary);
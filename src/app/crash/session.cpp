@@ -25,8 +25,11 @@
 #include "base/fstream_path.h"
 #include "base/path.h"
 #include "base/process.h"
+#include "base/scoped_lock.h"
 #include "base/split_string.h"
 #include "base/string.h"
+#include "doc/image_swap.h"
+#include "she/system.h"
 
 namespace app {
 namespace crash {
@@ -88,7 +91,13 @@ const Session::Backups& Session::backups()
 bool Session::isRunning()
 {
   loadPid();
+#ifdef __EMSCRIPTEN__
+  // The pid is the same in each page load, the sessions stored in
+  // IndexedDB are from previous loads (or other tabs).
+  return false;
+#else
   return base::is_process_running(m_pid);
+#endif
 }
 
 bool Session::isEmpty()
@@ -120,7 +129,12 @@ void Session::removeFromDisk()
     if (base::is_file(verFilename()))
       base::delete_file(verFilename());
 
+    // Left by a crashed session
+    if (base::is_file(undoSwapFilename()))
+      base::delete_file(undoSwapFilename());
+
     base::remove_directory(m_path);
+    she::instance()->persistUserFiles();
   }
   catch (const std::exception& ex) {
     (void)ex;
@@ -130,9 +144,15 @@ void Session::removeFromDisk()
 }
 
 void Session::saveDocumentChanges(app::Document* doc)
+{
+  std::unique_ptr<DocumentSnapshot> snapshot = takeDocumentSnapshot(doc);
+  if (snapshot)
+    saveDocumentSnapshot(snapshot.get());
+}
+
+std::unique_ptr<DocumentSnapshot> Session::takeDocumentSnapshot(app::Document* doc)
 {
   DocumentReader reader(doc, 250);
-  app::Context ctx;
   std::string dir = base::join_path(m_path,
     base::convert_to<std::string>(doc->id()));
   TRACE("DataRecovery: Saving document '%s'...\n", dir.c_str());
@@ -140,12 +160,23 @@ void Session::saveDocumentChanges(app::Document* doc)
   if (!base::is_directory(dir))
     base::make_directory(dir);
 
-  // Save document information
-  write_document(dir, doc);
+  // Copy document information (the reader lock is released when we
+  // return, before the images are compressed)
+  std::unique_ptr<DocumentSnapshot> snapshot(new DocumentSnapshot(dir, doc));
+  if (snapshot->isEmpty())
+    snapshot.reset();
+  return snapshot;
+}
+
+void Session::saveDocumentSnapshot(DocumentSnapshot* snapshot)
+{
+  base::scoped_lock hold(m_writeMutex);
+  snapshot->write();
 }
 
 void Session::removeDocument(app::Document* doc)
 {
+  base::scoped_lock hold(m_writeMutex);
   try {
     delete_document_internals(doc);
 
@@ -154,6 +185,8 @@ void Session::removeDocument(app::Document* doc)
       base::convert_to<std::string>(doc->id()));
     if (base::is_directory(dir))
       deleteDirectory(dir);
+
+    she::instance()->persistUserFiles();
   }
   catch (const std::exception&) {
     // TODO Log this error
@@ -229,12 +262,21 @@ std::string Session::verFilename() const
   return base::join_path(m_path, "ver");
 }
 
+std::string Session::undoSwapFilename() const
+{
+  return base::join_path(m_path, "undo");
+}
+
 void Session::deleteDirectory(const std::string& dir)
 {
   ASSERT(!dir.empty());
   if (dir.empty())
     return;
 
+  // Images of restored documents that are still in the backup
+  // files must be loaded before removing them
+  doc::ImageSwap::instance().loadExternalImages(dir);
+
   for (auto& item : base::list_files(dir)) {
     std::string objfn = base::join_path(dir, item);
     if (base::is_file(objfn)) {
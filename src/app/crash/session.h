@@ -9,10 +9,12 @@
 
 #include "app/crash/raw_images_as.h"
 #include "base/disable_copying.h"
+#include "base/mutex.h"
 #include "base/process.h"
 #include "base/shared_ptr.h"
 
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -20,6 +22,7 @@ namespace app {
   class Document;
 
 namespace crash {
+  class DocumentSnapshot;
 
   // A class to record/restore session information.
   class Session {
@@ -39,6 +42,9 @@ namespace crash {
     ~Session();
 
     std::string name() const;
+
+    // File used to store old undo states (see UndoSwap).
+    std::string undoSwapFilename() const;
     const Backups& backups();
 
     bool isRunning();
@@ -48,6 +54,16 @@ namespace crash {
     void removeFromDisk();
 
     void saveDocumentChanges(app::Document* doc);
+
+    // Copies the document changes locking the document for reading
+    // (it throws an exception if the document cannot be locked).
+    // Returns nullptr if there is nothing new to save.
+    std::unique_ptr<DocumentSnapshot> takeDocumentSnapshot(app::Document* doc);
+
+    // Saves the snapshot in the disk, the document doesn't need to
+    // be locked (it could even be closed in the meantime).
+    void saveDocumentSnapshot(DocumentSnapshot* snapshot);
+
     void removeDocument(app::Document* doc);
 
     void restoreBackup(Backup* backup);
@@ -66,6 +82,8 @@ namespace crash {
     std::fstream m_log;
     std::fstream m_pidFile;
     Backups m_backups;
+    // Serializes the writing of snapshots with removeDocument()
+    base::mutex m_writeMutex;
 
     DISABLE_COPYING(Session);
   };
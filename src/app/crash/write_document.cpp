@@ -13,6 +13,7 @@
 
 #include "app/crash/internals.h"
 #include "app/document.h"
+#include "app/pref/preferences.h"
 #include "base/convert_to.h"
 #include "base/fs.h"
 #include "base/fstream_path.h"
@@ -26,6 +27,8 @@
 #include "doc/frame.h"
 #include "doc/frame_tag.h"
 #include "doc/frame_tag_io.h"
+#include "doc/image.h"
+#include "doc/image_hash.h"
 #include "doc/image_io.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
@@ -33,8 +36,11 @@
 #include "doc/sprite.h"
 #include "doc/string_io.h"
 
+#include <algorithm>
 #include <fstream>
 #include <map>
+#include <set>
+#include <sstream>
 
 namespace app {
 namespace crash {
@@ -45,146 +51,143 @@ using namespace doc;
 
 namespace {
 
-static std::map<ObjectId, ObjVersionsMap> g_docVersions;
+// Number of backups of a document between compactions of its
+// directory
+const int kCompactionPeriod = 10;
 
-class Writer {
-public:
-  Writer(const std::string& dir, app::Document* doc)
-    : m_dir(dir)
-    , m_doc(doc)
-    , m_objVersions(g_docVersions[doc->id()]) {
-  }
-
-  void saveDocument() {
-    Sprite* spr = m_doc->sprite();
+struct DocInfo {
+  ObjVersionsMap objVersions;
+  int backups = 0;
+};
 
-    // Save from objects without children (e.g. images), to aggregated
-    // objects (e.g. cels, layers, etc.)
+static std::map<ObjectId, DocInfo> g_docs;
 
-    for (auto pal : spr->getPalettes())
-      saveObject("pal", pal.get(), &Writer::writePalette);
+// Writes a file with the magic number at the beginning. The magic
+// number is written at the end, so we know that the file is complete
+// if it has the magic number.
+template<typename WriteContent>
+void save_file(const std::string& fn, const WriteContent& writeContent)
+{
+  std::ofstream s(FSTREAM_PATH(fn), std::ofstream::binary);
+  write32(s, 0);                // Leave a room for the magic number
+  writeContent(s);
 
-    for (FrameTag* frtag : spr->frameTags())
-      saveObject("frtag", frtag, &Writer::writeFrameTag);
+  // Flush all data. In this way we ensure that the magic number is
+  // the last thing being written in the file.
+  s.flush();
 
-    for (auto cel : spr->uniqueCels()) {
-      saveObject("img", cel->image(), &Writer::writeImage);
-      saveObject("celdata", cel->data(), &Writer::writeCelData);
-    }
+  // Write the magic number
+  s.seekp(0);
+  write32(s, MAGIC_NUMBER);
+}
 
-    for (auto cel : spr->cels())
-      saveObject("cel", cel.get(), &Writer::writeCel);
+bool is_complete_file(const std::string& fn)
+{
+  if (!base::is_file(fn))
+    return false;
 
-    std::vector<Layer*> layers;
-    spr->getLayersList(layers);
-    for (Layer* lay : layers)
-      saveObject("lay", lay, &Writer::writeLayerStructure);
+  std::ifstream s(FSTREAM_PATH(fn), std::ifstream::binary);
+  return (read32(s) == MAGIC_NUMBER);
+}
 
-    saveObject("spr", spr, &Writer::writeSprite);
-    saveObject("doc", m_doc, &Writer::writeDocumentFile);
-  }
+} // anonymous namespace
 
-private:
+// An object that must be saved in the backup directory. Images are
+// copied and compressed later (without locking the document), the
+// rest of objects are small, so they are serialized directly.
+struct DocumentSnapshot::Object {
+  const char* prefix;
+  ObjectId id;
+  ObjectVersion version;
+  std::string data;
+  std::unique_ptr<Image> image;
+};
 
-  void writeDocumentFile(std::ofstream& s, app::Document* doc) {
-    write32(s, doc->sprite()->id());
-    write_string(s, doc->filename());
-  }
+DocumentSnapshot::DocumentSnapshot(const std::string& dir, app::Document* doc)
+  : m_dir(dir)
+  , m_docId(doc->id())
+  , m_imageCompression(Preferences::instance().general.fastDataRecovery() ?
+                       ImageCompression::Qoi:
+                       ImageCompression::ZlibFast)
+{
+  Sprite* spr = doc->sprite();
 
-  void writeSprite(std::ofstream& s, Sprite* spr) {
-    write8(s, spr->pixelFormat());
-    write16(s, spr->width());
-    write16(s, spr->height());
-    write32(s, spr->transparentColor());
-
-    // Frame durations
-    write32(s, spr->totalFrames());
-    for (frame_t fr = 0; fr < spr->totalFrames(); ++fr)
-      write32(s, spr->frameDuration(fr));
-
-    // IDs of all main layers
-    std::vector<Layer*> layers;
-    spr->getLayersList(layers);
-    write32(s, layers.size());
-    for (Layer* lay : layers)
-      write32(s, lay->id());
-
-    // IDs of all palettes
-    write32(s, spr->getPalettes().size());
-    for (auto pal : spr->getPalettes())
-      write32(s, pal->id());
-
-    // IDs of all frame tags
-    write32(s, spr->frameTags().size());
-    for (FrameTag* frtag : spr->frameTags())
-      write32(s, frtag->id());
-  }
+  // Save from objects without children (e.g. images), to aggregated
+  // objects (e.g. cels, layers, etc.)
 
-  void writeLayerStructure(std::ofstream& s, Layer* lay) {
-    write32(s, static_cast<int>(lay->flags())); // Flags
-    write16(s, static_cast<int>(lay->type()));  // Type
-    write_string(s, lay->name());
+  for (auto pal : spr->getPalettes())
+    addObject("pal", pal.get(), &DocumentSnapshot::writePalette);
 
-    if (lay->type() == ObjectType::LayerImage) {
-      CelConstIterator it, begin = static_cast<const LayerImage*>(lay)->getCelBegin();
-      CelConstIterator end = static_cast<const LayerImage*>(lay)->getCelEnd();
+  for (FrameTag* frtag : spr->frameTags())
+    addObject("frtag", frtag, &DocumentSnapshot::writeFrameTag);
 
-      // Cels
-      write32(s, static_cast<const LayerImage*>(lay)->getCelsCount());
-      for (it=begin; it != end; ++it) {
-        write32(s, (*it)->id());
-      }
-    }
+  for (const auto& cel : spr->uniqueCels()) {
+    if (!isSavedSwappedImage(cel->data()))
+      addImage(cel->image());
+    addObject("celdata", cel->data(), &DocumentSnapshot::writeCelData);
   }
 
-  void writeCel(std::ofstream& s, Cel* cel) {
-    write_cel(s, cel);
-  }
+  for (const auto& cel : spr->cels())
+    addObject("cel", cel.get(), &DocumentSnapshot::writeCel);
 
-  void writeCelData(std::ofstream& s, CelData* celdata) {
-    write_celdata(s, celdata);
-  }
+  std::vector<Layer*> layers;
+  spr->getLayersList(layers);
+  for (Layer* lay : layers)
+    addObject("lay", lay, &DocumentSnapshot::writeLayerStructure);
 
-  void writeImage(std::ofstream& s, Image* img) {
-    write_image(s, img);
-  }
+  addObject("spr", spr, &DocumentSnapshot::writeSprite);
+  addObject("doc", doc, &DocumentSnapshot::writeDocumentFile);
+}
 
-  void writePalette(std::ofstream& s, Palette* pal) {
-    write_palette(s, *pal);
-  }
+DocumentSnapshot::~DocumentSnapshot()
+{
+  for (Object* obj : m_objects)
+    delete obj;
+}
 
-  void writeFrameTag(std::ofstream& s, FrameTag* frameTag) {
-    write_frame_tag(s, frameTag);
-  }
+void DocumentSnapshot::write()
+{
+  // The document was closed (and its backup deleted) after taking
+  // the snapshot
+  if (!base::is_directory(m_dir))
+    return;
 
-  template<typename T>
-  void saveObject(const char* prefix, T* obj, void (Writer::*writeMember)(std::ofstream&, T*)) {
-    if (!obj->version())
-      obj->incrementVersion();
+  DocInfo& info = g_docs[m_docId];
+  ObjVersionsMap& objVersions = info.objVersions;
 
-    ObjVersions& versions = m_objVersions[obj->id()];
-    if (versions.newer() == obj->version())
-      return;
+  for (Object* obj : m_objects) {
+    ObjVersions& versions = objVersions[obj->id];
 
-    std::string fn = prefix;
+    std::string fn = obj->prefix;
     fn.push_back('-');
-    fn += base::convert_to<std::string>(obj->id());
+    fn += base::convert_to<std::string>(obj->id);
 
     std::string fullfn = base::join_path(m_dir, fn);
     std::string oldfn = fullfn + "." + base::convert_to<std::string>(versions.older());
-    fullfn += "." + base::convert_to<std::string>(obj->version());
-
-    std::ofstream s(FSTREAM_PATH(fullfn), std::ofstream::binary);
-    write32(s, 0);                // Leave a room for the magic number
-    (this->*writeMember)(s, obj); // Write the object
+    fullfn += "." + base::convert_to<std::string>(obj->version);
+
+    // The pixels are saved in a blob (if it doesn't exist yet), and
+    // the image object is just a reference to it
+    if (obj->image) {
+      const uint64_t hash = calculate_image_hash(obj->image.get());
+      const std::string blobfn = base::join_path(m_dir, blob_filename(hash));
+      if (!is_complete_file(blobfn)) {
+        save_file(blobfn, [this, obj](std::ostream& s){
+            write_image(s, obj->image.get(), obj->id, m_imageCompression);
+          });
+        TRACE(" - Saved %s\n", blobfn.c_str());
+      }
 
-    // Flush all data. In this way we ensure that the magic number is
-    // the last thing being written in the file.
-    s.flush();
+      std::ostringstream ref;
+      write32(ref, uint32_t(hash));
+      write32(ref, uint32_t(hash >> 32));
+      obj->data = ref.str();
+    }
 
-    // Write the magic number
-    s.seekp(0);
-    write32(s, MAGIC_NUMBER);
+    // Write the object
+    save_file(fullfn, [obj](std::ostream& s){
+        s.write(obj->data.c_str(), obj->data.size());
+      });
 
     // Remove the older version
     try {
@@ -192,40 +195,236 @@ private:
         base::delete_file(oldfn);
     }
     catch (const std::exception&) {
-      TRACE(" - Cannot delete %s #%d v%d\n", prefix, obj->id(), versions.older());
+      TRACE(" - Cannot delete %s #%d v%d\n", obj->prefix, obj->id, versions.older());
     }
 
     // Rotate versions and add the latest one
-    versions.rotateRevisions(obj->version());
+    versions.rotateRevisions(obj->version);
+
+    TRACE(" - Saved %s #%d v%d\n", obj->prefix, obj->id, obj->version);
 
-    TRACE(" - Saved %s #%d v%d\n", prefix, obj->id(), obj->version());
+    // Release the memory as soon as possible
+    obj->data.clear();
+    obj->image.reset();
   }
 
-  std::string m_dir;
-  app::Document* m_doc;
-  ObjVersionsMap& m_objVersions;
-};
+  if ((++info.backups % kCompactionPeriod) == 0)
+    compact(objVersions);
+}
 
-} // anonymous namespace
+void DocumentSnapshot::compact(ObjVersionsMap& objVersions)
+{
+  TRACE("DataRecovery: Compacting '%s'...\n", m_dir.c_str());
+
+  std::sort(m_liveIds.begin(), m_liveIds.end());
+
+  std::set<std::string> usedBlobs;
+  std::vector<std::string> blobs;
+
+  for (const auto& fn : base::list_files(m_dir)) {
+    if (fn.compare(0, 5, "blob-") == 0) {
+      blobs.push_back(fn);
+      continue;
+    }
+
+    auto i = fn.find('-');
+    if (i == std::string::npos)
+      continue;
+
+    auto j = fn.find('.', ++i);
+    if (j == std::string::npos)
+      continue;
+
+    ObjectId id = base::convert_to<int>(fn.substr(i, j - i));
+    if (!id)
+      continue;
+
+    std::string fullfn = base::join_path(m_dir, fn);
+
+    // Remove all versions of deleted objects (e.g. old cels)
+    if (!std::binary_search(m_liveIds.begin(), m_liveIds.end(), id)) {
+      try {
+        base::delete_file(fullfn);
+      }
+      catch (const std::exception&) {
+        TRACE(" - Cannot delete %s\n", fn.c_str());
+      }
+      objVersions.erase(id);
+      continue;
+    }
+
+    if (fn.compare(0, 7, "imgref-") == 0) {
+      std::ifstream s(FSTREAM_PATH(fullfn), std::ifstream::binary);
+      if (read32(s) == MAGIC_NUMBER) {
+        uint64_t hash = read32(s);
+        hash |= uint64_t(read32(s)) << 32;
+        usedBlobs.insert(blob_filename(hash));
+      }
+    }
+  }
+
+  // Remove pixels that are not used by any version of the images
+  for (const auto& fn : blobs) {
+    if (usedBlobs.find(fn) != usedBlobs.end())
+      continue;
+
+    try {
+      base::delete_file(base::join_path(m_dir, fn));
+    }
+    catch (const std::exception&) {
+      TRACE(" - Cannot delete %s\n", fn.c_str());
+    }
+  }
+}
+
+void DocumentSnapshot::writeDocumentFile(std::ostream& s, app::Document* doc)
+{
+  write32(s, doc->sprite()->id());
+  write_string(s, doc->filename());
+}
+
+void DocumentSnapshot::writeSprite(std::ostream& s, Sprite* spr)
+{
+  write8(s, spr->pixelFormat());
+  write16(s, spr->width());
+  write16(s, spr->height());
+  write32(s, spr->transparentColor());
+
+  // Frame durations
+  write32(s, spr->totalFrames());
+  for (frame_t fr = 0; fr < spr->totalFrames(); ++fr)
+    write32(s, spr->frameDuration(fr));
+
+  // IDs of all main layers
+  std::vector<Layer*> layers;
+  spr->getLayersList(layers);
+  write32(s, layers.size());
+  for (Layer* lay : layers)
+    write32(s, lay->id());
+
+  // IDs of all palettes
+  write32(s, spr->getPalettes().size());
+  for (auto pal : spr->getPalettes())
+    write32(s, pal->id());
+
+  // IDs of all frame tags
+  write32(s, spr->frameTags().size());
+  for (FrameTag* frtag : spr->frameTags())
+    write32(s, frtag->id());
+}
+
+void DocumentSnapshot::writeLayerStructure(std::ostream& s, Layer* lay)
+{
+  write32(s, static_cast<int>(lay->flags())); // Flags
+  write16(s, static_cast<int>(lay->type()));  // Type
+  write_string(s, lay->name());
+
+  if (lay->type() == ObjectType::LayerImage) {
+    CelConstIterator it, begin = static_cast<const LayerImage*>(lay)->getCelBegin();
+    CelConstIterator end = static_cast<const LayerImage*>(lay)->getCelEnd();
+
+    // Cels
+    write32(s, static_cast<const LayerImage*>(lay)->getCelsCount());
+    for (it=begin; it != end; ++it) {
+      write32(s, (*it)->id());
+    }
+  }
+}
+
+void DocumentSnapshot::writeCel(std::ostream& s, Cel* cel)
+{
+  write_cel(s, cel);
+}
+
+void DocumentSnapshot::writeCelData(std::ostream& s, CelData* celdata)
+{
+  write_celdata(s, celdata);
+}
+
+void DocumentSnapshot::writePalette(std::ostream& s, Palette* pal)
+{
+  write_palette(s, *pal);
+}
+
+void DocumentSnapshot::writeFrameTag(std::ostream& s, FrameTag* frameTag)
+{
+  write_frame_tag(s, frameTag);
+}
+
+DocumentSnapshot::Object* DocumentSnapshot::newObject(const char* prefix, doc::Object* obj)
+{
+  if (!obj->version())
+    obj->incrementVersion();
+
+  m_liveIds.push_back(obj->id());
+
+  ObjVersionsMap& objVersions = g_docs[m_docId].objVersions;
+  auto it = objVersions.find(obj->id());
+  if (it != objVersions.end() && it->second.newer() == obj->version())
+    return nullptr;
+
+  Object* o = new Object;
+  o->prefix = prefix;
+  o->id = obj->id();
+  o->version = obj->version();
+  m_objects.push_back(o);
+  return o;
+}
+
+template<typename T>
+void DocumentSnapshot::addObject(const char* prefix, T* obj,
+                                 void (DocumentSnapshot::*writeMember)(std::ostream&, T*))
+{
+  if (Object* o = newObject(prefix, obj)) {
+    std::ostringstream s;
+    (this->*writeMember)(s, obj);
+    o->data = s.str();
+  }
+}
+
+void DocumentSnapshot::addImage(Image* img)
+{
+  // Copying the pixels is much faster than compressing them
+  if (Object* o = newObject("imgref", img))
+    o->image.reset(Image::createCopy(img));
+}
+
+// Returns true if the image of the cel is swapped out and the same
+// version was already saved (so it's not loaded just to be skipped).
+bool DocumentSnapshot::isSavedSwappedImage(const CelData* celData)
+{
+  if (!celData->isSwapped())
+    return false;
+
+  const ObjectId imageId = celData->imageId();
+  ObjVersionsMap& objVersions = g_docs[m_docId].objVersions;
+  auto it = objVersions.find(imageId);
+  if (it == objVersions.end() ||
+      it->second.newer() != celData->imageVersion())
+    return false;
+
+  m_liveIds.push_back(imageId);
+  return true;
+}
 
 //////////////////////////////////////////////////////////////////////
 // Public API
 
 void write_document(const std::string& dir, app::Document* doc)
 {
-  Writer writer(dir, doc);
-  writer.saveDocument();
+  DocumentSnapshot snapshot(dir, doc);
+  snapshot.write();
 }
 
 void delete_document_internals(app::Document* doc)
 {
   ASSERT(doc);
-  auto it = g_docVersions.find(doc->id());
+  auto it = g_docs.find(doc->id());
 
-  // The document could not be inside g_documentObjects in case it was
-  // never saved by the backup process.
-  if (it != g_docVersions.end())
-    g_docVersions.erase(it);
+  // The document could not be inside g_docs in case it was never
+  // saved by the backup process.
+  if (it != g_docs.end())
+    g_docs.erase(it);
 }
 
 } // namespace crash
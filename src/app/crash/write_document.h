@@ -7,12 +7,76 @@
 
 #pragma once
 
+#include "app/crash/internals.h"
+#include "base/disable_copying.h"
+#include "doc/image_io.h"
+#include "doc/object_id.h"
+
+#include <iosfwd>
 #include <string>
+#include <vector>
+
+namespace doc {
+  class Cel;
+  class CelData;
+  class FrameTag;
+  class Image;
+  class Layer;
+  class Object;
+  class Palette;
+  class Sprite;
+}
 
 namespace app {
 class Document;
 namespace crash {
 
+  // Objects of a document that were modified since its last backup.
+  // It must be created with the document locked (e.g. with a
+  // DocumentReader), but write() can be called without the lock, so
+  // the user can continue editing the document while the images are
+  // compressed and saved in the disk.
+  class DocumentSnapshot {
+  public:
+    DocumentSnapshot(const std::string& dir, app::Document* doc);
+    ~DocumentSnapshot();
+
+    bool isEmpty() const { return m_objects.empty(); }
+
+    // Writes the objects in the backup directory.
+    void write();
+
+  private:
+    struct Object;
+
+    Object* newObject(const char* prefix, doc::Object* obj);
+    template<typename T>
+    void addObject(const char* prefix, T* obj,
+                   void (DocumentSnapshot::*writeMember)(std::ostream&, T*));
+    void addImage(doc::Image* img);
+    bool isSavedSwappedImage(const doc::CelData* celData);
+
+    // Removes files of deleted objects and unused pixels.
+    void compact(ObjVersionsMap& objVersions);
+
+    void writeDocumentFile(std::ostream& s, app::Document* doc);
+    void writeSprite(std::ostream& s, doc::Sprite* spr);
+    void writeLayerStructure(std::ostream& s, doc::Layer* lay);
+    void writeCel(std::ostream& s, doc::Cel* cel);
+    void writeCelData(std::ostream& s, doc::CelData* celdata);
+    void writePalette(std::ostream& s, doc::Palette* pal);
+    void writeFrameTag(std::ostream& s, doc::FrameTag* frameTag);
+
+    std::string m_dir;
+    doc::ObjectId m_docId;
+    doc::ImageCompression m_imageCompression;
+    std::vector<Object*> m_objects;
+    // IDs of all objects of the document (modified or not)
+    std::vector<doc::ObjectId> m_liveIds;
+
+    DISABLE_COPYING(DocumentSnapshot);
+  };
+
   void write_document(const std::string& dir, app::Document* doc);
   void delete_document_internals(app::Document* doc);
 
@@ -16,13 +16,12 @@
 #include "app/color_utils.h"
 #include "app/context.h"
 #include "app/document_api.h"
+#include "app/document_thumbnail.h"
 #include "app/document_undo.h"
 #include "app/flatten.h"
 #include "app/pref/preferences.h"
 #include "app/util/create_cel_copy.h"
 #include "base/memory.h"
-#include "base/scoped_lock.h"
-#include "base/thread.h"
 #include "doc/cel.h"
 #include "doc/context.h"
 #include "doc/document_event.h"
@@ -44,8 +43,7 @@ using namespace doc;
 Document::Document(Sprite* sprite)
   : m_undo(new DocumentUndo)
   , m_associated_to_file(false)
-  , m_write_lock(false)
-  , m_read_locks(0)
+  , m_loading(false)
     // Information about the file format used to load/save this document
   , m_format_options(NULL)
   // Mask
@@ -194,12 +192,28 @@ void Document::setFormatOptions(const base::SharedPtr<FormatOptions>& format_opt
   m_format_options = format_options;
 }
 
+void Document::setFileIndex(const std::shared_ptr<FormatOptions>& index)
+{
+  m_fileIndex = index;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Thumbnail
+
+DocumentThumbnail* Document::thumbnail()
+{
+  if (!m_thumbnail)
+    m_thumbnail.reset(new DocumentThumbnail(this));
+  return m_thumbnail.get();
+}
+
 //////////////////////////////////////////////////////////////////////
 // Boundaries
 
 void Document::generateMaskBoundaries(const Mask* mask)
 {
   m_maskBoundaries.reset();
+  ++m_maskBoundariesVersion;
 
   // No mask specified? Use the current one in the document
   if (!mask) {
@@ -433,104 +447,35 @@ Document* Document::duplicate(DuplicateType type) const
 
 bool Document::lock(LockType lockType, int timeout)
 {
-  while (timeout >= 0) {
-    {
-      scoped_lock lock(m_mutex);
-      switch (lockType) {
-
-        case ReadLock:
-          // If no body is writting the sprite...
-          if (!m_write_lock) {
-            // We can read it
-            ++m_read_locks;
-            return true;
-          }
-          break;
-
-        case WriteLock:
-          // If no body is reading and writting...
-          if (m_read_locks == 0 && !m_write_lock) {
-            // We can start writting the sprite...
-            m_write_lock = true;
-            TRACE("Document::lock: Locked <%d> to write\n", id());
-            return true;
-          }
-          break;
-
-      }
-    }
-
-    if (timeout > 0) {
-      int delay = MIN(100, timeout);
-      timeout -= delay;
-
-      TRACE("Document::lock: wait 100 msecs for <%d>\n", id());
-      base::this_thread::sleep_for(double(delay) / 1000.0);
-    }
-    else
-      break;
-  }
+  if (m_rwLock.lock(lockType == ReadLock ? base::rw_lock::ReadLock:
+                                           base::rw_lock::WriteLock,
+                    timeout))
+    return true;
 
   TRACE("Document::lock: Cannot lock <%d> to %s (has %d read locks and %d write locks)\n",
-    id(), (lockType == ReadLock ? "read": "write"), m_read_locks, m_write_lock);
+    id(), (lockType == ReadLock ? "read": "write"),
+    m_rwLock.read_locks(), m_rwLock.is_write_locked());
   return false;
 }
 
 bool Document::lockToWrite(int timeout)
 {
-  while (timeout >= 0) {
-    {
-      scoped_lock lock(m_mutex);
-      // this only is possible if there are just one reader
-      if (m_read_locks == 1) {
-        ASSERT(!m_write_lock);
-        m_read_locks = 0;
-        m_write_lock = true;
-        TRACE("Document::lockToWrite: Locked <%d> to write\n", id());
-        return true;
-      }
-    }
-
-    if (timeout > 0) {
-      int delay = MIN(100, timeout);
-      timeout -= delay;
-
-      TRACE("Document::lockToWrite: wait 100 msecs for <%d>\n", id());
-      base::this_thread::sleep_for(double(delay) / 1000.0);
-    }
-    else
-      break;
-  }
+  if (m_rwLock.upgrade_to_write(timeout))
+    return true;
 
   TRACE("Document::lockToWrite: Cannot lock <%d> to write (has %d read locks and %d write locks)\n",
-    id(), m_read_locks, m_write_lock);
+    id(), m_rwLock.read_locks(), m_rwLock.is_write_locked());
   return false;
 }
 
 void Document::unlockToRead()
 {
-  scoped_lock lock(m_mutex);
-
-  ASSERT(m_read_locks == 0);
-  ASSERT(m_write_lock);
-
-  m_write_lock = false;
-  m_read_locks = 1;
+  m_rwLock.downgrade_to_read();
 }
 
 void Document::unlock()
 {
-  scoped_lock lock(m_mutex);
-
-  if (m_write_lock) {
-    m_write_lock = false;
-  }
-  else if (m_read_locks > 0) {
-    --m_read_locks;
-  }
-  else {
-    ASSERT(false);
-  }
+  m_rwLock.unlock();
 }
 
 void Document::onContextChanged()
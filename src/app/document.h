@@ -11,7 +11,7 @@
 #include "app/file/format_options.h"
 #include "app/transformation.h"
 #include "base/disable_copying.h"
-#include "base/mutex.h"
+#include "base/rw_lock.h"
 #include "base/observable.h"
 #include "doc/blend_mode.h"
 #include "doc/color.h"
@@ -20,6 +20,7 @@
 #include "doc/pixel_format.h"
 #include "gfx/rect.h"
 
+#include <memory>
 #include <string>
 
 namespace doc {
@@ -36,6 +37,7 @@ namespace gfx {
 
 namespace app {
   class DocumentApi;
+  class DocumentThumbnail;
   class DocumentUndo;
   class Transaction;
 
@@ -88,6 +90,11 @@ namespace app {
     bool isAssociatedToFile() const;
     void markAsSaved();
 
+    // True while the frames of the document are still being loaded
+    // in background (the document cannot be saved).
+    bool isLoading() const { return m_loading; }
+    void setLoading(bool loading) { m_loading = loading; }
+
     // You can use this to indicate that we've destroyed (or we cannot
     // trust) the file associated with the document (e.g. when we
     // cancel a Save operation in the middle). So it's impossible to
@@ -105,6 +112,18 @@ namespace app {
     void setFormatOptions(const base::SharedPtr<FormatOptions>& format_options);
     base::SharedPtr<FormatOptions> getFormatOptions() { return m_format_options; }
 
+    // Data of the last loaded/saved file (e.g. offsets of the .ase
+    // frames) used by its format to save the same file incrementally.
+    void setFileIndex(const std::shared_ptr<FormatOptions>& index);
+    const std::shared_ptr<FormatOptions>& fileIndex() const { return m_fileIndex; }
+
+    //////////////////////////////////////////////////////////////////////
+    // Thumbnail
+
+    // Thumbnail of the first frame, created the first time it's used
+    // and updated incrementally from the modified areas.
+    DocumentThumbnail* thumbnail();
+
     //////////////////////////////////////////////////////////////////////
     // Boundaries
 
@@ -114,6 +133,11 @@ namespace app {
      return m_maskBoundaries.get();
     }
 
+    // Incremented each time the boundaries are generated.
+    int maskBoundariesVersion() const {
+      return m_maskBoundariesVersion;
+    }
+
     //////////////////////////////////////////////////////////////////////
     // Extra Cel (it is used to draw pen preview, pixels in movement, etc.)
 
@@ -172,6 +196,9 @@ namespace app {
 
     void unlock();
 
+    // Contention of the lock (e.g. to show it in the performance HUD).
+    base::rw_lock::Stats lockStats() const { return m_rwLock.stats(); }
+
   protected:
     virtual void onContextChanged() override;
 
@@ -182,21 +209,24 @@ namespace app {
     // True if this sprite is associated to a file in the file-system.
     bool m_associated_to_file;
 
+    // True if a progressive load is adding frames to the document.
+    bool m_loading;
+
     // Selected mask region boundaries
     std::unique_ptr<doc::MaskBoundaries> m_maskBoundaries;
+    int m_maskBoundariesVersion = 0;
 
-    // Mutex to modify the 'locked' flag.
-    base::mutex m_mutex;
-
-    // True if some thread is writing the sprite.
-    bool m_write_lock;
-
-    // Greater than zero when one or more threads are reading the sprite.
-    int m_read_locks;
+    // Readers/writer lock of the sprite.
+    base::rw_lock m_rwLock;
 
     // Data to save the file in the same format that it was loaded
     base::SharedPtr<FormatOptions> m_format_options;
 
+    // Data to save incrementally the last loaded/saved file
+    std::shared_ptr<FormatOptions> m_fileIndex;
+
+    std::unique_ptr<DocumentThumbnail> m_thumbnail;
+
     // Extra cel used to draw extra stuff (e.g. editor's pen preview, pixels in movement, etc.)
     ExtraCelRef m_extraCel;
 
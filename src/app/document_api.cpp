@@ -24,11 +24,13 @@
 #include "app/cmd/layer_from_background.h"
 #include "app/cmd/move_cel.h"
 #include "app/cmd/move_layer.h"
+#include "app/cmd/permute_frames.h"
 #include "app/cmd/remove_cel.h"
 #include "app/cmd/remove_frame.h"
 #include "app/cmd/remove_frame_tag.h"
 #include "app/cmd/remove_layer.h"
 #include "app/cmd/replace_image.h"
+#include "app/cmd/replace_images.h"
 #include "app/cmd/set_cel_frame.h"
 #include "app/cmd/set_cel_opacity.h"
 #include "app/cmd/set_cel_position.h"
@@ -46,6 +48,7 @@
 #include "app/document.h"
 #include "app/document_undo.h"
 #include "app/transaction.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/flip_image.h"
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
@@ -57,6 +60,7 @@
 #include "render/render.h"
 
 #include <memory>
+#include <numeric>
 #include <set>
 
 namespace app {
@@ -81,7 +85,10 @@ void DocumentApi::cropSprite(Sprite* sprite, const gfx::Rect& bounds)
 {
   setSpriteSize(sprite, bounds.w, bounds.h);
 
+  // Only the background cels need new images, the position of the
+  // other cels is just moved.
   app::Document* doc = static_cast<app::Document*>(sprite->document());
+  std::vector<Cel*> backgroundCels;
   std::vector<Layer*> layers;
   sprite->getLayersList(layers);
   for (Layer* layer : layers) {
@@ -102,16 +109,7 @@ void DocumentApi::cropSprite(Sprite* sprite, const gfx::Rect& bounds)
         if (image && !cel->link()) {
           ASSERT(cel->x() == 0);
           ASSERT(cel->y() == 0);
-
-          // Create the new image through a crop
-          ImageRef new_image(
-            crop_image(image,
-              bounds.x, bounds.y,
-              bounds.w, bounds.h,
-              doc->bgColor(layer)));
-
-          // Replace the image in the stock that is pointed by the cel
-          replaceImage(sprite, cel->imageRef(), new_image);
+          backgroundCels.push_back(cel.get());
         }
       }
       else {
@@ -122,6 +120,28 @@ void DocumentApi::cropSprite(Sprite* sprite, const gfx::Rect& bounds)
     }
   }
 
+  // Create the new images through a crop (in parallel)
+  if (!backgroundCels.empty()) {
+    std::vector<ImageRef> oldImages(backgroundCels.size());
+    std::vector<ImageRef> newImages(backgroundCels.size());
+    for (std::size_t i=0; i<backgroundCels.size(); ++i)
+      oldImages[i] = backgroundCels[i]->imageRef();
+
+    const color_t bgColor = doc->bgColor(backgroundCels.front()->layer());
+    base::thread_pool::instance().parallel_for(
+      int(backgroundCels.size()),
+      [&](int i) {
+        newImages[i].reset(
+          crop_image(oldImages[i].get(),
+                     bounds.x, bounds.y,
+                     bounds.w, bounds.h,
+                     bgColor));
+      });
+
+    // Replace the images in the stock that are pointed by the cels
+    replaceImages(sprite, oldImages, newImages);
+  }
+
   if (!m_document->mask()->isEmpty())
     setMaskPosition(m_document->mask()->bounds().x-bounds.x,
                     m_document->mask()->bounds().y-bounds.y);
@@ -213,92 +233,74 @@ void DocumentApi::setFrameRangeDuration(Sprite* sprite, frame_t from, frame_t to
 
 void DocumentApi::moveFrame(Sprite* sprite, frame_t frame, frame_t beforeFrame)
 {
-  if (frame != beforeFrame &&
-      frame >= 0 &&
-      frame <= sprite->lastFrame() &&
-      beforeFrame >= 0 &&
-      beforeFrame <= sprite->lastFrame()+1) {
-    // Change the frame-lengths.
-    int frlen_aux = sprite->frameDuration(frame);
-
-    // Moving the frame to the future.
-    if (frame < beforeFrame) {
-      for (frame_t c=frame; c<beforeFrame-1; ++c)
-        setFrameDuration(sprite, c, sprite->frameDuration(c+1));
-      setFrameDuration(sprite, beforeFrame-1, frlen_aux);
-    }
-    // Moving the frame to the past.
-    else if (beforeFrame < frame) {
-      for (frame_t c=frame; c>beforeFrame; --c)
-        setFrameDuration(sprite, c, sprite->frameDuration(c-1));
-      setFrameDuration(sprite, beforeFrame, frlen_aux);
-    }
-
-    adjustFrameTags(sprite, frame, -1, true);
-    adjustFrameTags(sprite, beforeFrame, +1, true);
-
-    // Change cel positions.
-    moveFrameLayer(sprite->folder(), frame, beforeFrame);
-  }
+  moveFrames(sprite, { std::make_pair(frame, beforeFrame) });
 }
 
-void DocumentApi::moveFrameLayer(Layer* layer, frame_t frame, frame_t beforeFrame)
+void DocumentApi::moveFrames(Sprite* sprite, const std::vector<std::pair<frame_t, frame_t>>& moves)
 {
-  ASSERT(layer);
-
-  switch (layer->type()) {
+  const frame_t total = sprite->totalFrames();
 
-    case ObjectType::LayerImage: {
-      LayerImage* imglayer = static_cast<LayerImage*>(layer);
+  // order[F] is the original frame that will be in the frame F
+  std::vector<frame_t> order(total);
+  std::iota(order.begin(), order.end(), frame_t(0));
 
-      CelList cels;
-      imglayer->getCels(cels);
+  struct TagRange {
+    FrameTag* tag;
+    frame_t from, to;
+    bool removed;
+  };
+  std::vector<TagRange> tags;
+  for (FrameTag* tag : sprite->frameTags())
+    tags.push_back(TagRange{ tag, tag->fromFrame(), tag->toFrame(), false });
 
-      CelIterator it = cels.begin();
-      CelIterator end = cels.end();
+  for (const auto& move : moves) {
+    const frame_t frame = move.first;
+    const frame_t beforeFrame = move.second;
+    if (frame == beforeFrame ||
+        frame < 0 || frame >= total ||
+        beforeFrame < 0 || beforeFrame > total)
+      continue;
 
-      for (; it != end; ++it) {
-        auto cel = *it;
-        frame_t celFrame = cel->frame();
-        frame_t newFrame = celFrame;
+    const frame_t moved = order[frame];
+    order.erase(order.begin()+frame);
+    order.insert(order.begin()+(frame < beforeFrame ? beforeFrame-1: beforeFrame), moved);
 
-        // moving the frame to the future
-        if (frame < beforeFrame) {
-          if (celFrame == frame) {
-            newFrame = beforeFrame-1;
-          }
-          else if (celFrame > frame &&
-                   celFrame < beforeFrame) {
-            --newFrame;
-          }
-        }
-        // moving the frame to the past
-        else if (beforeFrame < frame) {
-          if (celFrame == frame) {
-            newFrame = beforeFrame;
-          }
-          else if (celFrame >= beforeFrame &&
-                   celFrame < frame) {
-            ++newFrame;
-          }
-        }
+    // Same as adjustFrameTags(sprite, frame, -1, true) and
+    // adjustFrameTags(sprite, beforeFrame, +1, true)
+    for (TagRange& t : tags) {
+      if (t.removed)
+        continue;
 
-        if (celFrame != newFrame)
-          setCelFramePosition(cel, newFrame);
+      if (frame < t.from) { --t.from; }
+      if (frame <= t.to) { --t.to; }
+      if (t.from > t.to) {
+        t.removed = true;
+        continue;
       }
-      break;
-    }
-
-    case ObjectType::LayerFolder: {
-      LayerIterator it = static_cast<LayerFolder*>(layer)->getLayerBegin();
-      LayerIterator end = static_cast<LayerFolder*>(layer)->getLayerEnd();
 
-      for (; it != end; ++it)
-        moveFrameLayer(*it, frame, beforeFrame);
-      break;
+      if (beforeFrame <= t.from) { ++t.from; }
+      if (beforeFrame <= t.to+1) { ++t.to; }
     }
+  }
+
+  for (const TagRange& t : tags) {
+    if (t.removed)
+      m_transaction.execute(new cmd::RemoveFrameTag(sprite, t.tag));
+    else if (t.from != t.tag->fromFrame() ||
+             t.to != t.tag->toFrame())
+      m_transaction.execute(new cmd::SetFrameTagRange(t.tag, t.from, t.to));
+  }
 
+  // Change frame durations and cel positions.
+  std::vector<frame_t> newFrames(total);
+  bool changed = false;
+  for (frame_t frame=0; frame<total; ++frame) {
+    newFrames[order[frame]] = frame;
+    if (order[frame] != frame)
+      changed = true;
   }
+  if (changed)
+    m_transaction.execute(new cmd::PermuteFrames(sprite, newFrames));
 }
 
 void DocumentApi::addCel(LayerImage* layer, std::shared_ptr<Cel> cel)
@@ -498,6 +500,22 @@ void DocumentApi::replaceImage(Sprite* sprite, const ImageRef& oldImage, const I
       sprite, oldImage, newImage));
 }
 
+void DocumentApi::replaceImages(Sprite* sprite,
+                                const std::vector<ImageRef>& oldImages,
+                                const std::vector<ImageRef>& newImages)
+{
+  ASSERT(oldImages.size() == newImages.size());
+  if (oldImages.empty())
+    return;
+
+  auto cmd = new cmd::ReplaceImages(sprite);
+  for (std::size_t i=0; i<oldImages.size(); ++i) {
+    ASSERT(oldImages[i]->maskColor() == newImages[i]->maskColor());
+    cmd->add(oldImages[i], newImages[i]);
+  }
+  m_transaction.execute(cmd);
+}
+
 void DocumentApi::flipImage(Image* image, const gfx::Rect& bounds,
   doc::algorithm::FlipType flipType)
 {
@@ -15,6 +15,9 @@
 #include "doc/pixel_format.h"
 #include "gfx/rect.h"
 
+#include <utility>
+#include <vector>
+
 namespace doc {
   class Cel;
   class Image;
@@ -57,6 +60,9 @@ namespace app {
     void setFrameDuration(Sprite* sprite, frame_t frame, int msecs);
     void setFrameRangeDuration(Sprite* sprite, frame_t from, frame_t to, int msecs);
     void moveFrame(Sprite* sprite, frame_t frame, frame_t beforeFrame);
+    // Same as calling moveFrame() for each (frame, beforeFrame) pair,
+    // but the cels and durations are reordered with just one command.
+    void moveFrames(Sprite* sprite, const std::vector<std::pair<frame_t, frame_t>>& moves);
 
     // Cels API
     void addCel(LayerImage* layer, std::shared_ptr<Cel> cel);
@@ -92,6 +98,10 @@ namespace app {
 
     // Images API
     void replaceImage(Sprite* sprite, const ImageRef& oldImage, const ImageRef& newImage);
+    // Replaces oldImages[i] with newImages[i] in one undo record.
+    void replaceImages(Sprite* sprite,
+                       const std::vector<ImageRef>& oldImages,
+                       const std::vector<ImageRef>& newImages);
 
     // Image API
     void flipImage(Image* image, const gfx::Rect& bounds, doc::algorithm::FlipType flipType);
@@ -106,7 +116,6 @@ namespace app {
 
   private:
     void setCelFramePosition(std::shared_ptr<Cel> cel, frame_t frame);
-    void moveFrameLayer(Layer* layer, frame_t frame, frame_t beforeFrame);
     void adjustFrameTags(Sprite* sprite, frame_t frame, frame_t delta, bool between);
 
     Document* m_document;
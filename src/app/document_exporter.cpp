@@ -22,56 +22,55 @@
 #include "base/convert_to.h"
 #include "base/fstream_path.h"
 #include "base/path.h"
-#include "base/replace_string.h"
+#include "base/serialization.h"
+#include "base/json_writer.h"
 #include "base/shared_ptr.h"
 #include "base/string.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/dithering_method.h"
 #include "doc/frame_tag.h"
+#include "doc/identical_cels.h"
+#include "doc/image_hash.h"
 #include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
+#include "gfx/max_rects_packing.h"
 #include "gfx/packing_rects.h"
 #include "gfx/size.h"
 #include "render/render.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
 
 using namespace doc;
 
 namespace {
 
-std::string escape_for_json(const std::string& path)
-{
-  std::string res = path;
-  base::replace_string(res, "\\", "\\\\");
-  base::replace_string(res, "\"", "\\\"");
-  return res;
-}
-
-std::ostream& operator<<(std::ostream& os, const doc::UserData& data)
+void write_user_data(base::json_writer& w, const doc::UserData& data)
 {
   doc::color_t color = data.color();
   if (doc::rgba_geta(color)) {
-    os << ", \"color\": \"#"
-       << std::hex << std::setfill('0')
-       << std::setw(2) << (int)doc::rgba_getr(color)
-       << std::setw(2) << (int)doc::rgba_getg(color)
-       << std::setw(2) << (int)doc::rgba_getb(color)
-       << std::setw(2) << (int)doc::rgba_geta(color)
-       << std::dec
-       << "\"";
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "#%02x%02x%02x%02x",
+                  (int)doc::rgba_getr(color),
+                  (int)doc::rgba_getg(color),
+                  (int)doc::rgba_getb(color),
+                  (int)doc::rgba_geta(color));
+    w.member("color", buf);
   }
   if (!data.text().empty())
-    os << ", \"data\": \"" << escape_for_json(data.text()) << "\"";
-  return os;
+    w.member("data", data.text());
 }
 
 } // anonymous namespace
@@ -83,7 +82,8 @@ public:
   SampleBounds(Sprite* sprite) :
     m_originalSize(sprite->width(), sprite->height()),
     m_trimmedBounds(0, 0, sprite->width(), sprite->height()),
-    m_inTextureBounds(0, 0, sprite->width(), sprite->height()) {
+    m_inTextureBounds(0, 0, sprite->width(), sprite->height()),
+    m_rotated(false) {
   }
 
   bool trimmed() const {
@@ -97,13 +97,19 @@ public:
   const gfx::Rect& trimmedBounds() const { return m_trimmedBounds; }
   const gfx::Rect& inTextureBounds() const { return m_inTextureBounds; }
 
+  // True if the sample is rotated 90 degrees clockwise in the texture
+  // (inTextureBounds() has the rotated size).
+  bool rotated() const { return m_rotated; }
+
   void setTrimmedBounds(const gfx::Rect& bounds) { m_trimmedBounds = bounds; }
   void setInTextureBounds(const gfx::Rect& bounds) { m_inTextureBounds = bounds; }
+  void setRotated(bool rotated) { m_rotated = rotated; }
 
 private:
   gfx::Size m_originalSize;
   gfx::Rect m_trimmedBounds;
   gfx::Rect m_inTextureBounds;
+  bool m_rotated;
 };
 
 typedef base::SharedPtr<SampleBounds> SampleBoundsPtr;
@@ -156,6 +162,7 @@ public:
   const gfx::Size& originalSize() const { return m_bounds->originalSize(); }
   const gfx::Rect& trimmedBounds() const { return m_bounds->trimmedBounds(); }
   const gfx::Rect& inTextureBounds() const { return m_bounds->inTextureBounds(); }
+  bool rotated() const { return m_bounds->rotated(); }
 
   gfx::Size requiredSize() const {
     gfx::Size size = m_bounds->trimmedBounds().size();
@@ -170,6 +177,7 @@ public:
 
   void setTrimmedBounds(const gfx::Rect& bounds) { m_bounds->setTrimmedBounds(bounds); }
   void setInTextureBounds(const gfx::Rect& bounds) { m_bounds->setInTextureBounds(bounds); }
+  void setRotated(bool rotated) { m_bounds->setRotated(rotated); }
 
   bool isDuplicated() const { return m_isDuplicated; }
   SampleBoundsPtr sharedBounds() const { return m_bounds; }
@@ -201,6 +209,7 @@ public:
   typedef List::const_iterator const_iterator;
 
   bool empty() const { return m_samples.empty(); }
+  std::size_t size() const { return m_samples.size(); }
 
   void addSample(const Sample& sample) {
     m_samples.push_back(sample);
@@ -431,6 +440,55 @@ public:
   }
 };
 
+class DocumentExporter::MaxRectsLayoutSamples :
+    public DocumentExporter::LayoutSamples {
+public:
+  MaxRectsLayoutSamples(bool allowRotation)
+    : m_allowRotation(allowRotation) {
+  }
+
+  void layoutSamples(Samples& samples, int borderPadding, int shapePadding, int& width, int& height) override {
+    gfx::MaxRectsPacking mr;
+    mr.setAllowRotation(m_allowRotation);
+
+    // The shape padding is added at the right/bottom side of each
+    // sample (it can be outside the texture for the last ones)
+    for (auto& sample : samples) {
+      if (sample.isDuplicated())
+        continue;
+
+      gfx::Size size = sample.requiredSize();
+      mr.add(gfx::Size(size.w+shapePadding, size.h+shapePadding));
+    }
+
+    if (width == 0 || height == 0) {
+      gfx::Size sz = mr.bestFit();
+      width = sz.w + 2*borderPadding;
+      height = sz.h + 2*borderPadding;
+    }
+    else
+      mr.pack(gfx::Size(width - 2*borderPadding + shapePadding,
+                        height - 2*borderPadding + shapePadding));
+
+    int i = 0;
+    for (auto& sample : samples) {
+      if (sample.isDuplicated())
+        continue;
+
+      gfx::Rect rc = mr[i];
+      rc.offset(borderPadding, borderPadding);
+      rc.w -= shapePadding;
+      rc.h -= shapePadding;
+      sample.setInTextureBounds(rc);
+      sample.setRotated(mr.isRotated(i));
+      ++i;
+    }
+  }
+
+private:
+  bool m_allowRotation;
+};
+
 DocumentExporter::DocumentExporter()
  : m_dataFormat(DefaultDataFormat)
  , m_textureFormat(DefaultTextureFormat)
@@ -445,8 +503,10 @@ DocumentExporter::DocumentExporter()
  , m_shapePadding(0)
  , m_innerPadding(0)
  , m_trimCels(false)
+ , m_allowRotation(false)
  , m_listFrameTags(false)
  , m_listLayers(false)
+ , m_compactData(false)
 {
 }
 
@@ -485,6 +545,13 @@ Document* DocumentExporter::exportSheet()
         m_textureWidth, m_textureHeight);
       break;
     }
+    case SpriteSheetType::MaxRects: {
+      MaxRectsLayoutSamples layout(m_allowRotation);
+      layout.layoutSamples(
+        samples, m_borderPadding, m_shapePadding,
+        m_textureWidth, m_textureHeight);
+      break;
+    }
     default: {
       if(m_perTag){
         PerTagLayoutSamples layout(m_sheetType);
@@ -510,11 +577,25 @@ Document* DocumentExporter::exportSheet()
   Image* textureImage = texture->folder()->getFirstLayer()
     ->cel(frame_t(0))->image();
 
-  renderTexture(samples, textureImage);
-
-  // Save the metadata.
-  if (osbuf)
-    createDataFile(samples, os, textureImage);
+  convertSamples(samples, textureImage);
+
+  // Save the metadata while the texture is rendered (the data only
+  // depends on the layout and the texture size).
+  std::ofstream bos;
+  if (!m_dataBinaryFilename.empty())
+    bos.open(FSTREAM_PATH(m_dataBinaryFilename), std::ios::out | std::ios::binary);
+
+  base::thread_pool& pool = base::thread_pool::instance();
+  pool.parallel_for(2, [&](int i) {
+    if (i == 0) {
+      if (osbuf)
+        createDataFile(samples, os, textureImage);
+      if (bos.is_open())
+        createBinaryDataFile(samples, bos, textureImage);
+    }
+    else
+      renderTexture(samples, textureImage);
+  });
 
   // Save the image files.
   if (!m_textureFilename.empty()) {
@@ -529,6 +610,26 @@ Document* DocumentExporter::exportSheet()
 
 void DocumentExporter::captureSamples(Samples& samples)
 {
+  // Samples are collected in three passes: first we decide which
+  // ones re-use the bounds of a previous sample (linked or identical
+  // cels), then the other ones are rendered, trimmed and hashed in
+  // parallel (which is the slowest part for big sprite sheets), and
+  // finally samples with the same pixels share one texture rect.
+  struct Candidate {
+    Candidate(const Sample& sample) : sample(sample) { }
+    Sample sample;
+    int source = -1;            // Candidate with the shared bounds
+    bool trim = false;          // It must be trimmed
+    bool useBgColor = false;    // Trim the background color (or the transparent color)
+    bool empty = false;
+    uint64_t hash = 0;          // Hash of the trimmed pixels
+  };
+  std::vector<Candidate> candidates;
+
+  // Cels of the added samples to re-use their samples for identical
+  // cels that aren't linked.
+  IdenticalCels identicalCels;
+
   for (auto& item : m_documents) {
     Document* doc = item.doc;
     Sprite* sprite = doc->sprite();
@@ -567,7 +668,7 @@ void DocumentExporter::captureSamples(Samples& samples)
 
       std::string filename = filename_formatter(format, fnInfo);
 
-      Sample sample(doc, sprite, layer, frame, filename, m_innerPadding);
+      Candidate candidate(Sample(doc, sprite, layer, frame, filename, m_innerPadding));
       std::shared_ptr<Cel> cel;
       std::shared_ptr<Cel> link;
       bool done = false;
@@ -575,18 +676,23 @@ void DocumentExporter::captureSamples(Samples& samples)
       if (layer && layer->isImage())
         cel = layer->cel(frame);
 
-      if (cel)
+      if (cel) {
         link = cel->link();
+        if (!link)
+          link = identicalCels.find(cel);
+      }
 
       // Re-use linked samples
       if (link) {
-        for (const Sample& other : samples) {
+        for (int i=0; i<int(candidates.size()); ++i) {
+          const Sample& other = candidates[i].sample;
           if (other.sprite() == sprite &&
               other.layer() == layer &&
               other.frame() == link->frame()) {
             ASSERT(!other.isDuplicated());
 
-            sample.setSharedBounds(other.sharedBounds());
+            candidate.sample.setSharedBounds(other.sharedBounds());
+            candidate.source = i;
             done = true;
             break;
           }
@@ -601,47 +707,164 @@ void DocumentExporter::captureSamples(Samples& samples)
         if (layer && layer->isImage() && !cel)
           continue;
 
-        std::unique_ptr<Image> sampleRender(
-          Image::create(sprite->pixelFormat(),
-            sprite->width(),
-            sprite->height(),
-            m_sampleRenderBuf));
+        candidate.trim = true;
+        candidate.useBgColor =
+          (m_trimCels &&
+           ((layer &&
+             layer->isBackground()) ||
+            (!layer &&
+             sprite->backgroundLayer() &&
+             sprite->backgroundLayer()->isVisible())));
+      }
 
-        sampleRender->setMaskColor(sprite->transparentColor());
-        clear_image(sampleRender.get(), sprite->transparentColor());
-        renderSample(sample, sampleRender.get(), 0, 0);
+      candidates.push_back(candidate);
+      if (cel && !candidate.sample.isDuplicated())
+        identicalCels.add(cel);
+    }
+  }
 
-        gfx::Rect frameBounds;
-        doc::color_t refColor = 0;
-
-        if (m_trimCels) {
-          if ((layer &&
-               layer->isBackground()) ||
-              (!layer &&
-               sprite->backgroundLayer() &&
-               sprite->backgroundLayer()->isVisible())) {
-            refColor = get_pixel(sampleRender.get(), 0, 0);
-          }
-          else {
-            refColor = sprite->transparentColor();
-          }
-        }
-        else if (m_ignoreEmptyCels)
-          refColor = sprite->transparentColor();
+  // Render, trim and hash samples in parallel
+  std::vector<int> rendered;
+  for (int i=0; i<int(candidates.size()); ++i)
+    if (candidates[i].source < 0)
+      rendered.push_back(i);
 
+  base::thread_pool::instance().parallel_for(
+    int(rendered.size()),
+    [this, &candidates, &rendered](int i) {
+      Candidate& candidate = candidates[rendered[i]];
+      Sprite* sprite = candidate.sample.sprite();
+
+      std::unique_ptr<Image> sampleRender(
+        Image::create(sprite->pixelFormat(),
+                      sprite->width(),
+                      sprite->height()));
+
+      sampleRender->setMaskColor(sprite->transparentColor());
+      clear_image(sampleRender.get(), sprite->transparentColor());
+      renderSample(candidate.sample, sampleRender.get(), 0, 0);
+
+      if (candidate.trim) {
+        doc::color_t refColor =
+          (candidate.useBgColor ? get_pixel(sampleRender.get(), 0, 0):
+                                  sprite->transparentColor());
+
+        gfx::Rect frameBounds;
         if (!algorithm::shrink_bounds(sampleRender.get(), frameBounds, refColor)) {
           // If shrink_bounds() returns false, it's because the whole
           // image is transparent (equal to the mask color).
-          continue;
+          candidate.empty = true;
+          return;
         }
+        else if (m_trimCels)
+          candidate.sample.setTrimmedBounds(frameBounds);
+      }
+
+      const gfx::Rect& bounds = candidate.sample.trimmedBounds();
+      if (bounds == sampleRender->bounds())
+        candidate.hash = calculate_image_hash(sampleRender.get());
+      else {
+        std::unique_ptr<Image> trimmedRender(
+          crop_image(sampleRender.get(), bounds, sprite->transparentColor()));
+        candidate.hash = calculate_image_hash(trimmedRender.get());
+      }
+    });
+
+  // Samples with the same pixels (and trimmed bounds) share the
+  // texture rect of the first one. The candidates with the same hash
+  // are rendered again to compare their pixels (in parallel, one
+  // group of candidates by job).
+  struct Group {
+    int first;
+    std::vector<int> others;
+    std::vector<char> same;
+  };
+  std::vector<Group> groups;
+  std::unordered_map<uint64_t, int> groupByKey;
+
+  for (int i : rendered) {
+    const Candidate& candidate = candidates[i];
+    if (candidate.empty)
+      continue;
+
+    const Sample& sample = candidate.sample;
+    const gfx::Rect& bounds = sample.trimmedBounds();
+    uint64_t key = candidate.hash;
+    key ^= uint64_t(reinterpret_cast<uintptr_t>(sample.sprite())) * 0x9e3779b97f4a7c15ULL;
+    key ^= (uint64_t(uint32_t(bounds.x)) << 32) ^ uint32_t(bounds.y);
+
+    auto it = groupByKey.find(key);
+    if (it == groupByKey.end()) {
+      groupByKey[key] = int(groups.size());
+      groups.push_back(Group{ i, { }, { } });
+      continue;
+    }
+
+    // Indexed samples are rendered with the palette of their frame
+    const Sample& first = candidates[groups[it->second].first].sample;
+    if (first.sprite() == sample.sprite() &&
+        first.trimmedBounds() == bounds &&
+        first.sprite()->palette(first.frame()) == sample.sprite()->palette(sample.frame()))
+      groups[it->second].others.push_back(i);
+  }
 
-        if (m_trimCels)
-          sample.setTrimmedBounds(frameBounds);
+  auto renderTrimmed = [this](const Sample& sample) {
+    Sprite* sprite = sample.sprite();
+    const gfx::Size size = sample.trimmedBounds().size();
+    std::unique_ptr<Image> image(
+      Image::create(sprite->pixelFormat(), size.w, size.h));
+    image->setMaskColor(sprite->transparentColor());
+    clear_image(image.get(), sprite->transparentColor());
+    renderSample(sample, image.get(), 0, 0);
+    return image;
+  };
+
+  std::vector<Group*> compared;
+  for (Group& group : groups)
+    if (!group.others.empty())
+      compared.push_back(&group);
+
+  base::thread_pool::instance().parallel_for(
+    int(compared.size()),
+    [&candidates, &compared, &renderTrimmed](int i) {
+      Group& group = *compared[i];
+      std::unique_ptr<Image> first = renderTrimmed(candidates[group.first].sample);
+
+      group.same.resize(group.others.size());
+      for (std::size_t j=0; j<group.others.size(); ++j) {
+        std::unique_ptr<Image> other = renderTrimmed(candidates[group.others[j]].sample);
+        group.same[j] = is_same_image(first.get(), other.get());
       }
+    });
 
-      samples.addSample(sample);
+  std::vector<int> mergedWith(candidates.size(), -1);
+  for (Group* group : compared) {
+    for (std::size_t j=0; j<group->others.size(); ++j) {
+      if (group->same[j])
+        mergedWith[group->others[j]] = group->first;
     }
   }
+
+  for (int i=0; i<int(candidates.size()); ++i) {
+    Candidate& candidate = candidates[i];
+    int source = (candidate.source >= 0 ? candidate.source: i);
+    if (mergedWith[source] < 0)
+      continue;
+
+    // Samples linked with a merged one are merged too
+    candidate.source = mergedWith[source];
+    candidate.sample.setSharedBounds(
+      candidates[candidate.source].sample.sharedBounds());
+  }
+
+  for (const Candidate& candidate : candidates) {
+    // Empty samples (and the ones that share their bounds) are ignored
+    if (candidate.empty ||
+        (candidate.source >= 0 && candidates[candidate.source].empty))
+      continue;
+
+    samples.addSample(candidate.sample);
+  }
 }
 
 Document* DocumentExporter::createEmptyTexture(const Samples& samples)
@@ -702,10 +925,8 @@ Document* DocumentExporter::createEmptyTexture(const Samples& samples)
   return new Document(sprite.release());
 }
 
-void DocumentExporter::renderTexture(const Samples& samples, Image* textureImage)
+void DocumentExporter::convertSamples(const Samples& samples, Image* textureImage)
 {
-  textureImage->clear(0);
-
   for (const auto& sample : samples) {
     if (sample.isDuplicated())
       continue;
@@ -718,122 +939,162 @@ void DocumentExporter::renderTexture(const Samples& samples, Image* textureImage
         textureImage->pixelFormat(),
         DitheringMethod::NONE).execute(UIContext::instance());
     }
+  }
+}
+
+void DocumentExporter::renderTexture(const Samples& samples, Image* textureImage)
+{
+  textureImage->clear(0);
 
-    renderSample(sample, textureImage,
-      sample.inTextureBounds().x+m_innerPadding,
-      sample.inTextureBounds().y+m_innerPadding);
+  std::vector<const Sample*> rendered;
+  for (const auto& sample : samples) {
+    if (!sample.isDuplicated())
+      rendered.push_back(&sample);
   }
+
+  // Each sample is rendered in its own (disjoint) rect of the texture
+  base::thread_pool::instance().parallel_for(
+    int(rendered.size()),
+    [this, &rendered, textureImage](int i) {
+      const Sample& sample = *rendered[i];
+      const int x = sample.inTextureBounds().x+m_innerPadding;
+      const int y = sample.inTextureBounds().y+m_innerPadding;
+
+      if (sample.rotated()) {
+        // Render the sample unrotated and then rotate it 90 degrees
+        // clockwise into the texture
+        const gfx::Size size = sample.trimmedBounds().size();
+        std::unique_ptr<Image> sampleImage(
+          Image::create(textureImage->pixelFormat(), size.w, size.h));
+        std::unique_ptr<Image> rotatedImage(
+          Image::create(textureImage->pixelFormat(), size.h, size.w));
+        sampleImage->clear(0);
+        renderSample(sample, sampleImage.get(), 0, 0);
+        doc::rotate_image(sampleImage.get(), rotatedImage.get(), 90);
+        copy_image(textureImage, rotatedImage.get(), x, y);
+      }
+      else
+        renderSample(sample, textureImage, x, y);
+    });
 }
 
 void DocumentExporter::createDataFile(const Samples& samples, std::ostream& os, Image* textureImage)
 {
-  std::string frames_begin;
-  std::string frames_end;
-  bool filename_as_key = false;
-  bool filename_as_attr = false;
+  base::json_writer w(os, !m_compactData);
+  w.begin_object();
 
-  // TODO we should use some string templates system here
+  w.key("frames");
   switch (m_dataFormat) {
-    case JsonHashDataFormat:
-      frames_begin = "{";
-      frames_end = "}";
-      filename_as_key = true;
-      filename_as_attr = false;
-      break;
-    case JsonArrayDataFormat:
-      frames_begin = "[";
-      frames_end = "]";
-      filename_as_key = false;
-      filename_as_attr = true;
-      break;
+    case JsonHashDataFormat: w.begin_object(); break;
+    case JsonArrayDataFormat: w.begin_array(); break;
   }
 
-  os << "{ \"frames\": " << frames_begin << "\n";
-  for (Samples::const_iterator
-         it = samples.begin(),
-         end = samples.end(); it != end; ) {
-    const Sample& sample = *it;
+  for (const Sample& sample : samples) {
     gfx::Size srcSize = sample.originalSize();
     gfx::Rect spriteSourceBounds = sample.trimmedBounds();
     gfx::Rect frameBounds = sample.inTextureBounds();
 
-    if (filename_as_key)
-      os << "   \"" << escape_for_json(sample.filename()) << "\": {\n";
-    else if (filename_as_attr)
-      os << "   {\n"
-         << "    \"filename\": \"" << escape_for_json(sample.filename()) << "\",\n";
-
-    os << "    \"frame\": { "
-       << "\"x\": " << frameBounds.x << ", "
-       << "\"y\": " << frameBounds.y << ", "
-       << "\"w\": " << frameBounds.w << ", "
-       << "\"h\": " << frameBounds.h << " },\n"
-       << "    \"rotated\": false,\n"
-       << "    \"trimmed\": " << (sample.trimmed() ? "true": "false") << ",\n"
-       << "    \"spriteSourceSize\": { "
-       << "\"x\": " << spriteSourceBounds.x << ", "
-       << "\"y\": " << spriteSourceBounds.y << ", "
-       << "\"w\": " << spriteSourceBounds.w << ", "
-       << "\"h\": " << spriteSourceBounds.h << " },\n"
-       << "    \"sourceSize\": { "
-       << "\"w\": " << srcSize.w << ", "
-       << "\"h\": " << srcSize.h << " },\n"
-       << "    \"duration\": " << sample.sprite()->frameDuration(sample.frame()) << "\n"
-       << "   }";
-
-    if (++it != samples.end())
-      os << ",\n";
-    else
-      os << "\n";
+    // The frame size of rotated samples is the unrotated one
+    if (sample.rotated())
+      std::swap(frameBounds.w, frameBounds.h);
+
+    if (m_dataFormat == JsonHashDataFormat)
+      w.key(sample.filename());
+    w.begin_object();
+    if (m_dataFormat == JsonArrayDataFormat)
+      w.member("filename", sample.filename());
+
+    w.key("frame");
+    w.begin_object(true);
+    w.member("x", frameBounds.x);
+    w.member("y", frameBounds.y);
+    w.member("w", frameBounds.w);
+    w.member("h", frameBounds.h);
+    w.end_object();
+
+    w.member("rotated", sample.rotated());
+    w.member("trimmed", sample.trimmed());
+
+    w.key("spriteSourceSize");
+    w.begin_object(true);
+    w.member("x", spriteSourceBounds.x);
+    w.member("y", spriteSourceBounds.y);
+    w.member("w", spriteSourceBounds.w);
+    w.member("h", spriteSourceBounds.h);
+    w.end_object();
+
+    w.key("sourceSize");
+    w.begin_object(true);
+    w.member("w", srcSize.w);
+    w.member("h", srcSize.h);
+    w.end_object();
+
+    w.member("duration", sample.sprite()->frameDuration(sample.frame()));
+    w.end_object();
+  }
+
+  switch (m_dataFormat) {
+    case JsonHashDataFormat: w.end_object(); break;
+    case JsonArrayDataFormat: w.end_array(); break;
   }
-  os << " " << frames_end;
 
   // "meta" property
-  os << ",\n"
-     << " \"meta\": {\n"
-     << "  \"app\": \"" << WEBSITE << "\",\n"
-     << "  \"version\": \"" << VERSION << "\",\n";
+  w.key("meta");
+  w.begin_object();
+  w.member("app", WEBSITE);
+  w.member("version", VERSION);
 
   if (!m_textureFilename.empty())
-    os << "  \"image\": \"" << escape_for_json(m_textureFilename).c_str() << "\",\n";
-
-  os << "  \"format\": \"" << (textureImage->pixelFormat() == IMAGE_RGB ? "RGBA8888": "I8") << "\",\n"
-     << "  \"size\": { "
-     << "\"w\": " << textureImage->width() << ", "
-     << "\"h\": " << textureImage->height() << " },\n"
-     << "  \"scale\": \"" << m_scale << "\"";
+    w.member("image", m_textureFilename);
+
+  w.member("format", (textureImage->pixelFormat() == IMAGE_RGB ? "RGBA8888": "I8"));
+  w.key("size");
+  w.begin_object(true);
+  w.member("w", textureImage->width());
+  w.member("h", textureImage->height());
+  w.end_object();
+
+  std::ostringstream scale;
+  scale << m_scale;
+  w.member("scale", scale.str());
+
+  // meta.efficiency (used texture area)
+  if (m_sheetType == SpriteSheetType::MaxRects) {
+    double area = 0.0;
+    for (const auto& sample : samples) {
+      if (!sample.isDuplicated())
+        area += double(sample.inTextureBounds().w) * sample.inTextureBounds().h;
+    }
+    w.member("efficiency",
+             area / (double(textureImage->width()) * textureImage->height()));
+  }
 
   // meta.frameTags
   if (m_listFrameTags) {
-    os << ",\n"
-       << "  \"frameTags\": [";
+    w.key("frameTags");
+    w.begin_array();
 
-    bool firstTag = true;
     for (auto& item : m_documents) {
       Document* doc = item.doc;
       Sprite* sprite = doc->sprite();
 
       for (FrameTag* tag : sprite->frameTags()) {
-        if (firstTag)
-          firstTag = false;
-        else
-          os << ",";
-
-        os << "\n   { \"name\": \"" << escape_for_json(tag->name()) << "\","
-           << " \"from\": " << tag->fromFrame() << ","
-           << " \"to\": " << tag->toFrame() << ","
-           << " \"direction\": \"" << escape_for_json(convert_to_string(tag->aniDir())) << "\" }";
+        w.begin_object(true);
+        w.member("name", tag->name());
+        w.member("from", tag->fromFrame());
+        w.member("to", tag->toFrame());
+        w.member("direction", convert_to_string(tag->aniDir()));
+        w.end_object();
       }
     }
-    os << "\n  ]";
+    w.end_array();
   }
 
   // meta.layers
   if (m_listLayers) {
-    os << ",\n"
-       << "  \"layers\": [";
+    w.key("layers");
+    w.begin_array();
 
-    bool firstLayer = true;
     for (auto& item : m_documents) {
       Document* doc = item.doc;
       Sprite* sprite = doc->sprite();
@@ -842,16 +1103,13 @@ void DocumentExporter::createDataFile(const Samples& samples, std::ostream& os,
       sprite->getLayersList(layers);
 
       for (Layer* layer : layers) {
-        if (firstLayer)
-          firstLayer = false;
-        else
-          os << ",";
-        os << "\n   { \"name\": \"" << escape_for_json(layer->name()) << "\"";
+        w.begin_object(true);
+        w.member("name", layer->name());
         if (LayerImage* layerImg = dynamic_cast<LayerImage*>(layer)) {
-          os << ", \"opacity\": " << layerImg->opacity()
-             << ", \"blendMode\": \"" << blend_mode_to_string(layerImg->blendMode()) << "\"";
+          w.member("opacity", layerImg->opacity());
+          w.member("blendMode", blend_mode_to_string(layerImg->blendMode()));
         }
-        os << layer->userData();
+        write_user_data(w, layer->userData());
 
         // Cels
         CelList cels;
@@ -865,37 +1123,75 @@ void DocumentExporter::createDataFile(const Samples& samples, std::ostream& os,
         }
 
         if (someCelWithData) {
-          bool firstCel = true;
-
-          os << ", \"cels\": [";
+          w.key("cels");
+          w.begin_array();
           for (auto cel : cels) {
             if (!cel->data()->userData().isEmpty()) {
-              if (firstCel)
-                firstCel = false;
-              else
-                os << ", ";
-
-              os << "{ \"frame\": " << cel->frame()
-                 << cel->data()->userData()
-                 << " }";
+              w.begin_object();
+              w.member("frame", cel->frame());
+              write_user_data(w, cel->data()->userData());
+              w.end_object();
             }
           }
-          os << "]";
+          w.end_array();
         }
 
-        os << " }";
+        w.end_object();
       }
     }
-    os << "\n  ]";
+    w.end_array();
+  }
+
+  w.end_object();               // meta
+  w.end_object();
+}
+
+void DocumentExporter::createBinaryDataFile(const Samples& samples, std::ostream& os, Image* textureImage)
+{
+  base::serialization::buffer_writer buf(32 + 64*samples.size());
+
+  buf.write("LSSB", 4);
+  buf.write16(1);               // Version
+  buf.write16(0);               // Reserved flags
+  buf.write32(textureImage->width());
+  buf.write32(textureImage->height());
+  buf.write32(uint32_t(samples.size()));
+
+  for (const Sample& sample : samples) {
+    gfx::Size srcSize = sample.originalSize();
+    gfx::Rect spriteSourceBounds = sample.trimmedBounds();
+    gfx::Rect frameBounds = sample.inTextureBounds();
+
+    if (sample.rotated())
+      std::swap(frameBounds.w, frameBounds.h);
+
+    const std::string& filename = sample.filename();
+    const uint32_t values[11] = {
+      uint32_t(frameBounds.x), uint32_t(frameBounds.y),
+      uint32_t(frameBounds.w), uint32_t(frameBounds.h),
+      uint32_t(spriteSourceBounds.x), uint32_t(spriteSourceBounds.y),
+      uint32_t(spriteSourceBounds.w), uint32_t(spriteSourceBounds.h),
+      uint32_t(srcSize.w), uint32_t(srcSize.h),
+      uint32_t(sample.sprite()->frameDuration(sample.frame()))
+    };
+    buf.write32_array(values, 11);
+    buf.write8((sample.rotated() ? 1: 0) |
+               (sample.trimmed() ? 2: 0));
+    buf.write16(uint16_t(std::min<std::size_t>(filename.size(), 0xffff)));
+    buf.write(filename.c_str(), std::min<std::size_t>(filename.size(), 0xffff));
+
+    // Write big sheets in pieces
+    if (buf.size() >= 64*1024)
+      buf.flush_to(os);
   }
 
-  os << "\n }\n"
-     << "}\n";
+  buf.flush_to(os);
 }
 
 void DocumentExporter::renderSample(const Sample& sample, doc::Image* dst, int x, int y)
 {
   render::Render render;
+  render.setParallel(true);
   gfx::Clip clip(x, y, sample.trimmedBounds());
 
   if (sample.layer()) {
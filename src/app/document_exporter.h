@@ -11,7 +11,6 @@
 
 #include "app/sprite_sheet_type.h"
 #include "base/disable_copying.h"
-#include "doc/image_buffer.h"
 #include "gfx/fwd.h"
 
 #include <iosfwd>
@@ -46,8 +45,24 @@ namespace app {
 
     DocumentExporter();
 
+    // The binary data file (setDataBinaryFilename()) is a sidecar
+    // for game engines with the frames of the JSON data (all values
+    // are little-endian):
+    //
+    //   "LSSB", uint16 version (1), uint16 flags (0)
+    //   uint32 texture width, uint32 texture height
+    //   uint32 number of frames, and for each frame:
+    //     int32 x, y, w, h (frame in the texture)
+    //     int32 x, y, w, h (spriteSourceSize)
+    //     int32 w, h (sourceSize)
+    //     int32 duration
+    //     uint8 flags (1=rotated, 2=trimmed)
+    //     uint16 filename length, UTF-8 filename
+
     void setDataFormat(DataFormat format) { m_dataFormat = format; }
     void setDataFilename(const std::string& filename) { m_dataFilename = filename; }
+    void setDataBinaryFilename(const std::string& filename) { m_dataBinaryFilename = filename; }
+    void setCompactData(bool compact) { m_compactData = compact; }
     void setTextureFormat(TextureFormat format) { m_textureFormat = format; }
     void setTextureFilename(const std::string& filename) { m_textureFilename = filename; }
     void setTextureWidth(int width) { m_textureWidth = width; }
@@ -61,6 +76,7 @@ namespace app {
     void setShapePadding(int padding) { m_shapePadding = padding; }
     void setInnerPadding(int padding) { m_innerPadding = padding; }
     void setTrimCels(bool trim) { m_trimCels = trim; }
+    void setAllowRotation(bool rotation) { m_allowRotation = rotation; }
     void setFilenameFormat(const std::string& format) { m_filenameFormat = format; }
     void setListFrameTags(bool value) { m_listFrameTags = value; }
     void setListLayers(bool value) { m_listLayers = value; }
@@ -81,11 +97,14 @@ namespace app {
     class SimpleLayoutSamples;
     class PerTagLayoutSamples;
     class BestFitLayoutSamples;
+    class MaxRectsLayoutSamples;
 
     void captureSamples(Samples& samples);
     Document* createEmptyTexture(const Samples& samples);
+    void convertSamples(const Samples& samples, doc::Image* textureImage);
     void renderTexture(const Samples& samples, doc::Image* textureImage);
     void createDataFile(const Samples& samples, std::ostream& os, doc::Image* textureImage);
+    void createBinaryDataFile(const Samples& samples, std::ostream& os, doc::Image* textureImage);
     void renderSample(const Sample& sample, doc::Image* dst, int x, int y);
 
     class Item {
@@ -124,11 +143,13 @@ namespace app {
     int m_shapePadding;
     int m_innerPadding;
     bool m_trimCels;
+    bool m_allowRotation;
     Items m_documents;
     std::string m_filenameFormat;
-    doc::ImageBufferPtr m_sampleRenderBuf;
     bool m_listFrameTags;
     bool m_listLayers;
+    bool m_compactData;
+    std::string m_dataBinaryFilename;
 
     DISABLE_COPYING(DocumentExporter);
   };
@@ -91,9 +91,8 @@ static DocumentRange drop_range_op(
     Transaction transaction(writer.context(), undoLabel, ModifyDocument);
     DocumentApi api = doc->getApi(transaction);
 
-    // TODO Try to add the range with just one call to DocumentApi
-    // methods, to avoid generating a lot of SetCelFrame undoers (see
-    // DocumentApi::setCelFramePosition).
+    // TODO Try to move/copy cels and layers with just one call to
+    // DocumentApi methods too (frames are moved with moveFrames()).
 
     switch (from.type()) {
 
@@ -242,16 +241,22 @@ static DocumentRange drop_range_op(
               break;
           }
 
+          // All moved frames are reordered with one command
+          std::vector<std::pair<frame_t, frame_t>> moves;
+
           for (frame_t srcFrame = srcFrameBegin,
                  dstFrame = dstFrameBegin; srcFrame != srcFrameEnd; ) {
             switch (op) {
-              case Move: api.moveFrame(sprite, srcFrame, dstFrame); break;
+              case Move: moves.push_back(std::make_pair(srcFrame, dstFrame)); break;
               case Copy: api.copyFrame(sprite, srcFrame, dstFrame); break;
             }
             srcFrame += srcFrameStep;
             dstFrame += dstFrameStep;
           }
 
+          if (!moves.empty())
+            api.moveFrames(sprite, moves);
+
           if (place == kDocumentRangeBefore) {
             resultRange.startRange(LayerIndex::NoLayer, frame_t(to.frameBegin()), from.type());
             resultRange.endRange(LayerIndex::NoLayer, frame_t(to.frameBegin()+from.frames()-1));
@@ -378,11 +383,13 @@ void reverse_frames(Document* doc, const DocumentRange& range)
   }
 
   if (moveFrames) {
+    std::vector<std::pair<frame_t, frame_t>> moves;
     for (frame_t frameRev = frameEnd+1;
          frameRev > frameBegin;
          --frameRev) {
-      api.moveFrame(sprite, frameBegin, frameRev);
+      moves.push_back(std::make_pair(frameBegin, frameRev));
     }
+    api.moveFrames(sprite, moves);
   }
   else if (swapCels) {
     std::vector<Layer*> layers;
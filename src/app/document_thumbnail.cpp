@@ -0,0 +1,168 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/document_thumbnail.h"
+
+#include "app/app_render.h"
+#include "app/document.h"
+#include "base/base.h"
+#include "doc/cel.h"
+#include "doc/document_event.h"
+#include "doc/image.h"
+#include "doc/image_impl.h"
+#include "doc/primitives_fast.h"
+#include "doc/sprite.h"
+
+#include <algorithm>
+
+namespace app {
+
+using namespace doc;
+
+DocumentThumbnail::DocumentThumbnail(Document* document)
+  : m_document(document)
+{
+  m_document->addObserver(this);
+}
+
+DocumentThumbnail::~DocumentThumbnail()
+{
+  m_document->removeObserver(this);
+}
+
+// static
+gfx::Size DocumentThumbnail::thumbnailSize(const gfx::Size& spriteSize)
+{
+  const int w = spriteSize.w;
+  const int h = spriteSize.h;
+  const int max = std::max(w, h);
+  if (max <= MAX_THUMBNAIL_SIZE)
+    return gfx::Size(std::max(1, w), std::max(1, h));
+
+  return gfx::Size(MID(1, MAX_THUMBNAIL_SIZE * w / max, MAX_THUMBNAIL_SIZE),
+                   MID(1, MAX_THUMBNAIL_SIZE * h / max, MAX_THUMBNAIL_SIZE));
+}
+
+const Image* DocumentThumbnail::image()
+{
+  const Sprite* sprite = m_document->sprite();
+  if (!sprite)
+    return nullptr;
+
+  const gfx::Size size = thumbnailSize(sprite->bounds().size());
+  if (!m_image ||
+      m_image->width() != size.w ||
+      m_image->height() != size.h) {
+    m_image.reset(Image::create(IMAGE_RGB, size.w, size.h));
+    invalidate();
+  }
+
+  if (!m_dirty.isEmpty())
+    renderDirtyArea();
+
+  return m_image.get();
+}
+
+void DocumentThumbnail::invalidate()
+{
+  if (const Sprite* sprite = m_document->sprite())
+    m_dirty = sprite->bounds();
+}
+
+void DocumentThumbnail::invalidate(const gfx::Rect& spriteBounds)
+{
+  m_dirty |= spriteBounds;
+}
+
+// Each thumbnail pixel (tx, ty) is the sprite pixel (tx*sw/tw,
+// ty*sh/th), so only the sampled pixels inside the dirty area are
+// rendered (one sprite row for each affected thumbnail row).
+void DocumentThumbnail::renderDirtyArea()
+{
+  const Sprite* sprite = m_document->sprite();
+  const int sw = sprite->width();
+  const int sh = sprite->height();
+  const int tw = m_image->width();
+  const int th = m_image->height();
+
+  const gfx::Rect dirty = m_dirty & sprite->bounds();
+  m_dirty = gfx::Rect();
+  if (dirty.isEmpty())
+    return;
+
+  // First thumbnail column/row whose sample is >= the given sprite
+  // coordinate
+  auto firstX = [=](int x) { return (x*tw + sw-1) / sw; };
+  auto firstY = [=](int y) { return (y*th + sh-1) / sh; };
+
+  const int tx1 = firstX(dirty.x);
+  const int tx2 = std::min(tw, firstX(dirty.x2()));
+  const int ty1 = firstY(dirty.y);
+  const int ty2 = std::min(th, firstY(dirty.y2()));
+  if (tx1 >= tx2 || ty1 >= ty2)
+    return;
+
+  const int sx1 = tx1*sw/tw;
+  const int sx2 = (tx2-1)*sw/tw + 1;
+  std::unique_ptr<Image> row(Image::create(IMAGE_RGB, sx2-sx1, 1));
+
+  AppRender render;
+  render.setupBackground(nullptr, IMAGE_RGB);
+  render.setBgType(render::BgType::CHECKED);
+
+  for (int ty=ty1; ty<ty2; ++ty) {
+    const int sy = ty*sh/th;
+    render.renderSprite(row.get(), sprite, frame_t(0),
+                        gfx::Clip(0, 0, sx1, sy, row->width(), 1));
+
+    for (int tx=tx1; tx<tx2; ++tx)
+      put_pixel_fast<RgbTraits>(
+        m_image.get(), tx, ty,
+        get_pixel_fast<RgbTraits>(row.get(), tx*sw/tw - sx1, 0));
+  }
+}
+
+void DocumentThumbnail::invalidateFrame(DocumentEvent& ev)
+{
+  // Changes in cels of other frames don't modify the thumbnail
+  if (ev.cel() && ev.cel()->frame() != 0)
+    return;
+
+  invalidate();
+}
+
+void DocumentThumbnail::onGeneralUpdate(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onPixelFormatChanged(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onAddLayer(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onAddFrame(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onAddCel(DocumentEvent& ev) { invalidateFrame(ev); }
+void DocumentThumbnail::onAfterRemoveLayer(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onRemoveFrame(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onRemoveCel(DocumentEvent& ev) { invalidateFrame(ev); }
+void DocumentThumbnail::onSpriteSizeChanged(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onSpriteTransparentColorChanged(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onLayerOpacityChange(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onLayerBlendModeChange(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onLayerRestacked(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onLayerMergedDown(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onCelMoved(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onCelCopied(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onCelFrameChanged(DocumentEvent& ev) { invalidate(); }
+void DocumentThumbnail::onCelPositionChanged(DocumentEvent& ev) { invalidateFrame(ev); }
+void DocumentThumbnail::onCelOpacityChange(DocumentEvent& ev) { invalidateFrame(ev); }
+
+void DocumentThumbnail::onSpritePixelsModified(DocumentEvent& ev)
+{
+  if (ev.frame() == 0)
+    invalidate(ev.region().bounds());
+}
+
+} // namespace app
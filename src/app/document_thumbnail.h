@@ -0,0 +1,85 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/document_observer.h"
+#include "gfx/rect.h"
+#include "gfx/size.h"
+
+#include <memory>
+
+// Maximum width/height of the thumbnails of files and documents
+#define MAX_THUMBNAIL_SIZE              128
+
+namespace doc {
+  class Image;
+}
+
+namespace app {
+  class Document;
+
+  // RGB thumbnail of the first frame of a document. It observes the
+  // document and accumulates the modified area of the sprite, so
+  // image() re-renders just the thumbnail pixels sampled from that
+  // area instead of the whole sprite.
+  class DocumentThumbnail : public doc::DocumentObserver {
+  public:
+    explicit DocumentThumbnail(Document* document);
+    ~DocumentThumbnail();
+
+    // Returns the updated thumbnail, or nullptr if the document
+    // doesn't have a sprite.
+    const doc::Image* image();
+
+    // Marks the whole sprite (or the given sprite bounds) as
+    // modified.
+    void invalidate();
+    void invalidate(const gfx::Rect& spriteBounds);
+
+    // Size of the thumbnail for a sprite of the given size (small
+    // sprites aren't enlarged).
+    static gfx::Size thumbnailSize(const gfx::Size& spriteSize);
+
+    // doc::DocumentObserver impl
+    void onGeneralUpdate(doc::DocumentEvent& ev) override;
+    void onPixelFormatChanged(doc::DocumentEvent& ev) override;
+    void onAddLayer(doc::DocumentEvent& ev) override;
+    void onAddFrame(doc::DocumentEvent& ev) override;
+    void onAddCel(doc::DocumentEvent& ev) override;
+    void onAfterRemoveLayer(doc::DocumentEvent& ev) override;
+    void onRemoveFrame(doc::DocumentEvent& ev) override;
+    void onRemoveCel(doc::DocumentEvent& ev) override;
+    void onSpriteSizeChanged(doc::DocumentEvent& ev) override;
+    void onSpriteTransparentColorChanged(doc::DocumentEvent& ev) override;
+    void onLayerOpacityChange(doc::DocumentEvent& ev) override;
+    void onLayerBlendModeChange(doc::DocumentEvent& ev) override;
+    void onLayerRestacked(doc::DocumentEvent& ev) override;
+    void onLayerMergedDown(doc::DocumentEvent& ev) override;
+    void onCelMoved(doc::DocumentEvent& ev) override;
+    void onCelCopied(doc::DocumentEvent& ev) override;
+    void onCelFrameChanged(doc::DocumentEvent& ev) override;
+    void onCelPositionChanged(doc::DocumentEvent& ev) override;
+    void onCelOpacityChange(doc::DocumentEvent& ev) override;
+    void onSpritePixelsModified(doc::DocumentEvent& ev) override;
+
+  private:
+    void invalidateFrame(doc::DocumentEvent& ev);
+    void renderDirtyArea();
+
+    Document* m_document;
+    std::unique_ptr<doc::Image> m_image;
+
+    // Modified area of the sprite (in sprite coordinates) which
+    // wasn't rendered in m_image yet.
+    gfx::Rect m_dirty;
+
+    DISABLE_COPYING(DocumentThumbnail);
+  };
+
+} // namespace app
@@ -16,6 +16,7 @@
 #include "app/cmd_transaction.h"
 #include "app/document_undo_observer.h"
 #include "app/pref/preferences.h"
+#include "base/trace_span.h"
 #include "doc/context.h"
 #include "undo/undo_history.h"
 #include "undo/undo_state.h"
@@ -29,6 +30,7 @@ DocumentUndo::DocumentUndo()
   : m_ctx(NULL)
   , m_savedCounter(0)
   , m_savedStateIsLost(false)
+  , m_modifications(0)
 {
 }
 
@@ -40,6 +42,7 @@ void DocumentUndo::setContext(doc::Context* ctx)
 void DocumentUndo::add(CmdTransaction* cmd)
 {
   ASSERT(cmd);
+  ++m_modifications;
 
   // A linear undo history is the default behavior
   if (!App::instance() ||
@@ -47,7 +50,19 @@ void DocumentUndo::add(CmdTransaction* cmd)
     clearRedo();
   }
 
+  // Coalesce tiny strokes with the previous undo state
+  const undo::UndoState* state = m_undoHistory.currentState();
+  if (state && !state->next()) {
+    auto lastCmd = static_cast<CmdTransaction*>(state->cmd());
+    if (lastCmd->canMergeWith(cmd)) {
+      lastCmd->merge(cmd);
+      swapOutOldStates();
+      return;
+    }
+  }
+
   m_undoHistory.add(cmd);
+  swapOutOldStates();
   notifyObservers(&DocumentUndoObserver::onAddUndoState, this);
 }
 
@@ -63,13 +78,17 @@ bool DocumentUndo::canRedo() const
 
 void DocumentUndo::undo()
 {
+  TRACE_SPAN("DocumentUndo::undo");
   m_undoHistory.undo();
+  ++m_modifications;
   notifyObservers(&DocumentUndoObserver::onAfterUndo, this);
 }
 
 void DocumentUndo::redo()
 {
+  TRACE_SPAN("DocumentUndo::redo");
   m_undoHistory.redo();
+  ++m_modifications;
   notifyObservers(&DocumentUndoObserver::onAfterRedo, this);
 }
 
@@ -133,6 +152,24 @@ SpritePosition DocumentUndo::nextRedoSpritePosition() const
     return SpritePosition();
 }
 
+void DocumentUndo::collectStats(CmdStatsMap& stats) const
+{
+  for (const undo::UndoState* state = m_undoHistory.firstState();
+       state; state = state->next()) {
+    static_cast<const Cmd*>(state->cmd())->collectStats(stats);
+  }
+}
+
+size_t DocumentUndo::memSize() const
+{
+  size_t size = 0;
+  for (const undo::UndoState* state = m_undoHistory.firstState();
+       state; state = state->next()) {
+    size += static_cast<const Cmd*>(state->cmd())->memSize();
+  }
+  return size;
+}
+
 Cmd* DocumentUndo::lastExecutedCmd() const
 {
   const undo::UndoState* state = m_undoHistory.currentState();
@@ -145,6 +182,7 @@ Cmd* DocumentUndo::lastExecutedCmd() const
 void DocumentUndo::moveToState(const undo::UndoState* state)
 {
   m_undoHistory.moveTo(state);
+  ++m_modifications;
 }
 
 const undo::UndoState* DocumentUndo::nextUndo() const
@@ -161,4 +199,27 @@ const undo::UndoState* DocumentUndo::nextRedo() const
     return m_undoHistory.firstState();
 }
 
+// Moves the data of the states older than the undo limit to the
+// undo swap file (only if the "swap_old_states" option is enabled).
+void DocumentUndo::swapOutOldStates()
+{
+  if (!App::instance())
+    return;
+
+  Preferences& pref = App::instance()->preferences();
+  if (!pref.undo.swapOldStates())
+    return;
+
+  const size_t limit = size_t(pref.undo.sizeLimit()) * 1024 * 1024;
+  size_t size = 0;
+  for (const undo::UndoState* state = m_undoHistory.currentState();
+       state; state = state->prev()) {
+    Cmd* cmd = static_cast<Cmd*>(state->cmd());
+    if (size > limit)
+      cmd->swapOut();
+    else
+      size += cmd->memSize();
+  }
+}
+
 } // namespace app
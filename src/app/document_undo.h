@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "app/cmd_stats.h"
 #include "base/disable_copying.h"
 #include "base/observable.h"
 #include "doc/sprite_position.h"
@@ -54,14 +55,27 @@ namespace app {
 
     int* savedCounter() { return &m_savedCounter; }
 
+    // Number of times the history was modified (new or merged
+    // states, undoes, redoes). Used to know if the document was
+    // modified between two points in time.
+    int modifications() const { return m_modifications; }
+
     const undo::UndoState* firstState() const { return m_undoHistory.firstState(); }
     const undo::UndoState* currentState() const { return m_undoHistory.currentState(); }
 
     void moveToState(const undo::UndoState* state);
 
+    // Memory used by each type of Cmd in the whole history.
+    void collectStats(CmdStatsMap& stats) const;
+
+    // Memory used by the whole history (commands swapped out to the
+    // undo swap file don't count).
+    size_t memSize() const;
+
   private:
     const undo::UndoState* nextUndo() const;
     const undo::UndoState* nextRedo() const;
+    void swapOutOldStates();
 
     undo::UndoHistory m_undoHistory;
     doc::Context* m_ctx;
@@ -77,6 +91,8 @@ namespace app {
     // way. E.g. If the save process fails.
     bool m_savedStateIsLost;
 
+    int m_modifications;
+
     DISABLE_COPYING(DocumentUndo);
   };
 
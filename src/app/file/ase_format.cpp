@@ -14,16 +14,26 @@
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
+#include "app/pref/preferences.h"
 #include "base/cfile.h"
+#include "base/config.h"
 #include "base/exception.h"
 #include "base/file_handle.h"
+#include "base/file_reader.h"
+#include "base/fs.h"
 #include "base/path.h"
+#include "base/thread_pool.h"
 #include "doc/doc.h"
+#include "doc/image_io.h"
 #include "ui/alert.h"
 #include "zlib.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #define ASE_FILE_MAGIC                      0xA5E0
 #define ASE_FILE_FRAME_MAGIC                0xF1FA
@@ -96,45 +106,94 @@ struct ASE_Chunk {
   int start;
 };
 
-static bool ase_file_read_header(FILE* f, ASE_Header* header);
+// A compressed cel read from the file which isn't decoded yet, the
+// data points to the chunk payload in the FileReader memory
+struct ASE_CompressedCel {
+  ImageRef image;
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  std::string error;
+};
+
+// Compressed cels are decoded in batches of kMaxPendingCelBytes
+struct ASE_PendingCels {
+  std::vector<ASE_CompressedCel> cels;
+  size_t bytes = 0;
+};
+
+const size_t kMaxPendingCelBytes = 64*1024*1024;
+
+// Compressed pixels of each cel to be saved, cels are compressed in
+// batches of kMaxCompressBatchBytes (uncompressed)
+using ASE_CompressedCels = std::map<const Cel*, std::vector<uint8_t>>;
+
+const size_t kMaxCompressBatchBytes = 64*1024*1024;
+
+// Position of each frame in the last loaded/saved file and the
+// signature of its content at that moment (see
+// ase_frame_signature()). It's kept in the Document so the next save
+// of the same file can copy the unmodified frames.
+class AseFileIndex : public FormatOptions {
+public:
+  struct Frame {
+    size_t offset;
+    size_t size;
+    uint64_t signature;
+  };
+
+  std::string filename;
+  size_t fileSize = 0;
+  base::Time modTime;
+  uint64_t structure = 0;
+  std::vector<Frame> frames;
+};
+
+static bool ase_file_read_header(FileReader* f, ASE_Header* header);
 static void ase_file_prepare_header(FILE* f, ASE_Header* header, const Sprite* sprite);
 static void ase_file_write_header(FILE* f, ASE_Header* header);
 static void ase_file_write_header_filesize(FILE* f, ASE_Header* header);
 
-static void ase_file_read_frame_header(FILE* f, ASE_FrameHeader* frame_header);
+static void ase_file_read_frame_header(FileReader* f, ASE_FrameHeader* frame_header);
 static void ase_file_prepare_frame_header(FILE* f, ASE_FrameHeader* frame_header);
 static void ase_file_write_frame_header(FILE* f, ASE_FrameHeader* frame_header);
 
 static void ase_file_write_layers(FILE* f, ASE_FrameHeader* frame_header, const Layer* layer);
-static void ase_file_write_cels(FILE* f, ASE_FrameHeader* frame_header, const Sprite* sprite, const Layer* layer, frame_t frame);
+static void ase_file_write_cels(FILE* f, ASE_FrameHeader* frame_header, const Sprite* sprite, const Layer* layer, frame_t frame, const ASE_CompressedCels& buffers);
 
-static void ase_file_read_padding(FILE* f, int bytes);
+static void ase_file_read_padding(FileReader* f, int bytes);
 static void ase_file_write_padding(FILE* f, int bytes);
-static std::string ase_file_read_string(FILE* f);
+static std::string ase_file_read_string(FileReader* f);
 static void ase_file_write_string(FILE* f, const std::string& string);
 
 static void ase_file_write_start_chunk(FILE* f, ASE_FrameHeader* frame_header, int type, ASE_Chunk* chunk);
 static void ase_file_write_close_chunk(FILE* f, ASE_Chunk* chunk);
 
-static std::shared_ptr<Palette> ase_file_read_color_chunk(FILE* f, const Palette& prevPal, frame_t frame);
-static std::shared_ptr<Palette> ase_file_read_color2_chunk(FILE* f, const Palette& prevPal, frame_t frame);
-static std::shared_ptr<Palette> ase_file_read_palette_chunk(FILE* f, const Palette& prevPal, frame_t frame);
+static std::shared_ptr<Palette> ase_file_read_color_chunk(FileReader* f, const Palette& prevPal, frame_t frame);
+static std::shared_ptr<Palette> ase_file_read_color2_chunk(FileReader* f, const Palette& prevPal, frame_t frame);
+static std::shared_ptr<Palette> ase_file_read_palette_chunk(FileReader* f, const Palette& prevPal, frame_t frame);
 static void ase_file_write_color2_chunk(FILE* f, ASE_FrameHeader* frame_header, const Palette* pal);
 static void ase_file_write_palette_chunk(FILE* f, ASE_FrameHeader* frame_header, const Palette* pal, int from, int to);
-static Layer* ase_file_read_layer_chunk(FILE* f, ASE_Header* header, Sprite* sprite, Layer** previous_layer, int* current_level);
+static Layer* ase_file_read_layer_chunk(FileReader* f, ASE_Header* header, Sprite* sprite, Layer** previous_layer, int* current_level);
 static void ase_file_write_layer_chunk(FILE* f, ASE_FrameHeader* frame_header, const Layer* layer);
-static Cel* ase_file_read_cel_chunk(FILE* f, Sprite* sprite, frame_t frame, PixelFormat pixelFormat, FileOp* fop, ASE_Header* header, size_t chunk_end);
-static void ase_file_write_cel_chunk(FILE* f, ASE_FrameHeader* frame_header, const Cel* cel, const LayerImage* layer, const Sprite* sprite);
-static Mask* ase_file_read_mask_chunk(FILE* f);
+static Cel* ase_file_read_cel_chunk(FileReader* f, Sprite* sprite, frame_t frame, PixelFormat pixelFormat, FileOp* fop, ASE_Header* header, size_t chunk_end, ASE_PendingCels* pending);
+static void ase_decode_pending_cels(ASE_PendingCels* pending, FileOp* fop);
+static void ase_file_write_cel_chunk(FILE* f, ASE_FrameHeader* frame_header, const Cel* cel, const LayerImage* layer, const Sprite* sprite, const ASE_CompressedCels& buffers);
+static frame_t ase_compress_cels(const Sprite* sprite, frame_t frame, int level, const std::vector<bool>& reused, ASE_CompressedCels& buffers);
+static Mask* ase_file_read_mask_chunk(FileReader* f);
 #if 0
 static void ase_file_write_mask_chunk(FILE* f, ASE_FrameHeader* frame_header, Mask* mask);
 #endif
-static void ase_file_read_frame_tags_chunk(FILE* f, FrameTags* frameTags);
+static void ase_file_read_frame_tags_chunk(FileReader* f, FrameTags* frameTags);
 static void ase_file_write_frame_tags_chunk(FILE* f, ASE_FrameHeader* frame_header, const FrameTags* frameTags);
-static void ase_file_read_user_data_chunk(FILE* f, UserData* userData);
+static void ase_file_read_user_data_chunk(FileReader* f, UserData* userData);
 static void ase_file_write_user_data_chunk(FILE* f, ASE_FrameHeader* frame_header, const UserData* userData);
 static bool ase_has_groups(LayerFolder* layer);
 static void ase_ungroup_all(LayerFolder* layer);
+static bool ase_requires_new_palette_chunk(const Sprite* sprite);
+static void ase_file_write_frame(FILE* f, const Sprite* sprite, frame_t frame, bool require_new_palette_chunk, const ASE_CompressedCels& buffers);
+static uint64_t ase_structure_signature(const Sprite* sprite, bool require_new_palette_chunk);
+static uint64_t ase_frame_signature(const Sprite* sprite, frame_t frame);
+static bool ase_is_frame_block(FileReader* f, const AseFileIndex::Frame& frame);
 
 class ChunkWriter {
 public:
@@ -182,7 +241,8 @@ static FileFormat::Regular<AseFormat> ff{"ase"};
 bool AseFormat::onLoad(FileOp* fop)
 {
   FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
-  FILE* f = handle.get();
+  FileReader reader(handle);
+  FileReader* f = &reader;
   bool ignore_old_color_chunks = false;
 
   ASE_Header header;
@@ -192,9 +252,10 @@ bool AseFormat::onLoad(FileOp* fop)
   }
 
   // Create the new sprite
-  std::unique_ptr<Sprite> sprite(new Sprite(header.depth == 32 ? IMAGE_RGB:
+  std::unique_ptr<Sprite> spriteOwner(new Sprite(header.depth == 32 ? IMAGE_RGB:
       header.depth == 16 ? IMAGE_GRAYSCALE: IMAGE_INDEXED,
       header.width, header.height, header.ncolors));
+  Sprite* sprite = spriteOwner.get();
 
   // Set frames and speed
   sprite->setTotalFrames(frame_t(header.frames));
@@ -207,11 +268,18 @@ bool AseFormat::onLoad(FileOp* fop)
   Layer* last_layer = sprite->folder();
   WithUserData* last_object_with_user_data = nullptr;
   int current_level = -1;
+  ASE_PendingCels pending;
+  auto index = std::make_shared<AseFileIndex>();
 
   // Read frame by frame to end-of-file
   for (frame_t frame(0); frame<sprite->totalFrames(); ++frame) {
+    // In a progressive load the document can be in the UI already
+    FileOpWriteLock lock(fop);
+    if (!lock.locked())
+      break;
+
     // Start frame position
-    int frame_pos = ftell(f);
+    int frame_pos = f->tell();
     fop->setProgress((float)frame_pos / (float)header.size);
 
     // Read frame header
@@ -227,12 +295,12 @@ bool AseFormat::onLoad(FileOp* fop)
       // Read chunks
       for (int c=0; c<frame_header.chunks; c++) {
         /* start chunk position */
-        int chunk_pos = ftell(f);
+        int chunk_pos = f->tell();
         fop->setProgress((float)chunk_pos / (float)header.size);
 
         // Read chunk information
-        int chunk_size = fgetl(f);
-        int chunk_type = fgetw(f);
+        int chunk_size = f->getl();
+        int chunk_type = f->getw();
 
         switch (chunk_type) {
 
@@ -261,17 +329,24 @@ bool AseFormat::onLoad(FileOp* fop)
 
           case ASE_FILE_CHUNK_LAYER: {
             last_object_with_user_data =
-              ase_file_read_layer_chunk(f, &header, sprite.get(),
+              ase_file_read_layer_chunk(f, &header, sprite,
                                         &last_layer,
                                         &current_level);
             break;
           }
 
           case ASE_FILE_CHUNK_CEL: {
+            // The compressed pixels are skipped (with the user data
+            // of the cel)
+            if (fop->isMetadataOnly()) {
+              last_object_with_user_data = nullptr;
+              break;
+            }
+
             Cel* cel =
-              ase_file_read_cel_chunk(f, sprite.get(), frame,
+              ase_file_read_cel_chunk(f, sprite, frame,
                                       sprite->pixelFormat(), fop, &header,
-                                      chunk_pos+chunk_size);
+                                      chunk_pos+chunk_size, &pending);
             if (cel) {
               last_object_with_user_data = cel->data();
             }
@@ -304,9 +379,9 @@ bool AseFormat::onLoad(FileOp* fop)
           }
 
           case ASE_FILE_CHUNK_COLOR_PROFILE: {
-            (void) fgetw(f); //  type
-            (void) fgetw(f); //  flags
-            (void) fgetl(f); //  gamma
+            (void) f->getw(); //  type
+            (void) f->getw(); //  flags
+            (void) f->getl(); //  gamma
             ase_file_read_padding(f, 8);
             break;
           }
@@ -317,12 +392,29 @@ bool AseFormat::onLoad(FileOp* fop)
         }
 
         // Skip chunk size
-        fseek(f, chunk_pos+chunk_size, SEEK_SET);
+        f->seek(chunk_pos+chunk_size);
       }
     }
 
     // Skip frame size
-    fseek(f, frame_pos+frame_header.size, SEEK_SET);
+    f->seek(frame_pos+frame_header.size);
+    index->frames.push_back({ size_t(frame_pos), size_t(frame_header.size), 0 });
+
+    if (pending.bytes > kMaxPendingCelBytes ||
+        fop->isFirstFrameLoaded())
+      ase_decode_pending_cels(&pending, fop);
+
+    // The document can be displayed with its first frame while the
+    // other ones are loaded
+    if (frame == 0 &&
+        fop->isProgressive() &&
+        sprite->totalFrames() > 1 &&
+        !fop->isStop()) {
+      ase_decode_pending_cels(&pending, fop);
+      fop->createDocument(sprite);
+      spriteOwner.release();
+      fop->setFirstFrameLoaded();
+    }
 
     // Just one frame?
     if (fop->isOneFrame())
@@ -332,10 +424,34 @@ bool AseFormat::onLoad(FileOp* fop)
       break;
   }
 
-  fop->createDocument(sprite.get());
-  sprite.release();
+  ase_decode_pending_cels(&pending, fop);
+
+  FileOpWriteLock lock(fop);
+
+  // Signatures of the loaded frames for the next incremental save
+  if (lock.locked() &&
+      !fop->isOneFrame() &&
+      !fop->isMetadataOnly() &&
+      frame_t(index->frames.size()) == sprite->totalFrames()) {
+    index->filename = fop->filename();
+    index->fileSize = f->size();
+    index->modTime = base::get_modification_time(fop->filename());
+    index->structure = ase_structure_signature(
+      sprite, ase_requires_new_palette_chunk(sprite));
+    for (frame_t frame(0); frame<sprite->totalFrames(); ++frame)
+      index->frames[frame].signature = ase_frame_signature(sprite, frame);
+  }
+  else
+    index.reset();
 
-  if (ferror(f)) {
+  if (spriteOwner) {
+    fop->createDocument(sprite);
+    spriteOwner.release();
+  }
+  if (index)
+    fop->document()->setFileIndex(index);
+
+  if (f->error()) {
     fop->setError("Error reading file.\n");
     return false;
   }
@@ -375,112 +491,202 @@ bool AseFormat::onPostLoad(FileOp* fop)
 bool AseFormat::onSave(FileOp* fop)
 {
   const Sprite* sprite = fop->document()->sprite();
-  FileHandle handle(open_file_with_exception(fop->filename(), "wb"));
-  FILE* f = handle.get();
-
-  // Write the header
-  ASE_Header header;
-  ase_file_prepare_header(f, &header, sprite);
-  ase_file_write_header(f, &header);
-
-  bool require_new_palette_chunk = false;
-  for (auto& pal : sprite->getPalettes()) {
-    if (pal->size() != 256 || pal->hasAlpha()) {
-      require_new_palette_chunk = true;
-      break;
+  const bool require_new_palette_chunk = ase_requires_new_palette_chunk(sprite);
+
+  auto index = std::make_shared<AseFileIndex>();
+  index->filename = fop->filename();
+  index->structure = ase_structure_signature(sprite, require_new_palette_chunk);
+
+  // The incremental save copies the frames that weren't modified
+  // since the last load/save of this same file. The first frame is
+  // always written again as it contains the layers and tags.
+  std::vector<bool> reused(sprite->totalFrames(), false);
+  FileHandle oldHandle;
+  std::unique_ptr<FileReader> oldFile;
+  auto oldIndex = std::dynamic_pointer_cast<AseFileIndex>(fop->document()->fileIndex());
+  if (Preferences::instance().general.incrementalSave() &&
+      oldIndex &&
+      oldIndex->filename == fop->filename() &&
+      oldIndex->structure == index->structure &&
+      base::is_file(fop->filename()) &&
+      base::file_size(fop->filename()) == oldIndex->fileSize &&
+      base::get_modification_time(fop->filename()) == oldIndex->modTime) {
+    oldHandle = open_file_with_exception(fop->filename(), "rb");
+    oldFile.reset(new FileReader(oldHandle));
+
+    bool any = false;
+    frame_t frames = std::min(sprite->totalFrames(), frame_t(oldIndex->frames.size()));
+    for (frame_t frame(1); frame<frames; ++frame) {
+      const AseFileIndex::Frame& old = oldIndex->frames[frame];
+      if (old.signature == ase_frame_signature(sprite, frame) &&
+          ase_is_frame_block(oldFile.get(), old)) {
+        reused[frame] = true;
+        any = true;
+      }
+    }
+    if (!any) {
+      oldFile.reset();
+      oldHandle.reset();
     }
   }
 
-  // Write frames
-  for (frame_t frame(0); frame<sprite->totalFrames(); ++frame) {
-    // Prepare the frame header
-    ASE_FrameHeader frame_header;
-    ase_file_prepare_frame_header(f, &frame_header);
-
-    // Frame duration
-    frame_header.duration = sprite->frameDuration(frame);
-
-    // is the first frame or did the palette change?
-    auto pal = sprite->palette(frame);
-    int palFrom = 0, palTo = pal->size()-1;
-    if ((frame == 0 ||
-         sprite->palette(frame-1)->countDiff(*pal, &palFrom, &palTo) > 0)) {
-      // Write new palette chunk
-      if (require_new_palette_chunk) {
-        ase_file_write_palette_chunk(f, &frame_header,
-                                     pal, palFrom, palTo);
+  // The new file is written in a temporary file when we have to read
+  // frames from the old one
+  const bool incremental = (oldFile != nullptr);
+  const std::string filename = (incremental ? fop->filename() + ".tmp":
+                                              fop->filename());
+  {
+    FileHandle handle(open_file_with_exception(filename, "wb"));
+    FILE* f = handle.get();
+
+    // Write the header
+    ASE_Header header;
+    ase_file_prepare_header(f, &header, sprite);
+    ase_file_write_header(f, &header);
+
+    // The fast save uses the fastest zlib level (bigger files)
+    const int level = (Preferences::instance().general.fastSave() ?
+                       Z_BEST_SPEED: Z_DEFAULT_COMPRESSION);
+    ASE_CompressedCels buffers;
+    frame_t compressedFrames(0);
+
+    // Write frames
+    for (frame_t frame(0); frame<sprite->totalFrames(); ++frame) {
+      if (frame == compressedFrames)
+        compressedFrames = ase_compress_cels(sprite, frame, level, reused, buffers);
+
+      AseFileIndex::Frame info;
+      info.offset = ftell(f);
+      info.signature = ase_frame_signature(sprite, frame);
+
+      if (reused[frame]) {
+        const AseFileIndex::Frame& old = oldIndex->frames[frame];
+        oldFile->seek(old.offset);
+        fwrite(oldFile->data(old.size), 1, old.size, f);
       }
+      else
+        ase_file_write_frame(f, sprite, frame, require_new_palette_chunk, buffers);
 
-      // Write color chunk for backward compatibility only
-      ase_file_write_color2_chunk(f, &frame_header, pal);
-    }
-
-    // Write extra chunks in the first frame
-    if (frame == 0) {
-      LayerIterator it = sprite->folder()->getLayerBegin();
-      LayerIterator end = sprite->folder()->getLayerEnd();
+      info.size = ftell(f) - info.offset;
+      index->frames.push_back(info);
 
-      // Write layer chunks
-      for (; it != end; ++it)
-        ase_file_write_layers(f, &frame_header, *it);
+      // Progress
+      if (sprite->totalFrames() > 1)
+        fop->setProgress(float(frame+1) / float(sprite->totalFrames()));
 
-      // Writer frame tags
-      if (sprite->frameTags().size() > 0)
-        ase_file_write_frame_tags_chunk(f, &frame_header, &sprite->frameTags());
+      if (fop->isStop())
+        break;
     }
 
-    // Write cel chunks
-    ase_file_write_cels(f, &frame_header, sprite, sprite->folder(), frame);
+    // Write the missing field (filesize) of the header.
+    ase_file_write_header_filesize(f, &header);
 
-    // Write the frame header
-    ase_file_write_frame_header(f, &frame_header);
+    if (ferror(f)) {
+      fop->setError("Error writing file.\n");
+      handle.reset();
+      if (incremental)
+        base::delete_file(filename);
+      return false;
+    }
+  }
 
-    // Progress
-    if (sprite->totalFrames() > 1)
-      fop->setProgress(float(frame+1) / float(sprite->totalFrames()));
+  if (incremental) {
+    oldFile.reset();
+    oldHandle.reset();
+#ifdef _WIN32
+    base::delete_file(fop->filename());
+#endif
+    base::move_file(filename, fop->filename());
+  }
 
-    if (fop->isStop())
-      break;
+  index->fileSize = base::file_size(fop->filename());
+  index->modTime = base::get_modification_time(fop->filename());
+  fop->document()->setFileIndex(index);
+  return true;
+}
+
+static bool ase_requires_new_palette_chunk(const Sprite* sprite)
+{
+  for (auto& pal : sprite->getPalettes()) {
+    if (pal->size() != 256 || pal->hasAlpha())
+      return true;
   }
+  return false;
+}
 
-  // Write the missing field (filesize) of the header.
-  ase_file_write_header_filesize(f, &header);
+static void ase_file_write_frame(FILE* f, const Sprite* sprite, frame_t frame,
+                                 bool require_new_palette_chunk,
+                                 const ASE_CompressedCels& buffers)
+{
+  // Prepare the frame header
+  ASE_FrameHeader frame_header;
+  ase_file_prepare_frame_header(f, &frame_header);
+
+  // Frame duration
+  frame_header.duration = sprite->frameDuration(frame);
+
+  // is the first frame or did the palette change?
+  auto pal = sprite->palette(frame);
+  int palFrom = 0, palTo = pal->size()-1;
+  if ((frame == 0 ||
+       sprite->palette(frame-1)->countDiff(*pal, &palFrom, &palTo) > 0)) {
+    // Write new palette chunk
+    if (require_new_palette_chunk) {
+      ase_file_write_palette_chunk(f, &frame_header,
+                                   pal, palFrom, palTo);
+    }
 
-  if (ferror(f)) {
-    fop->setError("Error writing file.\n");
-    return false;
+    // Write color chunk for backward compatibility only
+    ase_file_write_color2_chunk(f, &frame_header, pal);
   }
-  else {
-    return true;
+
+  // Write extra chunks in the first frame
+  if (frame == 0) {
+    LayerIterator it = sprite->folder()->getLayerBegin();
+    LayerIterator end = sprite->folder()->getLayerEnd();
+
+    // Write layer chunks
+    for (; it != end; ++it)
+      ase_file_write_layers(f, &frame_header, *it);
+
+    // Writer frame tags
+    if (sprite->frameTags().size() > 0)
+      ase_file_write_frame_tags_chunk(f, &frame_header, &sprite->frameTags());
   }
+
+  // Write cel chunks
+  ase_file_write_cels(f, &frame_header, sprite, sprite->folder(), frame, buffers);
+
+  // Write the frame header
+  ase_file_write_frame_header(f, &frame_header);
 }
 
-static bool ase_file_read_header(FILE* f, ASE_Header* header)
+static bool ase_file_read_header(FileReader* f, ASE_Header* header)
 {
-  header->pos = ftell(f);
+  header->pos = f->tell();
 
-  header->size  = fgetl(f);
-  header->magic = fgetw(f);
+  header->size  = f->getl();
+  header->magic = f->getw();
   if (header->magic != ASE_FILE_MAGIC)
     return false;
 
-  header->frames     = fgetw(f);
-  header->width      = fgetw(f);
-  header->height     = fgetw(f);
-  header->depth      = fgetw(f);
-  header->flags      = fgetl(f);
-  header->speed      = fgetw(f);
-  header->next       = fgetl(f);
-  header->frit       = fgetl(f);
-  header->transparent_index = fgetc(f);
-  header->ignore[0]  = fgetc(f);
-  header->ignore[1]  = fgetc(f);
-  header->ignore[2]  = fgetc(f);
-  header->ncolors    = fgetw(f);
+  header->frames     = f->getw();
+  header->width      = f->getw();
+  header->height     = f->getw();
+  header->depth      = f->getw();
+  header->flags      = f->getl();
+  header->speed      = f->getw();
+  header->next       = f->getl();
+  header->frit       = f->getl();
+  header->transparent_index = f->getc();
+  header->ignore[0]  = f->getc();
+  header->ignore[1]  = f->getc();
+  header->ignore[2]  = f->getc();
+  header->ncolors    = f->getw();
   if (header->ncolors == 0)     // 0 means 256 (old .ase files)
     header->ncolors = 256;
 
-  fseek(f, header->pos+128, SEEK_SET);
+  f->seek(header->pos+128);
   return true;
 }
 
@@ -540,12 +746,12 @@ static void ase_file_write_header_filesize(FILE* f, ASE_Header* header)
   fseek(f, header->pos+header->size, SEEK_SET);
 }
 
-static void ase_file_read_frame_header(FILE* f, ASE_FrameHeader* frame_header)
+static void ase_file_read_frame_header(FileReader* f, ASE_FrameHeader* frame_header)
 {
-  frame_header->size = fgetl(f);
-  frame_header->magic = fgetw(f);
-  frame_header->chunks = fgetw(f);
-  frame_header->duration = fgetw(f);
+  frame_header->size = f->getl();
+  frame_header->magic = f->getw();
+  frame_header->chunks = f->getw();
+  frame_header->duration = f->getw();
   ase_file_read_padding(f, 6);
 }
 
@@ -594,14 +800,14 @@ static void ase_file_write_layers(FILE* f, ASE_FrameHeader* frame_header, const
   }
 }
 
-static void ase_file_write_cels(FILE* f, ASE_FrameHeader* frame_header, const Sprite* sprite, const Layer* layer, frame_t frame)
+static void ase_file_write_cels(FILE* f, ASE_FrameHeader* frame_header, const Sprite* sprite, const Layer* layer, frame_t frame, const ASE_CompressedCels& buffers)
 {
   if (layer->isImage()) {
     if (auto cel = layer->cel(frame)) {
 /*       fop->setError("New cel in frame %d, in layer %d\n", */
 /*                   frame, sprite_layer2index(sprite, layer)); */
 
-      ase_file_write_cel_chunk(f, frame_header, cel.get(), static_cast<const LayerImage*>(layer), sprite);
+      ase_file_write_cel_chunk(f, frame_header, cel.get(), static_cast<const LayerImage*>(layer), sprite, buffers);
 
       if (!cel->link() &&
           !cel->data()->userData().isEmpty()) {
@@ -616,14 +822,14 @@ static void ase_file_write_cels(FILE* f, ASE_FrameHeader* frame_header, const Sp
          end = static_cast<const LayerFolder*>(layer)->getLayerEnd();
 
     for (; it != end; ++it)
-      ase_file_write_cels(f, frame_header, sprite, *it, frame);
+      ase_file_write_cels(f, frame_header, sprite, *it, frame, buffers);
   }
 }
 
-static void ase_file_read_padding(FILE* f, int bytes)
+static void ase_file_read_padding(FileReader* f, int bytes)
 {
   for (int c=0; c<bytes; c++)
-    fgetc(f);
+    f->getc();
 }
 
 static void ase_file_write_padding(FILE* f, int bytes)
@@ -632,9 +838,9 @@ static void ase_file_write_padding(FILE* f, int bytes)
     fputc(0, f);
 }
 
-static std::string ase_file_read_string(FILE* f)
+static std::string ase_file_read_string(FileReader* f)
 {
-  int length = fgetw(f);
+  int length = f->getw();
   if (length == EOF)
     return "";
 
@@ -642,7 +848,7 @@ static std::string ase_file_read_string(FILE* f)
   string.reserve(length+1);
 
   for (int c=0; c<length; c++)
-    string.push_back(fgetc(f));
+    string.push_back(f->getc());
 
   return string;
 }
@@ -676,25 +882,25 @@ static void ase_file_write_close_chunk(FILE* f, ASE_Chunk* chunk)
   fseek(f, chunk_end, SEEK_SET);
 }
 
-static std::shared_ptr<Palette> ase_file_read_color_chunk(FILE* f, const Palette& prevPal, frame_t frame)
+static std::shared_ptr<Palette> ase_file_read_color_chunk(FileReader* f, const Palette& prevPal, frame_t frame)
 {
   int i, c, r, g, b, packets, skip, size;
   auto pal = prevPal.clone();
   pal->setFrame(frame);
 
-  packets = fgetw(f);   // Number of packets
+  packets = f->getw();  // Number of packets
   skip = 0;
 
   // Read all packets
   for (i=0; i<packets; i++) {
-    skip += fgetc(f);
-    size = fgetc(f);
+    skip += f->getc();
+    size = f->getc();
     if (!size) size = 256;
 
     for (c=skip; c<skip+size; c++) {
-      r = fgetc(f);
-      g = fgetc(f);
-      b = fgetc(f);
+      r = f->getc();
+      g = f->getc();
+      b = f->getc();
       pal->setEntry(c, rgba(scale_6bits_to_8bits(r),
                             scale_6bits_to_8bits(g),
                             scale_6bits_to_8bits(b), 255));
@@ -704,25 +910,25 @@ static std::shared_ptr<Palette> ase_file_read_color_chunk(FILE* f, const Palette
   return pal;
 }
 
-static std::shared_ptr<Palette> ase_file_read_color2_chunk(FILE* f, const Palette& prevPal, frame_t frame)
+static std::shared_ptr<Palette> ase_file_read_color2_chunk(FileReader* f, const Palette& prevPal, frame_t frame)
 {
   int i, c, r, g, b, packets, skip, size;
   auto pal = prevPal.clone();
   pal->setFrame(frame);
 
-  packets = fgetw(f);   // Number of packets
+  packets = f->getw();  // Number of packets
   skip = 0;
 
   // Read all packets
   for (i=0; i<packets; i++) {
-    skip += fgetc(f);
-    size = fgetc(f);
+    skip += f->getc();
+    size = f->getc();
     if (!size) size = 256;
 
     for (c=skip; c<skip+size; c++) {
-      r = fgetc(f);
-      g = fgetc(f);
-      b = fgetc(f);
+      r = f->getc();
+      g = f->getc();
+      b = f->getc();
       pal->setEntry(c, rgba(r, g, b, 255));
     }
   }
@@ -730,25 +936,25 @@ static std::shared_ptr<Palette> ase_file_read_color2_chunk(FILE* f, const Palett
   return pal;
 }
 
-static std::shared_ptr<Palette> ase_file_read_palette_chunk(FILE* f, const Palette& prevPal, frame_t frame)
+static std::shared_ptr<Palette> ase_file_read_palette_chunk(FileReader* f, const Palette& prevPal, frame_t frame)
 {
   auto pal = prevPal.clone();
   pal->setFrame(frame);
 
-  int newSize = fgetl(f);
-  int from = fgetl(f);
-  int to = fgetl(f);
+  int newSize = f->getl();
+  int from = f->getl();
+  int to = f->getl();
   ase_file_read_padding(f, 8);
 
   if (newSize > 0)
     pal->resize(newSize);
 
   for (int c=from; c<=to; ++c) {
-    int flags = fgetw(f);
-    int r = fgetc(f);
-    int g = fgetc(f);
-    int b = fgetc(f);
-    int a = fgetc(f);
+    int flags = f->getw();
+    int r = f->getc();
+    int g = f->getc();
+    int b = f->getc();
+    int a = f->getc();
     pal->setEntry(c, rgba(r, g, b, a));
 
     // Skip name
@@ -798,7 +1004,7 @@ static void ase_file_write_palette_chunk(FILE* f, ASE_FrameHeader* frame_header,
   }
 }
 
-static Layer* ase_file_read_layer_chunk(FILE* f, ASE_Header* header, Sprite* sprite, Layer** previous_layer, int* current_level)
+static Layer* ase_file_read_layer_chunk(FileReader* f, ASE_Header* header, Sprite* sprite, Layer** previous_layer, int* current_level)
 {
   std::string name;
   Layer* layer = NULL;
@@ -807,13 +1013,13 @@ static Layer* ase_file_read_layer_chunk(FILE* f, ASE_Header* header, Sprite* spr
   int layer_type;
   int child_level;
 
-  flags = fgetw(f);
-  layer_type = fgetw(f);
-  child_level = fgetw(f);
-  fgetw(f);                     // default width
-  fgetw(f);                     // default height
-  int blendmode = fgetw(f);     // blend mode
-  int opacity = fgetc(f);       // opacity
+  flags = f->getw();
+  layer_type = f->getw();
+  child_level = f->getw();
+  f->getw();                    // default width
+  f->getw();                    // default height
+  int blendmode = f->getw();    // blend mode
+  int opacity = f->getc();      // opacity
 
   ase_file_read_padding(f, 3);
   name = ase_file_read_string(f);
@@ -897,7 +1103,7 @@ static void ase_file_write_layer_chunk(FILE* f, ASE_FrameHeader* frame_header, c
 template<typename ImageTraits>
 class PixelIO {
 public:
-  typename ImageTraits::pixel_t read_pixel(FILE* f);
+  typename ImageTraits::pixel_t read_pixel(FileReader* f);
   void write_pixel(FILE* f, typename ImageTraits::pixel_t c);
   void read_scanline(typename ImageTraits::address_t address, int w, uint8_t* buffer);
   void write_scanline(typename ImageTraits::address_t address, int w, uint8_t* buffer);
@@ -907,11 +1113,11 @@ template<>
 class PixelIO<RgbTraits> {
   int r, g, b, a;
 public:
-  RgbTraits::pixel_t read_pixel(FILE* f) {
-    r = fgetc(f);
-    g = fgetc(f);
-    b = fgetc(f);
-    a = fgetc(f);
+  RgbTraits::pixel_t read_pixel(FileReader* f) {
+    r = f->getc();
+    g = f->getc();
+    b = f->getc();
+    a = f->getc();
     return rgba(r, g, b, a);
   }
   void write_pixel(FILE* f, RgbTraits::pixel_t c) {
@@ -946,9 +1152,9 @@ template<>
 class PixelIO<GrayscaleTraits> {
   int k, a;
 public:
-  GrayscaleTraits::pixel_t read_pixel(FILE* f) {
-    k = fgetc(f);
-    a = fgetc(f);
+  GrayscaleTraits::pixel_t read_pixel(FileReader* f) {
+    k = f->getc();
+    a = f->getc();
     return graya(k, a);
   }
   void write_pixel(FILE* f, GrayscaleTraits::pixel_t c) {
@@ -976,8 +1182,8 @@ public:
 template<>
 class PixelIO<IndexedTraits> {
 public:
-  IndexedTraits::pixel_t read_pixel(FILE* f) {
-    return fgetc(f);
+  IndexedTraits::pixel_t read_pixel(FileReader* f) {
+    return f->getc();
   }
   void write_pixel(FILE* f, IndexedTraits::pixel_t c) {
     fputc(c, f);
@@ -997,7 +1203,7 @@ public:
 //////////////////////////////////////////////////////////////////////
 
 template<typename ImageTraits>
-static void read_raw_image(FILE* f, Image* image, FileOp* fop, ASE_Header* header)
+static void read_raw_image(FileReader* f, Image* image, FileOp* fop, ASE_Header* header)
 {
   PixelIO<ImageTraits> pixel_io;
   int x, y;
@@ -1006,7 +1212,7 @@ static void read_raw_image(FILE* f, Image* image, FileOp* fop, ASE_Header* heade
     for (x=0; x<image->width(); x++)
       put_pixel_fast<ImageTraits>(image, x, y, pixel_io.read_pixel(f));
 
-    fop->setProgress((float)ftell(f) / (float)header->size);
+    fop->setProgress((float)f->tell() / (float)header->size);
   }
 }
 
@@ -1026,7 +1232,7 @@ static void write_raw_image(FILE* f, const Image* image)
 //////////////////////////////////////////////////////////////////////
 
 template<typename ImageTraits>
-static void read_compressed_image(FILE* f, Image* image, size_t chunk_end, FileOp* fop, ASE_Header* header)
+static void decode_compressed_image(const uint8_t* compressed, size_t size, Image* image)
 {
   PixelIO<ImageTraits> pixel_io;
   z_stream zstream;
@@ -1040,59 +1246,35 @@ static void read_compressed_image(FILE* f, Image* image, size_t chunk_end, FileO
   if (err != Z_OK)
     throw base::Exception("ZLib error %d in inflateInit().", err);
 
-  std::vector<uint8_t> scanline(ImageTraits::getRowStrideBytes(image->width()));
-  std::vector<uint8_t> uncompressed(static_cast<long>(image->height()) * ImageTraits::getRowStrideBytes(image->width()));
-  std::vector<uint8_t> compressed(4096);
-  int uncompressed_offset = 0;
-
-  while (true) {
-    size_t input_bytes;
-
-    if (ftell(f)+compressed.size() > chunk_end) {
-      input_bytes = chunk_end - ftell(f); // Remaining bytes
-      ASSERT(input_bytes < compressed.size());
-
-      if (input_bytes == 0)
-        break;                  // Done, we consumed all chunk
-    }
-    else
-      input_bytes = compressed.size();
-
-    size_t bytes_read = fread(&compressed[0], 1, input_bytes, f);
-    zstream.next_in = (Bytef*)&compressed[0];
-    zstream.avail_in = bytes_read;
-
-    do {
-      zstream.next_out = (Bytef*)&scanline[0];
-      zstream.avail_out = scanline.size();
-
-      err = inflate(&zstream, Z_NO_FLUSH);
-      if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
-        throw base::Exception("ZLib error %d in inflate().", err);
-
-      size_t uncompressed_bytes = scanline.size() - zstream.avail_out;
-      if (uncompressed_bytes > 0) {
-        if (uncompressed_offset+uncompressed_bytes > uncompressed.size())
-          throw base::Exception("Bad compressed image.");
+  const size_t rowstride = ImageTraits::getRowStrideBytes(image->width());
+  std::vector<uint8_t> uncompressed(static_cast<long>(image->height()) * rowstride);
 
-        std::copy(scanline.begin(), scanline.begin()+uncompressed_bytes,
-                  uncompressed.begin()+uncompressed_offset);
+  // The whole chunk is already in memory, so we inflate it at once
+  zstream.next_in = (Bytef*)compressed;
+  zstream.avail_in = size;
+  zstream.next_out = (Bytef*)uncompressed.data();
+  zstream.avail_out = uncompressed.size();
 
-        uncompressed_offset += uncompressed_bytes;
-      }
-    } while (zstream.avail_out == 0);
+  err = inflate(&zstream, Z_FINISH);
+  if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
+    inflateEnd(&zstream);
+    throw base::Exception("ZLib error %d in inflate().", err);
+  }
 
-    fop->setProgress((float)ftell(f) / (float)header->size);
+  // There is more data than pixels in the image
+  if (err != Z_STREAM_END && zstream.avail_out == 0 && zstream.avail_in > 0) {
+    inflateEnd(&zstream);
+    throw base::Exception("Bad compressed image.");
   }
 
-  uncompressed_offset = 0;
+  size_t uncompressed_offset = 0;
   for (y=0; y<image->height(); y++) {
     typename ImageTraits::address_t address =
       (typename ImageTraits::address_t)image->getPixelAddress(0, y);
 
     pixel_io.read_scanline(address, image->width(), &uncompressed[uncompressed_offset]);
 
-    uncompressed_offset += ImageTraits::getRowStrideBytes(image->width());
+    uncompressed_offset += rowstride;
   }
 
   err = inflateEnd(&zstream);
@@ -1100,8 +1282,53 @@ static void read_compressed_image(FILE* f, Image* image, size_t chunk_end, FileO
     throw base::Exception("ZLib error %d in inflateEnd().", err);
 }
 
+static void decode_compressed_cel(ASE_CompressedCel& cel)
+{
+  // OK, in case of error we can show the problem, but continue
+  // loading more cels.
+  try {
+    switch (cel.image->pixelFormat()) {
+
+      case IMAGE_RGB:
+        decode_compressed_image<RgbTraits>(cel.data, cel.size, cel.image.get());
+        break;
+
+      case IMAGE_GRAYSCALE:
+        decode_compressed_image<GrayscaleTraits>(cel.data, cel.size, cel.image.get());
+        break;
+
+      case IMAGE_INDEXED:
+        decode_compressed_image<IndexedTraits>(cel.data, cel.size, cel.image.get());
+        break;
+    }
+  }
+  catch (const std::exception& e) {
+    cel.error = e.what();
+  }
+}
+
+// Inflates all pending cels in parallel (each cel is an independent
+// zlib stream) and reports their errors in the original file order.
+static void ase_decode_pending_cels(ASE_PendingCels* pending, FileOp* fop)
+{
+  std::vector<ASE_CompressedCel>& cels = pending->cels;
+
+  base::thread_pool::instance().parallel_for(
+    int(cels.size()),
+    [&cels](int i) {
+      decode_compressed_cel(cels[i]);
+    });
+
+  for (const ASE_CompressedCel& cel : cels)
+    if (!cel.error.empty())
+      fop->setError(cel.error.c_str());
+
+  cels.clear();
+  pending->bytes = 0;
+}
+
 template<typename ImageTraits>
-static void write_compressed_image(FILE* f, const Image* image)
+static void compress_image(const Image* image, int level, std::vector<uint8_t>& output)
 {
   PixelIO<ImageTraits> pixel_io;
   z_stream zstream;
@@ -1110,12 +1337,14 @@ static void write_compressed_image(FILE* f, const Image* image)
   zstream.zalloc = (alloc_func)0;
   zstream.zfree  = (free_func)0;
   zstream.opaque = (voidpf)0;
-  err = deflateInit(&zstream, Z_DEFAULT_COMPRESSION);
+  err = deflateInit(&zstream, level);
   if (err != Z_OK)
     throw base::Exception("ZLib error %d in deflateInit().", err);
 
   std::vector<uint8_t> scanline(ImageTraits::getRowStrideBytes(image->width()));
-  std::vector<uint8_t> compressed(4096);
+  output.resize(deflateBound(&zstream, scanline.size() * image->height()));
+  zstream.next_out = (Bytef*)&output[0];
+  zstream.avail_out = output.size();
 
   for (y=0; y<image->height(); y++) {
     typename ImageTraits::address_t address =
@@ -1127,43 +1356,105 @@ static void write_compressed_image(FILE* f, const Image* image)
     zstream.avail_in = scanline.size();
     int flush = (y == image->height()-1 ? Z_FINISH: Z_NO_FLUSH);
 
-    do {
-      zstream.next_out = (Bytef*)&compressed[0];
-      zstream.avail_out = compressed.size();
-
-      // Compress
-      err = deflate(&zstream, flush);
-      if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
-        throw base::Exception("ZLib error %d in deflate().", err);
-
-      int output_bytes = compressed.size() - zstream.avail_out;
-      if (output_bytes > 0) {
-        if ((fwrite(&compressed[0], 1, output_bytes, f) != (size_t)output_bytes)
-            || ferror(f))
-          throw base::Exception("Error writing compressed image pixels.\n");
-      }
-    } while (zstream.avail_out == 0);
+    // deflateBound() guarantees that the output buffer is big enough
+    err = deflate(&zstream, flush);
+    if (err != Z_OK && err != Z_STREAM_END) {
+      deflateEnd(&zstream);
+      throw base::Exception("ZLib error %d in deflate().", err);
+    }
   }
 
+  output.resize(output.size() - zstream.avail_out);
+
   err = deflateEnd(&zstream);
   if (err != Z_OK)
     throw base::Exception("ZLib error %d in deflateEnd().", err);
 }
 
+static void compress_cel_image(const Image* image, int level, std::vector<uint8_t>& output)
+{
+  switch (image->pixelFormat()) {
+
+    case IMAGE_RGB:
+      compress_image<RgbTraits>(image, level, output);
+      break;
+
+    case IMAGE_GRAYSCALE:
+      compress_image<GrayscaleTraits>(image, level, output);
+      break;
+
+    case IMAGE_INDEXED:
+      compress_image<IndexedTraits>(image, level, output);
+      break;
+  }
+}
+
+static void ase_collect_cels(const Layer* layer, frame_t frame, std::vector<const Cel*>& cels)
+{
+  if (layer->isImage()) {
+    const Cel* cel = layer->cel(frame).get();
+    if (cel && !cel->link() && cel->image())
+      cels.push_back(cel);
+  }
+
+  if (layer->isFolder()) {
+    auto it = static_cast<const LayerFolder*>(layer)->getLayerBegin(),
+         end = static_cast<const LayerFolder*>(layer)->getLayerEnd();
+
+    for (; it != end; ++it)
+      ase_collect_cels(*it, frame, cels);
+  }
+}
+
+// Compresses (in parallel) the cels of the frames from "frame" until
+// kMaxCompressBatchBytes of pixels are collected (skipping frames
+// copied from the previous file). Returns the first frame that wasn't
+// compressed.
+static frame_t ase_compress_cels(const Sprite* sprite, frame_t frame, int level,
+                                 const std::vector<bool>& reused,
+                                 ASE_CompressedCels& buffers)
+{
+  std::vector<const Cel*> cels;
+  size_t bytes = 0;
+
+  buffers.clear();
+  do {
+    size_t i = cels.size();
+    if (!reused[frame])
+      ase_collect_cels(sprite->folder(), frame, cels);
+    for (; i<cels.size(); ++i)
+      bytes += cels[i]->image()->getMemSize();
+    ++frame;
+  } while (frame < sprite->totalFrames() && bytes < kMaxCompressBatchBytes);
+
+  std::vector<std::vector<uint8_t>> outputs(cels.size());
+  base::thread_pool::instance().parallel_for(
+    int(cels.size()),
+    [&cels, &outputs, level](int i) {
+      compress_cel_image(cels[i]->image(), level, outputs[i]);
+    });
+
+  for (size_t i=0; i<cels.size(); ++i)
+    buffers[cels[i]] = std::move(outputs[i]);
+
+  return frame;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Cel Chunk
 //////////////////////////////////////////////////////////////////////
 
-static Cel* ase_file_read_cel_chunk(FILE* f, Sprite* sprite, frame_t frame,
+static Cel* ase_file_read_cel_chunk(FileReader* f, Sprite* sprite, frame_t frame,
                                     PixelFormat pixelFormat,
-                                    FileOp* fop, ASE_Header* header, size_t chunk_end)
+                                    FileOp* fop, ASE_Header* header, size_t chunk_end,
+                                    ASE_PendingCels* pending)
 {
   /* read chunk data */
-  LayerIndex layer_index = LayerIndex(fgetw(f));
-  int x = ((short)fgetw(f));
-  int y = ((short)fgetw(f));
-  int opacity = fgetc(f);
-  int cel_type = fgetw(f);
+  LayerIndex layer_index = LayerIndex(f->getw());
+  int x = ((short)f->getw());
+  int y = ((short)f->getw());
+  int opacity = f->getc();
+  int cel_type = f->getw();
   Layer* layer;
 
   ase_file_read_padding(f, 7);
@@ -1187,8 +1478,8 @@ static Cel* ase_file_read_cel_chunk(FILE* f, Sprite* sprite, frame_t frame,
 
     case ASE_FILE_RAW_CEL: {
       // Read width and height
-      int w = fgetw(f);
-      int h = fgetw(f);
+      int w = f->getw();
+      int h = f->getw();
 
       if (w > 0 && h > 0) {
         ImageRef image(Image::create(pixelFormat, w, h));
@@ -1218,7 +1509,7 @@ static Cel* ase_file_read_cel_chunk(FILE* f, Sprite* sprite, frame_t frame,
 
     case ASE_FILE_LINK_CEL: {
       // Read link position
-      frame_t link_frame = frame_t(fgetw(f));
+      frame_t link_frame = frame_t(f->getw());
       if (auto link = layer->cel(link_frame)) {
         // There were a beta version that allow to the user specify
         // different X, Y, or opacity per link, in that case we must
@@ -1242,34 +1533,46 @@ static Cel* ase_file_read_cel_chunk(FILE* f, Sprite* sprite, frame_t frame,
 
     case ASE_FILE_COMPRESSED_CEL: {
       // Read width and height
-      int w = fgetw(f);
-      int h = fgetw(f);
+      int w = f->getw();
+      int h = f->getw();
+
+#ifdef ASEPRITE_LITTLE_ENDIAN
+      // The compressed pixels are kept in memory and decoded when the
+      // cel is used (the .ase pixels have the same byte order as the
+      // Image in little endian)
+      if (w > 0 && h > 0 &&
+          fop->keepCompressedCels() &&
+          f->tell() < chunk_end) {
+        const size_t size = std::min(chunk_end - f->tell(), f->size() - f->tell());
+        const uLong bytes = uLong(calculate_rowstride_bytes(pixelFormat, w)) * h;
+        if (size <= compressBound(bytes)) {
+          auto data = std::make_shared<std::vector<uint8_t>>();
+          make_zlib_image_stream(*data, pixelFormat, w, h,
+                                 sprite->transparentColor(),
+                                 f->data(size), size);
+
+          cel = std::make_shared<Cel>(frame, ImageRef(Image::create(pixelFormat, 1, 1)));
+          cel->setPosition(x, y);
+          cel->setOpacity(opacity);
+          cel->data()->setCompressedImage(data, 1);
+          break;
+        }
+      }
+#endif
 
       if (w > 0 && h > 0) {
         ImageRef image(Image::create(pixelFormat, w, h));
 
-        // Try to read pixel data
-        try {
-          switch (image->pixelFormat()) {
-
-            case IMAGE_RGB:
-              read_compressed_image<RgbTraits>(f, image.get(), chunk_end, fop, header);
-              break;
-
-            case IMAGE_GRAYSCALE:
-              read_compressed_image<GrayscaleTraits>(f, image.get(), chunk_end, fop, header);
-              break;
-
-            case IMAGE_INDEXED:
-              read_compressed_image<IndexedTraits>(f, image.get(), chunk_end, fop, header);
-              break;
-          }
-        }
-        // OK, in case of error we can show the problem, but continue
-        // loading more cels.
-        catch (const std::exception& e) {
-          fop->setError(e.what());
+        // The compressed data will be decoded (in parallel with
+        // other cels) by ase_decode_pending_cels()
+        ASE_CompressedCel compressed;
+        compressed.image = image;
+        if (f->tell() < chunk_end) {
+          compressed.size = std::min(chunk_end - f->tell(), f->size() - f->tell());
+          compressed.data = f->data(compressed.size);
         }
+        pending->bytes += compressed.size;
+        pending->cels.push_back(std::move(compressed));
 
         cel = std::make_shared<Cel>(frame, image);
         cel->setPosition(x, y);
@@ -1287,7 +1590,8 @@ static Cel* ase_file_read_cel_chunk(FILE* f, Sprite* sprite, frame_t frame,
 }
 
 static void ase_file_write_cel_chunk(FILE* f, ASE_FrameHeader* frame_header,
-                                     const Cel* cel, const LayerImage* layer, const Sprite* sprite)
+                                     const Cel* cel, const LayerImage* layer, const Sprite* sprite,
+                                     const ASE_CompressedCels& buffers)
 {
   ChunkWriter chunk(f, frame_header, ASE_FILE_CHUNK_CEL);
 
@@ -1349,20 +1653,14 @@ static void ase_file_write_cel_chunk(FILE* f, ASE_FrameHeader* frame_header,
         fputw(image->width(), f);
         fputw(image->height(), f);
 
-        // Pixel data
-        switch (image->pixelFormat()) {
-
-          case IMAGE_RGB:
-            write_compressed_image<RgbTraits>(f, image);
-            break;
-
-          case IMAGE_GRAYSCALE:
-            write_compressed_image<GrayscaleTraits>(f, image);
-            break;
-
-          case IMAGE_INDEXED:
-            write_compressed_image<IndexedTraits>(f, image);
-            break;
+        // Pixel data (compressed by ase_compress_cels())
+        auto it = buffers.find(cel);
+        ASSERT(it != buffers.end());
+        if (it != buffers.end() && !it->second.empty()) {
+          const std::vector<uint8_t>& data = it->second;
+          if ((fwrite(&data[0], 1, data.size(), f) != data.size())
+              || ferror(f))
+            throw base::Exception("Error writing compressed image pixels.\n");
         }
       }
       else {
@@ -1375,15 +1673,15 @@ static void ase_file_write_cel_chunk(FILE* f, ASE_FrameHeader* frame_header,
   }
 }
 
-static Mask* ase_file_read_mask_chunk(FILE* f)
+static Mask* ase_file_read_mask_chunk(FileReader* f)
 {
   int c, u, v, byte;
   Mask* mask;
   // Read chunk data
-  int x = fgetw(f);
-  int y = fgetw(f);
-  int w = fgetw(f);
-  int h = fgetw(f);
+  int x = f->getw();
+  int y = f->getw();
+  int w = f->getw();
+  int h = f->getw();
 
   ase_file_read_padding(f, 8);
   std::string name = ase_file_read_string(f);
@@ -1395,7 +1693,7 @@ static Mask* ase_file_read_mask_chunk(FILE* f)
   // Read image data
   for (v=0; v<h; v++)
     for (u=0; u<(w+7)/8; u++) {
-      byte = fgetc(f);
+      byte = f->getc();
       for (c=0; c<8; c++)
         put_pixel(mask->bitmap(), u*8+c, v, byte & (1<<(7-c)));
     }
@@ -1432,30 +1730,30 @@ static void ase_file_write_mask_chunk(FILE* f, ASE_FrameHeader* frame_header, Ma
 }
 #endif
 
-static void ase_file_read_frame_tags_chunk(FILE* f, FrameTags* frameTags)
+static void ase_file_read_frame_tags_chunk(FileReader* f, FrameTags* frameTags)
 {
-  size_t tags = fgetw(f);
+  size_t tags = f->getw();
 
-  fgetl(f);                     // 8 reserved bytes
-  fgetl(f);
+  f->getl();                    // 8 reserved bytes
+  f->getl();
 
   for (size_t c=0; c<tags; ++c) {
-    frame_t from = fgetw(f);
-    frame_t to = fgetw(f);
-    int aniDir = fgetc(f);
+    frame_t from = f->getw();
+    frame_t to = f->getw();
+    int aniDir = f->getc();
     if (aniDir != int(AniDir::FORWARD) &&
         aniDir != int(AniDir::REVERSE) &&
         aniDir != int(AniDir::PING_PONG)) {
       aniDir = int(AniDir::FORWARD);
     }
 
-    fgetl(f);                     // 8 reserved bytes
-    fgetl(f);
+    f->getl();                    // 8 reserved bytes
+    f->getl();
 
-    int r = fgetc(f);
-    int g = fgetc(f);
-    int b = fgetc(f);
-    fgetc(f);                     // Skip
+    int r = f->getc();
+    int g = f->getc();
+    int b = f->getc();
+    f->getc();                    // Skip
 
     std::string name = ase_file_read_string(f);
 
@@ -1493,9 +1791,9 @@ static void ase_file_write_frame_tags_chunk(FILE* f, ASE_FrameHeader* frame_head
   }
 }
 
-static void ase_file_read_user_data_chunk(FILE* f, UserData* userData)
+static void ase_file_read_user_data_chunk(FileReader* f, UserData* userData)
 {
-  size_t flags = fgetl(f);
+  size_t flags = f->getl();
 
   if (flags & ASE_USER_DATA_FLAG_HAS_TEXT) {
     std::string text = ase_file_read_string(f);
@@ -1503,10 +1801,10 @@ static void ase_file_read_user_data_chunk(FILE* f, UserData* userData)
   }
 
   if (flags & ASE_USER_DATA_FLAG_HAS_COLOR) {
-    int r = fgetc(f);
-    int g = fgetc(f);
-    int b = fgetc(f);
-    int a = fgetc(f);
+    int r = f->getc();
+    int g = f->getc();
+    int b = f->getc();
+    int a = f->getc();
     userData->setColor(doc::rgba(r, g, b, a));
   }
 }
@@ -1575,4 +1873,119 @@ static void ase_ungroup_all(LayerFolder* folder)
   }
 }
 
+// FNV-1a of the bytes of the given value
+static uint64_t ase_hash(uint64_t hash, uint64_t value)
+{
+  for (int i=0; i<8; ++i) {
+    hash ^= (value >> (i*8)) & 0xff;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static uint64_t ase_hash_object(uint64_t hash, const Object* object)
+{
+  hash = ase_hash(hash, object->id());
+  return ase_hash(hash, object->version());
+}
+
+// User data doesn't change the version of its object
+static uint64_t ase_hash_user_data(uint64_t hash, const UserData& userData)
+{
+  for (char chr : userData.text())
+    hash = ase_hash(hash, uint8_t(chr));
+  hash = ase_hash(hash, userData.text().size());
+  return ase_hash(hash, userData.color());
+}
+
+static uint64_t ase_layers_signature(uint64_t hash, const Layer* layer)
+{
+  hash = ase_hash_object(hash, layer);
+  hash = ase_hash_user_data(hash, layer->userData());
+
+  if (layer->isFolder()) {
+    auto it = static_cast<const LayerFolder*>(layer)->getLayerBegin(),
+         end = static_cast<const LayerFolder*>(layer)->getLayerEnd();
+
+    for (; it != end; ++it)
+      hash = ase_layers_signature(hash, *it);
+  }
+  return hash;
+}
+
+static uint64_t ase_cels_signature(uint64_t hash, const Layer* layer, frame_t frame)
+{
+  if (layer->isImage()) {
+    const auto cel = layer->cel(frame);
+    if (cel) {
+      auto link = cel->link();
+      hash = ase_hash_object(hash, cel.get());
+      hash = ase_hash(hash, cel->x());
+      hash = ase_hash(hash, cel->y());
+      hash = ase_hash(hash, cel->opacity());
+      hash = ase_hash(hash, link ? link->frame()+1: 0);
+      hash = ase_hash_object(hash, cel->data());
+      hash = ase_hash_user_data(hash, cel->data()->userData());
+
+      // Without loading swapped out images
+      if (ObjectId imageId = cel->data()->imageId()) {
+        hash = ase_hash(hash, imageId);
+        hash = ase_hash(hash, cel->data()->imageVersion());
+      }
+    }
+    else
+      hash = ase_hash(hash, 0);
+  }
+
+  if (layer->isFolder()) {
+    auto it = static_cast<const LayerFolder*>(layer)->getLayerBegin(),
+         end = static_cast<const LayerFolder*>(layer)->getLayerEnd();
+
+    for (; it != end; ++it)
+      hash = ase_cels_signature(hash, *it, frame);
+  }
+  return hash;
+}
+
+// Signature of the sprite properties and layers, if it changes the
+// file must be saved completely (e.g. cels reference layers by index)
+static uint64_t ase_structure_signature(const Sprite* sprite, bool require_new_palette_chunk)
+{
+  uint64_t hash = 14695981039346656037ull;
+  hash = ase_hash(hash, sprite->pixelFormat());
+  hash = ase_hash(hash, sprite->width());
+  hash = ase_hash(hash, sprite->height());
+  hash = ase_hash(hash, sprite->transparentColor());
+  hash = ase_hash(hash, require_new_palette_chunk);
+  return ase_layers_signature(hash, sprite->folder());
+}
+
+// Signature of everything that is written in the block of the given
+// frame. It uses the object versions, so it's only valid to compare
+// signatures of the same document.
+static uint64_t ase_frame_signature(const Sprite* sprite, frame_t frame)
+{
+  uint64_t hash = 14695981039346656037ull;
+  hash = ase_hash(hash, frame);
+  hash = ase_hash(hash, sprite->frameDuration(frame));
+  hash = ase_hash_object(hash, sprite->palette(frame));
+  if (frame > 0)
+    hash = ase_hash_object(hash, sprite->palette(frame-1));
+  return ase_cels_signature(hash, sprite->folder(), frame);
+}
+
+// Checks that the old file still has the frame block in the given
+// position
+static bool ase_is_frame_block(FileReader* f, const AseFileIndex::Frame& frame)
+{
+  f->seek(frame.offset);
+  const uint8_t* data = f->data(frame.size);
+  if (!data || frame.size < 16)
+    return false;
+
+  const size_t size = (data[0] | (data[1] << 8) | (data[2] << 16) | (size_t(data[3]) << 24));
+  const int magic = (data[4] | (data[5] << 8));
+  return (size == frame.size && magic == ASE_FILE_FRAME_MAGIC);
+}
+
 } // namespace app
@@ -16,8 +16,12 @@
 #include "app/file/format_options.h"
 #include "base/cfile.h"
 #include "base/file_handle.h"
+#include "base/file_reader.h"
 #include "doc/doc.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace base;
@@ -114,13 +118,13 @@ typedef struct OS2BMPINFOHEADER  // Size: 12.
 /* read_bmfileheader:
  *  Reads a BMP file header and check that it has the BMP magic number.
  */
-static int read_bmfileheader(FILE *f, BITMAPFILEHEADER *fileheader)
+static int read_bmfileheader(FileReader *f, BITMAPFILEHEADER *fileheader)
 {
-  fileheader->bfType = fgetw(f);
-  fileheader->bfSize = fgetl(f);
-  fileheader->bfReserved1 = fgetw(f);
-  fileheader->bfReserved2 = fgetw(f);
-  fileheader->bfOffBits = fgetl(f);
+  fileheader->bfType = f->getw();
+  fileheader->bfSize = f->getl();
+  fileheader->bfReserved1 = f->getw();
+  fileheader->bfReserved2 = f->getw();
+  fileheader->bfOffBits = f->getl();
 
   if (fileheader->bfType != 19778)
     return -1;
@@ -131,20 +135,20 @@ static int read_bmfileheader(FILE *f, BITMAPFILEHEADER *fileheader)
 /* read_win_bminfoheader:
  *  Reads information from a BMP file header.
  */
-static int read_win_bminfoheader(FILE *f, BITMAPINFOHEADER *infoheader)
+static int read_win_bminfoheader(FileReader *f, BITMAPINFOHEADER *infoheader)
 {
   WINBMPINFOHEADER win_infoheader;
 
-  win_infoheader.biWidth = fgetl(f);
-  win_infoheader.biHeight = fgetl(f);
-  win_infoheader.biPlanes = fgetw(f);
-  win_infoheader.biBitCount = fgetw(f);
-  win_infoheader.biCompression = fgetl(f);
-  win_infoheader.biSizeImage = fgetl(f);
-  win_infoheader.biXPelsPerMeter = fgetl(f);
-  win_infoheader.biYPelsPerMeter = fgetl(f);
-  win_infoheader.biClrUsed = fgetl(f);
-  win_infoheader.biClrImportant = fgetl(f);
+  win_infoheader.biWidth = f->getl();
+  win_infoheader.biHeight = f->getl();
+  win_infoheader.biPlanes = f->getw();
+  win_infoheader.biBitCount = f->getw();
+  win_infoheader.biCompression = f->getl();
+  win_infoheader.biSizeImage = f->getl();
+  win_infoheader.biXPelsPerMeter = f->getl();
+  win_infoheader.biYPelsPerMeter = f->getl();
+  win_infoheader.biClrUsed = f->getl();
+  win_infoheader.biClrImportant = f->getl();
 
   infoheader->biWidth = win_infoheader.biWidth;
   infoheader->biHeight = win_infoheader.biHeight;
@@ -157,14 +161,14 @@ static int read_win_bminfoheader(FILE *f, BITMAPINFOHEADER *infoheader)
 /* read_os2_bminfoheader:
  *  Reads information from an OS/2 format BMP file header.
  */
-static int read_os2_bminfoheader(FILE *f, BITMAPINFOHEADER *infoheader)
+static int read_os2_bminfoheader(FileReader *f, BITMAPINFOHEADER *infoheader)
 {
   OS2BMPINFOHEADER os2_infoheader;
 
-  os2_infoheader.biWidth = fgetw(f);
-  os2_infoheader.biHeight = fgetw(f);
-  os2_infoheader.biPlanes = fgetw(f);
-  os2_infoheader.biBitCount = fgetw(f);
+  os2_infoheader.biWidth = f->getw();
+  os2_infoheader.biHeight = f->getw();
+  os2_infoheader.biPlanes = f->getw();
+  os2_infoheader.biBitCount = f->getw();
 
   infoheader->biWidth = os2_infoheader.biWidth;
   infoheader->biHeight = os2_infoheader.biHeight;
@@ -177,14 +181,14 @@ static int read_os2_bminfoheader(FILE *f, BITMAPINFOHEADER *infoheader)
 /* read_bmicolors:
  *  Loads the color palette for 1,4,8 bit formats.
  */
-static void read_bmicolors(FileOp* fop, int bytes, FILE *f, bool win_flag)
+static void read_bmicolors(FileOp* fop, int bytes, FileReader *f, bool win_flag)
 {
   int i, j, r, g, b;
 
   for (i=j=0; i+3 <= bytes && j < 256; ) {
-    b = fgetc(f);
-    g = fgetc(f);
-    r = fgetc(f);
+    b = f->getc();
+    g = f->getc();
+    r = f->getc();
 
     fop->sequenceSetColor(j, r, g, b);
 
@@ -192,155 +196,74 @@ static void read_bmicolors(FileOp* fop, int bytes, FILE *f, bool win_flag)
     i += 3;
 
     if (win_flag && i < bytes) {
-      fgetc(f);
+      f->getc();
       i++;
     }
   }
 
   for (; i<bytes; i++)
-    fgetc(f);
+    f->getc();
 }
 
 /* read_1bit_line:
  *  Support function for reading the 1 bit bitmap file format.
  */
-static void read_1bit_line(int length, FILE *f, Image *image, int line)
+static void read_1bit_line(int length, const uint8_t* src, uint8_t* dst)
 {
-  unsigned char b[32];
-  unsigned long n;
-  int i, j, k;
-  int pix;
-
-  for (i=0; i<length; i++) {
-    j = i % 32;
-    if (j == 0) {
-      n = fgetl(f);
-      n =
-        ((n&0x000000ff)<<24) |
-        ((n&0x0000ff00)<< 8) |
-        ((n&0x00ff0000)>> 8) |
-        ((n&0xff000000)>>24);
-      for (k=0; k<32; k++) {
-        b[31-k] = (char)(n & 1);
-        n = n >> 1;
-      }
-    }
-    pix = b[j];
-    put_pixel(image, i, line, pix);
-  }
+  for (int i=0; i<length; i++)
+    dst[i] = (src[i >> 3] >> (7 - (i & 7))) & 1;
 }
 
 /* read_4bit_line:
  *  Support function for reading the 4 bit bitmap file format.
  */
-static void read_4bit_line(int length, FILE *f, Image *image, int line)
+static void read_4bit_line(int length, const uint8_t* src, uint8_t* dst)
 {
-  unsigned char b[8];
-  unsigned long n;
-  int i, j, k;
-  int temp;
-  int pix;
-
-  for (i=0; i<length; i++) {
-    j = i % 8;
-    if (j == 0) {
-      n = fgetl(f);
-      for (k=0; k<4; k++) {
-        temp = n & 255;
-        b[k*2+1] = temp & 15;
-        temp = temp >> 4;
-        b[k*2] = temp & 15;
-        n = n >> 8;
-      }
-    }
-    pix = b[j];
-    put_pixel(image, i, line, pix);
-  }
+  for (int i=0; i<length; i++)
+    dst[i] = (i & 1 ? src[i >> 1] & 15: src[i >> 1] >> 4);
 }
 
 /* read_8bit_line:
  *  Support function for reading the 8 bit bitmap file format.
  */
-static void read_8bit_line(int length, FILE *f, Image *image, int line)
+static void read_8bit_line(int length, const uint8_t* src, uint8_t* dst)
 {
-  unsigned char b[4];
-  unsigned long n;
-  int i, j, k;
-  int pix;
-
-  for (i=0; i<length; i++) {
-    j = i % 4;
-    if (j == 0) {
-      n = fgetl(f);
-      for (k=0; k<4; k++) {
-        b[k] = (char)(n & 255);
-        n = n >> 8;
-      }
-    }
-    pix = b[j];
-    put_pixel(image, i, line, pix);
-  }
+  std::copy(src, src+length, dst);
 }
 
-static void read_16bit_line(int length, FILE *f, Image *image, int line)
+static void read_16bit_line(int length, const uint8_t* src, uint32_t* dst)
 {
-  int i, r, g, b, word;
+  for (int i=0; i<length; i++, src+=2) {
+    int word = (src[1] << 8) | src[0];
 
-  for (i=0; i<length; i++) {
-    word = fgetw(f);
-
-    r = (word >> 10) & 0x1f;
-    g = (word >> 5) & 0x1f;
-    b = (word) & 0x1f;
-
-    put_pixel(image, i, line,
-              rgba(scale_5bits_to_8bits(r),
-                   scale_5bits_to_8bits(g),
-                   scale_5bits_to_8bits(b), 255));
+    dst[i] = rgba(scale_5bits_to_8bits((word >> 10) & 0x1f),
+                  scale_5bits_to_8bits((word >> 5) & 0x1f),
+                  scale_5bits_to_8bits(word & 0x1f), 255);
   }
-
-  i = (2*i) % 4;
-  if (i > 0)
-    while (i++ < 4)
-      fgetc(f);
 }
 
-static void read_24bit_line(int length, FILE *f, Image *image, int line)
+static void read_24bit_line(int length, const uint8_t* src, uint32_t* dst)
 {
-  int i, r, g, b;
-
-  for (i=0; i<length; i++) {
-    b = fgetc(f);
-    g = fgetc(f);
-    r = fgetc(f);
-    put_pixel(image, i, line, rgba(r, g, b, 255));
-  }
-
-  i = (3*i) % 4;
-  if (i > 0)
-    while (i++ < 4)
-      fgetc(f);
+  for (int i=0; i<length; i++, src+=3)
+    dst[i] = rgba(src[2], src[1], src[0], 255);
 }
 
-static void read_32bit_line(int length, FILE *f, Image *image, int line)
+static void read_32bit_line(int length, const uint8_t* src, uint32_t* dst)
 {
-  int i, r, g, b;
-
-  for (i=0; i<length; i++) {
-    b = fgetc(f);
-    g = fgetc(f);
-    r = fgetc(f);
-    fgetc(f);
-    put_pixel(image, i, line, rgba(r, g, b, 255));
-  }
+  for (int i=0; i<length; i++, src+=4)
+    dst[i] = rgba(src[2], src[1], src[0], 255);
 }
 
 /* read_image:
- *  For reading the noncompressed BMP image format.
+ *  For reading the noncompressed BMP image format. Each row (padded
+ *  to 32 bits) is read at once and decoded in the image row.
  */
-static void read_image(FILE *f, Image *image, const BITMAPINFOHEADER *infoheader, FileOp *fop)
+static void read_image(FileReader *f, Image *image, const BITMAPINFOHEADER *infoheader, FileOp *fop)
 {
   int i, line, height, dir;
+  const int width = (int)infoheader->biWidth;
+  const std::size_t stride = ((std::size_t(width) * infoheader->biBitCount + 31) / 32) * 4;
+  std::vector<uint8_t> buffer;
 
   height = (int)infoheader->biHeight;
   line   = height < 0 ? 0: height-1;
@@ -348,13 +271,16 @@ static void read_image(FILE *f, Image *image, const BITMAPINFOHEADER *infoheader
   height = ABS(height);
 
   for (i=0; i<height; i++, line+=dir) {
+    const uint8_t* src = f->data(stride, buffer);
+    uint8_t* dst = image->getPixelAddress(0, line);
+
     switch (infoheader->biBitCount) {
-      case 1: read_1bit_line(infoheader->biWidth, f, image, line); break;
-      case 4: read_4bit_line(infoheader->biWidth, f, image, line); break;
-      case 8: read_8bit_line(infoheader->biWidth, f, image, line); break;
-      case 16: read_16bit_line(infoheader->biWidth, f, image, line); break;
-      case 24: read_24bit_line(infoheader->biWidth, f, image, line); break;
-      case 32: read_32bit_line(infoheader->biWidth, f, image, line); break;
+      case 1: read_1bit_line(width, src, dst); break;
+      case 4: read_4bit_line(width, src, dst); break;
+      case 8: read_8bit_line(width, src, dst); break;
+      case 16: read_16bit_line(width, src, (uint32_t*)dst); break;
+      case 24: read_24bit_line(width, src, (uint32_t*)dst); break;
+      case 32: read_32bit_line(width, src, (uint32_t*)dst); break;
     }
 
     fop->setProgress((float)(i+1) / (float)(height));
@@ -363,17 +289,46 @@ static void read_image(FILE *f, Image *image, const BITMAPINFOHEADER *infoheader
   }
 }
 
+/* fill_rle_run:
+ *  Puts "count" pixels of the given index from "pos" in the given
+ *  line (clipping the pixels outside the image).
+ */
+static void fill_rle_run(Image *image, int pos, int line, int count, uint8_t index)
+{
+  if (line < 0 || line >= image->height() || pos >= image->width())
+    return;
+
+  count = std::min(count, image->width() - pos);
+  if (count > 0)
+    std::fill_n(image->getPixelAddress(pos, line), count, index);
+}
+
+/* copy_rle_run:
+ *  Copies "count" indexes from "src" to the given line (clipping the
+ *  pixels outside the image).
+ */
+static void copy_rle_run(Image *image, int pos, int line, int count, const uint8_t* src)
+{
+  if (line < 0 || line >= image->height() || pos >= image->width())
+    return;
+
+  count = std::min(count, image->width() - pos);
+  if (count > 0)
+    std::copy(src, src+count, image->getPixelAddress(pos, line));
+}
+
 /* read_rle8_compressed_image:
  *  For reading the 8 bit RLE compressed BMP image format.
  *
  * @note This support compressed top-down bitmaps, the MSDN says that
  *       they can't exist, but Photoshop can create them.
  */
-static void read_rle8_compressed_image(FILE *f, Image *image, const BITMAPINFOHEADER *infoheader)
+static void read_rle8_compressed_image(FileReader *f, Image *image, const BITMAPINFOHEADER *infoheader)
 {
-  unsigned char count, val, val0;
-  int j, pos, line, height, dir;
+  unsigned char count, val;
+  int pos, line, height, dir;
   int eolflag, eopicflag;
+  std::vector<uint8_t> buffer;
 
   eopicflag = 0;
 
@@ -387,14 +342,12 @@ static void read_rle8_compressed_image(FILE *f, Image *image, const BITMAPINFOHE
     eolflag = 0;                           /* end of line flag */
 
     while ((eolflag == 0) && (eopicflag == 0)) {
-      count = fgetc(f);
-      val = fgetc(f);
+      count = f->getc();
+      val = f->getc();
 
       if (count > 0) {                    /* repeat pixel count times */
-        for (j=0;j<count;j++) {
-          put_pixel(image, pos, line, val);
-          pos++;
-        }
+        fill_rle_run(image, pos, line, count, val);
+        pos += count;
       }
       else {
         switch (val) {
@@ -408,21 +361,17 @@ static void read_rle8_compressed_image(FILE *f, Image *image, const BITMAPINFOHE
             break;
 
           case 2:                       /* displace picture */
-            count = fgetc(f);
-            val = fgetc(f);
+            count = f->getc();
+            val = f->getc();
             pos += count;
             line += val*dir;
             break;
 
           default:                      /* read in absolute mode */
-            for (j=0; j<val; j++) {
-              val0 = fgetc(f);
-              put_pixel(image, pos, line, val0);
-              pos++;
-            }
-
-            if (j%2 == 1)
-              val0 = fgetc(f);    /* align on word boundary */
+            /* the data is aligned on word boundary */
+            copy_rle_run(image, pos, line, val,
+                         f->data((val+1) & ~1, buffer));
+            pos += val;
             break;
 
         }
@@ -444,13 +393,14 @@ static void read_rle8_compressed_image(FILE *f, Image *image, const BITMAPINFOHE
  * @note This support compressed top-down bitmaps, the MSDN says that
  *       they can't exist, but Photoshop can create them.
  */
-static void read_rle4_compressed_image(FILE *f, Image *image, const BITMAPINFOHEADER *infoheader)
+static void read_rle4_compressed_image(FileReader *f, Image *image, const BITMAPINFOHEADER *infoheader)
 {
-  unsigned char b[8];
+  uint8_t b[256];
   unsigned char count;
-  unsigned short val0, val;
-  int j, k, pos, line, height, dir;
+  unsigned short val;
+  int j, pos, line, height, dir;
   int eolflag, eopicflag;
+  std::vector<uint8_t> buffer;
 
   eopicflag = 0;                            /* end of picture flag */
 
@@ -464,16 +414,14 @@ static void read_rle4_compressed_image(FILE *f, Image *image, const BITMAPINFOHE
     eolflag = 0;                           /* end of line flag */
 
     while ((eolflag == 0) && (eopicflag == 0)) {
-      count = fgetc(f);
-      val = fgetc(f);
+      count = f->getc();
+      val = f->getc();
 
       if (count > 0) {                    /* repeat pixels count times */
-        b[1] = val & 15;
-        b[0] = (val >> 4) & 15;
-        for (j=0; j<count; j++) {
-          put_pixel(image, pos, line, b[j%2]);
-          pos++;
-        }
+        for (j=0; j<count; j++)
+          b[j] = (j & 1 ? val & 15: (val >> 4) & 15);
+        copy_rle_run(image, pos, line, count, b);
+        pos += count;
       }
       else {
         switch (val) {
@@ -487,27 +435,21 @@ static void read_rle4_compressed_image(FILE *f, Image *image, const BITMAPINFOHE
             break;
 
           case 2:                       /* displace image */
-            count = fgetc(f);
-            val = fgetc(f);
+            count = f->getc();
+            val = f->getc();
             pos += count;
             line += val*dir;
             break;
 
-          default:                      /* read in absolute mode */
-            for (j=0; j<val; j++) {
-              if ((j%4) == 0) {
-                val0 = fgetw(f);
-                for (k=0; k<2; k++) {
-                  b[2*k+1] = val0 & 15;
-                  val0 = val0 >> 4;
-                  b[2*k] = val0 & 15;
-                  val0 = val0 >> 4;
-                }
-              }
-              put_pixel(image, pos, line, b[j%4]);
-              pos++;
-            }
+          default: {                    /* read in absolute mode */
+            /* two pixels per byte, aligned on word boundary */
+            const uint8_t* src = f->data(((val+3)/4)*2, buffer);
+            for (j=0; j<val; j++)
+              b[j] = (j & 1 ? src[j >> 1] & 15: src[j >> 1] >> 4);
+            copy_rle_run(image, pos, line, val, b);
+            pos += val;
             break;
+          }
         }
       }
 
@@ -521,7 +463,7 @@ static void read_rle4_compressed_image(FILE *f, Image *image, const BITMAPINFOHE
   }
 }
 
-static int read_bitfields_image(FILE *f, Image *image, BITMAPINFOHEADER *infoheader,
+static int read_bitfields_image(FileReader *f, Image *image, BITMAPINFOHEADER *infoheader,
                                 unsigned long rmask, unsigned long gmask, unsigned long bmask)
 {
 #define CALC_SHIFT(c)                           \
@@ -561,12 +503,19 @@ static int read_bitfields_image(FILE *f, Image *image, BITMAPINFOHEADER *infohea
   bytes_per_pixel = ((bits_per_pixel / 8) +
                      ((bits_per_pixel % 8) > 0 ? 1: 0));
 
+  const int width = (int)infoheader->biWidth;
+  const std::size_t stride = ((std::size_t(width) * bytes_per_pixel + 3) / 4) * 4;
+  std::vector<uint8_t> row;
+
   for (i=0; i<height; i++, line+=dir) {
-    for (j=0; j<(int)infoheader->biWidth; j++) {
+    const uint8_t* src = f->data(stride, row);
+    uint32_t* dst = (uint32_t*)image->getPixelAddress(0, line);
+
+    for (j=0; j<width; j++, src+=bytes_per_pixel) {
       /* read the DWORD, WORD or BYTE in little-endian order */
       buffer = 0;
       for (k=0; k<bytes_per_pixel; k++)
-        buffer |= fgetc(f) << (k<<3);
+        buffer |= (unsigned long)src[k] << (k<<3);
 
       r = (buffer & rmask) >> rshift;
       g = (buffer & gmask) >> gshift;
@@ -576,13 +525,8 @@ static int read_bitfields_image(FILE *f, Image *image, BITMAPINFOHEADER *infohea
       g = gscale ? gscale(g): g;
       b = bscale ? bscale(b): b;
 
-      put_pixel_fast<RgbTraits>(image, j, line, rgba(r, g, b, 255));
+      dst[j] = rgba(r, g, b, 255);
     }
-
-    j = (bytes_per_pixel*j) % 4;
-    if (j > 0)
-      while (j++ < 4)
-        fgetc(f);
   }
 
   return 0;
@@ -598,12 +542,13 @@ bool BmpFormat::onLoad(FileOp *fop)
   int format;
 
   FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
-  FILE* f = handle.get();
+  FileReader reader(handle);
+  FileReader* f = &reader;
 
   if (read_bmfileheader(f, &fileheader) != 0)
     return false;
 
-  biSize = fgetl(f);
+  biSize = f->getl();
 
   if (biSize == WININFOHEADERSIZE) {
     format = BMP_OPTIONS_FORMAT_WINDOWS;
@@ -637,9 +582,9 @@ bool BmpFormat::onLoad(FileOp *fop)
 
   /* bitfields have the 'mask' for each component */
   if (infoheader.biCompression == BI_BITFIELDS) {
-    rmask = fgetl(f);
-    gmask = fgetl(f);
-    bmask = fgetl(f);
+    rmask = f->getl();
+    gmask = f->getl();
+    bmask = f->getl();
   }
   else
     rmask = gmask = bmask = 0;
@@ -682,7 +627,7 @@ bool BmpFormat::onLoad(FileOp *fop)
       return false;
   }
 
-  if (ferror(f)) {
+  if (f->error()) {
     fop->setError("Error reading file.\n");
     return false;
   }
@@ -114,6 +114,7 @@ bool ExtensionFormat::onLoad(FileOp* fop)
   if (!base::is_directory(themePath)) {
     base::make_all_directories(themePath);
     archive.extractTo(themePath);
+    ResourceFinder::resetDataDirsCache();
   }
 
   if (themeName != Preferences::instance().theme.selected()) {
@@ -28,19 +28,28 @@
 #include "base/scoped_lock.h"
 #include "base/shared_ptr.h"
 #include "base/string.h"
+#include "base/thread_pool.h"
+#include "base/trace_span.h"
 #include "doc/doc.h"
+#include "doc/identical_cels.h"
+#include "doc/image_swap.h"
 #include "render/quantization.h"
 #include "render/render.h"
 #include "ui/alert.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cstdarg>
 #include <string_view>
+#include <vector>
 
 namespace app {
 
 using namespace base;
 
+// Size of the rendered frames of a sequence that are saved at the same time
+const int kMaxSequenceBatchBytes = 64*1024*1024;
+
 std::string get_readable_extensions()
 {
   std::string buf;
@@ -186,6 +195,23 @@ FileOp* FileOp::createLoadDocumentOperation(Context* context, const char* filena
   if (fop->m_loadFlags & FILE_LOAD_ONE_FRAME)
     fop->m_oneframe = true;
 
+  // Just the structure of the document (without pixels)
+  if (fop->m_loadFlags & FILE_LOAD_METADATA_ONLY)
+    fop->m_metadataOnly = true;
+
+  // Cels are decoded on demand
+  if ((fop->m_loadFlags & FILE_LOAD_COMPRESSED_CELS) &&
+      !fop->m_oneframe)
+    fop->m_compressedCels = true;
+
+  // Formats that support it can give the document with its first
+  // frame before it's completely loaded
+  if ((fop->m_loadFlags & FILE_LOAD_PROGRESSIVE) &&
+      !fop->m_oneframe &&
+      !fop->m_metadataOnly &&
+      !fop->isSequence())
+    fop->m_progressive = true;
+
   return fop.release();
 }
 
@@ -471,6 +497,10 @@ bool FileOp::operateLoadTryFormat(IFileOpProgress* progress)
 
     old_image = m_seq.image.get();
     m_seq.image.reset();
+
+    // Free memory for the next frames of big sequences
+    if (ImageSwap::instance().isOverBudget())
+      m_seq.last_cel->data()->swapOut();
     m_seq.last_cel = NULL;
   };
 
@@ -547,6 +577,9 @@ bool FileOp::operateLoadTryFormat(IFileOpProgress* progress)
     // Set the frames range
     m_document->sprite()->setTotalFrames(frame);
 
+    // Share the images of identical frames
+    link_identical_cels(m_document->sprite());
+
     // Sets special options from the specific format (e.g. BMP
     // file can contain the number of bits per pixel).
     m_document->setFormatOptions(m_seq.format_options);
@@ -602,6 +635,10 @@ void FileOp::operateLoad(IFileOpProgress* progress)
       LOG("Loading Exception");
     }
 
+    // The document is already in the UI, other formats cannot be tried
+    if (isFirstFrameLoaded())
+      return;
+
     if (firstError.empty())
       firstError = m_error;
   }
@@ -618,6 +655,7 @@ void FileOp::operateLoad(IFileOpProgress* progress)
 // FileOp::done() function.
 void FileOp::operate(IFileOpProgress* progress)
 {
+  TRACE_SPAN("FileOp::operate");
   ASSERT(!isDone());
 
   m_progressInterface = progress;
@@ -634,42 +672,49 @@ void FileOp::operate(IFileOpProgress* progress)
       ASSERT(m_format->support(FILE_SUPPORT_SEQUENCES));
 
       Sprite* sprite = m_document->sprite();
-
-      // Create a temporary bitmap
-      m_seq.image.reset(Image::create(sprite->pixelFormat(),
-          sprite->width(),
-          sprite->height()));
+      const frame_t nframes = sprite->totalFrames();
 
       m_seq.progress_offset = 0.0f;
-      m_seq.progress_fraction = 1.0f / (double)sprite->totalFrames();
-
-      // For each frame in the sprite.
-      render::Render render;
-      for (frame_t frame(0); frame < sprite->totalFrames(); ++frame) {
-        // Draw the "frame" in "m_seq.image"
-        render.renderSprite(m_seq.image.get(), sprite, frame);
-
-        // Setup the palette.
-        sprite->palette(frame)->copyColorsTo(*m_seq.palette);
-
-        // Setup the filename to be used.
-        m_filename = m_seq.filename_list[frame];
-
-        // Call the "save" procedure... did it fail?
-        if (!m_format->save(this)) {
+      m_seq.progress_fraction = 1.0f / (double)nframes;
+
+      // Frames are rendered and saved in parallel, in batches to
+      // limit the memory used by the rendered images.
+      const int frameBytes = std::max(1, sprite->width() * sprite->height() * 4);
+      const frame_t batchSize = std::clamp(frame_t(kMaxSequenceBatchBytes / frameBytes),
+                                           frame_t(1), nframes);
+      int savedFrames = 0;
+
+      for (frame_t first(0); first < nframes; first += batchSize) {
+        const frame_t last = std::min(nframes, first+batchSize);
+        std::vector<char> saved(last-first, false);
+
+        base::thread_pool::instance().parallel_for(
+          last-first,
+          [&](int i) {
+            saved[i] = saveSequenceFrame(first+i);
+
+            scoped_lock lock(m_mutex);
+            m_seq.progress_offset = m_seq.progress_fraction * (++savedFrames);
+            m_progress = m_seq.progress_offset;
+            if (m_progressInterface)
+              m_progressInterface->ackFileOpProgress(m_progress);
+          });
+
+        // Did it fail?
+        auto it = std::find(saved.begin(), saved.end(), false);
+        if (it != saved.end()) {
+          const frame_t frame = first + frame_t(it - saved.begin());
           setError("Error saving frame %d in the file \"%s\"\n",
-                   frame+1, m_filename.c_str());
+                   frame+1, m_seq.filename_list[frame].c_str());
           break;
         }
 
-        m_seq.progress_offset += m_seq.progress_fraction;
+        if (isStop())
+          break;
       }
 
       m_filename = *m_seq.filename_list.begin();
       m_document->setFilename(m_filename);
-
-      // Destroy the image
-      m_seq.image.reset();
     }
     // Direct save to a file.
     else {
@@ -699,6 +744,35 @@ void FileOp::stop()
     m_stop = true;
 }
 
+// Renders and saves the given frame of a sequence using its own
+// FileOp (so several frames can be saved at the same time).
+bool FileOp::saveSequenceFrame(frame_t frame)
+{
+  const Sprite* sprite = m_document->sprite();
+
+  FileOp fop(FileOpSave, m_context);
+  fop.m_format = m_format;
+  fop.m_document = m_document;
+  fop.m_filename = m_seq.filename_list[frame];
+  fop.m_seq.format_options = m_seq.format_options;
+  fop.m_seq.palette = Palette::create(256);
+  sprite->palette(frame)->copyColorsTo(*fop.m_seq.palette);
+  fop.m_seq.image.reset(Image::create(sprite->pixelFormat(),
+                                      sprite->width(),
+                                      sprite->height()));
+
+  // Draw the "frame" in the image of the sequence
+  render::Render render;
+  render.setParallel(true);
+  render.renderSprite(fop.m_seq.image.get(), sprite, frame);
+
+  // Call the "save" procedure
+  bool result = m_format->save(&fop);
+  if (fop.hasError())
+    setError("%s", fop.error().c_str());
+  return result;
+}
+
 FileOp::~FileOp()
 {
   if (m_format)
@@ -728,6 +802,14 @@ void FileOp::postLoad()
 
   bool result = m_format->postLoad(this);
   if (!result) {
+    // The thread of a progressive load can be still using the
+    // document, so the caller must destroy it after waiting the thread
+    if (isFirstFrameLoaded()) {
+      scoped_lock lock(m_mutex);
+      m_stop = true;
+      return;
+    }
+
     // Destroy the document
     delete m_document;
     m_document = nullptr;
@@ -744,6 +826,15 @@ void FileOp::postLoad()
       sprite->resetPalettes();
       sprite->setPalette(*palette, false);
     }
+
+    // The loaded pixels are a new version of each image, so the data
+    // cached by image version (e.g. doc::get_image_content()) can be
+    // used for them (compressed cels aren't decoded here, they have
+    // their own version)
+    for (const auto& cel : sprite->uniqueCels()) {
+      if (!cel->data()->isSwapped() && cel->image())
+        cel->image()->incrementVersion();
+    }
   }
 
   m_document->markAsSaved();
@@ -879,7 +970,7 @@ void FileOp::setProgress(double progress)
   }
 
   if (m_progressInterface)
-    m_progressInterface->ackFileOpProgress(progress);
+    m_progressInterface->ackFileOpProgress(m_progress);
 }
 
 double FileOp::progress() const
@@ -904,6 +995,21 @@ bool FileOp::isDone() const
   return done;
 }
 
+void FileOp::setFirstFrameLoaded()
+{
+  ASSERT(m_progressive);
+  ASSERT(m_document);
+
+  scoped_lock lock(m_mutex);
+  m_firstFrameLoaded = true;
+}
+
+bool FileOp::isFirstFrameLoaded() const
+{
+  scoped_lock lock(m_mutex);
+  return m_firstFrameLoaded;
+}
+
 bool FileOp::isStop() const
 {
   bool stop;
@@ -924,6 +1030,11 @@ FileOp::FileOp(FileOpType type, Context* context)
   , m_done(false)
   , m_stop(false)
   , m_oneframe(false)
+  , m_progressive(false)
+  , m_firstFrameLoaded(false)
+  , m_metadataOnly(false)
+  , m_compressedCels(false)
+  , m_maxPreviewSize(0)
 {
   m_seq.palette = nullptr;
   m_seq.image.reset();
@@ -934,6 +1045,28 @@ FileOp::FileOp(FileOpType type, Context* context)
   m_seq.last_cel = nullptr;
 }
 
+FileOpWriteLock::FileOpWriteLock(FileOp* fop)
+  : m_document(fop->isFirstFrameLoaded() ? fop->document(): nullptr)
+  , m_locked(true)
+{
+  // Wait the UI thread (e.g. the editor painting the document) until
+  // the document is closed (and the operation stopped)
+  if (m_document) {
+    while (!m_document->lock(Document::WriteLock, 10)) {
+      if (fop->isStop()) {
+        m_locked = false;
+        break;
+      }
+    }
+  }
+}
+
+FileOpWriteLock::~FileOpWriteLock()
+{
+  if (m_document && m_locked)
+    m_document->unlock();
+}
+
 void FileOp::prepareForSequence()
 {
   m_seq.palette = Palette::create(256);
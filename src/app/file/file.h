@@ -21,6 +21,9 @@
 #define FILE_LOAD_SEQUENCE_ASK          0x00000002
 #define FILE_LOAD_SEQUENCE_YES          0x00000004
 #define FILE_LOAD_ONE_FRAME             0x00000008
+#define FILE_LOAD_PROGRESSIVE           0x00000010
+#define FILE_LOAD_METADATA_ONLY         0x00000020
+#define FILE_LOAD_COMPRESSED_CELS       0x00000040
 
 namespace doc {
   class Document;
@@ -66,6 +69,26 @@ namespace app {
 
     bool isSequence() const { return !m_seq.filename_list.empty(); }
     bool isOneFrame() const { return m_oneframe; }
+    bool isProgressive() const { return m_progressive; }
+
+    // True if the document is loaded just to inspect its structure
+    // (layers, frames, tags, palettes), formats can skip the pixels
+    // of the cels (FILE_LOAD_METADATA_ONLY flag). The document must
+    // not be saved/edited.
+    bool isMetadataOnly() const { return m_metadataOnly; }
+
+    // True if formats can keep the compressed pixels of each cel in
+    // memory, decoding them the first time they are used
+    // (FILE_LOAD_COMPRESSED_CELS flag, see
+    // doc::CelData::setCompressedImage()).
+    bool keepCompressedCels() const { return m_compressedCels; }
+
+    // If it's greater than zero, the document is loaded just to show
+    // a preview of this size (e.g. a thumbnail), so formats can load
+    // a smaller image (at least of this size in its biggest side).
+    // The document must not be saved/edited.
+    int maxPreviewSize() const { return m_maxPreviewSize; }
+    void setMaxPreviewSize(int size) { m_maxPreviewSize = size; }
 
     const std::string& filename() const { return m_filename; }
     Context* context() const { return m_context; }
@@ -87,6 +110,13 @@ namespace app {
     // Does extra post-load processing which may require user intervention.
     void postLoad();
 
+    // In a progressive load (FILE_LOAD_PROGRESSIVE flag) the format
+    // calls setFirstFrameLoaded() when the document can be displayed,
+    // after that, the document is modified only in the scope of a
+    // FileOpWriteLock.
+    void setFirstFrameLoaded();
+    bool isFirstFrameLoaded() const;
+
     // Helpers for file decoder/encoder (FileFormat) with
     // FILE_SUPPORT_SEQUENCES flag.
     base::SharedPtr<FormatOptions> sequenceGetFormatOptions() const;
@@ -136,6 +166,14 @@ namespace app {
     bool m_oneframe;            // Load just one frame (in formats
                                 // that support animation like
                                 // GIF/FLI/ASE).
+    bool m_progressive;         // The document can be displayed
+                                // before all frames are loaded.
+    bool m_firstFrameLoaded;    // The first frame of a progressive
+                                // load is ready.
+    bool m_metadataOnly;        // Load the document without the
+                                // pixels of the cels.
+    bool m_compressedCels;      // Decode the cels when they are used.
+    int m_maxPreviewSize;       // Size of the preview (0 = full load)
 
     // Data for sequences.
     struct {
@@ -154,10 +192,26 @@ namespace app {
     } m_seq;
 
     void prepareForSequence();
+    bool saveSequenceFrame(frame_t frame);
     void operateLoad(IFileOpProgress* progress);
     bool operateLoadTryFormat(IFileOpProgress* progress);
   };
 
+  // Locks the document of a progressive load to write (when it was
+  // already given to the UI) in the scope of a FileOp::operate()
+  // thread. locked() is false if the operation was stopped.
+  class FileOpWriteLock {
+  public:
+    FileOpWriteLock(FileOp* fop);
+    ~FileOpWriteLock();
+
+    bool locked() const { return m_locked; }
+
+  private:
+    Document* m_document;
+    bool m_locked;
+  };
+
   // Available extensions for each load/save operation.
 
   std::string get_readable_extensions();
@@ -15,11 +15,14 @@
 #include "app/file/format_options.h"
 #include "app/modules/palettes.h"
 #include "base/file_handle.h"
+#include "base/thread_pool.h"
 #include "doc/doc.h"
 #include "flic/flic.h"
 #include "render/render.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <vector>
 
 namespace app {
 
@@ -171,6 +174,22 @@ static int get_time_precision(const Sprite *sprite)
   return precision;
 }
 
+// Size of the rendered frames that are encoded in each batch
+const int kMaxBatchBytes = 64*1024*1024;
+
+static void fill_colormap(const Sprite* sprite, frame_t frame, flic::Frame& fliFrame)
+{
+  const Palette* pal = sprite->palette(frame);
+  int size = MIN(256, pal->size());
+
+  for (int c=0; c<size; c++) {
+    color_t color = pal->getEntry(c);
+    fliFrame.colormap[c].r = rgba_getr(color);
+    fliFrame.colormap[c].g = rgba_getg(color);
+    fliFrame.colormap[c].b = rgba_getb(color);
+  }
+}
+
 bool FliFormat::onSave(FileOp* fop)
 {
   const Sprite* sprite = fop->document()->sprite();
@@ -188,47 +207,54 @@ bool FliFormat::onSave(FileOp* fop)
   header.speed = get_time_precision(sprite);
   encoder.writeHeader(header);
 
-  // Create the bitmaps
-  ImageRef bmp(Image::create(IMAGE_INDEXED, sprite->width(), sprite->height()));
-  render::Render render;
+  // Frames are rendered in parallel by batches (to limit the memory
+  // used by the rendered images), and then they are encoded in order.
+  const int nframes = sprite->totalFrames();
+  const int frameBytes = std::max(1, sprite->width() * sprite->height());
+  const int batchSize = std::clamp(int(kMaxBatchBytes / frameBytes), 1, nframes);
+
+  // The first frame is written again at the end (ring frame)
+  ImageRef firstImage;
 
-  // Write frame by frame
   flic::Frame fliFrame;
-  fliFrame.pixels = bmp->getPixelAddress(0, 0);
-  fliFrame.rowstride = IndexedTraits::getRowStrideBytes(bmp->width());
-  for (frame_t frame_it=0;
-       frame_it <= sprite->totalFrames();
-       ++frame_it) {
-    frame_t frame = (frame_it % sprite->totalFrames());
-    const Palette* pal = sprite->palette(frame);
-    int size = MIN(256, pal->size());
-
-    for (int c=0; c<size; c++) {
-      color_t color = pal->getEntry(c);
-      fliFrame.colormap[c].r = rgba_getr(color);
-      fliFrame.colormap[c].g = rgba_getg(color);
-      fliFrame.colormap[c].b = rgba_getb(color);
-    }
+  fliFrame.rowstride = IndexedTraits::getRowStrideBytes(sprite->width());
 
-    // Render the frame in the bitmap
-    render.renderSprite(bmp.get(), sprite, frame);
+  for (int first=0; first<nframes; first+=batchSize) {
+    const int last = std::min(nframes, first+batchSize);
 
-    // How many times this frame should be written to get the same
-    // time that it has in the sprite
-    if (frame_it < sprite->totalFrames()) {
+    std::vector<ImageRef> images(last-first);
+    base::thread_pool::instance().parallel_for(
+      int(images.size()),
+      [&](int i) {
+        images[i].reset(Image::create(IMAGE_INDEXED, sprite->width(), sprite->height()));
+        render::Render render;
+        render.renderSprite(images[i].get(), sprite, frame_t(first+i));
+      });
+
+    if (first == 0)
+      firstImage = images[0];
+
+    for (frame_t frame=first; frame<last; ++frame) {
+      fill_colormap(sprite, frame, fliFrame);
+      fliFrame.pixels = images[frame-first]->getPixelAddress(0, 0);
+
+      // How many times this frame should be written to get the same
+      // time that it has in the sprite
       int times = sprite->frameDuration(frame) / header.speed;
       times = MAX(1, times);
       for (int c=0; c<times; c++)
         encoder.writeFrame(fliFrame);
-    }
-    else {
-      encoder.writeRingFrame(fliFrame);
-    }
 
-    // Update progress
-    fop->setProgress((float)(frame_it+1) / (float)(sprite->totalFrames()+1));
+      // Update progress
+      fop->setProgress((float)(frame+1) / (float)(nframes+1));
+    }
   }
 
+  fill_colormap(sprite, 0, fliFrame);
+  fliFrame.pixels = firstImage->getPixelAddress(0, 0);
+  encoder.writeRingFrame(fliFrame);
+  fop->setProgress(1.0f);
+
   return true;
 }
 
@@ -18,10 +18,14 @@
 #include "app/file/gif_options.h"
 #include "app/ini_file.h"
 #include "app/modules/gui.h"
-#include "app/util/autocrop.h"
 #include "base/file_handle.h"
 #include "base/fs.h"
+#include "base/thread_pool.h"
+#include "doc/algorithm/clear_unchanged.h"
+#include "doc/algorithm/shrink_bounds.h"
 #include "doc/doc.h"
+#include "doc/identical_cels.h"
+#include "doc/image_swap.h"
 #include "render/quantization.h"
 #include "render/render.h"
 #include "ui/alert.h"
@@ -30,7 +34,9 @@
 #include "gif_options.xml.h"
 
 #include <gif_lib.h>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #ifdef _WIN32
   #include <io.h>
@@ -183,7 +189,8 @@ public:
     , m_frameDelay(1)
     , m_remap(256)
     , m_hasLocalColormaps(false)
-    , m_firstLocalColormap(nullptr) {
+    , m_firstLocalColormap(nullptr)
+    , m_canvasChanged(false) {
     TRACE("[GifDecoder] GIF background index=%d\n", (int)m_gifFile->SBackGroundColor);
     TRACE("[GifDecoder] GIF global colormap=%d, ncolors=%d\n",
           (m_gifFile->SColorMap ? 1: 0),
@@ -343,9 +350,13 @@ private:
                             m_disposalMethod,
                             frameBounds,
                             m_bgIndex);
+    if (m_disposalMethod == DisposalMethod::RESTORE_BGCOLOR ||
+        m_disposalMethod == DisposalMethod::RESTORE_PREVIOUS)
+      m_canvasChanged = true;
 
-    // Copy the current image into previous image
-    copy_image(m_previousImage.get(), m_currentImage.get());
+    // Copy the current image into previous image (they can differ
+    // only in the frame bounds)
+    m_previousImage->copy(m_currentImage.get(), gfx::Clip(frameBounds));
 
     // Set frame delay (1/100th seconds to milliseconds)
     if (m_frameDelay >= 0)
@@ -570,51 +581,82 @@ private:
     m_sprite->setPalette(*palette, false);
   }
 
+  // Both composite functions use a LUT to convert each frame index
+  // to the canvas value.
   void compositeIndexedImageToIndexed(const gfx::Rect& frameBounds,
                                       const Image* frameImage) {
-    // Compose the frame image with the previous frame
-    for (int y=0; y<frameBounds.h; ++y) {
-      for (int x=0; x<frameBounds.w; ++x) {
-        color_t i = get_pixel_fast<IndexedTraits>(frameImage, x, y);
-        if (i == m_localTransparentIndex)
-          continue;
+    IndexedTraits::pixel_t lut[256];
+    for (int i=0; i<256; ++i)
+      lut[i] = IndexedTraits::pixel_t(m_remap[i]);
 
-        i = m_remap[i];
-        put_pixel_fast<IndexedTraits>(m_currentImage.get(),
-                                      frameBounds.x + x,
-                                      frameBounds.y + y, i);
-      }
-    }
+    compositeFrame<IndexedTraits>(frameBounds, frameImage, lut);
   }
 
   void compositeIndexedImageToRgb(const gfx::Rect& frameBounds,
                                   const Image* frameImage) {
     ColorMapObject* colormap = getFrameColormap();
 
-    // Compose the frame image with the previous frame
+    RgbTraits::pixel_t lut[256];
+    for (int i=0; i<256; ++i) {
+      if (i < colormap->ColorCount)
+        lut[i] = colormap2rgba(colormap, i);
+      else
+        lut[i] = rgba(0, 0, 0, 255);
+    }
+
+    compositeFrame<RgbTraits>(frameBounds, frameImage, lut);
+  }
+
+  // Draws the non-transparent pixels of the frame in m_currentImage
+  // and notes if some pixel was changed.
+  template<typename ImageTraits>
+  void compositeFrame(const gfx::Rect& frameBounds,
+                      const Image* frameImage,
+                      const typename ImageTraits::pixel_t* lut) {
+    typedef typename ImageTraits::pixel_t pixel_t;
+    const int transparent = m_localTransparentIndex;
+    bool changed = false;
+
     for (int y=0; y<frameBounds.h; ++y) {
+      const uint8_t* src = (const uint8_t*)frameImage->getPixelAddress(0, y);
+      pixel_t* dst = (pixel_t*)m_currentImage->getPixelAddress(frameBounds.x,
+                                                               frameBounds.y + y);
       for (int x=0; x<frameBounds.w; ++x) {
-        color_t i = get_pixel_fast<IndexedTraits>(frameImage, x, y);
-        if (i == m_localTransparentIndex)
+        if (src[x] == transparent)
           continue;
 
-        i = rgba(
-          colormap->Colors[i].Red,
-          colormap->Colors[i].Green,
-          colormap->Colors[i].Blue, 255);
-
-        put_pixel_fast<RgbTraits>(m_currentImage.get(),
-                                  frameBounds.x + x,
-                                  frameBounds.y + y, i);
+        const pixel_t c = lut[src[x]];
+        if (dst[x] != c) {
+          dst[x] = c;
+          changed = true;
+        }
       }
     }
+
+    if (changed)
+      m_canvasChanged = true;
   }
 
   void createCel() {
-    auto cel = std::make_shared<Cel>(m_frameNum, ImageRef(0));
-    ImageRef celImage(Image::createCopy(m_currentImage.get()));
-    cel->data()->setImage(celImage);
+    // If the canvas is the same of the previous frame, we link the
+    // previous cel (frames that don't change are very common in
+    // optimized GIF files).
+    std::shared_ptr<Cel> cel;
+    if (m_lastCel && !m_canvasChanged) {
+      cel = Cel::createLink(m_lastCel);
+      cel->setFrame(m_frameNum);
+    }
+    else {
+      cel = std::make_shared<Cel>(m_frameNum, ImageRef(0));
+      cel->data()->setImage(ImageRef(Image::createCopy(m_currentImage.get())));
+    }
     m_layer->addCel(cel);
+    m_lastCel = cel;
+    m_canvasChanged = false;
+
+    // Free memory for the next frames of big animations
+    if (ImageSwap::instance().isOverBudget())
+      cel->data()->swapOut();
   }
 
   void readExtensionRecord() {
@@ -675,7 +717,7 @@ private:
   // Converts the whole sprite read so far because it contains more
   // than 256 colors at the same time.
   void convertIndexedSpriteToRgb() {
-    for (auto cel : m_sprite->uniqueCels()) {
+    for (const auto& cel : m_sprite->uniqueCels()) {
       Image* oldImage = cel->image();
       ImageRef newImage(
         render::convert_pixel_format
@@ -721,7 +763,7 @@ private:
                  // sprite isn't opaque, because we
                  // cannot write the header again
 
-    for (auto cel : m_sprite->uniqueCels())
+    for (const auto& cel : m_sprite->uniqueCels())
       doc::remap_image(cel->image(), remap);
 
     m_sprite->setPalette(*newPalette, false);
@@ -763,6 +805,10 @@ private:
   // all local colormaps are the same, so we can use it as a global
   // colormap.
   ColorMapObject* m_firstLocalColormap;
+
+  // Last created cel, and if m_currentImage was modified after it
+  std::shared_ptr<Cel> m_lastCel;
+  bool m_canvasChanged;
 };
 
 bool GifFormat::onLoad(FileOp* fop)
@@ -788,13 +834,36 @@ bool GifFormat::onLoad(FileOp* fop)
 
   GifDecoder decoder(fop, gif_file, fd, filesize);
   if (decoder.decode()) {
-    fop->createDocument(decoder.releaseSprite());
+    Sprite* sprite = decoder.releaseSprite();
+    // GIF files don't have linked cels, but frames that don't change
+    // are very common.
+    link_identical_cels(sprite);
+    fop->createDocument(sprite);
     return true;
   }
   else
     return false;
 }
 
+// Size of the rendered frames that are encoded in each batch
+const int kMaxBatchBytes = 64*1024*1024;
+
+struct ColorMapDeleter {
+  void operator()(ColorMapObject* colormap) const {
+    GifFreeMapObject(colormap);
+  }
+};
+
+// A frame ready to be written in the GIF file
+struct GifFrame {
+  gfx::Rect bounds;
+  DisposalMethod disposal;
+  ImageRef image;                  // RGB pixels inside bounds
+  std::vector<uint8_t> pixels;     // Indexes to write in the file
+  int transparentIndex;
+  std::unique_ptr<ColorMapObject, ColorMapDeleter> colormap; // Local colormap
+};
+
 class GifEncoder {
 public:
   GifEncoder(FileOp* fop, GifFileType* gifFile)
@@ -805,7 +874,8 @@ public:
     , m_hasBackground(m_sprite->backgroundLayer() ? true: false)
     , m_bitsPerPixel(1)
     , m_globalColormap(nullptr)
-    , m_quantizeColormaps(false) {
+    , m_quantizeColormaps(false)
+    , m_rgbmap(nullptr) {
     if (m_sprite->pixelFormat() == IMAGE_INDEXED) {
       for (auto& palette : m_sprite->getPalettes()) {
         int bpp = GifBitSizeLimited(palette->size());
@@ -855,11 +925,8 @@ public:
     const base::SharedPtr<GifOptions> gifOptions = fop->sequenceGetFormatOptions();
     m_interlaced = gifOptions->interlaced();
     m_loop = (gifOptions->loop() ? 0: -1);
+    m_dithering = gifOptions->dithering();
 
-    for (int i=0; i<3; ++i)
-      m_images[i].reset(Image::create(IMAGE_RGB,
-                                      m_spriteBounds.w,
-                                      m_spriteBounds.h));
   }
 
   ~GifEncoder() {
@@ -872,43 +939,95 @@ public:
     if (m_loop >= 0)
       writeLoopExtension();
 
+    // The colors of indexed sprites with just one palette are mapped
+    // in several threads, so the whole RgbMap is calculated now.
+    if (!m_quantizeColormaps) {
+      m_rgbmap = m_sprite->rgbMap(0);
+      m_rgbmap->calculateAll();
+    }
+
+    // Frames are processed in batches to limit the memory used by
+    // the rendered images.
+    const int nframes = m_sprite->totalFrames();
+    const int frameBytes = std::max(1, m_spriteBounds.w * m_spriteBounds.h * 4);
+    const int batchSize = std::clamp(int(kMaxBatchBytes / frameBytes), 1, nframes);
+
     // Previous and next images are used to decide the best disposal
     // method (e.g. if it's more convenient to restore the background
     // color or to restore the previous frame to reach the next one).
-    m_previousImage = m_images[0].get();
-    m_currentImage = m_images[1].get();
-    m_nextImage = m_images[2].get();
-
-    int nframes = m_sprite->totalFrames();
-    for (int frameNum=0; frameNum<nframes; ++frameNum) {
-      if (frameNum == 0)
-        renderFrame(0, m_nextImage);
-      else if (frameNum > 0)
-        std::swap(m_previousImage, m_currentImage);
-
-      std::swap(m_currentImage, m_nextImage);
-      if (frameNum+1 < nframes)
-        renderFrame(frameNum+1, m_nextImage);
-
-      gfx::Rect frameBounds;
-      DisposalMethod disposal;
-      calculateBestDisposalMethod(
-        frameNum, frameBounds, disposal);
-
-      // TODO We could join both frames in a longer one (with more duration)
-      if (frameBounds.isEmpty())
-        frameBounds = gfx::Rect(0, 0, 1, 1);
-
-      writeImage(frameNum, frameBounds, disposal);
-
-      // Dispose/clear frame content
-      process_disposal_method(m_previousImage,
-                              m_currentImage,
-                              disposal,
-                              frameBounds,
-                              m_clearColor);
-
-      m_fop->setProgress(double(frameNum+1) / double(nframes));
+    ImageRef previousImage;
+    ImageRef nextImage;
+
+    for (int first=0; first<nframes; first+=batchSize) {
+      const int last = std::min(nframes, first+batchSize);
+
+      // Render the frames of the batch (and the next one) in parallel
+      std::vector<ImageRef> images(std::min(nframes, last+1) - first);
+      images[0] = nextImage;
+      base::thread_pool::instance().parallel_for(
+        int(images.size()),
+        [&](int i) {
+          if (!images[i]) {
+            images[i].reset(Image::create(IMAGE_RGB,
+                                          m_spriteBounds.w,
+                                          m_spriteBounds.h));
+            renderFrame(first+i, images[i].get());
+          }
+        });
+
+      // The disposal method of each frame depends on the disposed
+      // content of the previous one, so it's calculated in order.
+      std::vector<GifFrame> frames(last-first);
+      for (int frameNum=first; frameNum<last; ++frameNum) {
+        GifFrame& frame = frames[frameNum-first];
+        Image* currentImage = images[frameNum-first].get();
+
+        calculateBestDisposalMethod(
+          frameNum,
+          previousImage.get(),
+          currentImage,
+          (frameNum+1 < nframes ? images[frameNum-first+1].get(): nullptr),
+          frame.bounds, frame.disposal);
+
+        // TODO We could join both frames in a longer one (with more duration)
+        if (frame.bounds.isEmpty())
+          frame.bounds = gfx::Rect(0, 0, 1, 1);
+
+        frame.image.reset(crop_image(currentImage, frame.bounds, m_clearColor));
+
+        // Pixels that are already displayed (from previous frames)
+        // are written with the transparent index, so the LZW encoder
+        // compresses them better.
+        if (frameNum > 0 && m_transparentIndex >= 0) {
+          ImageRef canvas(crop_image(previousImage.get(), frame.bounds, m_clearColor));
+          algorithm::clear_unchanged_pixels(frame.image.get(), canvas.get(),
+                                            rgba(0, 0, 0, 0));
+        }
+
+        // Dispose/clear frame content
+        process_disposal_method(previousImage.get(),
+                                currentImage,
+                                frame.disposal,
+                                frame.bounds,
+                                m_clearColor);
+
+        previousImage = images[frameNum-first];
+      }
+      if (last < nframes)
+        nextImage = images.back();
+
+      // Quantize the frames in parallel
+      base::thread_pool::instance().parallel_for(
+        int(frames.size()),
+        [&](int i) {
+          quantizeFrame(first+i, frames[i]);
+        });
+
+      // Write (LZW-encode) the frames in order
+      for (int frameNum=first; frameNum<last; ++frameNum) {
+        writeFrame(frameNum, frames[frameNum-first]);
+        m_fop->setProgress(double(frameNum+1) / double(nframes));
+      }
     }
     return true;
   }
@@ -977,21 +1096,17 @@ private:
       throw Exception("Error writing GIF graphics extension record for frame %d.\n", (int)frameNum);
   }
 
-  static gfx::Rect calculateFrameBounds(Image* a, Image* b) {
+  static gfx::Rect calculateFrameBounds(const Image* a, const Image* b) {
     gfx::Rect frameBounds;
-    int x1, y1, x2, y2;
-
-    if (get_shrink_rect2(&x1, &y1, &x2, &y2, a, b)) {
-      frameBounds.x = x1;
-      frameBounds.y = y1;
-      frameBounds.w = x2 - x1 + 1;
-      frameBounds.h = y2 - y1 + 1;
-    }
-
+    if (!algorithm::shrink_bounds2(a, b, a->bounds(), frameBounds))
+      frameBounds = gfx::Rect();
     return frameBounds;
   }
 
   void calculateBestDisposalMethod(int frameNum,
+                                   Image* previousImage,
+                                   Image* currentImage,
+                                   Image* nextImage,
                                    gfx::Rect& frameBounds,
                                    DisposalMethod& disposal) {
     if (m_hasBackground) {
@@ -1008,11 +1123,11 @@ private:
       gfx::Rect prev, next;
 
       if (frameNum-1 >= 0)
-        prev = calculateFrameBounds(m_currentImage, m_previousImage);
+        prev = calculateFrameBounds(currentImage, previousImage);
 
       if (!m_hasBackground &&
           frameNum+1 < m_sprite->totalFrames())
-        next = calculateFrameBounds(m_currentImage, m_nextImage);
+        next = calculateFrameBounds(currentImage, nextImage);
 
       frameBounds = prev.createUnion(next);
 
@@ -1020,7 +1135,7 @@ private:
       // when we dispose the current one than clearing with the bg
       // color.
       if (m_hasBackground && !prev.isEmpty()) {
-        gfx::Rect prevNext = calculateFrameBounds(m_previousImage, m_nextImage);
+        gfx::Rect prevNext = calculateFrameBounds(previousImage, nextImage);
         if (!prevNext.isEmpty() &&
             frameBounds.contains(prevNext) &&
             prevNext.w*prevNext.h < frameBounds.w*frameBounds.h) {
@@ -1035,35 +1150,28 @@ private:
     }
   }
 
-  void writeImage(int frameNum, const gfx::Rect& frameBounds, DisposalMethod disposal) {
+  // Converts the RGB pixels of the frame to the indexes that must be
+  // stored in the GIF file (it's called from several threads).
+  void quantizeFrame(int frameNum, GifFrame& frame) const {
     std::shared_ptr<Palette> framePaletteRef;
     std::unique_ptr<RgbMap> rgbmapRef;
-    Palette* framePalette = m_sprite->palette(frameNum);
-    RgbMap* rgbmap = m_sprite->rgbMap(frameNum);
+    const Palette* framePalette = m_sprite->palette(frameNum);
+    const RgbMap* rgbmap = m_rgbmap;
 
     // Create optimized palette for RGB/Grayscale images
     if (m_quantizeColormaps) {
-      framePaletteRef = createOptimizedPalette(frameBounds);
+      framePaletteRef = createOptimizedPalette(frame.image.get());
       framePalette = framePaletteRef.get();
 
       rgbmapRef.reset(new RgbMap);
+      rgbmapRef->regenerate(framePalette, m_transparentIndex);
+      if (frame.bounds.w * frame.bounds.h > rgbmapRef->size())
+        rgbmapRef->calculateAll();
       rgbmap = rgbmapRef.get();
-      rgbmap->regenerate(framePalette, m_transparentIndex);
     }
 
-    // We will store the frameBounds pixels in frameImage, with the
-    // indexes that must be stored in the GIF file for this specific
-    // frame.
-    if (!m_frameImageBuf)
-      m_frameImageBuf.reset(new ImageBuffer);
-
-    ImageRef frameImage(Image::create(IMAGE_INDEXED,
-                                      frameBounds.w,
-                                      frameBounds.h,
-                                      m_frameImageBuf));
-
-    // Convert the frameBounds area of m_currentImage (RGB) to frameImage (Indexed)
-    // bool needsTransparent = false;
+    // Convert the pixels of the frame (RGB) to indexes
+    frame.pixels.resize(frame.bounds.w * frame.bounds.h);
     PalettePicks usedColors(framePalette->size());
 
     // If the sprite needs a transparent color we mark it as used so
@@ -1077,17 +1185,29 @@ private:
       usedColors[i] = true;
     }
 
+    // Dithered indexes of the opaque pixels
+    std::unique_ptr<Image> dithered;
+    if (m_quantizeColormaps && m_dithering != DitheringMethod::NONE)
+      dithered.reset(ditherFrame(frame.image.get(), rgbmap, framePalette));
+
     {
-      LockImageBits<RgbTraits> bits(m_currentImage, frameBounds);
+      const LockImageBits<RgbTraits> bits(frame.image.get());
       auto it = bits.begin();
-      for (int y=0; y<frameBounds.h; ++y) {
-        for (int x=0; x<frameBounds.w; ++x, ++it) {
+      uint8_t* dst = &frame.pixels[0];
+      for (int y=0; y<frame.bounds.h; ++y) {
+        const uint8_t* ditheredRow =
+          (dithered ? dithered->getPixelAddress(0, y): nullptr);
+
+        for (int x=0; x<frame.bounds.w; ++x, ++it, ++dst) {
           ASSERT(it != bits.end());
 
           color_t color = *it;
           int i;
 
-          if (rgba_geta(color) >= 128) {
+          if (rgba_geta(color) >= 128 && ditheredRow) {
+            i = ditheredRow[x];
+          }
+          else if (rgba_geta(color) >= 128) {
             i = framePalette->findExactMatch(
               rgba_getr(color),
               rgba_getg(color),
@@ -1117,20 +1237,22 @@ private:
             usedColors.resize(i+1);
           usedColors[i] = true;
 
-          put_pixel_fast<IndexedTraits>(frameImage.get(), x, y, i);
+          *dst = i;
         }
       }
     }
 
+    // The RGB pixels aren't needed anymore
+    frame.image.reset();
+
     int usedNColors = usedColors.picks();
 
     Remap remap(256);
     for (int i=0; i<remap.size(); ++i)
       remap.map(i, i);
 
-    int localTransparent = m_transparentIndex;
-    ColorMapObject* colormap = m_globalColormap;
-    if (!colormap) {
+    frame.transparentIndex = m_transparentIndex;
+    if (!m_globalColormap) {
       auto reducedPalette = Palette::create(usedNColors);
       reducedPalette->setFrame(frameNum);
 
@@ -1142,23 +1264,54 @@ private:
         }
       }
 
-      colormap = createColorMap(*reducedPalette);
-      if (localTransparent >= 0)
-        localTransparent = remap[localTransparent];
+      frame.colormap.reset(createColorMap(*reducedPalette));
+      if (frame.transparentIndex >= 0)
+        frame.transparentIndex = remap[frame.transparentIndex];
+    }
+
+    if (frame.transparentIndex >= 0 && m_transparentIndex != frame.transparentIndex)
+      remap.map(m_transparentIndex, frame.transparentIndex);
+
+    for (uint8_t& index : frame.pixels)
+      index = remap[index];
+  }
+
+  // Converts the RGB pixels of the frame to indexes with the
+  // dithering method selected by the user. The alpha channel is
+  // reduced to opaque/transparent as the GIF format doesn't support
+  // translucent pixels.
+  Image* ditherFrame(const Image* image,
+                     const RgbMap* rgbmap,
+                     const Palette* palette) const {
+    std::unique_ptr<Image> opaque(Image::createCopy(image));
+    for (int y=0; y<opaque->height(); ++y) {
+      auto it = (RgbTraits::address_t)opaque->getPixelAddress(0, y);
+      for (int x=0; x<opaque->width(); ++x, ++it) {
+        if (rgba_geta(*it) >= 128)
+          *it |= rgba(0, 0, 0, 255);
+        else
+          *it = rgba(0, 0, 0, 0);
+      }
     }
 
-    if (localTransparent >= 0 && m_transparentIndex != localTransparent)
-      remap.map(m_transparentIndex, localTransparent);
+    return render::convert_pixel_format(
+      opaque.get(), nullptr, IMAGE_INDEXED, m_dithering,
+      rgbmap, palette, m_hasBackground,
+      (m_transparentIndex >= 0 ? m_transparentIndex: 0));
+  }
+
+  void writeFrame(int frameNum, const GifFrame& frame) {
+    const gfx::Rect& frameBounds = frame.bounds;
 
     // Write extension record.
-    writeExtension(frameNum, localTransparent, disposal);
+    writeExtension(frameNum, frame.transparentIndex, frame.disposal);
 
     // Write the image record.
     if (EGifPutImageDesc(m_gifFile,
                          frameBounds.x, frameBounds.y,
                          frameBounds.w, frameBounds.h,
                          m_interlaced ? 1: 0,
-                         (colormap != m_globalColormap ? colormap: nullptr)) == GIF_ERROR) {
+                         frame.colormap.get()) == GIF_ERROR) {
       throw Exception("Error writing GIF frame %d.\n", (int)frameNum);
     }
 
@@ -1169,12 +1322,7 @@ private:
       // Need to perform 4 passes on the images.
       for (int i=0; i<4; ++i)
         for (int y=interlaced_offset[i]; y<frameBounds.h; y+=interlaced_jumps[i]) {
-          IndexedTraits::address_t addr =
-            (IndexedTraits::address_t)frameImage->getPixelAddress(0, y);
-
-          for (int i=0; i<frameBounds.w; ++i, ++addr)
-            scanline[i] = remap[*addr];
-
+          std::copy_n(&frame.pixels[y*frameBounds.w], frameBounds.w, &scanline[0]);
           if (EGifPutLine(m_gifFile, &scanline[0], frameBounds.w) == GIF_ERROR)
             throw Exception("Error writing GIF image scanlines for frame %d.\n", (int)frameNum);
         }
@@ -1182,26 +1330,18 @@ private:
     else {
       // Write all image scanlines (not interlaced in this case).
       for (int y=0; y<frameBounds.h; ++y) {
-        IndexedTraits::address_t addr =
-          (IndexedTraits::address_t)frameImage->getPixelAddress(0, y);
-
-        for (int i=0; i<frameBounds.w; ++i, ++addr)
-          scanline[i] = remap[*addr];
-
+        std::copy_n(&frame.pixels[y*frameBounds.w], frameBounds.w, &scanline[0]);
         if (EGifPutLine(m_gifFile, &scanline[0], frameBounds.w) == GIF_ERROR)
           throw Exception("Error writing GIF image scanlines for frame %d.\n", (int)frameNum);
       }
     }
-
-    if (colormap && colormap != m_globalColormap)
-      GifFreeMapObject(colormap);
   }
 
-  std::shared_ptr<Palette> createOptimizedPalette(const gfx::Rect& frameBounds) {
+  std::shared_ptr<Palette> createOptimizedPalette(const Image* image) const {
     render::PaletteOptimizer optimizer;
 
-    // Feed the palette optimizer with pixels inside frameBounds
-    for (const auto& color : LockImageBits<RgbTraits>(m_currentImage, frameBounds)) {
+    // Feed the palette optimizer with pixels of the frame
+    for (const auto& color : LockImageBits<RgbTraits>(image)) {
       if (rgba_geta(color) >= 128)
         optimizer.feedWithRgbaColor(
           rgba(rgba_getr(color),
@@ -1214,9 +1354,10 @@ private:
     return palette;
   }
 
-  void renderFrame(int frameNum, Image* dst) {
+  void renderFrame(int frameNum, Image* dst) const {
     render::Render render;
     render.setBgType(render::BgType::NONE);
+    render.setParallel(true);
     clear_image(dst, m_clearColor);
     render.renderSprite(dst, m_sprite, frameNum);
   }
@@ -1255,11 +1396,8 @@ private:
   bool m_quantizeColormaps;
   bool m_interlaced;
   int m_loop;
-  ImageBufferPtr m_frameImageBuf;
-  ImageRef m_images[3];
-  Image* m_previousImage;
-  Image* m_currentImage;
-  Image* m_nextImage;
+  DitheringMethod m_dithering;
+  RgbMap* m_rgbmap;
 };
 
 bool GifFormat::onSave(FileOp* fop)
@@ -1283,7 +1421,7 @@ bool GifFormat::onSave(FileOp* fop)
 base::SharedPtr<FormatOptions> GifFormat::onGetFormatOptions(FileOp* fop)
 {
   base::SharedPtr<GifOptions> gif_options;
-  if (fop->document()->getFormatOptions())
+  if (dynamic_cast<GifOptions*>(fop->document()->getFormatOptions().get()))
     gif_options = base::SharedPtr<GifOptions>(fop->document()->getFormatOptions());
 
   if (!gif_options)
@@ -1298,21 +1436,26 @@ base::SharedPtr<FormatOptions> GifFormat::onGetFormatOptions(FileOp* fop)
     // Configuration parameters
     gif_options->setInterlaced(get_config_bool("GIF", "Interlaced", gif_options->interlaced()));
     gif_options->setLoop(get_config_bool("GIF", "Loop", gif_options->loop()));
+    gif_options->setDithering(DitheringMethod(
+        get_config_int("GIF", "Dithering", int(gif_options->dithering()))));
 
     // Load the window to ask to the user the GIF options he wants.
 
     app::gen::GifOptions win;
     win.interlaced()->setSelected(gif_options->interlaced());
     win.loop()->setSelected(gif_options->loop());
+    win.dithering()->setSelectedItemIndex(int(gif_options->dithering()));
 
     win.openWindowInForeground();
 
     if (win.closer() == win.ok()) {
       gif_options->setInterlaced(win.interlaced()->isSelected());
       gif_options->setLoop(win.loop()->isSelected());
+      gif_options->setDithering(DitheringMethod(win.dithering()->getSelectedItemIndex()));
 
       set_config_bool("GIF", "Interlaced", gif_options->interlaced());
       set_config_bool("GIF", "Loop", gif_options->loop());
+      set_config_int("GIF", "Dithering", int(gif_options->dithering()));
     }
     else {
       gif_options.reset(NULL);
@@ -24,6 +24,7 @@
 #include "doc/doc.h"
 #include "ui/ui.h"
 
+#include <algorithm>
 #include <csetjmp>
 #include <cstdio>
 #include <cstdlib>
@@ -128,6 +129,20 @@ bool JpegFormat::onLoad(FileOp* fop)
   else
     cinfo.out_color_space = JCS_RGB;
 
+  // For previews, use the DCT scaling of libjpeg (1/2, 1/4, or 1/8)
+  // to decode a smaller image that is still bigger than the preview.
+  if (fop->maxPreviewSize() > 0) {
+    const int size = std::max(cinfo.image_width, cinfo.image_height);
+    int denom = 8;
+    while (denom > 1 && size / denom < fop->maxPreviewSize())
+      denom /= 2;
+
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+  }
+
   // Start decompressor.
   jpeg_start_decompress(&cinfo);
 
@@ -345,7 +360,7 @@ bool JpegFormat::onSave(FileOp* fop)
 base::SharedPtr<FormatOptions> JpegFormat::onGetFormatOptions(FileOp* fop)
 {
   base::SharedPtr<JpegOptions> jpeg_options;
-  if (fop->document()->getFormatOptions())
+  if (dynamic_cast<JpegOptions*>(fop->document()->getFormatOptions().get()))
     jpeg_options = base::SharedPtr<JpegOptions>(fop->document()->getFormatOptions());
 
   if (!jpeg_options)
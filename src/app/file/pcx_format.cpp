@@ -16,8 +16,12 @@
 #include "app/file/format_options.h"
 #include "base/cfile.h"
 #include "base/file_handle.h"
+#include "base/file_reader.h"
 #include "doc/doc.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace base;
@@ -46,47 +50,50 @@ bool PcxFormat::onLoad(FileOp* fop)
   int c, r, g, b;
   int width, height;
   int bpp, bytes_per_line;
-  int xx, po;
+  int xx;
   int x, y;
   char ch = 0;
 
   FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
-  FILE* f = handle.get();
+  FileReader reader(handle);
+  FileReader* f = &reader;
 
-  fgetc(f);                    /* skip manufacturer ID */
-  fgetc(f);                    /* skip version flag */
-  fgetc(f);                    /* skip encoding flag */
+  f->getc();                   /* skip manufacturer ID */
+  f->getc();                   /* skip version flag */
+  f->getc();                   /* skip encoding flag */
 
-  if (fgetc(f) != 8) {         /* we like 8 bit color planes */
+  if (f->getc() != 8) {        /* we like 8 bit color planes */
     fop->setError("This PCX doesn't have 8 bit color planes.\n");
     return false;
   }
 
-  width = -(fgetw(f));          /* xmin */
-  height = -(fgetw(f));         /* ymin */
-  width += fgetw(f) + 1;        /* xmax */
-  height += fgetw(f) + 1;       /* ymax */
+  width = -(f->getw());         /* xmin */
+  height = -(f->getw());        /* ymin */
+  width += f->getw() + 1;       /* xmax */
+  height += f->getw() + 1;      /* ymax */
 
-  fgetl(f);                     /* skip DPI values */
+  f->getl();                    /* skip DPI values */
 
   for (c=0; c<16; c++) {        /* read the 16 color palette */
-    r = fgetc(f);
-    g = fgetc(f);
-    b = fgetc(f);
+    r = f->getc();
+    g = f->getc();
+    b = f->getc();
     fop->sequenceSetColor(c, r, g, b);
   }
 
-  fgetc(f);
+  f->getc();
 
-  bpp = fgetc(f) * 8;          /* how many color planes? */
+  bpp = f->getc() * 8;         /* how many color planes? */
   if ((bpp != 8) && (bpp != 24)) {
     return false;
   }
 
-  bytes_per_line = fgetw(f);
+  bytes_per_line = f->getw();
+  if (bytes_per_line < 0)
+    return false;
 
   for (c=0; c<60; c++)             /* skip some more junk */
-    fgetc(f);
+    f->getc();
 
   Image* image = fop->sequenceImage(bpp == 8 ?
                                     IMAGE_INDEXED:
@@ -99,46 +106,40 @@ bool PcxFormat::onLoad(FileOp* fop)
   if (bpp == 24)
     clear_image(image, rgba(0, 0, 0, 255));
 
+  // Each line is expanded in a buffer (one plane after the other)
+  // and then copied/interleaved in the image row.
+  const int planes = bpp/8;
+  const int line_size = bytes_per_line*planes;
+  const int w = std::min(width, bytes_per_line);
+  std::vector<uint8_t> line(line_size);
+
   for (y=0; y<height; y++) {       /* read RLE encoded PCX data */
-    x = xx = 0;
-    po = rgba_r_shift;
+    x = 0;
 
-    while (x < bytes_per_line*bpp/8) {
-      ch = fgetc(f);
+    while (x < line_size) {
+      ch = f->getc();
       if ((ch & 0xC0) == 0xC0) {
         c = (ch & 0x3F);
-        ch = fgetc(f);
+        ch = f->getc();
       }
       else
         c = 1;
 
-      if (bpp == 8) {
-        while (c--) {
-          if (x < image->width())
-            put_pixel_fast<IndexedTraits>(image, x, y, ch);
+      c = std::min(c, line_size - x);
+      std::fill_n(&line[x], c, uint8_t(ch));
+      x += c;
+    }
 
-          x++;
-        }
-      }
-      else {
-        while (c--) {
-          if (xx < image->width())
-            put_pixel_fast<RgbTraits>(image, xx, y,
-                                      get_pixel_fast<RgbTraits>(image, xx, y) | ((ch & 0xff) << po));
-
-          x++;
-          if (x == bytes_per_line) {
-            xx = 0;
-            po = rgba_g_shift;
-          }
-          else if (x == bytes_per_line*2) {
-            xx = 0;
-            po = rgba_b_shift;
-          }
-          else
-            xx++;
-        }
-      }
+    if (bpp == 8) {
+      std::copy(line.data(), line.data()+w, image->getPixelAddress(0, y));
+    }
+    else {
+      const uint8_t* rplane = line.data();
+      const uint8_t* gplane = rplane + bytes_per_line;
+      const uint8_t* bplane = gplane + bytes_per_line;
+      uint32_t* dst = (uint32_t*)image->getPixelAddress(0, y);
+      for (xx=0; xx<w; xx++)
+        dst[xx] = rgba(rplane[xx], gplane[xx], bplane[xx], 255);
     }
 
     fop->setProgress((float)(y+1) / (float)(height));
@@ -148,12 +149,12 @@ bool PcxFormat::onLoad(FileOp* fop)
 
   if (!fop->isStop()) {
     if (bpp == 8) {                  /* look for a 256 color palette */
-      while ((c = fgetc(f)) != EOF) {
+      while ((c = f->getc()) != EOF) {
         if (c == 12) {
           for (c=0; c<256; c++) {
-            r = fgetc(f);
-            g = fgetc(f);
-            b = fgetc(f);
+            r = f->getc();
+            g = f->getc();
+            b = f->getc();
             fop->sequenceSetColor(c, r, g, b);
           }
           break;
@@ -162,7 +163,7 @@ bool PcxFormat::onLoad(FileOp* fop)
     }
   }
 
-  if (ferror(f)) {
+  if (f->error()) {
     fop->setError("Error reading file.\n");
     return false;
   }
@@ -10,18 +10,26 @@
 #endif
 
 #include "app/app.h"
+#include "app/console.h"
+#include "app/context.h"
 #include "app/document.h"
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
+#include "app/file/png_options.h"
 #include "app/ini_file.h"
+#include "app/pref/preferences.h"
 #include "base/file_handle.h"
 #include "doc/doc.h"
+#include "ui/ui.h"
+
+#include "png_options.xml.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "png.h"
+#include "zlib.h"
 
 namespace app {
 
@@ -41,11 +49,13 @@ class PngFormat : public FileFormat {
       FILE_SUPPORT_GRAYA |
       FILE_SUPPORT_INDEXED |
       FILE_SUPPORT_SEQUENCES |
-      FILE_SUPPORT_PALETTE_WITH_ALPHA;
+      FILE_SUPPORT_PALETTE_WITH_ALPHA |
+      FILE_SUPPORT_GET_FORMAT_OPTIONS;
   }
 
   bool onLoad(FileOp* fop) override;
   bool onSave(FileOp* fop) override;
+  base::SharedPtr<FormatOptions> onGetFormatOptions(FileOp* fop) override;
 };
 
 static FileFormat::Regular<PngFormat> ff{"png"};
@@ -334,6 +344,28 @@ bool PngFormat::onLoad(FileOp* fop)
   return true;
 }
 
+static void set_png_compression(png_structp png_ptr, const PngOptions& options)
+{
+  png_set_compression_level(png_ptr, options.compressionLevel());
+
+  switch (options.filter()) {
+    case PngOptions::kDefaultFilter: break;
+    case PngOptions::kNoFilter:      png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE); break;
+    case PngOptions::kSubFilter:     png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB); break;
+    case PngOptions::kUpFilter:      png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_UP); break;
+    case PngOptions::kAverageFilter: png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_AVG); break;
+    case PngOptions::kPaethFilter:   png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_PAETH); break;
+    case PngOptions::kAllFilters:    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_ALL_FILTERS); break;
+  }
+
+  switch (options.strategy()) {
+    case PngOptions::kDefaultStrategy:     break;
+    case PngOptions::kFilteredStrategy:    png_set_compression_strategy(png_ptr, Z_FILTERED); break;
+    case PngOptions::kHuffmanOnlyStrategy: png_set_compression_strategy(png_ptr, Z_HUFFMAN_ONLY); break;
+    case PngOptions::kRleStrategy:         png_set_compression_strategy(png_ptr, Z_RLE); break;
+  }
+}
+
 bool PngFormat::onSave(FileOp* fop)
 {
   const Image* image = fop->sequenceImage();
@@ -410,6 +442,11 @@ bool PngFormat::onSave(FileOp* fop)
   png_set_IHDR(png_ptr, info_ptr, width, height, 8, color_type,
                PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
+  // Compression options
+  base::SharedPtr<PngOptions> png_options = fop->sequenceGetFormatOptions();
+  if (png_options)
+    set_png_compression(png_ptr, *png_options);
+
   if (image->pixelFormat() == IMAGE_INDEXED) {
     int c, r, g, b;
     int pal_size = fop->sequenceGetNColors();
@@ -559,4 +596,67 @@ bool PngFormat::onSave(FileOp* fop)
   return true;
 }
 
+// Shows the PNG configuration dialog (only when it's enabled in the
+// preferences, by default the last used options are used).
+base::SharedPtr<FormatOptions> PngFormat::onGetFormatOptions(FileOp* fop)
+{
+  base::SharedPtr<PngOptions> png_options;
+  if (dynamic_cast<PngOptions*>(fop->document()->getFormatOptions().get()))
+    png_options = base::SharedPtr<PngOptions>(fop->document()->getFormatOptions());
+
+  if (!png_options)
+    png_options.reset(new PngOptions);
+
+  // Non-interactive mode (the options can be specified in the
+  // --png-options argument)
+  if (!fop->context() ||
+      !fop->context()->isUIAvailable())
+    return png_options;
+
+  try {
+    // Configuration parameters
+    png_options->setCompressionLevel(get_config_int("PNG", "Compression", png_options->compressionLevel()));
+    png_options->setFilter(get_config_int("PNG", "Filter", png_options->filter()));
+    png_options->setStrategy(get_config_int("PNG", "Strategy", png_options->strategy()));
+
+    if (!Preferences::instance().general.showPngOptions())
+      return png_options;
+
+    // Load the window to ask to the user the PNG options he wants.
+    app::gen::PngOptions win;
+    win.compression()->setValue(png_options->compressionLevel());
+    win.filter()->setSelectedItemIndex(png_options->filter());
+    win.strategy()->setSelectedItemIndex(png_options->strategy());
+    win.fastest()->Click.connect(
+      [&win](ui::Event&) {
+        PngOptions fastest;
+        fastest.setFastestPreset();
+        win.compression()->setValue(fastest.compressionLevel());
+        win.filter()->setSelectedItemIndex(fastest.filter());
+        win.strategy()->setSelectedItemIndex(fastest.strategy());
+      });
+
+    win.openWindowInForeground();
+
+    if (win.closer() == win.ok()) {
+      png_options->setCompressionLevel(win.compression()->getValue());
+      png_options->setFilter(win.filter()->getSelectedItemIndex());
+      png_options->setStrategy(win.strategy()->getSelectedItemIndex());
+
+      set_config_int("PNG", "Compression", png_options->compressionLevel());
+      set_config_int("PNG", "Filter", png_options->filter());
+      set_config_int("PNG", "Strategy", png_options->strategy());
+    }
+    else {
+      png_options.reset(nullptr);
+    }
+
+    return png_options;
+  }
+  catch (std::exception& e) {
+    Console::showException(e);
+    return base::SharedPtr<PngOptions>(nullptr);
+  }
+}
+
 } // namespace app
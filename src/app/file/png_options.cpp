@@ -0,0 +1,70 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/file/png_options.h"
+
+#include "base/split_string.h"
+
+#include <vector>
+
+namespace app {
+
+static int find_name(const std::string& value,
+                     const std::vector<std::string>& names)
+{
+  for (int i=0; i<int(names.size()); ++i)
+    if (value == names[i])
+      return i;
+  return -1;
+}
+
+bool PngOptions::parse(const std::string& spec)
+{
+  std::vector<std::string> options;
+  base::split_string(spec, options, ",");
+
+  for (const std::string& option : options) {
+    const std::string::size_type eq = option.find('=');
+    const std::string key = option.substr(0, eq);
+    const std::string value = (eq != std::string::npos ? option.substr(eq+1): "");
+
+    if (key == "fastest") {
+      setFastestPreset();
+    }
+    else if (key == "best") {
+      m_compressionLevel = 9;
+      m_filter = kAllFilters;
+      m_strategy = kDefaultStrategy;
+    }
+    else if (key == "level") {
+      if (value.size() != 1 || value[0] < '0' || value[0] > '9')
+        return false;
+      m_compressionLevel = value[0] - '0';
+    }
+    else if (key == "filter") {
+      int i = find_name(value, { "default", "none", "sub", "up", "avg", "paeth", "all" });
+      if (i < 0)
+        return false;
+      m_filter = static_cast<Filter>(i);
+    }
+    else if (key == "strategy") {
+      int i = find_name(value, { "default", "filtered", "huffman", "rle" });
+      if (i < 0)
+        return false;
+      m_strategy = static_cast<Strategy>(i);
+    }
+    else if (!key.empty())
+      return false;
+  }
+  return true;
+}
+
+} // namespace app
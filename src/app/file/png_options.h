@@ -0,0 +1,74 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "app/file/format_options.h"
+
+#include <string>
+
+namespace app {
+
+  // Data for PNG files
+  class PngOptions : public FormatOptions {
+  public:
+    // Row filters (Default uses the libpng choice: adaptive filtering
+    // for RGB/grayscale images, and no filter for indexed images)
+    enum Filter {
+      kDefaultFilter,
+      kNoFilter,
+      kSubFilter,
+      kUpFilter,
+      kAverageFilter,
+      kPaethFilter,
+      kAllFilters,
+    };
+
+    // zlib strategies
+    enum Strategy {
+      kDefaultStrategy,
+      kFilteredStrategy,
+      kHuffmanOnlyStrategy,
+      kRleStrategy,
+    };
+
+    PngOptions()
+      : m_compressionLevel(6)
+      , m_filter(kDefaultFilter)
+      , m_strategy(kDefaultStrategy) {
+    }
+
+    int compressionLevel() const { return m_compressionLevel; }
+    Filter filter() const { return m_filter; }
+    Strategy strategy() const { return m_strategy; }
+
+    void setCompressionLevel(int level) { m_compressionLevel = level; }
+    void setFilter(int filter) { m_filter = static_cast<Filter>(filter); }
+    void setStrategy(int strategy) { m_strategy = static_cast<Strategy>(strategy); }
+
+    // The fastest settings (e.g. for intermediate files of a
+    // pipeline): bigger files but several times faster to write.
+    void setFastestPreset() {
+      m_compressionLevel = 1;
+      m_filter = kNoFilter;
+      m_strategy = kRleStrategy;
+    }
+
+    // Parses a comma-separated list of options like
+    // "fastest", "best", "level=0-9",
+    // "filter=default|none|sub|up|avg|paeth|all", and
+    // "strategy=default|filtered|huffman|rle". Returns false if
+    // some option is invalid.
+    bool parse(const std::string& spec);
+
+  private:
+    int m_compressionLevel;     // zlib level (0=no compression, 9=best compression)
+    Filter m_filter;
+    Strategy m_strategy;
+  };
+
+} // namespace app
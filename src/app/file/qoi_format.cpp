@@ -21,7 +21,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define QOI_IMPLEMENTATION
 #include <qoi.h>
 
 namespace app {
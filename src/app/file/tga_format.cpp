@@ -17,8 +17,12 @@
 #include "app/file/format_options.h"
 #include "base/cfile.h"
 #include "base/file_handle.h"
+#include "base/file_reader.h"
 #include "doc/doc.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace base;
@@ -43,139 +47,74 @@ class TgaFormat : public FileFormat {
 
 static FileFormat::Regular<TgaFormat> ff{"tga"};
 
-/* rle_tga_read:
- *  Helper for reading 256 color RLE data from TGA files.
- */
-static void rle_tga_read(unsigned char *address, int w, int type, FILE *f)
+// Functions to convert a pixel of the file to a pixel of the image.
+
+static inline uint8_t tga_index(const uint8_t* src)
 {
-  unsigned char value;
-  int count, g;
-  int c = 0;
+  return src[0];
+}
 
-  do {
-    count = fgetc(f);
-    if (count & 0x80) {
-      count = (count & 0x7F) + 1;
-      c += count;
-      value = fgetc(f);
-      while (count--) {
-        if (type == 1)
-          *(address++) = value;
-        else {
-          *((uint16_t*)address) = value;
-          address += sizeof(uint16_t);
-        }
-      }
-    }
-    else {
-      count++;
-      c += count;
-      if (type == 1) {
-        fread(address, 1, count, f);
-        address += count;
-      }
-      else {
-        for (g=0; g<count; g++) {
-          *((uint16_t*)address) = fgetc(f);
-          address += sizeof(uint16_t);
-        }
-      }
-    }
-  } while (c < w);
+static inline uint16_t tga_gray(const uint8_t* src)
+{
+  return graya(src[0], 255);
 }
 
-/* rle_tga_read32:
- *  Helper for reading 32 bit RLE data from TGA files.
- */
-static void rle_tga_read32(uint32_t* address, int w, FILE *f)
+static inline uint32_t tga_bgra(const uint8_t* src)
 {
-  unsigned char value[4];
-  int count;
-  int c = 0;
+  return rgba(src[2], src[1], src[0], src[3]);
+}
 
-  do {
-    count = fgetc(f);
-    if (count & 0x80) {
-      count = (count & 0x7F) + 1;
-      c += count;
-      fread(value, 1, 4, f);
-      while (count--)
-        *(address++) = rgba(value[2], value[1], value[0], value[3]);
-    }
-    else {
-      count++;
-      c += count;
-      while (count--) {
-        fread(value, 1, 4, f);
-        *(address++) = rgba(value[2], value[1], value[0], value[3]);
-      }
-    }
-  } while (c < w);
+static inline uint32_t tga_bgr(const uint8_t* src)
+{
+  return rgba(src[2], src[1], src[0], 255);
 }
 
-/* rle_tga_read24:
- *  Helper for reading 24 bit RLE data from TGA files.
- */
-static void rle_tga_read24(uint32_t* address, int w, FILE *f)
+static inline uint32_t tga_rgb555(const uint8_t* src)
 {
-  unsigned char value[4];
-  int count;
-  int c = 0;
+  int c = (src[1] << 8) | src[0];
+  return rgba(scale_5bits_to_8bits((c >> 10) & 0x1F),
+              scale_5bits_to_8bits((c >> 5) & 0x1F),
+              scale_5bits_to_8bits(c & 0x1F), 255);
+}
 
-  do {
-    count = fgetc(f);
-    if (count & 0x80) {
-      count = (count & 0x7F) + 1;
-      c += count;
-      fread(value, 1, 3, f);
-      while (count--)
-        *(address++) = rgba(value[2], value[1], value[0], 255);
-    }
-    else {
-      count++;
-      c += count;
-      while (count--) {
-        fread(value, 1, 3, f);
-        *(address++) = rgba(value[2], value[1], value[0], 255);
-      }
-    }
-  } while (c < w);
+/* tga_read_row:
+ *  Reads an uncompressed row of "w" pixels at once.
+ */
+template<typename pixel_t, typename Convert>
+static void tga_read_row(pixel_t* address, int w, int bytes, FileReader *f,
+                         std::vector<uint8_t>& buffer, Convert convert)
+{
+  const uint8_t* src = f->data(std::size_t(w) * bytes, buffer);
+  for (int x=0; x<w; x++, src+=bytes)
+    address[x] = convert(src);
 }
 
-/* rle_tga_read16:
- *  Helper for reading 16 bit RLE data from TGA files.
+/* rle_tga_read:
+ *  Reads a row of RLE data. The packets that don't fit in the row
+ *  are clipped.
  */
-static void rle_tga_read16(uint32_t* address, int w, FILE *f)
+template<typename pixel_t, typename Convert>
+static void rle_tga_read(pixel_t* address, int w, int bytes, FileReader *f,
+                         std::vector<uint8_t>& buffer, Convert convert)
 {
-  unsigned int value;
-  uint32_t color;
   int count;
   int c = 0;
 
   do {
-    count = fgetc(f);
+    count = f->getc();
     if (count & 0x80) {
       count = (count & 0x7F) + 1;
-      c += count;
-      value = fgetw(f);
-      color = rgba(scale_5bits_to_8bits(((value >> 10) & 0x1F)),
-                   scale_5bits_to_8bits(((value >> 5) & 0x1F)),
-                   scale_5bits_to_8bits((value & 0x1F)), 255);
-
-      while (count--)
-        *(address++) = color;
+      const pixel_t value = convert(f->data(bytes, buffer));
+      std::fill_n(address+c, std::min(count, w-c), value);
     }
     else {
       count++;
-      c += count;
-      while (count--) {
-        value = fgetw(f);
-        color = rgba(scale_5bits_to_8bits(((value >> 10) & 0x1F)),
-                     scale_5bits_to_8bits(((value >> 5) & 0x1F)),
-                     scale_5bits_to_8bits((value & 0x1F)), 255);
-        *(address++) = color;
-      }
+      const uint8_t* src = f->data(std::size_t(count) * bytes, buffer);
+      const int n = std::min(count, w-c);
+      for (int x=0; x<n; x++, src+=bytes)
+        address[c+x] = convert(src);
     }
+    c += count;
   } while (c < w);
 }
 
@@ -184,38 +123,40 @@ static void rle_tga_read16(uint32_t* address, int w, FILE *f)
 // should be an array of at least 256 RGB structures).
 bool TgaFormat::onLoad(FileOp* fop)
 {
-  unsigned char image_id[256], image_palette[256][3], rgb[4];
+  unsigned char image_id[256], image_palette[256][3];
   unsigned char id_length, palette_type, image_type, palette_entry_size;
   unsigned char bpp, descriptor_bits;
   short unsigned int palette_colors;
   short unsigned int image_width, image_height;
-  unsigned int c, i, x, y, yc;
+  unsigned int c, i, y, yc;
   int compressed;
+  std::vector<uint8_t> buffer;
 
   FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
-  FILE* f = handle.get();
-
-  id_length = fgetc(f);
-  palette_type = fgetc(f);
-  image_type = fgetc(f);
-  fgetw(f);                     // first_color
-  palette_colors  = fgetw(f);
-  palette_entry_size = fgetc(f);
-  fgetw(f);                     // "left" field
-  fgetw(f);                     // "top" field
-  image_width = fgetw(f);
-  image_height = fgetw(f);
-  bpp = fgetc(f);
-  descriptor_bits = fgetc(f);
-
-  fread(image_id, 1, id_length, f);
+  FileReader reader(handle);
+  FileReader* f = &reader;
+
+  id_length = f->getc();
+  palette_type = f->getc();
+  image_type = f->getc();
+  f->getw();                    // first_color
+  palette_colors  = f->getw();
+  palette_entry_size = f->getc();
+  f->getw();                    // "left" field
+  f->getw();                    // "top" field
+  image_width = f->getw();
+  image_height = f->getw();
+  bpp = f->getc();
+  descriptor_bits = f->getc();
+
+  f->read(image_id, id_length);
 
   if (palette_type == 1) {
     for (i=0; i<palette_colors; i++) {
       switch (palette_entry_size) {
 
         case 16:
-          c = fgetw(f);
+          c = f->getw();
           image_palette[i][0] = (c & 0x1F) << 3;
           image_palette[i][1] = ((c >> 5) & 0x1F) << 3;
           image_palette[i][2] = ((c >> 10) & 0x1F) << 3;
@@ -223,11 +164,11 @@ bool TgaFormat::onLoad(FileOp* fop)
 
         case 24:
         case 32:
-          image_palette[i][0] = fgetc(f);
-          image_palette[i][1] = fgetc(f);
-          image_palette[i][2] = fgetc(f);
+          image_palette[i][0] = f->getc();
+          image_palette[i][1] = f->getc();
+          image_palette[i][2] = f->getc();
           if (palette_entry_size == 32)
-            fgetc(f);
+            f->getc();
           break;
       }
     }
@@ -303,55 +244,42 @@ bool TgaFormat::onLoad(FileOp* fop)
   for (y=image_height; y; y--) {
     yc = (descriptor_bits & 0x20) ? image_height-y : y-1;
 
+    uint8_t* address = image->getPixelAddress(0, yc);
+
     switch (image_type) {
 
       case 1:
+        if (compressed)
+          rle_tga_read(address, image_width, 1, f, buffer, tga_index);
+        else
+          tga_read_row(address, image_width, 1, f, buffer, tga_index);
+        break;
+
       case 3:
         if (compressed)
-          rle_tga_read(image->getPixelAddress(0, yc), image_width, image_type, f);
-        else if (image_type == 1)
-          fread(image->getPixelAddress(0, yc), 1, image_width, f);
-        else {
-          for (x=0; x<image_width; x++)
-            put_pixel_fast<GrayscaleTraits>(image, x, yc, graya(fgetc(f), 255));
-        }
+          rle_tga_read((uint16_t*)address, image_width, 1, f, buffer, tga_gray);
+        else
+          tga_read_row((uint16_t*)address, image_width, 1, f, buffer, tga_gray);
         break;
 
       case 2:
         if (bpp == 32) {
-          if (compressed) {
-            rle_tga_read32((uint32_t*)image->getPixelAddress(0, yc), image_width, f);
-          }
-          else {
-            for (x=0; x<image_width; x++) {
-              fread(rgb, 1, 4, f);
-              put_pixel_fast<RgbTraits>(image, x, yc, rgba(rgb[2], rgb[1], rgb[0], rgb[3]));
-            }
-          }
+          if (compressed)
+            rle_tga_read((uint32_t*)address, image_width, 4, f, buffer, tga_bgra);
+          else
+            tga_read_row((uint32_t*)address, image_width, 4, f, buffer, tga_bgra);
         }
         else if (bpp == 24) {
-          if (compressed) {
-            rle_tga_read24((uint32_t*)image->getPixelAddress(0, yc), image_width, f);
-          }
-          else {
-            for (x=0; x<image_width; x++) {
-              fread(rgb, 1, 3, f);
-              put_pixel_fast<RgbTraits>(image, x, yc, rgba(rgb[2], rgb[1], rgb[0], 255));
-            }
-          }
+          if (compressed)
+            rle_tga_read((uint32_t*)address, image_width, 3, f, buffer, tga_bgr);
+          else
+            tga_read_row((uint32_t*)address, image_width, 3, f, buffer, tga_bgr);
         }
         else {
-          if (compressed) {
-            rle_tga_read16((uint32_t*)image->getPixelAddress(0, yc), image_width, f);
-          }
-          else {
-            for (x=0; x<image_width; x++) {
-              c = fgetw(f);
-              put_pixel_fast<RgbTraits>(image, x, yc, rgba(((c >> 10) & 0x1F),
-                                                           ((c >> 5) & 0x1F),
-                                                           (c & 0x1F), 255));
-            }
-          }
+          if (compressed)
+            rle_tga_read((uint32_t*)address, image_width, 2, f, buffer, tga_rgb555);
+          else
+            tga_read_row((uint32_t*)address, image_width, 2, f, buffer, tga_rgb555);
         }
         break;
     }
@@ -363,7 +291,7 @@ bool TgaFormat::onLoad(FileOp* fop)
     }
   }
 
-  if (ferror(f)) {
+  if (f->error()) {
     fop->setError("Error reading file.\n");
     return false;
   }
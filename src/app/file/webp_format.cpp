@@ -263,8 +263,13 @@ bool WebPFormat::onSave(FileOp* fop)
       fop->setError("Error in WebP configuration preset\n");
       return false;
     }
+    config.method = webp_options->getLossyMethod();
   }
 
+  // Use more threads in the encoder (e.g. alpha plane and the
+  // analysis of lossy images are encoded in parallel)
+  config.thread_level = webp_options->getThreadLevel();
+
   if (!WebPValidateConfig(&config)) {
     fop->setError("Error validating WebP encoder configuration\n");
     return false;
@@ -311,7 +316,7 @@ bool WebPFormat::onSave(FileOp* fop)
 base::SharedPtr<FormatOptions> WebPFormat::onGetFormatOptions(FileOp* fop)
 {
   base::SharedPtr<WebPOptions> webp_options;
-  if (fop->document()->getFormatOptions())
+  if (dynamic_cast<WebPOptions*>(fop->document()->getFormatOptions().get()))
     webp_options = base::SharedPtr<WebPOptions>(fop->document()->getFormatOptions());
 
   if (!webp_options)
@@ -326,6 +331,8 @@ base::SharedPtr<FormatOptions> WebPFormat::onGetFormatOptions(FileOp* fop)
     // Configuration parameters
     webp_options->setQuality(get_config_int("WEBP", "Quality", webp_options->getQuality()));
     webp_options->setMethod(get_config_int("WEBP", "Compression", webp_options->getMethod()));
+    webp_options->setLossyMethod(get_config_int("WEBP", "LossyMethod", webp_options->getLossyMethod()));
+    webp_options->setThreadLevel(get_config_int("WEBP", "ThreadLevel", webp_options->getThreadLevel()));
     webp_options->setImageHint(get_config_int("WEBP", "ImageHint", webp_options->getImageHint()));
     webp_options->setImagePreset(get_config_int("WEBP", "ImagePreset", webp_options->getImagePreset()));
 
@@ -338,6 +345,8 @@ base::SharedPtr<FormatOptions> WebPFormat::onGetFormatOptions(FileOp* fop)
     win.compression()->setValue(webp_options->getMethod());
     win.imageHint()->setSelectedItemIndex(webp_options->getImageHint());
     win.imagePreset()->setSelectedItemIndex(webp_options->getImagePreset());
+    win.lossyMethod()->setValue(webp_options->getLossyMethod());
+    win.threadLevel()->setSelected(webp_options->getThreadLevel() != 0);
 
     win.openWindowInForeground();
 
@@ -347,11 +356,15 @@ base::SharedPtr<FormatOptions> WebPFormat::onGetFormatOptions(FileOp* fop)
       webp_options->setLossless(win.lossless()->isSelected());
       webp_options->setImageHint(base::convert_to<int>(win.imageHint()->getValue()));
       webp_options->setImagePreset(base::convert_to<int>(win.imagePreset()->getValue()));
+      webp_options->setLossyMethod(win.lossyMethod()->getValue());
+      webp_options->setThreadLevel(win.threadLevel()->isSelected() ? 1: 0);
 
       set_config_int("WEBP", "Quality", webp_options->getQuality());
       set_config_int("WEBP", "Compression", webp_options->getMethod());
       set_config_int("WEBP", "ImageHint", webp_options->getImageHint());
       set_config_int("WEBP", "ImagePreset", webp_options->getImagePreset());
+      set_config_int("WEBP", "LossyMethod", webp_options->getLossyMethod());
+      set_config_int("WEBP", "ThreadLevel", webp_options->getThreadLevel());
     }
     else {
       webp_options.reset(NULL);
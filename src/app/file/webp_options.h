@@ -9,6 +9,8 @@
 
 #include "app/file/format_options.h"
 
+#include <algorithm>
+
 #include <webp/decode.h>
 #include <webp/encode.h>
 
@@ -16,11 +18,13 @@ namespace app {
   // Data for WebP files
   class WebPOptions : public FormatOptions {
   public:
-    WebPOptions(): m_lossless(1), m_quality(75), m_method(6), m_image_hint(WEBP_HINT_DEFAULT), m_image_preset(WEBP_PRESET_DEFAULT) {};
+    WebPOptions(): m_lossless(1), m_quality(75), m_method(6), m_lossy_method(4), m_thread_level(1), m_image_hint(WEBP_HINT_DEFAULT), m_image_preset(WEBP_PRESET_DEFAULT) {};
 
     bool lossless() { return m_lossless; }
     int getQuality() { return m_quality; }
     int getMethod() { return m_method; }
+    int getLossyMethod() { return m_lossy_method; }
+    int getThreadLevel() { return m_thread_level; }
     WebPImageHint getImageHint() { return m_image_hint; }
     WebPPreset getImagePreset() { return m_image_preset; }
 
@@ -28,6 +32,8 @@ namespace app {
     void setLossless(bool lossless) { m_lossless = lossless; }
     void setQuality(int quality) { m_quality = quality; }
     void setMethod(int method) { m_method = method; }
+    void setLossyMethod(int method) { m_lossy_method = std::clamp(method, 0, 6); }
+    void setThreadLevel(int threadLevel) { m_thread_level = (threadLevel != 0); }
     void setImageHint(int imageHint) { m_image_hint = static_cast<WebPImageHint>(imageHint); }
     void setImageHint(WebPImageHint imageHint) { m_image_hint = imageHint; }
     void setImagePreset(int imagePreset) { m_image_preset = static_cast<WebPPreset>(imagePreset); };
@@ -37,6 +43,8 @@ namespace app {
     bool m_lossless;           // Lossless encoding (0=lossy(default), 1=lossless).
     int m_quality;          // between 0 (smallest file) and 100 (biggest)
     int m_method;             // quality/speed trade-off (0=fast, 9=slower-better)
+    int m_lossy_method;       // lossy quality/speed trade-off (0=fast, 6=slower-better)
+    int m_thread_level;       // 1 to use multiple threads in the encoder
     WebPImageHint m_image_hint;  // Hint for image type (lossless only for now).
     WebPPreset m_image_preset;  // Image Preset for lossy webp.
   };
@@ -20,13 +20,18 @@
 #include "base/fs.h"
 #include "base/path.h"
 #include "base/string.h"
+#include "base/time.h"
 #include "she/display.h"
 #include "she/surface.h"
 #include "she/system.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 #ifdef _WIN32
@@ -50,6 +55,22 @@
 
 namespace app {
 
+struct DirEntry {
+  std::string name;
+  bool isFolder;
+};
+
+// Entries of a folder found by a background thread (the blocking I/O
+// is done without locking the file system).
+struct DirEnumeration {
+  std::mutex mutex;
+  std::vector<DirEntry> entries; // Entries not added to the folder yet
+  base::Time modTime;            // Modification time of the folder
+  bool unchanged = false;        // The folder wasn't modified since the last listing
+  bool done = false;
+  std::atomic<bool> canceled { false };
+};
+
 // a position in the file-system
 class FileItem : public IFileItem {
 public:
@@ -61,6 +82,10 @@ public:
   unsigned int m_version;
   bool m_removed;
   bool m_is_folder;
+  bool m_listed;
+  base::Time m_modTime;           // modification time of the folder
+                                  // when it was listed
+  std::shared_ptr<DirEnumeration> m_enumeration;
 #ifdef _WIN32
   LPITEMIDLIST m_pidl;            // relative to parent
   LPITEMIDLIST m_fullpidl;        // relative to the Desktop folder
@@ -74,6 +99,12 @@ public:
   void insertChildSorted(FileItem* child);
   int compare(const FileItem& that) const;
 
+  bool needsUpdate() const;
+  void startListing();
+  void addEntries(const std::vector<DirEntry>& entries);
+  void finishListing(bool unchanged, const base::Time& modTime);
+  void cancelEnumeration();
+
   bool operator<(const FileItem& that) const { return compare(that) < 0; }
   bool operator>(const FileItem& that) const { return compare(that) > 0; }
   bool operator==(const FileItem& that) const { return compare(that) == 0; }
@@ -91,6 +122,8 @@ public:
 
   IFileItem* parent() const;
   const FileItemList& children();
+  const FileItemList& childrenAsync();
+  bool isLoading() const;
   void createDirectory(const std::string& dirname);
 
   bool hasExtension(const std::string& csv_extensions);
@@ -109,6 +142,9 @@ static FileItemMap* fileitems_map;
 static ThumbnailMap* thumbnail_map;
 static unsigned int current_file_system_version = 0;
 
+// folders being enumerated in background threads
+static std::vector<FileItem*> loading_items;
+
 #ifdef _WIN32
   static IMalloc* shl_imalloc = NULL;
   static IShellFolder* shl_idesktop = NULL;
@@ -131,6 +167,7 @@ static unsigned int current_file_system_version = 0;
   static void put_fileitem(FileItem* fileitem);
 #else
   static FileItem* get_fileitem_by_path(const std::string& path, bool create_if_not);
+  static void list_directory(const std::string& path, base::Time lastModTime, DirEnumeration* e);
   static std::string remove_backslash_if_needed(const std::string& filename);
   static std::string get_key_for_filename(const std::string& filename);
   static void put_fileitem(FileItem* fileitem);
@@ -173,6 +210,9 @@ FileSystemModule::~FileSystemModule()
   LOG("File system module: uninstalling\n");
   ASSERT(m_instance == this);
 
+  // Background enumerations are stopped (each FileItem destructor
+  // cancels its own enumeration)
+
   for (FileItemMap::iterator
          it=fileitems_map->begin(); it!=fileitems_map->end(); ++it) {
     delete it->second;
@@ -211,6 +251,42 @@ void FileSystemModule::refresh()
   ++current_file_system_version;
 }
 
+bool FileSystemModule::update()
+{
+  bool changed = false;
+
+  // Copy the list because finished folders are removed from it, and
+  // folders can be deleted when their parent is updated
+  std::vector<FileItem*> items = loading_items;
+  for (FileItem* item : items) {
+    if (std::find(loading_items.begin(), loading_items.end(), item) == loading_items.end())
+      continue;
+
+    std::shared_ptr<DirEnumeration> e = item->m_enumeration;
+    std::vector<DirEntry> entries;
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock(e->mutex);
+      entries.swap(e->entries);
+      done = e->done;
+    }
+
+    if (!entries.empty()) {
+      item->addEntries(entries);
+      changed = true;
+    }
+
+    if (done) {
+      item->m_enumeration.reset();
+      loading_items.erase(std::find(loading_items.begin(), loading_items.end(), item));
+      item->finishListing(e->unchanged, e->modTime);
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+
 IFileItem* FileSystemModule::getRootFileItem()
 {
   FileItem* fileitem;
@@ -357,22 +433,11 @@ IFileItem* FileItem::parent() const
 
 const FileItemList& FileItem::children()
 {
-  // Is the file-item a folder?
-  if (isFolder() &&
-      // if the children list is empty, or the file-system version
-      // change (it's like to say: the current m_children list
-      // is outdated)...
-      (m_children.empty() ||
-       current_file_system_version > m_version)) {
-    FileItemList::iterator it;
-    FileItem* child;
-
-    // we have to mark current items as deprecated
-    for (it=m_children.begin();
-         it!=m_children.end(); ++it) {
-      child = static_cast<FileItem*>(*it);
-      child->m_removed = true;
-    }
+  // Is the file-item a folder and its children list is outdated?
+  if (isFolder() && needsUpdate()) {
+    // The listing is done right now
+    cancelEnumeration();
+    startListing();
 
     //LOG("FS: Loading files for %p (%s)\n", fileitem, fileitem->displayname);
 #ifdef _WIN32
@@ -416,7 +481,7 @@ const FileItemList& FileItem::children()
               LPITEMIDLIST fullpidl = concat_pidl(m_fullpidl,
                                                   itempidl[c]);
 
-              child = get_fileitem_by_fullpidl(fullpidl, false);
+              FileItem* child = get_fileitem_by_fullpidl(fullpidl, false);
               if (!child) {
                 child = new FileItem(this);
 
@@ -443,69 +508,128 @@ const FileItemList& FileItem::children()
           pFolder->Release();
       }
     }
-#else
-    {
-      DIR* dir = opendir(m_filename.c_str());
-      if (dir) {
-        dirent* entry;
-        while ((entry = readdir(dir)) != NULL) {
-          FileItem* child;
-          std::string fn = entry->d_name;
-          std::string fullfn = base::join_path(m_filename, fn);
-
-          if (fn == "." || fn == "..")
-            continue;
-
-          child = get_fileitem_by_path(fullfn, false);
-          if (!child) {
-            child = new FileItem(this);
-
-            bool is_folder;
-            if (entry->d_type == DT_LNK) {
-              is_folder = base::is_directory(fullfn);
-            }
-            else {
-              is_folder = (entry->d_type == DT_DIR);
-            }
 
-            child->m_filename = fullfn;
-            child->m_displayname = fn;
-            child->m_is_folder = is_folder;
+    finishListing(false, base::Time());
+#else
+    DirEnumeration e;
+    list_directory(m_filename, m_modTime, &e);
+    if (!e.unchanged)
+      addEntries(e.entries);
+    finishListing(e.unchanged, e.modTime);
+#endif
+  }
 
-            put_fileitem(child);
-          }
-          else {
-            ASSERT(child->m_parent == this);
-          }
+  return m_children;
+}
 
-          insertChildSorted(child);
-        }
-        closedir(dir);
-      }
+const FileItemList& FileItem::childrenAsync()
+{
+#ifdef _WIN32
+  // Shell folders are enumerated in the GUI thread
+  return children();
+#else
+  if (isFolder() && !m_enumeration && needsUpdate()) {
+    startListing();
+
+    m_enumeration = std::make_shared<DirEnumeration>();
+    loading_items.push_back(this);
+
+    // The thread keeps a reference to the enumeration (so it can
+    // finish after the FileItem is deleted)
+    std::shared_ptr<DirEnumeration> e = m_enumeration;
+    std::string path = m_filename;
+    base::Time modTime = m_modTime;
+    std::thread(
+      [e, path, modTime]{
+        list_directory(path, modTime, e.get());
+      }).detach();
   }
+  return m_children;
 #endif
+}
+
+bool FileItem::isLoading() const
+{
+  return (m_enumeration != nullptr);
+}
 
-    // check old file-items (maybe removed directories or file-items)
-    for (it=m_children.begin();
-         it!=m_children.end(); ) {
-      child = static_cast<FileItem*>(*it);
-      ASSERT(child != NULL);
+bool FileItem::needsUpdate() const
+{
+  // The children list was never loaded or the file-system version
+  // changed (it's like to say: the current m_children list is
+  // outdated)
+  return (!m_listed ||
+          current_file_system_version > m_version);
+}
 
-      if (child && child->m_removed) {
-        it = m_children.erase(it);
+void FileItem::startListing()
+{
+  // we have to mark current items as deprecated
+  for (IFileItem* child : m_children)
+    static_cast<FileItem*>(child)->m_removed = true;
+}
 
-        fileitems_map->erase(fileitems_map->find(child->m_keyname));
-        delete child;
-      }
-      else
-        ++it;
+void FileItem::addEntries(const std::vector<DirEntry>& entries)
+{
+#ifndef _WIN32
+  for (const DirEntry& entry : entries) {
+    std::string fullfn = base::join_path(m_filename, entry.name);
+
+    FileItem* child = get_fileitem_by_path(fullfn, false);
+    if (!child) {
+      child = new FileItem(this);
+      child->m_filename = fullfn;
+      child->m_displayname = entry.name;
+      child->m_is_folder = entry.isFolder;
+
+      put_fileitem(child);
+    }
+    else {
+      ASSERT(child->m_parent == this);
     }
 
-    // now this file-item is updated
-    m_version = current_file_system_version;
+    insertChildSorted(child);
   }
+#endif
+}
 
-  return m_children;
+void FileItem::finishListing(bool unchanged, const base::Time& modTime)
+{
+  FileItemList::iterator it;
+  FileItem* child;
+
+  // check old file-items (maybe removed directories or file-items)
+  for (it=m_children.begin();
+       it!=m_children.end(); ) {
+    child = static_cast<FileItem*>(*it);
+    ASSERT(child != NULL);
+
+    if (unchanged)
+      child->m_removed = false;
+
+    if (child && child->m_removed) {
+      it = m_children.erase(it);
+
+      fileitems_map->erase(fileitems_map->find(child->m_keyname));
+      delete child;
+    }
+    else
+      ++it;
+  }
+
+  // now this file-item is updated
+  m_version = current_file_system_version;
+  m_modTime = modTime;
+  m_listed = true;
+}
+
+void FileItem::cancelEnumeration()
+{
+  if (m_enumeration) {
+    m_enumeration->canceled = true;
+    m_enumeration.reset();
+    loading_items.erase(std::find(loading_items.begin(), loading_items.end(), this));
+  }
 }
 
 void FileItem::createDirectory(const std::string& dirname)
@@ -514,6 +638,7 @@ void FileItem::createDirectory(const std::string& dirname)
 
   // Invalidate the children list.
   m_version = 0;
+  m_modTime = base::Time();
 }
 
 bool FileItem::hasExtension(const std::string& csv_extensions)
@@ -556,6 +681,7 @@ FileItem::FileItem(FileItem* parent)
   m_version = current_file_system_version;
   m_removed = false;
   m_is_folder = false;
+  m_listed = false;
 #ifdef _WIN32
   m_pidl = NULL;
   m_fullpidl = NULL;
@@ -566,6 +692,8 @@ FileItem::~FileItem()
 {
   LOG("FS: Destroying FileItem() with parent %p\n", m_parent);
 
+  cancelEnumeration();
+
 #ifdef _WIN32
   if (m_fullpidl && m_fullpidl != m_pidl) {
     free_pidl(m_fullpidl);
@@ -946,6 +1074,57 @@ static FileItem* get_fileitem_by_path(const std::string& path, bool create_if_no
   return fileitem;
 }
 
+static void list_directory(const std::string& path, base::Time lastModTime, DirEnumeration* e)
+{
+  base::Time modTime = base::get_modification_time(path);
+  if (lastModTime.valid() && modTime == lastModTime) {
+    std::lock_guard<std::mutex> lock(e->mutex);
+    e->modTime = modTime;
+    e->unchanged = true;
+    e->done = true;
+    return;
+  }
+
+  // The modification time has a resolution of seconds, so if the
+  // folder was modified in this same second it could be modified
+  // again after the listing (we cannot trust the time to skip the
+  // next listing).
+  base::Time now = base::current_time();
+  if (modTime == now)
+    modTime = base::Time();
+
+  // Entries are given to the GUI thread in small batches
+  std::vector<DirEntry> batch;
+  DIR* dir = opendir(path.c_str());
+  if (dir) {
+    dirent* entry;
+    while (!e->canceled && (entry = readdir(dir)) != NULL) {
+      std::string fn = entry->d_name;
+      if (fn == "." || fn == "..")
+        continue;
+
+      bool is_folder;
+      if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+        is_folder = base::is_directory(base::join_path(path, fn));
+      else
+        is_folder = (entry->d_type == DT_DIR);
+
+      batch.push_back(DirEntry{ fn, is_folder });
+      if (batch.size() == 64) {
+        std::lock_guard<std::mutex> lock(e->mutex);
+        e->entries.insert(e->entries.end(), batch.begin(), batch.end());
+        batch.clear();
+      }
+    }
+    closedir(dir);
+  }
+
+  std::lock_guard<std::mutex> lock(e->mutex);
+  e->entries.insert(e->entries.end(), batch.begin(), batch.end());
+  e->modTime = modTime;
+  e->done = true;
+}
+
 static std::string remove_backslash_if_needed(const std::string& filename)
 {
   if (!filename.empty() && base::is_path_separator(*(filename.end()-1))) {
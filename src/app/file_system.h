@@ -32,9 +32,16 @@ namespace app {
     static FileSystemModule* instance();
 
     // Marks all FileItems as deprecated to be refresh the next time
-    // they are queried through @ref FileItem::children().
+    // they are queried through @ref FileItem::children(). Folders
+    // that weren't modified since they were listed are not listed
+    // again.
     void refresh();
 
+    // Adds the entries found by the background enumerations (see
+    // IFileItem::childrenAsync()) in their folders. It must be called
+    // from the GUI thread. Returns true if some folder has changed.
+    bool update();
+
     IFileItem* getRootFileItem();
 
     // Returns the FileItem through the specified "path".
@@ -74,6 +81,15 @@ namespace app {
 
     virtual IFileItem* parent() const = 0;
     virtual const FileItemList& children() = 0;
+
+    // Like children() but the folder is enumerated in a background
+    // thread, the returned list is completed in each
+    // FileSystemModule::update() call.
+    virtual const FileItemList& childrenAsync() = 0;
+
+    // Returns true if the folder is being enumerated in background.
+    virtual bool isLoading() const = 0;
+
     virtual void createDirectory(const std::string& dirname) = 0;
 
     virtual bool hasExtension(const std::string& csv_extensions) = 0;
@@ -30,6 +30,7 @@ LayerImage* create_flatten_layer_copy(Sprite* dstSprite, const Layer* srcLayer,
 {
   std::unique_ptr<LayerImage> flatLayer(new LayerImage(dstSprite));
   render::Render render;
+  render.setParallel(true);
 
   for (frame_t frame=frmin; frame<=frmax; ++frame) {
     // Does this frame have cels to render?
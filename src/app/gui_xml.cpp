@@ -17,15 +17,23 @@
 
 namespace app {
 
+static GuiXml* singleton = nullptr;
+
 // static
 GuiXml* GuiXml::instance()
 {
-  static GuiXml* singleton = 0;
   if (!singleton)
     singleton = new GuiXml();
   return singleton;
 }
 
+// static
+void GuiXml::destroyInstance()
+{
+  delete singleton;
+  singleton = nullptr;
+}
+
 GuiXml::GuiXml()
 {
   LOG("Loading gui.xml file...\n");
@@ -21,6 +21,9 @@ namespace app {
     // generated an exception if there are errors in the XML file.
     static GuiXml* instance();
 
+    // Deletes the singleton (if it was loaded).
+    static void destroyInstance();
+
     // Returns the tinyxml document instance.
     XmlDocumentRef doc() {
       return m_doc;
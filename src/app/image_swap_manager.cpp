@@ -0,0 +1,118 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/image_swap_manager.h"
+
+#include "app/document.h"
+#include "app/ui_context.h"
+#include "doc/cel.h"
+#include "doc/cel_data.h"
+#include "doc/cels_range.h"
+#include "doc/image_swap.h"
+#include "doc/sprite.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace app {
+
+using namespace doc;
+
+namespace {
+
+const int kTrimInterval = 1000; // Milliseconds
+
+// Number of trim intervals that an image must be unused to free its
+// pixels if it has a compressed copy
+const int kColdTicks = 30;
+
+} // anonymous namespace
+
+ImageSwapManager::ImageSwapManager()
+  : m_timer(kTrimInterval)
+  , m_ticks(0)
+  , m_checkTick(0)
+  , m_coldTick(0)
+{
+  m_timer.Tick.connect(&ImageSwapManager::onTick, this);
+  m_timer.start();
+}
+
+// static
+void ImageSwapManager::setMemoryBudget(int mb)
+{
+  ImageSwap::instance().setMaxResidentBytes(
+    std::size_t(std::max(0, mb)) * 1024 * 1024);
+}
+
+int ImageSwapManager::trim()
+{
+  ImageSwap& swap = ImageSwap::instance();
+  const uint64_t coldTick = m_coldTick;
+  m_coldTick = 0;
+  if (!swap.isOverBudget() && coldTick == 0)
+    return 0;
+
+  // Lock all the documents that are not being used right now (we
+  // cannot swap out images while other thread has access to them).
+  std::vector<Document*> docs;
+  for (auto doc : UIContext::instance()->documents()) {
+    Document* document = static_cast<Document*>(doc);
+    if (document->lock(Document::WriteLock, 0))
+      docs.push_back(document);
+  }
+
+  std::vector<CelData*> candidates;
+  for (Document* doc : docs) {
+    for (const auto& cel : doc->sprite()->uniqueCels()) {
+      CelData* celData = cel->data();
+      if (!celData->isSwapped())
+        candidates.push_back(celData);
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](const CelData* a, const CelData* b) {
+              return a->lastAccess() < b->lastAccess();
+            });
+
+  int swapped = 0;
+  for (CelData* celData : candidates) {
+    if (!swap.isOverBudget()) {
+      // Cold images are cheap to swap out (their compressed copy is
+      // still valid)
+      if (celData->lastAccess() >= coldTick)
+        break;
+      if (!celData->hasCompressedCopy())
+        continue;
+    }
+    if (celData->swapOut())
+      ++swapped;
+  }
+
+  for (Document* doc : docs)
+    doc->unlock();
+
+  return swapped;
+}
+
+void ImageSwapManager::onTick()
+{
+  if (++m_ticks == kColdTicks) {
+    m_ticks = 0;
+    m_coldTick = m_checkTick;
+    m_checkTick = ImageSwap::instance().accessTick();
+  }
+
+  trim();
+}
+
+} // namespace app
@@ -0,0 +1,51 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "ui/timer.h"
+
+#include <cstdint>
+
+namespace app {
+
+  // Keeps the memory used by the cel images of all the open documents
+  // under the limit of the "image_memory_budget" option. The least
+  // recently used images are written in the swap file (see
+  // doc::ImageSwap) from time to time in the GUI thread, locking each
+  // document to write (so nobody is using a raw Image pointer of the
+  // cels that are swapped out).
+  class ImageSwapManager {
+  public:
+    ImageSwapManager();
+
+    // Changes the memory budget (in MB, 0 = unlimited).
+    static void setMemoryBudget(int mb);
+
+    // Swaps out images until the memory budget is satisfied, and the
+    // unmodified images with a compressed copy in memory (see
+    // doc::CelData::hasCompressedCopy()) that weren't used for a
+    // while. Returns the number of swapped images.
+    int trim();
+
+  private:
+    void onTick();
+
+    ui::Timer m_timer;
+
+    // Each kColdTicks timer ticks the images that weren't used since
+    // the previous check (m_checkTick) are cold, trim() swaps them
+    // out if m_coldTick != 0.
+    int m_ticks;
+    uint64_t m_checkTick;
+    uint64_t m_coldTick;
+
+    DISABLE_COPYING(ImageSwapManager);
+  };
+
+} // namespace app
@@ -30,6 +30,7 @@ Job::Job(const char* jobName)
   m_last_progress = 0.0;
   m_done_flag = false;
   m_canceled_flag = false;
+  m_detached_flag = false;
 
   m_mutex = new base::mutex();
 
@@ -67,7 +68,7 @@ void Job::startJob()
     // The job was canceled by the user?
     {
       base::scoped_lock hold(*m_mutex);
-      if (!m_done_flag)
+      if (!m_done_flag && !m_detached_flag)
         m_canceled_flag = true;
     }
 
@@ -107,6 +108,18 @@ bool Job::isCanceled()
   return m_canceled_flag;
 }
 
+bool Job::isDetached()
+{
+  base::scoped_lock hold(*m_mutex);
+  return m_detached_flag;
+}
+
+void Job::detachJob()
+{
+  base::scoped_lock hold(*m_mutex);
+  m_detached_flag = true;
+}
+
 void Job::onMonitoringTick()
 {
   base::scoped_lock hold(*m_mutex);
@@ -115,7 +128,7 @@ void Job::onMonitoringTick()
   m_alert_window->setProgress(m_last_progress);
 
   // is job done? we can close the monitor
-  if (m_done_flag || m_canceled_flag) {
+  if (m_done_flag || m_canceled_flag || m_detached_flag) {
     m_timer->stop();
     m_alert_window->closeWindow(NULL);
   }
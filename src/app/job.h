@@ -40,7 +40,15 @@ namespace app {
     // check this variable periodically to stop working.
     bool isCanceled();
 
+    // Returns true if the progress window was closed with detachJob()
+    // while the job continues working in its thread. waitJob() must
+    // be called anyway before deleting the job.
+    bool isDetached();
+
   protected:
+    // Closes the progress window (from the GUI thread) without
+    // canceling the job.
+    void detachJob();
 
     // This member function is called from another dedicated thread
     // outside the GUI one, so you can do some image processing here.
@@ -66,6 +74,7 @@ namespace app {
     double m_last_progress;
     bool m_done_flag;
     bool m_canceled_flag;
+    bool m_detached_flag;
     std::exception_ptr m_error;
 
     // these methods are privated and not defined
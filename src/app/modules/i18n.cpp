@@ -9,6 +9,7 @@
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <unordered_set>
 
 namespace app {
@@ -35,6 +36,16 @@ void loadLanguage(const std::string& language) {
       return;
   }
 
+  // Read the whole catalogue at once, it's parsed from memory.
+  std::vector<char> buf;
+  {
+    char chunk[16*1024];
+    std::size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file.get())) > 0)
+      buf.insert(buf.end(), chunk, chunk+n);
+  }
+  file.reset();
+
   enum class State {
       start,
       KeyOrClose,
@@ -49,7 +60,8 @@ void loadLanguage(const std::string& language) {
   std::string acc, key;
   bool escape = false;
 
-  while (fread(&ch, 1, 1, file.get())) {
+  for (std::size_t i=0; i<buf.size(); ++i) {
+    ch = buf[i];
     switch (state) {
     case State::start:
       if (ch <= ' ') continue;
@@ -115,7 +127,7 @@ void loadLanguage(const std::string& language) {
       return;
 
     case State::AfterValue:
-      translations[key] = acc;
+      translations[key] = std::move(acc);
       acc.clear();
       state = State::KeyOrClose;
       break;
@@ -145,6 +157,10 @@ std::string i18n(const std::string& key, const std::string& src)
 
 void setLanguage(const std::string& language)
 {
+    // Keep the loaded catalogue if the language didn't change
+    if (languageLoaded && app::language == language)
+        return;
+
     app::language = language;
     languageLoaded = false;
     languageMissing.clear();
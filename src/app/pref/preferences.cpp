@@ -63,8 +63,11 @@ void Preferences::save()
   for (auto& pair : m_tools)
     pair.second->save();
 
+  // Only documents with modified options are written, so we don't
+  // rewrite the .ini file of each opened document.
   for (auto& pair : m_docs)
-    serializeDocPref(pair.first, pair.second, true);
+    if (pair.second->isDirty())
+      serializeDocPref(pair.first, pair.second, true);
 
   flush_config_file();
 }
@@ -131,7 +134,8 @@ void Preferences::removeDocument(doc::Document* doc)
 
   auto it = m_docs.find(static_cast<app::Document*>(doc));
   if (it != m_docs.end()) {
-    serializeDocPref(it->first, it->second, true);
+    if (it->second->isDirty())
+      serializeDocPref(it->first, it->second, true);
     delete it->second;
     m_docs.erase(it);
   }
@@ -7,9 +7,12 @@
 #pragma once
 
 #include <chrono>
+#include <fstream>
 #include <sstream>
 #include <unordered_map>
 #include "app/task_manager.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
 #include "net/http_request.h"
 #include "net/http_response.h"
 
@@ -21,11 +24,11 @@ namespace app {
       int status;
     };
 
+    // The requests are sent from worker threads, at most
+    // net::HttpInFlight::kDefaultLimit at the same time (connections
+    // are reused). The TaskHandle can abort them.
     static TaskHandle fetch(const std::string& url, const std::string* post, std::unordered_map<std::string, std::string>& headers, std::function<void(Result&&)>&& callback) {
-      auto req = std::make_shared<net::HttpRequest>(url);
-      req->setHeaders(headers);
-      if (post)
-        req->setPostBody(*post);
+      auto req = createRequest(url, post, headers);
       return TaskManager::instance().addTask<Result>(
         [=]{
           Result result;
@@ -40,5 +43,42 @@ namespace app {
         std::move(callback),
         [req]{req->abort();});
     }
+
+    // Streams the response body to the given file instead of keeping
+    // it in memory (Result::body is empty). The file is deleted if
+    // the request fails or is aborted.
+    static TaskHandle download(const std::string& url, const std::string* post, std::unordered_map<std::string, std::string>& headers, const std::string& filename, std::function<void(Result&&)>&& callback) {
+      auto req = createRequest(url, post, headers);
+      return TaskManager::instance().addTask<Result>(
+        [=]{
+          Result result;
+          bool ok;
+          {
+            std::ofstream file(FSTREAM_PATH(filename), std::ios::binary);
+            net::HttpResponse res{&file};
+            ok = (file && req->send(res));
+            result.status = (ok ? res.status(): 0);
+            file.close();
+            ok = (ok && file);
+          }
+          if (!ok) {
+            result.status = 0;
+            if (base::is_file(filename))
+              base::delete_file(filename);
+          }
+          return result;
+        },
+        std::move(callback),
+        [req]{req->abort();});
+    }
+
+  private:
+    static std::shared_ptr<net::HttpRequest> createRequest(const std::string& url, const std::string* post, std::unordered_map<std::string, std::string>& headers) {
+      auto req = std::make_shared<net::HttpRequest>(url);
+      req->setHeaders(headers);
+      if (post)
+        req->setPostBody(*post);
+      return req;
+    }
   };
 }
@@ -18,6 +18,9 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
 
 #ifdef _WIN32
   #include <windows.h>
@@ -26,6 +29,30 @@
 
 namespace app {
 
+static std::mutex data_dirs_mutex;
+static std::map<std::string, bool> data_dirs_exist;
+
+// Returns false if the given data directory doesn't exist, so we can
+// avoid probing the file system for each file inside it.
+static bool data_dir_exists(const std::string& dir)
+{
+  std::lock_guard<std::mutex> lock(data_dirs_mutex);
+  auto it = data_dirs_exist.find(dir);
+  if (it != data_dirs_exist.end())
+    return it->second;
+
+  bool exists = base::is_directory(dir);
+  data_dirs_exist[dir] = exists;
+  return exists;
+}
+
+// static
+void ResourceFinder::resetDataDirsCache()
+{
+  std::lock_guard<std::mutex> lock(data_dirs_mutex);
+  data_dirs_exist.clear();
+}
+
 ResourceFinder::ResourceFinder(bool log)
   : m_log(log)
 {
@@ -60,6 +87,13 @@ bool ResourceFinder::findFirst()
     if (m_log)
       LOG("Searching file \"%s\"...", filename().c_str());
 
+    const std::string& dataDir = m_dataDirs[m_current];
+    if (!dataDir.empty() && !data_dir_exists(dataDir)) {
+      if (m_log)
+        LOG(" (not found)\n");
+      continue;
+    }
+
     if (base::is_file(filename())) {
       if (m_log)
         LOG(" (found)\n");
@@ -76,6 +110,7 @@ bool ResourceFinder::findFirst()
 void ResourceFinder::addPath(const std::string& path)
 {
   m_paths.push_back(path);
+  m_dataDirs.push_back(std::string());
 }
 
 void ResourceFinder::includeBinDir(const char* filename)
@@ -85,6 +120,7 @@ void ResourceFinder::includeBinDir(const char* filename)
 
 void ResourceFinder::includeDataDir(const char* filename)
 {
+  const std::size_t firstPath = m_paths.size();
   char buf[4096];
 
 #ifdef _WIN32
@@ -128,6 +164,15 @@ void ResourceFinder::includeDataDir(const char* filename)
   includeBinDir(buf);
 
 #endif
+
+  // Each path ends with "data/filename", so we can get the data
+  // directory where the file should be.
+  const std::size_t n = std::strlen(filename);
+  for (std::size_t i=firstPath; i<m_paths.size(); ++i) {
+    const std::string& path = m_paths[i];
+    if (path.size() > n)
+      m_dataDirs[i] = path.substr(0, path.size()-n);
+  }
 }
 
 void ResourceFinder::includeHomeDir(const char* filename)
@@ -246,8 +291,10 @@ std::string ResourceFinder::getFirstOrCreateDefault()
     fn = defaultFilename();
 
     std::string dir = base::get_file_path(fn);
-    if (!base::is_directory(dir))
+    if (!base::is_directory(dir)) {
       base::make_all_directories(dir);
+      resetDataDirsCache();
+    }
   }
 
   return fn;
@@ -56,9 +56,15 @@ namespace app {
     // structure to create the file in its default location.
     std::string getFirstOrCreateDefault();
 
+    // Data directories that don't exist are remembered so their
+    // files aren't looked for again. This must be called after
+    // creating files in a data directory.
+    static void resetDataDirsCache();
+
   private:
     bool m_log;
     std::vector<std::string> m_paths;
+    std::vector<std::string> m_dataDirs; // Data directory of each path (empty if it isn't a data file)
     int m_current;
     std::string m_default;
 
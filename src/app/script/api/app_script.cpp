@@ -102,6 +102,11 @@ public:
       .doc("Schedules a yield event on the next frame")
       .docArg("event", "Name of the event to be raised. The default is yield.");
 
+    addMethod("shouldYield", &AppScriptObject::shouldYield)
+      .doc("Checks if a long task should call yield to keep the UI responsive")
+      .docArg("budget", "Milliseconds the script can run before yielding. The default is 16.")
+      .docReturns("true if the script has been running for longer than the budget");
+
     addMethod("open", &AppScriptObject::open)
       .doc("Opens a document for editing");
 
@@ -109,11 +114,25 @@ public:
 
     addMethod("redraw", &AppScriptObject::redraw);
 
+    addMethod("beginBatch", &AppScriptObject::beginBatch)
+      .doc("Starts a batch of changes: modified pixels are redrawn only once, when the batch ends.");
+
+    addMethod("endBatch", &AppScriptObject::endBatch)
+      .doc("Ends the current batch of changes and redraws the modified pixels.");
+
     makeGlobal("app");
   }
 
   void redraw() {
-    ui::Manager::getDefault()->invalidate();
+    AppScripting::redraw();
+  }
+
+  void beginBatch() {
+    AppScripting::beginBatch();
+  }
+
+  void endBatch() {
+    AppScripting::endBatch();
   }
 
   void yield(const std::string& event, int cycles) {
@@ -127,6 +146,11 @@ public:
     });
   }
 
+  bool shouldYield(script::Value budget) {
+    return AppScripting::shouldYield(
+      budget.type == script::Value::Type::UNDEFINED ? 16: int(budget));
+  }
+
   ScriptObject* createDialog(const std::string& id) {
     auto dialog = getEngine()->create<ui::Dialog>();
     if (!dialog)
@@ -5,13 +5,27 @@
 // it under the terms of the GNU General Public License version 2 as
 // published by the Free Software Foundation.
 
+#include "app/document.h"
+#include "app/script/app_scripting.h"
+#include "app/ui_context.h"
+#include "app/util/encode_image.h"
 #include "base/base64.h"
 #include "script/script_object.h"
+#include "doc/algorithm/flip_image.h"
+#include "doc/algorithm/floodfill.h"
+#include "doc/cel.h"
+#include "doc/cels_range.h"
 #include "doc/image.h"
-#include "she/surface.h"
-#include "she/system.h"
+#include "doc/image_impl.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "gfx/region.h"
+#include "render/render.h"
 #include "ui/manager.h"
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <vector>
 
 class ImageScriptObject : public script::ScriptObject {
 public:
@@ -44,17 +58,70 @@ public:
       .doc("clears the image with the specified color.")
       .docArg("color", "a 32-bit color in 8888 RGBA format.");
 
+    addMethod("fill", &ImageScriptObject::fill)
+      .doc("fills a rectangle of the image with the specified color.")
+      .docArg("x", "integer, left side of the rectangle.")
+      .docArg("y", "integer, top side of the rectangle.")
+      .docArg("width", "integer, width of the rectangle.")
+      .docArg("height", "integer, height of the rectangle.")
+      .docArg("color", "a 32-bit color in 8888 RGBA format.");
+
+    addMethod("drawImage", &ImageScriptObject::drawImage)
+      .doc("draws another image onto this one.")
+      .docArg("image", "the Image to draw.")
+      .docArg("x", "integer, destination of the left side of the image.")
+      .docArg("y", "integer, destination of the top side of the image.")
+      .docArg("opacity", "optional integer from 0 to 255 (255 by default).")
+      .docArg("blendMode", "optional integer, the BlendMode (normal by default).");
+
+    addMethod("replaceColor", &ImageScriptObject::replaceColor)
+      .doc("replaces all the pixels of one color with another color.")
+      .docArg("from", "the color to replace.")
+      .docArg("to", "the new color.")
+      .docArg("tolerance", "optional integer from 0 to 255, maximum difference of each component (0 by default).");
+
+    addMethod("applyLut", &ImageScriptObject::applyLut)
+      .doc("maps each component of each pixel through a lookup table.")
+      .docArg("lut", "a Uint8Array with 256 entries (applied to all the components) "
+              "or 1024 entries (256 for each of the R, G, B and A components).");
+
+    addMethod("flip", &ImageScriptObject::flip)
+      .doc("flips the image in place.")
+      .docArg("vertical", "optional boolean, flips the image vertically instead of horizontally.");
+
+    addMethod("floodFill", &ImageScriptObject::floodFill)
+      .doc("fills the area of similar color around the given coordinate.")
+      .docArg("x", "integer")
+      .docArg("y", "integer")
+      .docArg("color", "a 32-bit color in 8888 RGBA format.")
+      .docArg("tolerance", "optional integer from 0 to 255 (0 by default).")
+      .docArg("contiguous", "optional boolean, fills only the pixels connected to (x, y) (true by default).");
+
     addMethod("putImageData", &ImageScriptObject::putImageData)
-      .doc("writes the given pixels onto the image. Must be the same size as the image.")
-      .docArg("data", "All of the pixels in the image.");
+      .doc("writes the given pixels onto the image. Without a rectangle, the data must be the same size as the image.")
+      .docArg("data", "The pixels of the rectangle (or all of the pixels in the image), row by row.")
+      .docArg("x", "optional integer, left side of the rectangle.")
+      .docArg("y", "optional integer, top side of the rectangle.")
+      .docArg("width", "optional integer, width of the rectangle.")
+      .docArg("height", "optional integer, height of the rectangle.");
 
     addMethod("getImageData", &ImageScriptObject::getImageData)
-      .doc("creates an array containing all of the image's pixels.")
-      .docReturns("All pixels in a Uint8Array");
+      .doc("creates an array containing the pixels of the given rectangle (or all of the image's pixels).")
+      .docArg("x", "optional integer, left side of the rectangle.")
+      .docArg("y", "optional integer, top side of the rectangle.")
+      .docArg("width", "optional integer, width of the rectangle.")
+      .docArg("height", "optional integer, height of the rectangle.")
+      .docReturns("The pixels in a Uint8Array, row by row");
 
     addMethod("getPNGData", &ImageScriptObject::getPNGData)
       .doc("Encodes the image as a PNG.")
       .docReturns("The image as a Base64-encoded PNG string.");
+
+    addMethod("encode", &ImageScriptObject::encode)
+      .doc("Encodes the image in memory, without the Base64 conversion of getPNGData. Non-RGB images are converted to RGBA.")
+      .docArg("format", "optional string: \"png\" (default), \"qoi\" (much faster, bigger) or \"raw\" (the pixels as getImageData).")
+      .docArg("level", "optional integer, PNG compression level from 0 (fastest) to 9 (smallest).")
+      .docReturns("The encoded image in a Uint8Array, or an empty array if it cannot be encoded.");
   }
 
   doc::Image* img() {
@@ -64,51 +131,314 @@ public:
     return img;
   }
 
-  void putImageData(script::Value::Buffer& data) {
-    if (data.size() != std::size_t(img()->getRowStrideSize()*img()->height())) {
+  // Returns the rectangle given by the script (the whole image if
+  // it isn't specified), or an empty one if it's outside the image.
+  gfx::Rect getRect(const script::Value& x, const script::Value& y,
+                    const script::Value& w, const script::Value& h) {
+    gfx::Rect bounds = img()->bounds();
+    if (x.type == script::Value::Type::UNDEFINED)
+      return bounds;
+    gfx::Rect rc(int(x), int(y),
+                 (w.type == script::Value::Type::UNDEFINED ? bounds.w: int(w)),
+                 (h.type == script::Value::Type::UNDEFINED ? bounds.h: int(h)));
+    if (!bounds.contains(rc))
+      return gfx::Rect();
+    return rc;
+  }
+
+  void putImageData(script::Value::Buffer& data,
+                    script::Value x, script::Value y,
+                    script::Value w, script::Value h) {
+    gfx::Rect rc = getRect(x, y, w, h);
+    std::size_t rowSize = img()->getRowStrideSize(rc.w);
+    if (rc.isEmpty() || data.size() != rowSize*rc.h) {
       std::cout << "Data size mismatch: " << data.size() << std::endl;
       return;
     }
-    std::memcpy(img()->getPixelAddress(0, 0), data.data(), data.size());
-    ui::Manager::getDefault()->invalidate();
+
+    if (rc == img()->bounds() && rowSize == std::size_t(img()->getRowStrideSize())) {
+      std::memcpy(img()->getPixelAddress(0, 0), data.data(), data.size());
+    }
+    else {
+      const uint8_t* src = data.data();
+      for (int v=0; v<rc.h; ++v, src+=rowSize)
+        std::memcpy(img()->getPixelAddress(rc.x, rc.y+v), src, rowSize);
+    }
+    img()->incrementVersion();
+    notifyModified(rc);
   }
 
-  script::Value getImageData() {
-    return {
-      img()->getPixelAddress(0, 0),
-      std::size_t(img()->getRowStrideSize()*img()->height()),
-      false
-    };
+  script::Value getImageData(script::Value x, script::Value y,
+                             script::Value w, script::Value h) {
+    gfx::Rect rc = getRect(x, y, w, h);
+    if (rc == img()->bounds()) {
+      return {
+        img()->getPixelAddress(0, 0),
+        std::size_t(img()->getRowStrideSize()*img()->height()),
+        false
+      };
+    }
+
+    // Copy the rows of the rectangle in a new buffer owned by the
+    // script engine
+    std::size_t rowSize = img()->getRowStrideSize(rc.w);
+    std::size_t size = rowSize*rc.h;
+    uint8_t* buffer = new uint8_t[std::max<std::size_t>(size, 1)];
+    for (int v=0; v<rc.h; ++v)
+      std::memcpy(buffer+v*rowSize, img()->getPixelAddress(rc.x, rc.y+v), rowSize);
+    return {buffer, size, true};
   }
 
-  std::string getPNGData() {
-    auto w = img()->width();
-    auto h = img()->height();
-    std::shared_ptr<she::Surface> surface{
-      she::instance()->createRgbaSurface(w, h),
-      [](auto s) {s->dispose();}
-    };
-    if (!surface)
-      return "";
+  void fill(int x, int y, int w, int h, int color) {
+    gfx::Rect rc = gfx::Rect(x, y, w, h) & img()->bounds();
+    if (rc.isEmpty())
+      return;
+    doc::fill_rect(img(), rc, color);
+    img()->incrementVersion();
+    notifyModified(rc);
+  }
+
+  void drawImage(script::ScriptObject* other, int x, int y,
+                 script::Value opacity, script::Value blendMode) {
+    doc::Image* src = (other ? other->handle<doc::Object, doc::Image>(): nullptr);
+    if (!src || src->type() != doc::ObjectType::Image) {
+      std::cout << "drawImage: Invalid image" << std::endl;
+      return;
+    }
+
+    // Indexed images are converted with the palette of their sprite
+    const doc::Palette* pal = nullptr;
+    if (doc::Sprite* sprite = findSprite(img()))
+      pal = sprite->palette(0);
+    else if (doc::Sprite* sprite = findSprite(src))
+      pal = sprite->palette(0);
+    if (!pal && src->pixelFormat() == doc::IMAGE_INDEXED &&
+        img()->pixelFormat() != doc::IMAGE_INDEXED) {
+      std::cout << "drawImage: The indexed image isn't in a sprite" << std::endl;
+      return;
+    }
+
+    render::Render().renderImage(
+      img(), src, pal, x, y, render::Zoom(1, 1),
+      (opacity.type == script::Value::Type::UNDEFINED ? 255: int(opacity)),
+      (blendMode.type == script::Value::Type::UNDEFINED ? doc::BlendMode::NORMAL:
+                                                          doc::BlendMode(int(blendMode))));
+    img()->incrementVersion();
+    notifyModified(gfx::Rect(x, y, src->width(), src->height()) & img()->bounds());
+  }
 
-    for (auto y = 0; y < h; ++y) {
-      for (auto x = 0; x < w; ++x) {
-        surface->putPixel(img()->getPixel(x, y), x, y);
+  void replaceColor(int from, int to, script::Value tolerance) {
+    int tol = (tolerance.type == script::Value::Type::UNDEFINED ? 0: int(tolerance));
+    bool modified = false;
+
+    switch (img()->pixelFormat()) {
+      case doc::IMAGE_RGB: {
+        doc::LockImageBits<doc::RgbTraits> bits(img());
+        for (auto& c : bits) {
+          if (std::abs(int(doc::rgba_getr(c)) - int(doc::rgba_getr(from))) <= tol &&
+              std::abs(int(doc::rgba_getg(c)) - int(doc::rgba_getg(from))) <= tol &&
+              std::abs(int(doc::rgba_getb(c)) - int(doc::rgba_getb(from))) <= tol &&
+              std::abs(int(doc::rgba_geta(c)) - int(doc::rgba_geta(from))) <= tol) {
+            c = to;
+            modified = true;
+          }
+        }
+        break;
+      }
+      case doc::IMAGE_GRAYSCALE: {
+        doc::LockImageBits<doc::GrayscaleTraits> bits(img());
+        for (auto& c : bits) {
+          if (std::abs(int(doc::graya_getv(c)) - int(doc::graya_getv(from))) <= tol &&
+              std::abs(int(doc::graya_geta(c)) - int(doc::graya_geta(from))) <= tol) {
+            c = to;
+            modified = true;
+          }
+        }
+        break;
+      }
+      case doc::IMAGE_INDEXED: {
+        doc::LockImageBits<doc::IndexedTraits> bits(img());
+        for (auto& c : bits) {
+          if (std::abs(int(c) - from) <= tol) {
+            c = to;
+            modified = true;
+          }
+        }
+        break;
       }
+      default:
+        return;
+    }
+
+    if (modified) {
+      img()->incrementVersion();
+      notifyModified(img()->bounds());
+    }
+  }
+
+  void applyLut(script::Value::Buffer& lut) {
+    // One table for all the components, or one table per component
+    if (lut.size() != 256 && lut.size() != 1024) {
+      std::cout << "applyLut: The table must have 256 or 1024 entries" << std::endl;
+      return;
     }
+    const uint8_t* r = lut.data();
+    const uint8_t* g = (lut.size() == 1024 ? r+256: r);
+    const uint8_t* b = (lut.size() == 1024 ? r+512: r);
+    const uint8_t* a = (lut.size() == 1024 ? r+768: r);
+
+    switch (img()->pixelFormat()) {
+      case doc::IMAGE_RGB: {
+        doc::LockImageBits<doc::RgbTraits> bits(img());
+        for (auto& c : bits)
+          c = doc::rgba(r[doc::rgba_getr(c)], g[doc::rgba_getg(c)],
+                        b[doc::rgba_getb(c)], a[doc::rgba_geta(c)]);
+        break;
+      }
+      case doc::IMAGE_GRAYSCALE: {
+        doc::LockImageBits<doc::GrayscaleTraits> bits(img());
+        for (auto& c : bits)
+          c = doc::graya(r[doc::graya_getv(c)], a[doc::graya_geta(c)]);
+        break;
+      }
+      case doc::IMAGE_INDEXED: {
+        doc::LockImageBits<doc::IndexedTraits> bits(img());
+        for (auto& c : bits)
+          c = r[c];
+        break;
+      }
+      default:
+        return;
+    }
+    img()->incrementVersion();
+    notifyModified(img()->bounds());
+  }
+
+  void flip(bool vertical) {
+    doc::algorithm::flip_image(img(), img()->bounds(),
+                               (vertical ? doc::algorithm::FlipVertical:
+                                           doc::algorithm::FlipHorizontal));
+    img()->incrementVersion();
+    notifyModified(img()->bounds());
+  }
+
+  void floodFill(int x, int y, int color,
+                 script::Value tolerance, script::Value contiguous) {
+    if (!img()->bounds().contains(gfx::Point(x, y)))
+      return;
+
+    // The scanlines are collected first because the algorithm reads
+    // the image while it's traversed.
+    std::vector<gfx::Rect> hlines;
+    doc::algorithm::floodfill(
+      img(), nullptr, x, y, img()->bounds(),
+      (tolerance.type == script::Value::Type::UNDEFINED ? 0: int(tolerance)),
+      (contiguous.type == script::Value::Type::UNDEFINED ? true: bool(contiguous)),
+      &hlines,
+      [](int x1, int y, int x2, void* data) {
+        static_cast<std::vector<gfx::Rect>*>(data)->push_back(
+          gfx::Rect(x1, y, x2-x1+1, 1));
+      });
+    if (hlines.empty())
+      return;
+
+    gfx::Rect bounds;
+    for (const gfx::Rect& rc : hlines) {
+      doc::draw_hline(img(), rc.x, rc.y, rc.x2()-1, color);
+      bounds |= rc;
+    }
+    img()->incrementVersion();
+    notifyModified(bounds);
+  }
+
+  // Returns the first sprite that uses the given image in a cel.
+  doc::Sprite* findSprite(doc::Image* image) {
+    for (doc::Document* document : app::UIContext::instance()->documents()) {
+      for (const auto& cel : document->sprite()->uniqueCels()) {
+        if (cel->image() == image)
+          return document->sprite();
+      }
+    }
+    return nullptr;
+  }
+
+  // Repaints only the area of the sprite where the image is used
+  // (or the whole UI if the image isn't in a cel, e.g. an ImageView).
+  void notifyModified(const gfx::Rect& rc) {
+    doc::Image* image = img();
+    bool found = false;
+
+    for (doc::Document* document : app::UIContext::instance()->documents()) {
+      doc::Sprite* sprite = document->sprite();
+      for (const auto& cel : sprite->uniqueCels()) {
+        if (cel->image() != image)
+          continue;
+
+        app::AppScripting::notifyPixelsModified(
+          static_cast<app::Document*>(document),
+          gfx::Region(gfx::Rect(rc).offset(cel->position())), cel->frame());
+        found = true;
+      }
+    }
+
+    if (!found)
+      app::AppScripting::redraw();
+  }
+
+  // Palette to encode indexed images
+  const doc::Palette* encodingPalette() {
+    if (img()->pixelFormat() != doc::IMAGE_INDEXED)
+      return nullptr;
+    doc::Sprite* sprite = findSprite(img());
+    return (sprite ? sprite->palette(0): nullptr);
+  }
+
+  std::string getPNGData() {
+    std::vector<uint8_t> png;
+    if (!app::encode_image_as_png(img(), encodingPalette(), -1, png))
+      return "";
 
     std::string encoded;
-    base::encode_base64(she::instance()->encodeSurfaceAsPNG(surface.get()), encoded);
+    base::encode_base64(png, encoded);
     return "data:image/png;base64," + encoded;
   }
 
+  script::Value encode(script::Value format, script::Value level) {
+    const std::string fmt = (format.type == script::Value::Type::UNDEFINED ? "png": format.str());
+    if (fmt == "raw")
+      return getImageData({}, {}, {}, {});
+
+    std::vector<uint8_t> data;
+    bool ok = false;
+    if (fmt == "png")
+      ok = app::encode_image_as_png(img(), encodingPalette(),
+                                    (level.type == script::Value::Type::UNDEFINED ? -1: int(level)),
+                                    data);
+    else if (fmt == "qoi")
+      ok = app::encode_image_as_qoi(img(), encodingPalette(), data);
+    else
+      std::cout << "encode: Unknown format " << fmt << std::endl;
+
+    if (!ok)
+      data.clear();
+
+    // The engine owns the copy of the encoded bytes
+    uint8_t* buffer = new uint8_t[std::max<std::size_t>(data.size(), 1)];
+    if (!data.empty())
+      std::memcpy(buffer, data.data(), data.size());
+    return {buffer, data.size(), true};
+  }
+
   void putPixel(int x, int y, int color) {
-    if (unsigned(x) < unsigned(img()->width()) && unsigned(y) < unsigned(img()->height()))
+    if (unsigned(x) < unsigned(img()->width()) && unsigned(y) < unsigned(img()->height())) {
       img()->putPixel(x, y, color);
+      img()->incrementVersion();
+    }
   }
 
   void clear(int color) {
     img()->clear(color);
+    img()->incrementVersion();
   }
 };
 
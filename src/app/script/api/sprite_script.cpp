@@ -9,6 +9,7 @@
 #include "app/commands/commands.h"
 #include "app/document.h"
 #include "app/document_api.h"
+#include "app/document_undo.h"
 #include "app/file/palette_file.h"
 #include "app/transaction.h"
 #include "app/ui_context.h"
@@ -18,6 +19,7 @@
 #include "doc/mask.h"
 #include "doc/palette.h"
 #include "doc/sprite.h"
+#include "doc/sprite_memory.h"
 #include "script/engine.h"
 #include "script/script_object.h"
 #include <memory>
@@ -59,6 +61,22 @@ public:
       return getEngine()->getScriptObject(sprite()->palette(0));
     }).doc("read-only. Returns the sprite's palette.");
 
+    addProperty("memorySize", [this]{
+      return (double) doc::calculate_sprite_memory(sprite()).total;
+    }).doc("read-only. Returns the bytes used by the cels of the sprite (linked cels are counted one time).");
+
+    addProperty("undoMemorySize", [this]{
+      return (double) doc()->undoHistory()->memSize();
+    }).doc("read-only. Returns the bytes used by the undo history of the sprite.");
+
+    addMethod("layerMemorySize", &SpriteScriptObject::layerMemorySize)
+      .doc("returns the bytes used by the cels of a layer (data shared with previous layers isn't counted).")
+      .docArg("layerNumber", "The number of the layer, starting with zero from the bottom.");
+
+    addMethod("frameMemorySize", &SpriteScriptObject::frameMemorySize)
+      .doc("returns the bytes used by the cels of a frame (data shared with previous frames isn't counted).")
+      .docArg("frameNumber", "The number of the frame, starting with zero.");
+
     addMethod("layer", &SpriteScriptObject::layer)
       .doc("allows you to access a given layer.")
       .docArg("layerNumber", "The number of they layer, starting with zero from the bottom.")
@@ -127,6 +145,16 @@ public:
     return getEngine()->getScriptObject(sprite()->indexToLayer(doc::LayerIndex(i)));
   }
 
+  double layerMemorySize(int i) {
+    doc::SpriteMemory mem = doc::calculate_sprite_memory(sprite());
+    return (i >= 0 && i < int(mem.layers.size()) ? mem.layers[i]: 0);
+  }
+
+  double frameMemorySize(int i) {
+    doc::SpriteMemory mem = doc::calculate_sprite_memory(sprite());
+    return (i >= 0 && i < int(mem.frames.size()) ? mem.frames[i]: 0);
+  }
+
   void resize(int w, int h) {
     app::DocumentApi api(doc(), transaction());
     api.setSpriteSize(sprite(), w, h);
@@ -156,7 +184,9 @@ public:
     auto uiCtx = app::UIContext::instance();
     uiCtx->setActiveDocument(doc());
     auto saveCommand = app::CommandsModule::instance()->getCommandByName(app::CommandId::SaveFile);
-    uiCtx->executeCommand(saveCommand);
+    app::Params params;
+    params.set("background", "false");
+    uiCtx->executeCommand(saveCommand, params);
   }
 
   void saveAs(const std::string& fileName, bool asCopy) {
@@ -167,6 +197,7 @@ public:
     auto commandName = asCopy ? app::CommandId::SaveFileCopyAs : app::CommandId::SaveFile;
     auto saveCommand = app::CommandsModule::instance()->getCommandByName(commandName);
     app::Params params;
+    params.set("background", "false");
     if (asCopy) params.set("filename", fileName.c_str());
     else if(!fileName.empty()) doc()->setFilename(fileName);
     uiCtx->executeCommand(saveCommand, params);
@@ -43,6 +43,7 @@ public:
     addMethod("save", &StorageScriptObject::save);
     addMethod("load", &StorageScriptObject::load);
     addMethod("fetch", &StorageScriptObject::fetch);
+    addMethod("download", &StorageScriptObject::download);
     addMethod("decodeBase64", &StorageScriptObject::decodeBase64);
     makeGlobal("storage");
   }
@@ -127,28 +128,37 @@ public:
     return true;
   }
 
-  void fetch(const std::string& url, const std::string& key, const std::string& domain) {
-    auto fileName = app::AppScripting::getFileName();
-    auto domainKey = domain.empty() ? fileName : domain;
-    storage[domainKey][key] = std::string{};
-    std::cout << "Fetching " << url << " into " << key << std::endl;
-
+  // Reads the optional arguments of fetch()/download() after the
+  // first 3 ones: pairs of header name and value, "POST" is followed
+  // by the body of the request.
+  static const std::string* requestArgs(net::HttpHeaders& headers, std::string& body) {
     auto& args = script::Function::varArgs();
-    std::string body;
-    std::string* post{};
+    const std::string* post{};
     std::size_t argc = args.size();
 
-    net::HttpHeaders headers;
     for (std::size_t i = 3; i + 1 < argc; i += 2) {
       auto key = args[i].str();
-      auto val = args[i + 1].str();;
       if (key == "POST"){
-        body = val;
+        // The body can be a string or binary data (e.g. the result of
+        // image.encode()), it's converted only once
+        body = args[i + 1].str();
         post = &body;
       } else {
-        headers[key] = val;
+        headers[key] = args[i + 1].str();
       }
     }
+    return post;
+  }
+
+  void fetch(const std::string& url, const std::string& key, const std::string& domain) {
+    auto fileName = app::AppScripting::getFileName();
+    auto domainKey = domain.empty() ? fileName : domain;
+    storage[domainKey][key] = std::string{};
+    std::cout << "Fetching " << url << " into " << key << std::endl;
+
+    net::HttpHeaders headers;
+    std::string body;
+    auto post = requestArgs(headers, body);
 
     app::HTTP::fetch(url, post, headers, [=](app::HTTP::Result&& result) {
       storage[domainKey][key] = std::move(result.body);
@@ -156,6 +166,24 @@ public:
       app::AppScripting::raiseEvent(fileName, {key + "_fetch"});
     });
   }
+
+  // Like fetch(), but the response is streamed to the file of the key
+  // (the one used by save()/load()) instead of being kept in memory.
+  void download(const std::string& url, const std::string& key, const std::string& domain) {
+    auto fileName = app::AppScripting::getFileName();
+    auto domainKey = domain.empty() ? fileName : domain;
+    auto path = this->path(key, domain);
+    std::cout << "Downloading " << url << " into " << path << std::endl;
+
+    net::HttpHeaders headers;
+    std::string body;
+    auto post = requestArgs(headers, body);
+
+    app::HTTP::download(url, post, headers, path, [=](app::HTTP::Result&& result) {
+      storage[domainKey][key + "_status"] = result.status;
+      app::AppScripting::raiseEvent(fileName, {key + "_download"});
+    });
+  }
 };
 
 static script::ScriptObject::Regular<StorageScriptObject> reg("StorageScriptObject", {"global"});
@@ -14,11 +14,15 @@
 #include "app/document.h"
 #include "app/script/app_scripting.h"
 #include "app/task_manager.h"
+#include "app/ui_context.h"
 #include "base/file_handle.h"
+#include "base/time.h"
 #include "base/path.h"
 #include "base/range.h"
 #include "base/string.h"
 #include "base/trim_string.h"
+#include "doc/sprite.h"
+#include "gfx/region.h"
 #include "script/engine.h"
 #include "script/engine_delegate.h"
 #include "script/value.h"
@@ -28,6 +32,7 @@
 #include "ui/widget.h"
 #include "ui/manager.h"
 
+#include <algorithm>
 #include <map>
 #include <utility>
 #include <string>
@@ -40,6 +45,21 @@ inject<script::Engine> engine{nullptr};
 std::string previousFileName;
 bool wasInit{};
 
+// Changes notified at the end of the current script batch
+int batchLevel{};
+std::map<std::pair<app::Document*, doc::frame_t>, gfx::Region> batchRegions;
+bool batchRedraw{};
+
+// When the UI called the script for the last time
+base::tick_t sliceStart{};
+
+void closeBatches() {
+  if (batchLevel > 0) {
+    batchLevel = 1;
+    app::AppScripting::endBatch();
+  }
+}
+
 }
 
 namespace app {
@@ -155,6 +175,49 @@ namespace app {
     return true;
   }
 
+  void AppScripting::beginBatch() {
+    ++batchLevel;
+  }
+
+  void AppScripting::endBatch() {
+    if (batchLevel == 0 || --batchLevel > 0)
+      return;
+
+    // The script could have closed some documents
+    auto& documents = UIContext::instance()->documents();
+    for (auto& entry : batchRegions) {
+      Document* document = entry.first.first;
+      if (std::find(documents.begin(), documents.end(), document) != documents.end())
+        document->notifySpritePixelsModified(document->sprite(), entry.second, entry.first.second);
+    }
+    batchRegions.clear();
+
+    if (batchRedraw) {
+      batchRedraw = false;
+      ui::Manager::getDefault()->invalidate();
+    }
+  }
+
+  void AppScripting::notifyPixelsModified(Document* document,
+                                          const gfx::Region& region,
+                                          doc::frame_t frame) {
+    if (batchLevel > 0)
+      batchRegions[std::make_pair(document, frame)] |= region;
+    else
+      document->notifySpritePixelsModified(document->sprite(), region, frame);
+  }
+
+  void AppScripting::redraw() {
+    if (batchLevel > 0)
+      batchRedraw = true;
+    else
+      ui::Manager::getDefault()->invalidate();
+  }
+
+  bool AppScripting::shouldYield(int budget) {
+    return base::current_tick() - sliceStart >= base::tick_t(budget);
+  }
+
   void AppScripting::initEngine() {
     if (!wasInit) {
       wasInit = true;
@@ -176,16 +239,21 @@ namespace app {
 
   void AppScripting::raiseEvent(const std::string& fileName, const std::vector<script::Value> &event) {
     TaskManager::instance().delayed([=]{
+      sliceStart = base::current_tick();
       if ((engine && fileName == previousFileName) || evalFile(fileName)) {
         engine->raiseEvent(event);
       }
+      closeBatches();
     });
   }
 
   bool AppScripting::eval(const std::string& code) {
     initEngine();
     if (engine) {
-      return engine->eval(code);
+      sliceStart = base::current_tick();
+      bool result = engine->eval(code);
+      closeBatches();
+      return result;
     }
     inject<script::EngineDelegate>{}->onConsolePrint("No compatible scripting engine.");
     return false;
@@ -9,6 +9,8 @@
 #pragma once
 
 #include "base/injection.h"
+#include "doc/frame.h"
+#include "gfx/fwd.h"
 
 namespace script {
     class Engine;
@@ -16,6 +18,7 @@ namespace script {
 };
 
 namespace app {
+  class Document;
 
   class AppScripting {
     void initEngine();
@@ -28,6 +31,22 @@ namespace app {
     static bool scanScript(const std::string& fullPath);
     static void clearEventHooks();
 
+    // Between beginBatch() and endBatch() the pixels modified by
+    // scripts are notified to the document (and the UI is redrawn)
+    // only once, when the batch ends. Batches left open by a script
+    // are closed when the script returns.
+    static void beginBatch();
+    static void endBatch();
+    static void notifyPixelsModified(Document* document,
+                                     const gfx::Region& region,
+                                     doc::frame_t frame);
+    static void redraw();
+
+    // Returns true if the script has been running for more than the
+    // given milliseconds since it was called by the UI (so it should
+    // continue in the next app.yield() event).
+    static bool shouldYield(int budget);
+
     bool eval(const std::string& code);
     void printLastResult();
   };
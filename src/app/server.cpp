@@ -0,0 +1,491 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/server.h"
+
+#include "app/context.h"
+#include "app/document.h"
+#include "app/document_exporter.h"
+#include "app/file/file.h"
+#include "app/script/app_scripting.h"
+#include "app/sprite_sheet_type.h"
+#include "app/util/encode_image.h"
+#include "base/base64.h"
+#include "base/file_handle.h"
+#include "base/fs.h"
+#include "base/injection.h"
+#include "base/mem_tags.h"
+#include "base/replace_string.h"
+#include "doc/image.h"
+#include "doc/sprite.h"
+#include "render/render.h"
+#include "script/engine_delegate.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace app {
+
+namespace {
+
+// The output of the scripts executed by the server is returned in
+// the "output" field of the response (stdout is used to write the
+// responses).
+class ServerEngineDelegate : public script::EngineDelegate {
+public:
+  void onConsolePrint(const char* text) override {
+    m_output += text;
+    m_output += "\n";
+  }
+
+  std::string takeOutput() {
+    std::string output;
+    std::swap(output, m_output);
+    return output;
+  }
+
+private:
+  std::string m_output;
+};
+
+static script::EngineDelegate::Singleton<ServerEngineDelegate> reg("server");
+
+void skip_spaces(const std::string& s, std::size_t& i)
+{
+  while (i < s.size() && std::isspace((unsigned char)s[i]))
+    ++i;
+}
+
+bool parse_string(const std::string& s, std::size_t& i, std::string& out)
+{
+  if (i >= s.size() || s[i] != '"')
+    return false;
+
+  out.clear();
+  for (++i; i < s.size(); ) {
+    char c = s[i++];
+    if (c == '"')
+      return true;
+    if (c != '\\') {
+      out.push_back(c);
+      continue;
+    }
+    if (i >= s.size())
+      return false;
+    switch (s[i++]) {
+      case '"': out.push_back('"'); break;
+      case '\\': out.push_back('\\'); break;
+      case '/': out.push_back('/'); break;
+      case 'b': out.push_back('\b'); break;
+      case 'f': out.push_back('\f'); break;
+      case 'n': out.push_back('\n'); break;
+      case 'r': out.push_back('\r'); break;
+      case 't': out.push_back('\t'); break;
+      case 'u': {
+        if (i+4 > s.size())
+          return false;
+        int chr = std::strtol(s.substr(i, 4).c_str(), nullptr, 16);
+        i += 4;
+        // UTF-8 (only the basic multilingual plane)
+        if (chr < 0x80)
+          out.push_back(chr);
+        else if (chr < 0x800) {
+          out.push_back(0xC0 | (chr >> 6));
+          out.push_back(0x80 | (chr & 0x3F));
+        }
+        else {
+          out.push_back(0xE0 | (chr >> 12));
+          out.push_back(0x80 | ((chr >> 6) & 0x3F));
+          out.push_back(0x80 | (chr & 0x3F));
+        }
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return false;
+}
+
+// Parses a JSON object with strings, numbers, booleans or null as
+// values (that's all the server needs).
+bool parse_request(const std::string& line,
+                   std::map<std::string, std::string>& req)
+{
+  std::size_t i = 0;
+  skip_spaces(line, i);
+  if (i >= line.size() || line[i++] != '{')
+    return false;
+
+  skip_spaces(line, i);
+  if (i < line.size() && line[i] == '}')
+    ++i;
+  else {
+    for (;;) {
+      std::string key, value;
+      skip_spaces(line, i);
+      if (!parse_string(line, i, key))
+        return false;
+
+      skip_spaces(line, i);
+      if (i >= line.size() || line[i++] != ':')
+        return false;
+
+      skip_spaces(line, i);
+      if (i < line.size() && line[i] == '"') {
+        if (!parse_string(line, i, value))
+          return false;
+      }
+      else {
+        std::size_t j = i;
+        while (i < line.size() &&
+               line[i] != ',' && line[i] != '}' &&
+               line[i] != '{' && line[i] != '[' &&
+               !std::isspace((unsigned char)line[i]))
+          ++i;
+        value = line.substr(j, i-j);
+        if (value.empty())
+          return false;
+      }
+      req[key] = value;
+
+      skip_spaces(line, i);
+      if (i >= line.size())
+        return false;
+      if (line[i] == ',') {
+        ++i;
+        continue;
+      }
+      if (line[i++] == '}')
+        break;
+      return false;
+    }
+  }
+
+  skip_spaces(line, i);
+  return (i == line.size());
+}
+
+std::string json_string(const std::string& str)
+{
+  std::string res = "\"";
+  for (char c : str) {
+    switch (c) {
+      case '"': res += "\\\""; break;
+      case '\\': res += "\\\\"; break;
+      case '\n': res += "\\n"; break;
+      case '\r': res += "\\r"; break;
+      case '\t': res += "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+          res += buf;
+        }
+        else
+          res.push_back(c);
+        break;
+    }
+  }
+  res += "\"";
+  return res;
+}
+
+bool is_number(const std::string& str)
+{
+  return (!str.empty() &&
+          std::all_of(str.begin(), str.end(),
+                      [](char c){ return std::isdigit((unsigned char)c); }));
+}
+
+std::string get_value(const std::map<std::string, std::string>& req,
+                      const char* key)
+{
+  auto it = req.find(key);
+  return (it != req.end() ? it->second: std::string());
+}
+
+int get_int(const std::map<std::string, std::string>& req,
+            const char* key, int defaultValue)
+{
+  auto it = req.find(key);
+  return (it != req.end() ? std::atoi(it->second.c_str()): defaultValue);
+}
+
+} // anonymous namespace
+
+Server::Server(Context* context, int maxDocuments)
+  : m_context(context)
+  , m_maxDocuments(std::max(maxDocuments, 1))
+  , m_running(false)
+{
+}
+
+Server::~Server()
+{
+  for (const auto& entry : m_documents)
+    closeDocument(entry);
+}
+
+void Server::run(AppScripting& engine, std::istream& in, std::ostream& out)
+{
+  m_running = true;
+
+  std::string line;
+  while (m_running && std::getline(in, line)) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+
+    Request req;
+    std::string fields;
+    bool ok = false;
+    if (!parse_request(line, req))
+      fields = ", \"error\": \"Invalid request\"";
+    else {
+      try {
+        ok = process(req, engine, fields);
+      }
+      catch (const std::exception& e) {
+        fields = ", \"error\": " + json_string(e.what());
+      }
+    }
+
+    const std::string id = get_value(req, "id");
+    out << "{ \"id\": " << (is_number(id) ? id: json_string(id))
+        << ", \"ok\": " << (ok ? "true": "false")
+        << fields << " }" << std::endl;
+  }
+}
+
+bool Server::process(const Request& req, AppScripting& engine, std::string& fields)
+{
+  const std::string cmd = get_value(req, "cmd");
+
+  // {"cmd":"open", "file":...}
+  if (cmd == "open") {
+    EntryPtr entry = getDocument(get_value(req, "file"));
+    const doc::Sprite* sprite = entry->document->sprite();
+    std::ostringstream res;
+    res << ", \"width\": " << sprite->width()
+        << ", \"height\": " << sprite->height()
+        << ", \"frames\": " << sprite->totalFrames();
+    fields = res.str();
+  }
+  // {"cmd":"render", "file":..., "frame":..., "to":..., "scale":..., "output":...}
+  else if (cmd == "render") {
+    EntryPtr entry = getDocument(get_value(req, "file"));
+    const doc::Sprite* sprite = entry->document->sprite();
+    const doc::frame_t from = get_int(req, "frame", 0);
+    const doc::frame_t to = get_int(req, "to", from);
+    const int scale = get_int(req, "scale", 1);
+    const std::string output = get_value(req, "output");
+
+    if (from < 0 || to > sprite->lastFrame() || from > to)
+      throw std::runtime_error("Invalid frame range");
+    if (scale < 1 || scale > 64)
+      throw std::runtime_error("Invalid scale");
+    if (output.empty() && from != to)
+      throw std::runtime_error("An output filename is needed to render several frames");
+
+    std::string files;
+    for (doc::frame_t frame=from; frame<=to; ++frame) {
+      doc::ImageRef image = renderFrame(*entry, frame, scale);
+      std::vector<uint8_t> png;
+      if (!encode_image_as_png(image.get(), nullptr, -1, png))
+        throw std::runtime_error("Cannot encode the frame");
+
+      // Without "output" the PNG is returned in the response
+      if (output.empty()) {
+        std::string encoded;
+        base::encode_base64(png, encoded);
+        fields = ", \"data\": \"data:image/png;base64," + encoded + "\"";
+        break;
+      }
+
+      std::string filename = output;
+      base::replace_string(filename, "{frame}", std::to_string(frame));
+      base::FileHandle f(base::open_file_with_exception(filename, "wb"));
+      if (std::fwrite(png.data(), 1, png.size(), f.get()) != png.size())
+        throw std::runtime_error("Cannot write " + filename);
+
+      files += (files.empty() ? "": ", ") + json_string(filename);
+    }
+    if (!output.empty())
+      fields = ", \"files\": [" + files + "]";
+  }
+  // {"cmd":"sheet", "file":..., "sheet":..., "data":..., "type":...}
+  else if (cmd == "sheet") {
+    EntryPtr entry = getDocument(get_value(req, "file"));
+    const std::string type = get_value(req, "type");
+
+    DocumentExporter exporter;
+    exporter.setTextureFilename(get_value(req, "sheet"));
+    exporter.setDataFilename(get_value(req, "data"));
+    if (type == "horizontal")
+      exporter.setSpriteSheetType(SpriteSheetType::Horizontal);
+    else if (type == "vertical")
+      exporter.setSpriteSheetType(SpriteSheetType::Vertical);
+    else if (type == "rows")
+      exporter.setSpriteSheetType(SpriteSheetType::Rows);
+    else if (type == "columns")
+      exporter.setSpriteSheetType(SpriteSheetType::Columns);
+    else if (type == "packed")
+      exporter.setSpriteSheetType(SpriteSheetType::Packed);
+    else if (type == "maxrects")
+      exporter.setSpriteSheetType(SpriteSheetType::MaxRects);
+    else if (!type.empty())
+      throw std::runtime_error("Invalid sheet type: " + type);
+
+    exporter.addDocument(entry->document);
+    std::unique_ptr<Document> sheet(exporter.exportSheet());
+  }
+  // {"cmd":"script", "code":...}
+  else if (cmd == "script") {
+    const bool ok = engine.eval(get_value(req, "code"));
+    auto delegate = inject<script::EngineDelegate>{}.get<ServerEngineDelegate>();
+    if (delegate)
+      fields = ", \"output\": " + json_string(delegate->takeOutput());
+    return ok;
+  }
+  // {"cmd":"close", "file":...}
+  else if (cmd == "close") {
+    const std::string filename = get_value(req, "file");
+    auto it = std::find_if(
+      m_documents.begin(), m_documents.end(),
+      [&filename](const EntryPtr& entry) {
+        return entry->filename == filename;
+      });
+    if (it == m_documents.end())
+      throw std::runtime_error("The file is not open: " + filename);
+
+    closeDocument(*it);
+    m_documents.erase(it);
+  }
+  // {"cmd":"quit"}
+  else if (cmd == "quit") {
+    m_running = false;
+  }
+  else
+    throw std::runtime_error("Unknown command: " + cmd);
+
+  return true;
+}
+
+Server::EntryPtr Server::getDocument(const std::string& filename)
+{
+  if (filename.empty())
+    throw std::runtime_error("No file was specified");
+
+  const base::Time mtime = base::get_modification_time(filename);
+  const doc::Documents& docs = m_context->documents();
+
+  for (auto it = m_documents.begin(); it != m_documents.end(); ++it) {
+    EntryPtr entry = *it;
+    if (entry->filename != filename)
+      continue;
+
+    m_documents.erase(it);
+
+    // The document can be closed by a script
+    if (std::find(docs.begin(), docs.end(), entry->document) == docs.end())
+      break;
+
+    if (entry->mtime == mtime) {
+      m_documents.push_front(entry);
+      return entry;
+    }
+
+    // The file was modified, load it again
+    closeDocument(entry);
+    break;
+  }
+
+  std::unique_ptr<FileOp> fop(
+    FileOp::createLoadDocumentOperation(
+      m_context, filename.c_str(), FILE_LOAD_SEQUENCE_NONE));
+  if (!fop)
+    throw std::runtime_error("Cannot open " + filename);
+
+  if (!fop->hasError()) {
+    fop->operate();
+    fop->done();
+    fop->postLoad();
+  }
+
+  Document* document = fop->releaseDocument();
+  if (!document)
+    throw std::runtime_error(fop->hasError() ? fop->error():
+                                               "Cannot open " + filename);
+  document->setContext(m_context);
+
+  EntryPtr entry = std::make_shared<Entry>();
+  entry->filename = filename;
+  entry->mtime = mtime;
+  entry->document = document;
+  m_documents.push_front(entry);
+
+  while (m_documents.size() > m_maxDocuments) {
+    closeDocument(m_documents.back());
+    m_documents.pop_back();
+  }
+  return entry;
+}
+
+void Server::closeDocument(const EntryPtr& entry)
+{
+  entry->frames.clear();
+
+  const doc::Documents& docs = m_context->documents();
+  if (std::find(docs.begin(), docs.end(), entry->document) == docs.end())
+    return;
+
+  entry->document->close();
+  delete entry->document;
+  entry->document = nullptr;
+}
+
+// Returns the given frame scaled (RGB), it's rendered again only if
+// the sprite was modified since the last time.
+doc::ImageRef Server::renderFrame(Entry& entry, doc::frame_t frame, int scale)
+{
+  const doc::Sprite* sprite = entry.document->sprite();
+  const render::Zoom zoom(scale, 1);
+
+  render::Render render;
+  render.setParallel(true);
+
+  std::vector<uint32_t> key;
+  render.makeRenderKey(key, sprite, doc::IMAGE_RGB, frame, zoom);
+
+  auto it = entry.frames.find(frame);
+  if (it != entry.frames.end() && it->second.first == key)
+    return it->second.second;
+
+  doc::ImageRef image;
+  {
+    base::mem_tag_scope tag(base::mem_tag::render_cache);
+    image.reset(doc::Image::create(doc::IMAGE_RGB,
+                                   sprite->width()*scale,
+                                   sprite->height()*scale));
+  }
+  render.renderSprite(image.get(), sprite, frame,
+                      gfx::Clip(image->bounds()), zoom);
+
+  entry.frames[frame] = std::make_pair(key, image);
+  return image;
+}
+
+} // namespace app
@@ -0,0 +1,77 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/time.h"
+#include "doc/frame.h"
+#include "doc/image_ref.h"
+
+#include <iosfwd>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace app {
+  class AppScripting;
+  class Context;
+  class Document;
+
+  // Long-lived render server (--server). It reads one JSON request
+  // per line from the input and writes one JSON response per line to
+  // the output, e.g.:
+  //
+  //   {"id":1, "cmd":"open", "file":"hero.ase"}
+  //   {"id":2, "cmd":"render", "file":"hero.ase", "frame":0, "to":3,
+  //    "scale":2, "output":"hero{frame}.png"}
+  //   {"id":3, "cmd":"sheet", "file":"hero.ase", "sheet":"hero.png",
+  //    "data":"hero.json", "type":"packed"}
+  //   {"id":4, "cmd":"script", "code":"..."}
+  //   {"id":5, "cmd":"close", "file":"hero.ase"}
+  //   {"id":6, "cmd":"quit"}
+  //
+  // The documents stay open between requests (the least recently
+  // used ones are closed when there are too many of them) with the
+  // rendered frames, so a pipeline can issue a lot of small renders
+  // without loading the files each time. A document is loaded again
+  // if its file is modified.
+  class Server {
+  public:
+    Server(Context* context, int maxDocuments);
+    ~Server();
+
+    void run(AppScripting& engine, std::istream& in, std::ostream& out);
+
+  private:
+    typedef std::map<std::string, std::string> Request;
+
+    struct Entry {
+      std::string filename;
+      base::Time mtime;
+      Document* document;
+      // Rendered frames with the key of their render::Render
+      std::map<doc::frame_t, std::pair<std::vector<uint32_t>, doc::ImageRef>> frames;
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+
+    bool process(const Request& req, AppScripting& engine, std::string& fields);
+    EntryPtr getDocument(const std::string& filename);
+    void closeDocument(const EntryPtr& entry);
+    doc::ImageRef renderFrame(Entry& entry, doc::frame_t frame, int scale);
+
+    Context* m_context;
+    std::size_t m_maxDocuments;
+    std::list<EntryPtr> m_documents; // Most recently used first
+    bool m_running;
+
+    DISABLE_COPYING(Server);
+  };
+
+} // namespace app
@@ -15,7 +15,8 @@ namespace app {
     Vertical,
     Rows,
     Columns,
-    Packed
+    Packed,
+    MaxRects
   };
 
 } // namespace app
@@ -14,97 +14,254 @@
 #include "app/app.h"
 #include "app/app_render.h"
 #include "app/document.h"
+#include "app/document_thumbnail.h"
 #include "app/file/file.h"
 #include "app/file_system.h"
+#include "app/resource_finder.h"
 #include "base/bind.h"
-#include "base/scoped_lock.h"
-#include "base/thread.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/path.h"
+#include "base/serialization.h"
+#include "base/time.h"
 #include "doc/algorithm/rotate.h"
 #include "doc/conversion_she.h"
 #include "doc/image.h"
-#include "doc/palette.h"
+#include "doc/image_io.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
 #include "she/system.h"
 
-#define MAX_THUMBNAIL_SIZE              128
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <tuple>
+
+// Maximum number of threads generating thumbnails at the same time
+#define MAX_THUMBNAIL_THREADS           4
 
 namespace app {
 
+namespace {
+
+using namespace base::serialization;
+using namespace base::serialization::little_endian;
+
+// Header of the files in the thumbnails cache (change it if the
+// format of the thumbnails changes)
+const char kCacheMagic[] = "LSTHUMB2";
+
+// The oldest thumbnails are removed from the cache when it has more
+// files or bytes than these limits.
+const std::size_t kMaxCacheFiles = 1024;
+const std::size_t kMaxCacheSize = 32*1024*1024;
+
+// Modification time and size of the original file, saved after the
+// magic number to know if the cached thumbnail is still valid.
+struct FileStamp {
+  base::Time time;
+  uint64_t size;
+
+  explicit FileStamp(const std::string& filename)
+    : time(base::get_modification_time(filename))
+    , size(base::file_size(filename)) {
+  }
+
+  explicit FileStamp(std::istream& is) {
+    time.year = read16(is);
+    time.month = read8(is);
+    time.day = read8(is);
+    time.hour = read8(is);
+    time.minute = read8(is);
+    time.second = read8(is);
+    size = read32(is);
+    size |= uint64_t(read32(is)) << 32;
+  }
+
+  void write(std::ostream& os) const {
+    write16(os, time.year);
+    write8(os, time.month);
+    write8(os, time.day);
+    write8(os, time.hour);
+    write8(os, time.minute);
+    write8(os, time.second);
+    write32(os, uint32_t(size));
+    write32(os, uint32_t(size >> 32));
+  }
+
+  bool operator==(const FileStamp& other) const {
+    return (std::tie(time.year, time.month, time.day,
+                     time.hour, time.minute, time.second, size) ==
+            std::tie(other.time.year, other.time.month, other.time.day,
+                     other.time.hour, other.time.minute, other.time.second,
+                     other.size));
+  }
+};
+
+// Returns true if the header of the cached thumbnail is valid and
+// matches the current version of the given file.
+bool read_cache_header(std::istream& is, const std::string& filename)
+{
+  char magic[sizeof(kCacheMagic)-1];
+  if (!is.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic+sizeof(magic), kCacheMagic))
+    return false;
+
+  FileStamp stamp(is);
+  return (is.good() && stamp == FileStamp(filename));
+}
+
+// Returns nullptr if the file isn't in the cache, it's broken, or it
+// was generated for an old version of the file (so the thumbnail is
+// generated again).
+Image* load_cached_thumbnail(const std::string& cacheFilename,
+                             const std::string& filename)
+{
+  if (cacheFilename.empty() || !base::is_file(cacheFilename))
+    return nullptr;
+
+  try {
+    std::ifstream is(FSTREAM_PATH(cacheFilename), std::ios::binary);
+    if (!read_cache_header(is, filename))
+      return nullptr;
+
+    std::unique_ptr<Image> image(read_image(is, false));
+    if (!image ||
+        image->pixelFormat() != IMAGE_RGB ||
+        image->width() > MAX_THUMBNAIL_SIZE ||
+        image->height() > MAX_THUMBNAIL_SIZE)
+      return nullptr;
+
+    return image.release();
+  }
+  catch (const std::exception&) {
+    return nullptr;
+  }
+}
+
+bool has_cached_thumbnail(const std::string& cacheFilename,
+                          const std::string& filename)
+{
+  if (cacheFilename.empty() || !base::is_file(cacheFilename))
+    return false;
+
+  try {
+    std::ifstream is(FSTREAM_PATH(cacheFilename), std::ios::binary);
+    return read_cache_header(is, filename);
+  }
+  catch (const std::exception&) {
+    return false;
+  }
+}
+
+void save_cached_thumbnail(const std::string& cacheFilename,
+                           const std::string& filename,
+                           const Image* thumbnail)
+{
+  if (cacheFilename.empty())
+    return;
+
+  try {
+    std::ofstream os(FSTREAM_PATH(cacheFilename), std::ios::binary);
+    os.write(kCacheMagic, sizeof(kCacheMagic)-1);
+    FileStamp(filename).write(os);
+    write_image(os, thumbnail);
+    if (os.good())
+      return;
+  }
+  catch (const std::exception&) {
+    // Ignore errors, the thumbnail will be generated again
+  }
+
+  try {
+    base::delete_file(cacheFilename);
+  }
+  catch (const std::exception&) {
+    // Ignore
+  }
+}
+
+// Removes the oldest thumbnails of the cache until it's under
+// kMaxCacheFiles and kMaxCacheSize.
+void prune_thumbnails_cache(const std::string& cacheDir)
+{
+  struct Entry {
+    base::Time time;
+    std::size_t size;
+    std::string path;
+  };
+
+  std::vector<Entry> entries;
+  for (const auto& name : base::list_files(cacheDir)) {
+    if (base::get_file_extension(name) != "thumb")
+      continue;
+
+    const std::string path = base::join_path(cacheDir, name);
+    if (base::is_file(path))
+      entries.push_back({ base::get_modification_time(path),
+                          base::file_size(path), path });
+  }
+
+  // Newest thumbnails first
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) {
+              return (std::tie(a.time.year, a.time.month, a.time.day,
+                               a.time.hour, a.time.minute, a.time.second) >
+                      std::tie(b.time.year, b.time.month, b.time.day,
+                               b.time.hour, b.time.minute, b.time.second));
+            });
+
+  std::size_t files = 0;
+  std::size_t bytes = 0;
+  for (const auto& entry : entries) {
+    ++files;
+    bytes += entry.size;
+    if (files <= kMaxCacheFiles && bytes <= kMaxCacheSize)
+      continue;
+
+    try {
+      base::delete_file(entry.path);
+    }
+    catch (const std::exception&) {
+      // Ignore
+    }
+  }
+}
+
+} // anonymous namespace
+
 class ThumbnailGenerator::Worker {
 public:
-  Worker(FileOp* fop, IFileItem* fileitem)
+  Worker(FileOp* fop, IFileItem* fileitem, const std::string& cacheFilename)
     : m_fop(fop)
     , m_fileitem(fileitem)
-    , m_thumbnail(nullptr)
-    , m_palette(nullptr)
-    , m_thread(base::Bind<void>(&Worker::loadBgThread, this)) {
-  }
-
-  ~Worker() {
-    m_fop->stop();
-    m_thread.join();
+    , m_filename(fileitem->fileName())
+    , m_cacheFilename(cacheFilename) {
   }
 
   IFileItem* getFileItem() { return m_fileitem; }
   bool isDone() const { return m_fop->isDone(); }
   double getProgress() const { return m_fop->progress(); }
+  void stop() { m_fop->stop(); }
 
-private:
-  void loadBgThread() {
+  // Called from a thread of the ThumbnailGenerator.
+  void run() {
     try {
-      m_fop->operate(nullptr);
-
-      // Post load
-      m_fop->postLoad();
-
-      // Convert the loaded document into the she::Surface.
-      const Sprite* sprite =
-        (m_fop->document() &&
-         m_fop->document()->sprite() ?
-         m_fop->document()->sprite(): nullptr);
-
-      if (!m_fop->isStop() && sprite) {
-        // The palette to convert the Image
-        m_palette = sprite->palette(frame_t(0))->clone();
-
-        // Render first frame of the sprite in 'image'
-        std::unique_ptr<Image> image(Image::create(
-            IMAGE_RGB, sprite->width(), sprite->height()));
-
-        AppRender render;
-        render.setupBackground(NULL, image->pixelFormat());
-        render.setBgType(render::BgType::CHECKED);
-        render.renderSprite(image.get(), sprite, frame_t(0));
-
-        // Calculate the thumbnail size
-        int thumb_w = MAX_THUMBNAIL_SIZE * image->width() / MAX(image->width(), image->height());
-        int thumb_h = MAX_THUMBNAIL_SIZE * image->height() / MAX(image->width(), image->height());
-        if (MAX(thumb_w, thumb_h) > MAX(image->width(), image->height())) {
-          thumb_w = image->width();
-          thumb_h = image->height();
-        }
-        thumb_w = MID(1, thumb_w, MAX_THUMBNAIL_SIZE);
-        thumb_h = MID(1, thumb_h, MAX_THUMBNAIL_SIZE);
-
-        // Stretch the 'image'
-        m_thumbnail.reset(Image::create(image->pixelFormat(), thumb_w, thumb_h));
-        clear_image(m_thumbnail.get(), 0);
-        algorithm::scale_image(m_thumbnail.get(), image.get(),
-                               0, 0, thumb_w, thumb_h,
-                               0, 0, image->width(), image->height());
+      m_thumbnail.reset(load_cached_thumbnail(m_cacheFilename, m_filename));
+      if (!m_thumbnail) {
+        generateThumbnail();
+        if (m_thumbnail)
+          save_cached_thumbnail(m_cacheFilename, m_filename, m_thumbnail.get());
       }
 
-      // Close file
-      delete m_fop->releaseDocument();
-
       // Set the thumbnail of the file-item.
-      if (m_thumbnail) {
+      if (m_thumbnail && !m_fop->isStop()) {
         she::Surface* thumbnail = she::instance()->createRgbaSurface(
           m_thumbnail->width(),
           m_thumbnail->height());
 
-        convert_image_to_surface(m_thumbnail.get(), m_palette.get(), thumbnail,
+        // The thumbnail is an RGB image, so it doesn't need a palette
+        convert_image_to_surface(m_thumbnail.get(), nullptr, thumbnail,
           0, 0, 0, 0, m_thumbnail->width(), m_thumbnail->height());
 
         m_fileitem->setThumbnail(thumbnail);
@@ -116,11 +273,54 @@ private:
     m_fop->done();
   }
 
+private:
+  void generateThumbnail() {
+    // Just the first frame is loaded (the loading is stopped if
+    // the list of visible files changes)
+    m_fop->operate(nullptr);
+
+    // Post load
+    m_fop->postLoad();
+
+    // Convert the loaded document into the she::Surface.
+    const Sprite* sprite =
+      (m_fop->document() &&
+       m_fop->document()->sprite() ?
+       m_fop->document()->sprite(): nullptr);
+
+    if (!m_fop->isStop() && sprite) {
+      // Render first frame of the sprite in 'image'
+      std::unique_ptr<Image> image(Image::create(
+          IMAGE_RGB, sprite->width(), sprite->height()));
+
+      AppRender render;
+      render.setupBackground(NULL, image->pixelFormat());
+      render.setBgType(render::BgType::CHECKED);
+      render.renderSprite(image.get(), sprite, frame_t(0));
+
+      // Calculate the thumbnail size
+      const gfx::Size thumbSize =
+        DocumentThumbnail::thumbnailSize(image->bounds().size());
+      const int thumb_w = thumbSize.w;
+      const int thumb_h = thumbSize.h;
+
+      // Stretch the 'image'
+      m_thumbnail.reset(Image::create(image->pixelFormat(), thumb_w, thumb_h));
+      clear_image(m_thumbnail.get(), 0);
+      algorithm::scale_image(m_thumbnail.get(), image.get(),
+                             0, 0, thumb_w, thumb_h,
+                             0, 0, image->width(), image->height());
+    }
+
+    // Close file
+    delete m_fop->releaseDocument();
+  }
+
   std::unique_ptr<FileOp> m_fop;
   IFileItem* m_fileitem;
+  std::string m_filename;
+  std::string m_cacheFilename;
   std::unique_ptr<Image> m_thumbnail;
-  std::shared_ptr<Palette> m_palette;
-  base::thread m_thread;
 };
 
 static void delete_singleton(ThumbnailGenerator* singleton)
@@ -138,9 +338,45 @@ ThumbnailGenerator* ThumbnailGenerator::instance()
   return singleton;
 }
 
+ThumbnailGenerator::ThumbnailGenerator()
+  : m_exit(false)
+{
+  try {
+    ResourceFinder rf;
+    rf.includeUserDir(base::join_path("thumbnails", ".").c_str());
+    m_cacheDir = base::get_file_path(rf.getFirstOrCreateDefault());
+
+    if (!base::is_directory(m_cacheDir))
+      base::make_all_directories(m_cacheDir);
+    else
+      prune_thumbnails_cache(m_cacheDir);
+  }
+  catch (const std::exception&) {
+    // Without cache
+    m_cacheDir.clear();
+  }
+}
+
+ThumbnailGenerator::~ThumbnailGenerator()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_workersAccess);
+    m_exit = true;
+    for (Worker* worker : m_workers)
+      worker->stop();
+  }
+  m_workersCV.notify_all();
+
+  for (std::thread& thread : m_threads)
+    thread.join();
+
+  for (Worker* worker : m_workers)
+    delete worker;
+}
+
 ThumbnailGenerator::WorkerStatus ThumbnailGenerator::getWorkerStatus(IFileItem* fileitem, double& progress)
 {
-  base::scoped_lock hold(m_workersAccess);
+  std::lock_guard<std::mutex> lock(m_workersAccess);
 
   for (WorkerList::iterator
          it=m_workers.begin(), end=m_workers.end(); it!=end; ++it) {
@@ -159,7 +395,7 @@ ThumbnailGenerator::WorkerStatus ThumbnailGenerator::getWorkerStatus(IFileItem*
 
 bool ThumbnailGenerator::checkWorkers()
 {
-  base::scoped_lock hold(m_workersAccess);
+  std::lock_guard<std::mutex> lock(m_workersAccess);
   bool doingWork = !m_workers.empty();
 
   for (WorkerList::iterator
@@ -176,15 +412,29 @@ bool ThumbnailGenerator::checkWorkers()
   return doingWork;
 }
 
-void ThumbnailGenerator::addWorkerToGenerateThumbnail(IFileItem* fileitem)
+void ThumbnailGenerator::addWorkerToGenerateThumbnail(IFileItem* fileitem,
+                                                      Priority priority)
 {
-  double progress;
-
   if (fileitem->isBrowsable() ||
-      fileitem->getThumbnail() != NULL ||
-      getWorkerStatus(fileitem, progress) != WithoutWorker)
+      fileitem->getThumbnail() != NULL)
     return;
 
+  {
+    std::lock_guard<std::mutex> lock(m_workersAccess);
+    for (Worker* worker : m_workers) {
+      if (worker->getFileItem() != fileitem)
+        continue;
+
+      // Move the waiting worker to the front of the queue
+      auto it = std::find(m_pending.begin(), m_pending.end(), worker);
+      if (priority == HighPriority && it != m_pending.end()) {
+        m_pending.erase(it);
+        m_pending.push_front(worker);
+      }
+      return;
+    }
+  }
+
   std::unique_ptr<FileOp> fop(
     FileOp::createLoadDocumentOperation(
       nullptr,
@@ -197,34 +447,108 @@ void ThumbnailGenerator::addWorkerToGenerateThumbnail(IFileItem* fileitem)
   if (fop->hasError())
     return;
 
-  Worker* worker = new Worker(fop.release(), fileitem);
-  try {
-    base::scoped_lock hold(m_workersAccess);
-    m_workers.push_back(worker);
+  fop->setMaxPreviewSize(MAX_THUMBNAIL_SIZE);
+
+  std::unique_ptr<Worker> worker(
+    new Worker(fop.release(), fileitem, cacheFilename(fileitem->fileName())));
+  {
+    std::lock_guard<std::mutex> lock(m_workersAccess);
+    m_workers.push_back(worker.get());
+    if (priority == HighPriority)
+      m_pending.push_front(worker.release());
+    else
+      m_pending.push_back(worker.release());
+
+    // Threads are created on demand (up to MAX_THUMBNAIL_THREADS)
+    const int maxThreads =
+      MID(1, int(std::thread::hardware_concurrency())/2, MAX_THUMBNAIL_THREADS);
+    if (int(m_threads.size()) < maxThreads)
+      m_threads.push_back(std::thread(&ThumbnailGenerator::threadLoop, this));
   }
-  catch (...) {
+  m_workersCV.notify_one();
+}
+
+void ThumbnailGenerator::cancelPendingWorkers()
+{
+  std::lock_guard<std::mutex> lock(m_workersAccess);
+  for (Worker* worker : m_pending) {
+    m_workers.erase(std::find(m_workers.begin(), m_workers.end(), worker));
     delete worker;
-    throw;
   }
+  m_pending.clear();
 }
 
 void ThumbnailGenerator::stopAllWorkers()
 {
-  base::thread* ptr = new base::thread(base::Bind<void>(&ThumbnailGenerator::stopAllWorkersBackground, this));
-  m_stopThread.reset(ptr);
+  cancelPendingWorkers();
+
+  // The running workers are deleted in checkWorkers() when their
+  // files are closed.
+  std::lock_guard<std::mutex> lock(m_workersAccess);
+  for (Worker* worker : m_workers)
+    worker->stop();
 }
 
-void ThumbnailGenerator::stopAllWorkersBackground()
+void ThumbnailGenerator::threadLoop()
 {
-  WorkerList workersCopy;
-  {
-    base::scoped_lock hold(m_workersAccess);
-    workersCopy = m_workers;
-    m_workers.clear();
+  std::unique_lock<std::mutex> lock(m_workersAccess);
+  while (true) {
+    m_workersCV.wait(lock, [this]{ return m_exit || !m_pending.empty(); });
+    if (m_exit)
+      break;
+
+    Worker* worker = m_pending.front();
+    m_pending.pop_front();
+
+    lock.unlock();
+    worker->run();
+    lock.lock();
+  }
+}
+
+void ThumbnailGenerator::saveDocumentThumbnail(Document* document)
+{
+  const std::string fn = document->filename();
+  if (!base::is_file(fn))
+    return;
+
+  if (const Image* thumbnail = document->thumbnail()->image())
+    save_cached_thumbnail(cacheFilename(fn), fn, thumbnail);
+}
+
+Image* ThumbnailGenerator::loadCachedThumbnail(const std::string& filename) const
+{
+  if (!base::is_file(filename))
+    return nullptr;
+
+  return load_cached_thumbnail(cacheFilename(filename), filename);
+}
+
+bool ThumbnailGenerator::hasCachedThumbnail(const std::string& filename) const
+{
+  if (!base::is_file(filename))
+    return false;
+
+  return has_cached_thumbnail(cacheFilename(filename), filename);
+}
+
+std::string ThumbnailGenerator::cacheFilename(const std::string& fn) const
+{
+  if (m_cacheDir.empty())
+    return std::string();
+
+  // The key is the path of the file (FNV-1a hash), so a modified file
+  // overwrites its old thumbnail (the header of the cached thumbnail
+  // says if it's still valid, see FileStamp).
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (unsigned char c : fn) {
+    h ^= c;
+    h *= 0x100000001b3ULL;
   }
 
-  for (auto it=workersCopy.begin(), end=workersCopy.end(); it!=end; ++it)
-    delete *it;
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%016llx.thumb", (unsigned long long)h);
+  return base::join_path(m_cacheDir, buf);
 }
 
 } // namespace app
@@ -7,27 +7,40 @@
 
 #pragma once
 
-#include "base/mutex.h"
-
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
-namespace base {
-  class thread;
+namespace doc {
+  class Image;
 }
 
 namespace app {
+  class Document;
   class IFileItem;
 
   class ThumbnailGenerator {
   public:
     enum WorkerStatus { WithoutWorker, WorkingOnThumbnail, ThumbnailIsDone };
 
+    // Items with high priority (e.g. the selected file) are processed
+    // before the ones with low priority (e.g. visible files).
+    enum Priority { LowPriority, HighPriority };
+
+    ThumbnailGenerator();
+    ~ThumbnailGenerator();
+
     static ThumbnailGenerator* instance();
 
     // Generate a thumbnail for the given file-item.  It must be called
-    // from the GUI thread.
-    void addWorkerToGenerateThumbnail(IFileItem* fileitem);
+    // from the GUI thread. The thumbnail is loaded from the cache of
+    // thumbnails if the file wasn't modified since it was generated.
+    void addWorkerToGenerateThumbnail(IFileItem* fileitem,
+                                      Priority priority = HighPriority);
 
     // Returns the status of the worker that is generating the thumbnail
     // for the given file.
@@ -35,23 +48,44 @@ namespace app {
 
     // Checks the status of workers. If there are workers that already
     // done its job, we've to destroy them. This function must be called
-    // from the GUI thread (because a thread is joint to it).
+    // from the GUI thread.
     // Returns true if there are workers generating thumbnails.
     bool checkWorkers();
 
+    // Removes the workers that are waiting for a thread (e.g. because
+    // the visible files have changed).
+    void cancelPendingWorkers();
+
     // Stops all workers generating thumbnails. This is an non-blocking
-    // operation. The cancelation of all workers is done in a background
-    // thread.
+    // operation (the current files are closed by their threads).
     void stopAllWorkers();
 
-  private:
-    void stopAllWorkersBackground();
+    // Saves the thumbnail of the document (see DocumentThumbnail) in
+    // the cache of thumbnails of its file, so the thumbnail of the
+    // just saved file is available without loading it again.
+    void saveDocumentThumbnail(Document* document);
+
+    // Returns the cached thumbnail of the given file (it's never
+    // loaded to generate the thumbnail), or nullptr if the cache
+    // doesn't have a thumbnail for the current version of the file.
+    doc::Image* loadCachedThumbnail(const std::string& filename) const;
+    bool hasCachedThumbnail(const std::string& filename) const;
 
+  private:
     class Worker;
     typedef std::vector<Worker*> WorkerList;
 
+    void threadLoop();
+    std::string cacheFilename(const std::string& filename) const;
+
+    // All workers (waiting, working or done)
     WorkerList m_workers;
-    base::mutex m_workersAccess;
-    std::unique_ptr<base::thread> m_stopThread;
+    // Workers waiting for a thread (the first one is the next one)
+    std::deque<Worker*> m_pending;
+    std::vector<std::thread> m_threads;
+    std::mutex m_workersAccess;
+    std::condition_variable m_workersCV;
+    bool m_exit;
+    std::string m_cacheDir;
   };
 } // namespace app
@@ -48,7 +48,7 @@ ActiveToolManager::ActiveToolManager(ToolBox* toolbox)
   , m_rightClickTool(nullptr)
   , m_rightClickInk(nullptr)
   , m_proximityTool(nullptr)
-  , m_selectedTool(m_toolbox->getToolById(WellKnownTools::Pencil)) // "pencil" is the active tool by default
+  , m_selectedTool(nullptr)     // "pencil" by default (see selectedTool())
 {
 }
 
@@ -64,8 +64,7 @@ Tool* ActiveToolManager::activeTool() const
     return m_proximityTool;
 
   // Active tool should never returns null
-  ASSERT(m_selectedTool);
-  return m_selectedTool;
+  return selectedTool();
 }
 
 std::shared_ptr<Ink> ActiveToolManager::activeInk() const
@@ -120,6 +119,12 @@ Tool* ActiveToolManager::quickTool() const
 
 Tool* ActiveToolManager::selectedTool() const
 {
+  // The default tool is taken when it's needed the first time, so
+  // the tools aren't loaded from gui.xml in batch mode.
+  if (!m_selectedTool)
+    m_selectedTool = m_toolbox->getToolById(WellKnownTools::Pencil);
+
+  ASSERT(m_selectedTool);
   return m_selectedTool;
 }
 
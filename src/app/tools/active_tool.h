@@ -63,7 +63,7 @@ private:
   Tool* m_proximityTool;
 
   // Selected tool in the toolbar/toolbox.
-  Tool* m_selectedTool;
+  mutable Tool* m_selectedTool;
 };
 
 } // namespace tools
@@ -0,0 +1,192 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/tools/cel_tool_loop.h"
+
+#include "app/app.h"
+#include "app/document.h"
+#include "app/tools/ink.h"
+#include "app/tools/stroke_recording.h"
+#include "app/tools/tool.h"
+#include "app/tools/tool_box.h"
+#include "base/exception.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+
+namespace app {
+namespace tools {
+
+namespace {
+
+// Same ink that the ActiveToolManager uses for the tool with the
+// given ink type (the preference of the tool).
+Ink* create_ink(Tool* tool, const RecordedStroke& settings, PixelFormat pixelFormat)
+{
+  std::shared_ptr<Ink> ink = tool->getInk(ToolLoop::Left);
+  if (ink->isPaint() && !ink->isEffect()) {
+    const char* id = WellKnownInks::Paint;
+    switch (settings.inkType) {
+      case InkType::SIMPLE:
+        if ((pixelFormat == IMAGE_RGB && rgba_geta(settings.primaryColor) == 0) ||
+            (pixelFormat == IMAGE_GRAYSCALE && graya_geta(settings.primaryColor) == 0))
+          id = WellKnownInks::PaintCopy;
+        break;
+      case InkType::ALPHA_COMPOSITING: id = WellKnownInks::Paint; break;
+      case InkType::COPY_COLOR: id = WellKnownInks::PaintCopy; break;
+      case InkType::LOCK_ALPHA: id = WellKnownInks::PaintLockAlpha; break;
+      case InkType::SHADING: id = WellKnownInks::Shading; break;
+    }
+    ink = App::instance()->toolBox()->getInkById(id);
+  }
+  return ink->clone();
+}
+
+} // anonymous namespace
+
+CelToolLoop::CelToolLoop(Document* document, Cel* cel,
+                         const RecordedStroke& settings)
+  : m_document(document)
+  , m_cel(cel)
+  , m_tool(App::instance()->toolBox()->getToolById(settings.toolId))
+  , m_brush(new Brush(settings.brushType, settings.brushSize, settings.brushAngle))
+  , m_src(Image::createCopy(cel->image()))
+  , m_zoom(1, 1)
+  , m_fgColor(settings.primaryColor)
+  , m_bgColor(settings.secondaryColor)
+  , m_primaryColor(settings.primaryColor)
+  , m_secondaryColor(settings.secondaryColor)
+  , m_opacity(settings.opacity)
+  , m_tolerance(settings.tolerance)
+  , m_contiguous(settings.contiguous)
+  , m_filled(settings.filled)
+  , m_canceled(false)
+{
+  if (!m_tool)
+    throw base::Exception("Unknown tool '%s'", settings.toolId.c_str());
+
+  m_ink.reset(create_ink(m_tool, settings, cel->image()->pixelFormat()));
+}
+
+CelToolLoop::~CelToolLoop()
+{
+}
+
+Sprite* CelToolLoop::sprite()
+{
+  return m_document->sprite();
+}
+
+Layer* CelToolLoop::getLayer()
+{
+  return m_cel->layer();
+}
+
+frame_t CelToolLoop::getFrame()
+{
+  return m_cel->frame();
+}
+
+Image* CelToolLoop::getDstImage()
+{
+  return m_cel->image();
+}
+
+void CelToolLoop::invalidateDstImage()
+{
+  copy_image(getDstImage(), m_src.get());
+}
+
+void CelToolLoop::invalidateDstImage(const gfx::Region& rgn)
+{
+  for (const auto& rc : rgn)
+    getDstImage()->copy(m_src.get(), gfx::Clip(rc));
+}
+
+void CelToolLoop::copyValidDstToSrcImage(const gfx::Region& rgn)
+{
+  for (const auto& rc : rgn)
+    m_src->copy(getDstImage(), gfx::Clip(rc));
+}
+
+RgbMap* CelToolLoop::getRgbMap()
+{
+  return sprite()->rgbMap(getFrame());
+}
+
+gfx::Point CelToolLoop::getCelOrigin()
+{
+  return m_cel->position();
+}
+
+Controller* CelToolLoop::getController()
+{
+  return m_tool->getController(Left);
+}
+
+PointShape* CelToolLoop::getPointShape()
+{
+  return m_tool->getPointShape(Left);
+}
+
+Intertwine* CelToolLoop::getIntertwine()
+{
+  return m_tool->getIntertwine(Left);
+}
+
+TracePolicy CelToolLoop::getTracePolicy()
+{
+  return m_tool->getTracePolicy(Left);
+}
+
+void replay_strokes_in_document(
+  Document* document,
+  const StrokeRecording& recording,
+  std::vector<std::vector<ToolLoopManager::StepTimes>>& steps)
+{
+  Sprite* sprite = document->sprite();
+
+  for (const auto& stroke : recording.strokes()) {
+    steps.push_back(std::vector<ToolLoopManager::StepTimes>());
+
+    // Strokes without layer (e.g. selection tools) are ignored
+    if (stroke.layerIndex < 0)
+      continue;
+
+    Layer* layer = sprite->indexToLayer(LayerIndex(stroke.layerIndex));
+    if (!layer || !layer->isImage() ||
+        stroke.frame < 0 || stroke.frame >= sprite->totalFrames())
+      throw base::Exception("The stroke was painted in a layer or frame "
+                            "that doesn't exist in this sprite");
+
+    Cel* cel = layer->cel(stroke.frame).get();
+    if (!cel) {
+      ImageRef image(Image::create(sprite->pixelFormat(),
+                                   sprite->width(), sprite->height()));
+      clear_image(image.get(), sprite->transparentColor());
+
+      auto newCel = std::make_shared<Cel>(stroke.frame, image);
+      static_cast<LayerImage*>(layer)->addCel(newCel);
+      cel = newCel.get();
+    }
+
+    CelToolLoop toolLoop(document, cel, stroke);
+    ToolLoopManager manager(&toolLoop);
+    manager.setStepTimes(&steps.back());
+    replay_stroke(stroke, manager);
+    toolLoop.dispose();
+  }
+}
+
+} // namespace tools
+} // namespace app
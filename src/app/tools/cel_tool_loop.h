@@ -0,0 +1,131 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "app/tools/tool_loop.h"
+#include "app/tools/tool_loop_manager.h"
+#include "doc/brush.h"
+#include "doc/mask.h"
+#include "gfx/region.h"
+#include "render/zoom.h"
+
+#include <memory>
+#include <vector>
+
+namespace doc {
+  class Cel;
+}
+
+namespace app {
+namespace tools {
+
+struct RecordedStroke;
+class StrokeRecording;
+
+// Tool loop that draws directly in a cel image (without undo
+// information and without an editor) with the settings of a
+// recorded stroke. It's used to replay strokes through the
+// ToolLoopManager in batch mode and in benchmarks.
+class CelToolLoop : public ToolLoop {
+public:
+  // Throws an exception if the tool of the stroke doesn't exist.
+  CelToolLoop(Document* document, doc::Cel* cel,
+              const RecordedStroke& settings);
+  ~CelToolLoop();
+
+  void dispose() override { }
+  Tool* getTool() override { return m_tool; }
+  doc::Brush* getBrush() override { return m_brush.get(); }
+  Document* getDocument() override { return m_document; }
+  doc::Sprite* sprite() override;
+  doc::Layer* getLayer() override;
+  doc::frame_t getFrame() override;
+  const doc::Image* getSrcImage() override { return m_src.get(); }
+  const doc::Image* getFloodFillSrcImage() override { return m_src.get(); }
+  doc::Image* getDstImage() override;
+  void validateSrcImage(const gfx::Region& rgn) override { }
+  void validateDstImage(const gfx::Region& rgn) override { }
+  void invalidateDstImage() override;
+  void invalidateDstImage(const gfx::Region& rgn) override;
+  void copyValidDstToSrcImage(const gfx::Region& rgn) override;
+  doc::RgbMap* getRgbMap() override;
+  bool useMask() override { return false; }
+  doc::Mask* getMask() override { return &m_mask; }
+  void setMask(doc::Mask* newMask) override { m_mask.copyFrom(newMask); }
+  gfx::Point getMaskOrigin() override { return gfx::Point(0, 0); }
+  const render::Zoom& zoom() override { return m_zoom; }
+  Button getMouseButton() override { return Left; }
+  doc::color_t getFgColor() override { return m_fgColor; }
+  doc::color_t getBgColor() override { return m_bgColor; }
+  doc::color_t getPrimaryColor() override { return m_primaryColor; }
+  void setPrimaryColor(doc::color_t color) override { m_primaryColor = color; }
+  doc::color_t getSecondaryColor() override { return m_secondaryColor; }
+  void setSecondaryColor(doc::color_t color) override { m_secondaryColor = color; }
+  int getOpacity() override { return m_opacity; }
+  int getTolerance() override { return m_tolerance; }
+  bool getContiguous() override { return m_contiguous; }
+  ToolLoopModifiers getModifiers() override { return ToolLoopModifiers::kNone; }
+  filters::TiledMode getTiledMode() override { return filters::TiledMode::NONE; }
+  bool getGridVisible() override { return false; }
+  bool getSnapToGrid() override { return false; }
+  bool getStopAtGrid() override { return false; }
+  gfx::Rect getGridBounds() override { return gfx::Rect(0, 0, 16, 16); }
+  bool getFilled() override { return m_filled; }
+  bool getPreviewFilled() override { return false; }
+  int getSprayWidth() override { return 16; }
+  int getSpraySpeed() override { return 32; }
+  int getBlurRadius() override { return 1; }
+  gfx::Point getCelOrigin() override;
+  void setSpeed(const gfx::Point& speed) override { m_speed = speed; }
+  gfx::Point getSpeed() override { return m_speed; }
+  Ink* getInk() override { return m_ink.get(); }
+  Controller* getController() override;
+  PointShape* getPointShape() override;
+  Intertwine* getIntertwine() override;
+  TracePolicy getTracePolicy() override;
+  Symmetry* getSymmetry() override { return nullptr; }
+  const doc::Remap* getShadingRemap() override { return nullptr; }
+  void cancel() override { m_canceled = true; }
+  bool isCanceled() override { return m_canceled; }
+  gfx::Region& getDirtyArea() override { return m_dirtyArea; }
+  void updateDirtyArea() override { }
+  void updateStatusBar(const char* text) override { }
+
+private:
+  Document* m_document;
+  doc::Cel* m_cel;
+  Tool* m_tool;
+  doc::BrushRef m_brush;
+  std::unique_ptr<doc::Image> m_src;
+  render::Zoom m_zoom;
+  std::unique_ptr<Ink> m_ink;
+  doc::Mask m_mask;
+  doc::color_t m_fgColor;
+  doc::color_t m_bgColor;
+  doc::color_t m_primaryColor;
+  doc::color_t m_secondaryColor;
+  int m_opacity;
+  int m_tolerance;
+  bool m_contiguous;
+  bool m_filled;
+  gfx::Point m_speed;
+  gfx::Region m_dirtyArea;
+  bool m_canceled;
+};
+
+// Replays the strokes in the recorded layer/frame of the given
+// document using CelToolLoops (the cels that don't exist are
+// created) and adds the time of each loop step to "steps". Throws
+// an exception if the layer or frame doesn't exist.
+void replay_strokes_in_document(
+  Document* document,
+  const StrokeRecording& recording,
+  std::vector<std::vector<ToolLoopManager::StepTimes>>& steps);
+
+} // namespace tools
+} // namespace app
@@ -41,6 +41,13 @@ namespace app {
 
       // The input and output strokes are relative to sprite coordinates.
       virtual void getStrokeToInterwine(const Stroke& input, Stroke& output) = 0;
+
+      // Returns the stroke to interwine after "movements" calls to
+      // movement() (by default only the last state of the stroke is
+      // used).
+      virtual void getStrokeToInterwine(const Stroke& input, Stroke& output, int movements) {
+        getStrokeToInterwine(input, output);
+      }
       virtual void getStatusBarText(const Stroke& stroke, std::string& text) = 0;
     };
 
@@ -7,6 +7,7 @@
 
 #include "base/pi.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace app {
@@ -66,13 +67,14 @@ public:
   }
 
   void getStrokeToInterwine(const Stroke& input, Stroke& output) override {
-    if (input.size() == 1) {
-      output.addPoint(input[0]);
-    }
-    else if (input.size() >= 2) {
-      output.addPoint(input[input.size()-2]);
-      output.addPoint(input[input.size()-1]);
-    }
+    getStrokeToInterwine(input, output, 1);
+  }
+
+  // The new points and the previous one (so all the segments since
+  // the last step are joined)
+  void getStrokeToInterwine(const Stroke& input, Stroke& output, int movements) override {
+    for (int i=std::max(0, input.size()-movements-1); i<input.size(); ++i)
+      output.addPoint(input[i]);
   }
 
   void getStatusBarText(const Stroke& stroke, std::string& text) override {
@@ -7,6 +7,7 @@
 
 #include "app/modules/palettes.h"
 #include "doc/blend_funcs.h"
+#include "doc/blend_span.h"
 #include "doc/image_impl.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
@@ -17,12 +18,85 @@
 #include "gfx/hsv.h"
 #include "gfx/rgb.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 namespace app {
 namespace tools {
 
 using namespace gfx;
 using namespace filters;
 
+// Shade of each RGB color of the palette for the whole stroke (so
+// each pixel is just a lookup instead of a Palette::findExactMatch()
+// call). Colors that aren't in the palette are not modified.
+class ShadingTable {
+public:
+  ShadingTable() : m_mask(0) { }
+
+  ShadingTable(const Palette* palette, const Remap* remap, bool left) {
+    const int n = palette->size();
+    std::size_t capacity = 16;
+    while (capacity < 2*std::size_t(n))
+      capacity *= 2;
+    m_entries.resize(capacity);
+    m_mask = capacity-1;
+
+    for (int i=0; i<n; ++i) {
+      const color_t color = palette->getEntry(i);
+
+      // As findExactMatch() the first index of each color is used
+      Entry* entry = &m_entries[find(color)];
+      if (entry->used)
+        continue;
+
+      int j = i;
+      if (remap) {
+        j = (*remap)[j];
+      }
+      else if (left) {
+        if (--j < 0)
+          j = n-1;
+      }
+      else {
+        if (++j >= n)
+          j = 0;
+      }
+
+      entry->color = color;
+      entry->shade = palette->getEntry(j);
+      entry->used = true;
+    }
+  }
+
+  bool isEmpty() const { return m_entries.empty(); }
+
+  color_t operator()(color_t color) const {
+    const Entry& entry = m_entries[find(color)];
+    return (entry.used ? entry.shade: color);
+  }
+
+private:
+  struct Entry {
+    color_t color = 0;
+    color_t shade = 0;
+    bool used = false;
+  };
+
+  // Returns the entry of the given color, or the empty entry where
+  // it should be inserted (linear probing).
+  std::size_t find(color_t color) const {
+    std::size_t i = (color * 2654435761u) & m_mask;
+    while (m_entries[i].used && m_entries[i].color != color)
+      i = (i+1) & m_mask;
+    return i;
+  }
+
+  std::vector<Entry> m_entries;
+  std::size_t m_mask;
+};
+
 namespace {
 
 //////////////////////////////////////////////////////////////////////
@@ -33,8 +107,6 @@ template<typename Derived>
 class InkProcessing {
 public:
   void operator()(int x1, int y, int x2, ToolLoop* loop) {
-    int x;
-
     // Use mask
     if (loop->useMask()) {
       Point maskOrigin(loop->getMaskOrigin());
@@ -50,20 +122,26 @@ public:
         x2 = maskOrigin.x+maskBounds.w-1;
 
       if (Image* bitmap = loop->getMask()->bitmap()) {
-        static_cast<Derived*>(this)->initIterators(loop, x1, y);
-
-        for (x=x1; x<=x2; ++x) {
-          if (bitmap->getPixel(x-maskOrigin.x, y-maskOrigin.y))
-            static_cast<Derived*>(this)->processPixel(x, y);
-
-          static_cast<Derived*>(this)->moveIterators();
-        }
+        // Each run of selected pixels is processed as a scanline
+        doc::for_each_bitmap_run(
+          bitmap, y-maskOrigin.y, x1-maskOrigin.x, x2-maskOrigin.x,
+          [this, y, loop, &maskOrigin](int u1, int u2) {
+            static_cast<Derived*>(this)->processScanline(
+              u1+maskOrigin.x, y, u2+maskOrigin.x, loop);
+          });
         return;
       }
     }
 
+    static_cast<Derived*>(this)->processScanline(x1, y, x2, loop);
+  }
+
+  // Processes all pixels from x1 to x2 (without mask). Inks can
+  // replace this with a faster version which processes the whole
+  // span at once.
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) {
     static_cast<Derived*>(this)->initIterators(loop, x1, y);
-    for (x=x1; x<=x2; ++x) {
+    for (int x=x1; x<=x2; ++x) {
       static_cast<Derived*>(this)->processPixel(x, y);
       static_cast<Derived*>(this)->moveIterators();
     }
@@ -125,6 +203,14 @@ public:
     *SimpleInkProcessing<CopyInkProcessing<ImageTraits>, ImageTraits>::m_dstAddress = m_color;
   }
 
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) {
+    if (x2 < x1)
+      return;
+
+    auto dst = (typename ImageTraits::address_t)loop->getDstImage()->getPixelAddress(x1, y);
+    std::fill_n(dst, x2-x1+1, typename ImageTraits::pixel_t(m_color));
+  }
+
 private:
   color_t m_color;
 };
@@ -282,6 +368,10 @@ public:
     // Do nothing
   }
 
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) {
+    DoubleInkProcessing<MergeInkProcessing<ImageTraits>, ImageTraits>::processScanline(x1, y, x2, loop);
+  }
+
 private:
   color_t m_color;
   int m_opacity;
@@ -292,11 +382,29 @@ void MergeInkProcessing<RgbTraits>::processPixel(int x, int y) {
   *m_dstAddress = rgba_blender_merge(*m_srcAddress, m_color, m_opacity);
 }
 
+template<>
+void MergeInkProcessing<RgbTraits>::processScanline(int x1, int y, int x2, ToolLoop* loop) {
+  if (x2 >= x1)
+    rgba_merge_span(
+      (RgbTraits::address_t)loop->getDstImage()->getPixelAddress(x1, y),
+      (const RgbTraits::pixel_t*)loop->getSrcImage()->getPixelAddress(x1, y),
+      x2-x1+1, m_color, m_opacity);
+}
+
 template<>
 void MergeInkProcessing<GrayscaleTraits>::processPixel(int x, int y) {
   *m_dstAddress = graya_blender_merge(*m_srcAddress, m_color, m_opacity);
 }
 
+template<>
+void MergeInkProcessing<GrayscaleTraits>::processScanline(int x1, int y, int x2, ToolLoop* loop) {
+  if (x2 >= x1)
+    graya_merge_span(
+      (GrayscaleTraits::address_t)loop->getDstImage()->getPixelAddress(x1, y),
+      (const GrayscaleTraits::pixel_t*)loop->getSrcImage()->getPixelAddress(x1, y),
+      x2-x1+1, m_color, m_opacity);
+}
+
 template<>
 class MergeInkProcessing<IndexedTraits> : public DoubleInkProcessing<MergeInkProcessing<IndexedTraits>, IndexedTraits> {
 public:
@@ -308,20 +416,27 @@ public:
     m_color(loop->getPrimaryColor() == m_maskIndex ?
             (m_palette->getEntry(loop->getPrimaryColor()) & rgba_rgb_mask):
             (m_palette->getEntry(loop->getPrimaryColor()))) {
+    std::memset(m_lut, -1, sizeof(m_lut));
   }
 
   void processPixel(int x, int y) {
-    color_t c = *m_srcAddress;
-    if (c == m_maskIndex)
-      c = m_palette->getEntry(c) & rgba_rgb_mask;  // Alpha = 0
-    else
-      c = m_palette->getEntry(c);
-
-    c = rgba_blender_merge(c, m_color, m_opacity);
-    *m_dstAddress = m_rgbmap->mapColor(rgba_getr(c),
-                                       rgba_getg(c),
-                                       rgba_getb(c),
-                                       rgba_geta(c));
+    // The result depends only on the source index, so each index is
+    // merged/mapped only once in the scanline.
+    const int i = *m_srcAddress;
+    if (m_lut[i] < 0) {
+      color_t c;
+      if (i == m_maskIndex)
+        c = m_palette->getEntry(i) & rgba_rgb_mask;  // Alpha = 0
+      else
+        c = m_palette->getEntry(i);
+
+      c = rgba_blender_merge(c, m_color, m_opacity);
+      m_lut[i] = m_rgbmap->mapColor(rgba_getr(c),
+                                    rgba_getg(c),
+                                    rgba_getb(c),
+                                    rgba_geta(c));
+    }
+    *m_dstAddress = m_lut[i];
   }
 
 private:
@@ -330,12 +445,135 @@ private:
   const int m_opacity;
   const int m_maskIndex;
   const color_t m_color;
+  int16_t m_lut[256];                 // Result for each source index (-1 = not calculated yet)
 };
 
 //////////////////////////////////////////////////////////////////////
 // Blur Ink
 //////////////////////////////////////////////////////////////////////
 
+// Sum of the non-transparent pixels of a box
+struct BlurArea {
+  int count, r, g, b, a;
+
+  void reset() { count = r = g = b = a = 0; }
+
+  void add(const BlurArea& o) {
+    count += o.count; r += o.r; g += o.g; b += o.b; a += o.a;
+  }
+
+  void subtract(const BlurArea& o) {
+    count -= o.count; r -= o.r; g -= o.g; b -= o.b; a -= o.a;
+  }
+};
+
+// Box blur of (2*radius+1)^2 pixels. Each scanline is blurred with a
+// sliding window: the sums of the columns are calculated only once,
+// and the window adds the next column and subtracts the first one for
+// each pixel. The Derived class must implement:
+//
+//   void addPixel(BlurArea& area, pixel_t color)
+//   void blendPixel(BlurArea& area)   (writes m_dstAddress)
+//
+template<typename Derived, typename ImageTraits>
+class BoxBlurInkProcessing : public DoubleInkProcessing<Derived, ImageTraits> {
+  typedef DoubleInkProcessing<Derived, ImageTraits> Base;
+  typedef typename ImageTraits::const_address_t const_address_t;
+
+public:
+  BoxBlurInkProcessing(ToolLoop* loop)
+    : m_tiledMode(loop->getTiledMode())
+    , m_srcImage(loop->getSrcImage())
+    , m_radius(MAX(1, loop->getBlurRadius())) {
+  }
+
+  // Used for pixels inside a mask bitmap
+  void processPixel(int x, int y) {
+    BlurArea area;
+    area.reset();
+    for (int v=y-m_radius; v<=y+m_radius; ++v) {
+      const_address_t row = rowAddress(v);
+      for (int u=x-m_radius; u<=x+m_radius; ++u)
+        derived()->addPixel(area, row[mapX(u)]);
+    }
+    derived()->blendPixel(area);
+  }
+
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) {
+    if (x2 < x1)
+      return;
+
+    const int size = 2*m_radius+1;
+    const int n = x2-x1+1;
+
+    m_rows.resize(size);
+    for (int i=0; i<size; ++i)
+      m_rows[i] = rowAddress(y-m_radius+i);
+
+    // Sums of the columns from x1-radius to x2+radius
+    m_columns.resize(n+size-1);
+    for (int i=0; i<n+size-1; ++i) {
+      BlurArea& col = m_columns[i];
+      const int u = mapX(x1-m_radius+i);
+      col.reset();
+      for (int j=0; j<size; ++j)
+        derived()->addPixel(col, m_rows[j][u]);
+    }
+
+    BlurArea window;
+    window.reset();
+    for (int i=0; i<size; ++i)
+      window.add(m_columns[i]);
+
+    Base::initIterators(loop, x1, y);
+    for (int i=0; i<n; ++i) {
+      BlurArea area = window;
+      derived()->blendPixel(area);
+      Base::moveIterators();
+
+      if (i+1 < n) {
+        window.add(m_columns[i+size]);
+        window.subtract(m_columns[i]);
+      }
+    }
+  }
+
+protected:
+  // Number of pixels in the box (transparent ones included)
+  int boxSize() const {
+    return (2*m_radius+1) * (2*m_radius+1);
+  }
+
+private:
+  Derived* derived() { return static_cast<Derived*>(this); }
+
+  // Pixels outside the image are taken from the other side in tiled
+  // mode, or from the nearest edge (as get_neighboring_pixels() does)
+  int mapX(int x) const {
+    return map(x, m_srcImage->width(), int(m_tiledMode) & int(TiledMode::X_AXIS));
+  }
+
+  const_address_t rowAddress(int y) const {
+    y = map(y, m_srcImage->height(), int(m_tiledMode) & int(TiledMode::Y_AXIS));
+    return (const_address_t)m_srcImage->getPixelAddress(0, y);
+  }
+
+  static int map(int i, int size, bool tiled) {
+    if (i >= 0 && i < size)
+      return i;
+    else if (tiled)
+      return (i < 0 ? size - (-(i+1) % size) - 1: i % size);
+    else
+      return MID(0, i, size-1);
+  }
+
+  TiledMode m_tiledMode;
+  const Image* m_srcImage;
+  int m_radius;
+  std::vector<const_address_t> m_rows;
+  std::vector<BlurArea> m_columns;
+};
+
 template<typename ImageTraits>
 class BlurInkProcessing : public DoubleInkProcessing<BlurInkProcessing<ImageTraits>, ImageTraits> {
 public:
@@ -347,27 +585,33 @@ public:
 };
 
 template<>
-class BlurInkProcessing<RgbTraits> : public DoubleInkProcessing<BlurInkProcessing<RgbTraits>, RgbTraits> {
+class BlurInkProcessing<RgbTraits> : public BoxBlurInkProcessing<BlurInkProcessing<RgbTraits>, RgbTraits> {
 public:
   BlurInkProcessing(ToolLoop* loop) :
-    m_opacity(loop->getOpacity()),
-    m_tiledMode(loop->getTiledMode()),
-    m_srcImage(loop->getSrcImage()) {
+    BoxBlurInkProcessing(loop),
+    m_opacity(loop->getOpacity()) {
   }
 
-  void processPixel(int x, int y) {
-    m_area.reset();
-    get_neighboring_pixels<RgbTraits>(m_srcImage, x, y, 3, 3, 1, 1, m_tiledMode, m_area);
+  void addPixel(BlurArea& area, RgbTraits::pixel_t color) {
+    if (rgba_geta(color) != 0) {
+      area.r += rgba_getr(color);
+      area.g += rgba_getg(color);
+      area.b += rgba_getb(color);
+      area.a += rgba_geta(color);
+      ++area.count;
+    }
+  }
 
-    if (m_area.count > 0) {
-      m_area.r /= m_area.count;
-      m_area.g /= m_area.count;
-      m_area.b /= m_area.count;
-      m_area.a /= 9;
+  void blendPixel(BlurArea& area) {
+    if (area.count > 0) {
+      area.r /= area.count;
+      area.g /= area.count;
+      area.b /= area.count;
+      area.a /= boxSize();
 
       *m_dstAddress =
         rgba_blender_normal(*m_srcAddress,
-                            rgba(m_area.r, m_area.g, m_area.b, m_area.a),
+                            rgba(area.r, area.g, area.b, area.a),
                             m_opacity);
     }
     else {
@@ -376,49 +620,33 @@ public:
   }
 
 private:
-  struct GetPixelsDelegate {
-    int count, r, g, b, a;
-
-    void reset() { count = r = g = b = a = 0; }
-
-    void operator()(RgbTraits::pixel_t color)
-    {
-      if (rgba_geta(color) != 0) {
-        r += rgba_getr(color);
-        g += rgba_getg(color);
-        b += rgba_getb(color);
-        a += rgba_geta(color);
-        ++count;
-      }
-    }
-  };
-
   int m_opacity;
-  TiledMode m_tiledMode;
-  const Image* m_srcImage;
-  GetPixelsDelegate m_area;
 };
 
 template<>
-class BlurInkProcessing<GrayscaleTraits> : public DoubleInkProcessing<BlurInkProcessing<GrayscaleTraits>, GrayscaleTraits> {
+class BlurInkProcessing<GrayscaleTraits> : public BoxBlurInkProcessing<BlurInkProcessing<GrayscaleTraits>, GrayscaleTraits> {
 public:
   BlurInkProcessing(ToolLoop* loop) :
-    m_opacity(loop->getOpacity()),
-    m_tiledMode(loop->getTiledMode()),
-    m_srcImage(loop->getSrcImage()) {
+    BoxBlurInkProcessing(loop),
+    m_opacity(loop->getOpacity()) {
   }
 
-  void processPixel(int x, int y) {
-    m_area.reset();
-    get_neighboring_pixels<GrayscaleTraits>(m_srcImage, x, y, 3, 3, 1, 1, m_tiledMode, m_area);
+  void addPixel(BlurArea& area, GrayscaleTraits::pixel_t color) {
+    if (graya_geta(color) > 0) {
+      area.r += graya_getv(color);
+      area.a += graya_geta(color);
+      ++area.count;
+    }
+  }
 
-    if (m_area.count > 0) {
-      m_area.v /= m_area.count;
-      m_area.a /= 9;
+  void blendPixel(BlurArea& area) {
+    if (area.count > 0) {
+      area.r /= area.count;
+      area.a /= boxSize();
 
       *m_dstAddress =
         graya_blender_normal(*m_srcAddress,
-                             graya(m_area.v, m_area.a),
+                             graya(area.r, area.a),
                              m_opacity);
     }
     else {
@@ -427,53 +655,44 @@ public:
   }
 
 private:
-  struct GetPixelsDelegate {
-    int count, v, a;
-
-    void reset() { count = v = a = 0; }
-
-    void operator()(GrayscaleTraits::pixel_t color)
-    {
-      if (graya_geta(color) > 0) {
-        v += graya_getv(color);
-        a += graya_geta(color);
-        ++count;
-      }
-    }
-  };
-
   int m_opacity;
-  TiledMode m_tiledMode;
-  const Image* m_srcImage;
-  GetPixelsDelegate m_area;
 };
 
 template<>
-class BlurInkProcessing<IndexedTraits> : public DoubleInkProcessing<BlurInkProcessing<IndexedTraits>, IndexedTraits> {
+class BlurInkProcessing<IndexedTraits> : public BoxBlurInkProcessing<BlurInkProcessing<IndexedTraits>, IndexedTraits> {
 public:
   BlurInkProcessing(ToolLoop* loop) :
+    BoxBlurInkProcessing(loop),
     m_palette(get_current_palette()),
     m_rgbmap(loop->getRgbMap()),
     m_opacity(loop->getOpacity()),
-    m_tiledMode(loop->getTiledMode()),
-    m_srcImage(loop->getSrcImage()),
-    m_area(get_current_palette(),
-           loop->getLayer()->isBackground() ? -1: loop->sprite()->transparentColor()) {
+    m_maskColor(loop->getLayer()->isBackground() ? -1: loop->sprite()->transparentColor()) {
   }
 
-  void processPixel(int x, int y) {
-    m_area.reset();
-    get_neighboring_pixels<IndexedTraits>(m_srcImage, x, y, 3, 3, 1, 1, m_tiledMode, m_area);
+  void addPixel(BlurArea& area, IndexedTraits::pixel_t color) {
+    if (color == m_maskColor)
+      return;
+
+    uint32_t color32 = m_palette->getEntry(color);
+    if (rgba_geta(color32) > 0) {
+      area.r += rgba_getr(color32);
+      area.g += rgba_getg(color32);
+      area.b += rgba_getb(color32);
+      area.a += rgba_geta(color32);
+      ++area.count;
+    }
+  }
 
-    if (m_area.count > 0) {
-      m_area.r /= m_area.count;
-      m_area.g /= m_area.count;
-      m_area.b /= m_area.count;
-      m_area.a /= 9;
+  void blendPixel(BlurArea& area) {
+    if (area.count > 0) {
+      area.r /= area.count;
+      area.g /= area.count;
+      area.b /= area.count;
+      area.a /= boxSize();
 
       color_t c =
         rgba_blender_normal(m_palette->getEntry(*m_srcAddress),
-                            rgba(m_area.r, m_area.g, m_area.b, m_area.a),
+                            rgba(area.r, area.g, area.b, area.a),
                             m_opacity);
 
       *m_dstAddress = m_rgbmap->mapColor(
@@ -485,39 +704,10 @@ public:
   }
 
 private:
-  struct GetPixelsDelegate {
-    const Palette* pal;
-    int count, r, g, b, a;
-    color_t maskColor;
-
-    GetPixelsDelegate(const Palette* pal,
-                      color_t maskColor)
-      : pal(pal), maskColor(maskColor) { }
-
-    void reset() { count = r = g = b = a = 0; }
-
-    void operator()(IndexedTraits::pixel_t color)
-    {
-      if (color == maskColor)
-        return;
-
-      uint32_t color32 = pal->getEntry(color);
-      if (rgba_geta(color32) > 0) {
-        r += rgba_getr(color32);
-        g += rgba_getg(color32);
-        b += rgba_getb(color32);
-        a += rgba_geta(color32);
-        ++count;
-      }
-    }
-  };
-
   const Palette* m_palette;
   const RgbMap* m_rgbmap;
   int m_opacity;
-  TiledMode m_tiledMode;
-  const Image* m_srcImage;
-  GetPixelsDelegate m_area;
+  color_t m_maskColor;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -713,56 +903,42 @@ public:
 template<>
 class ShadingInkProcessing<RgbTraits> : public DoubleInkProcessing<ShadingInkProcessing<RgbTraits>, RgbTraits> {
 public:
-  ShadingInkProcessing(ToolLoop* loop) :
-    m_palette(get_current_palette()),
-    m_rgbmap(loop->getRgbMap()),
-    m_remap(loop->getShadingRemap()),
-    m_left(loop->getMouseButton() == ToolLoop::Left) {
+  // The ShadingInk creates the table once for the whole stroke, it's
+  // created here if this is used for an isolated scanline.
+  ShadingInkProcessing(ToolLoop* loop, const ShadingTable* table = nullptr) {
+    if (table && !table->isEmpty()) {
+      m_table = table;
+    }
+    else {
+      m_ownTable = ShadingTable(get_current_palette(),
+                                loop->getShadingRemap(),
+                                loop->getMouseButton() == ToolLoop::Left);
+      m_table = &m_ownTable;
+    }
   }
 
   void processPixel(int x, int y) {
-    color_t src = *m_srcAddress;
-
-    // We cannot use the m_rgbmap->mapColor() function because RgbMaps
-    // are created with findBestfit(), and findBestfit() limits the
-    // returned indexes to [0,255] range (it's mainly used for RGBA ->
-    // Indexed image conversion).
-    int i = m_palette->findExactMatch(rgba_getr(src),
-                                      rgba_getg(src),
-                                      rgba_getb(src),
-                                      rgba_geta(src),
-                                      -1);
+    *m_dstAddress = (*m_table)(*m_srcAddress);
+  }
 
-    // If we didn't find the exact match.
-    if (i < 0) {
-      *m_dstAddress = src;
-      return;
-    }
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) {
+    initIterators(loop, x1, y);
 
-    if (m_remap) {
-      i = (*m_remap)[i];
-    }
-    else {
-      if (m_left) {
-        --i;
-        if (i < 0)
-          i = m_palette->size()-1;
-      }
-      else {
-        ++i;
-        if (i >= m_palette->size())
-          i = 0;
+    // Consecutive pixels usually have the same color
+    color_t src = *m_srcAddress;
+    color_t shade = (*m_table)(src);
+    for (int x=x1; x<=x2; ++x, moveIterators()) {
+      if (*m_srcAddress != src) {
+        src = *m_srcAddress;
+        shade = (*m_table)(src);
       }
+      *m_dstAddress = shade;
     }
-
-    *m_dstAddress = m_palette->getEntry(i);
   }
 
 private:
-  const Palette* m_palette;
-  const RgbMap* m_rgbmap;
-  const Remap* m_remap;
-  bool m_left;
+  const ShadingTable* m_table;
+  ShadingTable m_ownTable;
 };
 
 template<>
@@ -111,6 +111,7 @@ public:
 class ShadingInk : public Ink {
 private:
   AlgoHLine m_proc;
+  ShadingTable m_rgbTable;
 
 public:
   ShadingInk() { }
@@ -122,10 +123,23 @@ public:
 
   void prepareInk(ToolLoop* loop) override {
     m_proc = ink_processing[INK_SHADING][MID(0, loop->sprite()->pixelFormat(), 2)];
+
+    if (loop->sprite()->pixelFormat() == IMAGE_RGB) {
+      m_rgbTable = ShadingTable(get_current_palette(),
+                                loop->getShadingRemap(),
+                                loop->getMouseButton() == ToolLoop::Left);
+    }
+    else
+      m_rgbTable = ShadingTable();
   }
 
   void inkHline(int x1, int y, int x2, ToolLoop* loop) override {
-    (*m_proc)(x1, y, x2, loop);
+    if (!m_rgbTable.isEmpty()) {
+      ShadingInkProcessing<RgbTraits> ink(loop, &m_rgbTable);
+      ink(x1, y, x2, loop);
+    }
+    else
+      (*m_proc)(x1, y, x2, loop);
   }
 
 };
@@ -23,8 +23,28 @@ namespace tools {
 using namespace gfx;
 using namespace doc;
 
+static thread_local Stroke* captured_points = nullptr;
+
+// static
+void Intertwine::capturePoints(Stroke* points)
+{
+  captured_points = points;
+}
+
+// static
+void Intertwine::stampPoints(ToolLoop* loop, const Stroke& points)
+{
+  for (const auto& pt : points)
+    doPointshapePoint(pt.x, pt.y, pt.pressure, loop);
+}
+
 void Intertwine::doPointshapePoint(int x, int y, float pressure, ToolLoop* loop)
 {
+  if (captured_points) {
+    captured_points->addPoint({x, y, pressure});
+    return;
+  }
+
   Symmetry* symmetry = loop->getSymmetry();
   if (symmetry) {
     // Convert the point to the sprite position so we can apply the
@@ -26,12 +26,26 @@ namespace app {
 
       virtual ~Intertwine() { }
       virtual bool snapByAngle() { return false; }
+
+      // True if joinStroke() draws only the lines between consecutive
+      // points (so the modified area of a long diagonal stroke can be
+      // much smaller than its bounds).
+      virtual bool joinsWithLines() { return false; }
       virtual void prepareIntertwine() { }
 
       // The given stroke must be relative to the cel origin.
       virtual void joinStroke(ToolLoop* loop, const Stroke& stroke) = 0;
       virtual void fillStroke(ToolLoop* loop, const Stroke& stroke) = 0;
 
+      // While "points" isn't nullptr, the points that
+      // doPointshapePoint() receives in this thread are added to it
+      // (without symmetry) instead of being stamped.
+      static void capturePoints(Stroke* points);
+
+      // Stamps the given points (e.g. the ones captured with
+      // capturePoints()) like doPointshapePoint() does.
+      static void stampPoints(ToolLoop* loop, const Stroke& points);
+
     protected:
       // The given point must be relative to the cel origin.
       static void doPointshapePoint(int x, int y, float pressure, ToolLoop* loop);
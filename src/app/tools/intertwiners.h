@@ -24,6 +24,7 @@ public:
 class IntertwineAsLines : public Intertwine {
 public:
   bool snapByAngle() override { return true; }
+  bool joinsWithLines() override { return true; }
 
   void joinStroke(ToolLoop* loop, const Stroke& stroke) override
   {
@@ -9,9 +9,15 @@
 
 #include "app/tools/point_shape.h"
 #include "app/tools/tool_loop.h"
+#include "base/fast_random.h"
 #include "doc/brush.h"
 #include "doc/compressed_image.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
 namespace app::tools {
 
 class NonePointShape : public PointShape {
@@ -40,48 +46,42 @@ public:
 
 class BrushPointShape : public PointShape {
   doc::Brush* m_brush;
-  doc::CompressedImage m_compressedImage;
   bool m_firstPoint;
-  int m_brushGen;
 
 public:
 
   void preparePointShape(ToolLoop* loop) override {
     m_brush = loop->getBrush();
-    m_brushGen = !m_brush->gen();
     m_firstPoint = true;
   }
 
+  // It can be called from several threads at the same time for
+  // brushes that are not kImageBrushType (see
+  // ToolLoopManager::stampSymmetricStrokes()), so the scaled stamp is
+  // used directly instead of the Brush::scaledBounds().
   void transformPoint(ToolLoop* loop, int x, int y, float pressure) override {
-    auto srcImage = m_brush->image(pressure);
-    if (!srcImage)
+    doc::BrushStampRef stamp = m_brush->stamp(pressure);
+    if (!stamp)
       return; // brush size == 0
 
-    if (m_brushGen != m_brush->gen()) {
-      m_brushGen = m_brush->gen();
-      m_compressedImage.update(srcImage, false);
-    }
-
-    x += m_brush->scaledBounds().x;
-    y += m_brush->scaledBounds().y;
+    x += stamp->bounds().x;
+    y += stamp->bounds().y;
 
-    if (m_firstPoint) {
-      m_firstPoint = false;
-      if (m_brush->type() == kImageBrushType) {
+    if (m_brush->type() == kImageBrushType) {
+      if (m_firstPoint) {
+        m_firstPoint = false;
         if (m_brush->pattern() == BrushPattern::ALIGNED_TO_DST ||
             m_brush->pattern() == BrushPattern::PAINT_BRUSH) {
           m_brush->setPatternOrigin(gfx::Point(x, y));
         }
       }
-    }
-    else {
-      if (m_brush->type() == kImageBrushType &&
-          m_brush->pattern() == BrushPattern::PAINT_BRUSH) {
+      else if (m_brush->pattern() == BrushPattern::PAINT_BRUSH) {
         m_brush->setPatternOrigin(gfx::Point(x, y));
       }
     }
 
-    for (auto& scanline : m_compressedImage) {
+    // Scanlines are cached by the stamp
+    for (auto& scanline : stamp->scanlines()) {
       int u = x+scanline.x;
       doInkHline(u, y+scanline.y, u+scanline.w-1, loop);
     }
@@ -148,6 +148,16 @@ private:
 class SprayPointShape : public PointShape {
   BrushPointShape m_subPointShape;
   float m_pointRemainder = 0;
+  base::fast_random m_random;
+
+  // Horizontal lines of all the dots of one step
+  struct Span {
+    int y, x1, x2;
+    bool operator<(const Span& other) const {
+      return (y < other.y || (y == other.y && x1 < other.x1));
+    }
+  };
+  std::vector<Span> m_spans;
 
 public:
 
@@ -155,6 +165,11 @@ public:
 
   void preparePointShape(ToolLoop* loop) override {
     m_subPointShape.preparePointShape(loop);
+
+    // A different sequence for each tool loop
+    static std::atomic<uint64_t> loops(0);
+    m_random.reseed(uint64_t(std::chrono::steady_clock::now().time_since_epoch().count())
+                    ^ (++loops * 0x9e3779b97f4a7c15ull));
   }
 
   void transformPoint(ToolLoop* loop, int x, int y, float pressure) override {
@@ -174,23 +189,38 @@ public:
     m_pointRemainder = points_to_spray - integral_points;
     ASSERT(m_pointRemainder >= 0 && m_pointRemainder < 1.0f);
 
+    if (integral_points == 0 || spray_width <= 0)
+      return;
+
+    // Image brushes change their pattern origin with each point, so
+    // each dot is painted by the brush point shape.
+    doc::Brush* brush = loop->getBrush();
+    doc::BrushStampRef stamp;
+    const bool batch = (brush->type() != kImageBrushType);
+    if (batch) {
+      stamp = brush->stamp(pressure);
+      if (!stamp)
+        return; // brush size == 0
+      m_spans.clear();
+    }
+
     fixmath::fixed angle, radius;
 
     for (int c=0; c<integral_points; c++) {
-
-#if RAND_MAX <= 0xffff
-      // In Windows, rand() has a RAND_MAX too small
-      angle = fixmath::itofix(rand() * 255 / RAND_MAX);
-      radius = fixmath::itofix(rand() * spray_width / RAND_MAX);
-#else
-      angle = rand();
-      radius = rand() % fixmath::itofix(spray_width);
-#endif
+      angle = m_random.uniform(fixmath::itofix(256));
+      radius = m_random.uniform(fixmath::itofix(spray_width));
 
       int u = fixmath::fixtoi(fixmath::fixmul(radius, fixmath::fixcos(angle)));
       int v = fixmath::fixtoi(fixmath::fixmul(radius, fixmath::fixsin(angle)));
-      m_subPointShape.transformPoint(loop, x+u, y+v, pressure);
+
+      if (batch)
+        addBrushSpans(stamp.get(), x+u, y+v);
+      else
+        m_subPointShape.transformPoint(loop, x+u, y+v, pressure);
     }
+
+    if (batch)
+      inkSpans(loop);
   }
 
   void getModifiedArea(ToolLoop* loop, int x, int y, gfx::Rect& area) override {
@@ -205,6 +235,41 @@ public:
 
     area = area1.createUnion(area2);
   }
+
+private:
+  void addBrushSpans(doc::BrushStamp* stamp, int x, int y) {
+    x += stamp->bounds().x;
+    y += stamp->bounds().y;
+
+    for (auto& scanline : stamp->scanlines()) {
+      int u = x+scanline.x;
+      m_spans.push_back(Span{ y+scanline.y, u, u+scanline.w-1 });
+    }
+  }
+
+  // Paints the spans of all dots sorted by rows, joining the spans
+  // that are next to each other. Overlapping spans are not joined,
+  // so each pixel is painted as many times as dots touch it (as
+  // when each dot was painted separately).
+  void inkSpans(ToolLoop* loop) {
+    if (m_spans.empty())
+      return;
+
+    std::sort(m_spans.begin(), m_spans.end());
+
+    Span cur = m_spans[0];
+    for (std::size_t i=1; i<m_spans.size(); ++i) {
+      const Span& span = m_spans[i];
+      if (span.y == cur.y && span.x1 == cur.x2+1) {
+        cur.x2 = span.x2;
+      }
+      else {
+        doInkHline(cur.x1, cur.y, cur.x2, loop);
+        cur = span;
+      }
+    }
+    doInkHline(cur.x1, cur.y, cur.x2, loop);
+  }
 };
 
 } // namespace app::tools
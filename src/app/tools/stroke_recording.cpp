@@ -0,0 +1,315 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/tools/stroke_recording.h"
+
+#include "app/tools/tool.h"
+#include "app/tools/tool_loop.h"
+#include "base/exception.h"
+#include "doc/brush.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace app {
+namespace tools {
+
+namespace {
+
+// First line of the file (with the version of the format)
+const char* kFileHeader = "libresprite-strokes 1";
+
+StrokeRecording* active_recording = nullptr;
+
+const char* event_type_to_string(StrokeEventType type)
+{
+  switch (type) {
+    case StrokeEventType::Press: return "press";
+    case StrokeEventType::Movement: return "move";
+    case StrokeEventType::Release: return "release";
+  }
+  return "";
+}
+
+bool read_pointer(std::istream& in, Pointer& pointer)
+{
+  int x, y, button;
+  float pressure;
+  if (!(in >> x >> y >> button >> pressure) ||
+      button < Pointer::None || button > Pointer::Right)
+    return false;
+
+  pointer = Pointer(gfx::Point(x, y), Pointer::Button(button), pressure);
+  return true;
+}
+
+} // anonymous namespace
+
+void RecordedStroke::setSettings(ToolLoop* loop)
+{
+  toolId = loop->getTool()->getId();
+
+  doc::Brush* brush = loop->getBrush();
+  // Image brushes cannot be saved, they're replayed as circles
+  brushType = (brush->type() == doc::kImageBrushType ?
+               doc::kCircleBrushType: brush->type());
+  brushSize = brush->size();
+  brushAngle = brush->angle();
+
+  primaryColor = loop->getPrimaryColor();
+  secondaryColor = loop->getSecondaryColor();
+  opacity = loop->getOpacity();
+  tolerance = loop->getTolerance();
+  contiguous = loop->getContiguous();
+  filled = loop->getFilled();
+
+  doc::Layer* layer = loop->getLayer();
+  layerIndex = (layer ? int(loop->sprite()->layerToIndex(layer)): -1);
+  frame = loop->getFrame();
+}
+
+void StrokeRecording::save(const std::string& filename) const
+{
+  std::ofstream f(filename);
+  if (!f)
+    throw base::Exception("Cannot create file %s", filename.c_str());
+
+  f << kFileHeader << "\n";
+  for (const auto& stroke : m_strokes) {
+    f << "stroke\n"
+      << "tool " << stroke.toolId << "\n"
+      << "ink " << int(stroke.inkType) << "\n"
+      << "brush " << int(stroke.brushType) << " "
+      << stroke.brushSize << " " << stroke.brushAngle << "\n"
+      << "colors " << stroke.primaryColor << " " << stroke.secondaryColor << "\n"
+      << "opacity " << stroke.opacity << "\n"
+      << "tolerance " << stroke.tolerance << "\n"
+      << "contiguous " << (stroke.contiguous ? 1: 0) << "\n"
+      << "filled " << (stroke.filled ? 1: 0) << "\n"
+      << "layer " << stroke.layerIndex << "\n"
+      << "frame " << stroke.frame << "\n";
+
+    for (const auto& event : stroke.events) {
+      f << event_type_to_string(event.type) << " " << event.time;
+      if (event.type == StrokeEventType::Movement)
+        f << " " << event.pointers.size();
+      for (const auto& pointer : event.pointers)
+        f << " " << pointer.point().x
+          << " " << pointer.point().y
+          << " " << int(pointer.button())
+          << " " << pointer.pressure();
+      f << "\n";
+    }
+    f << "end\n";
+  }
+
+  if (!f)
+    throw base::Exception("Error writing file %s", filename.c_str());
+}
+
+void StrokeRecording::load(const std::string& filename)
+{
+  std::ifstream f(filename);
+  if (!f)
+    throw base::Exception("Cannot open file %s", filename.c_str());
+
+  std::string line;
+  if (!std::getline(f, line) || line != kFileHeader)
+    throw base::Exception("%s is not a strokes file", filename.c_str());
+
+  std::vector<RecordedStroke> strokes;
+  RecordedStroke* stroke = nullptr;
+  int lineNum = 1;
+
+  while (std::getline(f, line)) {
+    ++lineNum;
+    std::istringstream in(line);
+    std::string key;
+    if (!(in >> key))
+      continue;
+
+    bool ok = true;
+    if (key == "stroke") {
+      strokes.push_back(RecordedStroke());
+      stroke = &strokes.back();
+    }
+    else if (!stroke) {
+      ok = false;
+    }
+    else if (key == "end") {
+      ok = (!stroke->toolId.empty() && !stroke->events.empty());
+      stroke = nullptr;
+    }
+    else if (key == "tool") {
+      ok = bool(in >> stroke->toolId);
+    }
+    else if (key == "ink") {
+      int ink;
+      ok = bool(in >> ink);
+      stroke->inkType = InkType(ink);
+    }
+    else if (key == "brush") {
+      int type;
+      ok = (in >> type >> stroke->brushSize >> stroke->brushAngle &&
+            type >= doc::kFirstBrushType && type <= doc::kLastBrushType);
+      stroke->brushType = doc::BrushType(type);
+    }
+    else if (key == "colors") {
+      ok = bool(in >> stroke->primaryColor >> stroke->secondaryColor);
+    }
+    else if (key == "opacity") {
+      ok = bool(in >> stroke->opacity);
+    }
+    else if (key == "tolerance") {
+      ok = bool(in >> stroke->tolerance);
+    }
+    else if (key == "contiguous") {
+      ok = bool(in >> stroke->contiguous);
+    }
+    else if (key == "filled") {
+      ok = bool(in >> stroke->filled);
+    }
+    else if (key == "layer") {
+      ok = bool(in >> stroke->layerIndex);
+    }
+    else if (key == "frame") {
+      ok = bool(in >> stroke->frame);
+    }
+    else {
+      RecordedStroke::Event event;
+      int count = 1;
+      if (key == "press")
+        event.type = StrokeEventType::Press;
+      else if (key == "release")
+        event.type = StrokeEventType::Release;
+      else if (key == "move") {
+        event.type = StrokeEventType::Movement;
+        count = 0;
+      }
+      else
+        ok = false;
+
+      if (ok)
+        ok = bool(in >> event.time);
+      if (ok && event.type == StrokeEventType::Movement)
+        ok = (in >> count && count > 0);
+
+      for (int i=0; ok && i<count; ++i) {
+        Pointer pointer;
+        ok = read_pointer(in, pointer);
+        event.pointers.push_back(pointer);
+      }
+
+      // The first event must be a button press
+      if (ok && stroke->events.empty())
+        ok = (event.type == StrokeEventType::Press);
+      if (ok)
+        stroke->events.push_back(event);
+    }
+
+    if (!ok)
+      throw base::Exception("Invalid line %d in %s", lineNum, filename.c_str());
+  }
+
+  if (stroke)
+    throw base::Exception("Unexpected end of file %s", filename.c_str());
+
+  m_strokes = std::move(strokes);
+}
+
+// static
+StrokeRecording* StrokeRecording::active()
+{
+  return active_recording;
+}
+
+// static
+void StrokeRecording::setActive(StrokeRecording* recording)
+{
+  active_recording = recording;
+}
+
+void replay_stroke(const RecordedStroke& stroke, ToolLoopManager& manager)
+{
+  if (stroke.events.empty())
+    return;
+
+  manager.prepareLoop(stroke.events.front().pointers.front());
+
+  for (const auto& event : stroke.events) {
+    switch (event.type) {
+      case StrokeEventType::Press:
+        manager.pressButton(event.pointers.front());
+        break;
+      case StrokeEventType::Movement:
+        manager.movement(event.pointers);
+        break;
+      case StrokeEventType::Release:
+        // The loop finishes when the controller doesn't need more
+        // points (e.g. the polygon tool needs several clicks)
+        if (!manager.releaseButton(event.pointers.front()))
+          return;
+        break;
+    }
+    if (manager.isCanceled())
+      return;
+  }
+}
+
+void write_replay_report(
+  std::ostream& out,
+  const StrokeRecording& recording,
+  const std::vector<std::vector<ToolLoopManager::StepTimes>>& steps)
+{
+  out << "{\n  \"strokes\": [";
+
+  const auto& strokes = recording.strokes();
+  for (std::size_t i=0; i<strokes.size() && i<steps.size(); ++i) {
+    ToolLoopManager::StepTimes sum;
+    double maxStep = 0.0;
+    for (const auto& t : steps[i]) {
+      sum.dirtyArea += t.dirtyArea;
+      sum.intertwine += t.intertwine;
+      sum.ink += t.ink;
+      sum.repaint += t.repaint;
+      maxStep = std::max(maxStep, t.dirtyArea + t.intertwine + t.ink + t.repaint);
+    }
+
+    out << (i > 0 ? ",\n    ": "\n    ")
+        << "{ \"tool\": \"" << strokes[i].toolId << "\""
+        << ", \"events\": " << strokes[i].events.size()
+        << ", \"steps\": " << steps[i].size()
+        << ", \"total_ms\": " << (sum.dirtyArea + sum.intertwine + sum.ink + sum.repaint)
+        << ", \"max_step_ms\": " << maxStep
+        << ", \"intertwine_ms\": " << sum.intertwine
+        << ", \"ink_ms\": " << sum.ink
+        << ", \"dirty_area_ms\": " << sum.dirtyArea
+        << ", \"repaint_ms\": " << sum.repaint
+        << ",\n      \"step_times\": [";
+    // Each step as [intertwine, ink, dirty area, repaint]
+    for (std::size_t j=0; j<steps[i].size(); ++j) {
+      const auto& t = steps[i][j];
+      out << (j > 0 ? ", ": "")
+          << "[" << t.intertwine << ", " << t.ink
+          << ", " << t.dirtyArea << ", " << t.repaint << "]";
+    }
+    out << "] }";
+  }
+
+  out << "\n  ]\n}" << std::endl;
+}
+
+} // namespace tools
+} // namespace app
@@ -0,0 +1,94 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "app/tools/ink_type.h"
+#include "app/tools/pointer.h"
+#include "app/tools/tool_loop_manager.h"
+#include "doc/brush_type.h"
+#include "doc/color.h"
+#include "doc/frame.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace app {
+namespace tools {
+
+class ToolLoop;
+
+enum class StrokeEventType { Press, Movement, Release };
+
+// Pointer events received by a ToolLoopManager (with their time)
+// and the settings of the tool loop, so the same stroke can be
+// replayed later (e.g. to reproduce a slow brush).
+struct RecordedStroke {
+  struct Event {
+    StrokeEventType type;
+    double time;                   // Milliseconds since the first event
+    std::vector<Pointer> pointers; // Only one pointer for Press/Release
+  };
+
+  std::string toolId;
+  InkType inkType = InkType::DEFAULT;
+  doc::BrushType brushType = doc::kCircleBrushType;
+  int brushSize = 1;
+  int brushAngle = 0;
+  // Colors in the pixel format of the sprite
+  doc::color_t primaryColor = 0;
+  doc::color_t secondaryColor = 0;
+  int opacity = 255;
+  int tolerance = 0;
+  bool contiguous = true;
+  bool filled = false;
+  // Where the stroke was painted
+  int layerIndex = 0;
+  doc::frame_t frame = 0;
+  std::vector<Event> events;
+
+  // Copies the settings from the given tool loop (the ink type is
+  // a preference of the tool, it's not available in the loop).
+  void setSettings(ToolLoop* loop);
+};
+
+// A list of recorded strokes saved in a text file (one event per
+// line).
+class StrokeRecording {
+public:
+  std::vector<RecordedStroke>& strokes() { return m_strokes; }
+  const std::vector<RecordedStroke>& strokes() const { return m_strokes; }
+  bool empty() const { return m_strokes.empty(); }
+
+  // Both throw a base::Exception in case of error.
+  void save(const std::string& filename) const;
+  void load(const std::string& filename);
+
+  // Recording where the DrawingState adds the strokes painted by the
+  // user, or nullptr if nothing is being recorded.
+  static StrokeRecording* active();
+  static void setActive(StrokeRecording* recording);
+
+private:
+  std::vector<RecordedStroke> m_strokes;
+};
+
+// Sends all the events of the stroke to the given manager (as fast
+// as possible, the time of the events is ignored so the replay is
+// deterministic).
+void replay_stroke(const RecordedStroke& stroke, ToolLoopManager& manager);
+
+// Writes in JSON format the time spent in each loop step of the
+// replayed strokes ("steps" has one item for each recorded stroke).
+void write_replay_report(
+  std::ostream& out,
+  const StrokeRecording& recording,
+  const std::vector<std::vector<ToolLoopManager::StepTimes>>& steps);
+
+} // namespace tools
+} // namespace app
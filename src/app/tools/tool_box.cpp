@@ -81,6 +81,7 @@ const char* WellKnownPointShapes::FloodFill = "floodfill";
 const char* WellKnownPointShapes::Spray = "spray";
 
 ToolBox::ToolBox()
+  : m_toolsLoaded(false)
 {
   LOG("Toolbox module: installing\n");
 
@@ -122,8 +123,6 @@ ToolBox::ToolBox()
   m_intertwiners[WellKnownIntertwiners::AsBezier] = new IntertwineAsBezier();
   m_intertwiners[WellKnownIntertwiners::AsPixelPerfect] = new IntertwineAsPixelPerfect();
 
-  loadTools();
-
   LOG("Toolbox module: installed\n");
 }
 
@@ -175,9 +174,10 @@ PointShape* ToolBox::getPointShapeById(const std::string& id)
   return m_pointshapers[id];
 }
 
-void ToolBox::loadTools()
+void ToolBox::loadToolsFromGuiXml()
 {
   LOG("Loading LibreSprite tools\n");
+  m_toolsLoaded = true;
 
   XmlDocumentRef doc(GuiXml::instance()->doc());
   tinyxml2::XMLHandle handle(doc.get());
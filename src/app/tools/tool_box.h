@@ -79,22 +79,28 @@ namespace app {
       ToolBox();
       ~ToolBox();
 
-      ToolGroupList::iterator begin_group() { return m_groups.begin(); }
-      ToolGroupList::iterator end_group() { return m_groups.end(); }
+      // The tools are loaded from gui.xml the first time they are
+      // needed (batch mode doesn't need them in most cases).
+      ToolGroupList::iterator begin_group() { loadTools(); return m_groups.begin(); }
+      ToolGroupList::iterator end_group() { loadTools(); return m_groups.end(); }
 
-      ToolIterator begin() { return m_tools.begin(); }
-      ToolIterator end() { return m_tools.end(); }
-      ToolConstIterator begin() const { return m_tools.begin(); }
-      ToolConstIterator end() const { return m_tools.end(); }
+      ToolIterator begin() { loadTools(); return m_tools.begin(); }
+      ToolIterator end() { loadTools(); return m_tools.end(); }
+      ToolConstIterator begin() const { loadTools(); return m_tools.begin(); }
+      ToolConstIterator end() const { loadTools(); return m_tools.end(); }
 
       Tool* getToolById(const std::string& id);
       std::shared_ptr<Ink> getInkById(const std::string& id);
       Intertwine* getIntertwinerById(const std::string& id);
       PointShape* getPointShapeById(const std::string& id);
-      int getGroupsCount() const { return m_groups.size(); }
+      int getGroupsCount() const { loadTools(); return m_groups.size(); }
 
     private:
-      void loadTools();
+      void loadTools() const {
+        if (!m_toolsLoaded)
+          const_cast<ToolBox*>(this)->loadToolsFromGuiXml();
+      }
+      void loadToolsFromGuiXml();
       void loadToolProperties(tinyxml2::XMLElement* xmlTool, Tool* tool, int button, const std::string& suffix);
 
       std::map<std::string, std::shared_ptr<Ink>> m_inks;
@@ -104,6 +110,7 @@ namespace app {
 
       ToolGroupList m_groups;
       ToolList m_tools;
+      bool m_toolsLoaded;
     };
 
   } // namespace tools
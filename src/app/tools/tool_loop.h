@@ -13,6 +13,7 @@
 #include "doc/frame.h"
 #include "filters/tiled_mode.h"
 #include "gfx/point.h"
+#include "gfx/rect.h"
 
 namespace gfx {
   class Region;
@@ -189,6 +190,9 @@ namespace app {
       virtual int getSprayWidth() = 0;
       virtual int getSpraySpeed() = 0;
 
+      // Radius of the box used by the blur ink (1 = 3x3 pixels)
+      virtual int getBlurRadius() = 0;
+
       // X,Y origin of the cel where we are drawing
       virtual gfx::Point getCelOrigin() = 0;
 
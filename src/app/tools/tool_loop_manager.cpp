@@ -17,14 +17,23 @@
 #include "app/tools/ink.h"
 #include "app/tools/intertwine.h"
 #include "app/tools/point_shape.h"
+#include "app/tools/stroke_recording.h"
 #include "app/tools/symmetry.h"
 #include "app/tools/tool_loop.h"
+#include "app/tools/trace_policy.h"
+#include "base/thread_pool.h"
+#include "base/trace_span.h"
+#include "doc/brush.h"
 #include "doc/image.h"
 #include "doc/primitives.h"
+#include "doc/rgbmap.h"
 #include "doc/sprite.h"
 #include "gfx/region.h"
 
+#include <algorithm>
 #include <climits>
+#include <cstdlib>
+#include <cmath>
 
 namespace app {
 namespace tools {
@@ -33,9 +42,30 @@ using namespace gfx;
 using namespace doc;
 using namespace filters;
 
+// Maximum length (in sprite pixels) of the predicted segment
+static const int kMaxPredictionDistance = 8;
+
+// Size of the tiles used to calculate the dirty area of long lines
+static const int kDirtyTileSize = 32;
+
+// Minimum number of stamped pixels (points x brush area) to stamp
+// the symmetric strokes in several threads
+static const int kMinParallelStampPixels = 16*1024;
+
+static ToolLoopManager::StepStats step_stats;
+
+static double elapsed_ms(const std::chrono::steady_clock::time_point& t0)
+{
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - t0).count();
+}
+
 ToolLoopManager::ToolLoopManager(ToolLoop* toolLoop)
   : m_toolLoop(toolLoop)
   , m_dirtyArea(toolLoop->getDirtyArea())
+  , m_predictionEnabled(false)
+  , m_recordedStroke(nullptr)
+  , m_stepTimes(nullptr)
 {
 }
 
@@ -48,6 +78,13 @@ bool ToolLoopManager::isCanceled() const
  return m_toolLoop->isCanceled();
 }
 
+void ToolLoopManager::setRecordedStroke(RecordedStroke* stroke)
+{
+  m_recordedStroke = stroke;
+  if (m_recordedStroke)
+    m_recordedStroke->setSettings(m_toolLoop);
+}
+
 void ToolLoopManager::prepareLoop(const Pointer& pointer)
 {
   // Start with no points at all
@@ -71,10 +108,13 @@ void ToolLoopManager::notifyToolLoopModifiersChange()
 void ToolLoopManager::pressButton(const Pointer& pointer)
 {
   m_lastPointer = pointer;
+  recordEvent(StrokeEventType::Press, std::vector<Pointer>(1, pointer));
 
   if (isCanceled())
     return;
 
+  rollbackPrediction();
+
   // If the user pressed the other mouse button...
   if ((m_toolLoop->getMouseButton() == ToolLoop::Left && pointer.button() == Pointer::Right) ||
       (m_toolLoop->getMouseButton() == ToolLoop::Right && pointer.button() == Pointer::Left)) {
@@ -101,10 +141,13 @@ void ToolLoopManager::pressButton(const Pointer& pointer)
 bool ToolLoopManager::releaseButton(const Pointer& pointer)
 {
   m_lastPointer = pointer;
+  recordEvent(StrokeEventType::Release, std::vector<Pointer>(1, pointer));
 
   if (isCanceled())
     return false;
 
+  rollbackPrediction();
+
   Point spritePoint = pointer.point();
   snapToGrid(spritePoint);
 
@@ -121,34 +164,56 @@ bool ToolLoopManager::releaseButton(const Pointer& pointer)
 
 void ToolLoopManager::movement(const Pointer& pointer)
 {
-  m_lastPointer = pointer;
+  movement(std::vector<Pointer>(1, pointer));
+}
+
+void ToolLoopManager::movement(const std::vector<Pointer>& pointers)
+{
+  if (pointers.empty())
+    return;
+
+  m_lastPointer = pointers.back();
+  recordEvent(StrokeEventType::Movement, pointers);
 
   if (isCanceled())
     return;
 
-  // Convert the screen point to a sprite point
-  Point spritePoint = pointer.point();
-  // Calculate the speed (new sprite point - old sprite point)
-  m_toolLoop->setSpeed(spritePoint - m_oldPoint);
-  m_oldPoint = spritePoint;
-  snapToGrid(spritePoint);
+  rollbackPrediction();
+
+  for (const Pointer& pointer : pointers) {
+    // Convert the screen point to a sprite point
+    Point spritePoint = pointer.point();
+    // Calculate the speed (new sprite point - old sprite point)
+    m_toolLoop->setSpeed(spritePoint - m_oldPoint);
+    m_oldPoint = spritePoint;
+    snapToGrid(spritePoint);
 
-  m_toolLoop->getController()->movement(m_toolLoop, m_stroke, spritePoint, pointer.pressure());
+    m_toolLoop->getController()->movement(m_toolLoop, m_stroke, spritePoint, pointer.pressure());
+  }
 
   std::string statusText;
   m_toolLoop->getController()->getStatusBarText(m_stroke, statusText);
   m_toolLoop->updateStatusBar(statusText.c_str());
 
-  doLoopStep(false);
+  doLoopStep(false, int(pointers.size()));
+
+  if (canPredict())
+    drawPrediction(int(pointers.size()));
 }
 
-void ToolLoopManager::doLoopStep(bool last_step)
+void ToolLoopManager::doLoopStep(bool last_step, int movements)
 {
+  TRACE_SPAN("ToolLoopManager::doLoopStep");
+
+  StepTimes times;
+  const auto stepStart = std::chrono::steady_clock::now();
+  auto t0 = stepStart;
+
   // Original set of points to interwine (original user stroke,
   // relative to sprite origin).
   Stroke main_stroke;
   if (!last_step)
-    m_toolLoop->getController()->getStrokeToInterwine(m_stroke, main_stroke);
+    m_toolLoop->getController()->getStrokeToInterwine(m_stroke, main_stroke, movements);
   else
     main_stroke = m_stroke;
 
@@ -188,8 +253,17 @@ void ToolLoopManager::doLoopStep(bool last_step)
 
   m_toolLoop->validateDstImage(m_dirtyArea);
 
+  if (m_stepTimes)
+    times.dirtyArea = elapsed_ms(t0);
+
   // Join or fill user points
-  if (!m_toolLoop->getFilled() || (!last_step && !m_toolLoop->getPreviewFilled()))
+  const bool fill = (m_toolLoop->getFilled() &&
+                     (last_step || m_toolLoop->getPreviewFilled()));
+  if (m_stepTimes)
+    profileStroke(main_stroke, fill, times);
+  else if (canStampInParallel(strokes))
+    stampSymmetricStrokes(main_stroke, fill);
+  else if (!fill)
     m_toolLoop->getIntertwine()->joinStroke(m_toolLoop, main_stroke);
   else
     m_toolLoop->getIntertwine()->fillStroke(m_toolLoop, main_stroke);
@@ -200,8 +274,272 @@ void ToolLoopManager::doLoopStep(bool last_step)
     m_toolLoop->copyValidDstToSrcImage(m_dirtyArea);
   }
 
-  if (!m_dirtyArea.isEmpty())
+  if (!m_dirtyArea.isEmpty()) {
+    t0 = std::chrono::steady_clock::now();
     m_toolLoop->updateDirtyArea();
+    times.repaint = elapsed_ms(t0);
+  }
+
+  if (m_stepTimes)
+    m_stepTimes->push_back(times);
+
+  const double stepTime = elapsed_ms(stepStart);
+  step_stats.stepTime = (step_stats.stepTime == 0.0 ? stepTime:
+                         (3.0*step_stats.stepTime + stepTime) / 4.0);
+  step_stats.dirtyArea = 0;
+  for (const auto& rc : m_dirtyArea)
+    step_stats.dirtyArea += rc.w*rc.h;
+}
+
+// static
+const ToolLoopManager::StepStats& ToolLoopManager::stepStats()
+{
+  return step_stats;
+}
+
+// Adds to the next dirty area the pixels that a line from "a" to "b" can
+// modify with a point shape that modifies "brushArea" (relative to
+// each point). The line is split in pieces of kDirtyTileSize in its
+// major axis, so only the bounds of each piece are added.
+void ToolLoopManager::addLineDirtyArea(const gfx::Point& a, const gfx::Point& b,
+                                       const gfx::Rect& brushArea)
+{
+  const int dx = b.x - a.x;
+  const int dy = b.y - a.y;
+  const bool vertical = (std::abs(dy) >= std::abs(dx));
+  const int major1 = (vertical ? std::min(a.y, b.y): std::min(a.x, b.x));
+  const int major2 = (vertical ? std::max(a.y, b.y): std::max(a.x, b.x));
+
+  // Minor axis coordinate of the line at the given major coordinate
+  auto minorAt = [&](int m) -> double {
+    if (vertical)
+      return (dy ? a.x + double(m - a.y) * dx / dy: a.x);
+    else
+      return (dx ? a.y + double(m - a.x) * dy / dx: a.y);
+  };
+
+  // First tile aligned to the grid of tiles
+  int m = major1 - (((major1 % kDirtyTileSize) + kDirtyTileSize) % kDirtyTileSize);
+  for (; m <= major2; m += kDirtyTileSize) {
+    const int m1 = std::max(m, major1);
+    const int m2 = std::min(m+kDirtyTileSize-1, major2);
+    const double n1 = minorAt(m1);
+    const double n2 = minorAt(m2);
+
+    // One extra pixel for the rounding of the line algorithm
+    const int minor1 = int(std::floor(std::min(n1, n2))) - 1;
+    const int minor2 = int(std::ceil(std::max(n1, n2))) + 1;
+
+    Rect piece = (vertical ? Rect(minor1, m1, minor2-minor1+1, m2-m1+1):
+                             Rect(m1, minor1, m2-m1+1, minor2-minor1+1));
+
+    // Expand the piece with the area of the point shape
+    piece.x += brushArea.x;
+    piece.y += brushArea.y;
+    piece.w += brushArea.w-1;
+    piece.h += brushArea.h-1;
+
+    m_dirtyRects.add(piece);
+  }
+}
+
+bool ToolLoopManager::canStampInParallel(const Strokes& strokes)
+{
+  if (strokes.size() < 2 ||
+      base::thread_pool::instance().concurrency() < 2 ||
+      m_toolLoop->getTiledMode() != TiledMode::NONE)
+    return false;
+
+  // Only point shapes/inks without state shared between points
+  Ink* ink = m_toolLoop->getInk();
+  PointShape* pointShape = m_toolLoop->getPointShape();
+  Brush* brush = m_toolLoop->getBrush();
+  if (!ink->isPaint() ||
+      pointShape->isSpray() ||
+      pointShape->isFloodFill() ||
+      (!pointShape->isPixel() && brush->type() == kImageBrushType))
+    return false;
+
+  // Indexed inks can map colors in the RgbMap, which modifies it
+  // if it's not completely calculated.
+  if (m_toolLoop->sprite()->pixelFormat() == IMAGE_INDEXED &&
+      !m_toolLoop->getRgbMap()->isCalculated())
+    return false;
+
+  // The symmetric strokes cannot modify the same pixels (the
+  // result wouldn't depend on the order).
+  std::vector<gfx::Rect> areas;
+  for (const Stroke& stroke : strokes) {
+    if (stroke.empty())
+      return false;
+
+    gfx::Rect bounds = stroke.bounds();
+    gfx::Rect area1, area2;
+    pointShape->getModifiedArea(m_toolLoop, bounds.x, bounds.y, area1);
+    pointShape->getModifiedArea(m_toolLoop, bounds.x2()-1, bounds.y2()-1, area2);
+    gfx::Rect area = area1.createUnion(area2);
+
+    for (const gfx::Rect& other : areas)
+      if (area.intersects(other))
+        return false;
+    areas.push_back(area);
+  }
+  return true;
+}
+
+void ToolLoopManager::stampSymmetricStrokes(const Stroke& mainStroke, bool fill)
+{
+  // Collect the points of the main stroke...
+  Stroke points;
+  Intertwine::capturePoints(&points);
+  try {
+    if (!fill)
+      m_toolLoop->getIntertwine()->joinStroke(m_toolLoop, mainStroke);
+    else
+      m_toolLoop->getIntertwine()->fillStroke(m_toolLoop, mainStroke);
+  }
+  catch (...) {
+    Intertwine::capturePoints(nullptr);
+    throw;
+  }
+  Intertwine::capturePoints(nullptr);
+
+  // ...and stamp each symmetric copy of them in a different thread.
+  Strokes strokes;
+  m_toolLoop->getSymmetry()->generateStrokes(points, strokes, m_toolLoop);
+
+  PointShape* pointShape = m_toolLoop->getPointShape();
+  auto stamp = [this, pointShape, &strokes](int i) {
+    for (const auto& pt : strokes[i])
+      pointShape->transformPoint(m_toolLoop, pt.x, pt.y, pt.pressure);
+  };
+
+  const gfx::Rect brushBounds = m_toolLoop->getBrush()->bounds();
+  if (points.size() * brushBounds.w * brushBounds.h < kMinParallelStampPixels) {
+    for (int i=0; i<int(strokes.size()); ++i)
+      stamp(i);
+  }
+  else {
+    base::thread_pool::instance().parallel_for(int(strokes.size()), stamp);
+  }
+}
+
+// Joins or fills the stroke in two passes: first the points are
+// generated by the Intertwine (without stamping them), and then they
+// are stamped. The result is the same as joinStroke()/fillStroke().
+void ToolLoopManager::profileStroke(const Stroke& mainStroke, bool fill,
+                                    StepTimes& times)
+{
+  Stroke points;
+  auto t0 = std::chrono::steady_clock::now();
+  Intertwine::capturePoints(&points);
+  try {
+    if (!fill)
+      m_toolLoop->getIntertwine()->joinStroke(m_toolLoop, mainStroke);
+    else
+      m_toolLoop->getIntertwine()->fillStroke(m_toolLoop, mainStroke);
+  }
+  catch (...) {
+    Intertwine::capturePoints(nullptr);
+    throw;
+  }
+  Intertwine::capturePoints(nullptr);
+  times.intertwine = elapsed_ms(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  Intertwine::stampPoints(m_toolLoop, points);
+  times.ink = elapsed_ms(t0);
+}
+
+void ToolLoopManager::recordEvent(StrokeEventType type,
+                                  const std::vector<Pointer>& pointers)
+{
+  if (!m_recordedStroke)
+    return;
+
+  const auto now = std::chrono::steady_clock::now();
+  if (m_recordedStroke->events.empty())
+    m_recordingStart = now;
+
+  RecordedStroke::Event event;
+  event.type = type;
+  event.time = std::chrono::duration<double, std::milli>(now - m_recordingStart).count();
+  event.pointers = pointers;
+  m_recordedStroke->events.push_back(event);
+}
+
+bool ToolLoopManager::canPredict()
+{
+  // The predicted segment is drawn over the accumulated trace and
+  // its pixels are restored later, so it cannot be used with tools
+  // that redraw the whole trace or modify the source image.
+  return (m_predictionEnabled &&
+          m_toolLoop->getController()->isFreehand() &&
+          m_toolLoop->getInk()->isPaint() &&
+          !m_toolLoop->getInk()->needsSpecialSourceArea() &&
+          !m_toolLoop->getPointShape()->isSpray() &&
+          !m_toolLoop->getFilled() &&
+          m_toolLoop->getTracePolicy() == TracePolicy::Accumulate &&
+          m_stroke.size() >= 2);
+}
+
+void ToolLoopManager::drawPrediction(int movements)
+{
+  // Movement of the last frame
+  const Stroke::Point& last = m_stroke.lastPoint();
+  const Stroke::Point& prev = m_stroke[std::max(0, m_stroke.size()-1-movements)];
+  Point delta(last.x - prev.x, last.y - prev.y);
+
+  const double length = std::sqrt(double(delta.x*delta.x + delta.y*delta.y));
+  if (length < 1.0)
+    return;
+  if (length > kMaxPredictionDistance) {
+    delta.x = int(delta.x * kMaxPredictionDistance / length);
+    delta.y = int(delta.y * kMaxPredictionDistance / length);
+  }
+
+  Stroke predicted;
+  predicted.addPoint(last);
+  predicted.addPoint(Stroke::Point(last.x+delta.x, last.y+delta.y, last.pressure));
+
+  Strokes strokes;
+  if (Symmetry* symmetry = m_toolLoop->getSymmetry())
+    symmetry->generateStrokes(predicted, strokes, m_toolLoop);
+  else
+    strokes.push_back(predicted);
+
+  calculateDirtyArea(strokes);
+  m_toolLoop->validateSrcImage(m_dirtyArea);
+  m_toolLoop->validateDstImage(m_dirtyArea);
+
+  // Save the destination pixels (the region is relative to the
+  // sprite, and the destination image is located in the cel origin)
+  Image* dst = m_toolLoop->getDstImage();
+  gfx::Rect bounds = m_dirtyArea.bounds();
+  bounds.offset(-m_toolLoop->getCelOrigin());
+  bounds &= dst->bounds();
+  if (bounds.isEmpty())
+    return;
+
+  m_prediction.area = m_dirtyArea;
+  m_prediction.pixels.reset(crop_image(dst, bounds, 0));
+  m_prediction.position = bounds.origin();
+
+  m_toolLoop->getIntertwine()->joinStroke(m_toolLoop, predicted);
+  m_toolLoop->updateDirtyArea();
+}
+
+void ToolLoopManager::rollbackPrediction()
+{
+  if (!m_prediction.pixels)
+    return;
+
+  copy_image(m_toolLoop->getDstImage(), m_prediction.pixels.get(),
+             m_prediction.position.x, m_prediction.position.y);
+  m_prediction.pixels.reset();
+
+  m_dirtyArea = m_prediction.area;
+  m_toolLoop->updateDirtyArea();
 }
 
 // Applies the grid settings to the specified sprite point.
@@ -218,19 +556,25 @@ void ToolLoopManager::snapToGrid(Point& point)
 // Strokes are relative to sprite origin.
 void ToolLoopManager::calculateDirtyArea(const Strokes& strokes)
 {
-  // Save the current dirty area if it's needed
-  Region prevDirtyArea;
-  if (m_toolLoop->getTracePolicy() == TracePolicy::Last)
-    prevDirtyArea = m_dirtyArea;
-
-  // Start with a fresh dirty area
-  m_dirtyArea.clear();
+  // The lines between points modify only the tiles they cross
+  const bool lines = (m_toolLoop->getIntertwine()->joinsWithLines() &&
+                      !m_toolLoop->getFilled());
+  Rect brushArea;
+  if (lines)
+    m_toolLoop->getPointShape()->getModifiedArea(m_toolLoop, 0, 0, brushArea);
 
   for (auto& stroke : strokes) {
     gfx::Rect strokeBounds = stroke.bounds();
     if (strokeBounds.isEmpty())
       continue;
 
+    if (lines && stroke.size() >= 2 &&
+        std::min(strokeBounds.w, strokeBounds.h) > kDirtyTileSize) {
+      for (int c=0; c+1<stroke.size(); ++c)
+        addLineDirtyArea(stroke[c], stroke[c+1], brushArea);
+      continue;
+    }
+
     // Expand the dirty-area with the pen width
     Rect r1, r2;
 
@@ -244,14 +588,16 @@ void ToolLoopManager::calculateDirtyArea(const Strokes& strokes)
       strokeBounds.x+strokeBounds.w-1,
       strokeBounds.y+strokeBounds.h-1, r2);
 
-    m_dirtyArea.createUnion(m_dirtyArea, Region(r1.createUnion(r2)));
+    m_dirtyRects.add(r1.createUnion(r2));
   }
 
   // Merge new dirty area with the previous one (for tools like line
   // or rectangle it's needed to redraw the previous position and
   // the new one)
   if (m_toolLoop->getTracePolicy() == TracePolicy::Last)
-    m_dirtyArea.createUnion(m_dirtyArea, prevDirtyArea);
+    m_dirtyRects.add(m_dirtyArea);
+
+  m_dirtyRects.build(m_dirtyArea);
 
   // Apply tiled mode
   TiledMode tiledMode = m_toolLoop->getTiledMode();
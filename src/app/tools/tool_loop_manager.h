@@ -9,9 +9,11 @@
 
 #include "app/tools/pointer.h"
 #include "app/tools/stroke.h"
+#include "doc/image_ref.h"
 #include "gfx/point.h"
 #include "gfx/region.h"
 
+#include <chrono>
 #include <vector>
 
 namespace gfx { class Region; }
@@ -20,6 +22,8 @@ namespace app {
 namespace tools {
 
 class ToolLoop;
+struct RecordedStroke;
+enum class StrokeEventType;
 
 // Class to manage the drawing tool (editor <-> tool interface).
 //
@@ -33,12 +37,21 @@ class ToolLoop;
 //    - ToolLoopManager::pressButton
 // 4. If the user moves the mouse, the method
 //    - ToolLoopManager::movement
-//    is called.
+//    is called (with one point, or with all the points received
+//    in the same display frame).
 // 5. When the user release the mouse:
 //    - ToolLoopManager::releaseButton
 //
 class ToolLoopManager {
 public:
+  // Time (in milliseconds) spent in each part of a loop step.
+  struct StepTimes {
+    double dirtyArea = 0.0;  // Dirty area and validation of src/dst images
+    double intertwine = 0.0; // Points generated by the Intertwine
+    double ink = 0.0;        // Points stamped with the PointShape/Ink
+    double repaint = 0.0;    // ToolLoop::updateDirtyArea()
+  };
+
   // Contructs a manager for the ToolLoop delegate.
   ToolLoopManager(ToolLoop* toolLoop);
   virtual ~ToolLoopManager();
@@ -65,17 +78,70 @@ public:
   // Should be called each time the user moves the mouse inside the editor.
   void movement(const Pointer& pointer);
 
+  // Processes several mouse movements at once (e.g. all the events
+  // received in the same display frame). The controller receives all
+  // the points, but the ink is applied only once for all of them.
+  void movement(const std::vector<Pointer>& pointers);
+
+  // Draws a short segment ahead of the last point (extrapolated from
+  // the last movement) which is removed in the next step, so the ink
+  // doesn't look behind the pointer. It's used only with freehand
+  // paint tools that accumulate the trace.
+  void setPredictionEnabled(bool state) { m_predictionEnabled = state; }
+
+  // Adds the pointer events received by this manager to the given
+  // stroke (see StrokeRecording).
+  void setRecordedStroke(RecordedStroke* stroke);
+
+  // Adds the time of each loop step to the given vector (e.g. to
+  // profile a replayed stroke). The points generated by the
+  // Intertwine are stamped in a second pass to measure the ink
+  // separately.
+  void setStepTimes(std::vector<StepTimes>* stepTimes) { m_stepTimes = stepTimes; }
+
+  // Stats of the loop steps of all the tool loops.
+  struct StepStats {
+    double stepTime = 0.0; // Average milliseconds of a loop step
+    int dirtyArea = 0;     // Pixels of the dirty area of the last step
+  };
+  static const StepStats& stepStats();
+
 private:
-  void doLoopStep(bool last_step);
+  void doLoopStep(bool last_step, int movements = 1);
   void snapToGrid(gfx::Point& point);
 
   void calculateDirtyArea(const Strokes& strokes);
+  void addLineDirtyArea(const gfx::Point& a, const gfx::Point& b,
+                        const gfx::Rect& brushArea);
+
+  bool canStampInParallel(const Strokes& strokes);
+  void stampSymmetricStrokes(const Stroke& mainStroke, bool fill);
+  void profileStroke(const Stroke& mainStroke, bool fill, StepTimes& times);
+  void recordEvent(StrokeEventType type, const std::vector<Pointer>& pointers);
+
+  bool canPredict();
+  void drawPrediction(int movements);
+  void rollbackPrediction();
+
+  // Pixels of the destination image that were replaced by the
+  // predicted segment
+  struct Prediction {
+    gfx::Region area;
+    doc::ImageRef pixels;
+    gfx::Point position;
+  };
 
   ToolLoop* m_toolLoop;
   Stroke m_stroke;
   Pointer m_lastPointer;
   gfx::Point m_oldPoint;
   gfx::Region& m_dirtyArea;
+  gfx::RegionBuilder m_dirtyRects; // Rectangles of the next dirty area
+  bool m_predictionEnabled;
+  Prediction m_prediction;
+  RecordedStroke* m_recordedStroke;
+  std::chrono::steady_clock::time_point m_recordingStart;
+  std::vector<StepTimes>* m_stepTimes;
 };
 
 } // namespace tools
@@ -60,6 +60,12 @@ void Transaction::commit()
   m_cmds = NULL;
 }
 
+void Transaction::setMergeable(bool state)
+{
+  ASSERT(m_cmds);
+  m_cmds->setMergeable(state);
+}
+
 void Transaction::rollback()
 {
   ASSERT(m_cmds);
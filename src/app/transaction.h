@@ -54,6 +54,10 @@ namespace app {
 
     void execute(Cmd* cmd);
 
+    // The transaction can be coalesced with the previous one in the
+    // undo history if both are mergeable (see CmdTransaction).
+    void setMergeable(bool state);
+
   private:
     void rollback();
 
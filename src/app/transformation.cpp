@@ -18,6 +18,24 @@
 namespace app {
 
 using namespace gfx;
+using namespace fixmath;
+
+// Rotates "point" around "pivot" with the fixed point sin/cos of the
+// angle.
+static PointF rotate_point(const PointF& point, const PointF& pivot,
+                           fixed cos, fixed sin)
+{
+  fixed dx = fixsub(ftofix(point.x), ftofix(pivot.x));
+  fixed dy = fixsub(ftofix(point.y), ftofix(pivot.y));
+  return PointF(
+    fixtof(fixadd(ftofix(pivot.x), fixsub(fixmul(dx, cos), fixmul(dy, sin)))),
+    fixtof(fixadd(ftofix(pivot.y), fixadd(fixmul(dy, cos), fixmul(dx, sin)))));
+}
+
+static fixed angle_to_fix(double angle)
+{
+  return fixmul(ftofix(-angle), radtofix_r);
+}
 
 Transformation::Transformation()
 {
@@ -40,14 +58,14 @@ Transformation::Transformation(const RectF& bounds)
 
 void Transformation::transformBox(Corners& corners) const
 {
-  // TODO We could create a composed 4x4 matrix with all
-  // transformation and apply the same matrix to avoid calling
-  // rotatePoint/cos/sin functions 4 times, anyway, it's not
-  // critical at this point.
+  // The sin/cos are calculated one time for the four corners
+  const fixed fixangle = angle_to_fix(m_angle);
+  const fixed cos = fixcos(fixangle);
+  const fixed sin = fixsin(fixangle);
 
   corners = m_bounds;
   for (std::size_t c=0; c<corners.size(); ++c)
-    corners[c] = Transformation::rotatePoint(corners[c], m_pivot, m_angle);
+    corners[c] = rotate_point(corners[c], m_pivot, cos, sin);
 }
 
 void Transformation::displacePivotTo(const PointF& newPivot)
@@ -73,18 +91,8 @@ PointF Transformation::rotatePoint(
   const PointF& pivot,
   double angle)
 {
-  using namespace fixmath;
-
-  fixed fixangle = ftofix(-angle);
-  fixangle = fixmul(fixangle, radtofix_r);
-
-  fixed cos = fixcos(fixangle);
-  fixed sin = fixsin(fixangle);
-  fixed dx = fixsub(ftofix(point.x), ftofix(pivot.x));
-  fixed dy = fixsub(ftofix(point.y), ftofix(pivot.y));
-  return PointF(
-    fixtof(fixadd(ftofix(pivot.x), fixsub(fixmul(dx, cos), fixmul(dy, sin)))),
-    fixtof(fixadd(ftofix(pivot.y), fixadd(fixmul(dy, cos), fixmul(dx, sin)))));
+  const fixed fixangle = angle_to_fix(angle);
+  return rotate_point(point, pivot, fixcos(fixangle), fixsin(fixangle));
 }
 
 RectF Transformation::transformedBounds() const
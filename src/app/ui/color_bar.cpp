@@ -48,6 +48,7 @@
 #include "doc/cels_range.h"
 #include "doc/image.h"
 #include "doc/image_impl.h"
+#include "doc/image_spans.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
 #include "doc/remap.h"
@@ -63,7 +64,10 @@
 #include "ui/system.h"
 
 
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <vector>
 
 
 namespace app {
@@ -571,11 +575,15 @@ void ColorBar::onRemapButtonClick()
 
       if (remap.isFor8bit()) {
         PalettePicks usedEntries(256);
+        std::array<bool, 256> used;
+        used.fill(false);
 
-        for (auto cel : sprite->uniqueCels()) {
-          for (const auto& i : LockImageBits<IndexedTraits>(cel->image()))
-            usedEntries[i] = true;
+        for (const auto& cel : sprite->uniqueCels()) {
+          for (const auto& span : ImageConstSpans<IndexedTraits>(cel->image(), true))
+            for (auto it=span.begin; it!=span.end; ++it)
+              used[*it] = true;
         }
+        std::copy(used.begin(), used.end(), usedEntries.begin());
 
         if (remap.isInvertible(usedEntries)) {
           transaction.execute(new cmd::RemapColors(sprite, remap));
@@ -585,14 +593,20 @@ void ColorBar::onRemapButtonClick()
 
       // Special remap saving original images in undo history
       if (remapPixels) {
-        for (auto cel : sprite->uniqueCels()) {
-          ImageRef celImage = cel->imageRef();
-          ImageRef newImage(Image::createCopy(celImage.get()));
-          doc::remap_image(newImage.get(), remap);
+        std::vector<ImageRef> oldImages, newImages;
+        std::vector<Image*> images;
+        for (const auto& cel : sprite->uniqueCels()) {
+          oldImages.push_back(cel->imageRef());
+          newImages.push_back(ImageRef(Image::createCopy(cel->image())));
+          images.push_back(newImages.back().get());
+        }
+
+        // All copies are remapped in parallel
+        doc::remap_images(images, remap);
 
+        for (std::size_t i=0; i<oldImages.size(); ++i)
           transaction.execute(new cmd::ReplaceImage(
-                                sprite, celImage, newImage));
-        }
+                                sprite, oldImages[i], newImages[i]));
       }
 
       color_t oldTransparent = sprite->transparentColor();
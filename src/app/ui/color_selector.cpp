@@ -11,6 +11,8 @@
 
 #include "app/ui/color_selector.h"
 
+#include "she/surface.h"
+#include "she/system.h"
 #include "ui/message.h"
 #include "ui/size_hint_event.h"
 #include "ui/theme.h"
@@ -24,9 +26,15 @@ using namespace ui;
 ColorSelector::ColorSelector()
   : Widget(kGenericWidget)
   , m_lockColor(false)
+  , m_background(nullptr)
 {
 }
 
+ColorSelector::~ColorSelector()
+{
+  invalidateBackground();
+}
+
 void ColorSelector::selectColor(const app::Color& color)
 {
   if (m_lockColor)
@@ -79,4 +87,36 @@ bool ColorSelector::onProcessMessage(ui::Message* msg)
   return Widget::onProcessMessage(msg);
 }
 
+void ColorSelector::onInitTheme(ui::InitThemeEvent& ev)
+{
+  invalidateBackground();
+  Widget::onInitTheme(ev);
+}
+
+she::Surface* ColorSelector::getBackground(const gfx::Size& size)
+{
+  if (m_background &&
+      (m_background->width() != size.w ||
+       m_background->height() != size.h)) {
+    invalidateBackground();
+  }
+
+  if (!m_background) {
+    m_background = she::instance()->createSurface(size.w, size.h);
+
+    she::SurfaceLock lock(m_background);
+    onPaintBackground(m_background);
+  }
+
+  return m_background;
+}
+
+void ColorSelector::invalidateBackground()
+{
+  if (m_background) {
+    m_background->dispose();
+    m_background = nullptr;
+  }
+}
+
 } // namespace app
@@ -13,12 +13,17 @@
 #include "ui/mouse_buttons.h"
 #include "ui/widget.h"
 
+namespace she {
+  class Surface;
+}
+
 namespace app {
 
   class ColorSelector : public ui::Widget
                       , public IColorSource {
   public:
     ColorSelector();
+    ~ColorSelector();
 
     void selectColor(const app::Color& color);
 
@@ -28,6 +33,16 @@ namespace app {
   protected:
     void onSizeHint(ui::SizeHintEvent& ev) override;
     bool onProcessMessage(ui::Message* msg) override;
+    void onInitTheme(ui::InitThemeEvent& ev) override;
+
+    // Returns the background of the selector (the gradient that
+    // doesn't depend on the selected color) with the given size. It's
+    // painted with onPaintBackground() only when the size changes or
+    // after calling invalidateBackground(), so hovering or changing
+    // the color doesn't need to compute each pixel again.
+    she::Surface* getBackground(const gfx::Size& size);
+    void invalidateBackground();
+    virtual void onPaintBackground(she::Surface* surface) = 0;
 
     app::Color m_color;
 
@@ -35,6 +50,9 @@ namespace app {
     // E.g. When the user picks a color harmony, we don't want to
     // change the main color.
     bool m_lockColor;
+
+  private:
+    she::Surface* m_background;
   };
 
 } // namespace app
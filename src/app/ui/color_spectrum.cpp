@@ -78,21 +78,44 @@ void ColorSpectrum::onPaint(ui::PaintEvent& ev)
   if (rc.isEmpty())
     return;
 
-  int vmid = (align() & HORIZONTAL ? rc.h/2 : rc.w/2);
+  g->drawSurface(getBackground(rc.size()), rc.x, rc.y);
+
+  if (m_color.getType() != app::Color::MaskType) {
+    double hue = m_color.getHue();
+    double sat = m_color.getSaturation();
+    double val = m_color.getValue();
+    double lit = (200.0 - sat) * val / 200.0;
+    gfx::Point pos(rc.x + int(hue * rc.w / 360.0),
+                   rc.y + rc.h - int(lit * rc.h / 100.0));
+
+    she::Surface* icon = theme->parts.colorWheelIndicator()->bitmap(0);
+    g->drawColoredRgbaSurface(
+      icon,
+      lit > 50.0 ? gfx::rgba(0, 0, 0): gfx::rgba(255, 255, 255),
+      pos.x-icon->width()/2,
+      pos.y-icon->height()/2);
+  }
+}
+
+void ColorSpectrum::onPaintBackground(she::Surface* surface)
+{
+  const int w = surface->width();
+  const int h = surface->height();
+  int vmid = (align() & HORIZONTAL ? h/2 : w/2);
   vmid = MAX(1, vmid);
 
-  for (int y=0; y<rc.h; ++y) {
-    for (int x=0; x<rc.w; ++x) {
+  for (int y=0; y<h; ++y) {
+    for (int x=0; x<w; ++x) {
       int u, v, umax;
       if (align() & HORIZONTAL) {
         u = x;
         v = y;
-        umax = MAX(1, rc.w-1);
+        umax = MAX(1, w-1);
       }
       else {
         u = y;
         v = x;
-        umax = MAX(1, rc.h-1);
+        umax = MAX(1, h-1);
       }
 
       double hue = 360.0 * u / umax;
@@ -105,25 +128,9 @@ void ColorSpectrum::onPaint(ui::PaintEvent& ev)
           MID(0.0, sat, 100.0),
           MID(0.0, val, 100.0)));
 
-      g->putPixel(color, rc.x+x, rc.y+y);
+      surface->putPixel(color, x, y);
     }
   }
-
-  if (m_color.getType() != app::Color::MaskType) {
-    double hue = m_color.getHue();
-    double sat = m_color.getSaturation();
-    double val = m_color.getValue();
-    double lit = (200.0 - sat) * val / 200.0;
-    gfx::Point pos(rc.x + int(hue * rc.w / 360.0),
-                   rc.y + rc.h - int(lit * rc.h / 100.0));
-
-    she::Surface* icon = theme->parts.colorWheelIndicator()->bitmap(0);
-    g->drawColoredRgbaSurface(
-      icon,
-      lit > 50.0 ? gfx::rgba(0, 0, 0): gfx::rgba(255, 255, 255),
-      pos.x-icon->width()/2,
-      pos.y-icon->height()/2);
-  }
 }
 
 bool ColorSpectrum::onProcessMessage(ui::Message* msg)
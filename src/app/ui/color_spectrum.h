@@ -21,6 +21,7 @@ namespace app {
 
   protected:
     void onPaint(ui::PaintEvent& ev) override;
+    void onPaintBackground(she::Surface* surface) override;
     bool onProcessMessage(ui::Message* msg) override;
   };
 
@@ -30,6 +30,7 @@ using namespace ui;
 
 ColorTintShadeTone::ColorTintShadeTone()
   : m_capturedInHue(false)
+  , m_backgroundHue(-1.0)
 {
   setBorder(gfx::Border(3*ui::guiscale()));
 }
@@ -83,38 +84,14 @@ void ColorTintShadeTone::onPaint(ui::PaintEvent& ev)
   if (rc.isEmpty())
     return;
 
+  // The gradient depends on the hue of the selected color
   double hue = m_color.getHue();
-  int umax, vmax;
   int huebar = getHueBarSize();
-  umax = MAX(1, rc.w-1);
-  vmax = MAX(1, rc.h-1-huebar);
-
-  for (int y=0; y<rc.h-huebar; ++y) {
-    for (int x=0; x<rc.w; ++x) {
-      double sat = (100.0 * x / umax);
-      double val = (100.0 - 100.0 * y / vmax);
-
-      gfx::Color color = color_utils::color_for_ui(
-        app::Color::fromHsv(
-          hue,
-          MID(0.0, sat, 100.0),
-          MID(0.0, val, 100.0)));
-
-      g->putPixel(color, rc.x+x, rc.y+y);
-    }
-  }
-
-  if (huebar > 0) {
-    for (int y=rc.h-huebar; y<rc.h; ++y) {
-      for (int x=0; x<rc.w; ++x) {
-        gfx::Color color = color_utils::color_for_ui(
-          app::Color::fromHsv(
-            (360.0 * x / rc.w), 100.0, 100.0));
-
-        g->putPixel(color, rc.x+x, rc.y+y);
-      }
-    }
+  if (hue != m_backgroundHue) {
+    invalidateBackground();
+    m_backgroundHue = hue;
   }
+  g->drawSurface(getBackground(rc.size()), rc.x, rc.y);
 
   if (m_color.getType() != app::Color::MaskType) {
     double sat = m_color.getSaturation();
@@ -141,6 +118,44 @@ void ColorTintShadeTone::onPaint(ui::PaintEvent& ev)
   }
 }
 
+void ColorTintShadeTone::onPaintBackground(she::Surface* surface)
+{
+  const int w = surface->width();
+  const int h = surface->height();
+  double hue = m_backgroundHue;
+  int umax, vmax;
+  int huebar = getHueBarSize();
+  umax = MAX(1, w-1);
+  vmax = MAX(1, h-1-huebar);
+
+  for (int y=0; y<h-huebar; ++y) {
+    for (int x=0; x<w; ++x) {
+      double sat = (100.0 * x / umax);
+      double val = (100.0 - 100.0 * y / vmax);
+
+      gfx::Color color = color_utils::color_for_ui(
+        app::Color::fromHsv(
+          hue,
+          MID(0.0, sat, 100.0),
+          MID(0.0, val, 100.0)));
+
+      surface->putPixel(color, x, y);
+    }
+  }
+
+  if (huebar > 0) {
+    for (int y=h-huebar; y<h; ++y) {
+      for (int x=0; x<w; ++x) {
+        gfx::Color color = color_utils::color_for_ui(
+          app::Color::fromHsv(
+            (360.0 * x / w), 100.0, 100.0));
+
+        surface->putPixel(color, x, y);
+      }
+    }
+  }
+}
+
 bool ColorTintShadeTone::onProcessMessage(ui::Message* msg)
 {
   switch (msg->type()) {
@@ -20,6 +20,7 @@ namespace app {
 
   protected:
     void onPaint(ui::PaintEvent& ev) override;
+    void onPaintBackground(she::Surface* surface) override;
     bool onProcessMessage(ui::Message* msg) override;
 
   private:
@@ -30,6 +31,9 @@ namespace app {
     // It's used to avoid swapping in both areas (tint/shades/tones
     // area vs hue slider) when we drag the mouse above this widget.
     bool m_capturedInHue;
+
+    // Hue of the tints/shades/tones painted in the background.
+    double m_backgroundHue;
   };
 
 } // namespace app
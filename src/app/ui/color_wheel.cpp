@@ -81,11 +81,42 @@ app::Color ColorWheel::getColorInClientPos(const gfx::Point& pos)
 {
   m_harmonyPicked = false;
 
+  // Pick from the wheel
+  app::Color wheelColor = getColorInWheel(pos);
+  if (wheelColor.getType() != app::Color::MaskType)
+    return wheelColor;
+
+  // Pick harmonies
+  if (m_color.getAlpha() > 0) {
+    const gfx::Rect& rc = m_clientBounds;
+    int n = getHarmonies();
+    int boxsize = MIN(rc.w/10, rc.h/10);
+
+    for (int i=0; i<n; ++i) {
+      app::Color color = getColorInHarmony(i);
+
+      if (gfx::Rect(rc.x+rc.w-(n-i)*boxsize,
+                    rc.y+rc.h-boxsize,
+                    boxsize, boxsize).contains(pos)) {
+        m_harmonyPicked = true;
+
+        color = app::Color::fromHsv(convertHueAngle(int(color.getHue()), 1),
+                                    color.getSaturation(),
+                                    color.getValue());
+        return color;
+      }
+    }
+  }
+
+  return app::Color::fromMask();
+}
+
+app::Color ColorWheel::getColorInWheel(const gfx::Point& pos) const
+{
   int u = (pos.x - (m_wheelBounds.x+m_wheelBounds.w/2));
   int v = (pos.y - (m_wheelBounds.y+m_wheelBounds.h/2));
   double d = std::sqrt(u*u + v*v);
 
-  // Pick from the wheel
   if (d < m_wheelRadius+2*guiscale()) {
     double a = std::atan2(-v, u);
 
@@ -117,28 +148,6 @@ app::Color ColorWheel::getColorInClientPos(const gfx::Point& pos)
       100);
   }
 
-  // Pick harmonies
-  if (m_color.getAlpha() > 0) {
-    const gfx::Rect& rc = m_clientBounds;
-    int n = getHarmonies();
-    int boxsize = MIN(rc.w/10, rc.h/10);
-
-    for (int i=0; i<n; ++i) {
-      app::Color color = getColorInHarmony(i);
-
-      if (gfx::Rect(rc.x+rc.w-(n-i)*boxsize,
-                    rc.y+rc.h-boxsize,
-                    boxsize, boxsize).contains(pos)) {
-        m_harmonyPicked = true;
-
-        color = app::Color::fromHsv(convertHueAngle(int(color.getHue()), 1),
-                                    color.getSaturation(),
-                                    color.getValue());
-        return color;
-      }
-    }
-  }
-
   return app::Color::fromMask();
 }
 
@@ -147,6 +156,7 @@ void ColorWheel::setDiscrete(bool state)
   m_discrete = state;
   Preferences::instance().colorBar.discreteWheel(m_discrete);
 
+  invalidateBackground();
   invalidate();
 }
 
@@ -155,6 +165,7 @@ void ColorWheel::setColorModel(ColorModel colorModel)
   m_colorModel = colorModel;
   Preferences::instance().colorBar.wheelModel((int)m_colorModel);
 
+  invalidateBackground();
   invalidate();
 }
 
@@ -214,23 +225,8 @@ void ColorWheel::onPaint(ui::PaintEvent& ev)
                   bgColor());
 
   const gfx::Rect& rc = m_clientBounds;
-
-  for (int y=rc.y; y<rc.y+rc.h; ++y) {
-    for (int x=rc.x; x<rc.x+rc.w; ++x) {
-      app::Color appColor =
-        ColorWheel::getColorInClientPos(gfx::Point(x, y));
-
-      gfx::Color color;
-      if (appColor.getType() != app::Color::MaskType) {
-        color = color_utils::color_for_ui(appColor);
-      }
-      else {
-        color = theme->colors.editorFace();
-      }
-
-      g->putPixel(color, x, y);
-    }
-  }
+  if (!rc.isEmpty())
+    g->drawSurface(getBackground(rc.size()), rc.x, rc.y);
 
   if (m_color.getAlpha() > 0) {
     int n = getHarmonies();
@@ -265,6 +261,29 @@ void ColorWheel::onPaint(ui::PaintEvent& ev)
   }
 }
 
+void ColorWheel::onPaintBackground(she::Surface* surface)
+{
+  SkinTheme* theme = static_cast<SkinTheme*>(this->theme());
+  const gfx::Rect& rc = m_clientBounds;
+
+  for (int y=0; y<rc.h; ++y) {
+    for (int x=0; x<rc.w; ++x) {
+      app::Color appColor =
+        getColorInWheel(gfx::Point(rc.x+x, rc.y+y));
+
+      gfx::Color color;
+      if (appColor.getType() != app::Color::MaskType) {
+        color = color_utils::color_for_ui(appColor);
+      }
+      else {
+        color = theme->colors.editorFace();
+      }
+
+      surface->putPixel(color, x, y);
+    }
+  }
+}
+
 bool ColorWheel::onProcessMessage(ui::Message* msg)
 {
   switch (msg->type()) {
@@ -44,8 +44,10 @@ namespace app {
 
   private:
     app::Color getColorInClientPos(const gfx::Point& pos);
+    app::Color getColorInWheel(const gfx::Point& pos) const;
     void onResize(ui::ResizeEvent& ev) override;
     void onPaint(ui::PaintEvent& ev) override;
+    void onPaintBackground(she::Surface* surface) override;
     bool onProcessMessage(ui::Message* msg) override;
     void onOptions();
     int getHarmonies() const;
@@ -11,11 +11,19 @@
 
 #include "app/ui/devconsole_view.h"
 #include "app/app_menus.h"
+#include "app/cmd_stats.h"
+#include "app/document.h"
+#include "app/document_undo.h"
 #include "app/script/app_scripting.h"
 #include "app/ui/skin/skin_style_property.h"
 #include "app/ui/skin/skin_theme.h"
 #include "app/ui/workspace.h"
+#include "app/ui_context.h"
+#include "base/mem_tags.h"
+#include "base/mem_utils.h"
+#include "base/trace_span.h"
 #include "script/engine.h"
+#include "script/profiler.h"
 #include "ui/button.h"
 #include "ui/entry.h"
 #include "ui/message.h"
@@ -61,7 +69,9 @@ protected:
 
 DevConsoleView::DevConsoleView()
   : Box(VERTICAL)
-  , m_textBox("Welcome to LibreSprite Scripting Console\n(Experimental)", LEFT)
+  , m_textBox("Welcome to LibreSprite Scripting Console\n(Experimental)\n"
+              "Type /undostats to see the undo memory used by the active sprite\n"
+              "Type /memstats to see the memory used by each subsystem", LEFT)
   , m_label(">")
   , m_entry(new CommmandEntry)
 {
@@ -138,6 +148,50 @@ bool DevConsoleView::onProcessMessage(Message* msg)
 
 void DevConsoleView::onExecuteCommand(const std::string& cmd)
 {
+  // Built-in commands start with "/" (it cannot start a script)
+  if (cmd == "/undostats") {
+    auto doc = static_cast<app::Document*>(UIContext::instance()->activeDocument());
+    onConsolePrint(CmdStats::report(doc ? doc->undoHistory(): nullptr).c_str());
+    return;
+  }
+  if (cmd == "/memstats") {
+    size_t undoSize = 0;
+    for (doc::Document* doc : UIContext::instance()->documents())
+      undoSize += static_cast<app::Document*>(doc)->undoHistory()->memSize();
+
+    std::string report = base::mem_tag_report();
+    report += "Undo history:  " + base::get_pretty_memory_size(undoSize);
+    onConsolePrint(report.c_str());
+    return;
+  }
+  if (cmd == "/memstats reset") {
+    base::reset_mem_tag_peaks();
+    return;
+  }
+  if (cmd == "/profile on" || cmd == "/profile off") {
+    script::Profiler::setEnabled(cmd == "/profile on");
+    return;
+  }
+  if (cmd == "/profile reset") {
+    script::Profiler::reset();
+    return;
+  }
+  if (cmd == "/trace on" || cmd == "/trace off") {
+    base::trace::set_enabled(cmd == "/trace on");
+    return;
+  }
+  if (cmd.compare(0, 12, "/trace save ") == 0) {
+    std::string filename = cmd.substr(12);
+    onConsolePrint(base::trace::save_chrome_json(filename) ?
+                   ("Trace saved in " + filename).c_str():
+                   ("Cannot save " + filename).c_str());
+    return;
+  }
+  if (cmd == "/profile") {
+    onConsolePrint(script::Profiler::report().c_str());
+    return;
+  }
+
   script::Engine::setDefault(m_language.getValue());
   m_engine.printLastResult();
   m_engine.eval(cmd);
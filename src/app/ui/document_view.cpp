@@ -16,7 +16,9 @@
 #include "app/cmd/clear_mask.h"
 #include "app/cmd/deselect_mask.h"
 #include "app/cmd/trim_cel.h"
+#include "app/commands/cmd_save_file.h"
 #include "app/commands/commands.h"
+#include "app/commands/params.h"
 #include "app/console.h"
 #include "app/context_access.h"
 #include "app/document_access.h"
@@ -240,6 +242,9 @@ bool DocumentView::onCloseView(Workspace* workspace, bool quitting)
   bool save_it;
   bool try_again = true;
 
+  // A save in progress can leave the document unmodified
+  wait_background_save(m_document);
+
   while (try_again) {
     // This flag indicates if we have to sabe the sprite before to destroy it
     save_it = false;
@@ -275,9 +280,13 @@ bool DocumentView::onCloseView(Workspace* workspace, bool quitting)
       ctx->setActiveView(this);
       ctx->updateFlags();
 
+      // The document must be saved before closing it
+      Params params;
+      params.set("background", "false");
+
       Command* save_command =
         CommandsModule::instance()->getCommandByName(CommandId::SaveFile);
-      ctx->executeCommand(save_command);
+      ctx->executeCommand(save_command, params);
 
       try_again = true;
     }
@@ -339,6 +348,8 @@ void DocumentView::onSpritePixelsModified(doc::DocumentEvent& ev)
   if (m_editor->isVisible() &&
       m_editor->frame() == ev.frame())
     m_editor->drawSpriteClipped(ev.region());
+  else
+    m_editor->invalidateCanvas();
 }
 
 void DocumentView::onLayerMergedDown(doc::DocumentEvent& ev)
@@ -34,10 +34,25 @@
 #include "doc/primitives.h"
 #include "doc/site.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace app {
 
 using namespace doc;
 
+namespace {
+
+gfx::Rect pixels_bounds(const std::vector<gfx::Point>& pts)
+{
+  gfx::Rect bounds;
+  for (const auto& pt : pts)
+    bounds |= gfx::Rect(pt.x, pt.y, 1, 1);
+  return bounds;
+}
+
+} // anonymous namespace
+
 BrushPreview::BrushPreview(Editor* editor)
   : m_editor(editor)
   , m_type(CROSS)
@@ -45,6 +60,8 @@ BrushPreview::BrushPreview(Editor* editor)
   , m_withRealPreview(false)
   , m_screenPosition(0, 0)
   , m_editorPosition(0, 0)
+  , m_pixelsType(0)
+  , m_pixelsScale(0.0)
 {
 }
 
@@ -225,19 +242,43 @@ void BrushPreview::show(const gfx::Point& screenPos)
 
   // Save area and draw the cursor
   {
+    updateCursorPixels(spritePos);
+
+    const gfx::Point spriteScreenPos = m_editor->editorToScreen(spritePos);
+    m_drawnPixels.clear();
+    for (const auto& pt : m_screenPixels)
+      m_drawnPixels.push_back(m_screenPosition + pt);
+    for (const auto& pt : m_spritePixels)
+      m_drawnPixels.push_back(spriteScreenPos + pt);
+
+    // Test each pixel only if the cursor is partially visible
+    if (m_clippingRegion.contains(pixels_bounds(m_drawnPixels)) != gfx::Region::In) {
+      m_drawnPixels.erase(
+        std::remove_if(m_drawnPixels.begin(), m_drawnPixels.end(),
+                       [this](const gfx::Point& pt){
+                         return !m_clippingRegion.contains(pt);
+                       }),
+        m_drawnPixels.end());
+    }
+
     ui::ScreenGraphics g;
     ui::SetClip clip(&g, gfx::Rect(0, 0, g.width(), g.height()));
+    g.getPixels(m_drawnPixels, m_savedPixels);
 
-    forEachBrushPixel(&g, m_screenPosition, spritePos, ui_cursor_color, &BrushPreview::savePixelDelegate);
-    forEachBrushPixel(&g, m_screenPosition, spritePos, ui_cursor_color, &BrushPreview::drawPixelDelegate);
+    std::vector<gfx::Color> colors(m_savedPixels.size(), ui_cursor_color);
+    if (m_blackAndWhiteNegative) {
+      for (std::size_t i=0; i<colors.size(); ++i) {
+        gfx::Color c = m_savedPixels[i];
+        colors[i] = color_utils::blackandwhite_neg(
+          gfx::rgba(gfx::getr(c), gfx::getg(c), gfx::getb(c)));
+      }
+    }
+    g.putPixels(m_drawnPixels, colors);
   }
 
   // Cursor in the editor (model)
   m_onScreen = true;
   m_editorPosition = spritePos;
-
-  // Save the clipping-region to know where to clean the pixels
-  m_oldClippingRegion = m_clippingRegion;
 }
 
 // Cleans the brush cursor from the specified editor.
@@ -262,12 +303,23 @@ void BrushPreview::hide()
                                      m_editor->getUpdateRegion());
 
   {
-    // Restore pixels
+    // Restore the pixels which weren't painted again
+    if (m_clippingRegion.contains(pixels_bounds(m_drawnPixels)) != gfx::Region::In) {
+      std::size_t j = 0;
+      for (std::size_t i=0; i<m_drawnPixels.size(); ++i) {
+        if (m_clippingRegion.contains(m_drawnPixels[i])) {
+          m_drawnPixels[j] = m_drawnPixels[i];
+          m_savedPixels[j] = m_savedPixels[i];
+          ++j;
+        }
+      }
+      m_drawnPixels.resize(j);
+      m_savedPixels.resize(j);
+    }
+
     ui::ScreenGraphics g;
     ui::SetClip clip(&g, gfx::Rect(0, 0, g.width(), g.height()));
-
-    forEachBrushPixel(&g, m_screenPosition, m_editorPosition, gfx::ColorNone,
-                      &BrushPreview::clearPixelDelegate);
+    g.putPixels(m_drawnPixels, m_savedPixels);
   }
 
   // Clean pixel/brush preview
@@ -281,7 +333,8 @@ void BrushPreview::hide()
 
   m_onScreen = false;
   m_clippingRegion.clear();
-  m_oldClippingRegion.clear();
+  m_drawnPixels.clear();
+  m_savedPixels.clear();
 }
 
 void BrushPreview::redraw()
@@ -302,74 +355,70 @@ void BrushPreview::generateBoundaries()
 {
   BrushRef brush = getCurrentBrush();
 
-  if (m_brushBoundaries &&
-      m_brushGen == brush->gen())
-    return;
-
   bool isOnePixel =
     (m_editor->getCurrentEditorTool()->getPointShape(0)->isPixel() ||
      m_editor->getCurrentEditorTool()->getPointShape(0)->isFloodFill());
-  Image* brushImage = brush->image();
-  int w = (isOnePixel ? 1: brushImage->width());
-  int h = (isOnePixel ? 1: brushImage->height());
-
-  m_brushGen = brush->gen();
-  m_brushWidth = w;
-  m_brushHeight = h;
 
-  ImageRef mask;
+  BrushStampRef stamp;
   if (isOnePixel) {
-    mask.reset(Image::create(IMAGE_BITMAP, w, w));
-    mask->putPixel(0, 0, (color_t)1);
-  }
-  else if (brushImage->pixelFormat() != IMAGE_BITMAP) {
-    mask.reset(Image::create(IMAGE_BITMAP, w, h));
-
-    LockImageBits<BitmapTraits> bits(mask.get());
-    auto pos = bits.begin();
-    for (int v=0; v<h; ++v) {
-      for (int u=0; u<w; ++u) {
-        *pos = get_pixel(brushImage, u, v);
-        ++pos;
-      }
+    static BrushStampRef onePixel;
+    if (!onePixel) {
+      ImageRef mask(Image::create(IMAGE_BITMAP, 1, 1));
+      mask->putPixel(0, 0, (color_t)1);
+      onePixel = std::make_shared<BrushStamp>(mask);
     }
+    stamp = onePixel;
+  }
+  else {
+    // The stamps of generated brushes are shared by all brushes with
+    // the same type/size/angle, so the boundaries are calculated
+    // only once for each one.
+    stamp = brush->stamp();
   }
 
-  m_brushBoundaries.reset(
-    new MaskBoundaries(
-      (mask ? mask.get(): brushImage)));
+  if (!stamp || stamp == m_brushStamp)
+    return;
+
+  m_brushStamp = stamp;
+  m_brushWidth = stamp->image()->width();
+  m_brushHeight = stamp->image()->height();
 }
 
-void BrushPreview::forEachBrushPixel(
-  ui::Graphics* g,
-  const gfx::Point& screenPos,
-  const gfx::Point& spritePos,
-  gfx::Color color,
-  PixelDelegate pixelDelegate)
+void BrushPreview::updateCursorPixels(const gfx::Point& spritePos)
 {
-  m_savedPixelsIterator = 0;
+  // With fractional zoom levels the cursor pixels depend on the
+  // position of the sprite in the screen, so they are traced each
+  // time.
+  const double scale = m_editor->zoom().scale();
+  const bool cacheable = (scale == std::floor(scale));
+  if (cacheable &&
+      m_pixelsType == m_type &&
+      m_pixelsStamp == m_brushStamp &&
+      m_pixelsScale == scale)
+    return;
+
+  m_pixelsType = m_type;
+  m_pixelsStamp = m_brushStamp;
+  m_pixelsScale = (cacheable ? scale: 0.0);
+  m_screenPixels.clear();
+  m_spritePixels.clear();
 
   if (m_type & CROSS)
-    traceCrossPixels(g, screenPos, color, pixelDelegate);
+    traceCrossPixels(m_screenPixels);
 
   if (m_type & SELECTION_CROSS)
-    traceSelectionCrossPixels(g, spritePos, color, 1, pixelDelegate);
+    traceSelectionCrossPixels(1, m_spritePixels);
 
   if (m_type & BRUSH_BOUNDARIES)
-    traceBrushBoundaries(g, spritePos, color, pixelDelegate);
+    traceBrushBoundaries(spritePos, m_spritePixels);
 
   // Depending on the editor zoom, maybe we need subpixel movement (a
   // little dot inside the active pixel)
-  if (m_editor->zoom().scale() >= 4.0)
-    (this->*pixelDelegate)(g, screenPos, color);
-
-  m_savedPixelsLimit = m_savedPixelsIterator;
+  if (scale >= 4.0)
+    m_screenPixels.push_back(gfx::Point(0, 0));
 }
 
-void BrushPreview::traceCrossPixels(
-  ui::Graphics* g,
-  const gfx::Point& pt, gfx::Color color,
-  PixelDelegate pixelDelegate)
+void BrushPreview::traceCrossPixels(std::vector<gfx::Point>& pts)
 {
   static int cross[7*7] = {
     0, 0, 0, 1, 0, 0, 0,
@@ -380,16 +429,12 @@ void BrushPreview::traceCrossPixels(
     0, 0, 0, 1, 0, 0, 0,
     0, 0, 0, 1, 0, 0, 0,
   };
-  gfx::Point out;
   int u, v;
 
   for (v=0; v<7; v++) {
     for (u=0; u<7; u++) {
-      if (cross[v*7+u]) {
-        out.x = pt.x-3+u;
-        out.y = pt.y-3+v;
-        (this->*pixelDelegate)(g, out, color);
-      }
+      if (cross[v*7+u])
+        pts.push_back(gfx::Point(u-3, v-3));
     }
   }
 }
@@ -397,10 +442,7 @@ void BrushPreview::traceCrossPixels(
 //////////////////////////////////////////////////////////////////////
 // Old Thick Cross
 
-void BrushPreview::traceSelectionCrossPixels(
-  ui::Graphics* g,
-  const gfx::Point& pt, gfx::Color color,
-  int thickness, PixelDelegate pixelDelegate)
+void BrushPreview::traceSelectionCrossPixels(int thickness, std::vector<gfx::Point>& pts)
 {
   static int cross[6*6] = {
     0, 0, 1, 1, 0, 0,
@@ -410,7 +452,7 @@ void BrushPreview::traceSelectionCrossPixels(
     0, 0, 1, 1, 0, 0,
     0, 0, 1, 1, 0, 0,
   };
-  gfx::Point out, outpt = m_editor->editorToScreen(pt);
+  gfx::Point out;
   int u, v;
   int size = m_editor->zoom().apply(thickness/2);
   int size2 = m_editor->zoom().apply(thickness);
@@ -421,11 +463,9 @@ void BrushPreview::traceSelectionCrossPixels(
       if (!cross[v*6+u])
         continue;
 
-      out = outpt;
-      out.x += ((u<3) ? u-size-3: u-size-3+size2);
-      out.y += ((v<3) ? v-size-3: v-size-3+size2);
-
-      (this->*pixelDelegate)(g, out, color);
+      out.x = ((u<3) ? u-size-3: u-size-3+size2);
+      out.y = ((v<3) ? v-size-3: v-size-3+size2);
+      pts.push_back(out);
     }
   }
 }
@@ -433,18 +473,22 @@ void BrushPreview::traceSelectionCrossPixels(
 //////////////////////////////////////////////////////////////////////
 // Current Brush Bounds
 
-void BrushPreview::traceBrushBoundaries(ui::Graphics* g,
-                                        gfx::Point pos,
-                                        gfx::Color color,
-                                        PixelDelegate pixelDelegate)
+void BrushPreview::traceBrushBoundaries(const gfx::Point& spritePos,
+                                        std::vector<gfx::Point>& pts)
 {
+  if (!m_brushStamp)
+    return;
+
+  const gfx::Point origin = m_editor->editorToScreen(spritePos);
+  gfx::Point pos = spritePos;
   pos.x -= m_brushWidth/2;
   pos.y -= m_brushHeight/2;
 
-  for (const auto& seg : *m_brushBoundaries) {
+  for (const auto& seg : m_brushStamp->boundaries()) {
     gfx::Rect bounds = seg.bounds();
     bounds.offset(pos);
     bounds = m_editor->editorToScreen(bounds);
+    bounds.offset(-origin);
 
     if (seg.open()) {
       if (seg.vertical()) --bounds.x;
@@ -454,63 +498,13 @@ void BrushPreview::traceBrushBoundaries(ui::Graphics* g,
     gfx::Point pt(bounds.x, bounds.y);
     if (seg.vertical()) {
       for (; pt.y<bounds.y+bounds.h; ++pt.y)
-        (this->*pixelDelegate)(g, pt, color);
+        pts.push_back(pt);
     }
     else {
       for (; pt.x<bounds.x+bounds.w; ++pt.x)
-        (this->*pixelDelegate)(g, pt, color);
-    }
-  }
-}
-
-void BrushPreview::savePixelDelegate(ui::Graphics* g, const gfx::Point& pt, gfx::Color color)
-{
-  if (m_clippingRegion.contains(pt)) {
-    color_t c = g->getPixel(pt.x, pt.y);
-
-    if (m_savedPixelsIterator < (int)m_savedPixels.size())
-      m_savedPixels[m_savedPixelsIterator] = c;
-    else
-      m_savedPixels.push_back(c);
-
-    ++m_savedPixelsIterator;
-  }
-}
-
-void BrushPreview::drawPixelDelegate(ui::Graphics* gfx, const gfx::Point& pt, gfx::Color color)
-{
-  if (m_savedPixelsIterator < (int)m_savedPixels.size() &&
-      m_clippingRegion.contains(pt)) {
-    if (m_blackAndWhiteNegative) {
-      int c = m_savedPixels[m_savedPixelsIterator++];
-      int r = gfx::getr(c);
-      int g = gfx::getg(c);
-      int b = gfx::getb(c);
-
-      gfx->putPixel(color_utils::blackandwhite_neg(gfx::rgba(r, g, b)), pt.x, pt.y);
-    }
-    else {
-      gfx->putPixel(color, pt.x, pt.y);
-    }
-  }
-}
-
-void BrushPreview::clearPixelDelegate(ui::Graphics* g, const gfx::Point& pt, gfx::Color color)
-{
-  if (m_savedPixelsIterator < (int)m_savedPixels.size()) {
-    if (m_oldClippingRegion.contains(pt)) {
-      if (m_clippingRegion.contains(pt))
-        g->putPixel(m_savedPixels[m_savedPixelsIterator], pt.x, pt.y);
-      ++m_savedPixelsIterator;
+        pts.push_back(pt);
     }
   }
-
-#if _DEBUG
-  if (!(m_savedPixelsIterator <= m_savedPixelsLimit)) {
-    TRACE("m_savedPixelsIterator <= m_savedPixelsLimit: %d <= %d failed\n",
-          m_savedPixelsIterator, m_savedPixelsLimit);
-  }
-#endif
 }
 
 } // namespace app
@@ -12,7 +12,6 @@
 #include "doc/brush.h"
 #include "doc/color.h"
 #include "doc/frame.h"
-#include "doc/mask_boundaries.h"
 #include "gfx/color.h"
 #include "gfx/point.h"
 #include "gfx/rect.h"
@@ -54,26 +53,15 @@ namespace app {
     void invalidateRegion(const gfx::Region& region);
 
   private:
-    typedef void (BrushPreview::*PixelDelegate)(ui::Graphics*, const gfx::Point&, gfx::Color);
-
     doc::BrushRef getCurrentBrush();
     static doc::color_t getBrushColor(doc::Sprite* sprite, doc::Layer* layer);
 
     void generateBoundaries();
-    void forEachBrushPixel(
-      ui::Graphics* g,
-      const gfx::Point& screenPos,
-      const gfx::Point& spritePos,
-      gfx::Color color,
-      PixelDelegate pixelDelegate);
-
-    void traceCrossPixels(ui::Graphics* g, const gfx::Point& pt, gfx::Color color, PixelDelegate pixel);
-    void traceSelectionCrossPixels(ui::Graphics* g, const gfx::Point& pt, gfx::Color color, int thickness, PixelDelegate pixel);
-    void traceBrushBoundaries(ui::Graphics* g, gfx::Point pos, gfx::Color color, PixelDelegate pixel);
+    void updateCursorPixels(const gfx::Point& spritePos);
 
-    void savePixelDelegate(ui::Graphics* g, const gfx::Point& pt, gfx::Color color);
-    void drawPixelDelegate(ui::Graphics* g, const gfx::Point& pt, gfx::Color color);
-    void clearPixelDelegate(ui::Graphics* g, const gfx::Point& pt, gfx::Color color);
+    void traceCrossPixels(std::vector<gfx::Point>& pts);
+    void traceSelectionCrossPixels(int thickness, std::vector<gfx::Point>& pts);
+    void traceBrushBoundaries(const gfx::Point& spritePos, std::vector<gfx::Point>& pts);
 
     Editor* m_editor;
     int m_type;
@@ -89,17 +77,27 @@ namespace app {
     gfx::Point m_editorPosition; // Position in the editor (model)
 
     // Information about current brush
-    base::SharedPtr<doc::MaskBoundaries> m_brushBoundaries;
-    int m_brushGen;
+    doc::BrushStampRef m_brushStamp;
     int m_brushWidth;
     int m_brushHeight;
 
+    // Pixels of the cursor relative to the mouse position
+    // (m_screenPixels) and to the screen position of the sprite pixel
+    // below the mouse (m_spritePixels). They are traced again only
+    // when the cursor type, the brush or the zoom change.
+    std::vector<gfx::Point> m_screenPixels;
+    std::vector<gfx::Point> m_spritePixels;
+    int m_pixelsType;
+    doc::BrushStampRef m_pixelsStamp;
+    double m_pixelsScale;
+    gfx::Point m_pixelsSpritePos;
+
+    // Screen pixels of the cursor which are on the screen and the
+    // colors that were below them.
+    std::vector<gfx::Point> m_drawnPixels;
     std::vector<gfx::Color> m_savedPixels;
-    int m_savedPixelsIterator;
-    int m_savedPixelsLimit;
 
     gfx::Region m_clippingRegion;
-    gfx::Region m_oldClippingRegion;
 
     // Information stored in show() and used in hide() to clear the
     // brush preview in the exact same place.
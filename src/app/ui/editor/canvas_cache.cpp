@@ -0,0 +1,279 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/editor/canvas_cache.h"
+
+#include "base/mem_tags.h"
+#include "she/surface.h"
+#include "she/system.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace app {
+
+// Maximum size of the cached surface when the bounds are enlarged
+// (a 4K viewport).
+static const int kMaxCanvasPixels = 4096*2160;
+
+// All the canvas of all editors (used from the UI thread only)
+static std::vector<CanvasCache*> canvas_caches;
+
+// Bytes of a RGBA surface with the given bounds
+static std::size_t surface_bytes(const gfx::Rect& bounds)
+{
+  return std::size_t(bounds.w) * bounds.h * 4;
+}
+
+CanvasCache::CanvasCache()
+  : m_surface(nullptr)
+  , m_previous(nullptr)
+  , m_previousScale(1.0)
+  , m_previousBgColor(gfx::ColorNone)
+{
+  canvas_caches.push_back(this);
+}
+
+CanvasCache::~CanvasCache()
+{
+  canvas_caches.erase(
+    std::remove(canvas_caches.begin(), canvas_caches.end(), this),
+    canvas_caches.end());
+
+  discardPrevious();
+
+  if (m_surface) {
+    base::mem_tag_free(base::mem_tag::canvas, surface_bytes(m_bounds));
+    m_surface->dispose();
+  }
+}
+
+she::Surface* CanvasCache::prepare(const Key& key, const gfx::Rect& bounds)
+{
+  if (m_key != key) {
+    // The first key after rescale() is the new zoom level, any other
+    // change means that the previous canvas has nothing to show.
+    if (!m_key.empty())
+      discardPrevious();
+
+    m_key = key;
+    m_valid.clear();
+  }
+
+  if (!m_surface || !m_bounds.contains(bounds)) {
+    gfx::Rect newBounds = bounds;
+    if (m_surface) {
+      gfx::Rect united = m_bounds.createUnion(bounds);
+      if (united.w * united.h <= kMaxCanvasPixels)
+        newBounds = united;
+    }
+
+    she::Surface* newSurface =
+      she::instance()->createRgbaSurface(newBounds.w, newBounds.h);
+
+    // Keep the painted pixels that are still inside the new bounds
+    if (m_surface) {
+      if (newSurface && newSurface->nativeHandle() && !m_painted.isEmpty()) {
+        m_surface->blitTo(newSurface, 0, 0,
+                          m_bounds.x - newBounds.x,
+                          m_bounds.y - newBounds.y,
+                          m_bounds.w, m_bounds.h);
+        m_valid.createIntersection(m_valid, gfx::Region(newBounds));
+        m_painted.createIntersection(m_painted, gfx::Region(newBounds));
+      }
+      else {
+        m_valid.clear();
+        m_painted.clear();
+      }
+
+      base::mem_tag_free(base::mem_tag::canvas, surface_bytes(m_bounds));
+      m_surface->dispose();
+    }
+
+    m_surface = newSurface;
+    m_bounds = newBounds;
+    if (m_surface)
+      base::mem_tag_alloc(base::mem_tag::canvas, surface_bytes(m_bounds));
+  }
+
+  if (m_surface && !m_surface->nativeHandle())
+    return nullptr;
+
+  if (m_previous && m_surface) {
+    if (invalidRegion(bounds).isEmpty())
+      discardPrevious();
+    else
+      paintFromPrevious(bounds);
+  }
+
+  return m_surface;
+}
+
+gfx::Region CanvasCache::invalidRegion(const gfx::Rect& rc) const
+{
+  gfx::Region region(rc);
+  region.createSubtraction(region, m_valid);
+  return region;
+}
+
+void CanvasCache::copyFromOtherCanvas(const gfx::Rect& rc)
+{
+  if (!m_surface || !m_surface->nativeHandle())
+    return;
+
+  for (CanvasCache* other : canvas_caches) {
+    if (other == this ||
+        !other->m_surface ||
+        !other->m_surface->nativeHandle() ||
+        other->m_valid.isEmpty() ||
+        other->m_key != m_key)
+      continue;
+
+    gfx::Region region(rc & m_bounds & other->m_bounds);
+    region.createIntersection(region, other->m_valid);
+    region.createSubtraction(region, m_valid);
+
+    for (const gfx::Rect& copyRc : region) {
+      other->m_surface->blitTo(m_surface,
+                               copyRc.x - other->m_bounds.x,
+                               copyRc.y - other->m_bounds.y,
+                               copyRc.x - m_bounds.x,
+                               copyRc.y - m_bounds.y,
+                               copyRc.w, copyRc.h);
+    }
+    m_valid.createUnion(m_valid, region);
+    m_painted.createUnion(m_painted, region);
+  }
+}
+
+bool CanvasCache::isPainted(const gfx::Region& region) const
+{
+  gfx::Region unpainted(region);
+  unpainted.createSubtraction(unpainted, m_painted);
+  return unpainted.isEmpty();
+}
+
+void CanvasCache::validate(const gfx::Rect& rc)
+{
+  m_valid.createUnion(m_valid, gfx::Region(rc));
+  m_painted.createUnion(m_painted, gfx::Region(rc));
+}
+
+void CanvasCache::invalidate()
+{
+  m_valid.clear();
+}
+
+void CanvasCache::invalidate(const gfx::Region& region)
+{
+  m_valid.createSubtraction(m_valid, region);
+}
+
+void CanvasCache::rescale(double scale, gfx::Color bgColor)
+{
+  if (m_surface && m_surface->nativeHandle() && !m_painted.isEmpty()) {
+    discardPrevious();
+
+    m_previous = m_surface;
+    m_previousBounds = m_bounds;
+    m_previousPainted = m_painted;
+    m_previousScale = scale;
+
+    m_surface = nullptr;
+    m_bounds = gfx::Rect();
+  }
+  // Zoomed again before painting anything with the last zoom level
+  else if (m_previous) {
+    m_previousScale *= scale;
+  }
+
+  m_previousBgColor = bgColor;
+  m_key.clear();
+  m_valid.clear();
+  m_painted.clear();
+}
+
+// Fills the unpainted parts of "bounds" with the previous canvas
+// (nearest neighbor scaling), and marks them as painted.
+void CanvasCache::paintFromPrevious(const gfx::Rect& bounds)
+{
+  gfx::Region region(bounds & m_bounds);
+  region.createSubtraction(region, m_painted);
+  if (region.isEmpty())
+    return;
+
+  // Painted area of the previous canvas in the new coordinates
+  // (rounded inwards, so each pixel comes from a painted pixel).
+  const double s = m_previousScale;
+  gfx::Region scaled;
+  for (const gfx::Rect& rc : m_previousPainted) {
+    const int x1 = int(std::ceil(rc.x * s));
+    const int y1 = int(std::ceil(rc.y * s));
+    const int x2 = int(std::floor(rc.x2() * s));
+    const int y2 = int(std::floor(rc.y2() * s));
+    if (x1 < x2 && y1 < y2)
+      scaled.createUnion(scaled, gfx::Region(gfx::Rect(x1, y1, x2-x1, y2-y1)));
+  }
+
+  gfx::Region fromPrevious;
+  fromPrevious.createIntersection(region, scaled);
+
+  if (!fromPrevious.isEmpty()) {
+    she::SurfaceFormatData fmt;
+    m_surface->getFormat(&fmt);
+    const int bpp = fmt.bitsPerPixel / 8;
+
+    auto srcCoord = [s](int v, int origin, int size) {
+      return std::min(std::max(int(std::floor(v / s)) - origin, 0), size-1);
+    };
+
+    she::SurfaceLock lockDst(m_surface);
+    she::SurfaceLock lockSrc(m_previous);
+    std::vector<int> cols;
+
+    for (const gfx::Rect& rc : fromPrevious) {
+      cols.resize(rc.w);
+      for (int x=0; x<rc.w; ++x)
+        cols[x] = bpp * srcCoord(rc.x+x, m_previousBounds.x, m_previousBounds.w);
+
+      for (int y=rc.y; y<rc.y2(); ++y) {
+        const uint8_t* src = m_previous->getData(
+          0, srcCoord(y, m_previousBounds.y, m_previousBounds.h));
+        uint8_t* dst = m_surface->getData(rc.x - m_bounds.x, y - m_bounds.y);
+        for (int x=0; x<rc.w; ++x, dst += bpp)
+          std::copy(src + cols[x], src + cols[x] + bpp, dst);
+      }
+    }
+  }
+
+  // Parts that weren't visible with the previous zoom level (e.g.
+  // zooming out)
+  gfx::Region rest;
+  rest.createSubtraction(region, fromPrevious);
+  for (const gfx::Rect& rc : rest)
+    m_surface->fillRect(m_previousBgColor,
+                        gfx::Rect(rc).offset(-m_bounds.origin()));
+
+  m_painted.createUnion(m_painted, region);
+}
+
+void CanvasCache::discardPrevious()
+{
+  if (m_previous) {
+    base::mem_tag_free(base::mem_tag::canvas, surface_bytes(m_previousBounds));
+    m_previous->dispose();
+    m_previous = nullptr;
+  }
+  m_previousPainted.clear();
+}
+
+} // namespace app
@@ -0,0 +1,91 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "gfx/color.h"
+#include "gfx/point.h"
+#include "gfx/rect.h"
+#include "gfx/region.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace she {
+  class Surface;
+}
+
+namespace app {
+
+  // Rendered sprite (already converted to a she::Surface) of the
+  // editor. It's used to blit the areas of the sprite that didn't
+  // change since the last paint (scrolling, tiled mode copies, UI
+  // elements over the editor, marching ants, etc.).
+  //
+  // All coordinates are in zoomed sprite coordinates.
+  //
+  // Editors that show the same sprite/frame with the same zoom
+  // (e.g. the main editor and the preview window) generate the same
+  // key, so they can copy the pixels rendered by each other.
+  class CanvasCache {
+  public:
+    typedef std::vector<uint32_t> Key;
+
+    CanvasCache();
+    ~CanvasCache();
+
+    // Prepares the surface to draw the given bounds. If the key is
+    // different, all the valid areas are discarded. Returns nullptr
+    // if the surface cannot be created.
+    she::Surface* prepare(const Key& key, const gfx::Rect& bounds);
+
+    // Position of the surface in zoomed sprite coordinates.
+    const gfx::Rect& bounds() const { return m_bounds; }
+
+    // Returns the part of "rc" which must be rendered again.
+    gfx::Region invalidRegion(const gfx::Rect& rc) const;
+
+    // Returns true if the surface contains pixels rendered in some
+    // moment for the whole region (even if they aren't valid now, they
+    // can be displayed while the new ones are being rendered).
+    bool isPainted(const gfx::Region& region) const;
+
+    // Copies the parts of "rc" that were already rendered by other
+    // canvas with the same key, and validates them.
+    void copyFromOtherCanvas(const gfx::Rect& rc);
+
+    void validate(const gfx::Rect& rc);
+    void invalidate();
+    void invalidate(const gfx::Region& region);
+
+    // Called when the zoom changes by the given factor (new scale /
+    // old scale). The current pixels are kept as the "previous
+    // canvas", and the next prepare() calls fill the new surface
+    // with them scaled (or with "bgColor" where there is nothing to
+    // scale), so they can be displayed (as painted but not valid
+    // areas) while the new zoom level is rendered.
+    void rescale(double scale, gfx::Color bgColor);
+
+  private:
+    void paintFromPrevious(const gfx::Rect& bounds);
+    void discardPrevious();
+
+    Key m_key;
+    she::Surface* m_surface;
+    gfx::Rect m_bounds;
+    gfx::Region m_valid;
+    gfx::Region m_painted;
+
+    // Canvas of the previous zoom level (in its own coordinates).
+    she::Surface* m_previous;
+    gfx::Rect m_previousBounds;
+    gfx::Region m_previousPainted;
+    double m_previousScale;
+    gfx::Color m_previousBgColor;
+  };
+
+} // namespace app
@@ -14,8 +14,10 @@
 #include "app/commands/command.h"
 #include "app/commands/commands.h"
 #include "app/commands/params.h"
+#include "app/pref/preferences.h"
 #include "app/tools/controller.h"
 #include "app/tools/ink.h"
+#include "app/tools/stroke_recording.h"
 #include "app/tools/tool.h"
 #include "app/tools/tool_loop.h"
 #include "app/tools/tool_loop_manager.h"
@@ -25,6 +27,7 @@
 #include "app/ui/keyboard_shortcuts.h"
 #include "app/ui_context.h"
 #include "doc/layer.h"
+#include "ui/manager.h"
 #include "ui/message.h"
 #include "ui/system.h"
 
@@ -39,11 +42,24 @@ namespace app {
 
 using namespace ui;
 
+RegisterMessage kFlushMovementsMessage;
+
 DrawingState::DrawingState(tools::ToolLoop* toolLoop)
   : m_toolLoop(toolLoop)
   , m_toolLoopManager(new tools::ToolLoopManager(toolLoop))
   , m_mouseMoveReceived(false)
+  , m_flushPosted(false)
 {
+  m_toolLoopManager->setPredictionEnabled(
+    Preferences::instance().experimental.strokePrediction());
+
+  // Record the stroke (Help > Record Strokes)
+  if (tools::StrokeRecording* recording = tools::StrokeRecording::active()) {
+    recording->strokes().push_back(tools::RecordedStroke());
+    tools::RecordedStroke& stroke = recording->strokes().back();
+    m_toolLoopManager->setRecordedStroke(&stroke);
+    stroke.inkType = Preferences::instance().tool(toolLoop->getTool()).ink();
+  }
 }
 
 DrawingState::~DrawingState()
@@ -102,6 +118,8 @@ void DrawingState::initToolLoop(Editor* editor, MouseMessage* msg)
 
 void DrawingState::notifyToolLoopModifiersChange(Editor* editor)
 {
+  flushMovements(editor);
+
   if (!m_toolLoopManager->isCanceled())
     m_toolLoopManager->notifyToolLoopModifiersChange();
 }
@@ -111,6 +129,8 @@ bool DrawingState::onMouseDown(Editor* editor, MouseMessage* msg)
   // Drawing loop
   ASSERT(m_toolLoopManager != NULL);
 
+  flushMovements(editor);
+
   // Notify the mouse button down to the tool loop manager.
   m_toolLoopManager->pressButton(pointer_from_msg(editor, msg));
 
@@ -124,6 +144,8 @@ bool DrawingState::onMouseUp(Editor* editor, MouseMessage* msg)
 {
   ASSERT(m_toolLoopManager != NULL);
 
+  flushMovements(editor);
+
   // Selection tools are cancelled with a simple click (only "one
   // point" controller selection tools aren't cancelled with one click,
   // i.e. the magic wand).
@@ -154,21 +176,49 @@ bool DrawingState::onMouseMove(Editor* editor, MouseMessage* msg)
 
   m_mouseMoveReceived = true;
 
-  // It's needed to avoid some glitches with brush boundaries.
-  //
-  // TODO we should be able to avoid this if we correctly invalidate
-  // the BrushPreview::m_clippingRegion
-  HideBrushPreview hide(editor->brushPreview());
-
   // Infinite scroll
   gfx::Point mousePos = editor->autoScroll(msg, AutoScroll::MouseDir);
   tools::Pointer pointer(editor->screenToEditor(mousePos),
                          button_from_msg(msg),
                          msg->pointerType() == she::PointerType::Pen ? msg->pressure() : 1.0f);
 
-  // Notify mouse movement to the tool
-  ASSERT(m_toolLoopManager != NULL);
-  m_toolLoopManager->movement(pointer);
+  // Intermediate tablet packets or positions of coalesced mouse
+  // movements (the last one is this same mouse position). They're
+  // displaced in the same way as the mouse position if the
+  // auto-scroll moved it.
+  if (msg->samples().size() > 1) {
+    const gfx::Point delta = mousePos - msg->position();
+    const auto& samples = msg->samples();
+    for (std::size_t i=0; i+1<samples.size(); ++i) {
+      if (samples[i].time <= m_lastSampleTime)
+        continue;
+
+      tools::Pointer samplePointer(
+        editor->screenToEditor(samples[i].position + delta),
+        pointer.button(),
+        msg->pointerType() == she::PointerType::Pen ? samples[i].pressure: 1.0f);
+
+      // Points in the same sprite pixel add nothing to the stroke
+      if (!m_pendingPointers.empty() &&
+          m_pendingPointers.back().point() == samplePointer.point())
+        continue;
+
+      m_pendingPointers.push_back(samplePointer);
+    }
+    m_lastSampleTime = samples.back().time;
+  }
+
+  // The movement is processed with the other movements of this frame
+  // (the flush message is handled after all the mouse messages that
+  // are already in the queue).
+  m_pendingPointers.push_back(pointer);
+  if (!m_flushPosted) {
+    m_flushPosted = true;
+
+    Message* flushMsg = new Message(kFlushMovementsMessage);
+    flushMsg->addRecipient(editor);
+    Manager::getDefault()->enqueueMessage(flushMsg);
+  }
 
   // Save the last point.
   editor->setLastDrawingPosition(pointer.point());
@@ -176,6 +226,11 @@ bool DrawingState::onMouseMove(Editor* editor, MouseMessage* msg)
   return true;
 }
 
+void DrawingState::onFlushMovements(Editor* editor)
+{
+  flushMovements(editor);
+}
+
 bool DrawingState::onSetCursor(Editor* editor, const gfx::Point& mouseScreenPos)
 {
   if (m_toolLoop->getInk()->isEyedropper()) {
@@ -225,6 +280,23 @@ void DrawingState::onExposeSpritePixels(const gfx::Region& rgn)
     m_toolLoop->validateDstImage(rgn);
 }
 
+void DrawingState::flushMovements(Editor* editor)
+{
+  m_flushPosted = false;
+  if (m_pendingPointers.empty() || !m_toolLoopManager)
+    return;
+
+  // It's needed to avoid some glitches with brush boundaries.
+  //
+  // TODO we should be able to avoid this if we correctly invalidate
+  // the BrushPreview::m_clippingRegion
+  HideBrushPreview hide(editor->brushPreview());
+
+  // Notify all the mouse movements to the tool
+  m_toolLoopManager->movement(m_pendingPointers);
+  m_pendingPointers.clear();
+}
+
 void DrawingState::destroyLoopIfCanceled(Editor* editor)
 {
   // Cancel drawing loop
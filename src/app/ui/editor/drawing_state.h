@@ -7,9 +7,18 @@
 
 #pragma once
 
+#include "app/tools/pointer.h"
 #include "app/ui/editor/standby_state.h"
+#include "she/pointer_sample.h"
+#include "ui/register_message.h"
+
+#include <vector>
 
 namespace app {
+  // Sent to the editor to process the mouse movements received in
+  // the current frame.
+  extern ui::RegisterMessage kFlushMovementsMessage;
+
   namespace tools {
     class ToolLoop;
     class ToolLoopManager;
@@ -27,6 +36,7 @@ namespace app {
     virtual bool onKeyUp(Editor* editor, ui::KeyMessage* msg) override;
     virtual bool onUpdateStatusBar(Editor* editor) override;
     virtual void onExposeSpritePixels(const gfx::Region& rgn) override;
+    virtual void onFlushMovements(Editor* editor) override;
 
     // Drawing state doesn't require the brush-preview because we are
     // already drawing (viewing the real trace).
@@ -36,6 +46,7 @@ namespace app {
     void notifyToolLoopModifiersChange(Editor* editor);
 
   private:
+    void flushMovements(Editor* editor);
     void destroyLoopIfCanceled(Editor* editor);
     void destroyLoop(Editor* editor);
 
@@ -50,6 +61,15 @@ namespace app {
     // release the mouse button in the same location).
     bool m_mouseMoveReceived;
 
+    // Mouse movements received since the last flush. They are given
+    // to the tool loop manager all together once per frame.
+    std::vector<tools::Pointer> m_pendingPointers;
+    bool m_flushPosted;
+
+    // Time of the last tablet sample used (samples are never given
+    // twice to the tool loop).
+    she::PointerSample::Time m_lastSampleTime;
+
     // Stores the last drawing position before we start this
     // DrawingState. It's used to restore the last drawing position in
     // case this stroke is canceled.
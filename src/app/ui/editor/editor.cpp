@@ -37,6 +37,7 @@
 #include "app/ui/editor/moving_pixels_state.h"
 #include "app/ui/editor/pixels_movement.h"
 #include "app/ui/editor/play_state.h"
+#include "app/ui/editor/playback_cache.h"
 #include "app/ui/editor/standby_state.h"
 #include "app/ui/main_window.h"
 #include "app/ui/skin/skin_theme.h"
@@ -45,6 +46,8 @@
 #include "app/ui_context.h"
 #include "base/bind.h"
 #include "base/convert_to.h"
+#include "base/time.h"
+#include "base/trace_span.h"
 #include "doc/conversion_she.h"
 #include "doc/doc.h"
 #include "doc/document_event.h"
@@ -53,6 +56,7 @@
 #include "she/system.h"
 #include "ui/ui.h"
 
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 
@@ -70,9 +74,15 @@ public:
     , m_image(image)
     , m_offset(offset)
     , m_zoom(zoom)
+    , m_modified(false)
   {
   }
 
+  bool isImageModified() const
+  {
+    return m_modified;
+  }
+
   Editor* getEditor() override
   {
     return m_editor;
@@ -80,11 +90,13 @@ public:
 
   Image* getImage() override
   {
+    m_modified = true;
     return m_image;
   }
 
   void fillRect(const gfx::Rect& rect, uint32_t rgbaColor, int opacity) override
   {
+    m_modified = true;
     blend_rect(m_image,
       m_offset.x + m_zoom.apply(rect.x),
       m_offset.y + m_zoom.apply(rect.y),
@@ -97,6 +109,7 @@ private:
   Image* m_image;
   Point m_offset;
   Zoom m_zoom;
+  bool m_modified;
 };
 
 class EditorPostRenderImpl : public EditorPostRender {
@@ -142,9 +155,23 @@ private:
 // static
 doc::ImageBufferPtr Editor::m_renderBuffer;
 
+// If rendering the invalid area of the canvas would take more
+// milliseconds than this, it's rendered in a background thread.
+static const int kAsyncRenderTime = 50;
+
+// Milliseconds to check if the background render is ready.
+static const int kAsyncRenderPollTime = 10;
+
+// Grids with cells up to this size (in screen pixels) are drawn with
+// a GridPattern tile instead of one line for each row/column.
+static const int kMaxGridPatternCell = 16;
+
 // static
 AppRender Editor::m_renderEngine;
 
+// static
+Editor::RenderStats Editor::m_renderStats;
+
 Editor::Editor(Document* document, EditorFlags flags)
   : Widget(editor_type())
   , m_state(new StandbyState())
@@ -167,6 +194,9 @@ Editor::Editor(Document* document, EditorFlags flags)
   , m_flags(flags)
   , m_secondaryButton(false)
   , m_aniSpeed(1.0)
+  , m_playbackCache(nullptr)
+  , m_asyncRenderTimer(kAsyncRenderPollTime, this)
+  , m_renderTimePerPixel(0.0)
 {
   // Add the first state into the history.
   m_statesHistory.push(m_state);
@@ -220,6 +250,7 @@ Editor::~Editor()
   setCustomizationDelegate(NULL);
 
   m_antsTimer.stop();
+  m_asyncRenderTimer.stop();
 }
 
 void Editor::destroyEditorSharedInternals()
@@ -365,6 +396,12 @@ Site Editor::getSite() const
 void Editor::setZoom(const render::Zoom& zoom)
 {
   if (m_zoom != zoom) {
+    // The current canvas is displayed scaled to the new zoom level
+    // until it's rendered again (see renderCanvasInBackground()).
+    SkinTheme* theme = static_cast<SkinTheme*>(this->theme());
+    m_canvasCache.rescale(zoom.scale() / m_zoom.scale(),
+                          theme->colors.editorFace());
+
     m_zoom = zoom;
     notifyZoomChanged();
   }
@@ -436,63 +473,15 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
   if (rc.isEmpty())
     return;
 
+  const auto t0 = std::chrono::steady_clock::now();
+
   // Generate the rendered image
   if (!m_renderBuffer)
-    m_renderBuffer.reset(new doc::ImageBuffer());
+    m_renderBuffer.reset(new doc::ImageBuffer(1, doc::ImageBuffer::Uninitialized));
 
-  std::unique_ptr<Image> rendered = nullptr;
+  she::Surface* canvas = nullptr;
   try {
-    // Generate a "expose sprite pixels" notification. This is used by
-    // tool managers that need to validate this region (copy pixels from
-    // the original cel) before it can be used by the RenderEngine.
-    {
-      gfx::Rect expose = m_zoom.remove(rc);
-      // If the zoom level is less than 100%, we add extra pixels to
-      // the exposed area. Those pixels could be shown in the
-      // rendering process depending on each cel position.
-      // E.g. when we are drawing in a cel with position < (0,0)
-      if (m_zoom.scale() < 1.0) {
-        expose.enlarge(int(1./m_zoom.scale()));
-      }
-      // If the zoom level is more than %100 we add an extra pixel to
-      // expose just in case the zoom requires to display it.  Note:
-      // this is really necessary to avoid showing invalid destination
-      // areas in ToolLoopImpl.
-      else if (m_zoom.scale() > 1.0) {
-        expose.enlarge(1);
-      }
-      m_document->notifyExposeSpritePixels(m_sprite, gfx::Region(expose));
-    }
-
-    // Create a temporary RGB bitmap to draw all to it
-    rendered.reset(Image::create(IMAGE_RGB, rc.w, rc.h, m_renderBuffer));
-    m_renderEngine.setupBackground(m_document, rendered->pixelFormat());
-    m_renderEngine.disableOnionskin();
-
-    if ((m_flags & kShowOnionskin) == kShowOnionskin) {
-      if (m_docPref.onionskin.active()) {
-        OnionskinOptions opts(
-          (m_docPref.onionskin.type() == app::gen::OnionskinType::MERGE ?
-           render::OnionskinType::MERGE:
-           (m_docPref.onionskin.type() == app::gen::OnionskinType::RED_BLUE_TINT ?
-            render::OnionskinType::RED_BLUE_TINT:
-            render::OnionskinType::NONE)));
-
-        opts.position(m_docPref.onionskin.position());
-        opts.prevFrames(m_docPref.onionskin.prevFrames());
-        opts.nextFrames(m_docPref.onionskin.nextFrames());
-        opts.opacityBase(m_docPref.onionskin.opacityBase());
-        opts.opacityStep(m_docPref.onionskin.opacityStep());
-        opts.layer(m_docPref.onionskin.currentLayer() ? m_layer: nullptr);
-
-        FrameTag* tag = nullptr;
-        if (m_docPref.onionskin.loopTag())
-          tag = m_sprite->frameTags().innerTag(m_frame);
-        opts.loopTag(tag);
-
-        m_renderEngine.setOnionskin(opts);
-      }
-    }
+    setupRenderEngine(m_frame);
 
     ExtraCelRef extraCel = m_document->extraCel();
     if (extraCel && extraCel->type() != render::ExtraType::NONE) {
@@ -504,53 +493,329 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
         m_layer, m_frame);
     }
 
-    m_renderEngine.renderSprite(rendered.get(), m_sprite, m_frame,
-      gfx::Clip(0, 0, rc), m_zoom);
+    // Only the parts of the canvas that were modified since the last
+    // paint (or that were never painted) are rendered again.
+    CanvasCache::Key key;
+    m_renderEngine.makeRenderKey(key, m_sprite, IMAGE_RGB, m_frame, m_zoom);
+    canvas = m_canvasCache.prepare(key, rc);
+    if (canvas) {
+      m_renderEngine.setParallel(Preferences::instance().experimental.parallelRender());
+      m_renderEngine.setRenderCache(&m_renderCache, m_layer);
+      m_renderEngine.setOnionskinCache(&m_onionskinCache);
+
+      // Other editor of this same sprite could have already rendered
+      // this area (the preview image is modified without
+      // notifications, so it's always rendered by each editor).
+      if (!m_renderEngine.previewImage())
+        m_canvasCache.copyFromOtherCanvas(rc);
+
+      gfx::Region invalid = m_canvasCache.invalidRegion(rc);
+      for (const gfx::Rect& invalidRc : invalid)
+        m_renderStats.renderedPixels += invalidRc.w*invalidRc.h;
+
+      if (!invalid.isEmpty() &&
+          !renderCanvasInBackground(canvas, key, invalid)) {
+        for (const gfx::Rect& invalidRc : invalid) {
+          if (!drawPrerenderedCanvasRect(m_playbackCache, canvas, key, invalidRc))
+            renderCanvasRect(canvas, invalidRc);
+        }
+      }
+
+      m_renderEngine.setRenderCache(nullptr, nullptr);
+      m_renderEngine.setOnionskinCache(nullptr);
+    }
 
     m_renderEngine.removeExtraImage();
   }
   catch (const std::exception& e) {
+    m_renderEngine.setRenderCache(nullptr, nullptr);
+    m_renderEngine.setOnionskinCache(nullptr);
+    m_renderEngine.removeExtraImage();
+    m_canvasCache.invalidate();
     Console::showException(e);
+    return;
   }
 
-  if (rendered) {
-    // Pre-render decorator.
-    if ((m_flags & kShowDecorators) && m_decorator) {
-      EditorPreRenderImpl preRender(this, rendered.get(),
-        Point(-rc.x, -rc.y), m_zoom);
-      m_decorator->preRenderDecorator(&preRender);
+  if (canvas) {
+    const gfx::Rect& canvasBounds = m_canvasCache.bounds();
+    g->blit(canvas,
+            rc.x - canvasBounds.x,
+            rc.y - canvasBounds.y,
+            dest_x, dest_y, rc.w, rc.h);
+
+    m_brushPreview.invalidateRegion(
+      gfx::Region(
+        gfx::Rect(dest_x, dest_y, rc.w, rc.h)));
+
+    m_renderStats.paintedPixels += rc.w*rc.h;
+  }
+
+  const double renderTime = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - t0).count();
+  m_renderStats.renderTime = (m_renderStats.renderTime == 0.0 ? renderTime:
+                              (3.0*m_renderStats.renderTime + renderTime) / 4.0);
+}
+
+// Sets up the background and onionskin of the render engine to
+// render the given frame.
+void Editor::setupRenderEngine(frame_t frame)
+{
+  m_renderEngine.setupBackground(m_document, IMAGE_RGB);
+  m_renderEngine.disableOnionskin();
+
+  if ((m_flags & kShowOnionskin) == kShowOnionskin) {
+    if (m_docPref.onionskin.active()) {
+      OnionskinOptions opts(
+        (m_docPref.onionskin.type() == app::gen::OnionskinType::MERGE ?
+         render::OnionskinType::MERGE:
+         (m_docPref.onionskin.type() == app::gen::OnionskinType::RED_BLUE_TINT ?
+          render::OnionskinType::RED_BLUE_TINT:
+          render::OnionskinType::NONE)));
+
+      opts.position(m_docPref.onionskin.position());
+      opts.prevFrames(m_docPref.onionskin.prevFrames());
+      opts.nextFrames(m_docPref.onionskin.nextFrames());
+      opts.opacityBase(m_docPref.onionskin.opacityBase());
+      opts.opacityStep(m_docPref.onionskin.opacityStep());
+      opts.layer(m_docPref.onionskin.currentLayer() ? m_layer: nullptr);
+
+      FrameTag* tag = nullptr;
+      if (m_docPref.onionskin.loopTag())
+        tag = m_sprite->frameTags().innerTag(frame);
+      opts.loopTag(tag);
+
+      m_renderEngine.setOnionskin(opts);
+    }
+  }
+}
+
+void Editor::prerenderFrames(const std::vector<frame_t>& frames)
+{
+  if (!m_playbackCache)
+    return;
+
+  // The extra cel and the preview image can be modified/deleted at
+  // any time, so these frames are rendered by the editor.
+  ExtraCelRef extraCel = m_document->extraCel();
+  if ((extraCel && extraCel->type() != render::ExtraType::NONE) ||
+      m_renderEngine.previewImage())
+    return;
+
+  m_playbackCache->setArea(getRenderAheadArea(), m_zoom);
+
+  m_renderEngine.setParallel(Preferences::instance().experimental.parallelRender());
+
+  for (frame_t frame : frames) {
+    setupRenderEngine(frame);
+
+    CanvasCache::Key key;
+    m_renderEngine.makeRenderKey(key, m_sprite, IMAGE_RGB, frame, m_zoom);
+    m_playbackCache->request(m_document, m_sprite, frame, key, m_renderEngine);
+  }
+}
+
+// Visible area of the sprite (with an extra pixel for the zoom
+// levels less than 100%, see drawSpriteUnclippedRect()) in zoomed
+// sprite coordinates.
+gfx::Rect Editor::getRenderAheadArea()
+{
+  gfx::Rect area = getVisibleSpriteBounds();
+  if (m_zoom.scale() < 1.0)
+    area.enlarge(int(1./m_zoom.scale()));
+  return m_zoom.apply(area & m_sprite->bounds());
+}
+
+// Converts the frame rendered ahead by the given cache to the
+// canvas. Returns false if the frame isn't ready or it doesn't cover
+// the given rectangle.
+bool Editor::drawPrerenderedCanvasRect(PlaybackCache* cache,
+                                       she::Surface* canvas,
+                                       const CanvasCache::Key& key,
+                                       const gfx::Rect& rc)
+{
+  if (!cache ||
+      !cache->area().contains(rc))
+    return false;
+
+  ImageRef rendered = cache->get(m_frame, key);
+  if (!rendered)
+    return false;
+
+  const gfx::Rect& area = cache->area();
+  const Image* src = rendered.get();
+  int srcx = rc.x - area.x;
+  int srcy = rc.y - area.y;
+
+  // Pre-render decorator (over a copy of the rendered frame)
+  std::unique_ptr<Image> decoratedImage;
+  bool decorated = false;
+  if ((m_flags & kShowDecorators) && m_decorator) {
+    decoratedImage.reset(crop_image(src, srcx, srcy, rc.w, rc.h, 0));
+    EditorPreRenderImpl preRender(this, decoratedImage.get(),
+      Point(-rc.x, -rc.y), m_zoom);
+    m_decorator->preRenderDecorator(&preRender);
+    decorated = preRender.isImageModified();
+    if (decorated) {
+      src = decoratedImage.get();
+      srcx = srcy = 0;
     }
+  }
 
-    // Convert the render to a she::Surface
-    static she::Surface* tmp;
-    if (!tmp || tmp->width() < rc.w || tmp->height() < rc.h) {
-      if (tmp)
-        tmp->dispose();
+  const gfx::Rect& canvasBounds = m_canvasCache.bounds();
+  she::SurfaceLock lock(canvas);
+  convert_image_to_surface(src, m_sprite->palette(m_frame),
+    canvas, srcx, srcy,
+    rc.x - canvasBounds.x, rc.y - canvasBounds.y, rc.w, rc.h);
+
+  if (!decorated)
+    m_canvasCache.validate(rc);
+  return true;
+}
+
+// Renders the invalid region of the canvas in a background thread
+// when the previous renders show that it would block the UI for
+// too long. Meanwhile the previous pixels of the canvas are
+// displayed, and the editor is invalidated when the new frame is
+// ready. Returns false if the region must be rendered right now.
+bool Editor::renderCanvasInBackground(she::Surface* canvas,
+                                      const CanvasCache::Key& key,
+                                      const gfx::Region& invalid)
+{
+  // The extra cel and the preview image (e.g. the stroke being drawn)
+  // must be displayed immediately.
+  ExtraCelRef extraCel = m_document->extraCel();
+  if (m_playbackCache ||
+      m_renderEngine.previewImage() ||
+      (extraCel && extraCel->type() != render::ExtraType::NONE)) {
+    m_asyncRenderTimer.stop();
+    return false;
+  }
 
-      tmp = she::instance()->createRgbaSurface(rc.w, rc.h);
+  const gfx::Rect area = getRenderAheadArea();
+  double pixels = 0.0;
+  for (const gfx::Rect& rc : invalid) {
+    if (!area.contains(rc)) {
+      m_asyncRenderTimer.stop();
+      return false;
     }
+    pixels += double(rc.w) * double(rc.h);
+  }
+
+  if (pixels * m_renderTimePerPixel < kAsyncRenderTime) {
+    m_asyncRenderTimer.stop();
+    return false;
+  }
+
+  if (!m_asyncRender)
+    m_asyncRender.reset(new PlaybackCache(1));
+  m_asyncRender->setArea(area, m_zoom);
 
-    if (tmp->nativeHandle()) {
-      convert_image_to_surface(rendered.get(), m_sprite->palette(m_frame),
-        tmp, 0, 0, 0, 0, rc.w, rc.h);
+  // The frame is ready
+  if (m_asyncRender->get(m_frame, key)) {
+    for (const gfx::Rect& rc : invalid)
+      drawPrerenderedCanvasRect(m_asyncRender.get(), canvas, key, rc);
 
-      g->blit(tmp, 0, 0, dest_x, dest_y, rc.w, rc.h);
+    if (!area.isEmpty())
+      m_renderTimePerPixel = m_asyncRender->renderTime() / (double(area.w) * double(area.h));
+    m_asyncRenderTimer.stop();
+    return true;
+  }
 
-      m_brushPreview.invalidateRegion(
-        gfx::Region(
-          gfx::Rect(dest_x, dest_y, rc.w, rc.h)));
+  // We need something to show meanwhile
+  if (!m_canvasCache.isPainted(invalid)) {
+    m_asyncRenderTimer.stop();
+    return false;
+  }
+
+  m_asyncRender->request(m_document, m_sprite, m_frame, key, m_renderEngine);
+  m_asyncRenderKey = key;
+  m_asyncRenderTimer.start();
+  return true;
+}
+
+void Editor::renderCanvasRect(she::Surface* canvas, const gfx::Rect& rc)
+{
+  // Generate a "expose sprite pixels" notification. This is used by
+  // tool managers that need to validate this region (copy pixels from
+  // the original cel) before it can be used by the RenderEngine.
+  {
+    gfx::Rect expose = m_zoom.remove(rc);
+    // If the zoom level is less than 100%, we add extra pixels to
+    // the exposed area. Those pixels could be shown in the
+    // rendering process depending on each cel position.
+    // E.g. when we are drawing in a cel with position < (0,0)
+    if (m_zoom.scale() < 1.0) {
+      expose.enlarge(int(1./m_zoom.scale()));
+    }
+    // If the zoom level is more than %100 we add an extra pixel to
+    // expose just in case the zoom requires to display it.  Note:
+    // this is really necessary to avoid showing invalid destination
+    // areas in ToolLoopImpl.
+    else if (m_zoom.scale() > 1.0) {
+      expose.enlarge(1);
     }
+    m_document->notifyExposeSpritePixels(m_sprite, gfx::Region(expose));
+  }
+
+  const gfx::Rect& canvasBounds = m_canvasCache.bounds();
+  const gfx::Rect canvasRc(rc.x - canvasBounds.x,
+                           rc.y - canvasBounds.y, rc.w, rc.h);
+  she::SurfaceLock lock(canvas);
+
+  // Render directly into the canvas pixels when the surface has the
+  // same format of RGB images, or use a temporary RGB bitmap that is
+  // converted to the surface format.
+  std::unique_ptr<Image> rendered(create_image_view_from_surface(canvas, canvasRc));
+  const bool direct = (rendered != nullptr);
+  if (!direct)
+    rendered.reset(Image::create(IMAGE_RGB, rc.w, rc.h, m_renderBuffer));
+
+  const base::tick_t t0 = base::current_tick();
+  m_renderEngine.renderSprite(rendered.get(), m_sprite, m_frame,
+    gfx::Clip(0, 0, rc), m_zoom);
+  const double elapsed = double(base::current_tick() - t0);
+  if (rc.w * rc.h > 0) {
+    const double perPixel = elapsed / (double(rc.w) * double(rc.h));
+    m_renderTimePerPixel = (m_renderTimePerPixel == 0.0 ? perPixel:
+                            (3.0*m_renderTimePerPixel + perPixel) / 4.0);
+  }
+
+  // Pre-render decorator.
+  bool decorated = false;
+  if ((m_flags & kShowDecorators) && m_decorator) {
+    EditorPreRenderImpl preRender(this, rendered.get(),
+      Point(-rc.x, -rc.y), m_zoom);
+    m_decorator->preRenderDecorator(&preRender);
+    decorated = preRender.isImageModified();
+  }
+
+  // Convert the render to a she::Surface
+  if (!direct) {
+    convert_image_to_surface(rendered.get(), m_sprite->palette(m_frame),
+      canvas, 0, 0, canvasRc.x, canvasRc.y, rc.w, rc.h);
   }
+
+  // Decorated pixels depend on the editor state, so they are
+  // rendered again in the next paint.
+  if (!decorated)
+    m_canvasCache.validate(rc);
 }
 
 void Editor::drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& _rc)
 {
+  TRACE_SPAN("Editor::drawSpriteUnclippedRect");
   gfx::Rect rc = _rc;
   // For odd zoom scales minor than 100% we have to add an extra window
   // just to make sure the whole rectangle is drawn.
   if (m_zoom.scale() < 1.0)
     rc.inflate(int(1./m_zoom.scale()), int(1./m_zoom.scale()));
 
+  // The preview image (e.g. the tool loop destination or a filter
+  // preview) is modified without notifications, it must be rendered
+  // each time (but only once for all the tiled mode copies).
+  if (m_renderEngine.previewImage())
+    m_canvasCache.invalidate();
+
   gfx::Rect client = clientBounds();
   gfx::Rect spriteRect(
     client.x + m_padding.x,
@@ -619,7 +884,7 @@ void Editor::drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& _rc)
         }
 
         drawGrid(g, enclosingRect, Rect(0, 0, 1, 1),
-          m_docPref.pixelGrid.color(), alpha);
+          m_docPref.pixelGrid.color(), alpha, m_pixelGridPattern);
       }
 
       // Draw the grid
@@ -637,7 +902,7 @@ void Editor::drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& _rc)
 
           if (alpha > 8)
             drawGrid(g, spriteRect, m_docPref.grid.bounds(),
-              m_docPref.grid.color(), alpha);
+              m_docPref.grid.color(), alpha, m_gridPattern);
         }
       }
     }
@@ -704,8 +969,20 @@ void Editor::drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& _rc)
   }
 }
 
+void Editor::invalidateCanvas()
+{
+  m_canvasCache.invalidate();
+}
+
 void Editor::drawSpriteClipped(const gfx::Region& updateRegion)
 {
+  // The callers use this function to show modified sprite pixels
+  for (const Rect& updateRect : updateRegion) {
+    gfx::Rect rc = m_zoom.apply(updateRect);
+    rc.enlarge(1);
+    m_canvasCache.invalidate(gfx::Region(rc));
+  }
+
   Region screenRegion;
   getDrawableRegion(screenRegion, kCutTopWindows);
 
@@ -739,8 +1016,44 @@ void Editor::drawMask(Graphics* g)
   int x = m_padding.x;
   int y = m_padding.y;
 
-  for (const auto& seg : *m_document->getMaskBoundaries()) {
-    CheckedDrawMode checked(g, m_antsOffset);
+  // Lines outside the clipping area are skipped (drawMaskSafe()
+  // draws the mask once for each visible rectangle).
+  gfx::Rect clip = g->getClipBounds();
+  clip.offset(-x, -y);
+
+  CheckedDrawMode checked(g, m_antsOffset);
+
+  for (const gfx::Rect& bounds : getMaskLines()) {
+    // The color doesn't matter, we are using CheckedDrawMode
+    if (bounds.w == 0) {
+      if (!clip.intersects(gfx::Rect(bounds.x, bounds.y, 1, bounds.h)))
+        continue;
+      g->drawVLine(gfx::rgba(0, 0, 0), x+bounds.x, y+bounds.y, bounds.h);
+    }
+    else {
+      if (!clip.intersects(gfx::Rect(bounds.x, bounds.y, bounds.w, 1)))
+        continue;
+      g->drawHLine(gfx::rgba(0, 0, 0), x+bounds.x, y+bounds.y, bounds.w);
+    }
+  }
+}
+
+const std::vector<gfx::Rect>& Editor::getMaskLines()
+{
+  auto& cache = m_maskLines;
+  if (cache.version == m_document->maskBoundariesVersion() &&
+      cache.zoom == m_zoom)
+    return cache.lines;
+
+  cache.version = m_document->maskBoundariesVersion();
+  cache.zoom = m_zoom;
+  cache.lines.clear();
+
+  const MaskBoundaries* boundaries = m_document->getMaskBoundaries();
+  if (!boundaries)
+    return cache.lines;
+
+  for (const auto& seg : *boundaries) {
     gfx::Rect bounds = m_zoom.apply(seg.bounds());
 
     if (m_zoom.scale() >= 1.0) {
@@ -750,12 +1063,14 @@ void Editor::drawMask(Graphics* g)
       }
     }
 
-    // The color doesn't matter, we are using CheckedDrawMode
     if (seg.vertical())
-      g->drawVLine(gfx::rgba(0, 0, 0), x+bounds.x, y+bounds.y, bounds.h);
+      bounds.w = 0;
     else
-      g->drawHLine(gfx::rgba(0, 0, 0), x+bounds.x, y+bounds.y, bounds.w);
+      bounds.h = 0;
+
+    cache.lines.push_back(bounds);
   }
+  return cache.lines;
 }
 
 void Editor::drawMaskSafe()
@@ -781,7 +1096,7 @@ void Editor::drawMaskSafe()
   }
 }
 
-void Editor::drawGrid(Graphics* g, const gfx::Rect& spriteBounds, const Rect& gridBounds, const app::Color& color, int alpha)
+void Editor::drawGrid(Graphics* g, const gfx::Rect& spriteBounds, const Rect& gridBounds, const app::Color& color, int alpha, GridPattern& pattern)
 {
   if ((m_flags & kShowGrid) == 0)
     return;
@@ -820,21 +1135,53 @@ void Editor::drawGrid(Graphics* g, const gfx::Rect& spriteBounds, const Rect& gr
     gfx::getg(grid_color),
     gfx::getb(grid_color), alpha);
 
-  // Draw horizontal lines
   int x1 = grid.x;
   int y1 = grid.y;
   int x2 = grid.x + spriteBounds.w;
   int y2 = grid.y + spriteBounds.h;
 
-  for (int c=y1; c<y2; c+=grid.h)
-    g->drawHLine(grid_color, x1, c, spriteBounds.w);
+  // Only the part of the grid inside the clipping region is drawn
+  // (the lines cannot be longer than the repainted area).
+  const gfx::Rect area =
+    g->getClipBounds() & gfx::Rect(x1, y1, spriteBounds.w+1, spriteBounds.h);
+  if (area.isEmpty())
+    return;
 
-  // Draw vertical lines
-  for (int c=x1; c<=x2; c+=grid.w)
-    g->drawVLine(grid_color, c, y1, spriteBounds.h);
+  she::Surface* tile = nullptr;
+  if (grid.w <= kMaxGridPatternCell && grid.h <= kMaxGridPatternCell)
+    tile = pattern.tile(grid.size(), grid_color);
+
+  if (tile) {
+    // Blend the tiles that intersect the area (the first tile starts
+    // in a multiple of the tile size from the grid origin)
+    IntersectClip clip(g, area);
+    if (clip) {
+      const int tw = tile->width();
+      const int th = tile->height();
+      const int tx = x1 + (area.x - x1) / tw * tw;
+      const int ty = y1 + (area.y - y1) / th * th;
+
+      for (int y=ty; y<area.y2(); y+=th)
+        for (int x=tx; x<area.x2(); x+=tw)
+          g->drawRgbaSurface(tile, x, y);
+    }
+  }
+  else {
+    // Draw horizontal lines
+    for (int c=y1 + (area.y - y1 + grid.h - 1) / grid.h * grid.h;
+         c<area.y2(); c+=grid.h)
+      g->drawHLine(grid_color, area.x, c, area.w);
+
+    // Draw vertical lines
+    for (int c=x1 + (area.x - x1 + grid.w - 1) / grid.w * grid.w;
+         c<area.x2(); c+=grid.w)
+      g->drawVLine(grid_color, c, area.y, area.h);
+  }
 
-  g->drawVLine(grid_color, x2 - 1, y1, spriteBounds.h);
-  g->drawHLine(grid_color, x1, y2 - 1, spriteBounds.w);
+  if (x2-1 >= area.x && x2-1 < area.x2())
+    g->drawVLine(grid_color, x2 - 1, area.y, area.h);
+  if (y2-1 >= area.y && y2-1 < area.y2())
+    g->drawHLine(grid_color, area.x, y2 - 1, area.w);
 }
 
 void Editor::flashCurrentLayer()
@@ -1163,6 +1510,13 @@ bool Editor::onProcessMessage(Message* msg)
           m_antsTimer.stop();
         }
       }
+      else if (static_cast<TimerMessage*>(msg)->timer() == &m_asyncRenderTimer) {
+        if (!m_asyncRender ||
+            m_asyncRender->get(m_frame, m_asyncRenderKey)) {
+          m_asyncRenderTimer.stop();
+          invalidate();
+        }
+      }
       break;
 
     case kMouseEnterMessage:
@@ -1302,6 +1656,12 @@ bool Editor::onProcessMessage(Message* msg)
       return true;
   }
 
+  if (msg->type() == kFlushMovementsMessage) {
+    EditorStatePtr holdState(m_state);
+    m_state->onFlushMovements(this);
+    return true;
+  }
+
   return Widget::onProcessMessage(msg);
 }
 
@@ -15,15 +15,18 @@
 #include "app/tools/tool_loop_modifiers.h"
 #include "app/ui/color_source.h"
 #include "app/ui/editor/brush_preview.h"
+#include "app/ui/editor/canvas_cache.h"
 #include "app/ui/editor/editor_observers.h"
 #include "app/ui/editor/editor_state.h"
 #include "app/ui/editor/editor_states_history.h"
+#include "app/ui/editor/grid_pattern.h"
 #include "base/connection.h"
 #include "doc/document_observer.h"
 #include "doc/frame.h"
 #include "doc/image_buffer.h"
 #include "filters/tiled_mode.h"
 #include "gfx/fwd.h"
+#include "render/render_cache.h"
 #include "render/zoom.h"
 #include "ui/base.h"
 #include "ui/cursor_type.h"
@@ -31,6 +34,9 @@
 #include "ui/timer.h"
 #include "ui/widget.h"
 
+#include <memory>
+#include <vector>
+
 namespace doc {
   class Layer;
   class Site;
@@ -39,6 +45,9 @@ namespace doc {
 namespace gfx {
   class Region;
 }
+namespace she {
+  class Surface;
+}
 namespace ui {
   class Graphics;
   class View;
@@ -49,6 +58,7 @@ namespace app {
   class DocumentView;
   class EditorCustomizationDelegate;
   class PixelsMovement;
+  class PlaybackCache;
 
   namespace tools {
     class Ink;
@@ -144,6 +154,11 @@ namespace app {
     void drawSpriteClipped(const gfx::Region& updateRegion);
     void drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& rc);
 
+    // Discards the cached canvas (e.g. when the sprite is modified
+    // but the editor is hidden). Use drawSpriteClipped() to redraw
+    // specific areas of the sprite.
+    void invalidateCanvas();
+
     void flashCurrentLayer();
 
     gfx::Point screenToEditor(const gfx::Point& pt);
@@ -210,6 +225,14 @@ namespace app {
     double getAnimationSpeedMultiplier() const;
     void setAnimationSpeedMultiplier(double speed);
 
+    // Frames rendered ahead by PlayState. The editor uses them
+    // (instead of rendering the sprite) while they are valid.
+    void setPlaybackCache(PlaybackCache* cache) { m_playbackCache = cache; }
+
+    // Queues the given frames to be rendered in the playback cache
+    // with the current render settings of the editor.
+    void prerenderFrames(const std::vector<frame_t>& frames);
+
     // Functions to be used in EditorState::onSetCursor()
     void showMouseCursor(ui::CursorType cursorType);
     void showBrushPreview(const gfx::Point& pos);
@@ -223,6 +246,14 @@ namespace app {
 
     AppRender& renderEngine() { return m_renderEngine; }
 
+    // Rendering stats of the sprite area of all editors.
+    struct RenderStats {
+      double renderTime = 0.0;        // Average milliseconds to draw a sprite rectangle
+      std::size_t paintedPixels = 0;  // Pixels blitted from the canvas cache
+      std::size_t renderedPixels = 0; // Pixels rendered again (canvas cache misses)
+    };
+    static const RenderStats& renderStats() { return m_renderStats; }
+
     // IColorSource
     app::Color getColorByPosition(const gfx::Point& pos) override;
 
@@ -248,8 +279,9 @@ namespace app {
 
     void drawMaskSafe();
     void drawMask(ui::Graphics* g);
+    const std::vector<gfx::Rect>& getMaskLines();
     void drawGrid(ui::Graphics* g, const gfx::Rect& spriteBounds, const gfx::Rect& gridBounds,
-      const app::Color& color, int alpha);
+      const app::Color& color, int alpha, GridPattern& pattern);
 
     void setCursor(const gfx::Point& mouseScreenPos);
 
@@ -257,6 +289,16 @@ namespace app {
     // You should setup the clip of the screen before calling this
     // routine.
     void drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& rc, int dx, int dy);
+    void renderCanvasRect(she::Surface* canvas, const gfx::Rect& rc);
+    bool drawPrerenderedCanvasRect(PlaybackCache* cache,
+                                   she::Surface* canvas,
+                                   const CanvasCache::Key& key,
+                                   const gfx::Rect& rc);
+    bool renderCanvasInBackground(she::Surface* canvas,
+                                  const CanvasCache::Key& key,
+                                  const gfx::Region& invalid);
+    gfx::Rect getRenderAheadArea();
+    void setupRenderEngine(frame_t frame);
 
     gfx::Point calcExtraPadding(const render::Zoom& zoom);
 
@@ -296,6 +338,15 @@ namespace app {
     ui::Timer m_antsTimer;
     int m_antsOffset;
 
+    // Mask boundaries with the editor zoom applied (vertical lines
+    // have w=0, horizontal lines have h=0), so each tick of the
+    // marching ants doesn't need to transform each segment again.
+    struct {
+      int version = -1;
+      render::Zoom zoom = render::Zoom(1, 1);
+      std::vector<gfx::Rect> lines;
+    } m_maskLines;
+
     base::ScopedConnection m_fgColorChangeConn;
     base::ScopedConnection m_contextBarBrushChangeConn;
     base::ScopedConnection m_showExtrasConn;
@@ -333,6 +384,33 @@ namespace app {
     // same document can show the same preview image/stroke being drawn
     // (search for Render::setPreviewImage()).
     static AppRender m_renderEngine;
+
+    static RenderStats m_renderStats;
+
+    // Flattened layers below the active layer (each editor can have
+    // a different active layer/frame/zoom).
+    render::RenderCache m_renderCache;
+    render::OnionskinCache m_onionskinCache;
+
+    // Rendered sprite converted to the screen format.
+    CanvasCache m_canvasCache;
+
+    // Tiles to draw the pixel grid and the grid with small cells.
+    GridPattern m_pixelGridPattern;
+    GridPattern m_gridPattern;
+
+    // Frames rendered ahead while the animation is played (owned by
+    // PlayState, it can be nullptr).
+    PlaybackCache* m_playbackCache;
+
+    // Renders the current frame in a background thread when it's too
+    // slow to render it in the UI thread (created on demand).
+    std::unique_ptr<PlaybackCache> m_asyncRender;
+    CanvasCache::Key m_asyncRenderKey;
+    ui::Timer m_asyncRenderTimer;
+
+    // Average milliseconds needed to render each pixel of the canvas.
+    double m_renderTimePerPixel;
   };
 
   ui::WidgetType editor_type();
@@ -106,6 +106,11 @@ namespace app {
     // When a part of the sprite will be exposed.
     virtual void onExposeSpritePixels(const gfx::Region& rgn) { }
 
+    // Called once per frame (after all the mouse movements of the
+    // frame were received) when the state asked for it with a
+    // kFlushMovementsMessage.
+    virtual void onFlushMovements(Editor* editor) { }
+
     // Returns true if the this state requires the brush-preview as
     // drawing cursor.
     virtual bool requireBrushPreview() { return false; }
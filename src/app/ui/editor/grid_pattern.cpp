@@ -0,0 +1,92 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/editor/grid_pattern.h"
+
+#include "base/mem_tags.h"
+#include "she/surface.h"
+#include "she/system.h"
+
+namespace app {
+
+// Minimum width/height of the tile (it's enlarged to a whole number
+// of cells).
+static const int kMinTileSize = 256;
+
+// Bytes of a RGBA surface with the given size
+static std::size_t surface_bytes(const gfx::Size& size)
+{
+  return std::size_t(size.w) * size.h * 4;
+}
+
+GridPattern::GridPattern()
+  : m_surface(nullptr)
+  , m_color(gfx::ColorNone)
+{
+}
+
+GridPattern::~GridPattern()
+{
+  if (m_surface) {
+    base::mem_tag_free(base::mem_tag::canvas,
+                       surface_bytes(gfx::Size(m_surface->width(),
+                                               m_surface->height())));
+    m_surface->dispose();
+  }
+}
+
+she::Surface* GridPattern::tile(const gfx::Size& cellSize, gfx::Color color)
+{
+  if (m_surface &&
+      m_cellSize == cellSize &&
+      m_color == color)
+    return m_surface;
+
+  const gfx::Size size(
+    cellSize.w * ((kMinTileSize + cellSize.w - 1) / cellSize.w),
+    cellSize.h * ((kMinTileSize + cellSize.h - 1) / cellSize.h));
+
+  if (!m_surface ||
+      m_surface->width() != size.w ||
+      m_surface->height() != size.h) {
+    if (m_surface) {
+      base::mem_tag_free(base::mem_tag::canvas,
+                         surface_bytes(gfx::Size(m_surface->width(),
+                                                 m_surface->height())));
+      m_surface->dispose();
+    }
+    m_surface = she::instance()->createRgbaSurface(size.w, size.h);
+    if (!m_surface)
+      return nullptr;
+    base::mem_tag_alloc(base::mem_tag::canvas, surface_bytes(size));
+  }
+
+  m_cellSize = cellSize;
+  m_color = color;
+
+  // The pixels are written (not blended) so the tile keeps the alpha
+  // of the color.
+  she::SurfaceLock lock(m_surface);
+  m_surface->clear();
+  for (int y=0; y<size.h; ++y) {
+    if ((y % cellSize.h) == 0) {
+      for (int x=0; x<size.w; ++x)
+        m_surface->putPixel(color, x, y);
+    }
+    else {
+      for (int x=0; x<size.w; x+=cellSize.w)
+        m_surface->putPixel(color, x, y);
+    }
+  }
+  return m_surface;
+}
+
+} // namespace app
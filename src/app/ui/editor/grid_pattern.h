@@ -0,0 +1,42 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "gfx/color.h"
+#include "gfx/size.h"
+
+namespace she {
+  class Surface;
+}
+
+namespace app {
+
+  // RGBA tile with the lines of several cells of a grid (the top and
+  // left lines of each cell), so a grid with small cells (e.g. the
+  // pixel grid at high zoom levels) can be drawn blending a few
+  // tiles instead of drawing hundreds of lines.
+  class GridPattern {
+  public:
+    GridPattern();
+    ~GridPattern();
+
+    // Returns the tile for a grid of cells of the given size (in
+    // screen pixels), it's created again only if the size or the
+    // color changed. The tile contains a whole number of cells.
+    she::Surface* tile(const gfx::Size& cellSize, gfx::Color color);
+
+  private:
+    she::Surface* m_surface;
+    gfx::Size m_cellSize;
+    gfx::Color m_color;
+
+    DISABLE_COPYING(GridPattern);
+  };
+
+} // namespace app
@@ -44,11 +44,54 @@
 
 namespace app {
 
+// Milliseconds that the mouse must stay still while a handle is
+// dragged to replace the fast preview with the selected algorithm.
+static const int kHighQualityIdleTime = 250;
+
 template<typename T>
 static inline const base::Vector2d<double> point2Vector(const gfx::PointT<T>& pt) {
   return base::Vector2d<double>(pt.x, pt.y);
 }
 
+// Draws "src" transformed to the given corners. It can be called
+// from a worker thread (it doesn't touch the UI), and it throws
+// std::bad_alloc if there is not enough memory for RotSprite.
+static void transform_image(tools::RotationAlgorithm rotAlgo,
+                            doc::Image* dst, const doc::Image* src, const doc::Image* mask,
+                            const Transformation::Corners& corners,
+                            const gfx::Point& leftTop)
+{
+  switch (rotAlgo) {
+
+    case tools::RotationAlgorithm::FAST:
+      doc::algorithm::parallelogram(
+        dst, src, mask,
+        int(corners.leftTop().x-leftTop.x),
+        int(corners.leftTop().y-leftTop.y),
+        int(corners.rightTop().x-leftTop.x),
+        int(corners.rightTop().y-leftTop.y),
+        int(corners.rightBottom().x-leftTop.x),
+        int(corners.rightBottom().y-leftTop.y),
+        int(corners.leftBottom().x-leftTop.x),
+        int(corners.leftBottom().y-leftTop.y));
+      break;
+
+    case tools::RotationAlgorithm::ROTSPRITE:
+      doc::algorithm::rotsprite_image(
+        dst, src, mask,
+        int(corners.leftTop().x-leftTop.x),
+        int(corners.leftTop().y-leftTop.y),
+        int(corners.rightTop().x-leftTop.x),
+        int(corners.rightTop().y-leftTop.y),
+        int(corners.rightBottom().x-leftTop.x),
+        int(corners.rightBottom().y-leftTop.y),
+        int(corners.leftBottom().x-leftTop.x),
+        int(corners.leftBottom().y-leftTop.y));
+      break;
+
+  }
+}
+
 PixelsMovement::PixelsMovement(
   Context* context,
   Site site,
@@ -68,6 +111,10 @@ PixelsMovement::PixelsMovement(
   , m_originalImage(Image::createCopy(moveThis))
   , m_opaque(false)
   , m_maskColor(m_sprite->transparentColor())
+  , m_fastPreview(false)
+  , m_extraIsPreview(false)
+  , m_highQualityTimer(kHighQualityIdleTime)
+  , m_extraVersion(std::make_shared<int>(0))
 {
   Transformation transform(mask->bounds());
   set_pivot_from_preferences(transform);
@@ -87,6 +134,8 @@ PixelsMovement::PixelsMovement(
   m_rotAlgoConn =
     Preferences::instance().selection.rotationAlgorithm.AfterChange.connect(
       base::Bind<void>(&PixelsMovement::onRotationAlgorithmChange, this));
+  m_highQualityTimer.Tick.connect(
+    base::Bind<void>(&PixelsMovement::startHighQualityRedraw, this));
 
   // The extra cel must be null, because if it's not null, it means
   // that someone else is using it (e.g. the editor brush preview),
@@ -126,9 +175,14 @@ PixelsMovement::PixelsMovement(
 
 PixelsMovement::~PixelsMovement()
 {
+  cancelHighQualityRedraw();
+
   delete m_originalImage;
   delete m_initialMask;
   delete m_currentMask;
+
+  // Free the scaled copy of the image that was rotated with RotSprite
+  doc::algorithm::clear_rotsprite_cache();
 }
 
 void PixelsMovement::flipImage(doc::algorithm::FlipType flipType)
@@ -555,12 +609,24 @@ void PixelsMovement::dropImageTemporarily()
 
     update_screen_for_document(m_document);
   }
+
+  // Replace the fast preview with the selected algorithm.
+  if (m_extraIsPreview)
+    startHighQualityRedraw();
 }
 
 void PixelsMovement::dropImage()
 {
   m_isDragging = false;
 
+  // The stamped pixels must be transformed with the selected
+  // algorithm, so we cannot wait for the worker thread.
+  if (m_extraIsPreview) {
+    ContextWriter writer(m_reader, 1000);
+    redrawExtraImage();
+  }
+  cancelHighQualityRedraw();
+
   // Stamp the image in the current layer.
   stampImage();
 
@@ -576,6 +642,7 @@ void PixelsMovement::dropImage()
 void PixelsMovement::discardImage(bool commit)
 {
   m_isDragging = false;
+  cancelHighQualityRedraw();
 
   // Deselect the mask (here we don't stamp the image)
   m_transaction.execute(new cmd::DeselectMask(m_document));
@@ -637,9 +704,99 @@ void PixelsMovement::redrawExtraImage()
   m_extraCel->setBlendMode(static_cast<LayerImage*>(m_layer)->blendMode());
   m_document->setExtraCel(m_extraCel);
 
+  // A result of the worker thread for a previous extra cel is useless
+  // now.
+  cancelHighQualityRedraw();
+
   // Draw the transformed pixels in the extra-cel which is the chunk
   // of pixels that the user is moving.
+  m_extraIsPreview = (m_isDragging && needsHighQualityAlgorithm());
+  m_fastPreview = m_extraIsPreview;
   drawImage(m_extraCel->image(), bounds.origin(), true);
+  m_fastPreview = false;
+
+  if (m_extraIsPreview)
+    m_highQualityTimer.start();
+}
+
+// Transforms the image with the selected algorithm in a worker
+// thread, and replaces the fast preview of the extra cel with the
+// result (if the transformation didn't change in the meantime).
+void PixelsMovement::startHighQualityRedraw()
+{
+  m_highQualityTimer.stop();
+  if (!m_extraIsPreview || !m_highQualityTask.done())
+    return;
+
+  const tools::RotationAlgorithm rotAlgo =
+    Preferences::instance().selection.rotationAlgorithm();
+  const gfx::Rect bounds = m_currentData.transformedBounds();
+
+  Transformation::Corners corners;
+  m_currentData.transformBox(corners);
+
+  // The worker thread uses its own copies, as the original image can
+  // be flipped and the layer pixels can change before it finishes.
+  std::shared_ptr<Image> dst(Image::create(m_sprite->pixelFormat(), bounds.w, bounds.h));
+  prepareImage(dst.get(), bounds.origin(), true);
+  std::shared_ptr<const Image> src(Image::createCopy(m_originalImage));
+  std::shared_ptr<const Mask> mask(new Mask(*m_initialMask));
+
+  const int version = *m_extraVersion;
+  std::weak_ptr<int> weakVersion(m_extraVersion);
+
+  m_highQualityTask = TaskManager::instance().addTask<std::shared_ptr<Image>>(
+    [rotAlgo, dst, src, mask, corners, bounds]() -> std::shared_ptr<Image> {
+      try {
+        transform_image(rotAlgo, dst.get(), src.get(), mask->bitmap(),
+                        corners, bounds.origin());
+        return dst;
+      }
+      catch (const std::bad_alloc&) {
+        // Keep the fast preview
+        return nullptr;
+      }
+    },
+    [this, version, weakVersion](std::shared_ptr<Image>&& result) {
+      std::shared_ptr<int> currentVersion = weakVersion.lock();
+      if (!result || !currentVersion || *currentVersion != version)
+        return;
+
+      try {
+        ContextWriter writer(m_reader, 1000);
+        Image* image = m_extraCel->image();
+        ASSERT(image->bounds() == result->bounds());
+        image->copy(result.get(), gfx::Clip(result->bounds()));
+        m_extraIsPreview = false;
+
+        m_document->notifySpritePixelsModified(
+          m_sprite, gfx::Region(m_extraCel->cel()->bounds()), m_site.frame());
+      }
+      catch (const std::exception& ex) {
+        Console::showException(ex);
+      }
+    },
+    []{});
+}
+
+void PixelsMovement::cancelHighQualityRedraw()
+{
+  m_highQualityTimer.stop();
+  ++*m_extraVersion;
+  m_highQualityTask.abort();
+  m_highQualityTask = TaskHandle();
+}
+
+// Returns true if the current transformation looks different with
+// the selected rotation algorithm than with the fast one.
+bool PixelsMovement::needsHighQualityAlgorithm() const
+{
+  if (Preferences::instance().selection.rotationAlgorithm() ==
+      tools::RotationAlgorithm::FAST)
+    return false;
+
+  return !(m_currentData.angle() == 0.0 &&
+           gfx::Rect(m_currentData.bounds()).size() == m_originalImage->size());
 }
 
 void PixelsMovement::redrawCurrentMask()
@@ -647,7 +804,10 @@ void PixelsMovement::redrawCurrentMask()
   drawMask(m_currentMask, true);
 }
 
-void PixelsMovement::drawImage(doc::Image* dst, const gfx::Point& pt, bool renderOriginalLayer)
+// Renders the original layer below the transformed image (if
+// renderOriginalLayer is true) and sets the mask color of the
+// original image.
+void PixelsMovement::prepareImage(doc::Image* dst, const gfx::Point& pt, bool renderOriginalLayer)
 {
   ASSERT(dst);
 
@@ -678,7 +838,14 @@ void PixelsMovement::drawImage(doc::Image* dst, const gfx::Point& pt, bool rende
       maskColor = 0;
   }
   m_originalImage->setMaskColor(maskColor);
+}
 
+void PixelsMovement::drawImage(doc::Image* dst, const gfx::Point& pt, bool renderOriginalLayer)
+{
+  prepareImage(dst, pt, renderOriginalLayer);
+
+  Transformation::Corners corners;
+  m_currentData.transformBox(corners);
   drawParallelogram(dst, m_originalImage, m_initialMask, corners, pt);
 }
 
@@ -715,46 +882,24 @@ void PixelsMovement::drawParallelogram(
     rotAlgo = tools::RotationAlgorithm::FAST;
   }
 
-retry:;      // In case that we don't have enough memory for RotSprite
-             // we can try with the fast algorithm anyway.
-
-  switch (rotAlgo) {
-
-    case tools::RotationAlgorithm::FAST:
-      doc::algorithm::parallelogram(
-        dst, src, (mask ? mask->bitmap(): nullptr),
-        int(corners.leftTop().x-leftTop.x),
-        int(corners.leftTop().y-leftTop.y),
-        int(corners.rightTop().x-leftTop.x),
-        int(corners.rightTop().y-leftTop.y),
-        int(corners.rightBottom().x-leftTop.x),
-        int(corners.rightBottom().y-leftTop.y),
-        int(corners.leftBottom().x-leftTop.x),
-        int(corners.leftBottom().y-leftTop.y));
-      break;
-
-    case tools::RotationAlgorithm::ROTSPRITE:
-      try {
-        doc::algorithm::rotsprite_image(
-          dst, src, (mask ? mask->bitmap(): nullptr),
-          int(corners.leftTop().x-leftTop.x),
-          int(corners.leftTop().y-leftTop.y),
-          int(corners.rightTop().x-leftTop.x),
-          int(corners.rightTop().y-leftTop.y),
-          int(corners.rightBottom().x-leftTop.x),
-          int(corners.rightBottom().y-leftTop.y),
-          int(corners.leftBottom().x-leftTop.x),
-          int(corners.leftBottom().y-leftTop.y));
-      }
-      catch (const std::bad_alloc&) {
-        StatusBar::instance()->showTip(1000,
-          "Not enough memory for RotSprite");
-
-        rotAlgo = tools::RotationAlgorithm::FAST;
-        goto retry;
-      }
-      break;
+  // While a handle is dragged we show a fast preview (see
+  // redrawExtraImage()).
+  if (m_fastPreview)
+    rotAlgo = tools::RotationAlgorithm::FAST;
 
+  try {
+    transform_image(rotAlgo, dst, src, (mask ? mask->bitmap(): nullptr),
+                    corners, leftTop);
+  }
+  catch (const std::bad_alloc&) {
+    // In case that we don't have enough memory for RotSprite we can
+    // try with the fast algorithm anyway.
+    StatusBar::instance()->showTip(1000,
+      "Not enough memory for RotSprite");
+
+    transform_image(tools::RotationAlgorithm::FAST,
+                    dst, src, (mask ? mask->bitmap(): nullptr),
+                    corners, leftTop);
   }
 }
 
@@ -9,6 +9,7 @@
 
 #include "app/context_access.h"
 #include "app/extra_cel.h"
+#include "app/task_manager.h"
 #include "app/transaction.h"
 #include "app/ui/editor/handle_type.h"
 #include "base/connection.h"
@@ -16,6 +17,9 @@
 #include "doc/algorithm/flip_type.h"
 #include "doc/site.h"
 #include "gfx/size.h"
+#include "ui/timer.h"
+
+#include <memory>
 
 namespace doc {
   class Image;
@@ -99,6 +103,10 @@ namespace app {
     void onRotationAlgorithmChange();
     void redrawExtraImage();
     void redrawCurrentMask();
+    void startHighQualityRedraw();
+    void cancelHighQualityRedraw();
+    bool needsHighQualityAlgorithm() const;
+    void prepareImage(doc::Image* dst, const gfx::Point& pos, bool renderOriginalLayer);
     void drawImage(doc::Image* dst, const gfx::Point& pos, bool renderOriginalLayer);
     void drawMask(doc::Mask* dst, bool shrink);
     void drawParallelogram(doc::Image* dst, const doc::Image* src, const doc::Mask* mask,
@@ -128,6 +136,16 @@ namespace app {
     base::ScopedConnection m_pivotPosConn;
     base::ScopedConnection m_rotAlgoConn;
     ExtraCelRef m_extraCel;
+
+    // While the user drags a handle the extra cel is drawn with the
+    // fast algorithm. The selected rotation algorithm is run in a
+    // worker thread when the handle is released or after the mouse
+    // stays still for a moment.
+    bool m_fastPreview;
+    bool m_extraIsPreview;
+    ui::Timer m_highQualityTimer;
+    std::shared_ptr<int> m_extraVersion;
+    TaskHandle m_highQualityTask;
   };
 
   inline PixelsMovement::MoveModifier& operator|=(PixelsMovement::MoveModifier& a,
@@ -16,6 +16,7 @@
 #include "app/loop_tag.h"
 #include "app/pref/preferences.h"
 #include "app/ui/editor/editor.h"
+#include "app/ui/editor/playback_cache.h"
 #include "app/ui/editor/scrolling_state.h"
 #include "app/ui_context.h"
 #include "doc/frame_tag.h"
@@ -24,10 +25,16 @@
 #include "ui/message.h"
 #include "ui/system.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace ui;
 
+// Maximum number of frames rendered ahead.
+static const int kPlaybackCacheSize = 8;
+
 PlayState::PlayState(bool playOnce)
   : m_editor(nullptr)
   , m_playOnce(playOnce)
@@ -44,6 +51,10 @@ PlayState::PlayState(bool playOnce)
     &PlayState::onBeforeCommandExecution, this);
 }
 
+PlayState::~PlayState()
+{
+}
+
 void PlayState::onEnterState(Editor* editor)
 {
   StateWithWheelBehavior::onEnterState(editor);
@@ -73,6 +84,12 @@ void PlayState::onEnterState(Editor* editor)
   m_curFrameTick = base::current_tick();
   m_pingPongForward = true;
 
+  if (!m_playbackCache) {
+    m_playbackCache.reset(new PlaybackCache(kPlaybackCacheSize));
+    m_editor->setPlaybackCache(m_playbackCache.get());
+  }
+  prerenderNextFrames();
+
   // Maybe we came from ScrollingState and the timer is already
   // running.
   if (!m_playTimer.isRunning())
@@ -88,6 +105,11 @@ EditorState::LeaveAction PlayState::onLeaveState(Editor* editor, EditorState* ne
     // We don't stop the timer if we are going to the ScrollingState
     // (we keep playing the animation).
     m_playTimer.stop();
+
+    // Stop rendering frames ahead (the sprite can be modified after
+    // this point).
+    m_editor->setPlaybackCache(nullptr);
+    m_playbackCache.reset();
   }
   return KeepState;
 }
@@ -186,6 +208,7 @@ void PlayState::onPlaybackTick()
     m_editor->setFrame(frame);
     m_nextFrameTime += getNextFrameTime();
     m_editor->invalidate();
+    prerenderNextFrames();
   }
 
   m_curFrameTick = base::current_tick();
@@ -227,4 +250,35 @@ double PlayState::getNextFrameTime()
     / m_editor->getAnimationSpeedMultiplier(); // The "speed multiplier" is a "duration divider"
 }
 
+// Queues the frames that come after the current one to be rendered
+// in the worker thread. While one frame is rendered, several frames
+// can be shown, so the window grows with the cost of rendering a
+// frame in relation to the frame duration.
+void PlayState::prerenderNextFrames()
+{
+  if (!m_playbackCache)
+    return;
+
+  doc::Sprite* sprite = m_editor->sprite();
+  doc::FrameTag* tag = get_animation_tag(sprite, m_refFrame);
+
+  const double frameTime = std::max(1.0, getNextFrameTime());
+  const int n = std::min(
+    kPlaybackCacheSize-1,
+    2 + int(m_playbackCache->renderTime() / frameTime));
+
+  std::vector<doc::frame_t> frames;
+  doc::frame_t frame = m_editor->frame();
+  bool pingPongForward = m_pingPongForward;
+  for (int i=0; i<n; ++i) {
+    frame = calculate_next_frame(sprite, frame, frame_t(1), tag,
+                                 pingPongForward);
+    if (std::find(frames.begin(), frames.end(), frame) != frames.end())
+      break;
+    frames.push_back(frame);
+  }
+
+  m_editor->prerenderFrames(frames);
+}
+
 } // namespace app
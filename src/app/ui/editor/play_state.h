@@ -13,13 +13,17 @@
 #include "doc/frame.h"
 #include "ui/timer.h"
 
+#include <memory>
+
 namespace app {
 
   class CommandExecutionEvent;
+  class PlaybackCache;
 
   class PlayState : public StateWithWheelBehavior {
   public:
     PlayState(bool playOnce);
+    ~PlayState();
 
     void onEnterState(Editor* editor) override;
     LeaveAction onLeaveState(Editor* editor, EditorState* newState) override;
@@ -36,6 +40,7 @@ namespace app {
     void onBeforeCommandExecution(CommandExecutionEvent& ev);
 
     double getNextFrameTime();
+    void prerenderNextFrames();
 
     Editor* m_editor;
     bool m_playOnce;
@@ -51,6 +56,9 @@ namespace app {
     doc::frame_t m_refFrame;
 
     base::ScopedConnection m_ctxConn;
+
+    // Next frames rendered ahead in a worker thread.
+    std::unique_ptr<PlaybackCache> m_playbackCache;
   };
 
 } // namespace app
@@ -0,0 +1,185 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/editor/playback_cache.h"
+
+#include "app/document.h"
+#include "base/mem_tags.h"
+#include "base/time.h"
+#include "doc/image.h"
+#include "doc/sprite.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace app {
+
+// Milliseconds to wait before trying to render a frame again when
+// the document is locked to write.
+static const int kLockedRetryTime = 10;
+
+PlaybackCache::PlaybackCache(int capacity)
+  : m_capacity(capacity)
+  , m_zoom(1, 1)
+  , m_renderTime(0.0)
+  , m_stop(false)
+{
+  m_thread = std::thread([this]{ workerLoop(); });
+}
+
+PlaybackCache::~PlaybackCache()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_pending.clear();
+  }
+  m_cv.notify_one();
+  m_thread.join();
+}
+
+void PlaybackCache::setArea(const gfx::Rect& area, render::Zoom zoom)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_area != area || m_zoom != zoom) {
+    m_area = area;
+    m_zoom = zoom;
+    clear();
+  }
+}
+
+void PlaybackCache::request(Document* document,
+                            const doc::Sprite* sprite,
+                            doc::frame_t frame,
+                            const Key& key,
+                            const render::Render& engine)
+{
+  if (m_area.isEmpty())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = std::find_if(
+      m_ring.begin(), m_ring.end(),
+      [frame](const EntryPtr& entry) {
+        return entry->frame == frame;
+      });
+    if (it != m_ring.end()) {
+      if ((*it)->key == key)
+        return;
+
+      // The frame was modified, render it again.
+      EntryPtr old = *it;
+      m_ring.erase(it);
+      m_pending.erase(
+        std::remove(m_pending.begin(), m_pending.end(), old),
+        m_pending.end());
+    }
+
+    EntryPtr entry(new Entry{ document, sprite, frame, key, engine, nullptr, false });
+    entry->engine.setRenderCache(nullptr, nullptr);
+    entry->engine.setOnionskinCache(nullptr);
+
+    // Discard the oldest frames (an entry that is being rendered is
+    // just forgotten, the worker thread keeps its own reference).
+    while (int(m_ring.size()) >= m_capacity) {
+      EntryPtr old = m_ring.front();
+      m_ring.pop_front();
+      m_pending.erase(
+        std::remove(m_pending.begin(), m_pending.end(), old),
+        m_pending.end());
+    }
+
+    m_ring.push_back(entry);
+    m_pending.push_back(entry);
+  }
+  m_cv.notify_one();
+}
+
+doc::ImageRef PlaybackCache::get(doc::frame_t frame, const Key& key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& entry : m_ring) {
+    if (entry->frame == frame) {
+      if (entry->ready && entry->key == key)
+        return entry->image;
+      break;
+    }
+  }
+  return nullptr;
+}
+
+double PlaybackCache::renderTime()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_renderTime;
+}
+
+void PlaybackCache::clear()
+{
+  m_ring.clear();
+  m_pending.clear();
+}
+
+void PlaybackCache::workerLoop()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (!m_stop) {
+    if (m_pending.empty()) {
+      m_cv.wait(lock);
+      continue;
+    }
+
+    EntryPtr entry = m_pending.front();
+    m_pending.pop_front();
+    const gfx::Rect area = m_area;
+    const render::Zoom zoom = m_zoom;
+
+    // The sprite is read without the UI thread, so we need a read
+    // lock (if someone is modifying it we try again later).
+    if (!entry->document->lock(Document::ReadLock, 0)) {
+      m_pending.push_front(entry);
+      m_cv.wait_for(lock, std::chrono::milliseconds(kLockedRetryTime));
+      continue;
+    }
+
+    lock.unlock();
+
+    const base::tick_t t0 = base::current_tick();
+    doc::ImageRef image;
+    try {
+      {
+        base::mem_tag_scope tag(base::mem_tag::render_cache);
+        image.reset(doc::Image::create(doc::IMAGE_RGB, area.w, area.h));
+      }
+      entry->engine.renderSprite(image.get(), entry->sprite, entry->frame,
+                                 gfx::Clip(0, 0, area), zoom);
+    }
+    catch (const std::exception&) {
+      // The frame will be rendered by the editor
+      image.reset();
+    }
+    entry->document->unlock();
+    const double elapsed = double(base::current_tick() - t0);
+
+    lock.lock();
+    if (image) {
+      entry->image = image;
+      entry->ready = true;
+      m_renderTime = (m_renderTime == 0.0 ? elapsed:
+                                            (3.0*m_renderTime + elapsed) / 4.0);
+    }
+  }
+}
+
+} // namespace app
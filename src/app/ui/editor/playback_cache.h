@@ -0,0 +1,96 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/frame.h"
+#include "doc/image_ref.h"
+#include "gfx/rect.h"
+#include "render/render.h"
+#include "render/zoom.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace doc {
+  class Sprite;
+}
+
+namespace app {
+  class Document;
+
+  // Frames of the sprite rendered ahead of time in a worker thread
+  // while the animation is played. The frames are rendered at the
+  // zoom of the editor in a bounded ring of images, so the editor
+  // only has to convert them to the screen format.
+  //
+  // All coordinates are in zoomed sprite coordinates.
+  class PlaybackCache {
+  public:
+    typedef std::vector<uint32_t> Key;
+
+    explicit PlaybackCache(int capacity);
+    ~PlaybackCache();
+
+    // Area of the sprite that is rendered for each frame. If it
+    // changes, all the frames are discarded.
+    void setArea(const gfx::Rect& area, render::Zoom zoom);
+    const gfx::Rect& area() const { return m_area; }
+
+    // Queues the given frame to be rendered with a copy of "engine"
+    // (if it isn't in the ring with the same key yet). The oldest
+    // frames are discarded to keep the ring bounded.
+    void request(Document* document,
+                 const doc::Sprite* sprite,
+                 doc::frame_t frame,
+                 const Key& key,
+                 const render::Render& engine);
+
+    // Returns the rendered frame if it's ready and it was rendered
+    // with the given key.
+    doc::ImageRef get(doc::frame_t frame, const Key& key);
+
+    // Average number of milliseconds that takes to render a frame (0
+    // if no frame was rendered yet).
+    double renderTime();
+
+  private:
+    struct Entry {
+      Document* document;
+      const doc::Sprite* sprite;
+      doc::frame_t frame;
+      Key key;
+      render::Render engine;
+      doc::ImageRef image;
+      bool ready;
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+
+    void clear();
+    void workerLoop();
+
+    const int m_capacity;
+    gfx::Rect m_area;
+    render::Zoom m_zoom;
+    std::deque<EntryPtr> m_ring;
+    std::deque<EntryPtr> m_pending;
+    double m_renderTime;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+
+    DISABLE_COPYING(PlaybackCache);
+  };
+
+} // namespace app
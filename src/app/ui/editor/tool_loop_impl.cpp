@@ -53,6 +53,10 @@ namespace app {
 
 using namespace ui;
 
+// Max size (in pixels) of a stroke that can be grouped with the
+// previous one in the undo history.
+static const int kTinyStrokeSize = 8;
+
 //////////////////////////////////////////////////////////////////////
 // Common properties between drawing/preview ToolLoop impl
 
@@ -271,6 +275,7 @@ class ToolLoopImpl : public ToolLoopBase {
   bool m_previewFilled;
   int m_sprayWidth;
   int m_spraySpeed;
+  int m_blurRadius;
   bool m_useMask;
   Mask* m_mask;
   gfx::Point m_maskOrigin;
@@ -368,6 +373,7 @@ public:
     m_previewFilled = m_toolPref.filledPreview();
     m_sprayWidth = m_toolPref.spray.width();
     m_spraySpeed = m_toolPref.spray.speed();
+    m_blurRadius = m_toolPref.blur.radius();
 
     if (m_ink->isSelection())
       m_useMask = false;
@@ -407,6 +413,14 @@ public:
           ContextReader reader(m_context, 500);
           ContextWriter writer(reader, 500);
           m_expandCelCanvas->commit();
+
+          // Tiny strokes (e.g. stippling) can be grouped in the same
+          // undo state.
+          const gfx::Rect& bounds = m_expandCelCanvas->getPatchedBounds();
+          if (Preferences::instance().undo.coalesceStrokes() &&
+              bounds.w <= kTinyStrokeSize &&
+              bounds.h <= kTinyStrokeSize)
+            m_transaction.setMergeable(true);
         }
         catch (const LockedDocumentException& ex) {
           Console::showException(ex);
@@ -471,6 +485,7 @@ public:
   bool getPreviewFilled() override { return m_previewFilled; }
   int getSprayWidth() override { return m_sprayWidth; }
   int getSpraySpeed() override { return m_spraySpeed; }
+  int getBlurRadius() override { return m_blurRadius; }
 
   void cancel() override { m_canceled = true; }
   bool isCanceled() override { return m_canceled; }
@@ -607,6 +622,7 @@ public:
   bool getPreviewFilled() override { return false; }
   int getSprayWidth() override { return 0; }
   int getSpraySpeed() override { return 0; }
+  int getBlurRadius() override { return 1; }
 
   void cancel() override { }
   bool isCanceled() override { return true; }
@@ -120,28 +120,14 @@ bool FileList::onProcessMessage(Message* msg)
     case kMouseMoveMessage:
       if (hasCapture()) {
         MouseMessage* mouseMsg = static_cast<MouseMessage*>(msg);
-        int th = textHeight();
-        int y = bounds().y;
         IFileItem* old_selected = m_selected;
         m_selected = NULL;
 
-        // rows
-        for (FileItemList::iterator
-               it=m_list.begin();
-             it!=m_list.end(); ++it) {
-          IFileItem* fi = *it;
-          gfx::Size itemSize = getFileItemSize(fi);
-
-          if (((mouseMsg->position().y >= y) &&
-               (mouseMsg->position().y < y+th+4*guiscale())) ||
-              (it == m_list.begin() && mouseMsg->position().y < y) ||
-              (it == m_list.end()-1 && mouseMsg->position().y >= y+th+4*guiscale())) {
-            m_selected = fi;
-            makeSelectedFileitemVisible();
-            break;
-          }
-
-          y += itemSize.h;
+        // The rows before/after the list select the first/last item
+        if (!m_list.empty()) {
+          int i = rowAt(mouseMsg->position().y - bounds().y);
+          m_selected = m_list[MID(0, i, int(m_list.size())-1)];
+          makeSelectedFileitemVisible();
         }
 
         if (old_selected != m_selected) {
@@ -200,7 +186,7 @@ bool FileList::onProcessMessage(Message* msg)
             gfx::Rect vp = view->viewportBounds();
             if (select < 0)
               select = 0;
-            select += sgn * vp.h / (textHeight()+4*guiscale());
+            select += sgn * vp.h / rowHeight();
             break;
           }
 
@@ -279,7 +265,7 @@ bool FileList::onProcessMessage(Message* msg)
       View* view = View::getView(this);
       if (view) {
         gfx::Point scroll = view->viewScroll();
-        scroll += static_cast<MouseMessage*>(msg)->wheelDelta() * 3*(textHeight()+4*guiscale());
+        scroll += static_cast<MouseMessage*>(msg)->wheelDelta() * 3*rowHeight();
         view->setViewScroll(scroll);
       }
       break;
@@ -305,18 +291,11 @@ bool FileList::onProcessMessage(Message* msg)
 
 int FileList::thumbnailY()
 {
-  int y = 0;
-  for (IFileItem* fi : m_list) {
-    gfx::Size itemSize = getFileItemSize(fi);
-    if (fi == m_selected) {
-      if (fi->getThumbnail())
-        return y + itemSize.h/2;
-      else
-        break;
-    }
-    y += itemSize.h;
-  }
-  return 0;
+  int i = getSelectedIndex();
+  if (i >= 0 && m_selected->getThumbnail())
+    return i*rowHeight() + rowHeight()/2;
+  else
+    return 0;
 }
 
 void FileList::onPaint(ui::PaintEvent& ev)
@@ -324,17 +303,31 @@ void FileList::onPaint(ui::PaintEvent& ev)
   Graphics* g = ev.graphics();
   SkinTheme* theme = static_cast<SkinTheme*>(this->theme());
   gfx::Rect bounds = clientBounds();
-  int x, y = bounds.y;
-  int evenRow = 0;
+  const int rh = rowHeight();
+  int x, y;
   gfx::Color bgcolor;
   gfx::Color fgcolor;
 
   g->fillRect(theme->colors.background(), bounds);
 
-  // rows
-  m_thumbnail = nullptr;
-  for (IFileItem* fi : m_list) {
-    gfx::Size itemSize = getFileItemSize(fi);
+  // Generate the thumbnails of the new visible files when the list
+  // is scrolled
+  if (View* view = View::getView(this)) {
+    if (view->viewScroll() != m_lastScroll) {
+      m_lastScroll = view->viewScroll();
+      m_generateThumbnailTimer.start();
+    }
+  }
+
+  // Only the rows inside the clipping region are painted
+  const gfx::Rect clip = g->getClipBounds();
+  const int first = std::max(0, rowAt(clip.y - bounds.y));
+  const int last = std::min(int(m_list.size())-1, rowAt(clip.y2()-1 - bounds.y));
+
+  for (int i=first; i<=last; ++i) {
+    IFileItem* fi = m_list[i];
+    const bool evenRow = ((i & 1) == 1);
+    y = bounds.y + i*rh;
 
     if (fi == m_selected) {
       fgcolor = theme->colors.filelistSelectedRowText();
@@ -354,7 +347,7 @@ void FileList::onPaint(ui::PaintEvent& ev)
     x = bounds.x+2*guiscale();
 
     // Item background
-    g->fillRect(bgcolor, gfx::Rect(bounds.x, y, bounds.w, itemSize.h));
+    g->fillRect(bgcolor, gfx::Rect(bounds.x, y, bounds.w, rh));
 
     if (fi->isFolder()) {
       int icon_w = font()->textLength("[+]");
@@ -379,19 +372,14 @@ void FileList::onPaint(ui::PaintEvent& ev)
       theme->paintProgressBar(g,
         gfx::Rect(
           bounds.x2()-2*guiscale()-barw,
-          y+itemSize.h/2-3*guiscale(),
+          y+rh/2-3*guiscale(),
           barw, 6*guiscale()),
         progress);
     }
-
-    // Thumbnail position
-    if (fi == m_selected)
-      m_thumbnail = fi->getThumbnail();
-
-    y += itemSize.h;
-    evenRow ^= 1;
   }
 
+  m_thumbnail = (m_selected ? m_selected->getThumbnail(): nullptr);
+
   // Draw the thumbnail
   if (m_thumbnail) {
     gfx::Rect tbounds = thumbnailBounds();
@@ -420,21 +408,23 @@ gfx::Rect FileList::thumbnailBounds()
 void FileList::onSizeHint(SizeHintEvent& ev)
 {
   if (!m_req_valid) {
-    gfx::Size reqSize(0, 0);
-
-    // rows
-    for (FileItemList::iterator
-           it=m_list.begin();
-         it!=m_list.end(); ++it) {
-      IFileItem* fi = *it;
-      gfx::Size itemSize = getFileItemSize(fi);
-      reqSize.w = MAX(reqSize.w, itemSize.w);
-      reqSize.h += itemSize.h;
+    // Only the new items are measured, the widths of the items that
+    // aren't in the list anymore are discarded.
+    std::unordered_map<IFileItem*, int> widths;
+    widths.reserve(m_list.size());
+
+    m_req_w = 0;
+    for (IFileItem* fi : m_list) {
+      auto it = m_itemWidths.find(fi);
+      const int w = (it != m_itemWidths.end() ? it->second:
+                                                getFileItemSize(fi).w);
+      widths[fi] = w;
+      m_req_w = std::max(m_req_w, w);
     }
+    m_itemWidths.swap(widths);
 
     m_req_valid = true;
-    m_req_w = reqSize.w;
-    m_req_h = reqSize.h;
+    m_req_h = int(m_list.size()) * rowHeight();
   }
   ev.setSizeHint(Size(m_req_w, m_req_h));
 }
@@ -458,15 +448,53 @@ void FileList::onMonitoringTick()
 {
   if (ThumbnailGenerator::instance()->checkWorkers())
     invalidate();
+
+  // New entries of the current folder (listed in background)
+  if (FileSystemModule::instance()->update())
+    onFolderUpdated();
+}
+
+void FileList::onFolderUpdated()
+{
+  regenerateList();
+
+  // The selected item could be removed
+  if (std::find(m_list.begin(), m_list.end(), m_selected) == m_list.end())
+    m_selected = nullptr;
+
+  m_req_valid = false;
+  invalidate();
+  View::getView(this)->updateView();
 }
 
 void FileList::onGenerateThumbnailTick()
 {
   m_generateThumbnailTimer.stop();
 
+  // Thumbnails of files that are not visible anymore aren't needed
+  ThumbnailGenerator* generator = ThumbnailGenerator::instance();
+  generator->cancelPendingWorkers();
+
   IFileItem* fileitem = m_itemToGenerateThumbnail;
   if (fileitem)
-    ThumbnailGenerator::instance()->addWorkerToGenerateThumbnail(fileitem);
+    generator->addWorkerToGenerateThumbnail(
+      fileitem, ThumbnailGenerator::HighPriority);
+
+  // Visible files after the selected one (so they are in the cache
+  // when they are selected)
+  View* view = View::getView(this);
+  if (!view)
+    return;
+
+  gfx::Rect vp = view->viewportBounds();
+  const int first = std::max(0, rowAt(vp.y - bounds().y));
+  const int last = std::min(int(m_list.size())-1, rowAt(vp.y2()-1 - bounds().y));
+  for (int i=first; i<=last; ++i) {
+    IFileItem* fi = m_list[i];
+    if (!fi->isFolder())
+      generator->addWorkerToGenerateThumbnail(
+        fi, ThumbnailGenerator::LowPriority);
+  }
 }
 
 gfx::Size FileList::getFileItemSize(IFileItem* fi) const
@@ -478,7 +506,22 @@ gfx::Size FileList::getFileItemSize(IFileItem* fi) const
 
   len += font()->textLength(fi->displayName().c_str());
 
-  return gfx::Size(len+4*guiscale(), textHeight()+4*guiscale());
+  return gfx::Size(len+4*guiscale(), rowHeight());
+}
+
+// All rows have the same height, so the position of each item is
+// calculated from its index (the list can have thousands of items).
+int FileList::rowHeight() const
+{
+  return textHeight()+4*guiscale();
+}
+
+// Returns the index of the row in the given "y" coordinate relative
+// to the widget origin (it can be outside the list).
+int FileList::rowAt(int y) const
+{
+  const int rh = rowHeight();
+  return (y >= 0 ? y / rh: (y - rh + 1) / rh);
 }
 
 void FileList::makeSelectedFileitemVisible()
@@ -486,34 +529,26 @@ void FileList::makeSelectedFileitemVisible()
   View* view = View::getView(this);
   gfx::Rect vp = view->viewportBounds();
   gfx::Point scroll = view->viewScroll();
-  int th = textHeight();
-  int y = bounds().y;
+  const int rh = rowHeight();
 
-  // rows
-  for (FileItemList::iterator
-         it=m_list.begin();
-       it!=m_list.end(); ++it) {
-    IFileItem* fi = *it;
-    gfx::Size itemSize = getFileItemSize(fi);
+  const int i = getSelectedIndex();
+  if (i < 0)
+    return;
 
-    if (fi == m_selected) {
-      if (y < vp.y)
-        scroll.y = y - bounds().y;
-      else if (y > vp.y + vp.h - (th+4*guiscale()))
-        scroll.y = y - bounds().y - vp.h + (th+4*guiscale());
+  const int y = bounds().y + i*rh;
+  if (y < vp.y)
+    scroll.y = y - bounds().y;
+  else if (y > vp.y + vp.h - rh)
+    scroll.y = y - bounds().y - vp.h + rh;
 
-      view->setViewScroll(scroll);
-      break;
-    }
-
-    y += itemSize.h;
-  }
+  view->setViewScroll(scroll);
 }
 
 void FileList::regenerateList()
 {
-  // get the children of the current folder
-  m_list = m_currentFolder->children();
+  // get the children of the current folder (the list is completed
+  // in onMonitoringTick() if the folder is being listed)
+  m_list = m_currentFolder->childrenAsync();
 
   // filter the list by the available extensions
   if (!m_exts.empty()) {
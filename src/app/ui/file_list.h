@@ -14,6 +14,7 @@
 #include "ui/widget.h"
 
 #include <string>
+#include <unordered_map>
 
 namespace she {
   class Surface;
@@ -54,7 +55,10 @@ namespace app {
   private:
     void onGenerateThumbnailTick();
     void onMonitoringTick();
+    void onFolderUpdated();
     gfx::Size getFileItemSize(IFileItem* fi) const;
+    int rowHeight() const;
+    int rowAt(int y) const;
     void makeSelectedFileitemVisible();
     void regenerateList();
     int getSelectedIndex();
@@ -66,6 +70,10 @@ namespace app {
     FileItemList m_list;
     bool m_req_valid;
     int m_req_w, m_req_h;
+
+    // Width of each item (the text of all items is measured just one
+    // time, and not again each time the list is regenerated)
+    std::unordered_map<IFileItem*, int> m_itemWidths;
     IFileItem* m_selected;
     std::string m_exts;
 
@@ -85,6 +93,10 @@ namespace app {
     IFileItem* m_itemToGenerateThumbnail;
 
     she::Surface* m_thumbnail;
+
+    // Scroll position of the last paint (to know when the visible
+    // files change).
+    gfx::Point m_lastScroll;
   };
 
 } // namespace app
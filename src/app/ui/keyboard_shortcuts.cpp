@@ -108,6 +108,23 @@ namespace app {
 
 using namespace ui;
 
+namespace {
+
+// Incremented each time an accelerator of a key is changed (or keys
+// are deleted) to rebuild the index of accelerators.
+int g_accelsVersion = 0;
+
+enum AccelIndexKind { kNoKey, kScancode, kUnicodeChar };
+
+uint64_t accel_index_key(KeyModifiers modifiers, AccelIndexKind kind, int value)
+{
+  return ((uint64_t(modifiers) << 40) |
+          (uint64_t(kind) << 32) |
+          uint64_t(uint32_t(value)));
+}
+
+} // anonymous namespace
+
 //////////////////////////////////////////////////////////////////////
 // Key
 
@@ -223,6 +240,7 @@ void Key::add(const ui::Accelerator& accel, KeySource source)
 
   // Add the accelerator
   accels->add(accel);
+  ++g_accelsVersion;
 }
 
 bool Key::isPressed(Message* msg) const
@@ -276,10 +294,13 @@ void Key::disableAccel(const ui::Accelerator& accel)
 
   if (m_accels.has(accel))
     m_userRemoved.add(accel);
+
+  ++g_accelsVersion;
 }
 
 void Key::reset()
 {
+  ++g_accelsVersion;
   m_users.clear();
   m_userRemoved.clear();
   m_userLabel.reset();
@@ -317,6 +338,7 @@ KeyboardShortcuts* KeyboardShortcuts::instance()
 }
 
 KeyboardShortcuts::KeyboardShortcuts()
+  : m_accelIndexVersion(-1)
 {
 }
 
@@ -331,6 +353,7 @@ void KeyboardShortcuts::clear()
     delete key;
   }
   m_keys.clear();
+  ++g_accelsVersion;
 }
 
 void KeyboardShortcuts::importCommands(tinyxml2::XMLHandle& handle, KeySource source) {
@@ -732,8 +755,41 @@ KeyContext KeyboardShortcuts::getCurrentKeyContext()
 
 bool KeyboardShortcuts::getCommandFromKeyMessage(Message* msg, Command** command, Params* params)
 {
-  for (Key* key : m_keys) {
-    if (key->type() == KeyType::Command && key->isPressed(msg)) {
+  if (m_accelIndexVersion != g_accelsVersion)
+    rebuildAccelIndex();
+
+  KeyModifiers modifiers = msg->modifiers();
+  KeyScancode scancode = static_cast<KeyMessage*>(msg)->scancode();
+  int unicodeChar = static_cast<KeyMessage*>(msg)->unicodeChar();
+  Accelerator::normalizeKey(modifiers, scancode, unicodeChar);
+
+  // Lists of candidates (each one sorted by index)
+  static const std::vector<int> kEmpty;
+  auto candidates = [&](AccelIndexKind kind, int value) -> const std::vector<int>& {
+    auto it = m_accelIndex.find(accel_index_key(modifiers, kind, value));
+    return (it != m_accelIndex.end() ? it->second: kEmpty);
+  };
+  const std::vector<int>& a =
+    (scancode != kKeyNil ? candidates(kScancode, scancode):
+     unicodeChar == 0 ? candidates(kNoKey, 0): kEmpty);
+  const std::vector<int>& b =
+    (unicodeChar != 0 ? candidates(kUnicodeChar, unicodeChar): kEmpty);
+
+  // The first key (in m_keys order) that is pressed in the current
+  // context
+  auto i = a.begin(), j = b.begin();
+  while (i != a.end() || j != b.end()) {
+    int index;
+    if (j == b.end() || (i != a.end() && *i <= *j)) {
+      index = *i++;
+      if (j != b.end() && *j == index)
+        ++j;
+    }
+    else
+      index = *j++;
+
+    Key* key = m_keys[index];
+    if (key->isPressed(msg)) {
       if (command) *command = key->command();
       if (params) *params = key->params();
       return true;
@@ -742,6 +798,35 @@ bool KeyboardShortcuts::getCommandFromKeyMessage(Message* msg, Command** command
   return false;
 }
 
+void KeyboardShortcuts::rebuildAccelIndex()
+{
+  m_accelIndex.clear();
+
+  auto add = [this](uint64_t indexKey, int index) {
+    std::vector<int>& list = m_accelIndex[indexKey];
+    if (list.empty() || list.back() != index)
+      list.push_back(index);
+  };
+
+  for (int index=0; index<int(m_keys.size()); ++index) {
+    const Key* key = m_keys[index];
+    if (key->type() != KeyType::Command)
+      continue;
+
+    for (const Accelerator& accel : key->accels()) {
+      // An accelerator matches the scancode or the character
+      if (accel.scancode() != kKeyNil)
+        add(accel_index_key(accel.modifiers(), kScancode, accel.scancode()), index);
+      if (accel.unicodeChar())
+        add(accel_index_key(accel.modifiers(), kUnicodeChar, accel.unicodeChar()), index);
+      if (accel.scancode() == kKeyNil && !accel.unicodeChar())
+        add(accel_index_key(accel.modifiers(), kNoKey, 0), index);
+    }
+  }
+
+  m_accelIndexVersion = g_accelsVersion;
+}
+
 tools::Tool* KeyboardShortcuts::getCurrentQuicktool(tools::Tool* currentTool)
 {
   if (currentTool && currentTool->getInk(0)->isSelection()) {
@@ -11,8 +11,10 @@
 #include "base/convert_to.h"
 #include "base/disable_copying.h"
 #include "ui/accelerator.h"
+#include <cstdint>
 #include <vector>
 #include <optional>
+#include <unordered_map>
 #include "tinyxml2.h"
 
 namespace ui {
@@ -176,9 +178,17 @@ namespace app {
     void importQuickTools(tinyxml2::XMLHandle &handle, KeySource source);
     void importActions(tinyxml2::XMLHandle& handle, KeySource source);
     void importTouches(tinyxml2::XMLHandle& handle, KeySource source);
+    void rebuildAccelIndex();
 
     Keys m_keys;
 
+    // Indexes of the Command keys in m_keys by the modifiers and the
+    // scancode/character of their accelerators, so a key message is
+    // compared only with the keys that could match it. It's rebuilt
+    // when the accelerators change.
+    std::unordered_map<uint64_t, std::vector<int>> m_accelIndex;
+    int m_accelIndexVersion;
+
     DISABLE_COPYING(KeyboardShortcuts);
   };
 
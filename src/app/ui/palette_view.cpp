@@ -30,6 +30,7 @@
 #include "gfx/point.h"
 #include "she/font.h"
 #include "she/surface.h"
+#include "she/system.h"
 #include "ui/graphics.h"
 #include "ui/manager.h"
 #include "ui/message.h"
@@ -71,6 +72,11 @@ PaletteView::PaletteView(bool editable, PaletteViewStyle style, PaletteViewDeleg
   m_conn = App::instance()->PaletteChange.connect(&PaletteView::onAppPaletteChange, this);
 }
 
+PaletteView::~PaletteView()
+{
+  invalidateEntriesSurface();
+}
+
 void PaletteView::setColumns(int columns)
 {
   int old_columns = m_columns;
@@ -437,9 +443,17 @@ void PaletteView::onPaint(ui::PaintEvent& ev)
       transparentIndex = current_editor->sprite()->transparentColor();
   }
 
-  g->fillRect(theme->colors.editorFace(), bounds);
+  // Draw palette entries (from the cache if they are in the regular
+  // place, i.e. we aren't moving/resizing the palette)
+  she::Surface* entriesSurface = nullptr;
+  if (!dragging && !resizing)
+    entriesSurface = getEntriesSurface(palette);
+
+  if (entriesSurface)
+    g->drawSurface(entriesSurface, bounds.x, bounds.y);
+  else
+    g->fillRect(theme->colors.editorFace(), bounds);
 
-  // Draw palette entries
   int picksCount = m_selectedEntries.picks();
   int idxOffset = 0;
   int boxOffset = 0;
@@ -460,7 +474,16 @@ void PaletteView::onPaint(ui::PaintEvent& ev)
     }
 
     gfx::Rect box = getPaletteEntryBounds(i + boxOffset);
-    gfx::Color gfxColor = drawEntry(g, box, i + idxOffset);
+    gfx::Color gfxColor;
+    if (entriesSurface) {
+      doc::color_t palColor = palette->getEntry(i);
+      gfxColor = gfx::rgba(rgba_getr(palColor),
+                           rgba_getg(palColor),
+                           rgba_getb(palColor),
+                           rgba_geta(palColor));
+    }
+    else
+      gfxColor = drawEntry(g, box, i + idxOffset);
 
     switch (m_style) {
 
@@ -606,6 +629,12 @@ void PaletteView::onSizeHint(ui::SizeHintEvent& ev)
   ev.setSizeHint(sz);
 }
 
+void PaletteView::onInitTheme(ui::InitThemeEvent& ev)
+{
+  invalidateEntriesSurface();
+  Widget::onInitTheme(ev);
+}
+
 void PaletteView::onDrawMarchingAnts()
 {
   invalidate();
@@ -645,6 +674,7 @@ void PaletteView::update_scroll(int color)
 
 void PaletteView::onAppPaletteChange()
 {
+  invalidateEntriesSurface();
   m_selectedEntries.resize(currentPalette()->size());
 
   View* view = View::getView(this);
@@ -985,4 +1015,47 @@ gfx::Color PaletteView::drawEntry(ui::Graphics* g, const gfx::Rect& box, int pal
   return gfxColor;
 }
 
+she::Surface* PaletteView::getEntriesSurface(const doc::Palette* palette)
+{
+  const gfx::Rect bounds = clientBounds();
+  if (bounds.isEmpty())
+    return nullptr;
+
+  auto& cache = m_entriesCache;
+  if (cache.surface &&
+      (cache.palette != palette ||
+       cache.modifications != palette->getModifications() ||
+       cache.columns != m_columns ||
+       cache.boxsize != m_boxsize ||
+       cache.surface->width() != bounds.w ||
+       cache.surface->height() != bounds.h)) {
+    invalidateEntriesSurface();
+  }
+
+  if (!cache.surface) {
+    SkinTheme* theme = static_cast<SkinTheme*>(this->theme());
+
+    cache.surface = she::instance()->createSurface(bounds.w, bounds.h);
+    cache.palette = palette;
+    cache.modifications = palette->getModifications();
+    cache.columns = m_columns;
+    cache.boxsize = m_boxsize;
+
+    ui::Graphics g(cache.surface, -bounds.x, -bounds.y);
+    g.fillRect(theme->colors.editorFace(), bounds);
+    for (int i=0; i<palette->size(); ++i)
+      drawEntry(&g, getPaletteEntryBounds(i), i);
+  }
+
+  return cache.surface;
+}
+
+void PaletteView::invalidateEntriesSurface()
+{
+  if (m_entriesCache.surface) {
+    m_entriesCache.surface->dispose();
+    m_entriesCache.surface = nullptr;
+  }
+}
+
 } // namespace app
@@ -18,6 +18,10 @@
 
 #include <vector>
 
+namespace she {
+  class Surface;
+}
+
 namespace doc {
   class Palette;
 }
@@ -52,6 +56,7 @@ namespace app {
     };
 
     PaletteView(bool editable, PaletteViewStyle style, PaletteViewDelegate* delegate, int boxsize);
+    ~PaletteView();
 
     bool isEditable() const { return m_editable; }
 
@@ -87,6 +92,7 @@ namespace app {
     void onPaint(ui::PaintEvent& ev) override;
     void onResize(ui::ResizeEvent& ev) override;
     void onSizeHint(ui::SizeHintEvent& ev) override;
+    void onInitTheme(ui::InitThemeEvent& ev) override;
     void onDrawMarchingAnts() override;
 
   private:
@@ -138,6 +144,8 @@ namespace app {
     int findExactIndex(const app::Color& color) const;
     void setNewPalette(const doc::Palette& oldPalette, const doc::Palette& newPalette, PaletteViewModification mod);
     gfx::Color drawEntry(ui::Graphics* g, const gfx::Rect& box, int palIdx);
+    she::Surface* getEntriesSurface(const doc::Palette* palette);
+    void invalidateEntriesSurface();
 
     State m_state;
     bool m_editable;
@@ -152,6 +160,18 @@ namespace app {
     base::ScopedConnection m_conn;
     Hit m_hot;
     bool m_copy;
+
+    // Background and palette entries painted in a surface, so we
+    // don't paint each entry again when only the hot entry or the
+    // selection change. It's painted again when the palette, the
+    // size of the view or the size of the entries change.
+    struct {
+      she::Surface* surface = nullptr;
+      const doc::Palette* palette = nullptr;
+      int modifications = 0;
+      int columns = 0;
+      int boxsize = 0;
+    } m_entriesCache;
   };
 
 } // namespace app
@@ -0,0 +1,220 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/performance_hud.h"
+
+#include "app/app.h"
+#include "app/document.h"
+#include "app/modules/editors.h"
+#include "app/tools/tool_loop_manager.h"
+#include "app/ui/editor/editor.h"
+#include "base/mem_tags.h"
+#include "she/font.h"
+#include "she/surface.h"
+#include "she/system.h"
+#include "ui/graphics.h"
+#include "ui/manager.h"
+#include "ui/overlay.h"
+#include "ui/overlay_manager.h"
+#include "ui/theme.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace app {
+
+using namespace ui;
+
+namespace {
+
+const int kUpdateInterval = 250; // Milliseconds
+
+std::unique_ptr<PerformanceHud> hud;
+
+// Returns "-" if there weren't lookups.
+std::string hit_rate(std::size_t hits, std::size_t lookups)
+{
+  if (lookups == 0)
+    return "-";
+
+  char buf[32];
+  std::sprintf(buf, "%d%%", int(100 * hits / lookups));
+  return buf;
+}
+
+std::string mem_size(base::mem_tag tag)
+{
+  char buf[32];
+  std::sprintf(buf, "%.1f MB",
+               double(base::get_mem_tag_stats(tag).current) / (1024.0*1024.0));
+  return buf;
+}
+
+} // anonymous namespace
+
+PerformanceHud::PerformanceHud()
+  : m_timer(kUpdateInterval)
+  , m_paintedPixels(Editor::renderStats().paintedPixels)
+  , m_renderedPixels(Editor::renderStats().renderedPixels)
+  , m_poolStats(doc::ImageBufferPool::instance().stats())
+  , m_stampStats(doc::BrushStampCache::instance().stats())
+{
+  m_timer.Tick.connect(&PerformanceHud::onTick, this);
+  m_timer.start();
+  onTick();
+}
+
+PerformanceHud::~PerformanceHud()
+{
+  if (m_overlay)
+    OverlayManager::instance()->removeOverlay(m_overlay.get());
+}
+
+// static
+PerformanceHud* PerformanceHud::instance()
+{
+  return hud.get();
+}
+
+// static
+void PerformanceHud::toggle()
+{
+  if (hud) {
+    hud.reset();
+    return;
+  }
+
+  static bool exitConnected = false;
+  if (!exitConnected) {
+    App::instance()->Exit.connect([]{ hud.reset(); });
+    exitConnected = true;
+  }
+  hud.reset(new PerformanceHud);
+}
+
+void PerformanceHud::onTick()
+{
+  std::vector<std::string> lines;
+  collectLines(lines);
+  redraw(lines);
+}
+
+void PerformanceHud::collectLines(std::vector<std::string>& lines)
+{
+  char buf[256];
+
+  const Manager::FrameStats& frame = Manager::getDefault()->frameStats();
+  std::sprintf(buf, "Frame: %.1f fps, paint %.2f ms, flip %.2f ms",
+               (frame.frameInterval > 0.0 ? 1000.0 / frame.frameInterval: 0.0),
+               frame.paintTime, frame.frameTime);
+  lines.push_back(buf);
+
+  std::sprintf(buf, "Dirty region: %d px", frame.dirtyArea);
+  lines.push_back(buf);
+
+  const Editor::RenderStats& render = Editor::renderStats();
+  const std::size_t painted = render.paintedPixels - m_paintedPixels;
+  const std::size_t rendered = render.renderedPixels - m_renderedPixels;
+  std::sprintf(buf, "Editor render: %.2f ms, canvas cache %s hits",
+               render.renderTime,
+               hit_rate(painted - std::min(painted, rendered), painted).c_str());
+  lines.push_back(buf);
+
+  const tools::ToolLoopManager::StepStats& step = tools::ToolLoopManager::stepStats();
+  std::sprintf(buf, "Tool loop step: %.2f ms, dirty %d px",
+               step.stepTime, step.dirtyArea);
+  lines.push_back(buf);
+
+  const doc::ImageBufferPool::Stats pool = doc::ImageBufferPool::instance().stats();
+  const doc::BrushStampCache::Stats stamps = doc::BrushStampCache::instance().stats();
+  std::sprintf(buf, "Image pool %s hits, brush stamps %s hits",
+               hit_rate(pool.hits - m_poolStats.hits,
+                        pool.allocations - m_poolStats.allocations).c_str(),
+               hit_rate(stamps.hits - m_stampStats.hits,
+                        stamps.lookups - m_stampStats.lookups).c_str());
+  lines.push_back(buf);
+
+  std::sprintf(buf, "Memory: images %s, pool %s",
+               mem_size(base::mem_tag::images).c_str(),
+               mem_size(base::mem_tag::image_pool).c_str());
+  lines.push_back(buf);
+
+  std::sprintf(buf, "Memory: render cache %s, canvas %s",
+               mem_size(base::mem_tag::render_cache).c_str(),
+               mem_size(base::mem_tag::canvas).c_str());
+  lines.push_back(buf);
+
+  if (current_editor && current_editor->document()) {
+    const base::rw_lock::Stats lock = current_editor->document()->lockStats();
+    std::sprintf(buf, "Document lock: %d waits (%d failed), %.1f ms",
+                 int(lock.contended), int(lock.timeouts), lock.waitTime);
+    lines.push_back(buf);
+  }
+}
+
+void PerformanceHud::redraw(const std::vector<std::string>& lines)
+{
+  Theme* theme = CurrentTheme::get();
+  if (!theme)
+    return;
+
+  std::shared_ptr<she::Font> font = theme->getDefaultFont();
+  const int border = 2*guiscale();
+  const int lineHeight = font->height();
+
+  int width = 0;
+  for (const auto& line : lines)
+    width = std::max(width, font->textLength(line));
+  width += 2*border;
+  const int height = int(lines.size())*lineHeight + 2*border;
+
+  // Reuse the surface while its size is the same
+  she::Surface* surface = (m_overlay ? m_overlay->setSurface(nullptr): nullptr);
+  if (surface && (surface->width() != width ||
+                  surface->height() != height)) {
+    surface->dispose();
+    surface = nullptr;
+  }
+  if (!surface)
+    surface = she::instance()->createRgbaSurface(width, height);
+
+  {
+    she::SurfaceLock lock(surface);
+    surface->fillRect(gfx::rgba(0, 0, 0, 192), gfx::Rect(0, 0, width, height));
+  }
+  {
+    Graphics g(surface, 0, 0);
+    g.setFont(font);
+    int y = border;
+    for (const auto& line : lines) {
+      g.drawString(line, gfx::rgba(255, 255, 255), gfx::ColorNone,
+                   gfx::Point(border, y));
+      y += lineHeight;
+    }
+  }
+
+  // Top-left corner of the active editor
+  gfx::Point pos(0, 0);
+  if (current_editor && current_editor->isVisible())
+    pos = current_editor->bounds().origin();
+
+  if (m_overlay) {
+    m_overlay->moveOverlay(pos);
+    m_overlay->setSurface(surface);
+  }
+  else {
+    m_overlay.reset(new Overlay(surface, pos, Overlay::MouseZOrder-1));
+    OverlayManager::instance()->addOverlay(m_overlay.get());
+    m_overlay->markDirty();
+  }
+}
+
+} // namespace app
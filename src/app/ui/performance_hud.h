@@ -0,0 +1,55 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/brush_stamp.h"
+#include "doc/image_buffer_pool.h"
+#include "ui/timer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ui {
+  class Overlay;
+}
+
+namespace app {
+
+  // Overlay over the active editor with the timing of the last
+  // frames (paint, editor render, tool loop step, flip), the flipped
+  // area, the hit rate of the caches, and the memory of each
+  // subsystem. The text is updated a few times per second.
+  class PerformanceHud {
+  public:
+    PerformanceHud();
+    ~PerformanceHud();
+
+    static PerformanceHud* instance();
+    static void toggle();
+
+  private:
+    void onTick();
+    void collectLines(std::vector<std::string>& lines);
+    void redraw(const std::vector<std::string>& lines);
+
+    ui::Timer m_timer;
+    std::unique_ptr<ui::Overlay> m_overlay;
+
+    // Counters when the HUD was shown (the hit rates are calculated
+    // from these values)
+    std::size_t m_paintedPixels;
+    std::size_t m_renderedPixels;
+    doc::ImageBufferPool::Stats m_poolStats;
+    doc::BrushStampCache::Stats m_stampStats;
+
+    DISABLE_COPYING(PerformanceHud);
+  };
+
+} // namespace app
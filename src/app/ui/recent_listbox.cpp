@@ -16,11 +16,17 @@
 #include "app/commands/params.h"
 #include "app/pref/preferences.h"
 #include "app/recent_files.h"
+#include "app/thumbnail_generator.h"
 #include "app/ui/skin/skin_theme.h"
 #include "app/ui/skin/style.h"
 #include "app/ui_context.h"
 #include "base/bind.h"
 #include "base/path.h"
+#include "doc/algorithm/rotate.h"
+#include "doc/conversion_she.h"
+#include "doc/image.h"
+#include "she/surface.h"
+#include "she/system.h"
 #include "ui/graphics.h"
 #include "ui/link_label.h"
 #include "ui/listitem.h"
@@ -30,20 +36,62 @@
 #include "ui/system.h"
 #include "ui/view.h"
 
+#include <algorithm>
+#include <memory>
+
 namespace app {
 
 using namespace ui;
 using namespace skin;
 
+namespace {
+
+// Size of the previews of the recent files (without guiscale)
+const int kPreviewSize = 32;
+
+// Creates the preview of the given file from the cache of thumbnails
+// (the file is never loaded). Returns nullptr if the file doesn't
+// have a cached thumbnail.
+she::Surface* create_preview(const std::string& filename)
+{
+  std::unique_ptr<doc::Image> thumbnail(
+    ThumbnailGenerator::instance()->loadCachedThumbnail(filename));
+  if (!thumbnail)
+    return nullptr;
+
+  const int size = kPreviewSize*guiscale();
+  const int max = std::max(thumbnail->width(), thumbnail->height());
+  const int w = std::max(1, size * thumbnail->width() / max);
+  const int h = std::max(1, size * thumbnail->height() / max);
+
+  std::unique_ptr<doc::Image> image(doc::Image::create(doc::IMAGE_RGB, w, h));
+  doc::algorithm::scale_image(image.get(), thumbnail.get(),
+                              0, 0, w, h,
+                              0, 0, thumbnail->width(), thumbnail->height());
+
+  she::Surface* surface = she::instance()->createRgbaSurface(w, h);
+  doc::convert_image_to_surface(image.get(), nullptr, surface,
+                                0, 0, 0, 0, w, h);
+  return surface;
+}
+
+} // anonymous namespace
+
 //////////////////////////////////////////////////////////////////////
 // RecentFileItem
 
 class RecentFileItem : public LinkLabel {
 public:
-  RecentFileItem(const std::string& file)
+  RecentFileItem(const std::string& file, bool preview)
     : LinkLabel(file)
     , m_name(base::get_file_name(file))
-    , m_path(base::get_file_path(file)) {
+    , m_path(base::get_file_path(file))
+    , m_preview(preview ? create_preview(file): nullptr) {
+  }
+
+  ~RecentFileItem() {
+    if (m_preview)
+      m_preview->dispose();
   }
 
 protected:
@@ -54,7 +102,12 @@ protected:
     Style::State state;
     gfx::Size sz1 = style->sizeHint(m_name.c_str(), state);
     gfx::Size sz2 = styleDetail->sizeHint(m_path.c_str(), state);
-    ev.setSizeHint(gfx::Size(sz1.w+sz2.w, MAX(sz1.h, sz2.h)));
+    gfx::Size sz(sz1.w+sz2.w, MAX(sz1.h, sz2.h));
+    if (m_preview) {
+      sz.w += previewWidth();
+      sz.h = MAX(sz.h, kPreviewSize*guiscale());
+    }
+    ev.setSizeHint(sz);
   }
 
   void onPaint(PaintEvent& ev) override {
@@ -69,6 +122,19 @@ protected:
     if (isSelected()) state += Style::active();
     if (parent()->hasCapture()) state += Style::clicked();
 
+    if (m_preview) {
+      // Paint the background of the item below the preview too
+      style->paint(g, bounds, nullptr, state);
+
+      const int size = kPreviewSize*guiscale();
+      g->drawRgbaSurface(m_preview,
+                         bounds.x + (size - m_preview->width())/2,
+                         bounds.y + (bounds.h - m_preview->height())/2);
+
+      bounds.x += previewWidth();
+      bounds.w -= previewWidth();
+    }
+
     style->paint(g, bounds, m_name.c_str(), state);
 
     if (Preferences::instance().general.showFullPath()) {
@@ -85,8 +151,13 @@ protected:
   }
 
 private:
+  int previewWidth() const {
+    return (kPreviewSize+2)*guiscale();
+  }
+
   std::string m_name;
   std::string m_path;
+  she::Surface* m_preview;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -134,7 +205,7 @@ void RecentFilesListBox::onRebuildList()
   auto it = recent->files_begin();
   auto end = recent->files_end();
   for (; it != end; ++it)
-    addChild(new RecentFileItem(it->c_str()));
+    addChild(new RecentFileItem(it->c_str(), true));
 }
 
 void RecentFilesListBox::onClick(const std::string& path)
@@ -159,7 +230,7 @@ void RecentFoldersListBox::onRebuildList()
   auto it = recent->paths_begin();
   auto end = recent->paths_end();
   for (; it != end; ++it)
-    addChild(new RecentFileItem(*it));
+    addChild(new RecentFileItem(*it, false));
 }
 
 void RecentFoldersListBox::onClick(const std::string& path)
@@ -41,6 +41,7 @@
 #include "gfx/size.h"
 #include "she/font.h"
 #include "she/surface.h"
+#include "she/surface_format.h"
 #include "she/system.h"
 #include "ui/intern.h"
 #include "ui/ui.h"
@@ -176,6 +177,8 @@ SkinTheme::~SkinTheme()
     it->second->dispose();
   }
 
+  clearBorderCache();
+
   if (m_sheet)
     m_sheet->dispose();
 
@@ -209,6 +212,9 @@ void SkinTheme::onRegenerate()
 {
   Preferences& pref = Preferences::instance();
 
+  // Parts are going to be reloaded (maybe with a new scale)
+  clearBorderCache();
+
   // First we load the skin from default theme, which is more proper
   // to have every single needed skin part/color/dimension.
   // Then we load the selected theme to redefine default theme parts.
@@ -2239,17 +2245,133 @@ void SkinTheme::drawRect(Graphics* g, const Rect& rc,
   }
 }
 
+// Copies (without blending) the given "src" bitmap tiled in the
+// [from, to) range of a column or a row of "dst", clipped to [clipFrom, clipTo).
+static void copy_tiled(she::Surface* dst, she::Surface* src,
+                       bool horizontal, int fixed,
+                       int from, int to, int clipFrom, int clipTo)
+{
+  she::SurfaceFormatData fmt;
+  src->getFormat(&fmt);
+  const int bpp = fmt.bitsPerPixel / 8;
+  const int step = (horizontal ? src->width(): src->height());
+  if (step <= 0)
+    return;
+
+  for (int pos=from; pos<to; pos+=step) {
+    const int a = std::max(pos, clipFrom);
+    const int b = std::min(pos+step, clipTo);
+    if (a >= b)
+      continue;
+
+    if (horizontal) {
+      for (int y=0; y<src->height(); ++y) {
+        if (fixed+y < 0 || fixed+y >= dst->height())
+          continue;
+        std::copy(src->getData(a-pos, y),
+                  src->getData(b-pos, y),
+                  dst->getData(a, fixed+y));
+      }
+    }
+    else {
+      for (int y=a; y<b; ++y)
+        std::copy(src->getData(0, y-pos),
+                  src->getData(0, y-pos) + bpp*src->width(),
+                  dst->getData(fixed, y));
+    }
+  }
+}
+
+she::Surface* SkinTheme::getBorderSurface(SkinPart* skinPart, const gfx::Size& size)
+{
+  // Small rectangles of the same size (buttons, check boxes, etc.)
+  // are painted again and again with the same parts.
+  const int kMaxBorderArea = 128*64;
+  const std::size_t kMaxBorderCacheSize = 128;
+
+  if (size.w*size.h > kMaxBorderArea || skinPart->countBitmaps() < 8)
+    return nullptr;
+
+  for (std::size_t i=0; i<8; ++i)
+    if (!skinPart->bitmap(i))
+      return nullptr;
+
+  she::Surface* nw = skinPart->bitmapNW();
+  she::Surface* n  = skinPart->bitmapN();
+  she::Surface* ne = skinPart->bitmapNE();
+  she::Surface* e  = skinPart->bitmapE();
+  she::Surface* se = skinPart->bitmapSE();
+  she::Surface* s  = skinPart->bitmapS();
+  she::Surface* sw = skinPart->bitmapSW();
+  she::Surface* w  = skinPart->bitmapW();
+
+  // Parts must not overlap, in other case they are blended between
+  // them and we cannot just copy them.
+  if (nw->width()+ne->width() > size.w ||
+      sw->width()+se->width() > size.w ||
+      nw->height()+sw->height() > size.h ||
+      ne->height()+se->height() > size.h ||
+      n->height() > std::min(nw->height(), ne->height()) ||
+      s->height() > std::min(sw->height(), se->height()) ||
+      w->width() > std::min(nw->width(), sw->width()) ||
+      e->width() > std::min(ne->width(), se->width()))
+    return nullptr;
+
+  auto key = std::make_tuple(skinPart, size.w, size.h);
+  auto it = m_borderCache.find(key);
+  if (it != m_borderCache.end())
+    return it->second;
+
+  if (m_borderCache.size() >= kMaxBorderCacheSize)
+    clearBorderCache();
+
+  she::Surface* sur = she::instance()->createRgbaSurface(size.w, size.h);
+  {
+    she::SurfaceLock lockDst(sur);
+    she::SurfaceLock lockNW(nw), lockN(n), lockNE(ne), lockE(e);
+    she::SurfaceLock lockSE(se), lockS(s), lockSW(sw), lockW(w);
+    sur->clear();
+
+    const int W = size.w, H = size.h;
+
+    // Same layout of drawRect(Graphics*, Rect, nw, n, ...)
+    copy_tiled(sur, nw, true, 0, 0, nw->width(), 0, nw->width());
+    copy_tiled(sur, n, true, 0, nw->width(), W-ne->width(), nw->width(), W-ne->width());
+    copy_tiled(sur, ne, true, 0, W-ne->width(), W, W-ne->width(), W);
+
+    copy_tiled(sur, sw, true, H-sw->height(), 0, sw->width(), 0, sw->width());
+    copy_tiled(sur, s, true, H-s->height(), sw->width(), W-se->width(), sw->width(), W-se->width());
+    copy_tiled(sur, se, true, H-se->height(), W-se->width(), W, W-se->width(), W);
+
+    copy_tiled(sur, w, false, 0, nw->height(), H-sw->height(), nw->height(), H-sw->height());
+    copy_tiled(sur, e, false, W-e->width(), ne->height(), H-se->height(), nw->height(), H-sw->height());
+  }
+
+  m_borderCache[key] = sur;
+  return sur;
+}
+
+void SkinTheme::clearBorderCache()
+{
+  for (auto& item : m_borderCache)
+    item.second->dispose();
+  m_borderCache.clear();
+}
+
 void SkinTheme::drawRect(ui::Graphics* g, const gfx::Rect& rc, SkinPart* skinPart, gfx::Color bg)
 {
-  drawRect(g, rc,
-    skinPart->bitmap(0),
-    skinPart->bitmap(1),
-    skinPart->bitmap(2),
-    skinPart->bitmap(3),
-    skinPart->bitmap(4),
-    skinPart->bitmap(5),
-    skinPart->bitmap(6),
-    skinPart->bitmap(7));
+  if (she::Surface* border = getBorderSurface(skinPart, rc.size()))
+    g->drawRgbaSurface(border, rc.x, rc.y);
+  else
+    drawRect(g, rc,
+      skinPart->bitmap(0),
+      skinPart->bitmap(1),
+      skinPart->bitmap(2),
+      skinPart->bitmap(3),
+      skinPart->bitmap(4),
+      skinPart->bitmap(5),
+      skinPart->bitmap(6),
+      skinPart->bitmap(7));
 
   // Center
   if (!is_transparent(bg)) {
@@ -17,8 +17,10 @@
 #include "skin.xml.h"
 
 #include <map>
-#include <string>
 #include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
 
 namespace ui {
   class Entry;
@@ -101,12 +103,17 @@ namespace app {
         return m_stylesheet.getStyle(id);
       }
 
-      SkinPartPtr getPartById(const std::string& id) {
-        return m_parts_by_id[id];
+      // Prefer the typed accessors generated from skin.xml (parts.*,
+      // dimensions.*, colors.*), which are resolved only once when the
+      // theme is loaded. These are for ids built at runtime.
+      SkinPartPtr getPartById(const std::string& id) const {
+        auto it = m_parts_by_id.find(id);
+        return (it != m_parts_by_id.end() ? it->second: SkinPartPtr());
       }
 
-      int getDimensionById(const std::string& id) {
-        return m_dimensions_by_id[id] * ui::guiscale();
+      int getDimensionById(const std::string& id) const {
+        auto it = m_dimensions_by_id.find(id);
+        return (it != m_dimensions_by_id.end() ? it->second * ui::guiscale(): 0);
       }
 
       gfx::Color getColorById(const std::string& id);
@@ -122,6 +129,8 @@ namespace app {
       void loadThemeXml(const std::string& filename);
 
       she::Surface* sliceSheet(she::Surface* sur, const gfx::Rect& bounds);
+      she::Surface* getBorderSurface(SkinPart* skinPart, const gfx::Size& size);
+      void clearBorderCache();
       gfx::Color getWidgetBgColor(ui::Widget* widget);
       void drawTextString(ui::Graphics* g, const char *t, gfx::Color fg_color, gfx::Color bg_color,
                           ui::Widget* widget, const gfx::Rect& rc,
@@ -133,10 +142,13 @@ namespace app {
       std::shared_ptr<she::Font> loadFont(const std::vector<std::string>& fonts, std::size_t);
 
       she::Surface* m_sheet;
-      std::map<std::string, SkinPartPtr> m_parts_by_id;
+      std::unordered_map<std::string, SkinPartPtr> m_parts_by_id;
       std::map<std::string, she::Surface*> m_toolicon;
-      std::map<std::string, gfx::Color> m_colors_by_id;
-      std::map<std::string, int> m_dimensions_by_id;
+      std::unordered_map<std::string, gfx::Color> m_colors_by_id;
+      std::unordered_map<std::string, int> m_dimensions_by_id;
+      // Borders of skin parts already composited for a specific size
+      // (see drawRect()), so they can be drawn with just one blit.
+      std::map<std::tuple<const SkinPart*, int, int>, she::Surface*> m_borderCache;
       std::vector<ui::Cursor*> m_cursors;
       StyleSheet m_stylesheet;
       std::shared_ptr<she::Font> m_defaultFont;
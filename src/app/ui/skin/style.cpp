@@ -209,21 +209,35 @@ gfx::Size Rules::sizeHint(const char* text, int maxWidth)
 Style::Style(css::Sheet& sheet, const std::string& id)
   : m_id(id)
   , m_compoundStyle(sheet.compoundStyle(id))
+  , m_rulesVersion(m_compoundStyle.version())
 {
 }
 
 Style::~Style()
+{
+  deleteRules();
+}
+
+void Style::deleteRules()
 {
   for (RulesMap::iterator it = m_rules.begin(), end = m_rules.end();
        it != end; ++it) {
     delete it->second;
   }
+  m_rules.clear();
 }
 
 Rules* Style::getRulesFromState(const State& state)
 {
   Rules* rules = NULL;
 
+  // Convert the rules again if the sheet was reloaded
+  const int version = m_compoundStyle.version();
+  if (m_rulesVersion != version) {
+    deleteRules();
+    m_rulesVersion = version;
+  }
+
   RulesMap::iterator it = m_rules.find(state);
   if (it != m_rules.end()) {
     rules = it->second;
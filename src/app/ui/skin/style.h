@@ -146,10 +146,12 @@ namespace app {
       typedef std::map<State, Rules*> RulesMap;
 
       Rules* getRulesFromState(const State& state);
+      void deleteRules();
 
       std::string m_id;
       css::CompoundStyle m_compoundStyle;
       RulesMap m_rules;
+      int m_rulesVersion;
 
       static css::State m_hoverState;
       static css::State m_activeState;
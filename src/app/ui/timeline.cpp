@@ -51,6 +51,7 @@
 #include "ui/scroll_helper.h"
 #include "ui/ui.h"
 
+#include <algorithm>
 #include <cstdio>
 
 // Size of the thumbnail in the screen (width x height), the really
@@ -253,8 +254,10 @@ void Timeline::setFrame(frame_t frame, bool byUser)
   else if (frame >= m_sprite->totalFrames())
     frame = frame_t(m_sprite->totalFrames()-1);
 
-  m_frame = frame;
-  invalidate();
+  if (m_frame != frame) {
+    invalidateFrameChange(m_frame, frame);
+    m_frame = frame;
+  }
 
   if (m_editor->frame() != frame) {
     bool isPlaying = m_editor->isPlaying();
@@ -1168,11 +1171,15 @@ void Timeline::onAfterFrameChanged(Editor* editor)
 
   setFrame(editor->frame(), false);
 
-  if (!hasCapture())
+  // setFrame() invalidates just the cels that depend on the current
+  // frame (e.g. while the animation is played), unless there is a
+  // range to hide.
+  if (!hasCapture() && m_range.enabled()) {
     m_range.disableRange();
+    invalidate();
+  }
 
   showCurrentCel();
-  invalidate();
 }
 
 void Timeline::onAfterLayerChanged(Editor* editor)
@@ -1246,6 +1253,21 @@ void Timeline::getDrawableLayers(ui::Graphics* g, LayerIndex* first_layer, Layer
   else
     j = LayerIndex::NoLayer;
 
+  // Only the rows that intersect the clip (e.g. a cel invalidated by
+  // invalidateFrame()) are drawn.
+  if (j >= i) {
+    const gfx::Rect clip = g->getClipBounds();
+    const int y0 = topHeight() + HDRSIZE - viewScroll().y;
+    const int row1 = std::max(0, clip.y - y0) / LAYSIZE;
+    const int row2 = (clip.y2() - y0 - 1);
+    if (row2 < 0)
+      j = i - LayerIndex(1);
+    else {
+      j = std::min(j, lastLayer() - LayerIndex(row1));
+      i = std::max(i, lastLayer() - LayerIndex(row2 / LAYSIZE));
+    }
+  }
+
   *first_layer = i;
   *last_layer = j;
 }
@@ -1256,6 +1278,17 @@ void Timeline::getDrawableFrames(ui::Graphics* g, frame_t* first_frame, frame_t*
 
   *first_frame = frame_t(viewScroll().x / FRMSIZE);
   *last_frame = *first_frame + frame_t(availW / FRMSIZE) + ((availW % FRMSIZE) > 0 ? 1: 0);
+
+  // Only the columns that intersect the clip are drawn.
+  const gfx::Rect clip = g->getClipBounds();
+  const int x0 = m_separator_x + m_separator_w - 1 - viewScroll().x;
+  const int col2 = (clip.x2() - x0 - 1);
+  if (col2 < 0)
+    *last_frame = *first_frame - 1;
+  else {
+    *first_frame = std::max(*first_frame, frame_t(std::max(0, clip.x - x0) / FRMSIZE));
+    *last_frame = std::min(*last_frame, frame_t(col2 / FRMSIZE));
+  }
 }
 
 void Timeline::drawPart(ui::Graphics* g, const gfx::Rect& bounds,
@@ -1567,7 +1600,15 @@ void Timeline::drawFrameTags(ui::Graphics* g)
       clientBounds().w,
       theme->dimensions.timelineTagsAreaHeight()));
 
+  frame_t first_frame, last_frame;
+  getDrawableFrames(g, &first_frame, &last_frame);
+
   for (FrameTag* frameTag : m_sprite->frameTags()) {
+    // Tags that start after the visible frames cannot be seen (the
+    // label is drawn from the first frame of the tag).
+    if (frameTag->fromFrame() > last_frame)
+      continue;
+
     gfx::Rect bounds1 = getPartBounds(Hit(PART_HEADER_FRAME, firstLayer(), frameTag->fromFrame()));
     gfx::Rect bounds2 = getPartBounds(Hit(PART_HEADER_FRAME, firstLayer(), frameTag->toFrame()));
     gfx::Rect bounds = bounds1.createUnion(bounds2);
@@ -1581,6 +1622,9 @@ void Timeline::drawFrameTags(ui::Graphics* g)
 
     {
       bounds = getPartBounds(Hit(PART_FRAME_TAG, LayerIndex(0), 0, frameTag->id()));
+      IntersectClip labelClip(g, bounds);
+      if (!labelClip)
+        continue;
 
       gfx::Color bg = frameTag->color();
       if (m_clk.part == PART_FRAME_TAG && m_clk.frameTag == frameTag->id()) {
@@ -1916,6 +1960,31 @@ void Timeline::invalidateHit(const Hit& hit)
   invalidateRect(getPartBounds(hit).offset(origin()));
 }
 
+// Invalidates the parts of the timeline that change when the current
+// frame goes from oldFrame to newFrame: both columns of frames (the
+// active frame is highlighted), the frame headers (onionskin range),
+// and the row of the active layer (links of the active cel).
+void Timeline::invalidateFrameChange(frame_t oldFrame, frame_t newFrame)
+{
+  const gfx::Rect client = clientBounds();
+
+  for (frame_t frame : { oldFrame, newFrame }) {
+    gfx::Rect rc = getPartBounds(Hit(PART_HEADER_FRAME, firstLayer(), frame));
+    rc.y = client.y;
+    rc.h = client.h;
+    invalidateRect(rc.offset(origin()));
+  }
+
+  invalidateRect(getFrameHeadersBounds().offset(origin()));
+
+  LayerIndex layer = getLayerIndex(m_layer);
+  if (validLayer(layer)) {
+    gfx::Rect rc = getPartBounds(Hit(PART_LAYER, layer));
+    rc.w = client.w;
+    invalidateRect(rc.offset(origin()));
+  }
+}
+
 void Timeline::regenerateLayers()
 {
   ASSERT(m_document != NULL);
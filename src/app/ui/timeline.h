@@ -216,6 +216,7 @@ namespace app {
     gfx::Rect getPartBounds(const Hit& hit) const;
     gfx::Rect getRangeBounds(const Range& range) const;
     void invalidateHit(const Hit& hit);
+    void invalidateFrameChange(frame_t oldFrame, frame_t newFrame);
     void regenerateLayers();
     void updateScrollBars();
     void updateByMousePos(ui::Message* msg, const gfx::Point& mousePos);
@@ -0,0 +1,150 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/undo_swap.h"
+
+#include "base/debug.h"
+#include "base/fs.h"
+#include "base/path.h"
+#include "base/process.h"
+
+namespace app {
+
+UndoSwap::UndoSwap()
+  : m_fileSize(0)
+  , m_storedBytes(0)
+  , m_slots(0)
+{
+}
+
+UndoSwap::~UndoSwap()
+{
+  closeFile();
+}
+
+// static
+UndoSwap& UndoSwap::instance()
+{
+  static UndoSwap swap;
+  return swap;
+}
+
+void UndoSwap::setFilename(const std::string& filename)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_filename = filename;
+  if (m_slots == 0)
+    closeFile();
+}
+
+std::size_t UndoSwap::storedBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_storedBytes;
+}
+
+bool UndoSwap::openFile()
+{
+  if (m_file.is_open())
+    return true;
+
+  m_openFilename = m_filename;
+  if (m_openFilename.empty()) {
+    m_openFilename = base::join_path(
+      base::get_temp_path(),
+      "libresprite-undo-" + std::to_string(base::get_current_process_id()) + ".bin");
+  }
+
+  m_file.open(m_openFilename, std::ios::in | std::ios::out |
+                              std::ios::trunc | std::ios::binary);
+  m_fileSize = 0;
+  m_freeSlots.clear();
+  return m_file.is_open();
+}
+
+void UndoSwap::closeFile()
+{
+  if (!m_file.is_open())
+    return;
+
+  m_file.close();
+  try {
+    base::delete_file(m_openFilename);
+  }
+  catch (...) {
+    // Ignore errors removing the temporary file
+  }
+}
+
+bool UndoSwap::store(const std::vector<uint8_t>& data, Slot& slot)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!openFile())
+    return false;
+
+  const uint32_t size = uint32_t(data.size());
+
+  // Reuse the smallest free slot where the data fits
+  auto it = m_freeSlots.lower_bound(size);
+  if (it != m_freeSlots.end()) {
+    slot.capacity = it->first;
+    slot.offset = it->second;
+    m_freeSlots.erase(it);
+  }
+  else {
+    slot.capacity = size;
+    slot.offset = m_fileSize;
+    m_fileSize += size;
+  }
+  slot.size = size;
+
+  m_file.clear();
+  m_file.seekp(std::streamoff(slot.offset));
+  if (!m_file.write((const char*)data.data(), size) || !m_file.flush()) {
+    m_file.clear();
+    m_freeSlots.insert(std::make_pair(slot.capacity, slot.offset));
+    return false;
+  }
+
+  ++m_slots;
+  m_storedBytes += size;
+  return true;
+}
+
+bool UndoSwap::load(const Slot& slot, std::vector<uint8_t>& data)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  data.resize(slot.size);
+
+  m_file.clear();
+  m_file.seekg(std::streamoff(slot.offset));
+  if (!m_file.read((char*)data.data(), slot.size)) {
+    m_file.clear();
+    return false;
+  }
+  return true;
+}
+
+void UndoSwap::release(const Slot& slot)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ASSERT(m_slots > 0);
+
+  m_storedBytes -= slot.size;
+  m_freeSlots.insert(std::make_pair(slot.capacity, slot.offset));
+
+  // Delete the file when it's not used (e.g. all documents with
+  // swapped undo states were closed)
+  if (--m_slots == 0)
+    closeFile();
+}
+
+} // namespace app
@@ -0,0 +1,68 @@
+// LibreSprite
+// Copyright (C) 2026 LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "base/disable_copying.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace app {
+
+  // Swap file for the data of old undo states. Commands can move
+  // their undo data here (see Cmd::swapOut()) and read it again when
+  // the user undoes/redoes them. The file is created the first
+  // time it's needed (in the data recovery session directory, or
+  // in the temporary directory) and deleted when no command uses it.
+  class UndoSwap {
+  public:
+    struct Slot {
+      uint64_t offset = 0;
+      uint32_t size = 0;
+      uint32_t capacity = 0;
+    };
+
+    UndoSwap();
+    ~UndoSwap();
+
+    // Changes the file used to store the next data, it's used only
+    // when the current file is not in use.
+    void setFilename(const std::string& filename);
+
+    bool store(const std::vector<uint8_t>& data, Slot& slot);
+    bool load(const Slot& slot, std::vector<uint8_t>& data);
+    void release(const Slot& slot);
+
+    // Sum of the sizes of all the stored data.
+    std::size_t storedBytes() const;
+
+    static UndoSwap& instance();
+
+  private:
+    bool openFile();
+    void closeFile();
+
+    mutable std::mutex m_mutex;
+    std::string m_filename;
+    std::string m_openFilename;
+    std::fstream m_file;
+    uint64_t m_fileSize;
+    std::size_t m_storedBytes;
+    int m_slots;
+    // Unused slots of the file sorted by capacity
+    std::multimap<uint32_t, uint64_t> m_freeSlots;
+
+    DISABLE_COPYING(UndoSwap);
+  };
+
+} // namespace app
@@ -15,9 +15,11 @@ namespace doc {
 
 namespace app {
 
+  // Bounds (inclusive) of the pixels that are different to "refpixel"
+  // (or to the pixels of "refimage"), see doc::algorithm::shrink_bounds().
   bool get_shrink_rect(int* x1, int* y1, int* x2, int* y2,
                        doc::Image *image, doc::color_t refpixel);
   bool get_shrink_rect2(int* x1, int* y1, int* x2, int* y2,
-                        doc::Image* image, doc::Image* regimage);
+                        doc::Image* image, doc::Image* refimage);
 
 } // namespace app
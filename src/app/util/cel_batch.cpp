@@ -0,0 +1,76 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/util/cel_batch.h"
+
+#include "app/document_api.h"
+#include "app/job.h"
+#include "base/thread_pool.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace app {
+
+using namespace doc;
+
+bool replace_cel_images(DocumentApi& api,
+                        Sprite* sprite,
+                        const CelList& cels,
+                        const CelImageFunc& func,
+                        Job* job)
+{
+  // Only one cel for each image (linked cels share the image, and
+  // it can be replaced just once)
+  std::vector<Cel*> targets;
+  std::set<ObjectId> images;
+  for (const auto& cel : cels) {
+    if (cel->image() && images.insert(cel->image()->id()).second)
+      targets.push_back(cel.get());
+  }
+
+  // The images are created in batches to report the progress and
+  // check if the job was canceled
+  base::thread_pool& pool = base::thread_pool::instance();
+  const int n = int(targets.size());
+  const int batchSize = (job ? 4*pool.concurrency(): n);
+  std::vector<ImageRef> newImages(n);
+
+  for (int begin=0; begin<n; begin+=batchSize) {
+    pool.parallel_for(
+      std::min(batchSize, n-begin),
+      [&targets, &newImages, &func, begin](int i) {
+        newImages[begin+i] = func(targets[begin+i]);
+      });
+
+    if (job) {
+      job->jobProgress(double(std::min(begin+batchSize, n)) / n);
+      if (job->isCanceled())
+        return false;
+    }
+  }
+
+  std::vector<ImageRef> oldImages;
+  std::vector<ImageRef> replacedImages;
+  for (int i=0; i<n; ++i) {
+    if (newImages[i]) {
+      oldImages.push_back(targets[i]->imageRef());
+      replacedImages.push_back(newImages[i]);
+    }
+  }
+  api.replaceImages(sprite, oldImages, replacedImages);
+  return true;
+}
+
+} // namespace app
@@ -0,0 +1,42 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "doc/cel_list.h"
+#include "doc/image_ref.h"
+
+#include <functional>
+
+namespace doc {
+  class Cel;
+  class Sprite;
+}
+
+namespace app {
+  class DocumentApi;
+  class Job;
+
+  // Creates the new image of a cel (or returns nullptr to keep the
+  // current one). It's called from several threads at the same time,
+  // so it can only read the cel and the sprite.
+  typedef std::function<doc::ImageRef(const doc::Cel* cel)> CelImageFunc;
+
+  // Applies an image operation to a whole set of cels: the new images
+  // are created in parallel with the shared thread pool, and then all
+  // of them replace the old ones with one undoable command (see
+  // DocumentApi::replaceImages()). Linked cels are processed once.
+  //
+  // If a "job" is given, the progress is reported to it, and nothing
+  // is replaced if it's canceled (returns false in that case).
+  bool replace_cel_images(DocumentApi& api,
+                          doc::Sprite* sprite,
+                          const doc::CelList& cels,
+                          const CelImageFunc& func,
+                          Job* job = nullptr);
+
+} // namespace app
@@ -34,7 +34,10 @@
 #include "base/shared_ptr.h"
 #include "doc/doc.h"
 #include "render/quantization.h"
+#include "ui/manager.h"
+#include "ui/timer.h"
 
+#include <memory>
 #include <stdexcept>
 
 namespace app {
@@ -97,6 +100,14 @@ static ImageRef clipboard_image;
 static base::SharedPtr<Mask> clipboard_mask;
 static ClipboardRange clipboard_range;
 
+// The native clipboard is updated in a timer tick after the copy (so
+// copy commands return immediately, and only the last image of
+// consecutive copies is converted).
+static const int kNativeClipboardDelay = 10; // Milliseconds
+static bool native_clipboard_pending = false;
+static bool native_clipboard_transparent = false;
+static std::unique_ptr<ui::Timer> native_clipboard_timer;
+
 static ClipboardManager* g_instance = nullptr;
 
 ClipboardManager::ClipboardManager()
@@ -128,6 +139,55 @@ ClipboardManager* ClipboardManager::instance()
   return g_instance;
 }
 
+static void flush_native_clipboard()
+{
+  if (native_clipboard_timer)
+    native_clipboard_timer->stop();
+
+  if (!native_clipboard_pending)
+    return;
+
+  native_clipboard_pending = false;
+
+  // Copy image to the native clipboard
+  Image* image = clipboard_image.get();
+  color_t oldMask;
+  if (image) {
+    oldMask = image->maskColor();
+    if (!native_clipboard_transparent)
+      image->setMaskColor(-1);
+  }
+
+  set_native_clipboard_bitmap(image, clipboard_mask.get(), clipboard_palette.get());
+
+  if (image && !native_clipboard_transparent)
+    image->setMaskColor(oldMask);
+}
+
+static void schedule_native_clipboard(bool image_source_is_transparent)
+{
+  native_clipboard_pending = true;
+  native_clipboard_transparent = image_source_is_transparent;
+
+  // Without UI (e.g. batch mode) we update the clipboard right now
+  if (!ui::Manager::getDefault()) {
+    flush_native_clipboard();
+    return;
+  }
+
+  if (!native_clipboard_timer) {
+    native_clipboard_timer.reset(new ui::Timer(kNativeClipboardDelay));
+    native_clipboard_timer->Tick.connect(&flush_native_clipboard);
+
+    App::instance()->Exit.connect(
+      []{
+        flush_native_clipboard();
+        native_clipboard_timer.reset();
+      });
+  }
+  native_clipboard_timer->start();
+}
+
 static void set_clipboard_image(Image* image,
                                 Mask* mask,
                                 std::shared_ptr<Palette> palette,
@@ -139,20 +199,10 @@ static void set_clipboard_image(Image* image,
   clipboard_image.reset(image);
   clipboard_mask.reset(mask);
 
-  // Copy image to the native clipboard
-  if (set_system_clipboard) {
-    color_t oldMask;
-    if (image) {
-      oldMask = image->maskColor();
-      if (!image_source_is_transparent)
-        image->setMaskColor(-1);
-    }
-
-    set_native_clipboard_bitmap(image, mask, palette.get());
-
-    if (image && !image_source_is_transparent)
-      image->setMaskColor(oldMask);
-  }
+  if (set_system_clipboard)
+    schedule_native_clipboard(image_source_is_transparent);
+  else
+    native_clipboard_pending = false;
 
   clipboard_range.invalidate();
 }
@@ -180,8 +230,9 @@ static bool copy_from_document(const Site& site, bool merged = false)
 
 ClipboardFormat get_current_format()
 {
-  // Check if the native clipboard has an image
-  if (has_native_clipboard_bitmap())
+  // Check if the native clipboard has an image (if the native
+  // clipboard isn't updated yet, our content is the newest one)
+  if (!native_clipboard_pending && has_native_clipboard_bitmap())
     return ClipboardImage;
   else if (clipboard_image)
     return ClipboardImage;
@@ -302,8 +353,10 @@ void paste()
   switch (get_current_format()) {
 
     case clipboard::ClipboardImage: {
-      // Get the image from the clipboard.
-      {
+      // Get the image from the native clipboard only if it's not our
+      // own image (in that case we use clipboard_image directly,
+      // without decoding the native data).
+      if (!native_clipboard_pending && !is_native_clipboard_owner()) {
         Image* native_image = nullptr;
         Mask* native_mask = nullptr;
         std::shared_ptr<Palette> native_palette;
@@ -544,15 +597,17 @@ void paste()
 bool get_image_size(gfx::Size& size)
 {
 #if !defined(EMSCRIPTEN) && !defined(ANDROID)
-  if (get_native_clipboard_bitmap_size(&size))
-    return true;
-#else
+  // Our image is the newest one while the native clipboard isn't
+  // updated yet
+  if (!native_clipboard_pending)
+    return get_native_clipboard_bitmap_size(&size);
+#endif
+
   if (clipboard_image) {
     size.w = clipboard_image->width();
     size.h = clipboard_image->height();
     return true;
   }
-#endif
 
   return false;
 }
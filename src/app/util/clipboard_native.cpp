@@ -11,6 +11,8 @@
 
 #include "app/util/clipboard_native.h"
 
+#include "app/pref/preferences.h"
+#include "base/process.h"
 #include "base/serialization.h"
 #include "clip/clip.h"
 #include "doc/color_scales.h"
@@ -37,6 +39,11 @@ using namespace base::serialization::little_endian;
 namespace {
   clip::format custom_image_format = 0;
 
+  // Format with the ID of the last content that we've set in the
+  // native clipboard (to know if the clipboard is still ours)
+  clip::format owner_format = 0;
+  uint32_t owner_id = 0;
+
   void* native_display_handle() {
     return she::instance()->defaultDisplay()->nativeHandle();
   }
@@ -58,6 +65,26 @@ void register_native_clipboard_formats()
 {
   clip::set_error_handler(custom_error_handler);
   custom_image_format = clip::register_format("org.aseprite.Image");
+  owner_format = clip::register_format("org.libresprite.ClipboardOwner");
+}
+
+bool is_native_clipboard_owner()
+{
+  if (!owner_format || !owner_id)
+    return false;
+
+  clip::lock l(native_display_handle());
+  if (!l.locked() ||
+      !l.is_convertible(owner_format) ||
+      l.get_data_length(owner_format) != 2*sizeof(uint32_t))
+    return false;
+
+  uint32_t data[2];
+  if (!l.get_data(owner_format, (char*)data, sizeof(data)))
+    return false;
+
+  return (data[0] == uint32_t(base::get_current_process_id()) &&
+          data[1] == owner_id);
 }
 
 bool has_native_clipboard_bitmap()
@@ -78,6 +105,11 @@ bool set_native_clipboard_bitmap(const doc::Image* image,
   if (!image)
     return false;
 
+  if (owner_format) {
+    uint32_t data[2] = { uint32_t(base::get_current_process_id()), ++owner_id };
+    l.set_data(owner_format, (const char*)data, sizeof(data));
+  }
+
   // Set custom clipboard formats
   if (custom_image_format) {
     std::stringstream os;
@@ -85,7 +117,11 @@ bool set_native_clipboard_bitmap(const doc::Image* image,
             (image   ? 1: 0) |
             (mask    ? 2: 0) |
             (palette ? 4: 0));
-    if (image) doc::write_image(os, image);
+    if (image)
+      doc::write_image(os, image,
+                       Preferences::instance().general.fastClipboard() ?
+                       doc::ImageCompression::Qoi:
+                       doc::ImageCompression::Zlib);
     if (mask) doc::write_mask(os, mask);
     if (palette) doc::write_palette(os, *palette);
 
@@ -21,6 +21,9 @@ namespace clipboard {
 
 void register_native_clipboard_formats();
 bool has_native_clipboard_bitmap();
+// Returns true if the native clipboard still contains the last image
+// set with set_native_clipboard_bitmap() from this process.
+bool is_native_clipboard_owner();
 bool set_native_clipboard_bitmap(const doc::Image* image,
                                  const doc::Mask* mask,
                                  const doc::Palette* palette);
@@ -10,6 +10,7 @@
 #endif
 
 #include "doc/cel.h"
+#include "doc/cel_data.h"
 #include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
@@ -27,6 +28,24 @@ std::shared_ptr<Cel> create_cel_copy(std::shared_ptr<const Cel> srcCel,
                      const Sprite* dstSprite,
                      const frame_t dstFrame)
 {
+  const Sprite* srcSprite = srcCel->sprite();
+
+  // The copy of an unmodified image that is compressed or swapped out
+  // shares the compressed pixels (it's decoded when it's used), so
+  // duplicated sprites and layers don't need more memory until then.
+  if (srcSprite->pixelFormat() == dstSprite->pixelFormat() &&
+      (dstSprite->pixelFormat() != IMAGE_INDEXED ||
+       !srcSprite->palette(srcCel->frame())->countDiff(*dstSprite->palette(dstFrame), nullptr, nullptr))) {
+    CelDataRef celData(new CelData(ImageRef(Image::create(dstSprite->pixelFormat(), 1, 1))));
+    if (celData->setCompressedCopyOf(*srcCel->data())) {
+      auto dstCel = std::make_shared<Cel>(dstFrame, celData);
+      dstCel->setPosition(srcCel->position());
+      dstCel->setOpacity(srcCel->opacity());
+      dstCel->data()->setUserData(srcCel->data()->userData());
+      return dstCel;
+    }
+  }
+
   const Image* celImage = srcCel->image();
 
   std::unique_ptr<Cel> dstCel(
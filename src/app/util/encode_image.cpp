@@ -0,0 +1,160 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/util/encode_image.h"
+
+#include "doc/color.h"
+#include "doc/image.h"
+#include "doc/palette.h"
+
+#include "png.h"
+
+#include <qoi.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace app {
+
+using namespace doc;
+
+namespace {
+
+// Returns a pointer to the "y" row of the image in RGBA format (the
+// row of the image itself if it's RGB, or "buf" with the converted
+// pixels).
+const uint8_t* get_rgba_row(const Image* image, const Palette* palette,
+                            int y, std::vector<uint8_t>& buf)
+{
+  if (image->pixelFormat() == IMAGE_RGB)
+    return image->getPixelAddress(0, y);
+
+  buf.resize(4*image->width());
+  uint32_t* dst = (uint32_t*)&buf[0];
+  for (int x=0; x<image->width(); ++x, ++dst) {
+    color_t c = image->getPixel(x, y);
+    switch (image->pixelFormat()) {
+      case IMAGE_GRAYSCALE:
+        c = rgba(graya_getv(c), graya_getv(c), graya_getv(c), graya_geta(c));
+        break;
+      case IMAGE_INDEXED:
+        if (c == image->maskColor())
+          c = rgba(0, 0, 0, 0);
+        else if (palette)
+          c = palette->getEntry(c);
+        else
+          c = rgba(c, c, c, 255);
+        break;
+      case IMAGE_BITMAP:
+        c = (c ? rgba(255, 255, 255, 255): rgba(0, 0, 0, 255));
+        break;
+      default:
+        break;
+    }
+    *dst = c;
+  }
+  return &buf[0];
+}
+
+void png_write_to_vector(png_structp png, png_bytep data, png_size_t length)
+{
+  auto output = (std::vector<uint8_t>*)png_get_io_ptr(png);
+  output->insert(output->end(), data, data+length);
+}
+
+void png_flush_nothing(png_structp png)
+{
+  // Do nothing
+}
+
+} // anonymous namespace
+
+bool encode_image_as_png(const Image* image,
+                         const Palette* palette,
+                         int compressionLevel,
+                         std::vector<uint8_t>& output)
+{
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+                                            nullptr, nullptr, nullptr);
+  if (!png)
+    return false;
+
+  png_infop info = png_create_info_struct(png);
+  if (!info) {
+    png_destroy_write_struct(&png, nullptr);
+    return false;
+  }
+
+  std::vector<uint8_t> rowBuf;
+  output.clear();
+  // Reserve some space to avoid reallocating the output several times
+  output.reserve(std::size_t(image->width())*image->height() + 1024);
+
+  if (setjmp(png_jmpbuf(png))) {
+    png_destroy_write_struct(&png, &info);
+    output.clear();
+    return false;
+  }
+
+  png_set_write_fn(png, &output, png_write_to_vector, png_flush_nothing);
+  png_set_compression_level(png, std::clamp(compressionLevel, -1, 9));
+  png_set_IHDR(png, info, image->width(), image->height(), 8,
+               PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+
+  for (int y=0; y<image->height(); ++y)
+    png_write_row(png, (png_bytep)get_rgba_row(image, palette, y, rowBuf));
+
+  png_write_end(png, info);
+  png_destroy_write_struct(&png, &info);
+  return true;
+}
+
+bool encode_image_as_qoi(const Image* image,
+                         const Palette* palette,
+                         std::vector<uint8_t>& output)
+{
+  qoi_desc desc;
+  desc.width = image->width();
+  desc.height = image->height();
+  desc.channels = 4;
+  desc.colorspace = QOI_SRGB;
+
+  // QOI needs all the pixels in one block, only RGB images can be
+  // encoded without a copy
+  std::vector<uint8_t> pixels;
+  const void* data;
+  if (image->pixelFormat() == IMAGE_RGB) {
+    data = image->getPixelAddress(0, 0);
+  }
+  else {
+    std::vector<uint8_t> rowBuf;
+    const std::size_t rowSize = 4*image->width();
+    pixels.resize(rowSize*image->height());
+    for (int y=0; y<image->height(); ++y)
+      std::memcpy(&pixels[y*rowSize], get_rgba_row(image, palette, y, rowBuf), rowSize);
+    data = &pixels[0];
+  }
+
+  int size = 0;
+  std::unique_ptr<void, decltype(&free)> encoded(qoi_encode(data, &desc, &size), free);
+  if (!encoded)
+    return false;
+
+  output.assign((const uint8_t*)encoded.get(),
+                (const uint8_t*)encoded.get() + size);
+  return true;
+}
+
+} // namespace app
@@ -0,0 +1,36 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace doc {
+  class Image;
+  class Palette;
+}
+
+namespace app {
+
+  // Encodes the image in memory, reading the rows of the image
+  // directly (RGB images aren't copied, other formats are converted
+  // to RGBA row by row, indexed images with the given palette).
+  // Returns false if the image cannot be encoded.
+
+  // "compressionLevel" goes from 0 (no compression) to 9 (best
+  // compression, slowest), or -1 to use the zlib default.
+  bool encode_image_as_png(const doc::Image* image,
+                           const doc::Palette* palette,
+                           int compressionLevel,
+                           std::vector<uint8_t>& output);
+
+  bool encode_image_as_qoi(const doc::Image* image,
+                           const doc::Palette* palette,
+                           std::vector<uint8_t>& output);
+
+} // namespace app
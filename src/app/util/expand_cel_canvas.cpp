@@ -20,6 +20,7 @@
 #include "app/document.h"
 #include "app/transaction.h"
 #include "app/util/range_utils.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/image.h"
@@ -28,12 +29,25 @@
 #include "doc/site.h"
 #include "doc/sprite.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace {
 
 // We cannot have two ExpandCelCanvas instances at the same time
 // (because we share ImageBuffers between them).
 static app::ExpandCelCanvas* singleton = nullptr;
 
+// Size of the tiles used to track the modified area of the canvas.
+// The valid regions of the source/destination canvas grow by whole
+// tiles too, so they keep a small number of rectangles on long
+// strokes.
+const int kDirtyTileSize = 32;
+
+// Minimum number of pixels to copy/compare before we split the work
+// between the threads of the pool.
+const int kParallelPixels = 256*256;
+
 static doc::ImageBufferPtr src_buffer;
 static doc::ImageBufferPtr dst_buffer;
 
@@ -53,6 +67,52 @@ static void create_buffers()
   }
 }
 
+// Expands each rectangle of the region to the tiles that it touches.
+static gfx::Region align_to_tiles(const gfx::Region& rgn)
+{
+  gfx::RegionBuilder rects;
+  for (const auto& rc : rgn) {
+    const int x1 = (rc.x >= 0 ? rc.x: rc.x-kDirtyTileSize+1) / kDirtyTileSize * kDirtyTileSize;
+    const int y1 = (rc.y >= 0 ? rc.y: rc.y-kDirtyTileSize+1) / kDirtyTileSize * kDirtyTileSize;
+    const int x2 = rc.x2() + (kDirtyTileSize - rc.x2() % kDirtyTileSize) % kDirtyTileSize;
+    const int y2 = rc.y2() + (kDirtyTileSize - rc.y2() % kDirtyTileSize) % kDirtyTileSize;
+    rects.add(gfx::Rect(x1, y1, x2-x1, y2-y1));
+  }
+  gfx::Region result;
+  rects.build(result);
+  return result;
+}
+
+// Calls func(rc) for each rectangle of the region. The rectangles
+// are disjoint, so when there are enough pixels (e.g. validating the
+// whole canvas) they are split in bands of rows and processed in
+// parallel.
+template<typename Func>
+static void for_each_rect(const gfx::Region& rgn, Func func)
+{
+  int pixels = 0;
+  for (const auto& rc : rgn)
+    pixels += rc.w*rc.h;
+
+  if (pixels < kParallelPixels) {
+    for (const auto& rc : rgn)
+      func(rc);
+    return;
+  }
+
+  std::vector<gfx::Rect> bands;
+  for (const auto& rc : rgn) {
+    for (int y=rc.y; y<rc.y2(); y+=kDirtyTileSize)
+      bands.push_back(gfx::Rect(rc.x, y, rc.w, std::min(kDirtyTileSize, rc.y2()-y)));
+  }
+
+  base::thread_pool::instance().parallel_for(
+    int(bands.size()),
+    [&bands, &func](int i) {
+      func(bands[i]);
+    });
+}
+
 }
 
 namespace app {
@@ -74,6 +134,7 @@ ExpandCelCanvas::ExpandCelCanvas(
   , m_committed(false)
   , m_transaction(transaction)
   , m_canCompareSrcVsDst((m_flags & NeedsSource) == NeedsSource)
+  , m_dirtyTileCols(0)
 {
   ASSERT(!singleton);
   singleton = this;
@@ -117,6 +178,10 @@ ExpandCelCanvas::ExpandCelCanvas(
   // draw this cel).
   m_cel->setPosition(m_bounds.x, m_bounds.y);
 
+  m_dirtyTileCols = (m_bounds.w + kDirtyTileSize - 1) / kDirtyTileSize;
+  m_dirtyTiles.resize(
+    m_dirtyTileCols * ((m_bounds.h + kDirtyTileSize - 1) / kDirtyTileSize), false);
+
   if (m_celCreated) {
     getDestCanvas();
     m_cel->data()->setImage(m_dstImage);
@@ -155,22 +220,27 @@ void ExpandCelCanvas::commit()
     ASSERT(m_cel);
     ASSERT(!m_celImage);
 
-    // Validate the whole m_dstImage (invalid areas are cleared, as we
-    // don't have a m_celImage)
-    validateDestCanvas(gfx::Region(m_bounds));
+    // Only the valid area of m_dstImage can contain pixels (the rest
+    // is cleared, as we don't have a m_celImage), so we validate and
+    // trim just its bounds instead of the whole canvas.
+    gfx::Rect usedBounds =
+      (m_layer->isBackground() ? m_dstImage->bounds():
+                                 m_validDstRegion.bounds());
+    validateDestCanvas(gfx::Region(gfx::Rect(usedBounds).offset(m_bounds.origin())));
 
     // We can temporary remove the cel.
     ASSERT(m_layer->isImage());
     static_cast<LayerImage*>(m_layer)->removeCel(m_cel);
 
     // Add a copy of m_dstImage in the sprite's image stock
-    gfx::Rect trimBounds = getTrimDstImageBounds();
+    gfx::Rect trimBounds = getTrimDstImageBounds(usedBounds);
     if (!trimBounds.isEmpty()) {
       ImageRef newImage(trimDstImage(trimBounds));
       ASSERT(newImage);
 
       m_cel->data()->setImage(newImage);
       m_cel->setPosition(m_cel->position() + trimBounds.origin());
+      m_patchedBounds = trimBounds;
 
       // And finally we add the cel again in the layer.
       m_transaction.execute(new cmd::AddCel(m_layer, m_cel));
@@ -188,16 +258,12 @@ void ExpandCelCanvas::commit()
     if (m_canCompareSrcVsDst) {
       ASSERT(gfx::Region().createSubtraction(m_validDstRegion, m_validSrcRegion).isEmpty());
 
-      for (gfx::Rect rc : m_validDstRegion) {
-        if (algorithm::shrink_bounds2(getSourceCanvas(),
-                                      getDestCanvas(), rc, rc)) {
-          reduced |= gfx::Region(rc);
-        }
-      }
-
+      getModifiedRegion(reduced);
       regionToPatch = &reduced;
     }
 
+    m_patchedBounds = regionToPatch->bounds();
+
     if (m_layer->isBackground()) {
       m_transaction.execute(
         new cmd::CopyRegion(
@@ -270,27 +336,32 @@ void ExpandCelCanvas::validateSourceCanvas(const gfx::Region& rgn)
 
   gfx::Region rgnToValidate(rgn);
   rgnToValidate.offset(-m_bounds.origin());
+  rgnToValidate = align_to_tiles(rgnToValidate);
   rgnToValidate.createSubtraction(rgnToValidate, m_validSrcRegion);
   rgnToValidate.createIntersection(rgnToValidate, gfx::Region(m_srcImage->bounds()));
 
+  Image* srcImage = m_srcImage.get();
   if (m_celImage) {
     gfx::Region rgnToClear;
     rgnToClear.createSubtraction(rgnToValidate,
       gfx::Region(m_celImage->bounds()
         .offset(m_origCelPos)
         .offset(-m_bounds.origin())));
-    for (const auto& rc : rgnToClear)
-      fill_rect(m_srcImage.get(), rc, m_srcImage->maskColor());
-
-    for (const auto& rc : rgnToValidate)
-      m_srcImage->copy(m_celImage.get(),
-        gfx::Clip(rc.x, rc.y,
-          rc.x+m_bounds.x-m_origCelPos.x,
-          rc.y+m_bounds.y-m_origCelPos.y, rc.w, rc.h));
+    for_each_rect(rgnToClear, [srcImage](const gfx::Rect& rc) {
+      fill_rect(srcImage, rc, srcImage->maskColor());
+    });
+
+    const Image* celImage = m_celImage.get();
+    const gfx::Point delta = m_bounds.origin() - m_origCelPos;
+    for_each_rect(rgnToValidate, [srcImage, celImage, delta](const gfx::Rect& rc) {
+      srcImage->copy(celImage,
+        gfx::Clip(rc.x, rc.y, rc.x+delta.x, rc.y+delta.y, rc.w, rc.h));
+    });
   }
   else {
-    for (const auto& rc : rgnToValidate)
-      fill_rect(m_srcImage.get(), rc, m_srcImage->maskColor());
+    for_each_rect(rgnToValidate, [srcImage](const gfx::Rect& rc) {
+      fill_rect(srcImage, rc, srcImage->maskColor());
+    });
   }
 
   m_validSrcRegion.createUnion(m_validSrcRegion, rgnToValidate);
@@ -316,30 +387,35 @@ void ExpandCelCanvas::validateDestCanvas(const gfx::Region& rgn)
 
   gfx::Region rgnToValidate(rgn);
   rgnToValidate.offset(-m_bounds.origin());
+  rgnToValidate = align_to_tiles(rgnToValidate);
   rgnToValidate.createSubtraction(rgnToValidate, m_validDstRegion);
   rgnToValidate.createIntersection(rgnToValidate, gfx::Region(m_dstImage->bounds()));
 
+  Image* dstImage = m_dstImage.get();
   if (src) {
     gfx::Region rgnToClear;
     rgnToClear.createSubtraction(rgnToValidate,
       gfx::Region(src->bounds()
         .offset(src_x, src_y)
         .offset(-m_bounds.origin())));
-    for (const auto& rc : rgnToClear)
-      fill_rect(m_dstImage.get(), rc, m_dstImage->maskColor());
-
-    for (const auto& rc : rgnToValidate)
-      m_dstImage->copy(src,
-        gfx::Clip(rc.x, rc.y,
-          rc.x+m_bounds.x-src_x,
-          rc.y+m_bounds.y-src_y, rc.w, rc.h));
+    for_each_rect(rgnToClear, [dstImage](const gfx::Rect& rc) {
+      fill_rect(dstImage, rc, dstImage->maskColor());
+    });
+
+    const gfx::Point delta = m_bounds.origin() - gfx::Point(src_x, src_y);
+    for_each_rect(rgnToValidate, [dstImage, src, delta](const gfx::Rect& rc) {
+      dstImage->copy(src,
+        gfx::Clip(rc.x, rc.y, rc.x+delta.x, rc.y+delta.y, rc.w, rc.h));
+    });
   }
   else {
-    for (const auto& rc : rgnToValidate)
-      fill_rect(m_dstImage.get(), rc, m_dstImage->maskColor());
+    for_each_rect(rgnToValidate, [dstImage](const gfx::Rect& rc) {
+      fill_rect(dstImage, rc, dstImage->maskColor());
+    });
   }
 
   m_validDstRegion.createUnion(m_validDstRegion, rgnToValidate);
+  markDirtyTiles(rgnToValidate);
 }
 
 void ExpandCelCanvas::invalidateDestCanvas()
@@ -370,14 +446,75 @@ void ExpandCelCanvas::copyValidDestToSourceCanvas(const gfx::Region& rgn)
   m_canCompareSrcVsDst = false;
 }
 
-gfx::Rect ExpandCelCanvas::getTrimDstImageBounds() const
+void ExpandCelCanvas::markDirtyTiles(const gfx::Region& rgn)
+{
+  for (const auto& rc : rgn) {
+    const int u1 = rc.x / kDirtyTileSize;
+    const int v1 = rc.y / kDirtyTileSize;
+    const int u2 = (rc.x2()-1) / kDirtyTileSize;
+    const int v2 = (rc.y2()-1) / kDirtyTileSize;
+    for (int v=v1; v<=v2; ++v)
+      for (int u=u1; u<=u2; ++u)
+        m_dirtyTiles[v*m_dirtyTileCols + u] = true;
+  }
+}
+
+// Calculates the minimal region (with a granularity of
+// kDirtyTileSize) where the source and destination canvas are
+// different. Only the dirty tiles are compared, and each one is
+// shrunk to the exact modified pixels, so a long diagonal stroke
+// doesn't save the whole bounding box of its valid region. The tiles
+// are independent, so they are compared in parallel.
+void ExpandCelCanvas::getModifiedRegion(gfx::Region& rgn) const
+{
+  const Image* src = m_srcImage.get();
+  const Image* dst = m_dstImage.get();
+
+  std::vector<int> tiles;
+  for (int i=0; i<int(m_dirtyTiles.size()); ++i)
+    if (m_dirtyTiles[i])
+      tiles.push_back(i);
+
+  std::vector<std::vector<gfx::Rect>> modified(tiles.size());
+  auto compareTile =
+    [this, src, dst, &tiles, &modified](int j) {
+      const int i = tiles[j];
+      gfx::Region tileRgn(
+        gfx::Rect((i % m_dirtyTileCols) * kDirtyTileSize,
+                  (i / m_dirtyTileCols) * kDirtyTileSize,
+                  kDirtyTileSize, kDirtyTileSize));
+      tileRgn.createIntersection(tileRgn, m_validDstRegion);
+
+      for (gfx::Rect rc : tileRgn) {
+        if (algorithm::shrink_bounds2(src, dst, rc, rc))
+          modified[j].push_back(rc);
+      }
+    };
+
+  const int n = int(tiles.size());
+  if (n*kDirtyTileSize*kDirtyTileSize < kParallelPixels) {
+    for (int j=0; j<n; ++j)
+      compareTile(j);
+  }
+  else
+    base::thread_pool::instance().parallel_for(n, compareTile);
+
+  gfx::RegionBuilder builder;
+  for (const auto& rects : modified)
+    for (const auto& rc : rects)
+      builder.add(rc);
+  builder.unionWith(rgn);
+}
+
+gfx::Rect ExpandCelCanvas::getTrimDstImageBounds(const gfx::Rect& usedBounds) const
 {
   if (m_layer->isBackground())
     return m_dstImage->bounds();
   else {
     gfx::Rect bounds;
-    algorithm::shrink_bounds(m_dstImage.get(), bounds,
-                             m_dstImage->maskColor());
+    if (!algorithm::shrink_bounds(m_dstImage.get(), usedBounds, bounds,
+                                  m_dstImage->maskColor()))
+      bounds = gfx::Rect();
     return bounds;
   }
 }
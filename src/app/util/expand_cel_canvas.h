@@ -15,6 +15,8 @@
 #include "gfx/region.h"
 #include "gfx/size.h"
 
+#include <vector>
+
 namespace doc {
   class Cel;
   class Image;
@@ -68,9 +70,15 @@ namespace app {
 
     const Cel* getCel() const { return m_cel.get(); }
 
+    // Bounds of the pixels that were patched by the last commit()
+    // (relative to the destination canvas).
+    const gfx::Rect& getPatchedBounds() const { return m_patchedBounds; }
+
   private:
-    gfx::Rect getTrimDstImageBounds() const;
+    gfx::Rect getTrimDstImageBounds(const gfx::Rect& usedBounds) const;
     ImageRef trimDstImage(const gfx::Rect& bounds) const;
+    void markDirtyTiles(const gfx::Region& rgn);
+    void getModifiedRegion(gfx::Region& rgn) const;
 
     Document* m_document;
     Sprite* m_sprite;
@@ -94,6 +102,12 @@ namespace app {
     // cel. This is false when dst is copied to the src, so we cannot
     // reduce the patched region because both images will be the same.
     bool m_canCompareSrcVsDst;
+
+    // Tiles of the destination canvas touched during the stroke, so
+    // commit() only compares src vs dst in these tiles.
+    std::vector<bool> m_dirtyTiles;
+    int m_dirtyTileCols;
+    gfx::Rect m_patchedBounds;
   };
 
 } // namespace app
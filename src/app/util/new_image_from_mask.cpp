@@ -68,29 +68,32 @@ doc::Image* new_image_from_mask(const doc::Site& site,
   // Copy the masked zones
   if (src) {
     if (srcMaskBitmap) {
-      // Copy active layer with mask
-      const LockImageBits<BitmapTraits> maskBits(srcMaskBitmap, gfx::Rect(0, 0, srcBounds.w, srcBounds.h));
-      LockImageBits<BitmapTraits>::const_iterator mask_it = maskBits.begin();
-
+      // Copy active layer with mask (each run of selected pixels is
+      // copied at once)
       for (int v=0; v<srcBounds.h; ++v) {
-        for (int u=0; u<srcBounds.w; ++u, ++mask_it) {
-          ASSERT(mask_it != maskBits.end());
-
-          if (src != dst.get()) {
-            if (*mask_it) {
-              int getx = u+srcBounds.x-x;
-              int gety = v+srcBounds.y-y;
-
-              if ((getx >= 0) && (getx < src->width()) &&
-                  (gety >= 0) && (gety < src->height()))
-                dst->putPixel(u, v, src->getPixel(getx, gety));
-            }
-          }
-          else {
-            if (!*mask_it) {
-              dst->putPixel(u, v, dst->maskColor());
-            }
-          }
+        if (src != dst.get()) {
+          for_each_bitmap_run(
+            srcMaskBitmap, v, 0, srcBounds.w-1,
+            [&](int u1, int u2) {
+              dst->copy(src, gfx::Clip(u1, v,
+                                       u1+srcBounds.x-x, v+srcBounds.y-y,
+                                       u2-u1+1, 1));
+            });
+        }
+        else {
+          // Clear the unselected pixels between runs
+          int u = 0;
+          auto clearUntil = [&](int u1) {
+            if (u < u1)
+              fill_rect(dst.get(), u, v, u1-1, v, dst->maskColor());
+          };
+          for_each_bitmap_run(
+            srcMaskBitmap, v, 0, srcBounds.w-1,
+            [&](int u1, int u2) {
+              clearUntil(u1);
+              u = u2+1;
+            });
+          clearUntil(srcBounds.w);
         }
       }
     }
@@ -35,6 +35,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <map>
 
 namespace app {
 
@@ -44,6 +45,35 @@ using namespace app::skin;
 static int convert_align_value_to_flags(const char *value);
 static int int_attr(const tinyxml2::XMLElement* elem, const char* attribute_name, int default_value);
 
+// Widget files already found and parsed, so opening the same dialog
+// again doesn't look for its .xml file and parse it again. The .xml
+// files are still the source of truth: a file is parsed again if it
+// was modified.
+namespace {
+
+  struct CachedXml {
+    XmlDocumentRef doc;
+    base::Time mtime;
+  };
+
+  std::map<std::string, std::string> widget_files; // File name -> full path
+  std::map<std::string, CachedXml> widget_docs;    // Full path -> document
+
+  XmlDocumentRef open_widget_xml(const std::string& filename)
+  {
+    base::Time mtime = base::get_modification_time(filename);
+
+    auto it = widget_docs.find(filename);
+    if (it != widget_docs.end() && it->second.mtime == mtime)
+      return it->second.doc;
+
+    XmlDocumentRef doc = open_xml(filename);
+    widget_docs[filename] = CachedXml{ doc, mtime };
+    return doc;
+  }
+
+}
+
 WidgetLoader::WidgetLoader()
   : m_tooltipManager(NULL)
 {
@@ -63,19 +93,26 @@ void WidgetLoader::addWidgetType(const char* tagName, IWidgetTypeCreator* creato
 
 Widget* WidgetLoader::loadWidget(const char* fileName, const char* widgetId, ui::Widget* widget)
 {
-  std::string buf;
+  std::string& filename = widget_files[fileName];
+  if (filename.empty() || !base::is_file(filename)) {
+    std::string buf;
 
-  ResourceFinder rf;
-  rf.addPath(fileName);
+    ResourceFinder rf;
+    rf.addPath(fileName);
 
-  buf = "widgets/";
-  buf += fileName;
-  rf.includeDataDir(buf.c_str());
+    buf = "widgets/";
+    buf += fileName;
+    rf.includeDataDir(buf.c_str());
 
-  if (!rf.findFirst())
-    throw WidgetNotFound(widgetId);
+    if (!rf.findFirst()) {
+      widget_files.erase(fileName);
+      throw WidgetNotFound(widgetId);
+    }
+
+    filename = rf.filename();
+  }
 
-  widget = loadWidgetFromXmlFile(rf.filename(), widgetId, widget);
+  widget = loadWidgetFromXmlFile(filename, widgetId, widget);
   if (!widget)
     throw WidgetNotFound(widgetId);
 
@@ -89,7 +126,7 @@ Widget* WidgetLoader::loadWidgetFromXmlFile(
 {
   m_tooltipManager = NULL;
 
-  XmlDocumentRef doc(open_xml(xmlFilename));
+  XmlDocumentRef doc(open_widget_xml(xmlFilename));
   tinyxml2::XMLHandle handle(doc.get());
 
   // Search the requested widget.
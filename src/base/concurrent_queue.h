@@ -1,5 +1,6 @@
 // Aseprite Base Library
 // Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2026 LibreSprite contributors
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -7,52 +8,121 @@
 #pragma once
 
 #include "base/disable_copying.h"
-#include "base/mutex.h"
-#include "base/scoped_lock.h"
 
-#include <queue>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
 
 namespace base {
 
+  // Queue for several producers and consumers. Consumers can poll
+  // it (try_pop) or wait for new elements (pop_wait/pop_for). After
+  // close() no more elements can be pushed and the waiting consumers
+  // are woken up (they still receive the elements that were in the
+  // queue).
   template<typename T>
   class concurrent_queue {
   public:
-    concurrent_queue() {
+    // A queue with a capacity > 0 blocks the producers while it's
+    // full.
+    explicit concurrent_queue(std::size_t capacity = 0)
+      : m_capacity(capacity)
+      , m_closed(false) {
     }
 
     ~concurrent_queue() {
     }
 
     bool empty() const {
-      bool result;
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_queue.empty();
+    }
+
+    std::size_t size() const {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_queue.size();
+    }
+
+    // Returns false if the queue was closed.
+    bool push(const T& value) {
+      return emplace(value);
+    }
+
+    bool push(T&& value) {
+      return emplace(std::move(value));
+    }
+
+    bool try_pop(T& value) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return pop_front(value);
+    }
+
+    // Waits until there is an element or the queue is closed (in
+    // this case it returns false).
+    bool pop_wait(T& value) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_notEmpty.wait(lock, [this]{ return m_closed || !m_queue.empty(); });
+      return pop_front(value);
+    }
+
+    // Like pop_wait() but returns false after the given timeout.
+    template<typename Rep, typename Period>
+    bool pop_for(T& value, const std::chrono::duration<Rep, Period>& timeout) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_notEmpty.wait_for(lock, timeout, [this]{ return m_closed || !m_queue.empty(); });
+      return pop_front(value);
+    }
+
+    void close() {
       {
-        scoped_lock hold(m_mutex);
-        result = m_queue.empty();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
       }
-      return result;
+      m_notEmpty.notify_all();
+      m_notFull.notify_all();
     }
 
-    void push(const T& value) {
-      scoped_lock hold(m_mutex);
-      m_queue.push(value);
+    bool closed() const {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_closed;
     }
 
-    bool try_pop(T& value) {
-      if (!m_mutex.try_lock())
-        return false;
+  private:
+    template<typename U>
+    bool emplace(U&& value) {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_capacity > 0)
+          m_notFull.wait(lock, [this]{ return m_closed || m_queue.size() < m_capacity; });
+        if (m_closed)
+          return false;
+        m_queue.push_back(std::forward<U>(value));
+      }
+      m_notEmpty.notify_one();
+      return true;
+    }
 
-      scoped_unlock unlock(m_mutex);
+    // Must be called with m_mutex locked.
+    bool pop_front(T& value) {
       if (m_queue.empty())
         return false;
 
-      value = m_queue.front();
-      m_queue.pop();
+      value = std::move(m_queue.front());
+      m_queue.pop_front();
+      if (m_capacity > 0)
+        m_notFull.notify_one();
       return true;
     }
 
-  private:
-    std::queue<T> m_queue;
-    mutable mutex m_mutex;
+    std::deque<T> m_queue;
+    const std::size_t m_capacity;
+    bool m_closed;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
 
     DISABLE_COPYING(concurrent_queue);
   };
@@ -0,0 +1,90 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/concurrent_queue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace base;
+
+TEST(ConcurrentQueue, PushPop)
+{
+  concurrent_queue<int> queue;
+  int value = 0;
+
+  EXPECT_FALSE(queue.try_pop(value));
+  queue.push(1);
+  queue.push(2);
+  EXPECT_EQ(2, queue.size());
+  EXPECT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(2, value);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(ConcurrentQueue, Timeout)
+{
+  concurrent_queue<int> queue;
+  int value = 0;
+  EXPECT_FALSE(queue.pop_for(value, std::chrono::milliseconds(1)));
+}
+
+TEST(ConcurrentQueue, Close)
+{
+  concurrent_queue<int> queue;
+  int value = 0;
+
+  queue.push(1);
+  queue.close();
+  EXPECT_FALSE(queue.push(2));
+
+  // The remaining elements can be popped
+  EXPECT_TRUE(queue.pop_wait(value));
+  EXPECT_EQ(1, value);
+  EXPECT_FALSE(queue.pop_wait(value));
+}
+
+TEST(ConcurrentQueue, ProducersAndConsumers)
+{
+  concurrent_queue<int> queue(16);
+  std::atomic<int> sum(0);
+  std::vector<std::thread> consumers;
+
+  for (int i=0; i<3; ++i) {
+    consumers.emplace_back([&queue, &sum]{
+        int value;
+        while (queue.pop_wait(value))
+          sum += value;
+      });
+  }
+
+  std::vector<std::thread> producers;
+  for (int i=0; i<3; ++i) {
+    producers.emplace_back([&queue]{
+        for (int j=1; j<=1000; ++j)
+          queue.push(j);
+      });
+  }
+
+  for (auto& producer : producers)
+    producer.join();
+  queue.close();
+  for (auto& consumer : consumers)
+    consumer.join();
+
+  EXPECT_EQ(3*500500, sum);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
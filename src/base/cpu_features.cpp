@@ -0,0 +1,80 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/cpu_features.h"
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  #include <intrin.h>
+  #define CPU_FEATURES_X86_MSVC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+  #define CPU_FEATURES_X86_GCC 1
+#endif
+
+namespace base {
+
+namespace {
+
+struct CpuFeatures {
+  bool sse2 = false;
+  bool avx2 = false;
+  bool neon = false;
+
+  CpuFeatures() {
+#if CPU_FEATURES_X86_MSVC
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    sse2 = ((info[3] & (1 << 26)) != 0);
+    const bool osxsave = ((info[2] & (1 << 27)) != 0);
+    const bool avx = ((info[2] & (1 << 28)) != 0);
+
+    // AVX2 needs the OS to save/restore the YMM registers too.
+    if (maxLeaf >= 7 && osxsave && avx &&
+        (_xgetbv(0) & 6) == 6) {
+      __cpuidex(info, 7, 0);
+      avx2 = ((info[1] & (1 << 5)) != 0);
+    }
+#elif CPU_FEATURES_X86_GCC
+    __builtin_cpu_init();
+    sse2 = __builtin_cpu_supports("sse2");
+    avx2 = __builtin_cpu_supports("avx2");
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+    // NEON (Advanced SIMD) is mandatory in ARMv8
+    neon = true;
+#endif
+  }
+};
+
+const CpuFeatures& cpu_features()
+{
+  static CpuFeatures features;
+  return features;
+}
+
+} // anonymous namespace
+
+bool cpu_has_sse2()
+{
+  return cpu_features().sse2;
+}
+
+bool cpu_has_avx2()
+{
+  return cpu_features().avx2;
+}
+
+bool cpu_has_neon()
+{
+  return cpu_features().neon;
+}
+
+} // namespace base
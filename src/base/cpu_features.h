@@ -0,0 +1,18 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+namespace base {
+
+  // Instruction set extensions that can be used by vectorized
+  // kernels. The detection is done only once (the first time one of
+  // these functions is called).
+  bool cpu_has_sse2();
+  bool cpu_has_avx2();
+  bool cpu_has_neon();
+
+} // namespace base
@@ -0,0 +1,45 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <cstdint>
+
+namespace base {
+
+  // Small pseudo-random number generator (xorshift64*) for code that
+  // needs a lot of numbers quickly (e.g. one per sprayed dot) and not
+  // a good statistical quality. Each instance has its own state, so
+  // it can be used without locks (one instance per thread/loop).
+  class fast_random {
+  public:
+    explicit fast_random(uint64_t seed = 1) {
+      reseed(seed);
+    }
+
+    void reseed(uint64_t seed) {
+      // Zero is the only invalid state
+      m_state = (seed ? seed: 0x9e3779b97f4a7c15ull);
+    }
+
+    // Returns a number in [0, 2^32)
+    uint32_t next() {
+      m_state ^= m_state >> 12;
+      m_state ^= m_state << 25;
+      m_state ^= m_state >> 27;
+      return uint32_t((m_state * 0x2545f4914f6cdd1dull) >> 32);
+    }
+
+    // Returns a number in [0, n) (n must be greater than 0)
+    int uniform(int n) {
+      return int((uint64_t(next()) * uint32_t(n)) >> 32);
+    }
+
+  private:
+    uint64_t m_state;
+  };
+
+} // namespace base
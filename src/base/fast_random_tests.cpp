@@ -0,0 +1,54 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/fast_random.h"
+
+#include <vector>
+
+using namespace base;
+
+TEST(FastRandom, SameSeedSameSequence)
+{
+  fast_random a(5), b(5), c(6);
+  bool different = false;
+  for (int i=0; i<100; ++i) {
+    uint32_t v = a.next();
+    EXPECT_EQ(v, b.next());
+    different |= (v != c.next());
+  }
+  EXPECT_TRUE(different);
+}
+
+TEST(FastRandom, ZeroSeed)
+{
+  fast_random rnd(0);
+  EXPECT_NE(rnd.next(), rnd.next());
+}
+
+TEST(FastRandom, Uniform)
+{
+  fast_random rnd;
+  std::vector<int> hits(10, 0);
+  for (int i=0; i<100000; ++i) {
+    int v = rnd.uniform(10);
+    ASSERT_TRUE(v >= 0 && v < 10);
+    ++hits[v];
+  }
+  for (int h : hits)
+    EXPECT_NEAR(10000, h, 500);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/file_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+namespace base {
+
+FileReader::FileReader(const FileHandle& handle)
+  : m_data(nullptr)
+  , m_size(0)
+  , m_pos(0)
+  , m_error(false)
+  , m_map(nullptr)
+  , m_mapSize(0)
+{
+  FILE* f = handle.get();
+  long start = std::ftell(f);
+  if (start < 0)
+    start = 0;
+
+#ifndef _WIN32
+  struct stat st;
+  if (fstat(fileno(f), &st) == 0 &&
+      S_ISREG(st.st_mode) &&
+      st.st_size > start) {
+    void* map = mmap(nullptr, std::size_t(st.st_size), PROT_READ,
+                     MAP_PRIVATE, fileno(f), 0);
+    if (map != MAP_FAILED) {
+      m_map = map;
+      m_mapSize = std::size_t(st.st_size);
+      m_data = static_cast<const uint8_t*>(map) + start;
+      m_size = m_mapSize - std::size_t(start);
+      return;
+    }
+  }
+#endif
+
+  // Read the rest of the file in memory
+  uint8_t buf[64*1024];
+  std::size_t bytes;
+  while ((bytes = std::fread(buf, 1, sizeof(buf), f)) > 0)
+    m_buffer.insert(m_buffer.end(), buf, buf+bytes);
+  m_error = (std::ferror(f) != 0);
+
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+}
+
+FileReader::~FileReader()
+{
+#ifndef _WIN32
+  if (m_map)
+    munmap(m_map, m_mapSize);
+#endif
+}
+
+void FileReader::seek(std::size_t pos)
+{
+  m_pos = std::min(pos, m_size);
+}
+
+std::size_t FileReader::read(void* dst, std::size_t bytes)
+{
+  bytes = std::min(bytes, m_size - m_pos);
+  if (bytes > 0)
+    std::memcpy(dst, m_data + m_pos, bytes);
+  m_pos += bytes;
+  return bytes;
+}
+
+const uint8_t* FileReader::data(std::size_t bytes, std::vector<uint8_t>& buffer)
+{
+  if (bytes <= m_size - m_pos)
+    return data(bytes);
+
+  buffer.assign(bytes, 0);
+  read(&buffer[0], bytes);
+  return &buffer[0];
+}
+
+} // namespace base
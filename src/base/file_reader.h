@@ -0,0 +1,97 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/file_handle.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace base {
+
+  // Reads a whole binary file from memory. The file is mapped in
+  // memory (or read at once if it cannot be mapped), so reading
+  // small fields doesn't call the C runtime for each byte.
+  //
+  // The functions to read fields are equivalent to fgetc(), fgetw()
+  // and fgetl() (little-endian) and return EOF at the end of the
+  // file. As with ferror(), error() is only true if the file
+  // couldn't be read (not when we try to read past the end).
+  class FileReader {
+  public:
+    // Reads the file from its current position.
+    explicit FileReader(const FileHandle& handle);
+    ~FileReader();
+
+    std::size_t size() const { return m_size; }
+    std::size_t tell() const { return m_pos; }
+    bool eof() const { return m_pos >= m_size; }
+    bool error() const { return m_error; }
+
+    // Moves to the given position (from the beginning of the file).
+    void seek(std::size_t pos);
+    void skip(std::size_t bytes) { seek(m_pos + bytes); }
+
+    int getc() {
+      if (m_pos < m_size)
+        return m_data[m_pos++];
+      return EOF;
+    }
+
+    int getw() {
+      const uint8_t* p = data(2);
+      if (!p)
+        return EOF;
+      return ((p[1] << 8) | p[0]);
+    }
+
+    long getl() {
+      const uint8_t* p = data(4);
+      if (!p)
+        return EOF;
+      return ((p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0]);
+    }
+
+    // Copies up to "bytes" bytes to "dst", returns the number of
+    // copied bytes (like fread()).
+    std::size_t read(void* dst, std::size_t bytes);
+
+    // Returns a pointer to the next "bytes" bytes of the file
+    // (without copying them) and moves the position after them.
+    // Returns nullptr (and moves to the end of the file) if there
+    // are not enough bytes.
+    const uint8_t* data(std::size_t bytes) {
+      if (bytes > m_size - m_pos) {
+        m_pos = m_size;
+        return nullptr;
+      }
+      const uint8_t* p = m_data + m_pos;
+      m_pos += bytes;
+      return p;
+    }
+
+    // Like data() but if there are not enough bytes, the rest of the
+    // file is copied to "buffer" padded with zeros (so truncated
+    // files can be decoded row by row like complete ones).
+    const uint8_t* data(std::size_t bytes, std::vector<uint8_t>& buffer);
+
+  private:
+    const uint8_t* m_data;
+    std::size_t m_size;
+    std::size_t m_pos;
+    bool m_error;
+    void* m_map;                // Mapped memory (or nullptr)
+    std::size_t m_mapSize;
+    std::vector<uint8_t> m_buffer; // Used when the file cannot be mapped
+
+    DISABLE_COPYING(FileReader);
+  };
+
+} // namespace base
@@ -0,0 +1,108 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/file_handle.h"
+#include "base/file_reader.h"
+#include "base/fs.h"
+
+using namespace base;
+
+TEST(FileReader, ReadFields)
+{
+  const char* fn = "file_reader_test.bin";
+  {
+    FileHandle f = open_file_with_exception(fn, "wb");
+    const uint8_t bytes[] = { 1, 0x34, 0x12, 0x78, 0x56, 0x34, 0x12, 9, 8, 7 };
+    fwrite(bytes, 1, sizeof(bytes), f.get());
+  }
+
+  {
+    FileHandle f = open_file_with_exception(fn, "rb");
+    fgetc(f.get());             // The reader starts from the current position
+
+    FileReader reader(f);
+    EXPECT_EQ(9u, reader.size());
+    EXPECT_EQ(0x1234, reader.getw());
+    EXPECT_EQ(0x12345678, reader.getl());
+    EXPECT_EQ(6u, reader.tell());
+
+    const uint8_t* data = reader.data(2);
+    ASSERT_TRUE(data != nullptr);
+    EXPECT_EQ(9, data[0]);
+    EXPECT_EQ(8, data[1]);
+
+    // Not enough bytes
+    EXPECT_EQ(EOF, reader.getw());
+    EXPECT_TRUE(reader.eof());
+    EXPECT_TRUE(reader.data(1) == nullptr);
+
+    reader.seek(1);
+    uint8_t buf[16];
+    EXPECT_EQ(8u, reader.read(buf, sizeof(buf)));
+    EXPECT_EQ(0x12, buf[0]);
+    EXPECT_EQ(EOF, reader.getc());
+    EXPECT_FALSE(reader.error());
+
+    reader.seek(100);
+    EXPECT_EQ(9u, reader.tell());
+  }
+
+  delete_file(fn);
+}
+
+TEST(FileReader, PaddedData)
+{
+  const char* fn = "file_reader_padded.bin";
+  {
+    FileHandle f = open_file_with_exception(fn, "wb");
+    const uint8_t bytes[] = { 1, 2, 3, 4, 5 };
+    fwrite(bytes, 1, sizeof(bytes), f.get());
+  }
+
+  {
+    FileReader reader(open_file_with_exception(fn, "rb"));
+    std::vector<uint8_t> buffer;
+
+    const uint8_t* data = reader.data(3, buffer);
+    ASSERT_TRUE(data != nullptr);
+    EXPECT_EQ(1, data[0]);
+    EXPECT_EQ(3, data[2]);
+    EXPECT_TRUE(buffer.empty());
+
+    // The last two bytes and zeros
+    data = reader.data(4, buffer);
+    ASSERT_TRUE(data == &buffer[0]);
+    EXPECT_EQ(4, data[0]);
+    EXPECT_EQ(5, data[1]);
+    EXPECT_EQ(0, data[2]);
+    EXPECT_EQ(0, data[3]);
+    EXPECT_TRUE(reader.eof());
+    EXPECT_FALSE(reader.error());
+  }
+
+  delete_file(fn);
+}
+
+TEST(FileReader, EmptyFile)
+{
+  const char* fn = "file_reader_empty.bin";
+  open_file_with_exception(fn, "wb");
+  {
+    FileReader reader(open_file_with_exception(fn, "rb"));
+    EXPECT_EQ(0u, reader.size());
+    EXPECT_EQ(EOF, reader.getc());
+    EXPECT_EQ(EOF, reader.getl());
+  }
+  delete_file(fn);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
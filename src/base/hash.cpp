@@ -0,0 +1,167 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/hash.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const uint64_t P1 = 0x9E3779B185EBCA87ULL;
+const uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t P3 = 0x165667B19E3779F9ULL;
+const uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian loads (memcpy is compiled as one unaligned load)
+inline uint64_t load64(const uint8_t* p)
+{
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+inline uint32_t load32(const uint8_t* p)
+{
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input)
+{
+  acc += input * P2;
+  acc = rotl(acc, 31);
+  return acc * P1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val)
+{
+  acc ^= round(0, val);
+  return acc * P1 + P4;
+}
+
+} // anonymous namespace
+
+hasher64::hasher64(uint64_t seed)
+  : m_total(0)
+  , m_bufSize(0)
+  , m_seed(seed)
+{
+  m_acc[0] = seed + P1 + P2;
+  m_acc[1] = seed + P2;
+  m_acc[2] = seed;
+  m_acc[3] = seed - P1;
+}
+
+void hasher64::consumeStripes(const uint8_t*& p, const uint8_t* end)
+{
+  // Local copies of the lanes so the compiler can keep them in
+  // registers (each lane is independent of the others)
+  uint64_t a = m_acc[0], b = m_acc[1], c = m_acc[2], d = m_acc[3];
+  for (; p+32 <= end; p += 32) {
+    a = round(a, load64(p));
+    b = round(b, load64(p+8));
+    c = round(c, load64(p+16));
+    d = round(d, load64(p+24));
+  }
+  m_acc[0] = a; m_acc[1] = b; m_acc[2] = c; m_acc[3] = d;
+}
+
+void hasher64::update(const void* data, std::size_t size)
+{
+  const uint8_t* p = (const uint8_t*)data;
+  const uint8_t* end = p + size;
+  m_total += size;
+
+  if (m_bufSize + size < 32) {
+    if (size > 0)
+      std::memcpy(m_buf + m_bufSize, p, size);
+    m_bufSize += size;
+    return;
+  }
+
+  if (m_bufSize > 0) {
+    const std::size_t n = 32 - m_bufSize;
+    std::memcpy(m_buf + m_bufSize, p, n);
+    p += n;
+    const uint8_t* q = m_buf;
+    consumeStripes(q, m_buf+32);
+    m_bufSize = 0;
+  }
+
+  consumeStripes(p, end);
+
+  m_bufSize = std::size_t(end - p);
+  if (m_bufSize > 0)
+    std::memcpy(m_buf, p, m_bufSize);
+}
+
+uint64_t hasher64::digest() const
+{
+  uint64_t h;
+  if (m_total >= 32) {
+    h = rotl(m_acc[0], 1) + rotl(m_acc[1], 7) +
+        rotl(m_acc[2], 12) + rotl(m_acc[3], 18);
+    for (int i=0; i<4; ++i)
+      h = merge_round(h, m_acc[i]);
+  }
+  else
+    h = m_seed + P5;
+
+  h += m_total;
+
+  // Remaining bytes (less than 32)
+  const uint8_t* p = m_buf;
+  const uint8_t* end = m_buf + m_bufSize;
+  for (; p+8 <= end; p += 8) {
+    h ^= round(0, load64(p));
+    h = rotl(h, 27) * P1 + P4;
+  }
+  if (p+4 <= end) {
+    h ^= uint64_t(load32(p)) * P1;
+    h = rotl(h, 23) * P2 + P3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= (*p) * P5;
+    h = rotl(h, 11) * P1;
+  }
+
+  // Avalanche
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t hash64(const void* data, std::size_t size, uint64_t seed)
+{
+  hasher64 hasher(seed);
+  hasher.update(data, size);
+  return hasher.digest();
+}
+
+} // namespace base
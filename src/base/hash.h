@@ -0,0 +1,43 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+  // Fast non-cryptographic 64-bit hash (the XXH64 algorithm, so the
+  // values are stable between executions and platforms). It processes
+  // 32 bytes per step in four independent lanes, it's an order of
+  // magnitude faster than Sha1 and it's good to find identical data
+  // (collisions are possible, use Sha1 if they matter).
+  //
+  // The data can be given in several update() calls, the result is
+  // the same as hashing all the data at once.
+  class hasher64 {
+  public:
+    explicit hasher64(uint64_t seed = 0);
+
+    void update(const void* data, std::size_t size);
+    void update64(uint64_t value) { update(&value, sizeof(value)); }
+
+    uint64_t digest() const;
+
+  private:
+    void consumeStripes(const uint8_t*& p, const uint8_t* end);
+
+    uint64_t m_acc[4];
+    uint64_t m_total;
+    uint8_t m_buf[32];
+    std::size_t m_bufSize;
+    uint64_t m_seed;
+  };
+
+  uint64_t hash64(const void* data, std::size_t size, uint64_t seed = 0);
+
+} // namespace base
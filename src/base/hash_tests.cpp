@@ -0,0 +1,55 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/hash.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace base;
+
+TEST(Hash, KnownValues)
+{
+  // Reference values of the XXH64 algorithm
+  EXPECT_EQ(0xEF46DB3751D8E999ULL, hash64("", 0));
+  EXPECT_EQ(0x44BC2CF5AD770999ULL, hash64("abc", 3));
+}
+
+TEST(Hash, UpdatesInPieces)
+{
+  std::vector<uint8_t> data(1000);
+  for (std::size_t i=0; i<data.size(); ++i)
+    data[i] = uint8_t(i * 7 + (i >> 3));
+
+  for (std::size_t size : { 0, 5, 31, 32, 33, 64, 100, 1000 }) {
+    const uint64_t expected = hash64(data.data(), size, 12);
+    for (std::size_t piece : { 1, 3, 17, 32, 45 }) {
+      hasher64 hasher(12);
+      for (std::size_t i=0; i<size; i+=piece)
+        hasher.update(data.data()+i, std::min(piece, size-i));
+      EXPECT_EQ(expected, hasher.digest()) << size << " " << piece;
+    }
+  }
+}
+
+TEST(Hash, DifferentData)
+{
+  char a[64], b[64];
+  std::memset(a, 1, sizeof(a));
+  std::memset(b, 1, sizeof(b));
+  b[40] = 2;
+  EXPECT_NE(hash64(a, sizeof(a)), hash64(b, sizeof(b)));
+  EXPECT_NE(hash64(a, sizeof(a)), hash64(a, sizeof(a)-1));
+  EXPECT_NE(hash64(a, sizeof(a), 0), hash64(a, sizeof(a), 1));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,228 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/json_writer.h"
+
+#include "base/debug.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <ostream>
+
+namespace base {
+
+namespace {
+
+const std::size_t kFlushSize = 64*1024;
+
+} // anonymous namespace
+
+json_writer::json_writer(std::ostream& os, bool pretty)
+  : m_os(os)
+  , m_pretty(pretty)
+  , m_afterKey(false)
+{
+  m_buf.reserve(kFlushSize + 1024);
+}
+
+json_writer::~json_writer()
+{
+  if (m_pretty && m_levels.empty() && !m_buf.empty())
+    m_buf.push_back('\n');
+  flush();
+}
+
+void json_writer::begin_object(bool one_line)
+{
+  begin('{', one_line);
+}
+
+void json_writer::end_object()
+{
+  end('}');
+}
+
+void json_writer::begin_array(bool one_line)
+{
+  begin('[', one_line);
+}
+
+void json_writer::end_array()
+{
+  end(']');
+}
+
+void json_writer::key(const char* k)
+{
+  key(k, std::strlen(k));
+}
+
+void json_writer::key(const char* k, std::size_t n)
+{
+  before_value();
+  string_value(k, n);
+  m_buf.append(m_pretty ? ": ": ":");
+  m_afterKey = true;
+}
+
+void json_writer::value(bool v)
+{
+  before_value();
+  m_buf.append(v ? "true": "false");
+  check_flush();
+}
+
+void json_writer::value(int64_t v)
+{
+  before_value();
+  char buf[32];
+  auto res = std::to_chars(buf, buf+sizeof(buf), v);
+  m_buf.append(buf, res.ptr);
+  check_flush();
+}
+
+void json_writer::value(double v)
+{
+  // JSON doesn't support infinite or NaN values
+  if (!std::isfinite(v)) {
+    null_value();
+    return;
+  }
+
+  before_value();
+  char buf[64];
+  auto res = std::to_chars(buf, buf+sizeof(buf), v);
+  m_buf.append(buf, res.ptr);
+  check_flush();
+}
+
+void json_writer::value(const char* v)
+{
+  before_value();
+  string_value(v, std::strlen(v));
+  check_flush();
+}
+
+void json_writer::null_value()
+{
+  before_value();
+  m_buf.append("null");
+  check_flush();
+}
+
+void json_writer::flush()
+{
+  if (!m_buf.empty()) {
+    m_os.write(m_buf.data(), m_buf.size());
+    m_buf.clear();
+  }
+}
+
+void json_writer::begin(char c, bool one_line)
+{
+  before_value();
+  m_buf.push_back(c);
+  m_levels.push_back(level{ one_line || (!m_levels.empty() && m_levels.back().one_line), true });
+}
+
+void json_writer::end(char c)
+{
+  ASSERT(!m_levels.empty());
+  const level lv = m_levels.back();
+  m_levels.pop_back();
+
+  if (m_pretty && !lv.empty) {
+    if (lv.one_line)
+      m_buf.push_back(' ');
+    else {
+      m_buf.push_back('\n');
+      indent();
+    }
+  }
+  m_buf.push_back(c);
+  check_flush();
+}
+
+void json_writer::before_value()
+{
+  // The separator was already written by key()
+  if (m_afterKey) {
+    m_afterKey = false;
+    return;
+  }
+
+  if (m_levels.empty())
+    return;
+
+  level& lv = m_levels.back();
+  if (!lv.empty)
+    m_buf.push_back(',');
+  lv.empty = false;
+
+  if (m_pretty) {
+    if (lv.one_line)
+      m_buf.push_back(' ');
+    else {
+      m_buf.push_back('\n');
+      indent();
+    }
+  }
+}
+
+void json_writer::indent()
+{
+  m_buf.append(m_levels.size(), ' ');
+}
+
+void json_writer::string_value(const char* s, std::size_t n)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  m_buf.push_back('"');
+
+  // Characters that don't need to be escaped are appended in runs
+  const char* run = s;
+  const char* end = s+n;
+  for (const char* p=s; p<end; ++p) {
+    const unsigned char c = *p;
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+
+    m_buf.append(run, p);
+    run = p+1;
+
+    switch (c) {
+      case '"': m_buf.append("\\\""); break;
+      case '\\': m_buf.append("\\\\"); break;
+      case '\n': m_buf.append("\\n"); break;
+      case '\r': m_buf.append("\\r"); break;
+      case '\t': m_buf.append("\\t"); break;
+      case '\b': m_buf.append("\\b"); break;
+      case '\f': m_buf.append("\\f"); break;
+      default: {
+        const char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+        m_buf.append(esc, 6);
+        break;
+      }
+    }
+  }
+  m_buf.append(run, end);
+
+  m_buf.push_back('"');
+}
+
+void json_writer::check_flush()
+{
+  if (m_buf.size() >= kFlushSize)
+    flush();
+}
+
+} // namespace base
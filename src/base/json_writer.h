@@ -0,0 +1,85 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "base/disable_copying.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace base {
+
+  // Streaming JSON emitter. Values are appended to an internal buffer
+  // (numbers are formatted with std::to_chars, strings are escaped
+  // in runs) which is written to the stream in big blocks, so huge
+  // documents can be generated without building them in memory.
+  //
+  // In pretty mode each member/element goes in its own line, except
+  // in objects/arrays opened with one_line=true. In compact mode no
+  // whitespace is written at all.
+  //
+  // The writer doesn't validate the structure (e.g. a key() must be
+  // followed by a value or a begin_object/array()).
+  class json_writer {
+  public:
+    explicit json_writer(std::ostream& os, bool pretty = true);
+    ~json_writer();
+
+    void begin_object(bool one_line = false);
+    void end_object();
+    void begin_array(bool one_line = false);
+    void end_array();
+
+    void key(const char* k);
+    void key(const std::string& k) { key(k.c_str(), k.size()); }
+    void key(const char* k, std::size_t n);
+
+    void value(bool v);
+    void value(int v) { value(int64_t(v)); }
+    void value(int64_t v);
+    void value(double v);
+    void value(const char* v);
+    void value(const std::string& v) { string_value(v.c_str(), v.size()); }
+    void null_value();
+
+    // Shortcut for key(k) + value(v)
+    template<typename T>
+    void member(const char* k, const T& v) {
+      key(k);
+      value(v);
+    }
+
+    // Writes the buffered data in the stream. It's called
+    // automatically when the buffer is big enough and when the
+    // writer is destroyed.
+    void flush();
+
+  private:
+    struct level {
+      bool one_line;
+      bool empty;
+    };
+
+    void begin(char c, bool one_line);
+    void end(char c);
+    void before_value();
+    void indent();
+    void string_value(const char* s, std::size_t n);
+    void check_flush();
+
+    std::ostream& m_os;
+    std::string m_buf;
+    std::vector<level> m_levels;
+    bool m_pretty;
+    bool m_afterKey;
+
+    DISABLE_COPYING(json_writer);
+  };
+
+} // namespace base
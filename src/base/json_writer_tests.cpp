@@ -0,0 +1,113 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/json_writer.h"
+
+#include <limits>
+#include <sstream>
+
+using namespace base;
+
+TEST(JsonWriter, Compact)
+{
+  std::ostringstream os;
+  {
+    json_writer w(os, false);
+    w.begin_object();
+    w.member("a", 1);
+    w.member("b", true);
+    w.member("c", "text");
+    w.key("d");
+    w.begin_array();
+    w.value(0.5);
+    w.null_value();
+    w.begin_object();
+    w.end_object();
+    w.end_array();
+    w.end_object();
+  }
+  EXPECT_EQ("{\"a\":1,\"b\":true,\"c\":\"text\",\"d\":[0.5,null,{}]}", os.str());
+}
+
+TEST(JsonWriter, Pretty)
+{
+  std::ostringstream os;
+  {
+    json_writer w(os);
+    w.begin_object();
+    w.key("frame");
+    w.begin_object(true);
+    w.member("x", 1);
+    w.member("y", -2);
+    w.end_object();
+    w.key("list");
+    w.begin_array();
+    w.value(3);
+    w.end_array();
+    w.key("empty");
+    w.begin_array();
+    w.end_array();
+    w.end_object();
+  }
+  EXPECT_EQ("{\n"
+            " \"frame\": { \"x\": 1, \"y\": -2 },\n"
+            " \"list\": [\n"
+            "  3\n"
+            " ],\n"
+            " \"empty\": []\n"
+            "}\n", os.str());
+}
+
+TEST(JsonWriter, EscapeStrings)
+{
+  std::ostringstream os;
+  {
+    json_writer w(os, false);
+    w.value(std::string("a\"b\\c\nd\t\x01\xc3\xa1", 11));
+  }
+  EXPECT_EQ("\"a\\\"b\\\\c\\nd\\t\\u0001\xc3\xa1\"", os.str());
+}
+
+TEST(JsonWriter, NonFiniteNumbers)
+{
+  std::ostringstream os;
+  {
+    json_writer w(os, false);
+    w.begin_array();
+    w.value(std::numeric_limits<double>::infinity());
+    w.value(std::numeric_limits<double>::quiet_NaN());
+    w.value(int64_t(1) << 40);
+    w.end_array();
+  }
+  EXPECT_EQ("[null,null,1099511627776]", os.str());
+}
+
+TEST(JsonWriter, BigDocument)
+{
+  std::ostringstream os;
+  std::string expected = "[";
+  {
+    json_writer w(os, false);
+    w.begin_array();
+    for (int i=0; i<100000; ++i) {
+      w.value(i);
+      if (i > 0)
+        expected += ",";
+      expected += std::to_string(i);
+    }
+    w.end_array();
+  }
+  expected += "]";
+  EXPECT_EQ(expected, os.str());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
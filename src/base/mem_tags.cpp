@@ -0,0 +1,119 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/mem_tags.h"
+
+#include "base/mem_utils.h"
+
+#include <atomic>
+#include <cstdio>
+
+namespace base {
+
+namespace {
+
+struct Counters {
+  std::atomic<std::size_t> current{0};
+  std::atomic<std::size_t> peak{0};
+  std::atomic<std::size_t> count{0};
+};
+
+Counters g_counters[int(mem_tag::count)];
+
+thread_local mem_tag g_currentTag = mem_tag::images;
+
+} // anonymous namespace
+
+void mem_tag_alloc(mem_tag tag, std::size_t size)
+{
+  Counters& c = g_counters[int(tag)];
+  const std::size_t current = (c.current += size);
+  ++c.count;
+
+  std::size_t peak = c.peak.load(std::memory_order_relaxed);
+  while (current > peak &&
+         !c.peak.compare_exchange_weak(peak, current,
+                                       std::memory_order_relaxed)) {
+    // Try again with the updated peak
+  }
+}
+
+void mem_tag_free(mem_tag tag, std::size_t size)
+{
+  Counters& c = g_counters[int(tag)];
+  c.current -= size;
+  --c.count;
+}
+
+mem_tag_stats get_mem_tag_stats(mem_tag tag)
+{
+  const Counters& c = g_counters[int(tag)];
+  mem_tag_stats stats;
+  stats.current = c.current.load(std::memory_order_relaxed);
+  stats.peak = c.peak.load(std::memory_order_relaxed);
+  stats.count = c.count.load(std::memory_order_relaxed);
+  return stats;
+}
+
+const char* mem_tag_name(mem_tag tag)
+{
+  switch (tag) {
+    case mem_tag::images: return "Images";
+    case mem_tag::image_pool: return "Image pool";
+    case mem_tag::render_cache: return "Render cache";
+    case mem_tag::canvas: return "Canvas";
+    default: return "";
+  }
+}
+
+void reset_mem_tag_peaks()
+{
+  for (Counters& c : g_counters)
+    c.peak = c.current.load();
+}
+
+std::string mem_tag_report()
+{
+  std::string result;
+  char buf[256];
+  std::snprintf(buf, sizeof(buf), "%-14s %12s %12s %8s\n",
+                "Tag", "Current", "Peak", "Blocks");
+  result += buf;
+
+  for (int i=0; i<int(mem_tag::count); ++i) {
+    const mem_tag tag = mem_tag(i);
+    const mem_tag_stats stats = get_mem_tag_stats(tag);
+    std::snprintf(buf, sizeof(buf), "%-14s %12s %12s %8zu\n",
+                  mem_tag_name(tag),
+                  get_pretty_memory_size(stats.current).c_str(),
+                  get_pretty_memory_size(stats.peak).c_str(),
+                  stats.count);
+    result += buf;
+  }
+  return result;
+}
+
+mem_tag current_mem_tag()
+{
+  return g_currentTag;
+}
+
+mem_tag_scope::mem_tag_scope(mem_tag tag)
+  : m_old(g_currentTag)
+{
+  g_currentTag = tag;
+}
+
+mem_tag_scope::~mem_tag_scope()
+{
+  g_currentTag = m_old;
+}
+
+} // namespace base
@@ -0,0 +1,57 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace base {
+
+  // Subsystems whose memory is accounted separately. The memory is
+  // reported by the allocation sites of each subsystem (it isn't a
+  // hook of the general allocator), so only big blocks are tracked.
+  enum class mem_tag {
+    images,        // Pixels of doc::Image
+    image_pool,    // Free image blocks retained by the ImageBufferPool
+    render_cache,  // Images of render/playback/onion skin caches
+    canvas,        // Surfaces of the editors' canvas cache
+    count
+  };
+
+  struct mem_tag_stats {
+    std::size_t current = 0;  // Bytes in use
+    std::size_t peak = 0;     // Maximum "current" value
+    std::size_t count = 0;    // Number of live blocks
+  };
+
+  // Thread-safe (each counter is an atomic).
+  void mem_tag_alloc(mem_tag tag, std::size_t size);
+  void mem_tag_free(mem_tag tag, std::size_t size);
+
+  mem_tag_stats get_mem_tag_stats(mem_tag tag);
+  const char* mem_tag_name(mem_tag tag);
+
+  // Resets the peak of each tag to its current value.
+  void reset_mem_tag_peaks();
+
+  // Table with the stats of all tags (one line per tag).
+  std::string mem_tag_report();
+
+  // Tag used by allocations that can belong to different subsystems
+  // (e.g. image buffers). It's mem_tag::images by default, and it's
+  // changed in the calling thread by a mem_tag_scope.
+  mem_tag current_mem_tag();
+
+  class mem_tag_scope {
+  public:
+    explicit mem_tag_scope(mem_tag tag);
+    ~mem_tag_scope();
+  private:
+    mem_tag m_old;
+  };
+
+} // namespace base
@@ -0,0 +1,58 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/mem_tags.h"
+
+#include <thread>
+
+using namespace base;
+
+TEST(MemTags, CurrentPeakAndCount)
+{
+  const mem_tag_stats before = get_mem_tag_stats(mem_tag::canvas);
+
+  mem_tag_alloc(mem_tag::canvas, 100);
+  mem_tag_alloc(mem_tag::canvas, 50);
+  mem_tag_free(mem_tag::canvas, 100);
+
+  const mem_tag_stats after = get_mem_tag_stats(mem_tag::canvas);
+  EXPECT_EQ(before.current + 50, after.current);
+  EXPECT_EQ(before.count + 1, after.count);
+  EXPECT_LE(before.current + 150, after.peak);
+
+  mem_tag_free(mem_tag::canvas, 50);
+  reset_mem_tag_peaks();
+  EXPECT_EQ(before.current, get_mem_tag_stats(mem_tag::canvas).peak);
+}
+
+TEST(MemTags, ScopeChangesTheTagOfTheThread)
+{
+  EXPECT_EQ(mem_tag::images, current_mem_tag());
+  {
+    mem_tag_scope scope(mem_tag::render_cache);
+    EXPECT_EQ(mem_tag::render_cache, current_mem_tag());
+
+    std::thread([]{
+      EXPECT_EQ(mem_tag::images, current_mem_tag());
+    }).join();
+  }
+  EXPECT_EQ(mem_tag::images, current_mem_tag());
+}
+
+TEST(MemTags, Report)
+{
+  std::string report = mem_tag_report();
+  for (int i=0; i<int(mem_tag::count); ++i)
+    EXPECT_NE(std::string::npos, report.find(mem_tag_name(mem_tag(i))));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,208 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/rw_lock.h"
+
+#include "base/debug.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// Read locks acquired by the current thread in each rw_lock. A lock
+// released from other thread leaves its counter here, which just
+// lets this thread skip the writers of that lock.
+thread_local std::vector<std::pair<const rw_lock*, int>> g_readLocks;
+
+int thread_read_locks(const rw_lock* rw)
+{
+  for (const auto& entry : g_readLocks)
+    if (entry.first == rw)
+      return entry.second;
+  return 0;
+}
+
+void add_thread_read_locks(const rw_lock* rw, int delta)
+{
+  auto it = std::find_if(g_readLocks.begin(), g_readLocks.end(),
+                         [rw](const auto& entry){ return entry.first == rw; });
+  if (it == g_readLocks.end()) {
+    if (delta > 0)
+      g_readLocks.emplace_back(rw, delta);
+    return;
+  }
+
+  it->second += delta;
+  if (it->second <= 0)
+    g_readLocks.erase(it);
+}
+
+} // anonymous namespace
+
+rw_lock::rw_lock()
+  : m_writeLocked(false)
+  , m_readLocks(0)
+  , m_waitingWriters(0)
+{
+}
+
+rw_lock::~rw_lock()
+{
+  ASSERT(!m_writeLocked);
+  ASSERT(m_readLocks == 0);
+}
+
+template<typename Pred>
+bool rw_lock::wait(std::unique_lock<std::mutex>& lock,
+                   std::condition_variable& cv,
+                   int timeout, bool writer, Pred pred)
+{
+  if (pred()) {
+    ++m_stats.locks;
+    return true;
+  }
+
+  ++m_stats.contended;
+
+  bool result = false;
+  if (timeout > 0) {
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // Waiting writers stop new readers
+    if (writer)
+      ++m_waitingWriters;
+
+    result = cv.wait_for(lock, std::chrono::milliseconds(timeout), pred);
+
+    if (writer && --m_waitingWriters == 0)
+      m_readersCV.notify_all();
+
+    m_stats.waitTime += std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t0).count();
+  }
+
+  if (result)
+    ++m_stats.locks;
+  else
+    ++m_stats.timeouts;
+  return result;
+}
+
+bool rw_lock::lock(LockType lockType, int timeout)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  switch (lockType) {
+
+    case ReadLock: {
+      const bool reentrant = (thread_read_locks(this) > 0);
+      if (!wait(lock, m_readersCV, timeout, false,
+                [this, reentrant]{
+                  return (!m_writeLocked &&
+                          (reentrant || m_waitingWriters == 0));
+                }))
+        return false;
+
+      ++m_readLocks;
+      add_thread_read_locks(this, 1);
+      return true;
+    }
+
+    case WriteLock:
+      if (!wait(lock, m_writersCV, timeout, true,
+                [this]{ return (!m_writeLocked && m_readLocks == 0); }))
+        return false;
+
+      m_writeLocked = true;
+      return true;
+  }
+  return false;
+}
+
+bool rw_lock::upgrade_to_write(int timeout)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ASSERT(!m_writeLocked);
+  ASSERT(m_readLocks > 0);
+
+  // Just possible when the caller is the only reader
+  if (!wait(lock, m_writersCV, timeout, true,
+            [this]{ return (!m_writeLocked && m_readLocks == 1); }))
+    return false;
+
+  m_readLocks = 0;
+  m_writeLocked = true;
+  add_thread_read_locks(this, -1);
+  return true;
+}
+
+void rw_lock::downgrade_to_read()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ASSERT(m_writeLocked);
+    ASSERT(m_readLocks == 0);
+
+    m_writeLocked = false;
+    m_readLocks = 1;
+    add_thread_read_locks(this, 1);
+  }
+  m_readersCV.notify_all();
+  m_writersCV.notify_all();
+}
+
+void rw_lock::unlock()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_writeLocked) {
+      m_writeLocked = false;
+    }
+    else if (m_readLocks > 0) {
+      --m_readLocks;
+      add_thread_read_locks(this, -1);
+
+      // Only writers (or an upgrade) can be waiting for this
+      if (m_readLocks > 1)
+        return;
+    }
+    else {
+      ASSERT(false);
+      return;
+    }
+  }
+  m_readersCV.notify_all();
+  m_writersCV.notify_all();
+}
+
+bool rw_lock::is_write_locked() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_writeLocked;
+}
+
+int rw_lock::read_locks() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_readLocks;
+}
+
+rw_lock::Stats rw_lock::stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+} // namespace base
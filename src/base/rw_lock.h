@@ -0,0 +1,79 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "base/disable_copying.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace base {
+
+  // Reader/writer lock with timeouts. The waiting threads are
+  // blocked in condition variables (they are woken up as soon as the
+  // lock is released).
+  //
+  // It's fair with writers: new readers wait while a writer is
+  // waiting, so a stream of readers cannot starve the writers. A
+  // thread that already has a read lock can always lock it again to
+  // read (the writer is waiting for that thread anyway).
+  //
+  // The lock isn't owned by a thread, a background thread can
+  // release the lock acquired by the GUI thread (and vice versa).
+  class rw_lock {
+  public:
+    enum LockType { ReadLock, WriteLock };
+
+    struct Stats {
+      std::size_t locks = 0;     // Successful locks (including upgrades)
+      std::size_t contended = 0; // Locks that had to wait (or failed)
+      std::size_t timeouts = 0;  // Failed locks
+      double waitTime = 0.0;     // Total time waiting (milliseconds)
+    };
+
+    rw_lock();
+    ~rw_lock();
+
+    // Locks to read or write waiting up to "timeout" milliseconds
+    // (a timeout of 0 just tries to lock). Returns false if the lock
+    // cannot be acquired.
+    bool lock(LockType lockType, int timeout);
+
+    // Converts the read lock of the caller into a write lock. Only
+    // possible when the caller is the only reader.
+    bool upgrade_to_write(int timeout);
+
+    // Converts the write lock of the caller into a read lock.
+    void downgrade_to_read();
+
+    // Releases a read or write lock.
+    void unlock();
+
+    bool is_write_locked() const;
+    int read_locks() const;
+
+    Stats stats() const;
+
+  private:
+    template<typename Pred>
+    bool wait(std::unique_lock<std::mutex>& lock,
+              std::condition_variable& cv,
+              int timeout, bool writer, Pred pred);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_readersCV;
+    std::condition_variable m_writersCV;
+    bool m_writeLocked;
+    int m_readLocks;
+    int m_waitingWriters;
+    Stats m_stats;
+
+    DISABLE_COPYING(rw_lock);
+  };
+
+} // namespace base
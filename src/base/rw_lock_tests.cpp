@@ -0,0 +1,123 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/rw_lock.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace base;
+
+TEST(RWLock, ManyReaders)
+{
+  rw_lock rw;
+  EXPECT_TRUE(rw.lock(rw_lock::ReadLock, 0));
+  EXPECT_TRUE(rw.lock(rw_lock::ReadLock, 0));
+  EXPECT_EQ(2, rw.read_locks());
+  EXPECT_FALSE(rw.lock(rw_lock::WriteLock, 0));
+  rw.unlock();
+  rw.unlock();
+  EXPECT_TRUE(rw.lock(rw_lock::WriteLock, 0));
+  EXPECT_TRUE(rw.is_write_locked());
+  EXPECT_FALSE(rw.lock(rw_lock::ReadLock, 0));
+  EXPECT_FALSE(rw.lock(rw_lock::WriteLock, 0));
+  rw.unlock();
+}
+
+TEST(RWLock, Timeout)
+{
+  rw_lock rw;
+  EXPECT_TRUE(rw.lock(rw_lock::WriteLock, 0));
+
+  std::thread thread([&rw]{
+    EXPECT_FALSE(rw.lock(rw_lock::ReadLock, 10));
+  });
+  thread.join();
+  rw.unlock();
+
+  rw_lock::Stats stats = rw.stats();
+  EXPECT_EQ(1, stats.locks);
+  EXPECT_EQ(1, stats.contended);
+  EXPECT_EQ(1, stats.timeouts);
+  EXPECT_LT(0.0, stats.waitTime);
+}
+
+TEST(RWLock, WaitForWriter)
+{
+  rw_lock rw;
+  EXPECT_TRUE(rw.lock(rw_lock::WriteLock, 0));
+
+  std::atomic<bool> locked(false);
+  std::thread thread([&]{
+    EXPECT_TRUE(rw.lock(rw_lock::ReadLock, 10000));
+    locked = true;
+    rw.unlock();
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(locked);
+  rw.unlock();
+  thread.join();
+  EXPECT_TRUE(locked);
+}
+
+TEST(RWLock, UpgradeAndDowngrade)
+{
+  rw_lock rw;
+  EXPECT_TRUE(rw.lock(rw_lock::ReadLock, 0));
+  EXPECT_TRUE(rw.lock(rw_lock::ReadLock, 0));
+  EXPECT_FALSE(rw.upgrade_to_write(0));
+  rw.unlock();
+  EXPECT_TRUE(rw.upgrade_to_write(0));
+  EXPECT_TRUE(rw.is_write_locked());
+  EXPECT_EQ(0, rw.read_locks());
+
+  rw.downgrade_to_read();
+  EXPECT_FALSE(rw.is_write_locked());
+  EXPECT_EQ(1, rw.read_locks());
+  EXPECT_TRUE(rw.lock(rw_lock::ReadLock, 0));
+  rw.unlock();
+  rw.unlock();
+}
+
+TEST(RWLock, WaitingWriterStopsNewReaders)
+{
+  rw_lock rw;
+  EXPECT_TRUE(rw.lock(rw_lock::ReadLock, 0));
+
+  std::atomic<bool> writing(false);
+  std::thread writer([&]{
+    EXPECT_TRUE(rw.lock(rw_lock::WriteLock, 10000));
+    writing = true;
+    rw.unlock();
+  });
+
+  // Wait until the writer is waiting
+  while (rw.stats().contended == 0)
+    std::this_thread::yield();
+
+  // Other threads cannot read, but this one can lock it again
+  std::thread reader([&]{
+    EXPECT_FALSE(rw.lock(rw_lock::ReadLock, 0));
+  });
+  reader.join();
+  EXPECT_TRUE(rw.lock(rw_lock::ReadLock, 0));
+  rw.unlock();
+
+  EXPECT_FALSE(writing);
+  rw.unlock();
+  writer.join();
+  EXPECT_TRUE(writing);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -10,6 +10,7 @@
 
 #include "base/serialization.h"
 
+#include <cstring>
 #include <iostream>
 
 namespace base {
@@ -94,5 +95,137 @@ uint32_t big_endian::read32(std::istream& is)
   return ((b4 << 24) | (b3 << 16) | (b2 << 8) | b1);
 }
 
+void buffer_writer::write16(uint16_t value)
+{
+  uint8_t* p = reserve(2);
+  p[0] = value & 0xff;
+  p[1] = value >> 8;
+}
+
+void buffer_writer::write32(uint32_t value)
+{
+  uint8_t* p = reserve(4);
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = value >> 24;
+}
+
+void buffer_writer::write(const void* data, std::size_t size)
+{
+  if (size > 0)
+    std::memcpy(reserve(size), data, size);
+}
+
+void buffer_writer::write16_array(const uint16_t* values, std::size_t n)
+{
+  uint8_t* p = reserve(2*n);
+  for (std::size_t i=0; i<n; ++i, p+=2) {
+    p[0] = values[i] & 0xff;
+    p[1] = values[i] >> 8;
+  }
+}
+
+void buffer_writer::write32_array(const uint32_t* values, std::size_t n)
+{
+  uint8_t* p = reserve(4*n);
+  for (std::size_t i=0; i<n; ++i, p+=4) {
+    p[0] = values[i] & 0xff;
+    p[1] = (values[i] >> 8) & 0xff;
+    p[2] = (values[i] >> 16) & 0xff;
+    p[3] = values[i] >> 24;
+  }
+}
+
+uint8_t* buffer_writer::reserve(std::size_t size)
+{
+  const std::size_t offset = m_buf.size();
+  m_buf.resize(offset + size);
+  return m_buf.data() + offset;
+}
+
+void buffer_writer::patch32(std::size_t offset, uint32_t value)
+{
+  uint8_t* p = m_buf.data() + offset;
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = value >> 24;
+}
+
+std::ostream& buffer_writer::flush_to(std::ostream& os)
+{
+  if (!m_buf.empty())
+    os.write((const char*)m_buf.data(), m_buf.size());
+  m_buf.clear();
+  return os;
+}
+
+const uint8_t* buffer_reader::skip(std::size_t size)
+{
+  if (!m_ok || remaining() < size) {
+    m_ok = false;
+    m_pos = m_end;
+    return nullptr;
+  }
+  const uint8_t* p = m_pos;
+  m_pos += size;
+  return p;
+}
+
+uint8_t buffer_reader::read8()
+{
+  const uint8_t* p = skip(1);
+  return (p ? p[0]: 0);
+}
+
+uint16_t buffer_reader::read16()
+{
+  const uint8_t* p = skip(2);
+  return (p ? uint16_t((p[1] << 8) | p[0]): 0);
+}
+
+uint32_t buffer_reader::read32()
+{
+  const uint8_t* p = skip(4);
+  return (p ? ((uint32_t(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0]): 0);
+}
+
+bool buffer_reader::read(void* data, std::size_t size)
+{
+  const uint8_t* p = skip(size);
+  if (p && size > 0)
+    std::memcpy(data, p, size);
+  return (p != nullptr);
+}
+
+bool buffer_reader::read16_array(uint16_t* values, std::size_t n)
+{
+  const uint8_t* p = skip(2*n);
+  if (!p)
+    return false;
+  for (std::size_t i=0; i<n; ++i, p+=2)
+    values[i] = uint16_t((p[1] << 8) | p[0]);
+  return true;
+}
+
+bool buffer_reader::read32_array(uint32_t* values, std::size_t n)
+{
+  const uint8_t* p = skip(4*n);
+  if (!p)
+    return false;
+  for (std::size_t i=0; i<n; ++i, p+=4)
+    values[i] = (uint32_t(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+  return true;
+}
+
+bool read_block(std::istream& is, std::size_t size, std::vector<uint8_t>& buf)
+{
+  buf.resize(size);
+  if (size == 0)
+    return true;
+  return !is.read((char*)buf.data(), size).fail();
+}
+
 } // namespace serialization
 } // namespace base
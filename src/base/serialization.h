@@ -7,7 +7,10 @@
 #pragma once
 
 #include "base/ints.h"
+
+#include <cstddef>
 #include <iosfwd>
+#include <vector>
 
 namespace base {
 namespace serialization {
@@ -33,5 +36,72 @@ namespace serialization {
 
   } // big_endian namespace
 
+  // Little-endian values encoded in a memory buffer, so a whole
+  // object can be written to the stream with just one call.
+  class buffer_writer {
+  public:
+    buffer_writer() { }
+    explicit buffer_writer(std::size_t capacity) { m_buf.reserve(capacity); }
+
+    void write8(uint8_t value) { m_buf.push_back(value); }
+    void write16(uint16_t value);
+    void write32(uint32_t value);
+    void write(const void* data, std::size_t size);
+    void write16_array(const uint16_t* values, std::size_t n);
+    void write32_array(const uint32_t* values, std::size_t n);
+
+    // Returns "size" uninitialized bytes at the end of the buffer to
+    // be filled by the caller (e.g. by an encoder). Unused bytes can
+    // be returned with unreserve().
+    uint8_t* reserve(std::size_t size);
+    void unreserve(std::size_t size) { m_buf.resize(m_buf.size() - size); }
+
+    // Overwrites a value written previously (e.g. a size that is
+    // known after writing the data).
+    void patch32(std::size_t offset, uint32_t value);
+
+    const uint8_t* data() const { return m_buf.data(); }
+    std::size_t size() const { return m_buf.size(); }
+
+    // Writes the buffer in the stream and clears it.
+    std::ostream& flush_to(std::ostream& os);
+
+  private:
+    std::vector<uint8_t> m_buf;
+  };
+
+  // Reads little-endian values from a memory block. Reading beyond
+  // the end of the block returns zeros and sets the fail state
+  // (like std::istream), so a truncated block can be checked once
+  // with ok().
+  class buffer_reader {
+  public:
+    buffer_reader(const uint8_t* data, std::size_t size)
+      : m_pos(data), m_end(data+size), m_ok(true) { }
+
+    uint8_t read8();
+    uint16_t read16();
+    uint32_t read32();
+    bool read(void* data, std::size_t size);
+    bool read16_array(uint16_t* values, std::size_t n);
+    bool read32_array(uint32_t* values, std::size_t n);
+
+    // Returns a pointer to the next "size" bytes (or nullptr if
+    // there are not enough bytes) and skips them.
+    const uint8_t* skip(std::size_t size);
+
+    std::size_t remaining() const { return std::size_t(m_end - m_pos); }
+    bool ok() const { return m_ok; }
+
+  private:
+    const uint8_t* m_pos;
+    const uint8_t* m_end;
+    bool m_ok;
+  };
+
+  // Reads "size" bytes from the stream in "buf" with one call.
+  // Returns false if the stream doesn't contain enough bytes.
+  bool read_block(std::istream& is, std::size_t size, std::vector<uint8_t>& buf);
+
 } // serialization namespace
 } // base namespace
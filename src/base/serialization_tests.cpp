@@ -0,0 +1,84 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/serialization.h"
+
+#include <sstream>
+
+using namespace base::serialization;
+
+TEST(Serialization, BufferIsCompatibleWithStreamFunctions)
+{
+  buffer_writer w;
+  w.write8(0x12);
+  w.write16(0x3456);
+  w.write32(0x789abcde);
+
+  std::stringstream s;
+  w.flush_to(s);
+  EXPECT_EQ(0u, w.size());
+
+  EXPECT_EQ(0x12, read8(s));
+  EXPECT_EQ(0x3456, little_endian::read16(s));
+  EXPECT_EQ(0x789abcdeu, little_endian::read32(s));
+}
+
+TEST(Serialization, Arrays)
+{
+  const uint16_t words[] = { 1, 0xffff, 0x1234 };
+  const uint32_t dwords[] = { 0xff000000, 2, 0x12345678, 0 };
+
+  buffer_writer w;
+  w.write16_array(words, 3);
+  w.write32_array(dwords, 4);
+  ASSERT_EQ(3*2 + 4*4u, w.size());
+
+  uint16_t words2[3];
+  uint32_t dwords2[4];
+  buffer_reader r(w.data(), w.size());
+  EXPECT_TRUE(r.read16_array(words2, 3));
+  EXPECT_TRUE(r.read32_array(dwords2, 4));
+  EXPECT_EQ(0u, r.remaining());
+  EXPECT_TRUE(r.ok());
+  for (int i=0; i<3; ++i) EXPECT_EQ(words[i], words2[i]);
+  for (int i=0; i<4; ++i) EXPECT_EQ(dwords[i], dwords2[i]);
+}
+
+TEST(Serialization, ReserveAndPatch)
+{
+  buffer_writer w;
+  w.write32(0);
+  uint8_t* p = w.reserve(10);
+  p[0] = 'a';
+  p[1] = 'b';
+  w.unreserve(8);
+  w.patch32(0, 2);
+
+  buffer_reader r(w.data(), w.size());
+  EXPECT_EQ(2u, r.read32());
+  EXPECT_EQ('a', r.read8());
+  EXPECT_EQ('b', r.read8());
+  EXPECT_TRUE(r.ok());
+}
+
+TEST(Serialization, TruncatedBuffer)
+{
+  const uint8_t data[] = { 1, 2, 3 };
+  buffer_reader r(data, sizeof(data));
+  EXPECT_EQ(0x0201, r.read16());
+  EXPECT_EQ(0u, r.read32());
+  EXPECT_FALSE(r.ok());
+  EXPECT_EQ(0, r.read8());
+  EXPECT_EQ(nullptr, r.skip(1));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
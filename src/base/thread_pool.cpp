@@ -0,0 +1,222 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace base {
+
+static int default_workers = 0;
+
+struct thread_pool::job {
+  const std::function<void(int)>* func;
+  int n;
+  std::atomic<int> next;        // Next index to process
+  std::atomic<int> pending;     // Indexes that are not finished yet
+  std::mutex mutex;
+  std::condition_variable done;
+  std::exception_ptr exception;
+
+  job(const std::function<void(int)>* func, int n)
+    : func(func), n(n), next(0), pending(n) { }
+};
+
+thread_pool::thread_pool(int workers)
+  : m_stop(false)
+{
+  if (workers <= 0)
+    workers = int(std::thread::hardware_concurrency())-1;
+
+  for (int i=0; i<workers; ++i)
+    m_workers.emplace_back([this]{ worker_loop(); });
+}
+
+thread_pool::~thread_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+
+  for (auto& worker : m_workers)
+    worker.join();
+}
+
+void thread_pool::parallel_for(int n, const std::function<void(int)>& func)
+{
+  if (n <= 0)
+    return;
+
+  // Nothing to distribute
+  if (n == 1 || m_workers.empty()) {
+    for (int i=0; i<n; ++i)
+      func(i);
+    return;
+  }
+
+  auto j = std::make_shared<job>(&func, n);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(j);
+  }
+  m_cv.notify_all();
+
+  // The calling thread works on its own job too.
+  run_job(*j);
+
+  {
+    std::unique_lock<std::mutex> lock(j->mutex);
+    j->done.wait(lock, [&j]{ return j->pending == 0; });
+  }
+
+  // Remove the job from the queue (if the workers didn't remove it)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it=m_jobs.begin(); it!=m_jobs.end(); ++it) {
+      if (*it == j) {
+        m_jobs.erase(it);
+        break;
+      }
+    }
+  }
+
+  if (j->exception)
+    std::rethrow_exception(j->exception);
+}
+
+void thread_pool::parallel_for_range(int n, int grain,
+                                     const std::function<void(int, int)>& func)
+{
+  if (n <= 0)
+    return;
+  grain = std::max(1, grain);
+
+  parallel_for((n+grain-1) / grain, [n, grain, &func](int i){
+      func(i*grain, std::min(n, (i+1)*grain));
+    });
+}
+
+void thread_pool::post(std::function<void()>&& func,
+                       priority prio,
+                       const cancel_token& token)
+{
+  task t{ std::move(func), token };
+  if (m_workers.empty()) {
+    run_task(t);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks[int(prio)].push_back(std::move(t));
+  }
+  m_cv.notify_one();
+}
+
+// static
+thread_pool& thread_pool::instance()
+{
+  static thread_pool pool(default_workers);
+  return pool;
+}
+
+// static
+void thread_pool::set_default_workers(int workers)
+{
+  default_workers = workers;
+}
+
+void thread_pool::worker_loop()
+{
+  while (true) {
+    std::shared_ptr<job> j;
+    task t;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this]{
+          return (m_stop ||
+                  !m_jobs.empty() ||
+                  std::any_of(m_tasks, m_tasks+kPriorities,
+                              [](const std::deque<task>& tasks){
+                                return !tasks.empty();
+                              }));
+        });
+      if (m_stop)
+        return;
+
+      if (!m_jobs.empty()) {
+        j = m_jobs.front();
+
+        // All indexes of this job were already picked, so this worker
+        // can remove it from the queue.
+        if (j->next >= j->n) {
+          m_jobs.pop_front();
+          continue;
+        }
+      }
+      else {
+        for (auto& tasks : m_tasks) {
+          if (!tasks.empty()) {
+            t = std::move(tasks.front());
+            tasks.pop_front();
+            break;
+          }
+        }
+      }
+    }
+
+    if (j)
+      run_job(*j);
+    else
+      run_task(t);
+  }
+}
+
+// static
+void thread_pool::run_task(task& t)
+{
+  if (t.token.canceled())
+    return;
+
+  // A task cannot report errors to anyone, it must catch its own
+  // exceptions (we don't want to lose the worker anyway).
+  try {
+    t.func();
+  }
+  catch (...) {
+  }
+}
+
+// static
+void thread_pool::run_job(job& j)
+{
+  int i;
+  while ((i = j.next++) < j.n) {
+    try {
+      (*j.func)(i);
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(j.mutex);
+      if (!j.exception)
+        j.exception = std::current_exception();
+    }
+
+    if (--j.pending == 0) {
+      std::lock_guard<std::mutex> lock(j.mutex);
+      j.done.notify_all();
+    }
+  }
+}
+
+} // namespace base
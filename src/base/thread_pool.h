@@ -0,0 +1,108 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "base/disable_copying.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+  // Can be shared between a posted task and its owner to cancel the
+  // task (if it wasn't started yet) or to ask it to stop early.
+  class cancel_token {
+  public:
+    cancel_token() : m_canceled(std::make_shared<std::atomic<bool>>(false)) { }
+    void cancel() { *m_canceled = true; }
+    bool canceled() const { return *m_canceled; }
+  private:
+    std::shared_ptr<std::atomic<bool>> m_canceled;
+  };
+
+  // A pool of worker threads to run fork-join jobs (e.g. to process
+  // independent parts of an image in parallel) and background tasks.
+  //
+  // Workers take the indexes of the parallel_for() jobs one by one
+  // from a shared counter, so a worker that finishes early just
+  // takes more indexes from the same job (or from a job posted by a
+  // nested parallel_for()).
+  class thread_pool {
+  public:
+    enum class priority { high, normal, low };
+
+    // Creates a pool with the given number of worker threads (0 =
+    // one less than the number of hardware threads, as the calling
+    // thread works too).
+    explicit thread_pool(int workers = 0);
+    ~thread_pool();
+
+    // Number of threads that can run a job at the same time
+    // (workers + the calling thread).
+    int concurrency() const { return int(m_workers.size())+1; }
+
+    // Calls func(i) for each i in [0, n). The indexes are distributed
+    // between the workers and the calling thread, and this function
+    // returns when all of them were processed. If some call throws
+    // an exception, the first one is re-thrown here.
+    //
+    // It can be called from a function that is being run by the
+    // pool itself (the calling thread will process the indexes that
+    // are not picked by other workers).
+    void parallel_for(int n, const std::function<void(int)>& func);
+
+    // Splits [0, n) in consecutive ranges of "grain" items and calls
+    // func(begin, end) for each range in parallel.
+    void parallel_for_range(int n, int grain,
+                            const std::function<void(int, int)>& func);
+
+    // Runs the given task in a worker thread (or in the calling
+    // thread if the pool doesn't have workers). Tasks are picked
+    // after the parallel_for() jobs (someone is waiting for them),
+    // and by priority. A task whose token is canceled before a
+    // worker picks it is discarded. Tasks that are pending when the
+    // pool is destroyed are discarded too.
+    void post(std::function<void()>&& task,
+              priority prio = priority::normal,
+              const cancel_token& token = cancel_token());
+
+    // Shared pool for the whole program.
+    static thread_pool& instance();
+
+    // Number of workers of the shared pool (0 = default). It must be
+    // called before the first call to instance().
+    static void set_default_workers(int workers);
+
+  private:
+    struct job;
+    struct task {
+      std::function<void()> func;
+      cancel_token token;
+    };
+    static const int kPriorities = 3;
+
+    void worker_loop();
+    static void run_job(job& j);
+    static void run_task(task& t);
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::shared_ptr<job>> m_jobs;
+    std::deque<task> m_tasks[kPriorities];
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop;
+
+    DISABLE_COPYING(thread_pool);
+  };
+
+} // namespace base
@@ -0,0 +1,145 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace base;
+
+TEST(ThreadPool, AllIndexesAreProcessedOnce)
+{
+  thread_pool pool(3);
+  std::vector<int> counts(1000, 0);
+
+  pool.parallel_for(int(counts.size()), [&counts](int i){
+      ++counts[i];
+    });
+
+  for (int count : counts)
+    EXPECT_EQ(1, count);
+}
+
+TEST(ThreadPool, NestedJobs)
+{
+  thread_pool pool(2);
+  std::atomic<int> sum(0);
+
+  pool.parallel_for(8, [&pool, &sum](int i){
+      pool.parallel_for(8, [&sum](int j){
+          ++sum;
+        });
+    });
+
+  EXPECT_EQ(64, sum);
+}
+
+TEST(ThreadPool, SharedPool)
+{
+  std::atomic<int> sum(0);
+  thread_pool::instance().parallel_for(10, [&sum](int i){ sum += i; });
+  EXPECT_EQ(45, sum);
+}
+
+TEST(ThreadPool, Exception)
+{
+  thread_pool pool(2);
+  std::atomic<int> calls(0);
+
+  EXPECT_THROW(
+    pool.parallel_for(100, [&calls](int i){
+        ++calls;
+        if (i == 50)
+          throw std::runtime_error("error");
+      }),
+    std::runtime_error);
+
+  // All indexes are processed anyway
+  EXPECT_EQ(100, calls);
+}
+
+TEST(ThreadPool, Ranges)
+{
+  thread_pool pool(3);
+  std::vector<int> counts(1001, 0);
+
+  pool.parallel_for_range(int(counts.size()), 64, [&counts](int begin, int end){
+      EXPECT_LE(end-begin, 64);
+      for (int i=begin; i<end; ++i)
+        ++counts[i];
+    });
+
+  for (int count : counts)
+    EXPECT_EQ(1, count);
+}
+
+TEST(ThreadPool, PostTasks)
+{
+  thread_pool pool(2);
+  std::mutex mutex;
+  std::condition_variable cv;
+  int done = 0;
+
+  for (int i=0; i<10; ++i) {
+    pool.post([&]{
+        std::lock_guard<std::mutex> lock(mutex);
+        ++done;
+        cv.notify_one();
+      }, (i & 1 ? thread_pool::priority::low:
+                  thread_pool::priority::high));
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&done]{ return done == 10; });
+  EXPECT_EQ(10, done);
+}
+
+TEST(ThreadPool, CanceledTasks)
+{
+  thread_pool pool(1);
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool blocked = true;
+  std::atomic<int> calls(0);
+
+  // Keep the only worker busy while we post and cancel a task
+  pool.post([&]{
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&blocked]{ return !blocked; });
+    });
+
+  cancel_token token;
+  pool.post([&calls]{ ++calls; }, thread_pool::priority::normal, token);
+  token.cancel();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    blocked = false;
+  }
+  cv.notify_one();
+
+  // Tasks run in order, so when this one is done the canceled one
+  // was already discarded.
+  std::atomic<bool> last(false);
+  pool.post([&last]{ last = true; });
+  while (!last)
+    std::this_thread::yield();
+
+  EXPECT_EQ(0, calls);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
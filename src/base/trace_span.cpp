@@ -0,0 +1,124 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/trace_span.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+namespace trace {
+
+// Spans kept for each thread
+static const std::size_t kRingSize = 64*1024;
+
+namespace {
+
+struct Event {
+  const char* name;
+  Clock::time_point start;
+  Clock::time_point end;
+};
+
+struct ThreadBuffer {
+  int tid;
+  std::mutex mutex;             // Only contended while saving
+  std::vector<Event> events;
+  std::size_t next = 0;         // Next position to write in the ring
+  bool full = false;
+};
+
+std::mutex buffers_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+Clock::time_point session_start = Clock::now();
+
+ThreadBuffer& thread_buffer()
+{
+  // The list of buffers keeps the buffer alive after the thread ends
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+  if (!buffer) {
+    buffer = std::make_shared<ThreadBuffer>();
+    buffer->events.resize(kRingSize);
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer->tid = int(buffers.size())+1;
+    buffers.push_back(buffer);
+  }
+  return *buffer;
+}
+
+} // anonymous namespace
+
+std::atomic<bool> g_enabled(false);
+
+void set_enabled(bool state)
+{
+  if (state && !g_enabled) {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (auto& buffer : buffers) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      buffer->next = 0;
+      buffer->full = false;
+    }
+    session_start = Clock::now();
+  }
+  g_enabled = state;
+}
+
+void add_span(const char* name, Clock::time_point start, Clock::time_point end)
+{
+  ThreadBuffer& buffer = thread_buffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.events[buffer.next] = Event{ name, start, end };
+  if (++buffer.next == buffer.events.size()) {
+    buffer.next = 0;
+    buffer.full = true;
+  }
+}
+
+bool save_chrome_json(const std::string& filename)
+{
+  FILE* f = std::fopen(filename.c_str(), "w");
+  if (!f)
+    return false;
+
+  auto us = [](Clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+  };
+
+  std::fputs("{\"traceEvents\":[\n", f);
+  bool first = true;
+
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  for (auto& buffer : buffers) {
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    std::size_t n = (buffer->full ? buffer->events.size(): buffer->next);
+    std::size_t i = (buffer->full ? buffer->next: 0);
+    for (; n > 0; --n, i = (i+1) % buffer->events.size()) {
+      const Event& ev = buffer->events[i];
+      if (ev.start < session_start)
+        continue;
+
+      std::fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                   "\"ts\":%.3f,\"dur\":%.3f}",
+                   (first ? "": ",\n"), ev.name, buffer->tid,
+                   us(ev.start - session_start), us(ev.end - ev.start));
+      first = false;
+    }
+  }
+
+  std::fputs("\n]}\n", f);
+  return (std::fclose(f) == 0);
+}
+
+} // namespace trace
+} // namespace base
@@ -0,0 +1,67 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace base {
+namespace trace {
+
+  using Clock = std::chrono::steady_clock;
+
+  // Spans are recorded only while tracing is enabled (the disabled
+  // cost of a span is one relaxed load).
+  extern std::atomic<bool> g_enabled;
+
+  inline bool is_enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+  }
+
+  // Enabling the tracing discards the spans of the previous session.
+  void set_enabled(bool state);
+
+  // Adds a span to the ring buffer of the calling thread (the oldest
+  // spans are overwritten). The "name" must be a string literal.
+  void add_span(const char* name, Clock::time_point start, Clock::time_point end);
+
+  // Saves the recorded spans of all threads in the Chrome trace
+  // event format (it can be opened in chrome://tracing or
+  // ui.perfetto.dev). Returns false if the file cannot be written.
+  bool save_chrome_json(const std::string& filename);
+
+  class Span {
+  public:
+    explicit Span(const char* name)
+      : m_name(is_enabled() ? name: nullptr) {
+      if (m_name)
+        m_start = Clock::now();
+    }
+    ~Span() {
+      if (m_name)
+        add_span(m_name, m_start, Clock::now());
+    }
+  private:
+    const char* m_name;
+    Clock::time_point m_start;
+  };
+
+} // namespace trace
+} // namespace base
+
+// Measures the rest of the current scope. The spans are compiled only
+// with the ENABLE_TRACE_SPANS build option.
+#ifdef ENABLE_TRACE_SPANS
+  #define TRACE_SPAN_CAT2(a, b) a##b
+  #define TRACE_SPAN_CAT(a, b) TRACE_SPAN_CAT2(a, b)
+  #define TRACE_SPAN(name) \
+    base::trace::Span TRACE_SPAN_CAT(trace_span_, __LINE__)(name)
+#else
+  #define TRACE_SPAN(name) ((void)0)
+#endif
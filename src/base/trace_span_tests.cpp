@@ -0,0 +1,59 @@
+// LibreSprite Base Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/trace_span.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace base;
+
+static std::string save_trace()
+{
+  const char* filename = "_trace_span_tests.json";
+  EXPECT_TRUE(trace::save_chrome_json(filename));
+
+  std::ifstream f(filename);
+  std::stringstream buf;
+  buf << f.rdbuf();
+  f.close();
+  std::remove(filename);
+  return buf.str();
+}
+
+TEST(TraceSpan, SpansOfEachThread)
+{
+  trace::set_enabled(true);
+  {
+    trace::Span span("main");
+  }
+  std::thread([]{ trace::Span span("worker"); }).join();
+  trace::set_enabled(false);
+
+  std::string json = save_trace();
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"main\",\"ph\":\"X\",\"pid\":1,\"tid\":1"));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"worker\",\"ph\":\"X\",\"pid\":1,\"tid\":2"));
+}
+
+TEST(TraceSpan, Disabled)
+{
+  trace::set_enabled(true);
+  trace::set_enabled(false);
+  {
+    trace::Span span("ignored");
+  }
+  EXPECT_EQ(std::string::npos, save_trace().find("ignored"));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -133,26 +133,32 @@ public:
 
   void setValue(const char* section, const char* name, const char* value) {
     m_ini.SetValue(section, name, value);
+    m_modified = true;
   }
 
   void setBoolValue(const char* section, const char* name, bool value) {
     m_ini.SetBoolValue(section, name, value);
+    m_modified = true;
   }
 
   void setIntValue(const char* section, const char* name, int value) {
     m_ini.SetLongValue(section, name, value);
+    m_modified = true;
   }
 
   void setDoubleValue(const char* section, const char* name, double value) {
     m_ini.SetDoubleValue(section, name, value);
+    m_modified = true;
   }
 
   void deleteValue(const char* section, const char* name) {
-    m_ini.Delete(section, name, true);
+    if (m_ini.Delete(section, name, true))
+      m_modified = true;
   }
 
   void load(const std::string& filename) {
     m_filename = filename;
+    m_modified = false;
 
     base::FileHandle file(base::open_file(m_filename, "rb"));
     if (file) {
@@ -180,6 +186,10 @@ public:
   }
 
   void save() {
+    // Nothing to write (the file is already up to date)
+    if (!m_modified)
+      return;
+
     std::string data;
     SI_Error err = m_ini.Save(data);
     if (err != SI_OK) {
@@ -202,12 +212,14 @@ public:
 
     if (base::FileHandle file = base::open_file(m_filename, "wb")) {
 	std::fwrite(data.c_str(), 1, data.size(), file.get());
+	m_modified = false;
     }
   }
 
 private:
   std::string m_filename;
   CSimpleIniA m_ini;
+  bool m_modified = false;
 };
 
 CfgFile::CfgFile()
@@ -16,18 +16,33 @@ namespace css {
 
 CompoundStyle::CompoundStyle(Sheet* sheet, const std::string& name) :
   m_sheet(sheet),
-  m_name(name)
+  m_name(name),
+  m_version(-1)
 {
   update();
 }
 
 void CompoundStyle::update()
+{
+  rebuild();
+}
+
+void CompoundStyle::rebuild() const
 {
   deleteQueries();
+  m_version = m_sheet->version();
 
   const Style* style = m_sheet->getStyle(m_name);
-  if (style)
-    m_normal = m_sheet->query(*style);
+  m_normal = (style ? m_sheet->query(*style): Query());
+}
+
+int CompoundStyle::version() const
+{
+  // Queries for each combination of states are memoized until the
+  // sheet is modified (e.g. when the theme is reloaded)
+  if (m_version != m_sheet->version())
+    rebuild();
+  return m_version;
 }
 
 CompoundStyle::~CompoundStyle()
@@ -35,7 +50,7 @@ CompoundStyle::~CompoundStyle()
   deleteQueries();
 }
 
-void CompoundStyle::deleteQueries()
+void CompoundStyle::deleteQueries() const
 {
   for (QueriesMap::iterator it = m_queries.begin(), end = m_queries.end();
        it != end; ++it) {
@@ -46,11 +61,14 @@ void CompoundStyle::deleteQueries()
 
 const Value& CompoundStyle::operator[](const Rule& rule) const
 {
+  version();
   return m_normal[rule];
 }
 
 const Query& CompoundStyle::operator[](const States& states) const
 {
+  version();
+
   QueriesMap::const_iterator it = m_queries.find(states);
 
   if (it != m_queries.end())
@@ -11,6 +11,9 @@
 #include "css/state.h"
 #include "css/stateful_style.h"
 
+#include <map>
+#include <string>
+
 namespace css {
 
   class Sheet;
@@ -25,15 +28,20 @@ namespace css {
     const Value& operator[](const Rule& rule) const;
     const Query& operator[](const States& states) const;
 
+    // Version of the sheet used to compute the cached queries.
+    int version() const;
+
   private:
     typedef std::map<States, Query*> QueriesMap;
 
-    void deleteQueries();
+    void rebuild() const;
+    void deleteQueries() const;
 
     Sheet* m_sheet;
     std::string m_name;
-    Query m_normal;
+    mutable Query m_normal;
     mutable QueriesMap m_queries;
+    mutable int m_version;
   };
 
 } // namespace css
@@ -246,6 +246,36 @@ TEST(Css, CompoundStyles)
   EXPECT_EQ(Value(8), compoundSub3[focus+hover][fg]);
 }
 
+TEST(Css, CompoundStyleIsUpdatedWhenSheetChanges)
+{
+  Rule bg("bg");
+  State hover("hover");
+  Style base("base");
+  Style baseHover("base:hover");
+  Style baseHover2("base:hover");
+  base[bg] = Value(1);
+  baseHover[bg] = Value(2);
+  baseHover2[bg] = Value(3);
+
+  Sheet sheet;
+  sheet.addRule(&bg);
+  sheet.addStyle(&base);
+  sheet.addStyle(&baseHover);
+
+  CompoundStyle compound = sheet.compoundStyle("base");
+  EXPECT_EQ(Value(1), compound[bg]);
+  EXPECT_EQ(Value(2), compound[hover][bg]);
+
+  const int version = compound.version();
+  EXPECT_EQ(version, compound.version());
+
+  // Reloading a style invalidates the memoized queries
+  sheet.addStyle(&baseHover2);
+  EXPECT_NE(version, compound.version());
+  EXPECT_EQ(Value(1), compound[bg]);
+  EXPECT_EQ(Value(3), compound[hover][bg]);
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
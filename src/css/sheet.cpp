@@ -19,22 +19,25 @@
 namespace css {
 
 Sheet::Sheet()
+  : m_version(0)
 {
 }
 
 void Sheet::addRule(Rule* rule)
 {
   m_rules.add(rule->name(), rule);
+  ++m_version;
 }
 
 void Sheet::addStyle(Style* style)
 {
   m_styles.add(style->name(), style);
+  ++m_version;
 }
 
 const Style* Sheet::getStyle(const std::string& name)
 {
-  return m_styles[name];
+  return findStyle(name);
 }
 
 Query Sheet::query(const StatefulStyle& compound)
@@ -63,7 +66,7 @@ Query Sheet::query(const StatefulStyle& compound)
     name = style->name();
     name += states;
 
-    const Style* style2 = m_styles[name];
+    const Style* style2 = findStyle(name);
     if (style2)
       query.addFromStyle(style2);
   }
@@ -84,7 +87,7 @@ Query Sheet::query(const StatefulStyle& compound)
       name += StatefulStyle::kSeparator;
       name += (*state_it)->name();
 
-      const Style* style2 = m_styles[name];
+      const Style* style2 = findStyle(name);
       if (style2)
         query.addFromStyle(style2);
     }
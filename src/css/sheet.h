@@ -31,9 +31,18 @@ namespace css {
     Query query(const StatefulStyle& stateful);
     CompoundStyle compoundStyle(const std::string& name);
 
+    // Incremented each time a rule or style is added, so cached
+    // queries (see CompoundStyle) know that they must be re-done.
+    int version() const { return m_version; }
+
   private:
+    const Style* findStyle(const std::string& name) const {
+      return m_styles[name];
+    }
+
     Rules m_rules;
     Styles m_styles;
+    int m_version;
   };
 
 } // namespace css
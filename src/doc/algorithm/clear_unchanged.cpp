@@ -0,0 +1,80 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/algorithm/clear_unchanged.h"
+
+#include "doc/image.h"
+#include "doc/image_impl.h"
+#include "doc/primitives_fast.h"
+
+namespace doc {
+namespace algorithm {
+
+namespace {
+
+// Each row is processed without branches so the compiler can
+// vectorize the loop.
+template<typename ImageTraits>
+int clear_unchanged_rows(Image* image, const Image* refimage, color_t clearColor)
+{
+  typedef typename ImageTraits::pixel_t pixel_t;
+  const pixel_t clear = pixel_t(clearColor);
+  const int w = image->width();
+  int count = 0;
+
+  for (int y=0; y<image->height(); ++y) {
+    pixel_t* p = (pixel_t*)image->getPixelAddress(0, y);
+    const pixel_t* r = (const pixel_t*)refimage->getPixelAddress(0, y);
+    for (int x=0; x<w; ++x) {
+      const bool same = (p[x] == r[x]);
+      p[x] = (same ? clear: p[x]);
+      count += same;
+    }
+  }
+  return count;
+}
+
+template<typename ImageTraits>
+int clear_unchanged_pixels_templ(Image* image, const Image* refimage, color_t clearColor)
+{
+  int count = 0;
+  for (int y=0; y<image->height(); ++y)
+    for (int x=0; x<image->width(); ++x) {
+      if (get_pixel_fast<ImageTraits>(image, x, y) ==
+          get_pixel_fast<ImageTraits>(refimage, x, y)) {
+        put_pixel_fast<ImageTraits>(image, x, y, clearColor);
+        ++count;
+      }
+    }
+  return count;
+}
+
+}
+
+int clear_unchanged_pixels(Image* image,
+                           const Image* refimage,
+                           color_t clearColor)
+{
+  ASSERT(image && refimage);
+  ASSERT(image->bounds() == refimage->bounds());
+  ASSERT(image->pixelFormat() == refimage->pixelFormat());
+
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB:       return clear_unchanged_rows<RgbTraits>(image, refimage, clearColor);
+    case IMAGE_GRAYSCALE: return clear_unchanged_rows<GrayscaleTraits>(image, refimage, clearColor);
+    case IMAGE_INDEXED:   return clear_unchanged_rows<IndexedTraits>(image, refimage, clearColor);
+    case IMAGE_BITMAP:    return clear_unchanged_pixels_templ<BitmapTraits>(image, refimage, clearColor);
+  }
+  ASSERT(false);
+  return 0;
+}
+
+} // namespace algorithm
+} // namespace doc
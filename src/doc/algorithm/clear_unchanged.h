@@ -0,0 +1,26 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "doc/color.h"
+
+namespace doc {
+  class Image;
+
+  namespace algorithm {
+
+    // Replaces with "clearColor" the pixels of "image" that are equal
+    // to the pixels of "refimage" (both images must have the same
+    // size and format). Used by animation encoders to write the
+    // pixels that don't change between frames with the transparent
+    // index. Returns the number of replaced pixels.
+    int clear_unchanged_pixels(Image* image,
+                               const Image* refimage,
+                               color_t clearColor);
+
+  } // algorithm
+} // doc
@@ -10,18 +10,23 @@
 
 #include "doc/algorithm/flip_image.h"
 
+#include "base/thread_pool.h"
 #include "gfx/rect.h"
 #include "doc/image.h"
+#include "doc/image_spans.h"
 #include "doc/mask.h"
 #include "doc/primitives.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
 namespace doc {
 namespace algorithm {
 
-void flip_image(Image* image, const gfx::Rect& bounds, FlipType flipType)
+namespace {
+
+void flip_image_generic(Image* image, const gfx::Rect& bounds, FlipType flipType)
 {
   switch (flipType) {
 
@@ -52,6 +57,82 @@ void flip_image(Image* image, const gfx::Rect& bounds, FlipType flipType)
   }
 }
 
+// Number of rows flipped by each job of the thread pool
+const int kFlipRowsPerJob = 32;
+
+// Images with less pixels than this are flipped in just one thread.
+const int kFlipParallelPixels = 256*256;
+
+// Calls func(y1, y2) for bands of "rows" rows (in parallel when
+// there are enough pixels)
+template<typename Func>
+void for_each_row_band(int rows, int width, Func func)
+{
+  const int bands = (rows + kFlipRowsPerJob - 1) / kFlipRowsPerJob;
+  auto band = [&](int i) {
+    const int y1 = i*kFlipRowsPerJob;
+    func(y1, std::min(y1+kFlipRowsPerJob, rows));
+  };
+
+  if (rows*width >= kFlipParallelPixels)
+    base::thread_pool::instance().parallel_for(bands, band);
+  else
+    for (int i=0; i<bands; ++i)
+      band(i);
+}
+
+template<typename ImageTraits>
+void flip_image_templ(Image* image, const gfx::Rect& bounds, FlipType flipType)
+{
+  ImageSpans<ImageTraits> spans(image, bounds);
+  const gfx::Rect& rc = spans.bounds();
+
+  switch (flipType) {
+
+    case FlipHorizontal:
+      for_each_row_band(
+        rc.h, rc.w,
+        [&spans, &rc](int y1, int y2) {
+          for (int y=rc.y+y1; y<rc.y+y2; ++y) {
+            auto span = spans.span(y);
+            std::reverse(span.begin, span.end);
+          }
+        });
+      break;
+
+    case FlipVertical:
+      // Each job swaps a band of rows of the top half with the
+      // mirrored rows of the bottom half
+      for_each_row_band(
+        rc.h/2, rc.w*2,
+        [&spans, &rc](int y1, int y2) {
+          for (int y=rc.y+y1, v=rc.y2()-1-y1; y<rc.y+y2; ++y, --v) {
+            auto a = spans.span(y);
+            std::swap_ranges(a.begin, a.end, spans.span(v).begin);
+          }
+        });
+      break;
+  }
+}
+
+} // anonymous namespace
+
+void flip_image(Image* image, const gfx::Rect& bounds, FlipType flipType)
+{
+  // Rows are flipped with spans (the generic version is used for
+  // parts outside the image, where get/put_pixel() clip each pixel)
+  if (image->bounds().contains(bounds)) {
+    switch (image->pixelFormat()) {
+      case IMAGE_RGB:       flip_image_templ<RgbTraits>(image, bounds, flipType); return;
+      case IMAGE_GRAYSCALE: flip_image_templ<GrayscaleTraits>(image, bounds, flipType); return;
+      case IMAGE_INDEXED:   flip_image_templ<IndexedTraits>(image, bounds, flipType); return;
+      default:
+        break;
+    }
+  }
+  flip_image_generic(image, bounds, flipType);
+}
+
 void flip_image_with_mask(Image* image, const Mask* mask, FlipType flipType, int bgcolor)
 {
   gfx::Rect bounds = mask->bounds();
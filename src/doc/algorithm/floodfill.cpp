@@ -1,344 +1,424 @@
-// The floodfill routine.
-// By Shawn Hargreaves.
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
 //
-// Changes by David Capello:
-// - Adapted to Aseprite
-// - Added non-contiguous mode
-// - Added mask parameter
+// Based on the floodfill routine by Shawn Hargreaves, adapted to
+// Aseprite by David Capello (non-contiguous mode, mask parameter).
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
-//
-// TODO rewrite this algorithm from scratch
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
-#include "base/base.h"
-#include "doc/algo.h"
+#include "doc/algorithm/floodfill.h"
+
+#include "base/thread_pool.h"
 #include "doc/image.h"
+#include "doc/image_impl.h"
 #include "doc/mask.h"
 #include "doc/primitives.h"
 #include "doc/primitives_fast.h"
+#include "gfx/rect.h"
 
-#include <climits>
-#include <cmath>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
 #include <vector>
 
 namespace doc {
 namespace algorithm {
 
-struct FLOODED_LINE {   // store segments which have been flooded
-  short flags;          // status of the segment
-  short lpos, rpos;     // left and right ends of segment
-  short y;              // y coordinate of the segment
-  int next;             // linked list if several per line
+namespace {
+
+// Number of rows compared by each job of the thread pool in the
+// non-contiguous mode.
+const int kFillRowsPerJob = 16;
+
+// Areas with less pixels than this are compared in just one thread.
+const int kFillParallelPixels = 256*256;
+
+// Compares pixels with the color to replace using the given
+// tolerance. The comparison doesn't branch, so the loop in
+// match_row() can be vectorized by the compiler.
+template<typename ImageTraits>
+struct ColorMatch;
+
+template<>
+struct ColorMatch<RgbTraits> {
+  int r, g, b, a, tolerance;
+  bool transparent;
+
+  ColorMatch(color_t c, int tolerance)
+    : r(rgba_getr(c)), g(rgba_getg(c)), b(rgba_getb(c)), a(rgba_geta(c))
+    , tolerance(tolerance)
+    , transparent(a == 0) {
+  }
+
+  // Two transparent pixels are always equal
+  uint8_t operator()(uint32_t c) const {
+    const int ca = rgba_geta(c);
+    return ((transparent & (ca == 0)) |
+            ((std::abs(int(rgba_getr(c)) - r) <= tolerance) &
+             (std::abs(int(rgba_getg(c)) - g) <= tolerance) &
+             (std::abs(int(rgba_getb(c)) - b) <= tolerance) &
+             (std::abs(ca - a) <= tolerance)));
+  }
+};
+
+template<>
+struct ColorMatch<GrayscaleTraits> {
+  int v, a, tolerance;
+  bool transparent;
+
+  ColorMatch(color_t c, int tolerance)
+    : v(graya_getv(c)), a(graya_geta(c))
+    , tolerance(tolerance)
+    , transparent(a == 0) {
+  }
+
+  uint8_t operator()(uint16_t c) const {
+    const int ca = graya_geta(c);
+    return ((transparent & (ca == 0)) |
+            ((std::abs(int(graya_getv(c)) - v) <= tolerance) &
+             (std::abs(ca - a) <= tolerance)));
+  }
 };
 
-/* Note: a 'short' is not sufficient for 'next' above in some corner cases. */
+template<>
+struct ColorMatch<IndexedTraits> {
+  int index, tolerance;
 
+  ColorMatch(color_t c, int tolerance)
+    : index(int(c)), tolerance(tolerance) {
+  }
 
-static std::vector<FLOODED_LINE> flood_buf;
-static int flood_count;          /* number of flooded segments */
+  uint8_t operator()(uint8_t c) const {
+    return (std::abs(int(c) - index) <= tolerance);
+  }
+};
 
-#define FLOOD_IN_USE             1
-#define FLOOD_TODO_ABOVE         2
-#define FLOOD_TODO_BELOW         4
+// Bitmaps don't use the tolerance
+template<>
+struct ColorMatch<BitmapTraits> {
+  color_t color;
 
-#define FLOOD_LINE(c)            (&flood_buf[c])
+  ColorMatch(color_t c, int tolerance) : color(c) {
+  }
+};
 
-static inline bool color_equal_32(color_t c1, color_t c2, int tolerance)
+// Sets out[i] to 1 if the pixel (x+i, y) matches the color
+template<typename ImageTraits>
+void match_row(const Image* image, const ColorMatch<ImageTraits>& match,
+               int x, int y, int w, uint8_t* out)
 {
-  if (tolerance == 0)
-    return (c1 == c2) || (rgba_geta(c1) == 0 && rgba_geta(c2) == 0);
-  else {
-    int r1 = rgba_getr(c1);
-    int g1 = rgba_getg(c1);
-    int b1 = rgba_getb(c1);
-    int a1 = rgba_geta(c1);
-    int r2 = rgba_getr(c2);
-    int g2 = rgba_getg(c2);
-    int b2 = rgba_getb(c2);
-    int a2 = rgba_geta(c2);
-
-    if (a1 == 0 && a2 == 0)
-      return true;
-
-    return ((ABS(r1-r2) <= tolerance) &&
-            (ABS(g1-g2) <= tolerance) &&
-            (ABS(b1-b2) <= tolerance) &&
-            (ABS(a1-a2) <= tolerance));
-  }
+  auto src = reinterpret_cast<typename ImageTraits::const_address_t>(
+    image->getPixelAddress(x, y));
+  for (int i=0; i<w; ++i)
+    out[i] = match(src[i]);
 }
 
-static inline bool color_equal_16(color_t c1, color_t c2, int tolerance)
+template<>
+void match_row<BitmapTraits>(const Image* image, const ColorMatch<BitmapTraits>& match,
+                             int x, int y, int w, uint8_t* out)
 {
-  if (tolerance == 0)
-    return (c1 == c2) || (graya_geta(c1) == 0 && graya_geta(c2) == 0);
-  else {
-    int k1 = graya_getv(c1);
-    int a1 = graya_geta(c1);
-    int k2 = graya_getv(c2);
-    int a2 = graya_geta(c2);
-
-    if (a1 == 0 && a2 == 0)
-      return true;
-
-    return ((ABS(k1-k2) <= tolerance) &&
-            (ABS(a1-a2) <= tolerance));
+  const uint8_t* src = image->getPixelAddress(0, y);
+  for (int i=0; i<w; ++i) {
+    const int u = x+i;
+    out[i] = (((src[u/8] >> (u%8)) & 1) == int(match.color));
   }
 }
 
-static inline bool color_equal_8(color_t c1, color_t c2, int tolerance)
+// Clears the pixels of the row that are outside the mask
+void mask_row(const Mask* mask, int x, int y, int w, uint8_t* out)
 {
-  if (tolerance == 0)
-    return (c1 == c2);
-  else
-    return ABS((int)c1 - (int)c2) <= tolerance;
+  const gfx::Rect& mb = mask->bounds();
+  if (y < mb.y || y >= mb.y2()) {
+    std::fill(out, out+w, 0);
+    return;
+  }
+
+  const int u1 = std::clamp(mb.x-x, 0, w);
+  const int u2 = std::clamp(mb.x2()-x, u1, w);
+  std::fill(out, out+u1, 0);
+  std::fill(out+u2, out+w, 0);
+
+  if (const Image* bitmap = mask->bitmap()) {
+    const uint8_t* bits = bitmap->getPixelAddress(0, y-mb.y);
+    for (int u=u1; u<u2; ++u) {
+      const int v = x+u-mb.x;
+      out[u] &= (bits[v/8] >> (v%8)) & 1;
+    }
+  }
 }
 
-template<typename ImageTraits>
-static inline bool color_equal(color_t c1, color_t c2, int tolerance)
+// Packs the 0/1 values of "in" in words of 64 bits (the bits after
+// "w" are zero)
+void pack_bits(const uint8_t* in, int w, uint64_t* out)
 {
-  static_assert(false && sizeof(ImageTraits), "Invalid color comparison");
-  return false;
+  for (int x=0; x<w; x+=64) {
+    const int n = std::min(64, w-x);
+    uint64_t word = 0;
+    for (int i=0; i<n; ++i)
+      word |= uint64_t(in[x+i]) << i;
+    out[x/64] = word;
+  }
 }
 
-template<>
-inline bool color_equal<RgbTraits>(color_t c1, color_t c2, int tolerance)
+bool is_bit_set(const uint64_t* row, int u)
 {
-  return color_equal_32(c1, c2, tolerance);
+  return (row[u/64] >> (u%64)) & 1;
 }
 
-template<>
-inline bool color_equal<GrayscaleTraits>(color_t c1, color_t c2, int tolerance)
+// First set bit in [u1, u2], or -1
+int find_set_bit(const uint64_t* row, int u1, int u2)
 {
-  return color_equal_16(c1, c2, tolerance);
+  int i = u1/64;
+  uint64_t word = row[i] & (~uint64_t(0) << (u1%64));
+  for (;;) {
+    if (word) {
+      const int u = i*64 + std::countr_zero(word);
+      return (u <= u2 ? u: -1);
+    }
+    if (++i*64 > u2)
+      return -1;
+    word = row[i];
+  }
 }
 
-template<>
-inline bool color_equal<IndexedTraits>(color_t c1, color_t c2, int tolerance)
+// First bit of the run of set bits that contains "u"
+int run_start(const uint64_t* row, int u)
 {
-  return color_equal_8(c1, c2, tolerance);
+  int i = u/64;
+  uint64_t clear = ~row[i] & (~uint64_t(0) >> (63 - u%64));
+  while (!clear) {
+    if (--i < 0)
+      return 0;
+    clear = ~row[i];
+  }
+  return i*64 + 64 - std::countl_zero(clear);
 }
 
-
-
-/* flooder:
- *  Fills a horizontal line around the specified position, and adds it
- *  to the list of drawn segments. Returns the first x coordinate after
- *  the part of the line which it has dealt with.
- */
-static int flooder(const Image* image,
-                   const Mask* mask,
-                   int x, int y,
-                   const gfx::Rect& bounds,
-                   color_t src_color, int tolerance, void *data, AlgoHLine proc)
+// Last bit of the run of set bits that contains "u" in a row of "w"
+// bits
+int run_end(const uint64_t* row, int w, int u)
 {
-#define MASKED(u, v)                                                    \
-        (mask &&                                                        \
-         (!mask->bounds().contains(u, v) ||                             \
-          (mask->bitmap() &&                                            \
-           !get_pixel_fast<BitmapTraits>(mask->bitmap(),                \
-                                         (u)-mask->bounds().x,          \
-                                         (v)-mask->bounds().y))))
-
-  FLOODED_LINE *p;
-  int left = 0, right = 0;
-  int c;
-
-  switch (image->pixelFormat()) {
-
-    case IMAGE_RGB:
-      {
-        uint32_t* address = reinterpret_cast<uint32_t*>(image->getPixelAddress(0, y));
-
-        // Check start pixel
-        if (!color_equal_32((int)*(address+x), src_color, tolerance) || MASKED(x, y))
-          return x+1;
-
-        // Work left from starting point
-        for (left=x-1; left>=bounds.x; left--) {
-          if (!color_equal_32((int)*(address+left), src_color, tolerance) || MASKED(left, y))
-            break;
-        }
-
-        // Work right from starting point
-        for (right=x+1; right<bounds.x2(); right++) {
-          if (!color_equal_32((int)*(address+right), src_color, tolerance) || MASKED(right, y))
-            break;
-        }
-      }
-      break;
-
-    case IMAGE_GRAYSCALE:
-      {
-        uint16_t* address = reinterpret_cast<uint16_t*>(image->getPixelAddress(0, y));
-
-        // Check start pixel
-        if (!color_equal_16((int)*(address+x), src_color, tolerance) || MASKED(x, y))
-          return x+1;
-
-        // Work left from starting point
-        for (left=x-1; left>=bounds.x; left--) {
-          if (!color_equal_16((int)*(address+left), src_color, tolerance) || MASKED(left, y))
-            break;
-        }
-
-        // Work right from starting point
-        for (right=x+1; right<bounds.x2(); right++) {
-          if (!color_equal_16((int)*(address+right), src_color, tolerance) || MASKED(right, y))
-            break;
-        }
-      }
-      break;
-
-    case IMAGE_INDEXED:
-      {
-        uint8_t* address = image->getPixelAddress(0, y);
-
-        // Check start pixel
-        if (!color_equal_8((int)*(address+x), src_color, tolerance) || MASKED(x, y))
-          return x+1;
-
-        // Work left from starting point
-        for (left=x-1; left>=bounds.x; left--) {
-          if (!color_equal_8((int)*(address+left), src_color, tolerance) || MASKED(left, y))
-            break;
-        }
-
-        // Work right from starting point
-        for (right=x+1; right<bounds.x2(); right++) {
-          if (!color_equal_8((int)*(address+right), src_color, tolerance) || MASKED(right, y))
-            break;
-        }
-      }
-      break;
-
-    default:
-      // Check start pixel
-      if (get_pixel(image, x, y) != src_color || MASKED(x, y))
-        return x+1;
-
-      // Work left from starting point
-      for (left=x-1; left>=bounds.x; left--) {
-        if (get_pixel(image, left, y) != src_color || MASKED(left, y))
-          break;
-      }
-
-      // Work right from starting point
-      for (right=x+1; right<bounds.x2(); right++) {
-        if (get_pixel(image, right, y) != src_color || MASKED(right, y))
-          break;
-      }
-      break;
+  const int words = (w+63) / 64;
+  int i = u/64;
+  uint64_t clear = ~row[i] & (~uint64_t(0) << (u%64));
+  while (!clear) {
+    if (++i == words)
+      return w-1;
+    clear = ~row[i];
   }
+  return i*64 + std::countr_zero(clear) - 1;
+}
 
-  left++;
-  right--;
-
-  /* draw the line */
-  (*proc)(left, y, right, data);
+void clear_bits(uint64_t* row, int u1, int u2)
+{
+  const int i1 = u1/64;
+  const int i2 = u2/64;
+  const uint64_t first = ~uint64_t(0) << (u1%64);
+  const uint64_t last = ~uint64_t(0) >> (63 - u2%64);
+  if (i1 == i2) {
+    row[i1] &= ~(first & last);
+    return;
+  }
+  row[i1] &= ~first;
+  std::fill(row+i1+1, row+i2, 0);
+  row[i2] &= ~last;
+}
 
-  /* store it in the list of flooded segments */
-  c = y;
-  p = FLOOD_LINE(c);
+// Packed bits of the pixels that can be filled. A bit is cleared
+// when its pixel is filled, so the same map tells us which pixels
+// were already visited. Rows are compared the first time they are
+// touched, so small fills in big images don't compare the whole
+// image.
+template<typename ImageTraits>
+class FillMap {
+public:
+  FillMap(const Image* image, const Mask* mask, const gfx::Rect& bounds,
+          const ColorMatch<ImageTraits>& match)
+    : m_image(image)
+    , m_mask(mask)
+    , m_bounds(bounds)
+    , m_match(match)
+    , m_words((bounds.w+63) / 64)
+    , m_bits(std::size_t(m_words) * bounds.h, 0)
+    , m_ready(bounds.h, false)
+    , m_tmp(bounds.w) {
+  }
 
-  if (p->flags) {
-    while (p->next) {
-      c = p->next;
-      p = FLOOD_LINE(c);
+  // Row of bits for the image row "v" (relative to the bounds)
+  uint64_t* row(int v) {
+    uint64_t* row = &m_bits[std::size_t(v) * m_words];
+    if (!m_ready[v]) {
+      matchRow(m_bounds.y+v, row);
+      m_ready[v] = true;
     }
-
-    p->next = c = flood_count++;
-    flood_buf.resize(flood_count);
-    p = FLOOD_LINE(c);
+    return row;
   }
 
-  p->flags = FLOOD_IN_USE;
-  p->lpos = left;
-  p->rpos = right;
-  p->y = y;
-  p->next = 0;
+private:
+  void matchRow(int y, uint64_t* row) {
+    uint8_t* tmp = &m_tmp[0];
+    match_row<ImageTraits>(m_image, m_match, m_bounds.x, y, m_bounds.w, tmp);
+    if (m_mask)
+      mask_row(m_mask, m_bounds.x, y, m_bounds.w, tmp);
+    pack_bits(tmp, m_bounds.w, row);
+  }
 
-  if (y > bounds.y)
-    p->flags |= FLOOD_TODO_ABOVE;
+  const Image* m_image;
+  const Mask* m_mask;
+  gfx::Rect m_bounds;
+  ColorMatch<ImageTraits> m_match;
+  int m_words;
+  std::vector<uint64_t> m_bits;
+  std::vector<bool> m_ready;
+  std::vector<uint8_t> m_tmp;
+};
 
-  if (y+1 < bounds.y2())
-    p->flags |= FLOOD_TODO_BELOW;
+template<typename ImageTraits>
+void flood_contiguous(const Image* image, const Mask* mask,
+                      int x, int y, const gfx::Rect& bounds,
+                      const ColorMatch<ImageTraits>& match,
+                      void* data, AlgoHLine proc)
+{
+  FillMap<ImageTraits> map(image, mask, bounds, match);
+  const int u = x - bounds.x;
+  const int v = y - bounds.y;
 
-  return right+2;
-}
+  uint64_t* startRow = map.row(v);
+  if (!is_bit_set(startRow, u))
+    return;
 
+  // Pending rows to scan below/above a filled span
+  struct Span { int v, u1, u2; };
+  std::vector<Span> stack;
+
+  auto fill = [&](uint64_t* row, int v, int u1, int u2) {
+    clear_bits(row, u1, u2);
+    (*proc)(bounds.x+u1, bounds.y+v, bounds.x+u2, data);
+    if (v > 0)
+      stack.push_back(Span{ v-1, u1, u2 });
+    if (v+1 < bounds.h)
+      stack.push_back(Span{ v+1, u1, u2 });
+  };
+
+  fill(startRow, v, run_start(startRow, u), run_end(startRow, bounds.w, u));
+
+  while (!stack.empty()) {
+    const Span span = stack.back();
+    stack.pop_back();
+
+    uint64_t* row = map.row(span.v);
+    int u1 = span.u1;
+    while (u1 <= span.u2) {
+      u1 = find_set_bit(row, u1, span.u2);
+      if (u1 < 0)
+        break;
 
+      // The new span can go beyond both ends of the previous one
+      const int left = run_start(row, u1);
+      const int right = run_end(row, bounds.w, u1);
+      fill(row, span.v, left, right);
+      u1 = right+2;
+    }
+  }
+}
 
-/* check_flood_line:
- *  Checks a line segment, using the scratch buffer is to store a list of
- *  segments which have already been drawn in order to minimise the required
- *  number of tests.
- */
-static int check_flood_line(const Image* image,
-                            const Mask* mask,
-                            int y, int left, int right,
-                            const gfx::Rect& bounds,
-                            int src_color, int tolerance, void *data, AlgoHLine proc)
+// Calls func(y, x1, x2) for each run of pixels of the rows [y1, y2)
+// that matches the color
+template<typename ImageTraits, typename Func>
+void for_each_run(const Image* image, const gfx::Rect& bounds,
+                  const ColorMatch<ImageTraits>& match,
+                  int y1, int y2, Func func)
 {
-  int c;
-  FLOODED_LINE *p;
-  int ret = false;
+  const int words = (bounds.w+63) / 64;
+  std::vector<uint8_t> tmp(bounds.w);
+  std::vector<uint64_t> bits(words);
 
-  while (left <= right) {
-    c = y;
+  for (int y=y1; y<y2; ++y) {
+    match_row<ImageTraits>(image, match, bounds.x, y, bounds.w, &tmp[0]);
+    pack_bits(&tmp[0], bounds.w, &bits[0]);
 
-    for (;;) {
-      p = FLOOD_LINE(c);
-
-      if ((left >= p->lpos) && (left <= p->rpos)) {
-        left = p->rpos+2;
-        break;
-      }
-
-      c = p->next;
-
-      if (!c) {
-        left = flooder(image, mask, left, y, bounds, src_color, tolerance, data, proc);
-        ret = true;
+    for (int u=0; u<bounds.w; ) {
+      u = find_set_bit(&bits[0], u, bounds.w-1);
+      if (u < 0)
         break;
-      }
+      const int end = run_end(&bits[0], bounds.w, u);
+      func(y, bounds.x+u, bounds.x+end);
+      u = end+2;
     }
   }
-
-  return ret;
 }
 
+// Calls proc() for each run of pixels in the bounds that matches
+// the color. Bands of rows are compared in parallel, and the runs
+// are drawn in order from the calling thread (as "proc" isn't
+// thread-safe).
 template<typename ImageTraits>
-static void replace_color(const Image* image, const gfx::Rect& bounds, int src_color, int tolerance, void* data, AlgoHLine proc)
+void replace_color(const Image* image, const gfx::Rect& bounds,
+                   const ColorMatch<ImageTraits>& match,
+                   void* data, AlgoHLine proc)
 {
-  typename ImageTraits::address_t address;
-
-  for (int y=bounds.y; y<bounds.y2(); ++y) {
-    address = reinterpret_cast<typename ImageTraits::address_t>(image->getPixelAddress(bounds.x, y));
-
-    for (int x=bounds.x; x<bounds.x2(); ++x, ++address) {
-      int right = -1;
-
-      if (color_equal<ImageTraits>((int)(*address), src_color, tolerance)) {
-        ++address;
-        for (right=x+1; right<bounds.x2(); ++right, ++address) {
-          if (!color_equal<ImageTraits>((int)(*address), src_color, tolerance))
-            break;
-        }
-        (*proc)(x, y, right-1, data);
-        x = right;
-      }
-    }
+  base::thread_pool& pool = base::thread_pool::instance();
+  if (bounds.w*bounds.h < kFillParallelPixels || pool.concurrency() < 2) {
+    for_each_run<ImageTraits>(
+      image, bounds, match, bounds.y, bounds.y2(),
+      [data, proc](int y, int x1, int x2) {
+        (*proc)(x1, y, x2, data);
+      });
+    return;
   }
+
+  struct Run { int y, x1, x2; };
+
+  // A limited number of bands are compared before being drawn so we
+  // don't keep the runs of the whole image in memory
+  const int bands = (bounds.h + kFillRowsPerJob - 1) / kFillRowsPerJob;
+  const int bandsPerBatch = 4*pool.concurrency();
+  std::vector<std::vector<Run>> runs(bandsPerBatch);
+
+  for (int first=0; first<bands; first+=bandsPerBatch) {
+    const int n = std::min(bandsPerBatch, bands-first);
+
+    pool.parallel_for(n, [&](int i) {
+      std::vector<Run>& bandRuns = runs[i];
+      const int y1 = bounds.y + (first+i)*kFillRowsPerJob;
+      const int y2 = std::min(y1+kFillRowsPerJob, bounds.y2());
+
+      bandRuns.clear();
+      for_each_run<ImageTraits>(
+        image, bounds, match, y1, y2,
+        [&bandRuns](int y, int x1, int x2) {
+          bandRuns.push_back(Run{ y, x1, x2 });
+        });
+    });
+
+    for (int i=0; i<n; ++i)
+      for (const Run& run : runs[i])
+        (*proc)(run.x1, run.y, run.x2, data);
+  }
+}
+
+template<typename ImageTraits>
+void floodfill_templ(const Image* image, const Mask* mask,
+                     int x, int y, const gfx::Rect& bounds,
+                     int tolerance, bool contiguous,
+                     void* data, AlgoHLine proc)
+{
+  const ColorMatch<ImageTraits> match(get_pixel_fast<ImageTraits>(image, x, y),
+                                      tolerance);
+  if (contiguous)
+    flood_contiguous<ImageTraits>(image, mask, x, y, bounds, match, data, proc);
+  else
+    replace_color<ImageTraits>(image, bounds, match, data, proc);
 }
 
-/* floodfill:
- *  Fills an enclosed area (starting at point x, y) with the specified color.
- */
+} // anonymous namespace
+
 void floodfill(const Image* image,
                const Mask* mask,
                int x, int y,
@@ -347,78 +427,26 @@ void floodfill(const Image* image,
                void* data,
                AlgoHLine proc)
 {
-  // Make sure we have a valid starting point
-  if ((x < 0) || (x >= image->width()) ||
-      (y < 0) || (y >= image->height()))
-    return;
-
-  // What color to replace?
-  color_t src_color = get_pixel(image, x, y);
+  const gfx::Rect rc = bounds & image->bounds();
 
-  // Non-contiguous case, we replace colors in the whole image.
-  if (!contiguous) {
-    switch (image->pixelFormat()) {
-      case IMAGE_RGB:
-        replace_color<RgbTraits>(image, bounds, src_color, tolerance, data, proc);
-        break;
-      case IMAGE_GRAYSCALE:
-        replace_color<GrayscaleTraits>(image, bounds, src_color, tolerance, data, proc);
-        break;
-      case IMAGE_INDEXED:
-        replace_color<IndexedTraits>(image, bounds, src_color, tolerance, data, proc);
-        break;
-    }
+  // Make sure we have a valid starting point
+  if (!rc.contains(gfx::Point(x, y)))
     return;
-  }
 
-  /* set up the list of flooded segments */
-  flood_buf.resize(image->height());
-  flood_count = image->height();
-  FLOODED_LINE* p = (FLOODED_LINE*)&flood_buf[0];
-  for (int c=0; c<flood_count; c++) {
-    p[c].flags = 0;
-    p[c].lpos = SHRT_MAX;
-    p[c].rpos = SHRT_MIN;
-    p[c].y = y;
-    p[c].next = 0;
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB:
+      floodfill_templ<RgbTraits>(image, mask, x, y, rc, tolerance, contiguous, data, proc);
+      break;
+    case IMAGE_GRAYSCALE:
+      floodfill_templ<GrayscaleTraits>(image, mask, x, y, rc, tolerance, contiguous, data, proc);
+      break;
+    case IMAGE_INDEXED:
+      floodfill_templ<IndexedTraits>(image, mask, x, y, rc, tolerance, contiguous, data, proc);
+      break;
+    case IMAGE_BITMAP:
+      floodfill_templ<BitmapTraits>(image, mask, x, y, rc, tolerance, contiguous, data, proc);
+      break;
   }
-
-  // Start up the flood algorithm
-  flooder(image, mask, x, y, bounds, src_color, tolerance, data, proc);
-
-  // Continue as long as there are some segments still to test
-  bool done;
-  do {
-    done = true;
-
-    // For each line on the screen
-    for (int c=0; c<flood_count; c++) {
-
-      p = FLOOD_LINE(c);
-
-      // Check below the segment?
-      if (p->flags & FLOOD_TODO_BELOW) {
-        p->flags &= ~FLOOD_TODO_BELOW;
-        if (check_flood_line(image, mask, p->y+1, p->lpos, p->rpos, bounds,
-            src_color, tolerance, data, proc)) {
-          done = false;
-          p = FLOOD_LINE(c);
-        }
-      }
-
-      // Check above the segment?
-      if (p->flags & FLOOD_TODO_ABOVE) {
-        p->flags &= ~FLOOD_TODO_ABOVE;
-        if (check_flood_line(image, mask, p->y-1, p->lpos, p->rpos, bounds,
-                             src_color, tolerance, data, proc)) {
-          done = false;
-          // Special case shortcut for going backwards
-          if ((c > bounds.y) && (c < bounds.y2()))
-            c -= 2;
-        }
-      }
-    }
-  } while (!done);
 }
 
 } // namespace algorithm
@@ -3,8 +3,6 @@
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
-//
-// TODO rewrite this algorithm from scratch
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -12,132 +10,102 @@
 
 #include "doc/algorithm/polygon.h"
 
-#include "gfx/point.h"
-
+#include <algorithm>
 #include <vector>
 
 namespace doc {
 
-using namespace gfx;
+// polygon() was an adaptation from Matthieu Haller code of GD
+// library (THANKS to Kirsten Schulz for the polygon fixes!). The
+// intersections are calculated in the same way, so the filled area
+// is the same, but now it uses an edge table sorted by the first
+// scanline of each edge (so each scanline only visits the edges that
+// cross it), and the overlapping spans are merged.
 
-// polygon() is an adaptation from Matthieu Haller code of GD library
+namespace {
 
-// THANKS to Kirsten Schulz for the polygon fixes!
+// Non-horizontal edge of the polygon (y1 < y2)
+struct Edge {
+  int x1, y1;
+  int x2, y2;
+};
 
-/* The intersection finding technique of this code could be improved  */
-/* by remembering the previous intertersection, and by using the slope. */
-/* That could help to adjust intersections  to produce a nice */
-/* interior_extrema. */
+} // anonymous namespace
 
 void algorithm::polygon(int vertices, const int* points, int pointStride, void* data, AlgoHLine proc)
 {
-  int n = vertices;
-  if (!n)
+  const int n = vertices;
+  if (n <= 0)
     return;
 
-  int i;
-  int j;
-  int index;
-  int y;
-  int miny, maxy;
-  int x1, y1;
-  int x2, y2;
-  int ind1, ind2;
-  int ints;
-
-  std::vector<int> polyInts(n);
-  std::vector<Point> p(n);
-  for (i = 0; (i < n); i++) {
-    p[i].x = points[i*pointStride];
-    p[i].y = points[i*pointStride+1];
-  }
+  std::vector<Edge> edges;
+  edges.reserve(n);
 
-  miny = p[0].y;
-  maxy = p[0].y;
-  for (i = 1; (i < n); i++) {
-    if (p[i].y < miny) miny = p[i].y;
-    if (p[i].y > maxy) maxy = p[i].y;
-  }
+  int miny = points[1];
+  int maxy = points[1];
+  for (int i=0; i<n; ++i) {
+    // Edge from the previous vertex to this one
+    const int* a = points + ((i+n-1) % n)*pointStride;
+    const int* b = points + i*pointStride;
 
-  /* 2.0.16: Optimization by Ilia Chipitsine -- don't waste time offscreen */
-  /* 2.0.26: clipping rectangle is even better */
-// if (miny < im->cy1) {
-//   miny = im->cy1;
-// }
-// if (maxy > im->cy2) {
-//   maxy = im->cy2;
-// }
-
-  /* Fix in 1.3: count a vertex only once */
-  for (y = miny; (y <= maxy); y++) {
-    /*1.4           int interLast = 0; */
-    /*              int dirLast = 0; */
-    /*              int interFirst = 1; */
-    /* 2.0.26+      int yshift = 0; */
-
-    ints = 0;
-    for (i = 0; (i < n); i++) {
-      if (!i) {
-        ind1 = n - 1;
-        ind2 = 0;
-      }
-      else {
-        ind1 = i - 1;
-        ind2 = i;
-      }
-      y1 = p[ind1].y;
-      y2 = p[ind2].y;
-      if (y1 < y2) {
-        x1 = p[ind1].x;
-        x2 = p[ind2].x;
-      }
-      else if (y1 > y2) {
-        y2 = p[ind1].y;
-        y1 = p[ind2].y;
-        x2 = p[ind1].x;
-        x1 = p[ind2].x;
-      }
-      else {
-        continue;
-      }
+    miny = std::min(miny, b[1]);
+    maxy = std::max(maxy, b[1]);
 
-      /* Do the following math as float intermediately, and round to ensure
-       * that Polygon and FilledPolygon for the same set of points have the
-       * same footprint. */
+    if (a[1] < b[1])
+      edges.push_back(Edge{ a[0], a[1], b[0], b[1] });
+    else if (a[1] > b[1])
+      edges.push_back(Edge{ b[0], b[1], a[0], a[1] });
+  }
 
-      if ((y >= y1) && (y < y2)) {
-        polyInts[ints++] = (int) ((float) ((y - y1) * (x2 - x1)) /
-                                  (float) (y2 - y1) + 0.5 + x1);
-      }
-      else if ((y == maxy) && (y > y1) && (y <= y2)) {
-        polyInts[ints++] = (int) ((float) ((y - y1) * (x2 - x1)) /
-                                  (float) (y2 - y1) + 0.5 + x1);
-      }
+  std::sort(edges.begin(), edges.end(),
+            [](const Edge& a, const Edge& b){ return a.y1 < b.y1; });
+
+  std::vector<const Edge*> active;
+  std::vector<int> ints;
+  std::size_t next = 0;
+
+  for (int y=miny; y<=maxy; ++y) {
+    // Add the edges that start in this scanline
+    for (; next < edges.size() && edges[next].y1 <= y; ++next)
+      active.push_back(&edges[next]);
+
+    // Remove the edges that end before this scanline. The last
+    // scanline of each edge is excluded (so a vertex is counted only
+    // once) except in the last scanline of the polygon.
+    active.erase(
+      std::remove_if(active.begin(), active.end(),
+                     [y, maxy](const Edge* e){
+                       return (e->y2 < y || (e->y2 == y && y != maxy));
+                     }),
+      active.end());
+
+    ints.clear();
+    for (const Edge* e : active) {
+      // Do the following math as float intermediately, and round to
+      // ensure that Polygon and FilledPolygon for the same set of
+      // points have the same footprint.
+      ints.push_back((int) ((float) ((y - e->y1) * (e->x2 - e->x1)) /
+                            (float) (e->y2 - e->y1) + 0.5 + e->x1));
     }
-    /*
-       2.0.26: polygons pretty much always have less than 100 points,
-       and most of the time they have considerably less. For such trivial
-       cases, insertion sort is a good choice. Also a good choice for
-       future implementations that may wish to indirect through a table.
-    */
-    for (i = 1; (i < ints); i++) {
-      index = polyInts[i];
-      j = i;
-      while ((j > 0) && (polyInts[j - 1] > index)) {
-        polyInts[j] = polyInts[j - 1];
-        j--;
+    std::sort(ints.begin(), ints.end());
+
+    // Each pair of intersections is a span, and the spans that
+    // overlap or touch each other are painted with one call.
+    bool span = false;
+    int spanX1 = 0, spanX2 = 0;
+    for (std::size_t i=0; i+1<ints.size(); i+=2) {
+      if (span && ints[i] <= spanX2+1) {
+        spanX2 = std::max(spanX2, ints[i+1]);
+        continue;
       }
-      polyInts[j] = index;
-    }
-    for (i = 0; (i < (ints)); i += 2) {
-#if 0
-      int minx = polyInts[i];
-      int maxx = polyInts[i + 1];
-#endif
-      /* 2.0.29: back to gdImageLine to prevent segfaults when
-         performing a pattern fill */
-      proc(polyInts[i], y, polyInts[i + 1], data);
+      if (span)
+        proc(spanX1, y, spanX2, data);
+      spanX1 = ints[i];
+      spanX2 = ints[i+1];
+      span = true;
     }
+    if (span)
+      proc(spanX1, y, spanX2, data);
   }
 }
 
@@ -12,6 +12,9 @@
 namespace doc {
   namespace algorithm {
 
+    // Fills the polygon calling "proc" for each span of each
+    // scanline (from top to bottom, left to right). The spans of the
+    // same scanline don't overlap or touch each other.
     void polygon(int vertices, const int* points, int pointStride, void* data, AlgoHLine proc);
 
     template<typename Container, typename Func>
@@ -10,40 +10,369 @@
 
 #include "doc/algorithm/resize_image.h"
 
+#include "base/pi.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/rotsprite.h"
 #include "doc/image_impl.h"
+#include "doc/image_spans.h"
 #include "doc/palette.h"
 #include "doc/primitives_fast.h"
 #include "doc/rgbmap.h"
 #include "gfx/point.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 namespace doc {
 namespace algorithm {
 
 template<typename ImageTraits>
 void resize_image_nearest(const Image* src, Image* dst)
+{
+  double x_ratio = double(src->width()) / double(dst->width());
+  double y_ratio = double(src->height()) / double(dst->height());
+
+  // Source column of each destination column
+  std::vector<int> srcCols(dst->width());
+  for (int x=0; x<dst->width(); ++x)
+    srcCols[x] = int(floor(x * x_ratio));
+
+  for (const auto& span : ImageSpans<ImageTraits>(dst)) {
+    auto srcRow = (typename ImageTraits::const_address_t)
+      src->getPixelAddress(0, int(floor(span.y * y_ratio)));
+    const int* srcCol = &srcCols[0];
+    for (auto dstIt=span.begin; dstIt!=span.end; ++dstIt, ++srcCol)
+      *dstIt = srcRow[*srcCol];
+  }
+}
+
+template<>
+void resize_image_nearest<BitmapTraits>(const Image* src, Image* dst)
 {
   double x_ratio = double(src->width()) / double(dst->width());
   double y_ratio = double(src->height()) / double(dst->height());
   double px, py;
 
-  LockImageBits<ImageTraits> dstBits(dst);
+  LockImageBits<BitmapTraits> dstBits(dst);
   auto dstIt = dstBits.begin();
 
   for (int y=0; y<dst->height(); ++y) {
     py = floor(y * y_ratio);
     for (int x=0; x<dst->width(); ++x, ++dstIt) {
       px = floor(x * x_ratio);
-      *dstIt = get_pixel_fast<ImageTraits>(src, px, py);
+      *dstIt = get_pixel_fast<BitmapTraits>(src, px, py);
     }
   }
 }
 
+namespace {
+
+// Fixed point precision of the filter weights (1.0 = 1 << kWeightBits)
+const int kWeightBits = 14;
+
+// Number of rows processed by each job of the thread pool
+const int kFilterRowsPerJob = 16;
+
+// Images with less pixels than this are resized in just one thread.
+const int kFilterParallelPixels = 256*256;
+
+double bicubic_kernel(double x)
+{
+  // Keys' cubic convolution with a = -0.5 (Catmull-Rom)
+  const double a = -0.5;
+  x = std::fabs(x);
+  if (x < 1.0)
+    return ((a+2.0)*x - (a+3.0))*x*x + 1.0;
+  else if (x < 2.0)
+    return ((a*x - 5.0*a)*x + 8.0*a)*x - 4.0*a;
+  else
+    return 0.0;
+}
+
+double sinc(double x)
+{
+  if (x == 0.0)
+    return 1.0;
+  x *= PI;
+  return std::sin(x) / x;
+}
+
+double lanczos3_kernel(double x)
+{
+  if (x > -3.0 && x < 3.0)
+    return sinc(x) * sinc(x/3.0);
+  else
+    return 0.0;
+}
+
+// Source pixels (and their weights) used to calculate each pixel of
+// a row (or column) of the destination image. All pixels use the
+// same number of taps ("count"), missing taps have a 0 weight.
+struct FilterTaps {
+  int count = 0;
+  std::vector<int> first;       // First source pixel of each destination pixel
+  std::vector<int> weights;     // "count" weights of each destination pixel
+
+  // Builds the taps from the weights of each destination pixel
+  // given by "contribs(i, first, weights)".
+  template<typename Contribs>
+  FilterTaps(int srcSize, int dstSize, Contribs contribs) {
+    std::vector<std::vector<double>> allWeights(dstSize);
+    first.resize(dstSize);
+    for (int i=0; i<dstSize; ++i) {
+      contribs(i, first[i], allWeights[i]);
+      count = std::max(count, int(allWeights[i].size()));
+    }
+    count = std::min(count, srcSize);
+
+    weights.resize(dstSize*count, 0);
+    for (int i=0; i<dstSize; ++i) {
+      const std::vector<double>& w = allWeights[i];
+      double sum = 0.0;
+      for (double v : w)
+        sum += v;
+      if (sum == 0.0)
+        sum = 1.0;
+
+      // Move the first tap so all taps are inside the source
+      const int offset = first[i] - std::min(first[i], srcSize - count);
+      first[i] -= offset;
+
+      int* dstWeights = &weights[i*count];
+      int total = 0, biggest = offset;
+      for (int j=0; j<int(w.size()); ++j) {
+        dstWeights[offset+j] = int(std::round(w[j] / sum * (1 << kWeightBits)));
+        total += dstWeights[offset+j];
+        if (dstWeights[offset+j] > dstWeights[biggest])
+          biggest = offset+j;
+      }
+      // Rounding errors go to the biggest weight, so a flat color
+      // keeps the same value.
+      dstWeights[biggest] += (1 << kWeightBits) - total;
+    }
+  }
+};
+
+// Bilinear interpolation between the two nearest source pixels,
+// with the first and last pixels of the source and destination
+// aligned (as the previous per-pixel version of the filter).
+FilterTaps bilinear_taps(int srcSize, int dstSize)
+{
+  const double delta = (dstSize > 1 ? (srcSize-1) / double(dstSize-1): 0.0);
+  return FilterTaps(
+    srcSize, dstSize,
+    [srcSize, delta](int i, int& first, std::vector<double>& weights) {
+      const double u = i * delta;
+      first = std::min(int(std::floor(u)), srcSize-1);
+      const double frac = u - first;
+      weights.push_back(1.0 - frac);
+      if (first < srcSize-1)
+        weights.push_back(frac);
+    });
+}
+
+// Convolution with the given "kernel" (with pixel centers aligned).
+// When the image is reduced the kernel is stretched to cover all the
+// source pixels (so there is no aliasing).
+FilterTaps convolution_taps(int srcSize, int dstSize,
+                            double (*kernel)(double), double support)
+{
+  const double scale = double(srcSize) / dstSize;
+  const double filterScale = std::max(scale, 1.0);
+  support *= filterScale;
+
+  return FilterTaps(
+    srcSize, dstSize,
+    [=](int i, int& first, std::vector<double>& weights) {
+      const double center = (i + 0.5) * scale;
+      const int x1 = std::max(int(std::floor(center - support + 0.5)), 0);
+      const int x2 = std::min(int(std::floor(center + support + 0.5)), srcSize);
+      first = x1;
+      for (int x=x1; x<x2; ++x)
+        weights.push_back(kernel((x - center + 0.5) / filterScale));
+      if (weights.empty()) {
+        first = std::min(int(center), srcSize-1);
+        weights.push_back(1.0);
+      }
+    });
+}
+
+inline uint8_t clamp_channel(int value)
+{
+  value >>= kWeightBits;
+  return uint8_t(std::min(std::max(value, 0), 255));
+}
+
+// Calls func(y1, y2) for bands of "rows" rows (in parallel when
+// there are enough pixels).
+template<typename Func>
+void for_each_row_band(int rows, int pixels, Func func)
+{
+  const int bands = (rows + kFilterRowsPerJob - 1) / kFilterRowsPerJob;
+  auto band = [&](int i) {
+    const int y1 = i*kFilterRowsPerJob;
+    func(y1, std::min(y1+kFilterRowsPerJob, rows));
+  };
+
+  if (pixels >= kFilterParallelPixels)
+    base::thread_pool::instance().parallel_for(bands, band);
+  else
+    for (int i=0; i<bands; ++i)
+      band(i);
+}
+
+// Separable resize filter: first each source row is resized
+// horizontally (to a temporary buffer with "channels" bytes per
+// pixel), and then the columns of the buffer are resized vertically.
+// "getRow(y, buf)" returns the bytes of the "y" source row (the
+// given buffer can be used to convert the pixels), and
+// "putRow(y, bytes)" stores a destination row.
+template<int channels, typename GetRow, typename PutRow>
+void resize_with_filter(int srcW, int srcH, int dstW, int dstH,
+                        const FilterTaps& xTaps, const FilterTaps& yTaps,
+                        GetRow getRow, PutRow putRow)
+{
+  const int rowBytes = dstW*channels;
+  std::vector<uint8_t> tmp(std::size_t(rowBytes)*srcH);
+
+  // Horizontal pass
+  for_each_row_band(
+    srcH, dstW*srcH,
+    [&](int y1, int y2) {
+      std::vector<uint8_t> buf;
+      for (int y=y1; y<y2; ++y) {
+        const uint8_t* srcRow = getRow(y, buf);
+        uint8_t* dstRow = &tmp[std::size_t(y)*rowBytes];
+        const int* w = &xTaps.weights[0];
+        for (int x=0; x<dstW; ++x, w+=xTaps.count) {
+          const uint8_t* src = srcRow + xTaps.first[x]*channels;
+          int acc[channels];
+          for (int c=0; c<channels; ++c)
+            acc[c] = 1 << (kWeightBits-1);
+          for (int t=0; t<xTaps.count; ++t, src+=channels)
+            for (int c=0; c<channels; ++c)
+              acc[c] += src[c] * w[t];
+          for (int c=0; c<channels; ++c)
+            *(dstRow++) = clamp_channel(acc[c]);
+        }
+      }
+    });
+
+  // Vertical pass, each row is accumulated from complete rows of the
+  // temporary buffer (contiguous loops that the compiler vectorizes)
+  for_each_row_band(
+    dstH, dstW*dstH,
+    [&](int y1, int y2) {
+      // Local copies (instead of captured references) so the
+      // compiler knows that they don't alias the accumulators
+      const int n = rowBytes;
+      std::vector<int> accBuf(n);
+      std::vector<uint8_t> dstBuf(n);
+      int* acc = &accBuf[0];
+      uint8_t* dstRow = &dstBuf[0];
+
+      for (int y=y1; y<y2; ++y) {
+        std::fill(acc, acc+n, 1 << (kWeightBits-1));
+        const int* w = &yTaps.weights[y*yTaps.count];
+        for (int t=0; t<yTaps.count; ++t) {
+          const uint8_t* tmpRow = &tmp[std::size_t(yTaps.first[y]+t)*n];
+          const int wt = w[t];
+          if (wt == 0)
+            continue;
+          for (int i=0; i<n; ++i)
+            acc[i] += tmpRow[i] * wt;
+        }
+        for (int i=0; i<n; ++i)
+          dstRow[i] = clamp_channel(acc[i]);
+        putRow(y, dstRow);
+      }
+    });
+}
+
+void resize_image_filter(const Image* src, Image* dst,
+                         const FilterTaps& xTaps, const FilterTaps& yTaps,
+                         const Palette* pal, const RgbMap* rgbmap, color_t maskColor)
+{
+  const int srcW = src->width();
+  const int srcH = src->height();
+  const int dstW = dst->width();
+  const int dstH = dst->height();
+
+  switch (src->pixelFormat()) {
+
+    // The bytes of each RGBA/gray+alpha pixel are filtered as
+    // independent channels.
+    case IMAGE_RGB:
+      resize_with_filter<RgbTraits::bytes_per_pixel>(
+        srcW, srcH, dstW, dstH, xTaps, yTaps,
+        [src](int y, std::vector<uint8_t>&) -> const uint8_t* {
+          return src->getPixelAddress(0, y);
+        },
+        [dst, dstW](int y, const uint8_t* bytes) {
+          std::copy(bytes, bytes+RgbTraits::getRowStrideBytes(dstW),
+                    dst->getPixelAddress(0, y));
+        });
+      break;
+
+    case IMAGE_GRAYSCALE:
+      resize_with_filter<GrayscaleTraits::bytes_per_pixel>(
+        srcW, srcH, dstW, dstH, xTaps, yTaps,
+        [src](int y, std::vector<uint8_t>&) -> const uint8_t* {
+          return src->getPixelAddress(0, y);
+        },
+        [dst, dstW](int y, const uint8_t* bytes) {
+          std::copy(bytes, bytes+GrayscaleTraits::getRowStrideBytes(dstW),
+                    dst->getPixelAddress(0, y));
+        });
+      break;
+
+    // Indexes are converted to RGBA values (through the palette),
+    // and the resized RGBA values are converted back to indexes with
+    // the RgbMap (in this thread, as the RgbMap calculates its
+    // entries when they are used for the first time).
+    case IMAGE_INDEXED: {
+      std::vector<color_t> colors(std::size_t(dstW)*dstH);
+      resize_with_filter<4>(
+        srcW, srcH, dstW, dstH, xTaps, yTaps,
+        [src, srcW, pal, maskColor](int y, std::vector<uint8_t>& buf) -> const uint8_t* {
+          buf.resize(srcW*4);
+          auto srcPtr = (IndexedTraits::const_address_t)src->getPixelAddress(0, y);
+          auto rgbaPtr = (color_t*)&buf[0];
+          for (int x=0; x<srcW; ++x, ++srcPtr, ++rgbaPtr) {
+            color_t c = pal->getEntry(*srcPtr);
+            if (*srcPtr == maskColor)
+              c &= rgba_rgb_mask; // Set alpha = 0
+            *rgbaPtr = c;
+          }
+          return &buf[0];
+        },
+        [&colors, dstW](int y, const uint8_t* bytes) {
+          std::copy(bytes, bytes+dstW*4, (uint8_t*)&colors[std::size_t(y)*dstW]);
+        });
+
+      const color_t* c = &colors[0];
+      for (const auto& span : ImageSpans<IndexedTraits>(dst)) {
+        for (auto it=span.begin; it!=span.end; ++it, ++c)
+          *it = rgbmap->mapColor(rgba_getr(*c), rgba_getg(*c),
+                                 rgba_getb(*c), rgba_geta(*c));
+      }
+      break;
+    }
+
+    // Bitmaps (masks) don't have intermediate values
+    case IMAGE_BITMAP:
+      resize_image_nearest<BitmapTraits>(src, dst);
+      break;
+  }
+}
+
+} // anonymous namespace
+
 void resize_image(const Image* src, Image* dst, ResizeMethod method, const Palette* pal, const RgbMap* rgbmap, color_t maskColor)
 {
   switch (method) {
 
-    // TODO optimize this
     case RESIZE_METHOD_NEAREST_NEIGHBOR: {
       ASSERT(src->pixelFormat() == dst->pixelFormat());
 
@@ -56,103 +385,29 @@ void resize_image(const Image* src, Image* dst, ResizeMethod method, const Palet
       break;
     }
 
-    // TODO optimize this
-    case RESIZE_METHOD_BILINEAR: {
-      uint32_t color[4], dst_color = 0;
-      double u, v, du, dv;
-      int u_floor, u_floor2;
-      int v_floor, v_floor2;
-      int x, y;
-
-      u = v = 0.0;
-      du = (src->width()-1) * 1.0 / (dst->width()-1);
-      dv = (src->height()-1) * 1.0 / (dst->height()-1);
-      for (y=0; y<dst->height(); ++y) {
-        for (x=0; x<dst->width(); ++x) {
-          u_floor = (int)floor(u);
-          v_floor = (int)floor(v);
-
-          if (u_floor > src->width()-1) {
-            u_floor = src->width()-1;
-            u_floor2 = src->width()-1;
-          }
-          else if (u_floor == src->width()-1)
-            u_floor2 = u_floor;
-          else
-            u_floor2 = u_floor+1;
-
-          if (v_floor > src->height()-1) {
-            v_floor = src->height()-1;
-            v_floor2 = src->height()-1;
-          }
-          else if (v_floor == src->height()-1)
-            v_floor2 = v_floor;
-          else
-            v_floor2 = v_floor+1;
-
-          // get the four colors
-          color[0] = src->getPixel(u_floor,  v_floor);
-          color[1] = src->getPixel(u_floor2, v_floor);
-          color[2] = src->getPixel(u_floor,  v_floor2);
-          color[3] = src->getPixel(u_floor2, v_floor2);
-
-          // calculate the interpolated color
-          double u1 = u - u_floor;
-          double v1 = v - v_floor;
-          double u2 = 1 - u1;
-          double v2 = 1 - v1;
-
-          switch (dst->pixelFormat()) {
-            case IMAGE_RGB: {
-              int r = int((rgba_getr(color[0])*u2 + rgba_getr(color[1])*u1)*v2 +
-                          (rgba_getr(color[2])*u2 + rgba_getr(color[3])*u1)*v1);
-              int g = int((rgba_getg(color[0])*u2 + rgba_getg(color[1])*u1)*v2 +
-                          (rgba_getg(color[2])*u2 + rgba_getg(color[3])*u1)*v1);
-              int b = int((rgba_getb(color[0])*u2 + rgba_getb(color[1])*u1)*v2 +
-                          (rgba_getb(color[2])*u2 + rgba_getb(color[3])*u1)*v1);
-              int a = int((rgba_geta(color[0])*u2 + rgba_geta(color[1])*u1)*v2 +
-                          (rgba_geta(color[2])*u2 + rgba_geta(color[3])*u1)*v1);
-              dst_color = rgba(r, g, b, a);
-              break;
-            }
-            case IMAGE_GRAYSCALE: {
-              int v = int((graya_getv(color[0])*u2 + graya_getv(color[1])*u1)*v2 +
-                          (graya_getv(color[2])*u2 + graya_getv(color[3])*u1)*v1);
-              int a = int((graya_geta(color[0])*u2 + graya_geta(color[1])*u1)*v2 +
-                          (graya_geta(color[2])*u2 + graya_geta(color[3])*u1)*v1);
-              dst_color = graya(v, a);
-              break;
-            }
-            case IMAGE_INDEXED: {
-              // Convert index to RGBA values
-              for (int i=0; i<4; ++i) {
-                if (color[i] == maskColor)
-                  color[i] = pal->getEntry(color[i]) & rgba_rgb_mask; // Set alpha = 0
-                else
-                  color[i] = pal->getEntry(color[i]);
-              }
+    case RESIZE_METHOD_BILINEAR:
+      ASSERT(src->pixelFormat() == dst->pixelFormat());
+      resize_image_filter(src, dst,
+                          bilinear_taps(src->width(), dst->width()),
+                          bilinear_taps(src->height(), dst->height()),
+                          pal, rgbmap, maskColor);
+      break;
 
-              int r = int((rgba_getr(color[0])*u2 + rgba_getr(color[1])*u1)*v2 +
-                          (rgba_getr(color[2])*u2 + rgba_getr(color[3])*u1)*v1);
-              int g = int((rgba_getg(color[0])*u2 + rgba_getg(color[1])*u1)*v2 +
-                          (rgba_getg(color[2])*u2 + rgba_getg(color[3])*u1)*v1);
-              int b = int((rgba_getb(color[0])*u2 + rgba_getb(color[1])*u1)*v2 +
-                          (rgba_getb(color[2])*u2 + rgba_getb(color[3])*u1)*v1);
-              int a = int((rgba_geta(color[0])*u2 + rgba_geta(color[1])*u1)*v2 +
-                          (rgba_geta(color[2])*u2 + rgba_geta(color[3])*u1)*v1);
-              dst_color = rgbmap->mapColor(r, g, b, a);
-              break;
-            }
-          }
+    case RESIZE_METHOD_BICUBIC:
+      ASSERT(src->pixelFormat() == dst->pixelFormat());
+      resize_image_filter(src, dst,
+                          convolution_taps(src->width(), dst->width(), bicubic_kernel, 2.0),
+                          convolution_taps(src->height(), dst->height(), bicubic_kernel, 2.0),
+                          pal, rgbmap, maskColor);
+      break;
 
-          dst->putPixel(x, y, dst_color);
-          u += du;
-        }
-        u = 0.0;
-        v += dv;
-      }
+    case RESIZE_METHOD_LANCZOS:
+      ASSERT(src->pixelFormat() == dst->pixelFormat());
+      resize_image_filter(src, dst,
+                          convolution_taps(src->width(), dst->width(), lanczos3_kernel, 3.0),
+                          convolution_taps(src->height(), dst->height(), lanczos3_kernel, 3.0),
+                          pal, rgbmap, maskColor);
       break;
-    }
 
     case RESIZE_METHOD_ROTSPRITE: {
       rotsprite_image(
@@ -175,11 +430,11 @@ void fixup_image_transparent_colors(Image* image)
 
     case IMAGE_RGB: {
       int r, g, b, count;
-      LockImageBits<RgbTraits> bits(image);
-      LockImageBits<RgbTraits>::iterator it = bits.begin();
 
-      for (y=0; y<image->height(); ++y) {
-        for (x=0; x<image->width(); ++x, ++it) {
+      for (const auto& span : ImageSpans<RgbTraits>(image)) {
+        y = span.y;
+        x = 0;
+        for (auto it=span.begin; it!=span.end; ++it, ++x) {
           uint32_t c = *it;
 
           // if this is a completelly-transparent pixel...
@@ -187,17 +442,15 @@ void fixup_image_transparent_colors(Image* image)
             count = 0;
             r = g = b = 0;
 
-            gfx::Rect area = gfx::Rect(x-1, y-1, 3, 3).createIntersection(image->bounds());
-            LockImageBits<RgbTraits>::iterator it2 = bits.begin_area(area);
-            LockImageBits<RgbTraits>::iterator end2 = bits.end_area(area);
-
-            for (; it2 != end2; ++it2) {
-              c = *it2;
-              if (rgba_geta(c) > 0) {
-                r += rgba_getr(c);
-                g += rgba_getg(c);
-                b += rgba_getb(c);
-                ++count;
+            for (const auto& area : ImageConstSpans<RgbTraits>(image, gfx::Rect(x-1, y-1, 3, 3))) {
+              for (auto it2=area.begin; it2!=area.end; ++it2) {
+                c = *it2;
+                if (rgba_geta(c) > 0) {
+                  r += rgba_getr(c);
+                  g += rgba_getg(c);
+                  b += rgba_getb(c);
+                  ++count;
+                }
               }
             }
 
@@ -215,11 +468,11 @@ void fixup_image_transparent_colors(Image* image)
 
     case IMAGE_GRAYSCALE: {
       int k, count;
-      LockImageBits<GrayscaleTraits> bits(image);
-      LockImageBits<GrayscaleTraits>::iterator it = bits.begin();
 
-      for (y=0; y<image->height(); ++y) {
-        for (x=0; x<image->width(); ++x, ++it) {
+      for (const auto& span : ImageSpans<GrayscaleTraits>(image)) {
+        y = span.y;
+        x = 0;
+        for (auto it=span.begin; it!=span.end; ++it, ++x) {
           uint16_t c = *it;
 
           // If this is a completelly-transparent pixel...
@@ -227,15 +480,13 @@ void fixup_image_transparent_colors(Image* image)
             count = 0;
             k = 0;
 
-            gfx::Rect area = gfx::Rect(x-1, y-1, 3, 3).createIntersection(image->bounds());
-            LockImageBits<GrayscaleTraits>::iterator it2 = bits.begin_area(area);
-            LockImageBits<GrayscaleTraits>::iterator end2 = bits.end_area(area);
-
-            for (; it2 != end2; ++it2) {
-              c = *it2;
-              if (graya_geta(c) > 0) {
-                k += graya_getv(c);
-                ++count;
+            for (const auto& area : ImageConstSpans<GrayscaleTraits>(image, gfx::Rect(x-1, y-1, 3, 3))) {
+              for (auto it2=area.begin; it2!=area.end; ++it2) {
+                c = *it2;
+                if (graya_geta(c) > 0) {
+                  k += graya_getv(c);
+                  ++count;
+                }
               }
             }
 
@@ -20,11 +20,18 @@ namespace doc {
       RESIZE_METHOD_NEAREST_NEIGHBOR,
       RESIZE_METHOD_BILINEAR,
       RESIZE_METHOD_ROTSPRITE,
+      RESIZE_METHOD_BICUBIC,
+      RESIZE_METHOD_LANCZOS,
     };
 
     // Resizes the source image 'src' to the destination image 'dst'.
+    // Bilinear, bicubic and Lanczos (3 lobes) methods are separable
+    // filters that resize big images in parallel. Indexed images are
+    // filtered in RGBA (with the 'palette') and converted back with
+    // the 'rgbmap', and bitmaps are resized with nearest neighbor.
     //
-    // Warning: If you are using the RESIZE_METHOD_BILINEAR, it is
+    // Warning: If you are using the RESIZE_METHOD_BILINEAR (or any
+    // of the other filters), it is
     // recommended to use 'fixup_image_transparent_colors' function
     // over the source image 'src' BEFORE using this routine.
     void resize_image(const Image* src, Image* dst, ResizeMethod method, const Palette* palette, const RgbMap* rgbmap,
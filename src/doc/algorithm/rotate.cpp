@@ -12,14 +12,18 @@
 #endif
 
 #include "base/pi.h"
+#include "base/thread_pool.h"
 #include "doc/blend_funcs.h"
 #include "doc/image_impl.h"
+#include "doc/image_spans.h"
 #include "doc/mask.h"
 #include "doc/primitives.h"
 #include "doc/primitives_fast.h"
 #include "fixmath/fixmath.h"
 
+#include <algorithm>
 #include <cmath>
+#include <type_traits>
 
 namespace doc {
 namespace algorithm {
@@ -39,11 +43,75 @@ static void ase_rotate_scale_flip_coordinates(
   int h_flip, int v_flip,
   fixed xs[4], fixed ys[4]);
 
+// Number of rows scaled by each job of the thread pool
+static const int kScaleRowsPerJob = 64;
+
+// Destination rectangles with less pixels than this are scaled in
+// just one thread.
+static const int kScaleParallelPixels = 256*256;
+
 template<typename ImageTraits, typename BlendFunc>
 static void image_scale_tpl(
   Image* dst, const Image* src,
   int dst_x, int dst_y, int dst_w, int dst_h,
   int src_x, int src_y, int src_w, int src_h, BlendFunc blend)
+{
+  const fixed first_x = itofix(src_x);
+  const fixed first_y = itofix(src_y);
+  const fixed dx = fixdiv(itofix(src_w-1), itofix(dst_w-1));
+  const fixed dy = fixdiv(itofix(src_h-1), itofix(dst_h-1));
+
+  const ImageSpans<ImageTraits> spans(dst, gfx::Rect(dst_x, dst_y, dst_w, dst_h));
+  const gfx::Rect& rc = spans.bounds();
+
+  // Rows are independent, the "v" row of the spans is scaled from
+  // the "first_y + v*dy" source row.
+  auto scaleRows = [&](int v1, int v2) {
+    for (int v=v1; v<v2; ++v) {
+      const auto span = spans.span(rc.y+v);
+      fixed x = first_x;
+      int old_x = fixtoi(x), new_x;
+
+      auto src_it = (typename ImageTraits::const_address_t)
+        src->getPixelAddress(src_x, fixtoi(first_y + v*dy));
+
+      for (auto dst_it=span.begin; dst_it!=span.end; ++dst_it) {
+        *dst_it = blend(*dst_it, *src_it);
+
+        x = fixadd(x, dx);
+        new_x = fixtoi(x);
+        if (old_x != new_x) {
+          // We don't want to move the "src_it" pointer outside the src
+          // image bounds.
+          if (new_x < src_w) {
+            src_it += (new_x - old_x);
+            old_x = new_x;
+          }
+          else
+            break;
+        }
+      }
+    }
+  };
+
+  if (rc.w*rc.h >= kScaleParallelPixels) {
+    base::thread_pool::instance().parallel_for(
+      (rc.h + kScaleRowsPerJob - 1) / kScaleRowsPerJob,
+      [&](int band) {
+        const int v = band*kScaleRowsPerJob;
+        scaleRows(v, std::min(v+kScaleRowsPerJob, rc.h));
+      });
+  }
+  else if (!rc.isEmpty())
+    scaleRows(0, rc.h);
+}
+
+// Generic version for bit-packed images (BitmapTraits)
+template<typename ImageTraits, typename BlendFunc>
+static void image_scale_bits_tpl(
+  Image* dst, const Image* src,
+  int dst_x, int dst_y, int dst_w, int dst_h,
+  int src_x, int src_y, int src_w, int src_h, BlendFunc blend)
 {
   LockImageBits<ImageTraits> dst_bits(dst, gfx::Rect(dst_x, dst_y, dst_w, dst_h));
   typename LockImageBits<ImageTraits>::iterator dst_it = dst_bits.begin();
@@ -95,7 +163,7 @@ class if_blender {
 public:
   if_blender(color_t mask) : m_mask(mask) {
   }
-  color_t operator()(color_t back, color_t front) {
+  color_t operator()(color_t back, color_t front) const {
     if (front != m_mask)
       return front;
     else
@@ -142,7 +210,7 @@ void scale_image(Image* dst, const Image* src,
       break;
 
     case IMAGE_BITMAP:
-      image_scale_tpl<BitmapTraits>(
+      image_scale_bits_tpl<BitmapTraits>(
         dst, src,
         dst_x, dst_y, dst_w, dst_h,
         src_x, src_y, src_w, src_h, if_blender(0));
@@ -190,25 +258,23 @@ void parallelogram(Image* bmp, const Image* sprite, const Image* mask,
 
 // Scanline drawers.
 
+// Bit-packed images (BitmapTraits) are drawn with an iterator.
 template<class Traits, class Delegate>
-static void draw_scanline(
+static void draw_scanline_bits(
   Image* bmp,
   const Image* spr,
   const Image* mask,
-  fixed l_bmp_x, int bmp_y_i,
-  fixed r_bmp_x,
+  int l_bmp_x, int bmp_y_i,
+  int r_bmp_x,
   fixed l_spr_x, fixed l_spr_y,
   fixed spr_dx, fixed spr_dy,
   Delegate& delegate)
 {
-  r_bmp_x >>= 16;
-  l_bmp_x >>= 16;
-
   delegate.lockBits(bmp, gfx::Rect(l_bmp_x, bmp_y_i, r_bmp_x - l_bmp_x + 1, 1));
 
   gfx::Rect maskBounds = (mask ? mask->bounds(): spr->bounds());
 
-  for (int x=(int)l_bmp_x; x<=(int)r_bmp_x; ++x) {
+  for (int x=l_bmp_x; x<=r_bmp_x; ++x) {
     int u = l_spr_x>>16;
     int v = l_spr_y>>16;
 
@@ -224,87 +290,144 @@ static void draw_scanline(
   delegate.unlockBits();
 }
 
-template<class Traits>
-class GenericDelegate {
-public:
-  void lockBits(Image* bmp, const gfx::Rect& bounds) {
-    m_bits = bmp->lockBits<Traits>(Image::ReadWriteLock, bounds);
-    m_it = m_bits.begin();
-    m_end = m_bits.end();
-  }
-
-  void unlockBits() {
-    m_bits.unlock();
+// Other images are drawn with a pointer to the destination scanline
+// and the row table of the source image. The source position of the
+// pixel "i" of the scanline is "l_spr + i*spr_d" (the same value
+// that is accumulated pixel by pixel), so without mask four pixels
+// are mapped per step with independent coordinates.
+template<class Traits, class Delegate>
+static void draw_scanline_pixels(
+  Image* bmp,
+  const Image* spr,
+  const Image* mask,
+  int l_bmp_x, int bmp_y_i,
+  int r_bmp_x,
+  fixed l_spr_x, fixed l_spr_y,
+  fixed spr_dx, fixed spr_dy,
+  Delegate& delegate)
+{
+  typedef typename Traits::address_t address_t;
+  typedef typename Traits::const_address_t const_address_t;
+
+  auto pixel = [spr](fixed u, fixed v) -> color_t {
+    return *((const_address_t)spr->getPixelAddress(u>>16, v>>16));
+  };
+
+  address_t dst = (address_t)bmp->getPixelAddress(l_bmp_x, bmp_y_i);
+  const int n = r_bmp_x - l_bmp_x + 1;
+  int i = 0;
+
+  if (mask) {
+    const gfx::Rect maskBounds = mask->bounds();
+    for (; i<n; ++i, l_spr_x+=spr_dx, l_spr_y+=spr_dy) {
+      const int u = l_spr_x>>16;
+      const int v = l_spr_y>>16;
+      if (maskBounds.contains(u, v) && get_pixel_fast<BitmapTraits>(mask, u, v))
+        delegate.put(dst+i, pixel(l_spr_x, l_spr_y));
+    }
+    return;
   }
 
-  void nextPixel() {
-    ASSERT(m_it != m_end);
-    ++m_it;
+  const fixed spr_dx4 = 4*spr_dx;
+  const fixed spr_dy4 = 4*spr_dy;
+  for (; i+4<=n; i+=4, l_spr_x+=spr_dx4, l_spr_y+=spr_dy4) {
+    const color_t c0 = pixel(l_spr_x, l_spr_y);
+    const color_t c1 = pixel(l_spr_x+spr_dx, l_spr_y+spr_dy);
+    const color_t c2 = pixel(l_spr_x+2*spr_dx, l_spr_y+2*spr_dy);
+    const color_t c3 = pixel(l_spr_x+3*spr_dx, l_spr_y+3*spr_dy);
+    delegate.put(dst+i, c0);
+    delegate.put(dst+i+1, c1);
+    delegate.put(dst+i+2, c2);
+    delegate.put(dst+i+3, c3);
   }
+  for (; i<n; ++i, l_spr_x+=spr_dx, l_spr_y+=spr_dy)
+    delegate.put(dst+i, pixel(l_spr_x, l_spr_y));
+}
 
-private:
-  ImageBits<Traits> m_bits;
+template<class Traits, class Delegate>
+static void draw_scanline(
+  Image* bmp,
+  const Image* spr,
+  const Image* mask,
+  fixed l_bmp_x, int bmp_y_i,
+  fixed r_bmp_x,
+  fixed l_spr_x, fixed l_spr_y,
+  fixed spr_dx, fixed spr_dy,
+  Delegate& delegate)
+{
+  r_bmp_x >>= 16;
+  l_bmp_x >>= 16;
 
-protected:
-  typename LockImageBits<Traits>::iterator m_it, m_end;
-};
+  if constexpr (std::is_same<Traits, BitmapTraits>::value)
+    draw_scanline_bits<Traits>(bmp, spr, mask, l_bmp_x, bmp_y_i, r_bmp_x,
+                               l_spr_x, l_spr_y, spr_dx, spr_dy, delegate);
+  else
+    draw_scanline_pixels<Traits>(bmp, spr, mask, l_bmp_x, bmp_y_i, r_bmp_x,
+                                 l_spr_x, l_spr_y, spr_dx, spr_dy, delegate);
+}
 
-class RgbDelegate : public GenericDelegate<RgbTraits> {
+class RgbDelegate {
 public:
   RgbDelegate(color_t mask_color) {
     m_mask_color = mask_color;
   }
 
-  void putPixel(const Image* spr, int spr_x, int spr_y) {
-    ASSERT(m_it != m_end);
-
-    int c = get_pixel_fast<RgbTraits>(spr, spr_x, spr_y);
+  void put(RgbTraits::address_t dst, color_t c) const {
     if ((rgba_geta(m_mask_color) == 0) || ((c & rgba_rgb_mask) != (m_mask_color & rgba_rgb_mask)))
-      *m_it = rgba_blender_normal(*m_it, c);
+      *dst = rgba_blender_normal(*dst, c);
   }
 
 private:
   color_t m_mask_color;
 };
 
-class GrayscaleDelegate : public GenericDelegate<GrayscaleTraits> {
+class GrayscaleDelegate {
 public:
   GrayscaleDelegate(color_t mask_color) {
     m_mask_color = mask_color;
   }
 
-  void putPixel(const Image* spr, int spr_x, int spr_y) {
-    ASSERT(m_it != m_end);
-
-    int c = get_pixel_fast<GrayscaleTraits>(spr, spr_x, spr_y);
+  void put(GrayscaleTraits::address_t dst, color_t c) const {
     if ((graya_geta(m_mask_color) == 0) || ((c & graya_v_mask) != (m_mask_color & graya_v_mask)))
-      *m_it = graya_blender_normal(*m_it, c, 255);
+      *dst = graya_blender_normal(*dst, c, 255);
   }
 
 private:
   color_t m_mask_color;
 };
 
-class IndexedDelegate : public GenericDelegate<IndexedTraits> {
+class IndexedDelegate {
 public:
   IndexedDelegate(color_t mask_color) :
     m_mask_color(mask_color) {
   }
 
-  void putPixel(const Image* spr, int spr_x, int spr_y) {
-    ASSERT(m_it != m_end);
-
-    color_t c = get_pixel_fast<IndexedTraits>(spr, spr_x, spr_y);
+  void put(IndexedTraits::address_t dst, color_t c) const {
     if (c != m_mask_color)
-      *m_it = c;
+      *dst = c;
   }
 
 private:
   color_t m_mask_color;
 };
 
-class BitmapDelegate : public GenericDelegate<BitmapTraits> {
+class BitmapDelegate {
 public:
+  void lockBits(Image* bmp, const gfx::Rect& bounds) {
+    m_bits = bmp->lockBits<BitmapTraits>(Image::ReadWriteLock, bounds);
+    m_it = m_bits.begin();
+    m_end = m_bits.end();
+  }
+
+  void unlockBits() {
+    m_bits.unlock();
+  }
+
+  void nextPixel() {
+    ASSERT(m_it != m_end);
+    ++m_it;
+  }
+
   void putPixel(const Image* spr, int spr_x, int spr_y) {
     ASSERT(m_it != m_end);
 
@@ -312,6 +435,10 @@ public:
     if (c != 0)                 // TODO
       *m_it = c;
   }
+
+private:
+  ImageBits<BitmapTraits> m_bits;
+  LockImageBits<BitmapTraits>::iterator m_it, m_end;
 };
 
 /* _parallelogram_map:
@@ -342,7 +469,8 @@ template<class Traits, class Delegate>
 static void ase_parallelogram_map(
   Image* bmp, const Image* spr, const Image* mask,
   fixed xs[4], fixed ys[4],
-  int sub_pixel_accuracy, Delegate delegate)
+  int sub_pixel_accuracy, Delegate delegate,
+  int band_top, int band_bottom)
 {
   /* Index in xs[] and ys[] to topmost point. */
   int top_index;
@@ -539,6 +667,10 @@ static void ase_parallelogram_map(
    */
 
   while (1) {
+    /* Scanlines after the band aren't drawn. */
+    if (bmp_y_i >= band_bottom)
+      break;
+
     /* Has beginning of scanline passed a corner? */
     if (bmp_y_i >= l_bmp_y_bottom_i) {
       /* Are we done? */
@@ -623,8 +755,9 @@ static void ase_parallelogram_map(
     if (r_bmp_x_rounded > clip_right)
       r_bmp_x_rounded = clip_right;
 
-    /* Draw! */
-    if (l_bmp_x_rounded <= r_bmp_x_rounded) {
+    /* Draw! (only the scanlines of the band, previous scanlines are
+       just walked to get the same edges than without bands) */
+    if (bmp_y_i >= band_top && l_bmp_x_rounded <= r_bmp_x_rounded) {
       if (!sub_pixel_accuracy) {
         /* The bodies of these ifs are only reached extremely seldom,
            it's an ugly hack to avoid reading outside the sprite when
@@ -738,12 +871,42 @@ static void ase_parallelogram_map(
   }
 }
 
+// Number of scanlines drawn by each job of the thread pool
+static const int kParallelogramRowsPerJob = 64;
+
+// Destination images with less pixels than this are drawn in just
+// one thread.
+static const int kParallelogramParallelPixels = 256*256;
+
 /* _parallelogram_map_standard:
  *  Helper function for calling _parallelogram_map() with the appropriate
  *  scanline drawer. I didn't want to include this in the
  *  _parallelogram_map() function since then you can bypass it and define
  *  your own scanline drawer, eg. for anti-aliased rotations.
+ *
+ *  Big destination images are drawn by bands of scanlines in parallel.
  */
+template<class Traits, class Delegate>
+static void ase_parallelogram_map_bands(
+  Image* bmp, const Image* sprite, const Image* mask,
+  fixed xs[4], fixed ys[4], const Delegate& delegate)
+{
+  const int h = bmp->height();
+  if (bmp->width()*h < kParallelogramParallelPixels) {
+    ase_parallelogram_map<Traits, Delegate>(bmp, sprite, mask, xs, ys, false, delegate, 0, h);
+    return;
+  }
+
+  base::thread_pool::instance().parallel_for(
+    (h + kParallelogramRowsPerJob - 1) / kParallelogramRowsPerJob,
+    [=, &delegate](int band) {
+      const int top = band*kParallelogramRowsPerJob;
+      ase_parallelogram_map<Traits, Delegate>(
+        bmp, sprite, mask, xs, ys, false, delegate,
+        top, std::min(top+kParallelogramRowsPerJob, h));
+    });
+}
+
 static void ase_parallelogram_map_standard(
   Image* bmp, const Image* sprite, const Image* mask,
   fixed xs[4], fixed ys[4])
@@ -752,25 +915,25 @@ static void ase_parallelogram_map_standard(
 
     case IMAGE_RGB: {
       RgbDelegate delegate(sprite->maskColor());
-      ase_parallelogram_map<RgbTraits, RgbDelegate>(bmp, sprite, mask, xs, ys, false, delegate);
+      ase_parallelogram_map_bands<RgbTraits>(bmp, sprite, mask, xs, ys, delegate);
       break;
     }
 
     case IMAGE_GRAYSCALE: {
       GrayscaleDelegate delegate(sprite->maskColor());
-      ase_parallelogram_map<GrayscaleTraits, GrayscaleDelegate>(bmp, sprite, mask, xs, ys, false, delegate);
+      ase_parallelogram_map_bands<GrayscaleTraits>(bmp, sprite, mask, xs, ys, delegate);
       break;
     }
 
     case IMAGE_INDEXED: {
       IndexedDelegate delegate(sprite->maskColor());
-      ase_parallelogram_map<IndexedTraits, IndexedDelegate>(bmp, sprite, mask, xs, ys, false, delegate);
+      ase_parallelogram_map_bands<IndexedTraits>(bmp, sprite, mask, xs, ys, delegate);
       break;
     }
 
     case IMAGE_BITMAP: {
       BitmapDelegate delegate;
-      ase_parallelogram_map<BitmapTraits, BitmapDelegate>(bmp, sprite, mask, xs, ys, false, delegate);
+      ase_parallelogram_map_bands<BitmapTraits>(bmp, sprite, mask, xs, ys, delegate);
       break;
     }
   }
@@ -8,127 +8,102 @@
 #include "config.h"
 #endif
 
+#include "doc/algorithm/rotsprite.h"
+
 #include "base/base.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/rotate.h"
+#include "doc/image_hash.h"
 #include "doc/image_impl.h"
 #include "doc/primitives.h"
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 
 namespace doc {
 namespace algorithm {
 
+namespace {
+
+// Number of source rows scaled by each job of the thread pool
+const int kScale2xRowsPerJob = 32;
+
+// Images with less pixels than this are scaled in just one thread.
+const int kScale2xParallelPixels = 128*128;
+
+// Scale factor of the intermediate images (three scale2x passes)
+const int kScale = 8;
+
+// The last source image (and mask) scaled with image_scale2x(), so
+// when RotSprite is used over and over again with the same image
+// (e.g. while the user drags a rotation handle) just the final
+// sampling is done. The source is compared pixel by pixel (against a
+// copy) because some temporary images are modified in place without
+// incrementing their version.
+struct ScaledImage {
+  std::unique_ptr<Image> source;
+  std::shared_ptr<const Image> scaled;
+};
+
+std::mutex g_cacheMutex;
+ScaledImage g_cachedSprite;
+ScaledImage g_cachedMask;
+
 // More information about EPX/Scale2x:
 // http://en.wikipedia.org/wiki/Pixel_art_scaling_algorithms#EPX.2FScale2.C3.97.2FAdvMAME2.C3.97
 // http://scale2x.sourceforge.net/algorithm.html
 // http://scale2x.sourceforge.net/scale2xandepx.html
 template<typename ImageTraits>
-static void image_scale2x_tpl(Image* dst, const Image* src, int src_w, int src_h)
+void image_scale2x_tpl(Image* dst, const Image* src, int src_w, int src_h, int y1, int y2)
 {
-#if 0      // TODO complete this implementation that should be faster
-           // than using a lot of get/put_pixel_fast calls.
-  int dst_w = src_w*2;
-  int dst_h = src_h*2;
+  typedef typename ImageTraits::address_t address_t;
+  typedef typename ImageTraits::const_address_t const_address_t;
+  typedef typename ImageTraits::pixel_t pixel_t;
 
-  LockImageBits<ImageTraits> dstBits(dst, Image::WriteLock, gfx::Rect(0, 0, dst_w, dst_h));
-  const LockImageBits<ImageTraits> srcBits(src);
-
-  LockImageBits<ImageTraits>::iterator dstRow0_it = dstBits.begin();
-  LockImageBits<ImageTraits>::iterator dstRow1_it = dstBits.begin();
-  LockImageBits<ImageTraits>::iterator dstRow0_end = dstBits.end();
-  LockImageBits<ImageTraits>::iterator dstRow1_end = dstBits.end();
-
-  // Iterators:
   //   A
   // C P B
   //   D
-  //
-  // These iterators are displaced through src image and are modified in this way:
-  //
-  // P: is the simplest one, we just start from (0, 0) to srcEnd.
-  // A: starts from row 0 (so A = P in the first row), then we start
-  //    again from the row 0.
-  // B: It starts from (1, row) and in the last pixel we don't moved it.
-  // C: It starts from (0, 0) and then it is moved with a delay.
-  // D: It starts from row 1 and continues until we reach the last
-  //    row, in that case we start D iterator again.
-  //
-  LockImageBits<ImageTraits>::const_iterator itP, itA, itB, itC, itD, savedD;
-  LockImageBits<ImageTraits>::const_iterator srcEnd = srcBits.end();
-  color_t P, A, B, C, D;
-
-  // Adjust iterators
-  itP = itA = itB = itC = itD = savedD = srcBits.begin();
-  dstRow1_it += dst_w;
-  itD += src->width();
-
-  for (int y=0; y<src_h; ++y) {
-    if (y == 1) itA = srcBits.begin();
-    if (y == src_h-2) savedD = itD;
-    if (y == src_h-1) itD = savedD;
-    ++itB;
+  pixel_t P, A, B, C, D;
+
+  for (int y=y1; y<y2; ++y) {
+    auto row = (const_address_t)src->getPixelAddress(0, y);
+    auto up = (y > 0 ? (const_address_t)src->getPixelAddress(0, y-1): row);
+    auto down = (y < src_h-1 ? (const_address_t)src->getPixelAddress(0, y+1): row);
+    auto dst0 = (address_t)dst->getPixelAddress(0, y*2);
+    auto dst1 = (address_t)dst->getPixelAddress(0, y*2+1);
 
     for (int x=0; x<src_w; ++x) {
-      ASSERT(itP != srcEnd);
-      ASSERT(itA != srcEnd);
-      ASSERT(itB != srcEnd);
-      ASSERT(itC != srcEnd);
-      ASSERT(itD != srcEnd);
-      ASSERT(dstRow0_it != dstRow0_end);
-      ASSERT(dstRow1_it != dstRow1_end);
-
-      P = *itP;
-      A = *itA;                 // y-1
-      B = *itB;                 // x+1
-      C = *itC;                 // x-1
-      D = *itD;                 // y+1
-
-      *dstRow0_it = (C == A && C != D && A != B ? A: P);
-      ++dstRow0_it;
-      *dstRow0_it = (A == B && A != C && B != D ? B: P);
-      ++dstRow0_it;
-
-      *dstRow1_it = (D == C && D != B && C != A ? C: P);
-      ++dstRow1_it;
-      *dstRow1_it = (B == D && B != A && D != C ? D: P);
-      ++dstRow1_it;
-
-      ++itP;
-      ++itA;
-      if (x < src_w-2) ++itB;
-      if (x > 0) ++itC;
-      ++itD;
+      P = row[x];
+      A = up[x];
+      B = (x < src_w-1 ? row[x+1]: P);
+      C = (x > 0 ? row[x-1]: P);
+      D = down[x];
+
+      *dst0++ = (C == A && C != D && A != B ? A: P);
+      *dst0++ = (A == B && A != C && B != D ? B: P);
+      *dst1++ = (D == C && D != B && C != A ? C: P);
+      *dst1++ = (B == D && B != A && D != C ? D: P);
     }
-
-    // Adjust iterators for the next two rows.
-    ++itB;
-    ++itC;
-    dstRow0_it += dst_w;
-    if (y < src_h-1)
-      dstRow1_it += dst_w;
   }
+}
 
-  // ASSERT(itP == srcEnd);
-  // ASSERT(itA == srcEnd);
-  // ASSERT(itB == srcEnd);
-  // ASSERT(itC == srcEnd);
-  // ASSERT(itD == srcEnd);
-  ASSERT(dstRow0_it == dstRow0_end);
-  ASSERT(dstRow1_it == dstRow1_end);
-#else
-
+// Generic version for bit-packed images (BitmapTraits)
+template<typename ImageTraits>
+void image_scale2x_bits_tpl(Image* dst, const Image* src, int src_w, int src_h, int y1, int y2)
+{
 #define A c[0]
 #define B c[1]
 #define C c[2]
 #define D c[3]
 #define P c[4]
 
-  LockImageBits<ImageTraits> dstBits(dst, gfx::Rect(0, 0, src_w*2, src_h*2));
+  LockImageBits<ImageTraits> dstBits(dst, gfx::Rect(0, y1*2, src_w*2, (y2-y1)*2));
   auto dstIt = dstBits.begin();
   auto dstIt2 = dstIt;
 
   color_t c[5];
-  for (int y=0; y<src_h; ++y) {
+  for (int y=y1; y<y2; ++y) {
     dstIt2 += src_w*2;
     for (int x=0; x<src_w; ++x) {
       P = get_pixel_fast<ImageTraits>(src, x, y);
@@ -150,29 +125,94 @@ static void image_scale2x_tpl(Image* dst, const Image* src, int src_w, int src_h
     dstIt += src_w*2;
   }
 
-#endif
+#undef A
+#undef B
+#undef C
+#undef D
+#undef P
 }
 
-static void image_scale2x(Image* dst, const Image* src, int src_w, int src_h)
+void image_scale2x_rows(Image* dst, const Image* src, int src_w, int src_h, int y1, int y2)
 {
   switch (src->pixelFormat()) {
-    case IMAGE_RGB:       image_scale2x_tpl<RgbTraits>(dst, src, src_w, src_h); break;
-    case IMAGE_GRAYSCALE: image_scale2x_tpl<GrayscaleTraits>(dst, src, src_w, src_h); break;
-    case IMAGE_INDEXED:   image_scale2x_tpl<IndexedTraits>(dst, src, src_w, src_h); break;
-    case IMAGE_BITMAP:    image_scale2x_tpl<BitmapTraits>(dst, src, src_w, src_h); break;
+    case IMAGE_RGB:       image_scale2x_tpl<RgbTraits>(dst, src, src_w, src_h, y1, y2); break;
+    case IMAGE_GRAYSCALE: image_scale2x_tpl<GrayscaleTraits>(dst, src, src_w, src_h, y1, y2); break;
+    case IMAGE_INDEXED:   image_scale2x_tpl<IndexedTraits>(dst, src, src_w, src_h, y1, y2); break;
+    case IMAGE_BITMAP:    image_scale2x_bits_tpl<BitmapTraits>(dst, src, src_w, src_h, y1, y2); break;
+  }
+}
+
+// Each source row is scaled to two destination rows, so bands of
+// rows can be scaled in parallel.
+void image_scale2x(Image* dst, const Image* src, int src_w, int src_h)
+{
+  if (src_w*src_h < kScale2xParallelPixels) {
+    image_scale2x_rows(dst, src, src_w, src_h, 0, src_h);
+    return;
+  }
+
+  base::thread_pool::instance().parallel_for(
+    (src_h + kScale2xRowsPerJob - 1) / kScale2xRowsPerJob,
+    [=](int band) {
+      const int y1 = band*kScale2xRowsPerJob;
+      image_scale2x_rows(dst, src, src_w, src_h,
+                         y1, std::min(y1+kScale2xRowsPerJob, src_h));
+    });
+}
+
+// Returns the sprite scaled "kScale" times with three scale2x passes.
+std::shared_ptr<const Image> scale_sprite(const Image* spr)
+{
+  std::shared_ptr<Image> a(Image::create(spr->pixelFormat(), spr->width()*kScale, spr->height()*kScale));
+  std::shared_ptr<Image> b(Image::create(spr->pixelFormat(), spr->width()*kScale, spr->height()*kScale));
+  a->setMaskColor(spr->maskColor());
+  b->setMaskColor(spr->maskColor());
+  a->copy(spr, gfx::Clip(spr->bounds()));
+
+  // Each pass reads the result of the previous one
+  for (int i=0; i<3; ++i) {
+    image_scale2x(b.get(), a.get(), spr->width()*(1<<i), spr->height()*(1<<i));
+    std::swap(a, b);
   }
+  return a;
 }
 
+std::shared_ptr<const Image> scale_mask(const Image* mask)
+{
+  std::shared_ptr<Image> msk(Image::create(IMAGE_BITMAP, mask->width()*kScale, mask->height()*kScale));
+  clear_image(msk.get(), 0);
+  scale_image(msk.get(), mask,
+              0, 0, msk->width(), msk->height(),
+              0, 0, mask->width(), mask->height());
+  return msk;
+}
+
+template<typename ScaleFunc>
+std::shared_ptr<const Image> get_scaled_image(ScaledImage& cache,
+                                              const Image* image,
+                                              ScaleFunc scale)
+{
+  {
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    if (cache.source && is_same_image(cache.source.get(), image))
+      return cache.scaled;
+  }
+
+  std::shared_ptr<const Image> scaled = scale(image);
+  std::unique_ptr<Image> source(Image::createCopy(image));
+
+  std::lock_guard<std::mutex> lock(g_cacheMutex);
+  cache.source = std::move(source);
+  cache.scaled = scaled;
+  return scaled;
+}
+
+} // anonymous namespace
+
 void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
   int x1, int y1, int x2, int y2,
   int x3, int y3, int x4, int y4)
 {
-  static ImageBufferPtr buf[3]; // TODO non-thread safe
-
-  for (int i=0; i<3; ++i)
-    if (!buf[i])
-      buf[i].reset(new ImageBuffer(1));
-
   int xmin = MIN(x1, MIN(x2, MIN(x3, x4)));
   int xmax = MAX(x1, MAX(x2, MAX(x3, x4)));
   int ymin = MIN(y1, MIN(y2, MIN(y3, y4)));
@@ -183,35 +223,15 @@ void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
   if (rot_width == 0 || rot_height == 0)
     return;
 
-  int scale = 8;
-  std::unique_ptr<Image> bmp_copy(Image::create(bmp->pixelFormat(), rot_width*scale, rot_height*scale, buf[0]));
-  std::unique_ptr<Image> tmp_copy(Image::create(spr->pixelFormat(), spr->width()*scale, spr->height()*scale, buf[1]));
-  std::unique_ptr<Image> spr_copy(Image::create(spr->pixelFormat(), spr->width()*scale, spr->height()*scale, buf[2]));
-  std::unique_ptr<Image> msk_copy;
+  int scale = kScale;
+  std::shared_ptr<const Image> spr_copy = get_scaled_image(g_cachedSprite, spr, scale_sprite);
+  std::shared_ptr<const Image> msk_copy;
+  if (mask)
+    msk_copy = get_scaled_image(g_cachedMask, mask, scale_mask);
 
   color_t maskColor = spr->maskColor();
-
+  std::unique_ptr<Image> bmp_copy(Image::create(bmp->pixelFormat(), rot_width*scale, rot_height*scale));
   bmp_copy->setMaskColor(maskColor);
-  tmp_copy->setMaskColor(maskColor);
-  spr_copy->setMaskColor(maskColor);
-
-  spr_copy->clear(maskColor);
-  spr_copy->copy(spr, gfx::Clip(spr->bounds()));
-
-  for (int i=0; i<3; ++i) {
-    // clear_image(tmp_copy, maskColor);
-    image_scale2x(tmp_copy.get(), spr_copy.get(), spr->width()*(1<<i), spr->height()*(1<<i));
-    spr_copy->copy(tmp_copy.get(), gfx::Clip(tmp_copy->bounds()));
-  }
-
-  if (mask) {
-    // Same ImageBuffer than tmp_copy
-    msk_copy.reset(Image::create(IMAGE_BITMAP, mask->width()*scale, mask->height()*scale, buf[1]));
-    clear_image(msk_copy.get(), 0);
-    scale_image(msk_copy.get(), mask,
-                0, 0, msk_copy->width(), msk_copy->height(),
-                0, 0, mask->width(), mask->height());
-  }
 
   clear_image(bmp_copy.get(), maskColor);
   scale_image(bmp_copy.get(), bmp,
@@ -228,5 +248,12 @@ void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
               0, 0, bmp_copy->width(), bmp_copy->height());
 }
 
+void clear_rotsprite_cache()
+{
+  std::lock_guard<std::mutex> lock(g_cacheMutex);
+  g_cachedSprite = ScaledImage();
+  g_cachedMask = ScaledImage();
+}
+
 } // namespace algorithm
 } // namespace doc
@@ -15,5 +15,10 @@ namespace doc {
       int x1, int y1, int x2, int y2,
       int x3, int y3, int x4, int y4);
 
+    // The scaled version of the last image rotated with
+    // rotsprite_image() is kept to rotate it again faster, this
+    // function frees it.
+    void clear_rotsprite_cache();
+
   } // namespace algorithm
 } // namespace doc
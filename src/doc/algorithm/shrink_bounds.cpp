@@ -14,35 +14,17 @@
 #include "doc/image_impl.h"
 #include "doc/primitives_fast.h"
 
+#include <algorithm>
+
 namespace doc {
 namespace algorithm {
 
 namespace {
 
+// Generic pixel by pixel versions for bit-packed images (the other
+// formats are processed with spans, see shrink_rows() below).
 template<typename ImageTraits>
-bool is_same_pixel(color_t pixel1, color_t pixel2)
-{
-  static_assert(false && sizeof(ImageTraits), "No is_same_pixel impl");
-  return false;
-}
-
-template<>
-bool is_same_pixel<RgbTraits>(color_t pixel1, color_t pixel2)
-{
-  return (rgba_geta(pixel1) == 0 && rgba_geta(pixel2) == 0) || (pixel1 == pixel2);
-}
-
-template<>
-bool is_same_pixel<GrayscaleTraits>(color_t pixel1, color_t pixel2)
-{
-  return (graya_geta(pixel1) == 0 && graya_geta(pixel2) == 0) || (pixel1 == pixel2);
-}
-
-template<>
-bool is_same_pixel<IndexedTraits>(color_t pixel1, color_t pixel2)
-{
-  return pixel1 == pixel2;
-}
+bool is_same_pixel(color_t pixel1, color_t pixel2);
 
 template<>
 bool is_same_pixel<BitmapTraits>(color_t pixel1, color_t pixel2)
@@ -192,6 +174,145 @@ bool shrink_bounds_templ2(const Image* a, const Image* b, gfx::Rect& bounds)
   return (!bounds.isEmpty());
 }
 
+// Pixels are compared in chunks without branches (so the compiler
+// can vectorize the loops) and the result of each chunk is checked
+// once.
+const int kChunkSize = 16;
+
+// Compares the pixels of a row with a reference pixel, a pixel is
+// different when ((pixel & mask) ^ value) != 0.
+template<typename T>
+struct RefPixelRow {
+  const T* pixels;
+  T mask;
+  T value;
+  T diff(int i) const { return (pixels[i] & mask) ^ value; }
+};
+
+// Compares the pixels of the same row in two images.
+template<typename T>
+struct TwoImagesRow {
+  const T* a;
+  const T* b;
+  T diff(int i) const { return a[i] ^ b[i]; }
+};
+
+// Returns the index of the first different pixel in [from, to) or
+// "to" if all are equal.
+template<typename Row>
+int first_diff(const Row& row, int from, int to)
+{
+  int i = from;
+  for (; i+kChunkSize <= to; i += kChunkSize) {
+    auto d = row.diff(i);
+    for (int j=1; j<kChunkSize; ++j)
+      d |= row.diff(i+j);
+    if (d)
+      break;
+  }
+  for (; i<to; ++i)
+    if (row.diff(i))
+      return i;
+  return to;
+}
+
+// Returns the index of the last different pixel in [from, to) or
+// "from-1" if all are equal.
+template<typename Row>
+int last_diff(const Row& row, int from, int to)
+{
+  int i = to;
+  for (; i-kChunkSize >= from; i -= kChunkSize) {
+    auto d = row.diff(i-kChunkSize);
+    for (int j=1; j<kChunkSize; ++j)
+      d |= row.diff(i-kChunkSize+j);
+    if (d)
+      break;
+  }
+  for (--i; i>=from; --i)
+    if (row.diff(i))
+      return i;
+  return from-1;
+}
+
+// Shrinks the given bounds checking the rows from top to bottom
+// (instead of column by column, which gives a cache miss for each
+// pixel). "getRow(y)" returns the Row to compare the pixels of the
+// row "y" from bounds.x.
+template<typename GetRow>
+bool shrink_rows(gfx::Rect& bounds, GetRow getRow)
+{
+  const int w = bounds.w;
+  int y1 = bounds.y;
+  int y2 = bounds.y2()-1;
+
+  while (y1 <= y2 && first_diff(getRow(y1), 0, w) == w)
+    ++y1;
+  if (y1 > y2) {
+    bounds.h = 0;
+    return false;
+  }
+  while (first_diff(getRow(y2), 0, w) == w)
+    --y2;
+
+  // Only the pixels outside the current [x1, x2] range must be
+  // checked in each row.
+  int x1 = w;
+  int x2 = -1;
+  for (int y=y1; y<=y2; ++y) {
+    auto row = getRow(y);
+    if (x1 > 0)
+      x1 = first_diff(row, 0, x1);
+    if (x2 < w-1)
+      x2 = std::max(x2, last_diff(row, std::max(x2+1, x1), w));
+    if (x1 == 0 && x2 == w-1)
+      break;
+  }
+
+  bounds = gfx::Rect(bounds.x+x1, y1, x2-x1+1, y2-y1+1);
+  return (!bounds.isEmpty());
+}
+
+template<typename ImageTraits>
+bool shrink_bounds_spans(const Image* image, gfx::Rect& bounds,
+                         color_t refpixel,
+                         typename ImageTraits::pixel_t alphaMask)
+{
+  typedef typename ImageTraits::pixel_t pixel_t;
+  RefPixelRow<pixel_t> row;
+  // Transparent pixels are equal to a transparent reference pixel
+  // (only the alpha is compared)
+  if (alphaMask && (refpixel & alphaMask) == 0) {
+    row.mask = alphaMask;
+    row.value = 0;
+  }
+  else {
+    row.mask = pixel_t(~pixel_t(0));
+    row.value = pixel_t(refpixel);
+  }
+
+  return shrink_rows(
+    bounds,
+    [image, &bounds, row](int y) mutable {
+      row.pixels = (const pixel_t*)image->getPixelAddress(bounds.x, y);
+      return row;
+    });
+}
+
+template<typename ImageTraits>
+bool shrink_bounds_spans2(const Image* a, const Image* b, gfx::Rect& bounds)
+{
+  typedef typename ImageTraits::pixel_t pixel_t;
+  return shrink_rows(
+    bounds,
+    [a, b, &bounds](int y) {
+      TwoImagesRow<pixel_t> row;
+      row.a = (const pixel_t*)a->getPixelAddress(bounds.x, y);
+      row.b = (const pixel_t*)b->getPixelAddress(bounds.x, y);
+      return row;
+    });
+}
+
 }
 
 bool shrink_bounds(const Image* image,
@@ -201,9 +322,9 @@ bool shrink_bounds(const Image* image,
 {
   bounds = (start_bounds & image->bounds());
   switch (image->pixelFormat()) {
-    case IMAGE_RGB:       return shrink_bounds_templ<RgbTraits>(image, bounds, refpixel);
-    case IMAGE_GRAYSCALE: return shrink_bounds_templ<GrayscaleTraits>(image, bounds, refpixel);
-    case IMAGE_INDEXED:   return shrink_bounds_templ<IndexedTraits>(image, bounds, refpixel);
+    case IMAGE_RGB:       return shrink_bounds_spans<RgbTraits>(image, bounds, refpixel, rgba_a_mask);
+    case IMAGE_GRAYSCALE: return shrink_bounds_spans<GrayscaleTraits>(image, bounds, refpixel, graya_a_mask);
+    case IMAGE_INDEXED:   return shrink_bounds_spans<IndexedTraits>(image, bounds, refpixel, 0);
     case IMAGE_BITMAP:    return shrink_bounds_templ<BitmapTraits>(image, bounds, refpixel);
   }
   ASSERT(false);
@@ -225,9 +346,9 @@ bool shrink_bounds2(const Image* a, const Image* b,
   bounds = (start_bounds & a->bounds());
 
   switch (a->pixelFormat()) {
-    case IMAGE_RGB:       return shrink_bounds_templ2<RgbTraits>(a, b, bounds);
-    case IMAGE_GRAYSCALE: return shrink_bounds_templ2<GrayscaleTraits>(a, b, bounds);
-    case IMAGE_INDEXED:   return shrink_bounds_templ2<IndexedTraits>(a, b, bounds);
+    case IMAGE_RGB:       return shrink_bounds_spans2<RgbTraits>(a, b, bounds);
+    case IMAGE_GRAYSCALE: return shrink_bounds_spans2<GrayscaleTraits>(a, b, bounds);
+    case IMAGE_INDEXED:   return shrink_bounds_spans2<IndexedTraits>(a, b, bounds);
     case IMAGE_BITMAP:    return shrink_bounds_templ2<BitmapTraits>(a, b, bounds);
   }
   ASSERT(false);
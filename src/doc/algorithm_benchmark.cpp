@@ -0,0 +1,125 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "tests/benchmark.h"
+
+#include "doc/algorithm/flip_image.h"
+#include "doc/algorithm/floodfill.h"
+#include "doc/algorithm/resize_image.h"
+#include "doc/algorithm/rotate.h"
+#include "doc/algorithm/shrink_bounds.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <memory>
+#include <random>
+
+using namespace doc;
+using namespace doc::algorithm;
+
+namespace {
+
+const int kSize = 512;
+
+// Random opaque pixels with a transparent border (so shrink_bounds()
+// has something to remove).
+Image* create_image(PixelFormat format, int w, int h)
+{
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> dist(0, 255);
+  Image* image = Image::create(format, w, h);
+  clear_image(image, 0);
+  for (int y=h/8; y<h-h/8; ++y)
+    for (int x=w/8; x<w-w/8; ++x)
+      put_pixel(image, x, y,
+                (format == IMAGE_RGB ?
+                 rgba(dist(rng), dist(rng), dist(rng), 255): dist(rng)));
+  return image;
+}
+
+void count_hline(int x1, int y, int x2, void* data)
+{
+  *((int*)data) += x2-x1+1;
+}
+
+} // anonymous namespace
+
+BENCHMARK(Algorithm, FlipHorizontal) {
+  std::unique_ptr<Image> image(create_image(IMAGE_RGB, kSize, kSize));
+  state.run([&]{
+      flip_image(image.get(), image->bounds(), FlipHorizontal);
+    });
+}
+
+BENCHMARK(Algorithm, FlipVertical) {
+  std::unique_ptr<Image> image(create_image(IMAGE_RGB, kSize, kSize));
+  state.run([&]{
+      flip_image(image.get(), image->bounds(), FlipVertical);
+    });
+}
+
+BENCHMARK(Algorithm, ResizeNearest2x) {
+  std::unique_ptr<Image> src(create_image(IMAGE_RGB, kSize/2, kSize/2));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, kSize, kSize));
+  state.run([&]{
+      resize_image(src.get(), dst.get(), RESIZE_METHOD_NEAREST_NEIGHBOR,
+                   nullptr, nullptr, 0);
+    });
+}
+
+BENCHMARK(Algorithm, ResizeBilinear2x) {
+  std::unique_ptr<Image> src(create_image(IMAGE_RGB, kSize/2, kSize/2));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, kSize, kSize));
+  state.run([&]{
+      resize_image(src.get(), dst.get(), RESIZE_METHOD_BILINEAR,
+                   nullptr, nullptr, 0);
+    });
+}
+
+BENCHMARK(Algorithm, ResizeLanczosHalf) {
+  std::unique_ptr<Image> src(create_image(IMAGE_RGB, kSize, kSize));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, kSize/2, kSize/2));
+  state.run([&]{
+      resize_image(src.get(), dst.get(), RESIZE_METHOD_LANCZOS,
+                   nullptr, nullptr, 0);
+    });
+}
+
+BENCHMARK(Algorithm, Rotate30) {
+  std::unique_ptr<Image> src(create_image(IMAGE_RGB, kSize/2, kSize/2));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, kSize, kSize));
+  state.run([&]{
+      clear_image(dst.get(), 0);
+      rotate_image(dst.get(), src.get(),
+                   kSize/4, kSize/4, kSize/2, kSize/2,
+                   kSize/2, kSize/2, 30.0);
+    });
+}
+
+BENCHMARK(Algorithm, ShrinkBounds) {
+  std::unique_ptr<Image> image(create_image(IMAGE_RGB, kSize, kSize));
+  state.run([&]{
+      gfx::Rect bounds;
+      bool res = shrink_bounds(image.get(), bounds, 0);
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(Algorithm, FloodfillIndexed) {
+  std::unique_ptr<Image> image(Image::create(IMAGE_INDEXED, kSize, kSize));
+  clear_image(image.get(), 0);
+  // A grid of lines, so the fill has to turn around a lot
+  for (int i=8; i<kSize; i+=16) {
+    draw_hline(image.get(), 0, i, kSize-16, 1);
+    draw_vline(image.get(), i, 16, kSize-1, 1);
+  }
+  state.run([&]{
+      int pixels = 0;
+      floodfill(image.get(), nullptr, 0, 0, image->bounds(),
+                0, true, &pixels, count_hline);
+      benchmark::do_not_optimize(pixels);
+    });
+}
@@ -0,0 +1,80 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "tests/benchmark.h"
+
+#include "doc/blend_funcs.h"
+#include "doc/blend_mode.h"
+#include "doc/color.h"
+
+#include <random>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+// 64K pixels with random colors and alpha values
+struct Pixels {
+  std::vector<color_t> backdrop;
+  std::vector<color_t> src;
+
+  Pixels(bool gray) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (int i=0; i<65536; ++i) {
+      if (gray) {
+        backdrop.push_back(graya(dist(rng), dist(rng)));
+        src.push_back(graya(dist(rng), dist(rng)));
+      }
+      else {
+        backdrop.push_back(rgba(dist(rng), dist(rng), dist(rng), dist(rng)));
+        src.push_back(rgba(dist(rng), dist(rng), dist(rng), dist(rng)));
+      }
+    }
+  }
+};
+
+void run_blender(benchmark::State& state, BlendFunc blender, bool gray)
+{
+  const Pixels pixels(gray);
+  std::vector<color_t> dst(pixels.src.size());
+  state.run([&]{
+      for (std::size_t i=0; i<dst.size(); ++i)
+        dst[i] = blender(pixels.backdrop[i], pixels.src[i], 200);
+      benchmark::do_not_optimize(dst);
+    });
+}
+
+} // anonymous namespace
+
+BENCHMARK(BlendFuncs, RgbaNormal64K) {
+  run_blender(state, get_rgba_blender(BlendMode::NORMAL), false);
+}
+
+BENCHMARK(BlendFuncs, RgbaMultiply64K) {
+  run_blender(state, get_rgba_blender(BlendMode::MULTIPLY), false);
+}
+
+BENCHMARK(BlendFuncs, RgbaOverlay64K) {
+  run_blender(state, get_rgba_blender(BlendMode::OVERLAY), false);
+}
+
+BENCHMARK(BlendFuncs, RgbaSoftLight64K) {
+  run_blender(state, get_rgba_blender(BlendMode::SOFT_LIGHT), false);
+}
+
+BENCHMARK(BlendFuncs, RgbaHslHue64K) {
+  run_blender(state, get_rgba_blender(BlendMode::HSL_HUE), false);
+}
+
+BENCHMARK(BlendFuncs, GrayaNormal64K) {
+  run_blender(state, get_graya_blender(BlendMode::NORMAL), true);
+}
+
+BENCHMARK(BlendFuncs, GrayaScreen64K) {
+  run_blender(state, get_graya_blender(BlendMode::SCREEN), true);
+}
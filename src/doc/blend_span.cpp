@@ -0,0 +1,142 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/blend_span.h"
+
+#include "base/cpu_features.h"
+
+namespace doc {
+
+#if DOC_BLEND_SPAN_X86
+BlendSpanFunc get_rgba_span_blender_sse2(BlendMode blendmode);
+BlendSpanFunc get_rgba_span_blender_avx2(BlendMode blendmode);
+void rgba_merge_span_sse2(color_t* dst, const color_t* src, int n, color_t color, int opacity);
+void rgba_merge_span_avx2(color_t* dst, const color_t* src, int n, color_t color, int opacity);
+void graya_merge_span_sse2(uint16_t* dst, const uint16_t* src, int n, color_t color, int opacity);
+void graya_merge_span_avx2(uint16_t* dst, const uint16_t* src, int n, color_t color, int opacity);
+#endif
+#if DOC_BLEND_SPAN_NEON
+BlendSpanFunc get_rgba_span_blender_neon(BlendMode blendmode);
+void rgba_merge_span_neon(color_t* dst, const color_t* src, int n, color_t color, int opacity);
+void graya_merge_span_neon(uint16_t* dst, const uint16_t* src, int n, color_t color, int opacity);
+#endif
+#if DOC_BLEND_SPAN_WASM
+BlendSpanFunc get_rgba_span_blender_wasm(BlendMode blendmode);
+void rgba_merge_span_wasm(color_t* dst, const color_t* src, int n, color_t color, int opacity);
+void graya_merge_span_wasm(uint16_t* dst, const uint16_t* src, int n, color_t color, int opacity);
+#endif
+
+namespace {
+
+typedef void (*RgbaMergeSpanFunc)(color_t* dst, const color_t* src, int n,
+                                  color_t color, int opacity);
+typedef void (*GrayaMergeSpanFunc)(uint16_t* dst, const uint16_t* src, int n,
+                                   color_t color, int opacity);
+
+void rgba_merge_span_scalar(color_t* dst, const color_t* src, int n,
+                            color_t color, int opacity)
+{
+  for (int i=0; i<n; ++i)
+    dst[i] = rgba_blender_merge(src[i], color, opacity);
+}
+
+void graya_merge_span_scalar(uint16_t* dst, const uint16_t* src, int n,
+                             color_t color, int opacity)
+{
+  for (int i=0; i<n; ++i)
+    dst[i] = graya_blender_merge(src[i], color, opacity);
+}
+
+RgbaMergeSpanFunc get_rgba_merge_span()
+{
+#if DOC_BLEND_SPAN_X86
+  if (base::cpu_has_avx2())
+    return rgba_merge_span_avx2;
+  if (base::cpu_has_sse2())
+    return rgba_merge_span_sse2;
+#endif
+#if DOC_BLEND_SPAN_NEON
+  if (base::cpu_has_neon())
+    return rgba_merge_span_neon;
+#endif
+#if DOC_BLEND_SPAN_WASM
+  // SIMD128 is checked when the module is compiled by the browser
+  return rgba_merge_span_wasm;
+#endif
+  return rgba_merge_span_scalar;
+}
+
+GrayaMergeSpanFunc get_graya_merge_span()
+{
+#if DOC_BLEND_SPAN_X86
+  if (base::cpu_has_avx2())
+    return graya_merge_span_avx2;
+  if (base::cpu_has_sse2())
+    return graya_merge_span_sse2;
+#endif
+#if DOC_BLEND_SPAN_NEON
+  if (base::cpu_has_neon())
+    return graya_merge_span_neon;
+#endif
+#if DOC_BLEND_SPAN_WASM
+  // SIMD128 is checked when the module is compiled by the browser
+  return graya_merge_span_wasm;
+#endif
+  return graya_merge_span_scalar;
+}
+
+} // anonymous namespace
+
+BlendSpanFunc get_rgba_span_blender(BlendMode blendmode)
+{
+#if DOC_BLEND_SPAN_X86
+  static const bool avx2 = base::cpu_has_avx2();
+  static const bool sse2 = base::cpu_has_sse2();
+  if (avx2)
+    return get_rgba_span_blender_avx2(blendmode);
+  if (sse2)
+    return get_rgba_span_blender_sse2(blendmode);
+#endif
+#if DOC_BLEND_SPAN_NEON
+  static const bool neon = base::cpu_has_neon();
+  if (neon)
+    return get_rgba_span_blender_neon(blendmode);
+#endif
+#if DOC_BLEND_SPAN_WASM
+  return get_rgba_span_blender_wasm(blendmode);
+#endif
+  return nullptr;
+}
+
+void rgba_blend_span_scalar(BlendFunc blendFunc,
+                            color_t* dst, const color_t* src, int n,
+                            color_t maskColor, int opacity)
+{
+  for (int i=0; i<n; ++i, ++dst, ++src) {
+    if (*src != maskColor)
+      *dst = (*blendFunc)(*dst, *src, opacity);
+  }
+}
+
+void rgba_merge_span(color_t* dst, const color_t* src, int n,
+                     color_t color, int opacity)
+{
+  static const RgbaMergeSpanFunc func = get_rgba_merge_span();
+  func(dst, src, n, color, opacity);
+}
+
+void graya_merge_span(uint16_t* dst, const uint16_t* src, int n,
+                      color_t color, int opacity)
+{
+  static const GrayaMergeSpanFunc func = get_graya_merge_span();
+  func(dst, src, n, color, opacity);
+}
+
+} // namespace doc
@@ -0,0 +1,47 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "doc/blend_funcs.h"
+#include "doc/blend_mode.h"
+#include "doc/color.h"
+
+#include <cstdint>
+
+namespace doc {
+
+  // Blends "n" RGBA pixels from "src" into "dst". Source pixels
+  // equal to "maskColor" are skipped (as the per-pixel compositing
+  // does). The result is exactly the same as calling the BlendFunc
+  // returned by get_rgba_blender() for each pixel.
+  typedef void (*BlendSpanFunc)(color_t* dst, const color_t* src, int n,
+                                color_t maskColor, int opacity);
+
+  // Returns the best vectorized span blender available in the
+  // current CPU for the given blend mode, or nullptr if the blend
+  // mode doesn't have a vectorized implementation (in that case the
+  // per-pixel BlendFunc must be used).
+  BlendSpanFunc get_rgba_span_blender(BlendMode blendmode);
+
+  // Reference implementation which calls the scalar BlendFunc for
+  // each pixel.
+  void rgba_blend_span_scalar(BlendFunc blendFunc,
+                              color_t* dst, const color_t* src, int n,
+                              color_t maskColor, int opacity);
+
+  // dst[i] = rgba_blender_merge(src[i], color, opacity) for "n"
+  // pixels (used to paint with a constant color, "dst" can be equal
+  // to "src"). A vectorized implementation is used when the CPU
+  // supports it.
+  void rgba_merge_span(color_t* dst, const color_t* src, int n,
+                       color_t color, int opacity);
+
+  // The same for grayscale pixels (graya_blender_merge()).
+  void graya_merge_span(uint16_t* dst, const uint16_t* src, int n,
+                        color_t color, int opacity);
+
+} // namespace doc
@@ -0,0 +1,65 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+//
+// This file must be compiled with AVX2 enabled (-mavx2 or
+// /arch:AVX2), it's used only if the CPU supports it.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/blend_span_kernel.h"
+
+#include <immintrin.h>
+
+namespace doc {
+
+namespace {
+
+struct AVX2 {
+  typedef __m256i I;
+  typedef __m256 F;
+  enum { N = 8 };
+
+  static I load(const color_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+  static void store(color_t* p, I v) { _mm256_storeu_si256((__m256i*)p, v); }
+  static I set1(int v) { return _mm256_set1_epi32(v); }
+  static I and_(I a, I b) { return _mm256_and_si256(a, b); }
+  static I or_(I a, I b) { return _mm256_or_si256(a, b); }
+  static I add(I a, I b) { return _mm256_add_epi32(a, b); }
+  static I sub(I a, I b) { return _mm256_sub_epi32(a, b); }
+  template<int n> static I srl(I a) { return _mm256_srli_epi32(a, n); }
+  template<int n> static I sll(I a) { return _mm256_slli_epi32(a, n); }
+  static I mul_u16(I a, I b) { return _mm256_mullo_epi16(a, b); }
+  static I cmpeq(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+  static I cmpgt(I a, I b) { return _mm256_cmpgt_epi32(a, b); }
+  static I select(I m, I a, I b) { return _mm256_blendv_epi8(b, a, m); }
+  static F to_float(I a) { return _mm256_cvtepi32_ps(a); }
+  static I trunc(F a) { return _mm256_cvttps_epi32(a); }
+  static F fmul(F a, F b) { return _mm256_mul_ps(a, b); }
+  static F fdiv(F a, F b) { return _mm256_div_ps(a, b); }
+};
+
+} // anonymous namespace
+
+BlendSpanFunc get_rgba_span_blender_avx2(BlendMode blendmode)
+{
+  return blend_span::get_span_blender<AVX2>(blendmode);
+}
+
+void rgba_merge_span_avx2(color_t* dst, const color_t* src, int n,
+                         color_t color, int opacity)
+{
+  blend_span::rgba_merge_span<AVX2>(dst, src, n, color, opacity);
+}
+
+void graya_merge_span_avx2(uint16_t* dst, const uint16_t* src, int n,
+                          color_t color, int opacity)
+{
+  blend_span::graya_merge_span<AVX2>(dst, src, n, color, opacity);
+}
+
+} // namespace doc
@@ -0,0 +1,372 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+// Generic implementation of the vectorized RGBA span blenders. This
+// file is included by each blend_span_<isa>.cpp file with a "V"
+// class that wraps the intrinsics of the specific instruction set:
+//
+//   V::I, V::F     Vector of V::N int32/float lanes (one pixel per lane)
+//   V::load/store  Unaligned load/store of V::N pixels
+//   V::set1        Broadcast a value to all lanes
+//   V::and_/or_/add/sub/srl<n>/sll<n>
+//   V::mul_u16     Multiply lanes whose product fits in 16 bits
+//   V::cmpeq/cmpgt Lane comparisons (all bits set for true)
+//   V::select      select(m, a, b) = (m ? a: b)
+//   V::to_float/trunc/fmul/fdiv
+//
+// All operations must give the same result that the scalar blenders
+// in doc/blend_funcs.cpp.
+
+#include "doc/blend_funcs.h"
+#include "doc/blend_internals.h"
+#include "doc/blend_mode.h"
+#include "doc/blend_span.h"
+#include "doc/color.h"
+
+namespace doc {
+namespace blend_span {
+
+template<class V>
+struct Pixels {
+  typedef typename V::I I;
+  I r, g, b, a;
+
+  explicit Pixels(I c) {
+    I ff = V::set1(0xff);
+    r = V::and_(c, ff);
+    g = V::and_(V::template srl<8>(c), ff);
+    b = V::and_(V::template srl<16>(c), ff);
+    a = V::template srl<24>(c);
+  }
+
+  Pixels(I r, I g, I b, I a) : r(r), g(g), b(b), a(a) { }
+
+  I pack() const {
+    return V::or_(V::or_(r, V::template sll<8>(g)),
+                  V::or_(V::template sll<16>(b), V::template sll<24>(a)));
+  }
+};
+
+// MUL_UN8() from doc/blend_internals.h
+template<class V>
+inline typename V::I mul_un8(typename V::I a, typename V::I b)
+{
+  typename V::I t = V::add(V::mul_u16(a, b), V::set1(ONE_HALF));
+  return V::template srl<G_SHIFT>(V::add(V::template srl<G_SHIFT>(t), t));
+}
+
+// DIV_UN8() from doc/blend_internals.h (b must be > 0 in the lanes
+// that are used). The numerator is exactly representable as a float
+// and the error of the float division is smaller than the distance
+// to the next integer, so truncating gives the integer quotient.
+template<class V>
+inline typename V::I div_un8(typename V::I a, typename V::I b)
+{
+  typename V::I num = V::add(V::mul_u16(a, V::set1(MASK)),
+                             V::template srl<1>(b));
+  typename V::I den = V::select(V::cmpeq(b, V::set1(0)), V::set1(1), b);
+  return V::trunc(V::fdiv(V::to_float(num), V::to_float(den)));
+}
+
+template<class V>
+inline typename V::I min_i(typename V::I a, typename V::I b)
+{
+  return V::select(V::cmpgt(a, b), b, a);
+}
+
+template<class V>
+inline typename V::I max_i(typename V::I a, typename V::I b)
+{
+  return V::select(V::cmpgt(a, b), a, b);
+}
+
+template<class V>
+inline typename V::I screen(typename V::I b, typename V::I s)
+{
+  return V::sub(V::add(b, s), mul_un8<V>(b, s));
+}
+
+template<class V>
+inline typename V::I hard_light(typename V::I b, typename V::I s)
+{
+  typedef typename V::I I;
+  I s2 = V::template sll<1>(s);
+  I lo = mul_un8<V>(b, s2);
+  I hi = screen<V>(b, V::sub(s2, V::set1(255)));
+  return V::select(V::cmpgt(V::set1(128), s), lo, hi);
+}
+
+// Separable blend functions applied to each RGB channel (b=backdrop,
+// s=source), these are the same macros/functions of blend_funcs.cpp.
+template<class V, BlendMode Mode>
+struct Channel;
+
+template<class V> struct Channel<V, BlendMode::MULTIPLY> {
+  static typename V::I blend(typename V::I b, typename V::I s) { return mul_un8<V>(b, s); }
+};
+
+template<class V> struct Channel<V, BlendMode::SCREEN> {
+  static typename V::I blend(typename V::I b, typename V::I s) { return screen<V>(b, s); }
+};
+
+template<class V> struct Channel<V, BlendMode::OVERLAY> {
+  static typename V::I blend(typename V::I b, typename V::I s) { return hard_light<V>(s, b); }
+};
+
+template<class V> struct Channel<V, BlendMode::DARKEN> {
+  static typename V::I blend(typename V::I b, typename V::I s) { return min_i<V>(b, s); }
+};
+
+template<class V> struct Channel<V, BlendMode::LIGHTEN> {
+  static typename V::I blend(typename V::I b, typename V::I s) { return max_i<V>(b, s); }
+};
+
+template<class V> struct Channel<V, BlendMode::COLOR_DODGE> {
+  static typename V::I blend(typename V::I b, typename V::I s) {
+    typedef typename V::I I;
+    I zero = V::set1(0);
+    I is = V::sub(V::set1(255), s);
+    I r = V::select(V::cmpgt(is, b), div_un8<V>(b, is), V::set1(255));
+    return V::select(V::cmpeq(b, zero), zero, r);
+  }
+};
+
+template<class V> struct Channel<V, BlendMode::COLOR_BURN> {
+  static typename V::I blend(typename V::I b, typename V::I s) {
+    typedef typename V::I I;
+    I ff = V::set1(255);
+    I ib = V::sub(ff, b);
+    I r = V::select(V::cmpgt(s, ib), V::sub(ff, div_un8<V>(ib, s)), V::set1(0));
+    return V::select(V::cmpeq(b, ff), ff, r);
+  }
+};
+
+template<class V> struct Channel<V, BlendMode::HARD_LIGHT> {
+  static typename V::I blend(typename V::I b, typename V::I s) { return hard_light<V>(b, s); }
+};
+
+template<class V> struct Channel<V, BlendMode::DIFFERENCE> {
+  static typename V::I blend(typename V::I b, typename V::I s) {
+    return V::sub(max_i<V>(b, s), min_i<V>(b, s));
+  }
+};
+
+template<class V> struct Channel<V, BlendMode::EXCLUSION> {
+  static typename V::I blend(typename V::I b, typename V::I s) {
+    typename V::I t = mul_un8<V>(b, s);
+    return V::sub(V::add(b, s), V::template sll<1>(t));
+  }
+};
+
+// rgba_blender_normal(backdrop, src, opacity)
+template<class V>
+inline typename V::I normal(const Pixels<V>& B, typename V::I backdrop,
+                            const Pixels<V>& S, typename V::I opacity)
+{
+  typedef typename V::I I;
+  typedef typename V::F F;
+  I zero = V::set1(0);
+
+  I Sa = mul_un8<V>(S.a, opacity);
+  I Ra = V::sub(V::add(B.a, Sa), mul_un8<V>(B.a, Sa));
+
+  // Ra is zero only when the backdrop is transparent (a lane that
+  // is discarded below), but avoid the 0/0 anyway.
+  F fSa = V::to_float(Sa);
+  F fRa = V::to_float(V::select(V::cmpeq(Ra, zero), V::set1(1), Ra));
+
+  // B + (S-B) * Sa / Ra
+  Pixels<V> R(
+    V::add(B.r, V::trunc(V::fdiv(V::fmul(V::to_float(V::sub(S.r, B.r)), fSa), fRa))),
+    V::add(B.g, V::trunc(V::fdiv(V::fmul(V::to_float(V::sub(S.g, B.g)), fSa), fRa))),
+    V::add(B.b, V::trunc(V::fdiv(V::fmul(V::to_float(V::sub(S.b, B.b)), fSa), fRa))),
+    Ra);
+
+  I result = R.pack();
+  // Source is transparent: keep the backdrop
+  result = V::select(V::cmpeq(S.a, zero), backdrop, result);
+  // Backdrop is transparent: source with the applied opacity
+  result = V::select(V::cmpeq(B.a, zero),
+                     Pixels<V>(S.r, S.g, S.b, Sa).pack(), result);
+  return result;
+}
+
+template<class V, BlendMode Mode>
+struct Blender {
+  static typename V::I blend(typename V::I backdrop, typename V::I src,
+                             typename V::I opacity) {
+    Pixels<V> B(backdrop);
+    Pixels<V> S(src);
+    Pixels<V> R(Channel<V, Mode>::blend(B.r, S.r),
+                Channel<V, Mode>::blend(B.g, S.g),
+                Channel<V, Mode>::blend(B.b, S.b),
+                S.a);
+    return normal<V>(B, backdrop, R, opacity);
+  }
+};
+
+template<class V>
+struct Blender<V, BlendMode::NORMAL> {
+  static typename V::I blend(typename V::I backdrop, typename V::I src,
+                             typename V::I opacity) {
+    return normal<V>(Pixels<V>(backdrop), backdrop, Pixels<V>(src), opacity);
+  }
+};
+
+template<class V>
+struct Blender<V, BlendMode::SRC> {
+  static typename V::I blend(typename V::I backdrop, typename V::I src,
+                             typename V::I opacity) {
+    return src;
+  }
+};
+
+template<class V, BlendMode Mode>
+void blend_span(color_t* dst, const color_t* src, int n,
+                color_t maskColor, int opacity)
+{
+  typedef typename V::I I;
+  const I mask = V::set1(int(maskColor));
+  const I op = V::set1(opacity);
+  int i = 0;
+
+  for (; i+V::N <= n; i += V::N) {
+    I d = V::load(dst+i);
+    I s = V::load(src+i);
+    I r = Blender<V, Mode>::blend(d, s, op);
+    V::store(dst+i, V::select(V::cmpeq(s, mask), d, r));
+  }
+
+  if (i < n)
+    rgba_blend_span_scalar(get_rgba_blender(Mode),
+                           dst+i, src+i, n-i, maskColor, opacity);
+}
+
+// MUL_UN8(s - b, opacity) where "s" and "b" are in [0, 255]. The
+// signed product is calculated as s*opacity - b*opacity (both fit
+// in 16 bits), and a bias of 65536 keeps all the intermediate values
+// positive (so logical shifts give the same result as the
+// arithmetic shifts of the scalar macro, plus 257).
+template<class V>
+inline typename V::I mul_un8_diff(typename V::I sOpacity, typename V::I b,
+                                  typename V::I opacity)
+{
+  typedef typename V::I I;
+  I t = V::add(V::sub(sOpacity, V::mul_u16(b, opacity)),
+               V::set1(ONE_HALF + 65536));
+  I u = V::template srl<G_SHIFT>(V::add(V::template srl<G_SHIFT>(t), t));
+  return V::sub(u, V::set1(257));
+}
+
+// The merge of a component with the given source component of a
+// backdrop bC whose alpha is bA (the same conditions of
+// rgba_blender_merge()).
+template<class V>
+inline typename V::I merge_component(typename V::I bC, typename V::I bA,
+                                     typename V::I sC, typename V::I sCOpacity,
+                                     bool sourceIsTransparent,
+                                     typename V::I opacity)
+{
+  typename V::I r =
+    (sourceIsTransparent ? bC: V::add(bC, mul_un8_diff<V>(sCOpacity, bC, opacity)));
+  return V::select(V::cmpeq(bA, V::set1(0)), sC, r);
+}
+
+// dst[i] = rgba_blender_merge(src[i], color, opacity)
+template<class V>
+void rgba_merge_span(color_t* dst, const color_t* src, int n,
+                     color_t color, int opacity)
+{
+  typedef typename V::I I;
+  const I zero = V::set1(0);
+  const I op = V::set1(opacity);
+  const bool transparent = (rgba_geta(color) == 0);
+  const Pixels<V> S(V::set1(int(color)));
+  const Pixels<V> SOp(V::mul_u16(S.r, op), V::mul_u16(S.g, op),
+                      V::mul_u16(S.b, op), V::mul_u16(S.a, op));
+  int i = 0;
+
+  for (; i+V::N <= n; i += V::N) {
+    const Pixels<V> B(V::load(src+i));
+    I Ra = V::add(B.a, mul_un8_diff<V>(SOp.a, B.a, op));
+    I nonzero = V::select(V::cmpeq(Ra, zero), zero, V::set1(-1));
+    Pixels<V> R(
+      V::and_(merge_component<V>(B.r, B.a, S.r, SOp.r, transparent, op), nonzero),
+      V::and_(merge_component<V>(B.g, B.a, S.g, SOp.g, transparent, op), nonzero),
+      V::and_(merge_component<V>(B.b, B.a, S.b, SOp.b, transparent, op), nonzero),
+      Ra);
+    V::store(dst+i, R.pack());
+  }
+
+  for (; i<n; ++i)
+    dst[i] = rgba_blender_merge(src[i], color, opacity);
+}
+
+// dst[i] = graya_blender_merge(src[i], color, opacity). Two
+// grayscale pixels are processed in each 32-bit lane (as two
+// value/alpha pairs).
+template<class V>
+void graya_merge_span(uint16_t* dst, const uint16_t* src, int n,
+                      color_t color, int opacity)
+{
+  typedef typename V::I I;
+  const I zero = V::set1(0);
+  const I ff = V::set1(0xff);
+  const I op = V::set1(opacity);
+  const bool transparent = (graya_geta(color) == 0);
+  const I Sv = V::set1(graya_getv(color));
+  const I Sa = V::set1(graya_geta(color));
+  const I SvOp = V::mul_u16(Sv, op);
+  const I SaOp = V::mul_u16(Sa, op);
+  int i = 0;
+
+  for (; i+2*V::N <= n; i += 2*V::N) {
+    const I b = V::load((const color_t*)(src+i));
+    I Bv[2] = { V::and_(b, ff), V::and_(V::template srl<16>(b), ff) };
+    I Ba[2] = { V::and_(V::template srl<8>(b), ff), V::template srl<24>(b) };
+    I R[2];
+
+    for (int j=0; j<2; ++j) {
+      I Ra = V::add(Ba[j], mul_un8_diff<V>(SaOp, Ba[j], op));
+      I Rv = merge_component<V>(Bv[j], Ba[j], Sv, SvOp, transparent, op);
+      Rv = V::select(V::cmpeq(Ra, zero), zero, Rv);
+      R[j] = V::or_(Rv, V::template sll<8>(Ra));
+    }
+
+    V::store((color_t*)(dst+i), V::or_(R[0], V::template sll<16>(R[1])));
+  }
+
+  for (; i<n; ++i)
+    dst[i] = graya_blender_merge(src[i], color, opacity);
+}
+
+template<class V>
+BlendSpanFunc get_span_blender(BlendMode blendmode)
+{
+  switch (blendmode) {
+    case BlendMode::SRC:         return blend_span<V, BlendMode::SRC>;
+    case BlendMode::NORMAL:      return blend_span<V, BlendMode::NORMAL>;
+    case BlendMode::MULTIPLY:    return blend_span<V, BlendMode::MULTIPLY>;
+    case BlendMode::SCREEN:      return blend_span<V, BlendMode::SCREEN>;
+    case BlendMode::OVERLAY:     return blend_span<V, BlendMode::OVERLAY>;
+    case BlendMode::DARKEN:      return blend_span<V, BlendMode::DARKEN>;
+    case BlendMode::LIGHTEN:     return blend_span<V, BlendMode::LIGHTEN>;
+    case BlendMode::COLOR_DODGE: return blend_span<V, BlendMode::COLOR_DODGE>;
+    case BlendMode::COLOR_BURN:  return blend_span<V, BlendMode::COLOR_BURN>;
+    case BlendMode::HARD_LIGHT:  return blend_span<V, BlendMode::HARD_LIGHT>;
+    case BlendMode::DIFFERENCE:  return blend_span<V, BlendMode::DIFFERENCE>;
+    case BlendMode::EXCLUSION:   return blend_span<V, BlendMode::EXCLUSION>;
+    default:
+      // Non-separable modes (soft light, HSL), tints, etc. are
+      // blended with the scalar functions.
+      return nullptr;
+  }
+}
+
+} // namespace blend_span
+} // namespace doc
@@ -0,0 +1,62 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/blend_span_kernel.h"
+
+#include <arm_neon.h>
+
+namespace doc {
+
+namespace {
+
+struct NEON {
+  typedef int32x4_t I;
+  typedef float32x4_t F;
+  enum { N = 4 };
+
+  static I load(const color_t* p) { return vreinterpretq_s32_u32(vld1q_u32(p)); }
+  static void store(color_t* p, I v) { vst1q_u32(p, vreinterpretq_u32_s32(v)); }
+  static I set1(int v) { return vdupq_n_s32(v); }
+  static I and_(I a, I b) { return vandq_s32(a, b); }
+  static I or_(I a, I b) { return vorrq_s32(a, b); }
+  static I add(I a, I b) { return vaddq_s32(a, b); }
+  static I sub(I a, I b) { return vsubq_s32(a, b); }
+  template<int n> static I srl(I a) { return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), n)); }
+  template<int n> static I sll(I a) { return vshlq_n_s32(a, n); }
+  static I mul_u16(I a, I b) { return vmulq_s32(a, b); }
+  static I cmpeq(I a, I b) { return vreinterpretq_s32_u32(vceqq_s32(a, b)); }
+  static I cmpgt(I a, I b) { return vreinterpretq_s32_u32(vcgtq_s32(a, b)); }
+  static I select(I m, I a, I b) { return vbslq_s32(vreinterpretq_u32_s32(m), a, b); }
+  static F to_float(I a) { return vcvtq_f32_s32(a); }
+  static I trunc(F a) { return vcvtq_s32_f32(a); }
+  static F fmul(F a, F b) { return vmulq_f32(a, b); }
+  static F fdiv(F a, F b) { return vdivq_f32(a, b); }
+};
+
+} // anonymous namespace
+
+BlendSpanFunc get_rgba_span_blender_neon(BlendMode blendmode)
+{
+  return blend_span::get_span_blender<NEON>(blendmode);
+}
+
+void rgba_merge_span_neon(color_t* dst, const color_t* src, int n,
+                         color_t color, int opacity)
+{
+  blend_span::rgba_merge_span<NEON>(dst, src, n, color, opacity);
+}
+
+void graya_merge_span_neon(uint16_t* dst, const uint16_t* src, int n,
+                          color_t color, int opacity)
+{
+  blend_span::graya_merge_span<NEON>(dst, src, n, color, opacity);
+}
+
+} // namespace doc
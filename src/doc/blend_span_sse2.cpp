@@ -0,0 +1,64 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/blend_span_kernel.h"
+
+#include <emmintrin.h>
+
+namespace doc {
+
+namespace {
+
+struct SSE2 {
+  typedef __m128i I;
+  typedef __m128 F;
+  enum { N = 4 };
+
+  static I load(const color_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+  static void store(color_t* p, I v) { _mm_storeu_si128((__m128i*)p, v); }
+  static I set1(int v) { return _mm_set1_epi32(v); }
+  static I and_(I a, I b) { return _mm_and_si128(a, b); }
+  static I or_(I a, I b) { return _mm_or_si128(a, b); }
+  static I add(I a, I b) { return _mm_add_epi32(a, b); }
+  static I sub(I a, I b) { return _mm_sub_epi32(a, b); }
+  template<int n> static I srl(I a) { return _mm_srli_epi32(a, n); }
+  template<int n> static I sll(I a) { return _mm_slli_epi32(a, n); }
+  // The high 16 bits of each lane are zero, so the low 16-bits
+  // product is the 32-bit product.
+  static I mul_u16(I a, I b) { return _mm_mullo_epi16(a, b); }
+  static I cmpeq(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+  static I cmpgt(I a, I b) { return _mm_cmpgt_epi32(a, b); }
+  static I select(I m, I a, I b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+  static F to_float(I a) { return _mm_cvtepi32_ps(a); }
+  static I trunc(F a) { return _mm_cvttps_epi32(a); }
+  static F fmul(F a, F b) { return _mm_mul_ps(a, b); }
+  static F fdiv(F a, F b) { return _mm_div_ps(a, b); }
+};
+
+} // anonymous namespace
+
+BlendSpanFunc get_rgba_span_blender_sse2(BlendMode blendmode)
+{
+  return blend_span::get_span_blender<SSE2>(blendmode);
+}
+
+void rgba_merge_span_sse2(color_t* dst, const color_t* src, int n,
+                         color_t color, int opacity)
+{
+  blend_span::rgba_merge_span<SSE2>(dst, src, n, color, opacity);
+}
+
+void graya_merge_span_sse2(uint16_t* dst, const uint16_t* src, int n,
+                          color_t color, int opacity)
+{
+  blend_span::graya_merge_span<SSE2>(dst, src, n, color, opacity);
+}
+
+} // namespace doc
@@ -0,0 +1,164 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/blend_span.h"
+
+#include <random>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+color_t random_pixel(std::mt19937& rng)
+{
+  // Use a lot of fully transparent/opaque pixels to test the special
+  // cases of the normal blender.
+  int a;
+  switch (rng() % 4) {
+    case 0: a = 0; break;
+    case 1: a = 255; break;
+    default: a = rng() % 256; break;
+  }
+  return rgba(rng() % 256, rng() % 256, rng() % 256, a);
+}
+
+} // anonymous namespace
+
+TEST(BlendSpan, SameResultsAsScalarBlenders)
+{
+  const BlendMode modes[] = {
+    BlendMode::SRC,
+    BlendMode::MERGE,
+    BlendMode::NEG_BW,
+    BlendMode::RED_TINT,
+    BlendMode::BLUE_TINT,
+    BlendMode::NORMAL,
+    BlendMode::MULTIPLY,
+    BlendMode::SCREEN,
+    BlendMode::OVERLAY,
+    BlendMode::DARKEN,
+    BlendMode::LIGHTEN,
+    BlendMode::COLOR_DODGE,
+    BlendMode::COLOR_BURN,
+    BlendMode::HARD_LIGHT,
+    BlendMode::SOFT_LIGHT,
+    BlendMode::DIFFERENCE,
+    BlendMode::EXCLUSION,
+    BlendMode::HSL_HUE,
+    BlendMode::HSL_SATURATION,
+    BlendMode::HSL_COLOR,
+    BlendMode::HSL_LUMINOSITY
+  };
+  const int opacities[] = { 0, 1, 127, 128, 200, 255 };
+  const color_t maskColor = 0;
+
+  std::mt19937 rng(1234);
+
+  for (BlendMode mode : modes) {
+    BlendSpanFunc spanBlender = get_rgba_span_blender(mode);
+    if (!spanBlender)
+      continue;
+
+    BlendFunc blender = get_rgba_blender(mode);
+
+    for (int opacity : opacities) {
+      // Different lengths to test the remaining pixels that don't
+      // fill a whole vector.
+      for (int n=1; n<=67; n+=3) {
+        std::vector<color_t> src(n), expected(n), actual(n);
+        for (int i=0; i<n; ++i) {
+          src[i] = random_pixel(rng);
+          expected[i] = actual[i] = random_pixel(rng);
+        }
+        src[0] = maskColor;
+
+        rgba_blend_span_scalar(blender, &expected[0], &src[0], n, maskColor, opacity);
+        spanBlender(&actual[0], &src[0], n, maskColor, opacity);
+
+        for (int i=0; i<n; ++i)
+          ASSERT_EQ(expected[i], actual[i])
+            << "Blend mode " << blend_mode_to_string(mode)
+            << ", opacity " << opacity << ", pixel " << i;
+      }
+    }
+  }
+}
+
+TEST(BlendSpan, AllBackdropAndSourceValues)
+{
+  // Exhaustive test of all channel combinations for the normal
+  // blender (alpha values make the division of the normal blender
+  // the most sensitive part of the vectorized kernels).
+  BlendSpanFunc spanBlender = get_rgba_span_blender(BlendMode::NORMAL);
+  if (!spanBlender)
+    return;
+
+  std::vector<color_t> src(256), expected(256), actual(256);
+  for (int b=0; b<256; ++b) {
+    for (int a=0; a<256; ++a) {
+      for (int s=0; s<256; ++s) {
+        src[s] = rgba(s, 255-s, s/2, s);
+        expected[s] = actual[s] = rgba(b, 255-b, b/3, a);
+      }
+
+      rgba_blend_span_scalar(get_rgba_blender(BlendMode::NORMAL),
+                             &expected[0], &src[0], 256, 0, 255);
+      spanBlender(&actual[0], &src[0], 256, 0, 255);
+      ASSERT_EQ(expected, actual) << "Backdrop " << b << " alpha " << a;
+    }
+  }
+}
+
+TEST(BlendSpan, MergeSpans)
+{
+  const int opacities[] = { 0, 1, 127, 128, 200, 255 };
+  std::mt19937 rng(5678);
+
+  for (int k=0; k<20; ++k) {
+    color_t color = random_pixel(rng);
+
+    for (int opacity : opacities) {
+      for (int n=1; n<=67; n+=3) {
+        std::vector<color_t> src(n), actual(n);
+        std::vector<uint16_t> graySrc(n), grayActual(n);
+        for (int i=0; i<n; ++i) {
+          src[i] = random_pixel(rng);
+          graySrc[i] = graya(rgba_getr(src[i]), rgba_geta(src[i]));
+        }
+
+        rgba_merge_span(&actual[0], &src[0], n, color, opacity);
+        graya_merge_span(&grayActual[0], &graySrc[0], n,
+                         graya(rgba_getr(color), rgba_geta(color)), opacity);
+
+        for (int i=0; i<n; ++i) {
+          ASSERT_EQ(rgba_blender_merge(src[i], color, opacity), actual[i])
+            << "Opacity " << opacity << ", pixel " << i;
+          ASSERT_EQ(graya_blender_merge(graySrc[i],
+                                        graya(rgba_getr(color), rgba_geta(color)),
+                                        opacity), grayActual[i])
+            << "Opacity " << opacity << ", pixel " << i;
+        }
+
+        // In-place merge
+        rgba_merge_span(&src[0], &src[0], n, color, opacity);
+        ASSERT_EQ(actual, src);
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/blend_span_kernel.h"
+
+#include <wasm_simd128.h>
+
+namespace doc {
+
+namespace {
+
+struct WASM {
+  typedef v128_t I;
+  typedef v128_t F;
+  enum { N = 4 };
+
+  static I load(const color_t* p) { return wasm_v128_load(p); }
+  static void store(color_t* p, I v) { wasm_v128_store(p, v); }
+  static I set1(int v) { return wasm_i32x4_splat(v); }
+  static I and_(I a, I b) { return wasm_v128_and(a, b); }
+  static I or_(I a, I b) { return wasm_v128_or(a, b); }
+  static I add(I a, I b) { return wasm_i32x4_add(a, b); }
+  static I sub(I a, I b) { return wasm_i32x4_sub(a, b); }
+  template<int n> static I srl(I a) { return wasm_u32x4_shr(a, n); }
+  template<int n> static I sll(I a) { return wasm_i32x4_shl(a, n); }
+  static I mul_u16(I a, I b) { return wasm_i32x4_mul(a, b); }
+  static I cmpeq(I a, I b) { return wasm_i32x4_eq(a, b); }
+  static I cmpgt(I a, I b) { return wasm_i32x4_gt(a, b); }
+  static I select(I m, I a, I b) { return wasm_v128_bitselect(a, b, m); }
+  static F to_float(I a) { return wasm_f32x4_convert_i32x4(a); }
+  static I trunc(F a) { return wasm_i32x4_trunc_sat_f32x4(a); }
+  static F fmul(F a, F b) { return wasm_f32x4_mul(a, b); }
+  static F fdiv(F a, F b) { return wasm_f32x4_div(a, b); }
+};
+
+} // anonymous namespace
+
+BlendSpanFunc get_rgba_span_blender_wasm(BlendMode blendmode)
+{
+  return blend_span::get_span_blender<WASM>(blendmode);
+}
+
+void rgba_merge_span_wasm(color_t* dst, const color_t* src, int n,
+                         color_t color, int opacity)
+{
+  blend_span::rgba_merge_span<WASM>(dst, src, n, color, opacity);
+}
+
+void graya_merge_span_wasm(uint16_t* dst, const uint16_t* src, int n,
+                          color_t color, int opacity)
+{
+  blend_span::graya_merge_span<WASM>(dst, src, n, color, opacity);
+}
+
+} // namespace doc
@@ -10,15 +10,10 @@
 
 #include "doc/brush.h"
 
-#include "base/pi.h"
-#include "doc/algo.h"
-#include "doc/algorithm/polygon.h"
 #include "doc/image.h"
 #include "doc/image_impl.h"
-#include "doc/primitives.h"
 
-#include <cmath>
-#include <array>
+#include <algorithm>
 
 namespace doc {
 
@@ -92,10 +87,12 @@ void Brush::setImage(const Image* image)
   m_backupImage.reset();
   m_mainColor.reset();
   m_bgColor.reset();
+  m_stamps.clear();
 
   m_bounds = gfx::Rect(
     -m_image.get()->width()/2, -m_image.get()->height()/2,
     m_image.get()->width(), m_image.get()->height());
+  m_scaledBounds = m_bounds;
 }
 
 template<class ImageTraits,
@@ -197,10 +194,12 @@ void Brush::setImageColor(ImageColor imageColor, color_t color)
   if (!m_image)
     return;
 
+  // The original image is kept as the backup (it can be shared with
+  // other brushes or the BrushStampCache)
   if (!m_backupImage)
-    m_backupImage.reset(Image::createCopy(m_image.get()));
-  else
-    m_image.reset(Image::createCopy(m_backupImage.get()));
+    m_backupImage = m_image;
+  m_image.reset(Image::createCopy(m_backupImage.get()));
+  m_stamps.clear();
 
   switch (imageColor) {
     case ImageColor::MainColor:
@@ -242,33 +241,52 @@ void Brush::clean()
   m_gen = ++generation;
   m_image.reset();
   m_backupImage.reset();
+  m_stamps.clear();
 }
 
-static void algo_hline(int x1, int y, int x2, void *data)
+Image* Brush::image(float scale)
 {
-  draw_hline(reinterpret_cast<Image*>(data), x1, y, x2, BitmapTraits::max_value);
+  BrushStampRef scaled = stamp(scale);
+  if (!scaled)
+    return nullptr;
+
+  m_scaledBounds = scaled->bounds();
+  return scaled->image();
 }
 
-Image* Brush::image() {
-  if (m_genSize != m_size && m_type != kImageBrushType)
-    regenerate();
-  return m_image.get();
+const CompressedImage& Brush::scanlines(float scale)
+{
+  static const CompressedImage empty;
+
+  BrushStampRef scaled = stamp(scale);
+  if (!scaled)
+    return empty;
+
+  m_scaledBounds = scaled->bounds();
+  return scaled->scanlines();
 }
 
-Image* Brush::image(float scale)
+BrushStampRef Brush::stamp(float scale)
 {
-  if (m_type == kImageBrushType)
-    return m_image.get();
-  auto size = m_size;
-  auto bounds = m_bounds;
-  m_size = m_size * scale + 0.5f;
-  if (m_size <= 0) m_size = 1;
-  if (m_size > size) m_size = size;
-  if (m_size != m_genSize)
-    regenerate();
-  m_size = size;
-  m_bounds = bounds;
-  return m_image.get();
+  int size = m_size;
+  if (m_type != kImageBrushType) {
+    size = int(m_size * scale + 0.5f);
+    size = std::clamp(size, 1, m_size);
+  }
+
+  std::lock_guard<std::mutex> lock(m_stampsMutex);
+  auto it = m_stamps.find(size);
+  if (it != m_stamps.end())
+    return it->second;
+
+  BrushStampRef& scaled = m_stamps[size];
+  if (size == m_size || m_type == kImageBrushType) {
+    if (m_image)
+      scaled = std::make_shared<BrushStamp>(m_image);
+  }
+  else
+    scaled = BrushStampCache::instance().get(m_type, size, m_angle);
+  return scaled;
 }
 
 // Regenerates the brush bitmap and its rectangle's region.
@@ -278,74 +296,11 @@ void Brush::regenerate()
 
   ASSERT(m_size > 0);
 
-  m_genSize = m_size;
-  int size = m_size;
-  if (m_type == kSquareBrushType && m_angle != 0 && m_size > 2)
-    size = (int)std::sqrt((double)2*m_size*m_size)+2;
-
-  m_image.reset(Image::create(IMAGE_BITMAP, size, size));
-
-  if (size == 1) {
-    clear_image(m_image.get(), BitmapTraits::max_value);
-  }
-  else {
-    clear_image(m_image.get(), BitmapTraits::min_value);
-
-    switch (m_type) {
-
-      case kCircleBrushType:
-        fill_ellipse(m_image.get(), 0, 0, size-1, size-1, BitmapTraits::max_value);
-        break;
-
-      case kSquareBrushType:
-        if (m_angle == 0 || size <= 2) {
-          clear_image(m_image.get(), BitmapTraits::max_value);
-        }
-        else {
-          int c = size/2;
-          int r = m_size/2;
-	  int sa = r * sin(m_angle * (PI / 180.0f)) + 0.5;
-	  int ca = r * cos(m_angle * (PI / 180.0f)) + 0.5;
-          int x1 = -ca - -sa;
-          int y1 = -sa + -ca;
-          int x2 =  ca - -sa;
-          int y2 =  sa + -ca;
-          int x3 =  ca -  sa;
-          int y3 =  ca +  sa;
-          int x4 = -ca -  sa;
-          int y4 = -sa +  ca;
-          std::array<std::pair<int,int>, 4> points {
-            std::pair<int, int>{x1 + c, y1 + c},
-            std::pair<int, int>{x4 + c, y4 + c},
-            std::pair<int, int>{x3 + c, y3 + c},
-            std::pair<int, int>{x2 + c, y2 + c}
-	  };
-
-          doc::algorithm::polygon(points, [&](int x, int y, int x2){
-            algo_hline(x, y, x2, m_image.get());
-          });
-        }
-        break;
-
-      case kLineBrushType: {
-	int r = m_size/2;
-	int sa = r * sin(m_angle * (PI / 180.0)) + 0.5;
-	int ca = r * cos(m_angle * (PI / 180.0)) + 0.5;
-	int x1 = -ca + r;
-	int y1 = -sa + r;
-	int x2 =  ca + r;
-	int y2 =  sa + r;
-        draw_line(m_image.get(), x1, y1, x2, y2, BitmapTraits::max_value);
-        break;
-      }
-    }
-  }
-
-  m_bounds = gfx::Rect(
-    -m_image->width()/2, -m_image->height()/2,
-    m_image->width(), m_image->height());
-
+  BrushStampRef stamp = BrushStampCache::instance().get(m_type, m_size, m_angle);
+  m_image = stamp->imageRef();
+  m_bounds = stamp->bounds();
   m_scaledBounds = m_bounds;
+  m_stamps[m_size] = stamp;
 }
 
 } // namespace doc
@@ -7,12 +7,17 @@
 #pragma once
 
 #include "doc/brush_pattern.h"
+#include "doc/brush_stamp.h"
 #include "doc/brush_type.h"
 #include "doc/color.h"
+#include "doc/compressed_image.h"
 #include "doc/image_ref.h"
 #include "gfx/point.h"
 #include "gfx/rect.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace doc {
@@ -32,10 +37,26 @@ namespace doc {
     BrushType type() const { return m_type; }
     int size() const { return m_size; }
     int angle() const { return m_angle; }
-    Image* image();
+    Image* image() { return m_image.get(); }
     int gen() const { return m_gen; }
+
+    // Image of the brush with its size scaled (e.g. by the pen
+    // pressure), scaledBounds() are updated to the bounds of this
+    // image. Scaled images are cached until the brush changes (and
+    // the images of generated brushes are shared by all brushes
+    // through the BrushStampCache).
     Image* image(float scale);
 
+    // Stamp with the image(scale) and its scanlines/boundaries, or
+    // nullptr if the brush doesn't have an image. It can be called
+    // from several threads (but not while the brush is modified).
+    BrushStampRef stamp(float scale = 1.0f);
+
+    // Runs of non-transparent pixels of image(scale) (cached for each
+    // scaled size too), so brushes can be stamped as horizontal lines
+    // without checking each pixel.
+    const CompressedImage& scanlines(float scale);
+
     BrushPattern pattern() const { return m_pattern; }
     gfx::Point patternOrigin() const { return m_patternOrigin; }
 
@@ -67,7 +88,8 @@ namespace doc {
     BrushPattern m_pattern;               // How the image should be replicated
     gfx::Point m_patternOrigin;           // From what position the brush was taken
     int m_gen;
-    int m_genSize{};
+    std::map<int, BrushStampRef> m_stamps; // By scaled size
+    std::mutex m_stampsMutex;
 
     // Extra data used for setImageColor()
     std::shared_ptr<Image> m_backupImage; // Backup image to avoid losing original brush colors/pattern
@@ -0,0 +1,221 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/brush_stamp.h"
+
+#include "base/pi.h"
+#include "doc/algo.h"
+#include "doc/algorithm/polygon.h"
+#include "doc/image.h"
+#include "doc/image_impl.h"
+#include "doc/primitives.h"
+
+#include <array>
+#include <cmath>
+
+namespace doc {
+
+BrushStamp::BrushStamp(const ImageRef& image)
+  : m_image(image)
+  , m_bounds(-image->width()/2, -image->height()/2,
+             image->width(), image->height())
+{
+}
+
+const CompressedImage& BrushStamp::scanlines() const
+{
+  std::call_once(m_scanlinesFlag, [this]{
+    m_scanlines.reset(new CompressedImage);
+    m_scanlines->update(m_image.get(), false);
+  });
+  return *m_scanlines;
+}
+
+const MaskBoundaries& BrushStamp::boundaries() const
+{
+  std::call_once(m_boundariesFlag, [this]{
+    if (m_image->pixelFormat() == IMAGE_BITMAP) {
+      m_boundaries.reset(new MaskBoundaries(m_image.get()));
+      return;
+    }
+
+    const int w = m_image->width();
+    const int h = m_image->height();
+    std::unique_ptr<Image> mask(Image::create(IMAGE_BITMAP, w, h));
+    {
+      LockImageBits<BitmapTraits> bits(mask.get());
+      auto pos = bits.begin();
+      for (int v=0; v<h; ++v) {
+        for (int u=0; u<w; ++u) {
+          *pos = get_pixel(m_image.get(), u, v);
+          ++pos;
+        }
+      }
+    }
+    m_boundaries.reset(new MaskBoundaries(mask.get()));
+  });
+  return *m_boundaries;
+}
+
+static void algo_hline(int x1, int y, int x2, void *data)
+{
+  draw_hline(reinterpret_cast<Image*>(data), x1, y, x2, BitmapTraits::max_value);
+}
+
+Image* create_brush_image(BrushType type, int brushSize, int angle)
+{
+  int size = brushSize;
+  if (type == kSquareBrushType && angle != 0 && brushSize > 2)
+    size = (int)std::sqrt((double)2*brushSize*brushSize)+2;
+
+  Image* image = Image::create(IMAGE_BITMAP, size, size);
+
+  if (size == 1) {
+    clear_image(image, BitmapTraits::max_value);
+  }
+  else {
+    clear_image(image, BitmapTraits::min_value);
+
+    switch (type) {
+
+      case kCircleBrushType:
+        fill_ellipse(image, 0, 0, size-1, size-1, BitmapTraits::max_value);
+        break;
+
+      case kSquareBrushType:
+        if (angle == 0 || size <= 2) {
+          clear_image(image, BitmapTraits::max_value);
+        }
+        else {
+          int c = size/2;
+          int r = brushSize/2;
+	  int sa = r * sin(angle * (PI / 180.0f)) + 0.5;
+	  int ca = r * cos(angle * (PI / 180.0f)) + 0.5;
+          int x1 = -ca - -sa;
+          int y1 = -sa + -ca;
+          int x2 =  ca - -sa;
+          int y2 =  sa + -ca;
+          int x3 =  ca -  sa;
+          int y3 =  ca +  sa;
+          int x4 = -ca -  sa;
+          int y4 = -sa +  ca;
+          std::array<std::pair<int,int>, 4> points {
+            std::pair<int, int>{x1 + c, y1 + c},
+            std::pair<int, int>{x4 + c, y4 + c},
+            std::pair<int, int>{x3 + c, y3 + c},
+            std::pair<int, int>{x2 + c, y2 + c}
+	  };
+
+          doc::algorithm::polygon(points, [&](int x, int y, int x2){
+            algo_hline(x, y, x2, image);
+          });
+        }
+        break;
+
+      case kLineBrushType: {
+	int r = brushSize/2;
+	int sa = r * sin(angle * (PI / 180.0)) + 0.5;
+	int ca = r * cos(angle * (PI / 180.0)) + 0.5;
+	int x1 = -ca + r;
+	int y1 = -sa + r;
+	int x2 =  ca + r;
+	int y2 =  sa + r;
+        draw_line(image, x1, y1, x2, y2, BitmapTraits::max_value);
+        break;
+      }
+    }
+  }
+
+  return image;
+}
+
+BrushStampCache::BrushStampCache()
+  : m_capacity(kDefaultCapacity)
+{
+}
+
+BrushStampRef BrushStampCache::get(BrushType type, int size, int angle)
+{
+  // The angle doesn't change these images
+  if (type == kCircleBrushType ||
+      (type == kSquareBrushType && size <= 2))
+    angle = 0;
+
+  const Key key(int(type), size, angle);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.lookups;
+
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+      ++m_stats.hits;
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      return it->second->second;
+    }
+  }
+
+  // Rasterize the image without the lock (if other thread creates
+  // the same stamp in the meantime, the first one is kept).
+  BrushStampRef stamp = std::make_shared<BrushStamp>(
+    ImageRef(create_brush_image(type, size, angle)));
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(key);
+  if (it != m_index.end())
+    return it->second->second;
+
+  m_entries.emplace_front(key, stamp);
+  m_index[key] = m_entries.begin();
+  shrink(m_capacity);
+  return stamp;
+}
+
+void BrushStampCache::setCapacity(std::size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_capacity = capacity;
+  shrink(m_capacity);
+}
+
+std::size_t BrushStampCache::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void BrushStampCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  shrink(0);
+}
+
+BrushStampCache::Stats BrushStampCache::stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+// static
+BrushStampCache& BrushStampCache::instance()
+{
+  static BrushStampCache cache;
+  return cache;
+}
+
+void BrushStampCache::shrink(std::size_t capacity)
+{
+  // Brushes that use the removed stamps keep their own references
+  while (m_entries.size() > capacity) {
+    m_index.erase(m_entries.back().first);
+    m_entries.pop_back();
+  }
+}
+
+} // namespace doc
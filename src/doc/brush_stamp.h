@@ -0,0 +1,101 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/brush_type.h"
+#include "doc/compressed_image.h"
+#include "doc/image_ref.h"
+#include "doc/mask_boundaries.h"
+#include "gfx/rect.h"
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace doc {
+
+  // A rasterized brush image with the data derived from it: its
+  // bounds (centered in the origin), its runs of pixels (to stamp
+  // it as horizontal lines) and its boundaries (to draw the brush
+  // cursor). The image must not be modified.
+  class BrushStamp {
+  public:
+    explicit BrushStamp(const ImageRef& image);
+
+    Image* image() const { return m_image.get(); }
+    const ImageRef& imageRef() const { return m_image; }
+    const gfx::Rect& bounds() const { return m_bounds; }
+
+    // These are calculated the first time they are used.
+    const CompressedImage& scanlines() const;
+    const MaskBoundaries& boundaries() const;
+
+  private:
+    ImageRef m_image;
+    gfx::Rect m_bounds;
+    mutable std::once_flag m_scanlinesFlag;
+    mutable std::once_flag m_boundariesFlag;
+    mutable std::unique_ptr<CompressedImage> m_scanlines;
+    mutable std::unique_ptr<MaskBoundaries> m_boundaries;
+
+    DISABLE_COPYING(BrushStamp);
+  };
+
+  typedef std::shared_ptr<BrushStamp> BrushStampRef;
+
+  // Creates the bitmap of a brush of the given type (except image
+  // brushes).
+  Image* create_brush_image(BrushType type, int size, int angle);
+
+  // Keeps the last used stamps of the generated brushes (circle,
+  // square and line) by type, size and angle, so brushes with the
+  // same parameters (e.g. the sizes given by the pen pressure, or a
+  // brush that is recreated when the active tool changes) don't
+  // rasterize their images again. It's thread-safe.
+  class BrushStampCache {
+  public:
+    struct Stats {
+      std::size_t lookups = 0;
+      std::size_t hits = 0;
+    };
+
+    enum { kDefaultCapacity = 256 };
+
+    BrushStampCache();
+
+    BrushStampRef get(BrushType type, int size, int angle);
+
+    // Maximum number of stamps (the least recently used ones are
+    // removed first).
+    void setCapacity(std::size_t capacity);
+    std::size_t size() const;
+    void clear();
+
+    Stats stats() const;
+
+    static BrushStampCache& instance();
+
+  private:
+    typedef std::tuple<int, int, int> Key;  // Type, size, angle
+    typedef std::list<std::pair<Key, BrushStampRef>> Entries;
+
+    void shrink(std::size_t capacity);
+
+    Entries m_entries;                  // Most recently used first
+    std::map<Key, Entries::iterator> m_index;
+    std::size_t m_capacity;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+
+    DISABLE_COPYING(BrushStampCache);
+  };
+
+} // namespace doc
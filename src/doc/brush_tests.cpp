@@ -0,0 +1,128 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/brush.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+using namespace doc;
+
+// Returns true if the scanlines cover exactly the non-transparent
+// pixels of the image.
+static bool same_pixels(const Image* image, const CompressedImage& scanlines)
+{
+  std::unique_ptr<Image> painted(Image::create(IMAGE_BITMAP, image->width(), image->height()));
+  clear_image(painted.get(), 0);
+  for (const auto& scanline : scanlines)
+    for (int x=scanline.x; x<scanline.x+scanline.w; ++x)
+      put_pixel(painted.get(), x, scanline.y, 1);
+
+  for (int y=0; y<image->height(); ++y)
+    for (int x=0; x<image->width(); ++x)
+      if ((get_pixel(image, x, y) != image->maskColor()) != (get_pixel(painted.get(), x, y) != 0))
+        return false;
+  return true;
+}
+
+TEST(Brush, ScaledImages)
+{
+  for (BrushType type : { kCircleBrushType, kSquareBrushType, kLineBrushType }) {
+    Brush brush(type, 32, 30);
+
+    for (float scale : { 1.0f, 0.5f, 0.1f, 0.5f }) {
+      Brush expected(type, std::max(1, int(32 * scale + 0.5f)), 30);
+
+      Image* image = brush.image(scale);
+      ASSERT_TRUE(image != nullptr);
+      EXPECT_EQ(expected.image()->bounds(), image->bounds());
+      EXPECT_EQ(expected.bounds(), brush.scaledBounds());
+      EXPECT_EQ(0, count_diff_between_images(expected.image(), image));
+      EXPECT_TRUE(same_pixels(image, brush.scanlines(scale)));
+    }
+
+    // The original image is kept
+    Brush original(type, 32, 30);
+    EXPECT_EQ(original.bounds(), brush.bounds());
+    EXPECT_EQ(0, count_diff_between_images(original.image(), brush.image()));
+  }
+}
+
+TEST(Brush, ScanlinesAreUpdated)
+{
+  Brush brush(kCircleBrushType, 16, 0);
+  const CompressedImage* scanlines = &brush.scanlines(1.0f);
+  EXPECT_TRUE(same_pixels(brush.image(), *scanlines));
+
+  brush.setType(kSquareBrushType);
+  scanlines = &brush.scanlines(1.0f);
+  EXPECT_TRUE(same_pixels(brush.image(), *scanlines));
+  ASSERT_EQ(16, std::distance(scanlines->begin(), scanlines->end()));
+  EXPECT_EQ(16, scanlines->begin()->w);
+}
+
+TEST(Brush, SharedStamps)
+{
+  Brush a(kLineBrushType, 20, 45);
+  Brush b(kLineBrushType, 20, 45);
+  EXPECT_EQ(a.stamp(), b.stamp());
+  EXPECT_EQ(a.image(), b.image());
+
+  // Pressure sizes are shared with the brushes of that size
+  Brush c(kLineBrushType, 10, 45);
+  EXPECT_EQ(c.stamp(), a.stamp(0.5f));
+  EXPECT_NE(a.stamp(), a.stamp(0.5f));
+
+  // Changing a brush doesn't change the shared image
+  a.setAngle(90);
+  EXPECT_NE(a.image(), b.image());
+  EXPECT_EQ(0, count_diff_between_images(Brush(kLineBrushType, 20, 45).image(), b.image()));
+
+  // The boundaries are the same of the image
+  const MaskBoundaries expected(b.image());
+  const MaskBoundaries& boundaries = b.stamp()->boundaries();
+  ASSERT_EQ(std::distance(expected.begin(), expected.end()),
+            std::distance(boundaries.begin(), boundaries.end()));
+  for (auto i=expected.begin(), j=boundaries.begin(); i!=expected.end(); ++i, ++j) {
+    EXPECT_EQ(i->bounds(), j->bounds());
+    EXPECT_EQ(i->open(), j->open());
+  }
+}
+
+TEST(BrushStampCache, LeastRecentlyUsed)
+{
+  BrushStampCache cache;
+  cache.setCapacity(2);
+
+  BrushStampRef a = cache.get(kCircleBrushType, 8, 0);
+  BrushStampRef b = cache.get(kSquareBrushType, 8, 0);
+  EXPECT_EQ(a, cache.get(kCircleBrushType, 8, 0));
+  EXPECT_EQ(a, cache.get(kCircleBrushType, 8, 30)); // Angle of circles is ignored
+  EXPECT_EQ(2, int(cache.size()));
+
+  // "b" is the least recently used one
+  BrushStampRef c = cache.get(kLineBrushType, 8, 0);
+  EXPECT_EQ(2, int(cache.size()));
+  EXPECT_EQ(a, cache.get(kCircleBrushType, 8, 0));
+  EXPECT_NE(b, cache.get(kSquareBrushType, 8, 0));
+  EXPECT_EQ(0, count_diff_between_images(b->image(),
+                                         cache.get(kSquareBrushType, 8, 0)->image()));
+
+  BrushStampCache::Stats stats = cache.stats();
+  EXPECT_EQ(8, int(stats.lookups));
+  EXPECT_EQ(4, int(stats.hits));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
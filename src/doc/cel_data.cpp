@@ -19,25 +19,244 @@ namespace doc {
 
 CelData::CelData(const ImageRef& image)
   : WithUserData(ObjectType::CelData)
-  , m_image(image)
+  , m_swapped(false)
+  , m_lastAccess(0)
+  , m_imageId(NullId)
+  , m_compressedVersion(0)
+  , m_imageBytes(0)
   , m_position(0, 0)
   , m_opacity(255)
 {
+  setResidentImage(image);
 }
 
 CelData::CelData(const CelData& celData)
   : WithUserData(ObjectType::CelData)
-  , m_image(celData.m_image)
+  , m_swapped(false)
+  , m_lastAccess(0)
+  , m_imageId(NullId)
+  , m_compressedVersion(0)
+  , m_imageBytes(0)
   , m_position(celData.m_position)
   , m_opacity(celData.m_opacity)
 {
+  setResidentImage(celData.imageRef());
+}
+
+CelData::~CelData()
+{
+  ImageSwap& swap = ImageSwap::instance();
+  if (m_swapped) {
+    std::lock_guard<std::mutex> lock(swap.mutex());
+    swap.release(m_imageId, m_slot);
+  }
+  else
+    swap.removeResidentBytes(m_imageBytes);
+}
+
+ImageRef CelData::imageRef() const
+{
+  ImageSwap& swap = ImageSwap::instance();
+  if (m_swapped) {
+    std::lock_guard<std::mutex> lock(swap.mutex());
+    swapInWithLock();
+  }
+  m_lastAccess = swap.nextAccessTick();
+  return m_image;
+}
+
+ObjectId CelData::imageId() const
+{
+  if (m_swapped)
+    return m_imageId;
+  else if (m_image)
+    return m_image->id();
+  else
+    return NullId;
+}
+
+ObjectVersion CelData::imageVersion() const
+{
+  if (m_swapped)
+    return m_slot.version;
+  else if (m_image)
+    return m_image->version();
+  else
+    return 0;
+}
+
+bool CelData::hasCompressedCopy() const
+{
+  return (!m_swapped &&
+          m_compressed &&
+          m_image &&
+          m_image->version() == m_compressedVersion);
 }
 
 void CelData::setImage(const ImageRef& image)
 {
   ASSERT(image.get());
+  m_compressed.reset();
+
+  ImageSwap& swap = ImageSwap::instance();
+  if (m_swapped) {
+    std::lock_guard<std::mutex> lock(swap.mutex());
+    if (m_swapped) {
+      swap.release(m_imageId, m_slot);
+      m_swapped = false;
+    }
+  }
+  else
+    swap.removeResidentBytes(m_imageBytes);
+
+  setResidentImage(image);
+}
+
+bool CelData::swapOut()
+{
+  ImageSwap& swap = ImageSwap::instance();
+  std::lock_guard<std::mutex> lock(swap.mutex());
+
+  if (m_swapped || !m_image || m_image.use_count() > 1)
+    return false;
+
+  ObjectId imageId = m_image->id();
+
+  // An unmodified image is swapped out to its compressed copy
+  if (hasCompressedCopy()) {
+    m_slot = ImageSwap::Slot();
+    m_slot.data = m_compressed;
+    m_slot.size = uint32_t(m_compressed->size());
+    m_slot.version = m_compressedVersion;
+    swap.addExternal(this, imageId);
+  }
+  else {
+    m_compressed.reset();
+    if (!swap.store(this, m_image.get(), m_slot))
+      return false;
+  }
+
+  swap.removeResidentBytes(m_imageBytes);
+  m_imageBytes = 0;
+  m_imageId = imageId;
+  m_swapped = true;
+  m_image.reset();
+  return true;
+}
 
+void CelData::setExternalImage(const std::string& filename,
+                               uint64_t offset, uint32_t size)
+{
+  ImageSwap::Slot slot;
+  slot.offset = offset;
+  slot.size = size;
+  slot.filename = filename;
+  m_compressed.reset();
+  setSwappedSlot(slot);
+}
+
+void CelData::setCompressedImage(const std::shared_ptr<const std::vector<uint8_t>>& data,
+                                 ObjectVersion version)
+{
+  ImageSwap::Slot slot;
+  slot.size = uint32_t(data->size());
+  slot.data = data;
+  slot.version = version;
+  m_compressed = data;
+  m_compressedVersion = version;
+  setSwappedSlot(slot);
+}
+
+bool CelData::setCompressedCopyOf(const CelData& src)
+{
+  ASSERT(&src != this);
+
+  ImageSwap& swap = ImageSwap::instance();
+  ImageSwap::Slot slot;
+  {
+    std::lock_guard<std::mutex> lock(swap.mutex());
+
+    if (src.m_swapped) {
+      slot = src.m_slot;
+
+      // The slots of the swap file are released when the source
+      // image is loaded, so the copy keeps its data in memory.
+      if (slot.filename.empty() && !slot.data) {
+        slot.data = swap.loadData(src.m_slot);
+        if (!slot.data)
+          return false;
+        slot.offset = 0;
+        slot.capacity = 0;
+      }
+    }
+    else if (src.hasCompressedCopy()) {
+      slot.size = uint32_t(src.m_compressed->size());
+      slot.data = src.m_compressed;
+      slot.version = src.m_compressedVersion;
+    }
+    else
+      return false;
+  }
+
+  m_compressed = slot.data;
+  m_compressedVersion = slot.version;
+  setSwappedSlot(slot);
+  return true;
+}
+
+void CelData::setSwappedSlot(const ImageSwap::Slot& slot)
+{
+  ImageSwap& swap = ImageSwap::instance();
+  std::lock_guard<std::mutex> lock(swap.mutex());
+
+  ObjectId imageId;
+  if (m_swapped) {
+    imageId = m_imageId;
+    swap.release(m_imageId, m_slot);
+  }
+  else {
+    ASSERT(m_image && m_image.use_count() == 1);
+    imageId = m_image->id();
+    swap.removeResidentBytes(m_imageBytes);
+    m_imageBytes = 0;
+
+    // Release the ID of the image (it's used by the external one)
+    m_image.reset();
+  }
+
+  m_slot = slot;
+  m_imageId = imageId;
+  m_swapped = true;
+  swap.addExternal(this, imageId);
+}
+
+Image* CelData::swapInWithLock() const
+{
+  // Other thread could have loaded the image while we were waiting
+  // the mutex.
+  if (!m_swapped)
+    return m_image.get();
+
+  ImageSwap& swap = ImageSwap::instance();
+  Image* image = swap.load(m_imageId, m_slot);
+  ASSERT(image);
+  if (!image)
+    return nullptr;
+
+  swap.release(m_imageId, m_slot);
+  if (m_slot.data)
+    m_compressedVersion = image->version();
+  const_cast<CelData*>(this)->setResidentImage(ImageRef(image));
+  m_swapped = false;
+  return image;
+}
+
+void CelData::setResidentImage(const ImageRef& image)
+{
   m_image = image;
+  m_imageBytes = (image ? std::size_t(image->getMemSize()): 0);
+  m_lastAccess = ImageSwap::instance().nextAccessTick();
+  ImageSwap::instance().addResidentBytes(m_imageBytes);
 }
 
 } // namespace doc
@@ -8,20 +8,77 @@
 
 #include "base/shared_ptr.h"
 #include "doc/image_ref.h"
+#include "doc/image_swap.h"
 #include "doc/object.h"
 #include "doc/with_user_data.h"
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace doc {
 
   class CelData : public WithUserData {
   public:
     CelData(const ImageRef& image);
     CelData(const CelData& celData);
+    ~CelData();
 
     const gfx::Point& position() const { return m_position; }
     int opacity() const { return m_opacity; }
-    Image* image() const { return const_cast<Image*>(m_image.get()); };
-    ImageRef imageRef() const { return m_image; }
+    Image* image() const { return imageRef().get(); };
+
+    // Returns the image loading it from the swap file if it was
+    // swapped out.
+    ImageRef imageRef() const;
+
+    // ID and version of the image (without loading it if it's
+    // swapped out).
+    ObjectId imageId() const;
+    ObjectVersion imageVersion() const;
+
+    // Writes the image in the swap file (see doc::ImageSwap) to free
+    // its memory. The image is swapped out only when it isn't used
+    // by other objects (i.e. nobody else has a ImageRef to it).
+    bool swapOut();
+    bool isSwapped() const { return m_swapped; }
+
+    // Replaces the image with one that is read from the given file
+    // (the "size" bytes at "offset" written by write_image()) the
+    // first time it's used, e.g. to restore crash recovery files
+    // without loading all images. The ID of the current image is
+    // kept, so nobody else must have a ImageRef to it.
+    void setExternalImage(const std::string& filename,
+                          uint64_t offset, uint32_t size);
+
+    // Replaces the image with the given compressed one (written with
+    // write_image()), it's decoded the first time it's used (e.g. the
+    // cels of a loaded file). The compressed copy is kept while the
+    // image isn't modified, so swapOut() can just free the decoded
+    // pixels. The ID of the current image is kept (like
+    // setExternalImage()), and the decoded image gets the given
+    // version.
+    void setCompressedImage(const std::shared_ptr<const std::vector<uint8_t>>& data,
+                            ObjectVersion version);
+
+    // Replaces the image with a copy of the image of the given cel
+    // data that shares its compressed pixels, i.e. when that image is
+    // swapped out or it has a compressed copy. The copy is decoded
+    // the first time it's used, so it doesn't need memory for pixels
+    // until then (e.g. the cels of a duplicated sprite). The ID of
+    // the current image is kept (like setCompressedImage()). Returns
+    // false if the given image is only in memory (its pixels must be
+    // copied).
+    bool setCompressedCopyOf(const CelData& src);
+
+    // True if the image is in memory and it has a compressed copy
+    // (it wasn't modified since it was decoded), so it can be swapped
+    // out without writing it.
+    bool hasCompressedCopy() const;
+
+    // Access tick (ImageSwap::nextAccessTick()) of the last time the
+    // image was used.
+    uint64_t lastAccess() const { return m_lastAccess; }
 
     void setImage(const ImageRef& image);
     void setPosition(int x, int y) {
@@ -32,12 +89,37 @@ namespace doc {
     void setOpacity(int opacity) { m_opacity = opacity; }
 
     virtual int getMemSize() const override {
+      return int(sizeof(CelData) + residentImageMemSize());
+    }
+
+    // Memory of the image (0 if it's swapped out). Unlike image(),
+    // it doesn't load the image or change its access tick.
+    std::size_t residentImageMemSize() const {
+      if (m_swapped)
+        return 0;
       ASSERT(m_image);
-      return sizeof(CelData) + m_image->getMemSize();
+      return std::size_t(m_image->getMemSize());
     }
 
   private:
-    ImageRef m_image;
+    friend class ImageSwap;
+
+    // Loads the image from the swap file (the ImageSwap mutex must
+    // be locked).
+    Image* swapInWithLock() const;
+    void setResidentImage(const ImageRef& image);
+    void setSwappedSlot(const ImageSwap::Slot& slot);
+
+    mutable ImageRef m_image;
+    mutable std::atomic<bool> m_swapped;
+    mutable std::atomic<uint64_t> m_lastAccess;
+    ObjectId m_imageId;         // ID of the swapped out image
+    ImageSwap::Slot m_slot;     // Where the swapped out image is
+    // Compressed copy of the image (and the image version it
+    // represents) given in setCompressedImage()
+    mutable std::shared_ptr<const std::vector<uint8_t>> m_compressed;
+    mutable ObjectVersion m_compressedVersion;
+    std::size_t m_imageBytes;   // Memory counted in ImageSwap::residentBytes()
     gfx::Point m_position;      // X/Y screen position
     int m_opacity;              // Opacity level
   };
@@ -14,6 +14,8 @@
 #include "doc/layer.h"
 #include "doc/sprite.h"
 
+#include <algorithm>
+
 namespace doc {
 
 CelsRange::CelsRange(const Sprite* sprite,
@@ -30,23 +32,16 @@ CelsRange::iterator::iterator()
 
 CelsRange::iterator::iterator(const Sprite* sprite, frame_t first, frame_t last, CelsRange::Flags flags)
   : m_cel(nullptr)
+  , m_layer(sprite->allLayers().begin())
+  , m_layerEnd(sprite->allLayers().end())
   , m_first(first)
   , m_last(last)
   , m_flags(flags)
 {
-  // Get first cel
-  Layer* layer = sprite->layer(sprite->firstLayer());
-  while (layer && !m_cel) {
-    for (frame_t f=first; f<=last; ++f) {
-      m_cel = layer->cel(f);
-      if (m_cel)
-        break;
-      m_cel = nullptr;
-    }
-    layer = layer->getNext();
+  if (m_layer != m_layerEnd) {
+    enterLayer();
+    findCel();
   }
-  if (m_cel && flags == CelsRange::UNIQUE)
-    m_visited.insert(m_cel->data()->id());
 }
 
 CelsRange::iterator& CelsRange::iterator::operator++()
@@ -54,31 +49,50 @@ CelsRange::iterator& CelsRange::iterator::operator++()
   if (!m_cel)
     return *this;
 
-  // Get next cel
-  Layer* layer = m_cel->layer();
-  frame_t first = m_cel->frame()+1;
-  m_cel = nullptr;
+  ++m_it;
+  findCel();
+  return *this;
+}
 
-  while (layer && !m_cel) {
-    for (frame_t f=first; f<=m_last; ++f) {
-      m_cel = layer->cel(f);
-      if (m_cel) {
-        if (m_flags == CelsRange::UNIQUE) {
-          if (m_visited.find(m_cel->data()->id()) == m_visited.end()) {
-            m_visited.insert(m_cel->data()->id());
-            break;
-          }
-          else
-            m_cel = nullptr;
-        }
-        else
-          break;
+// Puts m_it in the first cel of the current layer inside the range
+// of frames.
+void CelsRange::iterator::enterLayer()
+{
+  if ((*m_layer)->isImage()) {
+    auto layer = static_cast<const LayerImage*>(*m_layer);
+    m_itEnd = layer->getCelEnd();
+    m_it = std::lower_bound(
+      layer->getCelBegin(), m_itEnd, m_first,
+      [](const std::shared_ptr<Cel>& cel, frame_t frame) -> bool {
+        return cel->frame() < frame;
+      });
+  }
+  else
+    m_it = m_itEnd = CelConstIterator();
+}
+
+// Moves m_it to the next cel to return (starting from m_it itself).
+void CelsRange::iterator::findCel()
+{
+  for (;;) {
+    for (; m_it != m_itEnd; ++m_it) {
+      Cel* cel = m_it->get();
+      if (cel->frame() > m_last)
+        break;
+
+      if (m_flags != CelsRange::UNIQUE ||
+          m_visited.insert(cel->data()).second) {
+        m_cel = cel;
+        return;
       }
     }
-    layer = layer->getNext();
-    first = m_first;
+
+    if (++m_layer == m_layerEnd) {
+      m_cel = nullptr;
+      return;
+    }
+    enterLayer();
   }
-  return *this;
 }
 
 } // namespace doc
@@ -6,16 +6,23 @@
 
 #pragma once
 
+#include "doc/cel_list.h"
 #include "doc/frame.h"
-#include "doc/object_id.h"
+#include "doc/layer_list.h"
 
-#include <set>
 #include <memory>
+#include <unordered_set>
 
 namespace doc {
   class Cel;
+  class CelData;
   class Sprite;
 
+  // Iterates the cels of the given frames walking the cel vectors of
+  // the layers directly. The iterator gives references to the
+  // shared_ptrs stored in the layers (the reference count isn't
+  // touched, use "const auto&" in range-for loops), so they are valid
+  // while the layers/cels of the sprite aren't modified.
   class CelsRange {
   public:
     enum Flags {
@@ -39,17 +46,22 @@ namespace doc {
         return !operator==(other);
       }
 
-      std::shared_ptr<Cel> operator*() const {
-        return m_cel;
+      const std::shared_ptr<Cel>& operator*() const {
+        return *m_it;
       }
 
       iterator& operator++();
 
     private:
-      std::shared_ptr<Cel> m_cel;
+      void enterLayer();
+      void findCel();
+
+      Cel* m_cel;                       // Current cel (nullptr at the end)
+      LayerConstIterator m_layer, m_layerEnd;
+      CelConstIterator m_it, m_itEnd;   // Cels of the current layer
       frame_t m_first, m_last;
       Flags m_flags;
-      std::set<ObjectId> m_visited;
+      std::unordered_set<const CelData*> m_visited;
     };
 
     iterator begin() { return m_begin; }
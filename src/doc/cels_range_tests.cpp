@@ -0,0 +1,106 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/cel.h"
+#include "doc/cels_range.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/layers_range.h"
+#include "doc/sprite.h"
+
+#include <memory>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+  std::shared_ptr<Cel> add_cel(LayerImage* layer, frame_t frame)
+  {
+    auto cel = std::make_shared<Cel>(frame, ImageRef(Image::create(IMAGE_RGB, 4, 4)));
+    layer->addCel(cel);
+    return cel;
+  }
+
+  std::vector<Cel*> collect(CelsRange range)
+  {
+    std::vector<Cel*> cels;
+    for (const auto& cel : range)
+      cels.push_back(cel.get());
+    return cels;
+  }
+
+} // anonymous namespace
+
+TEST(CelsRange, Iterate)
+{
+  std::unique_ptr<Sprite> spr(new Sprite(IMAGE_RGB, 4, 4, 256));
+  spr->setTotalFrames(4);
+  LayerImage* lay1 = new LayerImage(spr.get());
+  LayerImage* lay2 = new LayerImage(spr.get());
+  LayerFolder* folder = new LayerFolder(spr.get());
+  spr->folder()->addLayer(lay1);
+  spr->folder()->addLayer(folder);
+  spr->folder()->addLayer(lay2);
+
+  // lay1 = A _ A B  (linked A)
+  // lay2 = _ C _ D
+  Cel* a = add_cel(lay1, 0).get();
+  auto link = Cel::createLink(lay1->cel(0));
+  link->setFrame(2);
+  lay1->addCel(link);
+  Cel* b = add_cel(lay1, 3).get();
+  Cel* c = add_cel(lay2, 1).get();
+  Cel* d = add_cel(lay2, 3).get();
+
+  EXPECT_EQ((std::vector<Cel*>{ a, link.get(), b, c, d }), collect(spr->cels()));
+  EXPECT_EQ((std::vector<Cel*>{ a, b, c, d }), collect(spr->uniqueCels()));
+  EXPECT_EQ((std::vector<Cel*>{ link.get(), b, d }), collect(spr->uniqueCels(2, 3)));
+  EXPECT_EQ((std::vector<Cel*>{ c }), collect(spr->cels(1)));
+  EXPECT_TRUE(collect(spr->cels(4)).empty());
+
+  std::vector<Layer*> layers;
+  for (Layer* layer : spr->layers())
+    layers.push_back(layer);
+  EXPECT_EQ((std::vector<Layer*>{ lay1, folder, lay2 }), layers);
+}
+
+TEST(LayersRange, NestedFoldersAndChanges)
+{
+  std::unique_ptr<Sprite> spr(new Sprite(IMAGE_RGB, 4, 4, 256));
+  LayerImage* lay1 = new LayerImage(spr.get());
+  LayerImage* lay2 = new LayerImage(spr.get());
+  LayerFolder* folder = new LayerFolder(spr.get());
+  folder->addLayer(lay2);
+  spr->folder()->addLayer(lay1);
+  spr->folder()->addLayer(folder);
+
+  EXPECT_EQ((LayerList{ lay1, folder, lay2 }), spr->allLayers());
+  EXPECT_EQ(lay2, spr->indexToLayer(LayerIndex(2)));
+  EXPECT_EQ(LayerIndex(1), spr->layerToIndex(folder));
+  EXPECT_EQ(nullptr, spr->indexToLayer(LayerIndex(3)));
+
+  spr->folder()->stackLayer(lay1, folder);
+  EXPECT_EQ((LayerList{ folder, lay2, lay1 }), spr->allLayers());
+  EXPECT_EQ(LayerIndex(2), spr->layerToIndex(lay1));
+
+  spr->folder()->removeLayer(lay1);
+  EXPECT_EQ((LayerList{ folder, lay2 }), spr->allLayers());
+  EXPECT_EQ(LayerIndex(-1), spr->layerToIndex(lay1));
+  delete lay1;
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,60 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/clear_unchanged.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <memory>
+#include <random>
+
+using namespace doc;
+
+TEST(ClearUnchanged, RandomPixels)
+{
+  std::mt19937 rnd(1);
+
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    const int w = 1 + rnd() % 100;
+    const int h = 1 + rnd() % 50;
+    std::unique_ptr<Image> orig(Image::create(format, w, h));
+    std::unique_ptr<Image> ref(Image::create(format, w, h));
+    for (int y=0; y<h; ++y)
+      for (int x=0; x<w; ++x) {
+        put_pixel(orig.get(), x, y, rnd() % 2 + 1);
+        put_pixel(ref.get(), x, y, rnd() % 2 + 1);
+      }
+
+    const color_t clearColor = (format == IMAGE_BITMAP ? 0: 7);
+    std::unique_ptr<Image> image(Image::createCopy(orig.get()));
+    const int count = algorithm::clear_unchanged_pixels(image.get(), ref.get(), clearColor);
+
+    int expectedCount = 0;
+    int errors = 0;
+    for (int y=0; y<h; ++y)
+      for (int x=0; x<w; ++x) {
+        const bool same = (get_pixel(orig.get(), x, y) == get_pixel(ref.get(), x, y));
+        const color_t expected = (same ? clearColor: get_pixel(orig.get(), x, y));
+        expectedCount += same;
+        if (get_pixel(image.get(), x, y) != expected)
+          ++errors;
+      }
+    EXPECT_EQ(0, errors) << "format " << format;
+    EXPECT_EQ(expectedCount, count) << "format " << format;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -10,27 +10,33 @@
 
 #include "doc/compressed_image.h"
 
-#include "doc/primitives.h"
+#include "doc/image_impl.h"
+#include "doc/primitives_fast.h"
 
 namespace doc {
 
-void CompressedImage::update(const Image* image, bool diffColors)
+namespace {
+
+template<typename ImageTraits>
+void update_scanlines(const Image* image, bool diffColors,
+                      CompressedImage::Scanlines& scanlines)
 {
-  m_image = image;
-  color_t c1, c2, mask = image->maskColor();
-  m_scanlines.clear();
+  typedef typename ImageTraits::pixel_t pixel_t;
+  const pixel_t mask = image->maskColor();
+  const int w = image->width();
+  pixel_t c1, c2;
 
   for (int y=0; y<image->height(); ++y) {
-    Scanline scanline(y);
+    CompressedImage::Scanline scanline(y);
 
-    for (int x=0; x<image->width(); ) {
-      c1 = get_pixel(image, x, y);
+    for (int x=0; x<w; ) {
+      c1 = get_pixel_fast<ImageTraits>(image, x, y);
       if (c1 != mask) {
         scanline.color = c1;
         scanline.x = x;
 
-        for (++x; x<image->width(); ++x) {
-          c2 = get_pixel(image, x, y);
+        for (++x; x<w; ++x) {
+          c2 = get_pixel_fast<ImageTraits>(image, x, y);
 
           if ((diffColors && c1 != c2) ||
               (!diffColors && c2 == mask))
@@ -38,7 +44,7 @@ void CompressedImage::update(const Image* image, bool diffColors)
         }
 
         scanline.w = x - scanline.x;
-        m_scanlines.push_back(scanline);
+        scanlines.push_back(scanline);
       }
       else
         ++x;
@@ -46,4 +52,21 @@ void CompressedImage::update(const Image* image, bool diffColors)
   }
 }
 
+} // anonymous namespace
+
+void CompressedImage::update(const Image* image, bool diffColors)
+{
+  m_format = image->pixelFormat();
+  m_width = image->width();
+  m_height = image->height();
+  m_scanlines.clear();
+
+  switch (m_format) {
+    case IMAGE_RGB:       update_scanlines<RgbTraits>(image, diffColors, m_scanlines); break;
+    case IMAGE_GRAYSCALE: update_scanlines<GrayscaleTraits>(image, diffColors, m_scanlines); break;
+    case IMAGE_INDEXED:   update_scanlines<IndexedTraits>(image, diffColors, m_scanlines); break;
+    case IMAGE_BITMAP:    update_scanlines<BitmapTraits>(image, diffColors, m_scanlines); break;
+  }
+}
+
 } // namespace doc
@@ -33,12 +33,17 @@ namespace doc {
     const_iterator begin() const { return m_scanlines.begin(); }
     const_iterator end() const { return m_scanlines.end(); }
 
-    PixelFormat pixelFormat() const { return m_image->pixelFormat(); }
-    int width() const { return m_image->width(); }
-    int height() const { return m_image->height(); }
+    bool empty() const { return m_scanlines.empty(); }
+    PixelFormat pixelFormat() const { return m_format; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
 
   private:
-    const Image* m_image;
+    // The image isn't referenced after update() so a CompressedImage
+    // can be kept after the image is destroyed (e.g. in a cache).
+    PixelFormat m_format = IMAGE_RGB;
+    int m_width = 0;
+    int m_height = 0;
     Scanlines m_scanlines;
   };
 
@@ -20,6 +20,8 @@
 #include "she/surface.h"
 #include "she/surface_format.h"
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace doc {
@@ -94,20 +96,139 @@ uint32_t convert_color_to_surface<false, BitmapTraits, she::kRgbaSurfaceFormat>(
     ((rgba_geta(c) << fd->alphaShift) & fd->alphaMask);
 }
 
+uint32_t pack_rgba(color_t c, const she::SurfaceFormatData* fd)
+{
+  return
+    ((rgba_getr(c) << fd->redShift  ) & fd->redMask  ) |
+    ((rgba_getg(c) << fd->greenShift) & fd->greenMask) |
+    ((rgba_getb(c) << fd->blueShift ) & fd->blueMask ) |
+    ((rgba_geta(c) << fd->alphaShift) & fd->alphaMask);
+}
+
+// Palette entries converted to the surface format. The table of the
+// last palette version (and surface format) is kept for each thread,
+// so repainting an indexed image doesn't convert the palette again.
+const uint32_t* palette_lut(const Palette* palette, const she::SurfaceFormatData* fd)
+{
+  struct Lut {
+    ObjectId paletteId = 0;
+    int modifications = 0;
+    she::SurfaceFormatData fd{};
+    uint32_t colors[256];
+  };
+  thread_local Lut lut;
+
+  const ObjectId id = palette->id();
+  if (lut.paletteId != id ||
+      lut.modifications != palette->getModifications() ||
+      std::memcmp(&lut.fd, fd, sizeof(*fd)) != 0) {
+    lut.paletteId = id;
+    lut.modifications = palette->getModifications();
+    lut.fd = *fd;
+
+    const int n = std::min(256, palette->size());
+    for (int i=0; i<n; ++i)
+      lut.colors[i] = pack_rgba(palette->getEntry(i), fd);
+    std::fill(lut.colors+n, lut.colors+256, pack_rgba(0, fd));
+  }
+  return lut.colors;
+}
+
+// Converts rows of 8-bit (indexed) or 16-bit (grayscale) pixels with
+// a table lookup for each pixel.
+template<typename SrcType, typename AddressType, typename Convert>
+void convert_rows(const Image* image, she::Surface* dst,
+  int src_x, int src_y, int dst_x, int dst_y, int w, int h, Convert convert)
+{
+  for (int v=0; v<h; ++v) {
+    auto src = (const SrcType*)image->getPixelAddress(src_x, src_y+v);
+    AddressType dst_address = AddressType(dst->getData(dst_x, dst_y+v));
+    int u = 0;
+
+    // The common 32-bpp surfaces are written 4 pixels per iteration
+    if constexpr (std::is_same_v<AddressType, uint32_t*>) {
+      for (; u+4<=w; u+=4, src+=4, dst_address+=4) {
+        const uint32_t c0 = convert(src[0]);
+        const uint32_t c1 = convert(src[1]);
+        const uint32_t c2 = convert(src[2]);
+        const uint32_t c3 = convert(src[3]);
+        dst_address[0] = c0;
+        dst_address[1] = c1;
+        dst_address[2] = c2;
+        dst_address[3] = c3;
+      }
+    }
+
+    for (; u<w; ++u, ++src) {
+      *dst_address = convert(*src);
+      ++dst_address;
+    }
+  }
+}
+
 template<typename ImageTraits, typename AddressType>
 void convert_image_to_surface_templ(const Image* image, she::Surface* dst,
   int src_x, int src_y, int dst_x, int dst_y, int w, int h, const Palette* palette, const she::SurfaceFormatData* fd)
 {
+  const bool formatMatch =
+    (fd->redShift == doc::rgba_r_shift &&
+     fd->greenShift == doc::rgba_g_shift &&
+     fd->blueShift == doc::rgba_b_shift &&
+     fd->alphaShift == doc::rgba_a_shift);
+
+  if constexpr (std::is_same_v<ImageTraits, IndexedTraits>) {
+    const uint32_t* lut = palette_lut(palette, fd);
+    convert_rows<uint8_t, AddressType>(
+      image, dst, src_x, src_y, dst_x, dst_y, w, h,
+      [lut](uint8_t c) { return lut[c]; });
+    return;
+  }
+
+  // Gray levels and alpha values are converted separately
+  if constexpr (std::is_same_v<ImageTraits, GrayscaleTraits>) {
+    uint32_t vlut[256], alut[256];
+    for (int i=0; i<256; ++i) {
+      vlut[i] =
+        ((i << fd->redShift  ) & fd->redMask  ) |
+        ((i << fd->greenShift) & fd->greenMask) |
+        ((i << fd->blueShift ) & fd->blueMask );
+      alut[i] = ((i << fd->alphaShift) & fd->alphaMask);
+    }
+    convert_rows<uint16_t, AddressType>(
+      image, dst, src_x, src_y, dst_x, dst_y, w, h,
+      [&vlut, &alut](uint16_t c) {
+        return vlut[graya_getv(c)] | alut[graya_geta(c)];
+      });
+    return;
+  }
+
+  // Bitmaps have two colors, the bits are read from each row
+  // directly (without the bit address math of LockImageBits).
+  if constexpr (std::is_same_v<ImageTraits, BitmapTraits>) {
+    uint32_t colors[2];
+    for (int i=0; i<2; ++i)
+      colors[i] = (formatMatch ?
+                   convert_color_to_surface<true, BitmapTraits, she::kRgbaSurfaceFormat>(i, palette, fd):
+                   convert_color_to_surface<false, BitmapTraits, she::kRgbaSurfaceFormat>(i, palette, fd));
+
+    for (int v=0; v<h; ++v, ++dst_y) {
+      const uint8_t* row = image->getPixelAddress(0, src_y+v);
+      AddressType dst_address = AddressType(dst->getData(dst_x, dst_y));
+      for (int x=src_x; x<src_x+w; ++x) {
+        *dst_address = colors[(row[x >> 3] >> (x & 7)) & 1];
+        ++dst_address;
+      }
+    }
+    return;
+  }
+
   const LockImageBits<ImageTraits> bits(image, gfx::Rect(src_x, src_y, w, h));
   typename LockImageBits<ImageTraits>::const_iterator src_it = bits.begin();
 #ifdef _DEBUG
   typename LockImageBits<ImageTraits>::const_iterator src_end = bits.end();
 #endif
 
-  if (fd->redShift == doc::rgba_r_shift &&
-      fd->greenShift == doc::rgba_g_shift &&
-      fd->blueShift == doc::rgba_b_shift &&
-      fd->alphaShift == doc::rgba_a_shift) {
+  if (formatMatch) {
     if constexpr (std::is_same_v<ImageTraits, RgbTraits> && std::is_same_v<AddressType, uint32_t*>) {
       for (int v=0; v<h; ++v, ++dst_y) {
           auto dst_address = AddressType(dst->getData(dst_x, dst_y));
@@ -230,4 +351,29 @@ void convert_image_to_surface(const Image* image, const Palette* palette,
   }
 }
 
+Image* create_image_view_from_surface(she::Surface* surface,
+  const gfx::Rect& bounds)
+{
+  if (bounds.isEmpty() ||
+      !gfx::Rect(0, 0, surface->width(), surface->height()).contains(bounds))
+    return nullptr;
+
+  she::SurfaceFormatData fd;
+  surface->getFormat(&fd);
+  if (fd.bitsPerPixel != 32 ||
+      fd.redShift != doc::rgba_r_shift ||
+      fd.greenShift != doc::rgba_g_shift ||
+      fd.blueShift != doc::rgba_b_shift ||
+      fd.alphaShift != doc::rgba_a_shift)
+    return nullptr;
+
+  uint8_t* bits = surface->getData(bounds.x, bounds.y);
+  int rowStrideBytes = (surface->height() > 1 ?
+                        int(surface->getData(0, 1) - surface->getData(0, 0)):
+                        4*surface->width());
+
+  return Image::createView(IMAGE_RGB, bounds.w, bounds.h,
+                           bits, rowStrideBytes);
+}
+
 } // namespace doc
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "gfx/fwd.h"
+
 namespace she {
   class Surface;
 }
@@ -18,4 +20,13 @@ namespace doc {
     she::Surface* surface,
     int src_x, int src_y, int dst_x, int dst_y, int w, int h);
 
+  // Returns an IMAGE_RGB image that writes directly into the given
+  // area of the surface, or nullptr if the surface format isn't the
+  // same as the RGB image format (in that case the image must be
+  // rendered in a temporary image and converted with
+  // convert_image_to_surface()). The surface must be locked while
+  // the image is used.
+  Image* create_image_view_from_surface(she::Surface* surface,
+    const gfx::Rect& bounds);
+
 } // namespace doc
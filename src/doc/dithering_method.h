@@ -12,6 +12,8 @@ namespace doc {
   enum class DitheringMethod {
     NONE,
     ORDERED,
+    FLOYD_STEINBERG,
+    ATKINSON,
   };
 
 } // namespace doc
@@ -0,0 +1,200 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/floodfill.h"
+#include "doc/image.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+const PixelFormat kFormats[] = { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP };
+
+// Number of times that each pixel was filled
+struct FillCount {
+  int width;
+  std::vector<int> count;
+
+  FillCount(int w, int h) : width(w), count(w*h, 0) { }
+
+  static void hline(int x1, int y, int x2, void* data) {
+    FillCount* fill = static_cast<FillCount*>(data);
+    for (int x=x1; x<=x2; ++x)
+      ++fill->count[y*fill->width + x];
+  }
+};
+
+// Few colors so there are big areas to fill
+color_t random_color(PixelFormat format, std::mt19937& rnd)
+{
+  switch (format) {
+    case IMAGE_RGB:
+      return rgba(rnd() % 2 * 40, 0, rnd() % 2 * 10, rnd() % 4 ? 255: 0);
+    case IMAGE_GRAYSCALE:
+      return graya(rnd() % 2 * 40, rnd() % 4 ? 255: 0);
+    case IMAGE_INDEXED:
+      return rnd() % 3 * 5;
+    default:
+      return rnd() % 4 ? 1: 0;
+  }
+}
+
+bool is_same_color(PixelFormat format, color_t a, color_t b, int tolerance)
+{
+  switch (format) {
+    case IMAGE_RGB:
+      return ((rgba_geta(a) == 0 && rgba_geta(b) == 0) ||
+              (std::abs(int(rgba_getr(a)) - int(rgba_getr(b))) <= tolerance &&
+               std::abs(int(rgba_getg(a)) - int(rgba_getg(b))) <= tolerance &&
+               std::abs(int(rgba_getb(a)) - int(rgba_getb(b))) <= tolerance &&
+               std::abs(int(rgba_geta(a)) - int(rgba_geta(b))) <= tolerance));
+    case IMAGE_GRAYSCALE:
+      return ((graya_geta(a) == 0 && graya_geta(b) == 0) ||
+              (std::abs(int(graya_getv(a)) - int(graya_getv(b))) <= tolerance &&
+               std::abs(int(graya_geta(a)) - int(graya_geta(b))) <= tolerance));
+    case IMAGE_INDEXED:
+      return std::abs(int(a) - int(b)) <= tolerance;
+    default:
+      return a == b;
+  }
+}
+
+// Pixels that must be filled (with a naive 4-connected search)
+std::vector<int> reference_fill(const Image* image, const Mask* mask,
+                                int x, int y, const gfx::Rect& bounds,
+                                int tolerance, bool contiguous)
+{
+  const int w = image->width();
+  std::vector<int> result(w*image->height(), 0);
+  const color_t color = get_pixel(image, x, y);
+  const gfx::Rect rc = bounds & image->bounds();
+
+  auto fillable = [&](int u, int v) {
+    return (rc.contains(gfx::Point(u, v)) &&
+            (!contiguous || !mask || mask->containsPoint(u, v)) &&
+            is_same_color(image->pixelFormat(), get_pixel(image, u, v), color, tolerance));
+  };
+
+  if (!contiguous) {
+    for (int v=rc.y; v<rc.y2(); ++v)
+      for (int u=rc.x; u<rc.x2(); ++u)
+        result[v*w + u] = fillable(u, v);
+    return result;
+  }
+
+  std::vector<gfx::Point> stack;
+  if (fillable(x, y)) {
+    result[y*w + x] = 1;
+    stack.push_back(gfx::Point(x, y));
+  }
+  while (!stack.empty()) {
+    const gfx::Point pt = stack.back();
+    stack.pop_back();
+    for (const gfx::Point& d : { gfx::Point(-1, 0), gfx::Point(1, 0),
+                                 gfx::Point(0, -1), gfx::Point(0, 1) }) {
+      const gfx::Point q = pt + d;
+      if (fillable(q.x, q.y) && !result[q.y*w + q.x]) {
+        result[q.y*w + q.x] = 1;
+        stack.push_back(q);
+      }
+    }
+  }
+  return result;
+}
+
+} // anonymous namespace
+
+TEST(FloodFill, MatchesReference)
+{
+  std::mt19937 rnd(1);
+
+  for (PixelFormat format : kFormats) {
+    for (int i=0; i<150; ++i) {
+      // Some images are wider than 64 pixels to cross words of bits
+      const int w = 1 + rnd() % 150;
+      const int h = 1 + rnd() % 50;
+      std::unique_ptr<Image> image(Image::create(format, w, h));
+      for (int y=0; y<h; ++y)
+        for (int x=0; x<w; ++x)
+          put_pixel(image.get(), x, y, random_color(format, rnd));
+
+      const int x = rnd() % w;
+      const int y = rnd() % h;
+      const int tolerance = (rnd() % 2 ? 0: 20 + rnd() % 30);
+      const bool contiguous = (rnd() % 4 != 0);
+      gfx::Rect bounds = image->bounds();
+      if (i % 3 == 0)
+        bounds = gfx::Rect(x - rnd() % 20, y - rnd() % 20, 1 + rnd() % 40, 1 + rnd() % 40);
+
+      std::unique_ptr<Mask> mask;
+      if (i % 5 == 0) {
+        mask.reset(new Mask);
+        mask->replace(gfx::Rect(rnd() % w, rnd() % h, 1 + rnd() % w, 1 + rnd() % h));
+        mask->subtract(gfx::Rect(rnd() % w, rnd() % h, 1 + rnd() % 10, 1 + rnd() % 10));
+      }
+
+      FillCount fill(w, h);
+      algorithm::floodfill(image.get(), mask.get(), x, y, bounds,
+                           tolerance, contiguous, &fill, &FillCount::hline);
+
+      std::vector<int> expected(w*h, 0);
+      if ((bounds & image->bounds()).contains(gfx::Point(x, y)))
+        expected = reference_fill(image.get(), mask.get(), x, y, bounds,
+                                  tolerance, contiguous);
+
+      int errors = 0;
+      for (int j=0; j<w*h; ++j)
+        if (fill.count[j] != expected[j])
+          ++errors;
+      EXPECT_EQ(0, errors) << "format " << format << " case " << i;
+    }
+  }
+}
+
+TEST(FloodFill, BigImages)
+{
+  // Non-contiguous fills are compared in parallel
+  for (PixelFormat format : kFormats) {
+    std::unique_ptr<Image> image(Image::create(format, 600, 500));
+    const color_t line = (format == IMAGE_RGB ? rgba(255, 255, 255, 255):
+                          format == IMAGE_GRAYSCALE ? graya(255, 255): 1);
+    clear_image(image.get(), 0);
+    for (int y=0; y<500; y+=7)
+      draw_hline(image.get(), 0, y, 598, line);
+
+    for (bool contiguous : { true, false }) {
+      FillCount fill(600, 500);
+      algorithm::floodfill(image.get(), nullptr, 599, 3, image->bounds(),
+                           0, contiguous, &fill, &FillCount::hline);
+
+      int errors = 0;
+      for (int y=0; y<500; ++y)
+        for (int x=0; x<600; ++x)
+          if (fill.count[y*600 + x] != (get_pixel(image.get(), x, y) == 0 ? 1: 0))
+            ++errors;
+      EXPECT_EQ(0, errors) << "format " << format << " contiguous " << contiguous;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -19,6 +19,7 @@ namespace doc {
 
 FrameTags::FrameTags(Sprite* sprite)
   : m_sprite(sprite)
+  , m_indexValid(false)
 {
 }
 
@@ -39,6 +40,9 @@ void FrameTags::add(FrameTag* tag)
   }
   m_tags.insert(it, tag);
   tag->setOwner(this);
+
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  m_indexValid = false;
 }
 
 void FrameTags::remove(FrameTag* tag)
@@ -49,6 +53,9 @@ void FrameTags::remove(FrameTag* tag)
     m_tags.erase(it);
 
   tag->setOwner(nullptr);
+
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  m_indexValid = false;
 }
 
 FrameTag* FrameTags::getByName(const std::string& name) const
@@ -71,32 +78,65 @@ FrameTag* FrameTags::getById(ObjectId id) const
 
 FrameTag* FrameTags::innerTag(frame_t frame) const
 {
-  const FrameTag* found = nullptr;
-  for (const FrameTag* tag : *this) {
-    if (frame >= tag->fromFrame() &&
-        frame <= tag->toFrame()) {
-      if (!found ||
-          (tag->toFrame() - tag->fromFrame()) < (found->toFrame() - found->fromFrame())) {
-        found = tag;
-      }
-    }
-  }
-  return const_cast<FrameTag*>(found);
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  const Segment* seg = findSegment(frame);
+  return (seg ? seg->inner: nullptr);
 }
 
 FrameTag* FrameTags::outerTag(frame_t frame) const
 {
-  const FrameTag* found = nullptr;
-  for (const FrameTag* tag : *this) {
-    if (frame >= tag->fromFrame() &&
-        frame <= tag->toFrame()) {
-      if (!found ||
-          (tag->toFrame() - tag->fromFrame()) > (found->toFrame() - found->fromFrame())) {
-        found = tag;
-      }
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  const Segment* seg = findSegment(frame);
+  return (seg ? seg->outer: nullptr);
+}
+
+// The index mutex must be locked.
+const FrameTags::Segment* FrameTags::findSegment(frame_t frame) const
+{
+  if (!m_indexValid)
+    rebuildIndex();
+
+  auto it = std::upper_bound(
+    m_index.begin(), m_index.end(), frame,
+    [](frame_t frame, const Segment& seg){ return frame < seg.fromFrame; });
+  if (it == m_index.begin())
+    return nullptr;
+  return &*(--it);
+}
+
+void FrameTags::rebuildIndex() const
+{
+  // The limits of all tags divide the frames in segments
+  std::vector<frame_t> limits;
+  limits.reserve(2*m_tags.size());
+  for (const FrameTag* tag : m_tags) {
+    limits.push_back(tag->fromFrame());
+    limits.push_back(tag->toFrame()+1);
+  }
+  std::sort(limits.begin(), limits.end());
+  limits.erase(std::unique(limits.begin(), limits.end()), limits.end());
+
+  m_index.clear();
+  m_index.reserve(limits.size());
+  for (frame_t frame : limits)
+    m_index.push_back(Segment{ frame, nullptr, nullptr });
+
+  // Tags are processed in the list order, so the first tag wins when
+  // several have the same size
+  for (FrameTag* tag : m_tags) {
+    const frame_t size = tag->toFrame() - tag->fromFrame();
+    auto it = std::lower_bound(limits.begin(), limits.end(), tag->fromFrame());
+    for (std::size_t i=it-limits.begin();
+         i<m_index.size() && m_index[i].fromFrame <= tag->toFrame(); ++i) {
+      Segment& seg = m_index[i];
+      if (!seg.inner || size < seg.inner->toFrame() - seg.inner->fromFrame())
+        seg.inner = tag;
+      if (!seg.outer || size > seg.outer->toFrame() - seg.outer->fromFrame())
+        seg.outer = tag;
     }
   }
-  return const_cast<FrameTag*>(found);
+
+  m_indexValid = true;
 }
 
 } // namespace doc
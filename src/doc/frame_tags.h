@@ -10,6 +10,7 @@
 #include "doc/frame.h"
 #include "doc/object_id.h"
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -44,13 +45,32 @@ namespace doc {
     std::size_t size() const { return m_tags.size(); }
     bool empty() const { return m_tags.empty(); }
 
+    // Smallest/biggest tag that contains the given frame (the first
+    // one in the list if there are several with the same size). They
+    // use an index of the frame ranges (rebuilt after tags are
+    // added/removed), so they are O(log n).
     FrameTag* innerTag(frame_t frame) const;
     FrameTag* outerTag(frame_t frame) const;
 
   private:
+    // Range of frames [fromFrame, next segment fromFrame) contained
+    // by the same tags.
+    struct Segment {
+      frame_t fromFrame;
+      FrameTag* inner;
+      FrameTag* outer;
+    };
+
+    const Segment* findSegment(frame_t frame) const;
+    void rebuildIndex() const;
+
     Sprite* m_sprite;
     List m_tags;
 
+    mutable std::vector<Segment> m_index;
+    mutable bool m_indexValid;
+    mutable std::mutex m_indexMutex;
+
     DISABLE_COPYING(FrameTags);
   };
 
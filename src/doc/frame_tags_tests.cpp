@@ -0,0 +1,93 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/frame_tag.h"
+#include "doc/frame_tags.h"
+
+#include <cstdlib>
+
+using namespace doc;
+
+namespace {
+
+// Linear search of the smallest (inner) or biggest (outer) tag
+FrameTag* find_tag(const FrameTags& tags, frame_t frame, bool inner)
+{
+  FrameTag* found = nullptr;
+  for (FrameTag* tag : tags) {
+    if (frame < tag->fromFrame() || frame > tag->toFrame())
+      continue;
+    const frame_t size = tag->toFrame() - tag->fromFrame();
+    const frame_t foundSize = (found ? found->toFrame() - found->fromFrame(): 0);
+    if (!found ||
+        (inner && size < foundSize) ||
+        (!inner && size > foundSize))
+      found = tag;
+  }
+  return found;
+}
+
+} // anonymous namespace
+
+TEST(FrameTags, InnerAndOuterTags)
+{
+  FrameTags tags(nullptr);
+  FrameTag* a = new FrameTag(0, 9);
+  FrameTag* b = new FrameTag(2, 4);
+  FrameTag* c = new FrameTag(12, 12);
+  tags.add(a);
+  tags.add(b);
+  tags.add(c);
+
+  EXPECT_EQ(a, tags.innerTag(0));
+  EXPECT_EQ(b, tags.innerTag(2));
+  EXPECT_EQ(b, tags.innerTag(4));
+  EXPECT_EQ(a, tags.innerTag(5));
+  EXPECT_EQ(a, tags.outerTag(3));
+  EXPECT_EQ(nullptr, tags.innerTag(10));
+  EXPECT_EQ(c, tags.outerTag(12));
+  EXPECT_EQ(nullptr, tags.outerTag(13));
+  EXPECT_EQ(nullptr, tags.outerTag(-1));
+
+  // Changing the range updates the index
+  b->setFrameRange(6, 20);
+  EXPECT_EQ(a, tags.innerTag(2));
+  EXPECT_EQ(c, tags.innerTag(12));
+  EXPECT_EQ(b, tags.outerTag(12));
+  EXPECT_EQ(b, tags.innerTag(20));
+
+  tags.remove(a);
+  delete a;
+  EXPECT_EQ(nullptr, tags.innerTag(0));
+  EXPECT_EQ(b, tags.innerTag(6));
+}
+
+TEST(FrameTags, SameResultsAsLinearSearch)
+{
+  std::srand(1);
+  FrameTags tags(nullptr);
+  for (int i=0; i<200; ++i) {
+    const frame_t from = std::rand() % 1000;
+    tags.add(new FrameTag(from, from + std::rand() % 100));
+  }
+
+  for (frame_t frame=-1; frame<1200; ++frame) {
+    ASSERT_EQ(find_tag(tags, frame, true), tags.innerTag(frame));
+    ASSERT_EQ(find_tag(tags, frame, false), tags.outerTag(frame));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,94 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/identical_cels.h"
+
+#include "doc/cel_data.h"
+#include "doc/image.h"
+#include "doc/image_hash.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+
+#include <vector>
+
+namespace doc {
+
+// static
+uint64_t IdenticalCels::key(const std::shared_ptr<Cel>& cel)
+{
+  // The layer and the position are part of the key, so images of
+  // different layers (or in other positions) don't compete in the
+  // same bucket.
+  uint64_t h = get_image_hash(cel->image());
+  h ^= uint64_t(reinterpret_cast<uintptr_t>(cel->layer())) * 0x9e3779b97f4a7c15ULL;
+  h ^= (uint64_t(uint32_t(cel->x())) << 32) ^ uint32_t(cel->y());
+  return h;
+}
+
+std::shared_ptr<Cel> IdenticalCels::find(const std::shared_ptr<Cel>& cel) const
+{
+  if (!cel->image())
+    return nullptr;
+
+  auto range = m_cels.equal_range(key(cel));
+  for (auto it=range.first; it!=range.second; ++it) {
+    const std::shared_ptr<Cel>& other = it->second;
+    if (other != cel &&
+        other->layer() == cel->layer() &&
+        other->dataRef() != cel->dataRef() &&
+        other->position() == cel->position() &&
+        other->opacity() == cel->opacity() &&
+        other->data()->userData() == cel->data()->userData() &&
+        is_same_image(other->image(), cel->image()))
+      return other;
+  }
+  return nullptr;
+}
+
+void IdenticalCels::add(const std::shared_ptr<Cel>& cel)
+{
+  if (cel->image())
+    m_cels.insert(std::make_pair(key(cel), cel));
+}
+
+int link_identical_cels(Sprite* sprite)
+{
+  IdenticalCels index;
+  int linked = 0;
+
+  std::vector<Layer*> layers;
+  sprite->getLayersList(layers);
+  for (Layer* layer : layers) {
+    if (!layer->isImage())
+      continue;
+
+    CelList cels;
+    layer->getCels(cels);
+    for (auto& cel : cels) {
+      // Cels already linked with a previous one are kept as they are
+      if (cel->link())
+        continue;
+
+      // Don't load swapped out images again (see ImageSwap)
+      if (cel->data()->isSwapped())
+        continue;
+
+      if (auto other = index.find(cel)) {
+        cel->setDataRef(other->dataRef());
+        ++linked;
+      }
+      else
+        index.add(cel);
+    }
+  }
+  return linked;
+}
+
+} // namespace doc
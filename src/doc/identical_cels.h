@@ -0,0 +1,48 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/cel.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+namespace doc {
+
+  class Sprite;
+
+  // Index of cels by the content of their images (see
+  // calculate_image_hash()) to find cels of the same layer with the
+  // same pixels, position, opacity and user data which aren't linked
+  // yet (e.g. each frame of an imported GIF file).
+  class IdenticalCels {
+  public:
+    IdenticalCels() { }
+
+    // Returns a cel previously added to the index that is identical
+    // to the given one (and isn't the same cel and doesn't share its
+    // data), or nullptr if there is no one.
+    std::shared_ptr<Cel> find(const std::shared_ptr<Cel>& cel) const;
+
+    void add(const std::shared_ptr<Cel>& cel);
+
+  private:
+    static uint64_t key(const std::shared_ptr<Cel>& cel);
+
+    std::unordered_multimap<uint64_t, std::shared_ptr<Cel>> m_cels;
+
+    DISABLE_COPYING(IdenticalCels);
+  };
+
+  // Links all identical cels of each layer of the sprite with the
+  // first one of them (without undo information, it's used when a
+  // sprite is loaded). Returns the number of linked cels.
+  int link_identical_cels(Sprite* sprite);
+
+} // namespace doc
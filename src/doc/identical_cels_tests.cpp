@@ -0,0 +1,83 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/cel.h"
+#include "doc/identical_cels.h"
+#include "doc/image_hash.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+
+#include <memory>
+
+using namespace doc;
+
+TEST(ImageHash, SamePixelsSameHash)
+{
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    std::unique_ptr<Image> a(Image::create(format, 13, 7));
+    std::unique_ptr<Image> b(Image::create(format, 13, 7));
+    // Padding bits of bitmaps are different (clear_image() sets them)
+    clear_image(a.get(), 1);
+    clear_image(b.get(), 0);
+    fill_rect(b.get(), 0, 0, 12, 6, 1);
+
+    EXPECT_TRUE(is_same_image(a.get(), b.get()));
+    EXPECT_EQ(calculate_image_hash(a.get()), calculate_image_hash(b.get()));
+
+    put_pixel(b.get(), 12, 6, 0);
+    EXPECT_FALSE(is_same_image(a.get(), b.get()));
+    EXPECT_NE(calculate_image_hash(a.get()), calculate_image_hash(b.get()));
+
+    std::unique_ptr<Image> c(Image::create(format, 7, 13));
+    clear_image(c.get(), 1);
+    EXPECT_FALSE(is_same_image(a.get(), c.get()));
+  }
+}
+
+TEST(IdenticalCels, LinkIdenticalCels)
+{
+  std::unique_ptr<Sprite> sprite(new Sprite(IMAGE_RGB, 16, 16, 256));
+  sprite->setTotalFrames(5);
+  LayerImage* layer = new LayerImage(sprite.get());
+  sprite->folder()->addLayer(layer);
+
+  auto createCel = [&](frame_t frame, color_t color, int x) {
+    ImageRef image(Image::create(IMAGE_RGB, 16, 16));
+    clear_image(image.get(), color);
+    auto cel = std::make_shared<Cel>(frame, image);
+    cel->setPosition(x, 0);
+    layer->addCel(cel);
+    return cel;
+  };
+
+  auto cel0 = createCel(0, rgba(255, 0, 0, 255), 0);
+  auto cel1 = createCel(1, rgba(0, 255, 0, 255), 0);
+  auto cel2 = createCel(2, rgba(255, 0, 0, 255), 0);
+  auto cel3 = createCel(3, rgba(255, 0, 0, 255), 1); // Other position
+  auto cel4 = createCel(4, rgba(0, 255, 0, 255), 0);
+
+  EXPECT_EQ(2, link_identical_cels(sprite.get()));
+  EXPECT_EQ(cel0->dataRef(), cel2->dataRef());
+  EXPECT_EQ(cel1->dataRef(), cel4->dataRef());
+  EXPECT_NE(cel0->dataRef(), cel3->dataRef());
+  EXPECT_NE(cel0->dataRef(), cel1->dataRef());
+
+  // Nothing else to link
+  EXPECT_EQ(0, link_identical_cels(sprite.get()));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
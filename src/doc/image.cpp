@@ -60,6 +60,20 @@ Image* Image::create(PixelFormat format, int width, int height,
   return NULL;
 }
 
+// static
+Image* Image::createView(PixelFormat format, int width, int height,
+                         uint8_t* bits, int rowStrideBytes,
+                         const ImageBufferPtr& buffer)
+{
+  switch (format) {
+    case IMAGE_RGB:       return new ImageImpl<RgbTraits>(width, height, bits, rowStrideBytes, buffer);
+    case IMAGE_GRAYSCALE: return new ImageImpl<GrayscaleTraits>(width, height, bits, rowStrideBytes, buffer);
+    case IMAGE_INDEXED:   return new ImageImpl<IndexedTraits>(width, height, bits, rowStrideBytes, buffer);
+    case IMAGE_BITMAP:    return new ImageImpl<BitmapTraits>(width, height, bits, rowStrideBytes, buffer);
+  }
+  return NULL;
+}
+
 // static
 Image* Image::createCopy(const Image* image, const ImageBufferPtr& buffer)
 {
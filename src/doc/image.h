@@ -8,6 +8,7 @@
 
 #include "doc/color.h"
 #include "doc/image_buffer.h"
+#include "doc/image_content.h"
 #include "doc/object.h"
 #include "doc/pixel_format.h"
 #include "gfx/clip.h"
@@ -34,6 +35,13 @@ namespace doc {
     static Image* createCopy(const Image* image,
                              const ImageBufferPtr& buffer = ImageBufferPtr());
 
+    // Creates an image over the given pixels (which must use the
+    // memory layout of the given format and live more than the
+    // image). Useful to render directly in a locked she::Surface.
+    static Image* createView(PixelFormat format, int width, int height,
+                             uint8_t* bits, int rowStrideBytes,
+                             const ImageBufferPtr& buffer = ImageBufferPtr());
+
     virtual ~Image();
 
     PixelFormat pixelFormat() const { return m_format; }
@@ -75,6 +83,24 @@ namespace doc {
     virtual void fillRect(int x1, int y1, int x2, int y2, color_t color) = 0;
     virtual void blendRect(int x1, int y1, int x2, int y2, color_t color, int opacity) = 0;
 
+    // Hash of the pixels cached by get_image_hash() (see
+    // doc/image_hash.h), it's valid while the version doesn't change.
+    struct HashCache {
+      ObjectVersion version = 0;
+      color_t maskColor = 0;
+      uint64_t hash = 0;
+    };
+    HashCache& hashCache() const { return m_hashCache; }
+
+    // Content bounds and opacity cached by get_image_content() (see
+    // doc/image_content.h), valid while the version doesn't change.
+    struct ContentCache {
+      ObjectVersion version = 0;
+      color_t maskColor = 0;
+      ImageContent content;
+    };
+    ContentCache& contentCache() const { return m_contentCache; }
+
   protected:
     Image(PixelFormat format, int width, int height);
 
@@ -83,6 +109,8 @@ namespace doc {
     int m_width;
     int m_height;
     color_t m_maskColor;  // Skipped color in merge process.
+    mutable HashCache m_hashCache;
+    mutable ContentCache m_contentCache;
   };
 
 } // namespace doc
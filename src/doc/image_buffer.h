@@ -6,29 +6,71 @@
 
 #pragma once
 
+#include "base/disable_copying.h"
 #include "base/ints.h"
+#include "base/mem_tags.h"
 #include "base/shared_ptr.h"
+#include "doc/image_buffer_pool.h"
 
-#include <vector>
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 
 namespace doc {
 
   class ImageBuffer {
   public:
-    ImageBuffer(std::size_t size = 1) : m_buffer(size) {
+    enum Init {
+      ZeroFill,       // New bytes are set to zero
+      Uninitialized,  // The user will overwrite all bytes anyway
+    };
+
+    ImageBuffer(std::size_t size = 1, Init init = ZeroFill)
+      : m_size(0), m_capacity(0), m_buffer(nullptr), m_init(init)
+      , m_tag(base::current_mem_tag()) {
+      resizeIfNecessary(size);
+    }
+
+    ~ImageBuffer() {
+      if (m_buffer)
+        base::mem_tag_free(m_tag, m_capacity);
+      ImageBufferPool::instance().release(m_buffer, m_capacity);
     }
 
-    std::size_t size() const { return m_buffer.size(); }
-    uint8_t* buffer() { return &m_buffer[0]; }
+    std::size_t size() const { return m_size; }
+    uint8_t* buffer() { return m_buffer; }
 
+    // The previous content is kept.
     void resizeIfNecessary(std::size_t size) {
-      if (size > m_buffer.size())
-        m_buffer.resize(size);
+      if (size <= m_size && m_buffer)
+        return;
+
+      if (size > m_capacity || !m_buffer) {
+        std::size_t capacity;
+        uint8_t* buffer = ImageBufferPool::instance().allocate(std::max<std::size_t>(size, 1), capacity);
+        if (m_buffer) {
+          std::memcpy(buffer, m_buffer, m_size);
+          base::mem_tag_free(m_tag, m_capacity);
+          ImageBufferPool::instance().release(m_buffer, m_capacity);
+        }
+        m_buffer = buffer;
+        m_capacity = capacity;
+        base::mem_tag_alloc(m_tag, m_capacity);
+      }
+
+      if (m_init == ZeroFill)
+        std::memset(m_buffer + m_size, 0, size - m_size);
+      m_size = size;
     }
 
   private:
-    std::vector<uint8_t> m_buffer;
+    std::size_t m_size;
+    std::size_t m_capacity;
+    uint8_t* m_buffer;
+    Init m_init;
+    base::mem_tag m_tag;  // Subsystem accounted for this buffer
+
+    DISABLE_COPYING(ImageBuffer);
   };
 
   typedef base::SharedPtr<ImageBuffer> ImageBufferPtr;
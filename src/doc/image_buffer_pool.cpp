@@ -0,0 +1,246 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/image_buffer_pool.h"
+
+#include "base/debug.h"
+#include "base/mem_tags.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace doc {
+
+namespace {
+
+// Sizes of the small blocks (multiples of 16 to keep the alignment of
+// the pixels)
+const std::size_t kSizeClasses[] = {
+  16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072
+};
+const int kNumSizeClasses = sizeof(kSizeClasses) / sizeof(kSizeClasses[0]);
+
+int size_class(std::size_t size)
+{
+  return int(std::lower_bound(kSizeClasses, kSizeClasses+kNumSizeClasses, size)
+             - kSizeClasses);
+}
+
+} // anonymous namespace
+
+struct ImageBufferPool::Chunk {
+  uint8_t* data;
+  int sizeClass;
+  int blocks;                   // Number of blocks of the chunk
+  int used = 0;                 // Blocks in use
+  int bumped = 0;               // Blocks used at least once
+  uint8_t* freeList = nullptr;  // Released blocks
+};
+
+ImageBufferPool::ImageBufferPool()
+  : m_partialChunks(kNumSizeClasses)
+  , m_maxRetainedBytes(64*1024*1024)
+{
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+  clear();
+
+  for (auto& it : m_chunks) {
+    ASSERT(it.second->used == 0);
+    delete[] it.second->data;
+    delete it.second;
+  }
+}
+
+uint8_t* ImageBufferPool::allocate(std::size_t size, std::size_t& capacity)
+{
+  if (size < kMinPooledSize) {
+    if (size <= kSizeClasses[kNumSizeClasses-1]) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return allocateSmall(size, capacity);
+    }
+    size = kMinPooledSize;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.allocations;
+
+    // Reuse a block that doesn't waste more than 1/8 of its size
+    auto it = m_blocks.lower_bound(size);
+    if (it != m_blocks.end() && it->first <= size + size/8) {
+      uint8_t* block = it->second;
+      capacity = it->first;
+      m_stats.retainedBytes -= capacity;
+      --m_stats.retainedBlocks;
+      ++m_stats.hits;
+      base::mem_tag_free(base::mem_tag::image_pool, capacity);
+      m_blocks.erase(it);
+      return block;
+    }
+  }
+
+  capacity = size;
+  return new uint8_t[size];
+}
+
+void ImageBufferPool::release(uint8_t* block, std::size_t capacity)
+{
+  if (!block)
+    return;
+
+  if (capacity < kMinPooledSize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    releaseSmall(block);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (capacity <= m_maxRetainedBytes) {
+      // Free the biggest blocks to make space for this one
+      shrink(m_maxRetainedBytes - capacity);
+
+      m_blocks.insert(std::make_pair(capacity, block));
+      m_stats.retainedBytes += capacity;
+      ++m_stats.retainedBlocks;
+      base::mem_tag_alloc(base::mem_tag::image_pool, capacity);
+      return;
+    }
+  }
+
+  delete[] block;
+}
+
+void ImageBufferPool::setMaxRetainedBytes(std::size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_maxRetainedBytes = bytes;
+  shrink(bytes);
+}
+
+void ImageBufferPool::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  shrink(0);
+
+  // Empty chunks of small blocks
+  for (auto& partial : m_partialChunks) {
+    for (auto it=partial.begin(); it!=partial.end(); ) {
+      if ((*it)->used == 0) {
+        freeChunk(*it);
+        it = partial.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+}
+
+ImageBufferPool::Stats ImageBufferPool::stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+void ImageBufferPool::shrink(std::size_t maxBytes)
+{
+  while (m_stats.retainedBytes > maxBytes) {
+    auto it = --m_blocks.end();
+    m_stats.retainedBytes -= it->first;
+    --m_stats.retainedBlocks;
+    base::mem_tag_free(base::mem_tag::image_pool, it->first);
+    delete[] it->second;
+    m_blocks.erase(it);
+  }
+}
+
+uint8_t* ImageBufferPool::allocateSmall(std::size_t size, std::size_t& capacity)
+{
+  const int cls = size_class(size);
+  const std::size_t blockSize = kSizeClasses[cls];
+  auto& partial = m_partialChunks[cls];
+
+  if (partial.empty()) {
+    Chunk* chunk = new Chunk;
+    chunk->data = new uint8_t[kArenaChunkSize];
+    chunk->sizeClass = cls;
+    chunk->blocks = int(kArenaChunkSize / blockSize);
+    m_chunks[chunk->data] = chunk;
+    partial.push_back(chunk);
+    m_stats.arenaBytes += kArenaChunkSize;
+  }
+
+  Chunk* chunk = partial.back();
+  uint8_t* block;
+  if (chunk->freeList) {
+    block = chunk->freeList;
+    std::memcpy(&chunk->freeList, block, sizeof(uint8_t*));
+  }
+  else
+    block = chunk->data + (chunk->bumped++)*blockSize;
+
+  if (++chunk->used == chunk->blocks)
+    partial.pop_back();
+
+  ++m_stats.arenaBlocks;
+  capacity = blockSize;
+  return block;
+}
+
+void ImageBufferPool::releaseSmall(uint8_t* block)
+{
+  auto it = m_chunks.upper_bound(block);
+  ASSERT(it != m_chunks.begin());
+  Chunk* chunk = (--it)->second;
+  ASSERT(block < chunk->data + kArenaChunkSize);
+
+  auto& partial = m_partialChunks[chunk->sizeClass];
+  if (chunk->used == chunk->blocks)
+    partial.push_back(chunk);
+
+  std::memcpy(block, &chunk->freeList, sizeof(uint8_t*));
+  chunk->freeList = block;
+  --m_stats.arenaBlocks;
+
+  if (--chunk->used == 0) {
+    // Keep one empty chunk for each size class (small temporary
+    // images are created and destroyed constantly)
+    if (partial.size() > 1) {
+      partial.erase(std::find(partial.begin(), partial.end(), chunk));
+      freeChunk(chunk);
+    }
+    else {
+      chunk->freeList = nullptr;
+      chunk->bumped = 0;
+    }
+  }
+}
+
+void ImageBufferPool::freeChunk(Chunk* chunk)
+{
+  m_chunks.erase(chunk->data);
+  m_stats.arenaBytes -= kArenaChunkSize;
+  delete[] chunk->data;
+  delete chunk;
+}
+
+// static
+ImageBufferPool& ImageBufferPool::instance()
+{
+  // Never destroyed, ImageBuffers in static variables can be
+  // released after the destruction of other static objects.
+  static ImageBufferPool* pool = new ImageBufferPool;
+  return *pool;
+}
+
+} // namespace doc
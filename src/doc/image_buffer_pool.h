@@ -0,0 +1,85 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/ints.h"
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace doc {
+
+  // Keeps the memory of released ImageBuffers to reuse it in the
+  // next allocations of a similar size (temporary images are created
+  // and destroyed constantly while drawing, and each new allocation
+  // of a big block is paid as page faults). The memory of the blocks
+  // isn't initialized. It's thread-safe.
+  //
+  // Small blocks (tiles, brushes, small cels) are carved from 64 KB
+  // chunks by size class instead of a heap allocation for each one,
+  // so thousands of small images don't pay the allocator overhead and
+  // are near in memory.
+  class ImageBufferPool {
+  public:
+    struct Stats {
+      std::size_t allocations = 0;    // Number of allocate() calls
+      std::size_t hits = 0;           // Allocations that reused a block
+      std::size_t retainedBytes = 0;  // Memory of the released blocks
+      std::size_t retainedBlocks = 0;
+      std::size_t arenaBytes = 0;     // Memory of the chunks of small blocks
+      std::size_t arenaBlocks = 0;    // Small blocks in use
+    };
+
+    // Blocks smaller than this aren't kept in the pool.
+    enum { kMinPooledSize = 4096 };
+
+    // Size of the chunks for small blocks.
+    enum { kArenaChunkSize = 64*1024 };
+
+    ImageBufferPool();
+    ~ImageBufferPool();
+
+    // Returns a block of at least "size" bytes, "capacity" is the
+    // real size of the block (which must be given to release()).
+    uint8_t* allocate(std::size_t size, std::size_t& capacity);
+    void release(uint8_t* block, std::size_t capacity);
+
+    // Maximum memory kept by released blocks (64 MB by default).
+    void setMaxRetainedBytes(std::size_t bytes);
+    // Frees all the retained blocks.
+    void clear();
+
+    Stats stats() const;
+
+    // Pool used by all ImageBuffers.
+    static ImageBufferPool& instance();
+
+  private:
+    struct Chunk;
+
+    void shrink(std::size_t maxBytes);
+    uint8_t* allocateSmall(std::size_t size, std::size_t& capacity);
+    void releaseSmall(uint8_t* block);
+    void freeChunk(Chunk* chunk);
+
+    // Released blocks sorted by capacity
+    std::multimap<std::size_t, uint8_t*> m_blocks;
+    // Chunks of small blocks sorted by address
+    std::map<uint8_t*, Chunk*> m_chunks;
+    // Chunks with free blocks for each size class
+    std::vector<std::vector<Chunk*>> m_partialChunks;
+    std::size_t m_maxRetainedBytes;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+
+    DISABLE_COPYING(ImageBufferPool);
+  };
+
+} // namespace doc
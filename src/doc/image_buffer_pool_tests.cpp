@@ -0,0 +1,127 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image_buffer.h"
+#include "doc/image_buffer_pool.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace doc;
+
+TEST(ImageBufferPool, ReuseBlocks)
+{
+  ImageBufferPool pool;
+  std::size_t capacity;
+
+  uint8_t* a = pool.allocate(100000, capacity);
+  EXPECT_EQ(100000, capacity);
+  pool.release(a, capacity);
+  EXPECT_EQ(100000, pool.stats().retainedBytes);
+  EXPECT_EQ(1, pool.stats().retainedBlocks);
+
+  // Similar size: the same block is used
+  uint8_t* b = pool.allocate(95000, capacity);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(100000, capacity);
+  EXPECT_EQ(1, pool.stats().hits);
+  EXPECT_EQ(0, pool.stats().retainedBytes);
+  pool.release(b, capacity);
+
+  // Too small for the retained block
+  uint8_t* c = pool.allocate(10000, capacity);
+  EXPECT_EQ(10000, capacity);
+  EXPECT_EQ(1, pool.stats().hits);
+  EXPECT_EQ(3, pool.stats().allocations);
+  pool.release(c, capacity);
+  EXPECT_EQ(110000, pool.stats().retainedBytes);
+
+  pool.setMaxRetainedBytes(50000);
+  EXPECT_EQ(10000, pool.stats().retainedBytes);
+
+  pool.clear();
+  EXPECT_EQ(0, pool.stats().retainedBytes);
+  EXPECT_EQ(0, pool.stats().retainedBlocks);
+}
+
+TEST(ImageBufferPool, SmallBlocks)
+{
+  ImageBufferPool pool;
+  std::size_t capacity;
+
+  // 8x8 RGB tile
+  uint8_t* a = pool.allocate(256, capacity);
+  EXPECT_EQ(256, capacity);
+  uint8_t* b = pool.allocate(200, capacity);
+  EXPECT_EQ(256, capacity);
+  EXPECT_EQ(a+256, b);
+  EXPECT_EQ(ImageBufferPool::kArenaChunkSize, pool.stats().arenaBytes);
+  EXPECT_EQ(2, pool.stats().arenaBlocks);
+  EXPECT_EQ(0, pool.stats().allocations);
+
+  // Released blocks are reused
+  pool.release(a, 256);
+  EXPECT_EQ(a, pool.allocate(256, capacity));
+  pool.release(a, 256);
+  pool.release(b, 256);
+  EXPECT_EQ(0, pool.stats().arenaBlocks);
+
+  // Fill more than one chunk
+  std::vector<uint8_t*> blocks;
+  for (int i=0; i<ImageBufferPool::kArenaChunkSize/1024+1; ++i) {
+    blocks.push_back(pool.allocate(1000, capacity));
+    EXPECT_EQ(1024, capacity);
+    std::fill(blocks.back(), blocks.back()+capacity, i);
+  }
+  EXPECT_EQ(3*ImageBufferPool::kArenaChunkSize, pool.stats().arenaBytes);
+  for (int i=0; i<int(blocks.size()); ++i)
+    EXPECT_EQ(uint8_t(i), blocks[i][1023]);
+  for (uint8_t* block : blocks)
+    pool.release(block, 1024);
+
+  // Just one empty chunk is kept for each size
+  EXPECT_EQ(2*ImageBufferPool::kArenaChunkSize, pool.stats().arenaBytes);
+  pool.clear();
+  EXPECT_EQ(0, pool.stats().arenaBytes);
+
+  // Bigger than the biggest small block
+  uint8_t* c = pool.allocate(3500, capacity);
+  EXPECT_EQ(ImageBufferPool::kMinPooledSize, capacity);
+  pool.release(c, capacity);
+  EXPECT_EQ(ImageBufferPool::kMinPooledSize, pool.stats().retainedBytes);
+}
+
+TEST(ImageBufferPool, ZeroFill)
+{
+  {
+    ImageBuffer buffer(8192, ImageBuffer::Uninitialized);
+    std::fill(buffer.buffer(), buffer.buffer()+buffer.size(), 0xff);
+  }
+  {
+    ImageBuffer buffer(8000);
+    for (std::size_t i=0; i<buffer.size(); ++i)
+      ASSERT_EQ(0, buffer.buffer()[i]);
+
+    buffer.buffer()[0] = 1;
+    buffer.resizeIfNecessary(16000);
+    EXPECT_EQ(16000, buffer.size());
+    EXPECT_EQ(1, buffer.buffer()[0]);
+    for (std::size_t i=1; i<buffer.size(); ++i)
+      ASSERT_EQ(0, buffer.buffer()[i]);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/image_content.h"
+
+#include "doc/algorithm/shrink_bounds.h"
+#include "doc/image.h"
+#include "doc/image_impl.h"
+#include "doc/primitives_fast.h"
+
+#include <cstdint>
+#include <mutex>
+
+namespace doc {
+
+namespace {
+
+// Mutexes to protect the Image::contentCache() of several images
+// (selected by the image address).
+std::mutex g_cacheMutexes[16];
+
+std::mutex& cache_mutex(const Image* image)
+{
+  return g_cacheMutexes[(uintptr_t(image) >> 6) & 15];
+}
+
+template<typename ImageTraits, typename Pred>
+bool all_pixels(const Image* image, Pred pred)
+{
+  for (int y=0; y<image->height(); ++y) {
+    auto it = (typename ImageTraits::const_address_t)image->getPixelAddress(0, y);
+    auto end = it + image->width();
+    for (; it != end; ++it)
+      if (!pred(*it))
+        return false;
+  }
+  return true;
+}
+
+bool is_opaque(const Image* image)
+{
+  const color_t mask = image->maskColor();
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB:
+      return all_pixels<RgbTraits>(
+        image, [](color_t c){ return (c & rgba_a_mask) == rgba_a_mask; });
+    case IMAGE_GRAYSCALE:
+      return all_pixels<GrayscaleTraits>(
+        image, [mask](uint16_t c){ return graya_geta(c) == 255 && c != mask; });
+    case IMAGE_INDEXED:
+      return all_pixels<IndexedTraits>(
+        image, [mask](uint8_t c){ return c != mask; });
+    case IMAGE_BITMAP:
+      // Bitmap pixels are bits, they cannot be iterated by address
+      for (int y=0; y<image->height(); ++y)
+        for (int x=0; x<image->width(); ++x)
+          if (get_pixel_fast<BitmapTraits>(image, x, y) == mask)
+            return false;
+      return true;
+  }
+  return false;
+}
+
+} // anonymous namespace
+
+ImageContent calculate_image_content(const Image* image)
+{
+  ImageContent content;
+  if (!algorithm::shrink_bounds(image, content.bounds, image->maskColor())) {
+    content.bounds = gfx::Rect();
+    return content;
+  }
+
+  // Only images without mask pixels in the borders can be opaque
+  content.opaque = (content.bounds == image->bounds() && is_opaque(image));
+  return content;
+}
+
+ImageContent get_image_content(const Image* image)
+{
+  const ObjectVersion version = image->version();
+  if (version == 0) {
+    ImageContent content;
+    content.bounds = image->bounds();
+    return content;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex(image));
+    const Image::ContentCache& cache = image->contentCache();
+    if (cache.version == version &&
+        cache.maskColor == image->maskColor())
+      return cache.content;
+  }
+
+  const ImageContent content = calculate_image_content(image);
+
+  std::lock_guard<std::mutex> lock(cache_mutex(image));
+  Image::ContentCache& cache = image->contentCache();
+  cache.version = version;
+  cache.maskColor = image->maskColor();
+  cache.content = content;
+  return content;
+}
+
+} // namespace doc
@@ -0,0 +1,36 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "gfx/rect.h"
+
+namespace doc {
+
+  class Image;
+
+  // What the pixels of an image cover when it's composited.
+  struct ImageContent {
+    // Bounds of the pixels that aren't the mask color (empty if all
+    // pixels are the mask color).
+    gfx::Rect bounds;
+
+    // True if no pixel is the mask color and (for RGB and grayscale
+    // images) all pixels have alpha = 255. Indexed images are opaque
+    // only if the palette entries are opaque too.
+    bool opaque = false;
+  };
+
+  ImageContent calculate_image_content(const Image* image);
+
+  // Same as calculate_image_content() but the result is cached in the
+  // image until its version changes. Images with version 0 are not
+  // scanned (their pixels can be modified without a new version),
+  // they return the whole image bounds as non-opaque content. It can
+  // be called from several threads.
+  ImageContent get_image_content(const Image* image);
+
+} // namespace doc
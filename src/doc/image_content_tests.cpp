@@ -0,0 +1,97 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image.h"
+#include "doc/image_content.h"
+#include "doc/primitives.h"
+
+#include <memory>
+
+using namespace doc;
+
+TEST(ImageContent, Empty)
+{
+  std::unique_ptr<Image> image(Image::create(IMAGE_RGB, 8, 8));
+  clear_image(image.get(), 0);
+
+  ImageContent content = calculate_image_content(image.get());
+  EXPECT_TRUE(content.bounds.isEmpty());
+  EXPECT_FALSE(content.opaque);
+}
+
+TEST(ImageContent, Bounds)
+{
+  std::unique_ptr<Image> image(Image::create(IMAGE_RGB, 8, 8));
+  clear_image(image.get(), 0);
+  put_pixel(image.get(), 2, 3, rgba(255, 0, 0, 255));
+  put_pixel(image.get(), 5, 4, rgba(0, 255, 0, 128));
+
+  ImageContent content = calculate_image_content(image.get());
+  EXPECT_EQ(gfx::Rect(2, 3, 4, 2), content.bounds);
+  EXPECT_FALSE(content.opaque);
+}
+
+TEST(ImageContent, Opaque)
+{
+  std::unique_ptr<Image> rgb(Image::create(IMAGE_RGB, 4, 4));
+  clear_image(rgb.get(), rgba(0, 0, 0, 255));
+  EXPECT_TRUE(calculate_image_content(rgb.get()).opaque);
+  put_pixel(rgb.get(), 3, 3, rgba(0, 0, 0, 254));
+  EXPECT_FALSE(calculate_image_content(rgb.get()).opaque);
+
+  std::unique_ptr<Image> gray(Image::create(IMAGE_GRAYSCALE, 4, 4));
+  clear_image(gray.get(), graya(64, 255));
+  EXPECT_TRUE(calculate_image_content(gray.get()).opaque);
+  put_pixel(gray.get(), 1, 2, graya(64, 0));
+  EXPECT_FALSE(calculate_image_content(gray.get()).opaque);
+
+  std::unique_ptr<Image> indexed(Image::create(IMAGE_INDEXED, 4, 4));
+  indexed->setMaskColor(0);
+  clear_image(indexed.get(), 1);
+  EXPECT_TRUE(calculate_image_content(indexed.get()).opaque);
+  put_pixel(indexed.get(), 2, 1, 0);
+  EXPECT_FALSE(calculate_image_content(indexed.get()).opaque);
+  EXPECT_EQ(indexed->bounds(), calculate_image_content(indexed.get()).bounds);
+
+  std::unique_ptr<Image> bitmap(Image::create(IMAGE_BITMAP, 12, 3));
+  clear_image(bitmap.get(), 1);
+  EXPECT_TRUE(calculate_image_content(bitmap.get()).opaque);
+  put_pixel(bitmap.get(), 10, 2, 0);
+  EXPECT_FALSE(calculate_image_content(bitmap.get()).opaque);
+}
+
+TEST(ImageContent, CacheFollowsVersion)
+{
+  std::unique_ptr<Image> image(Image::create(IMAGE_RGB, 8, 8));
+  clear_image(image.get(), 0);
+
+  // Version 0 isn't scanned
+  ImageContent content = get_image_content(image.get());
+  EXPECT_EQ(image->bounds(), content.bounds);
+  EXPECT_FALSE(content.opaque);
+
+  image->incrementVersion();
+  EXPECT_TRUE(get_image_content(image.get()).bounds.isEmpty());
+
+  // Same version, same cached result
+  put_pixel(image.get(), 1, 1, rgba(255, 255, 255, 255));
+  EXPECT_TRUE(get_image_content(image.get()).bounds.isEmpty());
+
+  image->incrementVersion();
+  EXPECT_EQ(gfx::Rect(1, 1, 1, 1), get_image_content(image.get()).bounds);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
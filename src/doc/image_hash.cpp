@@ -0,0 +1,132 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/image_hash.h"
+
+#include "base/hash.h"
+#include "doc/image.h"
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+namespace doc {
+
+namespace {
+
+// Mutexes to protect the Image::hashCache() of several images
+// (selected by the image address).
+std::mutex g_cacheMutexes[16];
+
+std::mutex& cache_mutex(const Image* image)
+{
+  return g_cacheMutexes[(uintptr_t(image) >> 6) & 15];
+}
+
+// Number of complete bytes of each row and the bits of the last byte
+// that belong to the image (only IMAGE_BITMAP rows end with some
+// padding bits which must be ignored).
+void row_bytes(const Image* image, int& bytes, uint8_t& lastMask)
+{
+  if (image->pixelFormat() == IMAGE_BITMAP) {
+    bytes = image->width() / 8;
+    lastMask = uint8_t((1 << (image->width() & 7)) - 1);
+  }
+  else {
+    bytes = image->getRowStrideSize();
+    lastMask = 0;
+  }
+}
+
+} // anonymous namespace
+
+uint64_t calculate_image_hash(const Image* image)
+{
+  base::hasher64 hasher;
+  hasher.update64(image->pixelFormat());
+  hasher.update64((uint64_t(image->width()) << 32) | uint32_t(image->height()));
+  hasher.update64(image->maskColor());
+
+  int bytes;
+  uint8_t lastMask;
+  row_bytes(image, bytes, lastMask);
+
+  // Hash all rows at once if there is no padding between them
+  const uint8_t* first = image->getPixelAddress(0, 0);
+  if (!lastMask &&
+      (image->height() == 1 ||
+       image->getPixelAddress(0, 1) == first + bytes)) {
+    hasher.update(first, std::size_t(bytes) * image->height());
+  }
+  else {
+    for (int y=0; y<image->height(); ++y) {
+      const uint8_t* row = image->getPixelAddress(0, y);
+      hasher.update(row, bytes);
+      if (lastMask) {
+        const uint8_t last = (row[bytes] & lastMask);
+        hasher.update(&last, 1);
+      }
+    }
+  }
+
+  return hasher.digest();
+}
+
+uint64_t get_image_hash(const Image* image)
+{
+  const ObjectVersion version = image->version();
+  if (version == 0)
+    return calculate_image_hash(image);
+
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex(image));
+    const Image::HashCache& cache = image->hashCache();
+    if (cache.version == version &&
+        cache.maskColor == image->maskColor())
+      return cache.hash;
+  }
+
+  const uint64_t hash = calculate_image_hash(image);
+
+  std::lock_guard<std::mutex> lock(cache_mutex(image));
+  Image::HashCache& cache = image->hashCache();
+  cache.version = version;
+  cache.maskColor = image->maskColor();
+  cache.hash = hash;
+  return hash;
+}
+
+bool is_same_image(const Image* a, const Image* b)
+{
+  if (a == b)
+    return true;
+
+  if (a->pixelFormat() != b->pixelFormat() ||
+      a->width() != b->width() ||
+      a->height() != b->height() ||
+      a->maskColor() != b->maskColor())
+    return false;
+
+  int bytes;
+  uint8_t lastMask;
+  row_bytes(a, bytes, lastMask);
+
+  for (int y=0; y<a->height(); ++y) {
+    const uint8_t* rowA = a->getPixelAddress(0, y);
+    const uint8_t* rowB = b->getPixelAddress(0, y);
+    if (std::memcmp(rowA, rowB, bytes) != 0)
+      return false;
+    if (lastMask && (rowA[bytes] & lastMask) != (rowB[bytes] & lastMask))
+      return false;
+  }
+  return true;
+}
+
+} // namespace doc
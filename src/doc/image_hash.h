@@ -0,0 +1,33 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <cstdint>
+
+namespace doc {
+
+  class Image;
+
+  // Non-cryptographic hash of the pixels of an image (and its format
+  // and size), the same pixels give the same hash. It uses
+  // base::hasher64, it's much faster than base/sha1 and good enough
+  // to find identical images (but two images with the same hash must
+  // be compared with is_same_image()).
+  uint64_t calculate_image_hash(const Image* image);
+
+  // Same as calculate_image_hash() but the result is cached in the
+  // image until its version changes. Images with version 0 (never
+  // modified by a command) are always hashed again, as their pixels
+  // can be modified without a new version (e.g. while they are
+  // created). It can be called from several threads.
+  uint64_t get_image_hash(const Image* image);
+
+  // Returns true if both images have the same format, size, mask
+  // color and pixels.
+  bool is_same_image(const Image* a, const Image* b);
+
+} // namespace doc
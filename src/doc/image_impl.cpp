@@ -13,27 +13,103 @@
 #include "doc/image_iterator.h"
 #include "doc/image_traits.h"
 
+#include <cstring>
+
 namespace doc {
 
+namespace {
+
+// Bits of the given row from x to x+7 (x can be unaligned)
+inline uint8_t get_bitmap_byte(const uint8_t* row, int x)
+{
+  const int shift = (x & 7);
+  if (shift == 0)
+    return row[x >> 3];
+  else
+    return uint8_t((row[x >> 3] >> shift) | (row[(x >> 3) + 1] << (8 - shift)));
+}
+
+inline void put_bitmap_bit(uint8_t* row, int x, bool value)
+{
+  if (value)
+    row[x >> 3] |= (1 << (x & 7));
+  else
+    row[x >> 3] &= ~(1 << (x & 7));
+}
+
+// Copies "w" bits from "src" (starting at bit "sx") to "dst"
+// (starting at bit "dx"), one byte at a time when possible.
+void copy_bitmap_row(uint8_t* dst, int dx, const uint8_t* src, int sx, int w)
+{
+  // Unaligned bits at the beginning of the destination
+  while (w > 0 && (dx & 7) != 0) {
+    put_bitmap_bit(dst, dx++, (src[sx >> 3] & (1 << (sx & 7))) != 0);
+    ++sx;
+    --w;
+  }
+
+  // Complete destination bytes
+  uint8_t* d = dst + (dx >> 3);
+  if ((sx & 7) == 0) {
+    const int n = (w >> 3);
+    std::memcpy(d, src + (sx >> 3), n);
+    d += n;
+    sx += n*8;
+    dx += n*8;
+    w -= n*8;
+  }
+  else {
+    for (; w >= 8; w -= 8, sx += 8, dx += 8)
+      *(d++) = get_bitmap_byte(src, sx);
+  }
+
+  // Remaining bits
+  for (; w > 0; --w, ++sx, ++dx)
+    put_bitmap_bit(dst, dx, (src[sx >> 3] & (1 << (sx & 7))) != 0);
+}
+
+} // anonymous namespace
+
 void copy_bitmaps(Image* dst, const Image* src, gfx::Clip area)
 {
   if (!area.clip(dst->width(), dst->height(), src->width(), src->height()))
     return;
 
-  // Copy process
-  ImageConstIterator<BitmapTraits> src_it(src, area.srcBounds(), area.src.x, area.src.y);
-  ImageIterator<BitmapTraits> dst_it(dst, area.dstBounds(), area.dst.x, area.dst.y);
+  for (int y=0; y<area.size.h; ++y) {
+    copy_bitmap_row(
+      (uint8_t*)dst->getPixelAddress(0, area.dst.y+y), area.dst.x,
+      (const uint8_t*)src->getPixelAddress(0, area.src.y+y), area.src.x,
+      area.size.w);
+  }
+}
 
-  int end_x = area.dst.x+area.size.w;
+void fill_bitmap_rect(Image* dst, int x1, int y1, int x2, int y2, color_t color)
+{
+  ASSERT(x1 >= 0 && x2 < dst->width() && x1 <= x2);
+  ASSERT(y1 >= 0 && y2 < dst->height() && y1 <= y2);
 
-  for (int end_y=area.dst.y+area.size.h;
-       area.dst.y<end_y;
-       ++area.dst.y, ++area.src.y) {
-    for (int x=area.dst.x; x<end_x; ++x) {
-      *dst_it = *src_it;
-      ++src_it;
-      ++dst_it;
+  const int b1 = (x1 >> 3);
+  const int b2 = (x2 >> 3);
+  // Bits of the first/last byte inside the [x1,x2] range
+  uint8_t firstMask = uint8_t(0xff << (x1 & 7));
+  uint8_t lastMask = uint8_t(0xff >> (7 - (x2 & 7)));
+  if (b1 == b2) {
+    firstMask &= lastMask;
+    lastMask = firstMask;
+  }
+
+  for (int y=y1; y<=y2; ++y) {
+    uint8_t* row = (uint8_t*)dst->getPixelAddress(0, y);
+    if (color) {
+      row[b1] |= firstMask;
+      row[b2] |= lastMask;
+    }
+    else {
+      row[b1] &= ~firstMask;
+      row[b2] &= ~lastMask;
     }
+    if (b2 > b1+1)
+      std::memset(row+b1+1, (color ? 0xff: 0), b2-b1-1);
   }
 }
 
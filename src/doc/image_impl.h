@@ -7,6 +7,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 
@@ -26,9 +27,11 @@ namespace doc {
     typedef typename Traits::address_t address_t;
     typedef typename Traits::const_address_t const_address_t;
 
+    // The rows are addressed with the stride (there is no table of
+    // row pointers), so the buffer of an image contains only pixels.
     ImageBufferPtr m_buffer;
     address_t m_bits;
-    address_t* m_rows;
+    std::ptrdiff_t m_rowStride;   // Bytes between rows
 
     inline address_t getBitsAddress() {
       return m_bits;
@@ -40,41 +43,49 @@ namespace doc {
 
     inline address_t getLineAddress(int y) {
       ASSERT(y >= 0 && y < height());
-      return m_rows[y];
+      return rowAddress(y);
     }
 
     inline const_address_t getLineAddress(int y) const {
       ASSERT(y >= 0 && y < height());
-      return m_rows[y];
+      return rowAddress(y);
+    }
+
+    inline address_t rowAddress(int y) const {
+      return (address_t)(((uint8_t*)m_bits) + y*m_rowStride);
     }
 
   public:
     inline address_t address(int x, int y) const {
-      return (address_t)(m_rows[y] + x / (Traits::pixels_per_byte == 0 ? 1 : Traits::pixels_per_byte));
+      return (address_t)(rowAddress(y) + x / (Traits::pixels_per_byte == 0 ? 1 : Traits::pixels_per_byte));
     }
 
     ImageImpl(int width, int height,
               const ImageBufferPtr& buffer)
       : Image(static_cast<PixelFormat>(Traits::pixel_format), width, height)
       , m_buffer(buffer)
+      , m_rowStride(Traits::getRowStrideBytes(width))
     {
-      std::size_t for_rows = sizeof(address_t) * height;
-      std::size_t rowstride_bytes = Traits::getRowStrideBytes(width);
-      std::size_t required_size = for_rows + rowstride_bytes*height;
+      std::size_t required_size = std::size_t(m_rowStride)*height;
 
       if (!m_buffer)
         m_buffer.reset(new ImageBuffer(required_size));
       else
         m_buffer->resizeIfNecessary(required_size);
 
-      m_rows = (address_t*)m_buffer->buffer();
-      m_bits = (address_t)(m_buffer->buffer() + for_rows);
+      m_bits = (address_t)m_buffer->buffer();
+    }
 
-      address_t addr = m_bits;
-      for (int y=0; y<height; ++y) {
-        m_rows[y] = addr;
-        addr = (address_t)(((uint8_t*)addr) + rowstride_bytes);
-      }
+    // Image that uses external pixels (e.g. a locked surface), the
+    // buffer isn't used.
+    ImageImpl(int width, int height,
+              uint8_t* bits, int rowStrideBytes,
+              const ImageBufferPtr& buffer)
+      : Image(static_cast<PixelFormat>(Traits::pixel_format), width, height)
+      , m_buffer(buffer)
+      , m_bits((address_t)bits)
+      , m_rowStride(rowStrideBytes)
+    {
     }
 
     uint8_t* getPixelAddress(int x, int y) const override {
@@ -217,6 +228,11 @@ namespace doc {
 
   template<>
   inline void ImageImpl<IndexedTraits>::clear(color_t color) {
+    if (m_rowStride != width()) {
+      for (int y=0; y<height(); ++y)
+        std::fill(rowAddress(y), rowAddress(y)+width(), color);
+      return;
+    }
     std::fill(m_bits,
               m_bits + width()*height(),
               color);
@@ -224,9 +240,26 @@ namespace doc {
 
   template<>
   inline void ImageImpl<BitmapTraits>::clear(color_t color) {
-    std::fill(m_bits,
-              m_bits + BitmapTraits::getRowStrideBytes(width()) * height(),
-              (color ? 0xff: 0x00));
+    const uint8_t value = (color ? 0xff: 0x00);
+    const int w = width();
+    if (m_rowStride*8 == w) {
+      std::fill(m_bits,
+                m_bits + m_rowStride * height(),
+                value);
+      return;
+    }
+
+    // Views don't own the bits after the last pixel of each row (nor
+    // the bytes between rows), so only the pixels of the view are
+    // modified.
+    const int bytes = w / 8;
+    const uint8_t tail = uint8_t((1 << (w % 8)) - 1);
+    for (int y=0; y<height(); ++y) {
+      uint8_t* row = rowAddress(y);
+      std::fill(row, row+bytes, value);
+      if (tail)
+        row[bytes] = (row[bytes] & ~tail) | (value & tail);
+    }
   }
 
   template<>
@@ -235,7 +268,7 @@ namespace doc {
     ASSERT(y >= 0 && y < height());
 
     std::div_t d = std::div(x, 8);
-    return ((*(m_rows[y] + d.quot)) & (1<<d.rem)) ? 1: 0;
+    return ((*(rowAddress(y) + d.quot)) & (1<<d.rem)) ? 1: 0;
   }
 
   template<>
@@ -245,15 +278,61 @@ namespace doc {
 
     std::div_t d = std::div(x, 8);
     if (color)
-      (*(m_rows[y] + d.quot)) |= (1 << d.rem);
+      (*(rowAddress(y) + d.quot)) |= (1 << d.rem);
     else
-      (*(m_rows[y] + d.quot)) &= ~(1 << d.rem);
+      (*(rowAddress(y) + d.quot)) &= ~(1 << d.rem);
+  }
+
+  void fill_bitmap_rect(Image* dst, int x1, int y1, int x2, int y2, color_t color);
+
+  // Calls f(x1, x2) for each run of set pixels in the row "y" of the
+  // bitmap between "x1" and "x2" (inclusive). Bytes with all bits
+  // clear/set are skipped/added to the run without testing each bit.
+  template<typename Func>
+  inline void for_each_bitmap_run(const Image* bitmap, int y, int x1, int x2, Func&& f) {
+    ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
+    if (x1 > x2)
+      return;
+
+    const uint8_t* row = bitmap->getPixelAddress(0, y);
+    int run = -1;               // First pixel of the current run
+    int x = x1;
+    while (x <= x2) {
+      if ((x & 7) == 0 && x+7 <= x2) {
+        const uint8_t bits = row[x >> 3];
+        if (bits == 0 || bits == 0xff) {
+          if (bits && run < 0)
+            run = x;
+          else if (!bits && run >= 0) {
+            f(run, x-1);
+            run = -1;
+          }
+          x += 8;
+          continue;
+        }
+      }
+
+      if (row[x >> 3] & (1 << (x & 7))) {
+        if (run < 0)
+          run = x;
+      }
+      else if (run >= 0) {
+        f(run, x-1);
+        run = -1;
+      }
+      ++x;
+    }
+    if (run >= 0)
+      f(run, x2);
+  }
+  template<>
+  inline void ImageImpl<BitmapTraits>::drawHLine(int x1, int y, int x2, color_t color) {
+    fill_bitmap_rect(this, x1, y, x2, y, color);
   }
 
   template<>
   inline void ImageImpl<BitmapTraits>::fillRect(int x1, int y1, int x2, int y2, color_t color) {
-    for (int y=y1; y<=y2; ++y)
-      ImageImpl<BitmapTraits>::drawHLine(x1, y, x2, color);
+    fill_bitmap_rect(this, x1, y1, x2, y2, color);
   }
 
   template<>
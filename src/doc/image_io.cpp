@@ -16,91 +16,157 @@
 #include "doc/image.h"
 #include "zlib.h"
 
+#define QOI_IMPLEMENTATION
+#include <qoi.h>
+
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 namespace doc {
 
 using namespace base::serialization;
 using namespace base::serialization::little_endian;
 
-// TODO Create a zlib wrapper for iostreams
+// Bit of the pixel format byte used to indicate that pixels are
+// encoded with QOI instead of zlib
+const int kQoiPixelsFlag = 0x80;
+
+// Bytes of the ID, pixel format, size and mask color
+const int kHeaderSize = 4+1+2+2+4;
 
-void write_image(std::ostream& os, const Image* image)
+static void write_qoi_pixels(buffer_writer& w, const Image* image)
 {
-  write32(os, image->id());
-  write8(os, image->pixelFormat());    // Pixel format
-  write16(os, image->width());         // Width
-  write16(os, image->height());        // Height
-  write32(os, image->maskColor());     // Mask color
-
-  int rowSize = image->getRowStrideSize();
-#if 0
-  {
-    for (int c=0; c<image->height(); c++)
-      os.write((char*)image->getPixelAddress(0, c), rowSize);
-  }
-#else
-  {
-    std::ostream::pos_type total_output_pos = os.tellp();
-    write32(os, 0);    // Compressed size (we update this value later)
-
-    z_stream zstream;
-    zstream.zalloc = (alloc_func)0;
-    zstream.zfree  = (free_func)0;
-    zstream.opaque = (voidpf)0;
-    int err = deflateInit(&zstream, Z_DEFAULT_COMPRESSION);
-    if (err != Z_OK)
-      throw base::Exception("ZLib error %d in deflateInit().", err);
-
-    std::vector<uint8_t> compressed(4096);
-    int total_output_bytes = 0;
-
-    for (int y=0; y<image->height(); y++) {
-      zstream.next_in = (Bytef*)image->getPixelAddress(0, y);
-      zstream.avail_in = rowSize;
-      int flush = (y == image->height()-1 ? Z_FINISH: Z_NO_FLUSH);
-
-      do {
-        zstream.next_out = (Bytef*)&compressed[0];
-        zstream.avail_out = compressed.size();
-
-        // Compress
-        err = deflate(&zstream, flush);
-        if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
-          throw base::Exception("ZLib error %d in deflate().", err);
-
-        int output_bytes = compressed.size() - zstream.avail_out;
-        if (output_bytes > 0) {
-          if (os.write((char*)&compressed[0], output_bytes).fail())
-            throw base::Exception("Error writing compressed image pixels.\n");
-
-          total_output_bytes += output_bytes;
-        }
-      } while (zstream.avail_out == 0);
-    }
-
-    err = deflateEnd(&zstream);
-    if (err != Z_OK)
-      throw base::Exception("ZLib error %d in deflateEnd().", err);
-
-    std::ostream::pos_type bak = os.tellp();
-    os.seekp(total_output_pos);
-    write32(os, total_output_bytes);
-    os.seekp(bak);
+  qoi_desc desc;
+  desc.width = image->width();
+  desc.height = image->height();
+  desc.channels = 4;
+  desc.colorspace = QOI_SRGB;
+
+  int size = 0;
+  std::unique_ptr<void, decltype(&free)> encoded(
+    qoi_encode(image->getPixelAddress(0, 0), &desc, &size), free);
+  if (!encoded)
+    throw base::Exception("Error encoding image pixels with QOI.");
+
+  w.write32(size);
+  w.write(encoded.get(), size);
+}
+
+static void read_qoi_pixels(std::istream& is, Image* image)
+{
+  int size = read32(is);
+  if (size < 1)
+    throw base::Exception("Bad compressed image.");
+
+  std::vector<uint8_t> encoded;
+  if (!read_block(is, size, encoded))
+    throw base::Exception("Error reading stream to restore image");
+
+  qoi_desc desc;
+  std::unique_ptr<void, decltype(&free)> decoded(
+    qoi_decode(&encoded[0], size, &desc, 4), free);
+  if (!decoded ||
+      int(desc.width) != image->width() ||
+      int(desc.height) != image->height())
+    throw base::Exception("Bad compressed image.");
+
+  std::copy((const uint8_t*)decoded.get(),
+            (const uint8_t*)decoded.get() + image->height()*image->getRowStrideSize(),
+            image->getPixelAddress(0, 0));
+}
+
+// The rows of the image are contiguous, so all pixels are compressed
+// with one call directly in the output buffer.
+static void write_zlib_pixels(buffer_writer& w, const Image* image, int level)
+{
+  const uLong size = uLong(image->height()) * image->getRowStrideSize();
+  const std::size_t sizeOffset = w.size();
+  w.write32(0);    // Compressed size (we update this value later)
+
+  const uLong bound = compressBound(size);
+  uLongf output_bytes = bound;
+  int err = compress2(w.reserve(bound), &output_bytes,
+                      (const Bytef*)image->getPixelAddress(0, 0), size, level);
+  if (err != Z_OK)
+    throw base::Exception("ZLib error %d in compress2().", err);
+
+  w.unreserve(bound - output_bytes);
+  w.patch32(sizeOffset, output_bytes);
+}
+
+static void read_zlib_pixels(std::istream& is, Image* image)
+{
+  const uLong uncompressed_size = uLong(image->height()) * image->getRowStrideSize();
+  const uLong avail_bytes = read32(is);
+  if (avail_bytes > compressBound(uncompressed_size))
+    throw base::Exception("Bad compressed image.");
+
+  std::vector<uint8_t> compressed;
+  if (!read_block(is, avail_bytes, compressed)) {
+    ASSERT(false);
+    throw base::Exception("Error reading stream to restore image");
   }
-#endif
+
+  uLongf output_bytes = uncompressed_size;
+  int err = uncompress((Bytef*)image->getPixelAddress(0, 0), &output_bytes,
+                       compressed.data(), avail_bytes);
+  if (err == Z_BUF_ERROR || err == Z_DATA_ERROR)
+    throw base::Exception("Bad compressed image.");
+  else if (err != Z_OK)
+    throw base::Exception("ZLib error %d in uncompress().", err);
+}
+
+void write_image(std::ostream& os, const Image* image, ImageCompression compression)
+{
+  write_image(os, image, image->id(), compression);
+}
+
+void write_image(std::ostream& os, const Image* image, ObjectId id,
+                 ImageCompression compression)
+{
+  const bool qoi = (compression == ImageCompression::Qoi &&
+                    image->pixelFormat() == IMAGE_RGB);
+
+  // The whole image is encoded in memory and written with one call
+  buffer_writer w;
+  w.write32(id);
+  w.write8(image->pixelFormat() | (qoi ? kQoiPixelsFlag: 0)); // Pixel format
+  w.write16(image->width());         // Width
+  w.write16(image->height());        // Height
+  w.write32(image->maskColor());     // Mask color
+
+  if (qoi)
+    write_qoi_pixels(w, image);
+  else
+    write_zlib_pixels(w, image,
+                      compression == ImageCompression::Zlib ?
+                      Z_DEFAULT_COMPRESSION: Z_BEST_SPEED);
+
+  if (w.flush_to(os).fail())
+    throw base::Exception("Error writing compressed image pixels.\n");
 }
 
 Image* read_image(std::istream& is, bool setId)
 {
-  ObjectId id = read32(is);
-  int pixelFormat = read8(is);          // Pixel format
-  int width = read16(is);               // Width
-  int height = read16(is);              // Height
-  uint32_t maskColor = read32(is);      // Mask color
+  std::vector<uint8_t> header;
+  if (!read_block(is, kHeaderSize, header))
+    return nullptr;
+
+  buffer_reader r(header.data(), header.size());
+  ObjectId id = r.read32();
+  int pixelFormat = r.read8();          // Pixel format
+  int width = r.read16();               // Width
+  int height = r.read16();              // Height
+  uint32_t maskColor = r.read32();      // Mask color
 
-  if ((pixelFormat != IMAGE_RGB &&
+  const bool qoi = (pixelFormat & kQoiPixelsFlag ? true: false);
+  pixelFormat &= ~kQoiPixelsFlag;
+
+  if ((qoi && pixelFormat != IMAGE_RGB) ||
+      (pixelFormat != IMAGE_RGB &&
        pixelFormat != IMAGE_GRAYSCALE &&
        pixelFormat != IMAGE_INDEXED &&
        pixelFormat != IMAGE_BITMAP) ||
@@ -109,76 +175,11 @@ Image* read_image(std::istream& is, bool setId)
     return nullptr;
 
   std::unique_ptr<Image> image(Image::create(static_cast<PixelFormat>(pixelFormat), width, height));
-  int rowSize = image->getRowStrideSize();
 
-#if 0
-  {
-    for (int c=0; c<image->height(); c++)
-      is.read((char*)image->getPixelAddress(0, c), rowSize);
-  }
-#else
-  {
-    int avail_bytes = read32(is);
-
-    z_stream zstream;
-    zstream.zalloc = (alloc_func)0;
-    zstream.zfree  = (free_func)0;
-    zstream.opaque = (voidpf)0;
-
-    int err = inflateInit(&zstream);
-    if (err != Z_OK)
-      throw base::Exception("ZLib error %d in inflateInit().", err);
-
-    int uncompressed_size = image->height() * rowSize;
-    int uncompressed_offset = 0;
-    int remain = avail_bytes;
-
-    std::vector<uint8_t> compressed(4096);
-    uint8_t* address = image->getPixelAddress(0, 0);
-    uint8_t* address_end = image->getPixelAddress(0, 0) + uncompressed_size;
-
-    while (remain > 0) {
-      int len = MIN(remain, (int)compressed.size());
-      if (is.read((char*)&compressed[0], len).fail()) {
-        ASSERT(false);
-        throw base::Exception("Error reading stream to restore image");
-      }
-
-      int bytes_read = (int)is.gcount();
-      if (bytes_read == 0) {
-        ASSERT(remain == 0);
-        break;
-      }
-
-      remain -= bytes_read;
-
-      zstream.next_in = (Bytef*)&compressed[0];
-      zstream.avail_in = (uInt)bytes_read;
-
-      do {
-        zstream.next_out = (Bytef*)address;
-        zstream.avail_out = address_end - address;
-
-        err = inflate(&zstream, Z_NO_FLUSH);
-        if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
-          throw base::Exception("ZLib error %d in inflate().", err);
-
-        int uncompressed_bytes = (int)((address_end - address) - zstream.avail_out);
-        if (uncompressed_bytes > 0) {
-          if (uncompressed_offset+uncompressed_bytes > uncompressed_size)
-            throw base::Exception("Bad compressed image.");
-
-          uncompressed_offset += uncompressed_bytes;
-          address += uncompressed_bytes;
-        }
-      } while (zstream.avail_in != 0 && zstream.avail_out == 0);
-    }
-
-    err = inflateEnd(&zstream);
-    if (err != Z_OK)
-      throw base::Exception("ZLib error %d in inflateEnd().", err);
-  }
-#endif
+  if (qoi)
+    read_qoi_pixels(is, image.get());
+  else
+    read_zlib_pixels(is, image.get());
 
   image->setMaskColor(maskColor);
   if (setId)
@@ -186,4 +187,22 @@ Image* read_image(std::istream& is, bool setId)
   return image.release();
 }
 
+void make_zlib_image_stream(std::vector<uint8_t>& output,
+                            PixelFormat pixelFormat, int width, int height,
+                            color_t maskColor,
+                            const uint8_t* zlibPixels, std::size_t size)
+{
+  buffer_writer w(kHeaderSize+4);
+  w.write32(0);                         // ID (read_image() can ignore it)
+  w.write8(pixelFormat);                // Pixel format
+  w.write16(width);                     // Width
+  w.write16(height);                    // Height
+  w.write32(maskColor);                 // Mask color
+  w.write32(uint32_t(size));            // Compressed size
+
+  output.resize(w.size() + size);
+  std::copy(w.data(), w.data()+w.size(), output.begin());
+  std::copy(zlibPixels, zlibPixels+size, output.begin()+w.size());
+}
+
 }
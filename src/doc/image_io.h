@@ -6,13 +6,42 @@
 
 #pragma once
 
+#include "doc/color.h"
+#include "doc/object_id.h"
+#include "doc/pixel_format.h"
+
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
+#include <vector>
 
 namespace doc {
 
   class Image;
 
-  void write_image(std::ostream& os, const Image* image);
+  // QOI is used for RGB images only, it's an order of magnitude
+  // faster than zlib but creates bigger streams. Other pixel formats
+  // are always compressed with zlib (with its fastest level).
+  // ZlibFast creates the same kind of streams than Zlib, so
+  // read_image() accepts all of them.
+  enum class ImageCompression { Zlib, ZlibFast, Qoi };
+
+  void write_image(std::ostream& os, const Image* image,
+                   ImageCompression compression = ImageCompression::Zlib);
+
+  // Writes the image with the given ID instead of image->id() (e.g. a
+  // copy of an image that must be read as the original one).
+  void write_image(std::ostream& os, const Image* image, ObjectId id,
+                   ImageCompression compression);
   Image* read_image(std::istream& is, bool setId = true);
 
+  // Creates the write_image() stream of an image whose pixels are
+  // already compressed with zlib (all rows, in the memory layout of
+  // the Image). E.g. the cels of .ase files can be kept compressed in
+  // memory without inflating and deflating them again.
+  void make_zlib_image_stream(std::vector<uint8_t>& output,
+                              PixelFormat pixelFormat, int width, int height,
+                              color_t maskColor,
+                              const uint8_t* zlibPixels, std::size_t size);
+
 } // namespace doc
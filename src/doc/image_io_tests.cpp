@@ -0,0 +1,120 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image.h"
+#include "doc/image_io.h"
+#include "doc/primitives.h"
+#include "doc/test_image.h"
+#include "zlib.h"
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+// Two of each three pixels are 0, so the images can be compressed
+std::unique_ptr<Image> create_sparse_image(PixelFormat format, int w, int h)
+{
+  const uint32_t mask = (format == IMAGE_BITMAP ? 1: 0xffffffff);
+  return create_random_image(
+    format, w, h,
+    [mask](std::mt19937& rnd) { return (rnd() % 3 ? 0: rnd()) & mask; });
+}
+
+} // anonymous namespace
+
+TEST(ImageIO, RoundTrip)
+{
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    for (auto compression : { ImageCompression::Zlib,
+                                ImageCompression::ZlibFast,
+                                ImageCompression::Qoi }) {
+      std::unique_ptr<Image> image = create_sparse_image(format, 67, 31);
+      image->setMaskColor(2);
+
+      std::stringstream s;
+      write_image(s, image.get(), compression);
+      std::unique_ptr<Image> result(read_image(s, false));
+      ASSERT_TRUE(result != nullptr);
+      EXPECT_EQ(format, result->pixelFormat());
+      EXPECT_EQ(2, int(result->maskColor()));
+      EXPECT_EQ(0, count_diff_between_images(image.get(), result.get()))
+        << "format " << format << " compression " << int(compression);
+    }
+  }
+}
+
+TEST(ImageIO, ConsecutiveImages)
+{
+  // QOI streams must be consumed completely to read the next object
+  std::unique_ptr<Image> a = create_sparse_image(IMAGE_RGB, 40, 40);
+  std::unique_ptr<Image> b = create_sparse_image(IMAGE_GRAYSCALE, 13, 7);
+
+  std::stringstream s;
+  write_image(s, a.get(), ImageCompression::Qoi);
+  write_image(s, b.get(), ImageCompression::Qoi);
+
+  std::unique_ptr<Image> a2(read_image(s, false));
+  std::unique_ptr<Image> b2(read_image(s, false));
+  ASSERT_TRUE(a2 != nullptr && b2 != nullptr);
+  EXPECT_EQ(0, count_diff_between_images(a.get(), a2.get()));
+  EXPECT_EQ(0, count_diff_between_images(b.get(), b2.get()));
+}
+
+TEST(ImageIO, CopyWithOriginalId)
+{
+  std::unique_ptr<Image> image = create_sparse_image(IMAGE_RGB, 20, 10);
+  const ObjectId id = image->id();
+  std::unique_ptr<Image> copy(Image::createCopy(image.get()));
+
+  std::stringstream s;
+  write_image(s, copy.get(), id, ImageCompression::Zlib);
+  image.reset();
+
+  std::unique_ptr<Image> result(read_image(s, true));
+  ASSERT_TRUE(result != nullptr);
+  EXPECT_EQ(id, result->id());
+  EXPECT_EQ(0, count_diff_between_images(copy.get(), result.get()));
+}
+
+TEST(ImageIO, ZlibImageStream)
+{
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    std::unique_ptr<Image> image = create_sparse_image(format, 23, 17);
+
+    const uLong size = uLong(image->height()) * image->getRowStrideSize();
+    std::vector<uint8_t> compressed(compressBound(size));
+    uLongf compressedSize = compressed.size();
+    ASSERT_EQ(Z_OK, compress(&compressed[0], &compressedSize,
+                             (const Bytef*)image->getPixelAddress(0, 0), size));
+
+    std::vector<uint8_t> stream;
+    make_zlib_image_stream(stream, format, 23, 17, 5,
+                           &compressed[0], compressedSize);
+
+    std::stringstream s(std::string(stream.begin(), stream.end()));
+    std::unique_ptr<Image> result(read_image(s, false));
+    ASSERT_TRUE(result != nullptr);
+    EXPECT_EQ(format, result->pixelFormat());
+    EXPECT_EQ(5, int(result->maskColor()));
+    EXPECT_EQ(0, count_diff_between_images(image.get(), result.get()));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
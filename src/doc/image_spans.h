@@ -0,0 +1,125 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "doc/image.h"
+#include "gfx/rect.h"
+
+#include <type_traits>
+
+namespace doc {
+
+  // Contiguous pixels [begin, end) of an image, "x" and "y" are the
+  // position of the first pixel.
+  template<typename Address>
+  struct ImageSpan {
+    Address begin;
+    Address end;
+    int x;
+    int y;
+
+    int size() const { return int(end - begin); }
+  };
+
+  // Rows of a rectangle of an image as contiguous ranges of pixels,
+  // it's an alternative to LockImageBits iterators for loops that
+  // can process each row as an array (without the per-pixel cost of
+  // the generic iterators):
+  //
+  //   for (const auto& span : ImageSpans<RgbTraits>(image, bounds))
+  //     for (auto it=span.begin; it!=span.end; ++it)
+  //       ...
+  //
+  // The rectangle is clipped to the image bounds. With "mergeRows",
+  // rectangles of full rows (without padding between them) are
+  // returned as just one span that covers all rows (so the loop over
+  // rows is removed), in that case the pixels of each span don't
+  // have the same "y" coordinate.
+  //
+  // Pixels of BitmapTraits images aren't addressable, so they cannot
+  // be iterated with spans.
+  template<typename ImageTraits,
+           typename Address = typename ImageTraits::address_t>
+  class ImageSpans {
+    static_assert(ImageTraits::pixels_per_byte <= 1,
+                  "ImageSpans cannot be used with bit-packed images");
+  public:
+    typedef Address address_t;
+    typedef ImageSpan<Address> Span;
+    typedef typename std::conditional<
+      std::is_const<typename std::remove_pointer<Address>::type>::value,
+      const Image*, Image*>::type image_t;
+
+    class iterator {
+    public:
+      iterator(const ImageSpans* spans, int y) : m_spans(spans), m_y(y) { }
+
+      Span operator*() const { return m_spans->span(m_y); }
+      iterator& operator++() {
+        m_y = (m_spans->m_merged ? m_spans->m_bounds.y2(): m_y+1);
+        return *this;
+      }
+      bool operator==(const iterator& other) const { return m_y == other.m_y; }
+      bool operator!=(const iterator& other) const { return m_y != other.m_y; }
+
+    private:
+      const ImageSpans* m_spans;
+      int m_y;
+    };
+
+    ImageSpans(image_t image, const gfx::Rect& bounds, bool mergeRows = false)
+      : m_image(image)
+      , m_bounds(bounds.createIntersection(image->bounds()))
+      , m_merged(false) {
+      // All rows of an image have the same stride, so just the first
+      // two rows are compared to know if there is padding.
+      if (mergeRows && !m_bounds.isEmpty() &&
+          m_bounds.x == 0 && m_bounds.w == image->width()) {
+        m_merged = (m_bounds.h == 1 ||
+                    rowAddress(m_bounds.y+1) == rowAddress(m_bounds.y) + m_bounds.w);
+      }
+    }
+
+    explicit ImageSpans(image_t image, bool mergeRows = false)
+      : ImageSpans(image, image->bounds(), mergeRows) {
+    }
+
+    iterator begin() const {
+      return iterator(this, m_bounds.isEmpty() ? m_bounds.y2(): m_bounds.y);
+    }
+    iterator end() const { return iterator(this, m_bounds.y2()); }
+
+    // Row "y" (or all rows if they were merged)
+    Span span(int y) const {
+      if (m_merged)
+        y = m_bounds.y;
+      Span span;
+      span.begin = rowAddress(y);
+      span.end = span.begin + (m_merged ? m_bounds.w*m_bounds.h: m_bounds.w);
+      span.x = m_bounds.x;
+      span.y = y;
+      return span;
+    }
+
+    const gfx::Rect& bounds() const { return m_bounds; }
+    bool isMerged() const { return m_merged; }
+
+  private:
+    address_t rowAddress(int y) const {
+      return (address_t)m_image->getPixelAddress(m_bounds.x, y);
+    }
+
+    image_t m_image;
+    gfx::Rect m_bounds;
+    bool m_merged;
+  };
+
+  // Read-only spans
+  template<typename ImageTraits>
+  using ImageConstSpans = ImageSpans<ImageTraits, typename ImageTraits::const_address_t>;
+
+} // namespace doc
@@ -0,0 +1,172 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+// Compares the time to process all pixels of an image with
+// LockImageBits iterators and with ImageSpans (reading, writing, and
+// the resize/flip algorithms that use spans). Results are printed in
+// CSV format:
+//
+//   image_spans_benchmark [--size WxH] [--iterations N]
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/algorithm/flip_image.h"
+#include "doc/algorithm/resize_image.h"
+#include "doc/image_impl.h"
+#include "doc/image_spans.h"
+#include "doc/primitives.h"
+#include "doc/primitives_fast.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+using namespace doc;
+
+namespace {
+
+struct Options {
+  int width = 1024;
+  int height = 1024;
+  int iterations = 20;
+};
+
+typedef std::chrono::steady_clock clock_type;
+
+template<typename Func>
+double measure(const Options& options, Func func)
+{
+  func();                       // Warm up
+  const clock_type::time_point start = clock_type::now();
+  for (int i=0; i<options.iterations; ++i)
+    func();
+  return std::chrono::duration<double, std::milli>(clock_type::now() - start).count()
+    / options.iterations;
+}
+
+void print(const char* format, const char* test, double iteratorsMs, double spansMs)
+{
+  std::printf("%s,%s,%.3f,%.3f,%.2f\n", format, test,
+              iteratorsMs, spansMs, iteratorsMs / spansMs);
+  std::fflush(stdout);
+}
+
+// Old resize_image_nearest() (with iterators and get_pixel_fast())
+template<typename ImageTraits>
+void resize_with_iterators(const Image* src, Image* dst)
+{
+  double x_ratio = double(src->width()) / double(dst->width());
+  double y_ratio = double(src->height()) / double(dst->height());
+  LockImageBits<ImageTraits> dstBits(dst);
+  auto dstIt = dstBits.begin();
+  for (int y=0; y<dst->height(); ++y) {
+    double py = std::floor(y * y_ratio);
+    for (int x=0; x<dst->width(); ++x, ++dstIt)
+      *dstIt = get_pixel_fast<ImageTraits>(src, std::floor(x * x_ratio), py);
+  }
+}
+
+template<typename ImageTraits>
+void run(const Options& options, const char* format)
+{
+  std::unique_ptr<Image> image(Image::create(ImageTraits::pixel_format,
+                                             options.width, options.height));
+  std::unique_ptr<Image> dst(Image::create(ImageTraits::pixel_format,
+                                           options.width*3/2, options.height*3/2));
+  clear_image(image.get(), 1);
+  volatile uint32_t result = 0;
+
+  print(format, "read",
+        measure(options, [&]{
+          uint32_t sum = 0;
+          const LockImageBits<ImageTraits> bits(image.get());
+          for (auto it=bits.begin(), end=bits.end(); it!=end; ++it)
+            sum += *it;
+          result = sum;
+        }),
+        measure(options, [&]{
+          uint32_t sum = 0;
+          for (const auto& span : ImageConstSpans<ImageTraits>(image.get(), true))
+            for (auto it=span.begin; it!=span.end; ++it)
+              sum += *it;
+          result = sum;
+        }));
+
+  print(format, "write",
+        measure(options, [&]{
+          LockImageBits<ImageTraits> bits(image.get(), Image::WriteLock);
+          for (auto it=bits.begin(), end=bits.end(); it!=end; ++it)
+            *it = *it + 1;
+        }),
+        measure(options, [&]{
+          for (const auto& span : ImageSpans<ImageTraits>(image.get(), true))
+            for (auto it=span.begin; it!=span.end; ++it)
+              *it = *it + 1;
+        }));
+
+  print(format, "resize_nearest",
+        measure(options, [&]{
+          resize_with_iterators<ImageTraits>(image.get(), dst.get());
+        }),
+        measure(options, [&]{
+          algorithm::resize_image(image.get(), dst.get(),
+                                  algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR,
+                                  nullptr, nullptr, -1);
+        }));
+
+  // The generic (get/put_pixel) version is used outside the image
+  const gfx::Rect bounds = image->bounds();
+  const gfx::Rect outside(-1, -1, bounds.w+2, bounds.h+2);
+  print(format, "flip_horizontal",
+        measure(options, [&]{
+          algorithm::flip_image(image.get(), outside, algorithm::FlipHorizontal);
+        }),
+        measure(options, [&]{
+          algorithm::flip_image(image.get(), bounds, algorithm::FlipHorizontal);
+        }));
+  (void)result;
+}
+
+bool parse_args(int argc, char** argv, Options& options)
+{
+  for (int i=1; i<argc; ++i) {
+    if (std::strcmp(argv[i], "--size") == 0 && i+1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+          options.width < 1 || options.height < 1)
+        return false;
+    }
+    else if (std::strcmp(argv[i], "--iterations") == 0 && i+1 < argc) {
+      options.iterations = std::atoi(argv[++i]);
+      if (options.iterations < 1)
+        return false;
+    }
+    else
+      return false;
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parse_args(argc, argv, options)) {
+    std::fprintf(stderr, "Usage: %s [--size WxH] [--iterations N]\n", argv[0]);
+    return 1;
+  }
+
+  std::printf("format,test,iterators_ms,spans_ms,speedup\n");
+  run<RgbTraits>(options, "rgb");
+  run<GrayscaleTraits>(options, "grayscale");
+  run<IndexedTraits>(options, "indexed");
+  return 0;
+}
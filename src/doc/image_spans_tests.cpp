@@ -0,0 +1,179 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/flip_image.h"
+#include "doc/algorithm/resize_image.h"
+#include "doc/image_impl.h"
+#include "doc/image_spans.h"
+#include "doc/primitives.h"
+#include "doc/test_image.h"
+
+#include <memory>
+#include <vector>
+
+using namespace doc;
+
+template<typename T>
+class ImageSpansAllTypes : public testing::Test {
+protected:
+  ImageSpansAllTypes() { }
+};
+
+typedef testing::Types<RgbTraits, GrayscaleTraits, IndexedTraits> ImageAllTraits;
+TYPED_TEST_CASE(ImageSpansAllTypes, ImageAllTraits);
+
+TYPED_TEST(ImageSpansAllTypes, SpansMatchIterators)
+{
+  typedef TypeParam ImageTraits;
+  std::unique_ptr<Image> image = create_random_image(ImageTraits::pixel_format, 23, 17);
+
+  for (const gfx::Rect& rc : { gfx::Rect(0, 0, 23, 17),
+                               gfx::Rect(3, 2, 10, 7),
+                               gfx::Rect(22, 16, 1, 1) }) {
+    const LockImageBits<ImageTraits> bits(image.get(), rc);
+    auto it = bits.begin();
+    int rows = 0;
+    for (const auto& span : ImageConstSpans<ImageTraits>(image.get(), rc)) {
+      EXPECT_EQ(rc.x, span.x);
+      EXPECT_EQ(rc.y + rows, span.y);
+      EXPECT_EQ(rc.w, span.size());
+      for (auto p=span.begin; p!=span.end; ++p, ++it)
+        EXPECT_EQ(*it, *p);
+      ++rows;
+    }
+    EXPECT_EQ(rc.h, rows);
+    EXPECT_TRUE(it == bits.end());
+  }
+}
+
+TYPED_TEST(ImageSpansAllTypes, MergeRows)
+{
+  typedef TypeParam ImageTraits;
+  std::unique_ptr<Image> image = create_random_image(ImageTraits::pixel_format, 13, 9);
+
+  // Full rows are merged in just one span
+  ImageSpans<ImageTraits> all(image.get(), gfx::Rect(0, 2, 13, 5), true);
+  EXPECT_TRUE(all.isMerged());
+  int n = 0;
+  for (const auto& span : all) {
+    EXPECT_EQ(0, span.x);
+    EXPECT_EQ(2, span.y);
+    EXPECT_EQ(13*5, span.size());
+    EXPECT_EQ((void*)image->getPixelAddress(0, 2), (void*)span.begin);
+    ++n;
+  }
+  EXPECT_EQ(1, n);
+
+  // Partial rows cannot be merged
+  ImageSpans<ImageTraits> part(image.get(), gfx::Rect(1, 2, 12, 5), true);
+  EXPECT_FALSE(part.isMerged());
+  n = 0;
+  for (const auto& span : part) {
+    EXPECT_EQ(12, span.size());
+    ++n;
+  }
+  EXPECT_EQ(5, n);
+}
+
+TYPED_TEST(ImageSpansAllTypes, ClipAndEmpty)
+{
+  typedef TypeParam ImageTraits;
+  std::unique_ptr<Image> image = create_random_image(ImageTraits::pixel_format, 8, 8);
+
+  ImageSpans<ImageTraits> clipped(image.get(), gfx::Rect(-2, 6, 5, 10));
+  EXPECT_EQ(gfx::Rect(0, 6, 3, 2), clipped.bounds());
+  int n = 0;
+  for (const auto& span : clipped) {
+    EXPECT_EQ(3, span.size());
+    ++n;
+  }
+  EXPECT_EQ(2, n);
+
+  ImageSpans<ImageTraits> outside(image.get(), gfx::Rect(10, 10, 4, 4), true);
+  EXPECT_TRUE(outside.begin() == outside.end());
+}
+
+TYPED_TEST(ImageSpansAllTypes, FlipImage)
+{
+  typedef TypeParam ImageTraits;
+  std::unique_ptr<Image> image = create_random_image(ImageTraits::pixel_format, 11, 7);
+  std::unique_ptr<Image> orig(Image::createCopy(image.get()));
+  const gfx::Rect rc(1, 1, 8, 5);
+
+  algorithm::flip_image(image.get(), rc, algorithm::FlipHorizontal);
+  for (int y=0; y<7; ++y)
+    for (int x=0; x<11; ++x) {
+      int u = (rc.contains(gfx::Point(x, y)) ? rc.x2()-1-(x-rc.x): x);
+      EXPECT_EQ(get_pixel(orig.get(), u, y), get_pixel(image.get(), x, y));
+    }
+
+  image.reset(Image::createCopy(orig.get()));
+  algorithm::flip_image(image.get(), rc, algorithm::FlipVertical);
+  for (int y=0; y<7; ++y)
+    for (int x=0; x<11; ++x) {
+      int v = (rc.contains(gfx::Point(x, y)) ? rc.y2()-1-(y-rc.y): y);
+      EXPECT_EQ(get_pixel(orig.get(), x, v), get_pixel(image.get(), x, y));
+    }
+}
+
+TYPED_TEST(ImageSpansAllTypes, ResizeNearest)
+{
+  typedef TypeParam ImageTraits;
+  std::unique_ptr<Image> src = create_random_image(ImageTraits::pixel_format, 7, 5);
+  std::unique_ptr<Image> dst(Image::create(ImageTraits::pixel_format, 17, 3));
+
+  algorithm::resize_image(src.get(), dst.get(),
+                          algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR,
+                          nullptr, nullptr, -1);
+
+  for (int y=0; y<3; ++y)
+    for (int x=0; x<17; ++x)
+      EXPECT_EQ(get_pixel(src.get(), int(x * 7.0 / 17.0), int(y * 5.0 / 3.0)),
+                get_pixel(dst.get(), x, y));
+}
+
+TEST(ImageSpans, BitmapRuns)
+{
+  std::unique_ptr<Image> image(Image::create(IMAGE_BITMAP, 40, 1));
+  clear_image(image.get(), 0);
+  fill_rect(image.get(), 3, 0, 5, 0, 1);   // Inside a byte
+  fill_rect(image.get(), 7, 0, 25, 0, 1);  // Over full bytes
+  fill_rect(image.get(), 39, 0, 39, 0, 1); // Last pixel
+
+  for (int x1=0; x1<40; ++x1) {
+    for (int x2=x1; x2<40; ++x2) {
+      std::vector<bool> expected(40, false), found(40, false);
+      for (int x=x1; x<=x2; ++x)
+        expected[x] = (image->getPixel(x, 0) != 0);
+
+      int last = -2;
+      for_each_bitmap_run(
+        image.get(), 0, x1, x2,
+        [&](int u1, int u2) {
+          EXPECT_LE(x1, u1);
+          EXPECT_LE(u1, u2);
+          EXPECT_LE(u2, x2);
+          EXPECT_LT(last+1, u1); // Runs are maximal and sorted
+          for (int u=u1; u<=u2; ++u)
+            found[u] = true;
+          last = u2;
+        });
+      EXPECT_EQ(expected, found);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,227 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/image_swap.h"
+
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/path.h"
+#include "base/process.h"
+#include "doc/cel_data.h"
+#include "doc/image.h"
+#include "doc/image_io.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace doc {
+
+ImageSwap::ImageSwap()
+  : m_maxResidentBytes(0)
+  , m_residentBytes(0)
+  , m_accessTick(0)
+  , m_fileSize(0)
+{
+  set_missing_object_handler(&ImageSwap::findSwappedImage);
+}
+
+ImageSwap::~ImageSwap()
+{
+  set_missing_object_handler(nullptr);
+
+  if (m_file.is_open()) {
+    m_file.close();
+    try {
+      base::delete_file(m_filename);
+    }
+    catch (...) {
+      // Ignore errors removing the temporary file
+    }
+  }
+}
+
+// static
+ImageSwap& ImageSwap::instance()
+{
+  static ImageSwap swap;
+  return swap;
+}
+
+ImageSwap::Stats ImageSwap::stats() const
+{
+  std::lock_guard<std::mutex> lock(const_cast<ImageSwap*>(this)->m_mutex);
+  Stats stats = m_stats;
+  stats.swappedImages = m_swappedImages.size();
+  stats.fileSize = m_fileSize;
+  return stats;
+}
+
+bool ImageSwap::openFile()
+{
+  if (m_file.is_open())
+    return true;
+
+  if (m_filename.empty()) {
+    m_filename = base::join_path(
+      base::get_temp_path(),
+      "libresprite-swap-" + std::to_string(base::get_current_process_id()) + ".bin");
+  }
+
+  m_file.open(m_filename, std::ios::in | std::ios::out |
+                          std::ios::trunc | std::ios::binary);
+  m_fileSize = 0;
+  m_freeSlots.clear();
+  return m_file.is_open();
+}
+
+bool ImageSwap::store(CelData* celData, const Image* image, Slot& slot)
+{
+  if (!openFile())
+    return false;
+
+  std::ostringstream os(std::ios::binary);
+  try {
+    write_image(os, image);
+  }
+  catch (...) {
+    return false;
+  }
+  const std::string data = os.str();
+  const uint32_t size = uint32_t(data.size());
+
+  slot = Slot();
+  slot.version = image->version();
+
+  // Reuse the smallest free slot where the image fits
+  auto it = m_freeSlots.lower_bound(size);
+  if (it != m_freeSlots.end()) {
+    slot.capacity = it->first;
+    slot.offset = it->second;
+    m_freeSlots.erase(it);
+  }
+  else {
+    slot.capacity = size;
+    slot.offset = m_fileSize;
+    m_fileSize += size;
+  }
+  slot.size = size;
+
+  m_file.clear();
+  m_file.seekp(std::streamoff(slot.offset));
+  if (!m_file.write(data.data(), size) || !m_file.flush()) {
+    m_file.clear();
+    m_freeSlots.insert(std::make_pair(slot.capacity, slot.offset));
+    return false;
+  }
+
+  m_swappedImages[image->id()] = celData;
+  ++m_stats.swapOuts;
+  return true;
+}
+
+void ImageSwap::addExternal(CelData* celData, ObjectId imageId)
+{
+  m_swappedImages[imageId] = celData;
+}
+
+bool ImageSwap::read(const Slot& slot, char* data)
+{
+  if (slot.data) {
+    std::copy(slot.data->begin(), slot.data->end(), data);
+  }
+  else if (slot.filename.empty()) {
+    m_file.clear();
+    m_file.seekg(std::streamoff(slot.offset));
+    if (!m_file.read(data, slot.size)) {
+      m_file.clear();
+      return false;
+    }
+  }
+  else {
+    std::ifstream file(FSTREAM_PATH(slot.filename), std::ios::binary);
+    file.seekg(std::streamoff(slot.offset));
+    if (!file.read(data, slot.size))
+      return false;
+  }
+  return true;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> ImageSwap::loadData(const Slot& slot)
+{
+  if (slot.data)
+    return slot.data;
+
+  auto data = std::make_shared<std::vector<uint8_t>>(slot.size);
+  if (!read(slot, (char*)data->data()))
+    return nullptr;
+  return data;
+}
+
+Image* ImageSwap::load(ObjectId imageId, const Slot& slot)
+{
+  std::string data(slot.size, '\0');
+  if (!read(slot, &data[0]))
+    return nullptr;
+
+  std::istringstream is(std::move(data), std::ios::binary);
+  Image* image = nullptr;
+  try {
+    // External images could be shared by several images in their
+    // files, so the ID is always the one of the swapped image
+    image = read_image(is, false);
+  }
+  catch (...) {
+    return nullptr;
+  }
+  if (image) {
+    image->setId(imageId);
+    image->setVersion(slot.version);
+    ++m_stats.swapIns;
+  }
+  return image;
+}
+
+void ImageSwap::release(ObjectId imageId, const Slot& slot)
+{
+  m_swappedImages.erase(imageId);
+  if (slot.filename.empty() && !slot.data)
+    m_freeSlots.insert(std::make_pair(slot.capacity, slot.offset));
+}
+
+void ImageSwap::loadExternalImages(const std::string& dir)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::vector<CelData*> celDatas;
+  for (const auto& it : m_swappedImages) {
+    const std::string& fn = it.second->m_slot.filename;
+    if (!fn.empty() && fn.compare(0, dir.size(), dir) == 0)
+      celDatas.push_back(it.second);
+  }
+
+  for (CelData* celData : celDatas)
+    celData->swapInWithLock();
+}
+
+// static
+Object* ImageSwap::findSwappedImage(ObjectId imageId)
+{
+  ImageSwap& swap = instance();
+  std::lock_guard<std::mutex> lock(swap.m_mutex);
+
+  auto it = swap.m_swappedImages.find(imageId);
+  if (it == swap.m_swappedImages.end())
+    return nullptr;
+
+  return it->second->swapInWithLock();
+}
+
+} // namespace doc
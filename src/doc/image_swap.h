@@ -0,0 +1,134 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/object.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace doc {
+
+  class CelData;
+  class Image;
+
+  // Swap file for cel images. The images of CelData objects that
+  // weren't used recently can be written here (with the same
+  // serialization used by the crash recovery data) to free their
+  // memory, and they are read again when CelData::image() is called
+  // (or when the image is requested by its ID with doc::get()).
+  // Images can be kept compressed in memory too (see
+  // CelData::setCompressedImage()).
+  //
+  // The memory budget is only checked by the code that decides what
+  // to swap out (see CelData::swapOut()), this class just counts the
+  // memory used by the images of all CelData objects. It's
+  // thread-safe.
+  class ImageSwap {
+  public:
+    struct Slot {
+      uint64_t offset = 0;
+      uint32_t size = 0;
+      uint32_t capacity = 0;
+      // Images that were never loaded are read from other files
+      // (e.g. crash recovery files), it's empty for the swap file.
+      std::string filename;
+      // Image compressed in memory (write_image() format) instead of
+      // a file, e.g. the cels of a loaded file that weren't used yet.
+      std::shared_ptr<const std::vector<uint8_t>> data;
+      // Version of the image when it was swapped out (it's restored
+      // when the image is loaded again).
+      ObjectVersion version = 0;
+    };
+
+    struct Stats {
+      std::size_t swapOuts = 0;
+      std::size_t swapIns = 0;
+      std::size_t swappedImages = 0;
+      uint64_t fileSize = 0;
+    };
+
+    ImageSwap();
+    ~ImageSwap();
+
+    // Maximum memory for cel images (0 = no limit, the default).
+    void setMaxResidentBytes(std::size_t bytes) { m_maxResidentBytes = bytes; }
+    std::size_t maxResidentBytes() const { return m_maxResidentBytes; }
+
+    // Memory used by the images of all the CelData objects which are
+    // in memory.
+    std::size_t residentBytes() const { return m_residentBytes; }
+    bool isOverBudget() const {
+      return (m_maxResidentBytes > 0 &&
+              m_residentBytes > m_maxResidentBytes);
+    }
+
+    // Counter incremented each time a cel image is used (to know the
+    // least recently used ones).
+    uint64_t nextAccessTick() { return ++m_accessTick; }
+    uint64_t accessTick() const { return m_accessTick; }
+
+    Stats stats() const;
+
+    // Loads the external images (see CelData::setExternalImage())
+    // that are read from files inside the given directory (e.g.
+    // because the directory is going to be deleted).
+    void loadExternalImages(const std::string& dir);
+
+    static ImageSwap& instance();
+
+  private:
+    friend class CelData;
+
+    void addResidentBytes(std::size_t bytes) { m_residentBytes += bytes; }
+    void removeResidentBytes(std::size_t bytes) { m_residentBytes -= bytes; }
+
+    // Writes the image in the swap file, the CelData can be found
+    // by the image ID until it's loaded or released.
+    bool store(CelData* celData, const Image* image, Slot& slot);
+    // Adds an image that is swapped out in other place (another file
+    // or a compressed copy in memory).
+    void addExternal(CelData* celData, ObjectId imageId);
+    Image* load(ObjectId imageId, const Slot& slot);
+    // Returns the compressed image of the slot in memory.
+    std::shared_ptr<const std::vector<uint8_t>> loadData(const Slot& slot);
+    void release(ObjectId imageId, const Slot& slot);
+
+    std::mutex& mutex() { return m_mutex; }
+
+    bool openFile();
+    bool read(const Slot& slot, char* data);
+    static Object* findSwappedImage(ObjectId imageId);
+
+    std::atomic<std::size_t> m_maxResidentBytes;
+    std::atomic<std::size_t> m_residentBytes;
+    std::atomic<uint64_t> m_accessTick;
+
+    // Protects the file, the free slots and the CelData of each
+    // swapped image (and the swap in/out of each CelData).
+    std::mutex m_mutex;
+    std::string m_filename;
+    std::fstream m_file;
+    uint64_t m_fileSize;
+    // Unused slots of the file sorted by capacity
+    std::multimap<uint32_t, uint64_t> m_freeSlots;
+    std::unordered_map<ObjectId, CelData*> m_swappedImages;
+    Stats m_stats;
+
+    DISABLE_COPYING(ImageSwap);
+  };
+
+} // namespace doc
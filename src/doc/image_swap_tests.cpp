@@ -0,0 +1,248 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/fs.h"
+#include "base/path.h"
+#include "doc/cel_data.h"
+#include "doc/image.h"
+#include "doc/image_io.h"
+#include "doc/image_swap.h"
+#include "doc/primitives.h"
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+ImageRef create_test_image(PixelFormat format, int w, int h)
+{
+  ImageRef image(Image::create(format, w, h));
+  for (int y=0; y<h; ++y)
+    for (int x=0; x<w; ++x)
+      put_pixel(image.get(), x, y, (x*7 + y*13) & 1);
+  return image;
+}
+
+} // anonymous namespace
+
+TEST(ImageSwap, SwapOutAndIn)
+{
+  ImageSwap& swap = ImageSwap::instance();
+
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    ImageRef image = create_test_image(format, 37, 21);
+    std::unique_ptr<Image> copy(Image::createCopy(image.get()));
+    const ObjectId id = image->id();
+
+    CelData celData(image);
+    image.reset();
+
+    const std::size_t before = swap.residentBytes();
+    EXPECT_TRUE(celData.swapOut());
+    EXPECT_TRUE(celData.isSwapped());
+    EXPECT_FALSE(celData.swapOut());
+    EXPECT_LT(swap.residentBytes(), before);
+    EXPECT_EQ(id, celData.imageId());
+
+    Image* restored = celData.image();
+    ASSERT_TRUE(restored != nullptr);
+    EXPECT_FALSE(celData.isSwapped());
+    EXPECT_EQ(before, swap.residentBytes());
+    EXPECT_EQ(id, restored->id());
+    EXPECT_EQ(0, count_diff_between_images(copy.get(), restored));
+  }
+}
+
+TEST(ImageSwap, GetObjectLoadsSwappedImage)
+{
+  CelData celData(create_test_image(IMAGE_RGB, 16, 16));
+  const ObjectId id = celData.imageId();
+
+  ASSERT_TRUE(celData.swapOut());
+  Image* image = get<Image>(id);
+  ASSERT_TRUE(image != nullptr);
+  EXPECT_FALSE(celData.isSwapped());
+  EXPECT_EQ(celData.image(), image);
+}
+
+TEST(ImageSwap, SharedImagesAreNotSwapped)
+{
+  ImageRef image = create_test_image(IMAGE_RGB, 8, 8);
+  CelData celData(image);
+  EXPECT_FALSE(celData.swapOut());
+  EXPECT_FALSE(celData.isSwapped());
+}
+
+TEST(ImageSwap, ResidentBytes)
+{
+  ImageSwap& swap = ImageSwap::instance();
+  const std::size_t before = swap.residentBytes();
+  {
+    CelData celData(create_test_image(IMAGE_RGB, 32, 32));
+    EXPECT_LT(before, swap.residentBytes());
+
+    celData.setImage(create_test_image(IMAGE_RGB, 64, 64));
+    ASSERT_TRUE(celData.swapOut());
+    EXPECT_EQ(before, swap.residentBytes());
+
+    // Replacing the swapped image releases its slot
+    celData.setImage(create_test_image(IMAGE_RGB, 16, 16));
+    EXPECT_FALSE(celData.isSwapped());
+    EXPECT_LT(before, swap.residentBytes());
+  }
+  EXPECT_EQ(before, swap.residentBytes());
+}
+
+TEST(ImageSwap, ExternalImage)
+{
+  ImageRef image = create_test_image(IMAGE_INDEXED, 23, 11);
+  const std::string fn = base::join_path(base::get_temp_path(),
+                                         "libresprite-external-image.bin");
+  uint32_t size;
+  {
+    std::ofstream os(fn, std::ios::binary);
+    os.write("head", 4);
+    write_image(os, image.get());
+    size = uint32_t(os.tellp()) - 4;
+  }
+
+  CelData celData(ImageRef(Image::create(IMAGE_INDEXED, 1, 1)));
+  const ObjectId id = celData.imageId();
+  celData.setExternalImage(fn, 4, size);
+  EXPECT_TRUE(celData.isSwapped());
+  EXPECT_EQ(id, celData.imageId());
+
+  ImageSwap::instance().loadExternalImages(base::get_temp_path());
+  EXPECT_FALSE(celData.isSwapped());
+  base::delete_file(fn);
+
+  ASSERT_TRUE(celData.image() != nullptr);
+  EXPECT_EQ(id, celData.image()->id());
+  EXPECT_EQ(0, count_diff_between_images(image.get(), celData.image()));
+}
+
+TEST(ImageSwap, CompressedImage)
+{
+  ImageSwap& swap = ImageSwap::instance();
+  ImageRef image = create_test_image(IMAGE_RGB, 19, 7);
+  auto data = std::make_shared<std::vector<uint8_t>>();
+  {
+    std::ostringstream os(std::ios::binary);
+    write_image(os, image.get());
+    const std::string str = os.str();
+    data->assign(str.begin(), str.end());
+  }
+
+  CelData celData(ImageRef(Image::create(IMAGE_RGB, 1, 1)));
+  const ObjectId id = celData.imageId();
+  celData.setCompressedImage(data, 3);
+  EXPECT_TRUE(celData.isSwapped());
+  EXPECT_FALSE(celData.hasCompressedCopy());
+  EXPECT_EQ(id, celData.imageId());
+  EXPECT_EQ(3, celData.imageVersion());
+
+  ASSERT_TRUE(celData.image() != nullptr);
+  EXPECT_EQ(id, celData.image()->id());
+  EXPECT_EQ(3, celData.image()->version());
+  EXPECT_EQ(0, count_diff_between_images(image.get(), celData.image()));
+  EXPECT_TRUE(celData.hasCompressedCopy());
+
+  // The unmodified image doesn't need the swap file
+  const std::size_t swapOuts = swap.stats().swapOuts;
+  ASSERT_TRUE(celData.swapOut());
+  EXPECT_EQ(swapOuts, swap.stats().swapOuts);
+  EXPECT_EQ(0, count_diff_between_images(image.get(), celData.image()));
+
+  // A modified image is written in the swap file
+  put_pixel(celData.image(), 0, 0, rgba(1, 2, 3, 4));
+  celData.image()->incrementVersion();
+  EXPECT_FALSE(celData.hasCompressedCopy());
+  ASSERT_TRUE(celData.swapOut());
+  EXPECT_EQ(swapOuts+1, swap.stats().swapOuts);
+  EXPECT_EQ(4, celData.imageVersion());
+  EXPECT_EQ(rgba(1, 2, 3, 4), get_pixel(celData.image(), 0, 0));
+  EXPECT_EQ(4, celData.image()->version());
+  EXPECT_FALSE(celData.hasCompressedCopy());
+}
+
+TEST(ImageSwap, CompressedCopy)
+{
+  ImageRef image = create_test_image(IMAGE_GRAYSCALE, 17, 9);
+  auto data = std::make_shared<std::vector<uint8_t>>();
+  {
+    std::ostringstream os(std::ios::binary);
+    write_image(os, image.get());
+    const std::string str = os.str();
+    data->assign(str.begin(), str.end());
+  }
+
+  CelData src(ImageRef(Image::create(IMAGE_GRAYSCALE, 1, 1)));
+  src.setCompressedImage(data, 2);
+
+  // The copy shares the compressed pixels and it's decoded with its
+  // own ID
+  CelData copy(ImageRef(Image::create(IMAGE_GRAYSCALE, 1, 1)));
+  const ObjectId id = copy.imageId();
+  EXPECT_TRUE(copy.setCompressedCopyOf(src));
+  EXPECT_TRUE(copy.isSwapped());
+  EXPECT_TRUE(src.isSwapped());
+  EXPECT_EQ(id, copy.imageId());
+  EXPECT_NE(src.imageId(), copy.imageId());
+  EXPECT_EQ(2, copy.imageVersion());
+
+  ASSERT_TRUE(copy.image() != nullptr);
+  EXPECT_EQ(id, copy.image()->id());
+  EXPECT_TRUE(copy.hasCompressedCopy());
+  EXPECT_EQ(0, count_diff_between_images(image.get(), copy.image()));
+
+  // Modifying the copy doesn't modify the source
+  put_pixel(copy.image(), 0, 0, graya(128, 255));
+  copy.image()->incrementVersion();
+  EXPECT_FALSE(copy.hasCompressedCopy());
+  EXPECT_TRUE(src.isSwapped());
+  EXPECT_EQ(0, count_diff_between_images(image.get(), src.image()));
+
+  // The modified image is only in memory, so it cannot be shared
+  CelData copy2(ImageRef(Image::create(IMAGE_GRAYSCALE, 1, 1)));
+  EXPECT_FALSE(copy2.setCompressedCopyOf(copy));
+  EXPECT_FALSE(copy2.isSwapped());
+
+  // But it can be shared when it's in the swap file
+  ASSERT_TRUE(copy.swapOut());
+  EXPECT_TRUE(copy2.setCompressedCopyOf(copy));
+  EXPECT_TRUE(copy.isSwapped());
+  EXPECT_EQ(graya(128, 255), get_pixel(copy2.image(), 0, 0));
+  EXPECT_EQ(0, count_diff_between_images(copy.image(), copy2.image()));
+}
+
+TEST(ImageSwap, Budget)
+{
+  ImageSwap& swap = ImageSwap::instance();
+  EXPECT_FALSE(swap.isOverBudget());
+
+  CelData celData(create_test_image(IMAGE_RGB, 64, 64));
+  swap.setMaxResidentBytes(1);
+  EXPECT_TRUE(swap.isOverBudget());
+  ASSERT_TRUE(celData.swapOut());
+  EXPECT_FALSE(swap.isOverBudget());
+  swap.setMaxResidentBytes(0);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
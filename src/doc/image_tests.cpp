@@ -69,7 +69,7 @@ TYPED_TEST(ImageAllTypes, PutGetAndIterators)
 
     // Read-only iterator (whole image)
     {
-      const LockImageBits<ImageTraits> bits((const Image*)image);
+      const LockImageBits<ImageTraits> bits(image.get());
       typename LockImageBits<ImageTraits>::const_iterator
         begin = bits.begin(),
         it = begin,
@@ -87,7 +87,7 @@ TYPED_TEST(ImageAllTypes, PutGetAndIterators)
       if (bounds.w <= 0 || bounds.h <= 0)
         break;
 
-      const LockImageBits<ImageTraits> bits((const Image*)image, bounds);
+      const LockImageBits<ImageTraits> bits(image.get(), bounds);
       typename LockImageBits<ImageTraits>::const_iterator
         begin = bits.begin(),
         it = begin,
@@ -108,7 +108,7 @@ TYPED_TEST(ImageAllTypes, PutGetAndIterators)
 
     // Write iterator (whole image)
     {
-      LockImageBits<ImageTraits> bits(image, Image::WriteLock);
+      LockImageBits<ImageTraits> bits(image.get(), Image::WriteLock);
       typename LockImageBits<ImageTraits>::iterator
         begin = bits.begin(),
         it = begin,
@@ -144,6 +144,69 @@ TEST(Image, DiffRgbImages)
   ASSERT_EQ(2, count_diff_between_images(a.get(), b.get()));
 }
 
+TEST(Image, RgbView)
+{
+  // 3x2 pixels view in the middle of a 5x4 buffer
+  std::vector<uint32_t> pixels(5*4, 0);
+  std::unique_ptr<Image> view(
+    Image::createView(IMAGE_RGB, 3, 2,
+                      (uint8_t*)&pixels[5+1], 5*sizeof(uint32_t)));
+
+  view->clear(rgba(255, 0, 0, 255));
+  put_pixel(view.get(), 2, 1, rgba(0, 0, 255, 255));
+
+  for (int y=0; y<4; ++y) {
+    for (int x=0; x<5; ++x) {
+      color_t expected = 0;
+      if (x == 3 && y == 2)
+        expected = rgba(0, 0, 255, 255);
+      else if (x >= 1 && x < 4 && y >= 1 && y < 3)
+        expected = rgba(255, 0, 0, 255);
+      EXPECT_EQ(expected, pixels[y*5+x]);
+    }
+  }
+
+  std::unique_ptr<Image> copy(Image::createCopy(view.get()));
+  EXPECT_EQ(0, count_diff_between_images(view.get(), copy.get()));
+}
+
+TEST(Image, IndexedView)
+{
+  // The rows of the view aren't contiguous
+  std::vector<uint8_t> pixels(4*3, 0);
+  std::unique_ptr<Image> view(
+    Image::createView(IMAGE_INDEXED, 2, 3, &pixels[1], 4));
+
+  view->clear(7);
+  for (int y=0; y<3; ++y)
+    for (int x=0; x<4; ++x)
+      EXPECT_EQ((x == 1 || x == 2 ? 7: 0), pixels[y*4+x]);
+}
+
+TEST(Image, BitmapView)
+{
+  // 10x2 pixels view starting in the second byte of the second row
+  // of a 24x4 bitmap
+  std::unique_ptr<Image> bitmap(Image::create(IMAGE_BITMAP, 24, 4));
+  clear_image(bitmap.get(), 1);
+
+  std::unique_ptr<Image> view(
+    Image::createView(IMAGE_BITMAP, 10, 2,
+                      bitmap->getPixelAddress(8, 1),
+                      bitmap->getRowStrideSize()));
+  view->clear(0);
+
+  for (int y=0; y<4; ++y)
+    for (int x=0; x<24; ++x)
+      EXPECT_EQ((x >= 8 && x < 18 && y >= 1 && y < 3 ? 0: 1),
+                get_pixel(bitmap.get(), x, y)) << x << "," << y;
+
+  view->clear(1);
+  for (int y=0; y<4; ++y)
+    for (int x=0; x<24; ++x)
+      EXPECT_EQ(1, get_pixel(bitmap.get(), x, y));
+}
+
 TYPED_TEST(ImageAllTypes, DrawHLine)
 {
   typedef TypeParam ImageTraits;
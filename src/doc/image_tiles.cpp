@@ -0,0 +1,249 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/image_tiles.h"
+
+#include "base/hash.h"
+#include "doc/image_impl.h"
+#include "doc/primitives.h"
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace doc {
+
+namespace {
+
+template<typename ImageTraits>
+bool is_empty_area(const Image* image, const gfx::Rect& bounds)
+{
+  const color_t mask = image->maskColor();
+  for (int y=bounds.y; y<bounds.y2(); ++y) {
+    auto it = (typename ImageTraits::const_address_t)
+      image->getPixelAddress(bounds.x, y);
+    for (int x=0; x<bounds.w; ++x, ++it)
+      if (*it != mask)
+        return false;
+  }
+  return true;
+}
+
+template<>
+bool is_empty_area<BitmapTraits>(const Image* image, const gfx::Rect& bounds)
+{
+  const color_t mask = image->maskColor();
+  for (int y=bounds.y; y<bounds.y2(); ++y)
+    for (int x=bounds.x; x<bounds.x2(); ++x)
+      if (get_pixel_fast<BitmapTraits>(image, x, y) != mask)
+        return false;
+  return true;
+}
+
+bool is_empty_area(const Image* image, const gfx::Rect& bounds)
+{
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB:       return is_empty_area<RgbTraits>(image, bounds);
+    case IMAGE_GRAYSCALE: return is_empty_area<GrayscaleTraits>(image, bounds);
+    case IMAGE_INDEXED:   return is_empty_area<IndexedTraits>(image, bounds);
+    case IMAGE_BITMAP:    return is_empty_area<BitmapTraits>(image, bounds);
+  }
+  return false;
+}
+
+typedef std::vector<uint8_t> TileData;
+
+// Tiles alive in all ImageTiles by the hash of their pixels, used to
+// share a tile instead of storing the same pixels again.
+class TileTable {
+public:
+  static TileTable& instance() {
+    // Never destroyed (tiles in static objects can be released later)
+    static TileTable* table = new TileTable;
+    return *table;
+  }
+
+  std::shared_ptr<const TileData> share(TileData&& data) {
+    const uint64_t hash = base::hash64(data.data(), data.size());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto range = m_tiles.equal_range(hash);
+    for (auto it=range.first; it!=range.second; ++it) {
+      if (auto tile = it->second.ref.lock()) {
+        if (*tile == data)
+          return tile;
+      }
+    }
+
+    // The deleter removes the tile from the table
+    std::shared_ptr<const TileData> tile(
+      new TileData(std::move(data)),
+      [this, hash](const TileData* tile) {
+        remove(hash, tile);
+        delete tile;
+      });
+    m_tiles.insert(std::make_pair(hash, Entry{ tile.get(), tile }));
+    return tile;
+  }
+
+  int size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return int(m_tiles.size());
+  }
+
+private:
+  struct Entry {
+    const TileData* tile;
+    std::weak_ptr<const TileData> ref;
+  };
+
+  void remove(uint64_t hash, const TileData* tile) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto range = m_tiles.equal_range(hash);
+    for (auto it=range.first; it!=range.second; ++it) {
+      if (it->second.tile == tile) {
+        m_tiles.erase(it);
+        break;
+      }
+    }
+  }
+
+  std::unordered_multimap<uint64_t, Entry> m_tiles;
+  mutable std::mutex m_mutex;
+};
+
+} // anonymous namespace
+
+ImageTiles::ImageTiles()
+  : m_format(IMAGE_RGB)
+  , m_width(0)
+  , m_height(0)
+  , m_maskColor(0)
+  , m_cols(0)
+  , m_rows(0)
+{
+}
+
+ImageTiles::ImageTiles(const Image* image)
+  : m_format(image->pixelFormat())
+  , m_width(image->width())
+  , m_height(image->height())
+  , m_maskColor(image->maskColor())
+  , m_cols((m_width + kTileSize - 1) / kTileSize)
+  , m_rows((m_height + kTileSize - 1) / kTileSize)
+  , m_tiles(m_cols * m_rows)
+{
+  update(image, image->bounds());
+}
+
+void ImageTiles::update(const Image* image, const gfx::Rect& bounds)
+{
+  ASSERT(image->pixelFormat() == m_format);
+  ASSERT(image->width() == m_width);
+  ASSERT(image->height() == m_height);
+
+  m_maskColor = image->maskColor();
+
+  const gfx::Rect rc = bounds.createIntersection(image->bounds());
+  if (rc.isEmpty())
+    return;
+
+  const int tx1 = rc.x / kTileSize;
+  const int ty1 = rc.y / kTileSize;
+  const int tx2 = (rc.x2() - 1) / kTileSize;
+  const int ty2 = (rc.y2() - 1) / kTileSize;
+
+  for (int ty=ty1; ty<=ty2; ++ty) {
+    for (int tx=tx1; tx<=tx2; ++tx) {
+      TileRef& tile = m_tiles[ty*m_cols + tx];
+      const gfx::Rect tileRc = tileBounds(tx, ty);
+
+      if (is_empty_area(image, tileRc)) {
+        tile.reset();
+        continue;
+      }
+
+      // Tiles are always created again (never modified) because they
+      // can be shared with other copies.
+      const int rowBytes = calculate_rowstride_bytes(m_format, tileRc.w);
+      Tile newTile(rowBytes * tileRc.h);
+      uint8_t* dst = newTile.data();
+      for (int y=tileRc.y; y<tileRc.y2(); ++y, dst+=rowBytes)
+        std::memcpy(dst, image->getPixelAddress(tileRc.x, y), rowBytes);
+      tile = TileTable::instance().share(std::move(newTile));
+    }
+  }
+}
+
+Image* ImageTiles::createImage() const
+{
+  Image* image = Image::create(m_format, m_width, m_height,
+                               ImageBufferPtr(new ImageBuffer(1, ImageBuffer::Uninitialized)));
+  copyTo(image);
+  return image;
+}
+
+void ImageTiles::copyTo(Image* image) const
+{
+  ASSERT(image->pixelFormat() == m_format);
+  ASSERT(image->width() == m_width);
+  ASSERT(image->height() == m_height);
+
+  image->setMaskColor(m_maskColor);
+
+  for (int ty=0; ty<m_rows; ++ty) {
+    for (int tx=0; tx<m_cols; ++tx) {
+      const TileRef& tile = m_tiles[ty*m_cols + tx];
+      const gfx::Rect tileRc = tileBounds(tx, ty);
+
+      if (!tile) {
+        fill_rect(image, tileRc, m_maskColor);
+        continue;
+      }
+
+      const int rowBytes = calculate_rowstride_bytes(m_format, tileRc.w);
+      const uint8_t* src = tile->data();
+      for (int y=tileRc.y; y<tileRc.y2(); ++y, src+=rowBytes)
+        std::memcpy(image->getPixelAddress(tileRc.x, y), src, rowBytes);
+    }
+  }
+}
+
+int ImageTiles::storedTilesCount() const
+{
+  int n = 0;
+  for (const TileRef& tile : m_tiles)
+    if (tile)
+      ++n;
+  return n;
+}
+
+int ImageTiles::getMemSize() const
+{
+  int size = sizeof(ImageTiles) + sizeof(TileRef)*int(m_tiles.size());
+  for (const TileRef& tile : m_tiles)
+    if (tile)
+      size += int(tile->size());
+  return size;
+}
+
+// static
+int ImageTiles::liveTilesCount()
+{
+  return TileTable::instance().size();
+}
+
+gfx::Rect ImageTiles::tileBounds(int tx, int ty) const
+{
+  return gfx::Rect(tx*kTileSize, ty*kTileSize, kTileSize, kTileSize)
+    .createIntersection(gfx::Rect(0, 0, m_width, m_height));
+}
+
+} // namespace doc
@@ -0,0 +1,76 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "doc/color.h"
+#include "doc/image.h"
+#include "gfx/rect.h"
+
+#include <memory>
+#include <vector>
+
+namespace doc {
+
+  // Copy of the pixels of an image divided in fixed-size tiles.
+  // Tiles with all pixels equal to the mask color aren't stored, and
+  // the other ones are immutable and shared between copies of the
+  // same ImageTiles (so copying an ImageTiles doesn't copy pixels).
+  // Tiles with the same pixels are shared too, even between copies of
+  // different images (e.g. the undo copies of several versions of an
+  // image share the tiles that weren't modified between versions).
+  //
+  // It's used to keep copies of images (e.g. in the undo history)
+  // without the memory of a full Image, the pixels are restored
+  // with createImage() or copyTo().
+  class ImageTiles {
+  public:
+    enum { kTileSize = 64 };
+
+    ImageTiles();
+    explicit ImageTiles(const Image* image);
+
+    // Copies the pixels of the given image (which must have the same
+    // format and size) in the tiles that intersect "bounds". The
+    // other tiles are still shared with previous copies.
+    void update(const Image* image, const gfx::Rect& bounds);
+
+    Image* createImage() const;
+    void copyTo(Image* image) const;
+
+    bool isEmpty() const { return m_width == 0 || m_height == 0; }
+    PixelFormat pixelFormat() const { return m_format; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    color_t maskColor() const { return m_maskColor; }
+
+    int tilesCount() const { return int(m_tiles.size()); }
+    int storedTilesCount() const;
+
+    // Memory used by the stored tiles (shared tiles are counted in
+    // each ImageTiles that use them).
+    int getMemSize() const;
+
+    // Number of different tiles alive in all ImageTiles.
+    static int liveTilesCount();
+
+  private:
+    typedef std::vector<uint8_t> Tile;
+    typedef std::shared_ptr<const Tile> TileRef;
+
+    gfx::Rect tileBounds(int tx, int ty) const;
+
+    PixelFormat m_format;
+    int m_width;
+    int m_height;
+    color_t m_maskColor;
+    int m_cols;
+    int m_rows;
+    // nullptr for tiles without pixels (all pixels == mask color)
+    std::vector<TileRef> m_tiles;
+  };
+
+} // namespace doc
@@ -0,0 +1,104 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image_impl.h"
+#include "doc/image_tiles.h"
+#include "doc/primitives.h"
+
+#include <memory>
+
+using namespace doc;
+
+TEST(ImageTiles, EmptyTilesAreNotStored)
+{
+  std::unique_ptr<Image> image(Image::create(IMAGE_RGB, 200, 100));
+  clear_image(image.get(), 0);
+  put_pixel(image.get(), 70, 10, rgba(255, 0, 0, 255));
+
+  ImageTiles tiles(image.get());
+  EXPECT_EQ(4*2, tiles.tilesCount());
+  EXPECT_EQ(1, tiles.storedTilesCount());
+
+  std::unique_ptr<Image> copy(tiles.createImage());
+  EXPECT_EQ(0, count_diff_between_images(image.get(), copy.get()));
+}
+
+TEST(ImageTiles, AllFormats)
+{
+  const PixelFormat formats[] = {
+    IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP
+  };
+  for (PixelFormat format : formats) {
+    std::unique_ptr<Image> image(Image::create(format, 131, 67));
+    clear_image(image.get(), 0);
+    for (int i=0; i<500; ++i)
+      put_pixel(image.get(), rand() % 131, rand() % 67, 1 + (rand() % 200));
+
+    ImageTiles tiles(image.get());
+    std::unique_ptr<Image> copy(tiles.createImage());
+    EXPECT_EQ(0, count_diff_between_images(image.get(), copy.get()));
+  }
+}
+
+TEST(ImageTiles, UpdateSharesUntouchedTiles)
+{
+  std::unique_ptr<Image> image(Image::create(IMAGE_INDEXED, 256, 256));
+  clear_image(image.get(), 1);
+
+  ImageTiles a(image.get());
+  ImageTiles b = a;
+  EXPECT_EQ(16, b.storedTilesCount());
+
+  // Only the tile (1,1) is copied again
+  fill_rect(image.get(), gfx::Rect(64, 64, 64, 64), 0);
+  b.update(image.get(), gfx::Rect(70, 70, 10, 10));
+  EXPECT_EQ(16, a.storedTilesCount());
+  EXPECT_EQ(15, b.storedTilesCount());
+
+  std::unique_ptr<Image> copy(b.createImage());
+  EXPECT_EQ(0, count_diff_between_images(image.get(), copy.get()));
+
+  std::unique_ptr<Image> old(a.createImage());
+  EXPECT_EQ(64*64, count_diff_between_images(image.get(), old.get()));
+}
+
+TEST(ImageTiles, EqualTilesAreShared)
+{
+  const int count = ImageTiles::liveTilesCount();
+
+  // All tiles of a plain color image are the same tile
+  std::unique_ptr<Image> image(Image::create(IMAGE_RGB, 256, 256));
+  clear_image(image.get(), rgba(0, 0, 255, 255));
+  {
+    ImageTiles a(image.get());
+    EXPECT_EQ(16, a.storedTilesCount());
+    EXPECT_EQ(count+1, ImageTiles::liveTilesCount());
+
+    // Copy of a modified version of the image: just the modified
+    // tile is new
+    put_pixel(image.get(), 100, 100, rgba(255, 0, 0, 255));
+    ImageTiles b(image.get());
+    EXPECT_EQ(count+2, ImageTiles::liveTilesCount());
+
+    std::unique_ptr<Image> copy(b.createImage());
+    EXPECT_EQ(0, count_diff_between_images(image.get(), copy.get()));
+    std::unique_ptr<Image> old(a.createImage());
+    EXPECT_EQ(1, count_diff_between_images(image.get(), old.get()));
+  }
+  EXPECT_EQ(count, ImageTiles::liveTilesCount());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -11,12 +11,14 @@
 #include "doc/layer.h"
 
 #include "doc/cel.h"
+#include "doc/cel_data.h"
 #include "doc/image.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
 
 #include <algorithm>
 #include <cstring>
+#include <unordered_set>
 
 namespace doc {
 
@@ -97,15 +99,13 @@ LayerImage::~LayerImage()
 int LayerImage::getMemSize() const
 {
   int size = sizeof(LayerImage);
-  CelConstIterator it = getCelBegin();
-  CelConstIterator end = getCelEnd();
 
-  for (; it != end; ++it) {
-    auto cel = *it;
-    size += cel->getMemSize();
-
-    const Image* image = cel->image();
-    size += image->getMemSize();
+  // Linked cels share their data (it's counted only one time)
+  std::unordered_set<const CelData*> visited;
+  for (const auto& cel : m_cels) {
+    size += sizeof(Cel);
+    if (visited.insert(cel->data()).second)
+      size += cel->data()->getMemSize();
   }
 
   return size;
@@ -237,20 +237,48 @@ void LayerImage::configureAsBackground()
 
 void LayerImage::displaceFrames(frame_t fromThis, frame_t delta)
 {
-  Sprite* sprite = this->sprite();
+  // The cels are sorted by frame, so the displaced ones are a suffix
+  // of the list and they keep their relative order. They are
+  // renumbered in place (instead of removing/adding each cel with
+  // moveCel(), which shifted the whole vector for each cel).
+  CelIterator first = findFirstCelIteratorAfter(fromThis-1);
+  for (CelIterator it=first; it!=m_cels.end(); ++it) {
+    Cel* cel = it->get();
+    cel->setParentLayer(nullptr);
+    cel->setFrame(cel->frame()+delta);
+    cel->setParentLayer(this);
+  }
 
-  if (delta > 0) {
-    for (frame_t c=sprite->lastFrame(); c>=fromThis; --c) {
-      if (auto cel = this->cel(c))
-        moveCel(cel, c+delta);
-    }
+  // Moving cels backward can overlap the previous ones
+  if (delta < 0 && first != m_cels.begin() && first != m_cels.end() &&
+      (*(first-1))->frame() > (*first)->frame()) {
+    std::stable_sort(m_cels.begin(), m_cels.end(),
+                     [](const std::shared_ptr<Cel>& a, const std::shared_ptr<Cel>& b) {
+                       return a->frame() < b->frame();
+                     });
   }
-  else {
-    for (frame_t c=fromThis; c<=sprite->lastFrame(); ++c) {
-      if (auto cel = this->cel(c))
-        moveCel(cel, c+delta);
+}
+
+void LayerImage::permuteFrames(const std::vector<frame_t>& newFrames)
+{
+  bool changed = false;
+  for (auto& cel : m_cels) {
+    frame_t frame = cel->frame();
+    if (frame < frame_t(newFrames.size()) &&
+        newFrames[frame] != frame) {
+      cel->setFrame(newFrames[frame]);
+      cel->incrementVersion();
+      changed = true;
     }
   }
+
+  // Sort the cels just one time (instead of removing/adding each
+  // cel with moveCel())
+  if (changed)
+    std::sort(m_cels.begin(), m_cels.end(),
+              [](const std::shared_ptr<Cel>& a, const std::shared_ptr<Cel>& b) {
+                return a->frame() < b->frame();
+              });
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -306,6 +334,9 @@ void LayerFolder::addLayer(Layer* layer)
 {
   m_layers.push_back(layer);
   layer->setParent(this);
+
+  if (sprite())
+    sprite()->layersChanged();
 }
 
 void LayerFolder::removeLayer(Layer* layer)
@@ -315,6 +346,9 @@ void LayerFolder::removeLayer(Layer* layer)
   m_layers.erase(it);
 
   layer->setParent(NULL);
+
+  if (sprite())
+    sprite()->layersChanged();
 }
 
 void LayerFolder::stackLayer(Layer* layer, Layer* after)
@@ -335,6 +369,9 @@ void LayerFolder::stackLayer(Layer* layer, Layer* after)
   }
   else
     m_layers.insert(m_layers.begin(), layer);
+
+  if (sprite())
+    sprite()->layersChanged();
 }
 
 void LayerFolder::displaceFrames(frame_t fromThis, frame_t delta)
@@ -343,4 +380,10 @@ void LayerFolder::displaceFrames(frame_t fromThis, frame_t delta)
     layer->displaceFrames(fromThis, delta);
 }
 
+void LayerFolder::permuteFrames(const std::vector<frame_t>& newFrames)
+{
+  for (Layer* layer : m_layers)
+    layer->permuteFrames(newFrames);
+}
+
 } // namespace doc
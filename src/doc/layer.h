@@ -14,6 +14,7 @@
 #include "doc/with_user_data.h"
 
 #include <string>
+#include <vector>
 
 namespace doc {
 
@@ -96,6 +97,11 @@ namespace doc {
     virtual void getCels(CelList& cels) const = 0;
     virtual void displaceFrames(frame_t fromThis, frame_t delta) = 0;
 
+    // Moves each cel from its frame F to the frame newFrames[F] (cels
+    // in frames outside the vector stay in the same frame). The
+    // vector must be a permutation.
+    virtual void permuteFrames(const std::vector<frame_t>& newFrames) = 0;
+
   private:
     std::string m_name;           // layer name
     Sprite* m_sprite;             // owner of the layer
@@ -129,6 +135,7 @@ namespace doc {
     std::shared_ptr<Cel> cel(frame_t frame) const override;
     void getCels(CelList& cels) const override;
     void displaceFrames(frame_t fromThis, frame_t delta) override;
+    void permuteFrames(const std::vector<frame_t>& newFrames) override;
 
     std::shared_ptr<Cel> getLastCel() const;
     CelConstIterator findCelIterator(frame_t frame) const;
@@ -177,6 +184,7 @@ namespace doc {
 
     void getCels(CelList& cels) const override;
     void displaceFrames(frame_t fromThis, frame_t delta) override;
+    void permuteFrames(const std::vector<frame_t>& newFrames) override;
 
   private:
     void destroyAllLayers();
@@ -10,7 +10,7 @@
 
 #include "doc/layers_range.h"
 
-#include "doc/cel.h"
+#include "base/base.h"
 #include "doc/layer.h"
 #include "doc/sprite.h"
 
@@ -25,18 +25,22 @@ LayersRange::LayersRange(const Sprite* sprite,
 
 LayersRange::iterator::iterator()
   : m_layer(nullptr)
-  , m_cur(-1)
-  , m_last(-1)
 {
 }
 
 LayersRange::iterator::iterator(const Sprite* sprite,
                                 LayerIndex first, LayerIndex last)
   : m_layer(nullptr)
-  , m_cur(first)
-  , m_last(last)
 {
-  m_layer = sprite->layer(first);
+  const LayerList& layers = sprite->allLayers();
+  const int n = int(layers.size());
+  const int i = MID(0, int(first), n);
+  const int j = MID(i, int(last)+1, n);
+
+  m_it = layers.begin() + i;
+  m_end = layers.begin() + j;
+  if (m_it != m_end)
+    m_layer = *m_it;
 }
 
 LayersRange::iterator& LayersRange::iterator::operator++()
@@ -44,11 +48,10 @@ LayersRange::iterator& LayersRange::iterator::operator++()
   if (!m_layer)
     return *this;
 
-  ++m_cur;
-  if (m_cur > m_last)
-    m_layer = nullptr;
+  if (++m_it != m_end)
+    m_layer = *m_it;
   else
-    m_layer = m_layer->getNext();
+    m_layer = nullptr;
 
   return *this;
 }
@@ -7,14 +7,14 @@
 #pragma once
 
 #include "doc/layer_index.h"
-#include "doc/object_id.h"
-
-#include <set>
+#include "doc/layer_list.h"
 
 namespace doc {
   class Layer;
   class Sprite;
 
+  // Iterates the layers between two indexes of the list of layers
+  // cached in the sprite (see Sprite::allLayers()).
   class LayersRange {
   public:
     LayersRange(const Sprite* sprite, LayerIndex first, LayerIndex last);
@@ -40,8 +40,7 @@ namespace doc {
 
     private:
       Layer* m_layer;
-      LayerIndex m_cur, m_last;
-      std::set<ObjectId> m_visited;
+      LayerConstIterator m_it, m_end;
     };
 
     iterator begin() { return m_begin; }
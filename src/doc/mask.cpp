@@ -12,13 +12,178 @@
 
 #include "base/base.h"
 #include "base/memory.h"
+#include "base/thread_pool.h"
 #include "doc/image_impl.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 
 namespace doc {
 
+namespace {
+
+// Bitmap rows are processed 64 bits at a time (bit 0 of each byte is
+// the leftmost pixel). The last byte of a row can contain padding
+// bits (outside the image) which must be ignored.
+
+inline uint64_t load64(const uint8_t* p)
+{
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline void store64(uint8_t* p, uint64_t v)
+{
+  std::memcpy(p, &v, sizeof(v));
+}
+
+inline int lowest_bit(uint8_t v)
+{
+  int i = 0;
+  while (!(v & (1 << i)))
+    ++i;
+  return i;
+}
+
+inline int highest_bit(uint8_t v)
+{
+  int i = 7;
+  while (!(v & (1 << i)))
+    --i;
+  return i;
+}
+
+inline uint8_t tail_mask(int w)
+{
+  return uint8_t((1 << (w & 7)) - 1);
+}
+
+// Returns the first and last selected pixels of a row of "w" pixels,
+// or false if the row is empty.
+bool row_bounds(const uint8_t* row, int w, int& first, int& last)
+{
+  const int full = (w >> 3);
+  const uint8_t tail = ((w & 7) ? (row[full] & tail_mask(w)): 0);
+  const bool hasTail = (tail != 0);
+
+  int i = 0;
+  for (; i+8 <= full; i += 8)
+    if (load64(row+i))
+      break;
+  for (; i<full; ++i)
+    if (row[i])
+      break;
+
+  if (i < full)
+    first = i*8 + lowest_bit(row[i]);
+  else if (hasTail)
+    first = full*8 + lowest_bit(tail);
+  else
+    return false;
+
+  if (hasTail) {
+    last = full*8 + highest_bit(tail);
+    return true;
+  }
+
+  // There is a non-zero byte in [i, full)
+  int j = full;
+  while (j-8 > i && !load64(row+j-8))
+    j -= 8;
+  while (!row[j-1])
+    --j;
+  last = (j-1)*8 + highest_bit(row[j-1]);
+  return true;
+}
+
+bool is_row_full(const uint8_t* row, int w)
+{
+  const int full = (w >> 3);
+  int i = 0;
+  for (; i+8 <= full; i += 8)
+    if (load64(row+i) != ~uint64_t(0))
+      return false;
+  for (; i<full; ++i)
+    if (row[i] != 0xff)
+      return false;
+  return ((w & 7) == 0 || (row[full] & tail_mask(w)) == tail_mask(w));
+}
+
+void invert_row(uint8_t* row, int w)
+{
+  const int bytes = BitmapTraits::getRowStrideBytes(w);
+  int i = 0;
+  for (; i+8 <= bytes; i += 8)
+    store64(row+i, ~load64(row+i));
+  for (; i<bytes; ++i)
+    row[i] = ~row[i];
+  // Keep padding bits clear
+  if (w & 7)
+    row[bytes-1] &= tail_mask(w);
+}
+
+// Images with less pixels are processed by byColor() in the calling
+// thread (the other ones in bands of rows in the thread pool).
+const int kByColorParallelPixels = 128*128;
+const int kByColorRowsPerJob = 32;
+
+// Writes in the bitmap row "dst" the result of match() for each
+// pixel of "src" (8 bytes = 64 pixels per store, padding bits are
+// cleared). The match() function must be branchless so the inner
+// loop can be vectorized.
+template<typename ImageTraits, typename Match>
+void match_row(const typename ImageTraits::pixel_t* src, uint8_t* dst,
+               int w, const Match& match)
+{
+  int x = 0;
+  for (; x+64 <= w; x += 64, src += 64, dst += 8) {
+    uint8_t bytes[8];
+    for (int i=0; i<8; ++i) {
+      uint8_t bits = 0;
+      for (int b=0; b<8; ++b)
+        bits |= uint8_t(match(src[i*8+b])) << b;
+      bytes[i] = bits;
+    }
+    store64(dst, load64(bytes));
+  }
+  for (; x < w; x += 8, src += 8, ++dst) {
+    const int n = std::min(8, w-x);
+    uint8_t bits = 0;
+    for (int b=0; b<n; ++b)
+      bits |= uint8_t(match(src[b])) << b;
+    *dst = bits;
+  }
+}
+
+template<typename ImageTraits, typename Match>
+void match_image(const Image* src, Image* dst, const Match& match)
+{
+  const int w = src->width();
+  const int h = src->height();
+  auto rows = [src, dst, w, &match](int y1, int y2) {
+    for (int y=y1; y<y2; ++y)
+      match_row<ImageTraits>(
+        (const typename ImageTraits::pixel_t*)src->getPixelAddress(0, y),
+        dst->getPixelAddress(0, y), w, match);
+  };
+
+  if (w*h < kByColorParallelPixels)
+    rows(0, h);
+  else
+    base::thread_pool::instance().parallel_for_range(h, kByColorRowsPerJob, rows);
+}
+
+// True if "v" is in [lo, lo+range]
+inline int in_range(int v, int lo, unsigned range)
+{
+  return (unsigned(v - lo) <= range);
+}
+
+} // anonymous namespace
+
 Mask::Mask()
   : Object(ObjectType::Mask)
 {
@@ -74,13 +239,10 @@ bool Mask::isRectangular() const
   if (!m_bitmap)
     return false;
 
-  LockImageBits<BitmapTraits> bits(m_bitmap.get());
-  LockImageBits<BitmapTraits>::iterator it = bits.begin(), end = bits.end();
-
-  for (; it != end; ++it) {
-    if (*it == 0)
+  const Image* bitmap = m_bitmap.get();
+  for (int y=0; y<bitmap->height(); ++y)
+    if (!is_row_full(bitmap->getPixelAddress(0, y), bitmap->width()))
       return false;
-  }
 
   return true;
 }
@@ -115,11 +277,9 @@ void Mask::invert()
   if (!m_bitmap)
     return;
 
-  LockImageBits<BitmapTraits> bits(m_bitmap.get());
-  LockImageBits<BitmapTraits>::iterator it = bits.begin(), end = bits.end();
-
-  for (; it != end; ++it)
-    *it = (*it ? 0: 1);
+  Image* bitmap = m_bitmap.get();
+  for (int y=0; y<bitmap->height(); ++y)
+    invert_row(bitmap->getPixelAddress(0, y), bitmap->width());
 
   shrink();
 }
@@ -155,6 +315,13 @@ void Mask::subtract(const gfx::Rect& bounds)
     bounds.x-m_bounds.x+bounds.w-1,
     bounds.y-m_bounds.y+bounds.h-1, 0);
 
+  // The bounds are still the minimum ones if the subtracted area
+  // doesn't touch the border rows/columns (which contain selected
+  // pixels).
+  if (bounds.x > m_bounds.x && bounds.y > m_bounds.y &&
+      bounds.x2() < m_bounds.x2() && bounds.y2() < m_bounds.y2())
+    return;
+
   shrink();
 }
 
@@ -186,99 +353,46 @@ void Mask::byColor(const Image *src, int color, int fuzziness)
   replace(src->bounds());
 
   Image* dst = m_bitmap.get();
+  const unsigned range = unsigned(2*fuzziness);
 
   switch (src->pixelFormat()) {
 
     case IMAGE_RGB: {
-      const LockImageBits<RgbTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<RgbTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      int src_r, src_g, src_b, src_a;
-      int dst_r, dst_g, dst_b, dst_a;
-      color_t c;
-
-      dst_r = rgba_getr(color);
-      dst_g = rgba_getg(color);
-      dst_b = rgba_getb(color);
-      dst_a = rgba_geta(color);
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        src_r = rgba_getr(c);
-        src_g = rgba_getg(c);
-        src_b = rgba_getb(c);
-        src_a = rgba_geta(c);
-
-        if (!((src_r >= dst_r-fuzziness) && (src_r <= dst_r+fuzziness) &&
-              (src_g >= dst_g-fuzziness) && (src_g <= dst_g+fuzziness) &&
-              (src_b >= dst_b-fuzziness) && (src_b <= dst_b+fuzziness) &&
-              (src_a >= dst_a-fuzziness) && (src_a <= dst_a+fuzziness)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+      const int r = rgba_getr(color) - fuzziness;
+      const int g = rgba_getg(color) - fuzziness;
+      const int b = rgba_getb(color) - fuzziness;
+      const int a = rgba_geta(color) - fuzziness;
+      match_image<RgbTraits>(
+        src, dst,
+        [r, g, b, a, range](color_t c) {
+          return (in_range(rgba_getr(c), r, range) &
+                  in_range(rgba_getg(c), g, range) &
+                  in_range(rgba_getb(c), b, range) &
+                  in_range(rgba_geta(c), a, range));
+        });
       break;
     }
 
     case IMAGE_GRAYSCALE: {
-      const LockImageBits<GrayscaleTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<GrayscaleTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      int src_k, src_a;
-      int dst_k, dst_a;
-      color_t c;
-
-      dst_k = graya_getv(color);
-      dst_a = graya_geta(color);
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        src_k = graya_getv(c);
-        src_a = graya_geta(c);
-
-        if (!((src_k >= dst_k-fuzziness) && (src_k <= dst_k+fuzziness) &&
-              (src_a >= dst_a-fuzziness) && (src_a <= dst_a+fuzziness)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+      const int k = graya_getv(color) - fuzziness;
+      const int a = graya_geta(color) - fuzziness;
+      match_image<GrayscaleTraits>(
+        src, dst,
+        [k, a, range](uint16_t c) {
+          return (in_range(graya_getv(c), k, range) &
+                  in_range(graya_geta(c), a, range));
+        });
       break;
     }
 
     case IMAGE_INDEXED: {
-      const LockImageBits<IndexedTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<IndexedTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      color_t c, min, max;
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        if (color > fuzziness)
-          min = color-fuzziness;
-        else
-          min = 0;
-        max = color + fuzziness;
-
-        if (!((c >= min) && (c <= max)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+      const int min = std::max(color-fuzziness, 0);
+      const unsigned indexRange = unsigned(color+fuzziness-min);
+      match_image<IndexedTraits>(
+        src, dst,
+        [min, indexRange](uint8_t c) {
+          return in_range(c, min, indexRange);
+        });
       break;
     }
   }
@@ -381,58 +495,38 @@ void Mask::shrink()
   if (m_freeze_count > 0)
     return;
 
-#define SHRINK_SIDE(u_begin, u_op, u_final, u_add,                      \
-                    v_begin, v_op, v_final, v_add, U, V, var)           \
-  {                                                                     \
-    for (u = u_begin; u u_op u_final; u u_add) {                        \
-      for (v = v_begin; v v_op v_final; v v_add) {                      \
-        if (get_pixel_fast<BitmapTraits>(m_bitmap.get(), U, V))         \
-          break;                                                        \
-      }                                                                 \
-      if (v == v_final)                                                 \
-        var;                                                            \
-      else                                                              \
-        break;                                                          \
-    }                                                                   \
-  }
-
-  int u, v, x1, y1, x2, y2;
-
-  x1 = m_bounds.x;
-  y1 = m_bounds.y;
-  x2 = m_bounds.x+m_bounds.w-1;
-  y2 = m_bounds.y+m_bounds.h-1;
-
-  SHRINK_SIDE(0, <, m_bounds.w, ++,
-              0, <, m_bounds.h, ++, u, v, x1++);
+  if (!m_bitmap)
+    return;
 
-  SHRINK_SIDE(0, <, m_bounds.h, ++,
-              0, <, m_bounds.w, ++, v, u, y1++);
+  const Image* bitmap = m_bitmap.get();
+  const int w = bitmap->width();
+  int x1 = w, y1 = -1, x2 = -1, y2 = -1;
 
-  SHRINK_SIDE(m_bounds.w-1, >, 0, --,
-              0, <, m_bounds.h, ++, u, v, x2--);
+  for (int y=0; y<bitmap->height(); ++y) {
+    int first, last;
+    if (!row_bounds(bitmap->getPixelAddress(0, y), w, first, last))
+      continue;
 
-  SHRINK_SIDE(m_bounds.h-1, >, 0, --,
-              0, <, m_bounds.w, ++, v, u, y2--);
+    if (y1 < 0)
+      y1 = y;
+    y2 = y;
+    x1 = std::min(x1, first);
+    x2 = std::max(x2, last);
+  }
 
-  if ((x1 > x2) || (y1 > y2)) {
+  if (y1 < 0) {
     clear();
   }
-  else if ((x1 != m_bounds.x) || (x2 != m_bounds.x+m_bounds.w-1) ||
-           (y1 != m_bounds.y) || (y2 != m_bounds.y+m_bounds.h-1)) {
-    u = m_bounds.x;
-    v = m_bounds.y;
+  else if (x1 != 0 || y1 != 0 ||
+           x2 != w-1 || y2 != bitmap->height()-1) {
+    Image* image = crop_image(bitmap, x1, y1, x2-x1+1, y2-y1+1, 0);
+    m_bitmap.reset(image);
 
-    m_bounds.x = x1;
-    m_bounds.y = y1;
+    m_bounds.x += x1;
+    m_bounds.y += y1;
     m_bounds.w = x2 - x1 + 1;
     m_bounds.h = y2 - y1 + 1;
-
-    Image* image = crop_image(m_bitmap.get(), m_bounds.x-u, m_bounds.y-v, m_bounds.w, m_bounds.h, 0);
-    m_bitmap.reset(image);
   }
-
-#undef SHRINK_SIDE
 }
 
 } // namespace doc
@@ -39,10 +39,9 @@ void write_mask(std::ostream& os, const Mask* mask)
   write16(os, mask->bitmap() ? bounds.h: 0);    // Height
 
   if (mask->bitmap()) {
+    // The rows of the bitmap are contiguous
     int size = BitmapTraits::getRowStrideBytes(bounds.w);
-
-    for (int c=0; c<bounds.h; c++)
-      os.write((char*)mask->bitmap()->getPixelAddress(0, c), size);
+    os.write((char*)mask->bitmap()->getPixelAddress(0, 0), size*bounds.h);
   }
 }
 
@@ -59,8 +58,7 @@ Mask* read_mask(std::istream& is)
     int size = BitmapTraits::getRowStrideBytes(w);
 
     mask->add(gfx::Rect(x, y, w, h));
-    for (int c=0; c<mask->bounds().h; c++)
-      is.read((char*)mask->bitmap()->getPixelAddress(0, c), size);
+    is.read((char*)mask->bitmap()->getPixelAddress(0, 0), size*mask->bounds().h);
   }
 
   return mask.release();
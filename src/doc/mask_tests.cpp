@@ -0,0 +1,192 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/mask.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+// Simple version of the selection (one bool per pixel) to compare
+// with the results of Mask operations.
+class RefMask {
+public:
+  RefMask(int w, int h) : m_w(w), m_h(h), m_pixels(w*h, false) { }
+
+  void fill(const gfx::Rect& rc, bool value) {
+    for (int y=std::max(0, rc.y); y<std::min(m_h, rc.y2()); ++y)
+      for (int x=std::max(0, rc.x); x<std::min(m_w, rc.x2()); ++x)
+        m_pixels[y*m_w+x] = value;
+  }
+
+  void invert(const gfx::Rect& rc) {
+    for (int y=rc.y; y<rc.y2(); ++y)
+      for (int x=rc.x; x<rc.x2(); ++x)
+        m_pixels[y*m_w+x] = !m_pixels[y*m_w+x];
+  }
+
+  void intersect(const gfx::Rect& rc) {
+    for (int y=0; y<m_h; ++y)
+      for (int x=0; x<m_w; ++x)
+        if (!rc.contains(gfx::Point(x, y)))
+          m_pixels[y*m_w+x] = false;
+  }
+
+  bool get(int x, int y) const { return m_pixels[y*m_w+x]; }
+
+  gfx::Rect bounds() const {
+    gfx::Rect rc;
+    for (int y=0; y<m_h; ++y)
+      for (int x=0; x<m_w; ++x)
+        if (get(x, y))
+          rc |= gfx::Rect(x, y, 1, 1);
+    return rc;
+  }
+
+private:
+  int m_w, m_h;
+  std::vector<bool> m_pixels;
+};
+
+gfx::Rect random_rect(int w, int h)
+{
+  int x = rand() % w;
+  int y = rand() % h;
+  return gfx::Rect(x, y, 1 + rand() % (w-x), 1 + rand() % (h-y));
+}
+
+void expect_same(const RefMask& ref, const Mask& mask, int w, int h)
+{
+  const gfx::Rect bounds = ref.bounds();
+  if (bounds.isEmpty()) {
+    ASSERT_TRUE(mask.isEmpty());
+    return;
+  }
+
+  ASSERT_FALSE(mask.isEmpty());
+  ASSERT_EQ(bounds, mask.bounds());
+  for (int y=0; y<h; ++y)
+    for (int x=0; x<w; ++x)
+      ASSERT_EQ(ref.get(x, y), mask.containsPoint(x, y)) << x << "," << y;
+}
+
+} // anonymous namespace
+
+TEST(Mask, RandomOperations)
+{
+  for (int w : { 1, 7, 8, 9, 63, 64, 65, 150 }) {
+    const int h = 37;
+    RefMask ref(w, h);
+    Mask mask;
+
+    for (int i=0; i<200; ++i) {
+      gfx::Rect rc = random_rect(w, h);
+      switch (rand() % 4) {
+        case 0:
+          ref.fill(rc, true);
+          mask.add(rc);
+          break;
+        case 1:
+          ref.fill(rc, false);
+          mask.subtract(rc);
+          break;
+        case 2:
+          if (!mask.isEmpty()) {
+            ref.invert(mask.bounds());
+            mask.invert();
+          }
+          break;
+        case 3:
+          // Avoid empty masks most of the time
+          if (rand() % 4 == 0) {
+            ref.intersect(rc);
+            mask.intersect(rc);
+          }
+          break;
+      }
+      expect_same(ref, mask, w, h);
+
+      if (!mask.isEmpty()) {
+        const gfx::Rect bounds = mask.bounds();
+        bool full = true;
+        for (int y=bounds.y; y<bounds.y2() && full; ++y)
+          for (int x=bounds.x; x<bounds.x2() && full; ++x)
+            full = ref.get(x, y);
+        EXPECT_EQ(full, mask.isRectangular());
+      }
+    }
+  }
+}
+
+TEST(Mask, CopyFrom)
+{
+  Mask a;
+  a.add(gfx::Rect(3, 5, 70, 20));
+  a.subtract(gfx::Rect(10, 10, 5, 5));
+
+  Mask b;
+  b.copyFrom(&a);
+  EXPECT_EQ(a.bounds(), b.bounds());
+  for (int y=0; y<40; ++y)
+    for (int x=0; x<80; ++x)
+      ASSERT_EQ(a.containsPoint(x, y), b.containsPoint(x, y));
+}
+
+TEST(Mask, ByColor)
+{
+  std::srand(3);
+
+  // Sizes for the scalar tail and the parallel bands
+  for (int w : { 1, 63, 64, 130, 300 }) {
+    const int h = (w == 300 ? 200: 5);
+    std::unique_ptr<Image> rgb(Image::create(IMAGE_RGB, w, h));
+    std::unique_ptr<Image> indexed(Image::create(IMAGE_INDEXED, w, h));
+    for (int y=0; y<h; ++y)
+      for (int x=0; x<w; ++x) {
+        put_pixel(rgb.get(), x, y,
+                  rgba(std::rand() % 32, 100 + std::rand() % 8, 200, 255));
+        put_pixel(indexed.get(), x, y, std::rand() % 16);
+      }
+
+    for (int tolerance : { 0, 3, 20 }) {
+      const color_t rgbColor = rgba(16, 104, 200, 255);
+      const int index = 8;
+
+      Mask a, b;
+      a.byColor(rgb.get(), rgbColor, tolerance);
+      b.byColor(indexed.get(), index, tolerance);
+
+      for (int y=0; y<h; ++y)
+        for (int x=0; x<w; ++x) {
+          const color_t c = get_pixel(rgb.get(), x, y);
+          const bool inRgb =
+            (std::abs(int(rgba_getr(c)) - 16) <= tolerance &&
+             std::abs(int(rgba_getg(c)) - 104) <= tolerance);
+          ASSERT_EQ(inRgb, a.containsPoint(x, y));
+
+          const int i = int(get_pixel(indexed.get(), x, y));
+          ASSERT_EQ(std::abs(i - index) <= tolerance, b.containsPoint(x, y));
+        }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -11,17 +11,35 @@
 #include "doc/object.h"
 
 #include "base/debug.h"
-#include "base/mutex.h"
-#include "base/scoped_lock.h"
 
-#include <map>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
 namespace doc {
 
-static base::mutex mutex;
-static ObjectId newId = 0;
-// TODO Profile this and see if an unordered_map is better
-static std::map<ObjectId, Object*> objects;
+namespace {
+
+// The objects are distributed in several hash tables (by ID) with
+// their own mutex, so threads creating/destroying objects at the
+// same time (e.g. loading a sprite while the backup or a thumbnail
+// are generated) don't contend for the same lock.
+struct Shard {
+  std::mutex mutex;
+  std::unordered_map<ObjectId, Object*> objects;
+};
+
+const int kShards = 16;
+Shard shards[kShards];
+std::atomic<ObjectId> newId(0);
+std::atomic<MissingObjectHandler> missingObjectHandler(nullptr);
+
+inline Shard& shard_for(ObjectId id)
+{
+  return shards[id % kShards];
+}
+
+} // anonymous namespace
 
 Object::Object(ObjectType type)
   : m_type(type)
@@ -53,30 +71,34 @@ const ObjectId Object::id() const
   // The first time the ID is request, we store the object in the
   // "objects" hash table.
   if (!m_id) {
-    base::scoped_unlock hold(mutex);
-    m_id = ++newId;
-    objects.insert(std::make_pair(m_id, const_cast<Object*>(this)));
+    ObjectId id = ++newId;
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.objects.insert(std::make_pair(id, const_cast<Object*>(this)));
+    m_id = id;
   }
   return m_id;
 }
 
 void Object::setId(ObjectId id)
 {
-  base::scoped_unlock hold(mutex);
-
   if (m_id) {
-    auto it = objects.find(m_id);
-    ASSERT(it != objects.end());
+    Shard& shard = shard_for(m_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.objects.find(m_id);
+    ASSERT(it != shard.objects.end());
     ASSERT(it->second == this);
-    if (it != objects.end())
-      objects.erase(it);
+    if (it != shard.objects.end())
+      shard.objects.erase(it);
   }
 
   m_id = id;
 
   if (m_id) {
-    ASSERT(objects.find(m_id) == objects.end());
-    objects.insert(std::make_pair(m_id, this));
+    Shard& shard = shard_for(m_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ASSERT(shard.objects.find(m_id) == shard.objects.end());
+    shard.objects.insert(std::make_pair(m_id, this));
   }
 }
 
@@ -87,12 +109,25 @@ void Object::setVersion(ObjectVersion version)
 
 Object* get_object(ObjectId id)
 {
-  base::scoped_unlock hold(mutex);
-  auto it = objects.find(id);
-  if (it != objects.end())
-    return it->second;
+  {
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.objects.find(id);
+    if (it != shard.objects.end())
+      return it->second;
+  }
+
+  // The handler is called without the lock because it can create
+  // the object again (which registers its ID in the same shard).
+  if (MissingObjectHandler handler = missingObjectHandler)
+    return handler(id);
   else
     return nullptr;
 }
 
+void set_missing_object_handler(MissingObjectHandler handler)
+{
+  missingObjectHandler = handler;
+}
+
 } // namespace doc
@@ -52,6 +52,12 @@ namespace doc {
 
   Object* get_object(ObjectId id);
 
+  // Function called by get_object() when there is no object with the
+  // given ID, it can return an object that was temporarily removed
+  // from memory (e.g. a swapped image, see doc::ImageSwap).
+  typedef Object* (*MissingObjectHandler)(ObjectId id);
+  void set_missing_object_handler(MissingObjectHandler handler);
+
   template<typename T>
   inline T* get(ObjectId id) {
     return static_cast<T*>(get_object(id));
@@ -0,0 +1,84 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+// Measures the time to register (Object::id()), look up
+// (doc::get_object()) and unregister (~Object) objects from one or
+// several threads at the same time (like loading a sprite while the
+// backup and thumbnails are generated). Results are printed in CSV
+// format:
+//
+//   object_benchmark [--objects N]
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/object.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+class TestObject : public Object {
+public:
+  TestObject() : Object(ObjectType::Image) { }
+};
+
+void run_thread(int n)
+{
+  std::vector<std::unique_ptr<TestObject>> objects(n);
+  for (auto& obj : objects) {
+    obj.reset(new TestObject);
+    obj->id();
+  }
+  for (auto& obj : objects) {
+    if (get_object(obj->id()) != obj.get())
+      std::abort();
+  }
+  objects.clear();
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  int n = 200000;
+  if (argc == 3 && std::strcmp(argv[1], "--objects") == 0)
+    n = std::max(1, std::atoi(argv[2]));
+  else if (argc != 1) {
+    std::fprintf(stderr, "Usage: %s [--objects N]\n", argv[0]);
+    return 1;
+  }
+
+  std::printf("threads,objects_per_thread,msecs,mobjects_per_sec\n");
+
+  for (int threads : { 1, 2, 4, 8 }) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i=0; i<threads; ++i)
+      workers.emplace_back(run_thread, n);
+    for (auto& worker : workers)
+      worker.join();
+
+    double secs = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%d,%d,%.3f,%.3f\n", threads, n, secs*1000.0,
+                double(n)*threads / secs / 1000000.0);
+    std::fflush(stdout);
+  }
+  return 0;
+}
@@ -217,8 +217,10 @@ int Palette::findBestfit(int r, int g, int b, int a, int mask_index) const
   ASSERT(b >= 0 && b <= 255);
   ASSERT(a >= 0 && a <= 255);
 
-  if (col_diff.empty())
-    initBestfit();
+  // Thread-safe initialization (RgbMap::calculateAll() uses several
+  // threads).
+  static const bool initialized = (initBestfit(), true);
+  (void)initialized;
 
   r >>= 3;
   g >>= 3;
@@ -15,6 +15,7 @@
 
 #include <iostream>
 #include <memory>
+#include <vector>
 
 namespace doc {
 
@@ -30,13 +31,15 @@ using namespace base::serialization::little_endian;
 
 void write_palette(std::ostream& os, const Palette& palette)
 {
-  write16(os, palette.frame()); // Frame
-  write16(os, palette.size());  // Number of colors
+  buffer_writer w(4 + 4*palette.size());
+  w.write16(palette.frame()); // Frame
+  w.write16(palette.size());  // Number of colors
 
   for (int c=0; c<palette.size(); c++) {
     uint32_t color = palette.getEntry(c);
-    write32(os, color);
+    w.write32(color);
   }
+  w.flush_to(os);
 }
 
 std::shared_ptr<Palette> read_palette(std::istream& is)
@@ -47,8 +50,11 @@ std::shared_ptr<Palette> read_palette(std::istream& is)
   auto palette = Palette::create(ncolors);
   palette->setFrame(frame);
 
+  std::vector<uint8_t> colors;
+  read_block(is, 4*ncolors, colors);
+  buffer_reader r(colors.data(), colors.size());
   for (int c=0; c<ncolors; ++c) {
-    uint32_t color = read32(is);
+    uint32_t color = r.read32();
     palette->setEntry(c, color);
   }
 
@@ -0,0 +1,145 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/polygon.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+const int kSize = 64;
+
+struct Span {
+  int x1, y, x2;
+};
+
+// Number of times that each pixel was filled
+struct Fill {
+  std::vector<int> count;
+  std::vector<Span> spans;
+
+  Fill() : count(kSize*kSize, 0) { }
+
+  void hline(int x1, int y, int x2) {
+    spans.push_back(Span{ x1, y, x2 });
+    for (int x=x1; x<=x2; ++x)
+      if (x >= 0 && x < kSize && y >= 0 && y < kSize)
+        ++count[y*kSize + x];
+  }
+};
+
+// The previous scanline polygon algorithm (it visits all the edges
+// in each scanline and paints the overlapping spans twice).
+void reference_polygon(const std::vector<int>& p, Fill& fill)
+{
+  const int n = int(p.size()/2);
+  int miny = p[1], maxy = p[1];
+  for (int i=1; i<n; ++i) {
+    miny = std::min(miny, p[2*i+1]);
+    maxy = std::max(maxy, p[2*i+1]);
+  }
+
+  std::vector<int> ints;
+  for (int y=miny; y<=maxy; ++y) {
+    ints.clear();
+    for (int i=0; i<n; ++i) {
+      const int ind1 = (i ? i-1: n-1);
+      const int ind2 = i;
+      int x1, y1, x2, y2;
+      if (p[2*ind1+1] < p[2*ind2+1]) {
+        x1 = p[2*ind1]; y1 = p[2*ind1+1];
+        x2 = p[2*ind2]; y2 = p[2*ind2+1];
+      }
+      else if (p[2*ind1+1] > p[2*ind2+1]) {
+        x1 = p[2*ind2]; y1 = p[2*ind2+1];
+        x2 = p[2*ind1]; y2 = p[2*ind1+1];
+      }
+      else
+        continue;
+
+      if ((y >= y1 && y < y2) ||
+          (y == maxy && y > y1 && y <= y2)) {
+        ints.push_back((int) ((float) ((y - y1) * (x2 - x1)) /
+                              (float) (y2 - y1) + 0.5 + x1));
+      }
+    }
+    std::sort(ints.begin(), ints.end());
+    for (int i=0; i+1<int(ints.size()); i+=2)
+      fill.hline(ints[i], y, ints[i+1]);
+  }
+}
+
+void fill_polygon(const std::vector<int>& p, Fill& fill)
+{
+  algorithm::polygon(int(p.size()/2), &p[0], 2, &fill,
+                     [](int x1, int y, int x2, void* data){
+                       static_cast<Fill*>(data)->hline(x1, y, x2);
+                     });
+}
+
+} // anonymous namespace
+
+TEST(Polygon, Triangle)
+{
+  std::vector<int> p = { 2, 2, 10, 2, 2, 10 };
+  Fill fill;
+  fill_polygon(p, fill);
+
+  ASSERT_FALSE(fill.spans.empty());
+  EXPECT_EQ(2, fill.spans.front().y);
+  EXPECT_EQ(2, fill.spans.front().x1);
+  EXPECT_EQ(10, fill.spans.front().x2);
+  EXPECT_EQ(10, fill.spans.back().y);
+
+  for (const Span& span : fill.spans)
+    EXPECT_EQ(2, span.x1);
+}
+
+TEST(Polygon, SameAreaThanReference)
+{
+  std::mt19937 rnd(1);
+  for (int t=0; t<500; ++t) {
+    std::vector<int> p(2*(3 + rnd() % 20));
+    for (int& v : p)
+      v = rnd() % kSize;
+
+    Fill fill, reference;
+    fill_polygon(p, fill);
+    reference_polygon(p, reference);
+
+    for (int i=0; i<kSize*kSize; ++i)
+      EXPECT_EQ(reference.count[i] > 0, fill.count[i] > 0) << "test " << t;
+
+    // Spans are painted once, and each span of a scanline is
+    // separated by at least one pixel
+    for (int i=0; i<kSize*kSize; ++i)
+      EXPECT_LE(fill.count[i], 1);
+    for (std::size_t i=1; i<fill.spans.size(); ++i) {
+      const Span& a = fill.spans[i-1];
+      const Span& b = fill.spans[i];
+      if (a.y == b.y)
+        EXPECT_LT(a.x2+1, b.x1);
+      else
+        EXPECT_LT(a.y, b.y);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -10,13 +10,17 @@
 
 #include "doc/primitives.h"
 
+#include "base/thread_pool.h"
 #include "doc/algo.h"
 #include "doc/brush.h"
 #include "doc/image_impl.h"
+#include "doc/image_spans.h"
 #include "doc/palette.h"
 #include "doc/remap.h"
 #include "doc/rgbmap.h"
 
+#include <algorithm>
+#include <array>
 #include <stdexcept>
 
 namespace doc {
@@ -69,7 +73,10 @@ Image* crop_image(const Image* image, int x, int y, int w, int h, color_t bg, co
   if (w < 1) throw std::invalid_argument("crop_image: Width is less than 1");
   if (h < 1) throw std::invalid_argument("crop_image: Height is less than 1");
 
-  Image* trim = Image::create(image->pixelFormat(), w, h, buffer);
+  // All pixels are overwritten, so a new buffer doesn't need to be
+  // zero-filled.
+  Image* trim = Image::create(image->pixelFormat(), w, h,
+                              buffer ? buffer: ImageBufferPtr(new ImageBuffer(1, ImageBuffer::Uninitialized)));
   trim->setMaskColor(image->maskColor());
 
   clear_image(trim, bg);
@@ -83,18 +90,86 @@ Image* crop_image(const Image* image, const gfx::Rect& bounds, color_t bg, const
   return crop_image(image, bounds.x, bounds.y, bounds.w, bounds.h, bg, buffer);
 }
 
-void rotate_image(const Image* src, Image* dst, int angle)
+namespace {
+
+// Size of the square tiles used to rotate 90 degrees, the rows of a
+// tile (in the source and in the destination) stay in the cache while
+// it's transposed.
+const int kRotateTileSize = 32;
+
+// Images with less pixels than this are rotated in just one thread.
+const int kRotateParallelPixels = 256*256;
+
+template<typename ImageTraits>
+void rotate_image_templ(const Image* src, Image* dst, int angle)
+{
+  typedef typename ImageTraits::address_t address_t;
+  typedef typename ImageTraits::const_address_t const_address_t;
+
+  const int w = src->width();
+  const int h = src->height();
+  const int bands = (h + kRotateTileSize - 1) / kRotateTileSize;
+
+  // Each band of source rows is written to different pixels of the
+  // destination, so bands can be rotated in parallel.
+  auto rotateBand = [=](int band) {
+    const int y1 = band*kRotateTileSize;
+    const int y2 = std::min(y1+kRotateTileSize, h);
+
+    if (angle == 180) {
+      for (int y=y1; y<y2; ++y) {
+        auto srcRow = (const_address_t)src->getPixelAddress(0, y);
+        std::reverse_copy(srcRow, srcRow+w,
+                          (address_t)dst->getPixelAddress(0, h-y-1));
+      }
+      return;
+    }
+
+    // Rows of the destination that receive the pixels of a tile
+    address_t dstRows[kRotateTileSize];
+
+    for (int x1=0; x1<w; x1+=kRotateTileSize) {
+      const int x2 = std::min(x1+kRotateTileSize, w);
+      const int n = x2 - x1;
+
+      if (angle == 90) {
+        // src(x, y) -> dst(h-y-1, x)
+        for (int i=0; i<n; ++i)
+          dstRows[i] = (address_t)dst->getPixelAddress(0, x1+i);
+        for (int y=y1; y<y2; ++y) {
+          auto srcPtr = (const_address_t)src->getPixelAddress(x1, y);
+          const int u = h-y-1;
+          for (int i=0; i<n; ++i)
+            dstRows[i][u] = srcPtr[i];
+        }
+      }
+      else {
+        // src(x, y) -> dst(y, w-x-1)
+        for (int i=0; i<n; ++i)
+          dstRows[i] = (address_t)dst->getPixelAddress(0, w-x1-i-1);
+        for (int y=y1; y<y2; ++y) {
+          auto srcPtr = (const_address_t)src->getPixelAddress(x1, y);
+          for (int i=0; i<n; ++i)
+            dstRows[i][y] = srcPtr[i];
+        }
+      }
+    }
+  };
+
+  if (w*h >= kRotateParallelPixels)
+    base::thread_pool::instance().parallel_for(bands, rotateBand);
+  else
+    for (int band=0; band<bands; ++band)
+      rotateBand(band);
+}
+
+void rotate_image_generic(const Image* src, Image* dst, int angle)
 {
-  ASSERT(src);
-  ASSERT(dst);
   int x, y;
 
   switch (angle) {
 
     case 180:
-      ASSERT(dst->width() == src->width());
-      ASSERT(dst->height() == src->height());
-
       for (y=0; y<src->height(); ++y)
         for (x=0; x<src->width(); ++x)
           dst->putPixel(src->width() - x - 1,
@@ -102,27 +177,55 @@ void rotate_image(const Image* src, Image* dst, int angle)
       break;
 
     case 90:
-      ASSERT(dst->width() == src->height());
-      ASSERT(dst->height() == src->width());
-
       for (y=0; y<src->height(); ++y)
         for (x=0; x<src->width(); ++x)
           dst->putPixel(src->height() - y - 1, x, src->getPixel(x, y));
       break;
 
     case -90:
-      ASSERT(dst->width() == src->height());
-      ASSERT(dst->height() == src->width());
-
       for (y=0; y<src->height(); ++y)
         for (x=0; x<src->width(); ++x)
           dst->putPixel(y, src->width() - x - 1, src->getPixel(x, y));
       break;
+  }
+}
+
+} // anonymous namespace
+
+void rotate_image(const Image* src, Image* dst, int angle)
+{
+  ASSERT(src);
+  ASSERT(dst);
+
+  switch (angle) {
+
+    case 180:
+      ASSERT(dst->width() == src->width());
+      ASSERT(dst->height() == src->height());
+      break;
+
+    case 90:
+    case -90:
+      ASSERT(dst->width() == src->height());
+      ASSERT(dst->height() == src->width());
+      break;
 
     // bad angle
     default:
       throw std::invalid_argument("Invalid angle specified to rotate the image");
   }
+
+  ASSERT(src->pixelFormat() == dst->pixelFormat());
+
+  switch (src->pixelFormat()) {
+    case IMAGE_RGB:       rotate_image_templ<RgbTraits>(src, dst, angle); break;
+    case IMAGE_GRAYSCALE: rotate_image_templ<GrayscaleTraits>(src, dst, angle); break;
+    case IMAGE_INDEXED:   rotate_image_templ<IndexedTraits>(src, dst, angle); break;
+    default:
+      // Bitmaps (e.g. masks) are bit-packed
+      rotate_image_generic(src, dst, angle);
+      break;
+  }
 }
 
 void draw_hline(Image* image, int x1, int y, int x2, color_t color)
@@ -334,19 +437,74 @@ int count_diff_between_images(const Image* i1, const Image* i2)
   return -1;
 }
 
-void remap_image(Image* image, const Remap& remap)
+namespace {
+
+// Number of rows remapped by each job of the thread pool
+const int kRemapRowsPerJob = 64;
+
+// Images with less pixels than this are remapped in just one thread.
+const int kRemapParallelPixels = 256*256;
+
+// Remap table for 8-bit images (indexes outside the Remap aren't
+// changed)
+typedef std::array<uint8_t, 256> RemapTable;
+
+RemapTable create_remap_table(const Remap& remap)
+{
+  RemapTable table;
+  for (int i=0; i<256; ++i)
+    table[i] = uint8_t(remap[i]);
+  return table;
+}
+
+void remap_rows(Image* image, const RemapTable& table, int y1, int y2)
+{
+  const uint8_t* lut = table.data();
+  for (const auto& span : ImageSpans<IndexedTraits>(
+         image, gfx::Rect(0, y1, image->width(), y2-y1), true)) {
+    uint8_t* p = span.begin;
+    const int n = span.size();
+    for (int i=0; i<n; ++i)
+      p[i] = lut[p[i]];
+  }
+}
+
+void remap_image_with_table(Image* image, const RemapTable& table)
 {
   ASSERT(image->pixelFormat() == IMAGE_INDEXED);
   if (image->pixelFormat() != IMAGE_INDEXED)
     return;
 
-  LockImageBits<IndexedTraits> bits(image);
-  LockImageBits<IndexedTraits>::iterator
-    it = bits.begin(),
-    end = bits.end();
+  const int h = image->height();
+  if (image->width()*h < kRemapParallelPixels) {
+    remap_rows(image, table, 0, h);
+    return;
+  }
+
+  const int bands = (h + kRemapRowsPerJob - 1) / kRemapRowsPerJob;
+  base::thread_pool::instance().parallel_for(
+    bands,
+    [image, &table, h](int i) {
+      const int y1 = i*kRemapRowsPerJob;
+      remap_rows(image, table, y1, std::min(y1+kRemapRowsPerJob, h));
+    });
+}
 
-  for (; it != end; ++it)
-    *it = remap[*it];
+} // anonymous namespace
+
+void remap_image(Image* image, const Remap& remap)
+{
+  remap_image_with_table(image, create_remap_table(remap));
+}
+
+void remap_images(const std::vector<Image*>& images, const Remap& remap)
+{
+  const RemapTable table = create_remap_table(remap);
+  base::thread_pool::instance().parallel_for(
+    int(images.size()),
+    [&images, &table](int i) {
+      remap_image_with_table(images[i], table);
+    });
 }
 
 } // namespace doc
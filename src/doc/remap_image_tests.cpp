@@ -0,0 +1,90 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "doc/remap.h"
+#include "doc/test_image.h"
+
+#include <memory>
+#include <vector>
+
+using namespace doc;
+
+TEST(RemapImage, MatchesRemap)
+{
+  Remap remap(256);
+  for (int i=0; i<256; ++i)
+    remap.map(i, (i*7 + 3) & 0xff);
+
+  // The last size is remapped in parallel bands
+  for (const gfx::Size& size : { gfx::Size(1, 1), gfx::Size(13, 7),
+                                 gfx::Size(300, 301) }) {
+    std::unique_ptr<Image> orig = create_random_image(IMAGE_INDEXED, size.w, size.h);
+    std::unique_ptr<Image> image(Image::createCopy(orig.get()));
+    remap_image(image.get(), remap);
+
+    int errors = 0;
+    for (int y=0; y<size.h; ++y)
+      for (int x=0; x<size.w; ++x)
+        if (get_pixel(image.get(), x, y) != color_t(remap[get_pixel(orig.get(), x, y)]))
+          ++errors;
+    EXPECT_EQ(0, errors) << "size " << size.w << "x" << size.h;
+  }
+}
+
+TEST(RemapImage, SmallRemapKeepsOtherIndexes)
+{
+  Remap remap(4);
+  remap.map(0, 3);
+  remap.map(1, 2);
+  remap.map(2, 1);
+  remap.map(3, 0);
+
+  std::unique_ptr<Image> image(Image::create(IMAGE_INDEXED, 6, 1));
+  for (int x=0; x<6; ++x)
+    put_pixel(image.get(), x, 0, x);
+  remap_image(image.get(), remap);
+
+  const color_t expected[] = { 3, 2, 1, 0, 4, 5 };
+  for (int x=0; x<6; ++x)
+    EXPECT_EQ(expected[x], get_pixel(image.get(), x, 0));
+}
+
+TEST(RemapImage, SeveralImages)
+{
+  Remap remap(256);
+  for (int i=0; i<256; ++i)
+    remap.map(i, 255-i);
+
+  std::vector<std::unique_ptr<Image>> origs, images;
+  std::vector<Image*> ptrs;
+  for (int i=0; i<9; ++i) {
+    origs.push_back(create_random_image(IMAGE_INDEXED, 10+i*37, 5+i*29));
+    images.emplace_back(Image::createCopy(origs.back().get()));
+    ptrs.push_back(images.back().get());
+  }
+  remap_images(ptrs, remap);
+
+  for (std::size_t i=0; i<images.size(); ++i) {
+    std::unique_ptr<Image> expected(Image::createCopy(origs[i].get()));
+    remap_image(expected.get(), remap);
+    EXPECT_EQ(0, count_diff_between_images(expected.get(), images[i].get()));
+    EXPECT_NE(0, count_diff_between_images(origs[i].get(), images[i].get()));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
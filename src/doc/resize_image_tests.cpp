@@ -13,7 +13,14 @@
 #include "doc/algorithm/resize_image.h"
 #include "doc/color.h"
 #include "doc/image.h"
+#include "doc/palette.h"
 #include "doc/primitives.h"
+#include "doc/rgbmap.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
 
 using namespace std;
 using namespace doc;
@@ -94,6 +101,123 @@ TEST(ResizeImage, BilinearInterpRGBType)
 }
 #endif
 
+// Per-pixel bilinear interpolation (the original implementation)
+color_t reference_bilinear(const Image* src, int dstW, int dstH, int x, int y)
+{
+  double u = x * (dstW > 1 ? (src->width()-1) * 1.0 / (dstW-1): 0.0);
+  double v = y * (dstH > 1 ? (src->height()-1) * 1.0 / (dstH-1): 0.0);
+  int u1 = std::min(int(std::floor(u)), src->width()-1);
+  int v1 = std::min(int(std::floor(v)), src->height()-1);
+  int u2 = std::min(u1+1, src->width()-1);
+  int v2 = std::min(v1+1, src->height()-1);
+  double fu = u - u1, fv = v - v1;
+  color_t c[4] = { get_pixel(src, u1, v1), get_pixel(src, u2, v1),
+                   get_pixel(src, u1, v2), get_pixel(src, u2, v2) };
+  int channels[4];
+  for (int i=0; i<4; ++i) {
+    int shift = 8*i;
+    double value =
+      (((c[0] >> shift) & 0xff)*(1-fu) + ((c[1] >> shift) & 0xff)*fu)*(1-fv) +
+      (((c[2] >> shift) & 0xff)*(1-fu) + ((c[3] >> shift) & 0xff)*fu)*fv;
+    channels[i] = int(value + 0.5);
+  }
+  return rgba(channels[0], channels[1], channels[2], channels[3]);
+}
+
+TEST(ResizeImage, BilinearMatchesReference)
+{
+  std::mt19937 rnd(1);
+  const gfx::Size sizes[][2] = {
+    { gfx::Size(3, 3), gfx::Size(9, 9) },
+    { gfx::Size(17, 5), gfx::Size(6, 11) },
+    { gfx::Size(1, 4), gfx::Size(5, 1) },
+    { gfx::Size(200, 150), gfx::Size(390, 280) }, // Resized in parallel
+  };
+
+  for (const auto& size : sizes) {
+    std::unique_ptr<Image> src(Image::create(IMAGE_RGB, size[0].w, size[0].h));
+    for (int y=0; y<src->height(); ++y)
+      for (int x=0; x<src->width(); ++x)
+        put_pixel(src.get(), x, y, rnd());
+
+    std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, size[1].w, size[1].h));
+    algorithm::resize_image(src.get(), dst.get(), algorithm::RESIZE_METHOD_BILINEAR,
+                            nullptr, nullptr, -1);
+
+    // The fixed point version can differ by 1 in each channel
+    int errors = 0;
+    for (int y=0; y<dst->height(); ++y)
+      for (int x=0; x<dst->width(); ++x) {
+        color_t a = get_pixel(dst.get(), x, y);
+        color_t b = reference_bilinear(src.get(), dst->width(), dst->height(), x, y);
+        for (int shift=0; shift<32; shift+=8)
+          if (std::abs(int((a >> shift) & 0xff) - int((b >> shift) & 0xff)) > 1)
+            ++errors;
+      }
+    EXPECT_EQ(0, errors) << size[0].w << "x" << size[0].h << " -> "
+                         << size[1].w << "x" << size[1].h;
+  }
+}
+
+TEST(ResizeImage, FiltersKeepFlatColors)
+{
+  auto pal = Palette::create(4);
+  pal->setEntry(0, rgba(0, 0, 0, 255));
+  pal->setEntry(1, rgba(255, 0, 0, 255));
+  pal->setEntry(2, rgba(0, 255, 0, 255));
+  pal->setEntry(3, rgba(0, 0, 255, 255));
+  RgbMap rgbmap;
+  rgbmap.regenerate(pal.get(), -1);
+
+  const std::pair<PixelFormat, color_t> colors[] = {
+    { IMAGE_RGB, rgba(10, 200, 30, 128) },
+    { IMAGE_GRAYSCALE, graya(77, 200) },
+    { IMAGE_INDEXED, 2 },
+  };
+
+  for (auto method : { algorithm::RESIZE_METHOD_BILINEAR,
+                       algorithm::RESIZE_METHOD_BICUBIC,
+                       algorithm::RESIZE_METHOD_LANCZOS }) {
+    for (const auto& pair : colors) {
+      for (const gfx::Size& size : { gfx::Size(1, 1), gfx::Size(7, 3),
+                                     gfx::Size(123, 80), gfx::Size(517, 411) }) {
+        std::unique_ptr<Image> src(Image::create(pair.first, 300, 200));
+        std::unique_ptr<Image> dst(Image::create(pair.first, size.w, size.h));
+        clear_image(src.get(), pair.second);
+
+        algorithm::resize_image(src.get(), dst.get(), method, pal.get(), &rgbmap, -1);
+
+        std::unique_ptr<Image> expected(Image::create(pair.first, size.w, size.h));
+        clear_image(expected.get(), pair.second);
+        EXPECT_EQ(0, count_diff_between_images(expected.get(), dst.get()))
+          << "method " << method << " format " << pair.first
+          << " size " << size.w << "x" << size.h;
+      }
+    }
+  }
+}
+
+TEST(ResizeImage, LanczosReducesGradient)
+{
+  // A horizontal gradient reduced to the half must be (almost) the
+  // same gradient
+  std::unique_ptr<Image> src(Image::create(IMAGE_GRAYSCALE, 256, 8));
+  for (int y=0; y<8; ++y)
+    for (int x=0; x<256; ++x)
+      put_pixel(src.get(), x, y, graya(x, 255));
+
+  std::unique_ptr<Image> dst(Image::create(IMAGE_GRAYSCALE, 128, 4));
+  algorithm::resize_image(src.get(), dst.get(), algorithm::RESIZE_METHOD_LANCZOS,
+                          nullptr, nullptr, -1);
+
+  // Pixels near the borders are affected by the clamped edges
+  for (int y=0; y<4; ++y)
+    for (int x=4; x<124; ++x) {
+      EXPECT_NEAR(2*x + 0.5, graya_getv(get_pixel(dst.get(), x, y)), 1.0);
+      EXPECT_EQ(255, graya_geta(get_pixel(dst.get(), x, y)));
+    }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
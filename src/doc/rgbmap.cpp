@@ -10,24 +10,65 @@
 
 #include "doc/rgbmap.h"
 
+#include "base/thread_pool.h"
 #include "doc/color_scales.h"
 #include "doc/palette.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace doc {
 
-#define RSIZE   32
-#define GSIZE   32
-#define BSIZE   32
-#define ASIZE   8
-#define MAPSIZE (RSIZE*GSIZE*BSIZE*ASIZE)
+namespace {
+
+// Weights of each component in the distance (the same of
+// Palette::findBestfit())
+inline int dist(int d, int w)
+{
+  return d*d*w*w;
+}
 
-RgbMap::RgbMap()
+// Scales a component of the given number of bits to 8 bits
+inline int scale_to_8bits(int value, int bits)
+{
+  const int max = (1 << bits) - 1;
+  return (value * 255 + max/2) / max;
+}
+
+// Maximum number of modified palette entries to recalculate only
+// the affected map entries (instead of the whole map).
+const int kMaxIncrementalChanges = 32;
+
+} // anonymous namespace
+
+RgbMap::RgbMap(int rgbBits, int alphaBits)
   : Object(ObjectType::RgbMap)
-  , m_map(MAPSIZE)
+  , m_rgbBits(rgbBits)
+  , m_alphaBits(alphaBits)
+  , m_rgbShift(8 - rgbBits)
+  , m_alphaShift(8 - alphaBits)
+  , m_rgbPrecisionShift(8 - std::max(5, rgbBits))
+  , m_alphaPrecisionShift(8 - std::max(5, alphaBits))
+  , m_map(std::size_t(1) << (3*rgbBits + alphaBits), INVALID)
   , m_palette(NULL)
   , m_modifications(0)
   , m_maskIndex(0)
+  , m_calculated(false)
 {
+  ASSERT(rgbBits >= 1 && rgbBits <= 8);
+  ASSERT(alphaBits >= 1 && alphaBits <= 8);
+  ASSERT(3*rgbBits + alphaBits <= 24);
+
+  // The values compared for each map entry are the quantized
+  // components scaled to 8 bits (e.g. with 5 bits, 0..31 values are
+  // 0..255) and then reduced to the comparison precision.
+  m_rgbValues.resize(1 << rgbBits);
+  for (int v=0; v<int(m_rgbValues.size()); ++v)
+    m_rgbValues[v] = scale_to_8bits(v, rgbBits) >> m_rgbPrecisionShift;
+
+  m_alphaValues.resize(1 << alphaBits);
+  for (int v=0; v<int(m_alphaValues.size()); ++v)
+    m_alphaValues[v] = scale_to_8bits(v, alphaBits) >> m_alphaPrecisionShift;
 }
 
 bool RgbMap::match(const Palette* palette) const
@@ -38,23 +79,194 @@ bool RgbMap::match(const Palette* palette) const
 
 void RgbMap::regenerate(const Palette* palette, int mask_index)
 {
+  std::vector<Entry> oldColors;
+  std::swap(oldColors, m_colors);
+  const bool canUpdate = (m_palette &&
+                          m_maskIndex == mask_index &&
+                          !m_entries.empty());
+
   m_palette = palette;
   m_modifications = palette->getModifications();
   m_maskIndex = mask_index;
 
+  int size = std::min(256, palette->size());
+  m_colors.resize(size);
+  m_entries.clear();
+  for (int i=0; i<size; ++i) {
+    color_t c = palette->getEntry(i);
+    Entry& e = m_colors[i];
+    e.r = rgba_getr(c) >> m_rgbPrecisionShift;
+    e.g = rgba_getg(c) >> m_rgbPrecisionShift;
+    e.b = rgba_getb(c) >> m_rgbPrecisionShift;
+    e.a = rgba_geta(c) >> m_alphaPrecisionShift;
+    e.index = i;
+    if (i != mask_index)
+      m_entries.push_back(e);
+  }
+  std::stable_sort(m_entries.begin(), m_entries.end(),
+                   [](const Entry& a, const Entry& b) {
+                     return a.g < b.g;
+                   });
+
+  // Only some colors were modified (e.g. a palette entry is being
+  // edited)
+  if (canUpdate && !m_entries.empty() && oldColors.size() == m_colors.size()) {
+    std::vector<int> modified;
+    for (int i=0; i<size; ++i)
+      if (!(oldColors[i] == m_colors[i]))
+        modified.push_back(i);
+
+    if (int(modified.size()) <= kMaxIncrementalChanges) {
+      if (!modified.empty()) {
+        invalidateEntries(modified);
+        m_calculated = false;
+      }
+      return;
+    }
+  }
+
   // Mark all entries as invalid (need to be regenerated)
   for (uint16_t& entry : m_map)
     entry |= INVALID;
+  m_calculated = false;
+}
+
+void RgbMap::calculateAll()
+{
+  forEachEntry(
+    [this](int i) {
+      if (m_map[i] & INVALID)
+        generateEntry(i);
+    });
+  m_calculated = true;
+}
+
+template<typename Func>
+void RgbMap::forEachEntry(Func func)
+{
+  // Each job processes all the entries with the same red component
+  const int n = (1 << m_rgbBits);
+  const int perJob = (1 << (2*m_rgbBits + m_alphaBits));
+  base::thread_pool::instance().parallel_for(
+    n,
+    [&func, perJob](int r) {
+      for (int i=r*perJob, end=i+perJob; i<end; ++i)
+        func(i);
+    });
 }
 
-int RgbMap::generateEntry(int i, int r, int g, int b, int a) const
+RgbMap::Entry RgbMap::entryColor(int i) const
 {
-  return m_map[i] =
-    m_palette->findBestfit(
-      scale_5bits_to_8bits(r>>3),
-      scale_5bits_to_8bits(g>>3),
-      scale_5bits_to_8bits(b>>3),
-      scale_3bits_to_8bits(a>>5), m_maskIndex);
+  const int rgbMask = (1 << m_rgbBits) - 1;
+  Entry c;
+  c.a = m_alphaValues[i & ((1 << m_alphaBits) - 1)];
+  i >>= m_alphaBits;
+  c.b = m_rgbValues[i & rgbMask];
+  i >>= m_rgbBits;
+  c.g = m_rgbValues[i & rgbMask];
+  i >>= m_rgbBits;
+  c.r = m_rgbValues[i & rgbMask];
+  c.index = -1;
+  return c;
+}
+
+int RgbMap::generateEntry(int i) const
+{
+  return m_map[i] = findBestfit(entryColor(i));
+}
+
+// Same result as Palette::findBestfit() (the same distance, and the
+// lowest index when there are several entries at the same
+// distance), but it only visits the entries which green component
+// is near enough to the given one.
+int RgbMap::findBestfit(const Entry& c) const
+{
+  // Mask index is like alpha = 0, so we can use it as transparent color.
+  if (c.a == 0 && m_maskIndex >= 0)
+    return m_maskIndex;
+
+  int bestfit = 0;
+  int lowest = std::numeric_limits<int>::max();
+
+  auto check = [&](const Entry& e, int gdiff) {
+    int d = gdiff
+      + dist(e.r - c.r, 30)
+      + dist(e.b - c.b, 11)
+      + dist(e.a - c.a, 8);
+    if (d < lowest || (d == lowest && e.index < bestfit)) {
+      bestfit = e.index;
+      lowest = d;
+    }
+  };
+
+  auto it = std::lower_bound(m_entries.begin(), m_entries.end(), c.g,
+                             [](const Entry& e, int g) { return e.g < g; });
+
+  // Entries with green >= c.g
+  for (auto hi=it; hi!=m_entries.end(); ++hi) {
+    int gdiff = dist(hi->g - c.g, 59);
+    if (gdiff > lowest)
+      break;
+    check(*hi, gdiff);
+  }
+
+  // Entries with green < c.g
+  for (auto lo=it; lo!=m_entries.begin(); ) {
+    --lo;
+    int gdiff = dist(lo->g - c.g, 59);
+    if (gdiff > lowest)
+      break;
+    check(*lo, gdiff);
+  }
+
+  return bestfit;
+}
+
+// Invalidates the map entries that are mapped to one of the modified
+// palette entries, or that could be mapped to the new color of one of
+// them.
+void RgbMap::invalidateEntries(const std::vector<int>& modifiedIndexes)
+{
+  std::vector<bool> isModified(m_colors.size(), false);
+  std::vector<const Entry*> modified;
+  for (int i : modifiedIndexes) {
+    isModified[i] = true;
+    if (i != m_maskIndex)
+      modified.push_back(&m_colors[i]);
+  }
+
+  auto distance = [](const Entry& a, const Entry& b) {
+    return
+      dist(a.g - b.g, 59) +
+      dist(a.r - b.r, 30) +
+      dist(a.b - b.b, 11) +
+      dist(a.a - b.a, 8);
+  };
+
+  forEachEntry(
+    [&](int i) {
+      int v = m_map[i];
+      if (v & INVALID)
+        return;
+
+      const Entry c = entryColor(i);
+      if (c.a == 0 && m_maskIndex >= 0)
+        return;
+
+      if (v >= int(m_colors.size()) || isModified[v]) {
+        m_map[i] |= INVALID;
+        return;
+      }
+
+      const int current = distance(c, m_colors[v]);
+      for (const Entry* e : modified) {
+        const int d = distance(c, *e);
+        if (d < current || (d == current && e->index < v)) {
+          m_map[i] |= INVALID;
+          return;
+        }
+      }
+    });
 }
 
 } // namespace doc
@@ -22,31 +22,96 @@ namespace doc {
     const int INVALID = 256;
 
   public:
-    RgbMap();
+    // The map has one entry for each RGBA color quantized to the
+    // given number of bits per component (by default 5 bits for
+    // RGB and 3 bits for alpha, 256K entries, the results are the
+    // same as Palette::findBestfit()). With more bits the colors are
+    // compared with more precision, e.g. RgbMap(6, 4) uses 4M
+    // entries (the map must have 24 bits at most).
+    RgbMap(int rgbBits = 5, int alphaBits = 3);
 
     bool match(const Palette* palette) const;
+
+    // Uses the given palette for the next mapColor() calls. If only
+    // some palette entries were modified since the last call, only
+    // the map entries that could be affected by these colors are
+    // calculated again.
     void regenerate(const Palette* palette, int mask_index);
 
+    // Calculates all the entries of the map now (using several
+    // threads) instead of one by one in mapColor(). Useful for batch
+    // jobs that map more colors than the size() of the map (e.g.
+    // convert big images to indexed).
+    void calculateAll();
+
+    // True if all entries are calculated (since the last
+    // calculateAll() call), so mapColor() doesn't modify the map and
+    // can be called from several threads at the same time.
+    bool isCalculated() const { return m_calculated; }
+
+    int size() const { return int(m_map.size()); }
+    int rgbBits() const { return m_rgbBits; }
+    int alphaBits() const { return m_alphaBits; }
+
     int mapColor(int r, int g, int b, int a) const {
       ASSERT(r >= 0 && r < 256);
       ASSERT(g >= 0 && g < 256);
       ASSERT(b >= 0 && b < 256);
       ASSERT(a >= 0 && a < 256);
-      // bits -> bbbbbgggggrrrrraaa
-      int i = (a>>5) | ((b>>3) << 3) | ((g>>3) << 8) | ((r>>3) << 13);
+      // bits -> rrrrrgggggbbbbbaaa (with the default resolution)
+      int i =
+        (a >> m_alphaShift) |
+        ((b >> m_rgbShift) << m_alphaBits) |
+        ((g >> m_rgbShift) << (m_alphaBits + m_rgbBits)) |
+        ((r >> m_rgbShift) << (m_alphaBits + 2*m_rgbBits));
       int v = m_map[i];
-      return (v & INVALID) ? generateEntry(i, r, g, b, a): v;
+      return (v & INVALID) ? generateEntry(i): v;
     }
 
     int maskIndex() const { return m_maskIndex; }
 
   private:
-    int generateEntry(int i, int r, int g, int b, int a) const;
+    // Palette entry quantized to the precision used to compare
+    // colors (5 bits per component by default, the same precision
+    // of Palette::findBestfit()).
+    struct Entry {
+      int r, g, b, a;
+      int index;
+      bool operator==(const Entry& o) const {
+        return r == o.r && g == o.g && b == o.b && a == o.a;
+      }
+    };
+
+    // Calls func(i) for each entry of the map using several threads.
+    template<typename Func>
+    void forEachEntry(Func func);
+
+    Entry entryColor(int i) const;
+    int generateEntry(int i) const;
+    int findBestfit(const Entry& c) const;
+    void invalidateEntries(const std::vector<int>& modifiedIndexes);
+
+    int m_rgbBits;
+    int m_alphaBits;
+    int m_rgbShift;
+    int m_alphaShift;
+    // Values to compare (in the comparison precision) for each
+    // quantized component
+    std::vector<int> m_rgbValues;
+    std::vector<int> m_alphaValues;
+    int m_rgbPrecisionShift;
+    int m_alphaPrecisionShift;
 
     mutable std::vector<uint16_t> m_map;
+    // Quantized palette colors by palette index
+    std::vector<Entry> m_colors;
+    // Palette entries sorted by green (the component with more weight
+    // in the distance) to discard most of them in findBestfit().
+    std::vector<Entry> m_entries;
     const Palette* m_palette;
     int m_modifications;
     int m_maskIndex;
+    bool m_calculated;
 
     DISABLE_COPYING(RgbMap);
   };
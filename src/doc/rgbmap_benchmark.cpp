@@ -0,0 +1,98 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "tests/benchmark.h"
+
+#include "doc/color.h"
+#include "doc/palette.h"
+#include "doc/rgbmap.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+void fill_palette(Palette& palette)
+{
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> dist(0, 255);
+  for (int i=0; i<palette.size(); ++i)
+    palette.setEntry(i, rgba(dist(rng), dist(rng), dist(rng), 255));
+}
+
+std::vector<color_t> random_colors(int n)
+{
+  std::mt19937 rng(2);
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::vector<color_t> colors;
+  for (int i=0; i<n; ++i)
+    colors.push_back(rgba(dist(rng), dist(rng), dist(rng), 255));
+  return colors;
+}
+
+int map_colors(const RgbMap& rgbmap, const std::vector<color_t>& colors)
+{
+  int sum = 0;
+  for (color_t c : colors)
+    sum += rgbmap.mapColor(rgba_getr(c), rgba_getg(c), rgba_getb(c), rgba_geta(c));
+  return sum;
+}
+
+} // anonymous namespace
+
+// Regenerates the map after a palette entry changes and maps some
+// colors (like drawing after each palette edit).
+BENCHMARK(RgbMap, RegenerateAndMap4K) {
+  std::shared_ptr<Palette> palette = Palette::create(256);
+  fill_palette(*palette);
+  const std::vector<color_t> colors = random_colors(4096);
+  RgbMap rgbmap;
+  state.run([&]{
+      palette->setEntry(0, palette->getEntry(0) ^ 1);
+      rgbmap.regenerate(palette.get(), -1);
+      int res = map_colors(rgbmap, colors);
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(RgbMap, CalculateAll) {
+  std::shared_ptr<Palette> palette = Palette::create(256);
+  fill_palette(*palette);
+  RgbMap rgbmap;
+  state.run([&]{
+      palette->setEntry(0, palette->getEntry(0) ^ 1);
+      rgbmap.regenerate(palette.get(), -1);
+      rgbmap.calculateAll();
+    });
+}
+
+BENCHMARK(RgbMap, MapCalculated64K) {
+  std::shared_ptr<Palette> palette = Palette::create(256);
+  fill_palette(*palette);
+  const std::vector<color_t> colors = random_colors(65536);
+  RgbMap rgbmap;
+  rgbmap.regenerate(palette.get(), -1);
+  rgbmap.calculateAll();
+  state.run([&]{
+      int res = map_colors(rgbmap, colors);
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(Palette, FindBestfit4K) {
+  std::shared_ptr<Palette> palette = Palette::create(256);
+  fill_palette(*palette);
+  const std::vector<color_t> colors = random_colors(4096);
+  state.run([&]{
+      int sum = 0;
+      for (color_t c : colors)
+        sum += palette->findBestfit(rgba_getr(c), rgba_getg(c), rgba_getb(c), 255, -1);
+      benchmark::do_not_optimize(sum);
+    });
+}
@@ -0,0 +1,144 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/color_scales.h"
+#include "doc/palette.h"
+#include "doc/rgbmap.h"
+
+#include <cstdlib>
+
+using namespace doc;
+
+namespace {
+
+void random_palette(Palette& pal, int ncolors)
+{
+  pal.resize(ncolors);
+  for (int i=0; i<ncolors; ++i) {
+    // Repeat some colors to test that the lowest index is used
+    if (i > 0 && (rand() % 8) == 0)
+      pal.setEntry(i, pal.getEntry(rand() % i));
+    else
+      pal.setEntry(i, rgba(rand() % 256, rand() % 256, rand() % 256,
+                           (rand() % 2) ? 255: rand() % 256));
+  }
+}
+
+} // anonymous namespace
+
+TEST(RgbMap, SameResultAsFindBestfit)
+{
+  for (int ncolors : { 1, 2, 16, 256 }) {
+    for (int mask : { -1, 0, 5 }) {
+      auto palRef = Palette::create(ncolors);
+      Palette& pal = *palRef;
+      random_palette(pal, ncolors);
+
+      RgbMap rgbmap;
+      rgbmap.regenerate(&pal, mask);
+
+      for (int i=0; i<5000; ++i) {
+        int r = rand() % 256;
+        int g = rand() % 256;
+        int b = rand() % 256;
+        int a = rand() % 256;
+        int expected = pal.findBestfit(
+          scale_5bits_to_8bits(r>>3),
+          scale_5bits_to_8bits(g>>3),
+          scale_5bits_to_8bits(b>>3),
+          scale_3bits_to_8bits(a>>5), mask);
+        ASSERT_EQ(expected, rgbmap.mapColor(r, g, b, a))
+          << "ncolors=" << ncolors << " mask=" << mask
+          << " rgba=" << r << "," << g << "," << b << "," << a;
+      }
+    }
+  }
+}
+
+TEST(RgbMap, CalculateAll)
+{
+  auto pal = Palette::create(256);
+  random_palette(*pal, 256);
+
+  RgbMap lazy, eager;
+  lazy.regenerate(pal.get(), 0);
+  eager.regenerate(pal.get(), 0);
+  eager.calculateAll();
+
+  for (int r=0; r<256; r+=3)
+    for (int g=0; g<256; g+=5)
+      for (int b=0; b<256; b+=7)
+        for (int a=0; a<256; a+=32)
+          ASSERT_EQ(lazy.mapColor(r, g, b, a), eager.mapColor(r, g, b, a));
+}
+
+TEST(RgbMap, IncrementalRegenerate)
+{
+  auto pal = Palette::create(256);
+  random_palette(*pal, 256);
+
+  RgbMap rgbmap;
+  rgbmap.regenerate(pal.get(), 0);
+  rgbmap.calculateAll();
+
+  for (int step=0; step<8; ++step) {
+    // Modify some entries (the mask one too)
+    for (int n=1+(step % 3); n>0; --n) {
+      int i = (step == 0 && n == 1 ? 0: rand() % 256);
+      pal->setEntry(i, rgba(rand() % 256, rand() % 256, rand() % 256,
+                            (rand() % 2) ? 255: rand() % 256));
+    }
+    rgbmap.regenerate(pal.get(), 0);
+
+    RgbMap fresh;
+    fresh.regenerate(pal.get(), 0);
+
+    for (int r=0; r<256; r+=5)
+      for (int g=0; g<256; g+=3)
+        for (int b=0; b<256; b+=7)
+          for (int a=0; a<256; a+=32)
+            ASSERT_EQ(fresh.mapColor(r, g, b, a), rgbmap.mapColor(r, g, b, a))
+              << "step=" << step
+              << " rgba=" << r << "," << g << "," << b << "," << a;
+  }
+}
+
+TEST(RgbMap, HighResolution)
+{
+  auto pal = Palette::create(4);
+  pal->setEntry(0, rgba(0, 0, 0, 0));
+  pal->setEntry(1, rgba(0, 0, 0, 255));
+  // These two colors are the same with 5 bits per component
+  pal->setEntry(2, rgba(96, 100, 100, 255));
+  pal->setEntry(3, rgba(100, 100, 100, 255));
+
+  RgbMap rgbmap(6, 4);
+  rgbmap.regenerate(pal.get(), 0);
+  EXPECT_EQ(1 << 22, rgbmap.size());
+  EXPECT_EQ(6, rgbmap.rgbBits());
+  EXPECT_EQ(4, rgbmap.alphaBits());
+
+  EXPECT_EQ(0, rgbmap.mapColor(10, 20, 30, 0));
+  EXPECT_EQ(1, rgbmap.mapColor(0, 0, 0, 255));
+  EXPECT_EQ(2, rgbmap.mapColor(96, 100, 100, 255));
+  EXPECT_EQ(3, rgbmap.mapColor(100, 100, 100, 255));
+
+  RgbMap lowres;
+  lowres.regenerate(pal.get(), 0);
+  EXPECT_EQ(2, lowres.mapColor(100, 100, 100, 255));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,110 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/flip_image.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "doc/test_image.h"
+
+#include <memory>
+
+using namespace doc;
+
+namespace {
+
+// Expected position in the source of the pixel (x, y) of the rotated image
+gfx::Point source_point(const Image* src, int angle, int x, int y)
+{
+  switch (angle) {
+    case 180: return gfx::Point(src->width()-x-1, src->height()-y-1);
+    case 90:  return gfx::Point(y, src->height()-x-1);
+    default:  return gfx::Point(src->width()-y-1, x);
+  }
+}
+
+const PixelFormat kFormats[] = { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP };
+
+} // anonymous namespace
+
+TEST(RotateImage, AllAngles)
+{
+  // Sizes smaller than a tile, not multiple of a tile, and big enough
+  // to be rotated in parallel
+  const gfx::Size sizes[] = { gfx::Size(1, 1), gfx::Size(3, 7),
+                              gfx::Size(33, 65), gfx::Size(300, 257) };
+
+  for (PixelFormat format : kFormats) {
+    for (const gfx::Size& size : sizes) {
+      std::unique_ptr<Image> src = create_random_image(format, size.w, size.h);
+
+      for (int angle : { 180, 90, -90 }) {
+        const bool swapSize = (angle != 180);
+        std::unique_ptr<Image> dst(
+          Image::create(format,
+                        swapSize ? size.h: size.w,
+                        swapSize ? size.w: size.h));
+        rotate_image(src.get(), dst.get(), angle);
+
+        int errors = 0;
+        for (int y=0; y<dst->height() && errors == 0; ++y)
+          for (int x=0; x<dst->width(); ++x) {
+            gfx::Point pt = source_point(src.get(), angle, x, y);
+            if (get_pixel(src.get(), pt.x, pt.y) != get_pixel(dst.get(), x, y))
+              ++errors;
+          }
+        EXPECT_EQ(0, errors) << "format " << format << " size "
+                             << size.w << "x" << size.h << " angle " << angle;
+      }
+    }
+  }
+}
+
+TEST(RotateImage, InvalidAngle)
+{
+  std::unique_ptr<Image> src(Image::create(IMAGE_RGB, 4, 4));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
+  EXPECT_THROW(rotate_image(src.get(), dst.get(), 45), std::invalid_argument);
+}
+
+TEST(FlipImage, BigImages)
+{
+  for (PixelFormat format : kFormats) {
+    std::unique_ptr<Image> orig = create_random_image(format, 301, 299);
+    const gfx::Rect rc(2, 1, 297, 295);
+
+    for (auto flipType : { algorithm::FlipHorizontal, algorithm::FlipVertical }) {
+      std::unique_ptr<Image> image(Image::createCopy(orig.get()));
+      algorithm::flip_image(image.get(), rc, flipType);
+
+      int errors = 0;
+      for (int y=0; y<image->height(); ++y)
+        for (int x=0; x<image->width(); ++x) {
+          int u = x, v = y;
+          if (rc.contains(gfx::Point(x, y))) {
+            if (flipType == algorithm::FlipHorizontal)
+              u = rc.x2()-1-(x-rc.x);
+            else
+              v = rc.y2()-1-(y-rc.y);
+          }
+          if (get_pixel(orig.get(), u, v) != get_pixel(image.get(), x, y))
+            ++errors;
+        }
+      EXPECT_EQ(0, errors) << "format " << format << " flip " << flipType;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/rotate.h"
+#include "doc/algorithm/rotsprite.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "doc/test_image.h"
+
+#include <memory>
+
+using namespace doc;
+
+namespace {
+
+// Just four colors, so there are a lot of equal neighbors
+uint32_t four_colors(std::mt19937& rnd)
+{
+  return (rnd() % 4) * 0x40404040;
+}
+
+void rotsprite_45(Image* dst, const Image* src)
+{
+  const int w = src->width();
+  const int h = src->height();
+  algorithm::rotsprite_image(dst, src, nullptr,
+                             w/2, 0, w, h/2,
+                             w/2, h, 0, h/2);
+}
+
+} // anonymous namespace
+
+TEST(RotSprite, IdentityFillsBounds)
+{
+  // The second size is scaled in parallel
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    for (const gfx::Size& size : { gfx::Size(7, 5), gfx::Size(130, 131) }) {
+      std::unique_ptr<Image> src(Image::create(format, size.w, size.h));
+      std::unique_ptr<Image> dst(Image::create(format, size.w+2, size.h+2));
+      clear_image(src.get(), (format == IMAGE_INDEXED ? 3: 0xff800000));
+      clear_image(dst.get(), 0);
+
+      algorithm::rotsprite_image(dst.get(), src.get(), nullptr,
+                                 1, 1, size.w+1, 1,
+                                 size.w+1, size.h+1, 1, size.h+1);
+
+      std::unique_ptr<Image> expected(Image::create(format, size.w+2, size.h+2));
+      clear_image(expected.get(), 0);
+      copy_image(expected.get(), src.get(), 1, 1);
+      EXPECT_EQ(0, count_diff_between_images(expected.get(), dst.get()))
+        << "format " << format << " size " << size.w << "x" << size.h;
+    }
+  }
+  algorithm::clear_rotsprite_cache();
+}
+
+TEST(RotSprite, CacheSeesChangedPixels)
+{
+  std::unique_ptr<Image> src = create_random_image(IMAGE_RGB, 32, 32, four_colors);
+  std::unique_ptr<Image> dst1(Image::create(IMAGE_RGB, 32, 32));
+  std::unique_ptr<Image> dst2(Image::create(IMAGE_RGB, 32, 32));
+
+  clear_image(dst1.get(), 0);
+  clear_image(dst2.get(), 0);
+  rotsprite_45(dst1.get(), src.get());
+  rotsprite_45(dst2.get(), src.get());
+  EXPECT_EQ(0, count_diff_between_images(dst1.get(), dst2.get()));
+
+  // Pixels modified in place (without a new version) must be scaled again
+  fill_rect(src.get(), 8, 8, 23, 23, rgba(255, 0, 0, 255));
+  clear_image(dst1.get(), 0);
+  rotsprite_45(dst1.get(), src.get());
+
+  algorithm::clear_rotsprite_cache();
+  clear_image(dst2.get(), 0);
+  rotsprite_45(dst2.get(), src.get());
+  EXPECT_EQ(0, count_diff_between_images(dst1.get(), dst2.get()));
+  EXPECT_EQ(rgba(255, 0, 0, 255), get_pixel(dst1.get(), 16, 16));
+
+  algorithm::clear_rotsprite_cache();
+}
+
+TEST(Parallelogram, BandsMatchOneThread)
+{
+  // The same parallelogram is drawn in a small image (one thread)
+  // and in a big one (bands of scanlines in parallel)
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    std::unique_ptr<Image> src = create_random_image(format, 61, 43, four_colors);
+    std::unique_ptr<Image> small(Image::create(format, 200, 200));
+    std::unique_ptr<Image> big(Image::create(format, 600, 600));
+    clear_image(small.get(), 0);
+    clear_image(big.get(), 0);
+
+    algorithm::parallelogram(small.get(), src.get(), nullptr,
+                             13, 2, 190, 40, 170, 197, 5, 150);
+    algorithm::parallelogram(big.get(), src.get(), nullptr,
+                             13, 2, 190, 40, 170, 197, 5, 150);
+
+    int errors = 0;
+    for (int y=0; y<600; ++y)
+      for (int x=0; x<600; ++x) {
+        color_t expected = (x < 200 && y < 200 ? get_pixel(small.get(), x, y): 0);
+        if (get_pixel(big.get(), x, y) != expected)
+          ++errors;
+      }
+    EXPECT_EQ(0, errors) << "format " << format;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
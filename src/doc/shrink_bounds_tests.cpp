@@ -0,0 +1,141 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/shrink_bounds.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <memory>
+#include <random>
+
+using namespace doc;
+
+namespace {
+
+bool is_same_pixel(PixelFormat format, color_t a, color_t b)
+{
+  switch (format) {
+    case IMAGE_RGB:
+      return (a == b) || (rgba_geta(a) == 0 && rgba_geta(b) == 0);
+    case IMAGE_GRAYSCALE:
+      return (a == b) || (graya_geta(a) == 0 && graya_geta(b) == 0);
+    default:
+      return a == b;
+  }
+}
+
+// Bounds of the pixels that are different to "refpixel"
+gfx::Rect reference_bounds(const Image* image, const gfx::Rect& start,
+                           color_t refpixel)
+{
+  gfx::Rect bounds;
+  for (int y=start.y; y<start.y2(); ++y)
+    for (int x=start.x; x<start.x2(); ++x)
+      if (!is_same_pixel(image->pixelFormat(), get_pixel(image, x, y), refpixel))
+        bounds |= gfx::Rect(x, y, 1, 1);
+  return bounds;
+}
+
+} // anonymous namespace
+
+TEST(ShrinkBounds, RandomDots)
+{
+  std::mt19937 rnd(1);
+
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    for (int i=0; i<200; ++i) {
+      const int w = 1 + rnd() % 70;
+      const int h = 1 + rnd() % 40;
+      std::unique_ptr<Image> image(Image::create(format, w, h));
+      color_t refpixel = 0;
+      color_t dot = 1;
+      switch (format) {
+        case IMAGE_RGB:
+          refpixel = (rnd() % 2 ? rgba(1, 2, 3, 255): 0);
+          dot = rgba(rnd() % 256, 0, 0, 255);
+          break;
+        case IMAGE_GRAYSCALE:
+          refpixel = (rnd() % 2 ? graya(1, 255): 0);
+          dot = graya(rnd() % 256, 128);
+          break;
+        case IMAGE_INDEXED:
+          refpixel = rnd() % 3;
+          dot = 100 + rnd() % 100;
+          break;
+        default:
+          break;
+      }
+      clear_image(image.get(), refpixel);
+
+      // Transparent pixels with different RGB/gray values must
+      // be equal to a transparent "refpixel"
+      if (format == IMAGE_RGB)
+        fill_rect(image.get(), 0, 0, w-1, 0, rgba(255, 0, 0, 0));
+      else if (format == IMAGE_GRAYSCALE)
+        fill_rect(image.get(), 0, 0, w-1, 0, graya(255, 0));
+
+      const int dots = rnd() % 4;
+      for (int j=0; j<dots; ++j)
+        put_pixel(image.get(), rnd() % w, rnd() % h, dot);
+
+      gfx::Rect start(rnd() % w, rnd() % h, w, h);
+      if (i % 2)
+        start = image->bounds();
+      start &= image->bounds();
+
+      const gfx::Rect expected = reference_bounds(image.get(), start, refpixel);
+      gfx::Rect bounds;
+      const bool result = algorithm::shrink_bounds(image.get(), start, bounds, refpixel);
+      EXPECT_EQ(!expected.isEmpty(), result) << "format " << format << " case " << i;
+      if (result) {
+        EXPECT_EQ(expected, bounds) << "format " << format << " case " << i;
+      }
+    }
+  }
+}
+
+TEST(ShrinkBounds, TwoImages)
+{
+  std::mt19937 rnd(2);
+
+  for (PixelFormat format : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    for (int i=0; i<100; ++i) {
+      const int w = 1 + rnd() % 70;
+      const int h = 1 + rnd() % 40;
+      std::unique_ptr<Image> a(Image::create(format, w, h));
+      clear_image(a.get(), 0);
+      std::unique_ptr<Image> b(Image::createCopy(a.get()));
+
+      gfx::Rect expected;
+      const int dots = rnd() % 4;
+      for (int j=0; j<dots; ++j) {
+        const int x = rnd() % w;
+        const int y = rnd() % h;
+        put_pixel(b.get(), x, y, 1);
+        expected |= gfx::Rect(x, y, 1, 1);
+      }
+
+      gfx::Rect bounds;
+      const bool result = algorithm::shrink_bounds2(a.get(), b.get(), a->bounds(), bounds);
+      EXPECT_EQ(!expected.isEmpty(), result);
+      if (result) {
+        EXPECT_EQ(expected, bounds);
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -23,15 +23,16 @@
 #include "doc/primitives.h"
 #include "doc/remap.h"
 #include "doc/rgbmap.h"
+#include "doc/sprite_memory.h"
 
+#include <algorithm>
 #include <cstring>
 #include <vector>
 #include <memory>
 
 namespace doc {
 
-static Layer* index2layer(const Layer* layer, const LayerIndex& index, int* index_count);
-static LayerIndex layer2index(const Layer* layer, const Layer* find_layer, int* index_count);
+static void flatten_layers(const LayerFolder* folder, LayerList& layers);
 
 //////////////////////////////////////////////////////////////////////
 // Constructors/Destructor
@@ -169,14 +170,7 @@ void Sprite::setTransparentColor(color_t color)
 
 int Sprite::getMemSize() const
 {
-  int size = 0;
-
-  std::vector<Image*> images;
-  getImages(images);
-  for (Image* image : images)
-    size += image->getRowStrideSize() * image->height();
-
-  return size;
+  return int(calculate_sprite_memory(this).total);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -222,17 +216,19 @@ Layer* Sprite::layer(int layerIndex) const
 
 Layer* Sprite::indexToLayer(LayerIndex index) const
 {
-  if (index < LayerIndex(0))
+  if (index < LayerIndex(0) || index >= LayerIndex(m_allLayers.size()))
     return NULL;
 
-  int index_count = -1;
-  return index2layer(folder(), index, &index_count);
+  return m_allLayers[index];
 }
 
 LayerIndex Sprite::layerToIndex(const Layer* layer) const
 {
-  int index_count = -1;
-  return layer2index(folder(), layer, &index_count);
+  auto it = std::find(m_allLayers.begin(), m_allLayers.end(), layer);
+  if (it != m_allLayers.end())
+    return LayerIndex(it - m_allLayers.begin());
+  else
+    return LayerIndex(-1);
 }
 
 void Sprite::getLayersList(std::vector<Layer*>& layers) const
@@ -246,6 +242,12 @@ void Sprite::getLayersList(std::vector<Layer*>& layers) const
   }
 }
 
+void Sprite::layersChanged()
+{
+  m_allLayers.clear();
+  flatten_layers(m_folder, m_allLayers);
+}
+
 //////////////////////////////////////////////////////////////////////
 // Palettes
 
@@ -404,8 +406,8 @@ void Sprite::setDurationForAllFrames(int msecs)
 
 ImageRef Sprite::getImageRef(ObjectId imageId)
 {
-  for (auto cel : cels()) {
-    if (cel->image()->id() == imageId)
+  for (const auto& cel : cels()) {
+    if (cel->data()->imageId() == imageId)
       return cel->imageRef();
   }
   return ImageRef(nullptr);
@@ -413,7 +415,7 @@ ImageRef Sprite::getImageRef(ObjectId imageId)
 
 CelDataRef Sprite::getCelDataRef(ObjectId celDataId)
 {
-  for (auto cel : cels()) {
+  for (const auto& cel : cels()) {
     if (cel->dataRef()->id() == celDataId)
       return cel->dataRef();
   }
@@ -425,8 +427,8 @@ CelDataRef Sprite::getCelDataRef(ObjectId celDataId)
 
 void Sprite::replaceImage(ObjectId curImageId, const ImageRef& newImage)
 {
-  for (auto cel : cels()) {
-    if (cel->image()->id() == curImageId)
+  for (const auto& cel : cels()) {
+    if (cel->data()->imageId() == curImageId)
       cel->data()->setImage(newImage);
   }
 }
@@ -443,25 +445,30 @@ void Sprite::remapImages(frame_t frameFrom, frame_t frameTo, const Remap& remap)
   ASSERT(m_format == IMAGE_INDEXED);
   //ASSERT(remap.size() == 256);
 
-  for (auto cel : uniqueCels()) {
+  std::vector<Image*> images;
+  for (const auto& cel : uniqueCels()) {
     // Remap this Cel because is inside the specified range
     if (cel->frame() >= frameFrom &&
         cel->frame() <= frameTo) {
-      remap_image(cel->image(), remap);
+      images.push_back(cel->image());
     }
   }
+  remap_images(images, remap);
 }
 
 //////////////////////////////////////////////////////////////////////
 // Drawing
 
-void Sprite::pickCels(int x, int y, frame_t frame, int opacityThreshold, CelList& cels) const
+void Sprite::pickCels(int x, int y, frame_t frame, int opacityThreshold, CelList& cels,
+                      int maxCels) const
 {
-  std::vector<Layer*> layers;
-  getLayersList(layers);
+  const gfx::Point pos(x, y);
+
+  // TODO support subfolders
+  const LayerList& layers = m_folder->getLayersList();
 
-  for (int i=(int)layers.size()-1; i>=0; --i) {
-    Layer* layer = layers[i];
+  for (auto it=layers.rbegin(), end=layers.rend(); it!=end; ++it) {
+    const Layer* layer = *it;
     if (!layer->isImage() || !layer->isVisible())
       continue;
 
@@ -469,11 +476,12 @@ void Sprite::pickCels(int x, int y, frame_t frame, int opacityThreshold, CelList
     if (!cel)
       continue;
 
-    Image* image = cel->image();
-    if (!image)
+    // Check the bounds before touching the image
+    if (!cel->bounds().contains(pos))
       continue;
 
-    if (!cel->bounds().contains(gfx::Point(x, y)))
+    Image* image = cel->image();
+    if (!image)
       continue;
 
     color_t color = get_pixel(image,
@@ -498,8 +506,9 @@ void Sprite::pickCels(int x, int y, frame_t frame, int opacityThreshold, CelList
       continue;
 
     cels.push_back(cel);
+    if (maxCels > 0 && int(cels.size()) >= maxCels)
+      break;
   }
-  fflush(stdout);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -532,49 +541,15 @@ CelsRange Sprite::uniqueCels(frame_t from, frame_t to) const
 
 //////////////////////////////////////////////////////////////////////
 
-static Layer* index2layer(const Layer* layer, const LayerIndex& index, int* index_count)
+static void flatten_layers(const LayerFolder* folder, LayerList& layers)
 {
-  if (index == *index_count)
-    return (Layer*)layer;
-  else {
-    (*index_count)++;
-
-    if (layer->isFolder()) {
-      Layer *found;
+  LayerConstIterator it = folder->getLayerBegin();
+  LayerConstIterator end = folder->getLayerEnd();
 
-      LayerConstIterator it = static_cast<const LayerFolder*>(layer)->getLayerBegin();
-      LayerConstIterator end = static_cast<const LayerFolder*>(layer)->getLayerEnd();
-
-      for (; it != end; ++it) {
-        if ((found = index2layer(*it, index, index_count)))
-          return found;
-      }
-    }
-
-    return NULL;
-  }
-}
-
-static LayerIndex layer2index(const Layer* layer, const Layer* find_layer, int* index_count)
-{
-  if (layer == find_layer)
-    return LayerIndex(*index_count);
-  else {
-    (*index_count)++;
-
-    if (layer->isFolder()) {
-      int found;
-
-      LayerConstIterator it = static_cast<const LayerFolder*>(layer)->getLayerBegin();
-      LayerConstIterator end = static_cast<const LayerFolder*>(layer)->getLayerEnd();
-
-      for (; it != end; ++it) {
-        if ((found = layer2index(*it, find_layer, index_count)) >= 0)
-          return LayerIndex(found);
-      }
-    }
-
-    return LayerIndex(-1);
+  for (; it != end; ++it) {
+    layers.push_back(*it);
+    if ((*it)->isFolder())
+      flatten_layers(static_cast<const LayerFolder*>(*it), layers);
   }
 }
 
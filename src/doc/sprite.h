@@ -14,6 +14,7 @@
 #include "doc/frame_tags.h"
 #include "doc/image_ref.h"
 #include "doc/layer_index.h"
+#include "doc/layer_list.h"
 #include "doc/object.h"
 #include "doc/pixel_format.h"
 #include "doc/sprite_position.h"
@@ -94,6 +95,13 @@ namespace doc {
 
     void getLayersList(std::vector<Layer*>& layers) const;
 
+    // All layers of the tree (without the main folder) in the order
+    // of their LayerIndex. The list is updated by layersChanged(),
+    // which LayerFolder calls each time a layer is added, removed or
+    // moved.
+    const LayerList& allLayers() const { return m_allLayers; }
+    void layersChanged();
+
     ////////////////////////////////////////
     // Palettes
 
@@ -140,7 +148,11 @@ namespace doc {
     void replaceImage(ObjectId curImageId, const ImageRef& newImage);
     void getImages(std::vector<Image*>& images) const;
     void remapImages(frame_t frameFrom, frame_t frameTo, const Remap& remap);
-    void pickCels(int x, int y, frame_t frame, int opacityThreshold, CelList& cels) const;
+    // Adds to "cels" the cels with an opaque pixel in the given
+    // position (from the top-most layer). If "maxCels" > 0 it stops
+    // after finding that number of cels.
+    void pickCels(int x, int y, frame_t frame, int opacityThreshold, CelList& cels,
+                  int maxCels = 0) const;
 
     ////////////////////////////////////////
     // Iterators
@@ -160,6 +172,7 @@ namespace doc {
     std::vector<int> m_frlens;             // duration per frame
     PalettesList m_palettes;               // list of palettes
     LayerFolder* m_folder;                 // main folder of layers
+    LayerList m_allLayers;                 // flattened tree of layers
 
     // Current rgb map
     mutable RgbMap* m_rgbMap;
@@ -0,0 +1,68 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/sprite_memory.h"
+
+#include "doc/cel.h"
+#include "doc/cel_data.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+
+#include <unordered_set>
+
+namespace doc {
+
+SpriteMemory calculate_sprite_memory(const Sprite* sprite)
+{
+  SpriteMemory mem;
+  mem.layers.resize(sprite->countLayers(), 0);
+  mem.frames.resize(sprite->totalFrames(), 0);
+
+  std::unordered_set<const CelData*> visitedData;
+  std::unordered_set<ObjectId> visitedImages;
+
+  for (int i=0; i<int(mem.layers.size()); ++i) {
+    const Layer* layer = sprite->layer(i);
+    if (!layer || !layer->isImage())
+      continue;
+
+    auto imageLayer = static_cast<const LayerImage*>(layer);
+    for (auto it=imageLayer->getCelBegin(), end=imageLayer->getCelEnd(); it!=end; ++it) {
+      const Cel* cel = it->get();
+      const CelData* data = cel->data();
+      std::size_t size = sizeof(Cel);
+
+      if (visitedData.insert(data).second) {
+        size += sizeof(CelData);
+
+        const std::size_t imageSize = data->residentImageMemSize();
+        if (data->isSwapped())
+          ++mem.swappedImages;
+        else if (visitedImages.insert(data->imageId()).second) {
+          size += imageSize;
+          mem.images += imageSize;
+        }
+        else
+          mem.linked += imageSize;
+      }
+      else
+        mem.linked += sizeof(CelData) + data->residentImageMemSize();
+
+      mem.total += size;
+      mem.layers[i] += size;
+      if (cel->frame() >= 0 && cel->frame() < frame_t(mem.frames.size()))
+        mem.frames[cel->frame()] += size;
+    }
+  }
+
+  return mem;
+}
+
+} // namespace doc
@@ -0,0 +1,34 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace doc {
+
+  class Sprite;
+
+  // Memory used by the cels of a sprite. Linked cels share their
+  // CelData (and cels can share images), so each CelData and image
+  // is counted only one time. Swapped out images (see ImageSwap)
+  // aren't loaded to calculate this, they don't use memory.
+  struct SpriteMemory {
+    std::size_t total = 0;         // Bytes of cels, cel data and images
+    std::size_t images = 0;        // Bytes of the images in memory
+    std::size_t linked = 0;        // Bytes that aren't repeated thanks to linked cels
+    int swappedImages = 0;         // Images in the swap file
+
+    // Bytes of each layer (by LayerIndex) and frame. Shared data is
+    // counted in the first layer/frame where it's found.
+    std::vector<std::size_t> layers;
+    std::vector<std::size_t> frames;
+  };
+
+  SpriteMemory calculate_sprite_memory(const Sprite* sprite);
+
+} // namespace doc
@@ -0,0 +1,73 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/cel.h"
+#include "doc/cel_data.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+#include "doc/sprite_memory.h"
+
+#include <memory>
+
+using namespace doc;
+
+TEST(SpriteMemory, LinkedCelsAreCountedOneTime)
+{
+  std::unique_ptr<Sprite> sprite(new Sprite(IMAGE_RGB, 32, 32, 256));
+  sprite->setTotalFrames(3);
+  LayerImage* layer1 = new LayerImage(sprite.get());
+  LayerImage* layer2 = new LayerImage(sprite.get());
+  sprite->folder()->addLayer(layer1);
+  sprite->folder()->addLayer(layer2);
+
+  ImageRef image(Image::create(IMAGE_RGB, 32, 32));
+  const std::size_t imageSize = image->getMemSize();
+
+  // layer1 = A A A (linked)
+  auto cel = std::make_shared<Cel>(frame_t(0), image);
+  layer1->addCel(cel);
+  for (frame_t frame=1; frame<3; ++frame) {
+    auto link = Cel::createLink(cel);
+    link->setFrame(frame);
+    layer1->addCel(link);
+  }
+
+  // layer2 = B _ _
+  layer2->addCel(std::make_shared<Cel>(frame_t(0),
+                                       ImageRef(Image::create(IMAGE_RGB, 32, 32))));
+
+  SpriteMemory mem = calculate_sprite_memory(sprite.get());
+  EXPECT_EQ(2*imageSize, mem.images);
+  EXPECT_EQ(2*(sizeof(CelData) + imageSize), mem.linked);
+  EXPECT_EQ(0, mem.swappedImages);
+
+  const std::size_t celSize = sizeof(Cel) + sizeof(CelData) + imageSize;
+  ASSERT_EQ(2, mem.layers.size());
+  EXPECT_EQ(celSize + 2*sizeof(Cel), mem.layers[0]);
+  EXPECT_EQ(celSize, mem.layers[1]);
+
+  ASSERT_EQ(3, mem.frames.size());
+  EXPECT_EQ(2*celSize, mem.frames[0]);
+  EXPECT_EQ(sizeof(Cel), mem.frames[1]);
+  EXPECT_EQ(sizeof(Cel), mem.frames[2]);
+
+  EXPECT_EQ(2*celSize + 2*sizeof(Cel), mem.total);
+  EXPECT_EQ(int(mem.total), sprite->getMemSize());
+  EXPECT_EQ(int(sizeof(LayerImage) + mem.layers[0]), layer1->getMemSize());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
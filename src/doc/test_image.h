@@ -0,0 +1,39 @@
+// LibreSprite Document Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+
+namespace doc {
+
+  // Creates an image with the pixels returned by value(rnd). The
+  // generator is seeded with the image area, so the tests get the
+  // same pixels for the same size in each run.
+  template<typename Func>
+  std::unique_ptr<Image> create_random_image(PixelFormat format, int w, int h,
+                                             Func&& value) {
+    std::mt19937 rnd(w*h);
+    std::unique_ptr<Image> image(Image::create(format, w, h));
+    for (int y=0; y<h; ++y)
+      for (int x=0; x<w; ++x)
+        put_pixel(image.get(), x, y, value(rnd));
+    return image;
+  }
+
+  // Random pixels of any value (0 or 1 for bitmaps).
+  inline std::unique_ptr<Image> create_random_image(PixelFormat format, int w, int h) {
+    const uint32_t mask = (format == IMAGE_BITMAP ? 1: 0xffffffff);
+    return create_random_image(format, w, h,
+                               [mask](std::mt19937& rnd) { return rnd() & mask; });
+  }
+
+} // namespace doc
@@ -49,6 +49,13 @@ const char* ColorCurveFilter::getName()
   return "Color Curve";
 }
 
+bool ColorCurveFilter::getChannelMap(uint8_t* map)
+{
+  for (int c=0; c<256; ++c)
+    map[c] = m_cmap[c];
+  return true;
+}
+
 void ColorCurveFilter::applyToRgba(FilterManager* filterMgr)
 {
   const uint32_t* src_address = (uint32_t*)filterMgr->getSourceAddress();
@@ -28,6 +28,9 @@ namespace filters {
     void applyToRgba(FilterManager* filterMgr);
     void applyToGrayscale(FilterManager* filterMgr);
     void applyToIndexed(FilterManager* filterMgr);
+    bool isThreadSafe() { return true; }
+    bool isPointwise() { return true; }
+    bool getChannelMap(uint8_t* map);
 
   private:
     ColorCurve* m_curve;
@@ -11,6 +11,11 @@
 
 #include "filters/convolution_matrix.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
 namespace filters {
 
 ConvolutionMatrix::ConvolutionMatrix(int width, int height)
@@ -25,4 +30,77 @@ ConvolutionMatrix::ConvolutionMatrix(int width, int height)
 {
 }
 
+ConvolutionMatrix* ConvolutionMatrix::createGaussianBlur(int radius)
+{
+  const int size = 2*radius+1;
+  const double sigma = (radius+1) / 2.0;
+  std::vector<int> weights(size);
+  for (int i=0; i<size; ++i) {
+    const double d = i-radius;
+    weights[i] = std::max(1, int(std::lround(64.0 * std::exp(-d*d / (2.0*sigma*sigma)))));
+  }
+
+  ConvolutionMatrix* matrix = new ConvolutionMatrix(size, size);
+  int div = 0;
+  for (int y=0; y<size; ++y) {
+    for (int x=0; x<size; ++x) {
+      matrix->value(x, y) = weights[x] * weights[y];
+      div += weights[x] * weights[y];
+    }
+  }
+
+  char name[64];
+  std::snprintf(name, sizeof(name), "gaussian-blur-r%d", radius);
+  matrix->setName(name);
+  matrix->setDiv(div);
+  matrix->setDefaultTarget(TARGET_RED_CHANNEL |
+                           TARGET_GREEN_CHANNEL |
+                           TARGET_BLUE_CHANNEL |
+                           TARGET_ALPHA_CHANNEL |
+                           TARGET_GRAY_CHANNEL);
+  return matrix;
+}
+
+bool ConvolutionMatrix::getSeparableKernels(std::vector<int>& rowKernel,
+                                            std::vector<int>& colKernel) const
+{
+  // The first row with values (divided by the GCD of its values) is
+  // the row kernel, and each row must be a multiple of it
+  int first = 0;
+  while (first < m_height &&
+         std::all_of(&value(0, first), &value(0, first)+m_width,
+                     [](int v){ return v == 0; }))
+    ++first;
+  if (first == m_height)
+    return false;
+
+  int gcd = 0;
+  for (int x=0; x<m_width; ++x)
+    gcd = std::gcd(gcd, value(x, first));
+
+  rowKernel.resize(m_width);
+  colKernel.assign(m_height, 0);
+  for (int x=0; x<m_width; ++x)
+    rowKernel[x] = value(x, first) / gcd;
+
+  // A column of the row kernel with a value (to know the factor of
+  // each row)
+  int pivot = 0;
+  while (rowKernel[pivot] == 0)
+    ++pivot;
+
+  for (int y=first; y<m_height; ++y) {
+    if (value(pivot, y) % rowKernel[pivot] != 0)
+      return false;
+
+    const int factor = value(pivot, y) / rowKernel[pivot];
+    for (int x=0; x<m_width; ++x) {
+      if (value(x, y) != factor * rowKernel[x])
+        return false;
+    }
+    colKernel[y] = factor;
+  }
+  return true;
+}
+
 } // namespace filters
@@ -22,6 +22,12 @@ namespace filters {
 
     ConvolutionMatrix(int width, int height);
 
+    // Creates a (2*radius+1)x(2*radius+1) Gaussian blur matrix. Its
+    // values are products of integer row and column weights, so it
+    // can be applied as two 1D convolutions (see
+    // getSeparableKernels()).
+    static ConvolutionMatrix* createGaussianBlur(int radius);
+
     const char* getName() const { return m_name.c_str(); }
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
@@ -53,6 +59,12 @@ namespace filters {
     int& value(int x, int y) { return m_data[y*m_width+x]; }
     const int& value(int x, int y) const { return m_data[y*m_width+x]; }
 
+    // Returns true if the matrix is the product of a column and a row
+    // of integers, i.e. value(x, y) == colKernel[y]*rowKernel[x]
+    // (e.g. box or Gaussian blurs).
+    bool getSeparableKernels(std::vector<int>& rowKernel,
+                             std::vector<int>& colKernel) const;
+
   private:
     std::string m_name;          // Name
     int m_width, m_height;       // Size of the matrix
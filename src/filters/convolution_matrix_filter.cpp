@@ -20,6 +20,11 @@
 #include "doc/palette.h"
 #include "doc/rgbmap.h"
 
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <vector>
+
 namespace filters {
 
 using namespace doc;
@@ -116,23 +121,201 @@ namespace {
 
   };
 
+
+  // Coordinates outside the image (the same ones used by
+  // get_neighboring_pixels())
+  inline int wrap_coord(int v, int size, bool tiled) {
+    if (tiled)
+      return ((v % size) + size) % size;
+    else
+      return MID(0, v, size-1);
+  }
+
+  // Rows of the source image convolved with the row kernel of a
+  // separable matrix. They are kept between calls (one cache per
+  // thread) because each row is used by "height" rows of the output,
+  // but only while the output rows are increasing (the source image
+  // could be modified between two applications of the filter).
+  struct SeparableRows {
+    // What was used to calculate the rows
+    struct Key {
+      const void* filter = nullptr;
+      uint32_t generation = 0;
+      const Image* image = nullptr;
+      ObjectId imageId = 0;
+      const Palette* palette = nullptr;
+      int x = 0, width = 0, channels = 0;
+
+      bool operator==(const Key& o) const {
+        return (filter == o.filter && generation == o.generation &&
+                image == o.image && imageId == o.imageId &&
+                palette == o.palette && x == o.x &&
+                width == o.width && channels == o.channels);
+      }
+    };
+
+    Key key;
+    std::vector<int> tags;      // Source row of each slot (unwrapped)
+    std::vector<std::vector<int>> slots;
+    std::vector<int> expanded;  // Channels of one source row
+    int lastY = INT_MIN;        // Last row of the output
+
+    void reset(const Key& newKey, int height) {
+      key = newKey;
+      tags.assign(height, INT_MIN);
+      slots.resize(height);
+      for (auto& slot : slots)
+        slot.assign(key.channels * key.width, 0);
+    }
+  };
+
+  thread_local SeparableRows t_rows;
+
+  // Convolves the current row of the filter manager with a separable
+  // matrix (value(x, y) == colKernel[y]*rowKernel[x]), first each
+  // source row with the row kernel (cached in t_rows), and then the
+  // column of rows with the column kernel. The loops are over arrays
+  // of each channel (no per-pixel gathers), so the compiler can
+  // vectorize them.
+  //
+  // "getChannels" converts a pixel to N channel values (the last one
+  // must be 1 if the pixel isn't transparent) and "write" is called
+  // with the sums for each x (or nullptr for skipped pixels).
+  template<typename Traits, int N, typename GetChannels, typename Write>
+  void apply_separable(FilterManager* filterMgr,
+                       const void* filter, uint32_t generation,
+                       const Palette* palette,
+                       const ConvolutionMatrix* matrix,
+                       const std::vector<int>& rowKernel,
+                       const std::vector<int>& colKernel,
+                       TiledMode tiledMode,
+                       GetChannels getChannels, Write write)
+  {
+    const Image* src = filterMgr->getSourceImage();
+    const int x1 = filterMgr->x();
+    const int width = filterMgr->getWidth();
+    const int y = filterMgr->y();
+    const int kw = int(rowKernel.size());
+    const int kh = int(colKernel.size());
+    const int cx = matrix->getCenterX();
+    const int cy = matrix->getCenterY();
+    const bool tiledX = (int(tiledMode) & int(TiledMode::X_AXIS)) != 0;
+    const bool tiledY = (int(tiledMode) & int(TiledMode::Y_AXIS)) != 0;
+
+    SeparableRows::Key key;
+    key.filter = filter;
+    key.generation = generation;
+    key.image = src;
+    key.imageId = src->id();
+    key.palette = palette;
+    key.x = x1;
+    key.width = width;
+    key.channels = N;
+
+    SeparableRows& rows = t_rows;
+    if (!(rows.key == key) || int(rows.slots.size()) != kh)
+      rows.reset(key, kh);
+    else if (y <= rows.lastY)
+      std::fill(rows.tags.begin(), rows.tags.end(), INT_MIN);
+    rows.lastY = y;
+
+    const int ew = width + kw - 1;
+    rows.expanded.resize(N * ew);
+
+    // Convolve the needed source rows with the row kernel
+    for (int j=0; j<kh; ++j) {
+      const int ry = y - cy + j;
+      const int slot = ((ry % kh) + kh) % kh;
+      if (rows.tags[slot] == ry)
+        continue;
+
+      auto address = reinterpret_cast<typename Traits::const_address_t>(
+        src->getPixelAddress(0, wrap_coord(ry, src->height(), tiledY)));
+
+      int* e = &rows.expanded[0];
+      int v[N];
+      for (int i=0; i<ew; ++i) {
+        getChannels(address[wrap_coord(x1-cx+i, src->width(), tiledX)], v);
+        for (int c=0; c<N; ++c)
+          e[c*ew + i] = v[c];
+      }
+
+      int* h = &rows.slots[slot][0];
+      std::fill(h, h + N*width, 0);
+      for (int c=0; c<N; ++c) {
+        int* hc = h + c*width;
+        const int* ec = e + c*ew;
+        for (int k=0; k<kw; ++k) {
+          const int u = rowKernel[k];
+          if (!u)
+            continue;
+          const int* ek = ec + k;
+          for (int i=0; i<width; ++i)
+            hc[i] += u * ek[i];
+        }
+      }
+      rows.tags[slot] = ry;
+    }
+
+    // Convolve the rows with the column kernel
+    std::vector<int> sums(N * width, 0);
+    for (int j=0; j<kh; ++j) {
+      const int v = colKernel[j];
+      if (!v)
+        continue;
+      const int ry = y - cy + j;
+      const int* h = &rows.slots[((ry % kh) + kh) % kh][0];
+      for (int i=0; i<N*width; ++i)
+        sums[i] += v * h[i];
+    }
+
+    int pixel[N];
+    for (int i=0; i<width; ++i) {
+      // Avoid the non-selected region
+      if (filterMgr->skipPixel()) {
+        write(x1+i, nullptr);
+        continue;
+      }
+      for (int c=0; c<N; ++c)
+        pixel[c] = sums[c*width + i];
+      write(x1+i, pixel);
+    }
+  }
+
+  // Each generation of matrix/tiled mode of a filter
+  std::atomic<uint32_t> g_generation(0);
+
 }
 
 ConvolutionMatrixFilter::ConvolutionMatrixFilter()
   : m_matrix(NULL)
   , m_tiledMode(TiledMode::NONE)
+  , m_separable(false)
+  , m_weightsSum(0)
+  , m_generation(++g_generation)
 {
 }
 
 void ConvolutionMatrixFilter::setMatrix(const base::SharedPtr<ConvolutionMatrix>& matrix)
 {
   m_matrix = matrix;
-  m_lines.resize(matrix->getHeight());
+  m_separable = (matrix &&
+                 matrix->getWidth()*matrix->getHeight() > 4 &&
+                 matrix->getSeparableKernels(m_rowKernel, m_colKernel));
+
+  m_weightsSum = 0;
+  if (matrix) {
+    for (int y=0; y<matrix->getHeight(); ++y)
+      for (int x=0; x<matrix->getWidth(); ++x)
+        m_weightsSum += matrix->value(x, y);
+  }
+  m_generation = ++g_generation;
 }
 
 void ConvolutionMatrixFilter::setTiledMode(TiledMode tiledMode)
 {
   m_tiledMode = tiledMode;
+  m_generation = ++g_generation;
 }
 
 const char* ConvolutionMatrixFilter::getName()
@@ -140,6 +323,110 @@ const char* ConvolutionMatrixFilter::getName()
   return "Convolution Matrix";
 }
 
+// The results of the sums are calculated in the same way for dense
+// and separable matrices.
+
+static color_t rgba_result(const GetPixelsDelegateRgba& d, color_t color,
+                           Target target, const ConvolutionMatrix* matrix)
+{
+  int r, g, b, a;
+
+  if (target & TARGET_RED_CHANNEL) {
+    r = d.r / d.div + matrix->getBias();
+    r = MID(0, r, 255);
+  }
+  else
+    r = rgba_getr(color);
+
+  if (target & TARGET_GREEN_CHANNEL) {
+    g = d.g / d.div + matrix->getBias();
+    g = MID(0, g, 255);
+  }
+  else
+    g = rgba_getg(color);
+
+  if (target & TARGET_BLUE_CHANNEL) {
+    b = d.b / d.div + matrix->getBias();
+    b = MID(0, b, 255);
+  }
+  else
+    b = rgba_getb(color);
+
+  if (target & TARGET_ALPHA_CHANNEL) {
+    a = d.a / matrix->getDiv() + matrix->getBias();
+    a = MID(0, a, 255);
+  }
+  else
+    a = rgba_geta(color);
+
+  return rgba(r, g, b, a);
+}
+
+static color_t grayscale_result(const GetPixelsDelegateGrayscale& d, color_t color,
+                                Target target, const ConvolutionMatrix* matrix)
+{
+  int v, a;
+
+  if (target & TARGET_GRAY_CHANNEL) {
+    v = d.v / d.div + matrix->getBias();
+    v = MID(0, v, 255);
+  }
+  else
+    v = graya_getv(color);
+
+  if (target & TARGET_ALPHA_CHANNEL) {
+    a = d.a / matrix->getDiv() + matrix->getBias();
+    a = MID(0, a, 255);
+  }
+  else
+    a = graya_geta(color);
+
+  return graya(v, a);
+}
+
+static color_t indexed_result(const GetPixelsDelegateIndexed& d, color_t index,
+                              Target target, const ConvolutionMatrix* matrix,
+                              const Palette* pal, const RgbMap* rgbmap)
+{
+  if (target & TARGET_INDEX_CHANNEL) {
+    int i = d.index / matrix->getDiv() + matrix->getBias();
+    return MID(0, i, 255);
+  }
+
+  color_t color = pal->getEntry(index);
+  int r, g, b, a;
+
+  if (target & TARGET_RED_CHANNEL) {
+    r = d.r / d.div + matrix->getBias();
+    r = MID(0, r, 255);
+  }
+  else
+    r = rgba_getr(color);
+
+  if (target & TARGET_GREEN_CHANNEL) {
+    g = d.g / d.div + matrix->getBias();
+    g = MID(0, g, 255);
+  }
+  else
+    g = rgba_getg(color);
+
+  if (target & TARGET_BLUE_CHANNEL) {
+    b = d.b / d.div + matrix->getBias();
+    b = MID(0, b, 255);
+  }
+  else
+    b = rgba_getb(color);
+
+  if (target & TARGET_ALPHA_CHANNEL) {
+    a = d.a / d.div + matrix->getBias();
+    a = MID(0, a, 255);
+  }
+  else
+    a = rgba_geta(color);
+
+  return rgbmap->mapColor(r, g, b, a);
+}
+
 void ConvolutionMatrixFilter::applyToRgba(FilterManager* filterMgr)
 {
   if (!m_matrix)
@@ -154,6 +441,38 @@ void ConvolutionMatrixFilter::applyToRgba(FilterManager* filterMgr)
   int x2 = x+filterMgr->getWidth();
   int y = filterMgr->y();
 
+  if (m_separable) {
+    apply_separable<RgbTraits, 5>(
+      filterMgr, this, m_generation, nullptr,
+      m_matrix.get(), m_rowKernel, m_colKernel, m_tiledMode,
+      [](RgbTraits::pixel_t color, int* v) {
+        const int m = (rgba_geta(color) != 0);
+        v[0] = rgba_getr(color) * m;
+        v[1] = rgba_getg(color) * m;
+        v[2] = rgba_getb(color) * m;
+        v[3] = rgba_geta(color);
+        v[4] = m;
+      },
+      [&](int x, const int* sums) {
+        if (sums) {
+          color = get_pixel_fast<RgbTraits>(src, x, y);
+          // Weights of transparent pixels are subtracted from div
+          delegate.div = m_matrix->getDiv() - (m_weightsSum - sums[4]);
+          if (delegate.div == 0)
+            *dst_address = color;
+          else {
+            delegate.r = sums[0];
+            delegate.g = sums[1];
+            delegate.b = sums[2];
+            delegate.a = sums[3];
+            *dst_address = rgba_result(delegate, color, target, m_matrix.get());
+          }
+        }
+        ++dst_address;
+      });
+    return;
+  }
+
   for (; x<x2; ++x) {
     // Avoid the non-selected region
     if (filterMgr->skipPixel()) {
@@ -175,35 +494,7 @@ void ConvolutionMatrixFilter::applyToRgba(FilterManager* filterMgr)
       continue;
     }
 
-    if (target & TARGET_RED_CHANNEL) {
-      delegate.r = delegate.r / delegate.div + m_matrix->getBias();
-      delegate.r = MID(0, delegate.r, 255);
-    }
-    else
-      delegate.r = rgba_getr(color);
-
-    if (target & TARGET_GREEN_CHANNEL) {
-      delegate.g = delegate.g / delegate.div + m_matrix->getBias();
-      delegate.g = MID(0, delegate.g, 255);
-    }
-    else
-      delegate.g = rgba_getg(color);
-
-    if (target & TARGET_BLUE_CHANNEL) {
-      delegate.b = delegate.b / delegate.div + m_matrix->getBias();
-      delegate.b = MID(0, delegate.b, 255);
-    }
-    else
-      delegate.b = rgba_getb(color);
-
-    if (target & TARGET_ALPHA_CHANNEL) {
-      delegate.a = delegate.a / m_matrix->getDiv() + m_matrix->getBias();
-      delegate.a = MID(0, delegate.a, 255);
-    }
-    else
-      delegate.a = rgba_geta(color);
-
-    *(dst_address++) = rgba(delegate.r, delegate.g, delegate.b, delegate.a);
+    *(dst_address++) = rgba_result(delegate, color, target, m_matrix.get());
   }
 }
 
@@ -221,6 +512,33 @@ void ConvolutionMatrixFilter::applyToGrayscale(FilterManager* filterMgr)
   int x2 = x+filterMgr->getWidth();
   int y = filterMgr->y();
 
+  if (m_separable) {
+    apply_separable<GrayscaleTraits, 3>(
+      filterMgr, this, m_generation, nullptr,
+      m_matrix.get(), m_rowKernel, m_colKernel, m_tiledMode,
+      [](GrayscaleTraits::pixel_t color, int* v) {
+        const int m = (graya_geta(color) != 0);
+        v[0] = graya_getv(color) * m;
+        v[1] = graya_geta(color);
+        v[2] = m;
+      },
+      [&](int x, const int* sums) {
+        if (sums) {
+          color = get_pixel_fast<GrayscaleTraits>(src, x, y);
+          delegate.div = m_matrix->getDiv() - (m_weightsSum - sums[2]);
+          if (delegate.div == 0)
+            *dst_address = color;
+          else {
+            delegate.v = sums[0];
+            delegate.a = sums[1];
+            *dst_address = grayscale_result(delegate, color, target, m_matrix.get());
+          }
+        }
+        ++dst_address;
+      });
+    return;
+  }
+
   for (; x<x2; ++x) {
     // Avoid the non-selected region
     if (filterMgr->skipPixel()) {
@@ -242,21 +560,7 @@ void ConvolutionMatrixFilter::applyToGrayscale(FilterManager* filterMgr)
       continue;
     }
 
-    if (target & TARGET_GRAY_CHANNEL) {
-      delegate.v = delegate.v / delegate.div + m_matrix->getBias();
-      delegate.v = MID(0, delegate.v, 255);
-    }
-    else
-      delegate.v = graya_getv(color);
-
-    if (target & TARGET_ALPHA_CHANNEL) {
-      delegate.a = delegate.a / m_matrix->getDiv() + m_matrix->getBias();
-      delegate.a = MID(0, delegate.a, 255);
-    }
-    else
-      delegate.a = graya_geta(color);
-
-    *(dst_address++) = graya(delegate.v, delegate.a);
+    *(dst_address++) = grayscale_result(delegate, color, target, m_matrix.get());
   }
 }
 
@@ -276,6 +580,41 @@ void ConvolutionMatrixFilter::applyToIndexed(FilterManager* filterMgr)
   int x2 = x+filterMgr->getWidth();
   int y = filterMgr->y();
 
+  if (m_separable) {
+    apply_separable<IndexedTraits, 6>(
+      filterMgr, this, m_generation, pal,
+      m_matrix.get(), m_rowKernel, m_colKernel, m_tiledMode,
+      [pal](IndexedTraits::pixel_t index, int* v) {
+        color_t color = pal->getEntry(index);
+        const int m = (rgba_geta(color) != 0);
+        v[0] = index;
+        v[1] = rgba_getr(color) * m;
+        v[2] = rgba_getg(color) * m;
+        v[3] = rgba_getb(color) * m;
+        v[4] = rgba_geta(color);
+        v[5] = m;
+      },
+      [&](int x, const int* sums) {
+        if (sums) {
+          color = get_pixel_fast<IndexedTraits>(src, x, y);
+          delegate.div = m_matrix->getDiv() - (m_weightsSum - sums[5]);
+          if (delegate.div == 0)
+            *dst_address = color;
+          else {
+            delegate.index = sums[0];
+            delegate.r = sums[1];
+            delegate.g = sums[2];
+            delegate.b = sums[3];
+            delegate.a = sums[4];
+            *dst_address = indexed_result(delegate, color, target,
+                                          m_matrix.get(), pal, rgbmap);
+          }
+        }
+        ++dst_address;
+      });
+    return;
+  }
+
   for (; x<x2; ++x) {
     // Avoid the non-selected region
     if (filterMgr->skipPixel()) {
@@ -297,45 +636,8 @@ void ConvolutionMatrixFilter::applyToIndexed(FilterManager* filterMgr)
       continue;
     }
 
-    if (target & TARGET_INDEX_CHANNEL) {
-      delegate.index = delegate.index / m_matrix->getDiv() + m_matrix->getBias();
-      delegate.index = MID(0, delegate.index, 255);
-
-      *(dst_address++) = delegate.index;
-    }
-    else {
-      color = pal->getEntry(color);
-
-      if (target & TARGET_RED_CHANNEL) {
-        delegate.r = delegate.r / delegate.div + m_matrix->getBias();
-        delegate.r = MID(0, delegate.r, 255);
-      }
-      else
-        delegate.r = rgba_getr(color);
-
-      if (target & TARGET_GREEN_CHANNEL) {
-        delegate.g =  delegate.g / delegate.div + m_matrix->getBias();
-        delegate.g = MID(0, delegate.g, 255);
-      }
-      else
-        delegate.g = rgba_getg(color);
-
-      if (target & TARGET_BLUE_CHANNEL) {
-        delegate.b = delegate.b / delegate.div + m_matrix->getBias();
-        delegate.b = MID(0, delegate.b, 255);
-      }
-      else
-        delegate.b = rgba_getb(color);
-
-      if (target & TARGET_ALPHA_CHANNEL) {
-        delegate.a = delegate.a / delegate.div + m_matrix->getBias();
-        delegate.a = MID(0, delegate.a, 255);
-      }
-      else
-        delegate.a = rgba_geta(color);
-
-      *(dst_address++) = rgbmap->mapColor(delegate.r, delegate.g, delegate.b, delegate.a);
-    }
+    *(dst_address++) = indexed_result(delegate, color, target,
+                                      m_matrix.get(), pal, rgbmap);
   }
 }
 
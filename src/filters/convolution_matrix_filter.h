@@ -33,11 +33,20 @@ namespace filters {
     void applyToRgba(FilterManager* filterMgr);
     void applyToGrayscale(FilterManager* filterMgr);
     void applyToIndexed(FilterManager* filterMgr);
+    bool isThreadSafe() { return true; }
 
   private:
     base::SharedPtr<ConvolutionMatrix> m_matrix;
     TiledMode m_tiledMode;
-    std::vector<uint8_t*> m_lines;
+    // Kernels of the matrix when it's separable (see
+    // ConvolutionMatrix::getSeparableKernels())
+    bool m_separable;
+    std::vector<int> m_rowKernel;
+    std::vector<int> m_colKernel;
+    int m_weightsSum;
+    // Changes with each matrix/tiled mode (to invalidate the rows
+    // cached by the separable convolution)
+    uint32_t m_generation;
   };
 
 } // namespace filters
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "base/ints.h"
+
 namespace filters {
 
   class FilterManager;
@@ -36,6 +38,22 @@ namespace filters {
     // each pixel.
     virtual void applyToIndexed(FilterManager* filterMgr) = 0;
 
+    // Returns true if the filter can be applied to several rows at
+    // the same time from different threads, i.e. applyTo*() members
+    // don't modify the state of the filter.
+    virtual bool isThreadSafe() { return false; }
+
+    // Returns true if each pixel is calculated from the same pixel of
+    // the source (it doesn't use FilterManager::getSourceImage()), so
+    // the filter can be used in a FilterChain.
+    virtual bool isPointwise() { return false; }
+
+    // Returns true if the filter changes each target channel of RGB
+    // and grayscale images with the same table of 256 values (given
+    // in "map"), independently of the other channels and pixels. It's
+    // used to fuse filters in a FilterChain.
+    virtual bool getChannelMap(uint8_t* map) { return false; }
+
   };
 
 } // namespace filters
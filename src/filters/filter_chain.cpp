@@ -0,0 +1,261 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "filters/filter_chain.h"
+
+#include "base/debug.h"
+#include "filters/filter_manager.h"
+#include "doc/image_impl.h"
+
+#include <algorithm>
+
+namespace filters {
+
+using namespace doc;
+
+namespace {
+
+  const int kChannels = 5;
+
+  // Channel of each table in Stage::maps
+  const Target kChannelTargets[kChannels] = {
+    TARGET_RED_CHANNEL,
+    TARGET_GREEN_CHANNEL,
+    TARGET_BLUE_CHANNEL,
+    TARGET_ALPHA_CHANNEL,
+    TARGET_GRAY_CHANNEL
+  };
+
+  struct IdentityMap {
+    uint8_t map[256];
+    IdentityMap() {
+      for (int c=0; c<256; ++c)
+        map[c] = c;
+    }
+  };
+
+  const IdentityMap g_identity;
+
+  // Returns the table for the given channel of the stage, or the
+  // identity if the channel isn't modified.
+  inline const uint8_t* channel_map(const std::vector<uint8_t>& maps,
+                                    Target target, int channel)
+  {
+    if (target & kChannelTargets[channel])
+      return &maps[channel*256];
+    else
+      return g_identity.map;
+  }
+
+  void apply_maps(RgbTraits::pixel_t* row, const char* skip, int w,
+                  const std::vector<uint8_t>& maps, Target target)
+  {
+    const uint8_t* r = channel_map(maps, target, 0);
+    const uint8_t* g = channel_map(maps, target, 1);
+    const uint8_t* b = channel_map(maps, target, 2);
+    const uint8_t* a = channel_map(maps, target, 3);
+
+    for (int x=0; x<w; ++x) {
+      if (skip[x])
+        continue;
+
+      const color_t c = row[x];
+      row[x] = rgba(r[rgba_getr(c)],
+                    g[rgba_getg(c)],
+                    b[rgba_getb(c)],
+                    a[rgba_geta(c)]);
+    }
+  }
+
+  void apply_maps(GrayscaleTraits::pixel_t* row, const char* skip, int w,
+                  const std::vector<uint8_t>& maps, Target target)
+  {
+    const uint8_t* v = channel_map(maps, target, 4);
+    const uint8_t* a = channel_map(maps, target, 3);
+
+    for (int x=0; x<w; ++x) {
+      if (skip[x])
+        continue;
+
+      const color_t c = row[x];
+      row[x] = graya(v[graya_getv(c)],
+                     a[graya_geta(c)]);
+    }
+  }
+
+  void apply_maps(IndexedTraits::pixel_t* row, const char* skip, int w,
+                  const std::vector<uint8_t>& maps, Target target)
+  {
+    // Channel maps are not fused for indexed images
+    ASSERT(false);
+  }
+
+} // anonymous namespace
+
+// FilterManager given to each filter of the chain. It reads/writes
+// rows of pixels of the chain and repeats the mask of the real row.
+class FilterChain::StageManager : public FilterManager {
+public:
+  StageManager(FilterManager* mgr,
+               const void* src, void* dst,
+               Target target, const char* skip)
+    : m_mgr(mgr)
+    , m_src(src)
+    , m_dst(dst)
+    , m_target(target)
+    , m_skip(skip) {
+  }
+
+  const void* getSourceAddress() override { return m_src; }
+  void* getDestinationAddress() override { return m_dst; }
+  int getWidth() override { return m_mgr->getWidth(); }
+  Target getTarget() override { return m_target; }
+  FilterIndexedData* getIndexedData() override { return m_mgr->getIndexedData(); }
+  bool skipPixel() override { return *(m_skip++) != 0; }
+  const doc::Image* getSourceImage() override { return m_mgr->getSourceImage(); }
+  int x() override { return m_mgr->x(); }
+  int y() override { return m_mgr->y(); }
+
+private:
+  FilterManager* m_mgr;
+  const void* m_src;
+  void* m_dst;
+  Target m_target;
+  const char* m_skip;
+};
+
+void FilterChain::addFilter(Filter* filter, Target target)
+{
+  ASSERT(filter);
+  ASSERT(filter->isPointwise());
+
+  Stage stage;
+  stage.filter = filter;
+  stage.target = target;
+  m_filters.push_back(stage);
+
+  uint8_t map[256];
+  if (!filter->getChannelMap(map)) {
+    m_fused.push_back(stage);
+    return;
+  }
+
+  // Fuse the map with the previous ones
+  if (m_fused.empty() || m_fused.back().filter) {
+    Stage fused;
+    fused.filter = nullptr;
+    fused.target = 0;
+    fused.maps.resize(kChannels*256);
+    for (int i=0; i<kChannels; ++i)
+      std::copy(g_identity.map, g_identity.map+256, &fused.maps[i*256]);
+    m_fused.push_back(fused);
+  }
+
+  Stage& fused = m_fused.back();
+  fused.target |= target;
+  for (int i=0; i<kChannels; ++i) {
+    if (target & kChannelTargets[i]) {
+      uint8_t* m = &fused.maps[i*256];
+      for (int c=0; c<256; ++c)
+        m[c] = map[m[c]];
+    }
+  }
+}
+
+Target FilterChain::getTarget() const
+{
+  Target target = 0;
+  for (const Stage& stage : m_filters)
+    target |= stage.target;
+  return target;
+}
+
+const char* FilterChain::getName()
+{
+  return "Filter Chain";
+}
+
+void FilterChain::applyToRgba(FilterManager* filterMgr)
+{
+  applyStages<RgbTraits>(filterMgr, m_fused, &Filter::applyToRgba);
+}
+
+void FilterChain::applyToGrayscale(FilterManager* filterMgr)
+{
+  applyStages<GrayscaleTraits>(filterMgr, m_fused, &Filter::applyToGrayscale);
+}
+
+void FilterChain::applyToIndexed(FilterManager* filterMgr)
+{
+  // Each filter maps its result to the palette (as if the filters
+  // were applied one after another)
+  applyStages<IndexedTraits>(filterMgr, m_filters, &Filter::applyToIndexed);
+}
+
+bool FilterChain::isThreadSafe()
+{
+  for (const Stage& stage : m_filters)
+    if (!stage.filter->isThreadSafe())
+      return false;
+  return true;
+}
+
+template<typename Traits>
+void FilterChain::applyStages(FilterManager* filterMgr,
+                              const std::vector<Stage>& stages,
+                              void (Filter::*applyRow)(FilterManager*))
+{
+  typedef typename Traits::pixel_t pixel_t;
+
+  // Rows used between stages (one pair for each thread)
+  static thread_local std::vector<pixel_t> rows[2];
+  static thread_local std::vector<char> skip;
+
+  const pixel_t* src = (const pixel_t*)filterMgr->getSourceAddress();
+  pixel_t* dst = (pixel_t*)filterMgr->getDestinationAddress();
+  const int w = filterMgr->getWidth();
+  const Target target = filterMgr->getTarget();
+
+  // The mask of the row is read only once for all stages
+  skip.resize(w);
+  for (int x=0; x<w; ++x)
+    skip[x] = filterMgr->skipPixel();
+
+  rows[0].assign(src, src+w);
+  rows[1].resize(w);
+  int cur = 0;
+
+  for (const Stage& stage : stages) {
+    // Channels that cannot be modified (e.g. alpha of the background
+    // layer) are removed for all stages
+    const Target stageTarget = (stage.target & target);
+
+    if (!stage.filter) {
+      apply_maps(&rows[cur][0], &skip[0], w, stage.maps, stageTarget);
+      continue;
+    }
+
+    // Skipped pixels are not written by the filter
+    std::copy(rows[cur].begin(), rows[cur].end(), rows[1-cur].begin());
+
+    StageManager stageMgr(filterMgr, &rows[cur][0], &rows[1-cur][0],
+                          stageTarget, &skip[0]);
+    (stage.filter->*applyRow)(&stageMgr);
+    cur = 1-cur;
+  }
+
+  for (int x=0; x<w; ++x) {
+    if (!skip[x])
+      dst[x] = rows[cur][x];
+  }
+}
+
+} // namespace filters
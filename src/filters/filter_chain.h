@@ -0,0 +1,67 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+#include "filters/filter.h"
+#include "filters/target.h"
+
+#include <vector>
+
+namespace filters {
+
+  // Applies several pointwise filters (see Filter::isPointwise()) in
+  // one pass, each one with its own target channels. The results are
+  // the same as applying the filters one after another, but the image
+  // is traversed only once. Consecutive filters with channel maps
+  // (see Filter::getChannelMap()) are fused in one table for each
+  // channel of RGB and grayscale images.
+  class FilterChain : public Filter {
+  public:
+    // Adds a filter at the end of the chain. The filter must be
+    // configured before (its channel map is read here) and it must
+    // live while the chain is used.
+    void addFilter(Filter* filter, Target target);
+
+    bool isEmpty() const { return m_filters.empty(); }
+
+    // Returns all channels modified by the filters (the target that
+    // should be used in the FilterManager).
+    Target getTarget() const;
+
+    // Filter implementation
+    const char* getName();
+    void applyToRgba(FilterManager* filterMgr);
+    void applyToGrayscale(FilterManager* filterMgr);
+    void applyToIndexed(FilterManager* filterMgr);
+    bool isThreadSafe();
+    bool isPointwise() { return true; }
+
+  private:
+    class StageManager;
+
+    struct Stage {
+      // The filter or nullptr if the stage uses "maps"
+      Filter* filter;
+      Target target;
+      // Tables for red, green, blue, alpha and gray channels (256
+      // values each) of fused filters
+      std::vector<uint8_t> maps;
+    };
+
+    template<typename Traits>
+    void applyStages(FilterManager* filterMgr,
+                     const std::vector<Stage>& stages,
+                     void (Filter::*applyRow)(FilterManager*));
+
+    // Each filter (used for indexed images)
+    std::vector<Stage> m_filters;
+    // Filters with fused channel maps (used for RGB and grayscale)
+    std::vector<Stage> m_fused;
+  };
+
+} // namespace filters
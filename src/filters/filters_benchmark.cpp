@@ -0,0 +1,113 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#include "tests/benchmark.h"
+
+#include "base/shared_ptr.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+#include "filters/color_curve.h"
+#include "filters/color_curve_filter.h"
+#include "filters/convolution_matrix.h"
+#include "filters/convolution_matrix_filter.h"
+#include "filters/filter.h"
+#include "filters/filter_manager.h"
+#include "filters/invert_color_filter.h"
+#include "filters/median_filter.h"
+
+#include <random>
+
+using namespace doc;
+using namespace filters;
+
+namespace {
+
+// Applies a filter to a whole RGB image row by row (like the
+// FilterManagerImpl of the app but without selection/undo).
+class BenchmarkFilterManager : public FilterManager {
+public:
+  BenchmarkFilterManager(const Image* src, Image* dst)
+    : m_src(src), m_dst(dst), m_row(0) {
+  }
+
+  void apply(Filter& filter) {
+    for (m_row=0; m_row<m_src->height(); ++m_row)
+      filter.applyToRgba(this);
+  }
+
+  const void* getSourceAddress() override { return m_src->getPixelAddress(0, m_row); }
+  void* getDestinationAddress() override { return m_dst->getPixelAddress(0, m_row); }
+  int getWidth() override { return m_src->width(); }
+  Target getTarget() override { return TARGET_ALL_CHANNELS; }
+  FilterIndexedData* getIndexedData() override { return nullptr; }
+  bool skipPixel() override { return false; }
+  const Image* getSourceImage() override { return m_src; }
+  int x() override { return 0; }
+  int y() override { return m_row; }
+
+private:
+  const Image* m_src;
+  Image* m_dst;
+  int m_row;
+};
+
+ImageRef create_noise_image(int w, int h)
+{
+  ImageRef image(Image::create(IMAGE_RGB, w, h));
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> dist(0, 255);
+  for (int y=0; y<h; ++y)
+    for (int x=0; x<w; ++x)
+      put_pixel(image.get(), x, y,
+                rgba(dist(rng), dist(rng), dist(rng), dist(rng)));
+  return image;
+}
+
+void run_filter(benchmark::State& state, Filter& filter)
+{
+  ImageRef src = create_noise_image(256, 256);
+  ImageRef dst(Image::create(IMAGE_RGB, 256, 256));
+  BenchmarkFilterManager mgr(src.get(), dst.get());
+
+  state.run([&]{
+    mgr.apply(filter);
+    benchmark::do_not_optimize(*dst);
+  });
+}
+
+} // anonymous namespace
+
+BENCHMARK(Filters, InvertColor256) {
+  InvertColorFilter filter;
+  run_filter(state, filter);
+}
+
+BENCHMARK(Filters, Median3x3_256) {
+  MedianFilter filter;
+  filter.setTiledMode(TiledMode::NONE);
+  filter.setSize(3, 3);
+  run_filter(state, filter);
+}
+
+BENCHMARK(Filters, GaussianBlur256) {
+  ConvolutionMatrixFilter filter;
+  filter.setMatrix(base::SharedPtr<ConvolutionMatrix>(
+                     ConvolutionMatrix::createGaussianBlur(2)));
+  run_filter(state, filter);
+}
+
+BENCHMARK(Filters, ColorCurve256) {
+  ColorCurve curve(ColorCurve::Linear);
+  curve.addPoint(gfx::Point(0, 0));
+  curve.addPoint(gfx::Point(64, 96));
+  curve.addPoint(gfx::Point(255, 255));
+
+  ColorCurveFilter filter;
+  filter.setCurve(&curve);
+  run_filter(state, filter);
+}
@@ -26,6 +26,13 @@ const char* InvertColorFilter::getName()
   return "Invert Color";
 }
 
+bool InvertColorFilter::getChannelMap(uint8_t* map)
+{
+  for (int c=0; c<256; ++c)
+    map[c] = c ^ 0xff;
+  return true;
+}
+
 void InvertColorFilter::applyToRgba(FilterManager* filterMgr)
 {
   const uint32_t* src_address = (uint32_t*)filterMgr->getSourceAddress();
@@ -17,84 +17,144 @@
 #include "doc/rgbmap.h"
 #include "filters/filter_indexed_data.h"
 #include "filters/filter_manager.h"
-#include "filters/neighboring_pixels.h"
 #include "filters/tiled_mode.h"
 
 #include <algorithm>
+#include <vector>
 
 namespace filters {
 
 using namespace doc;
 
 namespace {
-  struct GetPixelsDelegateRgba {
-    std::vector<std::vector<uint8_t> >& channel;
-    int c;
 
-    GetPixelsDelegateRgba(std::vector<std::vector<uint8_t> >& channel) : channel(channel) { }
-
-    void reset() { c = 0; }
-
-    void operator()(RgbTraits::pixel_t color)
-    {
-      channel[0][c] = rgba_getr(color);
-      channel[1][c] = rgba_getg(color);
-      channel[2][c] = rgba_getb(color);
-      channel[3][c] = rgba_geta(color);
-      c++;
+  // Histogram of the values of one channel in the window of the filter
+  // (the median is tracked as the window slides, so it's updated with
+  // a few steps per pixel instead of sorting all values).
+  class Histogram {
+  public:
+    void reset(int half) {
+      std::fill(m_hist, m_hist+256, 0);
+      m_half = half;
+      m_median = 0;
+      m_below = 0;
     }
-  };
 
-  struct GetPixelsDelegateGrayscale {
-    std::vector<std::vector<uint8_t> >& channel;
-    int c;
-
-    GetPixelsDelegateGrayscale(std::vector<std::vector<uint8_t> >& channel) : channel(channel) { }
+    void add(int v) {
+      ++m_hist[v];
+      if (v < m_median)
+        ++m_below;
+    }
 
-    void reset() { c = 0; }
+    void remove(int v) {
+      --m_hist[v];
+      if (v < m_median)
+        --m_below;
+    }
 
-    void operator()(GrayscaleTraits::pixel_t color)
-    {
-      channel[0][c] = graya_getv(color);
-      channel[1][c] = graya_geta(color);
-      c++;
+    // Returns the (n/2)-th value of the sorted window.
+    int median() {
+      while (m_below > m_half)
+        m_below -= m_hist[--m_median];
+      while (m_below + m_hist[m_median] <= m_half)
+        m_below += m_hist[m_median++];
+      return m_median;
     }
+
+  private:
+    int m_hist[256];
+    int m_half;
+    int m_median;
+    int m_below;            // Number of values less than m_median
   };
 
-  struct GetPixelsDelegateIndexed {
-    const Palette* pal;
-    std::vector<std::vector<uint8_t> >& channel;
-    Target target;
-    int c;
+  // Same coordinates used by get_neighboring_pixels()
+  inline int wrap_coord(int v, int size, bool tiled) {
+    if (tiled)
+      return ((v % size) + size) % size;
+    else
+      return MID(0, v, size-1);
+  }
 
-    GetPixelsDelegateIndexed(const Palette* pal, std::vector<std::vector<uint8_t> >& channel, Target target)
-      : pal(pal), channel(channel), target(target) { }
+  // Applies the median to the current row of the filter manager with
+  // a sliding histogram (Huang's algorithm): when the window moves to
+  // the next pixel only the pixels of two columns are updated.
+  // "getChannels" converts a pixel to N channels, and "write" is
+  // called with the medians of the active channels for each x (or
+  // with nullptr for skipped pixels).
+  template<typename Traits, int N, typename GetChannels, typename Write>
+  void apply_median(FilterManager* filterMgr, int width, int height,
+                    TiledMode tiledMode, const bool (&active)[N],
+                    GetChannels getChannels, Write write)
+  {
+    width = MAX(1, width);
+    height = MAX(1, height);
+
+    const Image* src = filterMgr->getSourceImage();
+    const int x1 = filterMgr->x();
+    const int x2 = x1+filterMgr->getWidth();
+    const int y = filterMgr->y();
+    const int cx = width/2;
+    const int cy = height/2;
+    const bool tiledX = (int(tiledMode) & int(TiledMode::X_AXIS)) != 0;
+    const bool tiledY = (int(tiledMode) & int(TiledMode::Y_AXIS)) != 0;
+
+    std::vector<typename Traits::const_address_t> rows(height);
+    for (int k=0; k<height; ++k)
+      rows[k] = reinterpret_cast<typename Traits::const_address_t>(
+        src->getPixelAddress(0, wrap_coord(y-cy+k, src->height(), tiledY)));
+
+    Histogram hist[N];
+    for (int c=0; c<N; ++c)
+      hist[c].reset(width*height/2);
+
+    uint8_t v[N];
+    auto addColumn = [&](int col) {
+      const int u = wrap_coord(col, src->width(), tiledX);
+      for (int k=0; k<height; ++k) {
+        getChannels(rows[k][u], v);
+        for (int c=0; c<N; ++c)
+          if (active[c])
+            hist[c].add(v[c]);
+      }
+    };
+    auto removeColumn = [&](int col) {
+      const int u = wrap_coord(col, src->width(), tiledX);
+      for (int k=0; k<height; ++k) {
+        getChannels(rows[k][u], v);
+        for (int c=0; c<N; ++c)
+          if (active[c])
+            hist[c].remove(v[c]);
+      }
+    };
 
-    void reset() { c = 0; }
+    for (int dx=0; dx<width; ++dx)
+      addColumn(x1-cx+dx);
 
-    void operator()(IndexedTraits::pixel_t color)
-    {
-      if (target & TARGET_INDEX_CHANNEL) {
-        channel[0][c] = color;
-      }
+    int medians[N];
+    for (int x=x1; x<x2; ++x) {
+      // Avoid the non-selected region
+      if (filterMgr->skipPixel())
+        write(x, nullptr);
       else {
-        color_t rgb = pal->getEntry(color);
-        channel[0][c] = rgba_getr(rgb);
-        channel[1][c] = rgba_getg(rgb);
-        channel[2][c] = rgba_getb(rgb);
-        channel[3][c] = rgba_geta(rgb);
+        for (int c=0; c<N; ++c)
+          medians[c] = (active[c] ? hist[c].median(): 0);
+        write(x, medians);
+      }
+
+      if (x+1 < x2) {
+        removeColumn(x-cx);
+        addColumn(x-cx+width);
       }
-      c++;
     }
-  };
-};
+  }
+
+} // anonymous namespace
 
 MedianFilter::MedianFilter()
   : m_tiledMode(TiledMode::NONE)
   , m_width(0)
   , m_height(0)
-  , m_ncolors(0)
-  , m_channel(4)
 {
 }
 
@@ -107,10 +167,6 @@ void MedianFilter::setSize(int width, int height)
 {
   m_width = width;
   m_height = height;
-  m_ncolors = width*height;
-
-  for (int c = 0; c < 4; ++c)
-    m_channel[c].resize(m_ncolors);
 }
 
 const char* MedianFilter::getName()
@@ -123,56 +179,31 @@ void MedianFilter::applyToRgba(FilterManager* filterMgr)
   const Image* src = filterMgr->getSourceImage();
   uint32_t* dst_address = (uint32_t*)filterMgr->getDestinationAddress();
   Target target = filterMgr->getTarget();
-  int color;
-  int r, g, b, a;
-  GetPixelsDelegateRgba delegate(m_channel);
-  int x = filterMgr->x();
-  int x2 = x+filterMgr->getWidth();
   int y = filterMgr->y();
-
-  for (; x<x2; ++x) {
-    // Avoid the non-selected region
-    if (filterMgr->skipPixel()) {
+  const bool active[4] = {
+    (target & TARGET_RED_CHANNEL) != 0,
+    (target & TARGET_GREEN_CHANNEL) != 0,
+    (target & TARGET_BLUE_CHANNEL) != 0,
+    (target & TARGET_ALPHA_CHANNEL) != 0 };
+
+  apply_median<RgbTraits>(
+    filterMgr, m_width, m_height, m_tiledMode, active,
+    [](RgbTraits::pixel_t color, uint8_t* v) {
+      v[0] = rgba_getr(color);
+      v[1] = rgba_getg(color);
+      v[2] = rgba_getb(color);
+      v[3] = rgba_geta(color);
+    },
+    [&](int x, const int* m) {
+      if (m) {
+        color_t color = get_pixel_fast<RgbTraits>(src, x, y);
+        *dst_address = rgba(active[0] ? m[0]: rgba_getr(color),
+                            active[1] ? m[1]: rgba_getg(color),
+                            active[2] ? m[2]: rgba_getb(color),
+                            active[3] ? m[3]: rgba_geta(color));
+      }
       ++dst_address;
-      continue;
-    }
-
-    delegate.reset();
-    get_neighboring_pixels<RgbTraits>(src, x, y, m_width, m_height, m_width/2, m_height/2,
-                                      m_tiledMode, delegate);
-
-    color = get_pixel_fast<RgbTraits>(src, x, y);
-
-    if (target & TARGET_RED_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      r = m_channel[0][m_ncolors/2];
-    }
-    else
-      r = rgba_getr(color);
-
-    if (target & TARGET_GREEN_CHANNEL) {
-      std::sort(m_channel[1].begin(), m_channel[1].end());
-      g = m_channel[1][m_ncolors/2];
-    }
-    else
-      g = rgba_getg(color);
-
-    if (target & TARGET_BLUE_CHANNEL) {
-      std::sort(m_channel[2].begin(), m_channel[2].end());
-      b = m_channel[2][m_ncolors/2];
-    }
-    else
-      b = rgba_getb(color);
-
-    if (target & TARGET_ALPHA_CHANNEL) {
-      std::sort(m_channel[3].begin(), m_channel[3].end());
-      a = m_channel[3][m_ncolors/2];
-    }
-    else
-      a = rgba_geta(color);
-
-    *(dst_address++) = rgba(r, g, b, a);
-  }
+    });
 }
 
 void MedianFilter::applyToGrayscale(FilterManager* filterMgr)
@@ -180,41 +211,25 @@ void MedianFilter::applyToGrayscale(FilterManager* filterMgr)
   const Image* src = filterMgr->getSourceImage();
   uint16_t* dst_address = (uint16_t*)filterMgr->getDestinationAddress();
   Target target = filterMgr->getTarget();
-  int color, k, a;
-  GetPixelsDelegateGrayscale delegate(m_channel);
-  int x = filterMgr->x();
-  int x2 = x+filterMgr->getWidth();
   int y = filterMgr->y();
-
-  for (; x<x2; ++x) {
-    // Avoid the non-selected region
-    if (filterMgr->skipPixel()) {
+  const bool active[2] = {
+    (target & TARGET_GRAY_CHANNEL) != 0,
+    (target & TARGET_ALPHA_CHANNEL) != 0 };
+
+  apply_median<GrayscaleTraits>(
+    filterMgr, m_width, m_height, m_tiledMode, active,
+    [](GrayscaleTraits::pixel_t color, uint8_t* v) {
+      v[0] = graya_getv(color);
+      v[1] = graya_geta(color);
+    },
+    [&](int x, const int* m) {
+      if (m) {
+        color_t color = get_pixel_fast<GrayscaleTraits>(src, x, y);
+        *dst_address = graya(active[0] ? m[0]: graya_getv(color),
+                             active[1] ? m[1]: graya_geta(color));
+      }
       ++dst_address;
-      continue;
-    }
-
-    delegate.reset();
-    get_neighboring_pixels<GrayscaleTraits>(src, x, y, m_width, m_height, m_width/2, m_height/2,
-                                            m_tiledMode, delegate);
-
-    color = get_pixel_fast<GrayscaleTraits>(src, x, y);
-
-    if (target & TARGET_GRAY_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      k = m_channel[0][m_ncolors/2];
-    }
-    else
-      k = graya_getv(color);
-
-    if (target & TARGET_ALPHA_CHANNEL) {
-      std::sort(m_channel[1].begin(), m_channel[1].end());
-      a = m_channel[1][m_ncolors/2];
-    }
-    else
-      a = graya_geta(color);
-
-    *(dst_address++) = graya(k, a);
-  }
+    });
 }
 
 void MedianFilter::applyToIndexed(FilterManager* filterMgr)
@@ -224,62 +239,48 @@ void MedianFilter::applyToIndexed(FilterManager* filterMgr)
   const Palette* pal = filterMgr->getIndexedData()->getPalette();
   const RgbMap* rgbmap = filterMgr->getIndexedData()->getRgbMap();
   Target target = filterMgr->getTarget();
-  int color, r, g, b, a;
-  GetPixelsDelegateIndexed delegate(pal, m_channel, target);
-  int x = filterMgr->x();
-  int x2 = x+filterMgr->getWidth();
   int y = filterMgr->y();
 
-  for (; x<x2; ++x) {
-    // Avoid the non-selected region
-    if (filterMgr->skipPixel()) {
-      ++dst_address;
-      continue;
-    }
-
-    delegate.reset();
-    get_neighboring_pixels<IndexedTraits>(src, x, y, m_width, m_height, m_width/2, m_height/2,
-                                          m_tiledMode, delegate);
-
-    if (target & TARGET_INDEX_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      *(dst_address++) = m_channel[0][m_ncolors/2];
-    }
-    else {
-      color = get_pixel_fast<IndexedTraits>(src, x, y);
-      color = pal->getEntry(color);
-
-      if (target & TARGET_RED_CHANNEL) {
-        std::sort(m_channel[0].begin(), m_channel[0].end());
-        r = m_channel[0][m_ncolors/2];
-      }
-      else
-        r = rgba_getr(color);
-
-      if (target & TARGET_GREEN_CHANNEL) {
-        std::sort(m_channel[1].begin(), m_channel[1].end());
-        g = m_channel[1][m_ncolors/2];
-      }
-      else
-        g = rgba_getg(pal->getEntry(color));
-
-      if (target & TARGET_BLUE_CHANNEL) {
-        std::sort(m_channel[2].begin(), m_channel[2].end());
-        b = m_channel[2][m_ncolors/2];
-      }
-      else
-        b = rgba_getb(color);
+  if (target & TARGET_INDEX_CHANNEL) {
+    const bool active[1] = { true };
+    apply_median<IndexedTraits>(
+      filterMgr, m_width, m_height, m_tiledMode, active,
+      [](IndexedTraits::pixel_t color, uint8_t* v) {
+        v[0] = color;
+      },
+      [&](int x, const int* m) {
+        if (m)
+          *dst_address = m[0];
+        ++dst_address;
+      });
+    return;
+  }
 
-      if (target & TARGET_ALPHA_CHANNEL) {
-        std::sort(m_channel[3].begin(), m_channel[3].end());
-        a = m_channel[3][m_ncolors/2];
+  const bool active[4] = {
+    (target & TARGET_RED_CHANNEL) != 0,
+    (target & TARGET_GREEN_CHANNEL) != 0,
+    (target & TARGET_BLUE_CHANNEL) != 0,
+    (target & TARGET_ALPHA_CHANNEL) != 0 };
+
+  apply_median<IndexedTraits>(
+    filterMgr, m_width, m_height, m_tiledMode, active,
+    [pal](IndexedTraits::pixel_t index, uint8_t* v) {
+      color_t color = pal->getEntry(index);
+      v[0] = rgba_getr(color);
+      v[1] = rgba_getg(color);
+      v[2] = rgba_getb(color);
+      v[3] = rgba_geta(color);
+    },
+    [&](int x, const int* m) {
+      if (m) {
+        color_t color = pal->getEntry(get_pixel_fast<IndexedTraits>(src, x, y));
+        *dst_address = rgbmap->mapColor(active[0] ? m[0]: rgba_getr(color),
+                                        active[1] ? m[1]: rgba_getg(color),
+                                        active[2] ? m[2]: rgba_getb(color),
+                                        active[3] ? m[3]: rgba_geta(color));
       }
-      else
-        a = rgba_geta(color);
-
-      *(dst_address++) = rgbmap->mapColor(r, g, b, a);
-    }
-  }
+      ++dst_address;
+    });
 }
 
 } // namespace filters
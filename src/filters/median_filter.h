@@ -11,8 +11,6 @@
 #include "filters/filter.h"
 #include "filters/tiled_mode.h"
 
-#include <vector>
-
 namespace filters {
 
   class MedianFilter : public Filter {
@@ -31,13 +29,12 @@ namespace filters {
     void applyToRgba(FilterManager* filterMgr);
     void applyToGrayscale(FilterManager* filterMgr);
     void applyToIndexed(FilterManager* filterMgr);
+    bool isThreadSafe() { return true; }
 
   private:
     TiledMode m_tiledMode;
     int m_width;
     int m_height;
-    int m_ncolors;
-    std::vector<std::vector<uint8_t> > m_channel;
   };
 
 } // namespace filters
@@ -9,6 +9,7 @@
 
 #include "filters/tiled_mode.h"
 #include "doc/image.h"
+#include "doc/image_spans.h"
 #include "doc/image_traits.h"
 
 #include <vector>
@@ -26,6 +27,16 @@ namespace filters {
                                      TiledMode tiledMode,
                                      Delegate& delegate)
   {
+    // Fast path: the whole matrix is inside the image (no tiled
+    // mode or edge handling is needed)
+    const gfx::Rect area(x - centerX, y - centerY, width, height);
+    if (sourceImage->bounds().contains(area)) {
+      for (const auto& span : ImageConstSpans<Traits>(sourceImage, area))
+        for (auto it=span.begin; it!=span.end; ++it)
+          delegate(*it);
+      return;
+    }
+
     // Y position to get pixel.
     int getx, gety = y - centerY;
     int addx, addy = 0;
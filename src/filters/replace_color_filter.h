@@ -28,6 +28,8 @@ namespace filters {
     void applyToRgba(FilterManager* filterMgr);
     void applyToGrayscale(FilterManager* filterMgr);
     void applyToIndexed(FilterManager* filterMgr);
+    bool isThreadSafe() { return true; }
+    bool isPointwise() { return true; }
 
   private:
     int m_from;
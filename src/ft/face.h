@@ -12,6 +12,7 @@
 #include "ft/freetype_headers.h"
 #include "gfx/rect.h"
 
+#include <cstdint>
 #include <iostream>
 #include <unordered_map>
 
@@ -105,26 +106,23 @@ namespace ft {
       FT_UInt prev_glyph = 0;
       double x = 0, y = 0;
 
+      // Vertical position of the baseline (descender is negative)
+      const double baseline = this->height() + this->descender();
+
       auto it = base::utf8_const_iterator(str.begin());
       auto end = base::utf8_const_iterator(str.end());
 
       for (; it != end; ++it) {
         FT_UInt glyph_index = m_cache.getGlyphIndex(m_face, *it);
 
-        if (use_kerning && prev_glyph && glyph_index) {
-          FT_Vector kerning;
-          FT_Get_Kerning(m_face, prev_glyph, glyph_index, FT_KERNING_DEFAULT, &kerning);
-          x += kerning.x / 64.0;
-        }
+        if (use_kerning && prev_glyph && glyph_index)
+          x += m_cache.getKerning(m_face, prev_glyph, glyph_index) / 64.0;
 
         Glyph* glyph = m_cache.loadGlyph(m_face, glyph_index, this->m_antialias);
         if (glyph) {
           glyph->bitmap = &FT_BitmapGlyph(glyph->ft_glyph)->bitmap;
           glyph->x = x + glyph->bearingX;
-          glyph->y = y
-            + this->height()
-            + this->descender() // descender is negative
-            - glyph->bearingY;
+          glyph->y = y + baseline - glyph->bearingY;
 
           callback(*glyph);
 
@@ -162,6 +160,12 @@ namespace ft {
       return FT_Get_Char_Index(face, charCode);
     }
 
+    FT_Pos getKerning(FT_Face face, FT_UInt prevGlyph, FT_UInt glyph) {
+      FT_Vector kerning;
+      FT_Get_Kerning(face, prevGlyph, glyph, FT_KERNING_DEFAULT, &kerning);
+      return kerning.x;
+    }
+
     Glyph* loadGlyph(FT_Face face, FT_UInt glyphIndex, bool antialias) {
       FT_Error err = FT_Load_Glyph(
         face, glyphIndex,
@@ -213,6 +217,30 @@ namespace ft {
       }
 
       m_glyphMap.clear();
+      m_kerningMap.clear();
+    }
+
+    // The glyph index doesn't depend on the size, so this map is
+    // kept when the cache is invalidated.
+    FT_UInt getGlyphIndex(FT_Face face, int charCode) {
+      auto it = m_indexMap.find(charCode);
+      if (it != m_indexMap.end())
+        return it->second;
+
+      FT_UInt glyphIndex = NoCache::getGlyphIndex(face, charCode);
+      m_indexMap[charCode] = glyphIndex;
+      return glyphIndex;
+    }
+
+    FT_Pos getKerning(FT_Face face, FT_UInt prevGlyph, FT_UInt glyph) {
+      const uint64_t key = (uint64_t(prevGlyph) << 32) | glyph;
+      auto it = m_kerningMap.find(key);
+      if (it != m_kerningMap.end())
+        return it->second;
+
+      FT_Pos kerning = NoCache::getKerning(face, prevGlyph, glyph);
+      m_kerningMap[key] = kerning;
+      return kerning;
     }
 
     Glyph* loadGlyph(FT_Face face, FT_UInt glyphIndex, bool antialias) {
@@ -244,6 +272,8 @@ namespace ft {
 
   private:
     std::unordered_map<FT_UInt, Glyph*> m_glyphMap;
+    std::unordered_map<int, FT_UInt> m_indexMap;
+    std::unordered_map<uint64_t, FT_Pos> m_kerningMap;
   };
 
   typedef FaceFT<SimpleCache> Face;
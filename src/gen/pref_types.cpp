@@ -29,7 +29,8 @@ static void print_pref_class_def(tinyxml2::XMLElement* elem, const std::string&
 
   std::cout
     << indent << "  void load();\n"
-    << indent << "  void save();\n";
+    << indent << "  void save();\n"
+    << indent << "  bool isDirty() const;\n";
 
   tinyxml2::XMLElement* child = (elem->FirstChild() ? elem->FirstChild()->ToElement(): NULL);
   while (child) {
@@ -157,6 +158,25 @@ static void print_pref_class_impl(tinyxml2::XMLElement* elem, const std::string&
   }
 
   std::cout
+    << "}\n"
+    << "\n"
+    << "bool " << prefix << className << "::isDirty() const\n"
+    << "{\n";
+
+  child = (elem->FirstChild() ? elem->FirstChild()->ToElement(): NULL);
+  while (child) {
+    if (child->Value()) {
+      std::string name = child->Value();
+      if (name == "option" || name == "section") {
+        std::string memberName = convert_xmlid_to_cppid(child->Attribute("id"), false);
+        std::cout << "  if (" << memberName << ".isDirty()) return true;\n";
+      }
+    }
+    child = child->NextSiblingElement();
+  }
+
+  std::cout
+    << "  return false;\n"
     << "}\n";
 
   child = (elem->FirstChild() ? elem->FirstChild()->ToElement(): NULL);
@@ -0,0 +1,251 @@
+// LibreSprite Gfx Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gfx/max_rects_packing.h"
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+namespace gfx {
+
+namespace {
+
+// Maximum texture side tried by bestFit()
+const int kMaxTextureSize = 65536;
+
+typedef MaxRectsPacking::Rects Rects;
+
+// Splits the free rectangles that intersect "used", removing the
+// resulting pieces that are contained in other free rectangles.
+void split_free_rects(Rects& freeRects, const Rect& used, Rects& pieces)
+{
+  pieces.clear();
+  for (std::size_t i=0; i<freeRects.size(); ) {
+    const Rect fr = freeRects[i];
+    if (!fr.intersects(used)) {
+      ++i;
+      continue;
+    }
+
+    if (used.x > fr.x) pieces.push_back(Rect(fr.x, fr.y, used.x-fr.x, fr.h));
+    if (used.x2() < fr.x2()) pieces.push_back(Rect(used.x2(), fr.y, fr.x2()-used.x2(), fr.h));
+    if (used.y > fr.y) pieces.push_back(Rect(fr.x, fr.y, fr.w, used.y-fr.y));
+    if (used.y2() < fr.y2()) pieces.push_back(Rect(fr.x, used.y2(), fr.w, fr.y2()-used.y2()));
+
+    freeRects[i] = freeRects.back();
+    freeRects.pop_back();
+  }
+
+  // The old free rectangles don't contain each other, so we have to
+  // compare only the new pieces (between them and with the old ones)
+  std::vector<char> keep(pieces.size(), true);
+  for (std::size_t i=0; i<pieces.size(); ++i) {
+    for (const Rect& fr : freeRects) {
+      if (fr.contains(pieces[i])) {
+        keep[i] = false;
+        break;
+      }
+    }
+    for (std::size_t j=0; j<pieces.size() && keep[i]; ++j) {
+      if (j != i &&
+          pieces[j].contains(pieces[i]) &&
+          (pieces[j] != pieces[i] || j < i))
+        keep[i] = false;
+    }
+  }
+
+  for (std::size_t i=0; i<freeRects.size(); ) {
+    bool contained = false;
+    for (std::size_t j=0; j<pieces.size() && !contained; ++j)
+      contained = (keep[j] && pieces[j].contains(freeRects[i]));
+
+    if (contained) {
+      freeRects[i] = freeRects.back();
+      freeRects.pop_back();
+    }
+    else
+      ++i;
+  }
+
+  for (std::size_t i=0; i<pieces.size(); ++i)
+    if (keep[i])
+      freeRects.push_back(pieces[i]);
+}
+
+bool pack_rects(const Size& size, const std::vector<Size>& sizes,
+                bool allowRotation, Rects& rects, std::vector<char>& rotated)
+{
+  rects.assign(sizes.size(), Rect());
+  rotated.assign(sizes.size(), false);
+
+  // Bigger rectangles first
+  std::vector<int> order(sizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(
+    order.begin(), order.end(),
+    [&sizes](int a, int b) {
+      const Size& u = sizes[a];
+      const Size& v = sizes[b];
+      if (std::max(u.w, u.h) != std::max(v.w, v.h))
+        return std::max(u.w, u.h) > std::max(v.w, v.h);
+      return std::min(u.w, u.h) > std::min(v.w, v.h);
+    });
+
+  Rects freeRects;
+  Rects pieces;
+  freeRects.push_back(Rect(size));
+
+  for (int i : order) {
+    const Size& sz = sizes[i];
+    if (sz.w <= 0 || sz.h <= 0) {
+      rects[i] = Rect(Point(0, 0), sz);
+      continue;
+    }
+
+    // Best short side fit: the free rectangle where the smallest
+    // leftover side is the shortest one
+    Rect best;
+    bool bestRotated = false;
+    int bestShort = INT_MAX;
+    int bestLong = INT_MAX;
+
+    auto tryFit = [&](const Rect& fr, int w, int h, bool rot) {
+      if (w > fr.w || h > fr.h)
+        return;
+
+      const int shortSide = std::min(fr.w-w, fr.h-h);
+      const int longSide = std::max(fr.w-w, fr.h-h);
+      if (shortSide < bestShort ||
+          (shortSide == bestShort && longSide < bestLong)) {
+        best = Rect(fr.x, fr.y, w, h);
+        bestRotated = rot;
+        bestShort = shortSide;
+        bestLong = longSide;
+      }
+    };
+
+    for (const Rect& fr : freeRects) {
+      tryFit(fr, sz.w, sz.h, false);
+      if (allowRotation && sz.w != sz.h)
+        tryFit(fr, sz.h, sz.w, true);
+    }
+
+    if (bestShort == INT_MAX)
+      return false;             // There is not enough room
+
+    rects[i] = best;
+    rotated[i] = bestRotated;
+    split_free_rects(freeRects, best, pieces);
+  }
+
+  return true;
+}
+
+} // anonymous namespace
+
+void MaxRectsPacking::add(const Size& sz)
+{
+  m_sizes.push_back(sz);
+  m_rects.push_back(Rect(Point(0, 0), sz));
+  m_rotated.push_back(false);
+}
+
+Size MaxRectsPacking::bestFit()
+{
+  // The texture cannot be smaller than the area of all rectangles
+  // or than the biggest one
+  double neededArea = 0.0;
+  int minW = 0, minH = 0;
+  for (const Size& sz : m_sizes) {
+    neededArea += double(sz.w) * double(sz.h);
+    if (m_allowRotation) {
+      minW = std::max(minW, std::min(sz.w, sz.h));
+      minH = std::max(minH, std::min(sz.w, sz.h));
+    }
+    else {
+      minW = std::max(minW, sz.w);
+      minH = std::max(minH, sz.h);
+    }
+  }
+
+  // Power of two sizes sorted by area (the squarer ones first, and
+  // wider than taller)
+  std::vector<Size> candidates;
+  for (int w=1; w<=kMaxTextureSize; w*=2) {
+    for (int h=1; h<=kMaxTextureSize; h*=2) {
+      if (w >= minW && h >= minH && double(w)*double(h) >= neededArea)
+        candidates.push_back(Size(w, h));
+    }
+  }
+  std::sort(
+    candidates.begin(), candidates.end(),
+    [](const Size& a, const Size& b) {
+      if (double(a.w)*a.h != double(b.w)*b.h)
+        return double(a.w)*a.h < double(b.w)*b.h;
+      const int da = std::max(a.w, a.h) / std::min(a.w, a.h);
+      const int db = std::max(b.w, b.h) / std::min(b.w, b.h);
+      if (da != db)
+        return da < db;
+      return a.w > b.w;
+    });
+
+  // Each batch of candidates is packed in parallel, the first one
+  // (the smallest) that fits is the result
+  const int batchSize = base::thread_pool::instance().concurrency();
+  std::vector<Rects> rects(batchSize);
+  std::vector<std::vector<char>> rotated(batchSize);
+  std::vector<char> fit(batchSize);
+
+  for (std::size_t first=0; first<candidates.size(); first+=batchSize) {
+    const int n = int(std::min(candidates.size()-first, std::size_t(batchSize)));
+
+    base::thread_pool::instance().parallel_for(
+      n,
+      [&](int i) {
+        fit[i] = pack_rects(candidates[first+i], m_sizes, m_allowRotation,
+                            rects[i], rotated[i]);
+      });
+
+    for (int i=0; i<n; ++i) {
+      if (fit[i]) {
+        m_bounds = Rect(candidates[first+i]);
+        m_rects.swap(rects[i]);
+        m_rotated.swap(rotated[i]);
+        return m_bounds.size();
+      }
+    }
+  }
+
+  m_bounds = Rect();
+  return Size(0, 0);
+}
+
+bool MaxRectsPacking::pack(const Size& size)
+{
+  m_bounds = Rect(size);
+  return pack_rects(size, m_sizes, m_allowRotation, m_rects, m_rotated);
+}
+
+double MaxRectsPacking::efficiency() const
+{
+  if (m_bounds.isEmpty())
+    return 0.0;
+
+  double area = 0.0;
+  for (const Size& sz : m_sizes)
+    area += double(sz.w) * double(sz.h);
+
+  return area / (double(m_bounds.w) * double(m_bounds.h));
+}
+
+} // namespace gfx
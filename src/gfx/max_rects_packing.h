@@ -0,0 +1,71 @@
+// LibreSprite Gfx Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "gfx/point.h"
+#include "gfx/rect.h"
+#include "gfx/size.h"
+
+#include <vector>
+
+namespace gfx {
+
+  // Packs rectangles with the MaxRects algorithm (best short side
+  // fit), optionally rotating them 90 degrees. It's slower than
+  // PackingRects for a few rectangles but scales to thousands of
+  // them and wastes less space.
+  class MaxRectsPacking {
+  public:
+    typedef std::vector<Rect> Rects;
+    typedef Rects::const_iterator const_iterator;
+
+    MaxRectsPacking() : m_allowRotation(false) { }
+
+    // Iterate over the packed rectangles (in the same order they
+    // were given in add() calls). The size of a rotated rectangle is
+    // swapped (it's the area used in the texture).
+    const_iterator begin() const { return m_rects.begin(); }
+    const_iterator end() const { return m_rects.end(); }
+
+    std::size_t size() const { return m_rects.size(); }
+    const Rect& operator[](int i) const { return m_rects[i]; }
+
+    // Returns true if the i-th rectangle was rotated 90 degrees.
+    bool isRotated(int i) const { return m_rotated[i] != 0; }
+
+    bool allowRotation() const { return m_allowRotation; }
+    void setAllowRotation(bool state) { m_allowRotation = state; }
+
+    // Adds a new rectangle.
+    void add(const Size& sz);
+
+    // Returns the smallest power of two size for the texture (the
+    // candidate sizes are tried in parallel), or an empty size if
+    // the rectangles cannot be packed.
+    Size bestFit();
+
+    // Arranges all rectangles in a texture of the given size.
+    // Returns true if all of them were arranged or false if there
+    // is not enough space.
+    bool pack(const Size& size);
+
+    // Returns the bounds of the packed area.
+    const Rect& bounds() const { return m_bounds; }
+
+    // Area of the rectangles divided by the area of bounds() (1.0
+    // means that no space is wasted).
+    double efficiency() const;
+
+  private:
+    Rect m_bounds;
+    std::vector<Size> m_sizes;
+    Rects m_rects;
+    std::vector<char> m_rotated;
+    bool m_allowRotation;
+  };
+
+} // namespace gfx
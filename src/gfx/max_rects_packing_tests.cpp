@@ -0,0 +1,91 @@
+// LibreSprite Gfx Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "gfx/max_rects_packing.h"
+#include "gfx/rect_io.h"
+#include "gfx/size.h"
+
+#include <random>
+
+using namespace gfx;
+
+namespace {
+
+int count_overlaps(const MaxRectsPacking& mr)
+{
+  int overlaps = 0;
+  for (std::size_t i=0; i<mr.size(); ++i)
+    for (std::size_t j=i+1; j<mr.size(); ++j)
+      if (mr[i].intersects(mr[j]))
+        ++overlaps;
+  return overlaps;
+}
+
+} // anonymous namespace
+
+TEST(MaxRectsPacking, Simple)
+{
+  MaxRectsPacking mr;
+  mr.add(Size(256, 128));
+  EXPECT_FALSE(mr.pack(Size(256, 120)));
+  EXPECT_TRUE(mr.pack(Size(256, 128)));
+
+  EXPECT_EQ(Rect(0, 0, 256, 128), mr[0]);
+  EXPECT_EQ(Rect(0, 0, 256, 128), mr.bounds());
+  EXPECT_DOUBLE_EQ(1.0, mr.efficiency());
+}
+
+TEST(MaxRectsPacking, Rotation)
+{
+  MaxRectsPacking mr;
+  mr.add(Size(64, 16));
+  mr.add(Size(16, 64));
+  EXPECT_FALSE(mr.pack(Size(32, 64)));
+
+  mr.setAllowRotation(true);
+  EXPECT_TRUE(mr.pack(Size(32, 64)));
+  EXPECT_TRUE(mr.isRotated(0));
+  EXPECT_FALSE(mr.isRotated(1));
+  EXPECT_EQ(Size(16, 64), mr[0].size());
+  EXPECT_EQ(0, count_overlaps(mr));
+}
+
+TEST(MaxRectsPacking, BestFit)
+{
+  std::mt19937 rnd(1);
+
+  for (bool rotation : { false, true }) {
+    MaxRectsPacking mr;
+    mr.setAllowRotation(rotation);
+    for (int i=0; i<200; ++i)
+      mr.add(Size(1 + rnd() % 40, 1 + rnd() % 40));
+
+    Size size = mr.bestFit();
+    ASSERT_FALSE(size.w == 0 || size.h == 0);
+    EXPECT_EQ(0, size.w & (size.w-1));
+    EXPECT_EQ(0, size.h & (size.h-1));
+    EXPECT_EQ(Rect(size), mr.bounds());
+    EXPECT_EQ(0, count_overlaps(mr));
+
+    for (const Rect& rc : mr)
+      EXPECT_TRUE(mr.bounds().contains(rc)) << rc;
+
+    EXPECT_GT(mr.efficiency(), 0.5);
+    EXPECT_LE(mr.efficiency(), 1.0);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
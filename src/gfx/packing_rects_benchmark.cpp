@@ -0,0 +1,87 @@
+// LibreSprite Gfx Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "tests/benchmark.h"
+
+#include "gfx/max_rects_packing.h"
+#include "gfx/packing_rects.h"
+#include "gfx/size.h"
+
+#include <random>
+#include <vector>
+
+using namespace gfx;
+
+namespace {
+
+// Sizes of the frames of a sprite sheet (trimmed cels)
+std::vector<Size> random_sizes(int n)
+{
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> dist(4, 64);
+  std::vector<Size> sizes;
+  for (int i=0; i<n; ++i)
+    sizes.push_back(Size(dist(rng), dist(rng)));
+  return sizes;
+}
+
+} // anonymous namespace
+
+BENCHMARK(PackingRects, BestFit64) {
+  const std::vector<Size> sizes = random_sizes(64);
+  state.run([&]{
+      PackingRects pr;
+      for (const Size& sz : sizes)
+        pr.add(sz);
+      Size res = pr.bestFit();
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(PackingRects, Pack256) {
+  const std::vector<Size> sizes = random_sizes(256);
+  state.run([&]{
+      PackingRects pr;
+      for (const Size& sz : sizes)
+        pr.add(sz);
+      bool res = pr.pack(Size(1024, 1024));
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(MaxRectsPacking, BestFit64) {
+  const std::vector<Size> sizes = random_sizes(64);
+  state.run([&]{
+      MaxRectsPacking pr;
+      for (const Size& sz : sizes)
+        pr.add(sz);
+      Size res = pr.bestFit();
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(MaxRectsPacking, Pack256) {
+  const std::vector<Size> sizes = random_sizes(256);
+  state.run([&]{
+      MaxRectsPacking pr;
+      for (const Size& sz : sizes)
+        pr.add(sz);
+      bool res = pr.pack(Size(1024, 1024));
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(MaxRectsPacking, Pack256WithRotation) {
+  const std::vector<Size> sizes = random_sizes(256);
+  state.run([&]{
+      MaxRectsPacking pr;
+      pr.setAllowRotation(true);
+      for (const Size& sz : sizes)
+        pr.add(sz);
+      bool res = pr.pack(Size(1024, 1024));
+      benchmark::do_not_optimize(res);
+    });
+}
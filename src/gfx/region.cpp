@@ -173,4 +173,27 @@ const Rect Region::operator[](int i) const
   return to_rect(pixman_region32_rectangles(&m_region, NULL)[i]);
 }
 
+void RegionBuilder::add(const Region& rgn)
+{
+  int n = 0;
+  const pixman_box32* boxes = pixman_region32_rectangles(&rgn.m_region, &n);
+  m_boxes.insert(m_boxes.end(), boxes, boxes+n);
+}
+
+void RegionBuilder::build(Region& rgn)
+{
+  pixman_region32_fini(&rgn.m_region);
+  pixman_region32_init_rects(&rgn.m_region, m_boxes.data(), int(m_boxes.size()));
+  m_boxes.clear();
+}
+
+void RegionBuilder::unionWith(Region& rgn)
+{
+  if (m_boxes.empty())
+    return;
+
+  add(rgn);
+  build(rgn);
+}
+
 } // namespace gfx
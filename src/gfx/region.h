@@ -119,6 +119,34 @@ namespace gfx {
 
   private:
     mutable details::Region m_region;
+    friend class RegionBuilder;
+  };
+
+  // Collects rectangles to create their union in one pass (the boxes
+  // are sorted and merged together), instead of calling
+  // Region::createUnion() for each one, which creates a new region
+  // each time (quadratic with thousands of small rectangles). The
+  // rectangles can overlap.
+  class RegionBuilder {
+  public:
+    void add(const Rect& rect) {
+      if (!rect.isEmpty())
+        m_boxes.push_back({ rect.x, rect.y, rect.x2(), rect.y2() });
+    }
+    void add(const Region& rgn);
+
+    bool isEmpty() const { return m_boxes.empty(); }
+    std::size_t size() const { return m_boxes.size(); }
+
+    // Replaces "rgn" with the union of the collected rectangles. The
+    // builder is cleared (its memory is kept to be reused).
+    void build(Region& rgn);
+
+    // Adds the collected rectangles to "rgn" and clears the builder.
+    void unionWith(Region& rgn);
+
+  private:
+    std::vector<details::Box> m_boxes;
   };
 
 } // namespace gfx
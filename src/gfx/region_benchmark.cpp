@@ -0,0 +1,113 @@
+// LibreSprite Gfx Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "tests/benchmark.h"
+
+#include "gfx/point.h"
+#include "gfx/rect.h"
+#include "gfx/region.h"
+
+#include <random>
+
+using namespace gfx;
+
+namespace {
+
+// Random rectangles in a 1024x1024 area (like the dirty regions of
+// brush strokes)
+Region random_region(int n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> pos(0, 1000), size(1, 64);
+  Region rgn;
+  for (int i=0; i<n; ++i)
+    rgn |= Region(Rect(pos(rng), pos(rng), size(rng), size(rng)));
+  return rgn;
+}
+
+} // anonymous namespace
+
+BENCHMARK(Region, UnionOfSmallRects) {
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> pos(0, 1000), size(1, 16);
+  std::vector<Rect> rects;
+  for (int i=0; i<256; ++i)
+    rects.push_back(Rect(pos(rng), pos(rng), size(rng), size(rng)));
+
+  state.run([&]{
+      Region rgn;
+      for (const Rect& rc : rects)
+        rgn |= Region(rc);
+      benchmark::do_not_optimize(rgn);
+    });
+}
+
+BENCHMARK(Region, BuilderOfSmallRects) {
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> pos(0, 1000), size(1, 16);
+  std::vector<Rect> rects;
+  for (int i=0; i<256; ++i)
+    rects.push_back(Rect(pos(rng), pos(rng), size(rng), size(rng)));
+
+  RegionBuilder builder;
+  state.run([&]{
+      Region rgn;
+      for (const Rect& rc : rects)
+        builder.add(rc);
+      builder.build(rgn);
+      benchmark::do_not_optimize(rgn);
+    });
+}
+
+BENCHMARK(Region, Union) {
+  const Region a = random_region(128, 1);
+  const Region b = random_region(128, 2);
+  state.run([&]{
+      Region res;
+      res.createUnion(a, b);
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(Region, Intersection) {
+  const Region a = random_region(128, 1);
+  const Region b = random_region(128, 2);
+  state.run([&]{
+      Region res;
+      res.createIntersection(a, b);
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(Region, Subtraction) {
+  const Region a = random_region(128, 1);
+  const Region b = random_region(128, 2);
+  state.run([&]{
+      Region res;
+      res.createSubtraction(a, b);
+      benchmark::do_not_optimize(res);
+    });
+}
+
+BENCHMARK(Region, ContainsPoint) {
+  const Region rgn = random_region(128, 1);
+  state.run([&]{
+      int count = 0;
+      for (int y=0; y<1024; y+=8)
+        for (int x=0; x<1024; x+=8)
+          count += (rgn.contains(PointT<int>(x, y)) ? 1: 0);
+      benchmark::do_not_optimize(count);
+    });
+}
+
+BENCHMARK(Region, Offset) {
+  Region rgn = random_region(128, 1);
+  state.run([&]{
+      rgn.offset(1, -1);
+      rgn.offset(-1, 1);
+      benchmark::do_not_optimize(rgn);
+    });
+}
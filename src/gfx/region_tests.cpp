@@ -123,6 +123,33 @@ TEST(Region, Iterators)
   EXPECT_EQ(2, c);
 }
 
+TEST(Region, Builder)
+{
+  RegionBuilder builder;
+  builder.add(Rect(0, 0, 32, 64));
+  builder.add(Rect(0, 0, 64, 32));
+  builder.add(Rect(16, 16, 8, 8));
+  builder.add(Rect(100, 100, 0, 10));
+  EXPECT_EQ(3, builder.size());
+
+  Region a;
+  builder.build(a);
+  EXPECT_TRUE(builder.isEmpty());
+
+  Region b;
+  b.createUnion(b, Region(Rect(0, 0, 32, 64)));
+  b.createUnion(b, Region(Rect(0, 0, 64, 32)));
+  ASSERT_EQ(b.size(), a.size());
+  for (std::size_t i=0; i<a.size(); ++i)
+    EXPECT_EQ(b[i], a[i]);
+
+  builder.add(Rect(64, 0, 16, 32));
+  builder.unionWith(a);
+  EXPECT_EQ(Rect(0, 0, 80, 64), a.bounds());
+  EXPECT_TRUE(a.contains(Point(79, 31)));
+  EXPECT_FALSE(a.contains(Point(40, 40)));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,68 @@
+// LibreSprite Network Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "net/http_in_flight.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+namespace net {
+
+namespace {
+
+std::mutex mutex;
+std::condition_variable changed;
+int limit = HttpInFlight::kDefaultLimit;
+int inFlight = 0;
+
+} // anonymous namespace
+
+// static
+void HttpInFlight::setLimit(int newLimit)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    limit = std::max(1, newLimit);
+  }
+  changed.notify_all();
+}
+
+// static
+bool HttpInFlight::acquire(const std::atomic<bool>& aborted)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [&aborted]{ return aborted || inFlight < limit; });
+  if (aborted)
+    return false;
+  ++inFlight;
+  return true;
+}
+
+// static
+void HttpInFlight::release()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    --inFlight;
+  }
+  changed.notify_all();
+}
+
+// static
+void HttpInFlight::wakeUp()
+{
+  // Lock the mutex so a waiting thread cannot miss the notification
+  // between checking its "aborted" flag and sleeping.
+  { std::lock_guard<std::mutex> lock(mutex); }
+  changed.notify_all();
+}
+
+} // namespace net
@@ -0,0 +1,48 @@
+// LibreSprite Network Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <atomic>
+
+namespace net {
+
+// Limits the number of requests that are sent at the same time (by
+// all the HttpRequest implementations). Requests that don't get a
+// slot wait until another one finishes, so a burst of requests
+// doesn't open a connection for each one.
+class HttpInFlight {
+public:
+  static constexpr int kDefaultLimit = 6;
+
+  static void setLimit(int limit);
+
+  // Waits for a free slot. Returns false (without taking the slot)
+  // if "aborted" is set while it's waiting.
+  static bool acquire(const std::atomic<bool>& aborted);
+  static void release();
+
+  // Notifies the requests waiting in acquire() that one of them
+  // could be aborted.
+  static void wakeUp();
+};
+
+// Takes a slot for the lifetime of the object.
+class HttpInFlightSlot {
+public:
+  explicit HttpInFlightSlot(const std::atomic<bool>& aborted)
+    : m_acquired(HttpInFlight::acquire(aborted)) { }
+  ~HttpInFlightSlot() {
+    if (m_acquired)
+      HttpInFlight::release();
+  }
+  bool acquired() const { return m_acquired; }
+
+private:
+  bool m_acquired;
+};
+
+} // namespace net
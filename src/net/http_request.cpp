@@ -11,20 +11,74 @@
 #include "net/http_request.h"
 
 #include "base/debug.h"
+#include "net/http_in_flight.h"
 #include "net/http_response.h"
 
 #if __has_include(<curl/curl.h>)
 
 #include <curl/curl.h>
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 namespace net {
 
+namespace {
+
+// Idle curl handles. Each handle keeps its open connections (and
+// DNS/TLS session caches) after a request, so reusing them avoids
+// the connection setup of the next requests to the same hosts.
+class CurlPool {
+public:
+  static constexpr std::size_t kMaxIdle = HttpInFlight::kDefaultLimit;
+
+  ~CurlPool() {
+    for (CURL* curl : m_idle)
+      curl_easy_cleanup(curl);
+  }
+
+  CURL* acquire() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_idle.empty()) {
+        CURL* curl = m_idle.back();
+        m_idle.pop_back();
+        // Resets the options but keeps the connections
+        curl_easy_reset(curl);
+        return curl;
+      }
+    }
+    return curl_easy_init();
+  }
+
+  void release(CURL* curl) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_idle.size() < kMaxIdle) {
+        m_idle.push_back(curl);
+        return;
+      }
+    }
+    curl_easy_cleanup(curl);
+  }
+
+private:
+  std::mutex m_mutex;
+  std::vector<CURL*> m_idle;
+};
+
+CurlPool curlPool;
+
+} // anonymous namespace
+
 class HttpRequestImpl {
 public:
   HttpRequestImpl(const std::string& url)
-    : m_curl(curl_easy_init())
+    : m_curl(curlPool.acquire())
     , m_headerlist(nullptr)
-    , m_response(nullptr) {
+    , m_response(nullptr)
+    , m_aborted(false) {
 #ifdef ANDROID
     curl_easy_setopt(m_curl,  CURLOPT_SSL_VERIFYPEER, 0);
 #endif
@@ -33,14 +87,22 @@ public:
     curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, &HttpRequestImpl::writeBodyCallback);
     curl_easy_setopt(m_curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(m_curl, CURLOPT_NOSIGNAL, 1);
-    curl_easy_setopt(m_curl, CURLOPT_NOPROGRESS, 1L);
+    curl_easy_setopt(m_curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    // The progress callback is used to cancel the transfer
+    curl_easy_setopt(m_curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(m_curl, CURLOPT_XFERINFODATA, this);
+    curl_easy_setopt(m_curl, CURLOPT_XFERINFOFUNCTION, &HttpRequestImpl::progressCallback);
   }
 
   ~HttpRequestImpl() {
     if (m_headerlist)
       curl_slist_free_all(m_headerlist);
 
-    curl_easy_cleanup(m_curl);
+    // An aborted transfer can leave the connection in any state
+    if (m_aborted)
+      curl_easy_cleanup(m_curl);
+    else
+      curlPool.release(m_curl);
   }
 
   void setPostBody(const std::string& body) {
@@ -67,6 +129,10 @@ public:
   }
 
   bool send(HttpResponse& response) {
+    HttpInFlightSlot slot(m_aborted);
+    if (!slot.acquired())
+      return false;
+
     m_response = &response;
     int res = curl_easy_perform(m_curl);
     if (res != CURLE_OK)
@@ -78,14 +144,17 @@ public:
     return true;
   }
 
+  // Can be called from other threads
   void abort() {
-    curl_easy_setopt(m_curl, CURLOPT_TIMEOUT_MS, 1);
-    curl_easy_setopt(m_curl, CURLOPT_CONNECTTIMEOUT_MS, 1);
+    m_aborted = true;
+    HttpInFlight::wakeUp();
   }
 
 private:
   std::size_t writeBody(char* ptr, std::size_t bytes) {
     ASSERT(m_response != NULL);
+    if (m_aborted)
+      return 0;                 // Stops the transfer
     m_response->write(ptr, bytes);
     return bytes;
   }
@@ -95,10 +164,16 @@ private:
     return req->writeBody(ptr, size*nmemb);
   }
 
+  static int progressCallback(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    HttpRequestImpl* req = reinterpret_cast<HttpRequestImpl*>(userdata);
+    return (req->m_aborted ? 1: 0);
+  }
+
   CURL* m_curl;
   curl_slist* m_headerlist;
   HttpResponse* m_response;
   std::string m_body;
+  std::atomic<bool> m_aborted;
 };
 
 HttpRequest::HttpRequest(const std::string& url) : m_impl{new HttpRequestImpl(url)} {}
@@ -12,12 +12,14 @@
 #include "net/http_request.h"
 
 #include "base/debug.h"
-#include "net/http_response.h"
+#include "net/http_in_flight.h"
 #include "net/http_response.h"
 
 #include <emscripten/emscripten.h>
-#include <thread>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <thread>
 
 namespace net {
 
@@ -26,7 +28,21 @@ class HttpRequestImpl {
   std::string m_body;
   std::string m_headers;
   bool m_isPOST{};
-  bool cancelled{};
+  std::atomic<bool> m_aborted{false};
+
+  // Shared with the JavaScript side (all fields are pointer-sized).
+  // It's allocated with malloc() because when the request is
+  // aborted, the fetch() callback frees it (with the response).
+  struct Args {
+    const char* url;
+    const char* body;
+    uintptr_t bodySize;
+    const char* headers;
+    char* response;
+    uintptr_t responseSize;
+    uintptr_t statusCode;
+    uintptr_t abandoned;
+  };
 
   public:
   HttpRequestImpl(const std::string& url) : m_url{url} {}
@@ -48,15 +64,14 @@ class HttpRequestImpl {
   }
 
   bool send(HttpResponse& response) {
-    struct {
-      const char* url;
-      const char* body;
-      uintptr_t bodySize;
-      const char* headers;
-      char* response;
-      uintptr_t responseSize;
-      uintptr_t statusCode;
-    } args {
+    HttpInFlightSlot slot(m_aborted);
+    if (!slot.acquired())
+      return false;
+
+    // The strings are copied to the JavaScript side before fetch()
+    // starts, so they can be destroyed if the request is abandoned.
+    auto args = static_cast<Args*>(malloc(sizeof(Args)));
+    *args = Args{
       m_url.c_str(), // url
       m_body.c_str(), // body
       m_body.size(), // bodySize
@@ -64,10 +79,11 @@ class HttpRequestImpl {
       nullptr, // response
       0, // responseSize
       ~uintptr_t{}, // statusCode
+      0, // abandoned
     };
 
     MAIN_THREAD_EM_ASM({
-	const index = 'url,body,bodySize,headers,response,responseSize,statusCode,callbackArg,callback'.split(',');
+	const index = 'url,body,bodySize,headers,response,responseSize,statusCode,abandoned'.split(',');
 	const HEAP32 = GROWABLE_HEAP_U32();
 	const HEAP8 = GROWABLE_HEAP_U8();
 
@@ -97,42 +113,67 @@ class HttpRequestImpl {
 	      parsedHeaders[arr[0].trim()] = arr[1].trim();
 	  });
 
+	// The browser keeps the connections alive and reuses them
+	let status = 400;
 	fetch(url, {
 	  method: isPOST ? 'POST' : 'GET',
 	  mode: 'cors',
 	  headers: parsedHeaders,
 	  body
 	  })
-	  .then(response => response.arrayBuffer())
+	  .then(response => {
+	      status = response.status;
+	      return response.arrayBuffer();
+	    })
 	  .then(buffer => {
+	      if (get('abandoned')) {
+		_free($0);
+		return;
+	      }
 	      const arr = new Uint8Array(buffer);
 	      const raw = _malloc(arr.length);
-	      for (let i = 0; i < arr.length; ++i)
-		HEAP8[raw + i] = arr[i];
+	      GROWABLE_HEAP_U8().set(arr, raw);
 	      set('response', raw);
 	      set('responseSize', arr.length);
-	      set('statusCode', 200);
+	      set('statusCode', status);
 	    })
 	  .catch(ex => {
-	      set('statusCode', 400);
+	      if (get('abandoned'))
+		_free($0);
+	      else
+		set('statusCode', 400);
 	    });
-      }, &args, sizeof(uintptr_t), m_isPOST);
-
-    while (args.statusCode == ~uintptr_t{}) {
+      }, args, sizeof(uintptr_t), m_isPOST);
+
+    while (args->statusCode == ~uintptr_t{}) {
+      if (m_aborted) {
+	// The fetch() callback will free the arguments (unless it
+	// finished just now)
+	args->abandoned = 1;
+	if (args->statusCode != ~uintptr_t{}) {
+	  free(args->response);
+	  free(args);
+	}
+	return false;
+      }
       using namespace std::chrono_literals;
       std::this_thread::sleep_for(30ms);
     }
 
-    response.setStatus(args.statusCode);
-    if (!args.response)
-      return false;
-    response.write(args.response, args.responseSize);
-    free(args.response);
-    return true;
+    bool ok = (args->response != nullptr);
+    response.setStatus(args->statusCode);
+    if (ok) {
+      response.write(args->response, args->responseSize);
+      free(args->response);
+    }
+    free(args);
+    return ok;
   }
 
+  // Can be called from other threads
   void abort() {
-    cancelled = true;
+    m_aborted = true;
+    HttpInFlight::wakeUp();
   }
 };
 
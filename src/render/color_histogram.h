@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <limits>
 #include <vector>
 
@@ -33,45 +34,89 @@ namespace render {
       AElements = 1 << ABits
     };
 
+    // A non-empty bin of the histogram
+    struct Bin {
+      uint32_t index;           // See histogramIndex()
+      std::size_t count;
+
+      int r() const { return index & (RElements-1); }
+      int g() const { return (index >> RBits) & (GElements-1); }
+      int b() const { return (index >> (RBits+GBits)) & (BElements-1); }
+      int a() const { return (index >> (RBits+GBits+BBits)) & (AElements-1); }
+    };
+
+    typedef typename std::vector<Bin>::const_iterator const_iterator;
+
     ColorHistogram()
-      : m_histogram(RElements*GElements*BElements*AElements, 0)
+      : m_highPrecisionTable(kHighPrecisionTableSize, kEmptyEntry)
       , m_useHighPrecision(true) {
+      clear();
     }
 
+    // Removes all samples (the memory used by the bins is kept to
+    // add new samples).
+    void clear() {
+      m_bins.clear();
+      m_table.assign(kInitialTableSize, kEmptyBin);
+      m_lastIndex = kEmptyBin;
+      m_lastBin = 0;
+
+      m_highPrecision.clear();
+      std::fill(m_highPrecisionTable.begin(), m_highPrecisionTable.end(), kEmptyEntry);
+      m_useHighPrecision = true;
+    }
+
+    // Number of non-empty bins
+    std::size_t size() const { return m_bins.size(); }
+    bool empty() const { return m_bins.empty(); }
+
+    // Iterates the non-empty bins (in the order that they were
+    // added to the histogram).
+    const_iterator begin() const { return m_bins.begin(); }
+    const_iterator end() const { return m_bins.end(); }
+
     // Returns the number of points in the specified histogram
     // entry. Each rgba-index is in the range of the histogram, e.g.
     // r=[0,RElements), g=[0,GElements), etc.
     std::size_t at(int r, int g, int b, int a) const {
-      return m_histogram[histogramIndex(r, g, b, a)];
+      const uint32_t index = histogramIndex(r, g, b, a);
+      const uint32_t bin = m_table[findSlot(index)];
+      return (bin != kEmptyBin ? m_bins[bin].count: 0);
     }
 
     // Add the specified "color" in the histogram as many times as the
     // specified value in "count".
     void addSamples(doc::color_t color, std::size_t count = 1) {
-      int i = histogramIndex(color);
-
-      if (m_histogram[i] < std::numeric_limits<std::size_t>::max()-count) // Avoid overflow
-        m_histogram[i] += count;
-      else
-        m_histogram[i] = std::numeric_limits<std::size_t>::max();
+      addCount(histogramIndex(color), count);
 
       // Accurate colors are used only for less than 256 colors.  If the
-      // image has more than 256 colors the m_histogram is used
+      // image has more than 256 colors the bins are used
       // instead.
-      if (m_useHighPrecision) {
-        std::vector<doc::color_t>::iterator it =
-          std::find(m_highPrecision.begin(), m_highPrecision.end(), color);
-
-        // The color is not in the high-precision table
-        if (it == m_highPrecision.end()) {
-          if (m_highPrecision.size() < 256) {
-            m_highPrecision.push_back(color);
-          }
-          else {
-            // In this case we reach the limit for the high-precision histogram.
-            m_useHighPrecision = false;
-          }
-        }
+      if (m_useHighPrecision)
+        addHighPrecision(color);
+    }
+
+    // Adds the samples of other histogram (e.g. one calculated in
+    // other thread). The result is the same as adding the samples of
+    // "other" after the samples of this histogram. Only the non-empty
+    // bins of "other" are visited.
+    void merge(const ColorHistogram& other) {
+      for (const Bin& bin : other.m_bins)
+        addCount(bin.index, bin.count);
+
+      if (!other.m_useHighPrecision)
+        m_useHighPrecision = false;
+
+      for (std::size_t i=0; i<other.m_highPrecision.size() && m_useHighPrecision; ++i)
+        addHighPrecision(other.m_highPrecision[i]);
+    }
+
+    // Fills "points" with the non-empty bins (used by median_cut()).
+    void getPoints(HistogramPoints& points) const {
+      points.resize(m_bins.size());
+      for (std::size_t i=0; i<m_bins.size(); ++i) {
+        const Bin& bin = m_bins[i];
+        points[i] = HistogramPoint{ bin.r(), bin.g(), bin.b(), bin.a(), bin.count };
       }
     }
 
@@ -101,17 +146,88 @@ namespace render {
     }
 
   private:
+    // Size of the hash table to find colors in m_highPrecision (twice
+    // the maximum number of colors)
+    enum { kHighPrecisionTableSize = 512 };
+    static constexpr uint64_t kEmptyEntry = uint64_t(-1);
+
+    // Initial size of the hash table of bins (it grows when it's half
+    // full)
+    enum { kInitialTableSize = 1024 };
+    static constexpr uint32_t kEmptyBin = uint32_t(-1);
+
+    // Position of the given bin in the m_table (or the empty slot
+    // where it should be added)
+    std::size_t findSlot(uint32_t index) const {
+      const std::size_t mask = m_table.size()-1;
+      std::size_t i = (index * 2654435761u) & mask;
+      for (; m_table[i] != kEmptyBin; i = (i+1) & mask) {
+        if (m_bins[m_table[i]].index == index)
+          break;
+      }
+      return i;
+    }
+
+    void addCount(uint32_t index, std::size_t count) {
+      // Consecutive samples of the same color are common (e.g. flat
+      // areas in images)
+      if (index != m_lastIndex) {
+        const std::size_t slot = findSlot(index);
+        if (m_table[slot] == kEmptyBin) {
+          m_lastBin = uint32_t(m_bins.size());
+          m_table[slot] = m_lastBin;
+          m_bins.push_back(Bin{ index, 0 });
+          if (2*m_bins.size() > m_table.size())
+            growTable();
+        }
+        else
+          m_lastBin = m_table[slot];
+        m_lastIndex = index;
+      }
+
+      std::size_t& value = m_bins[m_lastBin].count;
+      if (value < std::numeric_limits<std::size_t>::max()-count) // Avoid overflow
+        value += count;
+      else
+        value = std::numeric_limits<std::size_t>::max();
+    }
+
+    void growTable() {
+      m_table.assign(2*m_table.size(), kEmptyBin);
+      for (std::size_t i=0; i<m_bins.size(); ++i)
+        m_table[findSlot(m_bins[i].index)] = uint32_t(i);
+    }
+
+    void addHighPrecision(doc::color_t color) {
+      std::size_t i = ((color * 2654435761u) >> 23) & (kHighPrecisionTableSize-1);
+      for (; m_highPrecisionTable[i] != kEmptyEntry;
+           i = (i+1) & (kHighPrecisionTableSize-1)) {
+        // The color is already in the high-precision table
+        if (m_highPrecisionTable[i] == color)
+          return;
+      }
+
+      if (m_highPrecision.size() < 256) {
+        m_highPrecision.push_back(color);
+        m_highPrecisionTable[i] = color;
+      }
+      else {
+        // In this case we reach the limit for the high-precision histogram.
+        m_useHighPrecision = false;
+      }
+    }
+
     // Converts input color in a index for the histogram. It reduces
     // each 8-bit component to the resolution given in the template
     // parameters.
-    std::size_t histogramIndex(doc::color_t color) const {
+    static uint32_t histogramIndex(doc::color_t color) {
       return histogramIndex((rgba_getr(color) >> (8 - RBits)),
                             (rgba_getg(color) >> (8 - GBits)),
                             (rgba_getb(color) >> (8 - BBits)),
                             (rgba_geta(color) >> (8 - ABits)));
     }
 
-    std::size_t histogramIndex(int r, int g, int b, int a) const {
+    static uint32_t histogramIndex(int r, int g, int b, int a) {
       return
         r
         | (g << RBits)
@@ -119,13 +235,25 @@ namespace render {
         | (a << (RBits+GBits+BBits));
     }
 
-    // 3D histogram (the index in the histogram is calculated through histogramIndex() function).
-    std::vector<std::size_t> m_histogram;
+    // Non-empty bins of the histogram (the index of each bin is
+    // calculated through histogramIndex() function)
+    std::vector<Bin> m_bins;
+
+    // Hash table (open addressing) with the position of each bin in
+    // m_bins (or kEmptyBin)
+    std::vector<uint32_t> m_table;
+
+    // Last bin that was modified in addCount()
+    uint32_t m_lastIndex;
+    uint32_t m_lastBin;
 
     // High precision histogram to create an accurate palette if RGB
     // source images contains less than 256 colors.
     std::vector<doc::color_t> m_highPrecision;
 
+    // Hash table (open addressing) with the colors of m_highPrecision
+    std::vector<uint64_t> m_highPrecisionTable;
+
     // True if we can use m_highPrecision still (it means that the
     // number of different samples is less than 256 colors still).
     bool m_useHighPrecision;
@@ -0,0 +1,78 @@
+// LibreSprite Render Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "render/color_histogram.h"
+
+#include <random>
+
+using namespace doc;
+using namespace render;
+
+typedef ColorHistogram<5, 6, 5, 5> Histogram;
+
+TEST(ColorHistogram, Bins)
+{
+  Histogram h;
+  EXPECT_TRUE(h.empty());
+
+  h.addSamples(rgba(255, 0, 0, 255), 3);
+  h.addSamples(rgba(250, 1, 2, 255));   // Same bin as the previous color
+  h.addSamples(rgba(0, 0, 255, 255), 2);
+
+  EXPECT_EQ(2, int(h.size()));
+  EXPECT_EQ(4, int(h.at(31, 0, 0, 31)));
+  EXPECT_EQ(2, int(h.at(0, 0, 31, 31)));
+  EXPECT_EQ(0, int(h.at(0, 0, 0, 0)));
+
+  auto it = h.begin();
+  EXPECT_EQ(31, it->r());
+  EXPECT_EQ(0, it->b());
+  EXPECT_EQ(4, int(it->count));
+  ++it;
+  EXPECT_EQ(31, it->b());
+  EXPECT_EQ(2, int(it->count));
+
+  h.clear();
+  EXPECT_TRUE(h.empty());
+  EXPECT_EQ(0, int(h.at(31, 0, 0, 31)));
+}
+
+TEST(ColorHistogram, Merge)
+{
+  std::mt19937 rnd(1);
+  Histogram all, part1, part2;
+
+  // Enough colors to grow the hash table several times
+  for (int i=0; i<50000; ++i) {
+    color_t c = rgba(rnd() % 256, rnd() % 256, rnd() % 256, 255);
+    all.addSamples(c);
+    (i < 20000 ? part1: part2).addSamples(c);
+  }
+  part1.merge(part2);
+
+  ASSERT_EQ(all.size(), part1.size());
+  for (const auto& bin : all)
+    EXPECT_EQ(bin.count, part1.at(bin.r(), bin.g(), bin.b(), bin.a()));
+
+  auto palette1 = Palette::create(256);
+  auto palette2 = Palette::create(256);
+  EXPECT_EQ(all.createOptimizedPalette(*palette1),
+            part1.createOptimizedPalette(*palette2));
+  for (int i=0; i<palette1->size(); ++i)
+    EXPECT_EQ(palette1->getEntry(i), palette2->getEntry(i));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
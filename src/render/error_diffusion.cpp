@@ -0,0 +1,208 @@
+// LibreSprite Render Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/error_diffusion.h"
+
+#include "base/base.h"
+#include "base/thread_pool.h"
+#include "doc/image.h"
+#include "doc/image_traits.h"
+#include "doc/palette.h"
+#include "doc/rgbmap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace render {
+
+using namespace doc;
+
+namespace {
+
+// Part of the error of a pixel that goes to the pixel at (x+dx, y+dy)
+struct Weight {
+  int dx, dy, w;
+};
+
+struct Kernel {
+  const Weight* weights;
+  int count;
+  int div;
+};
+
+const Weight kFloydSteinberg[] = {
+                { 1, 0, 7 },
+  { -1, 1, 3 }, { 0, 1, 5 }, { 1, 1, 1 }
+};
+
+// Atkinson spreads only 6/8 of the error (the result has more
+// contrast than Floyd-Steinberg)
+const Weight kAtkinson[] = {
+                { 1, 0, 1 }, { 2, 0, 1 },
+  { -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 },
+                { 0, 2, 1 }
+};
+
+// Rows of errors in memory (the current one and the next two rows,
+// as the kernels reach y+2 at most). Each row uses the memory of the
+// row that is three rows above, which is cleared as it is read.
+const int kErrorRows = 3;
+
+// Extra columns at both sides of each row of errors, so pixels at
+// the edges can spread their errors without checking bounds.
+const int kPadding = 2;
+
+// Pixels of each tile (the progress of each row is known by tiles)
+const int kTileWidth = 64;
+
+const Kernel& get_kernel(DitheringMethod method)
+{
+  static const Kernel floydSteinberg = {
+    kFloydSteinberg, int(sizeof(kFloydSteinberg) / sizeof(Weight)), 16 };
+  static const Kernel atkinson = {
+    kAtkinson, int(sizeof(kAtkinson) / sizeof(Weight)), 8 };
+
+  ASSERT(method == DitheringMethod::FLOYD_STEINBERG ||
+         method == DitheringMethod::ATKINSON);
+  return (method == DitheringMethod::ATKINSON ? atkinson: floydSteinberg);
+}
+
+// Rounded division (half away from zero, so positive and negative
+// errors are treated in the same way)
+inline int div_round(int value, int div)
+{
+  return (value >= 0 ? (value + div/2) / div:
+                       -((div/2 - value) / div));
+}
+
+} // anonymous namespace
+
+ErrorDiffusionDither::ErrorDiffusionDither(DitheringMethod method,
+                                           int transparentIndex)
+  : m_method(method)
+  , m_transparentIndex(transparentIndex)
+{
+}
+
+void ErrorDiffusionDither::ditherRgbImageToIndexed(
+  const Image* srcImage,
+  Image* dstImage,
+  const RgbMap* rgbmap,
+  const Palette* palette,
+  bool parallel) const
+{
+  ASSERT(srcImage->pixelFormat() == IMAGE_RGB);
+  ASSERT(dstImage->pixelFormat() == IMAGE_INDEXED);
+  ASSERT(srcImage->width() == dstImage->width() &&
+         srcImage->height() == dstImage->height());
+
+  const Kernel& kernel = get_kernel(m_method);
+  const int w = srcImage->width();
+  const int h = srcImage->height();
+  const int tiles = (w + kTileWidth - 1) / kTileWidth;
+  if (w == 0 || h == 0)
+    return;
+
+  // Accumulated errors (multiplied by kernel.div) of the RGB
+  // components of each pixel
+  const int rowSize = 3*(w + 2*kPadding);
+  std::vector<int> errors(kErrorRows*rowSize, 0);
+  auto errorsAt = [&errors, rowSize](int x, int y) {
+    return &errors[(y % kErrorRows)*rowSize + 3*(x + kPadding)];
+  };
+
+  // Number of tiles converted in each row
+  std::vector<std::atomic<int>> progress(h);
+  std::atomic<int> nextRow(0);
+
+  auto convertTile = [&](int y, int x1, int x2) {
+    auto src = (const RgbTraits::pixel_t*)srcImage->getPixelAddress(0, y);
+    auto dst = (IndexedTraits::pixel_t*)dstImage->getPixelAddress(0, y);
+
+    for (int x=x1; x<x2; ++x) {
+      int* e = errorsAt(x, y);
+      const color_t c = src[x];
+      const int a = rgba_geta(c);
+
+      // Transparent pixels don't get (or spread) any error
+      if (a == 0) {
+        e[0] = e[1] = e[2] = 0;
+        if (m_transparentIndex >= 0)
+          dst[x] = m_transparentIndex;
+        else
+          dst[x] = (rgbmap ? rgbmap->mapColor(rgba_getr(c), rgba_getg(c), rgba_getb(c), 0):
+                             palette->findBestfit(rgba_getr(c), rgba_getg(c), rgba_getb(c), 0,
+                                                  m_transparentIndex));
+        continue;
+      }
+
+      const int r = MID(0, rgba_getr(c) + div_round(e[0], kernel.div), 255);
+      const int g = MID(0, rgba_getg(c) + div_round(e[1], kernel.div), 255);
+      const int b = MID(0, rgba_getb(c) + div_round(e[2], kernel.div), 255);
+      e[0] = e[1] = e[2] = 0;
+
+      const int index =
+        (rgbmap ? rgbmap->mapColor(r, g, b, a):
+                  palette->findBestfit(r, g, b, a, m_transparentIndex));
+      dst[x] = index;
+
+      const color_t p = palette->getEntry(index);
+      const int er = r - int(rgba_getr(p));
+      const int eg = g - int(rgba_getg(p));
+      const int eb = b - int(rgba_getb(p));
+      if (er == 0 && eg == 0 && eb == 0)
+        continue;
+
+      for (int i=0; i<kernel.count; ++i) {
+        const Weight& k = kernel.weights[i];
+        if (y+k.dy >= h)
+          continue;
+
+        int* t = errorsAt(x+k.dx, y+k.dy);
+        t[0] += er * k.w;
+        t[1] += eg * k.w;
+        t[2] += eb * k.w;
+      }
+    }
+  };
+
+  // Each thread converts the next row that wasn't taken, so the row
+  // it waits for is always being converted by other thread.
+  auto convertRows = [&](int) {
+    int y;
+    while ((y = nextRow++) < h) {
+      for (int t=0; t<tiles; ++t) {
+        // The previous row must be one tile ahead, so every error
+        // that goes to this tile was already spread.
+        if (y > 0) {
+          const int needed = std::min(tiles, t+2);
+          while (progress[y-1].load(std::memory_order_acquire) < needed)
+            std::this_thread::yield();
+        }
+
+        convertTile(y, t*kTileWidth, std::min(w, (t+1)*kTileWidth));
+        progress[y].store(t+1, std::memory_order_release);
+      }
+    }
+  };
+
+  int threads = 1;
+  if (parallel && (!rgbmap || rgbmap->isCalculated()))
+    threads = std::min(base::thread_pool::instance().concurrency(), h);
+
+  if (threads > 1)
+    base::thread_pool::instance().parallel_for(threads, convertRows);
+  else
+    convertRows(0);
+}
+
+} // namespace render
@@ -0,0 +1,45 @@
+// LibreSprite Render Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "doc/dithering_method.h"
+
+namespace doc {
+  class Image;
+  class Palette;
+  class RgbMap;
+}
+
+namespace render {
+
+  // Converts RGB images to indexed spreading the quantization error
+  // of each pixel to its neighbors (Floyd-Steinberg or Atkinson).
+  //
+  // The image is processed in tiles of rows: a tile can be converted
+  // when the previous row is a little ahead of it, so several rows
+  // are converted at the same time (a wavefront). The result is the
+  // same with any number of threads.
+  class ErrorDiffusionDither {
+  public:
+    ErrorDiffusionDither(doc::DitheringMethod method,
+                         int transparentIndex = -1);
+
+    // Several threads are used if "parallel" is true and the
+    // "rgbmap" is NULL or it's already calculated
+    // (RgbMap::isCalculated()).
+    void ditherRgbImageToIndexed(const doc::Image* srcImage,
+                                 doc::Image* dstImage,
+                                 const doc::RgbMap* rgbmap,
+                                 const doc::Palette* palette,
+                                 bool parallel = true) const;
+
+  private:
+    doc::DitheringMethod m_method;
+    int m_transparentIndex;
+  };
+
+} // namespace render
@@ -0,0 +1,105 @@
+// LibreSprite Render Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/rgbmap.h"
+#include "render/error_diffusion.h"
+
+#include <memory>
+
+using namespace doc;
+using namespace render;
+
+namespace {
+
+std::shared_ptr<Palette> black_and_white()
+{
+  auto palette = Palette::create(2);
+  palette->setEntry(0, rgba(0, 0, 0, 255));
+  palette->setEntry(1, rgba(255, 255, 255, 255));
+  return palette;
+}
+
+} // anonymous namespace
+
+TEST(ErrorDiffusion, ExactColors)
+{
+  auto palette = black_and_white();
+  RgbMap rgbmap;
+  rgbmap.regenerate(palette.get(), -1);
+
+  std::unique_ptr<Image> src(Image::create(IMAGE_RGB, 100, 50));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_INDEXED, 100, 50));
+  for (int y=0; y<src->height(); ++y)
+    for (int x=0; x<src->width(); ++x)
+      put_pixel(src.get(), x, y, ((x/3 + y) & 1 ? rgba(255, 255, 255, 255):
+                                                  rgba(0, 0, 0, 255)));
+
+  for (auto method : { DitheringMethod::FLOYD_STEINBERG,
+                       DitheringMethod::ATKINSON }) {
+    ErrorDiffusionDither(method).ditherRgbImageToIndexed(
+      src.get(), dst.get(), &rgbmap, palette.get());
+
+    for (int y=0; y<src->height(); ++y)
+      for (int x=0; x<src->width(); ++x)
+        EXPECT_EQ((x/3 + y) & 1, int(get_pixel(dst.get(), x, y)));
+  }
+}
+
+TEST(ErrorDiffusion, FloydSteinbergKeepsAverage)
+{
+  auto palette = black_and_white();
+  RgbMap rgbmap;
+  rgbmap.regenerate(palette.get(), -1);
+  rgbmap.calculateAll();
+
+  // Big enough to be converted in several tiles
+  std::unique_ptr<Image> src(Image::create(IMAGE_RGB, 300, 200));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_INDEXED, 300, 200));
+
+  for (int gray : { 64, 128, 192 }) {
+    clear_image(src.get(), rgba(gray, gray, gray, 255));
+    ErrorDiffusionDither(DitheringMethod::FLOYD_STEINBERG)
+      .ditherRgbImageToIndexed(src.get(), dst.get(), &rgbmap, palette.get());
+
+    int white = 0;
+    for (int y=0; y<dst->height(); ++y)
+      for (int x=0; x<dst->width(); ++x)
+        white += get_pixel(dst.get(), x, y);
+
+    const int pixels = dst->width() * dst->height();
+    EXPECT_NEAR(gray * pixels / 255, white, pixels / 100) << "gray " << gray;
+  }
+}
+
+TEST(ErrorDiffusion, TransparentPixels)
+{
+  auto palette = black_and_white();
+  std::unique_ptr<Image> src(Image::create(IMAGE_RGB, 16, 16));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_INDEXED, 16, 16));
+  clear_image(src.get(), rgba(128, 128, 128, 0));
+
+  ErrorDiffusionDither(DitheringMethod::ATKINSON, 1)
+    .ditherRgbImageToIndexed(src.get(), dst.get(), nullptr, palette.get());
+
+  for (int y=0; y<dst->height(); ++y)
+    for (int x=0; x<dst->width(); ++x)
+      EXPECT_EQ(1, int(get_pixel(dst.get(), x, y)));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -8,126 +8,140 @@
 
 #include "doc/color.h"
 
-#include <list>
+#include <algorithm>
 #include <queue>
+#include <vector>
 
 namespace render {
 
+  // A non-empty entry of a color histogram (the components are in
+  // the resolution of the histogram).
+  struct HistogramPoint {
+    int r, g, b, a;
+    std::size_t count;
+  };
+
+  typedef std::vector<HistogramPoint> HistogramPoints;
+
+  // Each box encloses the points of a contiguous range of the
+  // HistogramPoints vector, so only its points are visited to shrink
+  // or split it (instead of its whole volume in the histogram).
   template<class Histogram>
   class Box {
 
-    // These classes are used as parameters for some Box's generic
-    // member functions, so we can access to a different axis using
-    // the same generic function (i=Red channel in RAxisGetter, etc.).
-    struct RAxisGetter { static std::size_t at(const Histogram& h, int i, int j, int k, int l) { return h.at(i, j, k, l); } };
-    struct GAxisGetter { static std::size_t at(const Histogram& h, int i, int j, int k, int l) { return h.at(j, i, k, l); } };
-    struct BAxisGetter { static std::size_t at(const Histogram& h, int i, int j, int k, int l) { return h.at(j, k, i, l); } };
-    struct AAxisGetter { static std::size_t at(const Histogram& h, int i, int j, int k, int l) { return h.at(j, k, l, i); } };
-
     // These classes are used as template parameter to split a Box
     // along an axis (see splitAlongAxis)
     struct RAxisSplitter {
       static Box box1(const Box& box, int r) { return Box(box.r1, box.g1, box.b1, box.a1, r,      box.g2, box.b2, box.a2); }
       static Box box2(const Box& box, int r) { return Box(r,      box.g1, box.b1, box.a1, box.r2, box.g2, box.b2, box.a2); }
+      static int component(const HistogramPoint& p) { return p.r; }
     };
     struct GAxisSplitter {
       static Box box1(const Box& box, int g) { return Box(box.r1, box.g1, box.b1, box.a1, box.r2, g,      box.b2, box.a2); }
       static Box box2(const Box& box, int g) { return Box(box.r1, g,      box.b1, box.a1, box.r2, box.g2, box.b2, box.a2); }
+      static int component(const HistogramPoint& p) { return p.g; }
     };
     struct BAxisSplitter {
       static Box box1(const Box& box, int b) { return Box(box.r1, box.g1, box.b1, box.a1, box.r2, box.g2, b,      box.a2); }
       static Box box2(const Box& box, int b) { return Box(box.r1, box.g1, b,      box.a1, box.r2, box.g2, box.b2, box.a2); }
+      static int component(const HistogramPoint& p) { return p.b; }
     };
     struct AAxisSplitter {
       static Box box1(const Box& box, int a) { return Box(box.r1, box.g1, box.b1, box.a1, box.r2, box.g2, box.b2, a     ); }
       static Box box2(const Box& box, int a) { return Box(box.r1, box.g1, box.b1, a,      box.r2, box.g2, box.b2, box.a2); }
+      static int component(const HistogramPoint& p) { return p.a; }
     };
 
   public:
     Box(int r1, int g1, int b1, int a1,
-        int r2, int g2, int b2, int a2)
+        int r2, int g2, int b2, int a2,
+        std::size_t first = 0, std::size_t last = 0)
       : r1(r1), g1(g1), b1(b1), a1(a1)
       , r2(r2), g2(g2), b2(b2), a2(a2)
+      , first(first), last(last)
       , points(0)
       , volume(calculateVolume()) {
     }
 
+    // Number of points in each plane of the box along each axis. They
+    // are calculated once in shrink() and used to split the box (so
+    // the points are not visited again for each axis).
+    struct Planes {
+      std::size_t r[Histogram::RElements];
+      std::size_t g[Histogram::GElements];
+      std::size_t b[Histogram::BElements];
+      std::size_t a[Histogram::AElements];
+    };
+
     // Shrinks each plane of the box to a position where there are
     // points in the histogram.
-    void shrink(const Histogram& histogram) {
-      axisShrink<RAxisGetter>(histogram, r1, r2, g1, g2, b1, b2, a1, a2);
-      axisShrink<GAxisGetter>(histogram, g1, g2, r1, r2, b1, b2, a1, a2);
-      axisShrink<BAxisGetter>(histogram, b1, b2, r1, r2, g1, g2, a1, a2);
-      axisShrink<AAxisGetter>(histogram, a1, a2, r1, r2, g1, g2, b1, b2);
+    void shrink(const HistogramPoints& histogram, Planes& planes) {
+      countPlanes(histogram, planes);
 
-      // Calculate number of points inside the box (this is done by
-      // first time here, because the Box ctor didn't calculate it).
-      points = countPoints(histogram);
+      axisShrink(planes.r, r1, r2);
+      axisShrink(planes.g, g1, g2);
+      axisShrink(planes.b, b1, b2);
+      axisShrink(planes.a, a1, a2);
 
       // Recalculate the volume (used in operator<).
       volume = calculateVolume();
     }
 
-    bool split(const Histogram& histogram, std::priority_queue<Box>& boxes) const {
+    // Splits the box (after shrink()) in two sub-boxes. The points of
+    // the box are partitioned between both sub-boxes.
+    bool split(const Planes& planes, HistogramPoints& histogram,
+               std::priority_queue<Box>& boxes) const {
       // Split along the largest dimension of the box.
       if ((r2-r1) >= (g2-g1) &&
           (r2-r1) >= (b2-b1) &&
           (r2-r1) >= (a2-a1)) {
-        return splitAlongAxis<RAxisGetter, RAxisSplitter>(histogram, boxes, r1, r2, g1, g2, b1, b2, a1, a2);
+        return splitAlongAxis<RAxisSplitter>(planes.r, histogram, boxes, r1, r2);
       }
 
       if ((g2-g1) >= (r2-r1) &&
           (g2-g1) >= (b2-b1) &&
           (g2-g1) >= (a2-a1)) {
-        return splitAlongAxis<GAxisGetter, GAxisSplitter>(histogram, boxes, g1, g2, r1, r2, b1, b2, a1, a2);
+        return splitAlongAxis<GAxisSplitter>(planes.g, histogram, boxes, g1, g2);
       }
 
       if ((b2-b1) >= (r2-r1) &&
           (b2-b1) >= (g2-g1) &&
           (b2-b1) >= (a2-a1)) {
-        return splitAlongAxis<BAxisGetter, BAxisSplitter>(histogram, boxes, b1, b2, r1, r2, g1, g2, a1, a2);
+        return splitAlongAxis<BAxisSplitter>(planes.b, histogram, boxes, b1, b2);
       }
 
-      return splitAlongAxis<AAxisGetter, AAxisSplitter>(histogram, boxes, a1, a2, r1, r2, g1, g2, b1, b2);
+      return splitAlongAxis<AAxisSplitter>(planes.a, histogram, boxes, a1, a2);
     }
 
     // Returns the color enclosed by the box calculating the mean of
     // all histogram's points inside the box.
-    uint32_t meanColor(const Histogram& histogram) const {
+    uint32_t meanColor(const HistogramPoints& histogram) const {
       std::size_t r = 0, g = 0, b = 0, a = 0;
       std::size_t count = 0;
-      long i, j, k, l;
-
-      for (i=r1; i<=r2; ++i)
-        for (j=g1; j<=g2; ++j)
-          for (k=b1; k<=b2; ++k)
-            for (l=a1; l<=a2; ++l) {
-              int c = histogram.at(i, j, k, l);
-              r += static_cast<long>(c) * i;
-              g += static_cast<long>(c) * j;
-              b += static_cast<long>(c) * k;
-              a += static_cast<long>(c) * l;
-              count += c;
-            }
 
-      // No colors in the box? This should not be possible.
-      ASSERT(count > 0 && "Box without histogram points, you must fill the histogram before using this function.");
-      if (count == 0)
-        return doc::rgba(0, 0, 0, 255);
+      for (std::size_t i=first; i<last; ++i) {
+        const HistogramPoint& p = histogram[i];
+        r += p.count * p.r;
+        g += p.count * p.g;
+        b += p.count * p.b;
+        a += p.count * p.a;
+        count += p.count;
+      }
 
-      // Calculate the mean. We have to do this before the *255
-      // multiplication to avoid a 32-bit overflow. E.g. Alpha channel
-      // is the most proper to overflow the 32-bit capacity in case
-      // all pixels are opaque.
-      r /= count;
-      g /= count;
-      b /= count;
-      a /= count;
+      return meanColor(r, g, b, a, count);
+    }
 
-      return doc::rgba((255 * r / (Histogram::RElements-1)),
-                       (255 * g / (Histogram::GElements-1)),
-                       (255 * b / (Histogram::BElements-1)),
-                       (255 * a / (Histogram::AElements-1)));
+    // Same as meanColor(histogram) for a box after shrink().
+    uint32_t meanColor(const Planes& planes) const {
+      std::size_t r = 0, g = 0, b = 0, a = 0;
+      int i;
+
+      for (i=r1; i<=r2; ++i) r += planes.r[i] * i;
+      for (i=g1; i<=g2; ++i) g += planes.g[i] * i;
+      for (i=b1; i<=b2; ++i) b += planes.b[i] * i;
+      for (i=a1; i<=a2; ++i) a += planes.a[i] * i;
+
+      return meanColor(r, g, b, a, points);
     }
 
     // The boxes will be sort in the priority_queue by volume.
@@ -145,77 +159,76 @@ namespace render {
       return (r2-r1+1) * (g2-g1+1) * (b2-b1+1) * (a2-a1+1);
     }
 
-    // Returns the number of histogram's points inside the box bounds.
-    std::size_t countPoints(const Histogram& histogram) const {
-      std::size_t count = 0;
-      int i, j, k, l;
+    static uint32_t meanColor(std::size_t r, std::size_t g,
+                              std::size_t b, std::size_t a,
+                              std::size_t count) {
+      // No colors in the box? This should not be possible.
+      ASSERT(count > 0 && "Box without histogram points, you must fill the histogram before using this function.");
+      if (count == 0)
+        return doc::rgba(0, 0, 0, 255);
 
-      for (i=r1; i<=r2; ++i)
-        for (j=g1; j<=g2; ++j)
-          for (k=b1; k<=b2; ++k)
-            for (l=a1; l<=a2; ++l)
-              count += histogram.at(i, j, k, l);
+      // Calculate the mean. We have to do this before the *255
+      // multiplication to avoid a 32-bit overflow. E.g. Alpha channel
+      // is the most proper to overflow the 32-bit capacity in case
+      // all pixels are opaque.
+      r /= count;
+      g /= count;
+      b /= count;
+      a /= count;
 
-      return count;
+      return doc::rgba((255 * r / (Histogram::RElements-1)),
+                       (255 * g / (Histogram::GElements-1)),
+                       (255 * b / (Histogram::BElements-1)),
+                       (255 * a / (Histogram::AElements-1)));
     }
 
-    // Reduces the specified side of the box (i1/i2) along the
-    // specified axis (if AxisGetter is RAxisGetter, then i1=r1,
-    // i2=r2; if AxisGetter is GAxisGetter, then i1=g1, i2=g2).
-    template<class AxisGetter>
-    static void axisShrink(const Histogram& histogram,
-                           int& i1, int& i2,
-                           const int& j1, const int& j2,
-                           const int& k1, const int& k2,
-                           const int& l1, const int& l2)
-    {
-      int j, k, l;
-
-      // Shrink i1.
-      for (; i1<i2; ++i1) {
-        for (j=j1; j<=j2; ++j) {
-          for (k=k1; k<=k2; ++k) {
-            for (l=l1; l<=l2; ++l) {
-              if (AxisGetter::at(histogram, i1, j, k, l) > 0)
-                goto doneA;
-            }
-          }
-        }
-      }
-
-    doneA:;
-
-      for (; i2>i1; --i2) {
-        for (j=j1; j<=j2; ++j) {
-          for (k=k1; k<=k2; ++k) {
-            for (l=l1; l<=l2; ++l) {
-              if (AxisGetter::at(histogram, i2, j, k, l) > 0)
-                goto doneB;
-            }
-          }
-        }
+    // Calculates the number of points in each plane of the box (and
+    // the total number of points) with one pass over its points.
+    void countPlanes(const HistogramPoints& histogram, Planes& planes) {
+      std::fill(planes.r+r1, planes.r+r2+1, 0);
+      std::fill(planes.g+g1, planes.g+g2+1, 0);
+      std::fill(planes.b+b1, planes.b+b2+1, 0);
+      std::fill(planes.a+a1, planes.a+a2+1, 0);
+
+      points = 0;
+      for (std::size_t i=first; i<last; ++i) {
+        const HistogramPoint& p = histogram[i];
+        ASSERT(p.r >= r1 && p.r <= r2);
+        ASSERT(p.g >= g1 && p.g <= g2);
+        ASSERT(p.b >= b1 && p.b <= b2);
+        ASSERT(p.a >= a1 && p.a <= a2);
+        planes.r[p.r] += p.count;
+        planes.g[p.g] += p.count;
+        planes.b[p.b] += p.count;
+        planes.a[p.a] += p.count;
+        points += p.count;
       }
+    }
 
-    doneB:;
+    // Reduces the specified side of the box (i1/i2) to the first and
+    // last planes with points.
+    static void axisShrink(const std::size_t* planes, int& i1, int& i2) {
+      while (i1 < i2 && planes[i1] == 0)
+        ++i1;
+      while (i2 > i1 && planes[i2] == 0)
+        --i2;
     }
 
     // Splits the box in two sub-boxes (if it's possible) along the
-    // specified axis by AxisGetter template parameter and "i1/i2"
+    // specified axis by AxisSplitter template parameter and "i1/i2"
     // arguments. Returns true if the split was done and the "boxes"
     // queue contains the new two sub-boxes resulting from the split
     // operation.
-    template<class AxisGetter, class AxisSplitter>
-    bool splitAlongAxis(const Histogram& histogram,
+    template<class AxisSplitter>
+    bool splitAlongAxis(const std::size_t* planes,
+                        HistogramPoints& histogram,
                         std::priority_queue<Box>& boxes,
-                        const int& i1, const int& i2,
-                        const int& j1, const int& j2,
-                        const int& k1, const int& k2,
-                        const int& l1, const int& l2) const {
+                        const int& i1, const int& i2) const {
       // These two variables will be used to count how many points are
       // in each side of the box if we split it in "i" position.
       std::size_t totalPoints1 = 0;
       std::size_t totalPoints2 = this->points;
-      int i, j, k, l;
+      int i;
 
       // We will try to split the box along the "i" axis. Imagine a
       // plane which its normal vector is "i" axis, so we will try to
@@ -223,13 +236,8 @@ namespace render {
       // the number of points in both sides of the plane are
       // approximated the same.
       for (i=i1; i<=i2; ++i) {
-        std::size_t planePoints = 0;
-
-        // We count all points in "i" plane.
-        for (j=j1; j<=j2; ++j)
-          for (k=k1; k<=k2; ++k)
-            for (l=l1; l<=l2; ++l)
-              planePoints += AxisGetter::at(histogram, i, j, k, l);
+        // All points in "i" plane.
+        const std::size_t planePoints = planes[i];
 
         // As we move the plane to split through "i" axis One side is getting more points,
         totalPoints1 += planePoints;
@@ -237,21 +245,14 @@ namespace render {
 
         if (totalPoints1 > totalPoints2) {
           if (totalPoints2 > 0) {
-            Box box1(AxisSplitter::box1(*this, i));
-            Box box2(AxisSplitter::box2(*this, i+1));
-            box1.points = totalPoints1;
-            box2.points = totalPoints2;
-            boxes.push(box1);
-            boxes.push(box2);
+            pushBoxes<AxisSplitter>(histogram, boxes, i,
+                                    totalPoints1, totalPoints2);
             return true;
           }
           else if (totalPoints1-planePoints > 0) {
-            Box box1(AxisSplitter::box1(*this, i-1));
-            Box box2(AxisSplitter::box2(*this, i));
-            box1.points = totalPoints1-planePoints;
-            box2.points = totalPoints2+planePoints;
-            boxes.push(box1);
-            boxes.push(box2);
+            pushBoxes<AxisSplitter>(histogram, boxes, i-1,
+                                    totalPoints1-planePoints,
+                                    totalPoints2+planePoints);
             return true;
           }
           else
@@ -261,8 +262,32 @@ namespace render {
       return false;
     }
 
+    // Pushes the sub-boxes [..., i] and [i+1, ...] along the given
+    // axis.
+    template<class AxisSplitter>
+    void pushBoxes(HistogramPoints& histogram,
+                   std::priority_queue<Box>& boxes, int i,
+                   std::size_t points1, std::size_t points2) const {
+      auto mid = std::partition(
+        histogram.begin()+first, histogram.begin()+last,
+        [i](const HistogramPoint& p) {
+          return AxisSplitter::component(p) <= i;
+        });
+
+      Box box1(AxisSplitter::box1(*this, i));
+      Box box2(AxisSplitter::box2(*this, i+1));
+      box1.first = first;
+      box1.last = box2.first = std::size_t(mid - histogram.begin());
+      box2.last = last;
+      box1.points = points1;
+      box2.points = points2;
+      boxes.push(box1);
+      boxes.push(box2);
+    }
+
     int r1, g1, b1, a1;         // Min point (closest to origin)
     int r2, g2, b2, a2;         // Max point
+    std::size_t first, last;    // Range of points in the HistogramPoints
     std::size_t points;         // Number of points in the space which enclose this box
     int volume;
   }; // end of class Box
@@ -274,13 +299,20 @@ namespace render {
   void median_cut(const Histogram& histogram, std::size_t maxBoxes, std::vector<uint32_t>& result) {
     // We need a priority queue to split bigger boxes first (see Box::operator<).
     std::priority_queue<Box<Histogram> > boxes;
+    typename Box<Histogram>::Planes planes;
+
+    // The non-empty entries of the histogram, they are reordered
+    // while the boxes are split.
+    HistogramPoints points;
+    histogram.getPoints(points);
 
     // First we start with one big box containing all histogram's samples.
     boxes.push(Box<Histogram>(0, 0, 0, 0,
                               Histogram::RElements-1,
                               Histogram::GElements-1,
                               Histogram::BElements-1,
-                              Histogram::AElements-1));
+                              Histogram::AElements-1,
+                              0, points.size()));
 
     // Then we split each box until we reach the maximum specified by
     // the user (maxBoxes) or until there aren't more boxes to split.
@@ -291,16 +323,16 @@ namespace render {
 
       // Shrink the box to the minimum, to enclose the same points in
       // the histogram.
-      box.shrink(histogram);
+      box.shrink(points, planes);
 
       // Try to split the box along the largest axis.
-      if (!box.split(histogram, boxes)) {
+      if (!box.split(planes, points, boxes)) {
         // If we were not able to split the box (maybe because it is
         // too small or there are not enough points to split it), then
         // we add the box's color to the "result" vector directly (the
         // box is not in the queue anymore).
         if (result.size() < maxBoxes)
-          result.push_back(box.meanColor(histogram));
+          result.push_back(box.meanColor(planes));
         else
           return;
       }
@@ -310,7 +342,7 @@ namespace render {
     // to a color for the "result" vector.
     while (!boxes.empty() && result.size() < maxBoxes) {
       const Box<Histogram>& box(boxes.top());
-      doc::color_t color = box.meanColor(histogram);
+      doc::color_t color = box.meanColor(points);
       result.push_back(color);
       boxes.pop();
     }
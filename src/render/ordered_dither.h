@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "base/base.h"
 #include "doc/color.h"
 #include "doc/image_impl.h"
 #include "doc/palette.h"
@@ -78,9 +79,82 @@ namespace render {
       int x, int y,
       const doc::RgbMap* rgbmap,
       const doc::Palette* palette) {
+      const Candidates c = findCandidates(matrix.maxValue(), color, rgbmap, palette);
+      return c.pick(matrix(x, y));
+    }
+
+    // Converts the rows [y1, y2) of the given RGB image. Different
+    // rows can be converted from several threads at the same time if
+    // the "rgbmap" is NULL or it's already calculated
+    // (RgbMap::isCalculated()).
+    template<typename Matrix>
+    void ditherRgbImageToIndexed(const Matrix& matrix,
+                                 const doc::Image* srcImage,
+                                 doc::Image* dstImage,
+                                 int u, int v,
+                                 const doc::RgbMap* rgbmap,
+                                 const doc::Palette* palette,
+                                 int y1 = 0, int y2 = -1) {
+      ASSERT(srcImage->pixelFormat() == doc::IMAGE_RGB);
+      ASSERT(dstImage->pixelFormat() == doc::IMAGE_INDEXED);
+      const int w = srcImage->width();
+      if (y2 < 0)
+        y2 = srcImage->height();
+
+      // The two candidates of each color (and the position of the
+      // color between them) don't depend on the pixel position, so
+      // they are calculated once for each different color. Big areas
+      // of the same color (or a few colors) are common in sprites.
+      const int maxValue = matrix.maxValue();
+      Candidates cache[kCacheSize];
+
+      for (int y=y1; y<y2; ++y) {
+        auto src = (const doc::RgbTraits::pixel_t*)srcImage->getPixelAddress(0, y);
+        auto dst = (doc::IndexedTraits::pixel_t*)dstImage->getPixelAddress(0, y);
+
+        for (int x=0; x<w; ++x) {
+          const doc::color_t color = src[x];
+          Candidates& c = cache[cacheIndex(color)];
+          if (c.index1 < 0 || c.color != color)
+            c = findCandidates(maxValue, color, rgbmap, palette);
+          dst[x] = c.pick(matrix(x+u, y+v));
+        }
+      }
+    }
+
+  private:
+    enum { kCacheSize = 1024 };
+
+    // Indexes to choose for a color in the dithering, if "d" (the
+    // distance from "index1" scaled to the matrix range) is greater
+    // than the matrix threshold, the second index is used.
+    struct Candidates {
+      doc::color_t color = 0;
+      int index1 = -1;
+      int index2 = -1;
+      int d = 0;
+
+      doc::color_t pick(int threshold) const {
+        return (d > threshold ? index2: index1);
+      }
+    };
+
+    static int cacheIndex(doc::color_t color) {
+      return int((color * 2654435761u) >> 22) & (kCacheSize-1);
+    }
+
+    Candidates findCandidates(int maxValue,
+                              doc::color_t color,
+                              const doc::RgbMap* rgbmap,
+                              const doc::Palette* palette) const {
+      Candidates c;
+      c.color = color;
+
       // Alpha=0, output transparent color
-      if (m_transparentIndex >= 0 && !doc::rgba_geta(color))
-        return m_transparentIndex;
+      if (m_transparentIndex >= 0 && !doc::rgba_geta(color)) {
+        c.index1 = c.index2 = m_transparentIndex;
+        return c;
+      }
 
       // Get the nearest color in the palette with the given RGB
       // values.
@@ -92,6 +166,8 @@ namespace render {
         (rgbmap ? rgbmap->mapColor(r, g, b, a):
                   palette->findBestfit(r, g, b, a, m_transparentIndex));
 
+      c.index1 = c.index2 = int(nearest1idx);
+
       doc::color_t nearest1rgb = palette->getEntry(nearest1idx);
       int r1 = doc::rgba_getr(nearest1rgb);
       int g1 = doc::rgba_getg(nearest1rgb);
@@ -117,7 +193,7 @@ namespace render {
       // If both possible RGB colors use the same index, we cannot
       // make any dither with these two colors.
       if (nearest1idx == nearest2idx)
-        return nearest1idx;
+        return c;
 
       doc::color_t nearest2rgb = palette->getEntry(nearest2idx);
       r2 = doc::rgba_getr(nearest2rgb);
@@ -131,42 +207,16 @@ namespace render {
       int d = colorDistance(r1, g1, b1, a1, r, g, b, a);
       int D = colorDistance(r1, g1, b1, a1, r2, g2, b2, a2);
       if (D == 0)
-        return nearest1idx;
+        return c;
 
       // We convert the d/D factor to the matrix range to compare it
       // with the threshold. If d > threshold, it means that we're
       // closer to 'nearest2rgb' than to 'nearest1rgb'.
-      d = matrix.maxValue() * d / D;
-      int threshold = matrix(x, y);
-
-      return (d > threshold ? nearest2idx:
-                              nearest1idx);
-    }
-
-    template<typename Matrix>
-    void ditherRgbImageToIndexed(const Matrix& matrix,
-                                 const doc::Image* srcImage,
-                                 doc::Image* dstImage,
-                                 int u, int v,
-                                 const doc::RgbMap* rgbmap,
-                                 const doc::Palette* palette) {
-      const doc::LockImageBits<doc::RgbTraits> srcBits(srcImage);
-      doc::LockImageBits<doc::IndexedTraits> dstBits(dstImage);
-      auto srcIt = srcBits.begin();
-      auto dstIt = dstBits.begin();
-      int w = srcImage->width();
-      int h = srcImage->height();
-
-      for (int y=0; y<h; ++y) {
-        for (int x=0; x<w; ++x, ++srcIt, ++dstIt) {
-          ASSERT(srcIt != srcBits.end());
-          ASSERT(dstIt != dstBits.end());
-          *dstIt = ditherRgbPixelToIndex(matrix, *srcIt, x+u, y+v, rgbmap, palette);
-        }
-      }
+      c.index2 = int(nearest2idx);
+      c.d = maxValue * d / D;
+      return c;
     }
 
-  private:
     int m_transparentIndex;
   };
 
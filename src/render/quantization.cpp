@@ -12,6 +12,7 @@
 #include "render/quantization.h"
 
 #include "base/base.h"
+#include "base/thread_pool.h"
 #include "doc/image_impl.h"
 #include "doc/images_collector.h"
 #include "doc/layer.h"
@@ -22,12 +23,16 @@
 #include "doc/sprite.h"
 #include "gfx/hsv.h"
 #include "gfx/rgb.h"
+#include "render/error_diffusion.h"
 #include "render/ordered_dither.h"
 #include "render/render.h"
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace render {
@@ -35,6 +40,10 @@ namespace render {
 using namespace doc;
 using namespace gfx;
 
+// Maximum number of histograms used at the same time to create a
+// palette (each one can use several MB with images of many colors)
+static const int kMaxHistograms = 8;
+
 std::shared_ptr<Palette> create_palette_from_sprite(
   const Sprite* sprite,
   frame_t fromFrame,
@@ -54,23 +63,60 @@ std::shared_ptr<Palette> create_palette_from_sprite(
     palette->setFrame(fromFrame);
   }
 
-  // Add a flat image with the current sprite's frame rendered
-  std::shared_ptr<Image> flat_image {Image::create(IMAGE_RGB, sprite->width(), sprite->height())};
+  // Frames are rendered and counted in parallel, each thread with a
+  // contiguous range of frames and its own histogram (the histograms
+  // are merged in the same order of the frames)
+  const int frames = toFrame-fromFrame+1;
+  const int chunks = std::max(1, std::min(
+      std::min(base::thread_pool::instance().concurrency(), kMaxHistograms),
+      frames));
+  std::vector<std::unique_ptr<PaletteOptimizer>> optimizers(chunks);
+  std::mutex delegateMutex;
+  std::atomic<int> doneFrames(0);
+  std::atomic<bool> cancelled(false);
+
+  base::thread_pool::instance().parallel_for(
+    chunks,
+    [&](int i) {
+      const frame_t first = fromFrame + frames*i/chunks;
+      const frame_t last = fromFrame + frames*(i+1)/chunks - 1;
+
+      std::unique_ptr<PaletteOptimizer> chunkOptimizer;
+      PaletteOptimizer* opt = &optimizer;
+      if (i > 0) {
+        chunkOptimizer.reset(new PaletteOptimizer);
+        opt = chunkOptimizer.get();
+      }
 
-  // Feed the optimizer with all rendered frames
-  render::Render render;
-  for (frame_t frame=fromFrame; frame<=toFrame; ++frame) {
-    render.renderSprite(flat_image.get(), sprite, frame);
-    optimizer.feedWithImage(flat_image.get(), withAlpha);
+      std::unique_ptr<Image> flat_image(
+        Image::create(IMAGE_RGB, sprite->width(), sprite->height()));
 
-    if (delegate) {
-      if (!delegate->onPaletteOptimizerContinue())
-        return nullptr;
+      render::Render render;
+      // The frames are already rendered in parallel
+      render.setParallel(chunks == 1);
 
-      delegate->onPaletteOptimizerProgress(
-        double(frame-fromFrame+1) / double(toFrame-fromFrame+1));
-    }
-  }
+      for (frame_t frame=first; frame<=last && !cancelled; ++frame) {
+        render.renderSprite(flat_image.get(), sprite, frame);
+        opt->feedWithImage(flat_image.get(), withAlpha);
+
+        const int done = ++doneFrames;
+        if (delegate) {
+          std::lock_guard<std::mutex> lock(delegateMutex);
+          if (!delegate->onPaletteOptimizerContinue())
+            cancelled = true;
+          else
+            delegate->onPaletteOptimizerProgress(double(done) / double(frames));
+        }
+      }
+
+      optimizers[i] = std::move(chunkOptimizer);
+    });
+
+  if (cancelled)
+    return nullptr;
+
+  for (int i=1; i<chunks; ++i)
+    optimizer.merge(*optimizers[i]);
 
   // Generate an optimized palette
   optimizer.calculate(
@@ -83,6 +129,55 @@ std::shared_ptr<Palette> create_palette_from_sprite(
   return palette;
 }
 
+namespace {
+
+// Minimum number of pixels converted by each thread
+const int kMinPixelsPerBand = 16384;
+
+// Calls func(y1, y2) for bands of rows of the given image (from
+// several threads if "parallel" is true and the image is big enough).
+template<typename Func>
+void for_each_band(const Image* image, bool parallel, Func func)
+{
+  const int h = image->height();
+  const int rowsPerBand = MAX(1, kMinPixelsPerBand / MAX(1, image->width()));
+  const int bands = (h + rowsPerBand - 1) / rowsPerBand;
+
+  if (!parallel || bands < 2) {
+    func(0, h);
+    return;
+  }
+
+  base::thread_pool::instance().parallel_for(
+    bands,
+    [&func, rowsPerBand, h](int i) {
+      func(i*rowsPerBand, MIN(h, (i+1)*rowsPerBand));
+    });
+}
+
+// Converts each pixel of "src" with dstPixel = func(srcPixel).
+template<typename SrcTraits, typename DstTraits, typename Func>
+void convert_pixels(const Image* src, Image* dst, bool parallel, Func func)
+{
+  ASSERT(src->pixelFormat() == SrcTraits::pixel_format);
+  ASSERT(dst->pixelFormat() == DstTraits::pixel_format);
+  ASSERT(src->width() == dst->width() && src->height() == dst->height());
+
+  const int w = src->width();
+  for_each_band(
+    src, parallel,
+    [src, dst, w, &func](int y1, int y2) {
+      for (int y=y1; y<y2; ++y) {
+        auto srcIt = (typename SrcTraits::const_address_t)src->getPixelAddress(0, y);
+        auto dstIt = (typename DstTraits::address_t)dst->getPixelAddress(0, y);
+        for (int x=0; x<w; ++x)
+          dstIt[x] = func(srcIt[x]);
+      }
+    });
+}
+
+} // anonymous namespace
+
 Image* convert_pixel_format(
   const Image* image,
   Image* new_image,
@@ -97,25 +192,40 @@ Image* convert_pixel_format(
     new_image = Image::create(pixelFormat, image->width(), image->height());
   new_image->setMaskColor(new_mask_color);
 
+  // The rows can be converted in several threads if the rgbmap
+  // doesn't need to calculate new entries (RgbMap::mapColor() would
+  // modify the map).
+  const bool parallel = (new_image->pixelFormat() != IMAGE_INDEXED ||
+                         !rgbmap || rgbmap->isCalculated());
+
   // RGB -> Indexed with ordered dithering
   if (image->pixelFormat() == IMAGE_RGB &&
       pixelFormat == IMAGE_INDEXED &&
       ditheringMethod == DitheringMethod::ORDERED) {
     BayerMatrix<8> matrix;
     OrderedDither dither;
-    dither.ditherRgbImageToIndexed(matrix, image, new_image, 0, 0, rgbmap, palette);
+    for_each_band(
+      image, parallel,
+      [&](int y1, int y2) {
+        dither.ditherRgbImageToIndexed(matrix, image, new_image, 0, 0,
+                                       rgbmap, palette, y1, y2);
+      });
     return new_image;
   }
 
-  color_t c;
-  int r, g, b, a;
+  // RGB -> Indexed with error diffusion
+  if (image->pixelFormat() == IMAGE_RGB &&
+      pixelFormat == IMAGE_INDEXED &&
+      (ditheringMethod == DitheringMethod::FLOYD_STEINBERG ||
+       ditheringMethod == DitheringMethod::ATKINSON)) {
+    ErrorDiffusionDither dither(ditheringMethod);
+    dither.ditherRgbImageToIndexed(image, new_image, rgbmap, palette, parallel);
+    return new_image;
+  }
 
   switch (image->pixelFormat()) {
 
     case IMAGE_RGB: {
-      const LockImageBits<RgbTraits> srcBits(image);
-      LockImageBits<RgbTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-
       switch (new_image->pixelFormat()) {
 
         // RGB -> RGB
@@ -124,81 +234,47 @@ Image* convert_pixel_format(
           break;
 
         // RGB -> Grayscale
-        case IMAGE_GRAYSCALE: {
-          LockImageBits<GrayscaleTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<GrayscaleTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<GrayscaleTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            g = 255 * Hsv(Rgb(rgba_getr(c),
-                              rgba_getg(c),
-                              rgba_getb(c))).valueInt() / 100;
-
-            *dst_it = graya(g, rgba_geta(c));
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_GRAYSCALE:
+          convert_pixels<RgbTraits, GrayscaleTraits>(
+            image, new_image, parallel,
+            [](color_t c) -> color_t {
+              int g = 255 * Hsv(Rgb(rgba_getr(c),
+                                    rgba_getg(c),
+                                    rgba_getb(c))).valueInt() / 100;
+              return graya(g, rgba_geta(c));
+            });
           break;
-        }
 
         // RGB -> Indexed
-        case IMAGE_INDEXED: {
-          LockImageBits<IndexedTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<IndexedTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<IndexedTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            r = rgba_getr(c);
-            g = rgba_getg(c);
-            b = rgba_getb(c);
-            a = rgba_geta(c);
-
-            if (a == 0)
-              *dst_it = new_mask_color;
-            else
-              *dst_it = rgbmap->mapColor(r, g, b, a);
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_INDEXED:
+          convert_pixels<RgbTraits, IndexedTraits>(
+            image, new_image, parallel,
+            [rgbmap, new_mask_color](color_t c) -> color_t {
+              int a = rgba_geta(c);
+              if (a == 0)
+                return new_mask_color;
+              else
+                return rgbmap->mapColor(rgba_getr(c),
+                                        rgba_getg(c),
+                                        rgba_getb(c), a);
+            });
           break;
-        }
       }
       break;
     }
 
     case IMAGE_GRAYSCALE: {
-      const LockImageBits<GrayscaleTraits> srcBits(image);
-      LockImageBits<GrayscaleTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-
       switch (new_image->pixelFormat()) {
 
         // Grayscale -> RGB
-        case IMAGE_RGB: {
-          LockImageBits<RgbTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<RgbTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<RgbTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            g = graya_getv(c);
-
-            *dst_it = rgba(g, g, g, graya_geta(c));
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_RGB:
+          convert_pixels<GrayscaleTraits, RgbTraits>(
+            image, new_image, parallel,
+            [](color_t c) -> color_t {
+              int g = graya_getv(c);
+              return rgba(g, g, g, graya_geta(c));
+            });
           break;
-        }
 
         // Grayscale -> Grayscale
         case IMAGE_GRAYSCALE:
@@ -206,114 +282,70 @@ Image* convert_pixel_format(
           break;
 
         // Grayscale -> Indexed
-        case IMAGE_INDEXED: {
-          LockImageBits<IndexedTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<IndexedTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<IndexedTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-            a = graya_geta(c);
-            c = graya_getv(c);
-
-            if (a == 0)
-              *dst_it = new_mask_color;
-            else
-              *dst_it = rgbmap->mapColor(c, c, c, a);
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_INDEXED:
+          convert_pixels<GrayscaleTraits, IndexedTraits>(
+            image, new_image, parallel,
+            [rgbmap, new_mask_color](color_t c) -> color_t {
+              int a = graya_geta(c);
+              int v = graya_getv(c);
+              if (a == 0)
+                return new_mask_color;
+              else
+                return rgbmap->mapColor(v, v, v, a);
+            });
           break;
-        }
       }
       break;
     }
 
     case IMAGE_INDEXED: {
-      const LockImageBits<IndexedTraits> srcBits(image);
-      LockImageBits<IndexedTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
+      const color_t maskColor = image->maskColor();
 
       switch (new_image->pixelFormat()) {
 
         // Indexed -> RGB
-        case IMAGE_RGB: {
-          LockImageBits<RgbTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<RgbTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<RgbTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            if (!is_background && c == image->maskColor())
-              *dst_it = rgba(0, 0, 0, 0);
-            else
-              *dst_it = palette->getEntry(c);
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_RGB:
+          convert_pixels<IndexedTraits, RgbTraits>(
+            image, new_image, parallel,
+            [=](color_t c) -> color_t {
+              if (!is_background && c == maskColor)
+                return rgba(0, 0, 0, 0);
+              else
+                return palette->getEntry(c);
+            });
           break;
-        }
 
         // Indexed -> Grayscale
-        case IMAGE_GRAYSCALE: {
-          LockImageBits<GrayscaleTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<GrayscaleTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<GrayscaleTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
+        case IMAGE_GRAYSCALE:
+          convert_pixels<IndexedTraits, GrayscaleTraits>(
+            image, new_image, parallel,
+            [=](color_t c) -> color_t {
+              if (!is_background && c == maskColor)
+                return graya(0, 0);
 
-            if (!is_background && c == image->maskColor())
-              *dst_it = graya(0, 0);
-            else {
               c = palette->getEntry(c);
-              r = rgba_getr(c);
-              g = rgba_getg(c);
-              b = rgba_getb(c);
-              a = rgba_geta(c);
-
-              g = 255 * Hsv(Rgb(r, g, b)).valueInt() / 100;
-              *dst_it = graya(g, a);
-            }
-          }
-          ASSERT(dst_it == dst_end);
+              int g = 255 * Hsv(Rgb(rgba_getr(c),
+                                    rgba_getg(c),
+                                    rgba_getb(c))).valueInt() / 100;
+              return graya(g, rgba_geta(c));
+            });
           break;
-        }
 
         // Indexed -> Indexed
-        case IMAGE_INDEXED: {
-          LockImageBits<IndexedTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<IndexedTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<IndexedTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
+        case IMAGE_INDEXED:
+          convert_pixels<IndexedTraits, IndexedTraits>(
+            image, new_image, parallel,
+            [=](color_t c) -> color_t {
+              if (!is_background && c == maskColor)
+                return new_mask_color;
 
-            if (!is_background && c == image->maskColor())
-              *dst_it = new_mask_color;
-            else {
               c = palette->getEntry(c);
-              r = rgba_getr(c);
-              g = rgba_getg(c);
-              b = rgba_getb(c);
-              a = rgba_geta(c);
-              *dst_it = rgbmap->mapColor(r, g, b, a);
-            }
-          }
-          ASSERT(dst_it == dst_end);
+              return rgbmap->mapColor(rgba_getr(c),
+                                      rgba_getg(c),
+                                      rgba_getb(c),
+                                      rgba_geta(c));
+            });
           break;
-        }
-
       }
       break;
     }
@@ -328,18 +360,15 @@ Image* convert_pixel_format(
 
 void PaletteOptimizer::feedWithImage(Image* image, bool withAlpha)
 {
-  uint32_t color;
-
   ASSERT(image);
   switch (image->pixelFormat()) {
 
     case IMAGE_RGB:
-      {
-        const LockImageBits<RgbTraits> bits(image);
-        LockImageBits<RgbTraits>::const_iterator it = bits.begin(), end = bits.end();
-
+      for (int y=0; y<image->height(); ++y) {
+        const uint32_t* it = (const uint32_t*)image->getPixelAddress(0, y);
+        const uint32_t* end = it + image->width();
         for (; it != end; ++it) {
-          color = *it;
+          color_t color = *it;
           if (rgba_geta(color) > 0) {
             if (!withAlpha)
               color |= rgba(0, 0, 0, 255);
@@ -351,12 +380,11 @@ void PaletteOptimizer::feedWithImage(Image* image, bool withAlpha)
       break;
 
     case IMAGE_GRAYSCALE:
-      {
-        const LockImageBits<RgbTraits> bits(image);
-        LockImageBits<RgbTraits>::const_iterator it = bits.begin(), end = bits.end();
-
+      for (int y=0; y<image->height(); ++y) {
+        const uint16_t* it = (const uint16_t*)image->getPixelAddress(0, y);
+        const uint16_t* end = it + image->width();
         for (; it != end; ++it) {
-          color = *it;
+          color_t color = *it;
 
           if (graya_geta(color) > 0) {
             if (!withAlpha)
@@ -383,6 +411,11 @@ void PaletteOptimizer::feedWithRgbaColor(color_t color)
   m_histogram.addSamples(color, 1);
 }
 
+void PaletteOptimizer::merge(const PaletteOptimizer& other)
+{
+  m_histogram.merge(other.m_histogram);
+}
+
 void PaletteOptimizer::calculate(Palette& palette, int maskIndex,
                                  PaletteOptimizerDelegate* delegate)
 {
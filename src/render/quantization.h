@@ -35,6 +35,9 @@ namespace render {
   public:
     void feedWithImage(Image* image, bool withAlpha);
     void feedWithRgbaColor(color_t color);
+    // Adds the colors of other optimizer (e.g. one fed in other
+    // thread) as if its images were fed after the images of this one.
+    void merge(const PaletteOptimizer& other);
     void calculate(Palette& palette, int maskIndex, PaletteOptimizerDelegate* delegate);
 
   private:
@@ -11,18 +11,50 @@
 #include "render/render.h"
 
 #include "base/base.h"
+#include "base/thread_pool.h"
+#include "base/trace_span.h"
 #include "doc/blend_internals.h"
 #include "doc/blend_mode.h"
+#include "doc/blend_span.h"
 #include "doc/doc.h"
 #include "doc/handle_anidir.h"
+#include "doc/image_content.h"
 #include "doc/image_impl.h"
 #include "gfx/clip.h"
 #include "gfx/region.h"
+#include "render/render_cache.h"
+
+#include <algorithm>
+#include <set>
 
 namespace render {
 
 namespace {
 
+// Colors of the 256 entries of the palette (0 for the entries that
+// the palette doesn't have). The table of the last palette version
+// is kept for each thread, so each frame of an indexed sprite
+// converts its palette once instead of looking up each pixel.
+const color_t* palette_lut(const Palette* pal)
+{
+  struct Lut {
+    ObjectId paletteId = 0;
+    int modifications = 0;
+    color_t colors[256];
+  };
+  thread_local Lut lut;
+
+  const ObjectId id = pal->id();
+  if (lut.paletteId != id ||
+      lut.modifications != pal->getModifications()) {
+    lut.paletteId = id;
+    lut.modifications = pal->getModifications();
+    for (int i=0; i<256; ++i)
+      lut.colors[i] = pal->getEntry(i);
+  }
+  return lut.colors;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Scaled composite
 
@@ -74,7 +106,7 @@ public:
 
 template<>
 class BlenderHelper<RgbTraits, IndexedTraits> {
-  const Palette* m_pal;
+  const color_t* m_lut;
   BlendMode m_blendMode;
   BlendFunc m_blendFunc;
   color_t m_mask_color;
@@ -84,7 +116,7 @@ public:
     m_blendMode = blendMode;
     m_blendFunc = RgbTraits::get_blender(blendMode);
     m_mask_color = src->maskColor();
-    m_pal = pal;
+    m_lut = palette_lut(pal);
   }
   inline RgbTraits::pixel_t
   operator()(const RgbTraits::pixel_t& dst,
@@ -92,11 +124,11 @@ public:
                          int opacity)
   {
     if (m_blendMode == BlendMode::SRC) {
-      return m_pal->getEntry(src);
+      return m_lut[src];
     }
     else {
       if (src != m_mask_color) {
-        return (*m_blendFunc)(dst, m_pal->getEntry(src), opacity);
+        return (*m_blendFunc)(dst, m_lut[src], opacity);
       }
       else
         return dst;
@@ -185,6 +217,97 @@ void composite_image_without_scale(
   }
 }
 
+// RGB over RGB without scale is the most common case (editor and
+// export), so each row is blended with a vectorized span blender
+// (when the blend mode has one).
+void composite_rgb_image_without_scale(
+  Image* dst,
+  const Image* src,
+  const Palette* pal,
+  const gfx::Clip& _area,
+  const int opacity,
+  const BlendMode blendMode,
+  const Zoom& zoom)
+{
+  ASSERT(dst);
+  ASSERT(src);
+  ASSERT(dst->pixelFormat() == IMAGE_RGB);
+  ASSERT(src->pixelFormat() == IMAGE_RGB);
+
+  BlendSpanFunc blendSpan = get_rgba_span_blender(blendMode);
+  if (!blendSpan) {
+    composite_image_without_scale<RgbTraits, RgbTraits>(
+      dst, src, pal, _area, opacity, blendMode, zoom);
+    return;
+  }
+
+  gfx::Clip area = _area;
+  if (!area.clip(dst->width(), dst->height(),
+                 src->width(), src->height()))
+    return;
+
+  const color_t maskColor = src->maskColor();
+  for (int y=0; y<area.size.h; ++y) {
+    (*blendSpan)(
+      (RgbTraits::address_t)dst->getPixelAddress(area.dst.x, area.dst.y+y),
+      (RgbTraits::const_address_t)src->getPixelAddress(area.src.x, area.src.y+y),
+      area.size.w, maskColor, opacity);
+  }
+}
+
+// Indexed over RGB without scale (indexed sprites in the editor and
+// in exports). Each row is converted with the palette table, and the
+// opaque colors are copied without blending when the layer is opaque
+// with the normal blend mode.
+void composite_indexed_image_without_scale(
+  Image* dst,
+  const Image* src,
+  const Palette* pal,
+  const gfx::Clip& _area,
+  const int opacity,
+  const BlendMode blendMode,
+  const Zoom& zoom)
+{
+  ASSERT(dst);
+  ASSERT(src);
+  ASSERT(dst->pixelFormat() == IMAGE_RGB);
+  ASSERT(src->pixelFormat() == IMAGE_INDEXED);
+
+  gfx::Clip area = _area;
+  if (!area.clip(dst->width(), dst->height(),
+                 src->width(), src->height()))
+    return;
+
+  const color_t* lut = palette_lut(pal);
+  const color_t maskColor = src->maskColor();
+  const BlendFunc blendFunc = RgbTraits::get_blender(blendMode);
+  const bool copyOpaque = (blendMode == BlendMode::NORMAL && opacity == 255);
+  const int w = area.size.w;
+
+  for (int y=0; y<area.size.h; ++y) {
+    auto dst_address = (RgbTraits::address_t)dst->getPixelAddress(area.dst.x, area.dst.y+y);
+    auto src_address = (IndexedTraits::const_address_t)src->getPixelAddress(area.src.x, area.src.y+y);
+
+    if (blendMode == BlendMode::SRC) {
+      for (int x=0; x<w; ++x)
+        dst_address[x] = lut[src_address[x]];
+      continue;
+    }
+
+    for (int x=0; x<w; ++x) {
+      const color_t index = src_address[x];
+      if (index == maskColor)
+        continue;
+
+      const color_t c = lut[index];
+      if (copyOpaque && rgba_geta(c) == 255)
+        dst_address[x] = c;
+      else
+        dst_address[x] = (*blendFunc)(dst_address[x], c, opacity);
+    }
+  }
+}
+
 template<class DstTraits, class SrcTraits>
 void composite_image_scale_up(
   Image* dst,
@@ -347,43 +470,27 @@ void composite_image_scale_down(
 
   gfx::Rect srcBounds = zoom.remove(area.srcBounds());
   gfx::Rect dstBounds = area.dstBounds();
-  int bottom = area.dst.y+area.size.h-1;
 
   if (srcBounds.isEmpty())
     return;
 
-  // Lock all necessary bits
-  const LockImageBits<SrcTraits> srcBits(src, srcBounds);
-  LockImageBits<DstTraits> dstBits(dst, dstBounds);
-  typename LockImageBits<SrcTraits>::const_iterator src_it = srcBits.begin();
-  typename LockImageBits<SrcTraits>::const_iterator src_end = srcBits.end();
-  typename LockImageBits<DstTraits>::iterator dst_it, dst_end;
-
-  // For each line to draw of the source image...
-  dstBounds.h = 1;
-  for (int y=0; y<srcBounds.h; y+=unbox_h) {
-    dst_it = dstBits.begin_area(dstBounds);
-    dst_end = dstBits.end_area(dstBounds);
-
-    for (int x=0; x<srcBounds.w; x+=unbox_w) {
-      ASSERT(src_it >= srcBits.begin() && src_it < src_end);
-      ASSERT(dst_it >= dstBits.begin() && dst_it < dst_end);
-
-      *dst_it = blender(*dst_it, *src_it, opacity);
-
-      // Skip source pixels
-      for (int delta=0; delta < unbox_w && src_it != src_end; ++delta)
-        ++src_it;
-
-      ++dst_it;
-    }
-
-    if (++dstBounds.y > bottom)
-      break;
-
-    // Skip lines
-    for (int delta=0; delta < srcBounds.w * (unbox_h-1) && src_it != src_end; ++delta)
-      ++src_it;
+  // Each pixel of "dst" is one sample of "src" (nearest neighbor), so
+  // we read only the sampled pixels instead of iterating all the
+  // pixels of the source area (the cost depends on the output size,
+  // not on the zoom level).
+  const int dst_w = std::min(dstBounds.w, (srcBounds.w + unbox_w - 1) / unbox_w);
+  const int dst_h = std::min(dstBounds.h, (srcBounds.h + unbox_h - 1) / unbox_h);
+
+  for (int v=0; v<dst_h; ++v) {
+    typename SrcTraits::const_address_t src_address =
+      (typename SrcTraits::const_address_t)
+      src->getPixelAddress(srcBounds.x, srcBounds.y + v*unbox_h);
+    typename DstTraits::address_t dst_address =
+      (typename DstTraits::address_t)
+      dst->getPixelAddress(dstBounds.x, dstBounds.y + v);
+
+    for (int u=0; u<dst_w; ++u, ++dst_address)
+      *dst_address = blender(*dst_address, src_address[u*unbox_w], opacity);
   }
 }
 
@@ -406,7 +513,10 @@ CompositeImageFunc get_image_composition(PixelFormat dstFormat,
 
     case IMAGE_RGB:
       switch (dstFormat) {
-        case IMAGE_RGB:       return get_image_composition_impl<RgbTraits, RgbTraits>(zoom);
+        case IMAGE_RGB:
+          if (zoom.scale() == 1.0)
+            return composite_rgb_image_without_scale;
+          return get_image_composition_impl<RgbTraits, RgbTraits>(zoom);
         case IMAGE_GRAYSCALE: return get_image_composition_impl<GrayscaleTraits, RgbTraits>(zoom);
         case IMAGE_INDEXED:   return get_image_composition_impl<IndexedTraits, RgbTraits>(zoom);
       }
@@ -422,7 +532,10 @@ CompositeImageFunc get_image_composition(PixelFormat dstFormat,
 
     case IMAGE_INDEXED:
       switch (dstFormat) {
-        case IMAGE_RGB:       return get_image_composition_impl<RgbTraits, IndexedTraits>(zoom);
+        case IMAGE_RGB:
+          if (zoom.scale() == 1.0)
+            return composite_indexed_image_without_scale;
+          return get_image_composition_impl<RgbTraits, IndexedTraits>(zoom);
         case IMAGE_GRAYSCALE: return get_image_composition_impl<GrayscaleTraits, IndexedTraits>(zoom);
         case IMAGE_INDEXED:   return get_image_composition_impl<IndexedTraits, IndexedTraits>(zoom);
       }
@@ -444,12 +557,23 @@ Render::Render()
   , m_extraImage(NULL)
   , m_bgType(BgType::TRANSPARENT)
   , m_bgCheckedSize(16, 16)
+  , m_bgPatternColor1(0)
+  , m_bgPatternColor2(0)
   , m_globalOpacity(255)
   , m_selectedLayer(nullptr)
   , m_selectedFrame(-1)
   , m_previewImage(nullptr)
   , m_previewBlendMode(BlendMode::NORMAL)
   , m_onionskin(OnionskinType::NONE)
+  , m_parallel(false)
+  , m_cache(nullptr)
+  , m_onionskinCache(nullptr)
+  , m_cacheLayer(nullptr)
+  , m_cacheStage(CacheStage::ALL)
+  , m_passedCacheLayer(false)
+  , m_occluder(nullptr)
+  , m_occluderFrame(-1)
+  , m_passedOccluder(false)
 {
 }
 
@@ -526,6 +650,61 @@ void Render::disableOnionskin()
   m_onionskin.type(OnionskinType::NONE);
 }
 
+void Render::setParallel(bool state)
+{
+  m_parallel = state;
+}
+
+void Render::setRenderCache(RenderCache* cache, const Layer* activeLayer)
+{
+  m_cache = cache;
+  m_cacheLayer = activeLayer;
+}
+
+void Render::setOnionskinCache(OnionskinCache* cache)
+{
+  m_onionskinCache = cache;
+}
+
+bool Render::renderTilesInParallel(const gfx::Clip& area,
+                                   const RenderTileFunc& renderTile)
+{
+  // Minimum number of pixels/rows that are worth to send to a worker
+  const int kMinParallelPixels = 256*256;
+  const int kMinTileRows = 16;
+
+  if (!m_parallel ||
+      area.size.w * area.size.h < kMinParallelPixels)
+    return false;
+
+  base::thread_pool& pool = base::thread_pool::instance();
+  if (pool.concurrency() < 2)
+    return false;
+
+  // More tiles than threads to balance areas with different
+  // number/sizes of cels
+  int tiles = std::min(pool.concurrency()*4,
+                       area.size.h / kMinTileRows);
+  if (tiles < 2)
+    return false;
+
+  pool.parallel_for(tiles, [this, &area, &renderTile, tiles](int i){
+      const int y1 = area.size.h * i / tiles;
+      const int y2 = area.size.h * (i+1) / tiles;
+
+      // Each tile modifies its own Render state (e.g. m_globalOpacity)
+      Render tileRender(*this);
+      tileRender.m_parallel = false;
+      tileRender.m_cache = nullptr;
+
+      renderTile(tileRender,
+                 gfx::Clip(area.dst.x, area.dst.y+y1,
+                           area.src.x, area.src.y+y1,
+                           area.size.w, y2-y1));
+    });
+  return true;
+}
+
 void Render::renderSprite(
   Image* dstImage,
   const Sprite* sprite,
@@ -562,6 +741,13 @@ void Render::renderLayer(
 {
   m_sprite = layer->sprite();
 
+  if (renderTilesInParallel(
+        area,
+        [dstImage, layer, frame, blendMode](Render& render, const gfx::Clip& tile){
+          render.renderLayer(dstImage, layer, frame, tile, blendMode);
+        }))
+    return;
+
   CompositeImageFunc compositeImage =
     get_image_composition(
       dstImage->pixelFormat(),
@@ -583,8 +769,32 @@ void Render::renderSprite(
   const gfx::Clip& area,
   Zoom zoom)
 {
+  TRACE_SPAN("Render::renderSprite");
   m_sprite = sprite;
 
+  if (renderSpriteWithCache(dstImage, area, frame, zoom))
+    return;
+
+  prepareOnionskinCache(dstImage->pixelFormat(), area, frame, zoom);
+  if (m_bgType == BgType::CHECKED)
+    prepareCheckedPattern(dstImage->pixelFormat(), zoom);
+
+  if (renderTilesInParallel(
+        area,
+        [dstImage, frame, zoom](Render& render, const gfx::Clip& tile){
+          render.renderSpriteArea(dstImage, frame, tile, zoom);
+        }))
+    return;
+
+  renderSpriteArea(dstImage, frame, area, zoom);
+}
+
+void Render::renderSpriteArea(
+  Image* dstImage,
+  frame_t frame,
+  const gfx::Clip& area,
+  Zoom zoom)
+{
   CompositeImageFunc compositeImage =
     get_image_composition(
       dstImage->pixelFormat(),
@@ -607,8 +817,14 @@ void Render::renderSprite(
     }
   }
 
+  // Layers (and the background) below an opaque cel that covers the
+  // whole area are not rendered
+  m_occluder = findOccluder(area, frame, zoom);
+  m_occluderFrame = frame;
+  m_passedOccluder = false;
+
   // Draw checked background
-  switch (m_bgType) {
+  switch (m_occluder ? BgType::NONE: m_bgType) {
 
     case BgType::CHECKED:
       if (bgLayer && bgLayer->isVisible() && rgba_geta(bg_color) == 255) {
@@ -632,6 +848,7 @@ void Render::renderSprite(
 
   // Draw the background layer.
   m_globalOpacity = 255;
+  m_passedCacheLayer = false;
   renderLayer(
     m_sprite->folder(), dstImage,
     area, frame, zoom, compositeImage,
@@ -645,6 +862,7 @@ void Render::renderSprite(
 
   // Draw the transparent layers.
   m_globalOpacity = 255;
+  m_passedCacheLayer = false;
   renderLayer(
     m_sprite->folder(), dstImage,
     area, frame, zoom, compositeImage,
@@ -656,8 +874,11 @@ void Render::renderSprite(
   if (m_onionskin.position() == OnionskinPosition::INFRONT)
     renderOnionskin(dstImage, area, frame, zoom, compositeImage);
 
+  m_occluder = nullptr;
+
   // Overlay preview image
   if (m_previewImage &&
+      m_cacheStage != CacheStage::BELOW_ACTIVE &&
       m_selectedLayer == nullptr &&
       m_selectedFrame == frame) {
     renderImage(
@@ -674,18 +895,295 @@ void Render::renderSprite(
   }
 }
 
-void Render::renderOnionskin(
-  Image* dstImage,
-  const gfx::Clip& area,
-  frame_t frame, Zoom zoom,
-  CompositeImageFunc compositeImage)
+bool Render::renderSpriteWithCache(Image* dstImage,
+                                   const gfx::Clip& area,
+                                   frame_t frame, Zoom zoom)
+{
+  if (!canUseRenderCache(frame))
+    return false;
+
+  // The cache key is generated in each call, it's cheaper than
+  // compositing all layers below the active one again.
+  RenderCache::Key key;
+  makeRenderCacheKey(key, m_sprite, dstImage->pixelFormat(), frame, zoom);
+  addLayersToKey(key, m_sprite, frame, m_cacheLayer);
+
+  const gfx::Rect bounds = area.srcBounds();
+  const Image* cached = m_cache->get(key, bounds);
+  if (!cached) {
+    Image* image = m_cache->reset(key, bounds, dstImage->pixelFormat());
+
+    Render below(*this);
+    below.m_cache = nullptr;
+    below.m_cacheStage = CacheStage::BELOW_ACTIVE;
+    below.renderSprite(image, m_sprite, frame,
+                       gfx::Clip(0, 0, m_cache->bounds()), zoom);
+    cached = image;
+  }
+
+  const gfx::Rect& cacheBounds = m_cache->bounds();
+  dstImage->copy(cached,
+                 gfx::Clip(area.dst.x, area.dst.y,
+                           bounds.x - cacheBounds.x,
+                           bounds.y - cacheBounds.y,
+                           bounds.w, bounds.h));
+
+  // The background is already in the cached image
+  Render above(*this);
+  above.m_cache = nullptr;
+  above.m_cacheStage = CacheStage::FROM_ACTIVE;
+  above.m_bgType = BgType::NONE;
+  above.renderSprite(dstImage, m_sprite, frame, area, zoom);
+  return true;
+}
+
+bool Render::canUseRenderCache(frame_t frame) const
+{
+  if (!m_cache ||
+      !m_cacheLayer ||
+      m_cacheLayer->sprite() != m_sprite ||
+      m_cacheLayer->isBackground() ||
+      m_onionskin.type() != OnionskinType::NONE)
+    return false;
+
+  // Extra cels and preview images must be in the active layer (or
+  // above), they change too frequently to be cached.
+  if (m_extraCel && m_extraType != ExtraType::NONE &&
+      m_currentLayer != m_cacheLayer)
+    return false;
+
+  if (m_previewImage &&
+      m_selectedLayer &&
+      m_selectedLayer != m_cacheLayer &&
+      m_selectedFrame == frame)
+    return false;
+
+  // The active layer must be reachable by renderLayer()
+  for (const Layer* parent = m_cacheLayer->parent();
+       parent; parent = parent->parent()) {
+    if (!parent->isVisible())
+      return false;
+  }
+  return true;
+}
+
+const Layer* Render::findOccluder(const gfx::Clip& area,
+                                  frame_t frame, Zoom zoom) const
+{
+  const gfx::Rect bounds = area.srcBounds();
+  const LayerList& layers = m_sprite->allLayers();
+  auto end = layers.end();
+
+  // The cached image can only include the layers below the active one
+  if (m_cacheStage == CacheStage::BELOW_ACTIVE)
+    end = std::find(layers.begin(), layers.end(), m_cacheLayer);
+
+  // Layers from top to bottom (image layers are composited in the
+  // same order as they appear in the flattened list)
+  for (auto it = std::make_reverse_iterator(end),
+         rend = layers.rend(); it != rend; ++it) {
+    const Layer* layer = *it;
+    if (!layer->isImage())
+      continue;
+
+    bool visible = true;
+    for (const Layer* l = layer; l && visible; l = l->parent())
+      visible = l->isVisible();
+    if (!visible)
+      continue;
+
+    auto cel = layer->cel(frame);
+    if (!cel || !cel->image())
+      continue;
+
+    // Preview images and extra cels replace the cel pixels
+    if ((m_previewImage && m_selectedLayer == layer && m_selectedFrame == frame) ||
+        (m_extraCel && m_extraType != ExtraType::NONE && m_currentLayer == layer))
+      return nullptr;
+
+    const LayerImage* imgLayer = static_cast<const LayerImage*>(layer);
+    const Image* image = cel->image();
+    const gfx::Rect celBounds(
+      zoom.apply(cel->x()), zoom.apply(cel->y()),
+      zoom.apply(image->width()), zoom.apply(image->height()));
+
+    if (imgLayer->blendMode() != BlendMode::NORMAL ||
+        imgLayer->opacity() < 255 ||
+        cel->opacity() < 255 ||
+        !celBounds.contains(bounds)) {
+      // Only a cel without pixels in this area can be ignored
+      if (!celBounds.intersects(bounds))
+        continue;
+      return nullptr;
+    }
+
+    if (!get_image_content(image).opaque ||
+        (image->pixelFormat() == IMAGE_INDEXED &&
+         m_sprite->palette(frame)->hasAlpha())) {
+      return nullptr;
+    }
+    return layer;
+  }
+  return nullptr;
+}
+
+void Render::makeRenderCacheKey(std::vector<uint32_t>& key,
+                                const Sprite* sprite,
+                                PixelFormat dstFormat,
+                                frame_t frame, Zoom zoom) const
+{
+  key.push_back(uint32_t(dstFormat));
+  key.push_back(uint32_t(frame));
+  key.push_back(uint32_t(zoom.apply(1 << 16)));
+  key.push_back(uint32_t(zoom.remove(1 << 16)));
+
+  key.push_back(uint32_t(m_bgType));
+  key.push_back(uint32_t(m_bgZoom));
+  key.push_back(uint32_t(m_bgColor1));
+  key.push_back(uint32_t(m_bgColor2));
+  key.push_back(uint32_t(m_bgCheckedSize.w));
+  key.push_back(uint32_t(m_bgCheckedSize.h));
+
+  key.push_back(sprite->id());
+  key.push_back(sprite->version());
+  key.push_back(uint32_t(sprite->pixelFormat()));
+  key.push_back(uint32_t(sprite->transparentColor()));
+
+  // Indexed images are rendered with the palette (the palette version
+  // is not incremented when the sprite is modified by the scripting
+  // API, so we compare all the entries).
+  if (sprite->pixelFormat() == IMAGE_INDEXED) {
+    const Palette* pal = sprite->palette(frame);
+    key.push_back(uint32_t(pal->size()));
+    for (int i=0; i<pal->size(); ++i)
+      key.push_back(pal->getEntry(i));
+  }
+}
+
+void Render::makeRenderKey(std::vector<uint32_t>& key,
+                           const Sprite* sprite,
+                           PixelFormat dstFormat,
+                           frame_t frame, Zoom zoom) const
+{
+  makeRenderCacheKey(key, sprite, dstFormat, frame, zoom);
+  addLayersToKey(key, sprite, frame, nullptr);
+
+  // Onion skin frames
+  key.push_back(uint32_t(m_onionskin.type()));
+  if (m_onionskin.type() != OnionskinType::NONE) {
+    key.push_back(uint32_t(m_onionskin.position()));
+    key.push_back(uint32_t(m_onionskin.prevFrames()));
+    key.push_back(uint32_t(m_onionskin.nextFrames()));
+    key.push_back(uint32_t(m_onionskin.opacityBase()));
+    key.push_back(uint32_t(m_onionskin.opacityStep()));
+    key.push_back(m_onionskin.loopTag() ? m_onionskin.loopTag()->id(): 0);
+    key.push_back(m_onionskin.layer() ? m_onionskin.layer()->id(): 0);
+
+    for (frame_t f = frame - m_onionskin.prevFrames();
+         f <= frame + m_onionskin.nextFrames(); ++f) {
+      if (f != frame && f >= 0 && f <= sprite->lastFrame())
+        addLayersToKey(key, sprite, f, nullptr);
+    }
+  }
+
+  // The extra cel/preview image are compared by identity, their
+  // pixels are modified frequently (without object versions) so
+  // users of this key must invalidate them when they are notified.
+  key.push_back(uint32_t(m_extraType));
+  if (m_extraType != ExtraType::NONE && m_extraCel && m_extraImage) {
+    key.push_back(m_extraCel->id());
+    key.push_back(m_extraImage->id());
+    key.push_back(uint32_t(m_extraCel->x()));
+    key.push_back(uint32_t(m_extraCel->y()));
+    key.push_back(uint32_t(m_extraCel->frame()));
+    key.push_back(uint32_t(m_extraCel->opacity()));
+    key.push_back(uint32_t(m_extraBlendMode));
+    key.push_back(m_currentLayer ? m_currentLayer->id(): 0);
+    key.push_back(uint32_t(m_currentFrame));
+  }
+  if (m_previewImage) {
+    key.push_back(m_previewImage->id());
+    key.push_back(m_selectedLayer ? m_selectedLayer->id(): 0);
+    key.push_back(uint32_t(m_selectedFrame));
+    key.push_back(uint32_t(m_previewPos.x));
+    key.push_back(uint32_t(m_previewPos.y));
+    key.push_back(uint32_t(m_previewBlendMode));
+  }
+}
+
+void Render::addLayersToKey(std::vector<uint32_t>& key,
+                            const Sprite* sprite,
+                            frame_t frame,
+                            const Layer* stopLayer) const
+{
+  key.push_back(uint32_t(frame));
+
+  // Layers in the same order that renderLayer() visits them (until
+  // the "stopLayer" is found).
+  std::vector<const Layer*> layers(1, sprite->folder());
+  while (!layers.empty()) {
+    const Layer* layer = layers.back();
+    layers.pop_back();
+    if (layer == stopLayer)
+      break;
+
+    key.push_back(layer->id());
+    key.push_back(layer->version());
+    key.push_back(uint32_t(layer->flags()));
+
+    if (!layer->isVisible())
+      continue;
+
+    switch (layer->type()) {
+
+      case ObjectType::LayerImage: {
+        const LayerImage* imgLayer = static_cast<const LayerImage*>(layer);
+        key.push_back(uint32_t(imgLayer->blendMode()));
+        key.push_back(uint32_t(imgLayer->opacity()));
+
+        auto cel = layer->cel(frame);
+        if (cel) {
+          key.push_back(cel->id());
+          key.push_back(cel->version());
+          key.push_back(uint32_t(cel->x()));
+          key.push_back(uint32_t(cel->y()));
+          key.push_back(uint32_t(cel->opacity()));
+
+          const Image* image = cel->image();
+          if (image) {
+            key.push_back(image->id());
+            key.push_back(image->version());
+            key.push_back(uint32_t(image->width()));
+            key.push_back(uint32_t(image->height()));
+          }
+        }
+        else
+          key.push_back(0);
+        break;
+      }
+
+      case ObjectType::LayerFolder: {
+        // Push children in reverse order so the first one is visited
+        // first.
+        const LayerFolder* folder = static_cast<const LayerFolder*>(layer);
+        key.push_back(uint32_t(folder->getLayersCount()));
+        layers.insert(layers.end(),
+                      std::reverse_iterator<LayerConstIterator>(folder->getLayerEnd()),
+                      std::reverse_iterator<LayerConstIterator>(folder->getLayerBegin()));
+        break;
+      }
+
+    }
+  }
+}
+
+void Render::forEachOnionskinFrame(frame_t frame,
+                                   const OnionskinFrameFunc& func)
 {
   // Onion-skin feature: Draw previous/next frames with different
   // opacity (<255)
   if (m_onionskin.type() != OnionskinType::NONE) {
     FrameTag* loop = m_onionskin.loopTag();
-    Layer* onionLayer = (m_onionskin.layer() ? m_onionskin.layer():
-                                               m_sprite->folder());
     frame_t frameIn;
 
     for (frame_t frameOut = frame - m_onionskin.prevFrames();
@@ -708,40 +1206,225 @@ void Render::renderOnionskin(
         continue;
       }
 
+      int opacity;
       if (frameOut < frame) {
-        m_globalOpacity = m_onionskin.opacityBase() - m_onionskin.opacityStep() * ((frame - frameOut)-1);
+        opacity = m_onionskin.opacityBase() - m_onionskin.opacityStep() * ((frame - frameOut)-1);
       }
       else {
-        m_globalOpacity = m_onionskin.opacityBase() - m_onionskin.opacityStep() * ((frameOut - frame)-1);
+        opacity = m_onionskin.opacityBase() - m_onionskin.opacityStep() * ((frameOut - frame)-1);
       }
 
-      m_globalOpacity = MID(0, m_globalOpacity, 255);
-      if (m_globalOpacity > 0) {
+      opacity = MID(0, opacity, 255);
+      if (opacity > 0) {
         BlendMode blendMode = BlendMode::UNSPECIFIED;
         if (m_onionskin.type() == OnionskinType::MERGE)
           blendMode = BlendMode::NORMAL;
         else if (m_onionskin.type() == OnionskinType::RED_BLUE_TINT)
           blendMode = (frameOut < frame ? BlendMode::RED_TINT: BlendMode::BLUE_TINT);
 
+        func(frameIn, opacity, blendMode,
+             // Render background only for "in-front" onion skinning and
+             // when opacity is < 255
+             (opacity < 255 &&
+              m_onionskin.position() == OnionskinPosition::INFRONT));
+      }
+    }
+  }
+}
+
+void Render::renderOnionskin(
+  Image* dstImage,
+  const gfx::Clip& area,
+  frame_t frame, Zoom zoom,
+  CompositeImageFunc compositeImage)
+{
+  const Layer* onionLayer = (m_onionskin.layer() ? m_onionskin.layer():
+                                                   m_sprite->folder());
+
+  forEachOnionskinFrame(
+    frame,
+    [&](frame_t frameIn, int opacity, BlendMode blendMode, bool renderBackground) {
+      m_globalOpacity = opacity;
+
+      if (!renderOnionskinFrameWithCache(
+            dstImage, area, frameIn, zoom,
+            renderBackground, blendMode)) {
         renderLayer(
           onionLayer, dstImage,
           area, frameIn, zoom, compositeImage,
-          // Render background only for "in-front" onion skinning and
-          // when opacity is < 255
-          (m_globalOpacity < 255 &&
-           m_onionskin.position() == OnionskinPosition::INFRONT),
+          renderBackground,
           true,
           blendMode);
       }
+    });
+}
+
+void Render::prepareOnionskinCache(PixelFormat dstFormat,
+                                   const gfx::Clip& area,
+                                   frame_t frame, Zoom zoom)
+{
+  if (!m_onionskinCache ||
+      m_onionskin.type() == OnionskinType::NONE ||
+      dstFormat != IMAGE_RGB)
+    return;
+
+  CompositeImageFunc compositeImage =
+    get_image_composition(IMAGE_RGB, m_sprite->pixelFormat(), zoom);
+  if (!compositeImage)
+    return;
+
+  const Layer* onionLayer = (m_onionskin.layer() ? m_onionskin.layer():
+                                                   m_sprite->folder());
+  const gfx::Rect bounds = area.srcBounds();
+  std::set<int> usedEntries;
+
+  forEachOnionskinFrame(
+    frame,
+    [&](frame_t frameIn, int opacity, BlendMode blendMode, bool renderBackground) {
+      // The preview image is modified without versions
+      if (m_previewImage && m_selectedFrame == frameIn)
+        return;
+
+      if (!canCacheOnionskinFrame(onionLayer, frameIn, renderBackground))
+        return;
+
+      const int entry = frameIn*2 + (renderBackground ? 1: 0);
+      RenderCache& cache = m_onionskinCache->entry(entry);
+      usedEntries.insert(entry);
+
+      RenderCache::Key key;
+      makeOnionskinCacheKey(key, frameIn, zoom, onionLayer, renderBackground);
+      if (cache.get(key, bounds))
+        return;
+
+      Image* image = cache.reset(key, bounds, IMAGE_RGB);
+      clear_image(image, 0);
+
+      Render flatten(*this);
+      flatten.m_parallel = false;
+      flatten.m_cache = nullptr;
+      flatten.m_onionskinCache = nullptr;
+      flatten.m_globalOpacity = 255;
+      flatten.renderLayer(
+        onionLayer, image,
+        gfx::Clip(0, 0, cache.bounds()),
+        frameIn, zoom, compositeImage,
+        renderBackground, true,
+        BlendMode::UNSPECIFIED);
+    });
+
+  m_onionskinCache->keepEntries(usedEntries);
+}
+
+// The flattened frame is composited with the onion skin opacity and
+// blend mode, which gives the same result as compositing each layer
+// only if the frame has (at most) one cel, and it's composited with
+// the normal blend mode and full opacity (so the flattened image has
+// exactly the pixels of the cel).
+bool Render::canCacheOnionskinFrame(const Layer* onionLayer,
+                                    frame_t frame,
+                                    bool renderBackground) const
+{
+  // The extra cel is like other layer
+  if (m_extraCel && m_extraImage && m_currentFrame == frame)
+    return false;
+
+  int cels = 0;
+  std::vector<const Layer*> layers(1, onionLayer);
+  while (!layers.empty()) {
+    const Layer* layer = layers.back();
+    layers.pop_back();
+    if (!layer->isVisible())
+      continue;
+
+    switch (layer->type()) {
+
+      case ObjectType::LayerImage: {
+        if (!renderBackground && layer->isBackground())
+          break;
+
+        auto cel = layer->cel(frame);
+        if (!cel || !cel->image())
+          break;
+
+        const LayerImage* imgLayer = static_cast<const LayerImage*>(layer);
+        if (++cels > 1 ||
+            imgLayer->blendMode() != BlendMode::NORMAL ||
+            imgLayer->opacity() != 255 ||
+            cel->opacity() != 255)
+          return false;
+        break;
+      }
+
+      case ObjectType::LayerFolder: {
+        const LayerFolder* folder = static_cast<const LayerFolder*>(layer);
+        layers.insert(layers.end(),
+                      folder->getLayerBegin(),
+                      folder->getLayerEnd());
+        break;
+      }
+
     }
   }
+  return true;
 }
 
-void Render::renderBackground(Image* image,
+void Render::makeOnionskinCacheKey(std::vector<uint32_t>& key,
+                                   frame_t frame, Zoom zoom,
+                                   const Layer* onionLayer,
+                                   bool renderBackground) const
+{
+  makeRenderCacheKey(key, m_sprite, IMAGE_RGB, frame, zoom);
+  addLayersToKey(key, m_sprite, frame, nullptr);
+  key.push_back(onionLayer->id());
+  key.push_back(renderBackground ? 1: 0);
+}
+
+bool Render::renderOnionskinFrameWithCache(
+  Image* dstImage,
   const gfx::Clip& area,
-  Zoom zoom)
+  frame_t frame, Zoom zoom,
+  bool renderBackground,
+  BlendMode blendMode)
+{
+  if (!m_onionskinCache ||
+      dstImage->pixelFormat() != IMAGE_RGB ||
+      (m_previewImage && m_selectedFrame == frame))
+    return false;
+
+  // The cache is filled by prepareOnionskinCache() before the
+  // rendering starts (the tiles of renderTilesInParallel() only
+  // read it).
+  const RenderCache* cache =
+    m_onionskinCache->findEntry(frame*2 + (renderBackground ? 1: 0));
+  if (!cache)
+    return false;
+
+  const Layer* onionLayer = (m_onionskin.layer() ? m_onionskin.layer():
+                                                   m_sprite->folder());
+  RenderCache::Key key;
+  makeOnionskinCacheKey(key, frame, zoom, onionLayer, renderBackground);
+
+  const gfx::Rect bounds = area.srcBounds();
+  const Image* cached = cache->get(key, bounds);
+  if (!cached)
+    return false;
+
+  CompositeImageFunc compositeImage =
+    get_image_composition(IMAGE_RGB, IMAGE_RGB, Zoom(1, 1));
+  const gfx::Rect& cacheBounds = cache->bounds();
+  compositeImage(dstImage, cached, m_sprite->palette(frame),
+                 gfx::Clip(area.dst.x, area.dst.y,
+                           bounds.x - cacheBounds.x,
+                           bounds.y - cacheBounds.y,
+                           bounds.w, bounds.h),
+                 m_globalOpacity,
+                 blendMode, Zoom(1, 1));
+  return true;
+}
+
+gfx::Size Render::checkedTileSize(Zoom zoom) const
 {
-  int x, y, u, v;
   int tile_w = m_bgCheckedSize.w;
   int tile_h = m_bgCheckedSize.h;
 
@@ -757,29 +1440,73 @@ void Render::renderBackground(Image* image,
   if (tile_w < 1) tile_w = 1;
   if (tile_h < 1) tile_h = 1;
 
-  // Tile position (u,v) is the number of tile we start in "area.src" coordinate
-  u = (area.src.x / tile_w);
-  v = (area.src.y / tile_h);
+  return gfx::Size(tile_w, tile_h);
+}
 
-  // Position where we start drawing the first tile in "image"
-  int x_start = -(area.src.x % tile_w);
-  int y_start = -(area.src.y % tile_h);
+void Render::prepareCheckedPattern(PixelFormat pixelFormat, Zoom zoom)
+{
+  const gfx::Size tileSize = checkedTileSize(zoom);
 
-  gfx::Rect dstBounds = area.dstBounds();
+  if (m_bgPattern &&
+      m_bgPattern->pixelFormat() == pixelFormat &&
+      m_bgPattern->width() == 2*tileSize.w &&
+      m_bgPatternColor1 == m_bgColor1 &&
+      m_bgPatternColor2 == m_bgColor2)
+    return;
+
+  // Two rows: the first one starts with a m_bgColor1 tile, the second
+  // one with m_bgColor2. The checked background is a copy of these
+  // rows.
+  m_bgPattern.reset(Image::create(pixelFormat, 2*tileSize.w, 2));
+  fill_rect(m_bgPattern.get(), 0, 0, tileSize.w-1, 0, m_bgColor1);
+  fill_rect(m_bgPattern.get(), tileSize.w, 0, 2*tileSize.w-1, 0, m_bgColor2);
+  fill_rect(m_bgPattern.get(), 0, 1, tileSize.w-1, 1, m_bgColor2);
+  fill_rect(m_bgPattern.get(), tileSize.w, 1, 2*tileSize.w-1, 1, m_bgColor1);
+  m_bgPatternColor1 = m_bgColor1;
+  m_bgPatternColor2 = m_bgColor2;
+}
+
+void Render::renderBackground(Image* image,
+  const gfx::Clip& area,
+  Zoom zoom)
+{
+  const gfx::Size tileSize = checkedTileSize(zoom);
+  const int tile_w = tileSize.w;
+  const int tile_h = tileSize.h;
+
+  gfx::Rect dstBounds = area.dstBounds().createIntersection(image->bounds());
+  if (dstBounds.isEmpty())
+    return;
+
+  prepareCheckedPattern(image->pixelFormat(), zoom);
 
-  // Draw checked background (tile by tile)
-  int u_start = u;
-  for (y=y_start-tile_h; y<image->height()+tile_h; y+=tile_h) {
-    for (x=x_start-tile_w; x<image->width()+tile_w; x+=tile_w) {
-      gfx::Rect fillRc = dstBounds.createIntersection(gfx::Rect(x, y, tile_w, tile_h));
-      if (!fillRc.isEmpty())
-        fill_rect(
-          image, fillRc.x, fillRc.y, fillRc.x+fillRc.w-1, fillRc.y+fillRc.h-1,
-          (((u+v))&1)? m_bgColor2: m_bgColor1);
-      ++u;
+  // Tile position (u,v) is the number of tile we start in "area.src" coordinate
+  const int u = (area.src.x / tile_w);
+  const int v = (area.src.y / tile_h);
+
+  // Position where we start drawing the first tile in "image"
+  const int x_start = -(area.src.x % tile_w);
+  const int y_start = -(area.src.y % tile_h);
+
+  // Copy each row of the pattern (the first pixel of the row is at
+  // "px" in the pattern row)
+  const int pattern_w = 2*tile_w;
+  const int bpp = image->getRowStrideSize(1);
+  const int px = (dstBounds.x - x_start + tile_w + (u & 1)*tile_w) % pattern_w;
+
+  for (int y=dstBounds.y; y<dstBounds.y+dstBounds.h; ++y) {
+    const int row = (((y - y_start + tile_h) / tile_h) + v) & 1;
+    const uint8_t* src = m_bgPattern->getPixelAddress(0, row);
+    uint8_t* dst = image->getPixelAddress(dstBounds.x, y);
+
+    int x = px;
+    for (int w=dstBounds.w; w > 0; ) {
+      const int n = std::min(w, pattern_w - x);
+      std::copy(src + x*bpp, src + (x+n)*bpp, dst);
+      dst += n*bpp;
+      w -= n;
+      x = 0;
     }
-    u = u_start;
-    ++v;
   }
 }
 
@@ -811,6 +1538,13 @@ void Render::renderLayer(
   bool render_transparent,
   BlendMode blendMode)
 {
+  // Skip the layers that are (or will be) in the RenderCache
+  if (layer == m_cacheLayer)
+    m_passedCacheLayer = true;
+
+  if (m_cacheStage == CacheStage::BELOW_ACTIVE && m_passedCacheLayer)
+    return;
+
   // we can't read from this layer
   if (!layer->isVisible())
     return;
@@ -845,6 +1579,16 @@ void Render::renderLayer(
           (!render_transparent && !layer->isBackground()))
         break;
 
+      // Skip the layers covered by the occluder
+      if (m_occluder && frame == m_occluderFrame && !m_passedOccluder) {
+        if (layer != m_occluder)
+          break;
+        m_passedOccluder = true;
+      }
+
+      if (m_cacheStage == CacheStage::FROM_ACTIVE && !m_passedCacheLayer)
+        break;
+
       auto cel = layer->cel(frame);
       if (cel) {
         Palette* pal = m_sprite->palette(frame);
@@ -901,12 +1645,36 @@ void Render::renderLayer(
             }
           }
           // Draw the whole cel
-          else {
+          else if (celImage == m_previewImage ||
+                   layerBlendMode == BlendMode::SRC) {
             renderCel(
               image, celImage, pal,
               celPos, area, compositeImage,
               opacity, layerBlendMode, zoom);
           }
+          // Draw just the non-transparent pixels of the cel (the
+          // transparent ones don't modify the destination)
+          else {
+            gfx::Rect content = get_image_content(celImage).bounds;
+            if (!content.isEmpty()) {
+              if (zoom.scale() >= 1.0) {
+                gfx::Rect rc = zoom.apply(content.offset(celPos));
+                rc &= area.srcBounds();
+                if (!rc.isEmpty())
+                  renderCel(
+                    image, celImage, pal, celPos,
+                    gfx::Clip(area.dst.x+rc.x-area.src.x,
+                              area.dst.y+rc.y-area.src.y, rc), compositeImage,
+                    opacity, layerBlendMode, zoom);
+              }
+              else {
+                renderCel(
+                  image, celImage, pal,
+                  celPos, area, compositeImage,
+                  opacity, layerBlendMode, zoom);
+              }
+            }
+          }
         }
       }
       break;
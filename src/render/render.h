@@ -10,6 +10,7 @@
 #include "doc/blend_mode.h"
 #include "doc/color.h"
 #include "doc/frame.h"
+#include "doc/image_ref.h"
 #include "doc/pixel_format.h"
 #include "gfx/point.h"
 #include "gfx/size.h"
@@ -17,6 +18,10 @@
 #include "render/onionskin_position.h"
 #include "render/zoom.h"
 
+#include <cstdint>
+#include <functional>
+#include <vector>
+
 namespace gfx {
   class Clip;
 }
@@ -33,6 +38,9 @@ namespace doc {
 namespace render {
   using namespace doc;
 
+  class OnionskinCache;
+  class RenderCache;
+
   enum class BgType {
     NONE,
     TRANSPARENT,
@@ -128,6 +136,23 @@ namespace render {
     void setOnionskin(const OnionskinOptions& options);
     void disableOnionskin();
 
+    // Splits the area to render in horizontal tiles which are
+    // composited in parallel using the shared base::thread_pool.
+    // Small areas are rendered in the calling thread anyway.
+    void setParallel(bool state);
+
+    // Uses the given cache to store the flattened image of all layers
+    // below "activeLayer", so only the active layer and the layers
+    // above it are composited while the active layer is being
+    // modified. Use nullptr to disable the cache.
+    void setRenderCache(RenderCache* cache, const Layer* activeLayer);
+
+    // Uses the given cache to store the flattened neighbor frames
+    // displayed with the onion skin (only for RGB destinations). The
+    // onion skin opacity/tint is applied to the flattened frame
+    // instead of to each layer.
+    void setOnionskinCache(OnionskinCache* cache);
+
     void renderSprite(
       Image* dstImage,
       const Sprite* sprite,
@@ -151,6 +176,18 @@ namespace render {
       const gfx::Clip& area,
       BlendMode blendMode = BlendMode::UNSPECIFIED);
 
+    // Generates a key that identifies the image generated by
+    // renderSprite() with the current configuration (object versions
+    // of each layer/cel/image, background, onion skin, etc.). The
+    // pixels of the extra cel and preview image are not part of the
+    // key (only their identity).
+    void makeRenderKey(std::vector<uint32_t>& key,
+                       const Sprite* sprite,
+                       PixelFormat dstFormat,
+                       frame_t frame, Zoom zoom) const;
+
+    const Image* previewImage() const { return m_previewImage; }
+
     // Main function used to render the sprite. Draws the given sprite
     // frame in a new image and return it. Note: zoomedRect must have
     // the zoom applied (zoomedRect = zoom.apply(spriteRect)).
@@ -171,12 +208,79 @@ namespace render {
       int opacity, BlendMode blendMode);
 
   private:
+    typedef std::function<void(Render&, const gfx::Clip&)> RenderTileFunc;
+
+    // Layers rendered by the renderSprite() when the RenderCache is used
+    enum class CacheStage {
+      ALL,                      // All layers (cache not used)
+      BELOW_ACTIVE,             // Layers below the active layer
+      FROM_ACTIVE,              // The active layer and the ones above
+    };
+
+    // Returns true if the area was rendered in tiles by the thread
+    // pool (each tile with its own copy of this Render instance).
+    bool renderTilesInParallel(const gfx::Clip& area,
+                               const RenderTileFunc& renderTile);
+
+    gfx::Size checkedTileSize(Zoom zoom) const;
+    void prepareCheckedPattern(PixelFormat pixelFormat, Zoom zoom);
+
+    void renderSpriteArea(
+      Image* dstImage,
+      frame_t frame,
+      const gfx::Clip& area,
+      Zoom zoom);
+
+    // Returns true if the sprite was rendered using the RenderCache.
+    bool renderSpriteWithCache(Image* dstImage,
+                               const gfx::Clip& area,
+                               frame_t frame, Zoom zoom);
+    bool canUseRenderCache(frame_t frame) const;
+
+    // Returns the top-most layer whose cel covers the whole area with
+    // opaque pixels (the layers below it aren't visible), or nullptr.
+    const Layer* findOccluder(const gfx::Clip& area,
+                              frame_t frame, Zoom zoom) const;
+    void makeRenderCacheKey(std::vector<uint32_t>& key,
+                            const Sprite* sprite,
+                            PixelFormat dstFormat,
+                            frame_t frame, Zoom zoom) const;
+    void addLayersToKey(std::vector<uint32_t>& key,
+                        const Sprite* sprite,
+                        frame_t frame,
+                        const Layer* stopLayer) const;
+
     void renderOnionskin(
       Image* image,
       const gfx::Clip& area,
       frame_t frame, Zoom zoom,
       CompositeImageFunc compositeImage);
 
+    typedef std::function<void(frame_t frame, int opacity,
+                               BlendMode blendMode,
+                               bool renderBackground)> OnionskinFrameFunc;
+    void forEachOnionskinFrame(frame_t frame,
+                               const OnionskinFrameFunc& func);
+
+    // Renders the flattened onion skin frames in the OnionskinCache
+    // (if its needed) before renderSpriteArea() is called.
+    void prepareOnionskinCache(PixelFormat dstFormat,
+                               const gfx::Clip& area,
+                               frame_t frame, Zoom zoom);
+    bool canCacheOnionskinFrame(const Layer* onionLayer,
+                                frame_t frame,
+                                bool renderBackground) const;
+    void makeOnionskinCacheKey(std::vector<uint32_t>& key,
+                               frame_t frame, Zoom zoom,
+                               const Layer* onionLayer,
+                               bool renderBackground) const;
+    bool renderOnionskinFrameWithCache(
+      Image* image,
+      const gfx::Clip& area,
+      frame_t frame, Zoom zoom,
+      bool renderBackground,
+      BlendMode blendMode);
+
     void renderLayer(
       const Layer* layer,
       Image* image,
@@ -219,6 +323,9 @@ namespace render {
     color_t m_bgColor1;
     color_t m_bgColor2;
     gfx::Size m_bgCheckedSize;
+    ImageRef m_bgPattern;       // Rows of the checked background
+    color_t m_bgPatternColor1;
+    color_t m_bgPatternColor2;
     int m_globalOpacity;
     const Layer* m_selectedLayer;
     frame_t m_selectedFrame;
@@ -226,6 +333,15 @@ namespace render {
     gfx::Point m_previewPos;
     BlendMode m_previewBlendMode;
     OnionskinOptions m_onionskin;
+    bool m_parallel;
+    RenderCache* m_cache;
+    OnionskinCache* m_onionskinCache;
+    const Layer* m_cacheLayer;
+    CacheStage m_cacheStage;
+    bool m_passedCacheLayer;
+    const Layer* m_occluder;    // Layers below this one are skipped
+    frame_t m_occluderFrame;
+    bool m_passedOccluder;
   };
 
   void composite_image(Image* dst,
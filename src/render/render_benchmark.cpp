@@ -0,0 +1,230 @@
+// LibreSprite Render Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+// Measures the throughput of Render::renderSprite() (in millions of
+// destination pixels per second) for several pixel formats, blend
+// modes, zoom levels, layer counts and onion skin settings. The
+// results are printed in CSV format (one line per case) so they can
+// be compared between builds:
+//
+//   render_benchmark [--seconds N] [--size WxH] [--parallel]
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/render.h"
+
+#include "doc/blend_mode.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "gfx/clip.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+
+using namespace doc;
+using namespace render;
+
+namespace {
+
+struct Options {
+  double seconds = 0.1;
+  int width = 256;
+  int height = 256;
+  bool parallel = false;
+};
+
+const char* pixel_format_name(PixelFormat format)
+{
+  switch (format) {
+    case IMAGE_RGB:       return "rgb";
+    case IMAGE_GRAYSCALE: return "grayscale";
+    case IMAGE_INDEXED:   return "indexed";
+    default:              return "unknown";
+  }
+}
+
+// Random semi-transparent pixels (so all blend modes have some work
+// to do), the same image is shared by each cel.
+ImageRef create_test_image(PixelFormat format, int w, int h)
+{
+  std::mt19937 rnd(w*h);
+  ImageRef image(Image::create(format, w, h));
+
+  for (int y=0; y<h; ++y) {
+    for (int x=0; x<w; ++x) {
+      uint32_t v = rnd();
+      color_t c = 0;
+      switch (format) {
+        case IMAGE_RGB:
+          c = rgba(v & 255, (v >> 8) & 255, (v >> 16) & 255, 64 + ((v >> 24) & 191));
+          break;
+        case IMAGE_GRAYSCALE:
+          c = graya(v & 255, 64 + ((v >> 8) & 191));
+          break;
+        case IMAGE_INDEXED:
+          c = v & 255;
+          break;
+        default:
+          break;
+      }
+      put_pixel(image.get(), x, y, c);
+    }
+  }
+  return image;
+}
+
+std::unique_ptr<Sprite> create_test_sprite(PixelFormat format, int w, int h,
+                                           int layers, BlendMode blendMode)
+{
+  std::unique_ptr<Sprite> sprite(new Sprite(format, w, h, 256));
+  const frame_t frames = 3;
+  sprite->setTotalFrames(frames);
+
+  Palette* palette = sprite->palette(0);
+  for (int i=0; i<palette->size(); ++i)
+    palette->setEntry(i, rgba(i, 255-i, (i*7) & 255, 255));
+
+  ImageRef image = create_test_image(format, w, h);
+  for (int i=0; i<layers; ++i) {
+    LayerImage* layer = new LayerImage(sprite.get());
+    // The bottom layer is always normal so the other ones have a
+    // backdrop to blend with.
+    if (i > 0)
+      layer->setBlendMode(blendMode);
+    for (frame_t frame=0; frame<frames; ++frame)
+      layer->addCel(std::make_shared<Cel>(frame, image));
+    sprite->folder()->addLayer(layer);
+  }
+  return sprite;
+}
+
+// Returns the MPix/s of the given case and the number of renders.
+double run_case(const Options& options, PixelFormat format,
+                BlendMode blendMode, const Zoom& zoom,
+                int layers, bool onionskin, int& iterations)
+{
+  // The destination has always the same size, and the sprite is
+  // big enough to fill it with the given zoom.
+  const int dw = options.width;
+  const int dh = options.height;
+  const int sw = std::max(1, zoom.remove(dw));
+  const int sh = std::max(1, zoom.remove(dh));
+
+  std::unique_ptr<Sprite> sprite = create_test_sprite(format, sw, sh, layers, blendMode);
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, dw, dh));
+
+  Render render;
+  render.setBgType(BgType::CHECKED);
+  render.setBgColor1(rgba(128, 128, 128, 255));
+  render.setBgColor2(rgba(192, 192, 192, 255));
+  render.setParallel(options.parallel);
+  if (onionskin) {
+    OnionskinOptions opts(OnionskinType::MERGE);
+    opts.prevFrames(1);
+    opts.nextFrames(1);
+    opts.opacityBase(68);
+    opts.opacityStep(28);
+    render.setOnionskin(opts);
+  }
+
+  const gfx::Clip area(0, 0, 0, 0, dw, dh);
+  typedef std::chrono::steady_clock clock;
+
+  // Warm up
+  render.renderSprite(dst.get(), sprite.get(), 1, area, zoom);
+
+  iterations = 0;
+  const clock::time_point start = clock::now();
+  double elapsed = 0.0;
+  do {
+    render.renderSprite(dst.get(), sprite.get(), 1, area, zoom);
+    ++iterations;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  } while (elapsed < options.seconds);
+
+  return double(dw) * dh * iterations / elapsed / 1000000.0;
+}
+
+bool parse_args(int argc, char** argv, Options& options)
+{
+  for (int i=1; i<argc; ++i) {
+    if (std::strcmp(argv[i], "--seconds") == 0 && i+1 < argc)
+      options.seconds = std::atof(argv[++i]);
+    else if (std::strcmp(argv[i], "--size") == 0 && i+1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+          options.width < 1 || options.height < 1)
+        return false;
+    }
+    else if (std::strcmp(argv[i], "--parallel") == 0)
+      options.parallel = true;
+    else
+      return false;
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parse_args(argc, argv, options)) {
+    std::fprintf(stderr, "Usage: %s [--seconds N] [--size WxH] [--parallel]\n", argv[0]);
+    return 1;
+  }
+
+  const PixelFormat formats[] = { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED };
+  const BlendMode blendModes[] = {
+    BlendMode::NORMAL,
+    BlendMode::MULTIPLY,
+    BlendMode::OVERLAY,
+    BlendMode::HSL_HUE,
+  };
+  const Zoom zooms[] = {
+    Zoom(1, 4), Zoom(1, 2), Zoom(1, 1), Zoom(2, 1), Zoom(8, 1)
+  };
+  const int layerCounts[] = { 1, 4 };
+
+  std::printf("format,blend_mode,zoom,layers,onionskin,width,height,iterations,mpix_per_sec\n");
+
+  for (PixelFormat format : formats) {
+    for (BlendMode blendMode : blendModes) {
+      for (const Zoom& zoom : zooms) {
+        for (int layers : layerCounts) {
+          // The blend mode of one layer isn't used
+          if (layers == 1 && blendMode != BlendMode::NORMAL)
+            continue;
+
+          for (bool onionskin : { false, true }) {
+            int iterations = 0;
+            double mpix = run_case(options, format, blendMode, zoom,
+                                   layers, onionskin, iterations);
+
+            std::printf("%s,%s,%g,%d,%d,%d,%d,%d,%.3f\n",
+                        pixel_format_name(format),
+                        blend_mode_to_string(blendMode).c_str(),
+                        zoom.scale(), layers, onionskin ? 1: 0,
+                        options.width, options.height,
+                        iterations, mpix);
+            std::fflush(stdout);
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
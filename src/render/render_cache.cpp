@@ -0,0 +1,95 @@
+// LibreSprite Render Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/render_cache.h"
+
+#include "base/mem_tags.h"
+#include "doc/image.h"
+
+namespace render {
+
+// Maximum number of cached pixels when the bounds are enlarged
+// (a 4K viewport).
+static const int kMaxCachedPixels = 4096*2160;
+
+RenderCache::RenderCache()
+{
+}
+
+const doc::Image* RenderCache::get(const Key& key, const gfx::Rect& bounds) const
+{
+  if (m_image &&
+      m_key == key &&
+      m_bounds.contains(bounds))
+    return m_image.get();
+  else
+    return nullptr;
+}
+
+doc::Image* RenderCache::reset(const Key& key, const gfx::Rect& bounds,
+                               doc::PixelFormat pixelFormat)
+{
+  gfx::Rect newBounds = bounds;
+  if (m_image && m_key == key) {
+    gfx::Rect united = m_bounds.createUnion(bounds);
+    if (united.w * united.h <= kMaxCachedPixels)
+      newBounds = united;
+  }
+
+  if (!m_image ||
+      m_image->pixelFormat() != pixelFormat ||
+      m_image->width() != newBounds.w ||
+      m_image->height() != newBounds.h) {
+    base::mem_tag_scope tag(base::mem_tag::render_cache);
+    m_image.reset(doc::Image::create(pixelFormat, newBounds.w, newBounds.h));
+  }
+
+  m_key = key;
+  m_bounds = newBounds;
+  return m_image.get();
+}
+
+void RenderCache::invalidate()
+{
+  m_key.clear();
+  m_bounds = gfx::Rect();
+  m_image.reset();
+}
+
+RenderCache& OnionskinCache::entry(int id)
+{
+  return m_entries[id];
+}
+
+const RenderCache* OnionskinCache::findEntry(int id) const
+{
+  auto it = m_entries.find(id);
+  if (it != m_entries.end())
+    return &it->second;
+  else
+    return nullptr;
+}
+
+void OnionskinCache::keepEntries(const std::set<int>& ids)
+{
+  for (auto it=m_entries.begin(); it!=m_entries.end(); ) {
+    if (ids.find(it->first) == ids.end())
+      it = m_entries.erase(it);
+    else
+      ++it;
+  }
+}
+
+void OnionskinCache::invalidate()
+{
+  m_entries.clear();
+}
+
+} // namespace render
@@ -0,0 +1,77 @@
+// LibreSprite Render Library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "doc/image_ref.h"
+#include "doc/pixel_format.h"
+#include "gfx/rect.h"
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace render {
+
+  // Flattened image of the layers that are below the active layer
+  // (including the background). It's used by Render::renderSprite()
+  // to composite only the active layer and the layers above it when
+  // nothing below has changed.
+  //
+  // The key is generated by Render from the object versions of each
+  // layer/cel/image and the render options, so the cache doesn't need
+  // to observe the document to know when to invalidate itself.
+  class RenderCache {
+  public:
+    typedef std::vector<uint32_t> Key;
+
+    RenderCache();
+
+    // Returns the cached image if it was rendered with the given key
+    // and it contains the given bounds (in zoomed sprite coordinates).
+    const doc::Image* get(const Key& key, const gfx::Rect& bounds) const;
+
+    // Prepares the image to render the given key/bounds. If the key
+    // is the same, the new bounds() can be bigger than the requested
+    // one (so scrolling the editor doesn't miss the cache each time).
+    // The caller must render the whole bounds() in the returned image.
+    doc::Image* reset(const Key& key, const gfx::Rect& bounds,
+                      doc::PixelFormat pixelFormat);
+
+    // Area of the sprite (in zoomed sprite coordinates) that is
+    // cached. The cached image starts at bounds().origin().
+    const gfx::Rect& bounds() const { return m_bounds; }
+
+    void invalidate();
+
+  private:
+    Key m_key;
+    gfx::Rect m_bounds;
+    doc::ImageRef m_image;
+  };
+
+  // Flattened images of the frames that are displayed with the onion
+  // skin (without the onion skin opacity/tint), so painting in the
+  // current frame doesn't require to composite all neighbor frames
+  // again. Only frames that look the same composited in one step are
+  // cached (see Render::canCacheOnionskinFrame()).
+  class OnionskinCache {
+  public:
+    // Each entry is identified by Render (e.g. a frame number).
+    RenderCache& entry(int id);
+    const RenderCache* findEntry(int id) const;
+
+    // Removes all entries that are not in the given set.
+    void keepEntries(const std::set<int>& ids);
+
+    void invalidate();
+
+  private:
+    std::map<int, RenderCache> m_entries;
+  };
+
+} // namespace render
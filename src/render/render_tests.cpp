@@ -11,7 +11,9 @@
 #include <gtest/gtest.h>
 
 #include "render/render.h"
+#include "render/render_cache.h"
 
+#include "doc/blend_funcs.h"
 #include "doc/cel.h"
 #include "doc/context.h"
 #include "doc/document.h"
@@ -71,12 +73,12 @@ TEST(Render, Basic)
   clear_image(src, 2);
 
   std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 2, 2));
-  clear_image(dst, 1);
-  EXPECT_2X2_PIXELS(dst, 1, 1, 1, 1);
+  clear_image(dst.get(), 1);
+  EXPECT_2X2_PIXELS(dst.get(), 1, 1, 1, 1);
 
   Render render;
-  render.renderSprite(dst, doc->sprite(), frame_t(0));
-  EXPECT_2X2_PIXELS(dst, 2, 2, 2, 2);
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0));
+  EXPECT_2X2_PIXELS(dst.get(), 2, 2, 2, 2);
 }
 
 TYPED_TEST(RenderAllModes, CheckDefaultBackgroundMode)
@@ -93,13 +95,13 @@ TYPED_TEST(RenderAllModes, CheckDefaultBackgroundMode)
   put_pixel(src, 1, 1, 1);
 
   std::unique_ptr<Image> dst(Image::create(ImageTraits::pixel_format, 2, 2));
-  clear_image(dst, 1);
-  EXPECT_2X2_PIXELS(dst, 1, 1, 1, 1);
+  clear_image(dst.get(), 1);
+  EXPECT_2X2_PIXELS(dst.get(), 1, 1, 1, 1);
 
   Render render;
-  render.renderSprite(dst, doc->sprite(), frame_t(0));
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0));
   // Default background mode is to set all pixels to transparent color
-  EXPECT_2X2_PIXELS(dst, 0, 0, 0, 1);
+  EXPECT_2X2_PIXELS(dst.get(), 0, 0, 0, 1);
 }
 
 TEST(Render, DefaultBackgroundModeWithNonzeroTransparentIndex)
@@ -114,20 +116,56 @@ TEST(Render, DefaultBackgroundModeWithNonzeroTransparentIndex)
   put_pixel(src, 1, 1, 1);
 
   std::unique_ptr<Image> dst(Image::create(IMAGE_INDEXED, 2, 2));
-  clear_image(dst, 1);
-  EXPECT_2X2_PIXELS(dst, 1, 1, 1, 1);
+  clear_image(dst.get(), 1);
+  EXPECT_2X2_PIXELS(dst.get(), 1, 1, 1, 1);
 
   Render render;
-  render.renderSprite(dst, doc->sprite(), frame_t(0));
-  EXPECT_2X2_PIXELS(dst, 2, 2, 2, 1); // Indexed transparent
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0));
+  EXPECT_2X2_PIXELS(dst.get(), 2, 2, 2, 1); // Indexed transparent
 
   dst.reset(Image::create(IMAGE_RGB, 2, 2));
-  clear_image(dst, 1);
-  EXPECT_2X2_PIXELS(dst, 1, 1, 1, 1);
-  render.renderSprite(dst, doc->sprite(), frame_t(0));
+  clear_image(dst.get(), 1);
+  EXPECT_2X2_PIXELS(dst.get(), 1, 1, 1, 1);
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0));
   color_t c1 = doc->sprite()->palette(0)->entry(1);
   EXPECT_NE(0, c1);
-  EXPECT_2X2_PIXELS(dst, 0, 0, 0, c1); // RGB transparent
+  EXPECT_2X2_PIXELS(dst.get(), 0, 0, 0, c1); // RGB transparent
+}
+
+TEST(Render, IndexedOverRgb)
+{
+  Context ctx;
+  Document* doc = ctx.documents().add(2, 2, ColorMode::INDEXED);
+  Sprite* sprite = doc->sprite();
+  Palette* pal = sprite->palette(0);
+  pal->setEntry(1, rgba(255, 0, 0, 255));
+  pal->setEntry(2, rgba(0, 0, 255, 128));
+
+  Image* src = sprite->layer(0)->cel(0)->image();
+  clear_image(src, 0);
+  put_pixel(src, 1, 0, 1);
+  put_pixel(src, 0, 1, 2);
+  put_pixel(src, 1, 1, 1);
+
+  const color_t bg = rgba(0, 255, 0, 255);
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 2, 2));
+  clear_image(dst.get(), bg);
+
+  Render render;
+  render.renderLayer(dst.get(), sprite->layer(0), frame_t(0));
+  EXPECT_2X2_PIXELS(dst.get(), bg, rgba(255, 0, 0, 255),
+                    rgba_blender_normal(bg, rgba(0, 0, 255, 128), 255),
+                    rgba(255, 0, 0, 255));
+
+  // Modified palette with a semi-transparent layer
+  pal->setEntry(1, rgba(255, 255, 255, 255));
+  static_cast<LayerImage*>(sprite->layer(0))->setOpacity(128);
+  clear_image(dst.get(), bg);
+  render.renderLayer(dst.get(), sprite->layer(0), frame_t(0));
+  const color_t white = rgba_blender_normal(bg, rgba(255, 255, 255, 255), 128);
+  EXPECT_EQ(white, get_pixel(dst.get(), 1, 0));
+  EXPECT_EQ(white, get_pixel(dst.get(), 1, 1));
+  EXPECT_EQ(bg, get_pixel(dst.get(), 0, 0));
 }
 
 TEST(Render, CheckedBackground)
@@ -136,7 +174,7 @@ TEST(Render, CheckedBackground)
   Document* doc = ctx.documents().add(4, 4, ColorMode::RGB);
 
   std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
-  clear_image(dst, 0);
+  clear_image(dst.get(), 0);
 
   Render render;
   render.setBgType(BgType::CHECKED);
@@ -145,35 +183,35 @@ TEST(Render, CheckedBackground)
   render.setBgColor2(2);
 
   render.setBgCheckedSize(gfx::Size(1, 1));
-  render.renderSprite(dst, doc->sprite(), frame_t(0));
-  EXPECT_4X4_PIXELS(dst,
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0));
+  EXPECT_4X4_PIXELS(dst.get(),
     1, 2, 1, 2,
     2, 1, 2, 1,
     1, 2, 1, 2,
     2, 1, 2, 1);
 
   render.setBgCheckedSize(gfx::Size(2, 2));
-  render.renderSprite(dst, doc->sprite(), frame_t(0));
-  EXPECT_4X4_PIXELS(dst,
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0));
+  EXPECT_4X4_PIXELS(dst.get(),
     1, 1, 2, 2,
     1, 1, 2, 2,
     2, 2, 1, 1,
     2, 2, 1, 1);
 
   render.setBgCheckedSize(gfx::Size(3, 3));
-  render.renderSprite(dst, doc->sprite(), frame_t(0));
-  EXPECT_4X4_PIXELS(dst,
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0));
+  EXPECT_4X4_PIXELS(dst.get(),
     1, 1, 1, 2,
     1, 1, 1, 2,
     1, 1, 1, 2,
     2, 2, 2, 1);
 
   render.setBgCheckedSize(gfx::Size(1, 1));
-  render.renderSprite(dst,
+  render.renderSprite(dst.get(),
     doc->sprite(), frame_t(0),
     gfx::Clip(dst->bounds()),
     Zoom(2, 1));
-  EXPECT_4X4_PIXELS(dst,
+  EXPECT_4X4_PIXELS(dst.get(),
     1, 1, 2, 2,
     1, 1, 2, 2,
     2, 2, 1, 1,
@@ -194,7 +232,7 @@ TEST(Render, ZoomAndDstBounds)
   fill_rect(src, 1, 1, 2, 2, 4);
 
   std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
-  clear_image(dst, 0);
+  clear_image(dst.get(), 0);
 
   Render render;
   render.setBgType(BgType::CHECKED);
@@ -203,16 +241,242 @@ TEST(Render, ZoomAndDstBounds)
   render.setBgColor2(2);
   render.setBgCheckedSize(gfx::Size(1, 1));
 
-  render.renderSprite(dst, doc->sprite(), frame_t(0),
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0),
     gfx::Clip(1, 1, 0, 0, 2, 2),
     Zoom(1, 1));
-  EXPECT_4X4_PIXELS(dst,
+  EXPECT_4X4_PIXELS(dst.get(),
     0, 0, 0, 0,
     0, 1, 2, 0,
     0, 2, 4, 0,
     0, 0, 0, 0);
 }
 
+TEST(Render, ScaleDown)
+{
+  Context ctx;
+  Document* doc = ctx.documents().add(6, 6, ColorMode::RGB);
+  Image* src = doc->sprite()->layer(0)->cel(0)->image();
+  for (int y=0; y<6; ++y)
+    for (int x=0; x<6; ++x)
+      put_pixel(src, x, y, rgba(x, y, 0, 255));
+
+  Render render;
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
+
+  // Each output pixel is the top-left pixel of each 2x2 block
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0),
+    gfx::Clip(0, 0, 0, 0, 3, 3), Zoom(1, 2));
+  for (int y=0; y<4; ++y)
+    for (int x=0; x<4; ++x)
+      EXPECT_EQ(x < 3 && y < 3 ? rgba(x*2, y*2, 0, 255): 0,
+                get_pixel(dst.get(), x, y));
+
+  // Zoomed area starting in the middle of the sprite
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), doc->sprite(), frame_t(0),
+    gfx::Clip(1, 1, 1, 1, 3, 3), Zoom(1, 3));
+  EXPECT_4X4_PIXELS(dst.get(),
+    0, 0, 0, 0,
+    0, rgba(3, 3, 0, 255), 0, 0,
+    0, 0, 0, 0,
+    0, 0, 0, 0);
+}
+
+TEST(Render, RenderCache)
+{
+  Context ctx;
+  Document* doc = ctx.documents().add(4, 4, ColorMode::RGB);
+  Sprite* sprite = doc->sprite();
+
+  // Layers: bottom (the default one), active, top
+  Image* bottom = sprite->layer(0)->cel(0)->image();
+  clear_image(bottom, rgba(255, 0, 0, 255));
+
+  Layer* layers[2];
+  Image* images[2];
+  for (int i=0; i<2; ++i) {
+    LayerImage* layer = new LayerImage(sprite);
+    ImageRef image(Image::create(IMAGE_RGB, 4, 4));
+    clear_image(image.get(), 0);
+    layer->addCel(std::make_shared<Cel>(frame_t(0), image));
+    sprite->folder()->addLayer(layer);
+    layers[i] = layer;
+    images[i] = image.get();
+  }
+  put_pixel(images[0], 1, 1, rgba(0, 255, 0, 255));
+  put_pixel(images[1], 2, 2, rgba(0, 0, 255, 128));
+
+  std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, 4, 4));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
+
+  Render render;
+  render.setBgType(BgType::CHECKED);
+  render.setBgColor1(rgba(128, 128, 128, 255));
+  render.setBgColor2(rgba(64, 64, 64, 255));
+  render.setBgCheckedSize(gfx::Size(1, 1));
+
+  RenderCache cache;
+  for (int i=0; i<3; ++i) {
+    render.setRenderCache(nullptr, nullptr);
+    render.renderSprite(expected.get(), sprite, frame_t(0));
+
+    clear_image(dst.get(), 0);
+    render.setRenderCache(&cache, layers[0]);
+    render.renderSprite(dst.get(), sprite, frame_t(0));
+    EXPECT_EQ(0, count_diff_between_images(expected.get(), dst.get()));
+
+    // Modify the active layer (the cache is still valid)
+    if (i == 0)
+      put_pixel(images[0], 3, 0, rgba(0, 255, 255, 255));
+    // Modify the layer below (the cache must be regenerated)
+    else if (i == 1) {
+      put_pixel(bottom, 0, 3, rgba(255, 255, 0, 255));
+      bottom->incrementVersion();
+    }
+  }
+}
+
+TEST(Render, OnionskinCache)
+{
+  Context ctx;
+  Document* doc = ctx.documents().add(4, 4, ColorMode::RGB);
+  Sprite* sprite = doc->sprite();
+  sprite->setTotalFrames(2);
+  LayerImage* layer = static_cast<LayerImage*>(sprite->layer(0));
+  clear_image(layer->cel(0)->image(), rgba(255, 0, 0, 255));
+  ImageRef image(Image::create(IMAGE_RGB, 4, 4));
+  clear_image(image.get(), 0);
+  put_pixel(image.get(), 1, 1, rgba(0, 0, 255, 255));
+  layer->addCel(std::make_shared<Cel>(frame_t(1), image));
+
+  Render render;
+  OnionskinOptions opts(OnionskinType::MERGE);
+  opts.prevFrames(1);
+  opts.opacityBase(128);
+  render.setOnionskin(opts);
+
+  std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, 4, 4));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
+  render.renderSprite(expected.get(), sprite, frame_t(1));
+
+  OnionskinCache cache;
+  render.setOnionskinCache(&cache);
+  for (int i=0; i<2; ++i) {
+    clear_image(dst.get(), 0);
+    render.renderSprite(dst.get(), sprite, frame_t(1));
+    EXPECT_EQ(0, count_diff_between_images(expected.get(), dst.get()));
+  }
+  EXPECT_NE(nullptr, cache.findEntry(0));
+}
+
+TEST(Render, OnionskinCacheKeepsLayerBlending)
+{
+  Context ctx;
+  Document* doc = ctx.documents().add(4, 4, ColorMode::RGB);
+  Sprite* sprite = doc->sprite();
+  sprite->setTotalFrames(2);
+  LayerImage* bottom = static_cast<LayerImage*>(sprite->layer(0));
+  clear_image(bottom->cel(0)->image(), rgba(255, 0, 0, 255));
+
+  // Overlapping layer with other blend mode and opacity
+  LayerImage* top = new LayerImage(sprite);
+  top->setBlendMode(BlendMode::MULTIPLY);
+  top->setOpacity(128);
+  ImageRef image(Image::create(IMAGE_RGB, 4, 4));
+  clear_image(image.get(), rgba(0, 255, 255, 255));
+  top->addCel(std::make_shared<Cel>(frame_t(0), image));
+  sprite->folder()->addLayer(top);
+
+  Render render;
+  OnionskinOptions opts(OnionskinType::RED_BLUE_TINT);
+  opts.prevFrames(1);
+  opts.opacityBase(128);
+  render.setOnionskin(opts);
+
+  std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, 4, 4));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
+  clear_image(expected.get(), 0);
+  render.renderSprite(expected.get(), sprite, frame_t(1));
+
+  OnionskinCache cache;
+  render.setOnionskinCache(&cache);
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), sprite, frame_t(1));
+  EXPECT_EQ(0, count_diff_between_images(expected.get(), dst.get()));
+  EXPECT_EQ(nullptr, cache.findEntry(0));
+}
+TEST(Render, OccludedLayers)
+{
+  Context ctx;
+  Document* doc = ctx.documents().add(4, 4, ColorMode::RGB);
+  Sprite* sprite = doc->sprite();
+
+  const color_t red = rgba(255, 0, 0, 255);
+  const color_t green = rgba(0, 255, 0, 255);
+  const color_t blue = rgba(0, 0, 255, 255);
+  Image* bottom = sprite->layer(0)->cel(0)->image();
+  clear_image(bottom, red);
+
+  // Middle layer with one pixel, top layer with an opaque 2x4 cel
+  Image* images[2];
+  for (int i=0; i<2; ++i) {
+    LayerImage* layer = new LayerImage(sprite);
+    ImageRef image(Image::create(IMAGE_RGB, 2+2*(1-i), 4));
+    clear_image(image.get(), 0);
+    layer->addCel(std::make_shared<Cel>(frame_t(0), image));
+    sprite->folder()->addLayer(layer);
+    images[i] = image.get();
+  }
+  put_pixel(images[0], 1, 1, green);
+  put_pixel(images[0], 2, 2, green);
+  clear_image(images[1], blue);
+  images[0]->incrementVersion();
+  images[1]->incrementVersion();
+
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
+  Render render;
+  render.setBgType(BgType::TRANSPARENT);
+
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), sprite, frame_t(0));
+  EXPECT_4X4_PIXELS(dst.get(),
+    blue, blue, red, red,
+    blue, blue, red, red,
+    blue, blue, green, red,
+    blue, blue, red, red);
+
+  // Area covered by the top cel
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), sprite, frame_t(0),
+                      gfx::Clip(0, 0, 0, 0, 2, 4));
+  EXPECT_4X4_PIXELS(dst.get(),
+    blue, blue, 0, 0,
+    blue, blue, 0, 0,
+    blue, blue, 0, 0,
+    blue, blue, 0, 0);
+
+  // A semi-transparent pixel in the top cel shows the layers below
+  const color_t semi = rgba(0, 0, 255, 128);
+  put_pixel(images[1], 1, 1, semi);
+  images[1]->incrementVersion();
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), sprite, frame_t(0),
+                      gfx::Clip(0, 0, 0, 0, 2, 4));
+  EXPECT_EQ(rgba_blender_normal(green, semi, 255), get_pixel(dst.get(), 1, 1));
+  EXPECT_EQ(blue, get_pixel(dst.get(), 0, 0));
+
+  // Hidden top layer
+  put_pixel(images[1], 1, 1, blue);
+  images[1]->incrementVersion();
+  sprite->layer(2)->setVisible(false);
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), sprite, frame_t(0),
+                      gfx::Clip(0, 0, 0, 0, 2, 4));
+  EXPECT_EQ(green, get_pixel(dst.get(), 1, 1));
+  EXPECT_EQ(red, get_pixel(dst.get(), 0, 0));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -8,6 +8,7 @@
 #include "config.h"
 #endif
 
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <string>
@@ -54,6 +55,11 @@ namespace {
       base_free(ptr);
   }
 
+  // Bytecode of the scripts compiled in this session (indexed by
+  // their source code), so scripts that are run several times (or
+  // their events, which evaluate the file again) skip the compiler.
+  std::unordered_map<std::string, std::string> g_bytecode;
+
 // // TODO classes in modules isn't supported yet
 // std::map<std::string, Module*> g_modules;
 
@@ -112,6 +118,7 @@ public:
   }
 
   bool raiseEvent(const std::vector<script::Value>& event) override {
+    Profiler::ScriptScope profile;
     bool success = true;
     try {
       duk_push_global_object(m_handle);
@@ -132,11 +139,39 @@ public:
     return success;
   }
 
+  // Leaves the result of the script (or the error) on the stack.
+  duk_int_t compileAndRun(const std::string& code) {
+    // The console needs the result of the last expression, which is
+    // only available evaluating the code.
+    if (m_printLastResult)
+      return duk_peval_string(m_handle, code.c_str());
+
+    auto it = g_bytecode.find(code);
+    if (it != g_bytecode.end()) {
+      void* buffer = duk_push_fixed_buffer(m_handle, it->second.size());
+      std::memcpy(buffer, it->second.data(), it->second.size());
+      duk_load_function(m_handle);
+    }
+    else {
+      if (duk_pcompile_lstring(m_handle, 0, code.c_str(), code.size()) != 0)
+        return DUK_EXEC_ERROR;
+
+      duk_dup(m_handle, -1);
+      duk_dump_function(m_handle);
+      duk_size_t size = 0;
+      auto buffer = static_cast<const char*>(duk_get_buffer_data(m_handle, -1, &size));
+      g_bytecode[code].assign(buffer, size);
+      duk_pop(m_handle);
+    }
+    return duk_pcall(m_handle, 0);
+  }
+
   bool eval(const std::string& code) override {
+    Profiler::ScriptScope profile;
     bool success = true;
     try {
       initGlobals();
-      if (duk_peval_string(m_handle, code.c_str()) != 0) {
+      if (compileAndRun(code) != 0) {
         printLastResult();
         std::cout << "Error: [" << duk_safe_to_string(m_handle, -1) << "]" << std::endl;
         success = false;
@@ -183,6 +218,11 @@ public:
       void* buffer = duk_get_buffer_data(ctx, id, &size);
       if (buffer)
         return {buffer, size, false};
+      duk_get_prop_string(ctx, id, HIDDEN("self"));
+      auto self = reinterpret_cast<DukScriptObject*>(duk_get_pointer(ctx, -1));
+      duk_pop(ctx);
+      if (self)
+        return self->owner;
     } else if (type == DUK_TYPE_BUFFER) {
       duk_size_t size = 0;
       void* buffer = duk_get_buffer_data(ctx, id, &size);
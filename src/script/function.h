@@ -26,8 +26,10 @@ If an insufficient amount of arguments are provided, they will be default-constr
 #pragma once
 
 #include <type_traits>
+#include <typeinfo>
 #include <vector>
 #include <functional>
+#include "profiler.h"
 #include "value.h"
 
 namespace script {
@@ -103,6 +105,11 @@ namespace script {
     std::vector<Value> arguments;
     Value result;
 
+    // Identifies the function in the Profiler (null if it isn't a
+    // method/property of a ScriptObject)
+    const std::type_info* profileOwner = nullptr;
+    const std::string* profileName = nullptr;
+
     static std::vector<Value>& varArgs() {
       return **getVarArgsPtr();
     }
@@ -142,7 +149,13 @@ namespace script {
       while (arguments.size() < argCount) {
         arguments.push_back(Value{});
       }
-      call(result, arguments);
+      if (profileName && Profiler::isEnabled()) {
+        auto start = Profiler::Clock::now();
+        call(result, arguments);
+        Profiler::addCall(*profileOwner, *profileName, Profiler::Clock::now() - start);
+      }
+      else
+        call(result, arguments);
       arguments.clear();
     }
   };
@@ -0,0 +1,82 @@
+// LibreSprite Scripting Library
+// Copyright (c) 2026 LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "script/profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace script {
+
+static std::string class_name(const std::type_index& type)
+{
+  std::string name = type.name();
+#ifdef __GNUG__
+  int status;
+  char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+  if (status == 0)
+    name = demangled;
+  std::free(demangled);
+#endif
+  return name;
+}
+
+static double to_ms(Profiler::Clock::duration time)
+{
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+void Profiler::reset()
+{
+  m_counters.clear();
+  m_scriptTime = Clock::duration{};
+}
+
+void Profiler::addCall(const std::type_index& owner,
+                       const std::string& name,
+                       Clock::duration time)
+{
+  Counter& counter = m_counters[std::make_pair(owner, name)];
+  ++counter.calls;
+  counter.time += time;
+}
+
+std::string Profiler::report()
+{
+  std::vector<std::pair<std::string, Counter>> rows;
+  Clock::duration nativeTime{};
+  for (const auto& it : m_counters) {
+    rows.push_back(std::make_pair(class_name(it.first.first) + "." + it.first.second,
+                                  it.second));
+    nativeTime += it.second.time;
+  }
+  std::sort(rows.begin(), rows.end(),
+            [](const auto& a, const auto& b) {
+              return a.second.time > b.second.time;
+            });
+
+  char buf[256];
+  std::snprintf(buf, sizeof(buf), "Script time: %.1f ms (%.1f ms in native calls)\n",
+                to_ms(m_scriptTime), to_ms(nativeTime));
+  std::string result = buf;
+  result += "Function | calls | ms | us/call\n";
+  for (const auto& row : rows) {
+    const Counter& c = row.second;
+    std::snprintf(buf, sizeof(buf), " | %llu | %.1f | %.2f\n",
+                  (unsigned long long)c.calls, to_ms(c.time),
+                  1000.0 * to_ms(c.time) / double(std::max<std::uint64_t>(c.calls, 1)));
+    result += row.first + buf;
+  }
+  return result;
+}
+
+} // namespace script
@@ -0,0 +1,62 @@
+// LibreSprite Scripting Library
+// Copyright (c) 2026 LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <typeindex>
+#include <utility>
+
+namespace script {
+
+  // Counts the calls from scripts to native functions (methods and
+  // properties of each ScriptObject class) and the time spent in
+  // them, so we can see where scripts cross the binding too often.
+  class Profiler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Counter {
+      std::uint64_t calls = 0;
+      Clock::duration time{};
+    };
+
+    static bool isEnabled() { return m_enabled; }
+    static void setEnabled(bool state) { m_enabled = state; }
+    static void reset();
+
+    static void addCall(const std::type_index& owner,
+                        const std::string& name,
+                        Clock::duration time);
+
+    // Time spent running script code (including native calls).
+    static void addScriptTime(Clock::duration time) { m_scriptTime += time; }
+
+    // Table of native calls sorted by time.
+    static std::string report();
+
+    // Measures the time of a script evaluation or event.
+    class ScriptScope {
+    public:
+      ScriptScope() : m_start(m_enabled ? Clock::now(): Clock::time_point()) {}
+      ~ScriptScope() {
+        if (m_enabled && m_start != Clock::time_point())
+          addScriptTime(Clock::now() - m_start);
+      }
+    private:
+      Clock::time_point m_start;
+    };
+
+  private:
+    static inline bool m_enabled = false;
+    static inline Clock::duration m_scriptTime{};
+    static inline std::map<std::pair<std::type_index, std::string>, Counter> m_counters;
+  };
+
+}
@@ -13,6 +13,7 @@
 
 namespace script {
   class Engine;
+  class ScriptObject;
 
   class ObjectDestroyedException : public std::exception {};
 
@@ -73,6 +74,7 @@ namespace script {
     }
 
     inject<script::Engine> m_engine;
+    ScriptObject* owner = nullptr; // Used to receive objects as arguments
     std::unordered_map<std::string, ObjectProperty> properties;
     std::unordered_map<std::string, DocumentedFunction> functions;
     std::function<void()> onRelease;
@@ -86,12 +88,18 @@ namespace script {
   public:
     #if _DEBUG
     static inline std::size_t count{};
+    #endif
 
     ScriptObject() {
+      m_internal->owner = this;
+      #if _DEBUG
       count++;
       std::cout << "+Object count: " << count << std::endl;
+      #endif
     }
 
+    #if _DEBUG
+
     ~ScriptObject() {
       count--;
       std::cout << "-Object count: " << count << std::endl;
@@ -160,11 +168,17 @@ namespace script {
     }
 
     ObjectProperty& addProperty(const std::string& name, const Function& get = []{return Value{};}, const Function &set = [](const Value&){return Value{};}) {
-      return m_internal->addProperty(name, get, set);
+      auto& prop = m_internal->addProperty(name, get, set);
+      prop.getter.profileOwner = prop.setter.profileOwner = &typeid(*this);
+      prop.getter.profileName = prop.setter.profileName = &m_internal->properties.find(name)->first;
+      return prop;
     }
 
     DocumentedFunction& addFunction(const std::string& name, const Function& func) {
-      return m_internal->addFunction(name, func);
+      auto& function = m_internal->addFunction(name, func);
+      function.profileOwner = &typeid(*this);
+      function.profileName = &m_internal->functions.find(name)->first;
+      return function;
     }
 
     template<typename Class, typename Ret, typename ... Args>
@@ -22,6 +22,7 @@
 #include "app/resource_finder.h"
 #include <cstring>
 #include <map>
+#include <memory>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -86,6 +87,7 @@ public:
   }
 
     bool raiseEvent(const std::vector<script::Value>& event) override {
+    Profiler::ScriptScope profile;
     // return eval("if (typeof onEvent === \"function\") onEvent(\"" + event + "\");");
     bool success = true;
     try {
@@ -133,7 +135,45 @@ public:
     return success;
   }
 
+  v8::MaybeLocal<v8::Script> compile(const std::string& code, v8::Local<v8::String> source) {
+    auto& cache = codeCache();
+    auto it = cache.find(code);
+    if (it != cache.end()) {
+      // The Source takes ownership of the CachedData, which only
+      // points to our copy of the bytes.
+      v8::ScriptCompiler::Source cachedSource(
+        source,
+        new v8::ScriptCompiler::CachedData(
+          reinterpret_cast<const uint8_t*>(it->second.data()), it->second.size()));
+      auto script = v8::ScriptCompiler::Compile(context(), &cachedSource,
+                                                v8::ScriptCompiler::kConsumeCodeCache);
+      // A rejected cache (e.g. created with other V8 flags) is compiled
+      // from the source anyway.
+      if (cachedSource.GetCachedData()->rejected)
+        cache.erase(it);
+      return script;
+    }
+
+    v8::ScriptCompiler::Source plainSource(source);
+    auto script = v8::ScriptCompiler::Compile(context(), &plainSource);
+    if (!script.IsEmpty()) {
+      std::unique_ptr<v8::ScriptCompiler::CachedData> data(
+        v8::ScriptCompiler::CreateCodeCache(script.ToLocalChecked()->GetUnboundScript()));
+      if (data)
+        cache[code].assign(reinterpret_cast<const char*>(data->data), data->length);
+    }
+    return script;
+  }
+
+  // Code cache of the scripts compiled in this session, indexed by
+  // their source code.
+  static std::unordered_map<std::string, std::string>& codeCache() {
+    static std::unordered_map<std::string, std::string> cache;
+    return cache;
+  }
+
   bool eval(const std::string& code) override {
+    Profiler::ScriptScope profile;
     bool success = true;
     try {
       v8::Isolate::Scope isolatescope(m_isolate);
@@ -150,8 +190,9 @@ public:
       // Create a string containing the JavaScript source code.
       v8::Local<v8::String> source = ToLocal(v8::String::NewFromUtf8(m_isolate, code.c_str()));
 
-      // Compile the source code.
-      v8::MaybeLocal<v8::Script> script = v8::Script::Compile(context(), source);
+      // Compile the source code (using the code cache of a previous
+      // compilation of the same source, if there is one).
+      v8::MaybeLocal<v8::Script> script = compile(code, source);
       // Run the script to get the result.
       v8::MaybeLocal<v8::Value> result;
       if (!script.IsEmpty()) {
@@ -204,6 +245,10 @@ public:
     }
   }
 
+  static v8::Local<v8::Private> selfKey(v8::Isolate* isolate) {
+    return v8::Private::ForApi(isolate, ToLocal(v8::String::NewFromUtf8(isolate, "self")));
+  }
+
   static Value getValue(v8::Isolate *isolate, v8::Local<v8::Value> local) {
     if (local->IsNullOrUndefined())
       return {};
@@ -240,6 +285,13 @@ public:
       };
     }
 
+    if (local->IsObject()) {
+      v8::Local<v8::Value> self;
+      if (local.As<v8::Object>()->GetPrivate(isolate->GetCurrentContext(), selfKey(isolate)).ToLocal(&self) &&
+          self->IsExternal())
+        return reinterpret_cast<V8ScriptObject*>(self.As<v8::External>()->Value())->owner;
+    }
+
     v8::String::Utf8Value utf8(isolate, local->TypeOf(isolate));
     printf("Unknown type: [%s]\n", *utf8);
 
@@ -303,6 +355,9 @@ public:
     auto local = v8::Object::New(isolate);
     pushFunctions(local);
     pushProperties(local);
+    Check(local->SetPrivate(m_engine.get<V8Engine>()->context(),
+                            selfKey(isolate),
+                            v8::External::New(isolate, this)));
     m_local.Reset(isolate, local);
     m_local.SetWeak(this, [](const auto& info) {
       reinterpret_cast<V8ScriptObject*>(info.GetParameter())->release();
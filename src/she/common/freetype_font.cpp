@@ -17,6 +17,9 @@
 
 namespace she {
 
+// Maximum number of strings in the text length cache
+static const std::size_t kMaxTextLengths = 4096;
+
 FreeTypeFont::FreeTypeFont(const char* filename, int height)
   : m_face(m_ft.open(filename))
 {
@@ -54,7 +57,16 @@ int FreeTypeFont::charWidth(int chr) const
 
 int FreeTypeFont::textLength(const std::string& str) const
 {
-  return m_face.calcTextBounds(str).w;
+  auto it = m_textLengths.find(str);
+  if (it != m_textLengths.end())
+    return it->second;
+
+  if (m_textLengths.size() >= kMaxTextLengths)
+    m_textLengths.clear();
+
+  int length = m_face.calcTextBounds(str).w;
+  m_textLengths[str] = length;
+  return length;
 }
 
 bool FreeTypeFont::isScalable() const
@@ -65,11 +77,13 @@ bool FreeTypeFont::isScalable() const
 void FreeTypeFont::setSize(int size)
 {
   m_face.setSize(size);
+  m_textLengths.clear();
 }
 
 void FreeTypeFont::setAntialias(bool antialias)
 {
   m_face.setAntialias(antialias);
+  m_textLengths.clear();
 }
 
 FreeTypeFont* loadFreeTypeFont(const char* filename, int height)
@@ -11,6 +11,9 @@
 #include "ft/lib.h"
 #include "she/font.h"
 
+#include <string>
+#include <unordered_map>
+
 namespace she {
   class Font;
 
@@ -33,6 +36,10 @@ namespace she {
   private:
     mutable ft::Lib m_ft;
     mutable ft::Face m_face;
+
+    // Widths of the measured strings (widgets measure the same labels
+    // on each size hint/paint).
+    mutable std::unordered_map<std::string, int> m_textLengths;
   };
 
   FreeTypeFont* loadFreeTypeFont(const char* filename, int height);
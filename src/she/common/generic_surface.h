@@ -156,32 +156,28 @@ public:
             if (dstBounds.isEmpty())
               return;
 
-            int clippedRows = dstBounds.y - origDstBounds.y;
+            const int clippedRows = dstBounds.y - origDstBounds.y;
+            const int clippedCols = dstBounds.x - origDstBounds.x;
             int dst_y = dstBounds.y;
             int t;
             for (int v=0; v<dstBounds.h; ++v, ++dst_y) {
-              int bit = 0;
               const uint8_t* p = glyph.bitmap->buffer
                 + (v+clippedRows)*glyph.bitmap->pitch;
-              int dst_x = dstBounds.x;
-              uint32_t* dst_address =
-                (uint32_t*)this->getData(dst_x, dst_y);
 
               // Skip first clipped pixels
-              for (int u=0; u<dstBounds.x-origDstBounds.x; ++u) {
-                if (antialias) {
-                  ++p;
-                }
-                else {
-                  if (bit == 8) {
-                    bit = 0;
-                    ++p;
-                  }
-                }
+              int bit = 0;
+              if (antialias)
+                p += clippedCols;
+              else {
+                p += clippedCols / 8;
+                bit = clippedCols % 8;
               }
 
-              for (int u=0; u<dstBounds.w; ++u, ++dst_x) {
-                ASSERT(clipBounds.contains(gfx::Point(dst_x, dst_y)));
+              uint32_t* dst_address =
+                (uint32_t*)this->getData(dstBounds.x, dst_y);
+
+              for (int u=0; u<dstBounds.w; ++u, ++dst_address) {
+                ASSERT(clipBounds.contains(gfx::Point(dstBounds.x+u, dst_y)));
 
                 int alpha;
                 if (antialias) {
@@ -195,6 +191,11 @@ public:
                   }
                 }
 
+                // Transparent pixels of the glyph keep the backdrop
+                // (when there is no background color).
+                if (alpha == 0 && gfx::geta(bg) == 0)
+                  continue;
+
                 uint32_t backdrop = *dst_address;
                 gfx::Color backdropColor =
                   gfx::rgba(
@@ -217,8 +218,6 @@ public:
                   ((gfx::getg(output) << fd.greenShift) & fd.greenMask) |
                   ((gfx::getb(output) << fd.blueShift ) & fd.blueMask ) |
                   ((gfx::geta(output) << fd.alphaShift) & fd.alphaMask);
-
-                ++dst_address;
               }
             }
           });
@@ -0,0 +1,163 @@
+// SHE library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include <cstdint>
+
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+namespace she {
+
+  // Kernels to blend spans of 32-bit pixels of software surfaces.
+  // They work with any channel order ("alphaShift" is the position
+  // of the alpha byte) using the SDL_BLENDMODE_BLEND formula:
+  //
+  //   dstRGB = srcRGB*srcA + dstRGB*(1-srcA)
+  //   dstA   = srcA + dstA*(1-srcA)
+  //
+  // The alpha byte is blended as a color of value 255, so the same
+  // operation is applied to the four bytes. The SSE2 versions
+  // (always available on x86-64) blend 4 pixels per iteration.
+
+  namespace rgba_span {
+
+    // Rounded a*b/255 for 8-bit values
+    inline int mul_un8(int a, int b) {
+      int t = a*b + 0x80;
+      return ((t >> 8) + t) >> 8;
+    }
+
+    inline uint32_t blend_pixel(uint32_t dst, uint32_t src, int alphaShift) {
+      const int sa = (src >> alphaShift) & 0xff;
+      if (sa == 255)
+        return src;
+      if (sa == 0)
+        return dst;
+
+      src |= (0xffu << alphaShift);
+
+      uint32_t res = 0;
+      for (int shift=0; shift<32; shift+=8) {
+        const int s = (src >> shift) & 0xff;
+        const int d = (dst >> shift) & 0xff;
+        res |= uint32_t(mul_un8(s, sa) + mul_un8(d, 255-sa)) << shift;
+      }
+      return res;
+    }
+
+#ifdef __SSE2__
+    // mul_un8() for 8 lanes of 16 bits
+    inline __m128i mul_un8_epi16(__m128i a, __m128i b) {
+      __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(0x80));
+      return _mm_srli_epi16(_mm_add_epi16(_mm_srli_epi16(t, 8), t), 8);
+    }
+
+    // Copies the alpha of each pixel (unpacked to 16 bits, two
+    // pixels per register) to the four lanes of the pixel.
+    inline __m128i broadcast_alpha(__m128i px, int alphaShift) {
+      switch (alphaShift) {
+        case 0:  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0x00), 0x00);
+        case 8:  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0x55), 0x55);
+        case 16: return _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0xaa), 0xaa);
+        default: return _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0xff), 0xff);
+      }
+    }
+
+    // Blends two unpacked pixels
+    inline __m128i blend_unpacked(__m128i d, __m128i s, __m128i sa) {
+      return _mm_add_epi16(mul_un8_epi16(s, sa),
+                           mul_un8_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), sa)));
+    }
+#endif
+
+  } // namespace rgba_span
+
+  // Blends "n" pixels of "src" over "dst".
+  inline void blend_rgba_span(uint32_t* dst, const uint32_t* src, int n, int alphaShift)
+  {
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i amask = _mm_set1_epi32(int(0xffu << alphaShift));
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i+4 <= n; i+=4) {
+      const __m128i s = _mm_loadu_si128((const __m128i*)(src+i));
+      const __m128i sa = _mm_and_si128(s, amask);
+
+      // Fully transparent or opaque pixels (common in icons)
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) == 0xffff)
+        continue;
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, amask)) == 0xffff) {
+        _mm_storeu_si128((__m128i*)(dst+i), s);
+        continue;
+      }
+
+      const __m128i d = _mm_loadu_si128((const __m128i*)(dst+i));
+      const __m128i s255 = _mm_or_si128(s, amask);
+
+      const __m128i slo = _mm_unpacklo_epi8(s, zero);
+      const __m128i shi = _mm_unpackhi_epi8(s, zero);
+      const __m128i lo = rgba_span::blend_unpacked(
+        _mm_unpacklo_epi8(d, zero),
+        _mm_unpacklo_epi8(s255, zero),
+        rgba_span::broadcast_alpha(slo, alphaShift));
+      const __m128i hi = rgba_span::blend_unpacked(
+        _mm_unpackhi_epi8(d, zero),
+        _mm_unpackhi_epi8(s255, zero),
+        rgba_span::broadcast_alpha(shi, alphaShift));
+
+      _mm_storeu_si128((__m128i*)(dst+i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i<n; ++i)
+      dst[i] = rgba_span::blend_pixel(dst[i], src[i], alphaShift);
+  }
+
+  // Blends the "color" pixel (in the surface format) over "n"
+  // pixels of "dst".
+  inline void blend_color_span(uint32_t* dst, int n, uint32_t color, int alphaShift)
+  {
+    const int sa = (color >> alphaShift) & 0xff;
+    const int isa = 255 - sa;
+    color |= (0xffu << alphaShift);
+
+    // Source part of the result for each byte
+    uint32_t s = 0;
+    for (int shift=0; shift<32; shift+=8)
+      s |= uint32_t(rgba_span::mul_un8((color >> shift) & 0xff, sa)) << shift;
+
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i s16 = _mm_unpacklo_epi8(_mm_set1_epi32(int(s)), zero);
+    const __m128i isa16 = _mm_set1_epi16(short(isa));
+
+    for (; i+4 <= n; i+=4) {
+      const __m128i d = _mm_loadu_si128((const __m128i*)(dst+i));
+      const __m128i lo = _mm_add_epi16(
+        s16, rgba_span::mul_un8_epi16(_mm_unpacklo_epi8(d, zero), isa16));
+      const __m128i hi = _mm_add_epi16(
+        s16, rgba_span::mul_un8_epi16(_mm_unpackhi_epi8(d, zero), isa16));
+      _mm_storeu_si128((__m128i*)(dst+i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i<n; ++i) {
+      uint32_t res = 0;
+      for (int shift=0; shift<32; shift+=8)
+        res |= uint32_t(((s >> shift) & 0xff) +
+                        rgba_span::mul_un8((dst[i] >> shift) & 0xff, isa)) << shift;
+      dst[i] = res;
+    }
+  }
+
+} // namespace she
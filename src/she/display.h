@@ -53,6 +53,9 @@ namespace she {
     virtual void flip(const gfx::Rect& bounds) = 0;
     virtual void present() {}
 
+    // Refresh rate (in Hz) of the monitor where the display is shown.
+    virtual int refreshRate() const { return 60; }
+
     virtual void toggleFullscreen(){}
     virtual void maximize() = 0;
     virtual bool isMaximized() const = 0;
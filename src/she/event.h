@@ -9,6 +9,7 @@
 #include "gfx/point.h"
 #include "gfx/size.h"
 #include "she/keys.h"
+#include "she/pointer_sample.h"
 #include "she/pointer_type.h"
 
 #include <string>
@@ -83,6 +84,15 @@ namespace she {
     double magnification() const { return m_magnification; }
     double pressure() const { return m_pressure; }
 
+    // Tablet packets received since the previous MouseMove event (in
+    // chronological order, the last one is the current position).
+    // Empty if the device doesn't report intermediate samples.
+    const PointerSamples& samples() const { return m_samples; }
+
+    // When the event was generated by the device (a default
+    // constructed time point if the backend doesn't report it).
+    PointerSample::Time time() const { return m_time; }
+
     void setType(Type type) { m_type = type; }
     void setDisplay(Display* display) { m_display = display; }
     void setFiles(const Files& files) { m_files = files; }
@@ -98,6 +108,8 @@ namespace she {
     void setButton(MouseButton button) { m_button = button; }
     void setMagnification(double magnification) { m_magnification = magnification; }
     void setPressure(double pressure) { m_pressure = pressure; }
+    void setSamples(PointerSamples&& samples) { m_samples = std::move(samples); }
+    void setTime(const PointerSample::Time& time) { m_time = time; }
 
   private:
     Type m_type;
@@ -118,6 +130,12 @@ namespace she {
 
     // Pressure of stylus used in mouse-like events
     double m_pressure;
+
+    // For MouseMove events of tablets
+    PointerSamples m_samples;
+
+    // For MouseMove events
+    PointerSample::Time m_time;
   };
 
 } // namespace she
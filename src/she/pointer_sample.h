@@ -0,0 +1,30 @@
+// SHE library
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#pragma once
+
+#include "gfx/point.h"
+
+#include <chrono>
+#include <vector>
+
+namespace she {
+
+  // State of the pointer in one packet of the device. Tablets report
+  // several packets between two mouse events, and each one ends here.
+  struct PointerSample {
+    typedef std::chrono::steady_clock::time_point Time;
+
+    gfx::Point position;        // In display coordinates (same as Event::position())
+    float pressure = 0.0f;      // From 0.0 to 1.0
+    float tiltX = 0.0f;         // From -1.0 to 1.0 (0.0 if unknown)
+    float tiltY = 0.0f;
+    Time time;                  // When the packet was received
+  };
+
+  typedef std::vector<PointerSample> PointerSamples;
+
+} // namespace she
@@ -219,6 +219,7 @@ namespace she {
       m_surface->dispose();
     }
     m_dirty = true;
+    m_updateAll = true;
     m_surface = newSurface;
     she::sdl::screen = newSurface;
 
@@ -252,8 +253,25 @@ namespace she {
       #endif
       SDL_RenderCopy(m_renderer, texture, nullptr, nullptr);
       SDL_RenderPresent(m_renderer);
-    } else
+    } else if (m_updateAll || m_dirtyRects.empty()) {
       SDL_UpdateWindowSurface(m_window);
+    } else {
+      // Copy to the screen only the flipped areas
+      SDL_UpdateWindowSurfaceRects(m_window, m_dirtyRects.data(), int(m_dirtyRects.size()));
+    }
+    m_dirtyRects.clear();
+    m_updateAll = false;
+  }
+
+  int SDL2Display::refreshRate() const
+  {
+    SDL_DisplayMode mode;
+    if (m_window &&
+        SDL_GetWindowDisplayMode(m_window, &mode) == 0 &&
+        mode.refresh_rate > 0)
+      return mode.refresh_rate;
+    else
+      return 60;
   }
 
   void SDL2Display::flip(const gfx::Rect& bounds)
@@ -279,6 +297,10 @@ namespace she {
       rect.w * m_scale, rect.h * m_scale
     };
     SDL_BlitScaled((SDL_Surface*)m_surface->nativeHandle(), &rect, nativeSurface, &dst);
+
+    SDL_Rect windowRect {0, 0, nativeSurface->w, nativeSurface->h};
+    if (SDL_IntersectRect(&dst, &windowRect, &dst))
+      m_dirtyRects.push_back(dst);
   }
 
   void SDL2Display::maximize()
@@ -8,6 +8,8 @@
 
 #include "she/display.h"
 
+#include <vector>
+
 #if (defined(_WIN32) || defined(__linux__)) && !defined(ANDROID)
 #include <EasyTab/easytab.h>
 #undef None
@@ -58,6 +60,7 @@ namespace she {
         void* nativeHandle() override;
 
         void present() override;
+        int refreshRate() const override;
         SDL_Renderer* renderer() {return m_renderer;}
 
         static inline bool gpu{};
@@ -75,6 +78,10 @@ namespace she {
         int m_restoredHeight;
         bool m_isFullscreen = false;
         bool m_dirty = true;
+        // Window areas modified by flip() that must be updated by
+        // present() when the window surface is used (no renderer).
+        std::vector<SDL_Rect> m_dirtyRects;
+        bool m_updateAll = true;
     };
 
     extern SDL2Display* unique_display;
@@ -11,8 +11,10 @@
 #include "she/sdl2/sdl2_surface.h"
 
 #include "base/string.h"
+#include "gfx/clip.h"
 #include "gfx/point.h"
 #include "gfx/rect.h"
+#include "she/common/rgba_span.h"
 #include <iostream>
 #if __has_include(<SDL2/SDL.h>)
 #include <SDL2/SDL.h>
@@ -49,6 +51,32 @@ namespace she {
     return SDL_MapRGBA(format, gfx::getr(color), gfx::getg(color), gfx::getb(color), gfx::geta(color));
   }
 
+  // True if we can blend pixels of the surface with the
+  // she::blend_*_span() kernels.
+  inline bool has_rgba_pixels(const SDL_Surface* bmp)
+  {
+    return (bmp->format->BytesPerPixel == 4 && bmp->format->Amask != 0);
+  }
+
+  // Clips the "clip" with the size of both surfaces and the clipping
+  // rectangle of the destination.
+  static bool clip_to_surface(gfx::Clip& clip, const SDL_Surface* dst, int srcw, int srch)
+  {
+    if (!clip.clip(dst->w, dst->h, srcw, srch))
+      return false;
+
+    const gfx::Rect rc = clip.dstBounds() &
+      gfx::Rect(dst->clip_rect.x, dst->clip_rect.y,
+                dst->clip_rect.w, dst->clip_rect.h);
+    if (rc.isEmpty())
+      return false;
+
+    clip.src += rc.origin() - clip.dst;
+    clip.dst = rc.origin();
+    clip.size = rc.size();
+    return true;
+  }
+
   SDL2Surface::SDL2Surface(SDL_Surface* bmp, DestroyFlag destroy)
     : m_bmp(bmp)
     , m_destroy(destroy)
@@ -425,7 +453,17 @@ namespace she {
     auto alpha = gfx::geta(color);
     if (!alpha)
       return;
-    if (alpha != 255) {
+    if (alpha != 255 && has_rgba_pixels(m_bmp)) {
+      gfx::Clip clip(rc);
+      if (!clip_to_surface(clip, m_bmp, m_bmp->w, m_bmp->h))
+        return;
+
+      const uint32_t sdlColor = to_sdl(m_bmp->format, color);
+      for (int v=0; v<clip.size.h; ++v)
+        blend_color_span((uint32_t*)getData(clip.dst.x, clip.dst.y+v),
+                         clip.size.w, sdlColor, m_bmp->format->Ashift);
+    }
+    else if (alpha != 255) {
       if (!sdl::tempSurface)
         sdl::tempSurface = new SDL2Surface(1, 1, SDL2Surface::DeleteAndDestroy);
       SDL_FillRect(sdl::tempSurface->m_bmp, nullptr, to_sdl(sdl::tempSurface->m_bmp->format, color));
@@ -498,9 +536,67 @@ namespace she {
 
   void SDL2Surface::drawRgbaSurface(const Surface* src, int dstx, int dsty)
   {
+    // Blend the pixels directly when both surfaces have the same
+    // RGBA format (UI icons and skin parts)
+    const SDL_Surface* srcbmp = static_cast<const SDL2Surface*>(src)->m_bmp;
+    if (has_rgba_pixels(m_bmp) &&
+        srcbmp->format->format == m_bmp->format->format) {
+      gfx::Clip clip(dstx, dsty, 0, 0, srcbmp->w, srcbmp->h);
+      if (!clip_to_surface(clip, m_bmp, srcbmp->w, srcbmp->h))
+        return;
+
+      for (int v=0; v<clip.size.h; ++v)
+        blend_rgba_span((uint32_t*)getData(clip.dst.x, clip.dst.y+v),
+                        (const uint32_t*)src->getData(clip.src.x, clip.src.y+v),
+                        clip.size.w, m_bmp->format->Ashift);
+      return;
+    }
+
     src->blitTo(this, 0, 0, dstx, dsty, src->width(), src->height());
   }
 
+  void SDL2Surface::drawColoredRgbaSurface(const Surface* src, gfx::Color fg, gfx::Color bg, const gfx::Clip& clipbase)
+  {
+    if (!has_rgba_pixels(m_bmp)) {
+      GenericDrawColoredRgbaSurface<Surface>::drawColoredRgbaSurface(src, fg, bg, clipbase);
+      return;
+    }
+
+    gfx::Clip clip(clipbase);
+    if (!clip_to_surface(clip, m_bmp, src->width(), src->height()))
+      return;
+
+    SurfaceFormatData format;
+    src->getFormat(&format);
+
+    ASSERT(format.format == kRgbaSurfaceFormat);
+    ASSERT(format.bitsPerPixel == 32);
+
+    // Same result as the generic version, but reading/writing the
+    // rows directly instead of using getPixel()/putPixel()
+    SDL_PixelFormat* fmt = m_bmp->format;
+    for (int v=0; v<clip.size.h; ++v) {
+      const uint32_t* ptr = (const uint32_t*)src->getData(clip.src.x, clip.src.y+v);
+      uint32_t* dst = (uint32_t*)getData(clip.dst.x, clip.dst.y+v);
+
+      for (int u=0; u<clip.size.w; ++u, ++ptr, ++dst) {
+        const uint32_t alpha = (((*ptr) & format.alphaMask) >> format.alphaShift);
+        if (alpha == 0 && gfx::geta(bg) == 0)
+          continue;
+
+        gfx::Color dstColor = from_sdl(fmt, *dst);
+        if (gfx::geta(bg) > 0)
+          dstColor = blend(dstColor, bg);
+        if (alpha > 0)
+          dstColor = blend(dstColor, gfx::rgba(gfx::getr(fg),
+                                               gfx::getg(fg),
+                                               gfx::getb(fg), alpha));
+
+        *dst = to_sdl(fmt, dstColor);
+      }
+    }
+  }
+
   SDL_Texture* SDL2Surface::getTexture(const SDL_Rect* rect) {
     int x = rect ? rect->x : 0;
     int y = rect ? rect->y : 0;
@@ -57,6 +57,7 @@ namespace she {
     void scrollTo(const gfx::Rect& rc, int dx, int dy) override;
     void drawSurface(const Surface* src, int dstx, int dsty) override;
     void drawRgbaSurface(const Surface* src, int dstx, int dsty) override;
+    void drawColoredRgbaSurface(const Surface* src, gfx::Color fg, gfx::Color bg, const gfx::Clip& clip) override;
 
     SDL_Texture* getTexture(const SDL_Rect* rect = nullptr);
 
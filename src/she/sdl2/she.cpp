@@ -41,6 +41,10 @@
 
 float penPressure = 0;
 
+// Tablet packets received since the last MouseMove event
+static she::PointerSamples penSamples;
+static const std::size_t kMaxPenSamples = 256;
+
 #ifdef __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
 extern "C" {
@@ -274,6 +278,49 @@ static void patchEventListeners() {
   });
 }
 
+// The home directory (user data and crash sessions) is an IDBFS
+// mount, so the files survive page reloads. Its content is loaded
+// from IndexedDB before the app starts (returns true when it's
+// ready).
+static bool load_user_files() {
+  return EM_ASM_INT({
+    if (Module.userFilesLoaded === undefined) {
+      Module.userFilesLoaded = 0;
+      FS.mount(IDBFS, {}, '/home/web_user');
+      FS.syncfs(true, (err) => {
+        if (err)
+          console.error('Cannot load user files', err);
+        Module.userFilesLoaded = 1;
+      });
+    }
+    return Module.userFilesLoaded;
+  });
+}
+
+// Writes the changes of the home directory to IndexedDB. Only one
+// sync can run at the same time, the changes done meanwhile are
+// saved with the next one.
+static void persist_user_files() {
+  EM_ASM({
+    if (Module.userFilesSyncing) {
+      Module.userFilesPending = true;
+      return;
+    }
+    const sync = () => {
+      Module.userFilesSyncing = true;
+      Module.userFilesPending = false;
+      FS.syncfs(false, (err) => {
+        if (err)
+          console.error('Cannot save user files', err);
+        Module.userFilesSyncing = false;
+        if (Module.userFilesPending)
+          sync();
+      });
+    };
+    sync();
+  });
+}
+
 #endif
 
 static std::deque<she::Event> keybuffer;
@@ -350,6 +397,27 @@ namespace she {
 	getEventInternal(event, false);
     }
 
+#if defined(EASYTAB_H)
+    // Keeps the state of the tablet in each packet, so the strokes
+    // can use all of them (not only the last one before each SDL
+    // mouse motion).
+    void addPenSample() {
+      PointerSample sample;
+      sample.position = gfx::Point(EasyTab->PosX / unique_display->scale(),
+                                   EasyTab->PosY / unique_display->scale());
+      sample.pressure = EasyTab->Pressure;
+      sample.tiltX = EasyTab->TiltX;
+      sample.tiltY = EasyTab->TiltY;
+      sample.time = std::chrono::steady_clock::now();
+
+      // Too many samples without mouse motion events (e.g. the pen is
+      // hovering outside the window), keep only the recent ones.
+      if (penSamples.size() >= kMaxPenSamples)
+        penSamples.erase(penSamples.begin());
+      penSamples.push_back(sample);
+    }
+#endif
+
     void getEventInternal(Event& event, bool) {
       SDL_Event sdlEvent;
       while (SDL_PollEvent(&sdlEvent)) {
@@ -366,12 +434,14 @@ namespace she {
 	    auto& win = sdlEvent.syswm.msg->msg.win;
 	    if (EasyTab_HandleEvent(win.hwnd, win.msg, win.lParam, win.wParam) == EASYTAB_OK) {
 		penPressure = EasyTab->Pressure;
+		addPenSample();
 	    }
 	  }
 #endif
 #if defined(__linux__)
 	    if (EasyTab_HandleEvent(&sdlEvent.syswm.msg->msg.x11.event) == EASYTAB_OK) {
 		penPressure = EasyTab->Pressure;
+		addPenSample();
 	    }
 #endif
 #endif
@@ -449,8 +519,13 @@ namespace she {
               sdlEvent.motion.y / unique_display->scale()
             });
 
+	  // SDL timestamps are milliseconds since SDL_Init()
+	  event.setTime(std::chrono::steady_clock::now() -
+			std::chrono::milliseconds(SDL_GetTicks() - sdlEvent.motion.timestamp));
 	  event.setPressure(penPressure);
 	  event.setPointerType(pointerType);
+	  event.setSamples(std::move(penSamples));
+	  penSamples.clear();
           return;
 
         case SDL_FINGERMOTION:
@@ -660,6 +735,12 @@ namespace she {
     using Timestamp = std::chrono::high_resolution_clock::time_point;
     Timestamp start = std::chrono::high_resolution_clock::now();
 
+    void persistUserFiles() override {
+      #ifdef __EMSCRIPTEN__
+      gfx([]{ persist_user_files(); });
+      #endif
+    }
+
     void sleep() override {
       using namespace std::chrono_literals;
       if (shutdown)
@@ -738,7 +819,7 @@ namespace she {
       });
 
       emscripten_set_main_loop([]{
-	  if (!cfginit())
+	  if (!load_user_files() || !cfginit())
 	      return;
 	  auto sys = static_cast<SDL2System*>(g_instance);
 	  sys->mainThread = std::thread{[]{
@@ -929,12 +1010,28 @@ namespace she {
 // It must be defined by the user program code.
 extern int app_main(int argc, char* argv[]);
 
+// Returns true if the program was started with -b/--batch,
+// --server or --benchmark, in that case there is no display and the
+// video subsystem isn't needed.
+static bool is_batch_mode(int argc, char* argv[]) {
+  for (int i=1; i<argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-b" || arg == "--batch" ||
+        arg == "--server" || arg == "--benchmark")
+      return true;
+  }
+  return false;
+}
+
 int main(int argc, char* argv[]) {
   #ifdef SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR
   SDL_SetHint(SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR, "0");
   #endif
   SDL_SetHint(SDL_HINT_VIDEO_ALLOW_SCREENSAVER, "1");
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
+  Uint32 flags = SDL_INIT_EVENTS;
+  if (!is_batch_mode(argc, argv))
+    flags |= SDL_INIT_VIDEO;
+  if (SDL_Init(flags) != 0) {
     std::cerr << "Critical: Could not initialize SDL2. Aborting." << std::endl;
     return -1;
   }
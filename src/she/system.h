@@ -57,6 +57,12 @@ namespace she {
     virtual bool isMainThread() = 0;
     virtual void gfx(std::function<void()>&& func, bool sleep = false) = 0;
     virtual void sleep() = 0;
+
+    // Saves the user directory (preferences, crash sessions) in a
+    // persistent storage. It's asynchronous and does nothing in
+    // platforms where the file system is already persistent (it's
+    // used by the web version, where the files live in memory).
+    virtual void persistUserFiles() { }
   };
 
   System* create_system();
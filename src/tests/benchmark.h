@@ -0,0 +1,229 @@
+// LibreSprite
+// Copyright (C) 2026  LibreSprite contributors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#pragma once
+
+// Small micro-benchmark framework for the *_benchmark.cpp files (the
+// same idea as tests/test.h for *_tests.cpp). Each case is declared
+// with BENCHMARK(suite, name), prepares its data, and calls
+// state.run() with the code to be measured:
+//
+//   BENCHMARK(Region, Union) {
+//     gfx::Region a = ..., b = ...;
+//     state.run([&]{
+//       gfx::Region res;
+//       res.createUnion(a, b);
+//       benchmark::do_not_optimize(res);
+//     });
+//   }
+//
+// The results are printed in CSV format. They can be saved with
+// --save and compared with a previous run with --baseline. A case
+// fails if it's slower than the baseline by more than --threshold
+// percent (the exit code is 1 in that case):
+//
+//   xxx_benchmark [--filter text] [--seconds N]
+//                 [--save file.csv] [--baseline file.csv] [--threshold %]
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace benchmark {
+
+  class State {
+  public:
+    explicit State(double seconds)
+      : m_seconds(seconds)
+      , m_iterations(0)
+      , m_nsPerOp(0.0) {
+    }
+
+    // Calls "func" in batches (doubling the number of calls each
+    // time) until the given seconds are reached.
+    void run(const std::function<void()>& func) {
+      typedef std::chrono::steady_clock clock;
+
+      func();                   // Warm up
+
+      long batch = 1;
+      long total = 0;
+      double elapsed = 0.0;
+      while (elapsed < m_seconds) {
+        const auto t0 = clock::now();
+        for (long i=0; i<batch; ++i)
+          func();
+        elapsed += std::chrono::duration<double>(clock::now() - t0).count();
+        total += batch;
+        batch *= 2;
+      }
+
+      m_iterations = total;
+      m_nsPerOp = elapsed * 1e9 / double(total);
+    }
+
+    long iterations() const { return m_iterations; }
+    double nsPerOp() const { return m_nsPerOp; }
+
+  private:
+    double m_seconds;
+    long m_iterations;
+    double m_nsPerOp;
+  };
+
+  struct Case {
+    std::string name;
+    void (*func)(State& state);
+  };
+
+  inline std::vector<Case>& cases() {
+    static std::vector<Case> list;
+    return list;
+  }
+
+  struct Register {
+    Register(const char* name, void (*func)(State& state)) {
+      cases().push_back(Case{ name, func });
+    }
+  };
+
+  // Avoids that the compiler removes the computation of "value".
+  template<typename T>
+  inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+  }
+
+  // Reads a CSV file saved with --save (name -> ns per operation)
+  inline std::map<std::string, double> load_baseline(const char* filename) {
+    std::map<std::string, double> res;
+    FILE* f = std::fopen(filename, "r");
+    if (!f)
+      return res;
+
+    char buf[1024];
+    while (std::fgets(buf, sizeof(buf), f)) {
+      char* comma1 = std::strchr(buf, ',');
+      char* comma2 = (comma1 ? std::strchr(comma1+1, ','): nullptr);
+      if (!comma2)
+        continue;
+      *comma1 = 0;
+      res[buf] = std::atof(comma2+1);
+    }
+    std::fclose(f);
+    return res;
+  }
+
+} // namespace benchmark
+
+#define BENCHMARK(suite, name)                                          \
+  static void benchmark_##suite##_##name(benchmark::State& state);      \
+  static benchmark::Register benchmark_register_##suite##_##name(       \
+    #suite "." #name, benchmark_##suite##_##name);                      \
+  static void benchmark_##suite##_##name(benchmark::State& state)
+
+int main(int argc, char* argv[])
+{
+  const char* filter = nullptr;
+  const char* saveFile = nullptr;
+  const char* baselineFile = nullptr;
+  double seconds = 0.2;
+  double threshold = 10.0;
+
+  for (int i=1; i<argc; ++i) {
+    if (std::strcmp(argv[i], "--filter") == 0 && i+1 < argc)
+      filter = argv[++i];
+    else if (std::strcmp(argv[i], "--seconds") == 0 && i+1 < argc)
+      seconds = std::atof(argv[++i]);
+    else if (std::strcmp(argv[i], "--save") == 0 && i+1 < argc)
+      saveFile = argv[++i];
+    else if (std::strcmp(argv[i], "--baseline") == 0 && i+1 < argc)
+      baselineFile = argv[++i];
+    else if (std::strcmp(argv[i], "--threshold") == 0 && i+1 < argc)
+      threshold = std::atof(argv[++i]);
+    else {
+      std::fprintf(stderr,
+                   "Usage: %s [--filter text] [--seconds N]\n"
+                   "       [--save file.csv] [--baseline file.csv] [--threshold %%]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  std::map<std::string, double> baseline;
+  if (baselineFile) {
+    baseline = benchmark::load_baseline(baselineFile);
+    if (baseline.empty()) {
+      std::fprintf(stderr, "Cannot read baseline %s\n", baselineFile);
+      return 1;
+    }
+  }
+
+  FILE* save = nullptr;
+  if (saveFile) {
+    save = std::fopen(saveFile, "w");
+    if (!save) {
+      std::fprintf(stderr, "Cannot write %s\n", saveFile);
+      return 1;
+    }
+  }
+
+  int regressions = 0;
+  std::printf(baselineFile ? "name,iterations,ns_per_op,baseline_ns_per_op,change_percent,status\n":
+                             "name,iterations,ns_per_op\n");
+
+  for (const auto& c : benchmark::cases()) {
+    if (filter && c.name.find(filter) == std::string::npos)
+      continue;
+
+    benchmark::State state(seconds);
+    c.func(state);
+
+    std::printf("%s,%ld,%.2f", c.name.c_str(), state.iterations(), state.nsPerOp());
+    if (save)
+      std::fprintf(save, "%s,%ld,%.2f\n", c.name.c_str(), state.iterations(), state.nsPerOp());
+
+    if (baselineFile) {
+      auto it = baseline.find(c.name);
+      if (it != baseline.end() && it->second > 0.0) {
+        const double change = 100.0 * (state.nsPerOp() - it->second) / it->second;
+        const bool regression = (change > threshold);
+        if (regression)
+          ++regressions;
+        std::printf(",%.2f,%+.1f,%s", it->second, change,
+                    regression ? "REGRESSION": "ok");
+      }
+      else
+        std::printf(",,,new");
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+
+  if (save)
+    std::fclose(save);
+
+  if (regressions > 0) {
+    std::fprintf(stderr, "%d case(s) slower than the baseline by more than %g%%\n",
+                 regressions, threshold);
+    return 1;
+  }
+  return 0;
+}
@@ -377,9 +377,9 @@ std::string Accelerator::toString() const
   return buf;
 }
 
-bool Accelerator::isPressed(KeyModifiers modifiers, KeyScancode scancode, int unicodeChar) const
+// static
+void Accelerator::normalizeKey(KeyModifiers& modifiers, KeyScancode& scancode, int& unicodeChar)
 {
-  // Preprocess the character to be compared with the accelerator
 #ifdef PREPROCESS_KEYS
   // Directly scancode
   if ((scancode >= kKeyF1 && scancode <= kKeyF12) ||
@@ -429,6 +429,12 @@ bool Accelerator::isPressed(KeyModifiers modifiers, KeyScancode scancode, int un
     scancode = kKeyNil;
   }
 #endif
+}
+
+bool Accelerator::isPressed(KeyModifiers modifiers, KeyScancode scancode, int unicodeChar) const
+{
+  // Preprocess the character to be compared with the accelerator
+  normalizeKey(modifiers, scancode, unicodeChar);
 
 #ifdef REPORT_KEYS
   printf("%3d==%3d %3d==%3d %s==%s ",
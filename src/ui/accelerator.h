@@ -27,6 +27,11 @@ namespace ui {
 
     bool isPressed(KeyModifiers modifiers, KeyScancode scancode, int unicodeChar) const;
 
+    // Converts the key of a keyboard message to the values that are
+    // compared with the accelerators in isPressed() (e.g. Ctrl+letter
+    // is converted to the letter without scancode).
+    static void normalizeKey(KeyModifiers& modifiers, KeyScancode& scancode, int& unicodeChar);
+
     // Returns true if the key is pressed and only its modifiers are
     // pressed.
     bool isPressed() const;
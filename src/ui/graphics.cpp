@@ -94,6 +94,32 @@ void Graphics::putPixel(gfx::Color color, int x, int y)
   m_surface->putPixel(color, m_dx+x, m_dy+y);
 }
 
+void Graphics::getPixels(const std::vector<gfx::Point>& pts, std::vector<gfx::Color>& colors)
+{
+  colors.resize(pts.size());
+  if (pts.empty())
+    return;
+
+  she::SurfaceLock lock(m_surface);
+  for (std::size_t i=0; i<pts.size(); ++i)
+    colors[i] = m_surface->getPixel(m_dx+pts[i].x, m_dy+pts[i].y);
+}
+
+void Graphics::putPixels(const std::vector<gfx::Point>& pts, const std::vector<gfx::Color>& colors)
+{
+  ASSERT(pts.size() == colors.size());
+  if (pts.empty())
+    return;
+
+  gfx::Rect bounds;
+  she::SurfaceLock lock(m_surface);
+  for (std::size_t i=0; i<pts.size(); ++i) {
+    m_surface->putPixel(colors[i], m_dx+pts[i].x, m_dy+pts[i].y);
+    bounds |= gfx::Rect(pts[i].x, pts[i].y, 1, 1);
+  }
+  dirty(bounds.offset(m_dx, m_dy));
+}
+
 void Graphics::drawHLine(gfx::Color color, int x, int y, int w)
 {
   dirty(gfx::Rect(m_dx+x, m_dy+y, w, 1));
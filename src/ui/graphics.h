@@ -15,6 +15,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace gfx {
   class Region;
@@ -55,6 +56,11 @@ namespace ui {
     gfx::Color getPixel(int x, int y);
     void putPixel(gfx::Color color, int x, int y);
 
+    // Like getPixel()/putPixel() for several pixels (locking the
+    // surface just once).
+    void getPixels(const std::vector<gfx::Point>& pts, std::vector<gfx::Color>& colors);
+    void putPixels(const std::vector<gfx::Point>& pts, const std::vector<gfx::Color>& colors);
+
     void drawHLine(gfx::Color color, int x, int y, int w);
     void drawVLine(gfx::Color color, int x, int y, int h);
     void drawLine(gfx::Color color, const gfx::Point& a, const gfx::Point& b);
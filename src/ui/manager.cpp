@@ -15,6 +15,7 @@
 #include "app/task_manager.h"
 #include "base/scoped_value.h"
 #include "base/time.h"
+#include "base/trace_span.h"
 #include "she/display.h"
 #include "she/event.h"
 #include "she/event_queue.h"
@@ -33,6 +34,7 @@
 #endif
 
 #include <array>
+#include <chrono>
 #include <deque>
 #include <limits>
 #include <list>
@@ -64,6 +66,7 @@ typedef std::list<Filter*> Filters;
 
 Manager* Manager::m_defaultManager = NULL;
 gfx::Region Manager::m_dirtyRegion;
+gfx::RegionBuilder Manager::m_dirtyRects;
 
 static WidgetsList new_windows; // Windows that we should show
 static WidgetsList mouse_widgets_list; // List of widgets to send mouse events
@@ -81,6 +84,14 @@ static bool move_focus(Manager* manager, Message* msg);
 static int count_widgets_accept_focus(Widget* widget);
 static bool childs_accept_focus(Widget* widget, bool first);
 static Widget* next_widget(Widget* widget);
+// Milliseconds of jitter accepted in the main loop before a frame is
+// delayed to the next refresh of the display.
+static const base::tick_t kFrameTolerance = 2;
+
+// Dirty rectangles collected before they are merged in the dirty
+// region (they are merged before each flip too)
+static const std::size_t kMaxDirtyRects = 4096;
+
 static int cmp_left(Widget* widget, int x, int y);
 static int cmp_right(Widget* widget, int x, int y);
 static int cmp_up(Widget* widget, int x, int y);
@@ -92,6 +103,8 @@ Manager::Manager()
   , m_eventQueue(NULL)
   , m_lockedWindow(NULL)
   , m_mouseButtons(kButtonNone)
+  , m_lastFlipTime(0)
+  , m_paintTime(0.0)
 {
   if (!m_defaultManager) {
     // Empty lists
@@ -174,9 +187,11 @@ void Manager::run()
 
 void Manager::flipDisplay()
 {
+  TRACE_SPAN("Manager::flipDisplay");
   if (!m_display)
     return;
 
+  const base::tick_t t0 = base::current_tick();
   OverlayManager* overlays = OverlayManager::instance();
 
   update_cursor_overlay();
@@ -186,19 +201,63 @@ void Manager::flipDisplay()
   overlays->drawOverlays();
 
   // Flip dirty region.
+  int dirtyArea = 0;
   {
+    m_dirtyRects.unionWith(m_dirtyRegion);
     m_dirtyRegion.createIntersection(
       m_dirtyRegion,
       gfx::Region(gfx::Rect(0, 0, ui::display_w(), ui::display_h())));
 
-    for (auto& rc : m_dirtyRegion)
+    for (auto& rc : m_dirtyRegion) {
       m_display->flip(rc);
+      dirtyArea += rc.w*rc.h;
+    }
     m_display->present();
 
     m_dirtyRegion.clear();
   }
 
   overlays->restoreOverlappedAreas();
+
+  const base::tick_t t1 = base::current_tick();
+  const double frameTime = double(t1 - t0);
+  if (m_frameStats.frames == 0) {
+    m_frameStats.frameTime = frameTime;
+    m_frameStats.paintTime = m_paintTime;
+  }
+  else {
+    m_frameStats.frameTime = (3.0*m_frameStats.frameTime + frameTime) / 4.0;
+    m_frameStats.paintTime = (3.0*m_frameStats.paintTime + m_paintTime) / 4.0;
+    m_frameStats.frameInterval = (m_frameStats.frameInterval == 0.0 ?
+                                  double(t0 - m_lastFlipTime):
+                                  (3.0*m_frameStats.frameInterval + double(t0 - m_lastFlipTime)) / 4.0);
+  }
+  m_frameStats.dirtyArea = dirtyArea;
+  ++m_frameStats.frames;
+  m_lastFlipTime = t0;
+  m_paintTime = 0.0;
+}
+
+void Manager::flipDisplayIfDue()
+{
+  if (!m_display)
+    return;
+
+  // Moving the software cursor marks its old and new areas as dirty
+  update_cursor_overlay();
+
+  const base::tick_t interval = 1000 / std::max(m_display->refreshRate(), 1);
+  const base::tick_t elapsed = base::current_tick() - m_lastFlipTime;
+
+  // Nothing to show, or the previous frame is still on the screen
+  // (the region keeps growing and it's flipped in the next pass).
+  if ((m_dirtyRegion.isEmpty() && m_dirtyRects.isEmpty()) ||
+      elapsed + kFrameTolerance < interval) {
+    ++m_frameStats.skippedFrames;
+    return;
+  }
+
+  flipDisplay();
 }
 
 bool Manager::generateMessages()
@@ -278,10 +337,69 @@ static MouseButtons mouse_buttons_from_she_to_ui(const she::Event& sheEvent)
   }
 }
 
+static she::PointerSample pointer_sample_from_event(const she::Event& sheEvent)
+{
+  she::PointerSample sample;
+  sample.position = sheEvent.position();
+  sample.pressure = float(sheEvent.pressure());
+  // Events without a timestamp are supposed to be recent
+  sample.time = (sheEvent.time() != she::PointerSample::Time() ?
+                 sheEvent.time(): std::chrono::steady_clock::now());
+  return sample;
+}
+
+// Returns true if "next" can be merged with the "move" event (both
+// are consecutive MouseMove events of the same device).
+static bool can_coalesce_mouse_moves(const she::Event& move, const she::Event& next)
+{
+  return (move.type() == she::Event::MouseMove &&
+          next.type() == she::Event::MouseMove &&
+          move.pointerType() == next.pointerType() &&
+          move.modifiers() == next.modifiers());
+}
+
+// Replaces "move" with "next", keeping the intermediate positions of
+// both events as samples (so strokes don't lose points).
+static void coalesce_mouse_moves(she::Event& move, const she::Event& next)
+{
+  she::PointerSamples samples = move.samples();
+  if (samples.empty())
+    samples.push_back(pointer_sample_from_event(move));
+
+  if (next.samples().empty())
+    samples.push_back(pointer_sample_from_event(next));
+  else
+    samples.insert(samples.end(), next.samples().begin(), next.samples().end());
+
+  move = next;
+  move.setSamples(std::move(samples));
+}
+
 void Manager::generateMessagesFromSheEvents()
 {
   she::Event lastMouseMoveEvent;
 
+  // Several MouseMove events in a row (e.g. from a tablet or a
+  // trackpad) generate just one kMouseMoveMessage, so we don't look
+  // for the widget under the mouse for each one of them.
+  she::Event pendingMouseMove;
+  auto flushMouseMove =
+    [this, &pendingMouseMove, &lastMouseMoveEvent]{
+      if (pendingMouseMove.type() != she::Event::MouseMove)
+        return;
+
+      _internal_set_mouse_position(pendingMouseMove.position());
+      handleMouseMove(
+        pendingMouseMove.position(),
+        m_mouseButtons,
+        pendingMouseMove.modifiers(),
+        pendingMouseMove.pointerType(),
+        pendingMouseMove.pressure(),
+        pendingMouseMove.samples());
+      lastMouseMoveEvent = pendingMouseMove;
+      pendingMouseMove = she::Event();
+    };
+
   // Events from "she" layer.
   she::Event sheEvent;
   for (;;) {
@@ -292,6 +410,19 @@ void Manager::generateMessagesFromSheEvents()
     if (sheEvent.type() == she::Event::None)
       break;
 
+    if (sheEvent.type() == she::Event::MouseMove) {
+      if (can_coalesce_mouse_moves(pendingMouseMove, sheEvent))
+        coalesce_mouse_moves(pendingMouseMove, sheEvent);
+      else {
+        flushMouseMove();
+        pendingMouseMove = sheEvent;
+      }
+      continue;
+    }
+
+    // Other events must be processed after the pending movement
+    flushMouseMove();
+
     switch (sheEvent.type()) {
 
       case she::Event::CloseDisplay: {
@@ -349,18 +480,6 @@ void Manager::generateMessagesFromSheEvents()
         break;
       }
 
-      case she::Event::MouseMove: {
-        _internal_set_mouse_position(sheEvent.position());
-        handleMouseMove(
-          sheEvent.position(),
-          m_mouseButtons,
-          sheEvent.modifiers(),
-          sheEvent.pointerType(),
-          sheEvent.pressure());
-        lastMouseMoveEvent = sheEvent;
-        break;
-      }
-
       case she::Event::MouseDown: {
         MouseButtons pressedButton = mouse_buttons_from_she_to_ui(sheEvent);
         m_mouseButtons = (MouseButtons)((int)m_mouseButtons | (int)pressedButton);
@@ -416,9 +535,15 @@ void Manager::generateMessagesFromSheEvents()
         break;
       }
 
+      case she::Event::MouseMove:
+        // Already coalesced in pendingMouseMove (see above)
+        break;
+
     }
   }
 
+  flushMouseMove();
+
   // Generate just one kSetCursorMessage for the last mouse position
   if (lastMouseMoveEvent.type() != she::Event::None) {
     sheEvent = lastMouseMoveEvent;
@@ -432,7 +557,8 @@ void Manager::handleMouseMove(const gfx::Point& mousePos,
                               MouseButtons mouseButtons,
                               KeyModifiers modifiers,
                               PointerType pointerType,
-                              float pressure)
+                              float pressure,
+                              const she::PointerSamples& samples)
 {
   // Get the list of widgets to send mouse messages.
   mouse_widgets_list.clear();
@@ -456,16 +582,18 @@ void Manager::handleMouseMove(const gfx::Point& mousePos,
 
   // Send the mouse movement message
   Widget* dst = (capture_widget ? capture_widget: mouse_widget);
-  enqueueMessage(
-    newMouseMessage(
-      kMouseMoveMessage, dst,
-      mousePos,
-      pointerType,
-      mouseButtons,
-      modifiers,
-      {0,0},
-      false,
-      pressure));
+  Message* msg = newMouseMessage(
+    kMouseMoveMessage, dst,
+    mousePos,
+    pointerType,
+    mouseButtons,
+    modifiers,
+    {0,0},
+    false,
+    pressure);
+  if (!samples.empty())
+    static_cast<MouseMessage*>(msg)->setSamples(samples);
+  enqueueMessage(msg);
 }
 
 void Manager::handleMouseDown(const gfx::Point& mousePos,
@@ -602,7 +730,7 @@ void Manager::handleWindowZOrder()
 void Manager::dispatchMessages()
 {
   pumpQueue();
-  flipDisplay();
+  flipDisplayIfDue();
 }
 
 void Manager::addToGarbage(Widget* widget)
@@ -1010,7 +1138,9 @@ bool Manager::isFocusMovementKey(Message* msg)
 
 void Manager::dirtyRect(const gfx::Rect& bounds)
 {
-  m_dirtyRegion.createUnion(m_dirtyRegion, gfx::Region(bounds));
+  m_dirtyRects.add(bounds);
+  if (m_dirtyRects.size() >= kMaxDirtyRects)
+    m_dirtyRects.unionWith(m_dirtyRegion);
 }
 
 /* configures the window for begin the loop */
@@ -1331,7 +1461,10 @@ void Manager::pumpQueue()
 
           if (surface) {
             // Call the message handler
+            const auto t0 = std::chrono::steady_clock::now();
             done = widget->sendMessage(msg);
+            m_paintTime += std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - t0).count();
 
             // Restore clip region for paint messages.
             surface->setClipBounds(oldClip);
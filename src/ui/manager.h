@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include "base/time.h"
 #include "gfx/region.h"
+#include "she/pointer_sample.h"
 #include "ui/keys.h"
 #include "ui/message_type.h"
 #include "ui/mouse_buttons.h"
@@ -40,9 +42,25 @@ namespace ui {
     // Executes the main message loop.
     void run();
 
+    // Timing of the frames flipped to the real display.
+    struct FrameStats {
+      int frames = 0;             // Flipped frames
+      int skippedFrames = 0;      // Passes without changes or before the next refresh
+      double frameTime = 0.0;     // Average milliseconds to flip one frame
+      double frameInterval = 0.0; // Average milliseconds between two frames
+      double paintTime = 0.0;     // Average milliseconds painting widgets per frame
+      int dirtyArea = 0;          // Pixels flipped in the last frame
+    };
+
     // Refreshes the real display with the UI content.
     void flipDisplay();
 
+    // Refreshes the real display only if something was changed, and
+    // at most once per refresh of the monitor.
+    void flipDisplayIfDue();
+
+    const FrameStats& frameStats() const { return m_frameStats; }
+
     // Returns true if there are messages in the queue to be
     // distpatched through jmanager_dispatch_messages().
     bool generateMessages();
@@ -122,7 +140,8 @@ namespace ui {
                          MouseButtons mouseButtons,
                          KeyModifiers modifiers,
                          PointerType pointerType,
-                         float pressure);
+                         float pressure,
+                         const she::PointerSamples& samples);
     void handleMouseDown(const gfx::Point& mousePos,
                          MouseButtons mouseButtons,
                          KeyModifiers modifiers,
@@ -166,6 +185,7 @@ namespace ui {
 
     static Manager* m_defaultManager;
     static gfx::Region m_dirtyRegion;
+    static gfx::RegionBuilder m_dirtyRects; // Rectangles to add to m_dirtyRegion
 
     WidgetsList m_messageListeners;
     WidgetsList m_garbage;
@@ -179,6 +199,10 @@ namespace ui {
 
     // Current pressed buttons.
     MouseButtons m_mouseButtons;
+
+    base::tick_t m_lastFlipTime;
+    FrameStats m_frameStats;
+    double m_paintTime;           // Milliseconds painting since the last flip
   };
 
 } // namespace ui
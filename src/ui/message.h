@@ -8,6 +8,7 @@
 
 #include "gfx/point.h"
 #include "gfx/rect.h"
+#include "she/pointer_sample.h"
 #include "ui/base.h"
 #include "ui/keys.h"
 #include "ui/message_type.h"
@@ -127,6 +128,11 @@ namespace ui {
     bool preciseWheel() const { return m_preciseWheel; }
     float pressure() const { return m_pressure; }
 
+    // Intermediate positions of the pointer since the previous
+    // kMouseMoveMessage (see she::Event::samples()).
+    const she::PointerSamples& samples() const { return m_samples; }
+    void setSamples(const she::PointerSamples& samples) { m_samples = samples; }
+
     const gfx::Point& position() const { return m_pos; }
 
   private:
@@ -136,6 +142,7 @@ namespace ui {
     gfx::Point m_wheelDelta;    // Wheel axis variation
     bool m_preciseWheel;
     float m_pressure;
+    she::PointerSamples m_samples;
   };
 
   class TouchMessage : public Message {
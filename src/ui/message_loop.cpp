@@ -26,6 +26,9 @@ void MessageLoop::pumpMessages()
     m_manager->dispatchMessages();
   } else {
     m_manager->collectGarbage();
+
+    // A frame delayed by the last dispatch
+    m_manager->flipDisplayIfDue();
   }
   she::instance()->sleep();
 }
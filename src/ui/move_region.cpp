@@ -12,8 +12,8 @@
 
 #include "she/display.h"
 #include "she/surface.h"
-#include "she/system.h"
 
+#include <algorithm>
 #include <vector>
 
 namespace ui {
@@ -22,7 +22,6 @@ using namespace gfx;
 
 void move_region(Manager* manager, const Region& region, int dx, int dy)
 {
-  she::System* system = she::instance();
   she::Display* display = Manager::getDefault()->getDisplay();
   ASSERT(display);
   if (!display)
@@ -30,43 +29,26 @@ void move_region(Manager* manager, const Region& region, int dx, int dy)
 
   she::Surface* surface = display->getSurface();
   she::SurfaceLock lock(surface);
-  std::size_t nrects = region.size();
 
-  // Blit directly screen to screen.
-  if (nrects == 1) {
-    gfx::Rect rc = region[0];
+  // Each rectangle is scrolled in the same surface (moving its
+  // rows with memmove()). The rectangles of a region are sorted in
+  // bands from top to bottom and from left to right, so we move
+  // first the rectangles that are ahead in the direction of the
+  // movement to avoid overwriting areas that weren't moved yet.
+  std::vector<gfx::Rect> rects(region.begin(), region.end());
+  std::sort(rects.begin(), rects.end(),
+            [dx, dy](const gfx::Rect& a, const gfx::Rect& b) {
+              if (a.y != b.y)
+                return (dy > 0 ? a.y > b.y: a.y < b.y);
+              return (dx > 0 ? a.x > b.x: a.x < b.x);
+            });
+
+  for (gfx::Rect rc : rects) {
     surface->scrollTo(rc, dx, dy);
 
     rc.offset(dx, dy);
     Manager::getDefault()->dirtyRect(rc);
   }
-  // Blit saving areas and copy them.
-  else if (nrects > 1) {
-    std::vector<she::Surface*> images(nrects);
-    Region::const_iterator it, begin=region.begin(), end=region.end();
-    int c;
-
-    for (c=0, it=begin; it != end; ++it, ++c) {
-      const Rect& rc = *it;
-      she::Surface* tmpSur = system->createSurface(rc.w, rc.h);
-      {
-        she::SurfaceLock tmpSurLock(tmpSur);
-        surface->blitTo(tmpSur, rc.x, rc.y, 0, 0, rc.w, rc.h);
-      }
-      images[c] = tmpSur;
-    }
-
-    for (c=0, it=begin; it != end; ++it, ++c) {
-      gfx::Rect rc((*it).x+dx, (*it).y+dy, (*it).w, (*it).h);
-      she::Surface* tmpSur = images[c];
-      {
-        she::SurfaceLock tmpSurLock(tmpSur);
-        tmpSur->blitTo(surface, 0, 0, rc.x, rc.y, rc.w, rc.h);
-        manager->dirtyRect(rc);
-      }
-      tmpSur->dispose();
-    }
-  }
 }
 
 } // namespace ui
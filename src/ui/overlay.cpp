@@ -42,7 +42,9 @@ Overlay::~Overlay()
 she::Surface* Overlay::setSurface(she::Surface* newSurface)
 {
   she::Surface* oldSurface = m_surface;
+  markDirty();
   m_surface = newSurface;
+  markDirty();
   return oldSurface;
 }
 
@@ -59,18 +61,26 @@ void Overlay::drawOverlay(she::Surface* screen)
   if (!m_surface)
     return;
 
+  // The area is flipped only if it's dirty (because the overlay was
+  // moved or something was painted below it).
   she::SurfaceLock lock(m_surface);
   screen->drawRgbaSurface(m_surface, m_pos.x, m_pos.y);
-
-  Manager::getDefault()->dirtyRect(
-    gfx::Rect(m_pos.x, m_pos.y,
-              m_surface->width(),
-              m_surface->height()));
 }
 
 void Overlay::moveOverlay(const gfx::Point& newPos)
 {
+  if (m_pos == newPos)
+    return;
+
+  markDirty();
   m_pos = newPos;
+  markDirty();
+}
+
+void Overlay::markDirty()
+{
+  if (Manager* manager = Manager::getDefault())
+    manager->dirtyRect(bounds());
 }
 
 void Overlay::captureOverlappedArea(she::Surface* screen)
@@ -97,11 +107,6 @@ void Overlay::restoreOverlappedArea(she::Surface* screen)
   she::SurfaceLock lock(m_overlap);
   m_overlap->blitTo(screen, 0, 0, m_pos.x, m_pos.y,
                     m_overlap->width(), m_overlap->height());
-
-  Manager::getDefault()->dirtyRect(
-    gfx::Rect(m_pos.x, m_pos.y,
-              m_overlap->width(),
-              m_overlap->height()));
 }
 
 }
@@ -37,6 +37,9 @@ namespace ui {
     void drawOverlay(she::Surface* screen);
     void moveOverlay(const gfx::Point& newPos);
 
+    // Marks the area of the overlay to be flipped in the next frame.
+    void markDirty();
+
     bool operator<(const Overlay& other) const {
       return m_zorder < other.m_zorder;
     }
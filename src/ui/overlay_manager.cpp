@@ -49,14 +49,17 @@ void OverlayManager::addOverlay(Overlay* overlay)
 {
   iterator it = std::lower_bound(begin(), end(), overlay, less_than);
   m_overlays.insert(it, overlay);
+  overlay->markDirty();
 }
 
 void OverlayManager::removeOverlay(Overlay* overlay)
 {
   iterator it = std::find(begin(), end(), overlay);
   ASSERT(it != end());
-  if (it != end())
+  if (it != end()) {
     m_overlays.erase(it);
+    overlay->markDirty();
+  }
 }
 
 void OverlayManager::captureOverlappedAreas()
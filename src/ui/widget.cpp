@@ -15,6 +15,7 @@
 #include "app/modules/i18n.h"
 #include "base/memory.h"
 #include "base/string.h"
+#include "base/trace_span.h"
 #include "she/display.h"
 #include "she/font.h"
 #include "she/surface.h"
@@ -48,6 +49,11 @@ namespace ui {
 
 using namespace gfx;
 
+// Number of nested SizeHintCacheScope and generation of the
+// outermost one.
+static int size_hint_scopes = 0;
+static int size_hint_gen = 0;
+
 static inline void mark_dirty_flag(Widget* widget)
 {
   while (widget) {
@@ -71,6 +77,7 @@ Widget::Widget(WidgetType type)
   , m_bounds(0, 0, 0, 0)
   , m_parent(nullptr)
   , m_sizeHint(nullptr)
+  , m_cachedSizeHintGen(0)
   , m_minSize(0, 0)
   , m_maxSize(INT_MAX, INT_MAX)
   , m_childSpacing(0)
@@ -138,6 +145,7 @@ void Widget::initTheme()
 {
   InitThemeEvent ev(this, m_theme);
   onInitTheme(ev);
+  invalidateSizeHint();
 }
 
 int Widget::textInt() const
@@ -197,6 +205,7 @@ void Widget::setTextQuiet(const std::string& text)
 {
   m_text = m_i18n.empty() ? text : app::i18n(m_i18n, text);
   enableFlags(HAS_TEXT);
+  invalidateSizeHint();
 }
 
 std::shared_ptr<she::Font> Widget::font() const
@@ -211,6 +220,7 @@ std::shared_ptr<she::Font> Widget::font() const
 void Widget::resetFont(std::shared_ptr<she::Font> font)
 {
   m_font = font;
+  invalidateSizeHint();
 }
 
 void Widget::setBgColor(gfx::Color color)
@@ -223,6 +233,7 @@ void Widget::setTheme(Theme* theme)
 {
   m_theme = theme;
   m_font = nullptr;
+  invalidateSizeHint();
 }
 
 // ===============================================================
@@ -234,6 +245,7 @@ void Widget::setVisible(bool state)
   if (state) {
     if (hasFlags(HIDDEN)) {
       disableFlags(HIDDEN);
+      invalidateSizeHint();
       invalidate();
     }
   }
@@ -241,6 +253,7 @@ void Widget::setVisible(bool state)
     if (!hasFlags(HIDDEN)) {
       manager()->freeWidget(this); // Free from manager
       enableFlags(HIDDEN);
+      invalidateSizeHint();
     }
   }
 }
@@ -518,6 +531,7 @@ void Widget::addChild(Widget* child)
 
   m_children.push_back(child);
   child->m_parent = this;
+  invalidateSizeHint();
 }
 
 void Widget::removeChild(WidgetsList::iterator& it)
@@ -534,6 +548,7 @@ void Widget::removeChild(WidgetsList::iterator& it)
     manager->freeWidget(child);
 
   child->m_parent = NULL;
+  invalidateSizeHint();
 }
 
 void Widget::removeChild(Widget* child)
@@ -576,6 +591,7 @@ void Widget::replaceChild(Widget* oldChild, Widget* newChild)
 
   m_children.insert(m_children.begin()+index, newChild);
   newChild->m_parent = this;
+  invalidateSizeHint();
 }
 
 void Widget::insertChild(int index, Widget* child)
@@ -585,6 +601,7 @@ void Widget::insertChild(int index, Widget* child)
 
   m_children.insert(m_children.begin()+index, child);
   child->m_parent = this;
+  invalidateSizeHint();
 }
 
 // ===============================================================
@@ -663,6 +680,7 @@ Rect Widget::clientChildrenBounds() const
 
 void Widget::setBounds(const Rect& rc)
 {
+  SizeHintCacheScope cacheSizeHints;
   ResizeEvent ev(this, rc);
   onResize(ev);
 }
@@ -671,6 +689,7 @@ void Widget::setBoundsQuietly(const gfx::Rect& rc)
 {
   if (m_bounds != rc) {
     m_bounds = rc;
+    invalidateSizeHint();
 
     // Remove all paint messages for this widget.
     if (Manager* manager = this->manager())
@@ -683,17 +702,20 @@ void Widget::setBoundsQuietly(const gfx::Rect& rc)
 void Widget::setBorder(const Border& br)
 {
   m_border = br;
+  invalidateSizeHint();
 }
 
 void Widget::setChildSpacing(int childSpacing)
 {
   m_childSpacing = childSpacing;
+  invalidateSizeHint();
 }
 
 void Widget::noBorderNoChildSpacing()
 {
   m_border = gfx::Border(0, 0, 0, 0);
   m_childSpacing = 0;
+  invalidateSizeHint();
 }
 
 void Widget::getRegion(gfx::Region& region)
@@ -916,11 +938,13 @@ void Widget::getTextIconInfo(
 void Widget::setMinSize(const gfx::Size& sz)
 {
   m_minSize = sz;
+  invalidateSizeHint();
 }
 
 void Widget::setMaxSize(const gfx::Size& sz)
 {
   m_maxSize = sz;
+  invalidateSizeHint();
 }
 
 void Widget::flushRedraw()
@@ -1026,6 +1050,8 @@ void Widget::paint(Graphics* graphics, const gfx::Region& drawRegion)
 
 bool Widget::paintEvent(Graphics* graphics)
 {
+  TRACE_SPAN("Widget::paintEvent");
+
   // For transparent widgets we have to draw the parent first.
   if (isTransparent()) {
 #if _DEBUG
@@ -1187,17 +1213,7 @@ void Widget::broadcastMouseMessage(WidgetsList& targets)
 */
 Size Widget::sizeHint()
 {
-  if (m_sizeHint != NULL)
-    return *m_sizeHint;
-  else {
-    SizeHintEvent ev(this, Size(0, 0));
-    onSizeHint(ev);
-
-    Size sz(ev.sizeHint());
-    sz.w = MID(m_minSize.w, sz.w, m_maxSize.w);
-    sz.h = MID(m_minSize.h, sz.h, m_maxSize.h);
-    return sz;
-  }
+  return sizeHint(Size(0, 0));
 }
 
 /**
@@ -1218,15 +1234,34 @@ Size Widget::sizeHint(const Size& fitIn)
 {
   if (m_sizeHint != NULL)
     return *m_sizeHint;
-  else {
-    SizeHintEvent ev(this, fitIn);
-    onSizeHint(ev);
 
-    Size sz(ev.sizeHint());
-    sz.w = MID(m_minSize.w, sz.w, m_maxSize.w);
-    sz.h = MID(m_minSize.h, sz.h, m_maxSize.h);
-    return sz;
+  // Some widgets calculate their size hint from their bounds or the
+  // bounds of their parent (e.g. a TextBox inside a View), so they
+  // are part of the key too.
+  const Rect parentBounds = (m_parent ? m_parent->bounds(): Rect());
+  const bool cache = (size_hint_scopes > 0);
+  if (cache &&
+      m_cachedSizeHintGen == size_hint_gen &&
+      m_cachedSizeHintFitIn == fitIn &&
+      m_cachedSizeHintBounds == m_bounds &&
+      m_cachedSizeHintParentBounds == parentBounds)
+    return m_cachedSizeHint;
+
+  SizeHintEvent ev(this, fitIn);
+  onSizeHint(ev);
+
+  Size sz(ev.sizeHint());
+  sz.w = MID(m_minSize.w, sz.w, m_maxSize.w);
+  sz.h = MID(m_minSize.h, sz.h, m_maxSize.h);
+
+  if (cache) {
+    m_cachedSizeHintGen = size_hint_gen;
+    m_cachedSizeHintFitIn = fitIn;
+    m_cachedSizeHintBounds = m_bounds;
+    m_cachedSizeHintParentBounds = parentBounds;
+    m_cachedSizeHint = sz;
   }
+  return sz;
 }
 
 /**
@@ -1237,6 +1272,7 @@ void Widget::setSizeHint(const Size& fixedSize)
 {
   delete m_sizeHint;
   m_sizeHint = new Size(fixedSize);
+  invalidateSizeHint();
 }
 
 void Widget::setSizeHint(int fixedWidth, int fixedHeight)
@@ -1244,6 +1280,25 @@ void Widget::setSizeHint(int fixedWidth, int fixedHeight)
   setSizeHint(Size(fixedWidth, fixedHeight));
 }
 
+void Widget::invalidateSizeHint()
+{
+  for (Widget* widget=this; widget; widget=widget->m_parent)
+    widget->m_cachedSizeHintGen = 0;
+}
+
+SizeHintCacheScope::SizeHintCacheScope()
+{
+  // A new generation for each outermost scope, so nothing memoized
+  // in a previous layout is used.
+  if (size_hint_scopes++ == 0)
+    ++size_hint_gen;
+}
+
+SizeHintCacheScope::~SizeHintCacheScope()
+{
+  --size_hint_scopes;
+}
+
 // ===============================================================
 // FOCUS & MOUSE
 // ===============================================================
@@ -45,6 +45,15 @@ namespace ui {
   class Theme;
   class Window;
 
+  // While an instance of this class is alive (e.g. in one layout
+  // pass of a window), Widget::sizeHint() memoizes its result, so the
+  // same subtree isn't asked again and again by each container.
+  class SizeHintCacheScope {
+  public:
+    SizeHintCacheScope();
+    ~SizeHintCacheScope();
+  };
+
   /* Widgets are the basic visual object in LibreSprite, such as menus and grids.
 
   Widgets are non-copyable */
@@ -345,6 +354,11 @@ namespace ui {
     void setSizeHint(const gfx::Size& fixedSize);
     void setSizeHint(int fixedWidth, int fixedHeight);
 
+    // Discards the memoized size hint of this widget and all its
+    // parents (see SizeHintCacheScope). Call it when something that
+    // onSizeHint() uses is changed in the middle of a layout.
+    void invalidateSizeHint();
+
     // ===============================================================
     // MOUSE, FOCUS & KEYBOARD
     // ===============================================================
@@ -414,6 +428,14 @@ namespace ui {
     gfx::Size* m_sizeHint;
     Properties m_properties;
 
+    // Memoized result of onSizeHint() (valid in the
+    // SizeHintCacheScope with the same generation number only)
+    int m_cachedSizeHintGen;
+    gfx::Size m_cachedSizeHintFitIn;
+    gfx::Rect m_cachedSizeHintBounds;
+    gfx::Rect m_cachedSizeHintParentBounds;
+    gfx::Size m_cachedSizeHint;
+
     // Widget size limits
     gfx::Size m_minSize, m_maxSize;
 
@@ -192,6 +192,7 @@ void Window::remapWindow()
     this->setVisible(true);
   }
 
+  SizeHintCacheScope cacheSizeHints;
   setBounds(Rect(Point(bounds().x, bounds().y),
                  sizeHint()));
 
@@ -574,10 +574,13 @@ typedef struct
 {
     int32_t PosX, PosY;
     float   Pressure; // Range: 0.0f to 1.0f
+    float   TiltX, TiltY; // Range: -1.0f to 1.0f (0.0f if the tablet doesn't report tilt)
     int32_t Buttons; // Bit field. Use with the EasyTab_Buttons_ enum.
 
     int32_t RangeX, RangeY;
     int32_t MaxPressure;
+    int32_t MinTiltX, MaxTiltX;
+    int32_t MinTiltY, MaxTiltY;
 
 #ifdef __linux__
     XDevice* Device;
@@ -717,6 +720,15 @@ EasyTabResult EasyTab_Load(Display* Disp, Window Win)
                         //printf("Max/min pressure values: %d, %d\n", min, EasyTab->MaxPressure);
                     }
 
+                    // Tilt
+                    if (Info->num_axes > 4)
+                    {
+                        EasyTab->MinTiltX = Info->axes[3].min_value;
+                        EasyTab->MaxTiltX = Info->axes[3].max_value;
+                        EasyTab->MinTiltY = Info->axes[4].min_value;
+                        EasyTab->MaxTiltY = Info->axes[4].max_value;
+                    }
+
                     XEventClass EventClass;
                     DeviceMotionNotify(EasyTab->Device, EasyTab->MotionType, EventClass);
                     if (EventClass)
@@ -747,6 +759,16 @@ EasyTabResult EasyTab_HandleEvent(XEvent* Event)
     EasyTab->PosX     = MotionEvent->x;
     EasyTab->PosY     = MotionEvent->y;
     EasyTab->Pressure = (float)MotionEvent->axis_data[2] / (float)EasyTab->MaxPressure;
+
+    // The axes are reported from "first_axis" and only the changed
+    // ones could be included, so the tilt is read only when present.
+    if (MotionEvent->first_axis == 0 && MotionEvent->axes_count > 4 &&
+        EasyTab->MaxTiltX > EasyTab->MinTiltX &&
+        EasyTab->MaxTiltY > EasyTab->MinTiltY)
+    {
+        EasyTab->TiltX = 2.0f * (MotionEvent->axis_data[3] - EasyTab->MinTiltX) / (float)(EasyTab->MaxTiltX - EasyTab->MinTiltX) - 1.0f;
+        EasyTab->TiltY = 2.0f * (MotionEvent->axis_data[4] - EasyTab->MinTiltY) / (float)(EasyTab->MaxTiltY - EasyTab->MinTiltY) - 1.0f;
+    }
     return EASYTAB_OK;
 }
 